@@ -24,34 +24,80 @@
 
 #include <enca.h>
 
+/* Analysers for all languages are kept around per thread, setting
+ * them up is most of the time spent guessing the encoding of short
+ * strings like tags.
+ */
+typedef struct {
+	EncaAnalyser *analysers;
+	gsize n_analysers;
+} AnalyserSlot;
+
+static void
+analyser_slot_free (AnalyserSlot *slot)
+{
+	gsize i;
+
+	for (i = 0; i < slot->n_analysers; i++) {
+		if (slot->analysers[i])
+			enca_analyser_free (slot->analysers[i]);
+	}
+
+	g_free (slot->analysers);
+	g_slice_free (AnalyserSlot, slot);
+}
+
+static GPrivate analyser_slot = G_PRIVATE_INIT ((GDestroyNotify) analyser_slot_free);
+
+static AnalyserSlot *
+analyser_slot_get (void)
+{
+	AnalyserSlot *slot;
+	const gchar **langs;
+	gsize i;
+
+	slot = g_private_get (&analyser_slot);
+	if (slot)
+		return slot;
+
+	slot = g_slice_new0 (AnalyserSlot);
+	langs = enca_get_languages (&slot->n_analysers);
+	slot->analysers = g_new0 (EncaAnalyser, slot->n_analysers);
+
+	for (i = 0; i < slot->n_analysers; i++)
+		slot->analysers[i] = enca_analyser_alloc (langs[i]);
+
+	free (langs);
+	g_private_set (&analyser_slot, slot);
+
+	return slot;
+}
+
 gchar *
 tracker_encoding_guess_enca (const gchar *buffer,
                              gsize        size)
 {
 	gchar *encoding = NULL;
-	const gchar **langs;
-	gsize s;
+	AnalyserSlot *slot;
 	gsize i;
 
-	langs = enca_get_languages (&s);
+	slot = analyser_slot_get ();
 
-	for (i = 0; i < s && !encoding; i++) {
-		EncaAnalyser analyser;
+	for (i = 0; i < slot->n_analysers && !encoding; i++) {
 		EncaEncoding eencoding;
 
-		analyser = enca_analyser_alloc (langs[i]);
-		eencoding = enca_analyse_const (analyser, (guchar *)buffer, size);
+		if (!slot->analysers[i])
+			continue;
+
+		eencoding = enca_analyse_const (slot->analysers[i],
+		                                (guchar *) buffer, size);
 
 		if (enca_charset_is_known (eencoding.charset)) {
 			encoding = g_strdup (enca_charset_name (eencoding.charset,
 			                                        ENCA_NAME_STYLE_ICONV));
 		}
-
-		enca_analyser_free (analyser);
 	}
 
-	free (langs);
-
 	if (encoding)
 		g_debug ("Guessing charset as '%s'", encoding);
 
@@ -27,6 +27,41 @@
 #include <glib.h>
 #include "tracker-encoding-libicu.h"
 
+/* Detectors are kept around per thread, opening them loads all
+ * the charset recognizers, and detection happens for every string
+ * that is not valid UTF-8.
+ */
+static void
+detector_free (UCharsetDetector *detector)
+{
+	ucsdet_close (detector);
+}
+
+static GPrivate detector_slot = G_PRIVATE_INIT ((GDestroyNotify) detector_free);
+
+static UCharsetDetector *
+detector_get (void)
+{
+	UCharsetDetector *detector;
+	UErrorCode status = 0;
+
+	detector = g_private_get (&detector_slot);
+	if (detector)
+		return detector;
+
+	detector = ucsdet_open (&status);
+
+	if (U_FAILURE (status)) {
+		if (detector)
+			ucsdet_close (detector);
+		return NULL;
+	}
+
+	g_private_set (&detector_slot, detector);
+
+	return detector;
+}
+
 gchar *
 tracker_encoding_guess_icu (const gchar *buffer,
                             gsize        size,
@@ -39,9 +74,9 @@ tracker_encoding_guess_icu (const gchar *buffer,
 	const char *p_match = NULL;
 	int32_t conf = 0;
 
-	detector = ucsdet_open (&status);
+	detector = detector_get ();
 
-	if (U_FAILURE (status))
+	if (!detector)
 		goto failure;
 
 	if (size >= G_MAXINT32)
@@ -77,8 +112,12 @@ failure:
 	if (confidence)
 		*confidence = (gdouble) conf / 100;
 
-	if (detector)
-		ucsdet_close (detector);
+	if (detector) {
+		UErrorCode reset_status = 0;
+
+		/* Do not keep pointing to the buffer */
+		ucsdet_setText (detector, "", 0, &reset_status);
+	}
 
 	return charset;
 }
@@ -20,6 +20,8 @@
 #include "config-miners.h"
 
 #include <glib.h>
+#include <gio/gio.h>
+
 #include "tracker-encoding.h"
 
 #ifdef HAVE_ENCA
@@ -40,13 +42,67 @@ tracker_encoding_can_guess (void)
 #endif
 }
 
-gchar *
-tracker_encoding_guess (const gchar *buffer,
-                        gsize        size,
-                        gdouble     *confidence)
+/* Big buffers are sampled, by taking their beginning plus a few
+ * windows spread over the rest.
+ */
+#define SAMPLE_PREFIX_SIZE 4096
+#define SAMPLE_WINDOW_SIZE 1024
+#define SAMPLE_N_WINDOWS 4
+#define SAMPLE_SIZE (SAMPLE_PREFIX_SIZE + SAMPLE_N_WINDOWS * SAMPLE_WINDOW_SIZE)
+
+/* Files in a folder mostly share the same encoding */
+#define MAX_CACHED_DIRECTORIES 32
+
+typedef struct {
+	gchar *encoding;
+	gdouble confidence;
+} CachedEncoding;
+
+static GMutex cache_mutex;
+static GHashTable *directory_cache = NULL;
+
+static gboolean
+is_ascii (const gchar *buffer,
+          gsize        size)
+{
+	gsize i;
+
+	for (i = 0; i < size; i++) {
+		if (buffer[i] == '\0' || ((guchar) buffer[i] & 0x80) != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gchar *
+guess_sampled (const gchar *buffer,
+               gsize        size,
+               gdouble     *confidence)
 {
 	gchar *encoding = NULL;
 	gdouble conf = 1;
+	GString *sample = NULL;
+
+	if (size > SAMPLE_SIZE) {
+		gsize step, i;
+
+		sample = g_string_sized_new (SAMPLE_SIZE);
+		g_string_append_len (sample, buffer, SAMPLE_PREFIX_SIZE);
+
+		step = (size - SAMPLE_PREFIX_SIZE) / SAMPLE_N_WINDOWS;
+
+		for (i = 0; i < SAMPLE_N_WINDOWS; i++) {
+			gsize offset;
+
+			offset = SAMPLE_PREFIX_SIZE + i * step +
+				(step - SAMPLE_WINDOW_SIZE) / 2;
+			g_string_append_len (sample, &buffer[offset], SAMPLE_WINDOW_SIZE);
+		}
+
+		buffer = sample->str;
+		size = sample->len;
+	}
 
 #ifdef HAVE_LIBICU_CHARSET_DETECTION
 	encoding = tracker_encoding_guess_icu (buffer, size, &conf);
@@ -60,6 +116,125 @@ tracker_encoding_guess (const gchar *buffer,
 	}
 #endif /* HAVE_ENCA */
 
+	if (sample)
+		g_string_free (sample, TRUE);
+
+	*confidence = conf;
+
+	return encoding;
+}
+
+static void
+cached_encoding_free (CachedEncoding *cached)
+{
+	g_free (cached->encoding);
+	g_slice_free (CachedEncoding, cached);
+}
+
+static gboolean
+can_convert (const gchar *buffer,
+             gsize        size,
+             const gchar *encoding)
+{
+	gchar *converted;
+	gsize bytes_read = 0;
+
+	converted = g_convert (buffer, size, "UTF-8", encoding,
+	                       &bytes_read, NULL, NULL);
+	g_free (converted);
+
+	return converted != NULL && bytes_read == size;
+}
+
+gchar *
+tracker_encoding_guess (const gchar *buffer,
+                        gsize        size,
+                        gdouble     *confidence)
+{
+	gchar *encoding = NULL;
+	gdouble conf = 1;
+
+	if (is_ascii (buffer, size)) {
+		/* Valid in pretty much any encoding */
+	} else if (g_utf8_validate (buffer, size, NULL)) {
+		encoding = g_strdup ("UTF-8");
+	} else {
+		encoding = guess_sampled (buffer, size, &conf);
+	}
+
+	if (confidence)
+		*confidence = conf;
+
+	return encoding;
+}
+
+/* Same as tracker_encoding_guess(), reusing the encodings found for
+ * other files in the same folder as @file if they fit @buffer.
+ */
+gchar *
+tracker_encoding_guess_for_file (GFile       *file,
+                                 const gchar *buffer,
+                                 gsize        size,
+                                 gdouble     *confidence)
+{
+	g_autoptr (GFile) parent = NULL;
+	g_autofree gchar *directory = NULL;
+	gchar *encoding = NULL;
+	gdouble conf = 1;
+
+	if (is_ascii (buffer, size) || g_utf8_validate (buffer, size, NULL))
+		return tracker_encoding_guess (buffer, size, confidence);
+
+	parent = g_file_get_parent (file);
+	if (parent)
+		directory = g_file_get_uri (parent);
+
+	if (directory) {
+		CachedEncoding *cached;
+
+		g_mutex_lock (&cache_mutex);
+
+		cached = directory_cache ?
+			g_hash_table_lookup (directory_cache, directory) : NULL;
+		if (cached) {
+			encoding = g_strdup (cached->encoding);
+			conf = cached->confidence;
+		}
+
+		g_mutex_unlock (&cache_mutex);
+	}
+
+	if (encoding && !can_convert (buffer, size, encoding))
+		g_clear_pointer (&encoding, g_free);
+
+	if (!encoding) {
+		encoding = guess_sampled (buffer, size, &conf);
+
+		if (encoding && directory && conf >= 0.5) {
+			CachedEncoding *cached;
+
+			cached = g_slice_new (CachedEncoding);
+			cached->encoding = g_strdup (encoding);
+			cached->confidence = conf;
+
+			g_mutex_lock (&cache_mutex);
+
+			if (!directory_cache) {
+				directory_cache =
+					g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					                       (GDestroyNotify) cached_encoding_free);
+			} else if (g_hash_table_size (directory_cache) >= MAX_CACHED_DIRECTORIES) {
+				g_hash_table_remove_all (directory_cache);
+			}
+
+			g_hash_table_replace (directory_cache,
+			                      g_steal_pointer (&directory),
+			                      cached);
+
+			g_mutex_unlock (&cache_mutex);
+		}
+	}
+
 	if (confidence)
 		*confidence = conf;
 
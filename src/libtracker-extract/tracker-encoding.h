@@ -24,18 +24,24 @@
 #error "only <libtracker-extract/tracker-extract.h> must be included directly."
 #endif
 
-#include <glib.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
 /* Returns TRUE if there is some method available to guess encodings */
 gboolean  tracker_encoding_can_guess (void);
 
-/* Returns NULL if it couldn't guess it */
+/* Returns NULL if it couldn't guess it, or if @buffer is plain ASCII */
 gchar    *tracker_encoding_guess     (const gchar *buffer,
                                       gsize        size,
                                       gdouble     *confidence);
 
+/* Same, caching the results by folder */
+gchar    *tracker_encoding_guess_for_file (GFile       *file,
+                                           const gchar *buffer,
+                                           gsize        size,
+                                           gdouble     *confidence);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_EXTRACT_ENCODING_H__ */
@@ -26,8 +26,8 @@
 #include "tracker-utils.h"
 
 #ifdef HAVE_LIBEXIF
-
 #include <libexif/exif-data.h>
+#endif /* HAVE_LIBEXIF */
 
 #define EXIF_DATE_FORMAT "%Y:%m:%d %H:%M:%S"
 
@@ -68,6 +68,114 @@ enum {
 	EXIF_METERING_MODE_OTHER = 255,
 };
 
+static gchar *
+flash_to_string (guint16 flash)
+{
+	switch (flash) {
+	case EXIF_FLASH_NONE:
+	case EXIF_FLASH_FIRED_MISSING_STROBE:
+	case EXIF_FLASH_DID_NOT_FIRE_COMPULSORY_ON:
+	case EXIF_FLASH_DID_NOT_FIRE_COMPULSORY_OFF:
+	case EXIF_FLASH_DID_NOT_FIRE_AUTO:
+	case EXIF_FLASH_DID_NOT_FIRE_AUTO_RED_EYE_REDUCTION:
+		return g_strdup ("nmm:flash-off");
+	default:
+		return g_strdup ("nmm:flash-on");
+	}
+}
+
+static gchar *
+orientation_to_string (guint16 orientation)
+{
+	switch (orientation) {
+	case 1:
+		return g_strdup ("nfo:orientation-top");
+	case 2:
+		return g_strdup ("nfo:orientation-top-mirror");
+	case 3:
+		return g_strdup ("nfo:orientation-bottom");
+	case 4:
+		return g_strdup ("nfo:orientation-bottom-mirror");
+	case 5:
+		return g_strdup ("nfo:orientation-left-mirror");
+	case 6:
+		return g_strdup ("nfo:orientation-right");
+	case 7:
+		return g_strdup ("nfo:orientation-right-mirror");
+	case 8:
+		return g_strdup ("nfo:orientation-left");
+	default:
+		return g_strdup ("nfo:orientation-top");
+	}
+}
+
+static gchar *
+metering_mode_to_string (guint16 metering)
+{
+	switch (metering) {
+	case EXIF_METERING_MODE_AVERAGE:
+		return g_strdup ("nmm:metering-mode-average");
+	case EXIF_METERING_MODE_CENTER_WEIGHTED_AVERAGE:
+		return g_strdup ("nmm:metering-mode-center-weighted-average");
+	case EXIF_METERING_MODE_SPOT:
+		return g_strdup ("nmm:metering-mode-spot");
+	case EXIF_METERING_MODE_MULTISPOT:
+		return g_strdup ("nmm:metering-mode-multispot");
+	case EXIF_METERING_MODE_PATTERN:
+		return g_strdup ("nmm:metering-mode-pattern");
+	case EXIF_METERING_MODE_PARTIAL:
+		return g_strdup ("nmm:metering-mode-partial");
+	case EXIF_METERING_MODE_UNKNOWN:
+	case EXIF_METERING_MODE_OTHER:
+	default:
+		return g_strdup ("nmm:metering-mode-other");
+	}
+}
+
+static gchar *
+white_balance_to_string (guint16 white_balance)
+{
+	if (white_balance == 0)
+		return g_strdup ("nmm:white-balance-auto");
+
+	/* Found in the field: sunny, fluorescent, incandescent, cloudy.
+	 * These will this way also yield as manual. */
+	return g_strdup ("nmm:white-balance-manual");
+}
+
+/* @numerators and @denominators hold degrees, minutes and seconds */
+static gchar *
+gps_coordinate_to_string (const guint32 *numerators,
+                          const guint32 *denominators,
+                          gchar          ref)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gfloat f;
+
+	/* Avoid ridiculous values */
+	if (denominators[0] == 0 ||
+	    denominators[1] == 0 ||
+	    denominators[2] == 0) {
+		return NULL;
+	}
+
+	f = (gdouble) numerators[0] / denominators[0] +
+		(gdouble) numerators[1] / (denominators[1] * 60) +
+		(gdouble) numerators[2] / (denominators[2] * 60 * 60);
+
+	/* following Exif Version 2.2 specs */
+	if (ref == 'S' || ref == 'W') {
+		f = -1 * f;
+	} else if (ref != 'N' && ref != 'E') {
+		g_debug ("Invalid GPS Ref entry content");
+		return NULL;
+	}
+
+	return g_strdup (g_ascii_dtostr (buf, sizeof (buf), (gdouble) f));
+}
+
+#ifdef HAVE_LIBEXIF
+
 static gchar *
 get_date (ExifData *exif,
           ExifTag   tag)
@@ -120,17 +228,7 @@ get_flash (ExifData *exif,
 		order = exif_data_get_byte_order (exif);
 		flash = exif_get_short (entry->data, order);
 
-		switch (flash) {
-		case EXIF_FLASH_NONE:
-		case EXIF_FLASH_FIRED_MISSING_STROBE:
-		case EXIF_FLASH_DID_NOT_FIRE_COMPULSORY_ON:
-		case EXIF_FLASH_DID_NOT_FIRE_COMPULSORY_OFF:
-		case EXIF_FLASH_DID_NOT_FIRE_AUTO:
-		case EXIF_FLASH_DID_NOT_FIRE_AUTO_RED_EYE_REDUCTION:
-			return g_strdup ("nmm:flash-off");
-		default:
-			return g_strdup ("nmm:flash-on");
-		}
+		return flash_to_string (flash);
 	}
 
 	return NULL;
@@ -215,26 +313,7 @@ get_orientation (ExifData *exif,
 		order = exif_data_get_byte_order (exif);
 		orientation = exif_get_short (entry->data, order);
 
-		switch (orientation) {
-		case 1:
-			return g_strdup ("nfo:orientation-top");
-		case 2:
-			return g_strdup ("nfo:orientation-top-mirror");
-		case 3:
-			return g_strdup ("nfo:orientation-bottom");
-		case 4:
-			return g_strdup ("nfo:orientation-bottom-mirror");
-		case 5:
-			return g_strdup ("nfo:orientation-left-mirror");
-		case 6:
-			return g_strdup ("nfo:orientation-right");
-		case 7:
-			return g_strdup ("nfo:orientation-right-mirror");
-		case 8:
-			return g_strdup ("nfo:orientation-left");
-		default:
-			return g_strdup ("nfo:orientation-top");
-		}
+		return orientation_to_string (orientation);
 	}
 
 	return NULL;
@@ -253,24 +332,7 @@ get_metering_mode (ExifData *exif,
 		order = exif_data_get_byte_order (exif);
 		metering = exif_get_short (entry->data, order);
 
-		switch (metering) {
-		case EXIF_METERING_MODE_AVERAGE:
-			return g_strdup ("nmm:metering-mode-average");
-		case EXIF_METERING_MODE_CENTER_WEIGHTED_AVERAGE:
-			return g_strdup ("nmm:metering-mode-center-weighted-average");
-		case EXIF_METERING_MODE_SPOT:
-			return g_strdup ("nmm:metering-mode-spot");
-		case EXIF_METERING_MODE_MULTISPOT:
-			return g_strdup ("nmm:metering-mode-multispot");
-		case EXIF_METERING_MODE_PATTERN:
-			return g_strdup ("nmm:metering-mode-pattern");
-		case EXIF_METERING_MODE_PARTIAL:
-			return g_strdup ("nmm:metering-mode-partial");
-		case EXIF_METERING_MODE_UNKNOWN:
-		case EXIF_METERING_MODE_OTHER:
-		default:
-			return g_strdup ("nmm:metering-mode-other");
-		}
+		return metering_mode_to_string (metering);
 	}
 
 	return NULL;
@@ -289,12 +351,7 @@ get_white_balance (ExifData *exif,
 		order = exif_data_get_byte_order (exif);
 		white_balance = exif_get_short (entry->data, order);
 
-		if (white_balance == 0)
-			return g_strdup ("nmm:white-balance-auto");
-
-		/* Found in the field: sunny, fluorescent, incandescent, cloudy.
-		 * These will this way also yield as manual. */
-		return g_strdup ("nmm:white-balance-manual");
+		return white_balance_to_string (white_balance);
 	}
 
 	return NULL;
@@ -310,41 +367,26 @@ get_gps_coordinate (ExifData *exif,
 
 	if (entry && refentry) {
 		ExifByteOrder order;
-		ExifRational degrees, minutes, seconds;
-		gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-		gfloat f;
+		ExifRational rational;
+		guint32 numerators[3], denominators[3];
+		gint i;
 
 		if (entry->size == 24) {
 			order = exif_data_get_byte_order (exif);
-			degrees = exif_get_rational (entry->data, order);
-			minutes = exif_get_rational (entry->data + 8, order);
-			seconds = exif_get_rational (entry->data + 16, order);
-
-			/* Avoid ridiculous values */
-			if (degrees.denominator == 0 ||
-			    minutes.denominator == 0 ||
-			    seconds.denominator == 0) {
-				return NULL;
-			}
 
-			f = (gdouble) degrees.numerator / degrees.denominator +
-				(gdouble) minutes.numerator / (minutes.denominator * 60) +
-				(gdouble) seconds.numerator / (seconds.denominator * 60 * 60);
+			for (i = 0; i < 3; i++) {
+				rational = exif_get_rational (entry->data + i * 8, order);
+				numerators[i] = rational.numerator;
+				denominators[i] = rational.denominator;
+			}
 
 			if (refentry->format != EXIF_FORMAT_ASCII || refentry->size < 2) {
 				g_debug ("Invalid format/size for GPS ref entry");
 				return NULL;
 			}
 
-			/* following Exif Version 2.2 specs */
-			if (refentry->data[0] == 'S' || refentry->data[0] == 'W') {
-				f = -1 * f;
-			} else if (refentry->data[0] != 'N' && refentry->data[0] != 'E') {
-				g_debug ("Invalid GPS Ref entry content");
-				return NULL;
-			}
-
-			return g_strdup (g_ascii_dtostr (buf, sizeof (buf), (gdouble) f));
+			return gps_coordinate_to_string (numerators, denominators,
+			                                 refentry->data[0]);
 		} else {
 			gchar buf[25] = { 0 };
 
@@ -481,6 +523,696 @@ get_value (ExifData *exif,
 
 #endif /* HAVE_LIBEXIF */
 
+/* Reader of the TIFF structure inside EXIF blobs, going once through
+ * the IFDs holding the tags mapped to TrackerExifData, and reading
+ * their values straight from the buffer. libexif is only used for
+ * blobs it does not understand.
+ */
+
+enum {
+	TIFF_FORMAT_BYTE = 1,
+	TIFF_FORMAT_ASCII = 2,
+	TIFF_FORMAT_SHORT = 3,
+	TIFF_FORMAT_LONG = 4,
+	TIFF_FORMAT_RATIONAL = 5,
+	TIFF_FORMAT_SRATIONAL = 10,
+	TIFF_FORMAT_IFD = 13,
+	TIFF_FORMAT_LAST = 13,
+};
+
+/* Sizes of the TIFF formats, by format */
+static const guint8 tiff_format_sizes[] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8, 4 };
+
+/* Image IFDs looked up for the full resolution image of RAW files */
+#define TIFF_MAX_SUB_IFDS 8
+
+enum {
+	TAG_NEW_SUBFILE_TYPE = 0x00fe,
+	TAG_IMAGE_WIDTH = 0x0100,
+	TAG_IMAGE_LENGTH = 0x0101,
+	TAG_DOCUMENT_NAME = 0x010d,
+	TAG_IMAGE_DESCRIPTION = 0x010e,
+	TAG_MAKE = 0x010f,
+	TAG_MODEL = 0x0110,
+	TAG_ORIENTATION = 0x0112,
+	TAG_X_RESOLUTION = 0x011a,
+	TAG_Y_RESOLUTION = 0x011b,
+	TAG_RESOLUTION_UNIT = 0x0128,
+	TAG_SOFTWARE = 0x0131,
+	TAG_DATE_TIME = 0x0132,
+	TAG_ARTIST = 0x013b,
+	TAG_SUB_IFDS = 0x014a,
+	TAG_COPYRIGHT = 0x8298,
+	TAG_EXPOSURE_TIME = 0x829a,
+	TAG_FNUMBER = 0x829d,
+	TAG_EXIF_IFD_POINTER = 0x8769,
+	TAG_GPS_INFO_IFD_POINTER = 0x8825,
+	TAG_ISO_SPEED_RATINGS = 0x8827,
+	TAG_DATE_TIME_ORIGINAL = 0x9003,
+	TAG_METERING_MODE = 0x9207,
+	TAG_FLASH = 0x9209,
+	TAG_FOCAL_LENGTH = 0x920a,
+	TAG_USER_COMMENT = 0x9286,
+	TAG_PIXEL_X_DIMENSION = 0xa002,
+	TAG_PIXEL_Y_DIMENSION = 0xa003,
+	TAG_WHITE_BALANCE = 0xa403,
+};
+
+/* Tags in the GPS IFD */
+enum {
+	TAG_GPS_LATITUDE_REF = 0x0001,
+	TAG_GPS_LATITUDE = 0x0002,
+	TAG_GPS_LONGITUDE_REF = 0x0003,
+	TAG_GPS_LONGITUDE = 0x0004,
+	TAG_GPS_ALTITUDE_REF = 0x0005,
+	TAG_GPS_ALTITUDE = 0x0006,
+	TAG_GPS_IMG_DIRECTION = 0x0011,
+};
+
+typedef struct {
+	const guchar *data;
+	gsize len;
+	gboolean big_endian;
+} TiffReader;
+
+typedef struct {
+	guint16 tag;
+	guint16 format;
+	guint32 count;
+	const guchar *value;
+	gsize size;
+} TiffEntry;
+
+typedef struct {
+	TrackerExifData *data;
+	guint32 exif_ifd;
+	guint32 gps_ifd;
+	TiffEntry gps_latitude;
+	TiffEntry gps_latitude_ref;
+	TiffEntry gps_longitude;
+	TiffEntry gps_longitude_ref;
+	TiffEntry gps_altitude;
+	TiffEntry gps_altitude_ref;
+
+	/* Image size, only looked up in whole TIFF files */
+	guint32 sub_ifds[TIFF_MAX_SUB_IFDS];
+	guint n_sub_ifds;
+	guint32 ifd_subfile_type;
+	guint32 ifd_width;
+	guint32 ifd_length;
+	guint32 width;
+	guint32 length;
+	guint32 pixel_x;
+	guint32 pixel_y;
+} TiffWalk;
+
+static guint16
+tiff_get_short (const TiffReader *reader,
+                const guchar     *p)
+{
+	if (reader->big_endian)
+		return (p[0] << 8) | p[1];
+	else
+		return (p[1] << 8) | p[0];
+}
+
+static guint32
+tiff_get_long (const TiffReader *reader,
+               const guchar     *p)
+{
+	if (reader->big_endian)
+		return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	else
+		return ((guint32) p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+/* Skips the APP1 header, also finding it in whole JPEG files */
+static gboolean
+tiff_reader_init (TiffReader   *reader,
+                  const guchar *buffer,
+                  gsize         len)
+{
+	if (len >= 2 && buffer[0] == 0xff && buffer[1] == 0xd8) {
+		gsize pos = 2;
+
+		while (pos + 4 <= len && buffer[pos] == 0xff) {
+			gsize seg_len = (buffer[pos + 2] << 8) | buffer[pos + 3];
+
+			/* Start of scan */
+			if (buffer[pos + 1] == 0xda || seg_len < 2 ||
+			    pos + 2 + seg_len > len)
+				return FALSE;
+
+			if (buffer[pos + 1] == 0xe1 && seg_len >= 8 &&
+			    memcmp (&buffer[pos + 4], "Exif\0\0", 6) == 0) {
+				buffer += pos + 4;
+				len = seg_len - 2;
+				break;
+			}
+
+			pos += 2 + seg_len;
+		}
+	}
+
+	if (len >= 6 && memcmp (buffer, "Exif\0\0", 6) == 0) {
+		buffer += 6;
+		len -= 6;
+	}
+
+	if (len < 8)
+		return FALSE;
+
+	/* Olympus ORF files use their own magic numbers */
+	if (memcmp (buffer, "II*\0", 4) == 0 ||
+	    memcmp (buffer, "IIRO", 4) == 0 ||
+	    memcmp (buffer, "IIRS", 4) == 0)
+		reader->big_endian = FALSE;
+	else if (memcmp (buffer, "MM\0*", 4) == 0 ||
+	         memcmp (buffer, "MMOR", 4) == 0)
+		reader->big_endian = TRUE;
+	else
+		return FALSE;
+
+	reader->data = buffer;
+	reader->len = len;
+
+	return TRUE;
+}
+
+static gboolean
+tiff_read_entry (const TiffReader *reader,
+                 const guchar     *p,
+                 TiffEntry        *entry)
+{
+	guint32 offset;
+
+	entry->tag = tiff_get_short (reader, p);
+	entry->format = tiff_get_short (reader, p + 2);
+	entry->count = tiff_get_long (reader, p + 4);
+
+	if (entry->format == 0 || entry->format > TIFF_FORMAT_LAST ||
+	    entry->count > reader->len)
+		return FALSE;
+
+	entry->size = (gsize) entry->count * tiff_format_sizes[entry->format];
+	if (entry->size == 0 || entry->size > reader->len)
+		return FALSE;
+
+	if (entry->size <= 4) {
+		entry->value = p + 8;
+	} else {
+		offset = tiff_get_long (reader, p + 8);
+		if (offset > reader->len - entry->size)
+			return FALSE;
+
+		entry->value = reader->data + offset;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+tiff_entry_get_short (const TiffReader *reader,
+                      const TiffEntry  *entry,
+                      guint16          *value)
+{
+	if (entry->format != TIFF_FORMAT_SHORT)
+		return FALSE;
+
+	*value = tiff_get_short (reader, entry->value);
+	return TRUE;
+}
+
+static gboolean
+tiff_entry_get_long (const TiffReader *reader,
+                     const TiffEntry  *entry,
+                     guint32          *value)
+{
+	if (entry->format == TIFF_FORMAT_SHORT)
+		*value = tiff_get_short (reader, entry->value);
+	else if (entry->format == TIFF_FORMAT_LONG)
+		*value = tiff_get_long (reader, entry->value);
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+tiff_entry_get_rational (const TiffReader *reader,
+                         const TiffEntry  *entry,
+                         guint             n,
+                         guint32          *numerator,
+                         guint32          *denominator)
+{
+	if ((entry->format != TIFF_FORMAT_RATIONAL &&
+	     entry->format != TIFF_FORMAT_SRATIONAL) ||
+	    n >= entry->count)
+		return FALSE;
+
+	*numerator = tiff_get_long (reader, entry->value + n * 8);
+	*denominator = tiff_get_long (reader, entry->value + n * 8 + 4);
+
+	return TRUE;
+}
+
+static gboolean
+tiff_entry_get_double (const TiffReader *reader,
+                       const TiffEntry  *entry,
+                       gdouble          *value)
+{
+	guint32 numerator, denominator;
+
+	if (!tiff_entry_get_rational (reader, entry, 0, &numerator, &denominator) ||
+	    denominator == 0)
+		return FALSE;
+
+	if (entry->format == TIFF_FORMAT_SRATIONAL)
+		*value = (gdouble) (gint32) numerator / (gint32) denominator;
+	else
+		*value = (gdouble) numerator / denominator;
+
+	return TRUE;
+}
+
+static gchar *
+tiff_entry_get_string (const TiffEntry *entry)
+{
+	if (entry->format != TIFF_FORMAT_ASCII)
+		return NULL;
+
+	return g_strndup ((const gchar *) entry->value, entry->size);
+}
+
+static gchar *
+tiff_entry_get_double_str (const TiffReader *reader,
+                           const TiffEntry  *entry,
+                           const gchar      *format)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gdouble value;
+
+	if (!tiff_entry_get_double (reader, entry, &value))
+		return NULL;
+
+	if (format)
+		g_ascii_formatd (buf, sizeof (buf), format, value);
+	else
+		g_ascii_dtostr (buf, sizeof (buf), value);
+
+	return g_strdup (buf);
+}
+
+static gchar *
+tiff_entry_get_user_comment (const TiffReader *reader,
+                             const TiffEntry  *entry)
+{
+	const gchar *str = (const gchar *) entry->value;
+
+	/* The first 8 bytes tell the character code */
+	if (entry->size >= 8 &&
+	    (memcmp (str, "ASCII\0\0\0", 8) == 0 ||
+	     memcmp (str, "JIS\0\0\0\0\0", 8) == 0)) {
+		return g_strndup (str + 8, entry->size - 8);
+	}
+
+	if (entry->size >= 8 && memcmp (str, "UNICODE\0", 8) == 0) {
+		return g_convert (str + 8, entry->size - 8, "UTF-8",
+		                  reader->big_endian ? "UTF-16BE" : "UTF-16LE",
+		                  NULL, NULL, NULL);
+	}
+
+	return g_strndup (str, entry->size);
+}
+
+/* Only the photographer part, there may be an editor one after a nul */
+static gchar *
+tiff_entry_get_copyright (const TiffEntry *entry)
+{
+	const gchar *str = (const gchar *) entry->value;
+	gsize len;
+
+	if (entry->format != TIFF_FORMAT_ASCII)
+		return NULL;
+
+	len = strnlen (str, entry->size);
+
+	if (len == 0 && entry->size > 1)
+		return g_strndup (str + 1, entry->size - 1);
+
+	return g_strndup (str, len);
+}
+
+static void
+tiff_walk_entry (const TiffReader *reader,
+                 TiffWalk         *walk,
+                 const TiffEntry  *entry)
+{
+	TrackerExifData *data = walk->data;
+	guint16 value;
+	gchar *str;
+
+	switch (entry->tag) {
+	case TAG_DOCUMENT_NAME:
+		if (!data->document_name)
+			data->document_name = tiff_entry_get_string (entry);
+		break;
+	case TAG_IMAGE_DESCRIPTION:
+		if (!data->description)
+			data->description = tiff_entry_get_string (entry);
+		break;
+	case TAG_MAKE:
+		if (!data->make)
+			data->make = tiff_entry_get_string (entry);
+		break;
+	case TAG_MODEL:
+		if (!data->model)
+			data->model = tiff_entry_get_string (entry);
+		break;
+	case TAG_SOFTWARE:
+		if (!data->software)
+			data->software = tiff_entry_get_string (entry);
+		break;
+	case TAG_ARTIST:
+		if (!data->artist)
+			data->artist = tiff_entry_get_string (entry);
+		break;
+	case TAG_COPYRIGHT:
+		if (!data->copyright)
+			data->copyright = tiff_entry_get_copyright (entry);
+		break;
+	case TAG_DATE_TIME:
+	case TAG_DATE_TIME_ORIGINAL:
+		if (entry->tag == TAG_DATE_TIME ? data->time : data->time_original)
+			break;
+
+		str = tiff_entry_get_string (entry);
+		if (str) {
+			/* From: ex; date "2007:04:15 15:35:58"
+			 * To  : ex. "2007-04-15T17:35:58+0200 where +0200 is offset w.r.t gmt */
+			if (entry->tag == TAG_DATE_TIME)
+				data->time = tracker_date_format_to_iso8601 (str, EXIF_DATE_FORMAT);
+			else
+				data->time_original = tracker_date_format_to_iso8601 (str, EXIF_DATE_FORMAT);
+			g_free (str);
+		}
+		break;
+	case TAG_USER_COMMENT:
+		if (!data->user_comment)
+			data->user_comment = tiff_entry_get_user_comment (reader, entry);
+		break;
+	case TAG_ORIENTATION:
+		if (!data->orientation && tiff_entry_get_short (reader, entry, &value))
+			data->orientation = orientation_to_string (value);
+		break;
+	case TAG_METERING_MODE:
+		if (!data->metering_mode && tiff_entry_get_short (reader, entry, &value))
+			data->metering_mode = metering_mode_to_string (value);
+		break;
+	case TAG_FLASH:
+		if (!data->flash && tiff_entry_get_short (reader, entry, &value))
+			data->flash = flash_to_string (value);
+		break;
+	case TAG_WHITE_BALANCE:
+		if (!data->white_balance && tiff_entry_get_short (reader, entry, &value))
+			data->white_balance = white_balance_to_string (value);
+		break;
+	case TAG_ISO_SPEED_RATINGS:
+		if (!data->iso_speed_ratings && tiff_entry_get_short (reader, entry, &value))
+			data->iso_speed_ratings = g_strdup_printf ("%u", value);
+		break;
+	case TAG_RESOLUTION_UNIT:
+		if (!data->resolution_unit && tiff_entry_get_short (reader, entry, &value))
+			data->resolution_unit = value;
+		break;
+	case TAG_X_RESOLUTION:
+		if (!data->x_resolution)
+			data->x_resolution = tiff_entry_get_double_str (reader, entry, NULL);
+		break;
+	case TAG_Y_RESOLUTION:
+		if (!data->y_resolution)
+			data->y_resolution = tiff_entry_get_double_str (reader, entry, NULL);
+		break;
+	case TAG_EXPOSURE_TIME:
+		/* In seconds */
+		if (!data->exposure_time)
+			data->exposure_time = tiff_entry_get_double_str (reader, entry, NULL);
+		break;
+	case TAG_FNUMBER:
+		if (!data->fnumber)
+			data->fnumber = tiff_entry_get_double_str (reader, entry, "%.1f");
+		break;
+	case TAG_FOCAL_LENGTH:
+		/* In millimeters */
+		if (!data->focal_length)
+			data->focal_length = tiff_entry_get_double_str (reader, entry, "%.1f");
+		break;
+	case TAG_EXIF_IFD_POINTER:
+		if (entry->format == TIFF_FORMAT_LONG)
+			walk->exif_ifd = tiff_get_long (reader, entry->value);
+		break;
+	case TAG_GPS_INFO_IFD_POINTER:
+		if (entry->format == TIFF_FORMAT_LONG)
+			walk->gps_ifd = tiff_get_long (reader, entry->value);
+		break;
+	case TAG_SUB_IFDS:
+		if (entry->format == TIFF_FORMAT_LONG ||
+		    entry->format == TIFF_FORMAT_IFD) {
+			guint i;
+
+			for (i = 0; i < entry->count && walk->n_sub_ifds < TIFF_MAX_SUB_IFDS; i++) {
+				walk->sub_ifds[walk->n_sub_ifds++] =
+					tiff_get_long (reader, entry->value + i * 4);
+			}
+		}
+		break;
+	case TAG_NEW_SUBFILE_TYPE:
+		tiff_entry_get_long (reader, entry, &walk->ifd_subfile_type);
+		break;
+	case TAG_IMAGE_WIDTH:
+		tiff_entry_get_long (reader, entry, &walk->ifd_width);
+		break;
+	case TAG_IMAGE_LENGTH:
+		tiff_entry_get_long (reader, entry, &walk->ifd_length);
+		break;
+	case TAG_PIXEL_X_DIMENSION:
+		if (!walk->pixel_x)
+			tiff_entry_get_long (reader, entry, &walk->pixel_x);
+		break;
+	case TAG_PIXEL_Y_DIMENSION:
+		if (!walk->pixel_y)
+			tiff_entry_get_long (reader, entry, &walk->pixel_y);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+tiff_walk_gps_entry (const TiffReader *reader,
+                     TiffWalk         *walk,
+                     const TiffEntry  *entry)
+{
+	switch (entry->tag) {
+	case TAG_GPS_LATITUDE_REF:
+		walk->gps_latitude_ref = *entry;
+		break;
+	case TAG_GPS_LATITUDE:
+		walk->gps_latitude = *entry;
+		break;
+	case TAG_GPS_LONGITUDE_REF:
+		walk->gps_longitude_ref = *entry;
+		break;
+	case TAG_GPS_LONGITUDE:
+		walk->gps_longitude = *entry;
+		break;
+	case TAG_GPS_ALTITUDE_REF:
+		walk->gps_altitude_ref = *entry;
+		break;
+	case TAG_GPS_ALTITUDE:
+		walk->gps_altitude = *entry;
+		break;
+	case TAG_GPS_IMG_DIRECTION:
+		if (!walk->data->gps_direction)
+			walk->data->gps_direction = tiff_entry_get_double_str (reader, entry, NULL);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Returns the offset of the next IFD, or 0 */
+static guint32
+tiff_walk_ifd (const TiffReader *reader,
+               TiffWalk         *walk,
+               guint32           offset,
+               gboolean          is_gps)
+{
+	const guchar *p;
+	guint16 n_entries;
+	guint i;
+
+	if (offset < 8 || offset > reader->len - 2)
+		return 0;
+
+	p = reader->data + offset;
+	n_entries = tiff_get_short (reader, p);
+	p += 2;
+
+	walk->ifd_subfile_type = 0;
+	walk->ifd_width = 0;
+	walk->ifd_length = 0;
+
+	if ((gsize) n_entries * 12 > reader->len - offset - 2)
+		return 0;
+
+	for (i = 0; i < n_entries; i++, p += 12) {
+		TiffEntry entry;
+
+		if (!tiff_read_entry (reader, p, &entry))
+			continue;
+
+		if (is_gps)
+			tiff_walk_gps_entry (reader, walk, &entry);
+		else
+			tiff_walk_entry (reader, walk, &entry);
+	}
+
+	if ((gsize) (p - reader->data) + 4 > reader->len)
+		return 0;
+
+	return tiff_get_long (reader, p);
+}
+
+static gchar *
+tiff_walk_get_gps_coordinate (const TiffReader *reader,
+                              const TiffEntry  *entry,
+                              const TiffEntry  *ref)
+{
+	guint32 numerators[3], denominators[3];
+	guint i;
+
+	if (!entry->value || !ref->value)
+		return NULL;
+
+	for (i = 0; i < 3; i++) {
+		if (!tiff_entry_get_rational (reader, entry, i,
+		                              &numerators[i], &denominators[i]))
+			return NULL;
+	}
+
+	if (ref->format != TIFF_FORMAT_ASCII || ref->size < 2) {
+		g_debug ("Invalid format/size for GPS ref entry");
+		return NULL;
+	}
+
+	return gps_coordinate_to_string (numerators, denominators, ref->value[0]);
+}
+
+static gchar *
+tiff_walk_get_gps_altitude (const TiffReader *reader,
+                            const TiffEntry  *entry,
+                            const TiffEntry  *ref)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	gdouble value;
+	gfloat f;
+
+	if (!entry->value || !tiff_entry_get_double (reader, entry, &value))
+		return NULL;
+
+	f = value;
+
+	/* Below sea level */
+	if (ref->value && ref->format == TIFF_FORMAT_BYTE && ref->value[0] == 1)
+		f = -1 * f;
+
+	return g_strdup (g_ascii_dtostr (buf, sizeof (buf), (gdouble) f));
+}
+
+/* Like Exiv2, the first IFD flagged as the full resolution image
+ * (possibly implicitly) tells the image size.
+ */
+static void
+tiff_walk_pick_image (TiffWalk *walk)
+{
+	if (walk->width != 0 || walk->ifd_subfile_type != 0 ||
+	    walk->ifd_width == 0 || walk->ifd_length == 0)
+		return;
+
+	walk->width = walk->ifd_width;
+	walk->length = walk->ifd_length;
+}
+
+static gboolean
+parse_exif_tiff (const guchar    *buffer,
+                 gsize            len,
+                 gboolean         whole_file,
+                 TrackerExifData *data)
+{
+	TiffReader reader;
+	TiffWalk walk = { 0 };
+	guint32 ifd0, ifd1;
+	guint i;
+
+	if (!tiff_reader_init (&reader, buffer, len))
+		return FALSE;
+
+	ifd0 = tiff_get_long (&reader, reader.data + 4);
+	if (ifd0 < 8 || ifd0 > reader.len - 2)
+		return FALSE;
+
+	walk.data = data;
+
+	/* Same precedence as libexif lookups: the main image IFD,
+	 * then the EXIF and GPS ones, then the thumbnail IFD.
+	 */
+	ifd1 = tiff_walk_ifd (&reader, &walk, ifd0, FALSE);
+
+	if (whole_file) {
+		/* RAW formats keep the sensor data in sub-IFDs, in
+		 * front of a smaller preview in IFD0.
+		 */
+		tiff_walk_pick_image (&walk);
+
+		for (i = 0; i < walk.n_sub_ifds; i++) {
+			tiff_walk_ifd (&reader, &walk, walk.sub_ifds[i], FALSE);
+			tiff_walk_pick_image (&walk);
+		}
+	}
+
+	if (walk.exif_ifd)
+		tiff_walk_ifd (&reader, &walk, walk.exif_ifd, FALSE);
+	if (walk.gps_ifd)
+		tiff_walk_ifd (&reader, &walk, walk.gps_ifd, TRUE);
+	if (ifd1 && ifd1 != ifd0)
+		tiff_walk_ifd (&reader, &walk, ifd1, FALSE);
+
+	data->gps_latitude = tiff_walk_get_gps_coordinate (&reader,
+	                                                   &walk.gps_latitude,
+	                                                   &walk.gps_latitude_ref);
+	data->gps_longitude = tiff_walk_get_gps_coordinate (&reader,
+	                                                    &walk.gps_longitude,
+	                                                    &walk.gps_longitude_ref);
+	data->gps_altitude = tiff_walk_get_gps_altitude (&reader,
+	                                                 &walk.gps_altitude,
+	                                                 &walk.gps_altitude_ref);
+
+	if (whole_file) {
+		if (walk.width == 0 && walk.pixel_x != 0 && walk.pixel_y != 0) {
+			walk.width = walk.pixel_x;
+			walk.length = walk.pixel_y;
+		}
+
+		if (walk.width != 0) {
+			data->x_dimension = g_strdup_printf ("%u", walk.width);
+			data->y_dimension = g_strdup_printf ("%u", walk.length);
+		}
+	}
+
+	return TRUE;
+}
+
 static gboolean
 parse_exif (const unsigned char *buffer,
             size_t               len,
@@ -493,6 +1225,9 @@ parse_exif (const unsigned char *buffer,
 
 	memset (data, 0, sizeof (TrackerExifData));
 
+	if (parse_exif_tiff (buffer, len, FALSE, data))
+		return TRUE;
+
 #ifdef HAVE_LIBEXIF
 
 	exif = exif_data_new ();
@@ -661,6 +1396,44 @@ tracker_exif_new (const guchar *buffer,
 	return data;
 }
 
+/**
+ * tracker_exif_new_from_tiff:
+ * @buffer: the contents of a TIFF structured file.
+ * @len: the size of @buffer.
+ * @uri: the URI this is related to.
+ *
+ * This function reads the EXIF data of a whole TIFF structured file,
+ * such as the TIFF based RAW photo formats (CR2, NEF, ARW, DNG, ORF...).
+ * Unlike tracker_exif_new(), the @x_dimension and @y_dimension fields
+ * are also filled, with the size of the full resolution image.
+ *
+ * Only the IFDs and the values they point to are read, so @buffer may
+ * well be a mapping of the file.
+ *
+ * Returns: a newly allocated #TrackerExifData struct, %NULL if no TIFF
+ * structure was found in @buffer. Free the returned struct with
+ * tracker_exif_free().
+ **/
+TrackerExifData *
+tracker_exif_new_from_tiff (const guchar *buffer,
+                            size_t        len,
+                            const gchar  *uri)
+{
+	TrackerExifData *data;
+
+	g_return_val_if_fail (buffer != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	data = g_new0 (TrackerExifData, 1);
+
+	if (!parse_exif_tiff (buffer, len, TRUE, data)) {
+		tracker_exif_free (data);
+		return NULL;
+	}
+
+	return data;
+}
+
 /**
  * tracker_exif_free:
  * @data: a #TrackerExifData
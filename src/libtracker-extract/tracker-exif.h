@@ -102,6 +102,9 @@ typedef struct {
 TrackerExifData * tracker_exif_new   (const guchar *buffer,
                                       size_t        len,
                                       const gchar  *uri);
+TrackerExifData * tracker_exif_new_from_tiff (const guchar *buffer,
+                                              size_t        len,
+                                              const gchar  *uri);
 void              tracker_exif_free  (TrackerExifData *data);
 
 #ifndef TRACKER_DISABLE_DEPRECATED
@@ -21,6 +21,13 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libtracker-miners-common/tracker-file-utils.h>
+#include <libtracker-miners-common/tracker-memory.h>
+
 #include "tracker-extract-info.h"
 
 /**
@@ -40,6 +47,7 @@
 struct _TrackerExtractInfo
 {
 	TrackerResource *resource;
+	gchar *text;
 
 	GFile *file;
 	gchar *content_id;
@@ -47,6 +55,15 @@ struct _TrackerExtractInfo
 	gchar *graph;
 
 	gint max_text;
+	gint text_tail;
+	guint max_list_entries;
+	guint media_probe_size;
+	guint media_analyze_duration;
+
+	/* Opened on demand, shared by everything reading the file */
+	int fd;
+	GMappedFile *mapped_file;
+	GBytes *contents;
 
 	gint ref_count;
 };
@@ -84,11 +101,15 @@ tracker_extract_info_new (GFile       *file,
 	info->mimetype = g_strdup (mimetype);
 	info->graph = g_strdup (graph);
 	info->max_text = max_text;
+	info->max_list_entries = G_MAXUINT;
+	info->fd = -1;
 
 	info->resource = NULL;
 
 	info->ref_count = 1;
 
+	TRACKER_MEMORY_ALLOC (EXTRACTOR, sizeof (TrackerExtractInfo));
+
 	return info;
 }
 
@@ -135,6 +156,13 @@ tracker_extract_info_unref (TrackerExtractInfo *info)
 		if (info->resource)
 			g_object_unref (info->resource);
 
+		if (info->text)
+			TRACKER_MEMORY_FREE (EXTRACTOR, strlen (info->text) + 1);
+		g_free (info->text);
+
+		tracker_extract_info_release_contents (info);
+
+		TRACKER_MEMORY_FREE (EXTRACTOR, sizeof (TrackerExtractInfo));
 		g_slice_free (TrackerExtractInfo, info);
 	}
 }
@@ -251,6 +279,44 @@ tracker_extract_info_set_resource (TrackerExtractInfo *info,
 {
 	g_object_ref (resource);
 	info->resource = resource;
+	TRACKER_MEMORY_TRACK_OBJECT (EXTRACTOR, resource);
+}
+
+/**
+ * tracker_extract_info_get_text:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns: (nullable): the plain text content given through
+ *   tracker_extract_info_take_text(), or %NULL.
+ **/
+const gchar *
+tracker_extract_info_get_text (TrackerExtractInfo *info)
+{
+	return info->text;
+}
+
+/**
+ * tracker_extract_info_take_text:
+ * @info: a #TrackerExtractInfo
+ * @text: (transfer full) (nullable): the plain text content of the file
+ *
+ * Sets the nie:plainTextContent of the resource given through
+ * tracker_extract_info_set_resource(). Unlike setting the property in
+ * the resource, @text is not copied, it is kept as is until committed.
+ * This is preferred for text that may be of up to
+ * tracker_extract_info_get_max_text() bytes.
+ **/
+void
+tracker_extract_info_take_text (TrackerExtractInfo *info,
+                                gchar              *text)
+{
+	if (info->text)
+		TRACKER_MEMORY_FREE (EXTRACTOR, strlen (info->text) + 1);
+	if (text)
+		TRACKER_MEMORY_ALLOC (EXTRACTOR, strlen (text) + 1);
+
+	g_free (info->text);
+	info->text = text;
 }
 
 gint
@@ -258,3 +324,176 @@ tracker_extract_info_get_max_text (TrackerExtractInfo *info)
 {
 	return info->max_text;
 }
+
+/**
+ * tracker_extract_info_get_text_tail:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns: how many of the tracker_extract_info_get_max_text() bytes
+ *   should be taken from the end of the file, for plain text files
+ *   bigger than that.
+ **/
+gint
+tracker_extract_info_get_text_tail (TrackerExtractInfo *info)
+{
+	return info->text_tail;
+}
+
+void
+tracker_extract_info_set_text_tail (TrackerExtractInfo *info,
+                                    gint                text_tail)
+{
+	info->text_tail = text_tail;
+}
+
+/**
+ * tracker_extract_info_get_max_list_entries:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns: how many entries of lists such as playlists should be
+ *   extracted, further entries are only counted.
+ **/
+guint
+tracker_extract_info_get_max_list_entries (TrackerExtractInfo *info)
+{
+	return info->max_list_entries;
+}
+
+void
+tracker_extract_info_set_max_list_entries (TrackerExtractInfo *info,
+                                           guint               max_list_entries)
+{
+	info->max_list_entries = max_list_entries;
+}
+
+/**
+ * tracker_extract_info_get_media_probe_limits:
+ * @info: a #TrackerExtractInfo
+ * @probe_size: (out) (optional): return location for the bytes to probe
+ * @analyze_duration: (out) (optional): return location for the
+ *   milliseconds of streams to analyze
+ *
+ * Gets how much of audio and video files should be read to find their
+ * streams and properties. 0 stands for the decoder default.
+ **/
+void
+tracker_extract_info_get_media_probe_limits (TrackerExtractInfo *info,
+                                             guint              *probe_size,
+                                             guint              *analyze_duration)
+{
+	if (probe_size)
+		*probe_size = info->media_probe_size;
+	if (analyze_duration)
+		*analyze_duration = info->media_analyze_duration;
+}
+
+void
+tracker_extract_info_set_media_probe_limits (TrackerExtractInfo *info,
+                                             guint               probe_size,
+                                             guint               analyze_duration)
+{
+	info->media_probe_size = probe_size;
+	info->media_analyze_duration = analyze_duration;
+}
+
+/**
+ * tracker_extract_info_get_fd:
+ * @info: a #TrackerExtractInfo
+ * @error: return location for a #GError
+ *
+ * Returns a read-only file descriptor for the file being extracted,
+ * it is opened on the first call and shared by everything reading the
+ * file during the extraction. The descriptor belongs to @info, it must
+ * not be closed, and its offset should not be relied upon, use pread()
+ * or the mapping from tracker_extract_info_get_contents() instead.
+ *
+ * Returns: the file descriptor, or -1 if the file could not be opened
+ **/
+int
+tracker_extract_info_get_fd (TrackerExtractInfo  *info,
+                             GError             **error)
+{
+	g_autofree gchar *path = NULL;
+
+	g_return_val_if_fail (info != NULL, -1);
+
+	if (info->fd >= 0)
+		return info->fd;
+
+	path = g_file_get_path (info->file);
+	if (!path) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		             "File has no local path");
+		return -1;
+	}
+
+	info->fd = tracker_file_open_fd (path);
+	if (info->fd < 0) {
+		int saved_errno = errno;
+
+		g_set_error (error, G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Could not open '%s': %s",
+		             path, g_strerror (saved_errno));
+	}
+
+	return info->fd;
+}
+
+/**
+ * tracker_extract_info_get_contents:
+ * @info: a #TrackerExtractInfo
+ * @error: return location for a #GError
+ *
+ * Returns a read-only mapping of the whole file being extracted, it
+ * is created on the first call and shared by the extractor module and
+ * the metadata parsers it hands data to, so the file is only opened
+ * and read once. Only the pages actually accessed are read from disk.
+ *
+ * Returns: (transfer none): the file contents, or %NULL on error
+ **/
+GBytes *
+tracker_extract_info_get_contents (TrackerExtractInfo  *info,
+                                   GError             **error)
+{
+	int fd;
+
+	g_return_val_if_fail (info != NULL, NULL);
+
+	if (info->contents)
+		return info->contents;
+
+	fd = tracker_extract_info_get_fd (info, error);
+	if (fd < 0)
+		return NULL;
+
+	info->mapped_file = g_mapped_file_new_from_fd (fd, FALSE, error);
+	if (!info->mapped_file)
+		return NULL;
+
+	info->contents = g_mapped_file_get_bytes (info->mapped_file);
+
+	return info->contents;
+}
+
+/**
+ * tracker_extract_info_release_contents:
+ * @info: a #TrackerExtractInfo
+ *
+ * Closes the file descriptor and drops the mapping created by
+ * tracker_extract_info_get_fd() and tracker_extract_info_get_contents(),
+ * this is done once the extractor module is done with the file.
+ **/
+void
+tracker_extract_info_release_contents (TrackerExtractInfo *info)
+{
+	g_return_if_fail (info != NULL);
+
+	g_clear_pointer (&info->contents, g_bytes_unref);
+	g_clear_pointer (&info->mapped_file, g_mapped_file_unref);
+
+	if (info->fd >= 0) {
+		close (info->fd);
+		info->fd = -1;
+	}
+}
@@ -49,11 +49,33 @@ const gchar *         tracker_extract_info_get_mimetype           (TrackerExtrac
 const gchar *         tracker_extract_info_get_graph              (TrackerExtractInfo *info);
 
 gint                  tracker_extract_info_get_max_text           (TrackerExtractInfo *info);
+gint                  tracker_extract_info_get_text_tail          (TrackerExtractInfo *info);
+void                  tracker_extract_info_set_text_tail          (TrackerExtractInfo *info,
+                                                                   gint                text_tail);
+guint                 tracker_extract_info_get_max_list_entries   (TrackerExtractInfo *info);
+void                  tracker_extract_info_set_max_list_entries   (TrackerExtractInfo *info,
+                                                                   guint               max_list_entries);
+void                  tracker_extract_info_get_media_probe_limits (TrackerExtractInfo *info,
+                                                                   guint              *probe_size,
+                                                                   guint              *analyze_duration);
+void                  tracker_extract_info_set_media_probe_limits (TrackerExtractInfo *info,
+                                                                   guint               probe_size,
+                                                                   guint               analyze_duration);
+
+int                   tracker_extract_info_get_fd                 (TrackerExtractInfo  *info,
+                                                                   GError             **error);
+GBytes *              tracker_extract_info_get_contents           (TrackerExtractInfo  *info,
+                                                                   GError             **error);
+void                  tracker_extract_info_release_contents       (TrackerExtractInfo  *info);
 
 TrackerResource *     tracker_extract_info_get_resource           (TrackerExtractInfo *info);
 void                  tracker_extract_info_set_resource           (TrackerExtractInfo *info,
                                                                    TrackerResource    *resource);
 
+const gchar *         tracker_extract_info_get_text               (TrackerExtractInfo *info);
+void                  tracker_extract_info_take_text              (TrackerExtractInfo *info,
+                                                                   gchar              *text);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_EXTRACT_INFO_H__ */
@@ -30,8 +30,11 @@
 #include "tracker-extract-info.h"
 #include "tracker-module-manager.h"
 #include "tracker-guarantee.h"
+#include "tracker-html.h"
 #include "tracker-iptc.h"
 #include "tracker-resource-helpers.h"
+#include "tracker-text-limits.h"
+#include "tracker-text-sink.h"
 #include "tracker-utils.h"
 #include "tracker-xmp.h"
 
@@ -0,0 +1,761 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-html.h"
+#include "tracker-text-sink.h"
+
+/**
+ * SECTION:tracker-html
+ * @title: HTML tokenizing
+ * @short_description: Streaming HTML to text conversion
+ * @stability: Stable
+ * @include: libtracker-extract/tracker-extract.h
+ *
+ * A #TrackerHtmlTokenizer splits HTML into tags and text as it is fed,
+ * without building a document tree. It is lenient with broken markup,
+ * skips comments, scripts and styles, and decodes character references
+ * in text and attribute values. Any callback can stop it, e.g. once a
+ * #TrackerTextSink is full, so the rest of the document is not parsed.
+ **/
+
+/* Longest markup waited for across chunks, longer tags are taken as text */
+#define MAX_MARKUP_LEN 16384
+/* Longest word held back across chunks, so it is not split in two */
+#define MAX_PENDING_WORD 1024
+/* Longest character reference, e.g. "&#x10FFFF;" */
+#define MAX_ENTITY_LEN 32
+
+typedef enum {
+	STATE_TEXT,
+	STATE_COMMENT,
+	STATE_RAW,
+} TokenizerState;
+
+typedef enum {
+	MARKUP_TEXT,
+	MARKUP_INCOMPLETE,
+	MARKUP_TAG,
+	MARKUP_COMMENT,
+	MARKUP_DECLARATION,
+} MarkupType;
+
+struct _TrackerHtmlTokenizer {
+	TrackerHtmlCallbacks callbacks;
+	gpointer user_data;
+	TokenizerState state;
+	/* End tag of the script or style element being skipped */
+	gchar raw_tag[8];
+	gboolean stopped;
+
+	/* Input left unprocessed from the last chunk */
+	GString *pending;
+	/* Decoded text, and tag name plus attributes, created on demand */
+	GString *text;
+	GString *tag;
+	GArray *attr_offsets;
+	GPtrArray *attrs;
+};
+
+typedef struct {
+	const gchar *name;
+	gunichar value;
+} HtmlEntity;
+
+static const HtmlEntity entities[] = {
+	{ "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' },
+	{ "apos", '\'' }, { "nbsp", 0xA0 }, { "iexcl", 0xA1 },
+	{ "cent", 0xA2 }, { "pound", 0xA3 }, { "yen", 0xA5 },
+	{ "sect", 0xA7 }, { "copy", 0xA9 }, { "laquo", 0xAB },
+	{ "reg", 0xAE }, { "deg", 0xB0 }, { "plusmn", 0xB1 },
+	{ "para", 0xB6 }, { "middot", 0xB7 }, { "raquo", 0xBB },
+	{ "iquest", 0xBF }, { "Agrave", 0xC0 }, { "Aacute", 0xC1 },
+	{ "Acirc", 0xC2 }, { "Atilde", 0xC3 }, { "Auml", 0xC4 },
+	{ "Aring", 0xC5 }, { "AElig", 0xC6 }, { "Ccedil", 0xC7 },
+	{ "Egrave", 0xC8 }, { "Eacute", 0xC9 }, { "Ecirc", 0xCA },
+	{ "Euml", 0xCB }, { "Igrave", 0xCC }, { "Iacute", 0xCD },
+	{ "Icirc", 0xCE }, { "Iuml", 0xCF }, { "Ntilde", 0xD1 },
+	{ "Ograve", 0xD2 }, { "Oacute", 0xD3 }, { "Ocirc", 0xD4 },
+	{ "Otilde", 0xD5 }, { "Ouml", 0xD6 }, { "times", 0xD7 },
+	{ "Oslash", 0xD8 }, { "Ugrave", 0xD9 }, { "Uacute", 0xDA },
+	{ "Ucirc", 0xDB }, { "Uuml", 0xDC }, { "szlig", 0xDF },
+	{ "agrave", 0xE0 }, { "aacute", 0xE1 }, { "acirc", 0xE2 },
+	{ "atilde", 0xE3 }, { "auml", 0xE4 }, { "aring", 0xE5 },
+	{ "aelig", 0xE6 }, { "ccedil", 0xE7 }, { "egrave", 0xE8 },
+	{ "eacute", 0xE9 }, { "ecirc", 0xEA }, { "euml", 0xEB },
+	{ "igrave", 0xEC }, { "iacute", 0xED }, { "icirc", 0xEE },
+	{ "iuml", 0xEF }, { "ntilde", 0xF1 }, { "ograve", 0xF2 },
+	{ "oacute", 0xF3 }, { "ocirc", 0xF4 }, { "otilde", 0xF5 },
+	{ "ouml", 0xF6 }, { "divide", 0xF7 }, { "oslash", 0xF8 },
+	{ "ugrave", 0xF9 }, { "uacute", 0xFA }, { "ucirc", 0xFB },
+	{ "uuml", 0xFC }, { "yuml", 0xFF }, { "ndash", 0x2013 },
+	{ "mdash", 0x2014 }, { "lsquo", 0x2018 }, { "rsquo", 0x2019 },
+	{ "sbquo", 0x201A }, { "ldquo", 0x201C }, { "rdquo", 0x201D },
+	{ "bdquo", 0x201E }, { "dagger", 0x2020 }, { "bull", 0x2022 },
+	{ "hellip", 0x2026 }, { "euro", 0x20AC }, { "trade", 0x2122 },
+};
+
+static void
+tokenizer_init (TrackerHtmlTokenizer       *tokenizer,
+                const TrackerHtmlCallbacks *callbacks,
+                gpointer                    user_data)
+{
+	memset (tokenizer, 0, sizeof (TrackerHtmlTokenizer));
+	tokenizer->callbacks = *callbacks;
+	tokenizer->user_data = user_data;
+	tokenizer->state = STATE_TEXT;
+}
+
+static void
+tokenizer_clear (TrackerHtmlTokenizer *tokenizer)
+{
+	if (tokenizer->pending)
+		g_string_free (tokenizer->pending, TRUE);
+	if (tokenizer->text)
+		g_string_free (tokenizer->text, TRUE);
+	if (tokenizer->tag)
+		g_string_free (tokenizer->tag, TRUE);
+	g_clear_pointer (&tokenizer->attr_offsets, g_array_unref);
+	g_clear_pointer (&tokenizer->attrs, g_ptr_array_unref);
+}
+
+static const gchar *
+find_string (const gchar *p,
+             const gchar *end,
+             const gchar *str)
+{
+	gsize len = strlen (str);
+
+	while (p + len <= end) {
+		p = memchr (p, str[0], end - p - len + 1);
+		if (!p)
+			return NULL;
+		if (memcmp (p, str, len) == 0)
+			return p;
+		p++;
+	}
+
+	return NULL;
+}
+
+static gunichar
+parse_character_reference (const gchar *name,
+                           gsize        len)
+{
+	guint64 value = 0;
+	gboolean hex;
+	gsize i;
+
+	if (len == 0)
+		return 0;
+
+	if (name[0] != '#') {
+		for (i = 0; i < G_N_ELEMENTS (entities); i++) {
+			if (strncmp (entities[i].name, name, len) == 0 &&
+			    entities[i].name[len] == '\0')
+				return entities[i].value;
+		}
+
+		return 0;
+	}
+
+	hex = len > 1 && (name[1] == 'x' || name[1] == 'X');
+	i = hex ? 2 : 1;
+
+	if (i == len)
+		return 0;
+
+	for (; i < len; i++) {
+		if (hex && g_ascii_isxdigit (name[i]))
+			value = value * 16 + g_ascii_xdigit_value (name[i]);
+		else if (!hex && g_ascii_isdigit (name[i]))
+			value = value * 10 + g_ascii_digit_value (name[i]);
+		else
+			return 0;
+
+		if (value > 0x10FFFF)
+			break;
+	}
+
+	/* Out of range references stand for the replacement character */
+	if (value == 0 || value > 0x10FFFF ||
+	    (value >= 0xD800 && value <= 0xDFFF))
+		return 0xFFFD;
+
+	return (gunichar) value;
+}
+
+static void
+append_decoded (GString     *str,
+                const gchar *p,
+                const gchar *end)
+{
+	const gchar *amp, *semicolon;
+	gunichar ch;
+
+	while ((amp = memchr (p, '&', end - p)) != NULL) {
+		g_string_append_len (str, p, amp - p);
+		p = amp + 1;
+
+		semicolon = memchr (p, ';', MIN (end - p, MAX_ENTITY_LEN));
+		if (!semicolon) {
+			g_string_append_c (str, '&');
+			continue;
+		}
+
+		ch = parse_character_reference (p, semicolon - p);
+		if (ch == 0) {
+			/* Not a reference, keep it as is */
+			g_string_append_c (str, '&');
+			continue;
+		}
+
+		g_string_append_unichar (str, ch);
+		p = semicolon + 1;
+	}
+
+	g_string_append_len (str, p, end - p);
+}
+
+static void
+emit_text (TrackerHtmlTokenizer *tokenizer,
+           const gchar          *p,
+           const gchar          *end)
+{
+	const gchar *c;
+	gboolean keep_going;
+
+	if (!tokenizer->callbacks.text || tokenizer->stopped)
+		return;
+
+	for (c = p; c < end && g_ascii_isspace (*c); c++);
+	if (c == end)
+		return;
+
+	if (!memchr (p, '&', end - p)) {
+		keep_going = tokenizer->callbacks.text (p, end - p,
+		                                        tokenizer->user_data);
+	} else {
+		if (!tokenizer->text)
+			tokenizer->text = g_string_new (NULL);
+
+		g_string_truncate (tokenizer->text, 0);
+		append_decoded (tokenizer->text, p, end);
+		keep_going = tokenizer->callbacks.text (tokenizer->text->str,
+		                                        tokenizer->text->len,
+		                                        tokenizer->user_data);
+	}
+
+	if (!keep_going)
+		tokenizer->stopped = TRUE;
+}
+
+static const gchar *
+find_tag_end (const gchar *p,
+              const gchar *end)
+{
+	gchar quote = 0, prev = 0;
+
+	for (; p < end; p++) {
+		if (quote) {
+			if (*p == quote) {
+				quote = 0;
+				prev = *p;
+			}
+		} else if ((*p == '"' || *p == '\'') && prev == '=') {
+			/* Quotes only delimit attribute values */
+			quote = *p;
+		} else if (*p == '>') {
+			return p;
+		} else if (!g_ascii_isspace (*p)) {
+			prev = *p;
+		}
+	}
+
+	return NULL;
+}
+
+static MarkupType
+classify_markup (const gchar  *lt,
+                 const gchar  *end,
+                 gboolean      final,
+                 const gchar **markup_end)
+{
+	const gchar *gt;
+	MarkupType type;
+	gsize avail = end - lt;
+
+	if (avail < 2)
+		return final ? MARKUP_TEXT : MARKUP_INCOMPLETE;
+
+	if (lt[1] == '!') {
+		if (avail < 4 && !final)
+			return MARKUP_INCOMPLETE;
+
+		if (avail >= 4 && lt[2] == '-' && lt[3] == '-') {
+			*markup_end = lt + 4;
+			return MARKUP_COMMENT;
+		}
+
+		gt = memchr (lt, '>', avail);
+		type = MARKUP_DECLARATION;
+	} else if (lt[1] == '?') {
+		gt = memchr (lt, '>', avail);
+		type = MARKUP_DECLARATION;
+	} else if (lt[1] == '/' || g_ascii_isalpha (lt[1])) {
+		gt = find_tag_end (lt + 1, end);
+		type = MARKUP_TAG;
+	} else {
+		/* A lone '<' */
+		return MARKUP_TEXT;
+	}
+
+	if (!gt) {
+		if (final || avail >= MAX_MARKUP_LEN)
+			return MARKUP_TEXT;
+
+		return MARKUP_INCOMPLETE;
+	}
+
+	*markup_end = gt + 1;
+
+	return type;
+}
+
+static void
+add_attr_string (TrackerHtmlTokenizer *tokenizer,
+                 const gchar          *p,
+                 const gchar          *end,
+                 gboolean              lowercase,
+                 gboolean              decode)
+{
+	guint offset = tokenizer->tag->len;
+
+	g_array_append_val (tokenizer->attr_offsets, offset);
+
+	if (lowercase) {
+		for (; p < end; p++)
+			g_string_append_c (tokenizer->tag, g_ascii_tolower (*p));
+	} else if (decode) {
+		append_decoded (tokenizer->tag, p, end);
+	} else {
+		g_string_append_len (tokenizer->tag, p, end - p);
+	}
+
+	/* Each string is kept NUL-terminated in the buffer */
+	g_string_append_c (tokenizer->tag, '\0');
+}
+
+static void
+handle_tag (TrackerHtmlTokenizer *tokenizer,
+            const gchar          *lt,
+            const gchar          *gt)
+{
+	const gchar *p = lt + 1, *start, *value_end;
+	const gchar *name;
+	gboolean is_end_tag, self_closing;
+	guint i;
+
+	is_end_tag = *p == '/';
+	if (is_end_tag)
+		p++;
+
+	start = p;
+	while (p < gt && !g_ascii_isspace (*p) && *p != '/')
+		p++;
+
+	if (p == start)
+		return;
+
+	if (!tokenizer->tag) {
+		tokenizer->tag = g_string_new (NULL);
+		tokenizer->attr_offsets = g_array_new (FALSE, FALSE, sizeof (guint));
+		tokenizer->attrs = g_ptr_array_new ();
+	}
+
+	g_string_truncate (tokenizer->tag, 0);
+	g_array_set_size (tokenizer->attr_offsets, 0);
+	add_attr_string (tokenizer, start, p, TRUE, FALSE);
+
+	if (is_end_tag) {
+		name = tokenizer->tag->str;
+
+		if (tokenizer->callbacks.end_tag &&
+		    !tokenizer->callbacks.end_tag (name, tokenizer->user_data))
+			tokenizer->stopped = TRUE;
+		return;
+	}
+
+	self_closing = gt[-1] == '/';
+
+	while (p < gt) {
+		while (p < gt && (g_ascii_isspace (*p) || *p == '/'))
+			p++;
+		if (p == gt)
+			break;
+
+		start = p;
+		while (p < gt && !g_ascii_isspace (*p) && *p != '=' && *p != '/')
+			p++;
+
+		if (p == start) {
+			/* Stray '=' */
+			p++;
+			continue;
+		}
+
+		add_attr_string (tokenizer, start, p, TRUE, FALSE);
+
+		while (p < gt && g_ascii_isspace (*p))
+			p++;
+
+		if (p == gt || *p != '=') {
+			add_attr_string (tokenizer, p, p, FALSE, FALSE);
+			continue;
+		}
+
+		p++;
+		while (p < gt && g_ascii_isspace (*p))
+			p++;
+
+		if (p < gt && (*p == '"' || *p == '\'')) {
+			start = p + 1;
+			value_end = memchr (start, *p, gt - start);
+			if (!value_end)
+				value_end = gt;
+			p = MIN (value_end + 1, gt);
+		} else {
+			start = p;
+			while (p < gt && !g_ascii_isspace (*p))
+				p++;
+			value_end = p;
+		}
+
+		add_attr_string (tokenizer, start, value_end, FALSE, TRUE);
+	}
+
+	/* Offsets turn into pointers once the buffer is complete */
+	g_ptr_array_set_size (tokenizer->attrs, 0);
+	for (i = 1; i < tokenizer->attr_offsets->len; i++) {
+		g_ptr_array_add (tokenizer->attrs,
+		                 tokenizer->tag->str +
+		                 g_array_index (tokenizer->attr_offsets, guint, i));
+	}
+	g_ptr_array_add (tokenizer->attrs, NULL);
+
+	name = tokenizer->tag->str;
+
+	if (tokenizer->callbacks.start_tag &&
+	    !tokenizer->callbacks.start_tag (name,
+	                                     (const gchar **) tokenizer->attrs->pdata,
+	                                     tokenizer->user_data)) {
+		tokenizer->stopped = TRUE;
+		return;
+	}
+
+	if (self_closing) {
+		if (tokenizer->callbacks.end_tag &&
+		    !tokenizer->callbacks.end_tag (name, tokenizer->user_data))
+			tokenizer->stopped = TRUE;
+	} else if (strcmp (name, "script") == 0 || strcmp (name, "style") == 0) {
+		/* Their content is not text, skip it until the end tag */
+		g_strlcpy (tokenizer->raw_tag, name, sizeof (tokenizer->raw_tag));
+		tokenizer->state = STATE_RAW;
+	}
+}
+
+static const gchar *
+process_text (TrackerHtmlTokenizer *tokenizer,
+              const gchar          *p,
+              const gchar          *end,
+              gboolean              final,
+              gboolean             *need_more)
+{
+	const gchar *search = p, *lt, *markup_end = NULL, *hold;
+
+	while ((lt = memchr (search, '<', end - search)) != NULL) {
+		switch (classify_markup (lt, end, final, &markup_end)) {
+		case MARKUP_TEXT:
+			search = lt + 1;
+			continue;
+		case MARKUP_INCOMPLETE:
+			emit_text (tokenizer, p, lt);
+			*need_more = TRUE;
+			return lt;
+		case MARKUP_COMMENT:
+			emit_text (tokenizer, p, lt);
+			tokenizer->state = STATE_COMMENT;
+			return markup_end;
+		case MARKUP_DECLARATION:
+			emit_text (tokenizer, p, lt);
+			return markup_end;
+		case MARKUP_TAG:
+			emit_text (tokenizer, p, lt);
+			if (!tokenizer->stopped)
+				handle_tag (tokenizer, lt, markup_end - 1);
+			return markup_end;
+		}
+	}
+
+	hold = end;
+
+	if (!final) {
+		/* Keep the last word for the next chunk, it might go on there */
+		while (hold > p && !g_ascii_isspace (hold[-1]))
+			hold--;
+
+		if (end - hold > MAX_PENDING_WORD) {
+			/* Too long for a word, only keep its last character */
+			hold = end;
+			while (hold > p && (hold[-1] & 0xC0) == 0x80)
+				hold--;
+			if (hold > p && (guchar) hold[-1] >= 0xC0)
+				hold--;
+		}
+
+		*need_more = hold < end;
+	}
+
+	emit_text (tokenizer, p, hold);
+
+	return hold;
+}
+
+static const gchar *
+process_comment (TrackerHtmlTokenizer *tokenizer,
+                 const gchar          *p,
+                 const gchar          *end,
+                 gboolean              final,
+                 gboolean             *need_more)
+{
+	const gchar *comment_end;
+
+	comment_end = find_string (p, end, "-->");
+	if (comment_end) {
+		tokenizer->state = STATE_TEXT;
+		return comment_end + 3;
+	}
+
+	if (final || end - p <= 2) {
+		*need_more = !final;
+		return final ? end : p;
+	}
+
+	/* The end of the comment might be split across chunks */
+	*need_more = TRUE;
+	return end - 2;
+}
+
+static const gchar *
+process_raw (TrackerHtmlTokenizer *tokenizer,
+             const gchar          *p,
+             const gchar          *end,
+             gboolean              final,
+             gboolean             *need_more)
+{
+	const gchar *lt;
+	gsize tag_len = strlen (tokenizer->raw_tag);
+
+	while ((lt = memchr (p, '<', end - p)) != NULL) {
+		if ((gsize) (end - lt) < tag_len + 3) {
+			if (final)
+				break;
+
+			*need_more = TRUE;
+			return lt;
+		}
+
+		if (lt[1] == '/' &&
+		    g_ascii_strncasecmp (lt + 2, tokenizer->raw_tag, tag_len) == 0 &&
+		    (lt[tag_len + 2] == '>' || lt[tag_len + 2] == '/' ||
+		     g_ascii_isspace (lt[tag_len + 2]))) {
+			/* The end tag itself is handled as usual */
+			tokenizer->state = STATE_TEXT;
+			return lt;
+		}
+
+		p = lt + 1;
+	}
+
+	return end;
+}
+
+static gsize
+tokenizer_process (TrackerHtmlTokenizer *tokenizer,
+                   const gchar          *data,
+                   gsize                 len,
+                   gboolean              final)
+{
+	const gchar *p = data, *end = data + len;
+	gboolean need_more = FALSE;
+
+	while (p < end && !need_more && !tokenizer->stopped) {
+		switch (tokenizer->state) {
+		case STATE_TEXT:
+			p = process_text (tokenizer, p, end, final, &need_more);
+			break;
+		case STATE_COMMENT:
+			p = process_comment (tokenizer, p, end, final, &need_more);
+			break;
+		case STATE_RAW:
+			p = process_raw (tokenizer, p, end, final, &need_more);
+			break;
+		}
+	}
+
+	return p - data;
+}
+
+/**
+ * tracker_html_tokenizer_new:
+ * @callbacks: callbacks for the tags and text found
+ * @user_data: data passed to @callbacks
+ *
+ * Returns: (transfer full): a new #TrackerHtmlTokenizer.
+ **/
+TrackerHtmlTokenizer *
+tracker_html_tokenizer_new (const TrackerHtmlCallbacks *callbacks,
+                            gpointer                    user_data)
+{
+	TrackerHtmlTokenizer *tokenizer;
+
+	tokenizer = g_slice_new (TrackerHtmlTokenizer);
+	tokenizer_init (tokenizer, callbacks, user_data);
+
+	return tokenizer;
+}
+
+void
+tracker_html_tokenizer_free (TrackerHtmlTokenizer *tokenizer)
+{
+	tokenizer_clear (tokenizer);
+	g_slice_free (TrackerHtmlTokenizer, tokenizer);
+}
+
+/**
+ * tracker_html_tokenizer_feed:
+ * @tokenizer: a #TrackerHtmlTokenizer
+ * @data: the next chunk of the document
+ * @len: length of @data in bytes
+ *
+ * Tokenizes @data, except for any tag or word that might continue in
+ * the next chunk.
+ *
+ * Returns: %FALSE if a callback stopped @tokenizer, and there is no
+ *   need to read further.
+ **/
+gboolean
+tracker_html_tokenizer_feed (TrackerHtmlTokenizer *tokenizer,
+                             const gchar          *data,
+                             gsize                 len)
+{
+	gsize processed;
+
+	if (tokenizer->stopped)
+		return FALSE;
+
+	if (tokenizer->pending && tokenizer->pending->len > 0) {
+		g_string_append_len (tokenizer->pending, data, len);
+		processed = tokenizer_process (tokenizer,
+		                               tokenizer->pending->str,
+		                               tokenizer->pending->len,
+		                               FALSE);
+		g_string_erase (tokenizer->pending, 0, processed);
+	} else {
+		processed = tokenizer_process (tokenizer, data, len, FALSE);
+
+		if (processed < len) {
+			if (!tokenizer->pending)
+				tokenizer->pending = g_string_new (NULL);
+
+			g_string_append_len (tokenizer->pending,
+			                     data + processed, len - processed);
+		}
+	}
+
+	if (tokenizer->stopped && tokenizer->pending)
+		g_string_truncate (tokenizer->pending, 0);
+
+	return !tokenizer->stopped;
+}
+
+/**
+ * tracker_html_tokenizer_finish:
+ * @tokenizer: a #TrackerHtmlTokenizer
+ *
+ * Tokenizes what is left of the document after the last chunk.
+ **/
+void
+tracker_html_tokenizer_finish (TrackerHtmlTokenizer *tokenizer)
+{
+	if (tokenizer->stopped || !tokenizer->pending)
+		return;
+
+	tokenizer_process (tokenizer,
+	                   tokenizer->pending->str,
+	                   tokenizer->pending->len,
+	                   TRUE);
+	g_string_truncate (tokenizer->pending, 0);
+}
+
+static gboolean
+get_text_cb (const gchar *text,
+             gsize        len,
+             gpointer     user_data)
+{
+	return tracker_text_sink_append_word (user_data, text, len, NULL);
+}
+
+/**
+ * tracker_html_get_text:
+ * @html: an HTML document or fragment
+ * @len: length of @html in bytes, or -1 if NUL-terminated
+ * @max_bytes: maximum number of UTF-8 bytes to return
+ *
+ * Returns: (transfer full) (nullable): the plain text of @html, or
+ *   %NULL if there is none.
+ **/
+gchar *
+tracker_html_get_text (const gchar *html,
+                       gssize       len,
+                       gsize        max_bytes)
+{
+	const TrackerHtmlCallbacks callbacks = { NULL, NULL, get_text_cb };
+	TrackerHtmlTokenizer tokenizer;
+	TrackerTextSink *sink;
+	gchar *text;
+
+	if (len < 0)
+		len = strlen (html);
+
+	sink = tracker_text_sink_new (max_bytes);
+
+	/* All input is there, so nothing needs to be kept around */
+	tokenizer_init (&tokenizer, &callbacks, sink);
+	tokenizer_process (&tokenizer, html, len, TRUE);
+	tokenizer_clear (&tokenizer);
+
+	text = g_strdup (tracker_text_sink_get_text (sink));
+	tracker_text_sink_free (sink);
+
+	return text;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_EXTRACT_HTML_H__
+#define __LIBTRACKER_EXTRACT_HTML_H__
+
+#if !defined (__LIBTRACKER_EXTRACT_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-extract/tracker-extract.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerHtmlTokenizer TrackerHtmlTokenizer;
+
+/**
+ * TrackerHtmlCallbacks:
+ * @start_tag: called for each start tag, with its lowercase name and a
+ *   %NULL-terminated array of attribute name and value pairs
+ * @end_tag: called for each end tag, and after self-closing start tags
+ * @text: called with the entity-decoded text between tags, not
+ *   NUL-terminated
+ *
+ * Callbacks for a #TrackerHtmlTokenizer, any of them may be %NULL.
+ * Returning %FALSE from one stops the tokenizer.
+ **/
+typedef struct {
+	gboolean (* start_tag) (const gchar  *name,
+	                        const gchar **attrs,
+	                        gpointer      user_data);
+	gboolean (* end_tag)   (const gchar  *name,
+	                        gpointer      user_data);
+	gboolean (* text)      (const gchar  *text,
+	                        gsize         len,
+	                        gpointer      user_data);
+} TrackerHtmlCallbacks;
+
+TrackerHtmlTokenizer * tracker_html_tokenizer_new    (const TrackerHtmlCallbacks *callbacks,
+                                                      gpointer                    user_data);
+void                   tracker_html_tokenizer_free   (TrackerHtmlTokenizer       *tokenizer);
+
+gboolean               tracker_html_tokenizer_feed   (TrackerHtmlTokenizer       *tokenizer,
+                                                      const gchar                *data,
+                                                      gsize                       len);
+void                   tracker_html_tokenizer_finish (TrackerHtmlTokenizer       *tokenizer);
+
+gchar *                tracker_html_get_text         (const gchar                *html,
+                                                      gssize                      len,
+                                                      gsize                       max_bytes);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_EXTRACT_HTML_H__ */
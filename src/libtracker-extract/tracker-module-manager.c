@@ -19,8 +19,11 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
 #include <string.h>
 
+#include <gio/gio.h>
+
 #include "tracker-module-manager.h"
 
 #include "libtracker-miners-common/tracker-debug.h"
@@ -29,14 +32,25 @@
 #define INIT_FUNCTION      "tracker_extract_module_init"
 #define SHUTDOWN_FUNCTION  "tracker_extract_module_shutdown"
 
+#define N_CACHE_BUCKETS 256
+
+/* Rule files as parsed: version, rules directory and its mtime, then
+ * for each rule its path, ModulePath, MimeTypes, BlockMimeTypes,
+ * FallbackRdfTypes, Graph, Hash, ThreadSafe and Expensive keys.
+ */
+#define RULE_CACHE_VERSION 1
+#define RULE_CACHE_ENTRY_TYPE "(smsasasasmsmsbb)"
+#define RULE_CACHE_TYPE "(usxa" RULE_CACHE_ENTRY_TYPE ")"
+
 typedef struct {
 	const gchar *rule_path;
 	const gchar *module_path; /* intern string */
-	GList *allow_patterns;
 	GList *block_patterns;
 	GStrv fallback_rdf_types;
 	gchar *graph;
 	gchar *hash;
+	gboolean thread_safe;
+	gboolean expensive;
 } RuleInfo;
 
 typedef struct {
@@ -44,20 +58,54 @@ typedef struct {
 	TrackerExtractMetadataFunc extract_func;
 	TrackerExtractInitFunc init_func;
 	TrackerExtractShutdownFunc shutdown_func;
+	gboolean thread_safe;
+	/* Shut down while idle, initialized again on next use */
+	gboolean shut_down;
 } ModuleInfo;
 
 static gboolean dummy_extract_func (TrackerExtractInfo  *info,
                                     GError             **error);
 
 static ModuleInfo dummy_module = {
-	NULL, dummy_extract_func, NULL, NULL
+	NULL, dummy_extract_func, NULL, NULL, TRUE, FALSE
+};
+
+/* Allow patterns of all rules, by shape. Built once at initialization
+ * and only read afterwards.
+ */
+typedef struct {
+	gchar *prefix;
+	guint rule;
+} PrefixMatch;
+
+typedef struct {
+	GPatternSpec *pattern;
+	guint rule;
+} PatternMatch;
+
+typedef struct _CachedRules CachedRules;
+
+/* Entries are never modified nor freed once visible in the cache */
+struct _CachedRules {
+	CachedRules *next;
+	gchar *mimetype;
+	GList *rules;
 };
 
 static GHashTable *modules = NULL;
-static GHashTable *mimetype_map = NULL;
 static gboolean initialized = FALSE;
 static GArray *rules = NULL;
 
+/* Mimetype -> GArray of rule indexes */
+static GHashTable *exact_matches = NULL;
+/* Media type, e.g. "audio/" -> GArray of PrefixMatch */
+static GHashTable *prefix_matches = NULL;
+/* Any other pattern */
+static GArray *pattern_matches = NULL;
+
+/* Rule lists by mimetype, lock-free for readers */
+static CachedRules *rules_cache[N_CACHE_BUCKETS] = { NULL, };
+
 struct _TrackerMimetypeInfo {
 	const GList *rules;
 	const GList *cur;
@@ -71,15 +119,70 @@ dummy_extract_func (TrackerExtractInfo  *info,
 	return TRUE;
 }
 
+static void
+add_allow_pattern (const gchar *pattern,
+                   guint        rule)
+{
+	const gchar *wildcard, *slash;
+	GArray *array;
+
+	wildcard = strpbrk (pattern, "*?");
+
+	if (!wildcard) {
+		array = g_hash_table_lookup (exact_matches, pattern);
+		if (!array) {
+			array = g_array_new (FALSE, FALSE, sizeof (guint));
+			g_hash_table_insert (exact_matches, g_strdup (pattern), array);
+		}
+
+		g_array_append_val (array, rule);
+		return;
+	}
+
+	slash = strchr (pattern, '/');
+
+	/* The common "type/prefix*" form */
+	if (wildcard[0] == '*' && wildcard[1] == '\0' &&
+	    slash && slash < wildcard) {
+		PrefixMatch match;
+		gchar *media_type;
+
+		media_type = g_strndup (pattern, slash - pattern + 1);
+		array = g_hash_table_lookup (prefix_matches, media_type);
+		if (!array) {
+			array = g_array_new (FALSE, FALSE, sizeof (PrefixMatch));
+			g_hash_table_insert (prefix_matches, media_type, array);
+		} else {
+			g_free (media_type);
+		}
+
+		match.prefix = g_strndup (pattern, wildcard - pattern);
+		match.rule = rule;
+		g_array_append_val (array, match);
+	} else {
+		PatternMatch match;
+
+		match.pattern = g_pattern_spec_new (pattern);
+		match.rule = rule;
+		g_array_append_val (pattern_matches, match);
+	}
+}
+
+/* Parses a rule file into an entry of the rule cache, see
+ * RULE_CACHE_TYPE. Module paths are resolved once rules are added.
+ */
 static gboolean
-load_extractor_rule (GKeyFile    *key_file,
-                     const gchar *rule_path,
-                     GError     **error)
+parse_extractor_rule (GKeyFile         *key_file,
+                      const gchar      *rule_path,
+                      GVariantBuilder  *builder,
+                      GError          **error)
 {
 	GError *local_error = NULL;
-	gchar *module_path, **allow_mimetypes, **block_mimetypes;
-	gsize n_allow_mimetypes, n_block_mimetypes, i;
-	RuleInfo rule = { 0 };
+	g_autofree gchar *module_path = NULL, *graph = NULL, *hash = NULL;
+	g_auto (GStrv) allow_mimetypes = NULL, block_mimetypes = NULL;
+	g_auto (GStrv) fallback_rdf_types = NULL;
+	const gchar * const empty[] = { NULL };
+	gboolean thread_safe, expensive;
 
 	module_path = g_key_file_get_string (key_file, "ExtractorRule", "ModulePath", &local_error);
 
@@ -93,26 +196,9 @@ load_extractor_rule (GKeyFile    *key_file,
 		}
 	}
 
-	if (module_path &&
-	    !G_IS_DIR_SEPARATOR (module_path[0])) {
-		gchar *tmp;
-		const gchar *extractors_dir;
-
-		extractors_dir = g_getenv ("TRACKER_EXTRACTORS_DIR");
-		if (G_LIKELY (extractors_dir == NULL)) {
-			extractors_dir = TRACKER_EXTRACTORS_DIR;
-		}
-
-		tmp = g_build_filename (extractors_dir, module_path, NULL);
-		g_free (module_path);
-		module_path = tmp;
-	}
-
-	allow_mimetypes = g_key_file_get_string_list (key_file, "ExtractorRule", "MimeTypes", &n_allow_mimetypes, &local_error);
+	allow_mimetypes = g_key_file_get_string_list (key_file, "ExtractorRule", "MimeTypes", NULL, &local_error);
 
 	if (!allow_mimetypes) {
-		g_free (module_path);
-
 		if (local_error) {
 			g_propagate_error (error, local_error);
 		}
@@ -121,25 +207,79 @@ load_extractor_rule (GKeyFile    *key_file,
 	}
 
 	/* This key is optional */
-	block_mimetypes = g_key_file_get_string_list (key_file, "ExtractorRule", "BlockMimeTypes", &n_block_mimetypes, NULL);
+	block_mimetypes = g_key_file_get_string_list (key_file, "ExtractorRule", "BlockMimeTypes", NULL, NULL);
+
+	fallback_rdf_types = g_key_file_get_string_list (key_file, "ExtractorRule", "FallbackRdfTypes", NULL, NULL);
+	graph = g_key_file_get_string (key_file, "ExtractorRule", "Graph", NULL);
+	hash = g_key_file_get_string (key_file, "ExtractorRule", "Hash", NULL);
+	/* This key is optional, modules are assumed to be thread-unsafe */
+	thread_safe = g_key_file_get_boolean (key_file, "ExtractorRule", "ThreadSafe", NULL);
+	/* This key is optional, for modules that are heavy on the CPU */
+	expensive = g_key_file_get_boolean (key_file, "ExtractorRule", "Expensive", NULL);
+
+	g_variant_builder_add (builder, "(sms^as^as^asmsmsbb)",
+	                       rule_path,
+	                       module_path,
+	                       allow_mimetypes,
+	                       block_mimetypes ? (const gchar * const *) block_mimetypes : empty,
+	                       fallback_rdf_types ? (const gchar * const *) fallback_rdf_types : empty,
+	                       graph,
+	                       hash,
+	                       thread_safe,
+	                       expensive);
+	return TRUE;
+}
 
-	rule.rule_path = g_strdup (rule_path);
+static void
+add_extractor_rule (GVariant *entry)
+{
+	const gchar *rule_path, *module_path, *graph, *hash;
+	g_autofree const gchar **allow_mimetypes = NULL, **block_mimetypes = NULL;
+	g_autofree const gchar **fallback_rdf_types = NULL;
+	g_autofree gchar *full_module_path = NULL;
+	gboolean thread_safe, expensive;
+	RuleInfo rule = { 0 };
+	gsize i;
+
+	g_variant_get (entry, "(&sm&s^a&s^a&s^a&sm&sm&sbb)",
+	               &rule_path,
+	               &module_path,
+	               &allow_mimetypes,
+	               &block_mimetypes,
+	               &fallback_rdf_types,
+	               &graph,
+	               &hash,
+	               &thread_safe,
+	               &expensive);
 
-	rule.fallback_rdf_types = g_key_file_get_string_list (key_file, "ExtractorRule", "FallbackRdfTypes", NULL, NULL);
-	rule.graph = g_key_file_get_string (key_file, "ExtractorRule", "Graph", NULL);
-	rule.hash = g_key_file_get_string (key_file, "ExtractorRule", "Hash", NULL);
+	if (module_path &&
+	    !G_IS_DIR_SEPARATOR (module_path[0])) {
+		const gchar *extractors_dir;
+
+		extractors_dir = g_getenv ("TRACKER_EXTRACTORS_DIR");
+		if (G_LIKELY (extractors_dir == NULL)) {
+			extractors_dir = TRACKER_EXTRACTORS_DIR;
+		}
+
+		full_module_path = g_build_filename (extractors_dir, module_path, NULL);
+		module_path = full_module_path;
+	}
 
 	/* Construct the rule */
+	rule.rule_path = g_strdup (rule_path);
 	rule.module_path = g_intern_string (module_path);
+	rule.graph = g_strdup (graph);
+	rule.hash = g_strdup (hash);
+	rule.thread_safe = thread_safe;
+	rule.expensive = expensive;
 
-	for (i = 0; i < n_allow_mimetypes; i++) {
-		GPatternSpec *pattern;
+	if (fallback_rdf_types[0])
+		rule.fallback_rdf_types = g_strdupv ((gchar **) fallback_rdf_types);
 
-		pattern = g_pattern_spec_new (allow_mimetypes[i]);
-		rule.allow_patterns = g_list_prepend (rule.allow_patterns, pattern);
-	}
+	for (i = 0; allow_mimetypes[i]; i++)
+		add_allow_pattern (allow_mimetypes[i], rules->len);
 
-	for (i = 0; i < n_block_mimetypes; i++) {
+	for (i = 0; block_mimetypes[i]; i++) {
 		GPatternSpec *pattern;
 
 		pattern = g_pattern_spec_new (block_mimetypes[i]);
@@ -147,55 +287,103 @@ load_extractor_rule (GKeyFile    *key_file,
 	}
 
 	g_array_append_val (rules, rule);
-	g_strfreev (allow_mimetypes);
-	g_strfreev (block_mimetypes);
-	g_free (module_path);
-
-	return TRUE;
 }
 
-gboolean
-tracker_extract_module_manager_init (void)
+static void
+add_extractor_rules (GVariant *cache)
 {
-	const gchar *extractors_dir, *name;
-	GList *files = NULL, *l;
-	GError *error = NULL;
-	GDir *dir;
+	g_autoptr (GVariant) entries = NULL;
+	gsize i, n_entries;
 
-	if (initialized) {
-		return TRUE;
-	}
+	entries = g_variant_get_child_value (cache, 3);
+	n_entries = g_variant_n_children (entries);
 
-	if (!g_module_supported ()) {
-		g_error ("Modules are not supported for this platform");
-		return FALSE;
-	}
+	for (i = 0; i < n_entries; i++) {
+		g_autoptr (GVariant) entry = NULL;
 
-	extractors_dir = g_getenv ("TRACKER_EXTRACTOR_RULES_DIR");
-	if (G_LIKELY (extractors_dir == NULL)) {
-		extractors_dir = TRACKER_EXTRACTOR_RULES_DIR;
+		entry = g_variant_get_child_value (entries, i);
+		add_extractor_rule (entry);
 	}
+}
+
+static gint64
+get_mtime (const gchar *path)
+{
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileInfo) info = NULL;
+	g_autoptr (GDateTime) modified = NULL;
+
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (!info)
+		return -1;
+
+	modified = g_file_info_get_modification_date_time (info);
+	if (!modified)
+		return -1;
+
+	return (g_date_time_to_unix (modified) * G_USEC_PER_SEC +
+	        g_date_time_get_microsecond (modified));
+}
 
-	dir = g_dir_open (extractors_dir, 0, &error);
+/* Next to the rules directory, so writing it does not change the
+ * directory mtime.
+ */
+static gchar *
+get_system_cache_path (const gchar *rules_dir)
+{
+	g_autofree gchar *dir = NULL;
 
-	if (!dir) {
-		g_error ("Error opening extractor rules directory: %s", error->message);
-		g_error_free (error);
-		return FALSE;
-	}
+	dir = g_strdup (rules_dir);
+
+	while (strlen (dir) > 1 && G_IS_DIR_SEPARATOR (dir[strlen (dir) - 1]))
+		dir[strlen (dir) - 1] = '\0';
+
+	return g_strconcat (dir, ".cache", NULL);
+}
+
+static gchar *
+get_user_cache_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "tracker3",
+	                         "extract-rules.cache", NULL);
+}
+
+/* Parses all rules in @rules_dir, in the order they apply */
+static GVariant *
+parse_extractor_rules (const gchar  *rules_dir,
+                       gint64        mtime,
+                       GError      **error)
+{
+	GVariantBuilder builder;
+	const gchar *name;
+	GList *files = NULL, *l;
+	GDir *dir;
+
+	dir = g_dir_open (rules_dir, 0, error);
+	if (!dir)
+		return NULL;
 
 	while ((name = g_dir_read_name (dir)) != NULL) {
 		files = g_list_insert_sorted (files, (gpointer) name, (GCompareFunc) g_strcmp0);
 	}
 
-	TRACKER_NOTE (CONFIG, g_message ("Loading extractor rules... (%s)", extractors_dir));
+	TRACKER_NOTE (CONFIG, g_message ("Loading extractor rules... (%s)", rules_dir));
 
-	rules = g_array_new (FALSE, TRUE, sizeof (RuleInfo));
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (RULE_CACHE_TYPE));
+	g_variant_builder_add (&builder, "u", RULE_CACHE_VERSION);
+	g_variant_builder_add (&builder, "s", rules_dir);
+	g_variant_builder_add (&builder, "x", mtime);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("a" RULE_CACHE_ENTRY_TYPE));
 
 	for (l = files; l; l = l->next) {
-		GKeyFile *key_file;
-		const gchar *name;
-		gchar *path;
+		g_autoptr (GKeyFile) key_file = NULL;
+		g_autoptr (GError) local_error = NULL;
+		g_autofree gchar *path = NULL;
 
 		name = l->data;
 
@@ -204,103 +392,317 @@ tracker_extract_module_manager_init (void)
 			continue;
 		}
 
-		path = g_build_filename (extractors_dir, name, NULL);
+		path = g_build_filename (rules_dir, name, NULL);
 		key_file = g_key_file_new ();
 
-		if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &error) ||
-		    !load_extractor_rule (key_file, path, &error)) {
-			g_warning ("  Could not load extractor rule file '%s': %s", name, error->message);
-			g_clear_error (&error);
+		if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &local_error) ||
+		    !parse_extractor_rule (key_file, path, &builder, &local_error)) {
+			g_warning ("  Could not load extractor rule file '%s': %s", name,
+			           local_error ? local_error->message : "No MimeTypes");
 		} else {
 			TRACKER_NOTE (CONFIG, g_message ("  Loaded rule '%s'", name));
 		}
-
-		g_key_file_free (key_file);
-		g_free (path);
 	}
 
+	g_variant_builder_close (&builder);
+
 	TRACKER_NOTE (CONFIG, g_message ("Extractor rules loaded"));
 	g_list_free (files);
 	g_dir_close (dir);
 
-	/* Initialize miscellaneous data */
-	mimetype_map = g_hash_table_new_full (g_str_hash,
-	                                      g_str_equal,
-	                                      (GDestroyNotify) g_free,
-	                                      NULL);
-	initialized = TRUE;
-
-	return TRUE;
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
-static GList *
-lookup_rules (const gchar *mimetype)
+/* Caches are only used if made from the same rules directory, as it
+ * was last modified, and by the same version. Caches made on a host
+ * of the other byte order, if shared, fail the version check.
+ */
+static GVariant *
+load_rule_cache (const gchar *cache_path,
+                 const gchar *rules_dir,
+                 gint64       mtime)
 {
-	GList *mimetype_rules = NULL;
-	RuleInfo *info;
-	gchar *reversed;
-	gint len, i;
+	g_autoptr (GMappedFile) mapped = NULL;
+	g_autoptr (GBytes) bytes = NULL;
+	g_autoptr (GVariant) cache = NULL;
+	const gchar *cache_rules_dir;
+	gint64 cache_mtime;
+	guint32 version;
+
+	mapped = g_mapped_file_new (cache_path, FALSE, NULL);
+	if (!mapped)
+		return NULL;
 
-	if (!rules) {
+	bytes = g_mapped_file_get_bytes (mapped);
+	cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (RULE_CACHE_TYPE),
+	                                                      bytes, FALSE));
+
+	/* Untrusted data, everything read afterwards is in bounds */
+	if (!g_variant_is_normal_form (cache))
+		return NULL;
+
+	g_variant_get_child (cache, 0, "u", &version);
+	g_variant_get_child (cache, 1, "&s", &cache_rules_dir);
+	g_variant_get_child (cache, 2, "x", &cache_mtime);
+
+	if (version != RULE_CACHE_VERSION ||
+	    g_strcmp0 (cache_rules_dir, rules_dir) != 0 ||
+	    cache_mtime != mtime) {
+		TRACKER_NOTE (CONFIG, g_message ("Extractor rule cache '%s' is out of date", cache_path));
 		return NULL;
 	}
 
-	if (mimetype_map) {
-		mimetype_rules = g_hash_table_lookup (mimetype_map, mimetype);
+	return g_steal_pointer (&cache);
+}
 
-		if (mimetype_rules) {
-			return mimetype_rules;
+static gboolean
+save_rule_cache (const gchar  *cache_path,
+                 GVariant     *cache,
+                 GError      **error)
+{
+	g_autofree gchar *dir = NULL;
+
+	dir = g_path_get_dirname (cache_path);
+	if (g_mkdir_with_parents (dir, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+		             "Could not create directory '%s': %s",
+		             dir, g_strerror (errno));
+		return FALSE;
+	}
+
+	return g_file_set_contents (cache_path,
+	                            g_variant_get_data (cache),
+	                            g_variant_get_size (cache),
+	                            error);
+}
+
+static const gchar *
+get_rules_dir (void)
+{
+	const gchar *rules_dir;
+
+	rules_dir = g_getenv ("TRACKER_EXTRACTOR_RULES_DIR");
+	if (G_LIKELY (rules_dir == NULL)) {
+		rules_dir = TRACKER_EXTRACTOR_RULES_DIR;
+	}
+
+	return rules_dir;
+}
+
+/**
+ * tracker_extract_module_manager_write_cache:
+ * @error: return location for errors
+ *
+ * Parses the extractor rules and writes the cache of them that
+ * tracker_extract_module_manager_init() loads instead, next to the
+ * rules directory. This is meant to be run once the rules are
+ * installed.
+ *
+ * Returns: %TRUE if the cache was written
+ **/
+gboolean
+tracker_extract_module_manager_write_cache (GError **error)
+{
+	g_autoptr (GVariant) cache = NULL;
+	g_autofree gchar *cache_path = NULL;
+	const gchar *rules_dir;
+	gint64 mtime;
+
+	rules_dir = get_rules_dir ();
+	mtime = get_mtime (rules_dir);
+	cache = parse_extractor_rules (rules_dir, mtime, error);
+	if (!cache)
+		return FALSE;
+
+	cache_path = get_system_cache_path (rules_dir);
+
+	return save_rule_cache (cache_path, cache, error);
+}
+
+gboolean
+tracker_extract_module_manager_init (void)
+{
+	g_autoptr (GVariant) cache = NULL;
+	g_autofree gchar *system_cache_path = NULL, *user_cache_path = NULL;
+	const gchar *rules_dir;
+	GError *error = NULL;
+	gint64 mtime;
+
+	if (initialized) {
+		return TRUE;
+	}
+
+	if (!g_module_supported ()) {
+		g_error ("Modules are not supported for this platform");
+		return FALSE;
+	}
+
+	rules_dir = get_rules_dir ();
+	mtime = get_mtime (rules_dir);
+
+	/* The rules are parsed again if the directory changed since the
+	 * cache was written. As package managers do not keep directory
+	 * mtimes, the rules parsed here are cached for the user too.
+	 */
+	if (mtime >= 0) {
+		system_cache_path = get_system_cache_path (rules_dir);
+		user_cache_path = get_user_cache_path ();
+
+		cache = load_rule_cache (system_cache_path, rules_dir, mtime);
+		if (!cache)
+			cache = load_rule_cache (user_cache_path, rules_dir, mtime);
+
+		if (cache)
+			TRACKER_NOTE (CONFIG, g_message ("Loaded extractor rules from cache"));
+	}
+
+	if (!cache) {
+		cache = parse_extractor_rules (rules_dir, mtime, &error);
+
+		if (!cache) {
+			g_error ("Error opening extractor rules directory: %s", error->message);
+			g_error_free (error);
+			return FALSE;
+		}
+
+		if (user_cache_path &&
+		    !save_rule_cache (user_cache_path, cache, &error)) {
+			TRACKER_NOTE (CONFIG, g_message ("Could not write extractor rule cache: %s",
+			                                 error->message));
+			g_clear_error (&error);
 		}
 	}
 
-	reversed = g_strdup (mimetype);
-	g_strreverse (reversed);
-	len = strlen (mimetype);
+	rules = g_array_new (FALSE, TRUE, sizeof (RuleInfo));
+	exact_matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                       (GDestroyNotify) g_array_unref);
+	prefix_matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                        (GDestroyNotify) g_array_unref);
+	pattern_matches = g_array_new (FALSE, FALSE, sizeof (PatternMatch));
 
-	/* Apply the rules! */
-	for (i = 0; i < rules->len; i++) {
-		GList *l;
-		gboolean matched_allow_pattern = FALSE, matched_block_pattern = FALSE;
+	add_extractor_rules (cache);
+
+	initialized = TRUE;
 
-		info = &g_array_index (rules, RuleInfo, i);
+	return TRUE;
+}
 
-		for (l = info->allow_patterns; l; l = l->next) {
+static gboolean
+pattern_matches_mimetype (GPatternSpec *pattern,
+                          const gchar  *mimetype)
+{
 #if GLIB_CHECK_VERSION (2, 70, 0)
-			if (g_pattern_spec_match (l->data, len, mimetype, reversed))
+	return g_pattern_spec_match_string (pattern, mimetype);
 #else
-			if (g_pattern_match (l->data, len, mimetype, reversed))
+	return g_pattern_match_string (pattern, mimetype);
 #endif
-			{
-				matched_allow_pattern = TRUE;
-				break;
-			}
+}
+
+static gint
+compare_rule_indexes (gconstpointer a,
+                      gconstpointer b)
+{
+	guint rule_a = *(const guint *) a, rule_b = *(const guint *) b;
+
+	return (rule_a > rule_b) - (rule_a < rule_b);
+}
+
+static GList *
+match_rules (const gchar *mimetype)
+{
+	GList *mimetype_rules = NULL;
+	g_autoptr (GArray) matched = NULL;
+	const gchar *slash;
+	GArray *array;
+	guint i;
+
+	matched = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	array = g_hash_table_lookup (exact_matches, mimetype);
+	if (array)
+		g_array_append_vals (matched, array->data, array->len);
+
+	slash = strchr (mimetype, '/');
+	if (slash) {
+		g_autofree gchar *media_type = NULL;
+
+		media_type = g_strndup (mimetype, slash - mimetype + 1);
+		array = g_hash_table_lookup (prefix_matches, media_type);
+
+		for (i = 0; array && i < array->len; i++) {
+			PrefixMatch *match = &g_array_index (array, PrefixMatch, i);
+
+			if (g_str_has_prefix (mimetype, match->prefix))
+				g_array_append_val (matched, match->rule);
 		}
+	}
+
+	for (i = 0; i < pattern_matches->len; i++) {
+		PatternMatch *match = &g_array_index (pattern_matches, PatternMatch, i);
+
+		if (pattern_matches_mimetype (match->pattern, mimetype))
+			g_array_append_val (matched, match->rule);
+	}
+
+	/* Rules are applied in the order they were loaded, a rule may
+	 * match through several of its patterns.
+	 */
+	g_array_sort (matched, compare_rule_indexes);
+
+	for (i = 0; i < matched->len; i++) {
+		guint rule = g_array_index (matched, guint, i);
+		RuleInfo *info;
+		gboolean blocked = FALSE;
+		GList *l;
+
+		if (i > 0 && rule == g_array_index (matched, guint, i - 1))
+			continue;
+
+		info = &g_array_index (rules, RuleInfo, rule);
 
 		for (l = info->block_patterns; l; l = l->next) {
-#if GLIB_CHECK_VERSION (2, 70, 0)
-			if (g_pattern_spec_match (l->data, len, mimetype, reversed))
-#else
-			if (g_pattern_match (l->data, len, mimetype, reversed))
-#endif
-			{
-				matched_block_pattern = TRUE;
+			if (pattern_matches_mimetype (l->data, mimetype)) {
+				blocked = TRUE;
 				break;
 			}
 		}
 
-		if (matched_allow_pattern && !matched_block_pattern) {
+		if (!blocked)
 			mimetype_rules = g_list_prepend (mimetype_rules, info);
-		};
 	}
 
-	if (mimetype_rules) {
-		mimetype_rules = g_list_reverse (mimetype_rules);
-		g_hash_table_insert (mimetype_map, g_strdup (mimetype), mimetype_rules);
+	return g_list_reverse (mimetype_rules);
+}
+
+static GList *
+lookup_rules (const gchar *mimetype)
+{
+	CachedRules *entry, *head, **bucket;
+
+	if (!rules) {
+		return NULL;
+	}
+
+	bucket = &rules_cache[g_str_hash (mimetype) % N_CACHE_BUCKETS];
+
+	for (entry = g_atomic_pointer_get (bucket); entry; entry = entry->next) {
+		if (strcmp (entry->mimetype, mimetype) == 0)
+			return entry->rules;
 	}
 
-	g_free (reversed);
+	/* Entries are prepended, so concurrent misses on the same
+	 * mimetype at worst add duplicates that are never looked up.
+	 */
+	entry = g_new0 (CachedRules, 1);
+	entry->mimetype = g_strdup (mimetype);
+	entry->rules = match_rules (mimetype);
+
+	do {
+		head = g_atomic_pointer_get (bucket);
+		entry->next = head;
+	} while (!g_atomic_pointer_compare_and_exchange (bucket, head, entry));
 
-	return mimetype_rules;
+	return entry->rules;
 }
 
 /**
@@ -424,6 +826,24 @@ load_module (RuleInfo *info)
 		module_info = g_hash_table_lookup (modules, info->module_path);
 	}
 
+	if (module_info && module_info->shut_down) {
+		GError *init_error = NULL;
+
+		if (module_info->init_func &&
+		    !(module_info->init_func) (&init_error)) {
+			g_critical ("Could not initialize module %s: %s",
+			            g_module_name (module_info->module),
+			            (init_error) ? init_error->message : "No error given");
+
+			g_clear_error (&init_error);
+			return NULL;
+		}
+
+		TRACKER_NOTE (CONFIG, g_message ("Initialized module '%s' again",
+		                                 g_module_name (module_info->module)));
+		module_info->shut_down = FALSE;
+	}
+
 	if (!module_info) {
 		GModule *module;
 		GError *init_error = NULL;
@@ -442,6 +862,7 @@ load_module (RuleInfo *info)
 
 		module_info = g_slice_new0 (ModuleInfo);
 		module_info->module = module;
+		module_info->thread_safe = info->thread_safe;
 
 		if (!g_module_symbol (module, EXTRACTOR_FUNCTION, (gpointer *) &module_info->extract_func)) {
 			g_warning ("Could not load module '%s': Function %s() was not found, is it exported?",
@@ -545,6 +966,50 @@ tracker_extract_module_manager_get_module (const gchar                 *mimetype
 	return module;
 }
 
+/**
+ * tracker_extract_module_manager_module_is_thread_safe:
+ * @module: (allow-none): a #GModule, as returned by
+ *   tracker_extract_module_manager_get_module()
+ *
+ * Returns whether the extraction function of @module may be called
+ * concurrently from several threads, as declared by the ThreadSafe
+ * key of its .rule file. A %NULL @module means the dummy extractor,
+ * which is always thread safe.
+ *
+ * Returns: %TRUE if @module can run in several threads at once.
+ **/
+static ModuleInfo *
+lookup_module_info (GModule *module)
+{
+	GHashTableIter iter;
+	ModuleInfo *module_info;
+
+	if (!modules)
+		return NULL;
+
+	g_hash_table_iter_init (&iter, modules);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &module_info)) {
+		if (module_info->module == module)
+			return module_info;
+	}
+
+	return NULL;
+}
+
+gboolean
+tracker_extract_module_manager_module_is_thread_safe (GModule *module)
+{
+	ModuleInfo *module_info;
+
+	if (!module)
+		return dummy_module.thread_safe;
+
+	module_info = lookup_module_info (module);
+
+	return module_info ? module_info->thread_safe : FALSE;
+}
+
 void
 tracker_module_manager_load_modules (void)
 {
@@ -580,6 +1045,54 @@ tracker_extract_module_manager_get_graph (const gchar *mimetype)
 	return NULL;
 }
 
+/* Path of the module that would be tried first on @mimetype, without
+ * loading it. %NULL if no module handles it.
+ */
+const gchar *
+tracker_extract_module_manager_get_module_path (const gchar *mimetype)
+{
+	GList *l, *list;
+
+	if (!tracker_extract_module_manager_init ()) {
+		return NULL;
+	}
+
+	list = lookup_rules (mimetype);
+
+	for (l = list; l; l = l->next) {
+		RuleInfo *r_info = l->data;
+
+		if (r_info->module_path)
+			return r_info->module_path;
+	}
+
+	return NULL;
+}
+
+/* Whether the module that would be tried first on @mimetype is
+ * declared heavy on the CPU by the Expensive key of its rule.
+ */
+gboolean
+tracker_extract_module_manager_is_expensive (const gchar *mimetype)
+{
+	GList *l, *list;
+
+	if (!tracker_extract_module_manager_init ()) {
+		return FALSE;
+	}
+
+	list = lookup_rules (mimetype);
+
+	for (l = list; l; l = l->next) {
+		RuleInfo *r_info = l->data;
+
+		if (r_info->module_path)
+			return r_info->expensive;
+	}
+
+	return FALSE;
+}
+
 const gchar *
 tracker_extract_module_manager_get_hash (const gchar *mimetype)
 {
@@ -615,7 +1128,43 @@ tracker_module_manager_shutdown_modules (void)
 	g_hash_table_iter_init (&iter, modules);
 
 	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &module_info)) {
-		if (module_info->shutdown_func)
+		if (module_info->shutdown_func && !module_info->shut_down)
 			module_info->shutdown_func ();
+
+		module_info->shut_down = TRUE;
 	}
 }
+
+/**
+ * tracker_module_manager_shutdown_module:
+ * @module: (allow-none): a #GModule, as returned by
+ *   tracker_extract_module_manager_get_module()
+ *
+ * Shuts down @module, so it releases the resources it holds. The code
+ * itself stays loaded, as the libraries behind it may not be unloaded,
+ * the module is initialized again the next time it is returned by
+ * tracker_extract_module_manager_get_module().
+ *
+ * The caller must ensure that @module is not extracting any file.
+ *
+ * Returns: %TRUE if @module had anything to shut down.
+ **/
+gboolean
+tracker_module_manager_shutdown_module (GModule *module)
+{
+	ModuleInfo *module_info;
+
+	if (!module)
+		return FALSE;
+
+	module_info = lookup_module_info (module);
+
+	if (!module_info || module_info->shut_down ||
+	    !module_info->shutdown_func)
+		return FALSE;
+
+	module_info->shutdown_func ();
+	module_info->shut_down = TRUE;
+
+	return TRUE;
+}
@@ -40,10 +40,13 @@ typedef gboolean (* TrackerExtractMetadataFunc) (TrackerExtractInfo  *info,
                                                  GError             **error);
 
 gboolean  tracker_extract_module_manager_init                (void);
+gboolean  tracker_extract_module_manager_write_cache         (GError **error);
 
 GStrv     tracker_extract_module_manager_get_rdf_types (const gchar *mimetype);
 const gchar * tracker_extract_module_manager_get_graph (const gchar *mimetype);
 const gchar * tracker_extract_module_manager_get_hash  (const gchar *mimetype);
+const gchar * tracker_extract_module_manager_get_module_path (const gchar *mimetype);
+gboolean  tracker_extract_module_manager_is_expensive          (const gchar *mimetype);
 
 gboolean tracker_extract_module_manager_check_fallback_rdf_type (const gchar *mimetype,
                                                                  const gchar *rdf_type);
@@ -54,10 +57,14 @@ GModule * tracker_extract_module_manager_get_module (const gchar
 
 GList * tracker_extract_module_manager_get_matching_rules (const gchar *mimetype);
 
+gboolean tracker_extract_module_manager_module_is_thread_safe (GModule *module);
+
 void tracker_module_manager_load_modules (void);
 
 void tracker_module_manager_shutdown_modules (void);
 
+gboolean tracker_module_manager_shutdown_module (GModule *module);
+
 G_END_DECLS
 
 #endif /* __TRACKER_EXTRACT_MODULE_MANAGER_H__ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-text-limits.h"
+
+/**
+ * SECTION:tracker-text-limits
+ * @title: Text limits
+ * @short_description: How much text to extract from each file type
+ * @stability: Stable
+ * @include: libtracker-extract/tracker-extract.h
+ *
+ * A #TrackerTextLimits holds the "max-bytes", "text-limits" and
+ * "text-tail-bytes" extractor settings, and tells how much text to
+ * extract for a given MIME type and graph.
+ *
+ * Limits keyed by a graph name (e.g. "tracker:Software") apply to all
+ * files inserted there. Limits keyed by a MIME type pattern (e.g.
+ * "text/x-*") take precedence, the longest matching pattern wins.
+ *
+ * #TrackerTextLimits is immutable, so it can be shared across threads.
+ **/
+
+typedef struct {
+	gchar *key;
+	GPatternSpec *pattern;
+	gsize max_bytes;
+} TextLimit;
+
+struct _TrackerTextLimits {
+	gsize max_bytes;
+	gsize tail_bytes;
+	GArray *limits;
+	gint ref_count;
+};
+
+static void
+text_limit_clear (TextLimit *limit)
+{
+	g_free (limit->key);
+	if (limit->pattern)
+		g_pattern_spec_free (limit->pattern);
+}
+
+/**
+ * tracker_text_limits_new:
+ * @max_bytes: bytes of text to extract by default
+ * @tail_bytes: bytes of that text to take from the end of big plain
+ *   text files
+ * @limits: (nullable): a "a{si}" #GVariant with the limits for graphs
+ *   and MIME type patterns
+ *
+ * Returns: (transfer full): a new #TrackerTextLimits.
+ **/
+TrackerTextLimits *
+tracker_text_limits_new (gint      max_bytes,
+                         gint      tail_bytes,
+                         GVariant *limits)
+{
+	TrackerTextLimits *text_limits;
+
+	text_limits = g_slice_new0 (TrackerTextLimits);
+	text_limits->max_bytes = MAX (max_bytes, 0);
+	text_limits->tail_bytes = MAX (tail_bytes, 0);
+	text_limits->limits = g_array_new (FALSE, FALSE, sizeof (TextLimit));
+	g_array_set_clear_func (text_limits->limits, (GDestroyNotify) text_limit_clear);
+	text_limits->ref_count = 1;
+
+	if (limits && g_variant_is_of_type (limits, G_VARIANT_TYPE ("a{si}"))) {
+		g_autoptr (GVariant) owned = g_variant_ref_sink (limits);
+		GVariantIter iter;
+		const gchar *key;
+		gint32 value;
+
+		g_variant_iter_init (&iter, owned);
+
+		while (g_variant_iter_next (&iter, "{&si}", &key, &value)) {
+			TextLimit limit = { 0, };
+
+			if (!*key || value < 0)
+				continue;
+
+			limit.key = g_strdup (key);
+			limit.max_bytes = value;
+
+			/* Graph names are prefixed, MIME types are not */
+			if (!strchr (key, ':'))
+				limit.pattern = g_pattern_spec_new (key);
+
+			g_array_append_val (text_limits->limits, limit);
+		}
+	}
+
+	return text_limits;
+}
+
+TrackerTextLimits *
+tracker_text_limits_ref (TrackerTextLimits *limits)
+{
+	g_atomic_int_inc (&limits->ref_count);
+
+	return limits;
+}
+
+void
+tracker_text_limits_unref (TrackerTextLimits *limits)
+{
+	if (g_atomic_int_dec_and_test (&limits->ref_count)) {
+		g_array_unref (limits->limits);
+		g_slice_free (TrackerTextLimits, limits);
+	}
+}
+
+/**
+ * tracker_text_limits_get_max_text:
+ * @limits: a #TrackerTextLimits
+ * @mimetype: MIME type of the file
+ * @graph: (nullable): graph the file is inserted into
+ *
+ * Returns: the maximum number of UTF-8 bytes to extract.
+ **/
+gsize
+tracker_text_limits_get_max_text (TrackerTextLimits *limits,
+                                  const gchar       *mimetype,
+                                  const gchar       *graph)
+{
+	const TextLimit *graph_limit = NULL, *mime_limit = NULL;
+	guint i;
+
+	for (i = 0; i < limits->limits->len; i++) {
+		const TextLimit *limit = &g_array_index (limits->limits, TextLimit, i);
+
+		if (limit->pattern) {
+			if (!mimetype)
+				continue;
+#if GLIB_CHECK_VERSION (2, 70, 0)
+			if (!g_pattern_spec_match_string (limit->pattern, mimetype))
+#else
+			if (!g_pattern_match_string (limit->pattern, mimetype))
+#endif
+				continue;
+
+			if (!mime_limit || strlen (limit->key) > strlen (mime_limit->key))
+				mime_limit = limit;
+		} else if (g_strcmp0 (limit->key, graph) == 0) {
+			graph_limit = limit;
+		}
+	}
+
+	if (mime_limit)
+		return mime_limit->max_bytes;
+	if (graph_limit)
+		return graph_limit->max_bytes;
+
+	return limits->max_bytes;
+}
+
+/**
+ * tracker_text_limits_get_tail:
+ * @limits: a #TrackerTextLimits
+ * @mimetype: MIME type of the file
+ * @graph: (nullable): graph the file is inserted into
+ *
+ * Returns: how many of the bytes given by
+ *   tracker_text_limits_get_max_text() to take from the end of plain
+ *   text files bigger than that, 0 if they are only read from the start.
+ **/
+gsize
+tracker_text_limits_get_tail (TrackerTextLimits *limits,
+                              const gchar       *mimetype,
+                              const gchar       *graph)
+{
+	if (limits->tail_bytes == 0)
+		return 0;
+
+	return MIN (limits->tail_bytes,
+	            tracker_text_limits_get_max_text (limits, mimetype, graph));
+}
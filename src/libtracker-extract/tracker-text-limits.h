@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_EXTRACT_TEXT_LIMITS_H__
+#define __LIBTRACKER_EXTRACT_TEXT_LIMITS_H__
+
+#if !defined (__LIBTRACKER_EXTRACT_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-extract/tracker-extract.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerTextLimits TrackerTextLimits;
+
+TrackerTextLimits * tracker_text_limits_new          (gint               max_bytes,
+                                                      gint               tail_bytes,
+                                                      GVariant          *limits);
+TrackerTextLimits * tracker_text_limits_ref          (TrackerTextLimits *limits);
+void                tracker_text_limits_unref        (TrackerTextLimits *limits);
+
+gsize               tracker_text_limits_get_max_text (TrackerTextLimits *limits,
+                                                      const gchar       *mimetype,
+                                                      const gchar       *graph);
+gsize               tracker_text_limits_get_tail     (TrackerTextLimits *limits,
+                                                      const gchar       *mimetype,
+                                                      const gchar       *graph);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrackerTextLimits, tracker_text_limits_unref)
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_EXTRACT_TEXT_LIMITS_H__ */
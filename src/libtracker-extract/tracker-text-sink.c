@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-text-sink.h"
+#include "tracker-utils.h"
+
+/**
+ * SECTION:tracker-text-sink
+ * @title: Text sinks
+ * @short_description: Bounded plain text accumulation
+ * @stability: Stable
+ * @include: libtracker-extract/tracker-extract.h
+ *
+ * A #TrackerTextSink collects the plain text content of a document up
+ * to the configured limit. Once full, appending to it fails with
+ * %TRACKER_TEXT_SINK_ERROR_FULL, so parsers returning that error from
+ * their callbacks stop there, instead of parsing the rest of the
+ * document only to throw its text away.
+ **/
+
+struct _TrackerTextSink {
+	GString *text;
+	gsize remaining;
+};
+
+G_DEFINE_QUARK (tracker-text-sink-error-quark, tracker_text_sink_error)
+
+/**
+ * tracker_text_sink_new:
+ * @max_bytes: maximum number of UTF-8 bytes to store
+ *
+ * Returns: (transfer full): a new #TrackerTextSink.
+ **/
+TrackerTextSink *
+tracker_text_sink_new (gsize max_bytes)
+{
+	TrackerTextSink *sink;
+
+	sink = g_slice_new0 (TrackerTextSink);
+	sink->text = g_string_new (NULL);
+	sink->remaining = max_bytes;
+
+	return sink;
+}
+
+void
+tracker_text_sink_free (TrackerTextSink *sink)
+{
+	g_string_free (sink->text, TRUE);
+	g_slice_free (TrackerTextSink, sink);
+}
+
+static gboolean
+set_full_error (TrackerTextSink  *sink,
+                GError          **error)
+{
+	if (sink->remaining > 0)
+		return TRUE;
+
+	g_set_error_literal (error,
+	                     TRACKER_TEXT_SINK_ERROR,
+	                     TRACKER_TEXT_SINK_ERROR_FULL,
+	                     "Maximum text limit reached");
+	return FALSE;
+}
+
+static gsize
+append_valid (TrackerTextSink *sink,
+              const gchar     *text,
+              gssize           len)
+{
+	gsize written_bytes = 0;
+
+	if (len < 0)
+		len = strlen (text);
+
+	if (len == 0 || sink->remaining == 0)
+		return 0;
+
+	tracker_text_validate_utf8 (text,
+	                            MIN ((gsize) len, sink->remaining),
+	                            &sink->text,
+	                            &written_bytes);
+
+	/* Text cut at the limit is full, even if the last character
+	 * didn't fit and a few bytes are left */
+	if ((gsize) len >= sink->remaining)
+		sink->remaining = 0;
+	else
+		sink->remaining -= written_bytes;
+
+	return written_bytes;
+}
+
+/**
+ * tracker_text_sink_append:
+ * @sink: a #TrackerTextSink
+ * @text: text to append
+ * @len: length of @text in bytes, or -1 if NUL-terminated
+ * @error: return location for a %TRACKER_TEXT_SINK_ERROR_FULL error
+ *
+ * Appends the valid UTF-8 start of @text to @sink, as much as fits.
+ *
+ * Returns: %FALSE if @sink got full, and no more text should be
+ *   extracted.
+ **/
+gboolean
+tracker_text_sink_append (TrackerTextSink  *sink,
+                          const gchar      *text,
+                          gssize            len,
+                          GError          **error)
+{
+	append_valid (sink, text, len);
+
+	return set_full_error (sink, error);
+}
+
+/**
+ * tracker_text_sink_append_word:
+ * @sink: a #TrackerTextSink
+ * @text: text to append
+ * @len: length of @text in bytes, or -1 if NUL-terminated
+ * @error: return location for a %TRACKER_TEXT_SINK_ERROR_FULL error
+ *
+ * Like tracker_text_sink_append(), also separating @text from further
+ * text with a whitespace, for formats where each text node stands on
+ * its own.
+ *
+ * Returns: %FALSE if @sink got full, and no more text should be
+ *   extracted.
+ **/
+gboolean
+tracker_text_sink_append_word (TrackerTextSink  *sink,
+                               const gchar      *text,
+                               gssize            len,
+                               GError          **error)
+{
+	if (append_valid (sink, text, len) > 0 &&
+	    sink->text->str[sink->text->len - 1] != ' ')
+		g_string_append_c (sink->text, ' ');
+
+	return set_full_error (sink, error);
+}
+
+gboolean
+tracker_text_sink_is_full (TrackerTextSink *sink)
+{
+	return sink->remaining == 0;
+}
+
+/**
+ * tracker_text_sink_get_text:
+ * @sink: a #TrackerTextSink
+ *
+ * Returns: (nullable): the text collected by @sink, or %NULL if there is
+ *   none besides whitespace.
+ **/
+const gchar *
+tracker_text_sink_get_text (TrackerTextSink *sink)
+{
+	g_strstrip (sink->text->str);
+	sink->text->len = strlen (sink->text->str);
+
+	if (sink->text->len == 0)
+		return NULL;
+
+	return sink->text->str;
+}
+
+/**
+ * tracker_text_sink_steal_text:
+ * @sink: a #TrackerTextSink
+ *
+ * Same as tracker_text_sink_get_text(), but the text is handed over
+ * without copying it, @sink is left empty.
+ *
+ * Returns: (transfer full) (nullable): the text collected by @sink.
+ **/
+gchar *
+tracker_text_sink_steal_text (TrackerTextSink *sink)
+{
+	GString *text;
+
+	if (!tracker_text_sink_get_text (sink))
+		return NULL;
+
+	text = sink->text;
+	sink->text = g_string_new (NULL);
+
+	return g_string_free (text, FALSE);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_EXTRACT_TEXT_SINK_H__
+#define __LIBTRACKER_EXTRACT_TEXT_SINK_H__
+
+#if !defined (__LIBTRACKER_EXTRACT_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-extract/tracker-extract.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define TRACKER_TEXT_SINK_ERROR (tracker_text_sink_error_quark ())
+
+typedef enum {
+	TRACKER_TEXT_SINK_ERROR_FULL,
+} TrackerTextSinkError;
+
+typedef struct _TrackerTextSink TrackerTextSink;
+
+GQuark            tracker_text_sink_error_quark    (void);
+
+TrackerTextSink * tracker_text_sink_new            (gsize             max_bytes);
+void              tracker_text_sink_free           (TrackerTextSink  *sink);
+
+gboolean          tracker_text_sink_append         (TrackerTextSink  *sink,
+                                                    const gchar      *text,
+                                                    gssize            len,
+                                                    GError          **error);
+gboolean          tracker_text_sink_append_word    (TrackerTextSink  *sink,
+                                                    const gchar      *text,
+                                                    gssize            len,
+                                                    GError          **error);
+gboolean          tracker_text_sink_is_full        (TrackerTextSink  *sink);
+
+const gchar *     tracker_text_sink_get_text       (TrackerTextSink  *sink);
+gchar *           tracker_text_sink_steal_text     (TrackerTextSink  *sink);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_EXTRACT_TEXT_SINK_H__ */
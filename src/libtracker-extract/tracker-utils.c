@@ -313,24 +313,49 @@ tracker_text_normalize (const gchar *text,
                         guint       *n_words)
 {
 	GString *string;
-	gboolean in_break = TRUE;
+	gboolean in_break = TRUE, regular;
 	gunichar ch;
 	gint words = 0;
 
 	string = g_string_new (NULL);
 
-	while ((ch = g_utf8_get_char_validated (text, -1)) > 0) {
-		GUnicodeType type;
+	while (*text) {
+		if (((guchar) *text & 0x80) == 0) {
+			const gchar *start = text;
 
-		type = g_unichar_type (ch);
+			/* ASCII, runs of letters are appended at once */
+			while (g_ascii_isalpha (*text))
+				text++;
 
-		if (type == G_UNICODE_LOWERCASE_LETTER ||
-		    type == G_UNICODE_MODIFIER_LETTER ||
-		    type == G_UNICODE_OTHER_LETTER ||
-		    type == G_UNICODE_TITLECASE_LETTER ||
-		    type == G_UNICODE_UPPERCASE_LETTER) {
-			/* Append regular chars */
-			g_string_append_unichar (string, ch);
+			if (text > start) {
+				g_string_append_len (string, start, text - start);
+				in_break = FALSE;
+				continue;
+			}
+
+			regular = FALSE;
+			text++;
+		} else {
+			GUnicodeType type;
+
+			ch = g_utf8_get_char_validated (text, -1);
+			type = g_unichar_type (ch);
+
+			regular = (type == G_UNICODE_LOWERCASE_LETTER ||
+			           type == G_UNICODE_MODIFIER_LETTER ||
+			           type == G_UNICODE_OTHER_LETTER ||
+			           type == G_UNICODE_TITLECASE_LETTER ||
+			           type == G_UNICODE_UPPERCASE_LETTER);
+
+			if (regular) {
+				/* Append regular chars */
+				g_string_append_unichar (string, ch);
+			}
+
+			text = g_utf8_find_next_char (text, NULL);
+		}
+
+		if (regular) {
 			in_break = FALSE;
 		} else if (!in_break) {
 			/* Non-regular char found, treat as word break */
@@ -342,8 +367,6 @@ tracker_text_normalize (const gchar *text,
 				break;
 			}
 		}
-
-		text = g_utf8_find_next_char (text, NULL);
 	}
 
 	if (n_words) {
@@ -357,6 +380,33 @@ tracker_text_normalize (const gchar *text,
 	return g_string_free (string, FALSE);
 }
 
+/* For checking whole words of ASCII text at once */
+#define ONES_MASK  (G_MAXSIZE / 0xff)
+#define HIGHS_MASK (ONES_MASK * 0x80)
+
+/* Returns the first byte in [@text, @end) that is NUL or not ASCII */
+static const gchar *
+skip_ascii (const gchar *text,
+            const gchar *end)
+{
+	while (end - text >= (gssize) sizeof (gsize)) {
+		gsize word;
+
+		memcpy (&word, text, sizeof (word));
+
+		/* Bytes with the high bit set, or zero bytes */
+		if (((word | ((word - ONES_MASK) & ~word)) & HIGHS_MASK) != 0)
+			break;
+
+		text += sizeof (word);
+	}
+
+	while (text < end && *text != '\0' && ((guchar) *text & 0x80) == 0)
+		text++;
+
+	return text;
+}
+
 // LCOV_EXCL_STOP
 
 /**
@@ -368,7 +418,7 @@ tracker_text_normalize (const gchar *text,
  * @valid_len: Output number of valid UTF-8 bytes found, or %NULL if not needed
  *
  * This function iterates through @text checking for UTF-8 validity
- * using g_utf8_validate(), appends the first chunk of valid characters
+ * in the same way as g_utf8_validate(), appends the first chunk of valid characters
  * to @str, and gives the number of valid UTF-8 bytes in @valid_len.
  *
  * Returns: %TRUE if some bytes were found to be valid, %FALSE otherwise.
@@ -388,11 +438,18 @@ tracker_text_validate_utf8 (const gchar  *text,
 	len_to_validate = text_len >= 0 ? text_len : strlen (text);
 
 	if (len_to_validate > 0) {
-		const gchar *end = text;
+		const gchar *end = text, *limit = text + len_to_validate;
 
 		/* Validate string, getting the pointer to first non-valid character
-		 *  (if any) or to the end of the string. */
-		g_utf8_validate (text, len_to_validate, &end);
+		 *  (if any) or to the end of the string. Most text is ASCII, so
+		 *  only the other characters are decoded one by one. */
+		while ((end = skip_ascii (end, limit)) < limit && *end != '\0') {
+			/* Invalid or incomplete */
+			if (g_utf8_get_char_validated (end, limit - end) >= (gunichar) -2)
+				break;
+
+			end = g_utf8_next_char (end);
+		}
 		if (end > text) {
 			/* If str output required... */
 			if (str) {
@@ -414,13 +471,229 @@ tracker_text_validate_utf8 (const gchar  *text,
 	return FALSE;
 }
 
+/* Dates are parsed by hand, strptime() and GDateTime construction
+ * are locale and timezone aware, which is slow for the amount of
+ * dates going through here, and mostly unneeded for the handful
+ * of formats found in files.
+ */
+typedef struct {
+	gint year;
+	gint month;
+	gint day;
+	gint hour;
+	gint minute;
+	gint second;
+	gint offset; /* Seconds east of UTC */
+	guint has_offset : 1;
+} DateParts;
+
+static gboolean
+parse_digits (const gchar *str,
+              gint         n_digits,
+              gint        *value)
+{
+	gint i;
+
+	*value = 0;
+
+	for (i = 0; i < n_digits; i++) {
+		if (!g_ascii_isdigit (str[i]))
+			return FALSE;
+
+		*value = (*value * 10) + (str[i] - '0');
+	}
+
+	return TRUE;
+}
+
+static gboolean
+date_parts_valid (DateParts *parts)
+{
+	if (parts->year < 1 || parts->year > 9999 ||
+	    parts->month < 1 || parts->month > 12)
+		return FALSE;
+
+	if (parts->day < 1 ||
+	    parts->day > g_date_get_days_in_month (parts->month, parts->year))
+		return FALSE;
+
+	if (parts->hour > 23 || parts->minute > 59 || parts->second > 59)
+		return FALSE;
+
+	if (ABS (parts->offset) >= 24 * 3600)
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Parses "YYYY-MM-DDThh:mm:ss", optionally followed by a fraction of
+ * second and a "Z", "+hh", "+hh:mm" or "+hhmm" offset. Other forms
+ * of ISO 8601 are left to GDateTime.
+ */
+static gboolean
+parse_iso8601 (const gchar *str,
+               DateParts   *parts)
+{
+	gint hours, minutes = 0;
+	gchar sign;
+
+	memset (parts, 0, sizeof (DateParts));
+
+	if (!parse_digits (&str[0], 4, &parts->year) || str[4] != '-' ||
+	    !parse_digits (&str[5], 2, &parts->month) || str[7] != '-' ||
+	    !parse_digits (&str[8], 2, &parts->day) || str[10] != 'T' ||
+	    !parse_digits (&str[11], 2, &parts->hour) || str[13] != ':' ||
+	    !parse_digits (&str[14], 2, &parts->minute) || str[16] != ':' ||
+	    !parse_digits (&str[17], 2, &parts->second))
+		return FALSE;
+
+	str += 19;
+
+	if (*str == '.' || *str == ',') {
+		str++;
+		if (!g_ascii_isdigit (*str))
+			return FALSE;
+		while (g_ascii_isdigit (*str))
+			str++;
+	}
+
+	if (*str == 'Z') {
+		parts->has_offset = TRUE;
+		str++;
+	} else if (*str == '+' || *str == '-') {
+		sign = *str;
+		str++;
+
+		if (!parse_digits (str, 2, &hours))
+			return FALSE;
+		str += 2;
+
+		if (*str == ':')
+			str++;
+		if (g_ascii_isdigit (*str)) {
+			if (!parse_digits (str, 2, &minutes))
+				return FALSE;
+			str += 2;
+		}
+
+		if (minutes > 59)
+			return FALSE;
+
+		parts->offset = (hours * 3600) + (minutes * 60);
+		if (sign == '-')
+			parts->offset = -parts->offset;
+		parts->has_offset = TRUE;
+	}
+
+	if (*str != '\0')
+		return FALSE;
+
+	return date_parts_valid (parts);
+}
+
+/* Parses @date_string following @format, only fixed width numeric
+ * conversions are handled. Returns %FALSE if that is not enough, or
+ * the string does not match.
+ */
+static gboolean
+parse_with_format (const gchar *date_string,
+                   const gchar *format,
+                   struct tm   *date_tm)
+{
+	const gchar *str = date_string, *fmt;
+
+	for (fmt = format; *fmt; fmt++) {
+		gint value, n_digits;
+
+		if (*fmt != '%') {
+			if (*str != *fmt)
+				return FALSE;
+			str++;
+			continue;
+		}
+
+		fmt++;
+		n_digits = (*fmt == 'Y') ? 4 : 2;
+
+		if (!parse_digits (str, n_digits, &value))
+			return FALSE;
+		str += n_digits;
+
+		switch (*fmt) {
+		case 'Y':
+			date_tm->tm_year = value - 1900;
+			break;
+		case 'm':
+			if (value < 1 || value > 12)
+				return FALSE;
+			date_tm->tm_mon = value - 1;
+			break;
+		case 'd':
+			if (value < 1 || value > 31)
+				return FALSE;
+			date_tm->tm_mday = value;
+			break;
+		case 'H':
+			if (value > 23)
+				return FALSE;
+			date_tm->tm_hour = value;
+			break;
+		case 'M':
+			if (value > 59)
+				return FALSE;
+			date_tm->tm_min = value;
+			break;
+		case 'S':
+			if (value > 61)
+				return FALSE;
+			date_tm->tm_sec = value;
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+write_digits (gchar *buf,
+              gint   n_digits,
+              gint   value)
+{
+	gint i;
+
+	for (i = n_digits - 1; i >= 0; i--) {
+		buf[i] = '0' + (value % 10);
+		value /= 10;
+	}
+}
+
+/* Days since 1970-01-01 in the proleptic gregorian calendar */
+static gint64
+days_from_civil (gint year,
+                 gint month,
+                 gint day)
+{
+	gint64 era, yoe, doy, doe;
+
+	year -= month <= 2;
+	era = year / 400;
+	yoe = year - era * 400;
+	doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
 /**
  * tracker_date_format_to_iso8601:
  * @date_string: the date in a string pointer
  * @format: the format of the @date_string
  *
- * This function uses strptime() to create a time tm structure using
- * @date_string and @format.
+ * This function creates a time tm structure using @date_string and
+ * @format, numeric conversions are parsed directly, others through
+ * strptime().
  *
  * Returns: a newly-allocated string with the time represented in
  * ISO8601 date format which should be freed with g_free() when
@@ -438,8 +711,12 @@ tracker_date_format_to_iso8601 (const gchar *date_string,
 	g_return_val_if_fail (date_string != NULL, NULL);
 	g_return_val_if_fail (format != NULL, NULL);
 
-	if (strptime (date_string, format, &date_tm) == 0) {
-		return NULL;
+	if (!parse_with_format (date_string, format, &date_tm)) {
+		memset (&date_tm, 0, sizeof (date_tm));
+
+		if (strptime (date_string, format, &date_tm) == 0) {
+			return NULL;
+		}
 	}
 
 	/* If the input format string doesn't parse timezone information with
@@ -464,7 +741,24 @@ tracker_date_format_to_iso8601 (const gchar *date_string,
 	}
 
 	result = g_malloc (sizeof (char) * 25);
-	strftime (result, 25, DATE_FORMAT_ISO8601 , &date_tm);
+
+	if (date_tm.tm_year + 1900 >= 0 && date_tm.tm_year + 1900 <= 9999) {
+		write_digits (&result[0], 4, date_tm.tm_year + 1900);
+		result[4] = '-';
+		write_digits (&result[5], 2, date_tm.tm_mon + 1);
+		result[7] = '-';
+		write_digits (&result[8], 2, date_tm.tm_mday);
+		result[10] = 'T';
+		write_digits (&result[11], 2, date_tm.tm_hour);
+		result[13] = ':';
+		write_digits (&result[14], 2, date_tm.tm_min);
+		result[16] = ':';
+		write_digits (&result[17], 2, date_tm.tm_sec);
+		strftime (&result[19], 6, "%z", &date_tm);
+	} else {
+		strftime (result, 25, DATE_FORMAT_ISO8601 , &date_tm);
+	}
+
 	return result;
 }
 
@@ -485,41 +779,13 @@ parse_month (const gchar *month)
 /* Determine date format and convert to ISO 8601 format */
 /* FIXME We should handle all the fractions here (see ISO 8601), as well as YYYY:DDD etc */
 
-/**
- * tracker_date_guess:
- * @date_string: the date in a string pointer
- *
- * This function uses a number of methods to try and guess the date
- * held in @date_string. The @date_string must be at least 4
- * characters in length or longer for any guessing to be attempted.
- * Some of the string formats guessed include:
- *
- * <itemizedlist>
- *  <listitem><para>"YYYY-MM-DD" (Simple format)</para></listitem>
- *  <listitem><para>"20050315113224-08'00'" (PDF format)</para></listitem>
- *  <listitem><para>"20050216111533Z" (PDF format)</para></listitem>
- *  <listitem><para>"Mon Feb  9 10:10:00 2004" (Microsoft Office format)</para></listitem>
- *  <listitem><para>"2005:04:29 14:56:54" (Exif format)</para></listitem>
- *  <listitem><para>"YYYY-MM-DDThh:mm:ss.ff+zz:zz</para></listitem>
- * </itemizedlist>
- *
- * Returns: a newly-allocated string with the time represented in
- * ISO8601 date format which should be freed with g_free() when
- * finished with, otherwise %NULL.
- *
- * Since: 0.8
- **/
-gchar *
-tracker_date_guess (const gchar *date_string)
+/* Returns @date_string, or @buf with the date converted to ISO 8601 */
+static const gchar *
+date_guess (const gchar *date_string,
+            gchar        buf[30],
+            DateParts   *parts)
 {
-	gchar buf[30] = "0000-01-01T00:00:00Z";
-	gint  len;
-	g_autoptr (GDateTime) datetime = NULL;
-	g_autoptr (GTimeZone) tz = NULL;
-
-	if (!date_string) {
-		return NULL;
-	}
+	gint len;
 
 	len = strlen (date_string);
 
@@ -530,8 +796,6 @@ tracker_date_guess (const gchar *date_string)
 		return NULL;
 	}
 
-	tz = g_time_zone_new_local ();
-
 	/* Check for year only dates (EG ID3 music tags might have
 	 * Audio.ReleaseDate as 4 digit year)
 	 */
@@ -557,12 +821,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[18] = '0';
 		buf[19] = 'Z';
 		buf[20] = '\0';
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if (len == 10)  {
 		/* Check for date part only YYYY-MM-DD */
 		buf[0] = date_string[0];
@@ -585,12 +844,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[17] = '0';
 		buf[18] = '0';
 		buf[19] = '\0';
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if (len == 14) {
 		/* Check for pdf format EG 20050315113224-08'00' or
 		 * 20050216111533Z
@@ -615,12 +869,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[17] = date_string[12];
 		buf[18] = date_string[13];
 		buf[19] = '\0';
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if (len == 15 && date_string[14] == 'Z') {
 		buf[0] = date_string[0];
 		buf[1] = date_string[1];
@@ -643,12 +892,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[18] = date_string[13];
 		buf[19] = 'Z';
 
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if (len == 21 && (date_string[14] == '-' || date_string[14] == '+' )) {
 		buf[0] = date_string[0];
 		buf[1] = date_string[1];
@@ -677,12 +921,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[24] = date_string[19];
 		buf[25] = '\0';
 
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if ((len == 24) && (date_string[3] == ' ')) {
 		/* Check for msoffice date format "Mon Feb  9 10:10:00 2004" */
 		gint  num_month;
@@ -731,12 +970,7 @@ tracker_date_guess (const gchar *date_string)
 		buf[18] = date_string[18];
 		buf[19] = '\0';
 
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
-
-		if (!datetime)
-			return NULL;
-
-		return g_strdup (buf);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
 	} else if ((len == 19) && (date_string[4] == ':') && (date_string[7] == ':')) {
 		/* Check for Exif date format "2005:04:29 14:56:54" */
 		buf[0] = date_string[0];
@@ -760,20 +994,125 @@ tracker_date_guess (const gchar *date_string)
 		buf[18] = date_string[18];
 		buf[19] = '\0';
 
-		datetime = g_date_time_new_from_iso8601 (buf, tz);
+		return parse_iso8601 (buf, parts) ? buf : NULL;
+	}
+
+	if (!parse_iso8601 (date_string, parts)) {
+		g_autoptr (GTimeZone) tz = NULL;
+		g_autoptr (GDateTime) datetime = NULL;
+
+		tz = g_time_zone_new_local ();
+		datetime = g_date_time_new_from_iso8601 (date_string, tz);
 
 		if (!datetime)
 			return NULL;
 
-		return g_strdup (buf);
+		parts->year = g_date_time_get_year (datetime);
+		parts->month = g_date_time_get_month (datetime);
+		parts->day = g_date_time_get_day_of_month (datetime);
+		parts->hour = g_date_time_get_hour (datetime);
+		parts->minute = g_date_time_get_minute (datetime);
+		parts->second = g_date_time_get_second (datetime);
+		parts->offset = g_date_time_get_utc_offset (datetime) / G_TIME_SPAN_SECOND;
+		parts->has_offset = TRUE;
 	}
 
-	datetime = g_date_time_new_from_iso8601 (date_string, tz);
+	return date_string;
+}
+
+/**
+ * tracker_date_guess:
+ * @date_string: the date in a string pointer
+ *
+ * This function uses a number of methods to try and guess the date
+ * held in @date_string. The @date_string must be at least 4
+ * characters in length or longer for any guessing to be attempted.
+ * Some of the string formats guessed include:
+ *
+ * <itemizedlist>
+ *  <listitem><para>"YYYY-MM-DD" (Simple format)</para></listitem>
+ *  <listitem><para>"20050315113224-08'00'" (PDF format)</para></listitem>
+ *  <listitem><para>"20050216111533Z" (PDF format)</para></listitem>
+ *  <listitem><para>"Mon Feb  9 10:10:00 2004" (Microsoft Office format)</para></listitem>
+ *  <listitem><para>"2005:04:29 14:56:54" (Exif format)</para></listitem>
+ *  <listitem><para>"YYYY-MM-DDThh:mm:ss.ff+zz:zz</para></listitem>
+ * </itemizedlist>
+ *
+ * Returns: a newly-allocated string with the time represented in
+ * ISO8601 date format which should be freed with g_free() when
+ * finished with, otherwise %NULL.
+ *
+ * Since: 0.8
+ **/
+gchar *
+tracker_date_guess (const gchar *date_string)
+{
+	gchar buf[30] = "0000-01-01T00:00:00Z";
+	DateParts parts;
+	const gchar *date;
 
-	if (!datetime)
+	if (!date_string) {
 		return NULL;
+	}
+
+	date = date_guess (date_string, buf, &parts);
+
+	return g_strdup (date);
+}
+
+/**
+ * tracker_date_guess_unix:
+ * @date_string: the date in a string pointer
+ * @unix_time: (out): return location for the date as UNIX time
+ *
+ * Guesses the date held in @date_string like tracker_date_guess(),
+ * and gives it as seconds since the epoch, without allocating. Dates
+ * without timezone information are taken as local time.
+ *
+ * Returns: %TRUE if the date could be guessed, %FALSE otherwise.
+ *
+ * Since: 3.9
+ **/
+gboolean
+tracker_date_guess_unix (const gchar *date_string,
+                         gint64      *unix_time)
+{
+	gchar buf[30] = "0000-01-01T00:00:00Z";
+	DateParts parts;
+	gint64 seconds;
+
+	g_return_val_if_fail (unix_time != NULL, FALSE);
+
+	if (!date_string || !date_guess (date_string, buf, &parts)) {
+		return FALSE;
+	}
+
+	if (!parts.has_offset) {
+		struct tm date_tm = { 0 };
+		time_t t;
+
+		date_tm.tm_year = parts.year - 1900;
+		date_tm.tm_mon = parts.month - 1;
+		date_tm.tm_mday = parts.day;
+		date_tm.tm_hour = parts.hour;
+		date_tm.tm_min = parts.minute;
+		date_tm.tm_sec = parts.second;
+		date_tm.tm_isdst = -1;
+
+		t = mktime (&date_tm);
+		if (t != (time_t) -1) {
+			*unix_time = (gint64) t;
+			return TRUE;
+		}
+
+		/* Take it as UTC then */
+	}
+
+	seconds = (days_from_civil (parts.year, parts.month, parts.day) * 86400) +
+		(parts.hour * 3600) + (parts.minute * 60) + parts.second;
+	*unix_time = seconds - parts.offset;
 
-	return g_strdup (date_string);
+	return TRUE;
 }
 
 #ifndef HAVE_GETLINE
@@ -44,6 +44,8 @@ gboolean     tracker_text_validate_utf8     (const gchar  *text,
                                              GString     **str,
                                              gsize        *valid_len);
 gchar*       tracker_date_guess             (const gchar *date_string);
+gboolean     tracker_date_guess_unix        (const gchar *date_string,
+                                             gint64      *unix_time);
 gchar*       tracker_date_format_to_iso8601 (const gchar *date_string,
                                              const gchar *format);
 const gchar* tracker_coalesce_strip         (gint         n_values,
@@ -29,6 +29,19 @@
 #include "tracker-utils.h"
 
 #ifdef HAVE_EXEMPI
+#include <exempi/xmp.h>
+#include <exempi/xmpconsts.h>
+#else
+#define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
+#define NS_DC "http://purl.org/dc/elements/1.1/"
+#define NS_XAP "http://ns.adobe.com/xap/1.0/"
+#define NS_PDF "http://ns.adobe.com/pdf/1.3/"
+#define NS_PHOTOSHOP "http://ns.adobe.com/photoshop/1.0/"
+#define NS_IPTC4XMP "http://iptc.org/std/Iptc4xmpCore/1.0/xmlns/"
+#define NS_CC "http://creativecommons.org/ns#"
+#define NS_TIFF "http://ns.adobe.com/tiff/1.0/"
+#define NS_EXIF "http://ns.adobe.com/exif/1.0/"
+#endif /* HAVE_EXEMPI */
 
 #define NS_XMP_REGIONS "http://www.metadataworkinggroup.com/schemas/regions/"
 #define NS_ST_DIM "http://ns.adobe.com/xap/1.0/sType/Dimensions#"
@@ -36,9 +49,6 @@
 
 #define REGION_LIST_REGEX "^mwg-rs:Regions/mwg-rs:RegionList\\[(\\d+)\\]"
 
-#include <exempi/xmp.h>
-#include <exempi/xmpconsts.h>
-
 /**
  * SECTION:tracker-xmp
  * @title: XMP
@@ -62,11 +72,13 @@
  * using these standards.
  **/
 
+#ifdef HAVE_EXEMPI
 static void iterate        (XmpPtr                xmp,
                             XmpIteratorPtr        iter,
                             const gchar          *uri,
                             TrackerXmpData       *data,
                             gboolean              append);
+#endif /* HAVE_EXEMPI */
 static void iterate_simple (const gchar          *uri,
                             TrackerXmpData       *data,
                             const gchar          *schema,
@@ -131,8 +143,8 @@ gps_coordinate_dup (const gchar *coordinates)
 	static GRegex *reg = NULL;
 	GMatchInfo *info = NULL;
 
-	if (!reg) {
-		reg = g_regex_new ("([0-9]+),([0-9]+.[0-9]+)([A-Z])", 0, 0, NULL);
+	if (g_once_init_enter (&reg)) {
+		g_once_init_leave (&reg, g_regex_new ("([0-9]+),([0-9]+.[0-9]+)([A-Z])", 0, 0, NULL));
 	}
 
 	if (g_regex_match (reg, coordinates, 0, &info)) {
@@ -165,6 +177,8 @@ gps_coordinate_dup (const gchar *coordinates)
 	}
 }
 
+#ifdef HAVE_EXEMPI
+
 /* We have an array, now recursively iterate over it's children.  Set
  * 'append' to true so that all values of the array are added under
  * one entry.
@@ -200,6 +214,8 @@ iterate_alt_text (XmpPtr          xmp,
 	xmp_iterator_free (iter);
 }
 
+#endif /* HAVE_EXEMPI */
+
 static gchar *
 div_str_dup (const gchar *value)
 {
@@ -231,6 +247,45 @@ div_str_dup (const gchar *value)
 	return ret;
 }
 
+/* Whether text tagged with the @lang xml:lang qualifier is used */
+static gboolean
+language_is_wanted (const gchar *lang)
+{
+	static gchar *locale = NULL;
+
+	if (g_once_init_enter (&locale)) {
+		gchar *cur_locale;
+
+		cur_locale = g_strdup (setlocale (LC_ALL, NULL));
+
+		if (!cur_locale) {
+			cur_locale = g_strdup ("C");
+		} else {
+			gchar *sep;
+
+			sep = strchr (cur_locale, '.');
+
+			if (sep) {
+				cur_locale[sep - cur_locale] = '\0';
+			}
+
+			sep = strchr (cur_locale, '_');
+
+			if (sep) {
+				cur_locale[sep - cur_locale] = '-';
+			}
+		}
+
+		g_once_init_leave (&locale, cur_locale);
+	}
+
+	return (g_ascii_strcasecmp (lang, "x-default") == 0 ||
+	        g_ascii_strcasecmp (lang, "x-repair") == 0 ||
+	        g_ascii_strcasecmp (lang, locale) == 0);
+}
+
+#ifdef HAVE_EXEMPI
+
 /* We have a simple element, but need to iterate over the qualifiers */
 static void
 iterate_simple_qual (XmpPtr          xmp,
@@ -244,7 +299,6 @@ iterate_simple_qual (XmpPtr          xmp,
 	XmpIteratorPtr iter;
 	XmpStringPtr the_path;
 	XmpStringPtr the_prop;
-	static gchar *locale = NULL;
 	gboolean ignore_element = FALSE;
 
 	iter = xmp_iterator_new (xmp, schema, path, XMP_ITER_JUSTCHILDREN | XMP_ITER_JUSTLEAFNAME);
@@ -252,37 +306,13 @@ iterate_simple_qual (XmpPtr          xmp,
 	the_path = xmp_string_new ();
 	the_prop = xmp_string_new ();
 
-	if (G_UNLIKELY (!locale)) {
-		locale = g_strdup (setlocale (LC_ALL, NULL));
-
-		if (!locale) {
-			locale = g_strdup ("C");
-		} else {
-			gchar *sep;
-
-			sep = strchr (locale, '.');
-
-			if (sep) {
-				locale[sep - locale] = '\0';
-			}
-
-			sep = strchr (locale, '_');
-
-			if (sep) {
-				locale[sep - locale] = '-';
-			}
-		}
-	}
-
 	while (xmp_iterator_next (iter, NULL, the_path, the_prop, NULL)) {
 		const gchar *qual_path = xmp_string_cstr (the_path);
 		const gchar *qual_value = xmp_string_cstr (the_prop);
 
 		if (g_ascii_strcasecmp (qual_path, "xml:lang") == 0) {
 			/* Is this a language we should ignore? */
-			if (g_ascii_strcasecmp (qual_value, "x-default") != 0 &&
-			    g_ascii_strcasecmp (qual_value, "x-repair") != 0 &&
-			    g_ascii_strcasecmp (qual_value, locale) != 0) {
+			if (!language_is_wanted (qual_value)) {
 				ignore_element = TRUE;
 				break;
 			}
@@ -299,6 +329,8 @@ iterate_simple_qual (XmpPtr          xmp,
 	xmp_iterator_free (iter);
 }
 
+#endif /* HAVE_EXEMPI */
+
 static const gchar *
 fix_orientation (const gchar *orientation)
 {
@@ -336,8 +368,8 @@ get_region_counter (const gchar *path)
         gchar         *match;
         gint           result;
         
-        if (!regex) {
-                regex = g_regex_new (REGION_LIST_REGEX, 0, 0, NULL);
+        if (g_once_init_enter (&regex)) {
+                g_once_init_leave (&regex, g_regex_new (REGION_LIST_REGEX, 0, 0, NULL));
         }
 
         if (!g_regex_match (regex, path, 0, &match_info)) {
@@ -601,6 +633,7 @@ iterate_simple (const gchar    *uri,
 	g_free (name);
 }
 
+#ifdef HAVE_EXEMPI
 
 /* Iterate over the XMP, dispatching to the appropriate element type
  * (simple, simple w/qualifiers, or an array) handler.
@@ -663,8 +696,527 @@ register_namespace (const gchar *ns_uri,
         }
 }
 
+static void
+ensure_xmp_initialized (void)
+{
+	static gsize initialized = 0;
+
+	/* Exempi (un)initialization is not thread safe, do it
+	 * once and keep the library around for the lifetime
+	 * of the process.
+	 */
+	if (g_once_init_enter (&initialized)) {
+		xmp_init ();
+
+		register_namespace (NS_XMP_REGIONS, "mwg-rs");
+		register_namespace (NS_ST_DIM, "stDim");
+		register_namespace (NS_ST_AREA, "stArea");
+
+		g_once_init_leave (&initialized, 1);
+	}
+}
 #endif /* HAVE_EXEMPI */
 
+/* Streaming reader for the RDF/XML serialization of XMP packets.
+ * Properties are handed to iterate_simple() with the same schemas
+ * and paths exempi gives while iterating, e.g. "dc:subject[1]" or
+ * "mwg-rs:Regions/mwg-rs:RegionList[2]/mwg-rs:Area/stArea:x", as
+ * soon as their element ends. No model of the packet is built.
+ */
+
+typedef enum {
+	XMP_FRAME_OTHER,
+	XMP_FRAME_RDF,
+	XMP_FRAME_NODE,      /* rdf:Description, children are properties */
+	XMP_FRAME_PROPERTY,  /* A property, struct field or rdf:li item */
+	XMP_FRAME_CONTAINER, /* rdf:Bag, rdf:Seq or rdf:Alt */
+} XmpFrameType;
+
+typedef struct {
+	XmpFrameType type;
+	gchar *schema;
+	gchar *path;
+	guint n_namespaces;
+	guint n_items;
+	guint is_struct : 1;
+	guint has_value : 1;
+	guint ignore : 1;
+} XmpFrame;
+
+typedef struct {
+	gchar *prefix;
+	gchar *uri;
+} XmpNamespace;
+
+typedef struct {
+	const gchar *uri;
+	TrackerXmpData *data;
+	GArray *frames;
+	GArray *namespaces;
+	GString *text;
+	gboolean done;
+} XmpReader;
+
+/* Prefixes given in paths regardless of the ones in the packet,
+ * like the namespaces registered in exempi.
+ */
+static const struct {
+	const gchar *uri;
+	const gchar *prefix;
+} registered_prefixes[] = {
+	{ NS_XMP_REGIONS, "mwg-rs" },
+	{ NS_ST_DIM, "stDim" },
+	{ NS_ST_AREA, "stArea" },
+};
+
+static gboolean
+is_namespace_declaration (const gchar *attr_name)
+{
+	return (g_str_has_prefix (attr_name, "xmlns") &&
+	        (attr_name[5] == '\0' || attr_name[5] == ':'));
+}
+
+static gboolean
+is_rdf_name (const gchar *ns,
+             const gchar *local,
+             const gchar *name)
+{
+	return g_strcmp0 (ns, NS_RDF) == 0 && strcmp (local, name) == 0;
+}
+
+static guint
+xmp_reader_push_namespaces (XmpReader    *reader,
+                            const gchar **attribute_names,
+                            const gchar **attribute_values)
+{
+	guint i, n = 0;
+
+	for (i = 0; attribute_names[i]; i++) {
+		XmpNamespace ns;
+
+		if (!is_namespace_declaration (attribute_names[i]))
+			continue;
+
+		ns.prefix = g_strdup (attribute_names[i][5] == ':' ?
+		                      &attribute_names[i][6] : "");
+		ns.uri = g_strdup (attribute_values[i]);
+		g_array_append_val (reader->namespaces, ns);
+		n++;
+	}
+
+	return n;
+}
+
+static void
+xmp_reader_pop_namespaces (XmpReader *reader,
+                           guint      n)
+{
+	while (n > 0) {
+		XmpNamespace *ns;
+
+		ns = &g_array_index (reader->namespaces, XmpNamespace,
+		                     reader->namespaces->len - 1);
+		g_free (ns->prefix);
+		g_free (ns->uri);
+		g_array_set_size (reader->namespaces, reader->namespaces->len - 1);
+		n--;
+	}
+}
+
+/* Returns the namespace URI of @qname, or %NULL if it has none */
+static const gchar *
+xmp_reader_resolve (XmpReader    *reader,
+                    const gchar  *qname,
+                    const gchar **local)
+{
+	const gchar *colon;
+	gsize prefix_len;
+	guint i;
+
+	colon = strchr (qname, ':');
+	prefix_len = colon ? (gsize) (colon - qname) : 0;
+	*local = colon ? colon + 1 : qname;
+
+	for (i = reader->namespaces->len; i > 0; i--) {
+		XmpNamespace *ns;
+
+		ns = &g_array_index (reader->namespaces, XmpNamespace, i - 1);
+
+		if (strncmp (ns->prefix, qname, prefix_len) == 0 &&
+		    ns->prefix[prefix_len] == '\0')
+			return ns->uri;
+	}
+
+	return NULL;
+}
+
+static gchar *
+build_path (const gchar *parent_path,
+            const gchar *ns,
+            const gchar *qname,
+            const gchar *local)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (registered_prefixes); i++) {
+		if (strcmp (ns, registered_prefixes[i].uri) != 0)
+			continue;
+
+		if (parent_path) {
+			return g_strdup_printf ("%s/%s:%s", parent_path,
+			                        registered_prefixes[i].prefix, local);
+		} else {
+			return g_strdup_printf ("%s:%s",
+			                        registered_prefixes[i].prefix, local);
+		}
+	}
+
+	if (parent_path)
+		return g_strdup_printf ("%s/%s", parent_path, qname);
+	else
+		return g_strdup (qname);
+}
+
+static void
+xmp_reader_emit (XmpReader   *reader,
+                 const gchar *schema,
+                 const gchar *path,
+                 const gchar *value)
+{
+	if (!schema || tracker_is_empty_string (path))
+		return;
+
+	iterate_simple (reader->uri, reader->data, schema, path, value, FALSE);
+}
+
+/* Attributes of @frame that are properties, or struct fields */
+static guint
+xmp_reader_emit_attributes (XmpReader    *reader,
+                            XmpFrame     *frame,
+                            const gchar **attribute_names,
+                            const gchar **attribute_values)
+{
+	guint i, n = 0;
+
+	for (i = 0; attribute_names[i]; i++) {
+		const gchar *ns, *local;
+		gchar *path;
+
+		if (is_namespace_declaration (attribute_names[i]) ||
+		    g_str_has_prefix (attribute_names[i], "xml:"))
+			continue;
+
+		ns = xmp_reader_resolve (reader, attribute_names[i], &local);
+		if (!ns || local == attribute_names[i] ||
+		    strcmp (ns, NS_RDF) == 0)
+			continue;
+
+		path = build_path (frame->path, ns, attribute_names[i], local);
+		xmp_reader_emit (reader, frame->schema ? frame->schema : ns,
+		                 path, attribute_values[i]);
+		g_free (path);
+		n++;
+	}
+
+	return n;
+}
+
+static void
+xmp_reader_start_property (XmpReader    *reader,
+                           XmpFrame     *frame,
+                           const gchar **attribute_names,
+                           const gchar **attribute_values)
+{
+	const gchar *resource = NULL;
+	guint i;
+
+	frame->type = XMP_FRAME_PROPERTY;
+
+	for (i = 0; attribute_names[i]; i++) {
+		const gchar *ns, *local;
+
+		if (strcmp (attribute_names[i], "xml:lang") == 0) {
+			if (!language_is_wanted (attribute_values[i]))
+				frame->ignore = TRUE;
+			continue;
+		}
+
+		ns = xmp_reader_resolve (reader, attribute_names[i], &local);
+
+		if (is_rdf_name (ns, local, "parseType")) {
+			if (strcmp (attribute_values[i], "Resource") == 0)
+				frame->is_struct = TRUE;
+		} else if (is_rdf_name (ns, local, "resource")) {
+			resource = attribute_values[i];
+		}
+	}
+
+	if (frame->ignore)
+		return;
+
+	if (resource) {
+		xmp_reader_emit (reader, frame->schema, frame->path, resource);
+		frame->has_value = TRUE;
+	}
+
+	/* Struct fields given as attributes */
+	if (xmp_reader_emit_attributes (reader, frame,
+	                                attribute_names, attribute_values) > 0)
+		frame->is_struct = TRUE;
+}
+
+static void
+xmp_reader_start_element (GMarkupParseContext  *context,
+                          const gchar          *element_name,
+                          const gchar         **attribute_names,
+                          const gchar         **attribute_values,
+                          gpointer              user_data,
+                          GError              **error)
+{
+	XmpReader *reader = user_data;
+	XmpFrame frame = { 0, }, *parent = NULL;
+	const gchar *ns, *local;
+
+	frame.n_namespaces = xmp_reader_push_namespaces (reader,
+	                                                 attribute_names,
+	                                                 attribute_values);
+
+	if (reader->frames->len > 0) {
+		parent = &g_array_index (reader->frames, XmpFrame,
+		                         reader->frames->len - 1);
+	}
+
+	ns = xmp_reader_resolve (reader, element_name, &local);
+
+	if (!parent || parent->type == XMP_FRAME_OTHER) {
+		if (is_rdf_name (ns, local, "RDF"))
+			frame.type = XMP_FRAME_RDF;
+	} else if (parent->type == XMP_FRAME_RDF) {
+		if (is_rdf_name (ns, local, "Description")) {
+			frame.type = XMP_FRAME_NODE;
+			xmp_reader_emit_attributes (reader, &frame,
+			                            attribute_names, attribute_values);
+		}
+	} else if (parent->type == XMP_FRAME_NODE ||
+	           (parent->type == XMP_FRAME_PROPERTY && parent->is_struct &&
+	            !parent->ignore)) {
+		if (is_rdf_name (ns, local, "value")) {
+			/* Value of a property with qualifiers */
+			frame.schema = g_strdup (parent->schema);
+			frame.path = g_strdup (parent->path);
+			xmp_reader_start_property (reader, &frame,
+			                           attribute_names, attribute_values);
+		} else if (ns && local != element_name && strcmp (ns, NS_RDF) != 0) {
+			frame.schema = g_strdup (parent->schema ? parent->schema : ns);
+			frame.path = build_path (parent->path, ns, element_name, local);
+			xmp_reader_start_property (reader, &frame,
+			                           attribute_names, attribute_values);
+		}
+	} else if (parent->type == XMP_FRAME_PROPERTY) {
+		parent->has_value = TRUE;
+
+		if (parent->ignore) {
+			/* Skip the whole subtree */
+		} else if (is_rdf_name (ns, local, "Bag") ||
+		           is_rdf_name (ns, local, "Seq") ||
+		           is_rdf_name (ns, local, "Alt")) {
+			frame.type = XMP_FRAME_CONTAINER;
+			frame.schema = g_strdup (parent->schema);
+			frame.path = g_strdup (parent->path);
+		} else if (is_rdf_name (ns, local, "Description")) {
+			frame.type = XMP_FRAME_NODE;
+			frame.schema = g_strdup (parent->schema);
+			frame.path = g_strdup (parent->path);
+			xmp_reader_emit_attributes (reader, &frame,
+			                            attribute_names, attribute_values);
+		}
+	} else if (parent->type == XMP_FRAME_CONTAINER) {
+		if (is_rdf_name (ns, local, "li")) {
+			parent->n_items++;
+			frame.schema = g_strdup (parent->schema);
+			frame.path = g_strdup_printf ("%s[%u]", parent->path, parent->n_items);
+			xmp_reader_start_property (reader, &frame,
+			                           attribute_names, attribute_values);
+		}
+	}
+
+	g_string_truncate (reader->text, 0);
+	g_array_append_val (reader->frames, frame);
+}
+
+static void
+xmp_reader_end_element (GMarkupParseContext  *context,
+                        const gchar          *element_name,
+                        gpointer              user_data,
+                        GError              **error)
+{
+	XmpReader *reader = user_data;
+	XmpFrame *frame;
+
+	frame = &g_array_index (reader->frames, XmpFrame, reader->frames->len - 1);
+
+	if (frame->type == XMP_FRAME_PROPERTY &&
+	    !frame->is_struct && !frame->has_value && !frame->ignore)
+		xmp_reader_emit (reader, frame->schema, frame->path, reader->text->str);
+
+	if (frame->type == XMP_FRAME_RDF)
+		reader->done = TRUE;
+
+	xmp_reader_pop_namespaces (reader, frame->n_namespaces);
+	g_free (frame->schema);
+	g_free (frame->path);
+	g_array_set_size (reader->frames, reader->frames->len - 1);
+
+	g_string_truncate (reader->text, 0);
+}
+
+static void
+xmp_reader_text (GMarkupParseContext  *context,
+                 const gchar          *text,
+                 gsize                 text_len,
+                 gpointer              user_data,
+                 GError              **error)
+{
+	XmpReader *reader = user_data;
+	XmpFrame *frame;
+
+	if (reader->frames->len == 0)
+		return;
+
+	frame = &g_array_index (reader->frames, XmpFrame, reader->frames->len - 1);
+
+	if (frame->type == XMP_FRAME_PROPERTY)
+		g_string_append_len (reader->text, text, text_len);
+}
+
+static gboolean
+parse_xmp_packet (const gchar    *buffer,
+                  gsize           len,
+                  const gchar    *uri,
+                  TrackerXmpData *data)
+{
+	GMarkupParser parser = {
+		xmp_reader_start_element,
+		xmp_reader_end_element,
+		xmp_reader_text,
+		NULL,
+		NULL
+	};
+	GMarkupParseContext *context;
+	XmpReader reader = { 0, };
+	gboolean success;
+	guint i;
+
+	/* Sidecar files may start with a byte order mark */
+	if (len >= 3 && memcmp (buffer, "\xef\xbb\xbf", 3) == 0) {
+		buffer += 3;
+		len -= 3;
+	}
+
+	reader.uri = uri;
+	reader.data = data;
+	reader.frames = g_array_new (FALSE, FALSE, sizeof (XmpFrame));
+	reader.namespaces = g_array_new (FALSE, FALSE, sizeof (XmpNamespace));
+	reader.text = g_string_new (NULL);
+
+	context = g_markup_parse_context_new (&parser,
+	                                      G_MARKUP_TREAT_CDATA_AS_TEXT,
+	                                      &reader, NULL);
+
+	success = (g_markup_parse_context_parse (context, buffer, len, NULL) &&
+	           g_markup_parse_context_end_parse (context, NULL));
+
+	/* Padding or trailers after the RDF data don't matter */
+	if (reader.done)
+		success = TRUE;
+
+	g_markup_parse_context_free (context);
+
+	for (i = 0; i < reader.frames->len; i++) {
+		XmpFrame *frame = &g_array_index (reader.frames, XmpFrame, i);
+
+		g_free (frame->schema);
+		g_free (frame->path);
+	}
+
+	xmp_reader_pop_namespaces (&reader, reader.namespaces->len);
+	g_array_unref (reader.frames);
+	g_array_unref (reader.namespaces);
+	g_string_free (reader.text, TRUE);
+
+	return success;
+}
+
+static void
+xmp_region_free (gpointer data)
+{
+        TrackerXmpRegion *region = (TrackerXmpRegion *) data;
+
+        g_free (region->title);
+        g_free (region->description);
+        g_free (region->type);
+        g_free (region->x);
+        g_free (region->y);
+        g_free (region->width);
+        g_free (region->height);
+        g_free (region->link_class);
+        g_free (region->link_uri);
+
+        g_slice_free (TrackerXmpRegion, region);
+}
+
+static void
+xmp_data_clear (TrackerXmpData *data)
+{
+	g_free (data->title);
+	g_free (data->rights);
+	g_free (data->creator);
+	g_free (data->description);
+	g_free (data->date);
+	g_free (data->keywords);
+	g_free (data->subject);
+	g_free (data->publisher);
+	g_free (data->contributor);
+	g_free (data->type);
+	g_free (data->format);
+	g_free (data->identifier);
+	g_free (data->source);
+	g_free (data->language);
+	g_free (data->relation);
+	g_free (data->coverage);
+	g_free (data->license);
+	g_free (data->pdf_title);
+	g_free (data->pdf_keywords);
+	g_free (data->title2);
+	g_free (data->time_original);
+	g_free (data->artist);
+	g_free (data->make);
+	g_free (data->model);
+	g_free (data->orientation);
+	g_free (data->flash);
+	g_free (data->metering_mode);
+	g_free (data->exposure_time);
+	g_free (data->fnumber);
+	g_free (data->focal_length);
+	g_free (data->iso_speed_ratings);
+	g_free (data->white_balance);
+	g_free (data->copyright);
+	g_free (data->rating);
+	g_free (data->address);
+	g_free (data->country);
+	g_free (data->state);
+	g_free (data->city);
+	g_free (data->gps_altitude);
+	g_free (data->gps_altitude_ref);
+	g_free (data->gps_latitude);
+	g_free (data->gps_longitude);
+	g_free (data->gps_direction);
+
+
+	g_slist_free_full (data->regions, xmp_region_free);
+	memset (data, 0, sizeof (TrackerXmpData));
+}
+
 static gboolean
 parse_xmp (const gchar    *buffer,
            size_t          len,
@@ -677,13 +1229,14 @@ parse_xmp (const gchar    *buffer,
 
 	memset (data, 0, sizeof (TrackerXmpData));
 
-#ifdef HAVE_EXEMPI
+	if (parse_xmp_packet (buffer, len, uri, data))
+		return TRUE;
 
-	xmp_init ();
+#ifdef HAVE_EXEMPI
+	/* Leave packets GMarkup can't handle to exempi */
+	xmp_data_clear (data);
 
-        register_namespace (NS_XMP_REGIONS, "mwg-rs");
-        register_namespace (NS_ST_DIM, "stDim");
-        register_namespace (NS_ST_AREA, "stArea");
+	ensure_xmp_initialized ();
 
 	xmp = xmp_new_empty ();
 	xmp_parse (xmp, buffer, len);
@@ -696,8 +1249,6 @@ parse_xmp (const gchar    *buffer,
 		xmp_iterator_free (iter);
 		xmp_free (xmp);
 	}
-
-	xmp_terminate ();
 #endif /* HAVE_EXEMPI */
 
 	return TRUE;
@@ -743,24 +1294,6 @@ tracker_xmp_read (const gchar    *buffer,
 
 #endif /* TRACKER_DISABLE_DEPRECATED */
 
-static void
-xmp_region_free (gpointer data)
-{
-        TrackerXmpRegion *region = (TrackerXmpRegion *) data;
-
-        g_free (region->title);
-        g_free (region->description);
-        g_free (region->type);
-        g_free (region->x);
-        g_free (region->y);
-        g_free (region->width);
-        g_free (region->height);
-        g_free (region->link_class);
-        g_free (region->link_uri);
-
-        g_slice_free (TrackerXmpRegion, region);
-}
-
 
 /**
  * tracker_xmp_new:
@@ -797,21 +1330,125 @@ tracker_xmp_new (const gchar *buffer,
 	return data;
 }
 
-gchar *
-replace_extension (gchar *path)
+/* Sidecar files are looked up in a listing of their folder, made
+ * once for all the images extracted from it, rather than probing for
+ * a sidecar next to every image. Listings are dropped after a while,
+ * so new sidecars are eventually seen.
+ */
+#define SIDECAR_DIRS_MAX 4
+#define SIDECAR_DIR_TIMEOUT (30 * G_USEC_PER_SEC)
+
+typedef struct {
+	gchar *path;
+	GHashTable *sidecars; /* Image name without extension -> sidecar name */
+	gint64 time;
+} SidecarDir;
+
+static GMutex sidecar_dirs_mutex;
+static GQueue sidecar_dirs = G_QUEUE_INIT;
+
+static SidecarDir *
+sidecar_dir_new (const gchar *path,
+                 gint64       time)
+{
+	SidecarDir *sidecar_dir;
+	const gchar *name;
+	GDir *dir;
+
+	sidecar_dir = g_new0 (SidecarDir, 1);
+	sidecar_dir->path = g_strdup (path);
+	sidecar_dir->time = time;
+	sidecar_dir->sidecars = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                               g_free, g_free);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return sidecar_dir;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gsize len = strlen (name);
+		gchar *stem;
+
+		if (len <= 4 || g_ascii_strcasecmp (&name[len - 4], ".xmp") != 0)
+			continue;
+
+		stem = g_strndup (name, len - 4);
+
+		/* Prefer the lowercase extension if both exist */
+		if (strcmp (&name[len - 4], ".xmp") != 0 &&
+		    g_hash_table_contains (sidecar_dir->sidecars, stem)) {
+			g_free (stem);
+			continue;
+		}
+
+		g_hash_table_insert (sidecar_dir->sidecars, stem, g_strdup (name));
+	}
+
+	g_dir_close (dir);
+
+	return sidecar_dir;
+}
+
+static void
+sidecar_dir_free (SidecarDir *sidecar_dir)
 {
-	const gchar *dot;
-	gchar *prefix, *xmp_path;
+	g_hash_table_unref (sidecar_dir->sidecars);
+	g_free (sidecar_dir->path);
+	g_free (sidecar_dir);
+}
 
-	dot = strrchr (path, '.');
-	if (!dot)
+static gchar *
+lookup_sidecar (const gchar *path)
+{
+	g_autofree gchar *dirname = NULL, *basename = NULL;
+	SidecarDir *sidecar_dir = NULL;
+	const gchar *sidecar;
+	gchar *dot, *sidecar_path = NULL;
+	gint64 now;
+	GList *l;
+
+	basename = g_path_get_basename (path);
+	dot = strrchr (basename, '.');
+	if (!dot || dot == basename)
 		return NULL;
 
-	prefix = g_strndup (path, dot - path);
-	xmp_path = g_strdup_printf ("%s.xmp", prefix);
-	g_free (prefix);
+	dirname = g_path_get_dirname (path);
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&sidecar_dirs_mutex);
+
+	for (l = sidecar_dirs.head; l; l = l->next) {
+		if (strcmp (((SidecarDir *) l->data)->path, dirname) == 0)
+			break;
+	}
+
+	if (l) {
+		g_queue_unlink (&sidecar_dirs, l);
+
+		if (now - ((SidecarDir *) l->data)->time < SIDECAR_DIR_TIMEOUT)
+			sidecar_dir = l->data;
+		else
+			sidecar_dir_free (l->data);
+
+		g_list_free (l);
+	}
+
+	if (!sidecar_dir)
+		sidecar_dir = sidecar_dir_new (dirname, now);
+
+	g_queue_push_head (&sidecar_dirs, sidecar_dir);
 
-	return xmp_path;
+	while (g_queue_get_length (&sidecar_dirs) > SIDECAR_DIRS_MAX)
+		sidecar_dir_free (g_queue_pop_tail (&sidecar_dirs));
+
+	*dot = '\0';
+	sidecar = g_hash_table_lookup (sidecar_dir->sidecars, basename);
+	if (sidecar)
+		sidecar_path = g_build_filename (dirname, sidecar, NULL);
+
+	g_mutex_unlock (&sidecar_dirs_mutex);
+
+	return sidecar_path;
 }
 
 TrackerXmpData *
@@ -827,11 +1464,11 @@ tracker_xmp_new_from_sidecar (GFile  *orig_file,
 		*sidecar_uri = NULL;
 
 	path = g_file_get_path (orig_file);
-	xmp_path = replace_extension (path);
-	if (!xmp_path)
+	if (!path)
 		return NULL;
 
-	if (!g_file_test (xmp_path, G_FILE_TEST_IS_REGULAR))
+	xmp_path = lookup_sidecar (path);
+	if (!xmp_path)
 		return NULL;
 
 	mapped_file = g_mapped_file_new (xmp_path, FALSE, NULL);
@@ -864,51 +1501,7 @@ tracker_xmp_free (TrackerXmpData *data)
 {
 	g_return_if_fail (data != NULL);
 
-	g_free (data->title);
-	g_free (data->rights);
-	g_free (data->creator);
-	g_free (data->description);
-	g_free (data->date);
-	g_free (data->keywords);
-	g_free (data->subject);
-	g_free (data->publisher);
-	g_free (data->contributor);
-	g_free (data->type);
-	g_free (data->format);
-	g_free (data->identifier);
-	g_free (data->source);
-	g_free (data->language);
-	g_free (data->relation);
-	g_free (data->coverage);
-	g_free (data->license);
-	g_free (data->pdf_title);
-	g_free (data->pdf_keywords);
-	g_free (data->title2);
-	g_free (data->time_original);
-	g_free (data->artist);
-	g_free (data->make);
-	g_free (data->model);
-	g_free (data->orientation);
-	g_free (data->flash);
-	g_free (data->metering_mode);
-	g_free (data->exposure_time);
-	g_free (data->fnumber);
-	g_free (data->focal_length);
-	g_free (data->iso_speed_ratings);
-	g_free (data->white_balance);
-	g_free (data->copyright);
-	g_free (data->rating);
-	g_free (data->address);
-	g_free (data->country);
-	g_free (data->state);
-	g_free (data->city);
-	g_free (data->gps_altitude);
-	g_free (data->gps_altitude_ref);
-	g_free (data->gps_latitude);
-	g_free (data->gps_longitude);
-	g_free (data->gps_direction);
-
-        g_slist_free_full (data->regions, xmp_region_free);
+	xmp_data_clear (data);
 	g_free (data);
 }
 
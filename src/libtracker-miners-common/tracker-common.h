@@ -34,6 +34,7 @@
 
 #include "tracker-dbus.h"
 #include "tracker-debug.h"
+#include "tracker-desktop-entry.h"
 #include "tracker-domain-ontology.h"
 #include "tracker-enums.h"
 #include "tracker-error-report.h"
@@ -45,11 +46,16 @@
 #include "tracker-landlock.h"
 #endif
 
+#include "tracker-memory.h"
+#include "tracker-metrics.h"
 #include "tracker-miner.h"
 #include "tracker-miner-proxy.h"
+#include "tracker-pressure.h"
+#include "tracker-status-page.h"
 #include "tracker-sched.h"
 #include "tracker-seccomp.h"
 #include "tracker-term-utils.h"
+#include "tracker-trace.h"
 #include "tracker-type-utils.h"
 #include "tracker-utils.h"
 #include "tracker-locale.h"
@@ -37,17 +37,18 @@
 
 #include "tracker-dbus.h"
 
-/* How long clients can exist since last D-Bus call before being
- * cleaned up.
+/* Number of senders whose pid and binary name are remembered,
+ * the least recently used one is forgotten when a new sender
+ * shows up.
  */
-#define CLIENT_CLEAN_UP_TIME  300
+#define CLIENT_CACHE_SIZE 16
 
 typedef struct {
 	gchar *sender;
 	gchar *binary;
 	gulong pid;
-	guint clean_up_id;
-	gint n_active_requests;
+	guint64 last_used;
+	gint ref_count;
 } ClientData;
 
 struct _TrackerDBusRequest {
@@ -56,12 +57,10 @@ struct _TrackerDBusRequest {
 };
 
 static gboolean client_lookup_enabled;
-static GHashTable *clients;
+static ClientData *clients[CLIENT_CACHE_SIZE];
+static guint64 clients_age;
 static GDBusConnection *connection;
 
-static void     client_data_free    (gpointer data);
-static gboolean client_clean_up_cb (gpointer data);
-
 inline GBusType
 tracker_ipc_bus (void)
 {
@@ -75,53 +74,19 @@ tracker_ipc_bus (void)
 	return G_BUS_TYPE_SESSION;
 }
 
-static gboolean
-clients_init (void)
-{
-	GError *error = NULL;
-	connection = g_bus_get_sync (TRACKER_IPC_BUS, NULL, &error);
-
-	if (error) {
-		g_critical ("Could not connect to the D-Bus session bus, %s",
-		            error ? error->message : "no error given.");
-		g_clear_error (&error);
-		connection = NULL;
-	}
-
-	clients = g_hash_table_new_full (g_str_hash,
-	                                 g_str_equal,
-	                                 NULL,
-	                                 client_data_free);
-
-	return TRUE;
-}
-
-static gboolean
-clients_shutdown (void)
+static ClientData *
+client_data_ref (ClientData *cd)
 {
-	if (clients) {
-		g_hash_table_unref (clients);
-		clients = NULL;
-	}
+	cd->ref_count++;
 
-	if (connection) {
-		g_object_unref (connection);
-		connection = NULL;
-	}
-
-	return TRUE;
+	return cd;
 }
 
 static void
-client_data_free (gpointer data)
+client_data_unref (ClientData *cd)
 {
-	ClientData *cd = data;
-
-	if (!cd) {
+	if (--cd->ref_count > 0)
 		return;
-	}
-
-	g_source_remove (cd->clean_up_id);
 
 	g_free (cd->sender);
 	g_free (cd->binary);
@@ -129,144 +94,157 @@ client_data_free (gpointer data)
 	g_slice_free (ClientData, cd);
 }
 
-static ClientData *
-client_data_new (gchar *sender)
+static void
+clients_shutdown (void)
 {
-	ClientData *cd;
-	gboolean get_binary = TRUE;
-	GError *error = NULL;
+	guint i;
 
-	cd = g_slice_new0 (ClientData);
-	cd->sender = sender;
-
-	if (connection) {
-		GVariant *v;
-
-		v = g_dbus_connection_call_sync (connection,
-		                                 "org.freedesktop.DBus",
-		                                 "/org/freedesktop/DBus",
-		                                 "org.freedesktop.DBus",
-		                                 "GetConnectionUnixProcessID",
-		                                 g_variant_new ("(s)", sender),
-		                                 G_VARIANT_TYPE ("(u)"),
-		                                 G_DBUS_CALL_FLAGS_NONE,
-		                                 -1,
-		                                 NULL,
-		                                 &error);
-
-		if (!error) {
-			g_variant_get (v, "(u)", &cd->pid);
-			g_variant_unref (v);
-		} else {
-			g_error_free (error);
+	for (i = 0; i < CLIENT_CACHE_SIZE; i++) {
+		if (clients[i]) {
+			client_data_unref (clients[i]);
+			clients[i] = NULL;
 		}
 	}
 
-	if (get_binary) {
+	g_clear_object (&connection);
+}
+
+static void
+client_data_read_binary (ClientData *cd)
+{
 #ifndef __OpenBSD__
-		gchar *filename;
-		gchar *pid_str;
-		gchar *contents = NULL;
-		GError *error = NULL;
-		gchar **strv;
+	gchar *filename;
+	gchar *pid_str;
+	gchar *contents = NULL;
+	GError *error = NULL;
+	gchar **strv;
 #ifdef __sun /* Solaris */
-		psinfo_t psinfo = { 0 };
+	psinfo_t psinfo = { 0 };
 #endif
 
-		pid_str = g_strdup_printf ("%ld", cd->pid);
-		filename = g_build_filename (G_DIR_SEPARATOR_S,
-		                             "proc",
-		                             pid_str,
+	pid_str = g_strdup_printf ("%ld", cd->pid);
+	filename = g_build_filename (G_DIR_SEPARATOR_S,
+	                             "proc",
+	                             pid_str,
 #ifdef __sun /* Solaris */
-		                             "psinfo",
+	                             "psinfo",
 #else
-		                             "cmdline",
+	                             "cmdline",
 #endif
-		                             NULL);
-		g_free (pid_str);
-
-		if (!g_file_get_contents (filename, &contents, NULL, &error)) {
-			g_warning ("Could not get process name from id %ld, %s",
-			           cd->pid,
-			           error ? error->message : "no error given");
-			g_clear_error (&error);
-			g_free (filename);
-			return cd;
-		}
+	                             NULL);
+	g_free (pid_str);
 
+	if (!g_file_get_contents (filename, &contents, NULL, &error)) {
+		g_warning ("Could not get process name from id %ld, %s",
+		           cd->pid,
+		           error ? error->message : "no error given");
+		g_clear_error (&error);
 		g_free (filename);
+		return;
+	}
+
+	g_free (filename);
 
 #ifdef __sun /* Solaris */
-		memcpy (&psinfo, contents, sizeof (psinfo));
-		/* won't work with paths containing spaces :( */
-		strv = g_strsplit (psinfo.pr_psargs, " ", 2);
+	memcpy (&psinfo, contents, sizeof (psinfo));
+	/* won't work with paths containing spaces :( */
+	strv = g_strsplit (psinfo.pr_psargs, " ", 2);
 #else
-		strv = g_strsplit (contents, "^@", 2);
+	strv = g_strsplit (contents, "^@", 2);
 #endif
-		if (strv && strv[0]) {
-			cd->binary = g_path_get_basename (strv[0]);
-		}
+	if (strv && strv[0]) {
+		cd->binary = g_path_get_basename (strv[0]);
+	}
 
-		g_strfreev (strv);
-		g_free (contents);
+	g_strfreev (strv);
+	g_free (contents);
 #else
-		gint nproc;
-		struct kinfo_proc *kp;
-		kvm_t *kd;
-		gchar **strv;
-
-		if ((kd = kvm_openfiles (NULL, NULL, NULL, KVM_NO_FILES, NULL)) == NULL)
-			return cd;
-
-		if ((kp = kvm_getprocs (kd, KERN_PROC_PID, cd->pid, sizeof (*kp), &nproc)) == NULL) {
-			g_warning ("Could not get process name: %s", kvm_geterr (kd));
-			kvm_close(kd);
-			return cd;
-		}
+	gint nproc;
+	struct kinfo_proc *kp;
+	kvm_t *kd;
+	gchar **strv;
 
-		if ((kp->p_flag & P_SYSTEM) != 0) {
-			kvm_close(kd);
-			return cd;
-		}
+	if ((kd = kvm_openfiles (NULL, NULL, NULL, KVM_NO_FILES, NULL)) == NULL)
+		return;
 
-		strv = kvm_getargv (kd, kp, 0);
+	if ((kp = kvm_getprocs (kd, KERN_PROC_PID, cd->pid, sizeof (*kp), &nproc)) == NULL) {
+		g_warning ("Could not get process name: %s", kvm_geterr (kd));
+		kvm_close(kd);
+		return;
+	}
 
-		if (strv == NULL) {
-			kvm_close(kd);
-			return cd;
-		} else {
-			cd->binary = g_path_get_basename (strv[0]);
-			kvm_close(kd);
-		}
+	if ((kp->p_flag & P_SYSTEM) != 0) {
+		kvm_close(kd);
+		return;
+	}
+
+	strv = kvm_getargv (kd, kp, 0);
+
+	if (strv != NULL)
+		cd->binary = g_path_get_basename (strv[0]);
+
+	kvm_close(kd);
 #endif
+}
+
+static void
+client_data_pid_cb (GObject      *object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+	ClientData *cd = user_data;
+	GVariant *v;
+
+	v = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object),
+	                                   res, NULL);
+
+	if (v) {
+		g_variant_get (v, "(u)", &cd->pid);
+		g_variant_unref (v);
+
+		client_data_read_binary (cd);
 	}
 
-	return cd;
+	client_data_unref (cd);
 }
 
-static gboolean
-client_clean_up_cb (gpointer data)
+static ClientData *
+client_data_new (GDBusConnection *conn,
+                 const gchar     *sender)
 {
 	ClientData *cd;
 
-	cd = data;
-
-	g_debug ("Removing D-Bus client data for '%s' (pid: %lu) with id:'%s'",
-	         cd->binary, cd->pid, cd->sender);
-	g_hash_table_remove (clients, cd->sender);
+	cd = g_slice_new0 (ClientData);
+	cd->sender = g_strdup (sender);
+	cd->ref_count = 1;
 
-	if (g_hash_table_size (clients) < 1) {
-		/* Clean everything up. */
-		clients_shutdown ();
+	/* Requests are logged without pid and binary until the
+	 * reply arrives, so the method call is not held back by it.
+	 */
+	if (conn) {
+		g_dbus_connection_call (conn,
+		                        "org.freedesktop.DBus",
+		                        "/org/freedesktop/DBus",
+		                        "org.freedesktop.DBus",
+		                        "GetConnectionUnixProcessID",
+		                        g_variant_new ("(s)", sender),
+		                        G_VARIANT_TYPE ("(u)"),
+		                        G_DBUS_CALL_FLAGS_NONE,
+		                        -1,
+		                        NULL,
+		                        client_data_pid_cb,
+		                        client_data_ref (cd));
 	}
 
-	return FALSE;
+	return cd;
 }
 
 static ClientData *
-client_get_for_sender (const gchar *sender)
+client_get_for_sender (GDBusConnection *conn,
+                       const gchar     *sender)
 {
 	ClientData *cd;
+	guint i, slot = 0;
 
 	if (!client_lookup_enabled) {
 		return NULL;
@@ -279,27 +257,51 @@ client_get_for_sender (const gchar *sender)
 		return NULL;
 	}
 
-	if (G_UNLIKELY (!clients)) {
-		clients_init ();
-	}
+	for (i = 0; i < CLIENT_CACHE_SIZE; i++) {
+		if (!clients[i]) {
+			slot = i;
+			break;
+		}
 
-	cd = g_hash_table_lookup (clients, sender);
-	if (!cd) {
-		gchar *sender_dup;
+		if (g_strcmp0 (clients[i]->sender, sender) == 0) {
+			cd = clients[i];
+			cd->last_used = ++clients_age;
+			return client_data_ref (cd);
+		}
+
+		if (clients[i]->last_used < clients[slot]->last_used)
+			slot = i;
+	}
 
-		sender_dup = g_strdup (sender);
-		cd = client_data_new (sender_dup);
-		g_hash_table_insert (clients, sender_dup, cd);
+	if (!conn) {
+		if (G_UNLIKELY (!connection))
+			connection = g_bus_get_sync (TRACKER_IPC_BUS, NULL, NULL);
+		conn = connection;
 	}
 
-	if (cd->clean_up_id) {
-		g_source_remove (cd->clean_up_id);
-		cd->clean_up_id = 0;
+	if (clients[slot]) {
+		g_debug ("Forgetting D-Bus client data for '%s' (pid: %lu) with id:'%s'",
+		         clients[slot]->binary, clients[slot]->pid, clients[slot]->sender);
+		client_data_unref (clients[slot]);
 	}
 
-	cd->n_active_requests++;
+	cd = client_data_new (conn, sender);
+	cd->last_used = ++clients_age;
+	clients[slot] = cd;
 
-	return cd;
+	return client_data_ref (cd);
+}
+
+static const gchar *
+client_get_binary (ClientData *cd)
+{
+	return cd && cd->binary ? cd->binary : "";
+}
+
+static gulong
+client_get_pid (ClientData *cd)
+{
+	return cd ? cd->pid : 0;
 }
 
 GQuark
@@ -340,28 +342,26 @@ get_next_request_id (void)
 	return request_id++;
 }
 
-TrackerDBusRequest *
-tracker_dbus_request_begin (const gchar *sender,
-                            const gchar *format,
-                            ...)
+static TrackerDBusRequest *
+request_begin_valist (GDBusConnection *conn,
+                      const gchar     *sender,
+                      const gchar     *format,
+                      va_list          args)
 {
 	TrackerDBusRequest *request;
 	gchar *str;
-	va_list args;
 
-	va_start (args, format);
 	str = g_strdup_vprintf (format, args);
-	va_end (args);
 
 	request = g_slice_new (TrackerDBusRequest);
 	request->request_id = get_next_request_id ();
-	request->cd = client_get_for_sender (sender);
+	request->cd = client_get_for_sender (conn, sender);
 
 	g_debug ("<--- [%d%s%s|%lu] %s",
 	         request->request_id,
 	         request->cd ? "|" : "",
-	         request->cd ? request->cd->binary : "",
-	         request->cd ? request->cd->pid : 0,
+	         client_get_binary (request->cd),
+	         client_get_pid (request->cd),
 	         str);
 
 	g_free (str);
@@ -369,6 +369,21 @@ tracker_dbus_request_begin (const gchar *sender,
 	return request;
 }
 
+TrackerDBusRequest *
+tracker_dbus_request_begin (const gchar *sender,
+                            const gchar *format,
+                            ...)
+{
+	TrackerDBusRequest *request;
+	va_list args;
+
+	va_start (args, format);
+	request = request_begin_valist (NULL, sender, format, args);
+	va_end (args);
+
+	return request;
+}
+
 void
 tracker_dbus_request_end (TrackerDBusRequest *request,
                           GError             *error)
@@ -377,24 +392,19 @@ tracker_dbus_request_end (TrackerDBusRequest *request,
 		g_debug ("---> [%d%s%s|%lu] Success, no error given",
 			 request->request_id,
 			 request->cd ? "|" : "",
-			 request->cd ? request->cd->binary : "",
-			 request->cd ? request->cd->pid : 0);
+			 client_get_binary (request->cd),
+			 client_get_pid (request->cd));
 	} else {
 		g_message ("---> [%d%s%s|%lu] Failed, %s",
 			   request->request_id,
 			   request->cd ? "|" : "",
-			   request->cd ? request->cd->binary : "",
-			   request->cd ? request->cd->pid : 0,
+			   client_get_binary (request->cd),
+			   client_get_pid (request->cd),
 			   error->message);
 	}
 
-	if (request->cd) {
-		request->cd->n_active_requests--;
-
-		if (request->cd->n_active_requests == 0) {
-			request->cd->clean_up_id = g_timeout_add_seconds (CLIENT_CLEAN_UP_TIME, client_clean_up_cb, request->cd);
-		}
-	}
+	if (request->cd)
+		client_data_unref (request->cd);
 
 	g_slice_free (TrackerDBusRequest, request);
 }
@@ -414,8 +424,8 @@ tracker_dbus_request_info (TrackerDBusRequest    *request,
 	g_info ("---- [%d%s%s|%lu] %s",
 	        request->request_id,
 	        request->cd ? "|" : "",
-	        request->cd ? request->cd->binary : "",
-	        request->cd ? request->cd->pid : 0,
+	        client_get_binary (request->cd),
+	        client_get_pid (request->cd),
 	        str);
 	g_free (str);
 }
@@ -435,8 +445,8 @@ tracker_dbus_request_comment (TrackerDBusRequest    *request,
 	g_message ("---- [%d%s%s|%lu] %s",
 	           request->request_id,
 	           request->cd ? "|" : "",
-	           request->cd ? request->cd->binary : "",
-	           request->cd ? request->cd->pid : 0,
+	           client_get_binary (request->cd),
+	           client_get_pid (request->cd),
 	           str);
 	g_free (str);
 }
@@ -456,8 +466,8 @@ tracker_dbus_request_debug (TrackerDBusRequest    *request,
 	g_debug ("---- [%d%s%s|%lu] %s",
 	         request->request_id,
 	         request->cd ? "|" : "",
-	         request->cd ? request->cd->binary : "",
-	         request->cd ? request->cd->pid : 0,
+	         client_get_binary (request->cd),
+	         client_get_pid (request->cd),
 	         str);
 	g_free (str);
 }
@@ -481,18 +491,47 @@ tracker_g_dbus_request_begin (GDBusMethodInvocation *invocation,
                               ...)
 {
 	TrackerDBusRequest *request;
-	gchar *str;
-	const gchar *sender;
 	va_list args;
 
 	va_start (args, format);
-	str = g_strdup_vprintf (format, args);
+	request = request_begin_valist (g_dbus_method_invocation_get_connection (invocation),
+	                                g_dbus_method_invocation_get_sender (invocation),
+	                                format, args);
 	va_end (args);
 
-	sender = g_dbus_method_invocation_get_sender (invocation);
-	request = tracker_dbus_request_begin (sender, "%s", str);
+	return request;
+}
 
-	g_free (str);
+/**
+ * tracker_g_dbus_request_begin_full:
+ * @invocation: the method invocation
+ * @flags: a set of #TrackerDBusRequestFlags
+ * @format: printf-style format of the request description
+ *
+ * Like tracker_g_dbus_request_begin(). With
+ * %TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP the caller's pid and
+ * binary are not looked up nor logged, this is meant for the small
+ * status and control calls that are issued often.
+ *
+ * Returns: a new request, to be finished with tracker_dbus_request_end()
+ **/
+TrackerDBusRequest *
+tracker_g_dbus_request_begin_full (GDBusMethodInvocation   *invocation,
+                                   TrackerDBusRequestFlags  flags,
+                                   const gchar             *format,
+                                   ...)
+{
+	TrackerDBusRequest *request;
+	const gchar *sender = NULL;
+	va_list args;
+
+	if ((flags & TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP) == 0)
+		sender = g_dbus_method_invocation_get_sender (invocation);
+
+	va_start (args, format);
+	request = request_begin_valist (g_dbus_method_invocation_get_connection (invocation),
+	                                sender, format, args);
+	va_end (args);
 
 	return request;
 }
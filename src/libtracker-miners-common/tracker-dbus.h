@@ -66,6 +66,12 @@ typedef enum {
 	TRACKER_DBUS_ERROR_BROKEN_PIPE
 } TrackerDBusError;
 
+typedef enum {
+	TRACKER_DBUS_REQUEST_FLAGS_NONE = 0,
+	/* Do not look up the caller's pid and binary */
+	TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP = 1 << 0,
+} TrackerDBusRequestFlags;
+
 
 GBusType            tracker_ipc_bus                    (void);
 
@@ -100,6 +106,10 @@ gboolean            tracker_dbus_request_name (GDBusConnection  *connection,
 TrackerDBusRequest *tracker_g_dbus_request_begin       (GDBusMethodInvocation      *invocation,
                                                         const gchar                *format,
                                                         ...);
+TrackerDBusRequest *tracker_g_dbus_request_begin_full  (GDBusMethodInvocation      *invocation,
+                                                        TrackerDBusRequestFlags     flags,
+                                                        const gchar                *format,
+                                                        ...);
 
 G_END_DECLS
 
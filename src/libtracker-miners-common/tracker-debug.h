@@ -36,6 +36,7 @@ typedef enum {
   TRACKER_DEBUG_STATISTICS          = 1 <<  5,
   TRACKER_DEBUG_STATUS              = 1 <<  6,
   TRACKER_DEBUG_SANDBOX             = 1 <<  7,
+  TRACKER_DEBUG_MEMORY              = 1 <<  8,
 } TrackerDebugFlag;
 
 #ifdef G_ENABLE_DEBUG
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-desktop-entry.h"
+
+#define GROUP_DESKTOP_ENTRY "Desktop Entry"
+
+static const gchar *key_names[] = {
+	[TRACKER_DESKTOP_KEY_TYPE] = "Type",
+	[TRACKER_DESKTOP_KEY_HIDDEN] = "Hidden",
+	[TRACKER_DESKTOP_KEY_NAME] = "Name",
+	[TRACKER_DESKTOP_KEY_CATEGORIES] = "Categories",
+	[TRACKER_DESKTOP_KEY_COMMENT] = "Comment",
+	[TRACKER_DESKTOP_KEY_EXEC] = "Exec",
+	[TRACKER_DESKTOP_KEY_ICON] = "Icon",
+	[TRACKER_DESKTOP_KEY_URL] = "URL",
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (key_names) == TRACKER_N_DESKTOP_KEYS);
+
+static gint
+lookup_key (const gchar *name,
+            gsize        len)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (key_names); i++) {
+		if (strncmp (key_names[i], name, len) == 0 &&
+		    key_names[i][len] == '\0')
+			return i;
+	}
+
+	return -1;
+}
+
+/* Parses a key-value line, and passes it to @func if it is one
+ * of the extracted keys.
+ */
+static gboolean
+parse_key_value (const gchar              *line,
+                 const gchar              *end,
+                 TrackerDesktopEntryFunc   func,
+                 gpointer                  user_data)
+{
+	const gchar *equal, *key_end, *locale = NULL, *locale_end = NULL;
+	const gchar *value;
+	gint key;
+
+	equal = memchr (line, '=', end - line);
+	if (!equal || equal == line)
+		return FALSE;
+
+	key_end = equal;
+	while (key_end > line && g_ascii_isspace (key_end[-1]))
+		key_end--;
+
+	if (key_end > line && key_end[-1] == ']') {
+		locale_end = key_end - 1;
+		locale = memchr (line, '[', locale_end - line);
+		if (!locale)
+			return FALSE;
+
+		key_end = locale;
+		locale++;
+	}
+
+	key = lookup_key (line, key_end - line);
+	if (key < 0)
+		return TRUE;
+
+	value = equal + 1;
+	while (value < end && g_ascii_isspace (*value))
+		value++;
+	while (end > value && g_ascii_isspace (end[-1]))
+		end--;
+
+	func (key,
+	      locale, locale ? locale_end - locale : 0,
+	      value, end - value,
+	      user_data);
+
+	return TRUE;
+}
+
+/**
+ * tracker_desktop_entry_parse:
+ * @data: contents of a desktop file
+ * @len: length of @data
+ * @func: function called for each extracted key found
+ * @user_data: data for @func
+ * @error: return location for errors
+ *
+ * Goes through the "Desktop Entry" group of a desktop file, passing
+ * on the values of the keys in #TrackerDesktopKey, in all locales.
+ * Other groups and keys are skipped without parsing their values,
+ * which makes this a lot cheaper than loading a #GKeyFile, with
+ * desktop files having translations into dozens of languages.
+ *
+ * Returns: %FALSE if @data is not a key file.
+ **/
+gboolean
+tracker_desktop_entry_parse (const gchar              *data,
+                             gsize                     len,
+                             TrackerDesktopEntryFunc   func,
+                             gpointer                  user_data,
+                             GError                  **error)
+{
+	const gchar *line, *data_end = data + len;
+	gboolean in_group = FALSE, seen_group = FALSE;
+	guint line_number = 0;
+
+	for (line = data; line < data_end; ) {
+		const gchar *end, *next;
+
+		line_number++;
+		end = memchr (line, '\n', data_end - line);
+		next = end ? end + 1 : data_end;
+		if (!end)
+			end = data_end;
+
+		while (line < end && g_ascii_isspace (*line))
+			line++;
+		while (end > line && g_ascii_isspace (end[-1]))
+			end--;
+
+		if (line == end || *line == '#') {
+			/* Empty line or comment */
+		} else if (*line == '[') {
+			if (end[-1] != ']')
+				goto invalid;
+
+			in_group = ((gsize) (end - line - 2) == strlen (GROUP_DESKTOP_ENTRY) &&
+			            strncmp (line + 1, GROUP_DESKTOP_ENTRY, end - line - 2) == 0);
+			seen_group = TRUE;
+		} else if (!seen_group) {
+			g_set_error (error, G_KEY_FILE_ERROR,
+			             G_KEY_FILE_ERROR_GROUP_NOT_FOUND,
+			             "Key file does not start with a group");
+			return FALSE;
+		} else if (!memchr (line, '=', end - line)) {
+			goto invalid;
+		} else if (in_group &&
+		           !parse_key_value (line, end, func, user_data)) {
+			goto invalid;
+		}
+
+		line = next;
+	}
+
+	return TRUE;
+
+invalid:
+	g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE,
+	             "Key file contains an invalid line at line %u", line_number);
+	return FALSE;
+}
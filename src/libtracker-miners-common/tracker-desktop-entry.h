@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_DESKTOP_ENTRY_H__
+#define __LIBTRACKER_COMMON_DESKTOP_ENTRY_H__
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-miners-common/tracker-common.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Keys of the "Desktop Entry" group that are extracted */
+typedef enum {
+	TRACKER_DESKTOP_KEY_TYPE,
+	TRACKER_DESKTOP_KEY_HIDDEN,
+	TRACKER_DESKTOP_KEY_NAME,
+	TRACKER_DESKTOP_KEY_CATEGORIES,
+	TRACKER_DESKTOP_KEY_COMMENT,
+	TRACKER_DESKTOP_KEY_EXEC,
+	TRACKER_DESKTOP_KEY_ICON,
+	TRACKER_DESKTOP_KEY_URL,
+	TRACKER_N_DESKTOP_KEYS,
+} TrackerDesktopKey;
+
+/* @locale is %NULL for untranslated values, @value is still escaped */
+typedef void (* TrackerDesktopEntryFunc) (TrackerDesktopKey  key,
+                                          const gchar       *locale,
+                                          gsize              locale_len,
+                                          const gchar       *value,
+                                          gsize              value_len,
+                                          gpointer           user_data);
+
+gboolean tracker_desktop_entry_parse (const gchar              *data,
+                                      gsize                     len,
+                                      TrackerDesktopEntryFunc   func,
+                                      gpointer                  user_data,
+                                      GError                  **error);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_DESKTOP_ENTRY_H__ */
@@ -30,29 +30,34 @@
 #define KEY_SPARQL "Sparql"
 
 static gchar *report_dir = NULL;
+/* Names of the reports in report_dir, so files that were
+ * indexed fine do not need checking on disk.
+ */
+static GHashTable *reports = NULL;
 
 void
 tracker_error_report_init (GFile *cache_dir)
 {
 	GFile *report_file;
+	GDir *dir;
+	const gchar *name;
 
 	report_file = g_file_get_child (cache_dir, "errors");
 	report_dir = g_file_get_path (report_file);
 	if (g_mkdir_with_parents (report_dir, 0700) < 0)
 		g_warning ("Failed to create location for error reports: %m");
 	g_object_unref (report_file);
-}
 
-static gchar *
-get_report_file (const gchar *uri)
-{
-	gchar *md5, *report_file;
+	reports = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-	md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
-	report_file = g_build_filename (report_dir, md5, NULL);
-	g_free (md5);
+	dir = g_dir_open (report_dir, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL)
+		g_hash_table_add (reports, g_strdup (name));
 
-	return report_file;
+	g_dir_close (dir);
 }
 
 void
@@ -61,7 +66,7 @@ tracker_error_report (GFile       *file,
                       const gchar *sparql)
 {
 	g_autoptr (GKeyFile) key_file = NULL;
-	g_autofree gchar *report_path = NULL, *uri = NULL, *data = NULL;
+	g_autofree gchar *report_path = NULL, *uri = NULL, *data = NULL, *md5 = NULL;
 	g_autoptr (GError) error = NULL;
 	gssize len;
 
@@ -69,7 +74,8 @@ tracker_error_report (GFile       *file,
 		return;
 
 	uri = g_file_get_uri (file);
-	report_path = get_report_file (uri);
+	md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	report_path = g_build_filename (report_dir, md5, NULL);
 	key_file = g_key_file_new ();
 	g_key_file_set_string (key_file, GROUP, KEY_URI, uri);
 
@@ -81,36 +87,40 @@ tracker_error_report (GFile       *file,
 
 	data = g_key_file_to_data (key_file, &len, NULL);
 
+	/* Reports are informative, they are not worth syncing to disk */
 #if GLIB_CHECK_VERSION (2, 66, 0)
 	if (!g_file_set_contents_full (report_path, data, len,
-	                               G_FILE_SET_CONTENTS_CONSISTENT |
-	                               G_FILE_SET_CONTENTS_DURABLE,
+	                               G_FILE_SET_CONTENTS_CONSISTENT,
 	                               0666, &error))
 #else
 	if (!g_file_set_contents (report_path, data, len, &error))
 #endif
 	{
 		g_warning ("Could not save error report: %s\n", error->message);
+		return;
 	}
+
+	g_hash_table_add (reports, g_steal_pointer (&md5));
 }
 
 void
 tracker_error_report_delete (GFile *file)
 {
-	gchar *uri, *report_path;
+	g_autofree gchar *uri = NULL, *md5 = NULL, *report_path = NULL;
 
-	if (!report_dir)
+	if (!report_dir || g_hash_table_size (reports) == 0)
 		return;
 
 	uri = g_file_get_uri (file);
-	report_path = get_report_file (uri);
+	md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	if (!g_hash_table_remove (reports, md5))
+		return;
+
+	report_path = g_build_filename (report_dir, md5, NULL);
 	if (g_remove (report_path) < 0) {
 		if (errno != ENOENT) {
 			g_warning ("Error removing path '%s': %m",
 			           report_path);
 		}
 	}
-
-	g_free (report_path);
-	g_free (uri);
 }
@@ -34,6 +34,12 @@
 #include <sys/statfs.h>
 #endif
 
+#ifdef HAVE_BTRFS_IOCTL
+#include <sys/ioctl.h>
+#include <linux/btrfs.h>
+#include <linux/magic.h>
+#endif
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <gio/gio.h>
@@ -60,6 +66,14 @@ tracker_file_open_fd (const gchar *path)
 	fd = g_open (path, O_RDONLY, 0);
 #endif
 
+#ifdef HAVE_POSIX_FADVISE
+	/* Files are read once, keep them from pushing other data
+	 * out of the page cache.
+	 */
+	if (fd != -1)
+		posix_fadvise (fd, 0, 0, POSIX_FADV_NOREUSE);
+#endif /* HAVE_POSIX_FADVISE */
+
 	return fd;
 }
 
@@ -320,6 +334,164 @@ tracker_file_system_get_remaining_space_percentage (const gchar *path)
 	}
 }
 
+/* Network filesystems, and FUSE ones which are most often backed
+ * by a remote service. "fuseblk" is left out, it is used for local
+ * block devices (e.g. NTFS partitions).
+ */
+static const gchar *remote_fs_types[] = {
+	"nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "afs", "ceph",
+	"coda", "davfs", "glusterfs", "ncpfs", "sshfs", "fuse",
+};
+
+gboolean
+tracker_file_system_is_remote (const gchar *path)
+{
+	GUnixMountEntry *mount;
+	const gchar *fs_type;
+	gboolean remote = FALSE;
+	guint i;
+
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	mount = g_unix_mount_for (path, NULL);
+	if (!mount)
+		return FALSE;
+
+	fs_type = g_unix_mount_get_fs_type (mount);
+
+	if (g_str_has_prefix (fs_type, "fuse.")) {
+		remote = TRUE;
+	} else {
+		for (i = 0; i < G_N_ELEMENTS (remote_fs_types); i++) {
+			if (g_strcmp0 (fs_type, remote_fs_types[i]) == 0) {
+				remote = TRUE;
+				break;
+			}
+		}
+	}
+
+	g_unix_mount_free (mount);
+
+	return remote;
+}
+
+#if defined (HAVE_BTRFS_IOCTL) && defined (BTRFS_IOC_GET_SUBVOL_INFO)
+static gboolean
+btrfs_subvolume_is_below (int                                  fd,
+                          const struct btrfs_ioctl_get_subvol_rootref_args *rootrefs,
+                          guint                                idx)
+{
+#ifdef BTRFS_IOC_INO_LOOKUP_USER
+	struct btrfs_ioctl_ino_lookup_user_args args = { 0, };
+
+	/* The lookup only succeeds if the directory holding the
+	 * subvolume is below the directory of fd.
+	 */
+	args.dirid = rootrefs->rootref[idx].dirid;
+	args.treeid = rootrefs->rootref[idx].treeid;
+
+	if (ioctl (fd, BTRFS_IOC_INO_LOOKUP_USER, &args) == 0)
+		return TRUE;
+
+	return errno != EACCES;
+#else
+	return TRUE;
+#endif
+}
+
+static gchar *
+btrfs_get_generation (const gchar *path)
+{
+	struct btrfs_ioctl_get_subvol_info_args info = { 0, };
+	struct btrfs_ioctl_get_subvol_rootref_args rootrefs = { 0, };
+	struct statfs st;
+	gboolean nested = FALSE;
+	GString *str;
+	int fd, ret;
+	guint i;
+
+	fd = g_open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0);
+	if (fd < 0)
+		return NULL;
+
+	if (fstatfs (fd, &st) < 0 || st.f_type != BTRFS_SUPER_MAGIC ||
+	    ioctl (fd, BTRFS_IOC_GET_SUBVOL_INFO, &info) < 0) {
+		close (fd);
+		return NULL;
+	}
+
+	/* Changes in nested subvolumes are not accounted in the
+	 * generation of this one.
+	 */
+	do {
+		ret = ioctl (fd, BTRFS_IOC_GET_SUBVOL_ROOTREF, &rootrefs);
+		if (ret < 0 && errno != EOVERFLOW) {
+			nested = TRUE;
+			break;
+		}
+
+		for (i = 0; i < rootrefs.num_items && !nested; i++)
+			nested = btrfs_subvolume_is_below (fd, &rootrefs, i);
+	} while (ret < 0 && !nested);
+
+	close (fd);
+
+	if (nested)
+		return NULL;
+
+	str = g_string_new ("btrfs:");
+
+	for (i = 0; i < G_N_ELEMENTS (info.uuid); i++)
+		g_string_append_printf (str, "%02x", info.uuid[i]);
+
+	g_string_append_printf (str, ":%" G_GUINT64_FORMAT, (guint64) info.generation);
+
+	return g_string_free (str, FALSE);
+}
+#endif
+
+/**
+ * tracker_file_system_get_generation:
+ * @path: a directory
+ *
+ * Returns a string that changes whenever anything below @path changes,
+ * on filesystems that keep track of it. Currently these are btrfs
+ * subvolumes, every transaction modifying one gets a new generation.
+ *
+ * Returns: (transfer full) (nullable): the generation, or %NULL if
+ * not available for @path.
+ **/
+gchar *
+tracker_file_system_get_generation (const gchar *path)
+{
+#if defined (HAVE_BTRFS_IOCTL) && defined (BTRFS_IOC_GET_SUBVOL_INFO)
+	GList *mounts, *l;
+	gboolean nested = FALSE;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	/* Other filesystems may be mounted below */
+	mounts = g_unix_mounts_get (NULL);
+
+	for (l = mounts; l && !nested; l = l->next) {
+		const gchar *mount_path;
+
+		mount_path = g_unix_mount_get_mount_path (l->data);
+		nested = (g_strcmp0 (mount_path, path) != 0 &&
+		          tracker_path_is_in_path (mount_path, path));
+	}
+
+	g_list_free_full (mounts, (GDestroyNotify) g_unix_mount_free);
+
+	if (nested)
+		return NULL;
+
+	return btrfs_get_generation (path);
+#else
+	return NULL;
+#endif
+}
+
 gboolean
 tracker_path_is_in_path (const gchar *path,
                          const gchar *in_path)
@@ -57,6 +57,8 @@ gboolean tracker_filename_casecmp_without_extension         (const gchar *a,
 /* File system utils */
 guint64  tracker_file_system_get_remaining_space            (const gchar *path);
 gdouble  tracker_file_system_get_remaining_space_percentage (const gchar *path);
+gboolean tracker_file_system_is_remote                      (const gchar *path);
+gchar *  tracker_file_system_get_generation                 (const gchar *path);
 
 G_END_DECLS
 
@@ -218,6 +218,12 @@ tracker_landlock_init (const gchar * const *indexed_folders)
 		  LANDLOCK_ACCESS_FS_READ_FILE },
 		{ "/proc/self/mountinfo",
 		  LANDLOCK_ACCESS_FS_READ_FILE },
+		/* Necessary for the extractor memory quota */
+		{ "/proc/self/statm",
+		  LANDLOCK_ACCESS_FS_READ_FILE },
+		/* Necessary for pressure-based throttling */
+		{ "/proc/pressure/",
+		  LANDLOCK_ACCESS_FS_READ_FILE },
 		/* Necessary for g_get_user_name() */
 		{ "/etc/passwd",
 		  LANDLOCK_ACCESS_FS_READ_FILE },
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <signal.h>
+#include <glib-unix.h>
+
+#include "tracker-memory.h"
+
+/* Live bytes and allocations per subsystem, plus the instance counts
+ * of the GObjects these own. Sizes are those of the structures as
+ * requested, without allocator overhead, so these tell which part of
+ * the process holds memory rather than add up to its RSS.
+ *
+ * All of this is process global, and may be updated from any thread.
+ */
+#define REPORT_INTERVAL_SECONDS 60
+
+typedef struct {
+	gint64 bytes;
+	gint64 peak_bytes;
+	gint64 count;
+} MemoryCounter;
+
+typedef struct {
+	const gchar *type_name;
+	TrackerMemorySubsystem subsystem;
+	gint64 count;
+	gint64 peak_count;
+} ObjectCounter;
+
+static const gchar *subsystem_names[] = {
+	"notifier",
+	"queues",
+	"lru",
+	"batches",
+	"extractor",
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (subsystem_names) == TRACKER_MEMORY_N_SUBSYSTEMS);
+
+static GMutex memory_mutex;
+static MemoryCounter counters[TRACKER_MEMORY_N_SUBSYSTEMS];
+static GHashTable *objects = NULL;
+
+static void
+counter_add (TrackerMemorySubsystem subsystem,
+             gint64                 bytes,
+             gint64                 count)
+{
+	MemoryCounter *counter = &counters[subsystem];
+
+	counter->bytes += bytes;
+	counter->count += count;
+	counter->peak_bytes = MAX (counter->peak_bytes, counter->bytes);
+}
+
+/**
+ * tracker_memory_alloc:
+ * @subsystem: subsystem owning the memory
+ * @size: size of the allocation
+ *
+ * Accounts an allocation of @size bytes to @subsystem. Callers
+ * should use TRACKER_MEMORY_ALLOC(), which only calls this if
+ * memory accounting is enabled.
+ **/
+void
+tracker_memory_alloc (TrackerMemorySubsystem subsystem,
+                      gsize                  size)
+{
+	g_return_if_fail (subsystem < TRACKER_MEMORY_N_SUBSYSTEMS);
+
+	g_mutex_lock (&memory_mutex);
+	counter_add (subsystem, size, 1);
+	g_mutex_unlock (&memory_mutex);
+}
+
+void
+tracker_memory_free (TrackerMemorySubsystem subsystem,
+                     gsize                  size)
+{
+	g_return_if_fail (subsystem < TRACKER_MEMORY_N_SUBSYSTEMS);
+
+	g_mutex_lock (&memory_mutex);
+	counter_add (subsystem, - (gint64) size, -1);
+	g_mutex_unlock (&memory_mutex);
+}
+
+static gsize
+get_instance_size (GType type)
+{
+	GTypeQuery query;
+
+	g_type_query (type, &query);
+
+	return query.instance_size;
+}
+
+static ObjectCounter *
+lookup_object_counter (GType                  type,
+                       TrackerMemorySubsystem subsystem)
+{
+	ObjectCounter *counter;
+
+	if (!objects)
+		objects = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+	counter = g_hash_table_lookup (objects, GSIZE_TO_POINTER (type));
+
+	if (!counter) {
+		counter = g_new0 (ObjectCounter, 1);
+		counter->type_name = g_type_name (type);
+		counter->subsystem = subsystem;
+		g_hash_table_insert (objects, GSIZE_TO_POINTER (type), counter);
+	}
+
+	return counter;
+}
+
+static void
+object_finalized_cb (gpointer  data,
+                     GObject  *where_the_object_was)
+{
+	TrackerMemorySubsystem subsystem = GPOINTER_TO_UINT (data);
+	ObjectCounter *counter;
+	GType type;
+
+	/* Weak references are notified on dispose, the
+	 * instance is still there to get its type.
+	 */
+	type = G_OBJECT_TYPE (where_the_object_was);
+
+	g_mutex_lock (&memory_mutex);
+	counter = lookup_object_counter (type, subsystem);
+	counter->count--;
+	counter_add (subsystem, - (gint64) get_instance_size (type), -1);
+	g_mutex_unlock (&memory_mutex);
+}
+
+/**
+ * tracker_memory_track_object:
+ * @subsystem: subsystem owning @object
+ * @object: a #GObject
+ *
+ * Accounts the instance of @object to @subsystem until it is
+ * finalized, and counts the live instances of its type. Callers
+ * should use TRACKER_MEMORY_TRACK_OBJECT().
+ **/
+void
+tracker_memory_track_object (TrackerMemorySubsystem subsystem,
+                             gpointer               object)
+{
+	ObjectCounter *counter;
+	GType type;
+
+	g_return_if_fail (subsystem < TRACKER_MEMORY_N_SUBSYSTEMS);
+	g_return_if_fail (G_IS_OBJECT (object));
+
+	type = G_OBJECT_TYPE (object);
+
+	g_mutex_lock (&memory_mutex);
+	counter = lookup_object_counter (type, subsystem);
+	counter->count++;
+	counter->peak_count = MAX (counter->peak_count, counter->count);
+	counter_add (subsystem, get_instance_size (type), 1);
+	g_mutex_unlock (&memory_mutex);
+
+	g_object_weak_ref (object, object_finalized_cb, GUINT_TO_POINTER (subsystem));
+}
+
+static gint
+compare_object_counters (gconstpointer a,
+                         gconstpointer b)
+{
+	const ObjectCounter *counter_a = *(ObjectCounter **) a;
+	const ObjectCounter *counter_b = *(ObjectCounter **) b;
+
+	if (counter_a->subsystem != counter_b->subsystem)
+		return counter_a->subsystem - counter_b->subsystem;
+
+	return g_strcmp0 (counter_a->type_name, counter_b->type_name);
+}
+
+/**
+ * tracker_memory_to_string:
+ *
+ * Formats the live and peak bytes and allocations of every
+ * subsystem, followed by the instance counts of tracked types.
+ *
+ * Returns: (transfer full): the formatted table
+ **/
+gchar *
+tracker_memory_to_string (void)
+{
+	g_autoptr (GPtrArray) sorted = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	GString *str;
+	guint i;
+
+	str = g_string_new (NULL);
+	sorted = g_ptr_array_new ();
+
+	g_mutex_lock (&memory_mutex);
+
+	g_string_append_printf (str, "%-12s %12s %12s %12s\n",
+	                        "subsystem", "live KiB", "peak KiB", "allocations");
+
+	for (i = 0; i < TRACKER_MEMORY_N_SUBSYSTEMS; i++) {
+		g_string_append_printf (str, "%-12s %12.1f %12.1f %12" G_GINT64_FORMAT "\n",
+		                        subsystem_names[i],
+		                        counters[i].bytes / 1024.0,
+		                        counters[i].peak_bytes / 1024.0,
+		                        counters[i].count);
+	}
+
+	if (objects) {
+		g_hash_table_iter_init (&iter, objects);
+		while (g_hash_table_iter_next (&iter, NULL, &value))
+			g_ptr_array_add (sorted, value);
+		g_ptr_array_sort (sorted, compare_object_counters);
+	}
+
+	if (sorted->len > 0) {
+		g_string_append_printf (str, "\n%-12s %-32s %8s %8s\n",
+		                        "subsystem", "type", "live", "peak");
+	}
+
+	for (i = 0; i < sorted->len; i++) {
+		ObjectCounter *counter = g_ptr_array_index (sorted, i);
+
+		g_string_append_printf (str, "%-12s %-32s %8" G_GINT64_FORMAT " %8" G_GINT64_FORMAT "\n",
+		                        subsystem_names[counter->subsystem],
+		                        counter->type_name,
+		                        counter->count,
+		                        counter->peak_count);
+	}
+
+	g_mutex_unlock (&memory_mutex);
+
+	return g_string_free (str, FALSE);
+}
+
+static gboolean
+report_cb (gpointer user_data)
+{
+	g_autofree gchar *report = NULL;
+
+	report = tracker_memory_to_string ();
+	g_message ("Memory usage by subsystem:\n%s", report);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * tracker_memory_start_reporting:
+ *
+ * If memory accounting is enabled, logs the accounted memory
+ * periodically and whenever the process gets SIGUSR1. This should
+ * be called once from the main thread, with a running main loop.
+ **/
+void
+tracker_memory_start_reporting (void)
+{
+	if (!TRACKER_DEBUG_CHECK (MEMORY))
+		return;
+
+	g_timeout_add_seconds (REPORT_INTERVAL_SECONDS, report_cb, NULL);
+	g_unix_signal_add (SIGUSR1, report_cb, NULL);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_MEMORY_H__
+#define __LIBTRACKER_COMMON_MEMORY_H__
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-miners-common/tracker-common.h> must be included directly."
+#endif
+
+#include <glib-object.h>
+
+#include "tracker-debug.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+	TRACKER_MEMORY_NOTIFIER,
+	TRACKER_MEMORY_QUEUES,
+	TRACKER_MEMORY_LRU,
+	TRACKER_MEMORY_BATCHES,
+	TRACKER_MEMORY_EXTRACTOR,
+	TRACKER_MEMORY_N_SUBSYSTEMS,
+} TrackerMemorySubsystem;
+
+/* Accounting of the structures held by each subsystem, only
+ * done with TRACKER_DEBUG=memory. Every TRACKER_MEMORY_ALLOC()
+ * must be paired with a TRACKER_MEMORY_FREE() of the same size.
+ */
+#ifdef G_ENABLE_DEBUG
+
+#define TRACKER_MEMORY_ALLOC(subsystem,size)        G_STMT_START {  \
+    if (TRACKER_DEBUG_CHECK (MEMORY))                               \
+      tracker_memory_alloc (TRACKER_MEMORY_##subsystem, (size));    \
+                                                    } G_STMT_END
+
+#define TRACKER_MEMORY_FREE(subsystem,size)         G_STMT_START {  \
+    if (TRACKER_DEBUG_CHECK (MEMORY))                               \
+      tracker_memory_free (TRACKER_MEMORY_##subsystem, (size));     \
+                                                    } G_STMT_END
+
+#define TRACKER_MEMORY_TRACK_OBJECT(subsystem,object) G_STMT_START { \
+    if (TRACKER_DEBUG_CHECK (MEMORY))                                \
+      tracker_memory_track_object (TRACKER_MEMORY_##subsystem,       \
+                                   (object));                        \
+                                                    } G_STMT_END
+
+#else /* !G_ENABLE_DEBUG */
+
+#define TRACKER_MEMORY_ALLOC(subsystem,size) G_STMT_START { } G_STMT_END
+#define TRACKER_MEMORY_FREE(subsystem,size) G_STMT_START { } G_STMT_END
+#define TRACKER_MEMORY_TRACK_OBJECT(subsystem,object) G_STMT_START { } G_STMT_END
+
+#endif /* G_ENABLE_DEBUG */
+
+void    tracker_memory_alloc            (TrackerMemorySubsystem  subsystem,
+                                         gsize                   size);
+void    tracker_memory_free             (TrackerMemorySubsystem  subsystem,
+                                         gsize                   size);
+void    tracker_memory_track_object     (TrackerMemorySubsystem  subsystem,
+                                         gpointer                object);
+
+gchar * tracker_memory_to_string        (void);
+void    tracker_memory_start_reporting  (void);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_MEMORY_H__ */
@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-metrics.h"
+
+/* Counters and latency histograms for the hot paths of the indexer.
+ *
+ * Histograms are log-linear: every power of two is split in
+ * N_SUB_BUCKETS linear buckets, so percentiles are accurate within
+ * 25% at any scale with a fixed, small number of buckets. Values are
+ * in microseconds.
+ *
+ * Metrics are global to the process, and live until it exits.
+ * Snapshots of other processes (i.e. the extractor) can be merged
+ * into the ones exported by this process.
+ */
+#define SUB_BUCKET_BITS 2
+#define N_SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define N_BUCKETS ((64 - SUB_BUCKET_BITS + 1) * N_SUB_BUCKETS)
+
+struct _TrackerMetric {
+	gchar *name;
+	guint64 count;
+	guint64 sum;
+	guint64 buckets[N_BUCKETS];
+};
+
+static GMutex metrics_mutex;
+static GHashTable *metrics = NULL;
+static GHashTable *remote_snapshots = NULL;
+
+static guint
+bucket_for_value (guint64 value)
+{
+	guint exp, sub;
+
+	if (value < N_SUB_BUCKETS)
+		return value;
+
+	/* g_bit_storage() takes a gulong */
+	if (value >> 32)
+		exp = 32 + g_bit_storage ((gulong) (value >> 32)) - 1;
+	else
+		exp = g_bit_storage ((gulong) value) - 1;
+
+	sub = (value >> (exp - SUB_BUCKET_BITS)) & (N_SUB_BUCKETS - 1);
+
+	return (exp - SUB_BUCKET_BITS + 1) * N_SUB_BUCKETS + sub;
+}
+
+static guint64
+bucket_upper_bound (guint bucket)
+{
+	guint exp, sub;
+	guint64 lower;
+
+	if (bucket < N_SUB_BUCKETS)
+		return bucket;
+
+	exp = bucket / N_SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+	sub = bucket % N_SUB_BUCKETS;
+	lower = ((guint64) N_SUB_BUCKETS + sub) << (exp - SUB_BUCKET_BITS);
+
+	return lower + (G_GUINT64_CONSTANT (1) << (exp - SUB_BUCKET_BITS)) - 1;
+}
+
+static TrackerMetric *
+metric_new (const gchar *name)
+{
+	TrackerMetric *metric;
+
+	metric = g_new0 (TrackerMetric, 1);
+	metric->name = g_strdup (name);
+
+	return metric;
+}
+
+static void
+metric_free (TrackerMetric *metric)
+{
+	g_free (metric->name);
+	g_free (metric);
+}
+
+static TrackerMetric *
+lookup_unlocked (GHashTable  *table,
+                 const gchar *name)
+{
+	TrackerMetric *metric;
+
+	metric = g_hash_table_lookup (table, name);
+
+	if (!metric) {
+		metric = metric_new (name);
+		g_hash_table_insert (table, metric->name, metric);
+	}
+
+	return metric;
+}
+
+/**
+ * tracker_metrics_lookup:
+ * @name: metric name
+ *
+ * Returns the metric named @name, creating it if needed. The
+ * returned metric stays valid for the lifetime of the process,
+ * so callers in hot paths may keep it around.
+ *
+ * Returns: (transfer none): the metric
+ **/
+TrackerMetric *
+tracker_metrics_lookup (const gchar *name)
+{
+	TrackerMetric *metric;
+
+	g_return_val_if_fail (name != NULL, NULL);
+
+	g_mutex_lock (&metrics_mutex);
+
+	if (!metrics) {
+		metrics = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                 NULL, (GDestroyNotify) metric_free);
+	}
+
+	metric = lookup_unlocked (metrics, name);
+
+	g_mutex_unlock (&metrics_mutex);
+
+	return metric;
+}
+
+/**
+ * tracker_metric_record:
+ * @metric: a #TrackerMetric
+ * @usec: measured latency, in microseconds
+ *
+ * Adds a sample to @metric. This may be called from any thread.
+ **/
+void
+tracker_metric_record (TrackerMetric *metric,
+                       gint64         usec)
+{
+	guint64 value = MAX (usec, 0);
+
+	g_return_if_fail (metric != NULL);
+
+	g_mutex_lock (&metrics_mutex);
+	metric->count++;
+	metric->sum += value;
+	metric->buckets[bucket_for_value (value)]++;
+	g_mutex_unlock (&metrics_mutex);
+}
+
+void
+tracker_metrics_record (const gchar *name,
+                        gint64       usec)
+{
+	tracker_metric_record (tracker_metrics_lookup (name), usec);
+}
+
+static void
+add_metric_to_builder (TrackerMetric   *metric,
+                       GVariantBuilder *builder)
+{
+	GVariantBuilder buckets;
+	guint i;
+
+	g_variant_builder_init (&buckets, G_VARIANT_TYPE ("a(ut)"));
+
+	for (i = 0; i < N_BUCKETS; i++) {
+		if (metric->buckets[i] > 0)
+			g_variant_builder_add (&buckets, "(ut)", i, metric->buckets[i]);
+	}
+
+	g_variant_builder_add (builder, "(stta(ut))",
+	                       metric->name, metric->count, metric->sum,
+	                       &buckets);
+}
+
+static GVariant *
+snapshot_from_table (GHashTable *table)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_variant_builder_init (&builder, TRACKER_METRICS_SNAPSHOT_TYPE);
+
+	if (table) {
+		g_hash_table_iter_init (&iter, table);
+
+		while (g_hash_table_iter_next (&iter, NULL, &value))
+			add_metric_to_builder (value, &builder);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+merge_snapshot (GHashTable *table,
+                GVariant   *snapshot)
+{
+	GVariantIter iter, *buckets;
+	const gchar *name;
+	guint64 count, sum;
+
+	g_variant_iter_init (&iter, snapshot);
+
+	while (g_variant_iter_next (&iter, "(&stta(ut))", &name, &count, &sum, &buckets)) {
+		TrackerMetric *metric;
+		guint64 bucket_count;
+		guint bucket;
+
+		metric = lookup_unlocked (table, name);
+		metric->count += count;
+		metric->sum += sum;
+
+		while (g_variant_iter_next (buckets, "(ut)", &bucket, &bucket_count)) {
+			if (bucket < N_BUCKETS)
+				metric->buckets[bucket] += bucket_count;
+		}
+
+		g_variant_iter_free (buckets);
+	}
+}
+
+/**
+ * tracker_metrics_get_snapshot:
+ *
+ * Returns the current state of all metrics of this process, merged
+ * with the snapshots set through tracker_metrics_set_remote_snapshot().
+ *
+ * Returns: (transfer full): a floating #GVariant of type
+ *   %TRACKER_METRICS_SNAPSHOT_TYPE
+ **/
+GVariant *
+tracker_metrics_get_snapshot (void)
+{
+	g_autoptr (GHashTable) merged = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	GVariant *snapshot;
+
+	g_mutex_lock (&metrics_mutex);
+
+	if (!remote_snapshots || g_hash_table_size (remote_snapshots) == 0) {
+		snapshot = snapshot_from_table (metrics);
+		g_mutex_unlock (&metrics_mutex);
+		return snapshot;
+	}
+
+	merged = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                NULL, (GDestroyNotify) metric_free);
+
+	snapshot = g_variant_ref_sink (snapshot_from_table (metrics));
+	merge_snapshot (merged, snapshot);
+	g_variant_unref (snapshot);
+
+	g_hash_table_iter_init (&iter, remote_snapshots);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		merge_snapshot (merged, value);
+
+	g_mutex_unlock (&metrics_mutex);
+
+	return snapshot_from_table (merged);
+}
+
+/**
+ * tracker_metrics_set_remote_snapshot:
+ * @source: name of the process the snapshot comes from
+ * @snapshot: (nullable): snapshot of type %TRACKER_METRICS_SNAPSHOT_TYPE
+ *
+ * Replaces the last snapshot received from @source, it will be
+ * merged into the result of tracker_metrics_get_snapshot().
+ **/
+void
+tracker_metrics_set_remote_snapshot (const gchar *source,
+                                     GVariant    *snapshot)
+{
+	g_return_if_fail (source != NULL);
+	g_return_if_fail (!snapshot ||
+	                  g_variant_is_of_type (snapshot, TRACKER_METRICS_SNAPSHOT_TYPE));
+
+	g_mutex_lock (&metrics_mutex);
+
+	if (!remote_snapshots) {
+		remote_snapshots = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                          g_free,
+		                                          (GDestroyNotify) g_variant_unref);
+	}
+
+	if (snapshot) {
+		g_hash_table_insert (remote_snapshots, g_strdup (source),
+		                     g_variant_ref_sink (snapshot));
+	} else {
+		g_hash_table_remove (remote_snapshots, source);
+	}
+
+	g_mutex_unlock (&metrics_mutex);
+}
+
+static guint64
+metric_get_percentile (TrackerMetric *metric,
+                       gdouble        percentile)
+{
+	guint64 target, accum = 0;
+	guint i;
+
+	target = MAX ((guint64) (metric->count * percentile + 0.5), 1);
+
+	for (i = 0; i < N_BUCKETS; i++) {
+		accum += metric->buckets[i];
+
+		if (accum >= target)
+			return bucket_upper_bound (i);
+	}
+
+	return 0;
+}
+
+static void
+append_usec (GString *str,
+             guint64  usec)
+{
+	gchar buf[16];
+
+	if (usec < G_TIME_SPAN_MILLISECOND)
+		g_snprintf (buf, sizeof (buf), "%" G_GUINT64_FORMAT "us", usec);
+	else if (usec < G_TIME_SPAN_SECOND)
+		g_snprintf (buf, sizeof (buf), "%.1fms", (gdouble) usec / G_TIME_SPAN_MILLISECOND);
+	else
+		g_snprintf (buf, sizeof (buf), "%.2fs", (gdouble) usec / G_TIME_SPAN_SECOND);
+
+	g_string_append_printf (str, " %9s", buf);
+}
+
+static gint
+compare_metric_names (gconstpointer a,
+                      gconstpointer b)
+{
+	const TrackerMetric *metric_a = *(TrackerMetric **) a;
+	const TrackerMetric *metric_b = *(TrackerMetric **) b;
+
+	return g_strcmp0 (metric_a->name, metric_b->name);
+}
+
+/**
+ * tracker_metrics_snapshot_to_string:
+ * @snapshot: snapshot of type %TRACKER_METRICS_SNAPSHOT_TYPE
+ *
+ * Formats @snapshot as a table of counts and percentiles per
+ * metric, followed by the raw histograms as lines of
+ * "name upper-bound-usec count".
+ *
+ * Returns: (transfer full): the formatted snapshot
+ **/
+gchar *
+tracker_metrics_snapshot_to_string (GVariant *snapshot)
+{
+	g_autoptr (GHashTable) table = NULL;
+	g_autoptr (GPtrArray) sorted = NULL;
+	GString *str;
+	GHashTableIter iter;
+	gpointer value;
+	guint i, j;
+
+	g_return_val_if_fail (g_variant_is_of_type (snapshot, TRACKER_METRICS_SNAPSHOT_TYPE), NULL);
+
+	table = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                               NULL, (GDestroyNotify) metric_free);
+	merge_snapshot (table, snapshot);
+
+	sorted = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (sorted, value);
+	g_ptr_array_sort (sorted, compare_metric_names);
+
+	str = g_string_new (NULL);
+	g_string_append_printf (str, "%-32s %10s %9s %9s %9s %9s %9s\n",
+	                        "stage", "count", "mean", "p50", "p90", "p99", "max");
+
+	for (i = 0; i < sorted->len; i++) {
+		TrackerMetric *metric = g_ptr_array_index (sorted, i);
+
+		if (metric->count == 0)
+			continue;
+
+		g_string_append_printf (str, "%-32s %10" G_GUINT64_FORMAT,
+		                        metric->name, metric->count);
+		append_usec (str, metric->sum / metric->count);
+		append_usec (str, metric_get_percentile (metric, 0.50));
+		append_usec (str, metric_get_percentile (metric, 0.90));
+		append_usec (str, metric_get_percentile (metric, 0.99));
+		append_usec (str, metric_get_percentile (metric, 1.0));
+		g_string_append_c (str, '\n');
+	}
+
+	g_string_append (str, "\n# histograms: stage upper-bound-usec count\n");
+
+	for (i = 0; i < sorted->len; i++) {
+		TrackerMetric *metric = g_ptr_array_index (sorted, i);
+
+		for (j = 0; j < N_BUCKETS; j++) {
+			if (metric->buckets[j] == 0)
+				continue;
+
+			g_string_append_printf (str, "%s %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT "\n",
+			                        metric->name,
+			                        bucket_upper_bound (j),
+			                        metric->buckets[j]);
+		}
+	}
+
+	return g_string_free (str, FALSE);
+}
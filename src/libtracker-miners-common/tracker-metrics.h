@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_METRICS_H__
+#define __LIBTRACKER_COMMON_METRICS_H__
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-miners-common/tracker-common.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Stages measured by the indexer and extractor */
+#define TRACKER_METRIC_CRAWL_ENUMERATE "crawl-enumerate"
+#define TRACKER_METRIC_QUEUE_WAIT      "queue-wait"
+#define TRACKER_METRIC_RESOURCE_BUILD  "resource-build"
+#define TRACKER_METRIC_BATCH_EXECUTE   "batch-execute"
+#define TRACKER_METRIC_EXTRACT_PREFIX  "extract:"
+#define TRACKER_METRIC_COMMIT          "commit"
+
+/* Snapshots are of type a(stta(ut)): name, count, sum of
+ * microseconds, and the non-empty histogram buckets.
+ */
+#define TRACKER_METRICS_SNAPSHOT_TYPE ((const GVariantType *) "a(stta(ut))")
+
+typedef struct _TrackerMetric TrackerMetric;
+
+TrackerMetric * tracker_metrics_lookup               (const gchar   *name);
+void            tracker_metric_record                (TrackerMetric *metric,
+                                                      gint64         usec);
+void            tracker_metrics_record               (const gchar   *name,
+                                                      gint64         usec);
+
+GVariant *      tracker_metrics_get_snapshot         (void);
+void            tracker_metrics_set_remote_snapshot  (const gchar   *source,
+                                                      GVariant      *snapshot);
+
+gchar *         tracker_metrics_snapshot_to_string   (GVariant      *snapshot);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_METRICS_H__ */
@@ -42,6 +42,7 @@
 #include <libtracker-miners-common/tracker-dbus.h>
 #include <libtracker-miners-common/tracker-type-utils.h>
 #include <libtracker-miners-common/tracker-domain-ontology.h>
+#include <libtracker-miners-common/tracker-metrics.h>
 
 #include "tracker-miner-proxy.h"
 
@@ -89,6 +90,14 @@ static const gchar introspection_xml[] =
   "    <method name='GetRemainingTime'>"
   "      <arg type='i' name='remaining_time' direction='out' />"
   "    </method>"
+  "    <method name='GetStatusDetails'>"
+  "      <arg type='s' name='status' direction='out' />"
+  "      <arg type='d' name='progress' direction='out' />"
+  "      <arg type='i' name='remaining_time' direction='out' />"
+  "    </method>"
+  "    <method name='GetMetrics'>"
+  "      <arg type='a(stta(ut))' name='metrics' direction='out' />"
+  "    </method>"
   "    <method name='GetPauseDetails'>"
   "      <arg type='as' name='pause_applications' direction='out' />"
   "      <arg type='as' name='pause_reasons' direction='out' />"
@@ -295,9 +304,10 @@ handle_method_call_start (TrackerMinerProxy     *proxy,
 
 	priv = tracker_miner_proxy_get_instance_private (proxy);
 
-	request = tracker_g_dbus_request_begin (invocation,
-	                                        "%s",
-	                                        __PRETTY_FUNCTION__);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s",
+	                                             __PRETTY_FUNCTION__);
 
 	tracker_miner_start (priv->miner);
 
@@ -336,10 +346,11 @@ handle_method_call_resume (TrackerMinerProxy     *proxy,
 
 	g_variant_get (parameters, "(i)", &cookie);
 
-	request = tracker_g_dbus_request_begin (invocation,
-	                                        "%s(cookie:%d)",
-	                                        __PRETTY_FUNCTION__,
-	                                        cookie);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s(cookie:%d)",
+	                                             __PRETTY_FUNCTION__,
+	                                             cookie);
 
 	if (!g_hash_table_remove (priv->pauses, GINT_TO_POINTER (cookie))) {
 		tracker_dbus_request_end (request, NULL);
@@ -445,11 +456,12 @@ handle_method_call_pause (TrackerMinerProxy     *proxy,
 	tracker_gdbus_async_return_if_fail (application != NULL, invocation);
 	tracker_gdbus_async_return_if_fail (reason != NULL, invocation);
 
-	request = tracker_g_dbus_request_begin (invocation,
-	                                        "%s(application:'%s', reason:'%s')",
-	                                        __PRETTY_FUNCTION__,
-	                                        application,
-	                                        reason);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s(application:'%s', reason:'%s')",
+	                                             __PRETTY_FUNCTION__,
+	                                             application,
+	                                             reason);
 
 	cookie = pause_miner (proxy, application, reason, NULL, &local_error);
 	if (cookie == -1) {
@@ -482,11 +494,12 @@ handle_method_call_pause_for_process (TrackerMinerProxy     *proxy,
 	tracker_gdbus_async_return_if_fail (application != NULL, invocation);
 	tracker_gdbus_async_return_if_fail (reason != NULL, invocation);
 
-	request = tracker_g_dbus_request_begin (invocation,
-	                                        "%s(application:'%s', reason:'%s')",
-	                                        __PRETTY_FUNCTION__,
-	                                        application,
-	                                        reason);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s(application:'%s', reason:'%s')",
+	                                             __PRETTY_FUNCTION__,
+	                                             application,
+	                                             reason);
 
 	cookie = pause_miner (proxy,
 	                      application,
@@ -521,7 +534,9 @@ handle_method_call_get_pause_details (TrackerMinerProxy     *proxy,
 	TrackerMinerProxyPrivate *priv;
 
 	priv = tracker_miner_proxy_get_instance_private (proxy);
-	request = tracker_g_dbus_request_begin (invocation, "%s()", __PRETTY_FUNCTION__);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
 
 	applications = NULL;
 	reasons = NULL;
@@ -560,7 +575,9 @@ handle_method_call_get_remaining_time (TrackerMinerProxy     *proxy,
 
 	priv = tracker_miner_proxy_get_instance_private (proxy);
 
-	request = tracker_g_dbus_request_begin (invocation, "%s()", __PRETTY_FUNCTION__);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
 
 	tracker_dbus_request_end (request, NULL);
 	g_object_get (G_OBJECT (priv->miner), "remaining-time", &remaining_time, NULL);
@@ -579,7 +596,9 @@ handle_method_call_get_progress (TrackerMinerProxy     *proxy,
 
 	priv = tracker_miner_proxy_get_instance_private (proxy);
 
-	request = tracker_g_dbus_request_begin (invocation, "%s()", __PRETTY_FUNCTION__);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
 
 	tracker_dbus_request_end (request, NULL);
 	g_object_get (G_OBJECT (priv->miner), "progress", &progress, NULL);
@@ -598,7 +617,9 @@ handle_method_call_get_status (TrackerMinerProxy     *proxy,
 
 	priv = tracker_miner_proxy_get_instance_private (proxy);
 
-	request = tracker_g_dbus_request_begin (invocation, "%s()", __PRETTY_FUNCTION__);
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
 
 	tracker_dbus_request_end (request, NULL);
 	g_object_get (G_OBJECT (priv->miner), "status", &status, NULL);
@@ -608,6 +629,54 @@ handle_method_call_get_status (TrackerMinerProxy     *proxy,
 	g_free (status);
 }
 
+static void
+handle_method_call_get_status_details (TrackerMinerProxy     *proxy,
+                                       GDBusMethodInvocation *invocation,
+                                       GVariant              *parameters)
+{
+	TrackerDBusRequest *request;
+	TrackerMinerProxyPrivate *priv;
+	gchar *status;
+	gdouble progress;
+	gint remaining_time;
+
+	priv = tracker_miner_proxy_get_instance_private (proxy);
+
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
+
+	tracker_dbus_request_end (request, NULL);
+	g_object_get (G_OBJECT (priv->miner),
+	              "status", &status,
+	              "progress", &progress,
+	              "remaining-time", &remaining_time,
+	              NULL);
+	g_dbus_method_invocation_return_value (invocation,
+	                                       g_variant_new ("(sdi)",
+	                                                      status ? status : "",
+	                                                      progress,
+	                                                      remaining_time));
+	g_free (status);
+}
+
+static void
+handle_method_call_get_metrics (TrackerMinerProxy     *proxy,
+                                GDBusMethodInvocation *invocation,
+                                GVariant              *parameters)
+{
+	TrackerDBusRequest *request;
+
+	request = tracker_g_dbus_request_begin_full (invocation,
+	                                             TRACKER_DBUS_REQUEST_FLAGS_NO_CLIENT_LOOKUP,
+	                                             "%s()", __PRETTY_FUNCTION__);
+
+	tracker_dbus_request_end (request, NULL);
+	g_dbus_method_invocation_return_value (invocation,
+	                                       g_variant_new ("(@a(stta(ut)))",
+	                                                      tracker_metrics_get_snapshot ()));
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -636,6 +705,10 @@ handle_method_call (GDBusConnection       *connection,
 		handle_method_call_get_progress (proxy, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "GetStatus") == 0) {
 		handle_method_call_get_status (proxy, invocation, parameters);
+	} else if (g_strcmp0 (method_name, "GetStatusDetails") == 0) {
+		handle_method_call_get_status_details (proxy, invocation, parameters);
+	} else if (g_strcmp0 (method_name, "GetMetrics") == 0) {
+		handle_method_call_get_metrics (proxy, invocation, parameters);
 	} else {
 		g_dbus_method_invocation_return_error (invocation,
 		                                       G_DBUS_ERROR,
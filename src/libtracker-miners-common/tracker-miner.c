@@ -38,6 +38,14 @@
  */
 #define PROGRESS_ROUNDED(x) ((x) < 0.01 ? 0.00 : (ceil (((x) * 100) - 0.49) / 100))
 
+/* Progress changes are coalesced, and notified at exponentially
+ * growing intervals while the miner keeps busy, so clients listening
+ * to ::progress (e.g. through D-Bus) are not woken up all the time.
+ * Status changes are notified right away.
+ */
+#define PROGRESS_MIN_INTERVAL_MS 250
+#define PROGRESS_MAX_INTERVAL_MS 16000
+
 #ifdef G_ENABLE_DEBUG
 #define trace(message, ...) TRACKER_NOTE (STATUS, g_message (message, ##__VA_ARGS__))
 #else
@@ -63,6 +71,8 @@ struct _TrackerMinerPrivate {
 	gdouble progress;
 	gint remaining_time;
 	guint update_id;
+	guint update_interval;
+	gint64 last_update_time;
 };
 
 enum {
@@ -288,10 +298,45 @@ miner_update_progress_cb (gpointer data)
 	               miner->priv->remaining_time);
 
 	miner->priv->update_id = 0;
+	miner->priv->last_update_time = g_get_monotonic_time ();
 
 	return FALSE;
 }
 
+static void
+miner_schedule_progress (TrackerMiner *miner,
+                         gboolean      status_changed)
+{
+	TrackerMinerPrivate *priv = miner->priv;
+
+	if (status_changed) {
+		g_clear_handle_id (&priv->update_id, g_source_remove);
+		priv->update_interval = PROGRESS_MIN_INTERVAL_MS;
+		priv->update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+		                                   miner_update_progress_cb,
+		                                   miner,
+		                                   NULL);
+		return;
+	}
+
+	if (priv->update_id != 0)
+		return;
+
+	/* Start over after a quiet period */
+	if (priv->update_interval == 0 ||
+	    g_get_monotonic_time () - priv->last_update_time >
+	    (gint64) PROGRESS_MAX_INTERVAL_MS * 2 * 1000)
+		priv->update_interval = PROGRESS_MIN_INTERVAL_MS;
+
+	priv->update_id = g_timeout_add_full (G_PRIORITY_HIGH_IDLE,
+	                                      priv->update_interval,
+	                                      miner_update_progress_cb,
+	                                      miner,
+	                                      NULL);
+	priv->update_interval = MIN (priv->update_interval * 2,
+	                             PROGRESS_MAX_INTERVAL_MS);
+}
+
 static void
 miner_set_property (GObject      *object,
                     guint         prop_id,
@@ -343,16 +388,11 @@ miner_set_property (GObject      *object,
 			}
 		}
 
-		if (miner->priv->update_id == 0) {
-			miner->priv->update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
-			                                          miner_update_progress_cb,
-			                                          miner,
-			                                          NULL);
-		}
-
+		miner_schedule_progress (miner, TRUE);
 		break;
 	}
 	case PROP_PROGRESS: {
+		gboolean status_changed = FALSE;
 		gdouble new_progress;
 
 		new_progress = PROGRESS_ROUNDED (g_value_get_double (value));
@@ -382,6 +422,7 @@ miner_set_property (GObject      *object,
 				       G_OBJECT_TYPE_NAME (miner));
 				g_free (miner->priv->status);
 				miner->priv->status = g_strdup ("Initializing");
+				status_changed = TRUE;
 			}
 		} else if (new_progress == 1.0) {
 			if (miner->priv->status == NULL ||
@@ -390,16 +431,11 @@ miner_set_property (GObject      *object,
 				       G_OBJECT_TYPE_NAME (miner));
 				g_free (miner->priv->status);
 				miner->priv->status = g_strdup ("Idle");
+				status_changed = TRUE;
 			}
 		}
 
-		if (miner->priv->update_id == 0) {
-			miner->priv->update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
-			                                          miner_update_progress_cb,
-			                                          miner,
-			                                          NULL);
-		}
-
+		miner_schedule_progress (miner, status_changed);
 		break;
 	}
 	case PROP_REMAINING_TIME: {
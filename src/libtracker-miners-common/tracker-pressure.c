@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tracker-pressure.h"
+
+/* Linux pressure stall information, see
+ * https://docs.kernel.org/accounting/psi.html
+ */
+#define PSI_DIR "/proc/pressure/"
+
+#define SAMPLE_INTERVAL_MS 100
+
+/* Share of stalled time considered full pressure */
+#define PRESSURE_SATURATION 0.2
+
+/* Weight of each new sample as pressure goes down, so the pressure
+ * rises as soon as there is contention, but settles slowly after it.
+ */
+#define PRESSURE_DECAY 0.1
+
+static const gchar *resources[] = { "cpu", "io", "memory" };
+
+#define N_RESOURCES G_N_ELEMENTS (resources)
+
+struct _TrackerPressure
+{
+	GObject parent_instance;
+	int fds[N_RESOURCES];
+	guint64 totals[N_RESOURCES];
+	gint64 last_sample;
+	gdouble pressure;
+	guint sample_id;
+};
+
+enum {
+	PROP_0,
+	PROP_PRESSURE,
+	N_PROPS,
+};
+
+static GParamSpec *props[N_PROPS] = { 0, };
+
+G_DEFINE_TYPE (TrackerPressure, tracker_pressure, G_TYPE_OBJECT)
+
+/* Returns the total stall time in microseconds from the "some" line */
+static gboolean
+read_stall_total (int      fd,
+                  guint64 *total)
+{
+	gchar buf[256];
+	const gchar *str;
+	gssize len;
+
+	len = pread (fd, buf, sizeof (buf) - 1, 0);
+	if (len <= 0)
+		return FALSE;
+
+	buf[len] = '\0';
+
+	if (!g_str_has_prefix (buf, "some "))
+		return FALSE;
+
+	str = strstr (buf, "total=");
+	if (!str)
+		return FALSE;
+
+	*total = g_ascii_strtoull (str + strlen ("total="), NULL, 10);
+	return TRUE;
+}
+
+static gboolean
+sample_cb (gpointer user_data)
+{
+	TrackerPressure *pressure = user_data;
+	gdouble stalled = 0, value;
+	gint64 now, elapsed;
+	guint i;
+
+	now = g_get_monotonic_time ();
+	elapsed = now - pressure->last_sample;
+	pressure->last_sample = now;
+
+	for (i = 0; i < N_RESOURCES; i++) {
+		guint64 total;
+
+		if (pressure->fds[i] < 0 ||
+		    !read_stall_total (pressure->fds[i], &total))
+			continue;
+
+		if (elapsed > 0 && total > pressure->totals[i]) {
+			stalled = MAX (stalled,
+			               (gdouble) (total - pressure->totals[i]) / elapsed);
+		}
+
+		pressure->totals[i] = total;
+	}
+
+	value = CLAMP (stalled / PRESSURE_SATURATION, 0, 1);
+
+	if (value < pressure->pressure)
+		value = pressure->pressure + (value - pressure->pressure) * PRESSURE_DECAY;
+
+	/* Avoid notifying for insignificant changes */
+	value = floor (value * 100) / 100;
+
+	if (value != pressure->pressure) {
+		pressure->pressure = value;
+		g_object_notify_by_pspec (G_OBJECT (pressure), props[PROP_PRESSURE]);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+tracker_pressure_init (TrackerPressure *pressure)
+{
+	guint i;
+
+	for (i = 0; i < N_RESOURCES; i++)
+		pressure->fds[i] = -1;
+}
+
+static void
+tracker_pressure_constructed (GObject *object)
+{
+	TrackerPressure *pressure = TRACKER_PRESSURE (object);
+	guint i;
+
+	G_OBJECT_CLASS (tracker_pressure_parent_class)->constructed (object);
+
+	for (i = 0; i < N_RESOURCES; i++) {
+		g_autofree gchar *path = NULL;
+		int fd;
+
+		path = g_strconcat (PSI_DIR, resources[i], NULL);
+		fd = open (path, O_RDONLY | O_CLOEXEC);
+
+		if (fd >= 0 && read_stall_total (fd, &pressure->totals[i]))
+			pressure->fds[i] = fd;
+		else if (fd >= 0)
+			close (fd);
+	}
+
+	pressure->last_sample = g_get_monotonic_time ();
+	pressure->sample_id = g_timeout_add (SAMPLE_INTERVAL_MS, sample_cb, pressure);
+}
+
+static void
+tracker_pressure_finalize (GObject *object)
+{
+	TrackerPressure *pressure = TRACKER_PRESSURE (object);
+	guint i;
+
+	g_clear_handle_id (&pressure->sample_id, g_source_remove);
+
+	for (i = 0; i < N_RESOURCES; i++) {
+		if (pressure->fds[i] >= 0)
+			close (pressure->fds[i]);
+	}
+
+	G_OBJECT_CLASS (tracker_pressure_parent_class)->finalize (object);
+}
+
+static void
+tracker_pressure_get_property (GObject    *object,
+                               guint       prop_id,
+                               GValue     *value,
+                               GParamSpec *pspec)
+{
+	TrackerPressure *pressure = TRACKER_PRESSURE (object);
+
+	switch (prop_id) {
+	case PROP_PRESSURE:
+		g_value_set_double (value, pressure->pressure);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+tracker_pressure_class_init (TrackerPressureClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->constructed = tracker_pressure_constructed;
+	object_class->finalize = tracker_pressure_finalize;
+	object_class->get_property = tracker_pressure_get_property;
+
+	props[PROP_PRESSURE] =
+		g_param_spec_double ("pressure",
+		                     NULL, NULL,
+		                     0, 1, 0,
+		                     G_PARAM_READABLE |
+		                     G_PARAM_EXPLICIT_NOTIFY |
+		                     G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, props);
+}
+
+static gboolean
+tracker_pressure_is_available (TrackerPressure *pressure)
+{
+	guint i;
+
+	for (i = 0; i < N_RESOURCES; i++) {
+		if (pressure->fds[i] >= 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * tracker_pressure_new:
+ *
+ * Creates an object that follows the resource pressure of the system,
+ * as a value between 0 (idle) and 1 (contended).
+ *
+ * Returns: (nullable): a new #TrackerPressure, or %NULL if the kernel
+ *   does not report pressure stall information.
+ **/
+TrackerPressure *
+tracker_pressure_new (void)
+{
+	TrackerPressure *pressure;
+
+	pressure = g_object_new (TRACKER_TYPE_PRESSURE, NULL);
+
+	if (!tracker_pressure_is_available (pressure)) {
+		g_debug ("No pressure stall information available");
+		g_object_unref (pressure);
+		return NULL;
+	}
+
+	return pressure;
+}
+
+gdouble
+tracker_pressure_get_pressure (TrackerPressure *pressure)
+{
+	g_return_val_if_fail (TRACKER_IS_PRESSURE (pressure), 0);
+
+	return pressure->pressure;
+}
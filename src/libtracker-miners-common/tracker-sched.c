@@ -22,7 +22,11 @@
 
 #ifdef __linux__
 
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "tracker-sched.h"
 
@@ -59,6 +63,183 @@ tracker_sched_idle (void)
 	}
 }
 
+/* Parses CPU lists in the format used by sysfs, e.g. "0-3,8" */
+static gboolean
+parse_cpu_list (const gchar *str,
+                cpu_set_t   *set)
+{
+	g_auto (GStrv) ranges = NULL;
+	guint i;
+
+	CPU_ZERO (set);
+	ranges = g_strsplit (str, ",", -1);
+
+	for (i = 0; ranges[i]; i++) {
+		guint64 first, last, cpu;
+		gchar *end;
+
+		g_strstrip (ranges[i]);
+		if (ranges[i][0] == '\0')
+			continue;
+
+		if (!g_ascii_isdigit (ranges[i][0]))
+			return FALSE;
+
+		first = last = g_ascii_strtoull (ranges[i], &end, 10);
+
+		if (*end == '-') {
+			if (!g_ascii_isdigit (end[1]))
+				return FALSE;
+			last = g_ascii_strtoull (&end[1], &end, 10);
+		}
+
+		if (*end != '\0' || last < first || last >= CPU_SETSIZE)
+			return FALSE;
+
+		for (cpu = first; cpu <= last; cpu++)
+			CPU_SET (cpu, set);
+	}
+
+	return CPU_COUNT (set) > 0;
+}
+
+/* Finds the efficiency cores of hybrid CPUs. These are listed by the
+ * cpu_atom PMU on Intel, and have a capacity lower than the biggest
+ * cores on ARM.
+ */
+static gboolean
+get_efficiency_cpus (cpu_set_t *set)
+{
+	g_autofree gchar *contents = NULL;
+	gulong capacities[CPU_SETSIZE] = { 0, };
+	gulong max_capacity = 0;
+	gint cpu, n_cpus = 0;
+
+	if (g_file_get_contents ("/sys/devices/cpu_atom/cpus", &contents, NULL, NULL) &&
+	    parse_cpu_list (contents, set))
+		return TRUE;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		g_autofree gchar *dir = NULL, *path = NULL;
+
+		dir = g_strdup_printf ("/sys/devices/system/cpu/cpu%d", cpu);
+		if (!g_file_test (dir, G_FILE_TEST_IS_DIR))
+			break;
+
+		g_clear_pointer (&contents, g_free);
+		path = g_build_filename (dir, "cpu_capacity", NULL);
+
+		if (!g_file_get_contents (path, &contents, NULL, NULL))
+			continue;
+
+		capacities[cpu] = strtoul (contents, NULL, 10);
+		max_capacity = MAX (max_capacity, capacities[cpu]);
+		n_cpus = cpu + 1;
+	}
+
+	CPU_ZERO (set);
+
+	for (cpu = 0; cpu < n_cpus; cpu++) {
+		if (capacities[cpu] > 0 && capacities[cpu] < max_capacity)
+			CPU_SET (cpu, set);
+	}
+
+	return CPU_COUNT (set) > 0;
+}
+
+static const cpu_set_t *
+get_initial_cpus (void)
+{
+	static cpu_set_t initial;
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		if (sched_getaffinity (0, sizeof (initial), &initial) != 0) {
+			gint cpu;
+
+			CPU_ZERO (&initial);
+			for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				CPU_SET (cpu, &initial);
+		}
+
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return &initial;
+}
+
+/**
+ * tracker_sched_set_affinity:
+ * @cpus: (nullable): list of CPUs such as "0-3,8", or %NULL
+ *
+ * Restricts every thread of the process to @cpus, threads created
+ * afterwards inherit the affinity of the thread creating them. If
+ * @cpus is %NULL or empty, the efficiency cores of hybrid CPUs are
+ * used when these can be told apart, or all the CPUs the process
+ * started with otherwise.
+ *
+ * Returns: %FALSE if @cpus could not be parsed, or none of them can
+ *   be used.
+ */
+gboolean
+tracker_sched_set_affinity (const gchar *cpus)
+{
+	const cpu_set_t *initial;
+	cpu_set_t set;
+	GDir *dir;
+	const gchar *name;
+
+	initial = get_initial_cpus ();
+
+	if (cpus && *cpus) {
+		if (!parse_cpu_list (cpus, &set)) {
+			g_message ("Invalid CPU list '%s'", cpus);
+			return FALSE;
+		}
+
+		CPU_AND (&set, &set, initial);
+
+		if (CPU_COUNT (&set) == 0) {
+			g_message ("None of the CPUs in '%s' are available", cpus);
+			return FALSE;
+		}
+	} else {
+		cpu_set_t efficiency;
+
+		memcpy (&set, initial, sizeof (set));
+
+		if (get_efficiency_cpus (&efficiency)) {
+			CPU_AND (&efficiency, &efficiency, initial);
+			if (CPU_COUNT (&efficiency) > 0)
+				memcpy (&set, &efficiency, sizeof (set));
+		}
+	}
+
+	/* Update the calling thread first, so threads it spawns from now
+	 * on get the new affinity.
+	 */
+	if (sched_setaffinity (0, sizeof (set), &set) != 0) {
+		g_message ("Error setting CPU affinity: %s", g_strerror (errno));
+		return FALSE;
+	}
+
+	dir = g_dir_open ("/proc/self/task", 0, NULL);
+
+	while (dir && (name = g_dir_read_name (dir)) != NULL) {
+		pid_t tid = atoi (name);
+
+		/* Threads may be gone already */
+		if (tid > 0)
+			sched_setaffinity (tid, sizeof (set), &set);
+	}
+
+	g_clear_pointer (&dir, g_dir_close);
+
+	TRACKER_NOTE (CONFIG, g_message ("Set CPU affinity to %d CPUs", CPU_COUNT (&set)));
+
+	return TRUE;
+}
+
 #else /* __linux__ */
 
 /* Although pthread_setschedparam() should exist on any POSIX compliant OS,
@@ -80,4 +261,10 @@ tracker_sched_idle (void)
 	return TRUE;
 }
 
+gboolean
+tracker_sched_set_affinity (const gchar *cpus)
+{
+	return TRUE;
+}
+
 #endif /* __linux__ */
@@ -28,7 +28,8 @@ G_BEGIN_DECLS
 #error "only <libtracker-miners-common/tracker-common.h> must be included directly."
 #endif
 
-gboolean tracker_sched_idle (void);
+gboolean tracker_sched_idle         (void);
+gboolean tracker_sched_set_affinity (const gchar *cpus);
 
 G_END_DECLS
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "tracker-status-page.h"
+
+/* A small file in the cache directory where the indexer keeps its
+ * counters up to date through a shared mapping, so status can be
+ * polled without talking to the indexer nor querying the database.
+ *
+ * Writers bump the sequence number before and after each update,
+ * readers retry while it is odd or changed during the copy.
+ */
+#define STATUS_PAGE_FILENAME "status"
+#define STATUS_PAGE_MAGIC 0x54525354 /* "TRST" */
+#define STATUS_PAGE_VERSION 1
+#define STATUS_PAGE_READ_RETRIES 100
+
+typedef struct {
+	guint32 magic;
+	guint32 version;
+	guint32 pid;
+	gint seq;
+	TrackerStatusPageData sections[TRACKER_STATUS_PAGE_N_SECTIONS];
+} StatusPageLayout;
+
+struct _TrackerStatusPage
+{
+	StatusPageLayout *layout;
+	int fd;
+};
+
+static gchar *
+get_status_page_path (GFile *cache_dir)
+{
+	g_autoptr (GFile) file = NULL;
+
+	file = g_file_get_child (cache_dir, STATUS_PAGE_FILENAME);
+	return g_file_get_path (file);
+}
+
+static void
+status_page_begin_write (StatusPageLayout *layout)
+{
+	g_atomic_int_inc (&layout->seq);
+}
+
+static void
+status_page_end_write (StatusPageLayout *layout)
+{
+	g_atomic_int_inc (&layout->seq);
+}
+
+TrackerStatusPage *
+tracker_status_page_new (GFile   *cache_dir,
+                         GError **error)
+{
+	TrackerStatusPage *page;
+	g_autofree gchar *path = NULL;
+	StatusPageLayout *layout;
+	int fd;
+
+	g_return_val_if_fail (G_IS_FILE (cache_dir), NULL);
+
+	path = get_status_page_path (cache_dir);
+
+	fd = g_open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0 || ftruncate (fd, sizeof (StatusPageLayout)) < 0) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		             "Could not create status page at %s: %s",
+		             path, g_strerror (errsv));
+		if (fd >= 0)
+			close (fd);
+		return NULL;
+	}
+
+	layout = mmap (NULL, sizeof (StatusPageLayout),
+	               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (layout == MAP_FAILED) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		             "Could not map status page at %s: %s",
+		             path, g_strerror (errsv));
+		close (fd);
+		return NULL;
+	}
+
+	/* Leave an even sequence number behind a previous writer
+	 * that died during an update.
+	 */
+	layout->seq &= ~1;
+
+	status_page_begin_write (layout);
+	memset (layout->sections, 0, sizeof (layout->sections));
+	layout->magic = STATUS_PAGE_MAGIC;
+	layout->version = STATUS_PAGE_VERSION;
+	layout->pid = getpid ();
+	status_page_end_write (layout);
+
+	page = g_new0 (TrackerStatusPage, 1);
+	page->layout = layout;
+	page->fd = fd;
+
+	return page;
+}
+
+void
+tracker_status_page_free (TrackerStatusPage *page)
+{
+	status_page_begin_write (page->layout);
+	page->layout->pid = 0;
+	status_page_end_write (page->layout);
+
+	munmap (page->layout, sizeof (StatusPageLayout));
+	close (page->fd);
+	g_free (page);
+}
+
+void
+tracker_status_page_update (TrackerStatusPage           *page,
+                            TrackerStatusPageSection     section,
+                            const TrackerStatusPageData *data)
+{
+	g_return_if_fail (page != NULL);
+	g_return_if_fail (section < TRACKER_STATUS_PAGE_N_SECTIONS);
+
+	status_page_begin_write (page->layout);
+	page->layout->sections[section] = *data;
+	page->layout->sections[section].status[sizeof (data->status) - 1] = '\0';
+	page->layout->sections[section].update_time = g_get_real_time ();
+	status_page_end_write (page->layout);
+}
+
+static gboolean
+pid_is_running (guint32 pid)
+{
+	return pid != 0 && (kill (pid, 0) == 0 || errno == EPERM);
+}
+
+gboolean
+tracker_status_page_read (GFile                  *cache_dir,
+                          TrackerStatusPageData   data[TRACKER_STATUS_PAGE_N_SECTIONS],
+                          GError                **error)
+{
+	g_autofree gchar *path = NULL;
+	StatusPageLayout *layout, copy;
+	struct stat st;
+	int fd, i;
+
+	g_return_val_if_fail (G_IS_FILE (cache_dir), FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	path = get_status_page_path (cache_dir);
+
+	fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		             "Could not open status page at %s: %s",
+		             path, g_strerror (errsv));
+		return FALSE;
+	}
+
+	if (fstat (fd, &st) < 0 || st.st_size < (goffset) sizeof (StatusPageLayout)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Status page at %s is truncated", path);
+		close (fd);
+		return FALSE;
+	}
+
+	layout = mmap (NULL, sizeof (StatusPageLayout), PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+
+	if (layout == MAP_FAILED) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		             "Could not map status page at %s: %s",
+		             path, g_strerror (errsv));
+		return FALSE;
+	}
+
+	for (i = 0; i < STATUS_PAGE_READ_RETRIES; i++) {
+		gint seq;
+
+		seq = g_atomic_int_get (&layout->seq);
+		if (seq & 1) {
+			g_usleep (100);
+			continue;
+		}
+
+		memcpy (&copy, layout, sizeof (StatusPageLayout));
+
+		if (g_atomic_int_get (&layout->seq) == seq)
+			break;
+	}
+
+	munmap (layout, sizeof (StatusPageLayout));
+
+	if (i == STATUS_PAGE_READ_RETRIES) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_BUSY,
+		             "Status page at %s is busy", path);
+		return FALSE;
+	}
+
+	if (copy.magic != STATUS_PAGE_MAGIC ||
+	    copy.version != STATUS_PAGE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Status page at %s has an unknown format", path);
+		return FALSE;
+	}
+
+	if (!pid_is_running (copy.pid)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+		             "The indexer is not running");
+		return FALSE;
+	}
+
+	memcpy (data, copy.sections, sizeof (copy.sections));
+
+	return TRUE;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_STATUS_PAGE_H__
+#define __LIBTRACKER_COMMON_STATUS_PAGE_H__
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-miners-common/tracker-common.h> must be included directly."
+#endif
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	TRACKER_STATUS_PAGE_SECTION_FILES,
+	TRACKER_STATUS_PAGE_SECTION_EXTRACTOR,
+	TRACKER_STATUS_PAGE_N_SECTIONS,
+} TrackerStatusPageSection;
+
+typedef struct {
+	gchar status[64];
+	gdouble progress;
+	gint32 remaining_time;
+	guint32 queued;
+	guint64 processed;
+	guint64 errors;
+	/* Items per second */
+	gdouble rate;
+	/* Wall clock time, in microseconds */
+	gint64 update_time;
+} TrackerStatusPageData;
+
+typedef struct _TrackerStatusPage TrackerStatusPage;
+
+TrackerStatusPage * tracker_status_page_new    (GFile                         *cache_dir,
+                                                GError                       **error);
+void                tracker_status_page_free   (TrackerStatusPage             *page);
+
+void                tracker_status_page_update (TrackerStatusPage             *page,
+                                                TrackerStatusPageSection       section,
+                                                const TrackerStatusPageData   *data);
+
+gboolean            tracker_status_page_read   (GFile                         *cache_dir,
+                                                TrackerStatusPageData          data[TRACKER_STATUS_PAGE_N_SECTIONS],
+                                                GError                       **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrackerStatusPage, tracker_status_page_free)
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_STATUS_PAGE_H__ */
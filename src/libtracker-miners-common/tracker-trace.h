@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_TRACE_H__
+#define __LIBTRACKER_COMMON_TRACE_H__
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-miners-common/tracker-common.h> must be included directly."
+#endif
+
+#include <glib.h>
+
+/* Static trace points, in the "localsearch" USDT provider. These
+ * are a single nop in the code when no tracer is attached, probes
+ * whose arguments are costly to compute should be guarded with
+ * TRACKER_TRACE_ENABLED(), which checks the probe semaphore.
+ *
+ * Every probe needs a TRACKER_TRACE_DEFINE() at file scope in the
+ * file it is used in, e.g.:
+ *
+ *   TRACKER_TRACE_DEFINE (queue_event);
+ *   ...
+ *   if (TRACKER_TRACE_ENABLED (queue_event))
+ *           TRACKER_TRACE (queue_event, g_file_peek_path (file), type);
+ */
+#ifdef HAVE_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define TRACKER_TRACE_DEFINE(name) \
+	static unsigned short localsearch_##name##_semaphore \
+		__attribute__ ((used, section (".probes")))
+
+#define TRACKER_TRACE_ENABLED(name) G_UNLIKELY (localsearch_##name##_semaphore)
+
+#define TRACKER_TRACE(name, ...) STAP_PROBEV (localsearch, name, __VA_ARGS__)
+
+#else /* !HAVE_USDT */
+
+#define TRACKER_TRACE_DEFINE(name) G_STATIC_ASSERT (TRUE)
+#define TRACKER_TRACE_ENABLED(name) FALSE
+#define TRACKER_TRACE(name, ...) G_STMT_START { } G_STMT_END
+
+#endif /* HAVE_USDT */
+
+#endif /* __LIBTRACKER_COMMON_TRACE_H__ */
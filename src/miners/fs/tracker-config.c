@@ -48,6 +48,18 @@
 #define DEFAULT_LOW_DISK_SPACE_LIMIT             1        /* 0->100 / -1 */
 #define DEFAULT_CRAWLING_INTERVAL                -1       /* 0->365 / -1 / -2 */
 #define DEFAULT_REMOVABLE_DAYS_THRESHOLD         3        /* 1->365 / 0  */
+#define DEFAULT_IDENTIFIER_CACHE_SIZE            1000     /* 100->100000 */
+#define DEFAULT_MAX_CRAWLED_ROOTS                4        /* 1->16 */
+#define DEFAULT_MAX_CRAWLED_DIRECTORIES          1        /* 1->16 */
+#define DEFAULT_MAX_MONITORS                     0        /* 0->1048576 */
+#define DEFAULT_MIN_UPDATE_DELAY                 1000     /* 0->60000 */
+#define DEFAULT_MAX_UPDATE_DELAY                 60000    /* 0->3600000 */
+#define DEFAULT_SNIFF_CONTENT_TYPES              TRUE
+#define DEFAULT_REMOTE_INDEX_LEVEL               "full"
+#define DEFAULT_RESOURCE_CONTROL                 FALSE
+#define DEFAULT_BULK_INDEX_WEIGHT                100      /* 1->10000 */
+#define DEFAULT_STEADY_STATE_WEIGHT              20       /* 1->10000 */
+#define DEFAULT_MEMORY_HIGH                      0        /* 0->1048576 */
 
 typedef struct {
 	/* IMPORTANT: There are 3 versions of the directories:
@@ -110,6 +122,18 @@ enum {
 	PROP_IGNORED_FILES,
 	PROP_CRAWLING_INTERVAL,
 	PROP_REMOVABLE_DAYS_THRESHOLD,
+	PROP_IDENTIFIER_CACHE_SIZE,
+	PROP_MAX_CRAWLED_ROOTS,
+	PROP_MAX_CRAWLED_DIRECTORIES,
+	PROP_MAX_MONITORS,
+	PROP_MIN_UPDATE_DELAY,
+	PROP_MAX_UPDATE_DELAY,
+	PROP_SNIFF_CONTENT_TYPES,
+	PROP_REMOTE_INDEX_LEVEL,
+	PROP_RESOURCE_CONTROL,
+	PROP_BULK_INDEX_WEIGHT,
+	PROP_STEADY_STATE_WEIGHT,
+	PROP_MEMORY_HIGH,
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerConfig, tracker_config, G_TYPE_SETTINGS)
@@ -264,6 +288,108 @@ tracker_config_class_init (TrackerConfigClass *klass)
 	                                                   365,
 	                                                   DEFAULT_REMOVABLE_DAYS_THRESHOLD,
 	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_IDENTIFIER_CACHE_SIZE,
+	                                 g_param_spec_int ("identifier-cache-size",
+	                                                   "Identifier cache size",
+	                                                   " Number of file content identifiers kept in memory while indexing",
+	                                                   100,
+	                                                   100000,
+	                                                   DEFAULT_IDENTIFIER_CACHE_SIZE,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MAX_CRAWLED_ROOTS,
+	                                 g_param_spec_int ("max-crawled-roots",
+	                                                   "Max crawled roots",
+	                                                   " Maximum number of indexed folders on different devices crawled at once",
+	                                                   1,
+	                                                   16,
+	                                                   DEFAULT_MAX_CRAWLED_ROOTS,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MAX_CRAWLED_DIRECTORIES,
+	                                 g_param_spec_int ("max-crawled-directories",
+	                                                   "Max crawled directories",
+	                                                   " Maximum number of directories crawled at once within an indexed folder",
+	                                                   1,
+	                                                   16,
+	                                                   DEFAULT_MAX_CRAWLED_DIRECTORIES,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MAX_MONITORS,
+	                                 g_param_spec_int ("max-monitors",
+	                                                   "Max monitors",
+	                                                   " Maximum number of directories watched individually, 0 for the system limit",
+	                                                   0,
+	                                                   1048576,
+	                                                   DEFAULT_MAX_MONITORS,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MIN_UPDATE_DELAY,
+	                                 g_param_spec_int ("min-update-delay",
+	                                                   "Min update delay",
+	                                                   " Milliseconds that updates of files changing often are held back at first, 0 to disable",
+	                                                   0,
+	                                                   60000,
+	                                                   DEFAULT_MIN_UPDATE_DELAY,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MAX_UPDATE_DELAY,
+	                                 g_param_spec_int ("max-update-delay",
+	                                                   "Max update delay",
+	                                                   " Maximum milliseconds that updates of files changing often are held back",
+	                                                   0,
+	                                                   3600000,
+	                                                   DEFAULT_MAX_UPDATE_DELAY,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_SNIFF_CONTENT_TYPES,
+	                                 g_param_spec_boolean ("sniff-content-types",
+	                                                       "Sniff content types",
+	                                                       " Set to FALSE to guess content types from file names only while crawling",
+	                                                       DEFAULT_SNIFF_CONTENT_TYPES,
+	                                                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_REMOTE_INDEX_LEVEL,
+	                                 g_param_spec_string ("remote-index-level",
+	                                                      "Remote index level",
+	                                                      " How much is indexed from files in network and FUSE mounts (names, metadata or full)",
+	                                                      DEFAULT_REMOTE_INDEX_LEVEL,
+	                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_RESOURCE_CONTROL,
+	                                 g_param_spec_boolean ("resource-control",
+	                                                       "Resource control",
+	                                                       " Set to TRUE to adjust CPU, IO and memory limits of the service through systemd",
+	                                                       DEFAULT_RESOURCE_CONTROL,
+	                                                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_BULK_INDEX_WEIGHT,
+	                                 g_param_spec_int ("bulk-index-weight",
+	                                                   "Bulk index weight",
+	                                                   " CPU and IO weight while crawling folders",
+	                                                   1,
+	                                                   10000,
+	                                                   DEFAULT_BULK_INDEX_WEIGHT,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_STEADY_STATE_WEIGHT,
+	                                 g_param_spec_int ("steady-state-weight",
+	                                                   "Steady state weight",
+	                                                   " CPU and IO weight while following changes",
+	                                                   1,
+	                                                   10000,
+	                                                   DEFAULT_STEADY_STATE_WEIGHT,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (object_class,
+	                                 PROP_MEMORY_HIGH,
+	                                 g_param_spec_int ("memory-high",
+	                                                   "Memory high",
+	                                                   " Memory usage in megabytes above which the service is throttled (0 for no limit)",
+	                                                   0,
+	                                                   1048576,
+	                                                   DEFAULT_MEMORY_HIGH,
+	                                                   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -406,6 +532,42 @@ config_get_property (GObject    *object,
 	case PROP_REMOVABLE_DAYS_THRESHOLD:
 		g_value_set_int (value, tracker_config_get_removable_days_threshold (config));
 		break;
+	case PROP_IDENTIFIER_CACHE_SIZE:
+		g_value_set_int (value, tracker_config_get_identifier_cache_size (config));
+		break;
+	case PROP_MAX_CRAWLED_ROOTS:
+		g_value_set_int (value, tracker_config_get_max_crawled_roots (config));
+		break;
+	case PROP_MAX_CRAWLED_DIRECTORIES:
+		g_value_set_int (value, tracker_config_get_max_crawled_directories (config));
+		break;
+	case PROP_MAX_MONITORS:
+		g_value_set_int (value, tracker_config_get_max_monitors (config));
+		break;
+	case PROP_MIN_UPDATE_DELAY:
+		g_value_set_int (value, tracker_config_get_min_update_delay (config));
+		break;
+	case PROP_MAX_UPDATE_DELAY:
+		g_value_set_int (value, tracker_config_get_max_update_delay (config));
+		break;
+	case PROP_SNIFF_CONTENT_TYPES:
+		g_value_set_boolean (value, tracker_config_get_sniff_content_types (config));
+		break;
+	case PROP_REMOTE_INDEX_LEVEL:
+		g_value_take_string (value, tracker_config_get_remote_index_level (config));
+		break;
+	case PROP_RESOURCE_CONTROL:
+		g_value_set_boolean (value, tracker_config_get_resource_control (config));
+		break;
+	case PROP_BULK_INDEX_WEIGHT:
+		g_value_set_int (value, tracker_config_get_bulk_index_weight (config));
+		break;
+	case PROP_STEADY_STATE_WEIGHT:
+		g_value_set_int (value, tracker_config_get_steady_state_weight (config));
+		break;
+	case PROP_MEMORY_HIGH:
+		g_value_set_int (value, tracker_config_get_memory_high (config));
+		break;
 
 	/* Did we miss any new properties? */
 	default:
@@ -521,6 +683,18 @@ config_constructed (GObject *object)
 	g_settings_bind (settings, "crawling-interval", object, "crawling-interval", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "low-disk-space-limit", object, "low-disk-space-limit", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "removable-days-threshold", object, "removable-days-threshold", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "identifier-cache-size", object, "identifier-cache-size", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "max-crawled-roots", object, "max-crawled-roots", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "max-crawled-directories", object, "max-crawled-directories", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "max-monitors", object, "max-monitors", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "min-update-delay", object, "min-update-delay", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "max-update-delay", object, "max-update-delay", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "sniff-content-types", object, "sniff-content-types", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "remote-index-level", object, "remote-index-level", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "resource-control", object, "resource-control", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "bulk-index-weight", object, "bulk-index-weight", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "steady-state-weight", object, "steady-state-weight", G_SETTINGS_BIND_GET);
+	g_settings_bind (settings, "memory-high", object, "memory-high", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "enable-monitors", object, "enable-monitors", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "index-removable-devices", object, "index-removable-devices", G_SETTINGS_BIND_GET);
 	g_settings_bind (settings, "index-optical-discs", object, "index-optical-discs", G_SETTINGS_BIND_GET);
@@ -723,6 +897,102 @@ tracker_config_get_removable_days_threshold (TrackerConfig *config)
 	return g_settings_get_int (G_SETTINGS (config), "removable-days-threshold");
 }
 
+gint
+tracker_config_get_identifier_cache_size (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_IDENTIFIER_CACHE_SIZE);
+
+	return g_settings_get_int (G_SETTINGS (config), "identifier-cache-size");
+}
+
+gint
+tracker_config_get_max_crawled_roots (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MAX_CRAWLED_ROOTS);
+
+	return g_settings_get_int (G_SETTINGS (config), "max-crawled-roots");
+}
+
+gint
+tracker_config_get_max_crawled_directories (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MAX_CRAWLED_DIRECTORIES);
+
+	return g_settings_get_int (G_SETTINGS (config), "max-crawled-directories");
+}
+
+gint
+tracker_config_get_max_monitors (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MAX_MONITORS);
+
+	return g_settings_get_int (G_SETTINGS (config), "max-monitors");
+}
+
+gint
+tracker_config_get_min_update_delay (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MIN_UPDATE_DELAY);
+
+	return g_settings_get_int (G_SETTINGS (config), "min-update-delay");
+}
+
+gint
+tracker_config_get_max_update_delay (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MAX_UPDATE_DELAY);
+
+	return g_settings_get_int (G_SETTINGS (config), "max-update-delay");
+}
+
+gboolean
+tracker_config_get_sniff_content_types (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_SNIFF_CONTENT_TYPES);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "sniff-content-types");
+}
+
+gchar *
+tracker_config_get_remote_index_level (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), g_strdup (DEFAULT_REMOTE_INDEX_LEVEL));
+
+	return g_settings_get_string (G_SETTINGS (config), "remote-index-level");
+}
+
+gboolean
+tracker_config_get_resource_control (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_RESOURCE_CONTROL);
+
+	return g_settings_get_boolean (G_SETTINGS (config), "resource-control");
+}
+
+gint
+tracker_config_get_bulk_index_weight (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_BULK_INDEX_WEIGHT);
+
+	return g_settings_get_int (G_SETTINGS (config), "bulk-index-weight");
+}
+
+gint
+tracker_config_get_steady_state_weight (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_STEADY_STATE_WEIGHT);
+
+	return g_settings_get_int (G_SETTINGS (config), "steady-state-weight");
+}
+
+gint
+tracker_config_get_memory_high (TrackerConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_CONFIG (config), DEFAULT_MEMORY_HIGH);
+
+	return g_settings_get_int (G_SETTINGS (config), "memory-high");
+}
+
 void
 tracker_config_set_initial_sleep (TrackerConfig *config,
                                   gint           value)
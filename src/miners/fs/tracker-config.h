@@ -63,6 +63,18 @@ GSList *       tracker_config_get_ignored_directories_with_content (TrackerConfi
 GSList *       tracker_config_get_ignored_files                    (TrackerConfig *config);
 gint           tracker_config_get_crawling_interval                (TrackerConfig *config);
 gint           tracker_config_get_removable_days_threshold         (TrackerConfig *config);
+gint           tracker_config_get_identifier_cache_size            (TrackerConfig *config);
+gint           tracker_config_get_max_crawled_roots                (TrackerConfig *config);
+gint           tracker_config_get_max_crawled_directories          (TrackerConfig *config);
+gint           tracker_config_get_max_monitors                     (TrackerConfig *config);
+gint           tracker_config_get_min_update_delay                 (TrackerConfig *config);
+gint           tracker_config_get_max_update_delay                 (TrackerConfig *config);
+gboolean       tracker_config_get_sniff_content_types              (TrackerConfig *config);
+gchar *        tracker_config_get_remote_index_level               (TrackerConfig *config);
+gboolean       tracker_config_get_resource_control                 (TrackerConfig *config);
+gint           tracker_config_get_bulk_index_weight                (TrackerConfig *config);
+gint           tracker_config_get_steady_state_weight              (TrackerConfig *config);
+gint           tracker_config_get_memory_high                      (TrackerConfig *config);
 
 void           tracker_config_set_initial_sleep                    (TrackerConfig *config,
                                                                     gint           value);
@@ -6,6 +6,19 @@
 
 #include <libtracker-miners-common/tracker-common.h>
 
+/* Mount changes arriving within this time of each other are
+ * applied to the indexing tree together, docks and automounters
+ * make many of them in a row.
+ */
+#define MOUNT_CHANGES_DELAY_MS 200
+
+typedef struct {
+	gchar *mount_point;
+	gboolean added;
+	gboolean removable;
+	gboolean optical;
+} MountChange;
+
 struct _TrackerController
 {
 	GObject parent_instance;
@@ -26,8 +39,12 @@ struct _TrackerController
 	guint force_recheck_id;
 	guint volumes_changed_id;
 
+	GQueue mount_changes;
+	guint mount_changes_id;
+
 	guint index_removable_devices : 1;
 	guint index_optical_discs : 1;
+	guint recheck_roots : 1;
 };
 
 enum {
@@ -125,9 +142,13 @@ add_removable_or_optical_directory (TrackerController *controller,
 	TrackerDirectoryFlags flags;
 	g_autofree gchar *uri = NULL;
 
+	/* Volumes may hold large archives, crawled progressively so
+	 * their first levels can be browsed and searched early.
+	 */
 	flags = TRACKER_DIRECTORY_FLAG_RECURSE |
 		TRACKER_DIRECTORY_FLAG_PRESERVE |
-		TRACKER_DIRECTORY_FLAG_PRIORITY;
+		TRACKER_DIRECTORY_FLAG_PRIORITY |
+		TRACKER_DIRECTORY_FLAG_PROGRESSIVE;
 
 	if (tracker_config_get_enable_monitors (controller->config)) {
 		flags |= TRACKER_DIRECTORY_FLAG_MONITOR;
@@ -141,13 +162,17 @@ add_removable_or_optical_directory (TrackerController *controller,
 }
 
 static void
-mount_point_added_cb (TrackerController *controller,
-                      const gchar       *uuid,
-                      const gchar       *mount_point,
-                      const gchar       *mount_name,
-                      gboolean           removable,
-                      gboolean           optical,
-                      TrackerStorage    *storage)
+mount_change_free (MountChange *change)
+{
+	g_free (change->mount_point);
+	g_slice_free (MountChange, change);
+}
+
+static void
+handle_mount_point_added (TrackerController *controller,
+                          const gchar       *mount_point,
+                          gboolean           removable,
+                          gboolean           optical)
 {
 	g_autoptr (GFile) mount_point_file = NULL;
 
@@ -230,10 +255,8 @@ mount_point_added_cb (TrackerController *controller,
 }
 
 static void
-mount_point_removed_cb (TrackerController *controller,
-                        const gchar       *uuid,
-                        const gchar       *mount_point,
-                        TrackerStorage    *storage)
+handle_mount_point_removed (TrackerController *controller,
+                            const gchar       *mount_point)
 {
 	g_autoptr (GFile) mount_point_file = NULL;
 
@@ -243,6 +266,91 @@ mount_point_removed_cb (TrackerController *controller,
 	tracker_indexing_tree_remove (controller->indexing_tree, mount_point_file);
 }
 
+static void
+flush_mount_changes (TrackerController *controller)
+{
+	MountChange *change;
+
+	g_clear_handle_id (&controller->mount_changes_id, g_source_remove);
+
+	if (g_queue_is_empty (&controller->mount_changes))
+		return;
+
+	/* One update for all, so mounts coming and going again, or
+	 * overlapping roots, are only checked once.
+	 */
+	tracker_indexing_tree_begin_update (controller->indexing_tree);
+
+	while ((change = g_queue_pop_head (&controller->mount_changes)) != NULL) {
+		if (change->added) {
+			handle_mount_point_added (controller,
+			                          change->mount_point,
+			                          change->removable,
+			                          change->optical);
+		} else {
+			handle_mount_point_removed (controller, change->mount_point);
+		}
+
+		mount_change_free (change);
+	}
+
+	tracker_indexing_tree_end_update (controller->indexing_tree);
+}
+
+static gboolean
+mount_changes_cb (gpointer user_data)
+{
+	TrackerController *controller = user_data;
+
+	controller->mount_changes_id = 0;
+	flush_mount_changes (controller);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+queue_mount_change (TrackerController *controller,
+                    const gchar       *mount_point,
+                    gboolean           added,
+                    gboolean           removable,
+                    gboolean           optical)
+{
+	MountChange *change;
+
+	change = g_slice_new0 (MountChange);
+	change->mount_point = g_strdup (mount_point);
+	change->added = added;
+	change->removable = removable;
+	change->optical = optical;
+	g_queue_push_tail (&controller->mount_changes, change);
+
+	if (controller->mount_changes_id == 0) {
+		controller->mount_changes_id =
+			g_timeout_add (MOUNT_CHANGES_DELAY_MS, mount_changes_cb, controller);
+	}
+}
+
+static void
+mount_point_added_cb (TrackerController *controller,
+                      const gchar       *uuid,
+                      const gchar       *mount_point,
+                      const gchar       *mount_name,
+                      gboolean           removable,
+                      gboolean           optical,
+                      TrackerStorage    *storage)
+{
+	queue_mount_change (controller, mount_point, TRUE, removable, optical);
+}
+
+static void
+mount_point_removed_cb (TrackerController *controller,
+                        const gchar       *uuid,
+                        const gchar       *mount_point,
+                        TrackerStorage    *storage)
+{
+	queue_mount_change (controller, mount_point, FALSE, FALSE, FALSE);
+}
+
 static void
 mount_pre_unmount_cb (GVolumeMonitor    *volume_monitor,
                       GMount            *mount,
@@ -255,23 +363,13 @@ mount_pre_unmount_cb (GVolumeMonitor    *volume_monitor,
 	uri = g_file_get_uri (mount_root);
 	g_debug ("Pre-unmount requested for '%s'", uri);
 
+	/* Files must be let go of right away, after any pending
+	 * changes so these do not add the mount back.
+	 */
+	flush_mount_changes (controller);
 	tracker_indexing_tree_remove (controller->indexing_tree, mount_root);
 }
 
-static void
-indexing_tree_update_filter (TrackerIndexingTree *indexing_tree,
-			     TrackerFilterType    filter,
-			     GSList              *new_elems)
-{
-	tracker_indexing_tree_clear_filters (indexing_tree, filter);
-
-	while (new_elems) {
-		tracker_indexing_tree_add_filter (indexing_tree, filter,
-						  new_elems->data);
-		new_elems = new_elems->next;
-	}
-}
-
 static void
 update_filters (TrackerController *controller)
 {
@@ -280,21 +378,27 @@ update_filters (TrackerController *controller)
 	/* Always ignore hidden */
 	tracker_indexing_tree_set_filter_hidden (controller->indexing_tree, TRUE);
 
+	/* Only the content affected by changed filters is checked
+	 * again, see tracker_indexing_tree_set_filters().
+	 */
+
 	/* Ignored files */
 	list = tracker_config_get_ignored_files (controller->config);
-	indexing_tree_update_filter (controller->indexing_tree, TRACKER_FILTER_FILE, list);
+	tracker_indexing_tree_set_filters (controller->indexing_tree,
+	                                   TRACKER_FILTER_FILE,
+	                                   list);
 
 	/* Ignored directories */
 	list = tracker_config_get_ignored_directories (controller->config);
-	indexing_tree_update_filter (controller->indexing_tree,
-				     TRACKER_FILTER_DIRECTORY,
-				     list);
+	tracker_indexing_tree_set_filters (controller->indexing_tree,
+	                                   TRACKER_FILTER_DIRECTORY,
+	                                   list);
 
 	/* Directories with content */
 	list = tracker_config_get_ignored_directories_with_content (controller->config);
-	indexing_tree_update_filter (controller->indexing_tree,
-				     TRACKER_FILTER_PARENT_DIRECTORY,
-				     list);
+	tracker_indexing_tree_set_filters (controller->indexing_tree,
+	                                   TRACKER_FILTER_PARENT_DIRECTORY,
+	                                   list);
 }
 
 static void
@@ -418,27 +522,27 @@ trigger_recheck_idle_cb (gpointer user_data)
 
 	update_filters (controller);
 
-	roots = tracker_indexing_tree_list_roots (controller->indexing_tree);
+	if (controller->recheck_roots) {
+		roots = tracker_indexing_tree_list_roots (controller->indexing_tree);
 
-	for (l = roots; l; l = l->next)	{
-		GFile *root = l->data;
+		for (l = roots; l; l = l->next)	{
+			GFile *root = l->data;
 
-		tracker_indexing_tree_notify_update (controller->indexing_tree, root, FALSE);
+			tracker_indexing_tree_notify_update (controller->indexing_tree, root, FALSE);
+		}
+
+		g_list_free (roots);
 	}
 
 	controller->force_recheck_id = 0;
-	g_list_free (roots);
+	controller->recheck_roots = FALSE;
 
 	return G_SOURCE_REMOVE;
 }
 
 static void
-trigger_recheck_cb (TrackerConfig     *config,
-                    GParamSpec        *pspec,
-                    TrackerController *controller)
+queue_recheck (TrackerController *controller)
 {
-	TRACKER_NOTE (CONFIG, g_message ("Ignored content related configuration changed, checking index..."));
-
 	if (controller->force_recheck_id == 0) {
 		/* Set idle so multiple changes in the config lead to one recheck */
 		controller->force_recheck_id =
@@ -446,6 +550,27 @@ trigger_recheck_cb (TrackerConfig     *config,
 	}
 }
 
+static void
+trigger_recheck_cb (TrackerConfig     *config,
+                    GParamSpec        *pspec,
+                    TrackerController *controller)
+{
+	TRACKER_NOTE (CONFIG, g_message ("Monitoring configuration changed, checking index..."));
+
+	controller->recheck_roots = TRUE;
+	queue_recheck (controller);
+}
+
+static void
+filters_changed_cb (TrackerConfig     *config,
+                    GParamSpec        *pspec,
+                    TrackerController *controller)
+{
+	TRACKER_NOTE (CONFIG, g_message ("Ignored content related configuration changed, updating filters..."));
+
+	queue_recheck (controller);
+}
+
 static gboolean
 index_volumes_changed_idle (gpointer user_data)
 {
@@ -792,13 +917,13 @@ tracker_controller_constructed (GObject *object)
 	                  G_CALLBACK (index_single_directories_cb),
 	                  object);
 	g_signal_connect (controller->config, "notify::ignored-directories",
-	                  G_CALLBACK (trigger_recheck_cb),
+	                  G_CALLBACK (filters_changed_cb),
 	                  object);
 	g_signal_connect (controller->config, "notify::ignored-directories-with-content",
-	                  G_CALLBACK (trigger_recheck_cb),
+	                  G_CALLBACK (filters_changed_cb),
 	                  object);
 	g_signal_connect (controller->config, "notify::ignored-files",
-	                  G_CALLBACK (trigger_recheck_cb),
+	                  G_CALLBACK (filters_changed_cb),
 	                  object);
 	g_signal_connect (controller->config, "notify::enable-monitors",
 	                  G_CALLBACK (trigger_recheck_cb),
@@ -835,6 +960,8 @@ tracker_controller_finalize (GObject *object)
 
 	g_clear_handle_id (&controller->force_recheck_id, g_source_remove);
 	g_clear_handle_id (&controller->volumes_changed_id, g_source_remove);
+	g_clear_handle_id (&controller->mount_changes_id, g_source_remove);
+	g_queue_clear_full (&controller->mount_changes, (GDestroyNotify) mount_change_free);
 
 	g_clear_object (&controller->indexing_tree);
 	g_clear_object (&controller->storage);
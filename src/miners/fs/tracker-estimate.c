@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Estimates what indexing a directory as a new root would cost, for
+ * capacity planning. The directory is walked with several threads,
+ * looking at file metadata only: the same filters as the miner apply,
+ * mimetypes are guessed from file names, and the extractor rules tell
+ * which module would read each file. Nothing is read nor stored.
+ */
+
+#include "config-miners.h"
+
+#include <stdlib.h>
+
+#include <glib/gi18n.h>
+
+#include <libtracker-miners-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
+
+#include "tracker-estimate.h"
+
+#define ESTIMATE_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT
+
+#define MAX_ESTIMATE_THREADS 8
+
+/* Rough store cost of the resources describing a file, their
+ * properties and indexes, and of the full-text index for each
+ * byte of extracted text.
+ */
+#define STORE_BYTES_PER_FILE 2048
+#define STORE_BYTES_PER_TEXT_BYTE 1.5
+
+typedef struct {
+	guint64 files;
+	guint64 bytes;
+} ModuleEstimate;
+
+typedef struct {
+	TrackerIndexingTree *indexing_tree;
+	TrackerTextLimits *text_limits;
+	GThreadPool *pool;
+
+	/* Protects everything below, and the indexing tree */
+	GMutex mutex;
+	GCond cond;
+	guint pending;
+
+	guint64 directories;
+	guint64 directories_ignored;
+	guint64 files;
+	guint64 files_ignored;
+	guint64 bytes;
+	guint64 text_bytes;
+	GHashTable *modules;
+	guint errors;
+} Estimate;
+
+static void
+estimate_file (Estimate  *estimate,
+               GFileInfo *info)
+{
+	g_autofree gchar *mimetype = NULL;
+	const gchar *module_path, *graph;
+	g_autofree gchar *module = NULL;
+	ModuleEstimate *module_estimate;
+	goffset size;
+
+	size = g_file_info_get_size (info);
+	mimetype = g_content_type_guess (g_file_info_get_name (info), NULL, 0, NULL);
+	module_path = tracker_extract_module_manager_get_module_path (mimetype);
+	graph = tracker_extract_module_manager_get_graph (mimetype);
+
+	estimate->files++;
+	estimate->bytes += size;
+
+	/* Extractors read their files up to the end at most */
+	module = module_path ? g_path_get_basename (module_path) : g_strdup ("");
+	module_estimate = g_hash_table_lookup (estimate->modules, module);
+
+	if (!module_estimate) {
+		module_estimate = g_new0 (ModuleEstimate, 1);
+		g_hash_table_insert (estimate->modules, g_steal_pointer (&module),
+		                     module_estimate);
+	}
+
+	module_estimate->files++;
+
+	if (module_path)
+		module_estimate->bytes += size;
+
+	/* Document text goes to the full-text index, up to its limit */
+	if (module_path && g_strcmp0 (graph, "tracker:Documents") == 0) {
+		estimate->text_bytes +=
+			MIN ((gsize) size,
+			     tracker_text_limits_get_max_text (estimate->text_limits,
+			                                       mimetype, graph));
+	}
+}
+
+static void
+estimate_directory_thread (gpointer data,
+                           gpointer user_data)
+{
+	g_autoptr (GFile) directory = data;
+	Estimate *estimate = user_data;
+	g_autoptr (GFileEnumerator) enumerator = NULL;
+	g_autoptr (GPtrArray) infos = NULL;
+	gboolean filtered = FALSE;
+	GFileInfo *info;
+	guint i;
+
+	enumerator = g_file_enumerate_children (directory, ESTIMATE_ATTRIBUTES,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, NULL);
+	infos = g_ptr_array_new_with_free_func (g_object_unref);
+
+	while (enumerator &&
+	       (info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+		g_ptr_array_add (infos, info);
+
+	g_mutex_lock (&estimate->mutex);
+
+	if (!enumerator)
+		estimate->errors++;
+
+	/* Directory content filters do not apply to the root itself */
+	if (!tracker_indexing_tree_file_is_root (estimate->indexing_tree, directory)) {
+		for (i = 0; i < infos->len && !filtered; i++) {
+			info = g_ptr_array_index (infos, i);
+			filtered = tracker_indexing_tree_name_matches_filter (estimate->indexing_tree,
+			                                                      TRACKER_FILTER_PARENT_DIRECTORY,
+			                                                      g_file_info_get_name (info));
+		}
+	}
+
+	if (filtered) {
+		estimate->directories--;
+		estimate->directories_ignored++;
+		g_ptr_array_set_size (infos, 0);
+	}
+
+	for (i = 0; i < infos->len; i++) {
+		g_autoptr (GFile) child = NULL;
+
+		info = g_ptr_array_index (infos, i);
+		child = g_file_get_child (directory, g_file_info_get_name (info));
+
+		if (!tracker_indexing_tree_file_is_indexable (estimate->indexing_tree,
+		                                              child, info)) {
+			if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+				estimate->directories_ignored++;
+			else
+				estimate->files_ignored++;
+			continue;
+		}
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			estimate->directories++;
+
+			if (!g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT)) {
+				estimate->pending++;
+				g_thread_pool_push (estimate->pool, g_steal_pointer (&child), NULL);
+			}
+		} else {
+			estimate_file (estimate, info);
+		}
+	}
+
+	estimate->pending--;
+	if (estimate->pending == 0)
+		g_cond_signal (&estimate->cond);
+
+	g_mutex_unlock (&estimate->mutex);
+}
+
+static gint
+compare_modules (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+	GHashTable *modules = user_data;
+	const ModuleEstimate *estimate_a, *estimate_b;
+
+	estimate_a = g_hash_table_lookup (modules, *(const gchar **) a);
+	estimate_b = g_hash_table_lookup (modules, *(const gchar **) b);
+
+	if (estimate_a->bytes != estimate_b->bytes)
+		return estimate_a->bytes < estimate_b->bytes ? 1 : -1;
+
+	return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+static void
+estimate_print (Estimate *estimate,
+                GFile    *directory)
+{
+	g_autoptr (GPtrArray) modules = NULL;
+	g_autofree gchar *path = NULL, *bytes = NULL, *text_bytes = NULL, *store = NULL;
+	GHashTableIter iter;
+	gpointer key;
+	guint64 store_bytes;
+	guint i;
+
+	path = g_file_get_path (directory);
+	g_print (_("Estimate for indexing “%s”:"), path);
+	g_print ("\n");
+
+	g_print ("  %-28s %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT " %s)\n",
+	         _("Directories:"), estimate->directories,
+	         estimate->directories_ignored, _("ignored"));
+	g_print ("  %-28s %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT " %s)\n",
+	         _("Files:"), estimate->files,
+	         estimate->files_ignored, _("ignored"));
+	g_print ("  %-28s %" G_GUINT64_FORMAT "\n",
+	         _("Directory monitors:"), estimate->directories);
+	bytes = g_format_size (estimate->bytes);
+	g_print ("  %-28s %s\n", _("File contents:"), bytes);
+
+	g_print ("  %s\n", _("Read by extractor modules:"));
+
+	modules = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, estimate->modules);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (modules, key);
+
+	g_ptr_array_sort_with_data (modules, compare_modules, estimate->modules);
+
+	for (i = 0; i < modules->len; i++) {
+		const gchar *module = g_ptr_array_index (modules, i);
+		ModuleEstimate *module_estimate;
+		g_autofree gchar *size = NULL;
+
+		module_estimate = g_hash_table_lookup (estimate->modules, module);
+		size = g_format_size (module_estimate->bytes);
+		g_print ("    %-26s %10" G_GUINT64_FORMAT " %s, %s\n",
+		         *module ? module : _("(not extracted)"),
+		         module_estimate->files, _("files"), size);
+	}
+
+	store_bytes = (estimate->files + estimate->directories) * STORE_BYTES_PER_FILE +
+		estimate->text_bytes * STORE_BYTES_PER_TEXT_BYTE;
+
+	text_bytes = g_format_size (estimate->text_bytes);
+	store = g_format_size (store_bytes);
+	g_print ("  %-28s %s\n", _("Full-text search content:"), text_bytes);
+	g_print ("  %-28s %s\n", _("Expected store size:"), store);
+
+	if (estimate->errors > 0) {
+		g_print (_("%u directories could not be read"), estimate->errors);
+		g_print ("\n");
+	}
+}
+
+gint
+tracker_estimate_directory (TrackerIndexingTree *indexing_tree,
+                            GFile               *directory)
+{
+	g_autoptr (GSettings) extract_settings = NULL;
+	g_autoptr (GVariant) limits = NULL;
+	Estimate estimate = { 0, };
+
+	if (g_file_query_file_type (directory, G_FILE_QUERY_INFO_NONE, NULL) != G_FILE_TYPE_DIRECTORY) {
+		g_autofree gchar *path = NULL;
+
+		path = g_file_get_path (directory);
+		g_printerr (_("“%s” is not a directory"), path);
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!tracker_extract_module_manager_init ())
+		return EXIT_FAILURE;
+
+	/* Estimated as a new recursive root, on top of the configured ones */
+	if (!tracker_indexing_tree_file_is_root (indexing_tree, directory)) {
+		tracker_indexing_tree_add (indexing_tree, directory,
+		                           TRACKER_DIRECTORY_FLAG_RECURSE |
+		                           TRACKER_DIRECTORY_FLAG_MONITOR);
+	}
+
+	extract_settings = g_settings_new ("org.freedesktop.Tracker3.Extract");
+	limits = g_settings_get_value (extract_settings, "text-limits");
+
+	estimate.indexing_tree = indexing_tree;
+	estimate.text_limits =
+		tracker_text_limits_new (g_settings_get_int (extract_settings, "max-bytes"),
+		                         g_settings_get_int (extract_settings, "text-tail-bytes"),
+		                         limits);
+	estimate.modules = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                          g_free, g_free);
+	estimate.pool = g_thread_pool_new (estimate_directory_thread, &estimate,
+	                                   CLAMP (g_get_num_processors (), 1, MAX_ESTIMATE_THREADS),
+	                                   FALSE, NULL);
+	g_mutex_init (&estimate.mutex);
+	g_cond_init (&estimate.cond);
+
+	g_mutex_lock (&estimate.mutex);
+	estimate.directories = 1;
+	estimate.pending = 1;
+	g_thread_pool_push (estimate.pool, g_object_ref (directory), NULL);
+
+	while (estimate.pending > 0)
+		g_cond_wait (&estimate.cond, &estimate.mutex);
+
+	g_mutex_unlock (&estimate.mutex);
+
+	g_thread_pool_free (estimate.pool, FALSE, TRUE);
+	estimate_print (&estimate, directory);
+
+	g_hash_table_unref (estimate.modules);
+	tracker_text_limits_unref (estimate.text_limits);
+	g_mutex_clear (&estimate.mutex);
+	g_cond_clear (&estimate.cond);
+
+	return EXIT_SUCCESS;
+}
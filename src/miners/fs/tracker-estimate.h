@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_ESTIMATE_H__
+#define __TRACKER_ESTIMATE_H__
+
+#include <gio/gio.h>
+
+#include "tracker-indexing-tree.h"
+
+gint tracker_estimate_directory (TrackerIndexingTree *indexing_tree,
+                                 GFile               *directory);
+
+#endif /* __TRACKER_ESTIMATE_H__ */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Records the events queued by TrackerMinerFS into a trace file, to
+ * be replayed later on. Paths are anonymized: indexing roots become
+ * "root0", "root1"... and every path element below them is replaced
+ * by a salted hash. Only short file extensions are kept, so a replay
+ * still gets the same mimetypes. The salt is random for every trace,
+ * so the same name maps to different hashes across traces.
+ *
+ * The format is line based, with tab separated fields:
+ *
+ *   # localsearch-trace 1
+ *   <usec> <event> <d|f> <path> <dest path or "-">
+ *   # <usec> <mark>
+ *
+ * Timestamps are relative to the creation of the recorder.
+ */
+
+#include "config-miners.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "tracker-event-recorder.h"
+
+#define MAX_EXTENSION_LEN 8
+#define HASH_LEN 16
+
+struct _TrackerEventRecorder {
+	FILE *f;
+	TrackerIndexingTree *indexing_tree;
+	GHashTable *roots;
+	gchar *salt;
+	gint64 start_time;
+};
+
+TrackerEventRecorder *
+tracker_event_recorder_new (GFile                *trace_file,
+                            TrackerIndexingTree  *indexing_tree,
+                            GError              **error)
+{
+	TrackerEventRecorder *recorder;
+	g_autofree gchar *path = NULL;
+	FILE *f;
+
+	path = g_file_get_path (trace_file);
+	f = g_fopen (path, "w");
+
+	if (!f) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+		             "Could not open trace file '%s': %s",
+		             path, g_strerror (errsv));
+		return NULL;
+	}
+
+	recorder = g_new0 (TrackerEventRecorder, 1);
+	recorder->f = f;
+	recorder->indexing_tree = g_object_ref (indexing_tree);
+	recorder->roots = g_hash_table_new_full (g_file_hash,
+	                                         (GEqualFunc) g_file_equal,
+	                                         g_object_unref, NULL);
+	recorder->salt = g_strdup_printf ("%08x%08x%08x%08x",
+	                                  g_random_int (), g_random_int (),
+	                                  g_random_int (), g_random_int ());
+	recorder->start_time = g_get_monotonic_time ();
+
+	fputs ("# localsearch-trace 1\n", recorder->f);
+
+	return recorder;
+}
+
+void
+tracker_event_recorder_free (TrackerEventRecorder *recorder)
+{
+	fclose (recorder->f);
+	g_object_unref (recorder->indexing_tree);
+	g_hash_table_unref (recorder->roots);
+	g_free (recorder->salt);
+	g_free (recorder);
+}
+
+static void
+append_anonymized_element (TrackerEventRecorder *recorder,
+                           GString              *str,
+                           const gchar          *element)
+{
+	g_autofree gchar *salted = NULL, *hash = NULL;
+	const gchar *extension;
+
+	salted = g_strconcat (recorder->salt, element, NULL);
+	hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, salted, -1);
+	g_string_append_len (str, hash, HASH_LEN);
+
+	extension = strrchr (element, '.');
+
+	if (extension && extension != element &&
+	    strlen (extension) <= MAX_EXTENSION_LEN + 1) {
+		const gchar *p;
+
+		for (p = extension + 1; *p; p++) {
+			if (!g_ascii_isalnum (*p))
+				return;
+		}
+
+		g_string_append (str, extension);
+	}
+}
+
+static gchar *
+anonymize_file (TrackerEventRecorder *recorder,
+                GFile                *file)
+{
+	g_autofree gchar *relative = NULL;
+	g_auto (GStrv) elements = NULL;
+	GString *str;
+	GFile *root;
+	gpointer idx;
+	guint i;
+
+	if (!file)
+		return g_strdup ("-");
+
+	root = tracker_indexing_tree_get_root (recorder->indexing_tree, file, NULL);
+	if (!root)
+		return g_strdup ("-");
+
+	if (!g_hash_table_lookup_extended (recorder->roots, root, NULL, &idx)) {
+		idx = GUINT_TO_POINTER (g_hash_table_size (recorder->roots));
+		g_hash_table_insert (recorder->roots, g_object_ref (root), idx);
+	}
+
+	str = g_string_new (NULL);
+	g_string_append_printf (str, "root%u", GPOINTER_TO_UINT (idx));
+
+	relative = g_file_get_relative_path (root, file);
+	if (relative)
+		elements = g_strsplit (relative, G_DIR_SEPARATOR_S, -1);
+
+	for (i = 0; elements && elements[i]; i++) {
+		if (!*elements[i])
+			continue;
+
+		g_string_append_c (str, '/');
+		append_anonymized_element (recorder, str, elements[i]);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+void
+tracker_event_recorder_log_event (TrackerEventRecorder *recorder,
+                                  const gchar          *event,
+                                  GFile                *file,
+                                  GFile                *dest_file,
+                                  gboolean              is_dir)
+{
+	g_autofree gchar *path = NULL, *dest_path = NULL;
+
+	path = anonymize_file (recorder, file);
+	dest_path = anonymize_file (recorder, dest_file);
+
+	fprintf (recorder->f, "%" G_GINT64_FORMAT "\t%s\t%c\t%s\t%s\n",
+	         g_get_monotonic_time () - recorder->start_time,
+	         event, is_dir ? 'd' : 'f', path, dest_path);
+}
+
+void
+tracker_event_recorder_log_mark (TrackerEventRecorder *recorder,
+                                 const gchar          *mark)
+{
+	fprintf (recorder->f, "# %" G_GINT64_FORMAT "\t%s\n",
+	         g_get_monotonic_time () - recorder->start_time,
+	         mark);
+	fflush (recorder->f);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_EVENT_RECORDER_H__
+#define __TRACKER_EVENT_RECORDER_H__
+
+#include <gio/gio.h>
+
+#include "tracker-indexing-tree.h"
+
+typedef struct _TrackerEventRecorder TrackerEventRecorder;
+
+TrackerEventRecorder * tracker_event_recorder_new (GFile                *trace_file,
+                                                   TrackerIndexingTree  *indexing_tree,
+                                                   GError              **error);
+void tracker_event_recorder_free (TrackerEventRecorder *recorder);
+
+void tracker_event_recorder_log_event (TrackerEventRecorder *recorder,
+                                       const gchar          *event,
+                                       GFile                *file,
+                                       GFile                *dest_file,
+                                       gboolean              is_dir);
+void tracker_event_recorder_log_mark (TrackerEventRecorder *recorder,
+                                      const gchar          *mark);
+
+#endif /* __TRACKER_EVENT_RECORDER_H__ */
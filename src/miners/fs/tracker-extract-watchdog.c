@@ -22,13 +22,40 @@
 #include "tracker-extract-watchdog.h"
 
 #include "tracker-files-interface.h"
+#include "tracker-utils.h"
 #include <libtracker-miners-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
 
 #include <sys/socket.h>
 
 #define REMOTE_FD_NUMBER 3
 #define MINER_FS_NAME "org.freedesktop.Tracker3.Miner.Files"
 
+/* Upper limit of extractor processes running in parallel */
+#define MAX_EXTRACT_WORKERS 4
+
+/* Number of crashed extractor processes that may be respawned
+ * within RESTART_PERIOD seconds, counted across all workers.
+ */
+#define RESTART_BUDGET 5
+#define RESTART_PERIOD 60
+
+/* Interval at which extractor metrics are fetched while busy, they
+ * are also fetched whenever an extractor becomes idle.
+ */
+#define METRICS_INTERVAL_USEC (10 * G_USEC_PER_SEC)
+
+/* Files that crash or hang the extractor are ignored one by one. If
+ * that happens to too many files of a MIME type, or handled by the
+ * same module, within FAILURE_PERIOD seconds, files of that MIME type
+ * only get their basic data for a while, doubling every time.
+ */
+#define FAILURE_PERIOD (10 * 60)
+#define MIMETYPE_FAILURE_THRESHOLD 3
+#define MODULE_FAILURE_THRESHOLD 5
+#define FALLBACK_BACKOFF_MIN 60
+#define FALLBACK_BACKOFF_MAX (24 * 60 * 60)
+
 enum {
 	STATUS,
 	LOST,
@@ -46,23 +73,157 @@ enum {
 
 static GParamSpec *props[N_PROPS] = { 0, };
 
-struct _TrackerExtractWatchdog {
-	GObject parent_class;
-	TrackerSparqlConnection *sparql_conn;
+typedef struct {
+	TrackerExtractWatchdog *watchdog;
+	guint index;
 	GSubprocessLauncher *launcher;
 	GSubprocess *extract_process;
 	GCancellable *cancellable;
 	GDBusConnection *conn;
 	TrackerEndpoint *endpoint;
 	TrackerFilesInterface *files_interface;
-	TrackerIndexingTree *indexing_tree;
 	guint progress_signal_id;
 	guint error_signal_id;
 	int persistence_fd;
+	gchar *status;
+	gdouble progress;
+	gint remaining;
+	gint64 metrics_time;
+	guint crashed : 1;
+} ExtractWorker;
+
+typedef struct {
+	gint64 period_start;
+	guint n_failures;
+} FailureRate;
+
+typedef struct {
+	FailureRate rate;
+	const gchar *module_path;
+	guint n_trips;
+	/* Monotonic time until which only basic data is extracted */
+	gint64 fallback_until;
+} MimetypeBreaker;
+
+struct _TrackerExtractWatchdog {
+	GObject parent_class;
+	TrackerSparqlConnection *sparql_conn;
+	TrackerIndexingTree *indexing_tree;
+	GFile *store_location;
+	ExtractWorker *workers;
+	guint n_workers;
+	gint64 restart_period_start;
+	guint n_restarts;
+	guint restart_timeout_id;
+	guint n_errors;
+
+	/* MIME type -> MimetypeBreaker, module path -> FailureRate */
+	GHashTable *mimetype_breakers;
+	GHashTable *module_failures;
+	GStrv fallback_mimetypes;
+	guint fallback_timeout_id;
 };
 
 G_DEFINE_TYPE (TrackerExtractWatchdog, tracker_extract_watchdog, G_TYPE_OBJECT)
 
+static void
+emit_status (TrackerExtractWatchdog *watchdog)
+{
+	const gchar *status = "Idle";
+	gdouble progress = 0;
+	gint remaining = 0;
+	guint i, n_busy = 0;
+
+	/* Report the average progress of the busy workers, and the
+	 * time left for the slowest one.
+	 */
+	for (i = 0; i < watchdog->n_workers; i++) {
+		ExtractWorker *worker = &watchdog->workers[i];
+
+		if (!worker->status || g_strcmp0 (worker->status, "Idle") == 0)
+			continue;
+
+		status = worker->status;
+		progress += worker->progress;
+		remaining = MAX (remaining, worker->remaining);
+		n_busy++;
+	}
+
+	if (n_busy > 0)
+		progress /= n_busy;
+	else
+		progress = 1.0;
+
+	g_signal_emit (watchdog, signals[STATUS], 0,
+	               status, progress, remaining);
+}
+
+static void
+get_metrics_cb (GObject      *object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+	ExtractWorker *worker = user_data;
+	g_autoptr (GVariant) reply = NULL, snapshot = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *source = NULL;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object), res, &error);
+	if (!reply) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_debug ("Could not get extractor metrics: %s", error->message);
+		return;
+	}
+
+	snapshot = g_variant_get_child_value (reply, 0);
+	source = g_strdup_printf ("extractor-%u", worker->index);
+	tracker_metrics_set_remote_snapshot (source, snapshot);
+}
+
+static void
+worker_update_metrics (ExtractWorker *worker,
+                       gboolean       idle)
+{
+	gint64 now;
+
+	if (!worker->conn || g_dbus_connection_is_closed (worker->conn))
+		return;
+
+	now = g_get_monotonic_time ();
+	if (!idle && now - worker->metrics_time < METRICS_INTERVAL_USEC)
+		return;
+
+	worker->metrics_time = now;
+	g_dbus_connection_call (worker->conn,
+	                        NULL,
+	                        "/org/freedesktop/Tracker3/Extract",
+	                        "org.freedesktop.Tracker3.Extract",
+	                        "GetMetrics",
+	                        NULL,
+	                        G_VARIANT_TYPE ("(a(stta(ut)))"),
+	                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                        -1,
+	                        worker->cancellable,
+	                        get_metrics_cb,
+	                        worker);
+}
+
+static void
+worker_set_status (ExtractWorker *worker,
+                   const gchar   *status,
+                   gdouble        progress,
+                   gint           remaining)
+{
+	worker_update_metrics (worker, g_strcmp0 (status, "Idle") == 0);
+
+	g_free (worker->status);
+	worker->status = g_strdup (status);
+	worker->progress = progress;
+	worker->remaining = remaining;
+
+	emit_status (worker->watchdog);
+}
+
 static void
 on_extract_progress_cb (GDBusConnection *conn,
                         const gchar     *sender_name,
@@ -72,15 +233,236 @@ on_extract_progress_cb (GDBusConnection *conn,
                         GVariant        *parameters,
                         gpointer         user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractWorker *worker = user_data;
 	const gchar *status;
 	gdouble progress;
 	gint32 remaining;
 
 	g_variant_get (parameters, "(&sdi)",
 	               &status, &progress, &remaining);
-	g_signal_emit (watchdog, signals[STATUS], 0,
-	               status, progress, (gint) remaining);
+	worker_set_status (worker, status, progress, (gint) remaining);
+}
+
+static gboolean
+failure_rate_add (FailureRate *rate,
+                  gint64       now,
+                  guint        threshold)
+{
+	if (rate->period_start == 0 ||
+	    now - rate->period_start >= (gint64) FAILURE_PERIOD * G_USEC_PER_SEC) {
+		rate->period_start = now;
+		rate->n_failures = 0;
+	}
+
+	rate->n_failures++;
+
+	return rate->n_failures >= threshold;
+}
+
+static guint
+get_fallback_backoff (guint n_trips)
+{
+	guint backoff = FALLBACK_BACKOFF_MIN;
+
+	while (n_trips-- > 0 && backoff < FALLBACK_BACKOFF_MAX)
+		backoff *= 2;
+
+	return MIN (backoff, FALLBACK_BACKOFF_MAX);
+}
+
+static void
+trip_breaker (MimetypeBreaker *breaker,
+              const gchar     *mimetype,
+              gint64           now)
+{
+	guint backoff;
+
+	backoff = get_fallback_backoff (breaker->n_trips);
+	breaker->fallback_until = now + (gint64) backoff * G_USEC_PER_SEC;
+	breaker->n_trips++;
+	breaker->rate.period_start = 0;
+
+	g_message ("Extraction of '%s' files failed repeatedly, "
+	           "only basic data is indexed for the next %u seconds",
+	           mimetype, backoff);
+}
+
+static void update_fallback_mimetypes (TrackerExtractWatchdog *watchdog);
+
+static gboolean
+fallback_timeout_cb (gpointer user_data)
+{
+	TrackerExtractWatchdog *watchdog = user_data;
+
+	watchdog->fallback_timeout_id = 0;
+	update_fallback_mimetypes (watchdog);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+reset_fallback_files_cb (GObject      *object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                             res, &error))
+		g_warning ("Could not reset files for extraction: %s", error->message);
+}
+
+/* Files that got basic data only go back to the extractor, which
+ * will find out whether the module works now.
+ */
+static void
+reset_fallback_files (TrackerExtractWatchdog *watchdog,
+                      const gchar            *mimetype)
+{
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (GError) error = NULL;
+
+	stmt = tracker_load_statement (watchdog->sparql_conn,
+	                               "reset-fallback-files.rq", &error);
+	if (!stmt) {
+		g_warning ("Could not reset files of type '%s' for extraction: %s",
+		           mimetype, error->message);
+		return;
+	}
+
+	tracker_sparql_statement_bind_string (stmt, "mimetype", mimetype);
+	tracker_sparql_statement_update_async (stmt, NULL,
+	                                       reset_fallback_files_cb,
+	                                       NULL);
+}
+
+static void
+update_fallback_mimetypes (TrackerExtractWatchdog *watchdog)
+{
+	g_autoptr (GPtrArray) mimetypes = NULL;
+	GHashTableIter iter;
+	MimetypeBreaker *breaker;
+	const gchar *mimetype;
+	gint64 now, next_expiry = 0;
+	guint i;
+
+	now = g_get_monotonic_time ();
+	mimetypes = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, watchdog->mimetype_breakers);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &mimetype, (gpointer *) &breaker)) {
+		if (breaker->fallback_until == 0)
+			continue;
+
+		if (breaker->fallback_until <= now) {
+			g_message ("Extracting '%s' files again", mimetype);
+			breaker->fallback_until = 0;
+			reset_fallback_files (watchdog, mimetype);
+			continue;
+		}
+
+		g_ptr_array_add (mimetypes, (gpointer) mimetype);
+
+		if (next_expiry == 0 || breaker->fallback_until < next_expiry)
+			next_expiry = breaker->fallback_until;
+	}
+
+	g_ptr_array_add (mimetypes, NULL);
+
+	g_clear_pointer (&watchdog->fallback_mimetypes, g_strfreev);
+	watchdog->fallback_mimetypes = g_strdupv ((GStrv) mimetypes->pdata);
+
+	for (i = 0; i < watchdog->n_workers; i++) {
+		ExtractWorker *worker = &watchdog->workers[i];
+
+		if (worker->files_interface) {
+			tracker_files_interface_set_fallback_mimetypes (worker->files_interface,
+			                                                (const gchar * const *) watchdog->fallback_mimetypes);
+		}
+	}
+
+	g_clear_handle_id (&watchdog->fallback_timeout_id, g_source_remove);
+
+	if (next_expiry > 0) {
+		watchdog->fallback_timeout_id =
+			g_timeout_add_seconds ((next_expiry - now + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC,
+			                       fallback_timeout_cb,
+			                       watchdog);
+	}
+}
+
+/* Called for files that crashed or hung the extractor */
+static void
+record_fatal_error (TrackerExtractWatchdog *watchdog,
+                    const gchar            *mimetype)
+{
+	MimetypeBreaker *breaker;
+	FailureRate *module_rate;
+	gboolean tripped = FALSE;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+	breaker = g_hash_table_lookup (watchdog->mimetype_breakers, mimetype);
+
+	if (!breaker) {
+		breaker = g_new0 (MimetypeBreaker, 1);
+		breaker->module_path =
+			tracker_extract_module_manager_get_module_path (mimetype);
+		g_hash_table_insert (watchdog->mimetype_breakers,
+		                     g_strdup (mimetype), breaker);
+	}
+
+	/* Files that were in flight when this was decided */
+	if (breaker->fallback_until > now)
+		return;
+
+	/* Forget about past trips once things were quiet for long */
+	if (breaker->n_trips > 0 &&
+	    now - breaker->fallback_until > (gint64) FALLBACK_BACKOFF_MAX * G_USEC_PER_SEC)
+		breaker->n_trips = 0;
+
+	if (failure_rate_add (&breaker->rate, now, MIMETYPE_FAILURE_THRESHOLD)) {
+		trip_breaker (breaker, mimetype, now);
+		tripped = TRUE;
+	}
+
+	if (breaker->module_path) {
+		module_rate = g_hash_table_lookup (watchdog->module_failures,
+		                                   breaker->module_path);
+		if (!module_rate) {
+			module_rate = g_new0 (FailureRate, 1);
+			g_hash_table_insert (watchdog->module_failures,
+			                     (gpointer) breaker->module_path,
+			                     module_rate);
+		}
+
+		/* The module fails across MIME types, route every type of
+		 * it that failed lately.
+		 */
+		if (failure_rate_add (module_rate, now, MODULE_FAILURE_THRESHOLD)) {
+			GHashTableIter iter;
+			MimetypeBreaker *other;
+			const gchar *other_mimetype;
+
+			g_hash_table_iter_init (&iter, watchdog->mimetype_breakers);
+
+			while (g_hash_table_iter_next (&iter, (gpointer *) &other_mimetype, (gpointer *) &other)) {
+				if (g_strcmp0 (other->module_path, breaker->module_path) != 0 ||
+				    other->fallback_until > now ||
+				    other->rate.period_start == 0 ||
+				    now - other->rate.period_start >= (gint64) FAILURE_PERIOD * G_USEC_PER_SEC)
+					continue;
+
+				trip_breaker (other, other_mimetype, now);
+			}
+
+			module_rate->period_start = 0;
+			tripped = TRUE;
+		}
+	}
+
+	if (tripped)
+		update_fallback_mimetypes (watchdog);
 }
 
 static void
@@ -92,7 +474,9 @@ on_extract_error_cb (GDBusConnection *conn,
                      GVariant        *parameters,
                      gpointer         user_data)
 {
+	ExtractWorker *worker = user_data;
 	g_autoptr (GVariant) uri = NULL, message = NULL, extra = NULL, child = NULL;
+	g_autoptr (GVariant) mimetype = NULL, fatal = NULL;
 	GVariantIter iter;
 	GVariant *value;
 	gchar *key;
@@ -107,6 +491,10 @@ on_extract_error_cb (GDBusConnection *conn,
 			message = g_variant_ref_sink (value);
 		else if (g_strcmp0 (key, "extra-info") == 0)
 			extra = g_variant_ref_sink (value);
+		else if (g_strcmp0 (key, "mimetype") == 0)
+			mimetype = g_variant_ref_sink (value);
+		else if (g_strcmp0 (key, "fatal") == 0)
+			fatal = g_variant_ref_sink (value);
 
 		g_variant_unref (value);
 		g_free (key);
@@ -117,54 +505,76 @@ on_extract_error_cb (GDBusConnection *conn,
 	    (!extra || g_variant_is_of_type (extra, G_VARIANT_TYPE_STRING))) {
 		g_autoptr (GFile) file = NULL;
 
+		worker->watchdog->n_errors++;
+
 		file = g_file_new_for_uri (g_variant_get_string (uri, NULL));
 		tracker_error_report (file,
 		                      g_variant_get_string (message, NULL),
 		                      extra ? g_variant_get_string (extra, NULL) : NULL);
+
+		if (mimetype && g_variant_is_of_type (mimetype, G_VARIANT_TYPE_STRING) &&
+		    fatal && g_variant_is_of_type (fatal, G_VARIANT_TYPE_BOOLEAN) &&
+		    g_variant_get_boolean (fatal))
+			record_fatal_error (worker->watchdog, g_variant_get_string (mimetype, NULL));
 	}
 }
 
 static void
-clear_process_state (TrackerExtractWatchdog *watchdog)
+clear_worker_state (ExtractWorker *worker)
 {
-	if (watchdog->cancellable)
-		g_cancellable_cancel (watchdog->cancellable);
+	if (worker->cancellable)
+		g_cancellable_cancel (worker->cancellable);
 
-	if (watchdog->conn && watchdog->progress_signal_id) {
-		g_dbus_connection_signal_unsubscribe (watchdog->conn,
-		                                      watchdog->progress_signal_id);
-		watchdog->progress_signal_id = 0;
+	if (worker->conn && worker->progress_signal_id) {
+		g_dbus_connection_signal_unsubscribe (worker->conn,
+		                                      worker->progress_signal_id);
+		worker->progress_signal_id = 0;
 	}
 
-	if (watchdog->conn && watchdog->error_signal_id) {
-		g_dbus_connection_signal_unsubscribe (watchdog->conn,
-		                                      watchdog->error_signal_id);
-		watchdog->error_signal_id = 0;
+	if (worker->conn && worker->error_signal_id) {
+		g_dbus_connection_signal_unsubscribe (worker->conn,
+		                                      worker->error_signal_id);
+		worker->error_signal_id = 0;
 	}
 
-	g_clear_object (&watchdog->cancellable);
-	g_clear_object (&watchdog->extract_process);
-	g_clear_object (&watchdog->files_interface);
-	g_clear_object (&watchdog->endpoint);
-	g_clear_object (&watchdog->launcher);
-	g_clear_object (&watchdog->conn);
+	g_clear_object (&worker->cancellable);
+	g_clear_object (&worker->extract_process);
+	g_clear_object (&worker->files_interface);
+	g_clear_object (&worker->endpoint);
+	g_clear_object (&worker->launcher);
+	g_clear_object (&worker->conn);
 }
 
 static void
 tracker_extract_watchdog_finalize (GObject *object)
 {
 	TrackerExtractWatchdog *watchdog = TRACKER_EXTRACT_WATCHDOG (object);
+	guint i;
+
+	g_clear_handle_id (&watchdog->restart_timeout_id, g_source_remove);
+	g_clear_handle_id (&watchdog->fallback_timeout_id, g_source_remove);
+
+	for (i = 0; i < watchdog->n_workers; i++) {
+		ExtractWorker *worker = &watchdog->workers[i];
 
-	if (watchdog->extract_process)
-		g_subprocess_send_signal (watchdog->extract_process, SIGTERM);
+		if (worker->extract_process)
+			g_subprocess_send_signal (worker->extract_process, SIGTERM);
 
-	clear_process_state (watchdog);
+		clear_worker_state (worker);
 
-	if (watchdog->persistence_fd)
-		close (watchdog->persistence_fd);
+		if (worker->persistence_fd >= 0)
+			close (worker->persistence_fd);
 
+		g_free (worker->status);
+	}
+
+	g_free (watchdog->workers);
+	g_hash_table_unref (watchdog->mimetype_breakers);
+	g_hash_table_unref (watchdog->module_failures);
+	g_strfreev (watchdog->fallback_mimetypes);
 	g_clear_object (&watchdog->sparql_conn);
 	g_clear_object (&watchdog->indexing_tree);
+	g_clear_object (&watchdog->store_location);
 
 	G_OBJECT_CLASS (tracker_extract_watchdog_parent_class)->finalize (object);
 }
@@ -232,8 +642,26 @@ tracker_extract_watchdog_class_init (TrackerExtractWatchdogClass *klass)
 static void
 tracker_extract_watchdog_init (TrackerExtractWatchdog *watchdog)
 {
-	watchdog->cancellable = g_cancellable_new ();
-	watchdog->persistence_fd = -1;
+	guint i;
+
+	/* Every extractor process runs a pool of threads already, a
+	 * few processes are enough to keep extraction going while a
+	 * crashed one is replaced.
+	 */
+	watchdog->n_workers = CLAMP (g_get_num_processors () / 4,
+	                             1, MAX_EXTRACT_WORKERS);
+	watchdog->workers = g_new0 (ExtractWorker, watchdog->n_workers);
+
+	for (i = 0; i < watchdog->n_workers; i++) {
+		watchdog->workers[i].watchdog = watchdog;
+		watchdog->workers[i].index = i;
+		watchdog->workers[i].persistence_fd = -1;
+	}
+
+	watchdog->mimetype_breakers =
+		g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	watchdog->module_failures =
+		g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
 }
 
 TrackerExtractWatchdog *
@@ -251,20 +679,23 @@ on_new_connection_cb (GObject      *object,
                       GAsyncResult *res,
                       gpointer      user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractWorker *worker = user_data;
+	GDBusConnection *conn;
 	g_autoptr (GError) error = NULL;
 
-	watchdog->conn = g_dbus_connection_new_finish (res, &error);
-	if (!watchdog->conn) {
+	conn = g_dbus_connection_new_finish (res, &error);
+	if (!conn) {
 		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			g_warning ("Could not create peer-to-peer D-Bus connection: %s", error->message);
 		return;
 	}
 
+	worker->conn = conn;
+
 	/* Create an endpoint for this peer-to-peer connection */
-	watchdog->endpoint =
-		TRACKER_ENDPOINT (tracker_endpoint_dbus_new (watchdog->sparql_conn,
-		                                             watchdog->conn,
+	worker->endpoint =
+		TRACKER_ENDPOINT (tracker_endpoint_dbus_new (worker->watchdog->sparql_conn,
+		                                             worker->conn,
 		                                             NULL, NULL,
 		                                             &error));
 	if (error) {
@@ -273,11 +704,11 @@ on_new_connection_cb (GObject      *object,
 	}
 
 	/* Disallow access to further endpoints */
-	tracker_endpoint_set_allowed_services (watchdog->endpoint,
+	tracker_endpoint_set_allowed_services (worker->endpoint,
 	                                       (const gchar *[]) { NULL });
 
-	watchdog->progress_signal_id =
-		g_dbus_connection_signal_subscribe (watchdog->conn,
+	worker->progress_signal_id =
+		g_dbus_connection_signal_subscribe (worker->conn,
 		                                    NULL,
 		                                    "org.freedesktop.Tracker3.Miner",
 		                                    "Progress",
@@ -285,10 +716,10 @@ on_new_connection_cb (GObject      *object,
 		                                    NULL,
 		                                    G_DBUS_SIGNAL_FLAGS_NONE,
 		                                    on_extract_progress_cb,
-		                                    watchdog,
+		                                    worker,
 		                                    NULL);
-	watchdog->error_signal_id =
-		g_dbus_connection_signal_subscribe (watchdog->conn,
+	worker->error_signal_id =
+		g_dbus_connection_signal_subscribe (worker->conn,
 		                                    NULL,
 		                                    "org.freedesktop.Tracker3.Extract",
 		                                    "Error",
@@ -296,21 +727,29 @@ on_new_connection_cb (GObject      *object,
 		                                    NULL,
 		                                    G_DBUS_SIGNAL_FLAGS_NONE,
 		                                    on_extract_error_cb,
-		                                    watchdog,
+		                                    worker,
 		                                    NULL);
 
-	if (watchdog->persistence_fd >= 0) {
-		watchdog->files_interface =
-			tracker_files_interface_new_with_fd (watchdog->conn,
-			                                     watchdog->persistence_fd);
+	/* The persistence storage outlives the process, so a respawned
+	 * worker skips the file its predecessor crashed on.
+	 */
+	if (worker->persistence_fd >= 0) {
+		worker->files_interface =
+			tracker_files_interface_new_with_fd (worker->conn,
+			                                     worker->persistence_fd);
 	} else {
-		watchdog->files_interface =
-			tracker_files_interface_new (watchdog->conn);
-		watchdog->persistence_fd =
-			tracker_files_interface_dup_fd (watchdog->files_interface);
+		worker->files_interface =
+			tracker_files_interface_new (worker->conn);
+		worker->persistence_fd =
+			tracker_files_interface_dup_fd (worker->files_interface);
 	}
 
-	g_dbus_connection_start_message_processing (watchdog->conn);
+	if (worker->watchdog->fallback_mimetypes) {
+		tracker_files_interface_set_fallback_mimetypes (worker->files_interface,
+		                                                (const gchar * const *) worker->watchdog->fallback_mimetypes);
+	}
+
+	g_dbus_connection_start_message_processing (worker->conn);
 }
 
 static void
@@ -318,21 +757,25 @@ wait_check_async_cb (GObject      *object,
                      GAsyncResult *res,
                      gpointer      user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractWorker *worker = user_data;
 	g_autoptr (GError) error = NULL;
 
-	if (!g_subprocess_wait_check_finish (watchdog->extract_process,
+	if (!g_subprocess_wait_check_finish (G_SUBPROCESS (object),
 	                                     res, &error)) {
 		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			return;
 
-		g_warning ("Extractor subprocess died unexpectedly: %s", error->message);
-		g_signal_emit (watchdog, signals[LOST], 0);
+		g_warning ("Extractor subprocess %u died unexpectedly: %s",
+		           worker->index, error->message);
+		worker->crashed = TRUE;
+		g_signal_emit (worker->watchdog, signals[LOST], 0);
+	} else {
+		worker->crashed = FALSE;
 	}
 
-	clear_process_state (watchdog);
+	clear_worker_state (worker);
 
-	g_signal_emit (watchdog, signals[STATUS], 0, "Idle", 1.0, 0);
+	worker_set_status (worker, "Idle", 1.0, 0);
 }
 
 static GStrv
@@ -371,17 +814,17 @@ extractor_child_setup (gpointer user_data)
 }
 
 static gboolean
-setup_context (TrackerExtractWatchdog  *watchdog,
-               GError                 **error)
+setup_context (ExtractWorker  *worker,
+               GError        **error)
 {
 	g_autoptr (GSocket) socket = NULL;
 	g_autoptr (GIOStream) stream = NULL;
 	g_autofree gchar *guid = NULL;
 	int fd_pair[2];
 
-	clear_process_state (watchdog);
+	clear_worker_state (worker);
 
-	watchdog->cancellable = g_cancellable_new ();
+	worker->cancellable = g_cancellable_new ();
 
 	if (socketpair (AF_LOCAL, SOCK_STREAM, 0, fd_pair)) {
 		g_set_error (error,
@@ -391,15 +834,15 @@ setup_context (TrackerExtractWatchdog  *watchdog,
 		return FALSE;
 	}
 
-	watchdog->launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
-	g_subprocess_launcher_take_fd (watchdog->launcher, fd_pair[1], REMOTE_FD_NUMBER);
-	g_subprocess_launcher_setenv (watchdog->launcher,
+	worker->launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+	g_subprocess_launcher_take_fd (worker->launcher, fd_pair[1], REMOTE_FD_NUMBER);
+	g_subprocess_launcher_setenv (worker->launcher,
 	                              "GVFS_REMOTE_VOLUME_MONITOR_IGNORE", "1",
 	                              TRUE);
 
-	g_subprocess_launcher_set_child_setup (watchdog->launcher,
+	g_subprocess_launcher_set_child_setup (worker->launcher,
 	                                       extractor_child_setup,
-	                                       get_indexed_folders (watchdog),
+	                                       get_indexed_folders (worker->watchdog),
 	                                       (GDestroyNotify) g_strfreev);
 
 	socket = g_socket_new_from_fd (fd_pair[0], error);
@@ -418,23 +861,23 @@ setup_context (TrackerExtractWatchdog  *watchdog,
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER |
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_ALLOW_ANONYMOUS |
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_REQUIRE_SAME_USER,
-	                       NULL, watchdog->cancellable,
-	                       on_new_connection_cb, watchdog);
+	                       NULL, worker->cancellable,
+	                       on_new_connection_cb, worker);
 
 	return TRUE;
 }
 
-void
-tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
+static void
+start_worker (ExtractWorker *worker)
 {
 	g_autoptr (GError) error = NULL;
 	g_autofree gchar *current_dir = NULL;
+	g_autofree gchar *partition = NULL, *n_partitions = NULL;
+	g_autofree gchar *store_path = NULL;
+	g_autoptr (GPtrArray) argv = NULL;
 	const gchar *extract_path;
 
-	if (watchdog->extract_process)
-		return;
-
-	if (!setup_context (watchdog, &error)) {
+	if (!setup_context (worker, &error)) {
 		g_critical ("Could not setup context to spawn metadata extractor: %s", error->message);
 		return;
 	}
@@ -446,18 +889,207 @@ tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
 	else
 		extract_path = LIBEXECDIR "/localsearch-extractor-3";
 
-	watchdog->extract_process =
-		g_subprocess_launcher_spawn (watchdog->launcher,
-		                             &error,
-		                             extract_path,
-		                             "--socket-fd", G_STRINGIFY (REMOTE_FD_NUMBER),
-		                             NULL);
-
-	if (watchdog->extract_process) {
-		g_subprocess_wait_check_async (watchdog->extract_process,
-		                               watchdog->cancellable,
-		                               wait_check_async_cb, watchdog);
+	partition = g_strdup_printf ("%u", worker->index);
+	n_partitions = g_strdup_printf ("%u", worker->watchdog->n_workers);
+
+	argv = g_ptr_array_new ();
+	g_ptr_array_add (argv, (gpointer) extract_path);
+	g_ptr_array_add (argv, "--socket-fd");
+	g_ptr_array_add (argv, G_STRINGIFY (REMOTE_FD_NUMBER));
+	g_ptr_array_add (argv, "--partition");
+	g_ptr_array_add (argv, partition);
+	g_ptr_array_add (argv, "--n-partitions");
+	g_ptr_array_add (argv, n_partitions);
+
+	/* Let the extractor look up pending files in the database */
+	if (worker->watchdog->store_location)
+		store_path = g_file_get_path (worker->watchdog->store_location);
+	if (store_path) {
+		g_ptr_array_add (argv, "--store-dir");
+		g_ptr_array_add (argv, store_path);
+	}
+
+	g_ptr_array_add (argv, NULL);
+
+	worker->extract_process =
+		g_subprocess_launcher_spawnv (worker->launcher,
+		                              (const gchar * const *) argv->pdata,
+		                              &error);
+
+	if (worker->extract_process) {
+		g_subprocess_wait_check_async (worker->extract_process,
+		                               worker->cancellable,
+		                               wait_check_async_cb, worker);
 	} else {
 		g_warning ("Could not launch metadata extractor: %s", error->message);
 	}
 }
+
+static gboolean
+restart_timeout_cb (gpointer user_data)
+{
+	TrackerExtractWatchdog *watchdog = user_data;
+
+	watchdog->restart_timeout_id = 0;
+	tracker_extract_watchdog_ensure_started (watchdog);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+consume_restart (TrackerExtractWatchdog *watchdog)
+{
+	gint64 now, period_end;
+
+	now = g_get_monotonic_time ();
+	period_end = watchdog->restart_period_start +
+		RESTART_PERIOD * G_USEC_PER_SEC;
+
+	if (watchdog->restart_period_start == 0 || now >= period_end) {
+		watchdog->restart_period_start = now;
+		watchdog->n_restarts = 0;
+	}
+
+	if (watchdog->n_restarts < RESTART_BUDGET) {
+		watchdog->n_restarts++;
+		return TRUE;
+	}
+
+	/* Retry once the current period is over */
+	if (watchdog->restart_timeout_id == 0) {
+		guint seconds;
+
+		seconds = (period_end - now + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC;
+		g_debug ("Extractor restart budget exhausted, retrying in %u seconds",
+		         seconds);
+		watchdog->restart_timeout_id =
+			g_timeout_add_seconds (MAX (seconds, 1),
+			                       restart_timeout_cb,
+			                       watchdog);
+	}
+
+	return FALSE;
+}
+
+void
+tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
+{
+	guint i;
+
+	for (i = 0; i < watchdog->n_workers; i++) {
+		ExtractWorker *worker = &watchdog->workers[i];
+
+		if (worker->extract_process)
+			continue;
+
+		if (worker->crashed && !consume_restart (watchdog))
+			continue;
+
+		start_worker (worker);
+	}
+}
+
+static void
+extract_file_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+	g_autoptr (GTask) task = user_data;
+	g_autoptr (GVariant) reply = NULL;
+	g_autoptr (GError) error = NULL;
+	guint *n_pending;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object), res, &error);
+
+	/* Extraction is best effort, the file is in the store already */
+	if (!reply && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_debug ("Could not extract file right away: %s", error->message);
+
+	n_pending = g_task_get_task_data (task);
+	(*n_pending)--;
+
+	if (*n_pending == 0)
+		g_task_return_boolean (task, TRUE);
+}
+
+/* Each worker only looks at the files in its own partition, so all of
+ * them are asked, the one handling the file replies once its metadata
+ * is committed.
+ */
+void
+tracker_extract_watchdog_extract_file_async (TrackerExtractWatchdog *watchdog,
+                                             const gchar            *uri,
+                                             GCancellable           *cancellable,
+                                             GAsyncReadyCallback     callback,
+                                             gpointer                user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	guint *n_pending;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT_WATCHDOG (watchdog));
+	g_return_if_fail (uri != NULL);
+
+	task = g_task_new (watchdog, cancellable, callback, user_data);
+	n_pending = g_new0 (guint, 1);
+	g_task_set_task_data (task, n_pending, g_free);
+
+	tracker_extract_watchdog_ensure_started (watchdog);
+
+	for (i = 0; i < watchdog->n_workers; i++) {
+		ExtractWorker *worker = &watchdog->workers[i];
+
+		if (!worker->conn || g_dbus_connection_is_closed (worker->conn))
+			continue;
+
+		(*n_pending)++;
+		g_dbus_connection_call (worker->conn,
+		                        NULL,
+		                        "/org/freedesktop/Tracker3/Extract",
+		                        "org.freedesktop.Tracker3.Extract",
+		                        "ExtractFile",
+		                        g_variant_new ("(s)", uri),
+		                        NULL,
+		                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+		                        -1,
+		                        cancellable,
+		                        extract_file_cb,
+		                        g_object_ref (task));
+	}
+
+	/* Extractors that are still starting up find the file on their own */
+	if (*n_pending == 0)
+		g_task_return_boolean (task, TRUE);
+}
+
+gboolean
+tracker_extract_watchdog_extract_file_finish (TrackerExtractWatchdog  *watchdog,
+                                              GAsyncResult            *res,
+                                              GError                 **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, watchdog), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/* Extractors started from now on read the database at @location
+ * directly to find the files to extract, %NULL makes them query
+ * the miner instead, e.g. if the database is in memory.
+ */
+void
+tracker_extract_watchdog_set_store_location (TrackerExtractWatchdog *watchdog,
+                                             GFile                  *location)
+{
+	g_return_if_fail (TRACKER_IS_EXTRACT_WATCHDOG (watchdog));
+	g_return_if_fail (!location || G_IS_FILE (location));
+
+	g_set_object (&watchdog->store_location, location);
+}
+
+guint
+tracker_extract_watchdog_get_n_errors (TrackerExtractWatchdog *watchdog)
+{
+	g_return_val_if_fail (TRACKER_IS_EXTRACT_WATCHDOG (watchdog), 0);
+
+	return watchdog->n_errors;
+}
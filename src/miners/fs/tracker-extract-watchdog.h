@@ -38,6 +38,21 @@ TrackerExtractWatchdog * tracker_extract_watchdog_new (TrackerSparqlConnection *
 
 void tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog);
 
+void tracker_extract_watchdog_set_store_location (TrackerExtractWatchdog *watchdog,
+                                                  GFile                  *location);
+
+guint tracker_extract_watchdog_get_n_errors (TrackerExtractWatchdog *watchdog);
+
+void tracker_extract_watchdog_extract_file_async (TrackerExtractWatchdog *watchdog,
+                                                  const gchar            *uri,
+                                                  GCancellable           *cancellable,
+                                                  GAsyncReadyCallback     callback,
+                                                  gpointer                user_data);
+
+gboolean tracker_extract_watchdog_extract_file_finish (TrackerExtractWatchdog  *watchdog,
+                                                       GAsyncResult            *res,
+                                                       GError                 **error);
+
 G_END_DECLS
 
 #endif /* __TRACKER_EXTRACT_WATCHDOG_H__ */
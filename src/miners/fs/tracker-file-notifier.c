@@ -21,11 +21,18 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include <libtracker-miners-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-file-notifier.h"
+#include "tracker-lru.h"
+#include "tracker-mem-pool.h"
 #include "tracker-monitor-glib.h"
+#include "tracker-native-crawler.h"
+#include "tracker-spill-queue.h"
+#include "tracker-storage.h"
 #include "tracker-utils.h"
 
 #include <tinysparql.h>
@@ -44,11 +51,14 @@ enum {
 	FILE_MOVED,
 	DIRECTORY_STARTED,
 	DIRECTORY_FINISHED,
+	LEVEL_FINISHED,
 	FINISHED,
+	HOT_FILE,
 	LAST_SIGNAL
 };
 
 static guint signals[LAST_SIGNAL] = { 0 };
+static TrackerMemPool *file_data_pool = NULL;
 
 enum {
 	FILE_STATE_NONE,
@@ -66,66 +76,186 @@ typedef struct {
 	guint is_dir_in_disk : 1;
 	guint is_dir_in_store : 1;
 	guint state : 3;
-	GDateTime *store_mtime;
-	GDateTime *disk_mtime;
-	gchar *extractor_hash;
-	gchar *mimetype;
+	/* Kept compact, there may be one of these for every file
+	 * in an indexed root. Times are in microseconds, strings
+	 * are interned as there are only a few distinct ones.
+	 */
+	gint64 store_mtime;
+	gint64 disk_mtime;
+	const gchar *extractor_hash;
+	const gchar *mimetype;
 } TrackerFileData;
 
 typedef struct {
 	TrackerFileNotifier *notifier;
+	TrackerSparqlStatement *content_query;
 	TrackerSparqlCursor *cursor;
 	GFile *root;
-	GFileEnumerator *enumerator;
 	GCancellable *cancellable;
 	GHashTable *cache;
 	GQueue queue;
 	GQueue deleted_dirs;
-	GFile *current_dir;
 	GQueue *pending_dirs;
+	TrackerSpillQueue *spilled_dirs;
+	GQueue crawling_dirs;
+	GQueue parked_crawls;
+	/* For progressive roots, the directories pending or being
+	 * crawled at each depth, and the levels fully crawled.
+	 */
+	GArray *level_dirs;
+	guint levels_finished;
 	GTimer *timer;
 	guint flags;
 	guint cursor_idle_id;
+	guint n_crawls;
+	guint32 device;
 	guint directories_found;
 	guint directories_ignored;
 	guint files_found;
 	guint files_ignored;
 	guint ignore_root : 1;
 	guint cursor_has_content : 1;
+	guint from_scratch : 1;
+	guint device_known : 1;
+	guint paused : 1;
+	guint trusted : 1;
+	guint inode_order : 1;
+	guint inode_order_known : 1;
 } TrackerIndexRoot;
 
+/* A directory being enumerated within an index root. These are
+ * owned by the async operations, so they are freed on cancellation
+ * without touching the (possibly already freed) root.
+ */
+typedef struct {
+	TrackerIndexRoot *root;
+	GFile *directory;
+	GFileEnumerator *enumerator;
+	GCancellable *cancellable;
+	gint64 enumerate_start;
+	guint contents_checked : 1;
+} TrackerDirectoryCrawl;
+
 typedef struct {
 	TrackerIndexingTree *indexing_tree;
 
 	TrackerSparqlConnection *connection;
-	GCancellable *cancellable;
 
 	TrackerMonitor *monitor;
 
+	TrackerStorage *storage;
+
 	TrackerSparqlStatement *content_query;
 	TrackerSparqlStatement *deleted_query;
 
+	/* Looks for stored content matching new filters */
+	GCancellable *filters_cancellable;
+
 	gchar *file_attributes;
 
 	/* List of pending directory
 	 * trees to get data from
 	 */
 	GList *pending_index_roots;
-	TrackerIndexRoot *current_index_root;
+	GList *active_index_roots;
+	guint max_crawled_roots;
+	guint max_crawled_directories;
+
+	/* Directories pending a check after monitor overflows */
+	GList *overflow_dirs;
+	gint64 last_overflow_check;
+	guint overflow_id;
+
+	/* Crawl frontier. Directories in the store whose contents
+	 * may not be, either because crawling them was interrupted
+	 * or because changes found there are not processed yet.
+	 */
+	GHashTable *resume_dirs;
+	GHashTable *unprocessed_dirs;
+	GFile *checkpoint_file;
+	gint64 last_checkpoint;
+	guint checkpoint_saved : 1;
+
+	/* Directories with monitor events since everything was last
+	 * processed, they are part of the frontier too.
+	 */
+	GHashTable *journal_dirs;
+
+	/* Roots whose contents were all processed, and since when.
+	 * The ones listed on startup may be trusted to be consistent
+	 * with the store, so only their frontier is crawled.
+	 */
+	GHashTable *consistent_roots;
+	GHashTable *trusted_roots;
+	GHashTable *root_generations;
+	GFile *consistent_roots_file;
+
+	/* Directories with recent monitor events, and the ones
+	 * holding files in the XDG recently used files list.
+	 */
+	TrackerLRU *active_dirs;
+	GHashTable *recent_dirs;
+	GFileMonitor *recent_files_monitor;
+	gchar *recent_files_path;
+	guint recent_files_id;
 
 	guint stopped : 1;
 	guint high_water : 1;
-	guint active : 1;
+	guint overflow_all : 1;
+	guint native_crawl : 1;
 } TrackerFileNotifierPrivate;
 
 #define N_CURSOR_BATCH_ITEMS 200
+
+/* Attributes needed to tell whether a file in the store changed,
+ * the full set is only queried for files that did.
+ */
+#define CHECK_FILE_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED
+#define CHECK_DIRECTORY_ATTRIBUTES \
+	CHECK_FILE_ATTRIBUTES "," \
+	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT
 #define N_ENUMERATOR_BATCH_ITEMS 200
 
+/* Pending directories kept in memory for each root, further ones
+ * found while crawling wide trees are spilled to disk.
+ */
+#define MAX_PENDING_DIRS 4096
+
+/* Roots are crawled in parallel only if they are on different
+ * devices, directories within a root are crawled one at a time
+ * unless told otherwise.
+ */
+#define DEFAULT_MAX_CRAWLED_ROOTS 4
+#define DEFAULT_MAX_CRAWLED_DIRECTORIES 1
+
+/* Overflows come in bursts under heavy write loads. Checks are
+ * delayed a bit so further overflows are coalesced, and happen
+ * at most once every OVERFLOW_CHECK_INTERVAL seconds.
+ */
+#define OVERFLOW_CHECK_DELAY 2
+#define OVERFLOW_CHECK_INTERVAL 30
+
+/* Minimum interval in seconds between crawl checkpoints */
+#define CHECKPOINT_INTERVAL 10
+
+/* Monitor events on files in directories that changed within the
+ * last ACTIVE_DIRECTORY_TIMEOUT seconds, or that hold files used in
+ * the last RECENT_FILE_MAX_AGE seconds, are hot, see ::hot-file.
+ */
+#define ACTIVE_DIRECTORY_TIMEOUT 300
+#define MAX_ACTIVE_DIRECTORIES 64
+#define RECENT_FILE_MAX_AGE (7 * 24 * 60 * 60)
+#define RECENT_FILES_RELOAD_DELAY 2
+
 static gboolean tracker_index_root_query_contents (TrackerIndexRoot *root);
 static gboolean tracker_index_root_crawl_next (TrackerIndexRoot *root);
 static gboolean tracker_index_root_continue_cursor (TrackerIndexRoot *root);
 static void tracker_index_root_continue (TrackerIndexRoot *root);
 
+static void tracker_directory_crawl_free (TrackerDirectoryCrawl *crawl);
+
 static TrackerSparqlStatement * sparql_contents_ensure_statement (TrackerFileNotifier  *notifier,
                                                                   GError              **error);
 
@@ -187,11 +317,18 @@ static void
 file_data_free (TrackerFileData *file_data)
 {
 	g_object_unref (file_data->file);
-	g_clear_pointer (&file_data->store_mtime, g_date_time_unref);
-	g_clear_pointer (&file_data->disk_mtime, g_date_time_unref);
-	g_free (file_data->extractor_hash);
-	g_free (file_data->mimetype);
-	g_slice_free (TrackerFileData, file_data);
+	TRACKER_MEMORY_FREE (NOTIFIER, sizeof (TrackerFileData));
+	tracker_mem_pool_recycle (file_data_pool, file_data);
+}
+
+static gint64
+datetime_to_usec (GDateTime *datetime)
+{
+	if (!datetime)
+		return 0;
+
+	return (g_date_time_to_unix (datetime) * G_USEC_PER_SEC) +
+		g_date_time_get_microsecond (datetime);
 }
 
 static TrackerIndexRoot *
@@ -203,6 +340,7 @@ tracker_index_root_new (TrackerFileNotifier *notifier,
 	TrackerIndexRoot *data;
 
 	data = g_new0 (TrackerIndexRoot, 1);
+	TRACKER_MEMORY_ALLOC (NOTIFIER, sizeof (TrackerIndexRoot));
 	data->notifier = notifier;
 	data->root = g_object_ref (file);
 	data->pending_dirs = g_queue_new ();
@@ -211,6 +349,8 @@ tracker_index_root_new (TrackerFileNotifier *notifier,
 	data->timer = g_timer_new ();
 
 	g_queue_init (&data->deleted_dirs);
+	g_queue_init (&data->crawling_dirs);
+	g_queue_init (&data->parked_crawls);
 	g_queue_init (&data->queue);
 	data->cache = g_hash_table_new_full (g_file_hash,
 	                                     (GEqualFunc) g_file_equal,
@@ -220,23 +360,289 @@ tracker_index_root_new (TrackerFileNotifier *notifier,
 	return data;
 }
 
+static void
+add_resume_dir (GFile      *directory,
+                GHashTable *resume_dirs)
+{
+	g_hash_table_add (resume_dirs, g_object_ref (directory));
+}
+
 static void
 tracker_index_root_free (TrackerIndexRoot *data)
 {
-	g_queue_free_full (data->pending_dirs, (GDestroyNotify) g_object_unref);
+	TrackerFileNotifierPrivate *priv;
+
+	priv = tracker_file_notifier_get_instance_private (data->notifier);
+
+	if (data->cancellable)
+		g_cancellable_cancel (data->cancellable);
+
+	/* Give the statement back for other roots to use */
+	if (data->content_query && !priv->content_query)
+		priv->content_query = g_steal_pointer (&data->content_query);
+
+	/* The crawl was interrupted. Directories not fully crawled
+	 * might already be in the store with an up to date mtime,
+	 * make sure they are crawled when the root is checked again.
+	 */
+	while (!g_queue_is_empty (&data->crawling_dirs)) {
+		g_hash_table_add (priv->resume_dirs,
+		                  g_object_ref (g_queue_pop_head (&data->crawling_dirs)));
+	}
+
+	while (!g_queue_is_empty (data->pending_dirs))
+		g_hash_table_add (priv->resume_dirs, g_queue_pop_head (data->pending_dirs));
+
+	if (data->spilled_dirs) {
+		tracker_spill_queue_foreach (data->spilled_dirs,
+		                             (GFunc) add_resume_dir,
+		                             priv->resume_dirs);
+		tracker_spill_queue_free (data->spilled_dirs);
+	}
+
+	/* Crawls waiting on high water are not owned by any operation */
+	g_queue_clear_full (&data->parked_crawls,
+	                    (GDestroyNotify) tracker_directory_crawl_free);
+
+	g_queue_free (data->pending_dirs);
+	g_clear_pointer (&data->level_dirs, g_array_unref);
 	g_timer_destroy (data->timer);
 	g_queue_clear (&data->queue);
 	g_queue_clear_full (&data->deleted_dirs, g_object_unref);
 	g_hash_table_destroy (data->cache);
-	g_clear_object (&data->enumerator);
-	g_clear_object (&data->current_dir);
 	g_clear_object (&data->cursor);
+	g_clear_object (&data->content_query);
 	g_clear_handle_id (&data->cursor_idle_id, g_source_remove);
 	g_clear_object (&data->cancellable);
 	g_object_unref (data->root);
+	TRACKER_MEMORY_FREE (NOTIFIER, sizeof (TrackerIndexRoot));
 	g_free (data);
 }
 
+static guint32
+tracker_index_root_get_device (TrackerIndexRoot *root)
+{
+	if (!root->device_known) {
+		g_autoptr (GFileInfo) info = NULL;
+
+		info = g_file_query_info (root->root,
+		                          G_FILE_ATTRIBUTE_UNIX_DEVICE,
+		                          G_FILE_QUERY_INFO_NONE,
+		                          NULL, NULL);
+		if (info) {
+			root->device =
+				g_file_info_get_attribute_uint32 (info,
+				                                  G_FILE_ATTRIBUTE_UNIX_DEVICE);
+		}
+
+		root->device_known = TRUE;
+	}
+
+	return root->device;
+}
+
+/* On rotational disks, directory entries are handled in inode order,
+ * which follows their layout on disk closer than the order in which
+ * directories list them, or their names.
+ */
+static gboolean
+tracker_index_root_use_inode_order (TrackerIndexRoot *root)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	if (!root->inode_order_known) {
+		priv = tracker_file_notifier_get_instance_private (root->notifier);
+		root->inode_order =
+			priv->storage &&
+			g_file_is_native (root->root) &&
+			tracker_storage_is_rotational (priv->storage, root->root,
+			                               tracker_index_root_get_device (root));
+		root->inode_order_known = TRUE;
+
+		if (root->inode_order) {
+			TRACKER_NOTE (MINER_FS_EVENTS,
+			              g_message ("Crawling '%s' in inode order",
+			                         g_file_peek_path (root->root)));
+		}
+	}
+
+	return root->inode_order;
+}
+
+static gint
+compare_inodes (GFileInfo *info_a,
+                GFileInfo *info_b)
+{
+	guint64 inode_a, inode_b;
+
+	inode_a = g_file_info_get_attribute_uint64 (info_a, G_FILE_ATTRIBUTE_UNIX_INODE);
+	inode_b = g_file_info_get_attribute_uint64 (info_b, G_FILE_ATTRIBUTE_UNIX_INODE);
+
+	return (inode_a > inode_b) - (inode_a < inode_b);
+}
+
+static void
+tracker_index_root_emit_level_finished (TrackerIndexRoot *root)
+{
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("  Crawled level %u of '%s' after %2.2f seconds, "
+	                         "found %d directories and %d files so far",
+	                         root->levels_finished,
+	                         g_file_peek_path (root->root),
+	                         g_timer_elapsed (root->timer, NULL),
+	                         root->directories_found,
+	                         root->files_found));
+
+	g_signal_emit (root->notifier, signals[LEVEL_FINISHED], 0,
+	               root->root,
+	               root->levels_finished,
+	               root->directories_found,
+	               root->files_found);
+}
+
+/* Directories are crawled in the order they are found, so all of a
+ * level is crawled before the next one. A level is finished once
+ * no directory up to its depth is left to crawl.
+ */
+static void
+tracker_index_root_count_directory (TrackerIndexRoot *root,
+                                    GFile            *directory,
+                                    gint              delta)
+{
+	guint depth, *count;
+
+	if ((root->flags & TRACKER_DIRECTORY_FLAG_PROGRESSIVE) == 0)
+		return;
+
+	if (!root->level_dirs)
+		root->level_dirs = g_array_new (FALSE, TRUE, sizeof (guint));
+
+	depth = tracker_file_get_depth (root->root, directory);
+	if (depth >= root->level_dirs->len)
+		g_array_set_size (root->level_dirs, depth + 1);
+
+	count = &g_array_index (root->level_dirs, guint, depth);
+
+	if (delta > 0) {
+		*count += delta;
+		return;
+	}
+
+	*count -= MIN (*count, (guint) -delta);
+
+	while (root->levels_finished < root->level_dirs->len &&
+	       g_array_index (root->level_dirs, guint, root->levels_finished) == 0) {
+		tracker_index_root_emit_level_finished (root);
+		root->levels_finished++;
+	}
+}
+
+static void
+tracker_index_root_queue_directory (TrackerIndexRoot *root,
+                                    GFile            *directory)
+{
+	tracker_index_root_count_directory (root, directory, 1);
+
+	/* Once spilling, newer directories go after the spilled ones */
+	if ((root->spilled_dirs &&
+	     tracker_spill_queue_get_length (root->spilled_dirs) > 0) ||
+	    g_queue_get_length (root->pending_dirs) >= MAX_PENDING_DIRS) {
+		if (!root->spilled_dirs)
+			root->spilled_dirs = tracker_spill_queue_new ();
+
+		if (tracker_spill_queue_push (root->spilled_dirs, directory))
+			return;
+	}
+
+	g_queue_push_tail (root->pending_dirs, g_object_ref (directory));
+}
+
+static gboolean
+tracker_index_root_has_pending_dirs (TrackerIndexRoot *root)
+{
+	return (!g_queue_is_empty (root->pending_dirs) ||
+	        (root->spilled_dirs &&
+	         tracker_spill_queue_get_length (root->spilled_dirs) > 0));
+}
+
+static GFile *
+tracker_index_root_pop_directory (TrackerIndexRoot *root)
+{
+	TrackerFileNotifierPrivate *priv;
+	GFile *directory;
+
+	priv = tracker_file_notifier_get_instance_private (root->notifier);
+
+	/* Bring spilled directories back in batches, leaving room
+	 * for the directories found while crawling them.
+	 */
+	while (root->spilled_dirs &&
+	       g_queue_get_length (root->pending_dirs) < MAX_PENDING_DIRS / 2 &&
+	       (directory = tracker_spill_queue_pop (root->spilled_dirs)) != NULL) {
+		/* Configuration might have changed in the meantime */
+		if (tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+		                                             directory, NULL)) {
+			g_queue_push_tail (root->pending_dirs, directory);
+		} else {
+			tracker_index_root_count_directory (root, directory, -1);
+			g_object_unref (directory);
+		}
+	}
+
+	return g_queue_pop_head (root->pending_dirs);
+}
+
+static TrackerDirectoryCrawl *
+tracker_directory_crawl_new (TrackerIndexRoot *root,
+                             GFile            *directory)
+{
+	TrackerDirectoryCrawl *crawl;
+
+	crawl = g_slice_new0 (TrackerDirectoryCrawl);
+	TRACKER_MEMORY_ALLOC (NOTIFIER, sizeof (TrackerDirectoryCrawl));
+	crawl->root = root;
+	crawl->directory = g_object_ref (directory);
+	crawl->cancellable = g_object_ref (root->cancellable);
+	g_queue_push_tail (&root->crawling_dirs, crawl->directory);
+	root->n_crawls++;
+
+	return crawl;
+}
+
+static void
+tracker_directory_crawl_free (TrackerDirectoryCrawl *crawl)
+{
+	g_clear_object (&crawl->enumerator);
+	g_object_unref (crawl->directory);
+	g_object_unref (crawl->cancellable);
+	TRACKER_MEMORY_FREE (NOTIFIER, sizeof (TrackerDirectoryCrawl));
+	g_slice_free (TrackerDirectoryCrawl, crawl);
+}
+
+static gboolean
+tracker_directory_crawl_cancelled (TrackerDirectoryCrawl *crawl)
+{
+	/* The index root was already freed, nothing else to do */
+	if (g_cancellable_is_cancelled (crawl->cancellable)) {
+		tracker_directory_crawl_free (crawl);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+tracker_directory_crawl_finish (TrackerDirectoryCrawl *crawl)
+{
+	TrackerIndexRoot *root = crawl->root;
+
+	g_queue_remove (&root->crawling_dirs, crawl->directory);
+	root->n_crawls--;
+	tracker_index_root_count_directory (root, crawl->directory, -1);
+	tracker_directory_crawl_free (crawl);
+	tracker_index_root_continue (root);
+}
+
 static gboolean
 check_file (TrackerFileNotifier *notifier,
             GFile               *file,
@@ -261,21 +667,20 @@ index_root_equals_file (TrackerIndexRoot *root,
 }
 
 static gboolean
-check_directory (TrackerFileNotifier *notifier,
-                 GFile               *directory,
-                 GFileInfo           *info)
+check_directory (TrackerIndexRoot *root,
+                 GFile            *directory,
+                 GFileInfo        *info)
 {
 	TrackerFileNotifierPrivate *priv;
 
-	priv = tracker_file_notifier_get_instance_private (notifier);
-	g_assert (priv->current_index_root != NULL);
+	priv = tracker_file_notifier_get_instance_private (root->notifier);
 
 	/* If it's a config root itself, other than the one
 	 * currently processed, bypass it, it will be processed
 	 * when the time arrives.
 	 */
 	if (tracker_indexing_tree_file_is_root (priv->indexing_tree, directory) &&
-	    index_root_equals_file (priv->current_index_root, directory) != 0)
+	    index_root_equals_file (root, directory) != 0)
 		return FALSE;
 
 	return tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
@@ -331,10 +736,56 @@ tracker_file_notifier_notify (TrackerFileNotifier *notifier,
 	return stop;
 }
 
+static gboolean
+notifier_root_shares_device (TrackerFileNotifier *notifier,
+                             TrackerIndexRoot    *root)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	for (l = priv->active_index_roots; l; l = l->next) {
+		if (tracker_index_root_get_device (l->data) ==
+		    tracker_index_root_get_device (root))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static TrackerIndexRoot *
+notifier_pop_next_root (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	for (l = priv->pending_index_roots; l; l = l->next) {
+		TrackerIndexRoot *root = l->data;
+
+		/* Crawling roots on the same device in parallel
+		 * would just make the disk seek back and forth.
+		 * Ignored roots are not crawled at all.
+		 */
+		if ((root->flags & TRACKER_DIRECTORY_FLAG_IGNORE) == 0 &&
+		    notifier_root_shares_device (notifier, root))
+			continue;
+
+		priv->pending_index_roots =
+			g_list_delete_link (priv->pending_index_roots, l);
+		return root;
+	}
+
+	return NULL;
+}
+
 static gboolean
 notifier_check_next_root (TrackerFileNotifier *notifier)
 {
 	TrackerFileNotifierPrivate *priv;
+	TrackerIndexRoot *root;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
 
@@ -344,24 +795,40 @@ notifier_check_next_root (TrackerFileNotifier *notifier)
 	if (!sparql_contents_ensure_statement (notifier, NULL))
 		return FALSE;
 
-	g_clear_pointer (&priv->current_index_root, tracker_index_root_free);
-
-	while (priv->pending_index_roots) {
-		priv->current_index_root = priv->pending_index_roots->data;
-		priv->pending_index_roots =
-			g_list_delete_link (priv->pending_index_roots,
-			                    priv->pending_index_roots);
-
-		if (tracker_index_root_query_contents (priv->current_index_root))
-			return TRUE;
+	while (g_list_length (priv->active_index_roots) < priv->max_crawled_roots &&
+	       (root = notifier_pop_next_root (notifier)) != NULL) {
+		priv->active_index_roots =
+			g_list_prepend (priv->active_index_roots, root);
 
-		g_clear_pointer (&priv->current_index_root, tracker_index_root_free);
+		if (!tracker_index_root_query_contents (root)) {
+			priv->active_index_roots =
+				g_list_remove (priv->active_index_roots, root);
+			tracker_index_root_free (root);
+		}
 	}
 
+	if (priv->active_index_roots)
+		return TRUE;
+
 	g_signal_emit (notifier, signals[FINISHED], 0);
 	return FALSE;
 }
 
+static void
+notifier_finish_root (TrackerFileNotifier *notifier,
+                      TrackerIndexRoot    *root)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	priv->active_index_roots =
+		g_list_remove (priv->active_index_roots, root);
+	tracker_index_root_free (root);
+
+	notifier_check_next_root (notifier);
+}
+
 static void
 tracker_index_root_notify_changes (TrackerIndexRoot *root)
 {
@@ -380,7 +847,7 @@ update_state (TrackerFileData *data)
 
 	if (data->in_disk) {
 		if (data->in_store) {
-			if (!g_date_time_equal (data->store_mtime, data->disk_mtime)) {
+			if (data->store_mtime != data->disk_mtime) {
 				data->state = FILE_STATE_UPDATE;
 			} else if (data->mimetype) {
 				const gchar *current_hash;
@@ -409,7 +876,8 @@ ensure_file_data (TrackerIndexRoot *root,
 
 	file_data = g_hash_table_lookup (root->cache, file);
 	if (!file_data) {
-		file_data = g_slice_new0 (TrackerFileData);
+		file_data = tracker_mem_pool_alloc0 (file_data_pool);
+		TRACKER_MEMORY_ALLOC (NOTIFIER, sizeof (TrackerFileData));
 		file_data->file = g_object_ref (file);
 		g_hash_table_insert (root->cache, file_data->file, file_data);
 		file_data->node = g_list_alloc ();
@@ -431,8 +899,7 @@ _insert_disk_info (TrackerIndexRoot *root,
 	file_data = ensure_file_data (root, file);
 	file_data->in_disk = TRUE;
 	file_data->is_dir_in_disk = file_type == G_FILE_TYPE_DIRECTORY;
-	g_clear_pointer (&file_data->disk_mtime, g_date_time_unref);
-	file_data->disk_mtime = g_date_time_ref (datetime);
+	file_data->disk_mtime = datetime_to_usec (datetime);
 	update_state (file_data);
 
 	return file_data;
@@ -451,31 +918,155 @@ _insert_store_info (TrackerIndexRoot *root,
 	file_data = ensure_file_data (root, file);
 	file_data->in_store = TRUE;
 	file_data->is_dir_in_store = file_type == G_FILE_TYPE_DIRECTORY;
-	file_data->extractor_hash = g_strdup (extractor_hash);
-	file_data->mimetype = g_strdup (mimetype);
-	file_data->store_mtime = g_date_time_ref (datetime);
+	file_data->extractor_hash = g_intern_string (extractor_hash);
+	file_data->mimetype = g_intern_string (mimetype);
+	file_data->store_mtime = datetime_to_usec (datetime);
 	update_state (file_data);
 
 	return file_data;
 }
 
 static gboolean
-check_high_water (TrackerFileNotifier *notifier)
+check_high_water (TrackerIndexRoot *root)
 {
 	TrackerFileNotifierPrivate *priv;
 
-	priv = tracker_file_notifier_get_instance_private (notifier);
+	priv = tracker_file_notifier_get_instance_private (root->notifier);
 
 	if (priv->high_water) {
-		priv->active = FALSE;
+		root->paused = TRUE;
 		return TRUE;
 	}
 
 	return FALSE;
 }
 
+static void
+notifier_track_unprocessed (TrackerFileNotifier *notifier,
+                            GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv;
+	guint count;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	/* Only needed if there is a checkpoint to save */
+	if (!priv->checkpoint_file)
+		return;
+
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->unprocessed_dirs,
+	                                               directory));
+	g_hash_table_insert (priv->unprocessed_dirs, g_object_ref (directory),
+	                     GUINT_TO_POINTER (count + 1));
+}
+
+static void
+notifier_journal_change (TrackerFileNotifier *notifier,
+                         GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GFileOutputStream) stream = NULL;
+	g_autoptr (GFile) directory = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *line = NULL, *uri = NULL;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!priv->checkpoint_file)
+		return;
+
+	directory = g_file_get_parent (file);
+	if (!directory || g_hash_table_contains (priv->journal_dirs, directory))
+		return;
+
+	g_hash_table_add (priv->journal_dirs, g_object_ref (directory));
+
+	/* Appended right away, so the directory is crawled again if
+	 * miner-fs dies before the change is committed to the store.
+	 */
+	uri = g_file_get_uri (directory);
+	line = g_strconcat (uri, "\n", NULL);
+	stream = g_file_append_to (priv->checkpoint_file,
+	                           G_FILE_CREATE_PRIVATE,
+	                           NULL, &error);
+
+	if (!stream ||
+	    !g_output_stream_write_all (G_OUTPUT_STREAM (stream),
+	                                line, strlen (line),
+	                                NULL, NULL, &error))
+		g_warning ("Could not journal change: %s", error->message);
+	else
+		priv->checkpoint_saved = TRUE;
+}
+
+static void
+notifier_save_consistent_roots (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GError) error = NULL;
+	GHashTableIter iter;
+	gpointer root, time;
+	GString *str;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!priv->consistent_roots_file)
+		return;
+
+	str = g_string_new (NULL);
+	g_hash_table_iter_init (&iter, priv->consistent_roots);
+
+	while (g_hash_table_iter_next (&iter, &root, &time)) {
+		g_autofree gchar *uri = NULL;
+		const gchar *generation;
+
+		uri = g_file_get_uri (root);
+		generation = g_hash_table_lookup (priv->root_generations, root);
+		g_string_append_printf (str, "%s\t%" G_GINT64_FORMAT "\t%s\n",
+		                        uri, *((gint64 *) time),
+		                        generation ? generation : "");
+	}
+
+	if (!g_file_replace_contents (priv->consistent_roots_file,
+	                              str->str, str->len,
+	                              NULL, FALSE,
+	                              G_FILE_CREATE_PRIVATE,
+	                              NULL, NULL, &error))
+		g_warning ("Could not save consistent roots: %s", error->message);
+
+	g_string_free (str, TRUE);
+}
+
+static gboolean
+notifier_root_generation_unchanged (TrackerFileNotifier *notifier,
+                                    GFile               *root)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autofree gchar *generation = NULL;
+	const gchar *saved, *path;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	/* The root must still be consistent from the last run, its
+	 * filesystem then tells whether anything changed in it since.
+	 */
+	if (!g_hash_table_contains (priv->consistent_roots, root))
+		return FALSE;
+
+	saved = g_hash_table_lookup (priv->root_generations, root);
+	path = g_file_peek_path (root);
+	if (!saved || !path)
+		return FALSE;
+
+	g_hash_table_remove (priv->root_generations, root);
+	generation = tracker_file_system_get_generation (path);
+
+	return g_strcmp0 (saved, generation) == 0;
+}
+
 static void
 handle_file_from_filesystem (TrackerIndexRoot *root,
+                             GFile            *directory,
                              GFile            *file,
                              GFileInfo        *info)
 {
@@ -493,90 +1084,262 @@ handle_file_from_filesystem (TrackerIndexRoot *root,
 	if (file_type == G_FILE_TYPE_DIRECTORY &&
 	    file_data->state == FILE_STATE_CREATE &&
 	    (root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0 &&
-	    !g_file_equal (file, root->current_dir) &&
-	    check_directory_contents (root->notifier, file) &&
+	    !g_file_equal (file, directory) &&
 	    !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT)) {
-		/* Queue child dirs for later processing */
-		g_queue_push_tail (root->pending_dirs, g_object_ref (file));
+		/* Queue child dirs for later processing, their contents
+		 * are checked once they are enumerated.
+		 */
+		tracker_index_root_queue_directory (root, file);
 	}
 
+	if (file_data->state != FILE_STATE_NONE &&
+	    !g_file_equal (file, directory))
+		notifier_track_unprocessed (root->notifier, directory);
+
 	tracker_file_notifier_notify (root->notifier, file_data, info);
 	g_queue_delete_link (&root->queue, file_data->node);
 	g_hash_table_remove (root->cache, file);
 }
 
 static void
-enumerator_next_files_cb (GObject      *object,
+tracker_directory_crawl_handle_child (TrackerDirectoryCrawl *crawl,
+                                      GFile                 *file,
+                                      GFileInfo             *info)
+{
+	TrackerIndexRoot *root = crawl->root;
+
+	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+		root->directories_found++;
+
+		if (!check_directory (root, file, info)) {
+			root->directories_ignored++;
+			return;
+		}
+	} else {
+		root->files_found++;
+
+		if (!check_file (root->notifier, file, info)) {
+			root->files_ignored++;
+			return;
+		}
+	}
+
+	handle_file_from_filesystem (root, crawl->directory, file, info);
+}
+
+/* Directory content filters are matched against the names returned
+ * by the enumeration, instead of looking each of them up.
+ */
+static gboolean
+tracker_directory_crawl_checks_contents (TrackerDirectoryCrawl *crawl)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+
+	/* Like in check_directory_contents(), roots are exempt */
+	return !tracker_indexing_tree_file_is_root (priv->indexing_tree,
+	                                            crawl->directory);
+}
+
+static gboolean
+tracker_directory_crawl_is_content_marker (TrackerDirectoryCrawl *crawl,
+                                           GFileInfo             *info)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+
+	return tracker_indexing_tree_name_matches_filter (priv->indexing_tree,
+	                                                  TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                  g_file_info_get_name (info));
+}
+
+static void
+tracker_directory_crawl_skip_contents (TrackerDirectoryCrawl *crawl)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+	tracker_monitor_remove (priv->monitor, crawl->directory);
+	tracker_directory_crawl_finish (crawl);
+}
+
+static void tracker_directory_crawl_enumerate (TrackerDirectoryCrawl *crawl);
+static void enumerator_next_files_cb (GObject      *object,
+                                      GAsyncResult *res,
+                                      gpointer      user_data);
+
+static void
+tracker_directory_crawl_next_files (TrackerDirectoryCrawl *crawl)
+{
+	crawl->enumerate_start = g_get_monotonic_time ();
+	g_file_enumerator_next_files_async (crawl->enumerator,
+	                                    N_ENUMERATOR_BATCH_ITEMS,
+	                                    G_PRIORITY_DEFAULT,
+	                                    crawl->cancellable,
+	                                    enumerator_next_files_cb,
+	                                    crawl);
+}
+
+static void
+tracker_directory_crawl_record_enumerate (TrackerDirectoryCrawl *crawl)
+{
+	tracker_metrics_record (TRACKER_METRIC_CRAWL_ENUMERATE,
+	                        g_get_monotonic_time () - crawl->enumerate_start);
+}
+
+static void
+native_enumerate_cb (GObject      *object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+	TrackerDirectoryCrawl *crawl = user_data;
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GError) error = NULL;
+	guint i;
+
+	infos = tracker_native_crawler_enumerate_finish (G_FILE (object), res, &error);
+
+	if (tracker_directory_crawl_cancelled (crawl))
+		return;
+
+	tracker_directory_crawl_record_enumerate (crawl);
+
+	if (!infos) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED)) {
+			/* E.g. no statx() in the running kernel, use GIO from now on */
+			priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+			priv->native_crawl = FALSE;
+			tracker_directory_crawl_enumerate (crawl);
+			return;
+		}
+
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED)) {
+			g_autofree gchar *uri = NULL;
+
+			uri = g_file_get_uri (crawl->directory);
+			g_warning ("Got error crawling '%s': %s\n",
+			           uri, error->message);
+		}
+
+		tracker_directory_crawl_finish (crawl);
+		return;
+	}
+
+	if (tracker_directory_crawl_checks_contents (crawl)) {
+		for (i = 0; i < infos->len; i++) {
+			if (tracker_directory_crawl_is_content_marker (crawl, g_ptr_array_index (infos, i))) {
+				tracker_directory_crawl_skip_contents (crawl);
+				return;
+			}
+		}
+	}
+
+	for (i = 0; i < infos->len; i++) {
+		GFileInfo *info = g_ptr_array_index (infos, i);
+		g_autoptr (GFile) file = NULL;
+
+		file = g_file_get_child (crawl->directory, g_file_info_get_name (info));
+		tracker_directory_crawl_handle_child (crawl, file, info);
+	}
+
+	tracker_directory_crawl_finish (crawl);
+}
+
+static void
+enumerator_next_files_cb (GObject      *object,
                           GAsyncResult *res,
                           gpointer      user_data)
 {
-	TrackerIndexRoot *root;
+	TrackerDirectoryCrawl *crawl = user_data;
 	g_autoptr (GError) error = NULL;
 	GList *infos, *l;
 	int n_files = 0;
 
 	infos = g_file_enumerator_next_files_finish (G_FILE_ENUMERATOR (object), res, &error);
 
+	if (tracker_directory_crawl_cancelled (crawl)) {
+		g_list_free_full (infos, g_object_unref);
+		return;
+	}
+
+	tracker_directory_crawl_record_enumerate (crawl);
+
 	if (error) {
 		g_autofree gchar *uri = NULL;
 
-		/* Caller already commanded the way to continue */
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-			return;
-
-		uri = g_file_get_uri (g_file_enumerator_get_container (G_FILE_ENUMERATOR (object)));
+		uri = g_file_get_uri (crawl->directory);
 		g_warning ("Got error crawling '%s': %s\n",
 		           uri, error->message);
 
-		tracker_index_root_continue (user_data);
+		tracker_directory_crawl_finish (crawl);
 		return;
 	} else if (!infos) {
 		/* Directory contents were fully obtained */
-		tracker_index_root_continue (user_data);
+		tracker_directory_crawl_finish (crawl);
 		return;
 	}
 
-	root = user_data;
+	/* Subdirectories get queued in inode order too. The files in
+	 * the batch were already stat'ed by GIO in directory order.
+	 */
+	if (tracker_index_root_use_inode_order (crawl->root))
+		infos = g_list_sort (infos, (GCompareFunc) compare_inodes);
 
-	for (l = infos; l; l = l->next) {
-		GFileInfo *info = l->data;
-		GFileType file_type;
-		g_autoptr (GFile) file = NULL;
+	if (!crawl->contents_checked) {
+		crawl->contents_checked = TRUE;
 
-		file = g_file_enumerator_get_child (G_FILE_ENUMERATOR (object), info);
-		file_type = g_file_info_get_file_type (info);
-		n_files++;
+		if (tracker_directory_crawl_checks_contents (crawl)) {
+			gboolean filtered = FALSE;
 
-		if (file_type == G_FILE_TYPE_DIRECTORY) {
-			root->directories_found++;
+			for (l = infos; l && !filtered; l = l->next)
+				filtered = tracker_directory_crawl_is_content_marker (crawl, l->data);
+
+			/* The rest of larger directories is not listed yet,
+			 * look the markers up there.
+			 */
+			if (!filtered && g_list_length (infos) == N_ENUMERATOR_BATCH_ITEMS) {
+				TrackerFileNotifierPrivate *priv;
 
-			if (!check_directory (root->notifier, file, info)) {
-				root->directories_ignored++;
-				continue;
+				priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+				filtered = !tracker_indexing_tree_parent_is_indexable (priv->indexing_tree,
+				                                                       crawl->directory);
 			}
-		} else {
-			root->files_found++;
 
-			if (!check_file (root->notifier, file, info)) {
-				root->files_ignored++;
-				continue;
+			if (filtered) {
+				g_list_free_full (infos, g_object_unref);
+				tracker_directory_crawl_skip_contents (crawl);
+				return;
 			}
 		}
+	}
+
+	for (l = infos; l; l = l->next) {
+		GFileInfo *info = l->data;
+		g_autoptr (GFile) file = NULL;
 
-		handle_file_from_filesystem (root, file, info);
+		file = g_file_enumerator_get_child (G_FILE_ENUMERATOR (object), info);
+		tracker_directory_crawl_handle_child (crawl, file, info);
+		n_files++;
 	}
 
 	g_list_free_full (infos, g_object_unref);
 
 	if (n_files == N_ENUMERATOR_BATCH_ITEMS) {
-		g_file_enumerator_next_files_async (root->enumerator,
-		                                    N_ENUMERATOR_BATCH_ITEMS,
-		                                    G_PRIORITY_DEFAULT,
-		                                    root->cancellable,
-		                                    enumerator_next_files_cb,
-		                                    root);
+		if (check_high_water (crawl->root)) {
+			/* Do not flood the miner with the rest of a
+			 * large directory, continue once it caught up.
+			 */
+			g_queue_push_tail (&crawl->root->parked_crawls, crawl);
+			return;
+		}
+
+		tracker_directory_crawl_next_files (crawl);
 	} else {
-		tracker_index_root_continue (user_data);
+		tracker_directory_crawl_finish (crawl);
 	}
 }
 
@@ -585,17 +1348,18 @@ enumerate_children_cb (GObject      *object,
                        GAsyncResult *res,
                        gpointer      user_data)
 {
-	TrackerIndexRoot *root;
+	TrackerDirectoryCrawl *crawl = user_data;
 	g_autoptr (GFileEnumerator) enumerator = NULL;
 	g_autoptr (GError) error = NULL;
 
 	enumerator = g_file_enumerate_children_finish (G_FILE (object), res, &error);
 
-	if (!enumerator) {
-		/* Caller already commanded the way to continue */
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-			return;
+	if (tracker_directory_crawl_cancelled (crawl))
+		return;
 
+	tracker_directory_crawl_record_enumerate (crawl);
+
+	if (!enumerator) {
 		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
 		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED)) {
 			g_autofree gchar *uri = NULL;
@@ -605,18 +1369,12 @@ enumerate_children_cb (GObject      *object,
 			           uri, error->message);
 		}
 
-		tracker_index_root_continue (user_data);
+		tracker_directory_crawl_finish (crawl);
 		return;
 	}
 
-	root = user_data;
-	g_set_object (&root->enumerator, enumerator);
-	g_file_enumerator_next_files_async (root->enumerator,
-	                                    N_ENUMERATOR_BATCH_ITEMS,
-	                                    G_PRIORITY_DEFAULT,
-	                                    root->cancellable,
-	                                    enumerator_next_files_cb,
-	                                    root);
+	crawl->enumerator = g_steal_pointer (&enumerator);
+	tracker_directory_crawl_next_files (crawl);
 }
 
 static void
@@ -624,18 +1382,17 @@ query_root_info_cb (GObject      *object,
                     GAsyncResult *res,
                     gpointer      user_data)
 {
+	TrackerDirectoryCrawl *crawl = user_data;
 	TrackerIndexRoot *root;
-	TrackerFileNotifier *notifier;
-	TrackerFileNotifierPrivate *priv;
 	g_autoptr (GFileInfo) info = NULL;
 	g_autoptr (GError) error = NULL;
 
 	info = g_file_query_info_finish (G_FILE (object), res, &error);
-	if (error) {
-		/* Caller already commanded the way to continue */
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-			return;
 
+	if (tracker_directory_crawl_cancelled (crawl))
+		return;
+
+	if (error) {
 		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
 		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED)) {
 			gchar *uri;
@@ -646,72 +1403,107 @@ query_root_info_cb (GObject      *object,
 			g_free (uri);
 		}
 
-		tracker_index_root_continue (user_data);
+		tracker_directory_crawl_finish (crawl);
 		return;
 	}
 
-	root = user_data;
-	notifier = root->notifier;
-	priv = tracker_file_notifier_get_instance_private (notifier);
+	root = crawl->root;
+
+	handle_file_from_filesystem (root, crawl->directory, G_FILE (object), info);
+	tracker_directory_crawl_enumerate (crawl);
+}
+
+static void
+tracker_directory_crawl_enumerate (TrackerDirectoryCrawl *crawl)
+{
+	TrackerFileNotifierPrivate *priv;
 
-	handle_file_from_filesystem (root, G_FILE (object), info);
+	priv = tracker_file_notifier_get_instance_private (crawl->root->notifier);
+	crawl->enumerate_start = g_get_monotonic_time ();
 
-	g_file_enumerate_children_async (G_FILE (object),
-	                                 priv->file_attributes,
-	                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-	                                 G_PRIORITY_DEFAULT,
-	                                 root->cancellable,
-	                                 enumerate_children_cb,
-	                                 root);
+	if (priv->native_crawl && g_file_is_native (crawl->directory)) {
+		tracker_native_crawler_enumerate_async (crawl->directory,
+		                                        priv->file_attributes,
+		                                        tracker_index_root_use_inode_order (crawl->root),
+		                                        crawl->cancellable,
+		                                        native_enumerate_cb,
+		                                        crawl);
+	} else {
+		g_file_enumerate_children_async (crawl->directory,
+		                                 priv->file_attributes,
+		                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                                 G_PRIORITY_DEFAULT,
+		                                 crawl->cancellable,
+		                                 enumerate_children_cb,
+		                                 crawl);
+	}
 }
 
+TRACKER_TRACE_DEFINE (crawl_next);
+TRACKER_TRACE_DEFINE (crawl_directory);
+
 static gboolean
 tracker_index_root_crawl_next (TrackerIndexRoot *root)
 {
 	TrackerFileNotifier *notifier;
 	TrackerFileNotifierPrivate *priv;
-	TrackerDirectoryFlags flags;
-	g_autoptr (GFile) directory = NULL;
 
 	notifier = root->notifier;
 	priv = tracker_file_notifier_get_instance_private (notifier);
 
-	if (check_high_water (root->notifier))
+	if (TRACKER_TRACE_ENABLED (crawl_next)) {
+		TRACKER_TRACE (crawl_next,
+		               g_file_peek_path (root->root),
+		               root->n_crawls,
+		               root->parked_crawls.length);
+	}
+
+	if (check_high_water (root))
 		return TRUE;
 
-	if (g_queue_is_empty (root->pending_dirs))
-		return FALSE;
+	while (!g_queue_is_empty (&root->parked_crawls)) {
+		TrackerDirectoryCrawl *crawl;
 
-	directory = g_queue_pop_head (root->pending_dirs);
-	g_set_object (&root->current_dir, directory);
+		crawl = g_queue_pop_head (&root->parked_crawls);
+		tracker_directory_crawl_next_files (crawl);
+	}
 
-	tracker_indexing_tree_get_root (priv->indexing_tree,
-	                                directory, &flags);
+	while (root->n_crawls < priv->max_crawled_directories &&
+	       tracker_index_root_has_pending_dirs (root)) {
+		TrackerDirectoryFlags flags;
+		TrackerDirectoryCrawl *crawl;
+		g_autoptr (GFile) directory = NULL;
 
-	if ((flags & TRACKER_DIRECTORY_FLAG_MONITOR) != 0)
-		tracker_monitor_add (priv->monitor, directory);
+		directory = tracker_index_root_pop_directory (root);
+		if (!directory)
+			break;
 
-	priv->active = TRUE;
+		if (TRACKER_TRACE_ENABLED (crawl_directory))
+			TRACKER_TRACE (crawl_directory, g_file_peek_path (directory));
 
-	if (directory == root->root && !root->ignore_root) {
-		g_file_query_info_async (directory,
-		                         priv->file_attributes,
-		                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-		                         G_PRIORITY_DEFAULT,
-		                         root->cancellable,
-		                         query_root_info_cb,
-		                         root);
-	} else {
-		g_file_enumerate_children_async (directory,
-		                                 priv->file_attributes,
-		                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-		                                 G_PRIORITY_DEFAULT,
-		                                 root->cancellable,
-		                                 enumerate_children_cb,
-		                                 root);
+		tracker_indexing_tree_get_root (priv->indexing_tree,
+		                                directory, &flags);
+
+		if ((flags & TRACKER_DIRECTORY_FLAG_MONITOR) != 0)
+			tracker_monitor_add (priv->monitor, directory);
+
+		crawl = tracker_directory_crawl_new (root, directory);
+
+		if (directory == root->root && !root->ignore_root) {
+			g_file_query_info_async (directory,
+			                         priv->file_attributes,
+			                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+			                         G_PRIORITY_DEFAULT,
+			                         crawl->cancellable,
+			                         query_root_info_cb,
+			                         crawl);
+		} else {
+			tracker_directory_crawl_enumerate (crawl);
+		}
 	}
 
-	return TRUE;
+	/* Wait for the directories still being crawled */
+	return root->n_crawls > 0;
 }
 
 static void
@@ -749,7 +1541,7 @@ tracker_index_root_continue (TrackerIndexRoot *root)
 
 	tracker_index_root_notify_changes (root);
 	tracker_file_notifier_emit_directory_finished (root->notifier, root);
-	notifier_check_next_root (root->notifier);
+	notifier_finish_root (root->notifier, root);
 }
 
 static void
@@ -766,6 +1558,7 @@ tracker_index_root_remove_directory (TrackerIndexRoot *root,
 		if (g_file_equal (file, directory) ||
 		    g_file_has_prefix (file, directory)) {
 			g_queue_remove (root->pending_dirs, file);
+			tracker_index_root_count_directory (root, file, -1);
 			g_object_unref (file);
 		}
 
@@ -778,11 +1571,12 @@ file_notifier_current_root_check_remove_directory (TrackerFileNotifier *notifier
                                                    GFile               *file)
 {
 	TrackerFileNotifierPrivate *priv;
+	GList *l;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
 
-	if (priv->current_index_root)
-		tracker_index_root_remove_directory (priv->current_index_root, file);
+	for (l = priv->active_index_roots; l; l = l->next)
+		tracker_index_root_remove_directory (l->data, file);
 }
 
 static TrackerSparqlStatement *
@@ -844,6 +1638,27 @@ file_is_equal_or_descendant (gconstpointer a,
 	return (g_file_equal (file, deleted_file) || g_file_has_prefix (file, deleted_file)) ? 0 : -1;
 }
 
+/* Whether a file in the store can be assumed to be unchanged. In
+ * trusted roots, only directories in the frontier and their contents
+ * are checked against the filesystem.
+ */
+static gboolean
+tracker_index_root_trusts_file (TrackerIndexRoot *root,
+                                GFile            *file,
+                                gboolean          resumed)
+{
+	g_autoptr (GFile) parent = NULL;
+
+	if (!root->trusted || resumed)
+		return FALSE;
+
+	parent = g_file_get_parent (file);
+
+	return (!parent ||
+	        (!g_queue_find_custom (root->pending_dirs, parent, file_is_equal) &&
+	         !g_queue_find_custom (&root->crawling_dirs, parent, file_is_equal)));
+}
+
 static void
 handle_file_from_cursor (TrackerIndexRoot    *root,
                          TrackerSparqlCursor *cursor)
@@ -856,6 +1671,7 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 	g_autoptr (GDateTime) store_mtime = NULL;
 	g_autoptr (GFileInfo) info = NULL;
 	TrackerFileData *file_data;
+	gboolean resumed;
 
 	notifier = root->notifier;
 	priv = tracker_file_notifier_get_instance_private (notifier);
@@ -867,8 +1683,23 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 	                         file_is_equal_or_descendant))
 		return;
 
-	/* Get stored info */
+	/* Directory whose crawl did not finish before */
+	resumed = g_hash_table_remove (priv->resume_dirs, file);
+
 	folder_urn = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+
+	if (tracker_index_root_trusts_file (root, file, resumed)) {
+		/* Stored directories still need monitors */
+		if (folder_urn &&
+		    (root->flags & TRACKER_DIRECTORY_FLAG_MONITOR) != 0 &&
+		    ((root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0 ||
+		     index_root_equals_file (root, file) == 0))
+			tracker_monitor_add (priv->monitor, file);
+
+		return;
+	}
+
+	/* Get stored info */
 	store_mtime = tracker_sparql_cursor_get_datetime (cursor, 2);
 	file_type = folder_urn != NULL ? G_FILE_TYPE_DIRECTORY : G_FILE_TYPE_UNKNOWN;
 
@@ -879,8 +1710,13 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 	                                tracker_sparql_cursor_get_string (cursor, 4, NULL),
 	                                store_mtime);
 
-	/* Query fs info in place */
-	info = g_file_query_info (file, priv->file_attributes,
+	/* Query fs info in place. Directories whose mtime did not
+	 * change are not crawled, so this is the only I/O performed
+	 * on unchanged files, keep it to the minimum.
+	 */
+	info = g_file_query_info (file,
+	                          file_type == G_FILE_TYPE_DIRECTORY ?
+	                          CHECK_DIRECTORY_ATTRIBUTES : CHECK_FILE_ATTRIBUTES,
 	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 	                          NULL, NULL);
 
@@ -897,6 +1733,22 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 		                   disk_mtime);
 	}
 
+	if (info &&
+	    (file_data->state == FILE_STATE_CREATE ||
+	     file_data->state == FILE_STATE_UPDATE ||
+	     file_data->state == FILE_STATE_EXTRACTOR_UPDATE)) {
+		GFileInfo *full_info;
+
+		/* The file will be notified, get all attributes */
+		full_info = g_file_query_info (file, priv->file_attributes,
+		                               G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                               NULL, NULL);
+		if (full_info) {
+			g_object_unref (info);
+			info = full_info;
+		}
+	}
+
 	if (file_data->state == FILE_STATE_DELETE &&
 	    (file_data->is_dir_in_store || file_data->is_dir_in_disk)) {
 		/* Cache deleted dir, in order to skip children */
@@ -912,10 +1764,18 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 		}
 
 		if ((file_data->state == FILE_STATE_CREATE ||
-		     file_data->state == FILE_STATE_UPDATE) &&
+		     file_data->state == FILE_STATE_UPDATE ||
+		     resumed) &&
 		    !g_queue_find_custom (root->pending_dirs, file, file_is_equal)) {
-			/* Updated directory, needs crawling */
-			g_queue_push_head (root->pending_dirs, g_object_ref (file));
+			/* Updated directory, needs crawling. Progressive
+			 * roots keep crawling the shallowest ones first.
+			 */
+			tracker_index_root_count_directory (root, file, 1);
+
+			if ((root->flags & TRACKER_DIRECTORY_FLAG_PROGRESSIVE) != 0)
+				g_queue_push_tail (root->pending_dirs, g_object_ref (file));
+			else
+				g_queue_push_head (root->pending_dirs, g_object_ref (file));
 		}
 	}
 
@@ -935,15 +1795,64 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 	}
 }
 
+static void
+tracker_index_root_queue_resumed_dirs (TrackerIndexRoot *root)
+{
+	TrackerFileNotifierPrivate *priv;
+	GHashTableIter iter;
+	GFile *directory;
+
+	priv = tracker_file_notifier_get_instance_private (root->notifier);
+
+	if ((root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) == 0)
+		return;
+
+	/* Directories left to resume are not in the store yet, they
+	 * need crawling unless they will be found by crawling their
+	 * parent.
+	 */
+	g_hash_table_iter_init (&iter, priv->resume_dirs);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &directory, NULL)) {
+		g_autoptr (GFile) parent = NULL;
+		GFile *dir_root;
+
+		dir_root = tracker_indexing_tree_get_root (priv->indexing_tree,
+		                                           directory, NULL);
+		if (!dir_root || !g_file_equal (dir_root, root->root))
+			continue;
+
+		parent = g_file_get_parent (directory);
+
+		if (parent &&
+		    !g_queue_find_custom (root->pending_dirs, parent, file_is_equal) &&
+		    g_file_query_file_type (directory,
+		                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                            NULL) == G_FILE_TYPE_DIRECTORY &&
+		    check_directory (root, directory, NULL) &&
+		    check_directory_contents (root->notifier, directory)) {
+			tracker_index_root_queue_directory (root, directory);
+		}
+
+		g_hash_table_iter_remove (&iter);
+	}
+}
+
 static gboolean
 handle_cursor (TrackerIndexRoot *root)
 {
+	TrackerFileNotifierPrivate *priv;
 	TrackerSparqlCursor *cursor = root->cursor;
 	GCancellable *cancellable = root->cancellable;
 	g_autoptr (GError) error = NULL;
 	gboolean finished = TRUE, stop = TRUE;
 	int i;
 
+	priv = tracker_file_notifier_get_instance_private (root->notifier);
+
+	/* Stored directories get their monitors set up together */
+	tracker_monitor_begin_batch (priv->monitor);
+
 	for (i = 0; i < N_CURSOR_BATCH_ITEMS; i++) {
 		finished = !tracker_sparql_cursor_next (cursor, cancellable, &error);
 		if (finished)
@@ -953,6 +1862,8 @@ handle_cursor (TrackerIndexRoot *root)
 		root->cursor_has_content = TRUE;
 	}
 
+	tracker_monitor_end_batch (priv->monitor);
+
 	if (finished) {
 		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			return G_SOURCE_REMOVE;
@@ -965,13 +1876,17 @@ handle_cursor (TrackerIndexRoot *root)
 			            uri, error->message);
 		} else if (!root->cursor_has_content) {
 			/* Indexing from scratch, crawl root dir */
+			root->from_scratch = TRUE;
+			tracker_index_root_count_directory (root, root->root, 1);
 			g_queue_push_tail (root->pending_dirs, g_object_ref (root->root));
+		} else {
+			tracker_index_root_queue_resumed_dirs (root);
 		}
 
 		g_clear_object (&root->cursor);
 	}
 
-	stop = finished || check_high_water (root->notifier);
+	stop = finished || check_high_water (root);
 
 	if (stop) {
 		root->cursor_idle_id = 0;
@@ -987,7 +1902,7 @@ tracker_index_root_continue_cursor (TrackerIndexRoot *root)
 	if (!root->cursor)
 		return FALSE;
 
-	if (check_high_water (root->notifier))
+	if (check_high_water (root))
 		return TRUE;
 
 	if (root->cursor_idle_id == 0) {
@@ -1018,6 +1933,7 @@ query_execute_cb (TrackerSparqlStatement *statement,
 
 			tracker_file_notifier_emit_directory_finished (root->notifier,
 			                                               root);
+			notifier_finish_root (root->notifier, root);
 		}
 
 		return;
@@ -1040,7 +1956,6 @@ tracker_index_root_query_contents (TrackerIndexRoot *root)
 
 	if (!root->cancellable)
 		root->cancellable = g_cancellable_new ();
-	g_set_object (&priv->cancellable, root->cancellable);
 
 	directory = root->root;
 	flags = root->flags;
@@ -1053,15 +1968,36 @@ tracker_index_root_query_contents (TrackerIndexRoot *root)
 		return FALSE;
 	}
 
+	if ((g_hash_table_remove (priv->trusted_roots, directory) ||
+	     notifier_root_generation_unchanged (notifier, directory)) &&
+	    (flags & (TRACKER_DIRECTORY_FLAG_CHECK_MTIME |
+	              TRACKER_DIRECTORY_FLAG_CHECK_DELETED)) == 0) {
+		TRACKER_NOTE (STATISTICS,
+		              g_message ("Only checking the frontier of consistent root '%s'",
+		                         g_file_peek_path (directory)));
+		root->trusted = TRUE;
+	} else if (g_hash_table_remove (priv->consistent_roots, directory)) {
+		/* Not consistent until it is processed again */
+		notifier_save_consistent_roots (notifier);
+	}
+
 	g_timer_reset (root->timer);
 	g_signal_emit (notifier, signals[DIRECTORY_STARTED], 0, directory);
 
-	uri = g_file_get_uri (directory);
-	tracker_sparql_statement_bind_string (priv->content_query, "root", uri);
+	/* Roots may be queried in parallel, each needs its own
+	 * statement so bindings do not get mixed up.
+	 */
+	if (!root->content_query) {
+		if (!sparql_contents_ensure_statement (notifier, NULL))
+			return FALSE;
+
+		root->content_query = g_steal_pointer (&priv->content_query);
+	}
 
-	priv->active = TRUE;
+	uri = g_file_get_uri (directory);
+	tracker_sparql_statement_bind_string (root->content_query, "root", uri);
 
-	tracker_sparql_statement_execute_async (priv->content_query,
+	tracker_sparql_statement_execute_async (root->content_query,
 	                                        root->cancellable,
 	                                        (GAsyncReadyCallback) query_execute_cb,
 	                                        root);
@@ -1087,8 +2023,7 @@ notifier_queue_root (TrackerFileNotifier   *notifier,
 		priv->pending_index_roots = g_list_append (priv->pending_index_roots, root);
 	}
 
-	if (!priv->current_index_root)
-		notifier_check_next_root (notifier);
+	notifier_check_next_root (notifier);
 }
 
 static GFileInfo *
@@ -1109,53 +2044,169 @@ create_shallow_file_info (GFile    *file,
 	return file_info;
 }
 
-/* Monitor signal handlers */
-static void
-monitor_item_created_cb (TrackerMonitor *monitor,
-                         GFile          *file,
-                         gboolean        is_directory,
-                         gpointer        user_data)
+static gint64
+get_recent_file_modified (GBookmarkFile *bookmarks,
+                          const gchar   *uri)
+{
+#if GLIB_CHECK_VERSION (2, 66, 0)
+	GDateTime *modified;
+
+	modified = g_bookmark_file_get_modified_date_time (bookmarks, uri, NULL);
+
+	return modified ? g_date_time_to_unix (modified) : 0;
+#else
+	return g_bookmark_file_get_modified (bookmarks, uri, NULL);
+#endif
+}
+
+static gboolean
+notifier_reload_recent_files (gpointer user_data)
 {
 	TrackerFileNotifier *notifier = user_data;
 	TrackerFileNotifierPrivate *priv;
-	gboolean indexable;
+	g_autoptr (GBookmarkFile) bookmarks = NULL;
+	g_auto (GStrv) uris = NULL;
+	gsize i, n_uris;
+	gint64 now;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
+	priv->recent_files_id = 0;
+	g_hash_table_remove_all (priv->recent_dirs);
 
-	indexable = tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
-	                                                     file, NULL);
+	bookmarks = g_bookmark_file_new ();
+	if (!g_bookmark_file_load_from_file (bookmarks,
+	                                     priv->recent_files_path,
+	                                     NULL))
+		return G_SOURCE_REMOVE;
 
-	if (!is_directory) {
-		gboolean parent_indexable;
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	uris = g_bookmark_file_get_uris (bookmarks, &n_uris);
+
+	for (i = 0; i < n_uris; i++) {
+		g_autoptr (GFile) file = NULL;
 		GFile *parent;
 
+		if (now - get_recent_file_modified (bookmarks, uris[i]) > RECENT_FILE_MAX_AGE)
+			continue;
+
+		file = g_file_new_for_uri (uris[i]);
 		parent = g_file_get_parent (file);
 
-		if (parent) {
-			parent_indexable = tracker_indexing_tree_parent_is_indexable (priv->indexing_tree,
-			                                                              parent);
+		if (parent)
+			g_hash_table_add (priv->recent_dirs, parent);
+	}
 
-			if (!parent_indexable) {
-				/* New file triggered a directory content
-				 * filter, remove parent directory altogether
-				 */
-				g_signal_emit (notifier, signals[FILE_DELETED], 0, parent, TRUE);
-				file_notifier_current_root_check_remove_directory (notifier, parent);
+	TRACKER_NOTE (MONITORS,
+	              g_message ("%u directories hold recently used files",
+	                         g_hash_table_size (priv->recent_dirs)));
 
-				tracker_monitor_remove_recursively (priv->monitor, parent);
-				return;
-			}
+	return G_SOURCE_REMOVE;
+}
 
-			g_object_unref (parent);
-		}
+static void
+recent_files_changed_cb (GFileMonitor      *monitor,
+                         GFile             *file,
+                         GFile             *other_file,
+                         GFileMonitorEvent  event_type,
+                         gpointer           user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv;
 
-		if (!indexable)
-			return;
-	} else {
-		TrackerDirectoryFlags flags;
+	priv = tracker_file_notifier_get_instance_private (notifier);
 
-		if (!indexable)
-			return;
+	if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+		return;
+
+	/* The list is usually rewritten as a whole, wait for it to settle */
+	if (priv->recent_files_id == 0) {
+		priv->recent_files_id =
+			g_timeout_add_seconds (RECENT_FILES_RELOAD_DELAY,
+			                       notifier_reload_recent_files,
+			                       notifier);
+	}
+}
+
+/* Tells whether a monitor event on @file is likely caused by the
+ * user working on it, those are emitted as ::hot-file first so they
+ * are processed ahead of crawling.
+ */
+static void
+notifier_check_hot_file (TrackerFileNotifier *notifier,
+                         GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+	GFile *parent;
+	gpointer data;
+	gint64 now, *last_change;
+	gboolean hot;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	parent = g_file_get_parent (file);
+	if (!parent)
+		return;
+
+	now = g_get_monotonic_time ();
+	hot = g_hash_table_contains (priv->recent_dirs, parent);
+
+	if (tracker_lru_find (priv->active_dirs, parent, &data)) {
+		last_change = data;
+		hot |= now - *last_change < ACTIVE_DIRECTORY_TIMEOUT * G_USEC_PER_SEC;
+		*last_change = now;
+		g_object_unref (parent);
+	} else {
+		last_change = g_new (gint64, 1);
+		*last_change = now;
+		tracker_lru_add (priv->active_dirs, parent, last_change);
+	}
+
+	if (hot)
+		g_signal_emit (notifier, signals[HOT_FILE], 0, file);
+}
+
+/* Monitor signal handlers */
+static void
+monitor_item_created_cb (TrackerMonitor *monitor,
+                         GFile          *file,
+                         gboolean        is_directory,
+                         gpointer        user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GFile) parent = NULL;
+	gboolean indexable;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	notifier_journal_change (notifier, file);
+
+	/* The parent was indexable until now, only the new file
+	 * may have changed that.
+	 */
+	parent = g_file_get_parent (file);
+
+	if (parent &&
+	    tracker_indexing_tree_file_matches_filter (priv->indexing_tree,
+	                                               TRACKER_FILTER_PARENT_DIRECTORY,
+	                                               file)) {
+		/* New file triggered a directory content
+		 * filter, remove parent directory altogether
+		 */
+		g_signal_emit (notifier, signals[FILE_DELETED], 0, parent, TRUE);
+		file_notifier_current_root_check_remove_directory (notifier, parent);
+
+		tracker_monitor_remove_recursively (priv->monitor, parent);
+		return;
+	}
+
+	indexable = tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+	                                                     file, NULL);
+
+	if (!indexable)
+		return;
+
+	if (is_directory) {
+		TrackerDirectoryFlags flags;
 
 		/* If config for the directory is recursive,
 		 * Crawl new entire directory and add monitors
@@ -1173,6 +2224,9 @@ monitor_item_created_cb (TrackerMonitor *monitor,
 		}
 	}
 
+	if (!is_directory)
+		notifier_check_hot_file (notifier, file);
+
 	g_signal_emit (notifier, signals[FILE_CREATED], 0, file, NULL);
 }
 
@@ -1186,6 +2240,7 @@ monitor_item_updated_cb (TrackerMonitor *monitor,
 	TrackerFileNotifierPrivate *priv;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
+	notifier_journal_change (notifier, file);
 
 	if (!tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
 	                                              file, NULL)) {
@@ -1193,6 +2248,9 @@ monitor_item_updated_cb (TrackerMonitor *monitor,
 		return;
 	}
 
+	if (!is_directory)
+		notifier_check_hot_file (notifier, file);
+
 	g_signal_emit (notifier, signals[FILE_UPDATED], 0, file, NULL, FALSE);
 }
 
@@ -1206,6 +2264,7 @@ monitor_item_attribute_updated_cb (TrackerMonitor *monitor,
 	TrackerFileNotifierPrivate *priv;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
+	notifier_journal_change (notifier, file);
 
 	if (!tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
 	                                              file, NULL)) {
@@ -1226,6 +2285,7 @@ monitor_item_deleted_cb (TrackerMonitor *monitor,
 	TrackerFileNotifierPrivate *priv;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
+	notifier_journal_change (notifier, file);
 
 	/* Remove monitors if any */
 	if (is_directory &&
@@ -1316,6 +2376,8 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 
 	notifier = user_data;
 	priv = tracker_file_notifier_get_instance_private (notifier);
+	notifier_journal_change (notifier, file);
+	notifier_journal_change (notifier, other_file);
 	tracker_indexing_tree_get_root (priv->indexing_tree, other_file, &flags);
 
 	if (!is_source_monitored) {
@@ -1373,6 +2435,9 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 
 				/* Source file was not stored, check dest file as new */
 				if (!is_directory || !dest_is_recursive) {
+					if (!is_directory)
+						notifier_check_hot_file (notifier, other_file);
+
 					g_signal_emit (notifier, signals[FILE_CREATED], 0, other_file, NULL);
 				} else if (is_directory) {
 					/* Crawl dest directory */
@@ -1415,6 +2480,9 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 				}
 			}
 
+			if (!is_directory)
+				notifier_check_hot_file (notifier, other_file);
+
 			g_signal_emit (notifier, signals[FILE_MOVED], 0, file, other_file, is_directory);
 
 			if (extension_changed (file, other_file))
@@ -1427,6 +2495,108 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 }
 
 /* Indexing tree signal handlers */
+static void
+queue_overflow_check (TrackerFileNotifier *notifier,
+                      GFile               *directory)
+{
+	TrackerFileNotifierPrivate *priv;
+	TrackerDirectoryFlags flags;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!tracker_indexing_tree_get_root (priv->indexing_tree, directory, &flags))
+		return;
+
+	flags |= TRACKER_DIRECTORY_FLAG_CHECK_DELETED;
+	notifier_queue_root (notifier, directory, flags, FALSE);
+}
+
+static gboolean
+overflow_check_cb (gpointer user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv;
+	GList *dirs, *l;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	priv->overflow_id = 0;
+	priv->last_overflow_check = g_get_monotonic_time ();
+
+	if (priv->overflow_all) {
+		dirs = tracker_indexing_tree_list_roots (priv->indexing_tree);
+		g_list_foreach (dirs, (GFunc) g_object_ref, NULL);
+		g_list_free_full (priv->overflow_dirs, g_object_unref);
+	} else {
+		dirs = priv->overflow_dirs;
+	}
+
+	priv->overflow_dirs = NULL;
+	priv->overflow_all = FALSE;
+
+	for (l = dirs; l; l = l->next) {
+		TRACKER_NOTE (MONITORS,
+		              g_message ("Checking '%s' after monitor overflow",
+		                         g_file_peek_path (l->data)));
+		queue_overflow_check (notifier, l->data);
+	}
+
+	g_list_free_full (dirs, g_object_unref);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+monitor_overflow_cb (TrackerMonitor *monitor,
+                     GFile          *directory,
+                     gpointer        user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv;
+	gint64 next_check, now;
+	guint delay;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!directory) {
+		priv->overflow_all = TRUE;
+	} else if (!priv->overflow_all) {
+		GList *l, *next;
+
+		/* Directories already covered by a pending check */
+		if (g_list_find_custom (priv->overflow_dirs, directory,
+		                        file_is_equal_or_descendant))
+			return;
+
+		/* Drop pending checks that this one covers */
+		for (l = priv->overflow_dirs; l; l = next) {
+			next = l->next;
+
+			if (g_file_has_prefix (l->data, directory)) {
+				g_object_unref (l->data);
+				priv->overflow_dirs =
+					g_list_delete_link (priv->overflow_dirs, l);
+			}
+		}
+
+		priv->overflow_dirs = g_list_prepend (priv->overflow_dirs,
+		                                      g_object_ref (directory));
+	}
+
+	if (priv->overflow_id != 0)
+		return;
+
+	now = g_get_monotonic_time ();
+	next_check = priv->last_overflow_check +
+		OVERFLOW_CHECK_INTERVAL * G_USEC_PER_SEC;
+	delay = OVERFLOW_CHECK_DELAY;
+
+	if (priv->last_overflow_check != 0 && next_check > now)
+		delay = MAX (delay, (next_check - now) / G_USEC_PER_SEC);
+
+	priv->overflow_id = g_timeout_add_seconds (delay, overflow_check_cb,
+	                                           notifier);
+}
+
 static void
 indexing_tree_directory_added (TrackerIndexingTree *indexing_tree,
                                GFile               *directory,
@@ -1507,14 +2677,13 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
 			g_list_delete_link (priv->pending_index_roots, elem);
 	}
 
-	if (priv->current_index_root &&
-	    index_root_equals_file (priv->current_index_root, directory) == 0) {
+	elem = g_list_find_custom (priv->active_index_roots, directory,
+	                           (GCompareFunc) index_root_equals_file);
+
+	if (elem) {
 		/* Directory being currently processed */
-		if (priv->cancellable)
-			g_cancellable_cancel (priv->cancellable);
-		tracker_file_notifier_emit_directory_finished (notifier,
-		                                               priv->current_index_root);
-		notifier_check_next_root (notifier);
+		tracker_file_notifier_emit_directory_finished (notifier, elem->data);
+		notifier_finish_root (notifier, elem->data);
 	}
 
 	/* Remove monitors if any */
@@ -1557,6 +2726,405 @@ indexing_tree_child_updated (TrackerIndexingTree *indexing_tree,
 	}
 }
 
+/* Files deleted by each delete-filtered-files.rq update */
+#define PURGE_CHUNK_SIZE 1000
+
+typedef struct {
+	TrackerFileNotifier *notifier;
+	TrackerFilterType type;
+	TrackerSparqlStatement *stmt;
+	TrackerSparqlStatement *purge_stmt;
+	TrackerSparqlCursor *cursor;
+	GCancellable *cancellable;
+	GFile *last_directory;
+	guint n_files;
+	guint n_deleted;
+} FilteredContent;
+
+static void
+filtered_content_free (FilteredContent *data)
+{
+	g_clear_object (&data->stmt);
+	g_clear_object (&data->purge_stmt);
+	g_clear_object (&data->cursor);
+	g_clear_object (&data->cancellable);
+	g_clear_object (&data->last_directory);
+	g_free (data);
+}
+
+static void
+filtered_content_handle_file (FilteredContent *data)
+{
+	TrackerFileNotifier *notifier = data->notifier;
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GFile) file = NULL;
+	gboolean is_dir;
+	GFile *root;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	is_dir = tracker_sparql_cursor_is_bound (data->cursor, 1);
+	if (is_dir != (data->type == TRACKER_FILTER_DIRECTORY))
+		return;
+
+	/* Files are purged in bulk afterwards, directories and
+	 * their contents go through the miner.
+	 */
+	if (!is_dir) {
+		data->n_files++;
+		return;
+	}
+
+	file = g_file_new_for_uri (tracker_sparql_cursor_get_string (data->cursor, 0, NULL));
+
+	/* Contents of a directory deleted just before */
+	if (data->last_directory &&
+	    g_file_has_prefix (file, data->last_directory))
+		return;
+
+	/* Filters may have changed again since the query started */
+	if (!tracker_indexing_tree_file_matches_filter (priv->indexing_tree,
+	                                                data->type, file))
+		return;
+
+	root = tracker_indexing_tree_get_root (priv->indexing_tree, file, NULL);
+	if (!root || g_file_equal (file, root))
+		return;
+
+	g_signal_emit (notifier, signals[FILE_DELETED], 0, file, TRUE);
+	file_notifier_current_root_check_remove_directory (notifier, file);
+	tracker_monitor_remove_recursively (priv->monitor, file);
+	g_set_object (&data->last_directory, file);
+	data->n_deleted++;
+}
+
+static void filtered_content_purge (FilteredContent *data);
+
+static void
+filtered_content_purge_cb (GObject      *object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+	FilteredContent *data = user_data;
+	g_autoptr (GError) error = NULL;
+	guint n_chunk;
+
+	if (!tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                             res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_critical ("Could not delete filtered files: %s", error->message);
+
+		filtered_content_free (data);
+		return;
+	}
+
+	n_chunk = MIN (data->n_files, PURGE_CHUNK_SIZE);
+	data->n_files -= n_chunk;
+	data->n_deleted += n_chunk;
+
+	if (data->n_files > 0) {
+		filtered_content_purge (data);
+		return;
+	}
+
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("Removed %u items matching new filters",
+	                         data->n_deleted));
+	filtered_content_free (data);
+}
+
+static void
+filtered_content_purge (FilteredContent *data)
+{
+	tracker_sparql_statement_update_async (data->purge_stmt,
+	                                       data->cancellable,
+	                                       filtered_content_purge_cb,
+	                                       data);
+}
+
+static void
+filtered_content_next_cb (GObject      *object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+	FilteredContent *data = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_sparql_cursor_next_finish (TRACKER_SPARQL_CURSOR (object),
+	                                        res, &error)) {
+		if (error && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_critical ("Could not look up filtered content: %s", error->message);
+		} else if (!error && data->n_files > 0) {
+			/* Stored files matching the filters are deleted
+			 * in chunks, instead of one by one.
+			 */
+			filtered_content_purge (data);
+			return;
+		} else if (!error) {
+			TRACKER_NOTE (STATISTICS,
+			              g_message ("Removed %u items matching new filters",
+			                         data->n_deleted));
+		}
+
+		filtered_content_free (data);
+		return;
+	}
+
+	filtered_content_handle_file (data);
+
+	tracker_sparql_cursor_next_async (data->cursor,
+	                                  data->cancellable,
+	                                  filtered_content_next_cb,
+	                                  data);
+}
+
+static void
+filtered_content_query_cb (GObject      *object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+	FilteredContent *data = user_data;
+	g_autoptr (GError) error = NULL;
+
+	data->cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                        res, &error);
+	if (!data->cursor) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_critical ("Could not look up filtered content: %s", error->message);
+
+		filtered_content_free (data);
+		return;
+	}
+
+	tracker_sparql_cursor_next_async (data->cursor,
+	                                  data->cancellable,
+	                                  filtered_content_next_cb,
+	                                  data);
+}
+
+static gchar *
+filters_to_regex (GStrv globs)
+{
+	GString *str;
+	gint i;
+
+	str = g_string_new ("^(");
+
+	for (i = 0; globs[i]; i++) {
+		const gchar *p;
+
+		if (i > 0)
+			g_string_append_c (str, '|');
+
+		for (p = globs[i]; *p; p++) {
+			if (*p == '*')
+				g_string_append (str, ".*");
+			else if (*p == '?')
+				g_string_append_c (str, '.');
+			else if (strchr ("\\^$.|+()[]{}", *p))
+				g_string_append_printf (str, "\\%c", *p);
+			else
+				g_string_append_c (str, *p);
+		}
+	}
+
+	g_string_append (str, ")$");
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+indexing_tree_filters_added (TrackerIndexingTree *indexing_tree,
+                             TrackerFilterType    type,
+                             GStrv                globs,
+                             gpointer             user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *regex = NULL;
+	FilteredContent *data;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!priv->connection)
+		return;
+
+	/* Only content matching the new filters needs to go, which
+	 * is all in the store already.
+	 */
+	data = g_new0 (FilteredContent, 1);
+	data->notifier = notifier;
+	data->type = type;
+	data->stmt = tracker_load_statement (priv->connection,
+	                                     "get-filtered-content.rq",
+	                                     &error);
+	if (data->stmt && type == TRACKER_FILTER_FILE) {
+		data->purge_stmt = tracker_load_statement (priv->connection,
+		                                           "delete-filtered-files.rq",
+		                                           &error);
+	}
+
+	if (error) {
+		g_critical ("Could not look up filtered content: %s", error->message);
+		filtered_content_free (data);
+		return;
+	}
+
+	if (!priv->filters_cancellable)
+		priv->filters_cancellable = g_cancellable_new ();
+	data->cancellable = g_object_ref (priv->filters_cancellable);
+
+	regex = filters_to_regex (globs);
+	tracker_sparql_statement_bind_string (data->stmt, "regex", regex);
+	if (data->purge_stmt)
+		tracker_sparql_statement_bind_string (data->purge_stmt, "regex", regex);
+
+	tracker_sparql_statement_execute_async (data->stmt,
+	                                        data->cancellable,
+	                                        filtered_content_query_cb,
+	                                        data);
+}
+
+static gboolean
+notifier_frontier_is_empty (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (g_hash_table_size (priv->resume_dirs) > 0 ||
+	    g_hash_table_size (priv->unprocessed_dirs) > 0 ||
+	    g_hash_table_size (priv->journal_dirs) > 0)
+		return FALSE;
+
+	for (l = priv->active_index_roots; l; l = l->next) {
+		TrackerIndexRoot *root = l->data;
+
+		if (tracker_index_root_has_pending_dirs (root) ||
+		    !g_queue_is_empty (&root->crawling_dirs))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+frontier_add_directory (GHashTable *frontier,
+                        GString    *str,
+                        GFile      *directory)
+{
+	g_autofree gchar *uri = NULL;
+
+	if (g_hash_table_contains (frontier, directory))
+		return;
+
+	g_hash_table_add (frontier, directory);
+	uri = g_file_get_uri (directory);
+	g_string_append (str, uri);
+	g_string_append_c (str, '\n');
+}
+
+static void
+frontier_add_spilled_directory (GFile   *directory,
+                                GString *str)
+{
+	g_autofree gchar *uri = NULL;
+
+	/* Spilled directories are only queued once, no need to
+	 * check for duplicates.
+	 */
+	uri = g_file_get_uri (directory);
+	g_string_append (str, uri);
+	g_string_append_c (str, '\n');
+}
+
+static void
+notifier_save_checkpoint (TrackerFileNotifier *notifier,
+                          gboolean             force)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GHashTable) frontier = NULL;
+	g_autoptr (GError) error = NULL;
+	GString *str;
+	GHashTableIter iter;
+	GFile *directory;
+	GList *l, *d;
+	guint n_spilled = 0;
+	gint64 now;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!priv->checkpoint_file)
+		return;
+
+	if (notifier_frontier_is_empty (notifier)) {
+		if (priv->checkpoint_saved &&
+		    !g_file_delete (priv->checkpoint_file, NULL, &error) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			g_warning ("Could not delete crawl checkpoint: %s", error->message);
+
+		priv->checkpoint_saved = FALSE;
+		return;
+	}
+
+	now = g_get_monotonic_time ();
+
+	if (!force &&
+	    now - priv->last_checkpoint < CHECKPOINT_INTERVAL * G_USEC_PER_SEC)
+		return;
+
+	priv->last_checkpoint = now;
+
+	/* Directories are borrowed from the tables and queues below */
+	frontier = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+	str = g_string_new (NULL);
+
+	g_hash_table_iter_init (&iter, priv->resume_dirs);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &directory, NULL))
+		frontier_add_directory (frontier, str, directory);
+
+	g_hash_table_iter_init (&iter, priv->unprocessed_dirs);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &directory, NULL))
+		frontier_add_directory (frontier, str, directory);
+
+	g_hash_table_iter_init (&iter, priv->journal_dirs);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &directory, NULL))
+		frontier_add_directory (frontier, str, directory);
+
+	for (l = priv->active_index_roots; l; l = l->next) {
+		TrackerIndexRoot *root = l->data;
+
+		for (d = root->crawling_dirs.head; d; d = d->next)
+			frontier_add_directory (frontier, str, d->data);
+		for (d = root->pending_dirs->head; d; d = d->next)
+			frontier_add_directory (frontier, str, d->data);
+
+		if (root->spilled_dirs) {
+			tracker_spill_queue_foreach (root->spilled_dirs,
+			                             (GFunc) frontier_add_spilled_directory,
+			                             str);
+			n_spilled += tracker_spill_queue_get_length (root->spilled_dirs);
+		}
+	}
+
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("Saving crawl checkpoint with %d directories",
+	                         g_hash_table_size (frontier) + n_spilled));
+
+	if (!g_file_replace_contents (priv->checkpoint_file,
+	                              str->str, str->len,
+	                              NULL, FALSE,
+	                              G_FILE_CREATE_PRIVATE,
+	                              NULL, NULL, &error))
+		g_warning ("Could not save crawl checkpoint: %s", error->message);
+	else
+		priv->checkpoint_saved = TRUE;
+
+	g_string_free (str, TRUE);
+}
+
 static void
 tracker_file_notifier_finalize (GObject *object)
 {
@@ -1570,24 +3138,48 @@ tracker_file_notifier_finalize (GObject *object)
 		g_object_unref (priv->indexing_tree);
 	}
 
-	if (priv->cancellable) {
-		g_cancellable_cancel (priv->cancellable);
-		g_object_unref (priv->cancellable);
-	}
+	g_list_free_full (priv->active_index_roots, (GDestroyNotify) tracker_index_root_free);
+	priv->active_index_roots = NULL;
+
+	g_list_foreach (priv->pending_index_roots, (GFunc) tracker_index_root_free, NULL);
+	g_list_free (priv->pending_index_roots);
+	priv->pending_index_roots = NULL;
+
+	/* Interrupted crawls were added to the frontier above */
+	notifier_save_checkpoint (TRACKER_FILE_NOTIFIER (object), TRUE);
+	g_clear_object (&priv->checkpoint_file);
+	g_clear_object (&priv->storage);
+	g_hash_table_unref (priv->resume_dirs);
+	g_hash_table_unref (priv->unprocessed_dirs);
+	g_hash_table_unref (priv->journal_dirs);
+	g_hash_table_unref (priv->consistent_roots);
+	g_hash_table_unref (priv->trusted_roots);
+	g_hash_table_unref (priv->root_generations);
+	g_clear_object (&priv->consistent_roots_file);
 
 	g_clear_object (&priv->content_query);
 	g_clear_object (&priv->deleted_query);
 
+	g_cancellable_cancel (priv->filters_cancellable);
+	g_clear_object (&priv->filters_cancellable);
+
 	tracker_monitor_set_enabled (priv->monitor, FALSE);
 	g_signal_handlers_disconnect_by_data (priv->monitor, object);
 
 	g_object_unref (priv->monitor);
 	g_clear_object (&priv->connection);
 
-	g_clear_pointer (&priv->current_index_root, tracker_index_root_free);
+	g_clear_handle_id (&priv->overflow_id, g_source_remove);
+	g_list_free_full (priv->overflow_dirs, g_object_unref);
 
-	g_list_foreach (priv->pending_index_roots, (GFunc) tracker_index_root_free, NULL);
-	g_list_free (priv->pending_index_roots);
+	g_clear_handle_id (&priv->recent_files_id, g_source_remove);
+	if (priv->recent_files_monitor) {
+		g_signal_handlers_disconnect_by_data (priv->recent_files_monitor, object);
+		g_object_unref (priv->recent_files_monitor);
+	}
+	g_free (priv->recent_files_path);
+	g_hash_table_unref (priv->recent_dirs);
+	tracker_lru_unref (priv->active_dirs);
 
 	G_OBJECT_CLASS (tracker_file_notifier_parent_class)->finalize (object);
 }
@@ -1639,6 +3231,9 @@ tracker_file_notifier_constructed (GObject *object)
 	priv = tracker_file_notifier_get_instance_private (TRACKER_FILE_NOTIFIER (object));
 	g_assert (priv->indexing_tree);
 
+	priv->native_crawl = priv->file_attributes &&
+		tracker_native_crawler_supports_attributes (priv->file_attributes);
+
 	g_signal_connect (priv->indexing_tree, "directory-added",
 	                  G_CALLBACK (indexing_tree_directory_added), object);
 	g_signal_connect (priv->indexing_tree, "directory-updated",
@@ -1647,6 +3242,8 @@ tracker_file_notifier_constructed (GObject *object)
 	                  G_CALLBACK (indexing_tree_directory_removed), object);
 	g_signal_connect (priv->indexing_tree, "child-updated",
 	                  G_CALLBACK (indexing_tree_child_updated), object);
+	g_signal_connect (priv->indexing_tree, "filters-added",
+	                  G_CALLBACK (indexing_tree_filters_added), object);
 
 	check_disable_monitor (TRACKER_FILE_NOTIFIER (object));
 }
@@ -1681,6 +3278,9 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 
 	klass->finished = tracker_file_notifier_real_finished;
 
+	file_data_pool = tracker_mem_pool_new ("TrackerFileData",
+	                                       sizeof (TrackerFileData));
+
 	signals[FILE_CREATED] =
 		g_signal_new ("file-created",
 		              G_TYPE_FROM_CLASS (klass),
@@ -1742,6 +3342,17 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 		              G_TYPE_NONE,
 		              5, G_TYPE_FILE, G_TYPE_UINT,
 		              G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT);
+	signals[LEVEL_FINISHED] =
+		g_signal_new ("level-finished",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (TrackerFileNotifierClass,
+		                               level_finished),
+		              NULL, NULL,
+		              NULL,
+		              G_TYPE_NONE,
+		              4, G_TYPE_FILE, G_TYPE_UINT,
+		              G_TYPE_UINT, G_TYPE_UINT);
 	signals[FINISHED] =
 		g_signal_new ("finished",
 		              G_TYPE_FROM_CLASS (klass),
@@ -1751,6 +3362,16 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 		              NULL, NULL,
 		              NULL,
 		              G_TYPE_NONE, 0, G_TYPE_NONE);
+	/* Emitted right before the monitor event on a file the user
+	 * is likely working on.
+	 */
+	signals[HOT_FILE] =
+		g_signal_new ("hot-file",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST, 0,
+		              NULL, NULL, NULL,
+		              G_TYPE_NONE,
+		              1, G_TYPE_FILE);
 
 	g_object_class_install_property (object_class,
 	                                 PROP_INDEXING_TREE,
@@ -1785,10 +3406,53 @@ static void
 tracker_file_notifier_init (TrackerFileNotifier *notifier)
 {
 	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GFile) recent_files = NULL;
 	GError *error = NULL;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
 	priv->stopped = TRUE;
+	priv->max_crawled_roots = DEFAULT_MAX_CRAWLED_ROOTS;
+	priv->max_crawled_directories = DEFAULT_MAX_CRAWLED_DIRECTORIES;
+	priv->resume_dirs = g_hash_table_new_full (g_file_hash,
+	                                           (GEqualFunc) g_file_equal,
+	                                           g_object_unref, NULL);
+	priv->unprocessed_dirs = g_hash_table_new_full (g_file_hash,
+	                                                (GEqualFunc) g_file_equal,
+	                                                g_object_unref, NULL);
+	priv->journal_dirs = g_hash_table_new_full (g_file_hash,
+	                                            (GEqualFunc) g_file_equal,
+	                                            g_object_unref, NULL);
+	priv->consistent_roots = g_hash_table_new_full (g_file_hash,
+	                                                (GEqualFunc) g_file_equal,
+	                                                g_object_unref, g_free);
+	priv->trusted_roots = g_hash_table_new_full (g_file_hash,
+	                                             (GEqualFunc) g_file_equal,
+	                                             g_object_unref, NULL);
+	priv->root_generations = g_hash_table_new_full (g_file_hash,
+	                                                (GEqualFunc) g_file_equal,
+	                                                g_object_unref, g_free);
+	priv->active_dirs = tracker_lru_new (MAX_ACTIVE_DIRECTORIES,
+	                                     g_file_hash,
+	                                     (GEqualFunc) g_file_equal,
+	                                     g_object_unref,
+	                                     g_free);
+	priv->recent_dirs = g_hash_table_new_full (g_file_hash,
+	                                           (GEqualFunc) g_file_equal,
+	                                           g_object_unref, NULL);
+	priv->recent_files_path = g_build_filename (g_get_user_data_dir (),
+	                                            "recently-used.xbel",
+	                                            NULL);
+	priv->recent_files_id = g_idle_add (notifier_reload_recent_files,
+	                                    notifier);
+	recent_files = g_file_new_for_path (priv->recent_files_path);
+	priv->recent_files_monitor = g_file_monitor_file (recent_files,
+	                                                  G_FILE_MONITOR_NONE,
+	                                                  NULL, NULL);
+	if (priv->recent_files_monitor) {
+		g_signal_connect (priv->recent_files_monitor, "changed",
+		                  G_CALLBACK (recent_files_changed_cb),
+		                  notifier);
+	}
 
 	/* Set up monitor */
 	priv->monitor = tracker_monitor_new (&error);
@@ -1812,6 +3476,9 @@ tracker_file_notifier_init (TrackerFileNotifier *notifier)
 		g_signal_connect (priv->monitor, "item-moved",
 		                  G_CALLBACK (monitor_item_moved_cb),
 		                  notifier);
+		g_signal_connect (priv->monitor, "overflow",
+		                  G_CALLBACK (monitor_overflow_cb),
+		                  notifier);
 	}
 }
 
@@ -1833,13 +3500,27 @@ static void
 tracker_file_notifier_continue (TrackerFileNotifier *notifier)
 {
 	TrackerFileNotifierPrivate *priv;
+	GList *roots, *l;
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
 
-	if (priv->current_index_root)
-		tracker_index_root_continue (priv->current_index_root);
-	else
-		notifier_check_next_root (notifier);
+	/* Roots may finish and get freed while resuming others */
+	roots = g_list_copy (priv->active_index_roots);
+
+	for (l = roots; l; l = l->next) {
+		TrackerIndexRoot *root = l->data;
+
+		if (!g_list_find (priv->active_index_roots, root) ||
+		    !root->paused)
+			continue;
+
+		root->paused = FALSE;
+		tracker_index_root_continue (root);
+	}
+
+	g_list_free (roots);
+
+	notifier_check_next_root (notifier);
 }
 
 void
@@ -1856,13 +3537,90 @@ tracker_file_notifier_set_high_water (TrackerFileNotifier *notifier,
 
 	priv->high_water = high_water;
 
-	if (!high_water && !priv->active &&
-	    tracker_file_notifier_is_active (notifier)) {
+	if (!high_water && tracker_file_notifier_is_active (notifier)) {
 		/* Maybe kick everything back into action */
 		tracker_file_notifier_continue (notifier);
 	}
 }
 
+/**
+ * tracker_file_notifier_set_crawl_limits:
+ * @notifier: a #TrackerFileNotifier
+ * @max_roots: maximum number of index roots crawled at once
+ * @max_directories: maximum number of directories enumerated at once
+ *   within an index root
+ *
+ * Sets how much crawling happens in parallel. Index roots are only
+ * crawled in parallel if they are on different devices.
+ **/
+void
+tracker_file_notifier_set_crawl_limits (TrackerFileNotifier *notifier,
+                                        guint                max_roots,
+                                        guint                max_directories)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (max_roots > 0);
+	g_return_if_fail (max_directories > 0);
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	priv->max_crawled_roots = max_roots;
+	priv->max_crawled_directories = max_directories;
+
+	/* Start further roots if there is room now */
+	if (priv->pending_index_roots)
+		notifier_check_next_root (notifier);
+}
+
+/**
+ * tracker_file_notifier_set_max_monitors:
+ * @notifier: a #TrackerFileNotifier
+ * @max_monitors: maximum number of directories watched individually,
+ *   or 0 for the monitor backend limit
+ *
+ * Sets how many directories get their own monitor, the rest are
+ * checked periodically and reported through monitor overflows.
+ **/
+void
+tracker_file_notifier_set_max_monitors (TrackerFileNotifier *notifier,
+                                        guint                max_monitors)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (priv->monitor)
+		tracker_monitor_set_watch_budget (priv->monitor, max_monitors);
+}
+
+/**
+ * tracker_file_notifier_set_update_delays:
+ * @notifier: a #TrackerFileNotifier
+ * @min_delay: milliseconds that updates of files changing often are
+ *   first held back, 0 to disable
+ * @max_delay: maximum milliseconds that updates are held back
+ *
+ * Sets the bounds of the delay applied to updates of files that
+ * keep changing.
+ **/
+void
+tracker_file_notifier_set_update_delays (TrackerFileNotifier *notifier,
+                                         guint                min_delay,
+                                         guint                max_delay)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (priv->monitor)
+		tracker_monitor_set_update_delays (priv->monitor, min_delay, max_delay);
+}
+
 gboolean
 tracker_file_notifier_start (TrackerFileNotifier *notifier)
 {
@@ -1890,24 +3648,27 @@ tracker_file_notifier_stop (TrackerFileNotifier *notifier)
 	priv = tracker_file_notifier_get_instance_private (notifier);
 
 	if (!priv->stopped) {
-		if (priv->cancellable)
-			g_cancellable_cancel (priv->cancellable);
+		priv->stopped = TRUE;
+
+		while (priv->active_index_roots) {
+			TrackerIndexRoot *root = priv->active_index_roots->data;
+
+			priv->active_index_roots =
+				g_list_delete_link (priv->active_index_roots,
+				                    priv->active_index_roots);
 
-		if (priv->current_index_root) {
 			/* Index root arbitrarily cancelled cannot be easily
-			 * resumed, best to queue it again and start from
-			 * scratch.
+			 * resumed, best to queue it again and check its
+			 * contents from scratch. Directories that were left
+			 * to crawl are crawled again after that.
 			 */
 			notifier_queue_root (notifier,
-			                     priv->current_index_root->root,
-			                     priv->current_index_root->flags |
+			                     root->root,
+			                     root->flags |
 			                     TRACKER_DIRECTORY_FLAG_PRIORITY,
-			                     priv->current_index_root->ignore_root);
-			g_clear_pointer (&priv->current_index_root,
-			                 tracker_index_root_free);
+			                     root->ignore_root);
+			tracker_index_root_free (root);
 		}
-
-		priv->stopped = TRUE;
 	}
 }
 
@@ -1919,5 +3680,293 @@ tracker_file_notifier_is_active (TrackerFileNotifier *notifier)
 	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), FALSE);
 
 	priv = tracker_file_notifier_get_instance_private (notifier);
-	return priv->pending_index_roots || priv->current_index_root;
+	return priv->pending_index_roots || priv->active_index_roots;
+}
+
+/**
+ * tracker_file_notifier_is_indexing_from_scratch:
+ * @notifier: a #TrackerFileNotifier
+ *
+ * Returns: %TRUE if an index root being crawled had no content
+ *   in the store, so all its files are new.
+ **/
+gboolean
+tracker_file_notifier_is_indexing_from_scratch (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), FALSE);
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	for (l = priv->active_index_roots; l; l = l->next) {
+		TrackerIndexRoot *root = l->data;
+
+		if (root->from_scratch)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+notifier_update_consistent_roots (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *roots, *l;
+	gint64 now;
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (!priv->consistent_roots_file)
+		return;
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	roots = tracker_indexing_tree_list_roots (priv->indexing_tree);
+	g_hash_table_remove_all (priv->consistent_roots);
+	g_hash_table_remove_all (priv->root_generations);
+
+	for (l = roots; l; l = l->next) {
+		TrackerDirectoryFlags flags;
+		const gchar *path;
+		gchar *generation = NULL;
+		gint64 *time;
+
+		tracker_indexing_tree_get_root (priv->indexing_tree, l->data, &flags);
+		if ((flags & TRACKER_DIRECTORY_FLAG_IGNORE) != 0)
+			continue;
+
+		time = g_new (gint64, 1);
+		*time = now;
+		g_hash_table_insert (priv->consistent_roots,
+		                     g_object_ref (l->data), time);
+
+		path = g_file_peek_path (l->data);
+		if (path)
+			generation = tracker_file_system_get_generation (path);
+		if (generation) {
+			g_hash_table_insert (priv->root_generations,
+			                     g_object_ref (l->data), generation);
+		}
+	}
+
+	g_list_free (roots);
+	notifier_save_consistent_roots (notifier);
+}
+
+/**
+ * tracker_file_notifier_set_checkpoint_file:
+ * @notifier: a #TrackerFileNotifier
+ * @file: file to keep the crawl frontier in
+ *
+ * Makes @notifier save the directories whose crawl and processing
+ * did not finish yet to @file, so interrupted crawls resume from
+ * there next time. Directories saved by a previous instance are
+ * loaded from @file.
+ **/
+void
+tracker_file_notifier_set_checkpoint_file (TrackerFileNotifier *notifier,
+                                           GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autofree gchar *contents = NULL;
+	g_auto (GStrv) uris = NULL;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (G_IS_FILE (file));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	g_set_object (&priv->checkpoint_file, file);
+
+	if (!g_file_load_contents (file, NULL, &contents, NULL, NULL, NULL))
+		return;
+
+	priv->checkpoint_saved = TRUE;
+	uris = g_strsplit (contents, "\n", -1);
+
+	for (i = 0; uris[i]; i++) {
+		if (*uris[i] == '\0')
+			continue;
+
+		g_hash_table_add (priv->resume_dirs, g_file_new_for_uri (uris[i]));
+	}
+
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("Resuming crawl of %d directories",
+	                         g_hash_table_size (priv->resume_dirs)));
+}
+
+/**
+ * tracker_file_notifier_file_processed:
+ * @notifier: a #TrackerFileNotifier
+ * @file: a #GFile
+ *
+ * Tells @notifier that the changes it notified on @file were
+ * committed to the store.
+ **/
+void
+tracker_file_notifier_file_processed (TrackerFileNotifier *notifier,
+                                      GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autoptr (GFile) parent = NULL;
+	guint count;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (g_hash_table_size (priv->unprocessed_dirs) == 0)
+		return;
+
+	parent = g_file_get_parent (file);
+	if (!parent)
+		return;
+
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->unprocessed_dirs,
+	                                               parent));
+	if (count > 1) {
+		g_hash_table_insert (priv->unprocessed_dirs,
+		                     g_object_ref (parent),
+		                     GUINT_TO_POINTER (count - 1));
+	} else if (count == 1) {
+		g_hash_table_remove (priv->unprocessed_dirs, parent);
+	}
+}
+
+/**
+ * tracker_file_notifier_save_checkpoint:
+ * @notifier: a #TrackerFileNotifier
+ *
+ * Saves the crawl frontier to the checkpoint file, if enough
+ * time passed since the last time.
+ **/
+void
+tracker_file_notifier_save_checkpoint (TrackerFileNotifier *notifier)
+{
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	notifier_save_checkpoint (notifier, FALSE);
+}
+
+/**
+ * tracker_file_notifier_clear_checkpoint:
+ * @notifier: a #TrackerFileNotifier
+ *
+ * Tells @notifier that all notified changes were processed, and
+ * that there is nothing left to resume.
+ **/
+void
+tracker_file_notifier_clear_checkpoint (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+
+	if (tracker_file_notifier_is_active (notifier))
+		return;
+
+	g_hash_table_remove_all (priv->unprocessed_dirs);
+	g_hash_table_remove_all (priv->resume_dirs);
+	g_hash_table_remove_all (priv->journal_dirs);
+	notifier_save_checkpoint (notifier, TRUE);
+
+	notifier_update_consistent_roots (notifier);
+}
+
+/**
+ * tracker_file_notifier_set_consistent_roots_file:
+ * @notifier: a #TrackerFileNotifier
+ * @file: file to keep the consistent roots in
+ * @trust: whether to trust the roots found in @file
+ *
+ * Makes @notifier save to @file the indexed roots whose contents
+ * were all processed, together with the checkpoint file set through
+ * tracker_file_notifier_set_checkpoint_file() this tells which parts
+ * of them may be out of date.
+ *
+ * If @trust is %TRUE, the roots saved by a previous instance are
+ * assumed to be consistent with the store the first time they are
+ * crawled, only the directories in the checkpoint are compared with
+ * the filesystem. Changes done while no instance was running are
+ * then only found by later crawls.
+ **/
+void
+tracker_file_notifier_set_consistent_roots_file (TrackerFileNotifier *notifier,
+                                                 GFile               *file,
+                                                 gboolean             trust)
+{
+	TrackerFileNotifierPrivate *priv;
+	g_autofree gchar *contents = NULL;
+	g_auto (GStrv) lines = NULL;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (G_IS_FILE (file));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	g_set_object (&priv->consistent_roots_file, file);
+
+	if (!g_file_load_contents (file, NULL, &contents, NULL, NULL, NULL))
+		return;
+
+	lines = g_strsplit (contents, "\n", -1);
+
+	for (i = 0; lines[i]; i++) {
+		g_autoptr (GFile) root = NULL;
+		gchar *separator, *generation;
+		gint64 *time;
+
+		separator = strchr (lines[i], '\t');
+		if (!separator)
+			continue;
+
+		*separator = '\0';
+		root = g_file_new_for_uri (lines[i]);
+		time = g_new (gint64, 1);
+		*time = g_ascii_strtoll (separator + 1, &generation, 10);
+
+		g_hash_table_insert (priv->consistent_roots,
+		                     g_object_ref (root), time);
+
+		/* Files from older versions have no generation */
+		if (generation[0] == '\t' && generation[1] != '\0') {
+			g_hash_table_insert (priv->root_generations,
+			                     g_object_ref (root),
+			                     g_strdup (&generation[1]));
+		}
+
+		if (trust)
+			g_hash_table_add (priv->trusted_roots, g_object_ref (root));
+
+		TRACKER_NOTE (CONFIG,
+		              g_message ("Root '%s' consistent as of %" G_GINT64_FORMAT "%s",
+		                         g_file_peek_path (root), *time,
+		                         trust ? ", trusted" : ""));
+	}
+}
+
+/**
+ * tracker_file_notifier_set_storage:
+ * @notifier: a #TrackerFileNotifier
+ * @storage: a #TrackerStorage
+ *
+ * Makes @notifier ask @storage about the media indexed roots are on,
+ * the ones on rotational disks are crawled in inode order.
+ **/
+void
+tracker_file_notifier_set_storage (TrackerFileNotifier *notifier,
+                                   TrackerStorage      *storage)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (TRACKER_IS_STORAGE (storage));
+
+	priv = tracker_file_notifier_get_instance_private (notifier);
+	g_set_object (&priv->storage, storage);
 }
@@ -29,6 +29,7 @@
 #include <gio/gio.h>
 #include "tracker-indexing-tree.h"
 #include "tracker-miner-fs.h"
+#include "tracker-storage.h"
 
 G_BEGIN_DECLS
 
@@ -72,6 +73,11 @@ struct _TrackerFileNotifierClass {
 	                             guint                directories_ignored,
 	                             guint                files_found,
 	                             guint                files_ignored);
+	void (* level_finished)     (TrackerFileNotifier *notifier,
+	                             GFile               *directory,
+	                             guint                level,
+	                             guint                directories_found,
+	                             guint                files_found);
 
 	void (* finished)           (TrackerFileNotifier *notifier);
 };
@@ -87,9 +93,34 @@ gboolean      tracker_file_notifier_start        (TrackerFileNotifier     *notif
 void          tracker_file_notifier_stop         (TrackerFileNotifier     *notifier);
 gboolean      tracker_file_notifier_is_active    (TrackerFileNotifier     *notifier);
 
+gboolean      tracker_file_notifier_is_indexing_from_scratch (TrackerFileNotifier *notifier);
+
 void          tracker_file_notifier_set_high_water (TrackerFileNotifier *notifier,
                                                     gboolean             high_water);
 
+void          tracker_file_notifier_set_crawl_limits (TrackerFileNotifier *notifier,
+                                                      guint                max_roots,
+                                                      guint                max_directories);
+void          tracker_file_notifier_set_max_monitors (TrackerFileNotifier *notifier,
+                                                      guint                max_monitors);
+void          tracker_file_notifier_set_update_delays (TrackerFileNotifier *notifier,
+                                                       guint                min_delay,
+                                                       guint                max_delay);
+
+void          tracker_file_notifier_set_checkpoint_file (TrackerFileNotifier *notifier,
+                                                         GFile               *file);
+void          tracker_file_notifier_file_processed      (TrackerFileNotifier *notifier,
+                                                         GFile               *file);
+void          tracker_file_notifier_save_checkpoint     (TrackerFileNotifier *notifier);
+void          tracker_file_notifier_clear_checkpoint    (TrackerFileNotifier *notifier);
+
+void          tracker_file_notifier_set_consistent_roots_file (TrackerFileNotifier *notifier,
+                                                               GFile               *file,
+                                                               gboolean             trust);
+
+void          tracker_file_notifier_set_storage (TrackerFileNotifier *notifier,
+                                                 TrackerStorage      *storage);
+
 G_END_DECLS
 
 #endif /* __TRACKER_FILE_NOTIFIER_H__ */
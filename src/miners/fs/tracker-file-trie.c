@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-file-trie.h"
+
+/* Maps files to data, keeping one node per path component. This
+ * makes lookups proportional to path depth, and allows finding all
+ * the data stored for files below a directory without looking at
+ * anything else. Nodes only exist while they or their descendants
+ * hold data.
+ */
+
+typedef struct _TrieNode TrieNode;
+
+struct _TrieNode {
+	TrieNode *parent;
+	GHashTable *children;
+	gchar *name;
+	gpointer data;
+};
+
+struct _TrackerFileTrie {
+	/* Native files are keyed by path, others by URI */
+	TrieNode native_root;
+	TrieNode uri_root;
+	GDestroyNotify data_destroy;
+	guint size;
+};
+
+TrackerFileTrie *
+tracker_file_trie_new (GDestroyNotify data_destroy)
+{
+	TrackerFileTrie *trie;
+
+	trie = g_new0 (TrackerFileTrie, 1);
+	trie->data_destroy = data_destroy;
+
+	return trie;
+}
+
+static void trie_node_free (TrackerFileTrie *trie,
+                            TrieNode        *node);
+
+static void
+trie_node_clear_children (TrackerFileTrie *trie,
+                          TrieNode        *node)
+{
+	GHashTableIter iter;
+	TrieNode *child;
+
+	if (!node->children)
+		return;
+
+	g_hash_table_iter_init (&iter, node->children);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &child))
+		trie_node_free (trie, child);
+
+	g_clear_pointer (&node->children, g_hash_table_unref);
+}
+
+static void
+trie_node_free (TrackerFileTrie *trie,
+                TrieNode        *node)
+{
+	trie_node_clear_children (trie, node);
+
+	if (node->data && trie->data_destroy)
+		trie->data_destroy (node->data);
+
+	g_free (node->name);
+	g_slice_free (TrieNode, node);
+}
+
+void
+tracker_file_trie_free (TrackerFileTrie *trie)
+{
+	trie_node_clear_children (trie, &trie->native_root);
+	trie_node_clear_children (trie, &trie->uri_root);
+	g_free (trie);
+}
+
+static TrieNode *
+trie_node_get_child (TrieNode    *node,
+                     const gchar *name,
+                     gboolean     create)
+{
+	TrieNode *child = NULL;
+
+	if (node->children)
+		child = g_hash_table_lookup (node->children, name);
+
+	if (child || !create)
+		return child;
+
+	if (!node->children)
+		node->children = g_hash_table_new (g_str_hash, g_str_equal);
+
+	child = g_slice_new0 (TrieNode);
+	child->parent = node;
+	child->name = g_strdup (name);
+	g_hash_table_insert (node->children, child->name, child);
+
+	return child;
+}
+
+static TrieNode *
+trie_lookup_node (TrackerFileTrie  *trie,
+                  GFile            *file,
+                  gboolean          create,
+                  TrieNode        **closest)
+{
+	TrieNode *node;
+	gchar *key, *component, *p;
+
+	if (g_file_is_native (file)) {
+		key = g_file_get_path (file);
+		node = &trie->native_root;
+	} else {
+		key = g_file_get_uri (file);
+		node = &trie->uri_root;
+	}
+
+	if (!key)
+		return NULL;
+
+	component = key;
+
+	while (node && component) {
+		if (closest && node->data)
+			*closest = node;
+
+		p = strchr (component, '/');
+		if (p)
+			*p = '\0';
+
+		if (*component != '\0')
+			node = trie_node_get_child (node, component, create);
+
+		component = p ? p + 1 : NULL;
+	}
+
+	if (closest && node && node->data)
+		*closest = node;
+
+	g_free (key);
+
+	return node;
+}
+
+static void
+trie_prune (TrackerFileTrie *trie,
+            TrieNode        *node)
+{
+	while (node->parent && !node->data &&
+	       (!node->children || g_hash_table_size (node->children) == 0)) {
+		TrieNode *parent = node->parent;
+
+		g_hash_table_remove (parent->children, node->name);
+		trie_node_free (trie, node);
+		node = parent;
+	}
+}
+
+void
+tracker_file_trie_insert (TrackerFileTrie *trie,
+                          GFile           *file,
+                          gpointer         data)
+{
+	TrieNode *node;
+
+	g_return_if_fail (data != NULL);
+
+	node = trie_lookup_node (trie, file, TRUE, NULL);
+	if (!node)
+		return;
+
+	if (!node->data)
+		trie->size++;
+
+	node->data = data;
+}
+
+gpointer
+tracker_file_trie_lookup (TrackerFileTrie *trie,
+                          GFile           *file)
+{
+	TrieNode *node;
+
+	node = trie_lookup_node (trie, file, FALSE, NULL);
+
+	return node ? node->data : NULL;
+}
+
+/* Returns the data of @file, or of its closest ancestor holding any */
+gpointer
+tracker_file_trie_lookup_ancestor (TrackerFileTrie *trie,
+                                   GFile           *file)
+{
+	TrieNode *closest = NULL;
+
+	trie_lookup_node (trie, file, FALSE, &closest);
+
+	return closest ? closest->data : NULL;
+}
+
+gpointer
+tracker_file_trie_remove (TrackerFileTrie *trie,
+                          GFile           *file)
+{
+	TrieNode *node;
+	gpointer data;
+
+	node = trie_lookup_node (trie, file, FALSE, NULL);
+	if (!node)
+		return NULL;
+
+	data = node->data;
+
+	if (data) {
+		node->data = NULL;
+		trie->size--;
+		trie_prune (trie, node);
+	}
+
+	return data;
+}
+
+static void
+trie_node_collect (TrackerFileTrie  *trie,
+                   TrieNode         *node,
+                   gboolean          steal,
+                   GList           **list)
+{
+	if (node->data) {
+		*list = g_list_prepend (*list, node->data);
+
+		if (steal) {
+			node->data = NULL;
+			trie->size--;
+		}
+	}
+
+	if (node->children) {
+		GHashTableIter iter;
+		TrieNode *child;
+
+		g_hash_table_iter_init (&iter, node->children);
+
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &child))
+			trie_node_collect (trie, child, steal, list);
+	}
+}
+
+/* Removes @prefix and all files below it, returning their data.
+ * The data is not freed.
+ */
+GList *
+tracker_file_trie_steal_descendants (TrackerFileTrie *trie,
+                                     GFile           *prefix)
+{
+	TrieNode *node;
+	GList *list = NULL;
+
+	node = trie_lookup_node (trie, prefix, FALSE, NULL);
+	if (!node)
+		return NULL;
+
+	trie_node_collect (trie, node, TRUE, &list);
+	trie_node_clear_children (trie, node);
+	trie_prune (trie, node);
+
+	return list;
+}
+
+/* Returns the data of @prefix and all files below it, the trie is
+ * left unchanged.
+ */
+GList *
+tracker_file_trie_get_descendants (TrackerFileTrie *trie,
+                                   GFile           *prefix)
+{
+	TrieNode *node;
+	GList *list = NULL;
+
+	node = trie_lookup_node (trie, prefix, FALSE, NULL);
+	if (!node)
+		return NULL;
+
+	trie_node_collect (trie, node, FALSE, &list);
+
+	return list;
+}
+
+guint
+tracker_file_trie_get_size (TrackerFileTrie *trie)
+{
+	return trie->size;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_FILE_TRIE_H__
+#define __TRACKER_FILE_TRIE_H__
+
+#include <gio/gio.h>
+
+typedef struct _TrackerFileTrie TrackerFileTrie;
+
+TrackerFileTrie * tracker_file_trie_new (GDestroyNotify data_destroy);
+void tracker_file_trie_free (TrackerFileTrie *trie);
+
+void tracker_file_trie_insert (TrackerFileTrie *trie,
+                               GFile           *file,
+                               gpointer         data);
+gpointer tracker_file_trie_lookup (TrackerFileTrie *trie,
+                                   GFile           *file);
+gpointer tracker_file_trie_lookup_ancestor (TrackerFileTrie *trie,
+                                            GFile           *file);
+gpointer tracker_file_trie_remove (TrackerFileTrie *trie,
+                                   GFile           *file);
+
+GList * tracker_file_trie_steal_descendants (TrackerFileTrie *trie,
+                                             GFile           *prefix);
+GList * tracker_file_trie_get_descendants (TrackerFileTrie *trie,
+                                           GFile           *prefix);
+
+guint tracker_file_trie_get_size (TrackerFileTrie *trie);
+
+#endif /* __TRACKER_FILE_TRIE_H__ */
@@ -22,6 +22,7 @@
 #include "config-miners.h"
 
 #include "tracker-files-interface.h"
+#include "tracker-miner-files.h"
 
 #include <libtracker-miners-common/tracker-common.h>
 
@@ -34,13 +35,38 @@ struct _TrackerFilesInterface
 	GDBusConnection *connection;
 	GSettings *settings;
 	GVariant *priority_graphs;
+	GStrv fallback_mimetypes;
 #ifdef HAVE_POWER
 	TrackerPower *power;
+	/* logind session, for its IdleHint */
+	GDBusProxy *session_proxy;
+	GCancellable *cancellable;
 #endif
+	TrackerMinerFS *miner;
 	guint object_id;
 	int fd;
 };
 
+/* Files are looked up in the store in chunks, so each query stays
+ * reasonably sized.
+ */
+#define STATUS_CHUNK_SIZE 500
+
+#define STATUS_INDEXED "indexed"
+#define STATUS_PENDING "pending"
+#define STATUS_NOT_INDEXED "not-indexed"
+#define STATUS_FILTERED "filtered"
+#define STATUS_OUTSIDE "outside"
+
+typedef struct {
+	TrackerFilesInterface *files_interface;
+	GDBusMethodInvocation *invocation;
+	GStrv uris;
+	const gchar **statuses;
+	GArray *lookups;
+	guint next_lookup;
+} FileStatusRequest;
+
 enum {
 	PROP_0,
 	PROP_CONNECTION,
@@ -57,6 +83,18 @@ static const gchar *introspection_xml =
 	"    <method name='GetPersistenceStorage'>"
 	"      <arg type='h' direction='out' />"
 	"    </method>"
+	"    <method name='GetFileStatuses'>"
+	"      <arg type='as' name='uris' direction='in' />"
+	"      <arg type='as' name='statuses' direction='out' />"
+	"    </method>"
+	"    <method name='IndexFile'>"
+	"      <arg type='s' name='uri' direction='in' />"
+	"    </method>"
+	"    <method name='RegisterWriteback'>"
+	"      <arg type='s' name='uri' direction='in' />"
+	"      <arg type='x' name='modified' direction='in' />"
+	"      <arg type='x' name='size' direction='in' />"
+	"    </method>"
 	"  </interface>"
 	"</node>";
 
@@ -68,6 +106,288 @@ tracker_files_interface_init (TrackerFilesInterface *files_interface)
 	files_interface->fd = -1;
 }
 
+static void
+file_status_request_free (FileStatusRequest *request)
+{
+	g_object_unref (request->files_interface);
+	g_object_unref (request->invocation);
+	g_strfreev (request->uris);
+	g_free (request->statuses);
+	g_array_unref (request->lookups);
+	g_slice_free (FileStatusRequest, request);
+}
+
+static gboolean
+directory_is_eligible (TrackerIndexingTree *tree,
+                       GFile               *directory,
+                       GFile               *root,
+                       GHashTable          *cache)
+{
+	g_autoptr (GFile) parent = NULL;
+	gpointer value;
+	gboolean eligible;
+
+	if (g_file_equal (directory, root))
+		return TRUE;
+
+	if (g_hash_table_lookup_extended (cache, directory, NULL, &value))
+		return GPOINTER_TO_INT (value);
+
+	eligible =
+		!tracker_indexing_tree_file_matches_filter (tree, TRACKER_FILTER_DIRECTORY, directory) &&
+		!(tracker_indexing_tree_get_filter_hidden (tree) && tracker_file_is_hidden (directory)) &&
+		tracker_indexing_tree_parent_is_indexable (tree, directory);
+
+	parent = g_file_get_parent (directory);
+	if (eligible && parent)
+		eligible = directory_is_eligible (tree, parent, root, cache);
+
+	g_hash_table_insert (cache, g_object_ref (directory), GINT_TO_POINTER (eligible));
+
+	return eligible;
+}
+
+/* Returns NULL if the store must be checked */
+static const gchar *
+get_file_status (TrackerFilesInterface *files_interface,
+                 GFile                 *file,
+                 GHashTable            *directories)
+{
+	TrackerIndexingTree *tree;
+	g_autoptr (GFileInfo) info = NULL;
+	g_autoptr (GFile) parent = NULL;
+	GFile *root;
+
+	if (tracker_miner_fs_is_file_queued (files_interface->miner, file))
+		return STATUS_PENDING;
+
+	tree = tracker_miner_fs_get_indexing_tree (files_interface->miner);
+	root = tracker_indexing_tree_get_root (tree, file, NULL);
+
+	if (!root)
+		return STATUS_OUTSIDE;
+
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+	                          G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+
+	if (!tracker_indexing_tree_file_is_indexable (tree, file, info))
+		return STATUS_FILTERED;
+
+	parent = g_file_get_parent (file);
+	if (parent && !g_file_equal (file, root) &&
+	    !directory_is_eligible (tree, parent, root, directories))
+		return STATUS_FILTERED;
+
+	return NULL;
+}
+
+static void lookup_next_chunk (FileStatusRequest *request);
+
+static void
+lookup_chunk_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+	FileStatusRequest *request = user_data;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GHashTable) found = NULL;
+	g_autoptr (GError) error = NULL;
+	guint i;
+
+	cursor = tracker_sparql_connection_query_finish (TRACKER_SPARQL_CONNECTION (object),
+	                                                 res, &error);
+	found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, &error))
+		g_hash_table_add (found, g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)));
+
+	if (error) {
+		g_dbus_method_invocation_return_gerror (request->invocation, error);
+		file_status_request_free (request);
+		return;
+	}
+
+	for (i = request->next_lookup;
+	     i < request->lookups->len && i < request->next_lookup + STATUS_CHUNK_SIZE;
+	     i++) {
+		guint idx = g_array_index (request->lookups, guint, i);
+
+		request->statuses[idx] =
+			g_hash_table_contains (found, request->uris[idx]) ?
+			STATUS_INDEXED : STATUS_NOT_INDEXED;
+	}
+
+	request->next_lookup = i;
+	lookup_next_chunk (request);
+}
+
+static void
+lookup_next_chunk (FileStatusRequest *request)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (GString) values = NULL;
+	g_autofree gchar *query = NULL;
+	guint i;
+
+	if (request->next_lookup >= request->lookups->len) {
+		g_dbus_method_invocation_return_value (request->invocation,
+		                                       g_variant_new ("(^as)", request->statuses));
+		file_status_request_free (request);
+		return;
+	}
+
+	values = g_string_new (NULL);
+
+	for (i = request->next_lookup;
+	     i < request->lookups->len && i < request->next_lookup + STATUS_CHUNK_SIZE;
+	     i++) {
+		guint idx = g_array_index (request->lookups, guint, i);
+		g_autofree gchar *escaped = NULL;
+
+		escaped = tracker_sparql_escape_string (request->uris[idx]);
+		g_string_append_printf (values, " \"%s\"", escaped);
+	}
+
+	query = g_strdup_printf ("SELECT ?url { "
+	                         "  VALUES ?url {%s } "
+	                         "  GRAPH tracker:FileSystem { ?f nie:url ?url } "
+	                         "}",
+	                         values->str);
+
+	conn = tracker_miner_get_connection (TRACKER_MINER (request->files_interface->miner));
+	tracker_sparql_connection_query_async (conn, query, NULL,
+	                                       lookup_chunk_cb, request);
+}
+
+static void
+handle_get_file_statuses (TrackerFilesInterface *files_interface,
+                          GVariant              *parameters,
+                          GDBusMethodInvocation *invocation)
+{
+	FileStatusRequest *request;
+	g_autoptr (GHashTable) directories = NULL;
+	guint i, len;
+
+	if (!files_interface->miner) {
+		g_dbus_method_invocation_return_error (invocation,
+		                                       G_DBUS_ERROR,
+		                                       G_DBUS_ERROR_NOT_SUPPORTED,
+		                                       "File statuses are not available here");
+		return;
+	}
+
+	request = g_slice_new0 (FileStatusRequest);
+	request->files_interface = g_object_ref (files_interface);
+	request->invocation = g_object_ref (invocation);
+	g_variant_get (parameters, "(^as)", &request->uris);
+
+	len = g_strv_length (request->uris);
+	request->statuses = g_new0 (const gchar *, len + 1);
+	request->lookups = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	/* Directory eligibility is shared by siblings */
+	directories = g_hash_table_new_full (g_file_hash,
+	                                     (GEqualFunc) g_file_equal,
+	                                     g_object_unref, NULL);
+
+	for (i = 0; i < len; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = g_file_new_for_uri (request->uris[i]);
+		request->statuses[i] = get_file_status (files_interface, file, directories);
+
+		/* Only eligible files outside the queues need a query */
+		if (!request->statuses[i])
+			g_array_append_val (request->lookups, i);
+	}
+
+	lookup_next_chunk (request);
+}
+
+static void
+index_file_cb (GObject      *object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+	g_autoptr (GDBusMethodInvocation) invocation = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (tracker_miner_files_index_file_finish (TRACKER_MINER_FILES (object),
+	                                           res, &error))
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	else
+		g_dbus_method_invocation_return_gerror (invocation, error);
+}
+
+static void
+handle_index_file (TrackerFilesInterface *files_interface,
+                   GVariant              *parameters,
+                   GDBusMethodInvocation *invocation)
+{
+	g_autoptr (GHashTable) directories = NULL;
+	g_autoptr (GFile) file = NULL;
+	const gchar *uri, *status;
+
+	if (!files_interface->miner ||
+	    !TRACKER_IS_MINER_FILES (files_interface->miner)) {
+		g_dbus_method_invocation_return_error (invocation,
+		                                       G_DBUS_ERROR,
+		                                       G_DBUS_ERROR_NOT_SUPPORTED,
+		                                       "Files cannot be indexed here");
+		return;
+	}
+
+	g_variant_get (parameters, "(&s)", &uri);
+	file = g_file_new_for_uri (uri);
+	directories = g_hash_table_new_full (g_file_hash,
+	                                     (GEqualFunc) g_file_equal,
+	                                     g_object_unref, NULL);
+	status = get_file_status (files_interface, file, directories);
+
+	if (g_strcmp0 (status, STATUS_OUTSIDE) == 0 ||
+	    g_strcmp0 (status, STATUS_FILTERED) == 0) {
+		g_dbus_method_invocation_return_error (invocation,
+		                                       G_DBUS_ERROR,
+		                                       G_DBUS_ERROR_INVALID_ARGS,
+		                                       "File is not eligible for indexing: %s",
+		                                       uri);
+		return;
+	}
+
+	tracker_miner_files_index_file_async (TRACKER_MINER_FILES (files_interface->miner),
+	                                      file, NULL,
+	                                      index_file_cb,
+	                                      g_object_ref (invocation));
+}
+
+static void
+handle_register_writeback (TrackerFilesInterface *files_interface,
+                           GVariant              *parameters,
+                           GDBusMethodInvocation *invocation)
+{
+	g_autoptr (GFile) file = NULL;
+	const gchar *uri;
+	gint64 modified, size;
+
+	if (!files_interface->miner ||
+	    !TRACKER_IS_MINER_FILES (files_interface->miner)) {
+		g_dbus_method_invocation_return_error (invocation,
+		                                       G_DBUS_ERROR,
+		                                       G_DBUS_ERROR_NOT_SUPPORTED,
+		                                       "Files are not indexed here");
+		return;
+	}
+
+	g_variant_get (parameters, "(&sxx)", &uri, &modified, &size);
+	file = g_file_new_for_uri (uri);
+	tracker_miner_files_register_writeback (TRACKER_MINER_FILES (files_interface->miner),
+	                                        file, modified, size);
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -105,6 +425,12 @@ handle_method_call (GDBusConnection       *connection,
 			                                                         out_parameters,
 			                                                         fd_list);
 		}
+	} else if (g_strcmp0 (method_name, "GetFileStatuses") == 0) {
+		handle_get_file_statuses (files_interface, parameters, invocation);
+	} else if (g_strcmp0 (method_name, "IndexFile") == 0) {
+		handle_index_file (files_interface, parameters, invocation);
+	} else if (g_strcmp0 (method_name, "RegisterWriteback") == 0) {
+		handle_register_writeback (files_interface, parameters, invocation);
 	} else {
 		g_dbus_method_invocation_return_error (invocation,
 		                                       G_DBUS_ERROR,
@@ -114,6 +440,24 @@ handle_method_call (GDBusConnection       *connection,
 	}
 }
 
+#ifdef HAVE_POWER
+static gboolean
+session_is_idle (TrackerFilesInterface *files_interface)
+{
+	g_autoptr (GVariant) idle_hint = NULL;
+
+	if (!files_interface->session_proxy)
+		return FALSE;
+
+	idle_hint = g_dbus_proxy_get_cached_property (files_interface->session_proxy,
+	                                              "IdleHint");
+
+	return idle_hint &&
+		g_variant_is_of_type (idle_hint, G_VARIANT_TYPE_BOOLEAN) &&
+		g_variant_get_boolean (idle_hint);
+}
+#endif
+
 static GVariant *
 create_extractor_config_variant (TrackerFilesInterface *files_interface)
 {
@@ -122,16 +466,46 @@ create_extractor_config_variant (TrackerFilesInterface *files_interface)
 	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
 	g_variant_builder_add (&builder, "{sv}", "max-bytes",
 	                       g_settings_get_value (files_interface->settings, "max-bytes"));
+	g_variant_builder_add (&builder, "{sv}", "text-limits",
+	                       g_settings_get_value (files_interface->settings, "text-limits"));
+	g_variant_builder_add (&builder, "{sv}", "text-tail-bytes",
+	                       g_settings_get_value (files_interface->settings, "text-tail-bytes"));
+	g_variant_builder_add (&builder, "{sv}", "max-list-entries",
+	                       g_settings_get_value (files_interface->settings, "max-list-entries"));
+	g_variant_builder_add (&builder, "{sv}", "media-probe-size",
+	                       g_settings_get_value (files_interface->settings, "media-probe-size"));
+	g_variant_builder_add (&builder, "{sv}", "media-analyze-duration",
+	                       g_settings_get_value (files_interface->settings, "media-analyze-duration"));
+	g_variant_builder_add (&builder, "{sv}", "module-idle-timeout",
+	                       g_settings_get_value (files_interface->settings, "module-idle-timeout"));
+	g_variant_builder_add (&builder, "{sv}", "max-workers",
+	                       g_settings_get_value (files_interface->settings, "max-workers"));
+	g_variant_builder_add (&builder, "{sv}", "max-remote-bandwidth",
+	                       g_settings_get_value (files_interface->settings, "max-remote-bandwidth"));
+	g_variant_builder_add (&builder, "{sv}", "indexing-cpus",
+	                       g_settings_get_value (files_interface->settings, "indexing-cpus"));
 
 	if (files_interface->priority_graphs)
 		g_variant_builder_add (&builder, "{sv}", "priority-graphs", files_interface->priority_graphs);
 
+	g_variant_builder_add (&builder, "{sv}", "fallback-mimetypes",
+	                       files_interface->fallback_mimetypes ?
+	                       g_variant_new_strv ((const gchar * const *) files_interface->fallback_mimetypes, -1) :
+	                       g_variant_new_strv (NULL, 0));
+
 #ifdef HAVE_POWER
 	if (files_interface->power) {
 		g_variant_builder_add (&builder, "{sv}", "on-battery",
 		                       g_variant_new_boolean (tracker_power_get_on_battery (files_interface->power)));
 		g_variant_builder_add (&builder, "{sv}", "on-low-battery",
 		                       g_variant_new_boolean (tracker_power_get_on_low_battery (files_interface->power)));
+
+		/* Leave CPU heavy extractors for AC power, or for the user being away */
+		g_variant_builder_add (&builder, "{sv}", "defer-expensive",
+		                       g_variant_new_boolean (tracker_power_get_on_battery (files_interface->power) &&
+		                                              !g_settings_get_boolean (files_interface->settings,
+		                                                                       "expensive-extractors-on-battery") &&
+		                                              !session_is_idle (files_interface)));
 	}
 #endif
 
@@ -188,6 +562,48 @@ tracker_files_interface_emit_changed (TrackerFilesInterface *files_interface)
 	                               NULL);
 }
 
+/* The crawler, monitors and endpoint share the CPUs of the extractor */
+static void
+update_indexing_cpus (TrackerFilesInterface *files_interface)
+{
+	g_autofree gchar *cpus = NULL;
+
+	cpus = g_settings_get_string (files_interface->settings, "indexing-cpus");
+	tracker_sched_set_affinity (cpus);
+}
+
+#ifdef HAVE_POWER
+static void
+session_proxy_ready_cb (GObject      *object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+	TrackerFilesInterface *files_interface;
+	g_autoptr (GDBusProxy) proxy = NULL;
+	g_autoptr (GError) error = NULL;
+
+	proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	/* Without logind, the user is never considered idle */
+	if (error) {
+		g_debug ("Could not watch the session idle hint: %s", error->message);
+		return;
+	}
+
+	files_interface = user_data;
+	files_interface->session_proxy = g_steal_pointer (&proxy);
+	g_signal_connect_swapped (files_interface->session_proxy, "g-properties-changed",
+	                          G_CALLBACK (tracker_files_interface_emit_changed),
+	                          files_interface);
+
+	if (session_is_idle (files_interface))
+		tracker_files_interface_emit_changed (files_interface);
+}
+#endif
+
 static void
 tracker_files_interface_constructed (GObject *object)
 {
@@ -207,6 +623,27 @@ tracker_files_interface_constructed (GObject *object)
 	files_interface->settings = g_settings_new ("org.freedesktop.Tracker3.Extract");
 	g_signal_connect_swapped (files_interface->settings, "changed::max-bytes",
 	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::text-limits",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::text-tail-bytes",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::max-list-entries",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::media-probe-size",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::media-analyze-duration",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::module-idle-timeout",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::max-workers",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::max-remote-bandwidth",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::indexing-cpus",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::indexing-cpus",
+	                          G_CALLBACK (update_indexing_cpus), object);
+	update_indexing_cpus (files_interface);
 
 #ifdef HAVE_POWER
 	files_interface->power = tracker_power_new ();
@@ -215,6 +652,19 @@ tracker_files_interface_constructed (GObject *object)
 		                          G_CALLBACK (tracker_files_interface_emit_changed), object);
 		g_signal_connect_swapped (files_interface->power, "notify::on-low-battery",
 		                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+		g_signal_connect_swapped (files_interface->settings, "changed::expensive-extractors-on-battery",
+		                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+
+		files_interface->cancellable = g_cancellable_new ();
+		g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+		                          G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+		                          NULL,
+		                          "org.freedesktop.login1",
+		                          "/org/freedesktop/login1/session/auto",
+		                          "org.freedesktop.login1.Session",
+		                          files_interface->cancellable,
+		                          session_proxy_ready_cb,
+		                          files_interface);
 	}
 #endif
 
@@ -242,7 +692,12 @@ tracker_files_interface_finalize (GObject *object)
 	                                     files_interface->object_id);
 	g_clear_object (&files_interface->connection);
 	g_clear_object (&files_interface->settings);
+	g_clear_object (&files_interface->miner);
+	g_strfreev (files_interface->fallback_mimetypes);
 #ifdef HAVE_POWER
+	g_cancellable_cancel (files_interface->cancellable);
+	g_clear_object (&files_interface->cancellable);
+	g_clear_object (&files_interface->session_proxy);
 	g_clear_object (&files_interface->power);
 #endif
 
@@ -362,3 +817,33 @@ tracker_files_interface_set_priority_graphs (TrackerFilesInterface *files_interf
 	if (changed)
 		tracker_files_interface_emit_changed (files_interface);
 }
+
+void
+tracker_files_interface_set_miner (TrackerFilesInterface *files_interface,
+                                   TrackerMinerFS        *miner)
+{
+	g_set_object (&files_interface->miner, miner);
+}
+
+/* Files of these MIME types only get their basic data, as
+ * their extractor keeps failing.
+ */
+void
+tracker_files_interface_set_fallback_mimetypes (TrackerFilesInterface *files_interface,
+                                                const gchar * const   *mimetypes)
+{
+	const gchar * const empty[] = { NULL };
+
+	if (!mimetypes)
+		mimetypes = empty;
+
+	if (g_strv_equal (mimetypes,
+	                  files_interface->fallback_mimetypes ?
+	                  (const gchar * const *) files_interface->fallback_mimetypes : empty))
+		return;
+
+	g_strfreev (files_interface->fallback_mimetypes);
+	files_interface->fallback_mimetypes = g_strdupv ((GStrv) mimetypes);
+
+	tracker_files_interface_emit_changed (files_interface);
+}
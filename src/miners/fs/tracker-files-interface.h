@@ -24,6 +24,8 @@
 
 #include <gio/gio.h>
 
+#include "tracker-miner-fs.h"
+
 #define TRACKER_TYPE_FILES_INTERFACE (tracker_files_interface_get_type ())
 G_DECLARE_FINAL_TYPE (TrackerFilesInterface,
                       tracker_files_interface,
@@ -40,4 +42,10 @@ int tracker_files_interface_dup_fd (TrackerFilesInterface *files_interface);
 void tracker_files_interface_set_priority_graphs (TrackerFilesInterface *files_interface,
                                                   GVariant              *graphs);
 
+void tracker_files_interface_set_fallback_mimetypes (TrackerFilesInterface *files_interface,
+                                                     const gchar * const   *mimetypes);
+
+void tracker_files_interface_set_miner (TrackerFilesInterface *files_interface,
+                                        TrackerMinerFS        *miner);
+
 #endif /* __TRACKER_FILES_INTERFACE_H__ */
@@ -19,8 +19,12 @@
  * Author: Carlos Garnacho  <carlos@lanedo.com>
  */
 
+#include <string.h>
+
 #include <libtracker-miners-common/tracker-file-utils.h>
+#include <libtracker-miners-common/tracker-type-utils.h>
 #include "tracker-indexing-tree.h"
+#include "tracker-file-trie.h"
 
 /**
  * SECTION:tracker-indexing-tree
@@ -33,7 +37,17 @@
 typedef struct _TrackerIndexingTreePrivate TrackerIndexingTreePrivate;
 typedef struct _NodeData NodeData;
 typedef struct _PatternData PatternData;
-typedef struct _FindNodeData FindNodeData;
+typedef struct _FilterMatcher FilterMatcher;
+
+/* Change to a directory within an update, signalled when
+ * the outermost update ends.
+ */
+typedef enum {
+	NODE_CHANGE_NONE,
+	NODE_CHANGE_ADDED,
+	NODE_CHANGE_UPDATED,
+	NODE_CHANGE_REMOVED,
+} NodeChange;
 
 struct _NodeData
 {
@@ -41,6 +55,7 @@ struct _NodeData
 	guint flags;
 	guint shallow : 1;
 	guint removing : 1;
+	guint change : 2;
 };
 
 struct _PatternData
@@ -50,20 +65,35 @@ struct _PatternData
 	TrackerFilterType type;
 };
 
-struct _FindNodeData
+/* Filters of a given type, compiled so that the common literal,
+ * "*suffix" and "prefix*" globs are matched without going through
+ * GPatternSpec, or allocating memory.
+ */
+struct _FilterMatcher
 {
-	GEqualFunc func;
-	GNode *node;
-	GFile *file;
+	GHashTable *literals;
+	GHashTable *suffixes;
+	GArray *suffix_lengths;
+	GPtrArray *prefixes;
+	GPtrArray *patterns;
 };
 
 struct _TrackerIndexingTreePrivate
 {
 	GNode *config_tree;
+	/* Maps configured directories to their config_tree node */
+	TrackerFileTrie *config_nodes;
 	GList *filter_patterns;
+	FilterMatcher *matchers[TRACKER_FILTER_PARENT_DIRECTORY + 1];
 
 	GFile *root;
 	guint filter_hidden : 1;
+
+	/* Nesting of tracker_indexing_tree_begin_update() calls,
+	 * and the nodes changed since the outermost one.
+	 */
+	guint n_updates;
+	GPtrArray *changed_nodes;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerIndexingTree, tracker_indexing_tree, G_TYPE_OBJECT)
@@ -78,6 +108,7 @@ enum {
 	DIRECTORY_REMOVED,
 	DIRECTORY_UPDATED,
 	CHILD_UPDATED,
+	FILTERS_ADDED,
 	LAST_SIGNAL
 };
 
@@ -124,6 +155,7 @@ pattern_data_new (const gchar *string,
 	case TRACKER_FILTER_FILE:
 	case TRACKER_FILTER_DIRECTORY:
 		data->pattern = g_pattern_spec_new (string);
+		data->string = g_strdup (string);
 		break;
 	case TRACKER_FILTER_PARENT_DIRECTORY:
 		data->string = g_strdup (string);
@@ -141,6 +173,125 @@ pattern_data_free (PatternData *data)
 	g_slice_free (PatternData, data);
 }
 
+static void
+filter_matcher_free (FilterMatcher *matcher)
+{
+	g_hash_table_unref (matcher->literals);
+	g_hash_table_unref (matcher->suffixes);
+	g_array_unref (matcher->suffix_lengths);
+	g_ptr_array_unref (matcher->prefixes);
+	g_ptr_array_unref (matcher->patterns);
+	g_slice_free (FilterMatcher, matcher);
+}
+
+static void
+filter_matcher_add_suffix (FilterMatcher *matcher,
+                           const gchar   *suffix)
+{
+	gsize len, i;
+
+	len = strlen (suffix);
+	g_hash_table_add (matcher->suffixes, g_strdup (suffix));
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		if (g_array_index (matcher->suffix_lengths, gsize, i) == len)
+			return;
+	}
+
+	g_array_append_val (matcher->suffix_lengths, len);
+}
+
+static FilterMatcher *
+filter_matcher_new (GList             *filters,
+                    TrackerFilterType  type)
+{
+	FilterMatcher *matcher;
+	GList *l;
+
+	matcher = g_slice_new0 (FilterMatcher);
+	matcher->literals = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->suffixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->prefixes = g_ptr_array_new_with_free_func (g_free);
+	matcher->patterns = g_ptr_array_new ();
+
+	for (l = filters; l; l = l->next) {
+		PatternData *data = l->data;
+		const gchar *glob, *wildcard;
+		gsize len;
+
+		if (data->type != type)
+			continue;
+
+		if (!data->pattern) {
+			g_hash_table_add (matcher->literals, g_strdup (data->string));
+			continue;
+		}
+
+		glob = data->string;
+		len = strlen (glob);
+		wildcard = strpbrk (glob, "*?");
+
+		if (!wildcard) {
+			g_hash_table_add (matcher->literals, g_strdup (glob));
+		} else if (glob[0] == '*' && !strpbrk (&glob[1], "*?")) {
+			filter_matcher_add_suffix (matcher, &glob[1]);
+		} else if (wildcard == &glob[len - 1] && *wildcard == '*') {
+			g_ptr_array_add (matcher->prefixes, g_strndup (glob, len - 1));
+		} else {
+			/* Owned by the PatternData */
+			g_ptr_array_add (matcher->patterns, data->pattern);
+		}
+	}
+
+	return matcher;
+}
+
+static gboolean
+filter_matcher_match (FilterMatcher *matcher,
+                      const gchar   *str,
+                      gsize          len)
+{
+	guint i;
+
+	if (g_hash_table_contains (matcher->literals, str))
+		return TRUE;
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		gsize suffix_len = g_array_index (matcher->suffix_lengths, gsize, i);
+
+		/* The tail of the string is nul-terminated already */
+		if (suffix_len <= len &&
+		    g_hash_table_contains (matcher->suffixes, &str[len - suffix_len]))
+			return TRUE;
+	}
+
+	for (i = 0; i < matcher->prefixes->len; i++) {
+		if (g_str_has_prefix (str, g_ptr_array_index (matcher->prefixes, i)))
+			return TRUE;
+	}
+
+	for (i = 0; i < matcher->patterns->len; i++) {
+		GPatternSpec *pattern = g_ptr_array_index (matcher->patterns, i);
+
+#if GLIB_CHECK_VERSION (2, 70, 0)
+		if (g_pattern_spec_match (pattern, len, str, NULL))
+#else
+		if (g_pattern_match (pattern, len, str, NULL))
+#endif
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+invalidate_matcher (TrackerIndexingTree *tree,
+                    TrackerFilterType    type)
+{
+	g_clear_pointer (&tree->priv->matchers[type], filter_matcher_free);
+}
+
 static void
 tracker_indexing_tree_get_property (GObject    *object,
                                     guint       prop_id,
@@ -200,6 +351,9 @@ tracker_indexing_tree_constructed (GObject *object)
 	data->shallow = TRUE;
 
 	priv->config_tree = g_node_new (data);
+
+	priv->config_nodes = tracker_file_trie_new (NULL);
+	tracker_file_trie_insert (priv->config_nodes, priv->root, priv->config_tree);
 }
 
 static void
@@ -207,6 +361,7 @@ tracker_indexing_tree_finalize (GObject *object)
 {
 	TrackerIndexingTreePrivate *priv;
 	TrackerIndexingTree *tree;
+	guint i;
 
 	tree = TRACKER_INDEXING_TREE (object);
 	priv = tree->priv;
@@ -214,6 +369,9 @@ tracker_indexing_tree_finalize (GObject *object)
 	g_list_foreach (priv->filter_patterns, (GFunc) pattern_data_free, NULL);
 	g_list_free (priv->filter_patterns);
 
+	for (i = 0; i < G_N_ELEMENTS (priv->matchers); i++)
+		g_clear_pointer (&priv->matchers[i], filter_matcher_free);
+
 	g_node_traverse (priv->config_tree,
 	                 G_POST_ORDER,
 	                 G_TRAVERSE_ALL,
@@ -221,6 +379,8 @@ tracker_indexing_tree_finalize (GObject *object)
 	                 (GNodeTraverseFunc) node_free,
 	                 NULL);
 	g_node_destroy (priv->config_tree);
+	tracker_file_trie_free (priv->config_nodes);
+	g_clear_pointer (&priv->changed_nodes, g_ptr_array_unref);
 
 	if (priv->root) {
 		g_object_unref (priv->root);
@@ -337,6 +497,28 @@ tracker_indexing_tree_class_init (TrackerIndexingTreeClass *klass)
 		              NULL, NULL,
 		              NULL,
 		              G_TYPE_NONE, 2, G_TYPE_FILE, G_TYPE_FILE);
+
+	/**
+	 * TrackerIndexingTree::filters-added:
+	 * @indexing_tree: a #TrackerIndexingTree
+	 * @type: the #TrackerFilterType of the new filters
+	 * @globs: the glob strings that were added
+	 *
+	 * The ::filters-added signal is emitted when
+	 * tracker_indexing_tree_set_filters() only added filters of
+	 * the %TRACKER_FILTER_FILE or %TRACKER_FILTER_DIRECTORY types,
+	 * so that content matching them can be removed without checking
+	 * the whole indexing roots again.
+	 **/
+	signals[FILTERS_ADDED] =
+		g_signal_new ("filters-added",
+		              G_OBJECT_CLASS_TYPE (object_class),
+		              G_SIGNAL_RUN_LAST,
+		              G_STRUCT_OFFSET (TrackerIndexingTreeClass,
+		                               filters_added),
+		              NULL, NULL,
+		              NULL,
+		              G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_STRV);
 }
 
 static void
@@ -389,40 +571,19 @@ print_tree (GNode *node)
 
 #endif /* PRINT_INDEXING_TREE */
 
-static gboolean
-find_node_foreach (GNode    *node,
-                   gpointer  user_data)
+static GNode *
+find_directory_node (TrackerIndexingTree *tree,
+                     GFile               *file)
 {
-	FindNodeData *data = user_data;
-	NodeData *node_data = node->data;
-
-	if ((data->func) (data->file, node_data->file)) {
-		data->node = node;
-		return TRUE;
-	}
-
-	return FALSE;
+	return tracker_file_trie_lookup (tree->priv->config_nodes, file);
 }
 
+/* Returns the node for @file, or for the closest directory containing it */
 static GNode *
-find_directory_node (GNode      *node,
-                     GFile      *file,
-                     GEqualFunc  func)
+find_parent_node (TrackerIndexingTree *tree,
+                  GFile               *file)
 {
-	FindNodeData data;
-
-	data.file = file;
-	data.node = NULL;
-	data.func = func;
-
-	g_node_traverse (node,
-	                 G_POST_ORDER,
-	                 G_TRAVERSE_ALL,
-	                 -1,
-	                 find_node_foreach,
-	                 &data);
-
-	return data.node;
+	return tracker_file_trie_lookup_ancestor (tree->priv->config_nodes, file);
 }
 
 static void
@@ -442,6 +603,43 @@ check_reparent_node (GNode    *node,
 	}
 }
 
+static void
+record_node_change (TrackerIndexingTree *tree,
+                    GNode               *node,
+                    NodeChange           change)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+	NodeData *data = node->data;
+
+	if (data->change == NODE_CHANGE_NONE) {
+		if (!priv->changed_nodes)
+			priv->changed_nodes = g_ptr_array_new ();
+		g_ptr_array_add (priv->changed_nodes, node);
+	}
+
+	data->change = change;
+}
+
+static void
+unlink_directory_node (TrackerIndexingTree *tree,
+                       GNode               *node)
+{
+	TrackerIndexingTreePrivate *priv = tree->priv;
+	NodeData *data = node->data;
+	GNode *parent;
+
+	parent = node->parent;
+	g_node_unlink (node);
+	tracker_file_trie_remove (priv->config_nodes, data->file);
+
+	/* Move children to parent */
+	g_node_children_foreach (node, G_TRAVERSE_ALL,
+	                         check_reparent_node, parent);
+
+	node_data_free (node->data);
+	g_node_destroy (node);
+}
+
 /**
  * tracker_indexing_tree_add:
  * @tree: a #TrackerIndexingTree
@@ -464,10 +662,11 @@ tracker_indexing_tree_add (TrackerIndexingTree   *tree,
 	g_return_if_fail (G_IS_FILE (directory));
 
 	priv = tree->priv;
-	node = find_directory_node (priv->config_tree, directory,
-	                            (GEqualFunc) g_file_equal);
+	node = find_directory_node (tree, directory);
 
 	if (node) {
+		gboolean flags_changed = FALSE;
+
 		/* Node already existed */
 		data = node->data;
 		data->shallow = FALSE;
@@ -481,15 +680,30 @@ tracker_indexing_tree_add (TrackerIndexingTree   *tree,
 			g_free (uri);
 
 			data->flags = flags;
-			g_signal_emit (tree, signals[DIRECTORY_UPDATED], 0,
-			               data->file);
+			flags_changed = TRUE;
+		}
+
+		if (priv->n_updates == 0) {
+			if (flags_changed) {
+				g_signal_emit (tree, signals[DIRECTORY_UPDATED], 0,
+				               data->file);
+			}
+		} else if (data->change == NODE_CHANGE_REMOVED) {
+			/* Removed and added back within the update,
+			 * e.g. a remount, so its contents are checked again.
+			 */
+			record_node_change (tree, node, NODE_CHANGE_UPDATED);
+		} else if (flags_changed && data->change == NODE_CHANGE_NONE) {
+			record_node_change (tree, node, NODE_CHANGE_UPDATED);
 		}
+
 		return;
 	}
 
 	/* Find out the parent */
-	parent = find_directory_node (priv->config_tree, directory,
-	                              (GEqualFunc) g_file_has_prefix);
+	parent = find_parent_node (tree, directory);
+	if (!parent)
+		parent = priv->config_tree;
 
 	/* Create node, move children of parent that
 	 * could be children of this new node now.
@@ -502,8 +716,12 @@ tracker_indexing_tree_add (TrackerIndexingTree   *tree,
 
 	/* Add the new node underneath the parent */
 	g_node_append (parent, node);
+	tracker_file_trie_insert (priv->config_nodes, directory, node);
 
-	g_signal_emit (tree, signals[DIRECTORY_ADDED], 0, directory);
+	if (priv->n_updates > 0)
+		record_node_change (tree, node, NODE_CHANGE_ADDED);
+	else
+		g_signal_emit (tree, signals[DIRECTORY_ADDED], 0, directory);
 
 #ifdef PRINT_INDEXING_TREE
 	/* Print tree */
@@ -525,27 +743,24 @@ tracker_indexing_tree_remove (TrackerIndexingTree *tree,
                               GFile               *directory)
 {
 	TrackerIndexingTreePrivate *priv;
-	GNode *node, *parent;
+	GNode *node;
 	NodeData *data;
 
 	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
 	g_return_if_fail (G_IS_FILE (directory));
 
 	priv = tree->priv;
-	node = find_directory_node (priv->config_tree, directory,
-	                            (GEqualFunc) g_file_equal);
+	node = find_directory_node (tree, directory);
 	if (!node) {
 		return;
 	}
 
 	data = node->data;
 
-	if (data->removing) {
+	if (data->removing || data->change == NODE_CHANGE_REMOVED) {
 		return;
 	}
 
-	data->removing = TRUE;
-
 	if (!node->parent) {
 		/* Node is the config tree
 		 * root, mark as shallow again
@@ -554,17 +769,110 @@ tracker_indexing_tree_remove (TrackerIndexingTree *tree,
 		return;
 	}
 
+	if (priv->n_updates > 0) {
+		if (data->change == NODE_CHANGE_ADDED) {
+			/* Never signalled, nothing to undo */
+			g_ptr_array_remove (priv->changed_nodes, node);
+			unlink_directory_node (tree, node);
+		} else {
+			/* Kept in the tree until signalled, so
+			 * handlers still find its flags.
+			 */
+			record_node_change (tree, node, NODE_CHANGE_REMOVED);
+		}
+
+		return;
+	}
+
+	data->removing = TRUE;
 	g_signal_emit (tree, signals[DIRECTORY_REMOVED], 0, data->file);
+	unlink_directory_node (tree, node);
+}
 
-	parent = node->parent;
-	g_node_unlink (node);
+/**
+ * tracker_indexing_tree_begin_update:
+ * @tree: a #TrackerIndexingTree
+ *
+ * Starts a group of tracker_indexing_tree_add() and
+ * tracker_indexing_tree_remove() calls, whose signals are held
+ * back until the matching tracker_indexing_tree_end_update().
+ * Updates may be nested.
+ **/
+void
+tracker_indexing_tree_begin_update (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv;
 
-	/* Move children to parent */
-	g_node_children_foreach (node, G_TRAVERSE_ALL,
-	                         check_reparent_node, parent);
+	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
 
-	node_data_free (node->data);
-	g_node_destroy (node);
+	priv = tree->priv;
+	priv->n_updates++;
+}
+
+/**
+ * tracker_indexing_tree_end_update:
+ * @tree: a #TrackerIndexingTree
+ *
+ * Ends an update started with tracker_indexing_tree_begin_update().
+ * When the outermost update ends, each directory changed within
+ * is signalled once, according to the difference between its
+ * state before and after: directories removed and added back are
+ * updated, added and removed ones are not signalled at all.
+ **/
+void
+tracker_indexing_tree_end_update (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv;
+	g_autoptr (GPtrArray) changed_nodes = NULL;
+	NodeChange change;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
+
+	priv = tree->priv;
+	g_return_if_fail (priv->n_updates > 0);
+
+	priv->n_updates--;
+
+	if (priv->n_updates > 0 || !priv->changed_nodes)
+		return;
+
+	changed_nodes = g_steal_pointer (&priv->changed_nodes);
+
+	/* Removals go first, so the other handlers see the tree
+	 * as if they were already done.
+	 */
+	for (change = NODE_CHANGE_REMOVED; change > NODE_CHANGE_NONE; change--) {
+		for (i = 0; i < changed_nodes->len; i++) {
+			GNode *node = g_ptr_array_index (changed_nodes, i);
+			NodeData *data;
+
+			if (!node)
+				continue;
+
+			data = node->data;
+
+			if (data->change != change)
+				continue;
+
+			data->change = NODE_CHANGE_NONE;
+
+			if (change == NODE_CHANGE_REMOVED) {
+				data->removing = TRUE;
+				g_signal_emit (tree, signals[DIRECTORY_REMOVED], 0, data->file);
+				unlink_directory_node (tree, node);
+				g_ptr_array_index (changed_nodes, i) = NULL;
+			} else if (change == NODE_CHANGE_UPDATED) {
+				g_signal_emit (tree, signals[DIRECTORY_UPDATED], 0, data->file);
+			} else {
+				g_signal_emit (tree, signals[DIRECTORY_ADDED], 0, data->file);
+			}
+		}
+	}
+
+#ifdef PRINT_INDEXING_TREE
+	print_tree (priv->config_tree);
+#endif /* PRINT_INDEXING_TREE */
 }
 
 /**
@@ -661,6 +969,7 @@ tracker_indexing_tree_add_filter (TrackerIndexingTree *tree,
 
 	data = pattern_data_new (glob_string, filter);
 	priv->filter_patterns = g_list_prepend (priv->filter_patterns, data);
+	invalidate_matcher (tree, filter);
 }
 
 /**
@@ -693,6 +1002,96 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 			pattern_data_free (data);
 		}
 	}
+
+	invalidate_matcher (tree, type);
+}
+
+static gboolean
+filter_has_pattern (TrackerIndexingTree *tree,
+                    TrackerFilterType    type,
+                    const gchar         *glob_string)
+{
+	GList *l;
+
+	for (l = tree->priv->filter_patterns; l; l = l->next) {
+		PatternData *data = l->data;
+
+		if (data->type == type && g_strcmp0 (data->string, glob_string) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * tracker_indexing_tree_set_filters:
+ * @tree: a #TrackerIndexingTree
+ * @type: filter type
+ * @globs: (element-type utf8): glob-style strings for the filters
+ *
+ * Replaces the filters of a given type with @globs, and notifies
+ * about the content that may be affected by the change.
+ *
+ * If filters were only added, #TrackerIndexingTree::filters-added
+ * is emitted so the content matching them is removed. Otherwise
+ * files that were filtered out until now are only found by crawling,
+ * so #TrackerIndexingTree::directory-updated is emitted on every
+ * indexing root. Nothing is emitted if the filters did not change.
+ **/
+void
+tracker_indexing_tree_set_filters (TrackerIndexingTree *tree,
+                                   TrackerFilterType    type,
+                                   GSList              *globs)
+{
+	g_autoptr (GPtrArray) added = NULL;
+	gboolean removed = FALSE;
+	GList *l, *roots;
+	GSList *sl;
+
+	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
+
+	added = g_ptr_array_new ();
+
+	for (sl = globs; sl; sl = sl->next) {
+		if (!filter_has_pattern (tree, type, sl->data))
+			g_ptr_array_add (added, sl->data);
+	}
+
+	for (l = tree->priv->filter_patterns; l; l = l->next) {
+		PatternData *data = l->data;
+
+		if (data->type == type &&
+		    !tracker_string_in_gslist (data->string, globs)) {
+			removed = TRUE;
+			break;
+		}
+	}
+
+	if (added->len == 0 && !removed)
+		return;
+
+	tracker_indexing_tree_clear_filters (tree, type);
+
+	for (sl = globs; sl; sl = sl->next)
+		tracker_indexing_tree_add_filter (tree, type, sl->data);
+
+	roots = tracker_indexing_tree_list_roots (tree);
+
+	if (!removed && type != TRACKER_FILTER_PARENT_DIRECTORY) {
+		if (roots) {
+			g_ptr_array_add (added, NULL);
+			g_signal_emit (tree, signals[FILTERS_ADDED], 0,
+			               type, (GStrv) added->pdata);
+		}
+	} else {
+		/* Directory content filters are usually matched by
+		 * hidden files, which are not in the store either.
+		 */
+		for (l = roots; l; l = l->next)
+			g_signal_emit (tree, signals[DIRECTORY_UPDATED], 0, l->data);
+	}
+
+	g_list_free (roots);
 }
 
 /**
@@ -710,62 +1109,59 @@ tracker_indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
                                            TrackerFilterType    type,
                                            GFile               *file)
 {
-	TrackerIndexingTreePrivate *priv;
-	GList *filters;
-	gchar *basename, *str, *reverse;
-	gboolean match = FALSE;
-	gint len;
+	g_autofree gchar *allocated = NULL;
+	const gchar *path, *basename = NULL;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-	priv = tree->priv;
-	filters = priv->filter_patterns;
-	basename = g_file_get_basename (file);
-
-	str = g_utf8_make_valid (basename, -1);
-	len = strlen (str);
-	reverse = g_utf8_strreverse (str, len);
-
-	while (filters) {
-		PatternData *data = filters->data;
+	/* Avoid copying the basename of local files */
+	path = g_file_peek_path (file);
+	if (path) {
+		basename = strrchr (path, G_DIR_SEPARATOR);
+		basename = basename ? &basename[1] : path;
+	}
 
-		filters = filters->next;
+	if (!basename || !*basename)
+		basename = allocated = g_file_get_basename (file);
 
-		if (data->type != type)
-			continue;
+	return tracker_indexing_tree_name_matches_filter (tree, type, basename);
+}
 
-		if (!data->pattern) {
-			match = g_strcmp0 (str, data->string) == 0;
-			break;
-		}
+/**
+ * tracker_indexing_tree_name_matches_filter:
+ * @tree: a #TrackerIndexingTree
+ * @type: filter type
+ * @name: a file basename
+ *
+ * Returns %TRUE if a file named @name matches any filter of the given
+ * filter type. This avoids creating #GFile<!-- -->s for the names
+ * that an enumeration already returned, e.g. to look for the files
+ * matched by %TRACKER_FILTER_PARENT_DIRECTORY filters.
+ *
+ * Returns: %TRUE if @name is filtered.
+ **/
+gboolean
+tracker_indexing_tree_name_matches_filter (TrackerIndexingTree *tree,
+                                           TrackerFilterType    type,
+                                           const gchar         *name)
+{
+	TrackerIndexingTreePrivate *priv;
+	g_autofree gchar *allocated = NULL;
 
-#if GLIB_CHECK_VERSION (2, 70, 0)
-		if (g_pattern_spec_match (data->pattern, len, str, reverse))
-#else
-		if (g_pattern_match (data->pattern, len, str, reverse))
-#endif
+	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
 
-		{
-			match = TRUE;
-			break;
-		}
-	}
+	priv = tree->priv;
 
-	g_free (basename);
-	g_free (str);
-	g_free (reverse);
+	if (!priv->matchers[type])
+		priv->matchers[type] = filter_matcher_new (priv->filter_patterns, type);
 
-	return match;
-}
+	if (!g_utf8_validate (name, -1, NULL))
+		name = allocated = g_utf8_make_valid (name, -1);
 
-static gboolean
-parent_or_equals (GFile *file1,
-                  GFile *file2)
-{
-	return (file1 == file2 ||
-	        g_file_equal (file1, file2) ||
-	        g_file_has_prefix (file1, file2));
+	return filter_matcher_match (priv->matchers[type],
+	                             name, strlen (name));
 }
 
 /**
@@ -971,18 +1367,14 @@ tracker_indexing_tree_get_root (TrackerIndexingTree   *tree,
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 
 	priv = tree->priv;
-	parent = find_directory_node (priv->config_tree, file,
-	                              (GEqualFunc) parent_or_equals);
+	parent = find_parent_node (tree, file);
 	if (!parent) {
 		return NULL;
 	}
 
 	data = parent->data;
 
-	if (!data->shallow &&
-	    (file == data->file ||
-	     g_file_equal (file, data->file) ||
-	     g_file_has_prefix (file, data->file))) {
+	if (!data->shallow) {
 		if (directory_flags) {
 			*directory_flags = data->flags;
 		}
@@ -1062,8 +1454,7 @@ tracker_indexing_tree_file_is_root (TrackerIndexingTree *tree,
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
 	priv = tree->priv;
-	node = find_directory_node (priv->config_tree, file,
-	                            (GEqualFunc) g_file_equal);
+	node = find_directory_node (tree, file);
 	return node != NULL;
 }
 
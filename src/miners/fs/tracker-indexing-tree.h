@@ -58,6 +58,7 @@ struct _TrackerIndexingTree {
  * @directory_removed: Called when a directory is removed.
  * @directory_updated: Called when a directory is updated.
  * @child_updated: Called when a file inside a directory is updated.
+ * @filters_added: Called when filters were added.
  * @padding: Reserved for future API improvements.
  *
  * Class for the #TrackerIndexingTree.
@@ -74,8 +75,11 @@ typedef struct {
 	void (* child_updated)     (TrackerIndexingTree *indexing_tree,
 	                            GFile               *root,
 	                            GFile               *child);
+	void (* filters_added)     (TrackerIndexingTree *indexing_tree,
+	                            TrackerFilterType    type,
+	                            GStrv                globs);
 	/* <Private> */
-	gpointer padding[9];
+	gpointer padding[8];
 } TrackerIndexingTreeClass;
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrackerIndexingTree, g_object_unref)
@@ -89,6 +93,8 @@ void      tracker_indexing_tree_add                  (TrackerIndexingTree   *tre
                                                       TrackerDirectoryFlags  flags);
 void      tracker_indexing_tree_remove               (TrackerIndexingTree   *tree,
                                                       GFile                 *directory);
+void      tracker_indexing_tree_begin_update         (TrackerIndexingTree   *tree);
+void      tracker_indexing_tree_end_update           (TrackerIndexingTree   *tree);
 gboolean  tracker_indexing_tree_notify_update        (TrackerIndexingTree   *tree,
                                                       GFile                 *file,
                                                       gboolean               recursive);
@@ -98,9 +104,15 @@ void      tracker_indexing_tree_add_filter           (TrackerIndexingTree  *tree
                                                       const gchar          *glob_string);
 void      tracker_indexing_tree_clear_filters        (TrackerIndexingTree  *tree,
                                                       TrackerFilterType     type);
+void      tracker_indexing_tree_set_filters          (TrackerIndexingTree  *tree,
+                                                      TrackerFilterType     type,
+                                                      GSList               *globs);
 gboolean  tracker_indexing_tree_file_matches_filter  (TrackerIndexingTree  *tree,
                                                       TrackerFilterType     type,
                                                       GFile                *file);
+gboolean  tracker_indexing_tree_name_matches_filter  (TrackerIndexingTree  *tree,
+                                                      TrackerFilterType     type,
+                                                      const gchar          *name);
 
 gboolean  tracker_indexing_tree_file_is_indexable    (TrackerIndexingTree  *tree,
                                                       GFile                *file,
@@ -21,33 +21,54 @@
 
 #include "config-miners.h"
 
+#include <libtracker-miners-common/tracker-common.h>
+
 #include "tracker-lru.h"
 
+/* This is a CLOCK cache, an approximation of LRU. Elements are kept
+ * in a fixed array, and get a "referenced" bit set when found. When
+ * a slot is needed, the clock hand sweeps over the array, clearing
+ * referenced bits, until it finds an element that was not recently
+ * used.
+ */
+
 typedef struct _TrackerLRUElement TrackerLRUElement;
 
 struct _TrackerLRUElement {
 	gpointer element;
 	gpointer data;
-	GList *link;
+	guint referenced : 1;
 };
 
 struct _TrackerLRU {
-	GQueue queue;
-	GHashTable *items;
+	TrackerLRUElement *slots;
+	GHashTable *items; /* element -> slot index + 1 */
 	GDestroyNotify elem_destroy;
 	GDestroyNotify data_destroy;
 	guint max_size;
+	guint hand;
+	guint hits;
+	guint misses;
 	gint ref_count;
 };
 
+#define SLOT_TO_POINTER(i) (GUINT_TO_POINTER ((i) + 1))
+#define POINTER_TO_SLOT(p) (GPOINTER_TO_UINT (p) - 1)
+
 static void
-free_node (TrackerLRUElement *node,
-           TrackerLRU        *lru)
+free_slot (TrackerLRU *lru,
+           guint       slot)
 {
+	TrackerLRUElement *node = &lru->slots[slot];
+
+	if (!node->element)
+		return;
+
 	g_hash_table_remove (lru->items, node->element);
 	lru->elem_destroy (node->element);
 	lru->data_destroy (node->data);
-	g_slice_free (TrackerLRUElement, node);
+	node->element = node->data = NULL;
+	node->referenced = FALSE;
 }
 
 TrackerLRU *
@@ -59,15 +80,19 @@ tracker_lru_new (guint                size,
 {
 	TrackerLRU *lru;
 
+	g_return_val_if_fail (size > 0, NULL);
+
 	lru = g_new0 (TrackerLRU, 1);
-	g_queue_init (&lru->queue);
 	lru->max_size = size;
+	lru->slots = g_new0 (TrackerLRUElement, size);
 	lru->elem_destroy = elem_destroy;
 	lru->data_destroy = data_destroy;
 	lru->items = g_hash_table_new (elem_hash_func,
 	                               elem_equal_func);
 	lru->ref_count = 1;
 
+	TRACKER_MEMORY_ALLOC (LRU, sizeof (TrackerLRU) + size * sizeof (TrackerLRUElement));
+
 	return lru;
 }
 
@@ -82,18 +107,14 @@ void
 tracker_lru_unref (TrackerLRU *lru)
 {
 	if (g_atomic_int_dec_and_test (&lru->ref_count)) {
-		TrackerLRUElement *node;
-		GHashTableIter iter;
+		guint i;
 
-		g_hash_table_iter_init (&iter, lru->items);
-
-		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &node)) {
-			g_hash_table_iter_remove (&iter);
-			free_node (node, lru);
-		}
+		for (i = 0; i < lru->max_size; i++)
+			free_slot (lru, i);
 
 		g_hash_table_unref (lru->items);
-		g_queue_clear (&lru->queue);
+		TRACKER_MEMORY_FREE (LRU, sizeof (TrackerLRU) + lru->max_size * sizeof (TrackerLRUElement));
+		g_free (lru->slots);
 		g_free (lru);
 	}
 }
@@ -104,59 +125,85 @@ tracker_lru_find (TrackerLRU *lru,
                   gpointer   *data)
 {
 	TrackerLRUElement *node;
+	gpointer slot;
 
-	node = g_hash_table_lookup (lru->items, elem);
-	if (!node)
+	if (!g_hash_table_lookup_extended (lru->items, elem, NULL, &slot)) {
+		lru->misses++;
 		return FALSE;
+	}
+
+	lru->hits++;
+	node = &lru->slots[POINTER_TO_SLOT (slot)];
+	node->referenced = TRUE;
 
 	if (data)
 		*data = node->data;
 
-	if (node->link != lru->queue.head) {
-		/* Push to head */
-		g_queue_unlink (&lru->queue, node->link);
-		g_queue_push_head_link (&lru->queue, node->link);
-	}
-
 	return TRUE;
 }
 
+static guint
+find_free_slot (TrackerLRU *lru)
+{
+	TrackerLRUElement *node;
+	guint slot;
+
+	/* Terminates in at most two sweeps, as the first one
+	 * clears all referenced bits.
+	 */
+	while (TRUE) {
+		slot = lru->hand;
+		node = &lru->slots[slot];
+		lru->hand = (lru->hand + 1) % lru->max_size;
+
+		if (!node->element)
+			return slot;
+
+		if (node->referenced) {
+			node->referenced = FALSE;
+			continue;
+		}
+
+		free_slot (lru, slot);
+		return slot;
+	}
+}
+
 void
 tracker_lru_add (TrackerLRU *lru,
                  gpointer    elem,
                  gpointer    data)
 {
-	TrackerLRUElement *node, *last;
+	TrackerLRUElement *node;
+	gpointer slot;
+	guint i;
+
+	if (g_hash_table_lookup_extended (lru->items, elem, NULL, &slot)) {
+		/* Replace the existing element */
+		free_slot (lru, POINTER_TO_SLOT (slot));
+		i = POINTER_TO_SLOT (slot);
+	} else {
+		i = find_free_slot (lru);
+	}
 
-	node = g_slice_new0 (TrackerLRUElement);
+	node = &lru->slots[i];
 	node->element = elem;
 	node->data = data;
-	node->link = g_list_alloc ();
-	node->link->data = node;
+	node->referenced = TRUE;
 
-	g_queue_push_head_link (&lru->queue, node->link);
-
-	g_hash_table_insert (lru->items, elem, node);
-
-	if (g_hash_table_size (lru->items) > lru->max_size) {
-		/* Remove last element */
-		last = g_queue_pop_tail (&lru->queue);
-		free_node (last, lru);
-	}
+	g_hash_table_insert (lru->items, elem, SLOT_TO_POINTER (i));
 }
 
 void
 tracker_lru_remove (TrackerLRU *lru,
                     gpointer    elem)
 {
-	TrackerLRUElement *node;
+	gpointer slot;
 
-	node = g_hash_table_lookup (lru->items, elem);
-	if (!node)
+	if (!g_hash_table_lookup_extended (lru->items, elem, NULL, &slot))
 		return;
 
-	g_queue_remove (&lru->queue, node);
-	free_node (node, lru);
+	free_slot (lru, POINTER_TO_SLOT (slot));
 }
 
 void
@@ -164,18 +211,29 @@ tracker_lru_remove_foreach (TrackerLRU *lru,
                             GEqualFunc  equal_func,
                             gpointer    elem)
 {
-	TrackerLRUElement *node;
-	GList *next, *link = lru->queue.head;
+	guint i;
 
-	while (link) {
-		node = link->data;
-		next = link->next;
+	for (i = 0; i < lru->max_size; i++) {
+		TrackerLRUElement *node = &lru->slots[i];
 
-		if (equal_func (node->element, elem) == TRUE) {
-			g_queue_unlink (&lru->queue, node->link);
-			free_node (node, lru);
-		}
-
-		link = next;
+		if (node->element && equal_func (node->element, elem) == TRUE)
+			free_slot (lru, i);
 	}
 }
+
+void
+tracker_lru_get_stats (TrackerLRU *lru,
+                       guint      *hits,
+                       guint      *misses)
+{
+	if (hits)
+		*hits = lru->hits;
+	if (misses)
+		*misses = lru->misses;
+}
+
+guint
+tracker_lru_get_size (TrackerLRU *lru)
+{
+	return lru->max_size;
+}
@@ -48,4 +48,10 @@ void tracker_lru_remove_foreach (TrackerLRU *lru,
                                  GEqualFunc  compare_func,
                                  gpointer    elem);
 
+void tracker_lru_get_stats (TrackerLRU *lru,
+                            guint      *hits,
+                            guint      *misses);
+
+guint tracker_lru_get_size (TrackerLRU *lru);
+
 #endif /* __TRACKER_LRU_H__ */
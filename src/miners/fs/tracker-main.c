@@ -44,8 +44,10 @@
 
 #include "tracker-config.h"
 #include "tracker-controller.h"
+#include "tracker-estimate.h"
 #include "tracker-miner-files.h"
 #include "tracker-files-interface.h"
+#include "tracker-mem-pool.h"
 
 #include <tinysparql.h>
 
@@ -73,6 +75,8 @@ static guint cleanup_id;
 static gint initial_sleep = -1;
 static gboolean no_daemon;
 static gchar *eligible;
+static gchar *estimate;
+static gchar *record_trace;
 static gboolean version;
 static guint miners_timeout_id = 0;
 static gboolean do_crawling = FALSE;
@@ -97,10 +101,18 @@ static GOptionEntry entries[] = {
 	  G_OPTION_ARG_FILENAME, &eligible,
 	  N_("Checks if FILE is eligible for being mined based on configuration"),
 	  N_("FILE") },
+	{ "estimate", 0, 0,
+	  G_OPTION_ARG_FILENAME, &estimate,
+	  N_("Estimates the cost of indexing DIRECTORY, without indexing it"),
+	  N_("DIRECTORY") },
 	{ "domain-ontology", 'd', 0,
 	  G_OPTION_ARG_STRING, &domain_ontology_name,
 	  N_("Runs for a specific domain ontology"),
 	  NULL },
+	{ "record-trace", 0, 0,
+	  G_OPTION_ARG_FILENAME, &record_trace,
+	  N_("Records anonymized filesystem events to FILE, for replaying them later"),
+	  N_("FILE") },
 	{ "dry-run", 'r', 0,
 	  G_OPTION_ARG_NONE, &dry_run,
 	  N_("Avoids changes in the filesystem"),
@@ -314,7 +326,7 @@ should_crawl (TrackerMinerFiles *miner_files,
 		TRACKER_NOTE (CONFIG, g_message ("  Disabled"));
 		return FALSE;
 	} else if (crawling_interval == -1) {
-		TRACKER_NOTE (CONFIG, g_message ("  Maybe (depends on a clean last shutdown)"));
+		TRACKER_NOTE (CONFIG, g_message ("  Maybe (folders left up to date only check the directories changed since)"));
 		return TRUE;
 	} else if (crawling_interval == 0) {
 		TRACKER_NOTE (CONFIG, g_message ("  Forced"));
@@ -398,8 +410,16 @@ miner_start (TrackerMiner  *miner,
 }
 
 static void
-release_heap_memory (void)
+release_heap_memory (gboolean trim_heap)
 {
+	/* Pooled structures are given back wholesale, walking
+	 * the whole heap is only worth it under memory pressure.
+	 */
+	tracker_mem_pool_trim_all ();
+
+	if (!trim_heap)
+		return;
+
 #ifdef HAVE_MALLOC_TRIM
 	malloc_trim (0);
 #else
@@ -410,7 +430,7 @@ release_heap_memory (void)
 static gboolean
 cleanup_cb (gpointer user_data)
 {
-	release_heap_memory ();
+	release_heap_memory (FALSE);
 
 	cleanup_id = 0;
 
@@ -437,7 +457,7 @@ on_low_memory (GMemoryMonitor            *monitor,
                gpointer                   user_data)
 {
 	if (level > G_MEMORY_MONITOR_WARNING_LEVEL_LOW)
-		release_heap_memory ();
+		release_heap_memory (TRUE);
 }
 #endif
 
@@ -463,6 +483,10 @@ miner_finished_cb (TrackerMinerFS *fs,
 	        total_directories_found,
 	        total_files_found);
 
+	TRACKER_NOTE (STATISTICS, g_message ("Memory pools after mining:"));
+	TRACKER_NOTE (STATISTICS, tracker_mem_pool_print_stats ());
+	release_heap_memory (FALSE);
+
 	if (do_crawling && !dry_run) {
 		set_last_crawl_done (TRACKER_MINER_FILES (fs), TRUE);
 	}
@@ -804,6 +828,25 @@ setup_connection (TrackerDomainOntology  *domain,
 	return sparql_conn;
 }
 
+static void
+setup_connection_thread (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+	TrackerSparqlConnection *sparql_conn;
+	GError *error = NULL;
+
+	sparql_conn = setup_connection (task_data, &error);
+
+	if (sparql_conn) {
+		g_clear_error (&error);
+		g_task_return_pointer (task, sparql_conn, g_object_unref);
+	} else {
+		g_task_return_error (task, error);
+	}
+}
+
 int
 main (gint argc, gchar *argv[])
 {
@@ -818,6 +861,7 @@ main (gint argc, gchar *argv[])
 	TrackerStorage *storage;
 	TrackerDomainOntology *domain_ontology;
 	TrackerController *controller;
+	GTask *connection_task;
 #if GLIB_CHECK_VERSION (2, 64, 0)
 	GMemoryMonitor *memory_monitor;
 #endif
@@ -844,13 +888,6 @@ main (gint argc, gchar *argv[])
 	 */
 	raise_file_descriptor_limit ();
 
-	/* Preempt possible registry updates, before tracker-extract-3 deals
-	 * with gstreamer plugins.
-	 */
-#if defined(HAVE_GSTREAMER)
-	gst_init (NULL, NULL);
-#endif
-
 	/* Translators: this messagge will apper immediately after the
 	 * usage string - Usage: COMMAND <THIS_MESSAGE>
 	 */
@@ -872,12 +909,23 @@ main (gint argc, gchar *argv[])
 	}
 
 	indexing_tree = tracker_indexing_tree_new ();
-	storage = tracker_storage_new ();
 
 	if (eligible) {
+		storage = tracker_storage_new ();
 		return check_eligible (indexing_tree, storage);
 	}
 
+	if (estimate) {
+		g_autoptr (TrackerController) controller = NULL;
+		g_autoptr (GFile) file = NULL;
+
+		storage = tracker_storage_new ();
+		controller = tracker_controller_new (indexing_tree, storage, NULL);
+		file = g_file_new_for_commandline_arg (estimate);
+
+		return tracker_estimate_directory (indexing_tree, file);
+	}
+
 	domain_ontology = tracker_domain_ontology_new (domain_ontology_name, NULL, &error);
 	if (error) {
 		g_critical ("Could not load domain ontology '%s': %s",
@@ -886,6 +934,28 @@ main (gint argc, gchar *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (!dry_run) {
+		GFile *store = get_cache_dir (domain_ontology);
+
+		initial_index = !g_file_query_exists (store, NULL);
+		tracker_error_report_init (store);
+		g_object_unref (store);
+	}
+
+	/* Opening the store is the slowest part of startup, let it
+	 * happen while the bus, configuration and mounts are set up.
+	 */
+	connection_task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_task_data (connection_task, domain_ontology, NULL);
+	g_task_run_in_thread (connection_task, setup_connection_thread);
+
+	/* Preempt possible registry updates, before tracker-extract-3 deals
+	 * with gstreamer plugins.
+	 */
+#if defined(HAVE_GSTREAMER)
+	gst_init (NULL, NULL);
+#endif
+
 	connection = g_bus_get_sync (TRACKER_IPC_BUS, NULL, &error);
 	if (error) {
 		g_critical ("Could not create DBus connection: %s\n",
@@ -905,6 +975,8 @@ main (gint argc, gchar *argv[])
 
 	log_option_values (config);
 
+	storage = tracker_storage_new ();
+
 	main_loop = g_main_loop_new (NULL, FALSE);
 
 	if (no_daemon) {
@@ -925,15 +997,12 @@ main (gint argc, gchar *argv[])
 		g_debug ("tracker-miner-fs-3 running as org.freedesktop." DBUS_NAME_SUFFIX);
 	}
 
-	if (!dry_run) {
-		GFile *store = get_cache_dir (domain_ontology);
+	while (!g_task_get_completed (connection_task))
+		g_main_context_iteration (NULL, TRUE);
 
-		initial_index = !g_file_query_exists (store, NULL);
-		tracker_error_report_init (store);
-		g_object_unref (store);
-	}
+	sparql_conn = g_task_propagate_pointer (connection_task, &error);
+	g_object_unref (connection_task);
 
-	sparql_conn = setup_connection (domain_ontology, &error);
 	if (!sparql_conn) {
 
 		g_critical ("Could not create store: %s",
@@ -959,6 +1028,33 @@ main (gint argc, gchar *argv[])
 	                                       domain_ontology,
 	                                       initial_index);
 
+	if (!dry_run) {
+		g_autoptr (GFile) store = NULL;
+
+		store = get_cache_dir (domain_ontology);
+		tracker_miner_files_set_store_location (TRACKER_MINER_FILES (miner_files),
+		                                        store);
+	}
+
+	if (record_trace) {
+		g_autoptr (GFile) trace_file = NULL;
+		TrackerEventRecorder *recorder;
+
+		trace_file = g_file_new_for_commandline_arg (record_trace);
+		recorder = tracker_event_recorder_new (trace_file, indexing_tree, &error);
+
+		if (recorder) {
+			tracker_miner_fs_set_event_recorder (TRACKER_MINER_FS (miner_files),
+			                                     recorder);
+		} else {
+			g_warning ("Not recording events: %s", error->message);
+			g_clear_error (&error);
+		}
+	}
+
+	tracker_files_interface_set_miner (files_interface,
+	                                   TRACKER_MINER_FS (miner_files));
+
 	controller = tracker_controller_new (indexing_tree, storage, files_interface);
 
 	proxy = tracker_miner_proxy_new (miner_files, connection, DBUS_PATH, NULL, &error);
@@ -1030,6 +1126,7 @@ main (gint argc, gchar *argv[])
 		miner_start (miner_files, config);
 
 	initialize_signal_handler ();
+	tracker_memory_start_reporting ();
 
 	/* Go, go, go! */
 	g_main_loop_run (main_loop);
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <libtracker-miners-common/tracker-common.h>
+
+#include "tracker-mem-pool.h"
+
+/* Fixed size element pools for the structures the miner keeps one of
+ * per queued file. Elements are carved from anonymous mappings of their
+ * own, so the whole pool can be given back to the system at once after
+ * a crawl, without walking the heap as malloc_trim() does. Pools are
+ * meant to be used from the main thread only.
+ */
+
+#define SLAB_SIZE (256 * 1024)
+
+typedef struct _FreeElem FreeElem;
+
+struct _FreeElem {
+	FreeElem *next;
+};
+
+struct _TrackerMemPool {
+	gchar *name;
+	gsize elem_size;
+	GSList *slabs;
+	guint8 *slab_pos;
+	guint8 *slab_end;
+	FreeElem *free_list;
+	guint n_slabs;
+	guint n_heap;
+	guint n_live;
+	guint n_peak;
+};
+
+static GSList *pools = NULL;
+
+TrackerMemPool *
+tracker_mem_pool_new (const gchar *name,
+                      gsize        elem_size)
+{
+	TrackerMemPool *pool;
+
+	g_return_val_if_fail (elem_size > 0 && elem_size <= SLAB_SIZE, NULL);
+
+	pool = g_new0 (TrackerMemPool, 1);
+	pool->name = g_strdup (name);
+	pool->elem_size = MAX (elem_size, sizeof (FreeElem));
+	pool->elem_size = (pool->elem_size + sizeof (gpointer) - 1) &
+		~(sizeof (gpointer) - 1);
+	pools = g_slist_prepend (pools, pool);
+
+	return pool;
+}
+
+static gboolean
+pool_add_slab (TrackerMemPool *pool)
+{
+	gpointer slab;
+
+	slab = mmap (NULL, SLAB_SIZE, PROT_READ | PROT_WRITE,
+	             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (slab == MAP_FAILED)
+		return FALSE;
+
+	pool->slabs = g_slist_prepend (pool->slabs, slab);
+	pool->slab_pos = slab;
+	pool->slab_end = pool->slab_pos + SLAB_SIZE - (SLAB_SIZE % pool->elem_size);
+	pool->n_slabs++;
+
+	return TRUE;
+}
+
+gpointer
+tracker_mem_pool_alloc0 (TrackerMemPool *pool)
+{
+	gpointer mem;
+
+	if (pool->free_list) {
+		mem = pool->free_list;
+		pool->free_list = pool->free_list->next;
+		memset (mem, 0, pool->elem_size);
+	} else {
+		if (pool->slab_pos == pool->slab_end &&
+		    !pool_add_slab (pool)) {
+			/* Fall back to the heap, recycle() tells
+			 * these apart as they are out of every slab.
+			 */
+			pool->n_heap++;
+			return g_malloc0 (pool->elem_size);
+		}
+
+		/* Fresh anonymous pages are zeroed already */
+		mem = pool->slab_pos;
+		pool->slab_pos += pool->elem_size;
+	}
+
+	pool->n_live++;
+	pool->n_peak = MAX (pool->n_peak, pool->n_live);
+
+	return mem;
+}
+
+static gboolean
+pool_owns (TrackerMemPool *pool,
+           gpointer        mem)
+{
+	GSList *l;
+
+	for (l = pool->slabs; l; l = l->next) {
+		guint8 *slab = l->data;
+
+		if ((guint8 *) mem >= slab && (guint8 *) mem < slab + SLAB_SIZE)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+void
+tracker_mem_pool_recycle (TrackerMemPool *pool,
+                          gpointer        mem)
+{
+	FreeElem *elem = mem;
+
+	if (!mem)
+		return;
+
+	/* Heap fallbacks only happen once mmap() failed, look
+	 * the slabs up just then.
+	 */
+	if (G_UNLIKELY (pool->n_heap > 0) && !pool_owns (pool, mem)) {
+		pool->n_heap--;
+		g_free (mem);
+		return;
+	}
+
+	elem->next = pool->free_list;
+	pool->free_list = elem;
+	pool->n_live--;
+}
+
+/* Gives the slabs back to the system if no element is in use, returns
+ * the number of bytes released.
+ */
+gsize
+tracker_mem_pool_trim (TrackerMemPool *pool)
+{
+	gsize released;
+	GSList *l;
+
+	if (pool->n_live > 0 || pool->n_slabs == 0)
+		return 0;
+
+	for (l = pool->slabs; l; l = l->next)
+		munmap (l->data, SLAB_SIZE);
+
+	released = (gsize) pool->n_slabs * SLAB_SIZE;
+	g_clear_pointer (&pool->slabs, g_slist_free);
+	pool->slab_pos = pool->slab_end = NULL;
+	pool->free_list = NULL;
+	pool->n_slabs = 0;
+	pool->n_peak = 0;
+
+	return released;
+}
+
+gsize
+tracker_mem_pool_trim_all (void)
+{
+	gsize released = 0;
+	GSList *l;
+
+	for (l = pools; l; l = l->next)
+		released += tracker_mem_pool_trim (l->data);
+
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("Memory pools released %" G_GSIZE_FORMAT " KiB",
+	                         released / 1024));
+
+	return released;
+}
+
+void
+tracker_mem_pool_print_stats (void)
+{
+	GSList *l;
+
+	for (l = pools; l; l = l->next) {
+		TrackerMemPool *pool = l->data;
+
+		g_message ("  %-16s %8u elements in use, peak %8u, %6u KiB mapped",
+		           pool->name, pool->n_live, pool->n_peak,
+		           (guint) (pool->n_slabs * (SLAB_SIZE / 1024)));
+	}
+}
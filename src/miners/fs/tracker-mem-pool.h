@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_MEM_POOL_H__
+#define __TRACKER_MEM_POOL_H__
+
+#include <glib.h>
+
+typedef struct _TrackerMemPool TrackerMemPool;
+
+TrackerMemPool * tracker_mem_pool_new (const gchar *name,
+                                       gsize        elem_size);
+
+gpointer tracker_mem_pool_alloc0 (TrackerMemPool *pool);
+void tracker_mem_pool_recycle (TrackerMemPool *pool,
+                               gpointer        mem);
+
+gsize tracker_mem_pool_trim (TrackerMemPool *pool);
+gsize tracker_mem_pool_trim_all (void);
+
+void tracker_mem_pool_print_stats (void);
+
+#endif /* __TRACKER_MEM_POOL_H__ */
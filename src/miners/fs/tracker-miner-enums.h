@@ -56,6 +56,9 @@ G_BEGIN_DECLS
  * @TRACKER_DIRECTORY_FLAG_CHECK_DELETED: Forces checks on deleted
  * contents. This is most usually optimized away unless directory
  * mtime changes indicate there could be deleted content.
+ * @TRACKER_DIRECTORY_FLAG_PROGRESSIVE: Crawls the directory breadth
+ * first, giving its first levels priority over the deeper ones, and
+ * notifies when each level was crawled.
  *
  * Flags used when adding a new directory to be indexed in the
  * #TrackerIndexingTree and #TrackerDataProvider.
@@ -70,6 +73,7 @@ typedef enum {
 	TRACKER_DIRECTORY_FLAG_PRIORITY        = 1 << 6,
 	TRACKER_DIRECTORY_FLAG_NO_STAT         = 1 << 7,
 	TRACKER_DIRECTORY_FLAG_CHECK_DELETED   = 1 << 8,
+	TRACKER_DIRECTORY_FLAG_PROGRESSIVE     = 1 << 9,
 } TrackerDirectoryFlags;
 
 /**
@@ -20,8 +20,6 @@
 
 #include "config-miners.h"
 
-#include <gio/gunixmounts.h>
-
 #include "tracker-miner-files-methods.h"
 
 #include <libtracker-extract/tracker-extract.h>
@@ -29,6 +27,21 @@
 
 #define DEFAULT_GRAPH "tracker:FileSystem"
 
+static const gchar *
+miner_files_get_data_source (TrackerMinerFiles *mf,
+                             GFile             *file)
+{
+	TrackerMinerFS *fs = TRACKER_MINER_FS (mf);
+	GFile *root;
+
+	root = tracker_indexing_tree_get_root (tracker_miner_fs_get_indexing_tree (fs),
+	                                       file, NULL);
+	if (!root)
+		return NULL;
+
+	return tracker_miner_fs_get_identifier (fs, root);
+}
+
 static void
 miner_files_add_to_datasource (TrackerMinerFiles *mf,
                                GFile             *file,
@@ -43,13 +56,9 @@ miner_files_add_to_datasource (TrackerMinerFiles *mf,
 	if (tracker_indexing_tree_file_is_root (indexing_tree, file)) {
 		tracker_resource_set_relation (resource, "nie:dataSource", element_resource);
 	} else {
-		const gchar *identifier = NULL;
-		GFile *root;
-
-		root = tracker_indexing_tree_get_root (indexing_tree, file, NULL);
+		const gchar *identifier;
 
-		if (root)
-			identifier = tracker_miner_fs_get_identifier (fs, root);
+		identifier = miner_files_get_data_source (mf, file);
 
 		if (identifier)
 			tracker_resource_set_uri (resource, "nie:dataSource", identifier);
@@ -59,13 +68,17 @@ miner_files_add_to_datasource (TrackerMinerFiles *mf,
 static void
 miner_files_add_mount_info (TrackerMinerFiles *miner,
                             TrackerResource   *resource,
-                            GFile             *file)
+                            GFile             *file,
+                            GFileInfo         *file_info)
 {
 	TrackerStorage *storage;
 	TrackerStorageType storage_type;
+	const gchar *device_id;
 
 	storage = tracker_miner_files_get_storage (miner);
-	storage_type = tracker_storage_get_type_for_file (storage, file);
+	device_id = g_file_info_get_attribute_string (file_info,
+	                                              G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+	storage_type = tracker_storage_get_type_for_device (storage, file, device_id);
 
 	if (storage_type == 0)
 		return;
@@ -79,6 +92,7 @@ miner_files_add_mount_info (TrackerMinerFiles *miner,
 static TrackerResource *
 miner_files_create_folder_information_element (TrackerMinerFiles *miner,
                                                GFile             *file,
+                                               GFileInfo         *file_info,
                                                const gchar       *mime_type,
                                                gboolean           create)
 {
@@ -104,7 +118,7 @@ miner_files_create_folder_information_element (TrackerMinerFiles *miner,
 		tracker_resource_set_uri (resource, "nie:rootElementOf",
 		                          tracker_resource_get_identifier (resource));
 
-		miner_files_add_mount_info (miner, resource, file);
+		miner_files_add_mount_info (miner, resource, file, file_info);
 	}
 
 	uri = g_file_get_uri (file);
@@ -159,21 +173,72 @@ miner_files_create_empty_information_element (TrackerMinerFiles *miner,
 	return resource;
 }
 
-gchar *
-get_content_type (GFile     *file,
-		  GFileInfo *file_info)
+/* Inserts plain files through prepared statements, returns %FALSE
+ * for the less common shapes that need a full TrackerResource.
+ */
+static gboolean
+miner_files_process_regular_file (TrackerMinerFiles   *mf,
+                                  GFile               *file,
+                                  GFileInfo           *file_info,
+                                  TrackerSparqlBuffer *buffer,
+                                  const gchar         *mime_type,
+                                  const gchar         *parent_urn,
+                                  GDateTime           *modified,
+                                  TrackerIndexLevel    level)
 {
-	g_autoptr (GFileInfo) content_info = NULL;
-
-	if (!g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE)) {
-		content_info =
-			g_file_query_info (file,
-					   G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
-					   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-					   NULL, NULL);
+	g_autoptr (GDateTime) accessed = NULL, created = NULL;
+	const gchar *data_source, *graph, *content_urn = NULL;
+
+	data_source = miner_files_get_data_source (mf, file);
+	if (!data_source)
+		return FALSE;
+
+	graph = tracker_extract_module_manager_get_graph (mime_type);
+
+	/* Empty files skipped as mime-type for those cannot be trusted */
+	if (graph && g_file_info_get_size (file_info) == 0)
+		graph = NULL;
+
+	if (level == TRACKER_INDEX_LEVEL_NAMES)
+		graph = NULL;
+
+	if (graph) {
+		/* Files that are not extracted get a typed nie:InformationElement */
+		if (level == TRACKER_INDEX_LEVEL_METADATA)
+			return FALSE;
+
+		/* Disallowed text files get a typed nie:InformationElement */
+		if (tracker_extract_module_manager_check_fallback_rdf_type (mime_type,
+		                                                            "nfo:PlainTextDocument") &&
+		    !tracker_miner_files_check_allowed_text_file (mf, file))
+			return FALSE;
+
+		content_urn = tracker_miner_fs_get_identifier (TRACKER_MINER_FS (mf),
+		                                               file);
+		if (!content_urn)
+			return FALSE;
 	}
 
-	return g_strdup (g_file_info_get_content_type (content_info ? content_info : file_info));
+#ifdef GIO_SUPPORTS_CREATION_TIME
+	accessed = g_file_info_get_access_date_time (file_info);
+	created = g_file_info_get_creation_date_time (file_info);
+#else
+	accessed = g_date_time_new_from_unix_local ((time_t) g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_ACCESS));
+#endif
+
+	tracker_sparql_buffer_log_file_info (buffer, file,
+	                                     parent_urn,
+	                                     data_source,
+	                                     g_file_info_get_display_name (file_info),
+	                                     g_file_info_get_size (file_info),
+	                                     modified,
+	                                     accessed,
+	                                     created,
+	                                     graph,
+	                                     content_urn,
+	                                     g_file_info_get_attribute_string (file_info,
+	                                                                       TRACKER_FILE_ATTRIBUTE_CONTENT_FINGERPRINT));
+	return TRUE;
 }
 
 void
@@ -193,11 +258,15 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 	gboolean is_directory, is_root;
 	g_autoptr (GDateTime) modified = NULL;
 	g_autoptr (GDateTime) accessed = NULL, created = NULL;
+	TrackerIndexLevel level;
 
-	mime_type = get_content_type (file, file_info);
+	mime_type = tracker_miner_files_query_content_type (TRACKER_MINER_FILES (fs),
+	                                                    file, file_info, NULL);
 	if (!mime_type)
 		return;
 
+	level = tracker_miner_files_get_index_level (TRACKER_MINER_FILES (fs), file);
+
 	uri = g_file_get_uri (file);
 	indexing_tree = tracker_miner_fs_get_indexing_tree (fs);
 
@@ -209,13 +278,20 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 	if (!modified)
 		modified = g_date_time_new_from_unix_utc (0);
 
+	parent = g_file_get_parent (file);
+	parent_urn = tracker_miner_fs_get_identifier (fs, parent);
+
+	if (!is_directory && !is_root && parent_urn &&
+	    miner_files_process_regular_file (TRACKER_MINER_FILES (fs),
+	                                      file, file_info, buffer,
+	                                      mime_type, parent_urn, modified,
+	                                      level))
+		return;
+
 	resource = tracker_resource_new (uri);
 
 	tracker_resource_add_uri (resource, "rdf:type", "nfo:FileDataObject");
 
-	parent = g_file_get_parent (file);
-	parent_urn = tracker_miner_fs_get_identifier (fs, parent);
-
 	if (parent_urn) {
 		tracker_resource_set_uri (resource, "nfo:belongsToContainer", parent_urn);
 	}
@@ -249,6 +325,7 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 		folder_resource =
 			miner_files_create_folder_information_element (TRACKER_MINER_FILES (fs),
 			                                               file,
+			                                               file_info,
 			                                               mime_type,
 			                                               create);
 
@@ -261,6 +338,9 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 
 	graph = tracker_extract_module_manager_get_graph (mime_type);
 
+	if (!is_directory && level == TRACKER_INDEX_LEVEL_NAMES)
+		graph = NULL;
+
 	if (graph && g_file_info_get_size (file_info) > 0) {
 		TrackerResource *information_element;
 
@@ -280,10 +360,13 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 		                            g_file_info_get_size (file_info));
 		miner_files_add_to_datasource (TRACKER_MINER_FILES (fs), file, graph_file, NULL);
 
-		if (tracker_extract_module_manager_check_fallback_rdf_type (mime_type,
-		                                                            "nfo:PlainTextDocument") &&
-		    !tracker_miner_files_check_allowed_text_file (TRACKER_MINER_FILES (fs), file)) {
-			/* We let disallowed text files have a shallow document nie:InformationElement */
+		if (level == TRACKER_INDEX_LEVEL_METADATA ||
+		    (tracker_extract_module_manager_check_fallback_rdf_type (mime_type,
+		                                                             "nfo:PlainTextDocument") &&
+		     !tracker_miner_files_check_allowed_text_file (TRACKER_MINER_FILES (fs), file))) {
+			/* We let disallowed text files, and files that are not
+			 * extracted, have a shallow document nie:InformationElement
+			 */
 			information_element =
 				miner_files_create_text_file_information_element (TRACKER_MINER_FILES (fs),
 				                                                  file, mime_type);
@@ -311,7 +394,9 @@ tracker_miner_files_process_file (TrackerMinerFS      *fs,
 		tracker_sparql_buffer_log_file (buffer, file,
 		                                graph,
 		                                resource,
-		                                graph_file);
+		                                graph_file,
+		                                g_file_info_get_attribute_string (file_info,
+		                                                                  TRACKER_FILE_ATTRIBUTE_CONTENT_FINGERPRINT));
 	}
 }
 
@@ -321,83 +406,52 @@ tracker_miner_files_process_file_attributes (TrackerMinerFS      *fs,
                                              GFileInfo           *info,
                                              TrackerSparqlBuffer *buffer)
 {
-	g_autoptr (TrackerResource) resource = NULL, graph_file = NULL;
-	g_autofree gchar *uri = NULL;
 	g_autofree gchar *mime_type = NULL;
-	const gchar *graph;
 	g_autoptr (GDateTime) modified = NULL;
 	g_autoptr (GDateTime) accessed = NULL, created = NULL;
 
-	mime_type = get_content_type (file, info);
+	mime_type = tracker_miner_files_query_content_type (TRACKER_MINER_FILES (fs),
+	                                                    file, info, NULL);
 	if (!mime_type)
 		return;
 
-	uri = g_file_get_uri (file);
-	resource = tracker_resource_new (uri);
-	tracker_resource_add_uri (resource, "rdf:type", "nfo:FileDataObject");
-
 	modified = g_file_info_get_modification_date_time (info);
 	if (!modified)
 		modified = g_date_time_new_from_unix_utc (0);
 
-	graph = tracker_extract_module_manager_get_graph (mime_type);
-
-	/* Update nfo:fileLastModified */
-	tracker_resource_set_datetime (resource, "nfo:fileLastModified", modified);
-	if (graph) {
-		graph_file = tracker_resource_new (uri);
-		tracker_resource_add_uri (graph_file, "rdf:type", "nfo:FileDataObject");
-		tracker_resource_set_datetime (graph_file, "nfo:fileLastModified", modified);
-	}
-
 #ifdef GIO_SUPPORTS_CREATION_TIME
-	/* Update nfo:fileLastAccessed */
 	accessed = g_file_info_get_access_date_time (info);
-	tracker_resource_set_datetime (resource, "nfo:fileLastAccessed", accessed);
-
-	/* Update nfo:fileCreated */
 	created = g_file_info_get_creation_date_time (info);
-
-	if (created)
-		tracker_resource_set_datetime (resource, "nfo:fileCreated", created);
 #else
 	time_ = (time_t) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS);
 	accessed = g_date_time_new_from_unix_local (time_);
-	if (accessed)
-		tracker_resource_set_datetime (resource, "nfo:fileLastAccessed", accessed);
 #endif
 
+	/* Updates nfo:fileLastModified in all graphs, plus access and
+	 * creation times in tracker:FileSystem.
+	 */
 	tracker_sparql_buffer_log_attributes_update (buffer,
 	                                             file,
-	                                             graph,
-	                                             resource,
-	                                             graph_file);
+	                                             modified,
+	                                             accessed,
+	                                             created);
 }
 
-static gchar *
-lookup_filesystem_id (TrackerMinerFiles *files,
-                      GFile             *file)
+void
+tracker_miner_files_process_rewritten_file (TrackerMinerFS      *fs,
+                                            GFile               *file,
+                                            GFileInfo           *info,
+                                            TrackerSparqlBuffer *buffer)
 {
-	const gchar *id = NULL, *devname = NULL;
-	GUnixMountEntry *mount;
-	GUdevClient *udev_client;
-	g_autoptr (GUdevDevice) udev_device = NULL;
-
-	mount = g_unix_mount_for (g_file_peek_path (file), NULL);
-	if (mount)
-		devname = g_unix_mount_get_device_path (mount);
-
-	if (devname) {
-		udev_client = tracker_miner_files_get_udev_client (files);
-		udev_device = g_udev_client_query_by_device_file (udev_client, devname);
-		if (udev_device) {
-			id = g_udev_device_get_property (udev_device, "ID_FS_UUID_SUB");
-			if (!id)
-				id = g_udev_device_get_property (udev_device, "ID_FS_UUID");
-		}
-	}
+	tracker_miner_files_process_file_attributes (fs, file, info, buffer);
 
-	return g_strdup (id);
+	/* The metadata in the file is what we wrote, keep the extracted
+	 * content and just follow the new size and fingerprint.
+	 */
+	tracker_sparql_buffer_log_rewritten_file (buffer, file,
+	                                          g_file_info_get_size (info),
+	                                          g_file_info_get_attribute_string (info,
+	                                                                            TRACKER_FILE_ATTRIBUTE_CONTENT_FINGERPRINT));
 }
 
 gchar *
@@ -406,13 +460,15 @@ tracker_miner_files_get_content_identifier (TrackerMinerFiles *mf,
                                             GFileInfo         *info)
 {
 	g_autofree gchar *inode = NULL, *str = NULL, *id = NULL;
+	const gchar *device_id;
 
-	id = lookup_filesystem_id (mf, file);
+	device_id = g_file_info_get_attribute_string (info,
+	                                              G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+	id = tracker_storage_get_filesystem_id (tracker_miner_files_get_storage (mf),
+	                                        file, device_id);
 
-	if (!id) {
-		id = g_strdup (g_file_info_get_attribute_string (info,
-		                                                 G_FILE_ATTRIBUTE_ID_FILESYSTEM));
-	}
+	if (!id)
+		id = g_strdup (device_id);
 
 	inode = g_file_info_get_attribute_as_string (info, G_FILE_ATTRIBUTE_UNIX_INODE);
 
@@ -423,3 +479,167 @@ tracker_miner_files_get_content_identifier (TrackerMinerFiles *mf,
 
 	return g_steal_pointer (&str);
 }
+
+/* Bytes hashed from the start and the end of files */
+#define FINGERPRINT_SAMPLE_SIZE (64 * 1024)
+
+static gboolean
+checksum_update_from_stream (GChecksum     *checksum,
+                             GInputStream  *stream,
+                             gsize          len,
+                             GCancellable  *cancellable)
+{
+	guchar buffer[8192];
+
+	while (len > 0) {
+		gssize n_read;
+
+		n_read = g_input_stream_read (stream, buffer,
+		                              MIN (len, sizeof (buffer)),
+		                              cancellable, NULL);
+		if (n_read <= 0)
+			return FALSE;
+
+		g_checksum_update (checksum, buffer, n_read);
+		len -= n_read;
+	}
+
+	return TRUE;
+}
+
+static void
+checksum_update_desktop_value (TrackerDesktopKey  key,
+                               const gchar       *locale,
+                               gsize              locale_len,
+                               const gchar       *value,
+                               gsize              value_len,
+                               gpointer           user_data)
+{
+	GChecksum *checksum = user_data;
+	guchar key_byte = key;
+
+	g_checksum_update (checksum, &key_byte, 1);
+	if (locale)
+		g_checksum_update (checksum, (const guchar *) locale, locale_len);
+	g_checksum_update (checksum, (const guchar *) "=", 1);
+	g_checksum_update (checksum, (const guchar *) value, value_len);
+	g_checksum_update (checksum, (const guchar *) "\n", 1);
+}
+
+/* Desktop files are often rewritten as a whole on package upgrades,
+ * just changing keys that are not extracted (e.g. actions, keywords,
+ * or X- keys), only the extracted keys are hashed for those.
+ */
+static gboolean
+checksum_update_from_desktop_file (GChecksum     *checksum,
+                                   GInputStream  *stream,
+                                   gsize          len,
+                                   GCancellable  *cancellable)
+{
+	g_autofree gchar *contents = NULL;
+	gsize n_read;
+
+	contents = g_malloc (len);
+
+	if (!g_input_stream_read_all (stream, contents, len, &n_read,
+	                              cancellable, NULL) ||
+	    n_read != len)
+		return FALSE;
+
+	return tracker_desktop_entry_parse (contents, len,
+	                                    checksum_update_desktop_value,
+	                                    checksum, NULL);
+}
+
+/* Returns a fingerprint of the contents of files the extractor would
+ * handle, so files whose mtime changed but not their contents (e.g.
+ * touched, or restored from a backup) are not extracted again. Only
+ * the start and end of big files are looked at, along with the size.
+ *
+ * Plain text files are only extracted up to @max_text bytes, so the
+ * fingerprint of bigger ones covers just those, and appending to them
+ * (e.g. to logs) does not extract and index the same text again.
+ *
+ * The extractor hash of the module handling the file is part of the
+ * fingerprint, so the content is extracted again after that module
+ * changed, but not after unrelated modules did.
+ */
+gchar *
+tracker_miner_files_compute_content_fingerprint (GFile        *file,
+                                                 GFileInfo    *info,
+                                                 const gchar  *mime_type,
+                                                 gsize         max_text,
+                                                 GCancellable *cancellable)
+{
+	g_autoptr (GFileInputStream) stream = NULL;
+	g_autoptr (GChecksum) checksum = NULL;
+	const gchar *extractor_hash;
+	goffset size;
+
+	if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+		return NULL;
+
+	size = g_file_info_get_size (info);
+	if (size <= 0)
+		return NULL;
+
+	if (!tracker_extract_module_manager_get_graph (mime_type))
+		return NULL;
+
+	stream = g_file_read (file, cancellable, NULL);
+	if (!stream)
+		return NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+	extractor_hash = tracker_extract_module_manager_get_hash (mime_type);
+
+	if (max_text > 0 && (guint64) size > max_text &&
+	    tracker_extract_module_manager_check_fallback_rdf_type (mime_type,
+	                                                            "nfo:PlainTextDocument")) {
+		if (!checksum_update_from_stream (checksum, G_INPUT_STREAM (stream),
+		                                  max_text, cancellable))
+			return NULL;
+
+		/* Format:
+		 * 'text' [max text] ':' [md5] ':' [extractor hash]
+		 */
+		return g_strdup_printf ("text%" G_GSIZE_FORMAT ":%s:%s",
+		                        max_text, g_checksum_get_string (checksum),
+		                        extractor_hash ? extractor_hash : "");
+	}
+
+	if (size <= 2 * FINGERPRINT_SAMPLE_SIZE &&
+	    g_strcmp0 (mime_type, "application/x-desktop") == 0) {
+		if (!checksum_update_from_desktop_file (checksum, G_INPUT_STREAM (stream),
+		                                        size, cancellable))
+			return NULL;
+
+		/* Format:
+		 * 'desktop:' [md5] ':' [extractor hash]
+		 */
+		return g_strdup_printf ("desktop:%s:%s",
+		                        g_checksum_get_string (checksum),
+		                        extractor_hash ? extractor_hash : "");
+	}
+
+	if (size <= 2 * FINGERPRINT_SAMPLE_SIZE) {
+		if (!checksum_update_from_stream (checksum, G_INPUT_STREAM (stream),
+		                                  size, cancellable))
+			return NULL;
+	} else {
+		if (!checksum_update_from_stream (checksum, G_INPUT_STREAM (stream),
+		                                  FINGERPRINT_SAMPLE_SIZE, cancellable) ||
+		    !g_seekable_seek (G_SEEKABLE (stream), -FINGERPRINT_SAMPLE_SIZE,
+		                      G_SEEK_END, cancellable, NULL) ||
+		    !checksum_update_from_stream (checksum, G_INPUT_STREAM (stream),
+		                                  FINGERPRINT_SAMPLE_SIZE, cancellable))
+			return NULL;
+	}
+
+	/* Format:
+	 * [size] ':' [md5] ':' [extractor hash]
+	 */
+	return g_strdup_printf ("%" G_GOFFSET_FORMAT ":%s:%s",
+	                        size, g_checksum_get_string (checksum),
+	                        extractor_hash ? extractor_hash : "");
+}
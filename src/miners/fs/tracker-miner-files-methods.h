@@ -23,6 +23,9 @@
 #ifndef __TRACKER_MINER_FILES_METHODS_H__
 #define __TRACKER_MINER_FILES_METHODS_H__
 
+/* Set by the miner on the file infos it prepares */
+#define TRACKER_FILE_ATTRIBUTE_CONTENT_FINGERPRINT "tracker::content-fingerprint"
+
 void tracker_miner_files_process_file (TrackerMinerFS      *fs,
                                        GFile               *file,
                                        GFileInfo           *file_info,
@@ -32,9 +35,19 @@ void tracker_miner_files_process_file_attributes (TrackerMinerFS      *fs,
                                                   GFile               *file,
                                                   GFileInfo           *info,
                                                   TrackerSparqlBuffer *buffer);
+void tracker_miner_files_process_rewritten_file (TrackerMinerFS      *fs,
+                                                 GFile               *file,
+                                                 GFileInfo           *info,
+                                                 TrackerSparqlBuffer *buffer);
 
 gchar * tracker_miner_files_get_content_identifier (TrackerMinerFiles *files,
                                                     GFile             *file,
                                                     GFileInfo         *info);
 
+gchar * tracker_miner_files_compute_content_fingerprint (GFile        *file,
+                                                         GFileInfo    *info,
+                                                         const gchar  *mime_type,
+                                                         gsize         max_text,
+                                                         GCancellable *cancellable);
+
 #endif /* __TRACKER_MINER_FILES_METHODS_H__ */
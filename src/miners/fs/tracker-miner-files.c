@@ -19,24 +19,50 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include <glib/gstdio.h>
 
 #include <gio/gio.h>
 
 #include <libtracker-miners-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-miner-files.h"
 #include "tracker-miner-files-methods.h"
 #include "tracker-config.h"
 #include "tracker-storage.h"
 #include "tracker-extract-watchdog.h"
+#include "tracker-resource-control.h"
 #include "tracker-utils.h"
 
 #define DISK_SPACE_CHECK_FREQUENCY 10
 #define SECONDS_PER_DAY 86400
 
+/* Cached contents of expired volumes that are not seen again */
+#define VOLUME_CACHE_MAX_AGE_DAYS 365
+
+/* First line of the index bundles made by `localsearch index --export-bundle` */
+#define INDEX_BUNDLE_HEADER "# localsearch-bundle 1"
+
+/* Files deleted per transaction when expiring volumes */
+#define VOLUME_EXPIRY_BATCH_SIZE 2000
+
+/* Files deleted per transaction when removing index roots */
+#define ROOT_REMOVAL_BATCH_SIZE 2000
+
 #define DEFAULT_GRAPH "tracker:FileSystem"
 
+/* Hot files extracted ahead of the extractor queue at a time, further
+ * ones are left to their usual order.
+ */
+#define MAX_HOT_EXTRACTIONS 8
+
+/* Seconds for a file rewritten by writeback to show up in the
+ * monitors, before its registration is forgotten.
+ */
+#define WRITEBACK_ECHO_TIMEOUT 60
+
 #define FILE_ATTRIBUTES	  \
 	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT "," \
 	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
@@ -47,7 +73,9 @@
 	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
 	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
 	G_FILE_ATTRIBUTE_TIME_CREATED "," \
-	G_FILE_ATTRIBUTE_TIME_ACCESS
+	G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE
 
 #define TRACKER_MINER_FILES_GET_PRIVATE(o) (tracker_miner_files_get_instance_private (TRACKER_MINER_FILES (o)))
 
@@ -63,7 +91,9 @@ struct TrackerMinerFilesPrivate {
 	TrackerDomainOntology *domain_ontology;
 
 	GSettings *extract_settings;
-	GList *allowed_text_patterns;
+	/* Read from the threads preparing files, protected by text_config_mutex */
+	TextConfig *text_config;
+	GMutex text_config_mutex;
 
 	guint disk_space_check_id;
 	gboolean disk_space_pause;
@@ -71,15 +101,51 @@ struct TrackerMinerFilesPrivate {
 	gboolean low_battery_pause;
 	gboolean initial_index;
 
-	GUdevClient *udev_client;
 #ifdef HAVE_POWER
 	TrackerPower *power;
 #endif /* HAVE_POWER) */
+	TrackerPressure *pressure;
+	gboolean battery_throttle;
+	gboolean steady_state;
+	gboolean resource_control_applied;
 	gulong finished_handler;
 
 	guint stale_volumes_check_id;
+	guint n_hot_extractions;
+	/* GFile -> WritebackEcho */
+	GHashTable *writeback_echoes;
+	/* GFile -> RootRemoval */
+	GHashTable *root_removals;
+
+	/* Read from worker threads */
+	gint sniff_content_types;
+	gint remote_index_level;
 };
 
+typedef struct {
+	gint64 modified;
+	goffset size;
+	gint64 expiry;
+} WritebackEcho;
+
+typedef struct {
+	TrackerMinerFiles *miner;
+	GFile *root;
+	gboolean cancelled;
+} RootRemoval;
+
+/* Snapshot of the text settings, it is only replaced as a whole
+ * when they change, so threads can keep using the one they got.
+ */
+typedef struct {
+	TrackerTextLimits *text_limits;
+	/* Suffixes of "*.ext" allowlist patterns */
+	GHashTable *allowed_text_suffixes;
+	/* Allowlist patterns without wildcards */
+	GHashTable *allowed_text_names;
+	GPtrArray *allowed_text_patterns;
+} TextConfig;
+
 enum {
 	PROP_0,
 	PROP_CONFIG,
@@ -89,6 +155,9 @@ enum {
 };
 
 #define TEXT_ALLOWLIST "text-allowlist"
+#define MAX_BYTES "max-bytes"
+#define TEXT_LIMITS "text-limits"
+#define TEXT_TAIL_BYTES "text-tail-bytes"
 
 static void        miner_files_set_property             (GObject              *object,
                                                          guint                 param_id,
@@ -100,6 +169,9 @@ static void        miner_files_get_property             (GObject              *o
                                                          GParamSpec           *pspec);
 static void        miner_files_constructed              (GObject              *object);
 static void        miner_files_finalize                 (GObject              *object);
+static void        pressure_changed_cb                  (GObject              *object,
+                                                         GParamSpec           *pspec,
+                                                         gpointer              user_data);
 #ifdef HAVE_POWER
 static void        check_battery_status                 (TrackerMinerFiles    *fs);
 static void        battery_status_cb                    (GObject              *object,
@@ -111,11 +183,14 @@ static void        index_on_battery_cb                  (GObject    *object,
 #endif /* HAVE_POWER */
 static void        init_index_roots                     (TrackerMinerFiles    *miner);
 static void        init_stale_volume_removal            (TrackerMinerFiles    *miner);
+static void        prune_volume_cache                   (TrackerMinerFiles    *mf);
 static void        disk_space_check_start               (TrackerMinerFiles    *mf);
 static void        disk_space_check_stop                (TrackerMinerFiles    *mf);
 static void        low_disk_space_limit_cb              (GObject              *gobject,
                                                          GParamSpec           *arg1,
                                                          gpointer              user_data);
+static TextConfig *miner_files_get_text_config          (TrackerMinerFiles    *mf);
+static void        text_config_unref                    (TextConfig           *text_config);
 
 static void        miner_files_process_file             (TrackerMinerFS       *fs,
                                                          GFile                *file,
@@ -173,6 +248,94 @@ miner_files_get_content_identifier (TrackerMinerFS *fs,
 	                                                   file, info);
 }
 
+static GFileInfo *
+miner_files_prepare_file (TrackerMinerFS *fs,
+                          GFile          *file,
+                          GFileInfo      *info,
+                          GCancellable   *cancellable)
+{
+	g_autofree gchar *content_type = NULL, *fingerprint = NULL;
+	GFileInfo *prepared;
+
+	content_type = tracker_miner_files_query_content_type (TRACKER_MINER_FILES (fs),
+	                                                       file, info,
+	                                                       cancellable);
+	if (!content_type)
+		return g_object_ref (info);
+
+	/* Files that are not extracted are not read either */
+	if (tracker_miner_files_get_index_level (TRACKER_MINER_FILES (fs), file) == TRACKER_INDEX_LEVEL_FULL) {
+		TextConfig *text_config;
+		TrackerTextLimits *text_limits;
+		const gchar *graph;
+		gsize max_text = 0;
+
+		/* Text taken from the end changes on appends, so
+		 * the whole file is fingerprinted then.
+		 */
+		text_config = miner_files_get_text_config (TRACKER_MINER_FILES (fs));
+		text_limits = text_config->text_limits;
+		graph = tracker_extract_module_manager_get_graph (content_type);
+		if (tracker_text_limits_get_tail (text_limits, content_type, graph) == 0)
+			max_text = tracker_text_limits_get_max_text (text_limits, content_type, graph);
+		text_config_unref (text_config);
+
+		fingerprint = tracker_miner_files_compute_content_fingerprint (file, info,
+		                                                               content_type,
+		                                                               max_text,
+		                                                               cancellable);
+	}
+
+	if (!fingerprint &&
+	    g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE))
+		return g_object_ref (info);
+
+	prepared = g_file_info_dup (info);
+	g_file_info_set_content_type (prepared, content_type);
+
+	if (fingerprint) {
+		g_file_info_set_attribute_string (prepared,
+		                                  TRACKER_FILE_ATTRIBUTE_CONTENT_FINGERPRINT,
+		                                  fingerprint);
+	}
+
+	return prepared;
+}
+
+static void
+hot_file_extracted_cb (GObject      *object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+	TrackerMinerFiles *mf = user_data;
+
+	/* Worker errors are logged by the watchdog */
+	tracker_extract_watchdog_extract_file_finish (TRACKER_EXTRACT_WATCHDOG (object),
+	                                              res, NULL);
+	mf->private->n_hot_extractions--;
+	g_object_unref (mf);
+}
+
+static void
+miner_files_hot_file_stored (TrackerMinerFS *fs,
+                             GFile          *file)
+{
+	TrackerMinerFiles *mf = TRACKER_MINER_FILES (fs);
+	g_autofree gchar *uri = NULL;
+
+	if (!mf->private->extract_watchdog ||
+	    mf->private->n_hot_extractions >= MAX_HOT_EXTRACTIONS ||
+	    tracker_miner_files_get_index_level (mf, file) != TRACKER_INDEX_LEVEL_FULL)
+		return;
+
+	mf->private->n_hot_extractions++;
+	uri = g_file_get_uri (file);
+	tracker_extract_watchdog_extract_file_async (mf->private->extract_watchdog,
+	                                             uri, NULL,
+	                                             hot_file_extracted_cb,
+	                                             g_object_ref (mf));
+}
+
 static void
 tracker_miner_files_class_init (TrackerMinerFilesClass *klass)
 {
@@ -194,6 +357,8 @@ tracker_miner_files_class_init (TrackerMinerFilesClass *klass)
 	miner_fs_class->remove_children = miner_files_remove_children;
 	miner_fs_class->move_file = miner_files_move_file;
 	miner_fs_class->get_content_identifier = miner_files_get_content_identifier;
+	miner_fs_class->prepare_file = miner_files_prepare_file;
+	miner_fs_class->hot_file_stored = miner_files_hot_file_stored;
 
 	g_object_class_install_property (object_class,
 	                                 PROP_CONFIG,
@@ -265,6 +430,8 @@ on_extractor_status (TrackerExtractWatchdog *watchdog,
                      gint                    remaining,
                      TrackerMinerFiles      *mf)
 {
+	TrackerStatusPage *page;
+
 	if (!tracker_miner_is_paused (TRACKER_MINER (mf))) {
 		g_object_set (mf,
 		              "status", status,
@@ -272,6 +439,20 @@ on_extractor_status (TrackerExtractWatchdog *watchdog,
 		              "remaining-time", remaining,
 		              NULL);
 	}
+
+	/* The extractor is sandboxed, publish its status on its behalf */
+	page = tracker_miner_fs_get_status_page (TRACKER_MINER_FS (mf));
+	if (page) {
+		TrackerStatusPageData data = { 0, };
+
+		g_strlcpy (data.status, status, sizeof (data.status));
+		data.progress = progress;
+		data.remaining_time = remaining;
+		data.errors = tracker_extract_watchdog_get_n_errors (watchdog);
+		tracker_status_page_update (page,
+		                            TRACKER_STATUS_PAGE_SECTION_EXTRACTOR,
+		                            &data);
+	}
 }
 
 static void
@@ -294,10 +475,54 @@ tracker_miner_files_init (TrackerMinerFiles *mf)
 	}
 #endif /* HAVE_POWER */
 
+	g_mutex_init (&priv->text_config_mutex);
+
+	priv->pressure = tracker_pressure_new ();
+
+	if (priv->pressure) {
+		g_signal_connect (priv->pressure, "notify::pressure",
+		                  G_CALLBACK (pressure_changed_cb),
+		                  mf);
+	}
+
 	priv->finished_handler = g_signal_connect_after (mf, "finished",
 	                                                 G_CALLBACK (miner_finished_cb),
 	                                                 NULL);
-	priv->udev_client = g_udev_client_new (NULL);
+	priv->writeback_echoes = g_hash_table_new_full (g_file_hash,
+	                                                (GEqualFunc) g_file_equal,
+	                                                g_object_unref, g_free);
+	priv->root_removals = g_hash_table_new (g_file_hash,
+	                                        (GEqualFunc) g_file_equal);
+}
+
+static void
+sniff_content_types_changed (TrackerMinerFiles *mf)
+{
+	gboolean sniff;
+
+	sniff = tracker_config_get_sniff_content_types (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("%s content types while crawling",
+	                                 sniff ? "Sniffing" : "Not sniffing"));
+	g_atomic_int_set (&mf->private->sniff_content_types, sniff);
+}
+
+static void
+remote_index_level_changed (TrackerMinerFiles *mf)
+{
+	g_autofree gchar *level = NULL;
+	TrackerIndexLevel index_level;
+
+	level = tracker_config_get_remote_index_level (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("Indexing remote files at level '%s'", level));
+
+	if (g_strcmp0 (level, "names") == 0)
+		index_level = TRACKER_INDEX_LEVEL_NAMES;
+	else if (g_strcmp0 (level, "metadata") == 0)
+		index_level = TRACKER_INDEX_LEVEL_METADATA;
+	else
+		index_level = TRACKER_INDEX_LEVEL_FULL;
+
+	g_atomic_int_set (&mf->private->remote_index_level, index_level);
 }
 
 static void
@@ -320,6 +545,93 @@ removable_days_threshold_changed (TrackerMinerFiles *mf)
 	}
 }
 
+static void
+resource_control_changed (TrackerMinerFiles *mf)
+{
+	TrackerConfig *config = mf->private->config;
+	guint weight;
+	guint64 memory_high;
+
+	if (!tracker_config_get_resource_control (config)) {
+		/* Go back to the systemd defaults */
+		if (mf->private->resource_control_applied) {
+			tracker_resource_control_apply (100, 0);
+			mf->private->resource_control_applied = FALSE;
+		}
+		return;
+	}
+
+	if (mf->private->steady_state)
+		weight = tracker_config_get_steady_state_weight (config);
+	else
+		weight = tracker_config_get_bulk_index_weight (config);
+
+	memory_high = (guint64) tracker_config_get_memory_high (config) * 1024 * 1024;
+
+	TRACKER_NOTE (CONFIG, g_message ("Resource weight set to %u (%s)",
+	                                 weight,
+	                                 mf->private->steady_state ? "steady state" : "bulk index"));
+	tracker_resource_control_apply (weight, memory_high);
+	mf->private->resource_control_applied = TRUE;
+}
+
+static void
+set_steady_state (TrackerMinerFiles *mf,
+                  gboolean           steady_state)
+{
+	if (mf->private->steady_state == steady_state)
+		return;
+
+	mf->private->steady_state = steady_state;
+	resource_control_changed (mf);
+}
+
+static void
+identifier_cache_size_changed (TrackerMinerFiles *mf)
+{
+	gint size;
+
+	size = tracker_config_get_identifier_cache_size (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("Identifier cache size set to %d", size));
+	tracker_miner_fs_set_identifier_cache_size (TRACKER_MINER_FS (mf), size);
+}
+
+static void
+crawl_limits_changed (TrackerMinerFiles *mf)
+{
+	gint max_roots, max_directories;
+
+	max_roots = tracker_config_get_max_crawled_roots (mf->private->config);
+	max_directories = tracker_config_get_max_crawled_directories (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("Crawling up to %d roots, %d directories per root",
+	                                 max_roots, max_directories));
+	tracker_miner_fs_set_crawl_limits (TRACKER_MINER_FS (mf),
+	                                   max_roots, max_directories);
+}
+
+static void
+max_monitors_changed (TrackerMinerFiles *mf)
+{
+	gint max_monitors;
+
+	max_monitors = tracker_config_get_max_monitors (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("Watching up to %d directories", max_monitors));
+	tracker_miner_fs_set_max_monitors (TRACKER_MINER_FS (mf), max_monitors);
+}
+
+static void
+update_delays_changed (TrackerMinerFiles *mf)
+{
+	gint min_delay, max_delay;
+
+	min_delay = tracker_config_get_min_update_delay (mf->private->config);
+	max_delay = tracker_config_get_max_update_delay (mf->private->config);
+	TRACKER_NOTE (CONFIG, g_message ("Holding back updates of files changing often for %d-%d ms",
+	                                 min_delay, max_delay));
+	tracker_miner_fs_set_update_delays (TRACKER_MINER_FS (mf),
+	                                    min_delay, max_delay);
+}
+
 static void
 miner_files_set_property (GObject      *object,
                           guint         prop_id,
@@ -394,7 +706,8 @@ miner_files_finalize (GObject *object)
 	}
 
 	g_clear_object (&mf->private->extract_settings);
-	g_list_free_full (mf->private->allowed_text_patterns, (GDestroyNotify) g_pattern_spec_free);
+	g_clear_pointer (&mf->private->text_config, text_config_unref);
+	g_mutex_clear (&mf->private->text_config_mutex);
 
 	g_signal_handlers_disconnect_by_func (priv->extract_watchdog,
 	                                      on_extractor_lost,
@@ -416,8 +729,11 @@ miner_files_finalize (GObject *object)
 	}
 #endif /* HAVE_POWER */
 
+	g_clear_object (&priv->pressure);
+
 	tracker_domain_ontology_unref (priv->domain_ontology);
-	g_clear_pointer (&priv->udev_client, g_object_unref);
+	g_hash_table_unref (priv->writeback_echoes);
+	g_hash_table_unref (priv->root_removals);
 
 	if (priv->storage) {
 		g_object_unref (priv->storage);
@@ -501,203 +817,496 @@ delete_index_root (TrackerMinerFiles *miner,
 	                             NULL);
 }
 
+static void remove_index_root_batch (RootRemoval *removal);
+
 static void
-init_index_roots_cb (GObject      *source,
-                     GAsyncResult *result,
-                     gpointer      user_data)
+root_removal_free (RootRemoval *removal)
 {
-	g_autofree GError *error = NULL;
+	if (!removal->cancelled)
+		g_hash_table_remove (removal->miner->private->root_removals, removal->root);
 
-	tracker_batch_execute_finish (TRACKER_BATCH (source), result, &error);
+	g_object_unref (removal->root);
+	g_object_unref (removal->miner);
+	g_slice_free (RootRemoval, removal);
+}
 
-	if (error) {
-		g_critical ("Could not initialize currently active mount points: %s",
-		            error->message);
-	} else {
-		init_stale_volume_removal (user_data);
-	}
+static void
+remove_index_root_finished_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	RootRemoval *removal = user_data;
+	g_autoptr (GError) error = NULL;
+
+	tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                        result, &error);
+	if (error)
+		g_warning ("Could not remove index root: %s", error->message);
+
+	root_removal_free (removal);
 }
 
 static void
-init_index_roots (TrackerMinerFiles *miner_files)
+check_index_root_content_cb (GObject      *object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
 {
-	TrackerMiner *miner = TRACKER_MINER (miner_files);
+	RootRemoval *removal = user_data;
 	TrackerSparqlConnection *conn;
 	g_autoptr (TrackerSparqlStatement) stmt = NULL;
-	TrackerIndexingTree *indexing_tree;
-	g_autoptr (GList) roots = NULL;
-	g_autoptr (GHashTable) handled = NULL;
-	g_autoptr (TrackerBatch) batch = NULL;
-	g_autoptr (GError) error = NULL;
 	g_autoptr (TrackerSparqlCursor) cursor = NULL;
-	GList *l;
-
-	g_debug ("Initializing mount points...");
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GError) error = NULL;
 
-	conn = tracker_miner_get_connection (miner);
-	stmt = tracker_load_statement (conn, "get-index-roots.rq", &error);
+	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                  result, &error);
 
-	if (stmt) {
-		/* First, get all mounted volumes, according to tracker-store (SYNC!) */
-		cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	if (removal->cancelled) {
+		root_removal_free (removal);
+		return;
 	}
 
-	if (error) {
-		g_critical ("Could not obtain the mounted volumes: %s", error->message);
+	if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		remove_index_root_batch (removal);
 		return;
 	}
 
-	batch = tracker_sparql_connection_create_batch (conn);
-	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (miner));
-	handled = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
-	                                 g_object_unref, NULL);
-
-	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-		const gchar *uri;
-		gboolean is_removable, is_optical;
-		GFile *file;
-
-		uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-		is_removable = tracker_sparql_cursor_get_boolean (cursor, 1);
-		is_optical = tracker_sparql_cursor_get_boolean (cursor, 2);
-
-		file = g_file_new_for_uri (uri);
-		g_hash_table_add (handled, file);
-
-		if (tracker_indexing_tree_file_is_root (indexing_tree, file)) {
-			/* Directory is indexed and configured */
-			if (is_removable || is_optical) {
-				set_up_mount_point (TRACKER_MINER_FILES (miner),
-				                    file,
-				                    TRUE,
-				                    batch);
-			}
-		} else {
-			/* Directory is indexed, but no longer configured */
-			if (tracker_config_get_removable_days_threshold (miner_files->private->config) > 0 &&
-			    ((is_optical &&
-			      tracker_config_get_index_optical_discs (miner_files->private->config)) ||
-			     (!is_optical && is_removable &&
-			      tracker_config_get_index_removable_devices (miner_files->private->config)))) {
-				/* Preserve */
-				set_up_mount_point (TRACKER_MINER_FILES (miner),
-				                    file, FALSE, batch);
-			} else {
-				/* Not a removable device to preserve, or a no
-				 * longer configured folder.
-				 */
-				delete_index_root (TRACKER_MINER_FILES (miner),
-				                   file, batch);
-			}
-		}
+	if (error) {
+		g_warning ("Could not remove index root: %s", error->message);
+		root_removal_free (removal);
+		return;
 	}
 
-	roots = tracker_indexing_tree_list_roots (indexing_tree);
-
-	for (l = roots; l; l = l->next) {
-		TrackerStorage *storage = miner_files->private->storage;
-		TrackerStorageType type;
-		GFile *file = l->data;
+	/* Only the root folder is left, it goes last so the root is
+	 * still found and removed on startup if this is interrupted.
+	 */
+	conn = tracker_miner_get_connection (TRACKER_MINER (removal->miner));
+	stmt = tracker_load_statement (conn, "delete-index-root.rq", NULL);
+	uri = g_file_get_uri (removal->root);
+	tracker_sparql_statement_bind_string (stmt, "rootFolder", uri);
+	tracker_sparql_statement_update_async (stmt, NULL,
+	                                       remove_index_root_finished_cb,
+	                                       removal);
+}
 
-		if (g_hash_table_contains (handled, file))
-			continue;
+static void
+remove_index_root_batch_cb (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	RootRemoval *removal = user_data;
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GError) error = NULL;
 
-		type = tracker_storage_get_type_for_file (storage, file);
+	tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                        result, &error);
 
-		if ((type & TRACKER_STORAGE_REMOVABLE) != 0)
-			set_up_mount_point (miner_files, file, TRUE, NULL);
+	if (error || removal->cancelled) {
+		if (error)
+			g_warning ("Could not remove index root: %s", error->message);
+		root_removal_free (removal);
+		return;
 	}
 
-	tracker_batch_execute_async (batch,
-	                             NULL,
-	                             init_index_roots_cb,
-	                             miner);
+	/* See whether there is more to remove */
+	conn = tracker_miner_get_connection (TRACKER_MINER (removal->miner));
+	stmt = tracker_load_statement (conn, "get-index-root-content-left.rq", NULL);
+	uri = g_file_get_uri (removal->root);
+	tracker_sparql_statement_bind_string (stmt, "rootFolder", uri);
+	tracker_sparql_statement_execute_async (stmt, NULL,
+	                                        check_index_root_content_cb,
+	                                        removal);
 }
 
-static gboolean
-cleanup_stale_removable_volumes_cb (gpointer user_data)
+static void
+remove_index_root_batch (RootRemoval *removal)
 {
-	TrackerMinerFiles *miner = TRACKER_MINER_FILES (user_data);
-	g_autoptr (GDateTime) now = NULL, n_days_ago = NULL;
-	gint n_days_threshold;
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autofree gchar *uri = NULL;
 
-	n_days_threshold = tracker_config_get_removable_days_threshold (miner->private->config);
+	conn = tracker_miner_get_connection (TRACKER_MINER (removal->miner));
+	stmt = tracker_load_statement (conn, "delete-index-root-content.rq", NULL);
+	uri = g_file_get_uri (removal->root);
 
-	if (n_days_threshold == 0)
-		return TRUE;
+	tracker_sparql_statement_bind_string (stmt, "rootFolder", uri);
+	tracker_sparql_statement_bind_int (stmt, "limit", ROOT_REMOVAL_BATCH_SIZE);
+	tracker_sparql_statement_update_async (stmt, NULL,
+	                                       remove_index_root_batch_cb,
+	                                       removal);
+}
 
-	g_debug ("Running stale volumes check...");
+/* Index roots may hold a large number of files, deleting their content
+ * in batches keeps each transaction short, so the updates of other
+ * roots get through in the meantime.
+ */
+static void
+remove_index_root (TrackerMinerFiles *miner,
+                   GFile             *root)
+{
+	RootRemoval *removal;
 
-	now = g_date_time_new_now_utc ();
-	n_days_ago = g_date_time_add_days (now, -n_days_threshold);
-	miner_files_in_removable_media_remove_by_date (miner, n_days_ago);
+	if (g_hash_table_contains (miner->private->root_removals, root))
+		return;
 
-	return TRUE;
+	g_debug ("Removing content of index root '%s' in the background",
+	         g_file_peek_path (root));
+
+	removal = g_slice_new0 (RootRemoval);
+	removal->miner = g_object_ref (miner);
+	removal->root = g_object_ref (root);
+	g_hash_table_insert (miner->private->root_removals, removal->root, removal);
+
+	remove_index_root_batch (removal);
 }
 
+/* If a root comes back while its content is being removed, the rest
+ * is removed right away, so the crawler starts from a clean slate.
+ * This is still done in batches, so other connections can get
+ * through between them.
+ */
 static void
-init_stale_volume_removal (TrackerMinerFiles *miner)
+cancel_index_root_removal (TrackerMinerFiles *miner,
+                           GFile             *root)
 {
-	/* If disabled, make sure we don't do anything */
-	if (tracker_config_get_removable_days_threshold (miner->private->config) == 0) {
-		g_debug ("Stale volume check is disabled");
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) delete_content = NULL, content_left = NULL;
+	g_autoptr (TrackerBatch) batch = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *uri = NULL;
+	RootRemoval *removal;
+
+	removal = g_hash_table_lookup (miner->private->root_removals, root);
+	if (!removal)
 		return;
-	}
 
-	/* Run right away the first check */
-	cleanup_stale_removable_volumes_cb (miner);
+	removal->cancelled = TRUE;
+	g_hash_table_remove (miner->private->root_removals, root);
 
-	g_debug ("Initializing stale volume check timeout...");
+	conn = tracker_miner_get_connection (TRACKER_MINER (miner));
+	delete_content = tracker_load_statement (conn, "delete-index-root-content.rq", NULL);
+	content_left = tracker_load_statement (conn, "get-index-root-content-left.rq", NULL);
+	uri = g_file_get_uri (root);
 
-	/* Then, setup new timeout event every day */
-	miner->private->stale_volumes_check_id =
-		g_timeout_add_seconds (SECONDS_PER_DAY + 1,
-		                       cleanup_stale_removable_volumes_cb,
-		                       miner);
-}
+	tracker_sparql_statement_bind_string (delete_content, "rootFolder", uri);
+	tracker_sparql_statement_bind_int (delete_content, "limit", ROOT_REMOVAL_BATCH_SIZE);
+	tracker_sparql_statement_bind_string (content_left, "rootFolder", uri);
 
-#ifdef HAVE_POWER
+	while (!error) {
+		g_autoptr (TrackerSparqlCursor) cursor = NULL;
 
-static void
-set_up_throttle (TrackerMinerFiles *mf,
-                 gboolean           enable)
-{
-	gdouble throttle;
-	gint config_throttle;
+		cursor = tracker_sparql_statement_execute (content_left, NULL, &error);
+		if (!cursor || !tracker_sparql_cursor_next (cursor, NULL, &error))
+			break;
 
-	config_throttle = tracker_config_get_throttle (mf->private->config);
-	throttle = (1.0 / 20) * config_throttle;
+		tracker_sparql_statement_update (delete_content, NULL, &error);
+	}
 
-	if (enable) {
-		throttle += 0.25;
+	/* delete-index-root.rq removes whatever is left */
+	if (error) {
+		g_warning ("Could not remove index root content: %s", error->message);
+		g_clear_error (&error);
 	}
 
-	throttle = CLAMP (throttle, 0, 1);
+	batch = tracker_sparql_connection_create_batch (conn);
+	delete_index_root (miner, root, batch);
 
-	g_debug ("Setting new throttle to %0.3f", throttle);
-	tracker_miner_fs_set_throttle (TRACKER_MINER_FS (mf), throttle);
+	if (!tracker_batch_execute (batch, NULL, &error))
+		g_warning ("Could not remove index root: %s", error->message);
 }
 
 static void
-check_battery_status (TrackerMinerFiles *mf)
+init_index_roots_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
 {
-	gboolean on_battery, on_low_battery;
-	gboolean should_pause = FALSE;
-	gboolean should_throttle = FALSE;
+	g_autofree GError *error = NULL;
 
-	if (mf->private->power == NULL) {
-		return;
+	tracker_batch_execute_finish (TRACKER_BATCH (source), result, &error);
+
+	if (error) {
+		g_critical ("Could not initialize currently active mount points: %s",
+		            error->message);
+	} else {
+		init_stale_volume_removal (user_data);
 	}
+}
 
-	on_low_battery = tracker_power_get_on_low_battery (mf->private->power);
-	on_battery = tracker_power_get_on_battery (mf->private->power);
+typedef struct {
+	TrackerMinerFiles *miner;
+	TrackerSparqlCursor *cursor;
+	TrackerBatch *batch;
+	GHashTable *handled;
+} IndexRootsInit;
 
-	if (!on_battery) {
-		g_debug ("Running on AC power");
-		should_pause = FALSE;
-		should_throttle = FALSE;
-	} else if (on_low_battery) {
-		g_message ("Running on LOW Battery, pausing");
+static void
+index_roots_init_free (IndexRootsInit *data)
+{
+	g_clear_object (&data->cursor);
+	g_object_unref (data->batch);
+	g_hash_table_unref (data->handled);
+	g_object_unref (data->miner);
+	g_slice_free (IndexRootsInit, data);
+}
+
+static void
+init_index_root (IndexRootsInit *data)
+{
+	TrackerMinerFiles *miner_files = data->miner;
+	TrackerIndexingTree *indexing_tree;
+	gboolean is_removable, is_optical;
+	const gchar *uri;
+	GFile *file;
+
+	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (miner_files));
+	uri = tracker_sparql_cursor_get_string (data->cursor, 0, NULL);
+	is_removable = tracker_sparql_cursor_get_boolean (data->cursor, 1);
+	is_optical = tracker_sparql_cursor_get_boolean (data->cursor, 2);
+
+	file = g_file_new_for_uri (uri);
+	g_hash_table_add (data->handled, file);
+
+	if (tracker_indexing_tree_file_is_root (indexing_tree, file)) {
+		/* Directory is indexed and configured */
+		if (is_removable || is_optical) {
+			set_up_mount_point (miner_files,
+			                    file,
+			                    TRUE,
+			                    data->batch);
+		}
+	} else {
+		/* Directory is indexed, but no longer configured */
+		if (tracker_config_get_removable_days_threshold (miner_files->private->config) > 0 &&
+		    ((is_optical &&
+		      tracker_config_get_index_optical_discs (miner_files->private->config)) ||
+		     (!is_optical && is_removable &&
+		      tracker_config_get_index_removable_devices (miner_files->private->config)))) {
+			/* Preserve */
+			set_up_mount_point (miner_files,
+			                    file, FALSE, data->batch);
+		} else {
+			/* Not a removable device to preserve, or a no
+			 * longer configured folder.
+			 */
+			remove_index_root (miner_files, file);
+		}
+	}
+}
+
+static void
+init_index_roots_finish (IndexRootsInit *data)
+{
+	TrackerMinerFiles *miner_files = data->miner;
+	TrackerIndexingTree *indexing_tree;
+	g_autoptr (GList) roots = NULL;
+	GList *l;
+
+	indexing_tree = tracker_miner_fs_get_indexing_tree (TRACKER_MINER_FS (miner_files));
+	roots = tracker_indexing_tree_list_roots (indexing_tree);
+
+	for (l = roots; l; l = l->next) {
+		TrackerStorage *storage = miner_files->private->storage;
+		TrackerStorageType type;
+		GFile *file = l->data;
+
+		if (g_hash_table_contains (data->handled, file))
+			continue;
+
+		type = tracker_storage_get_type_for_file (storage, file);
+
+		if ((type & TRACKER_STORAGE_REMOVABLE) != 0)
+			set_up_mount_point (miner_files, file, TRUE, NULL);
+	}
+
+	tracker_batch_execute_async (data->batch,
+	                             NULL,
+	                             init_index_roots_cb,
+	                             miner_files);
+	index_roots_init_free (data);
+}
+
+static void
+index_roots_cursor_next_cb (GObject      *source,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	IndexRootsInit *data = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_sparql_cursor_next_finish (TRACKER_SPARQL_CURSOR (source),
+	                                        result, &error)) {
+		if (error) {
+			g_critical ("Could not obtain the mounted volumes: %s", error->message);
+			index_roots_init_free (data);
+		} else {
+			init_index_roots_finish (data);
+		}
+
+		return;
+	}
+
+	init_index_root (data);
+	tracker_sparql_cursor_next_async (data->cursor, NULL,
+	                                  index_roots_cursor_next_cb,
+	                                  data);
+}
+
+static void
+index_roots_query_cb (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	IndexRootsInit *data = user_data;
+	g_autoptr (GError) error = NULL;
+
+	data->cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (source),
+	                                                        result, &error);
+	if (!data->cursor) {
+		g_critical ("Could not obtain the mounted volumes: %s", error->message);
+		index_roots_init_free (data);
+		return;
+	}
+
+	tracker_sparql_cursor_next_async (data->cursor, NULL,
+	                                  index_roots_cursor_next_cb,
+	                                  data);
+}
+
+/* Index roots are handled as the query results come in, so the main
+ * loop is free to serve D-Bus requests during startup.
+ */
+static void
+init_index_roots (TrackerMinerFiles *miner_files)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (GError) error = NULL;
+	IndexRootsInit *data;
+
+	g_debug ("Initializing mount points...");
+
+	conn = tracker_miner_get_connection (TRACKER_MINER (miner_files));
+	stmt = tracker_load_statement (conn, "get-index-roots.rq", &error);
+
+	if (!stmt) {
+		g_critical ("Could not obtain the mounted volumes: %s", error->message);
+		return;
+	}
+
+	data = g_slice_new0 (IndexRootsInit);
+	data->miner = g_object_ref (miner_files);
+	data->batch = tracker_sparql_connection_create_batch (conn);
+	data->handled = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+	                                       g_object_unref, NULL);
+
+	tracker_sparql_statement_execute_async (stmt, NULL,
+	                                        index_roots_query_cb,
+	                                        data);
+}
+
+static gboolean
+cleanup_stale_removable_volumes_cb (gpointer user_data)
+{
+	TrackerMinerFiles *miner = TRACKER_MINER_FILES (user_data);
+	g_autoptr (GDateTime) now = NULL, n_days_ago = NULL;
+	gint n_days_threshold;
+
+	n_days_threshold = tracker_config_get_removable_days_threshold (miner->private->config);
+
+	if (n_days_threshold == 0)
+		return TRUE;
+
+	g_debug ("Running stale volumes check...");
+
+	now = g_date_time_new_now_utc ();
+	n_days_ago = g_date_time_add_days (now, -n_days_threshold);
+	miner_files_in_removable_media_remove_by_date (miner, n_days_ago);
+	prune_volume_cache (miner);
+
+	return TRUE;
+}
+
+static void
+init_stale_volume_removal (TrackerMinerFiles *miner)
+{
+	/* If disabled, make sure we don't do anything */
+	if (tracker_config_get_removable_days_threshold (miner->private->config) == 0) {
+		g_debug ("Stale volume check is disabled");
+		return;
+	}
+
+	/* Run right away the first check */
+	cleanup_stale_removable_volumes_cb (miner);
+
+	g_debug ("Initializing stale volume check timeout...");
+
+	/* Then, setup new timeout event every day */
+	miner->private->stale_volumes_check_id =
+		g_timeout_add_seconds (SECONDS_PER_DAY + 1,
+		                       cleanup_stale_removable_volumes_cb,
+		                       miner);
+}
+
+static void
+set_up_throttle (TrackerMinerFiles *mf,
+                 gboolean           enable)
+{
+	gdouble throttle;
+	gint config_throttle;
+
+	mf->private->battery_throttle = enable;
+
+	config_throttle = tracker_config_get_throttle (mf->private->config);
+	throttle = (1.0 / 20) * config_throttle;
+
+	if (enable) {
+		throttle += 0.25;
+	}
+
+	/* Back off further while the system is under resource pressure */
+	if (mf->private->pressure)
+		throttle = MAX (throttle, tracker_pressure_get_pressure (mf->private->pressure));
+
+	throttle = CLAMP (throttle, 0, 1);
+
+	g_debug ("Setting new throttle to %0.3f", throttle);
+	tracker_miner_fs_set_throttle (TRACKER_MINER_FS (mf), throttle);
+}
+
+static void
+pressure_changed_cb (GObject    *object,
+                     GParamSpec *pspec,
+                     gpointer    user_data)
+{
+	TrackerMinerFiles *mf = user_data;
+
+	set_up_throttle (mf, mf->private->battery_throttle);
+}
+
+#ifdef HAVE_POWER
+
+static void
+check_battery_status (TrackerMinerFiles *mf)
+{
+	gboolean on_battery, on_low_battery;
+	gboolean should_pause = FALSE;
+	gboolean should_throttle = FALSE;
+
+	if (mf->private->power == NULL) {
+		return;
+	}
+
+	on_low_battery = tracker_power_get_on_low_battery (mf->private->power);
+	on_battery = tracker_power_get_on_battery (mf->private->power);
+
+	if (!on_battery) {
+		g_debug ("Running on AC power");
+		should_pause = FALSE;
+		should_throttle = FALSE;
+	} else if (on_low_battery) {
+		g_message ("Running on LOW Battery, pausing");
 		should_pause = TRUE;
 		should_throttle = TRUE;
 	} else {
@@ -781,18 +1390,303 @@ miner_finished_cb (TrackerMinerFS *fs,
 		mf->private->finished_handler = 0;
 	}
 
-#ifdef HAVE_POWER
-	check_battery_status (mf);
-#endif /* HAVE_POWER */
-}
+#ifdef HAVE_POWER
+	check_battery_status (mf);
+#endif /* HAVE_POWER */
+}
+
+static GFile *
+get_cache_dir (TrackerMinerFiles *mf)
+{
+	GFile *cache;
+
+	cache = tracker_domain_ontology_get_cache (mf->private->domain_ontology);
+	return g_file_get_child (cache, "files");
+}
+
+static GFile *
+get_volume_cache_dir (TrackerMinerFiles *mf)
+{
+	g_autoptr (GFile) cache_dir = NULL;
+
+	cache_dir = get_cache_dir (mf);
+	return g_file_get_child (cache_dir, "volumes");
+}
+
+/* The cache of an expired volume is keyed by its root content
+ * identifier (filesystem UUID and root inode), and by the URI it
+ * was mounted on, since the cached data refers to file URIs.
+ */
+static GFile *
+get_volume_cache_file (TrackerMinerFiles *mf,
+                       const gchar       *root_urn,
+                       const gchar       *root_uri)
+{
+	g_autoptr (GFile) volumes_dir = NULL;
+	g_autoptr (GChecksum) checksum = NULL;
+	g_autofree gchar *basename = NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_checksum_update (checksum, (const guchar *) root_urn, -1);
+	g_checksum_update (checksum, (const guchar *) " ", 1);
+	g_checksum_update (checksum, (const guchar *) root_uri, -1);
+	basename = g_strconcat (g_checksum_get_string (checksum), ".trig", NULL);
+
+	volumes_dir = get_volume_cache_dir (mf);
+
+	return g_file_get_child (volumes_dir, basename);
+}
+
+/* Loads back the data of a volume that expired while unplugged, so
+ * that only files modified in the meantime need to be extracted again.
+ * This is synchronous on purpose, the data must be in place before the
+ * crawler compares the volume contents with the store.
+ */
+static void
+restore_volume_cache (TrackerMinerFiles *mf,
+                      GFile             *root)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (GFileInfo) info = NULL;
+	g_autoptr (GFile) cache_file = NULL;
+	g_autofree gchar *root_urn = NULL, *root_uri = NULL;
+	g_autofree gchar *cache_uri = NULL, *query = NULL;
+	g_autoptr (GError) error = NULL;
+
+	info = g_file_query_info (root,
+	                          G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
+	                          G_FILE_ATTRIBUTE_UNIX_INODE,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, NULL);
+	if (!info)
+		return;
+
+	root_urn = tracker_miner_files_get_content_identifier (mf, root, info);
+	root_uri = g_file_get_uri (root);
+	cache_file = get_volume_cache_file (mf, root_urn, root_uri);
+
+	if (!g_file_query_exists (cache_file, NULL))
+		return;
+
+	g_debug ("Restoring cached contents of volume '%s'", root_uri);
+
+	cache_uri = g_file_get_uri (cache_file);
+	query = g_strdup_printf ("LOAD <%s>", cache_uri);
+	conn = tracker_miner_get_connection (TRACKER_MINER (mf));
+
+	if (!tracker_sparql_connection_update (conn, query, NULL, &error)) {
+		g_warning ("Could not restore cached contents of volume '%s': %s",
+		           root_uri, error->message);
+	}
+
+	/* The volume is available again, it's the crawler's business now */
+	g_file_delete (cache_file, NULL, NULL);
+}
+
+static void
+prune_volume_cache (TrackerMinerFiles *mf)
+{
+	g_autoptr (GFile) volumes_dir = NULL;
+	g_autoptr (GFileEnumerator) enumerator = NULL;
+	g_autoptr (GDateTime) now = NULL, oldest = NULL;
+	GFileInfo *info;
+	GFile *child;
+
+	volumes_dir = get_volume_cache_dir (mf);
+	enumerator = g_file_enumerate_children (volumes_dir,
+	                                        G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, NULL);
+	if (!enumerator)
+		return;
+
+	now = g_date_time_new_now_utc ();
+	oldest = g_date_time_add_days (now, -VOLUME_CACHE_MAX_AGE_DAYS);
+
+	while (g_file_enumerator_iterate (enumerator, &info, &child, NULL, NULL) &&
+	       info) {
+		g_autoptr (GDateTime) modified = NULL;
+
+		modified = g_file_info_get_modification_date_time (info);
+
+		if (modified && g_date_time_compare (modified, oldest) < 0)
+			g_file_delete (child, NULL, NULL);
+	}
+}
+
+
+/* Index bundles are keyed by the URI of the root they are imported for */
+static GFile *
+get_index_bundle_file (TrackerMinerFiles *mf,
+                       const gchar       *root_uri)
+{
+	g_autoptr (GFile) cache_dir = NULL, bundles_dir = NULL;
+	g_autofree gchar *checksum = NULL, *basename = NULL;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, root_uri, -1);
+	basename = g_strconcat (checksum, ".trig", NULL);
+
+	cache_dir = get_cache_dir (mf);
+	bundles_dir = g_file_get_child (cache_dir, "bundles");
+
+	return g_file_get_child (bundles_dir, basename);
+}
+
+static gboolean
+read_index_bundle_header (GDataInputStream  *stream,
+                          const gchar       *key,
+                          gchar            **value)
+{
+	g_autofree gchar *line = NULL;
+	gsize key_len = strlen (key);
+
+	line = g_data_input_stream_read_line (stream, NULL, NULL, NULL);
+
+	if (!line ||
+	    !g_str_has_prefix (line, "# ") ||
+	    strncmp (&line[2], key, key_len) != 0 ||
+	    line[2 + key_len] != ' ')
+		return FALSE;
+
+	*value = g_strdup (&line[2 + key_len + 1]);
+	return TRUE;
+}
+
+/* Bundles refer to the files with the URIs of the machine that exported
+ * them, and to the root folder with its content identifier there. Both
+ * are replaced on IRIs and nie:url strings, other identifiers are kept
+ * as they are, they only need to be unique.
+ */
+static void
+append_index_bundle_line (GString     *str,
+                          const gchar *line,
+                          const gchar *src_uri,
+                          const gchar *dest_uri,
+                          const gchar *src_urn,
+                          const gchar *dest_urn)
+{
+	gsize uri_len = strlen (src_uri), urn_len = strlen (src_urn);
+	const gchar *p = line;
+
+	while (TRUE) {
+		const gchar *next;
+		gchar closing;
+
+		next = strpbrk (p, "<\"");
+		if (!next) {
+			g_string_append (str, p);
+			break;
+		}
+
+		g_string_append_len (str, p, next - p + 1);
+		closing = *next == '<' ? '>' : '"';
+		p = next + 1;
+
+		if (strncmp (p, src_uri, uri_len) == 0 &&
+		    (p[uri_len] == '/' || p[uri_len] == closing)) {
+			g_string_append (str, dest_uri);
+			p += uri_len;
+		} else if (closing == '>' &&
+		           strncmp (p, src_urn, urn_len) == 0 &&
+		           p[urn_len] == closing) {
+			g_string_append (str, dest_urn);
+			p += urn_len;
+		}
+	}
+
+	g_string_append_c (str, '\n');
+}
+
+/* Loads the data imported for a root with `localsearch index
+ * --import-bundle`, so the crawler only has to check that the files
+ * were not modified instead of extracting them. Like cached volumes,
+ * this happens synchronously before the root is crawled.
+ */
+static void
+restore_index_bundle (TrackerMinerFiles *mf,
+                      GFile             *root)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (GFile) bundle_file = NULL, load_file = NULL, parent = NULL;
+	g_autoptr (GFileInputStream) istream = NULL;
+	g_autoptr (GFileOutputStream) ostream = NULL;
+	g_autoptr (GDataInputStream) data = NULL;
+	g_autoptr (GFileInfo) info = NULL;
+	g_autoptr (GString) str = NULL;
+	g_autofree gchar *header = NULL, *src_uri = NULL, *src_urn = NULL;
+	g_autofree gchar *root_uri = NULL, *root_urn = NULL;
+	g_autofree gchar *load_uri = NULL, *query = NULL, *line = NULL;
+	g_autoptr (GError) error = NULL;
+
+	root_uri = g_file_get_uri (root);
+	bundle_file = get_index_bundle_file (mf, root_uri);
+	istream = g_file_read (bundle_file, NULL, NULL);
+	if (!istream)
+		return;
+
+	info = g_file_query_info (root,
+	                          G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
+	                          G_FILE_ATTRIBUTE_UNIX_INODE,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, NULL);
+	if (!info)
+		return;
+
+	data = g_data_input_stream_new (G_INPUT_STREAM (istream));
+	header = g_data_input_stream_read_line (data, NULL, NULL, NULL);
+
+	if (g_strcmp0 (header, INDEX_BUNDLE_HEADER) != 0 ||
+	    !read_index_bundle_header (data, "root-uri", &src_uri) ||
+	    !read_index_bundle_header (data, "root-urn", &src_urn)) {
+		g_warning ("Index bundle for '%s' is not valid, ignoring", root_uri);
+		g_file_delete (bundle_file, NULL, NULL);
+		return;
+	}
+
+	g_debug ("Importing index bundle of '%s' into '%s'", src_uri, root_uri);
+
+	root_urn = tracker_miner_files_get_content_identifier (mf, root, info);
+
+	parent = g_file_get_parent (bundle_file);
+	load_file = g_file_get_child (parent, "import.trig");
+	ostream = g_file_replace (load_file, NULL, FALSE,
+	                          G_FILE_CREATE_PRIVATE,
+	                          NULL, &error);
+
+	str = g_string_new (NULL);
+
+	while (ostream &&
+	       (line = g_data_input_stream_read_line (data, NULL, NULL, &error)) != NULL) {
+		g_string_truncate (str, 0);
+		append_index_bundle_line (str, line,
+		                          src_uri, root_uri,
+		                          src_urn, root_urn);
+		g_clear_pointer (&line, g_free);
+
+		if (!g_output_stream_write_all (G_OUTPUT_STREAM (ostream),
+		                                str->str, str->len,
+		                                NULL, NULL, &error))
+			break;
+	}
+
+	if (ostream && !error)
+		g_output_stream_close (G_OUTPUT_STREAM (ostream), NULL, &error);
 
-static GFile *
-get_cache_dir (TrackerMinerFiles *mf)
-{
-	GFile *cache;
+	if (!error) {
+		load_uri = g_file_get_uri (load_file);
+		query = g_strdup_printf ("LOAD <%s>", load_uri);
+		conn = tracker_miner_get_connection (TRACKER_MINER (mf));
+		tracker_sparql_connection_update (conn, query, NULL, &error);
+	}
 
-	cache = tracker_domain_ontology_get_cache (mf->private->domain_ontology);
-	return g_file_get_child (cache, "files");
+	/* E.g. because the root was already indexed, it is just crawled then */
+	if (error) {
+		g_warning ("Could not import index bundle for '%s': %s",
+		           root_uri, error->message);
+	}
+
+	g_file_delete (load_file, NULL, NULL);
+	g_file_delete (bundle_file, NULL, NULL);
 }
 
 
@@ -906,10 +1800,18 @@ indexing_tree_directory_added_cb (TrackerIndexingTree *indexing_tree,
 	TrackerStorage *storage = miner_files->private->storage;
 	TrackerStorageType type;
 
+	/* A new folder to crawl */
+	set_steady_state (miner_files, FALSE);
+
+	cancel_index_root_removal (miner_files, directory);
+	restore_index_bundle (miner_files, directory);
+
 	type = tracker_storage_get_type_for_file (storage, directory);
 
-	if ((type & TRACKER_STORAGE_REMOVABLE) != 0)
+	if ((type & TRACKER_STORAGE_REMOVABLE) != 0) {
+		restore_volume_cache (miner_files, directory);
 		set_up_mount_point (miner_files, directory, TRUE, NULL);
+	}
 }
 
 static void
@@ -941,16 +1843,46 @@ indexing_tree_directory_removed_cb (TrackerIndexingTree *indexing_tree,
 		delete = TRUE;
 	}
 
-	conn = tracker_miner_get_connection (TRACKER_MINER (miner_files));
-	batch = tracker_sparql_connection_create_batch (conn);
-
-	if (delete)
-		delete_index_root (miner_files, directory, batch);
-	else if (update_mount)
+	if (delete) {
+		remove_index_root (miner_files, directory);
+	} else if (update_mount) {
+		conn = tracker_miner_get_connection (TRACKER_MINER (miner_files));
+		batch = tracker_sparql_connection_create_batch (conn);
 		set_up_mount_point (miner_files, directory, FALSE, batch);
 
-	if (!tracker_batch_execute (batch, NULL, &error))
-		g_warning ("Error updating indexed folder: %s", error->message);
+		if (!tracker_batch_execute (batch, NULL, &error))
+			g_warning ("Error updating indexed folder: %s", error->message);
+	}
+}
+
+/* Returns %TRUE if the file is in the state writeback left it in */
+static gboolean
+miner_files_take_writeback_echo (TrackerMinerFiles *mf,
+                                 GFile             *file,
+                                 GFileInfo         *info)
+{
+	WritebackEcho *echo;
+
+	if (g_hash_table_size (mf->private->writeback_echoes) == 0)
+		return FALSE;
+
+	echo = g_hash_table_lookup (mf->private->writeback_echoes, file);
+	if (!echo)
+		return FALSE;
+
+	if (echo->expiry < g_get_monotonic_time ()) {
+		g_hash_table_remove (mf->private->writeback_echoes, file);
+		return FALSE;
+	}
+
+	/* Events from before the writeback may still be queued */
+	if ((gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) != echo->modified ||
+	    g_file_info_get_size (info) != echo->size)
+		return FALSE;
+
+	g_hash_table_remove (mf->private->writeback_echoes, file);
+
+	return TRUE;
 }
 
 static void
@@ -960,6 +1892,15 @@ miner_files_process_file (TrackerMinerFS       *fs,
                           TrackerSparqlBuffer  *buffer,
                           gboolean              create)
 {
+	/* Writeback replaces files, so these may come as created too */
+	if (miner_files_take_writeback_echo (TRACKER_MINER_FILES (fs), file, info)) {
+		TRACKER_NOTE (MINER_FS_EVENTS,
+		              g_message ("File '%s' was written back, not extracting it again",
+		                         g_file_peek_path (file)));
+		tracker_miner_files_process_rewritten_file (fs, file, info, buffer);
+		return;
+	}
+
 	tracker_miner_files_process_file (fs, file, info, buffer, create);
 }
 
@@ -981,6 +1922,7 @@ miner_files_finished (TrackerMinerFS *fs,
                       gint            files_ignored)
 {
 	tracker_miner_files_check_unextracted (TRACKER_MINER_FILES (fs));
+	set_steady_state (TRACKER_MINER_FILES (fs), TRUE);
 }
 
 static void
@@ -1021,25 +1963,116 @@ miner_files_move_file (TrackerMinerFS      *fs,
 }
 
 static void
-text_allowlist_changed_cb (GSettings         *settings,
-                           const gchar       *key,
-                           TrackerMinerFiles *mf)
+text_config_clear (TextConfig *text_config)
+{
+	g_clear_pointer (&text_config->text_limits, tracker_text_limits_unref);
+	g_clear_pointer (&text_config->allowed_text_suffixes, g_hash_table_unref);
+	g_clear_pointer (&text_config->allowed_text_names, g_hash_table_unref);
+	g_clear_pointer (&text_config->allowed_text_patterns, g_ptr_array_unref);
+}
+
+static void
+text_config_unref (TextConfig *text_config)
 {
-	GStrv allow_list;
+	g_atomic_rc_box_release_full (text_config, (GDestroyNotify) text_config_clear);
+}
+
+static TextConfig *
+text_config_new (GSettings *settings)
+{
+	g_autoptr (GVariant) limits = NULL;
+	g_auto (GStrv) allow_list = NULL;
+	TextConfig *text_config;
 	gint i;
 
-	g_list_free_full (mf->private->allowed_text_patterns, (GDestroyNotify) g_pattern_spec_free);
-	mf->private->allowed_text_patterns = NULL;
+	text_config = g_atomic_rc_box_new0 (TextConfig);
+
+	limits = g_settings_get_value (settings, TEXT_LIMITS);
+	text_config->text_limits =
+		tracker_text_limits_new (g_settings_get_int (settings, MAX_BYTES),
+		                         g_settings_get_int (settings, TEXT_TAIL_BYTES),
+		                         limits);
+
+	text_config->allowed_text_suffixes =
+		g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	text_config->allowed_text_names =
+		g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	text_config->allowed_text_patterns =
+		g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
 
 	allow_list = g_settings_get_strv (settings, TEXT_ALLOWLIST);
 
+	/* Most patterns are file extensions, those are looked up with
+	 * the suffixes of the file name, the rest need matching.
+	 */
 	for (i = 0; allow_list[i]; i++) {
-		mf->private->allowed_text_patterns =
-			g_list_prepend (mf->private->allowed_text_patterns,
-			                g_pattern_spec_new (allow_list[i]));
+		const gchar *pattern = allow_list[i];
+
+		if (pattern[0] == '*' && pattern[1] == '.' &&
+		    !strpbrk (&pattern[1], "*?")) {
+			g_hash_table_add (text_config->allowed_text_suffixes,
+			                  g_strdup (&pattern[1]));
+		} else if (!strpbrk (pattern, "*?")) {
+			g_hash_table_add (text_config->allowed_text_names,
+			                  g_strdup (pattern));
+		} else {
+			g_ptr_array_add (text_config->allowed_text_patterns,
+			                 g_pattern_spec_new (pattern));
+		}
+	}
+
+	return text_config;
+}
+
+static void
+text_config_changed_cb (GSettings         *settings,
+                        const gchar       *key,
+                        TrackerMinerFiles *mf)
+{
+	TextConfig *text_config, *old;
+
+	text_config = text_config_new (settings);
+
+	g_mutex_lock (&mf->private->text_config_mutex);
+	old = mf->private->text_config;
+	mf->private->text_config = text_config;
+	g_mutex_unlock (&mf->private->text_config_mutex);
+
+	if (old)
+		text_config_unref (old);
+}
+
+static TextConfig *
+miner_files_get_text_config (TrackerMinerFiles *mf)
+{
+	TextConfig *text_config;
+
+	g_mutex_lock (&mf->private->text_config_mutex);
+	text_config = g_atomic_rc_box_acquire (mf->private->text_config);
+	g_mutex_unlock (&mf->private->text_config_mutex);
+
+	return text_config;
+}
+
+static void
+init_status_page (TrackerMinerFiles *mf,
+                  GFile             *cache_dir)
+{
+	g_autoptr (TrackerStatusPage) page = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *path = NULL;
+
+	path = g_file_get_path (cache_dir);
+	g_mkdir_with_parents (path, 0700);
+
+	page = tracker_status_page_new (cache_dir, &error);
+	if (!page) {
+		g_warning ("%s", error->message);
+		return;
 	}
 
-	g_strfreev (allow_list);
+	tracker_miner_fs_set_status_page (TRACKER_MINER_FS (mf),
+	                                  g_steal_pointer (&page));
 }
 
 static void
@@ -1047,6 +2080,7 @@ miner_files_constructed (GObject *object)
 {
 	TrackerMinerFiles *mf = TRACKER_MINER_FILES (object);;
 	TrackerIndexingTree *indexing_tree;
+	g_autoptr (GFile) cache_dir = NULL, checkpoint = NULL, consistent_roots = NULL;
 	g_autofree gchar *domain_name = NULL;
 
 	G_OBJECT_CLASS (tracker_miner_files_parent_class)->constructed (object);
@@ -1065,6 +2099,81 @@ miner_files_constructed (GObject *object)
 	                          "notify::removable-days-threshold",
 	                          G_CALLBACK (removable_days_threshold_changed),
 	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::identifier-cache-size",
+	                          G_CALLBACK (identifier_cache_size_changed),
+	                          mf);
+	identifier_cache_size_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::max-crawled-roots",
+	                          G_CALLBACK (crawl_limits_changed),
+	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::max-crawled-directories",
+	                          G_CALLBACK (crawl_limits_changed),
+	                          mf);
+	crawl_limits_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::max-monitors",
+	                          G_CALLBACK (max_monitors_changed),
+	                          mf);
+	max_monitors_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::min-update-delay",
+	                          G_CALLBACK (update_delays_changed),
+	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::max-update-delay",
+	                          G_CALLBACK (update_delays_changed),
+	                          mf);
+	update_delays_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::sniff-content-types",
+	                          G_CALLBACK (sniff_content_types_changed),
+	                          mf);
+	sniff_content_types_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::remote-index-level",
+	                          G_CALLBACK (remote_index_level_changed),
+	                          mf);
+	remote_index_level_changed (mf);
+
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::resource-control",
+	                          G_CALLBACK (resource_control_changed),
+	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::bulk-index-weight",
+	                          G_CALLBACK (resource_control_changed),
+	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::steady-state-weight",
+	                          G_CALLBACK (resource_control_changed),
+	                          mf);
+	g_signal_connect_swapped (mf->private->config,
+	                          "notify::memory-high",
+	                          G_CALLBACK (resource_control_changed),
+	                          mf);
+	resource_control_changed (mf);
+
+	cache_dir = get_cache_dir (mf);
+	checkpoint = g_file_get_child (cache_dir, "crawl-checkpoint");
+	tracker_miner_fs_set_checkpoint_file (TRACKER_MINER_FS (mf), checkpoint);
+	if (mf->private->storage)
+		tracker_miner_fs_set_storage (TRACKER_MINER_FS (mf), mf->private->storage);
+	/* Folders left up to date by a previous run only get their
+	 * changed directories checked, unless crawling is forced.
+	 */
+	consistent_roots = g_file_get_child (cache_dir, "consistent-roots");
+	tracker_miner_fs_set_consistent_roots_file (TRACKER_MINER_FS (mf),
+	                                            consistent_roots,
+	                                            tracker_config_get_crawling_interval (mf->private->config) == -1);
+	init_status_page (mf, cache_dir);
 
 #ifdef HAVE_POWER
 	g_signal_connect (mf->private->config, "notify::index-on-battery",
@@ -1090,8 +2199,14 @@ miner_files_constructed (GObject *object)
 
 	mf->private->extract_settings = g_settings_new ("org.freedesktop.Tracker3.Extract");
 	g_signal_connect (mf->private->extract_settings, "changed::" TEXT_ALLOWLIST,
-	                  G_CALLBACK (text_allowlist_changed_cb), mf);
-	text_allowlist_changed_cb (mf->private->extract_settings, TEXT_ALLOWLIST, mf);
+	                  G_CALLBACK (text_config_changed_cb), mf);
+	g_signal_connect (mf->private->extract_settings, "changed::" MAX_BYTES,
+	                  G_CALLBACK (text_config_changed_cb), mf);
+	g_signal_connect (mf->private->extract_settings, "changed::" TEXT_LIMITS,
+	                  G_CALLBACK (text_config_changed_cb), mf);
+	g_signal_connect (mf->private->extract_settings, "changed::" TEXT_TAIL_BYTES,
+	                  G_CALLBACK (text_config_changed_cb), mf);
+	text_config_changed_cb (mf->private->extract_settings, NULL, mf);
 }
 
 TrackerMiner *
@@ -1116,18 +2231,167 @@ tracker_miner_files_new (TrackerSparqlConnection  *connection,
 	                     NULL);
 }
 
+typedef struct {
+	TrackerMinerFiles *miner;
+	GDateTime *datetime;
+	guint n_pending;
+} VolumeExpiry;
+
+typedef struct {
+	VolumeExpiry *expiry;
+	GFile *cache_file;
+} VolumeSave;
+
+static void remove_expired_batch (VolumeExpiry *expiry);
+
+static void
+volume_expiry_free (VolumeExpiry *expiry)
+{
+	g_object_unref (expiry->miner);
+	g_date_time_unref (expiry->datetime);
+	g_slice_free (VolumeExpiry, expiry);
+}
+
+static void
+check_expired_content_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	VolumeExpiry *expiry = user_data;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+
+	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                  result, &error);
+
+	if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		remove_expired_batch (expiry);
+		return;
+	}
+
+	if (error)
+		g_critical ("Could not remove files in volumes: %s", error->message);
+
+	volume_expiry_free (expiry);
+}
+
 static void
 remove_files_in_removable_media_cb (GObject      *object,
                                     GAsyncResult *result,
                                     gpointer      user_data)
 {
-	g_autofree GError *error = NULL;
+	VolumeExpiry *expiry = user_data;
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (GError) error = NULL;
 
 	tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
 	                                        result, &error);
 
-	if (error)
+	if (error) {
 		g_critical ("Could not remove files in volumes: %s", error->message);
+		volume_expiry_free (expiry);
+		return;
+	}
+
+	/* See whether there is more to remove */
+	conn = tracker_miner_get_connection (TRACKER_MINER (expiry->miner));
+	stmt = tracker_load_statement (conn, "get-expired-mountpoint-content.rq", NULL);
+
+	tracker_sparql_statement_bind_datetime (stmt, "unmountDate", expiry->datetime);
+	tracker_sparql_statement_execute_async (stmt, NULL,
+	                                        check_expired_content_cb,
+	                                        expiry);
+}
+
+/* Expired volumes may hold a large number of files, removing them in
+ * batches keeps each transaction short, so other updates get through.
+ */
+static void
+remove_expired_batch (VolumeExpiry *expiry)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+
+	conn = tracker_miner_get_connection (TRACKER_MINER (expiry->miner));
+	stmt = tracker_load_statement (conn, "delete-mountpoints-by-date.rq", NULL);
+
+	tracker_sparql_statement_bind_datetime (stmt, "unmountDate", expiry->datetime);
+	tracker_sparql_statement_bind_int (stmt, "limit", VOLUME_EXPIRY_BATCH_SIZE);
+	tracker_sparql_statement_update_async (stmt, NULL,
+	                                       remove_files_in_removable_media_cb,
+	                                       expiry);
+}
+
+static void
+volume_expiry_unref (VolumeExpiry *expiry)
+{
+	expiry->n_pending--;
+	if (expiry->n_pending > 0)
+		return;
+
+	/* All cached, now the volume contents can go */
+	remove_expired_batch (expiry);
+}
+
+static void
+volume_save_free (VolumeSave *save)
+{
+	volume_expiry_unref (save->expiry);
+	g_object_unref (save->cache_file);
+	g_slice_free (VolumeSave, save);
+}
+
+static void
+volume_cache_spliced_cb (GObject      *object,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+	VolumeSave *save = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (g_output_stream_splice_finish (G_OUTPUT_STREAM (object),
+	                                   result, &error) < 0) {
+		g_warning ("Could not cache volume contents: %s", error->message);
+		g_file_delete (save->cache_file, NULL, NULL);
+	}
+
+	volume_save_free (save);
+}
+
+static void
+volume_contents_serialized_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	VolumeSave *save = user_data;
+	g_autoptr (GInputStream) istream = NULL;
+	g_autoptr (GFileOutputStream) ostream = NULL;
+	g_autoptr (GFile) parent = NULL;
+	g_autoptr (GError) error = NULL;
+
+	istream = tracker_sparql_statement_serialize_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                     result, &error);
+	if (istream) {
+		parent = g_file_get_parent (save->cache_file);
+		g_file_make_directory_with_parents (parent, NULL, NULL);
+		ostream = g_file_replace (save->cache_file, NULL, FALSE,
+		                          G_FILE_CREATE_PRIVATE,
+		                          NULL, &error);
+	}
+
+	if (!ostream) {
+		g_warning ("Could not cache volume contents: %s", error->message);
+		volume_save_free (save);
+		return;
+	}
+
+	g_output_stream_splice_async (G_OUTPUT_STREAM (ostream), istream,
+	                              G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+	                              G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+	                              G_PRIORITY_LOW, NULL,
+	                              volume_cache_spliced_cb,
+	                              save);
 }
 
 static void
@@ -1136,6 +2400,9 @@ miner_files_in_removable_media_remove_by_date (TrackerMinerFiles *miner,
 {
 	TrackerSparqlConnection *conn;
 	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+	VolumeExpiry *expiry;
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (CONFIG)) {
@@ -1149,12 +2416,55 @@ miner_files_in_removable_media_remove_by_date (TrackerMinerFiles *miner,
 #endif
 
 	conn = tracker_miner_get_connection (TRACKER_MINER (miner));
-	stmt = tracker_load_statement (conn, "delete-mountpoints-by-date.rq", NULL);
 
-	tracker_sparql_statement_bind_datetime (stmt, "unmountDate", datetime);
-	tracker_sparql_statement_update_async (stmt, NULL,
-	                                       remove_files_in_removable_media_cb,
-	                                       NULL);
+	expiry = g_slice_new0 (VolumeExpiry);
+	expiry->miner = g_object_ref (miner);
+	expiry->datetime = g_date_time_ref (datetime);
+	/* Held until all volumes are cached */
+	expiry->n_pending = 1;
+
+	/* Keep the contents of expired volumes aside, so they are cheap
+	 * to bring back if the volume is plugged again.
+	 */
+	stmt = tracker_load_statement (conn, "get-expired-mountpoints.rq", &error);
+
+	if (stmt) {
+		tracker_sparql_statement_bind_datetime (stmt, "unmountDate", datetime);
+		cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	}
+
+	if (error)
+		g_warning ("Could not get expired volumes: %s", error->message);
+
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_autoptr (TrackerSparqlStatement) describe = NULL;
+		const gchar *root_urn, *root_uri;
+		VolumeSave *save;
+
+		root_urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		root_uri = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+
+		describe = tracker_load_statement (conn, "describe-index-root-content.rq", NULL);
+		if (!describe)
+			break;
+
+		g_debug ("Caching contents of expired volume '%s'", root_uri);
+
+		save = g_slice_new0 (VolumeSave);
+		save->expiry = expiry;
+		save->cache_file = get_volume_cache_file (miner, root_urn, root_uri);
+		expiry->n_pending++;
+
+		tracker_sparql_statement_bind_string (describe, "root", root_urn);
+		tracker_sparql_statement_serialize_async (describe,
+		                                          TRACKER_SERIALIZE_FLAGS_NONE,
+		                                          TRACKER_RDF_FORMAT_TRIG,
+		                                          NULL,
+		                                          volume_contents_serialized_cb,
+		                                          save);
+	}
+
+	volume_expiry_unref (expiry);
 }
 
 TrackerStorage *
@@ -1168,24 +2478,215 @@ tracker_miner_files_check_allowed_text_file (TrackerMinerFiles *mf,
                                              GFile             *file)
 {
 	g_autofree gchar *basename = NULL;
-	GList *l;
+	TextConfig *text_config;
+	gboolean allowed;
+	const gchar *suffix;
+	guint i;
 
 	basename = g_file_get_basename (file);
+	text_config = miner_files_get_text_config (mf);
+
+	allowed = g_hash_table_contains (text_config->allowed_text_names, basename);
+
+	for (suffix = strchr (basename, '.');
+	     suffix && !allowed;
+	     suffix = strchr (&suffix[1], '.'))
+		allowed = g_hash_table_contains (text_config->allowed_text_suffixes, suffix);
+
+	for (i = 0; i < text_config->allowed_text_patterns->len && !allowed; i++) {
+		GPatternSpec *pattern =
+			g_ptr_array_index (text_config->allowed_text_patterns, i);
 
-	for (l = mf->private->allowed_text_patterns; l; l = l->next) {
 #if GLIB_CHECK_VERSION (2, 70, 0)
-		if (g_pattern_spec_match_string (l->data, basename))
+		allowed = g_pattern_spec_match_string (pattern, basename);
 #else
-		if (g_pattern_match_string (l->data, basename))
+		allowed = g_pattern_match_string (pattern, basename);
 #endif
-			return TRUE;
 	}
 
-	return FALSE;
+	text_config_unref (text_config);
+
+	return allowed;
+}
+
+/* May be called from worker threads. Unless configured otherwise,
+ * GIO may read the start of the file to tell the content type of
+ * files with unknown or ambiguous extensions.
+ */
+gchar *
+tracker_miner_files_query_content_type (TrackerMinerFiles *mf,
+                                        GFile             *file,
+                                        GFileInfo         *info,
+                                        GCancellable      *cancellable)
+{
+	g_autoptr (GFileInfo) content_info = NULL;
+	const gchar *attribute;
+
+	if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE))
+		return g_strdup (g_file_info_get_content_type (info));
+
+	/* Otherwise the type is guessed from the file name only, the
+	 * extractor looks at the contents of the files it handles anyway.
+	 */
+	if (g_atomic_int_get (&mf->private->sniff_content_types) &&
+	    tracker_miner_files_get_index_level (mf, file) == TRACKER_INDEX_LEVEL_FULL)
+		attribute = G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE;
+	else
+		attribute = G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE;
+
+	content_info = g_file_query_info (file, attribute,
+	                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                  cancellable, NULL);
+	if (!content_info)
+		return NULL;
+
+	return g_strdup (g_file_info_get_attribute_string (content_info, attribute));
+}
+
+/* May be called from worker threads. Files in network and FUSE
+ * mounts are indexed at the configured level, local ones are always
+ * fully indexed.
+ */
+TrackerIndexLevel
+tracker_miner_files_get_index_level (TrackerMinerFiles *mf,
+                                     GFile             *file)
+{
+	TrackerIndexLevel level;
+
+	level = g_atomic_int_get (&mf->private->remote_index_level);
+
+	if (level == TRACKER_INDEX_LEVEL_FULL ||
+	    !g_file_is_native (file) ||
+	    !tracker_file_system_is_remote (g_file_peek_path (file)))
+		return TRACKER_INDEX_LEVEL_FULL;
+
+	return level;
+}
+
+static void
+index_file_extracted_cb (GObject      *object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+	g_autoptr (GTask) task = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (tracker_extract_watchdog_extract_file_finish (TRACKER_EXTRACT_WATCHDOG (object),
+	                                                  res, &error))
+		g_task_return_boolean (task, TRUE);
+	else
+		g_task_return_error (task, g_steal_pointer (&error));
+}
+
+static void
+index_file_stored_cb (GObject      *object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+	g_autoptr (GTask) task = user_data;
+	TrackerMinerFiles *mf = g_task_get_source_object (task);
+	GFile *file = g_task_get_task_data (task);
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_miner_fs_index_file_finish (TRACKER_MINER_FS (object),
+	                                         res, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	if (tracker_miner_files_get_index_level (mf, file) != TRACKER_INDEX_LEVEL_FULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	uri = g_file_get_uri (file);
+	tracker_extract_watchdog_extract_file_async (mf->private->extract_watchdog,
+	                                             uri,
+	                                             g_task_get_cancellable (task),
+	                                             index_file_extracted_cb,
+	                                             g_steal_pointer (&task));
+}
+
+/**
+ * tracker_miner_files_index_file_async:
+ * @mf: a #TrackerMinerFiles
+ * @file: a #GFile
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: callback to call when @file is indexed
+ * @user_data: data for @callback
+ *
+ * Indexes @file ahead of everything else, and has its metadata
+ * extracted right after it is stored. @callback is called once the
+ * extracted metadata is in the store, or once the file is stored if
+ * no metadata is extracted from it.
+ **/
+void
+tracker_miner_files_index_file_async (TrackerMinerFiles   *mf,
+                                      GFile               *file,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (TRACKER_IS_MINER_FILES (mf));
+	g_return_if_fail (G_IS_FILE (file));
+
+	task = g_task_new (mf, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+	tracker_miner_fs_index_file_async (TRACKER_MINER_FS (mf), file,
+	                                   cancellable,
+	                                   index_file_stored_cb,
+	                                   task);
+}
+
+gboolean
+tracker_miner_files_index_file_finish (TrackerMinerFiles  *mf,
+                                       GAsyncResult       *result,
+                                       GError            **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, mf), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+void
+tracker_miner_files_register_writeback (TrackerMinerFiles *mf,
+                                        GFile             *file,
+                                        gint64             modified,
+                                        goffset            size)
+{
+	WritebackEcho *echo;
+	GHashTableIter iter;
+	gint64 now;
+
+	g_return_if_fail (TRACKER_IS_MINER_FILES (mf));
+	g_return_if_fail (G_IS_FILE (file));
+
+	now = g_get_monotonic_time ();
+	g_hash_table_iter_init (&iter, mf->private->writeback_echoes);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &echo)) {
+		if (echo->expiry < now)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	echo = g_new0 (WritebackEcho, 1);
+	echo->modified = modified;
+	echo->size = size;
+	echo->expiry = now + WRITEBACK_ECHO_TIMEOUT * G_USEC_PER_SEC;
+	g_hash_table_replace (mf->private->writeback_echoes,
+	                      g_object_ref (file), echo);
 }
 
-GUdevClient *
-tracker_miner_files_get_udev_client (TrackerMinerFiles *mf)
+void
+tracker_miner_files_set_store_location (TrackerMinerFiles *mf,
+                                        GFile             *location)
 {
-	return mf->private->udev_client;
+	g_return_if_fail (TRACKER_IS_MINER_FILES (mf));
+
+	tracker_extract_watchdog_set_store_location (mf->private->extract_watchdog,
+	                                             location);
 }
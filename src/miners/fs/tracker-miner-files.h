@@ -21,7 +21,6 @@
 #define __TRACKER_MINER_FS_FILES_H__
 
 #include <gio/gio.h>
-#include <gudev/gudev.h>
 
 #include "tracker-config.h"
 
@@ -41,6 +40,13 @@ typedef struct TrackerMinerFiles TrackerMinerFiles;
 typedef struct TrackerMinerFilesClass TrackerMinerFilesClass;
 typedef struct TrackerMinerFilesPrivate TrackerMinerFilesPrivate;
 
+/* How much is indexed from a file */
+typedef enum {
+	TRACKER_INDEX_LEVEL_NAMES,
+	TRACKER_INDEX_LEVEL_METADATA,
+	TRACKER_INDEX_LEVEL_FULL,
+} TrackerIndexLevel;
+
 struct TrackerMinerFiles {
 	TrackerMinerFS parent_instance;
 	TrackerMinerFilesPrivate *private;
@@ -64,7 +70,31 @@ TrackerStorage * tracker_miner_files_get_storage (TrackerMinerFiles *mf);
 gboolean tracker_miner_files_check_allowed_text_file (TrackerMinerFiles *mf,
                                                       GFile             *file);
 
-GUdevClient * tracker_miner_files_get_udev_client (TrackerMinerFiles *mf);
+gchar * tracker_miner_files_query_content_type (TrackerMinerFiles *mf,
+                                                GFile             *file,
+                                                GFileInfo         *info,
+                                                GCancellable      *cancellable);
+
+TrackerIndexLevel tracker_miner_files_get_index_level (TrackerMinerFiles *mf,
+                                                       GFile             *file);
+
+void tracker_miner_files_index_file_async (TrackerMinerFiles   *mf,
+                                           GFile               *file,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+
+gboolean tracker_miner_files_index_file_finish (TrackerMinerFiles  *mf,
+                                                GAsyncResult       *result,
+                                                GError            **error);
+
+void tracker_miner_files_register_writeback (TrackerMinerFiles *mf,
+                                             GFile             *file,
+                                             gint64             modified,
+                                             goffset            size);
+
+void tracker_miner_files_set_store_location (TrackerMinerFiles *mf,
+                                             GFile             *location);
 
 G_END_DECLS
 
@@ -29,11 +29,12 @@
 #include "tracker-sparql-buffer.h"
 #include "tracker-file-notifier.h"
 #include "tracker-lru.h"
+#include "tracker-mem-pool.h"
+#include "tracker-file-trie.h"
+#include "tracker-packed-info.h"
 
 #define BUFFER_POOL_LIMIT 800
-#define DEFAULT_URN_LRU_SIZE 100
-
-#define BIG_QUEUE_THRESHOLD 1000
+#define DEFAULT_URN_LRU_SIZE 1000
 
 /* Put tasks processing at a lower priority so other events
  * (timeouts, monitor events, etc...) are guaranteed to be
@@ -41,10 +42,46 @@
  */
 #define TRACKER_TASK_PRIORITY G_PRIORITY_DEFAULT_IDLE + 10
 
-#define MAX_SIMULTANEOUS_ITEMS 64
+/* Time spent handling items per dispatch, so the main loop gets
+ * to D-Bus and monitor events in between regardless of how long
+ * each item takes.
+ */
+#define ITEM_SLICE_USEC (8 * 1000)
+
+/* Time slice while indexing from scratch, nothing interactive is
+ * waiting on the queue then.
+ */
+#define BULK_ITEM_SLICE_USEC (32 * 1000)
+
+/* Items being prepared in worker threads, or waiting for an earlier
+ * one to be ready, at any given time.
+ */
+#define MAX_PENDING_ITEMS 64
+
+/* Threads preparing those items. They get a pool of their own, the
+ * GLib one is where the SPARQL endpoint runs queries and streams
+ * cursors to readers, and blocking reads of file contents there
+ * delay every client.
+ */
+#define MAX_PREPARE_THREADS 4
 
 #define TRACKER_CRAWLER_MAX_TIMEOUT_INTERVAL 1000
 
+/* Queue priority of the files requested through
+ * tracker_miner_fs_index_file_async(), ahead of everything else.
+ */
+#define URGENT_PRIORITY (G_PRIORITY_HIGH - 100)
+
+/* Queue priority of the files the user is likely working on, see
+ * TrackerFileNotifier::hot-file, ahead of crawled files.
+ */
+#define HOT_PRIORITY (G_PRIORITY_HIGH - 50)
+
+/* Levels of progressive roots queued at the priority of the root,
+ * files deeper than this go after the other crawled files.
+ */
+#define PROGRESSIVE_CRAWL_LEVELS 3
+
 /**
  * SECTION:tracker-miner-fs
  * @short_description: Abstract base class for filesystem miners
@@ -63,13 +100,31 @@ typedef struct {
 	guint16 type;
 	guint attributes_update : 1;
 	guint is_dir : 1;
+	gint priority;
 	GFile *file;
 	GFile *dest_file;
+	/* Only one of these is set */
+	TrackerPackedInfo *packed_info;
 	GFileInfo *info;
 	GList *root_node;
 	GList *queue_node;
+	gint64 queued_time;
 } QueueEvent;
 
+/* An item taken from the queue, processed once it and all items
+ * taken before it are ready.
+ */
+typedef struct {
+	GFile *file;
+	GFile *source_file;
+	GFileInfo *info;
+	guint16 type;
+	guint attributes_update : 1;
+	guint is_dir : 1;
+	guint prepared : 1;
+	guint ready : 1;
+} PendingItem;
+
 typedef struct {
 	GFile *file;
 	gchar *urn;
@@ -81,9 +136,22 @@ typedef struct {
 
 struct _TrackerMinerFSPrivate {
 	TrackerPriorityQueue *items;
-	GHashTable *items_by_file;
+	/* Lists of queued events for each file, newest first */
+	TrackerFileTrie *items_by_file;
+	/* PendingItems, in queue order */
+	GQueue pending_items;
+	GThreadPool *prepare_pool;
+	/* GTasks waiting for a file to be stored, see
+	 * tracker_miner_fs_index_file_async().
+	 */
+	GPtrArray *urgent_tasks;
+	/* Files with hot changes not stored yet, these are also
+	 * stored without waiting for a full batch.
+	 */
+	GHashTable *hot_files;
 
 	guint item_queues_handler_id;
+	guint progress_update_id;
 
 	TrackerIndexingTree *indexing_tree;
 	TrackerFileNotifier *file_notifier;
@@ -102,10 +170,18 @@ struct _TrackerMinerFSPrivate {
 	/* Status */
 	GTimer *timer;
 	GTimer *extraction_timer;
+	gdouble progress_logged;
+	guint n_progress_updates;
+	TrackerStatusPage *status_page;
+	TrackerEventRecorder *event_recorder;
+
+	TrackerMetric *queue_wait_metric;
+	TrackerMetric *resource_build_metric;
 
 	guint shown_totals : 1;     /* TRUE if totals have been shown */
 	guint is_paused : 1;        /* TRUE if miner is paused */
 	guint flushing : 1;         /* TRUE if flushing SPARQL */
+	guint bulk_mode : 1;        /* TRUE if indexing for throughput */
 
 	guint timer_stopped : 1;    /* TRUE if main timer is stopped */
 	guint extraction_timer_stopped : 1; /* TRUE if the extraction
@@ -143,6 +219,13 @@ typedef enum {
 	TRACKER_MINER_FS_EVENT_MOVED,
 } TrackerMinerFSEventType;
 
+static const gchar *event_names[] = {
+	[TRACKER_MINER_FS_EVENT_CREATED] = "created",
+	[TRACKER_MINER_FS_EVENT_UPDATED] = "updated",
+	[TRACKER_MINER_FS_EVENT_DELETED] = "deleted",
+	[TRACKER_MINER_FS_EVENT_MOVED] = "moved",
+};
+
 enum {
 	FINISHED,
 	FINISHED_ROOT,
@@ -194,6 +277,9 @@ static void           file_notifier_file_moved            (TrackerFileNotifier
                                                            GFile                *dest,
                                                            gboolean              is_dir,
                                                            gpointer              user_data);
+static void           miner_fs_cache_identifier           (TrackerMinerFS      *fs,
+                                                           GFile               *file,
+                                                           GFileInfo           *info);
 static void           file_notifier_directory_started     (TrackerFileNotifier *notifier,
                                                            GFile               *directory,
                                                            gpointer             user_data);
@@ -204,16 +290,28 @@ static void           file_notifier_directory_finished    (TrackerFileNotifier *
                                                            guint                files_found,
                                                            guint                files_ignored,
                                                            gpointer             user_data);
+static void           file_notifier_level_finished        (TrackerFileNotifier *notifier,
+                                                           GFile               *directory,
+                                                           guint                level,
+                                                           guint                directories_found,
+                                                           guint                files_found,
+                                                           gpointer             user_data);
 static void           file_notifier_finished              (TrackerFileNotifier *notifier,
                                                            gpointer             user_data);
+static void           file_notifier_hot_file              (TrackerFileNotifier *notifier,
+                                                           GFile               *file,
+                                                           gpointer             user_data);
 
 static void           item_queue_handlers_set_up          (TrackerMinerFS       *fs);
+static void           prepare_item_thread                 (gpointer              data,
+                                                           gpointer              user_data);
 
 static void           task_pool_limit_reached_notify_cb       (GObject        *object,
                                                                GParamSpec     *pspec,
                                                                gpointer        user_data);
 
 static GQuark quark_last_queue_event = 0;
+static TrackerMemPool *queue_event_pool = NULL;
 static guint signals[LAST_SIGNAL] = { 0, };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (TrackerMinerFS, tracker_miner_fs, TRACKER_TYPE_MINER)
@@ -349,6 +447,7 @@ tracker_miner_fs_class_init (TrackerMinerFSClass *klass)
 					 NULL, NULL, NULL,
 					 G_TYPE_NONE, 0);
 
+	queue_event_pool = tracker_mem_pool_new ("QueueEvent", sizeof (QueueEvent));
 	quark_last_queue_event = g_quark_from_static_string ("tracker-last-queue-event");
 }
 
@@ -364,6 +463,9 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	priv->timer = g_timer_new ();
 	priv->extraction_timer = g_timer_new ();
 
+	priv->queue_wait_metric = tracker_metrics_lookup (TRACKER_METRIC_QUEUE_WAIT);
+	priv->resource_build_metric = tracker_metrics_lookup (TRACKER_METRIC_RESOURCE_BUILD);
+
 	g_timer_stop (priv->timer);
 	g_timer_stop (priv->extraction_timer);
 
@@ -371,9 +473,14 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	priv->extraction_timer_stopped = TRUE;
 
 	priv->items = tracker_priority_queue_new ();
-	priv->items_by_file = g_hash_table_new_full (g_file_hash,
-	                                             (GEqualFunc) g_file_equal,
-	                                             g_object_unref, NULL);
+	priv->items_by_file = tracker_file_trie_new ((GDestroyNotify) g_list_free);
+	priv->urgent_tasks = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->prepare_pool = g_thread_pool_new (prepare_item_thread, NULL,
+	                                        MAX_PREPARE_THREADS, FALSE,
+	                                        NULL);
+	priv->hot_files = g_hash_table_new_full (g_file_hash,
+	                                         (GEqualFunc) g_file_equal,
+	                                         g_object_unref, NULL);
 
 	priv->roots_to_notify = g_hash_table_new_full (g_file_hash,
 	                                               (GEqualFunc) g_file_equal,
@@ -395,10 +502,19 @@ queue_event_new (TrackerMinerFSEventType  type,
 
 	g_assert (type != TRACKER_MINER_FS_EVENT_MOVED);
 
-	event = g_new0 (QueueEvent, 1);
+	event = tracker_mem_pool_alloc0 (queue_event_pool);
+	TRACKER_MEMORY_ALLOC (QUEUES, sizeof (QueueEvent));
 	event->type = type;
+	event->queued_time = g_get_monotonic_time ();
 	g_set_object (&event->file, file);
-	g_set_object (&event->info, info);
+
+	/* Queues may hold an event for every file in the index roots,
+	 * keep the infos packed unless they have unexpected attributes.
+	 */
+	if (info)
+		event->packed_info = tracker_packed_info_new (file, info);
+	if (info && !event->packed_info)
+		g_set_object (&event->info, info);
 
 	return event;
 }
@@ -410,8 +526,10 @@ queue_event_moved_new (GFile    *source,
 {
 	QueueEvent *event;
 
-	event = g_new0 (QueueEvent, 1);
+	event = tracker_mem_pool_alloc0 (queue_event_pool);
+	TRACKER_MEMORY_ALLOC (QUEUES, sizeof (QueueEvent));
 	event->type = TRACKER_MINER_FS_EVENT_MOVED;
+	event->queued_time = g_get_monotonic_time ();
 	event->is_dir = !!is_dir;
 	g_set_object (&event->dest_file, dest);
 	g_set_object (&event->file, source);
@@ -431,8 +549,19 @@ queue_event_free (QueueEvent *event)
 
 	g_clear_object (&event->dest_file);
 	g_clear_object (&event->file);
+	g_clear_pointer (&event->packed_info, tracker_packed_info_free);
 	g_clear_object (&event->info);
-	g_free (event);
+	TRACKER_MEMORY_FREE (QUEUES, sizeof (QueueEvent));
+	tracker_mem_pool_recycle (queue_event_pool, event);
+}
+
+static void
+pending_item_free (PendingItem *item)
+{
+	g_clear_object (&item->file);
+	g_clear_object (&item->source_file);
+	g_clear_object (&item->info);
+	g_slice_free (PendingItem, item);
 }
 
 static QueueCoalesceAction
@@ -496,14 +625,6 @@ queue_event_coalesce (const QueueEvent  *first,
 	return QUEUE_ACTION_NONE;
 }
 
-static gboolean
-queue_event_is_equal_or_descendant (QueueEvent *event,
-				    GFile      *prefix)
-{
-	return (g_file_equal (event->file, prefix) ||
-		g_file_has_prefix (event->file, prefix));
-}
-
 static void
 fs_finalize (GObject *object)
 {
@@ -513,6 +634,9 @@ fs_finalize (GObject *object)
 
 	g_timer_destroy (priv->timer);
 	g_timer_destroy (priv->extraction_timer);
+	g_clear_handle_id (&priv->progress_update_id, g_source_remove);
+	g_clear_pointer (&priv->status_page, tracker_status_page_free);
+	g_clear_pointer (&priv->event_recorder, tracker_event_recorder_free);
 
 	g_clear_pointer (&priv->urn_lru, tracker_lru_unref);
 
@@ -529,11 +653,18 @@ fs_finalize (GObject *object)
 		g_object_unref (priv->sparql_buffer);
 	}
 
-	g_hash_table_unref (priv->items_by_file);
+	/* Worker threads keep a reference, so every item is ready here */
+	g_thread_pool_free (priv->prepare_pool, FALSE, TRUE);
+	g_queue_foreach (&priv->pending_items, (GFunc) pending_item_free, NULL);
+	g_queue_clear (&priv->pending_items);
+
+	tracker_file_trie_free (priv->items_by_file);
 	tracker_priority_queue_foreach (priv->items,
 					(GFunc) queue_event_free,
 					NULL);
 	tracker_priority_queue_unref (priv->items);
+	g_ptr_array_unref (priv->urgent_tasks);
+	g_hash_table_unref (priv->hot_files);
 
 	if (priv->indexing_tree) {
 		g_object_unref (priv->indexing_tree);
@@ -601,9 +732,15 @@ fs_constructed (GObject *object)
 	g_signal_connect (priv->file_notifier, "directory-finished",
 	                  G_CALLBACK (file_notifier_directory_finished),
 	                  object);
+	g_signal_connect (priv->file_notifier, "level-finished",
+	                  G_CALLBACK (file_notifier_level_finished),
+	                  object);
 	g_signal_connect (priv->file_notifier, "finished",
 	                  G_CALLBACK (file_notifier_finished),
 	                  object);
+	g_signal_connect (priv->file_notifier, "hot-file",
+	                  G_CALLBACK (file_notifier_hot_file),
+	                  object);
 }
 
 static void
@@ -713,6 +850,8 @@ miner_paused (TrackerMiner *miner)
 		g_source_remove (fs->priv->item_queues_handler_id);
 		fs->priv->item_queues_handler_id = 0;
 	}
+
+	g_clear_handle_id (&fs->priv->progress_update_id, g_source_remove);
 }
 
 static void
@@ -740,6 +879,10 @@ notify_roots_finished (TrackerMinerFS *fs)
 	GHashTableIter iter;
 	gpointer key, value;
 
+	/* Items of these roots may still be taken out of the queue */
+	if (!g_queue_is_empty (&fs->priv->pending_items))
+		return;
+
 	g_hash_table_iter_init (&iter, fs->priv->roots_to_notify);
 
 	while (g_hash_table_iter_next (&iter, &key, &value)) {
@@ -762,6 +905,8 @@ log_stats (TrackerMinerFS *fs)
 {
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
+		guint lru_hits, lru_misses;
+
 		/* Only do this the first time, otherwise the results are
 		 * likely to be inaccurate. Devices can be added or removed so
 		 * we can't assume stats are correct.
@@ -779,12 +924,63 @@ log_stats (TrackerMinerFS *fs)
 			g_info ("Changes processed : %d (%d errors)",
 			        fs->priv->changes_processed,
 			        fs->priv->total_files_notified_error);
+			tracker_lru_get_stats (fs->priv->urn_lru, &lru_hits, &lru_misses);
+			g_info ("Identifier cache  : %u hits, %u misses (size %u)",
+			        lru_hits, lru_misses,
+			        tracker_lru_get_size (fs->priv->urn_lru));
 			g_info ("--------------------------------------------------\n");
 		}
 	}
 #endif
 }
 
+static void
+miner_fs_set_bulk_mode (TrackerMinerFS *fs,
+                        gboolean        bulk_mode)
+{
+	bulk_mode = !!bulk_mode;
+
+	if (fs->priv->bulk_mode == bulk_mode)
+		return;
+
+	TRACKER_NOTE (MINER_FS_EVENTS,
+	              g_message ("%s bulk indexing mode",
+	                         bulk_mode ? "Entering" : "Leaving"));
+
+	fs->priv->bulk_mode = bulk_mode;
+	tracker_sparql_buffer_set_bulk_mode (fs->priv->sparql_buffer, bulk_mode);
+}
+
+static void
+publish_status_page (TrackerMinerFS *fs)
+{
+	TrackerStatusPageData data = { 0, };
+	g_autofree gchar *status = NULL;
+	gdouble extraction_elapsed;
+
+	if (!fs->priv->status_page)
+		return;
+
+	g_object_get (fs,
+	              "status", &status,
+	              "progress", &data.progress,
+	              "remaining-time", &data.remaining_time,
+	              NULL);
+	g_strlcpy (data.status, status ? status : "", sizeof (data.status));
+
+	data.queued = tracker_priority_queue_get_length (fs->priv->items);
+	data.processed = fs->priv->changes_processed;
+	data.errors = fs->priv->total_files_notified_error;
+
+	extraction_elapsed = g_timer_elapsed (fs->priv->extraction_timer, NULL);
+	if (extraction_elapsed > 0)
+		data.rate = data.processed / extraction_elapsed;
+
+	tracker_status_page_update (fs->priv->status_page,
+	                            TRACKER_STATUS_PAGE_SECTION_FILES,
+	                            &data);
+}
+
 static void
 process_stop (TrackerMinerFS *fs)
 {
@@ -794,6 +990,10 @@ process_stop (TrackerMinerFS *fs)
 
 	g_timer_stop (fs->priv->timer);
 	g_timer_stop (fs->priv->extraction_timer);
+	g_clear_handle_id (&fs->priv->progress_update_id, g_source_remove);
+
+	/* The backlog is drained, back to low latency */
+	miner_fs_set_bulk_mode (fs, FALSE);
 
 	fs->priv->timer_stopped = TRUE;
 	fs->priv->extraction_timer_stopped = TRUE;
@@ -803,12 +1003,19 @@ process_stop (TrackerMinerFS *fs)
 	              "status", "Idle",
 	              "remaining-time", 0,
 	              NULL);
+	publish_status_page (fs);
 
 	/* Make sure we signal _ALL_ roots as finished before the
 	 * main FINISHED signal
 	 */
 	notify_roots_finished (fs);
 
+	/* Everything was crawled and processed */
+	tracker_file_notifier_clear_checkpoint (fs->priv->file_notifier);
+
+	if (fs->priv->event_recorder)
+		tracker_event_recorder_log_mark (fs->priv->event_recorder, "idle");
+
 	g_signal_emit (fs, signals[FINISHED], 0,
 	               g_timer_elapsed (fs->priv->timer, NULL),
 	               fs->priv->total_directories_found,
@@ -825,6 +1032,63 @@ process_stop (TrackerMinerFS *fs)
 	fs->priv->total_files_notified_error = 0;
 }
 
+static void
+return_urgent_tasks (TrackerMinerFS *fs,
+                     GFile          *file,
+                     const GError   *error)
+{
+	guint i = 0;
+
+	while (i < fs->priv->urgent_tasks->len) {
+		GTask *task = g_ptr_array_index (fs->priv->urgent_tasks, i);
+
+		if (!g_file_equal (g_task_get_task_data (task), file)) {
+			i++;
+			continue;
+		}
+
+		if (error)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_boolean (task, TRUE);
+
+		g_ptr_array_remove_index_fast (fs->priv->urgent_tasks, i);
+	}
+}
+
+static gboolean
+has_buffered_urgent_items (TrackerMinerFS *fs)
+{
+	guint i;
+
+	for (i = 0; i < fs->priv->urgent_tasks->len; i++) {
+		GTask *task = g_ptr_array_index (fs->priv->urgent_tasks, i);
+
+		if (tracker_task_pool_find (TRACKER_TASK_POOL (fs->priv->sparql_buffer),
+		                            g_task_get_task_data (task)))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+has_buffered_hot_items (TrackerMinerFS *fs)
+{
+	GHashTableIter iter;
+	GFile *file;
+
+	g_hash_table_iter_init (&iter, fs->priv->hot_files);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL)) {
+		if (tracker_task_pool_find (TRACKER_TASK_POOL (fs->priv->sparql_buffer),
+		                            file))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static void
 check_notifier_high_water (TrackerMinerFS *fs)
 {
@@ -834,7 +1098,7 @@ check_notifier_high_water (TrackerMinerFS *fs)
 	 * the notifier to stop a bit.
 	 */
 	high_water = (tracker_priority_queue_get_length (fs->priv->items) >
-	              2 * BUFFER_POOL_LIMIT);
+	              2 * tracker_task_pool_get_limit (TRACKER_TASK_POOL (fs->priv->sparql_buffer)));
 	tracker_file_notifier_set_high_water (fs->priv->file_notifier, high_water);
 }
 
@@ -863,21 +1127,39 @@ sparql_buffer_flush_cb (GObject      *object,
 	}
 
 	for (i = 0; i < tasks->len; i++) {
+		const GError *task_error;
+
 		task = g_ptr_array_index (tasks, i);
 		task_file = tracker_task_get_file (task);
 
-		if (error) {
+		/* If the batch failed, the files at fault may be known */
+		task_error = error ? error : tracker_sparql_task_get_error (task);
+
+		if (task_error) {
 			gchar *sparql;
 
 			sparql = tracker_sparql_task_get_sparql (task);
-			tracker_error_report (task_file, error->message, sparql);
+			tracker_error_report (task_file, task_error->message, sparql);
 			fs->priv->total_files_notified_error++;
 			g_free (sparql);
 		} else {
 			tracker_error_report_delete (task_file);
 		}
+
+		if (fs->priv->urgent_tasks->len > 0)
+			return_urgent_tasks (fs, task_file, task_error);
+
+		if (g_hash_table_remove (fs->priv->hot_files, task_file) &&
+		    !task_error && TRACKER_MINER_FS_GET_CLASS (fs)->hot_file_stored)
+			TRACKER_MINER_FS_GET_CLASS (fs)->hot_file_stored (fs, task_file);
+
+		tracker_file_notifier_file_processed (fs->priv->file_notifier,
+		                                      task_file);
 	}
 
+	/* Processed changes are on disk, move the crawl checkpoint forward */
+	tracker_file_notifier_save_checkpoint (fs->priv->file_notifier);
+
 	fs->priv->flushing = FALSE;
 
 	if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (object))) {
@@ -889,6 +1171,13 @@ sparql_buffer_flush_cb (GObject      *object,
 
 		/* Check if we've finished inserting for given prefixes ... */
 		notify_roots_finished (fs);
+	} else if (has_buffered_urgent_items (fs) ||
+	           has_buffered_hot_items (fs)) {
+		if (tracker_sparql_buffer_flush (TRACKER_SPARQL_BUFFER (object),
+		                                 "Urgent file waiting",
+		                                 sparql_buffer_flush_cb,
+		                                 fs))
+			fs->priv->flushing = TRUE;
 	}
 
 	check_notifier_high_water (fs);
@@ -906,10 +1195,12 @@ item_add_or_update (TrackerMinerFS *fs,
                     gboolean        create)
 {
 	gchar *uri;
+	gint64 start;
 
 	if (info) {
 		g_object_ref (info);
 	} else {
+		/* Normally queried in a worker thread already */
 		info = g_file_query_info (file,
 		                          fs->priv->file_attributes,
 		                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
@@ -920,6 +1211,14 @@ item_add_or_update (TrackerMinerFS *fs,
 
 	uri = g_file_get_uri (file);
 
+	/* The notifier already queried the info of the file, use it to
+	 * fill in the identifier cache, so process_file() does not need
+	 * to query it again.
+	 */
+	miner_fs_cache_identifier (fs, file, info);
+
+	start = g_get_monotonic_time ();
+
 	if (!attributes_update) {
 		TRACKER_NOTE (MINER_FS_EVENTS, g_message ("Processing file '%s'...", uri));
 		TRACKER_MINER_FS_GET_CLASS (fs)->process_file (fs, file, info,
@@ -931,6 +1230,9 @@ item_add_or_update (TrackerMinerFS *fs,
 		                                                          fs->priv->sparql_buffer);
 	}
 
+	tracker_metric_record (fs->priv->resource_build_metric,
+	                       g_get_monotonic_time () - start);
+
 	g_free (uri);
 	g_object_unref (info);
 
@@ -1014,32 +1316,68 @@ item_move (TrackerMinerFS *fs,
 	return TRUE;
 }
 
-static gboolean
-maybe_remove_file_event_node (TrackerMinerFS *fs,
-                              QueueEvent     *event)
+static QueueEvent *
+queue_index_lookup (TrackerMinerFS *fs,
+                    GFile          *file)
 {
-	QueueEvent *item_event;
+	GList *events;
 
-	item_event = g_hash_table_lookup (fs->priv->items_by_file, event->file);
+	events = tracker_file_trie_lookup (fs->priv->items_by_file, file);
 
-	if (item_event == event) {
-		g_hash_table_remove (fs->priv->items_by_file, event->file);
-		return TRUE;
-	}
+	return events ? events->data : NULL;
+}
 
-	return FALSE;
+static void
+queue_index_add (TrackerMinerFS *fs,
+                 QueueEvent     *event)
+{
+	GList *events;
+
+	events = tracker_file_trie_lookup (fs->priv->items_by_file, event->file);
+	events = g_list_prepend (events, event);
+	tracker_file_trie_insert (fs->priv->items_by_file, event->file, events);
 }
 
-static gboolean
-remove_items_by_file_foreach (gpointer key,
-                              gpointer value,
-                              gpointer user_data)
+static void
+queue_index_remove (TrackerMinerFS *fs,
+                    QueueEvent     *event)
+{
+	GList *events;
+
+	events = tracker_file_trie_lookup (fs->priv->items_by_file, event->file);
+	events = g_list_remove (events, event);
+
+	if (events)
+		tracker_file_trie_insert (fs->priv->items_by_file, event->file, events);
+	else
+		tracker_file_trie_remove (fs->priv->items_by_file, event->file);
+}
+
+static void
+remove_descendant_events (TrackerMinerFS *fs,
+                          GFile          *prefix)
 {
-	GFile *file = key;
-	GFile *prefix = user_data;
+	GList *files, *l, *e;
+
+	/* The index has every queued event, so only the events
+	 * below @prefix are looked at.
+	 */
+	files = tracker_file_trie_steal_descendants (fs->priv->items_by_file,
+	                                             prefix);
+
+	for (l = files; l; l = l->next) {
+		for (e = l->data; e; e = e->next) {
+			QueueEvent *event = e->data;
+
+			tracker_priority_queue_remove_node (fs->priv->items,
+			                                    event->queue_node);
+			queue_event_free (event);
+		}
+
+		g_list_free (l->data);
+	}
 
-	return (g_file_equal (file, prefix) ||
-	        g_file_has_prefix (file, prefix));
+	g_list_free (files);
 }
 
 static void
@@ -1059,6 +1397,9 @@ item_queue_get_next_file (TrackerMinerFS           *fs,
 	event = tracker_priority_queue_pop (fs->priv->items, NULL);
 
 	if (event) {
+		tracker_metric_record (fs->priv->queue_wait_metric,
+		                       g_get_monotonic_time () - event->queued_time);
+
 		if (event->type == TRACKER_MINER_FS_EVENT_MOVED) {
 			g_set_object (file, event->dest_file);
 			g_set_object (source_file, event->file);
@@ -1069,9 +1410,16 @@ item_queue_get_next_file (TrackerMinerFS           *fs,
 		*type = event->type;
 		*attributes_update = event->attributes_update;
 		*is_dir = event->is_dir;
-		g_set_object (info, event->info);
 
-		maybe_remove_file_event_node (fs, event);
+		if (event->packed_info) {
+			g_clear_object (info);
+			*info = tracker_packed_info_unpack (event->packed_info,
+			                                    event->file);
+		} else {
+			g_set_object (info, event->info);
+		}
+
+		queue_index_remove (fs, event);
 		queue_event_free (event);
 	}
 }
@@ -1107,170 +1455,362 @@ item_queue_get_progress (TrackerMinerFS *fs,
 	return (gdouble) (items_total - items_to_process) / items_total;
 }
 
-static gboolean
-miner_handle_next_item (TrackerMinerFS *fs)
+static void
+prepare_item_thread (gpointer data,
+                     gpointer user_data)
 {
-	GFile *file = NULL;
-	GFile *source_file = NULL;
-	gint64 time_now;
-	static gint64 time_last = 0;
-	gboolean keep_processing = TRUE;
-	gboolean attributes_update = FALSE;
-	gboolean is_dir = FALSE;
-	TrackerMinerFSEventType type;
-	GFileInfo *info = NULL;
-
-	item_queue_get_next_file (fs, &file, &source_file, &info, &type,
-	                          &attributes_update, &is_dir);
+	GTask *task = data;
+	TrackerMinerFS *fs = g_task_get_source_object (task);
+	PendingItem *item = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	GFileInfo *info;
 
-	if (fs->priv->timer_stopped) {
-		g_timer_start (fs->priv->timer);
-		fs->priv->timer_stopped = FALSE;
+	/* Only blocking I/O happens here, everything touching miner
+	 * state is left to the main thread.
+	 */
+	if (item->info) {
+		info = g_object_ref (item->info);
+	} else {
+		info = g_file_query_info (item->file,
+		                          fs->priv->file_attributes,
+		                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                          cancellable, NULL);
 	}
 
-	if (file == NULL && !fs->priv->extraction_timer_stopped) {
-		g_timer_stop (fs->priv->extraction_timer);
-		fs->priv->extraction_timer_stopped = TRUE;
-	} else if (file != NULL && fs->priv->extraction_timer_stopped) {
-		g_timer_continue (fs->priv->extraction_timer);
-		fs->priv->extraction_timer_stopped = FALSE;
+	if (info && TRACKER_MINER_FS_GET_CLASS (fs)->prepare_file) {
+		GFileInfo *prepared;
+
+		prepared = TRACKER_MINER_FS_GET_CLASS (fs)->prepare_file (fs,
+		                                                          item->file,
+		                                                          info,
+		                                                          cancellable);
+		g_object_unref (info);
+		info = prepared;
 	}
 
-	/* Update progress, but don't spam it. */
-	time_now = g_get_monotonic_time ();
+	g_task_return_pointer (task, info, g_object_unref);
+	g_object_unref (task);
+}
 
-	if ((time_now - time_last) >= 1000000) {
-		guint items_processed, items_remaining;
-		gdouble progress_now;
-		static gdouble progress_last = 0.0;
-		static gint info_last = 0;
-		gdouble seconds_elapsed, extraction_elapsed;
+static void
+prepare_item_cb (GObject      *object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	TrackerMinerFS *fs = TRACKER_MINER_FS (object);
+	PendingItem *item = user_data;
 
-		time_last = time_now;
+	g_clear_object (&item->info);
+	item->info = g_task_propagate_pointer (G_TASK (result), NULL);
+	item->ready = TRUE;
 
-		/* Update progress? */
-		progress_now = item_queue_get_progress (fs,
-		                                        &items_processed,
-		                                        &items_remaining);
-		seconds_elapsed = g_timer_elapsed (fs->priv->timer, NULL);
-		extraction_elapsed = g_timer_elapsed (fs->priv->extraction_timer, NULL);
+	item_queue_handlers_set_up (fs);
+}
 
-		if (!tracker_file_notifier_is_active (fs->priv->file_notifier)) {
-			gchar *status;
-			gint remaining_time;
+static void
+pending_item_prepare (TrackerMinerFS *fs,
+                      PendingItem    *item)
+{
+	GTask *task;
 
-			g_object_get (fs, "status", &status, NULL);
+	item->prepared = TRUE;
 
-			/* Compute remaining time */
-			remaining_time = (gint)tracker_seconds_estimate (extraction_elapsed,
-			                                                 items_processed,
-			                                                 items_remaining);
+	task = g_task_new (fs, NULL, prepare_item_cb, item);
+	g_task_set_task_data (task, item, NULL);
+	g_thread_pool_push (fs->priv->prepare_pool, task, NULL);
+}
 
-			/* CLAMP progress so it doesn't go back below
-			 * 2% (which we use for crawling)
-			 */
-			if (g_strcmp0 (status, "Processing…") != 0) {
-				/* Don't spam this */
-				g_object_set (fs,
-				              "status", "Processing…",
-				              "progress", CLAMP (progress_now, 0.02, 1.00),
-				              "remaining-time", remaining_time,
-				              NULL);
-			} else {
-				g_object_set (fs,
-				              "progress", CLAMP (progress_now, 0.02, 1.00),
-				              "remaining-time", remaining_time,
-				              NULL);
-			}
+static gboolean
+pending_item_process (TrackerMinerFS *fs,
+                      PendingItem    *item)
+{
+	switch (item->type) {
+	case TRACKER_MINER_FS_EVENT_MOVED:
+		return item_move (fs, item->file, item->source_file, item->is_dir);
+	case TRACKER_MINER_FS_EVENT_DELETED:
+		return item_remove (fs, item->file, item->is_dir, FALSE);
+	case TRACKER_MINER_FS_EVENT_CREATED:
+	case TRACKER_MINER_FS_EVENT_UPDATED:
+		/* The file went away before it could be looked at */
+		if (item->prepared && !item->info)
+			return TRUE;
 
-			g_free (status);
-		}
+		return item_add_or_update (fs, item->file, item->info,
+		                           item->attributes_update,
+		                           item->type == TRACKER_MINER_FS_EVENT_CREATED);
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+/* Urgent files are stored right away, instead of waiting for
+ * the batch to fill up.
+ */
+static void
+flush_urgent_item (TrackerMinerFS *fs,
+                   GFile          *file)
+{
+	guint i;
 
-		if (++info_last >= 5 &&
-		    (gint) (progress_last * 100) != (gint) (progress_now * 100)) {
-			gchar *str1, *str2;
+	for (i = 0; i < fs->priv->urgent_tasks->len; i++) {
+		GTask *task = g_ptr_array_index (fs->priv->urgent_tasks, i);
 
-			info_last = 0;
-			progress_last = progress_now;
+		if (g_file_equal (g_task_get_task_data (task), file))
+			break;
+	}
 
-			/* Log estimated remaining time */
-			str1 = tracker_seconds_estimate_to_string (extraction_elapsed,
-			                                           TRUE,
-			                                           items_processed,
-			                                           items_remaining);
-			str2 = tracker_seconds_to_string (seconds_elapsed, TRUE);
+	if (i == fs->priv->urgent_tasks->len)
+		return;
 
-			g_info ("Processed %u/%u, estimated %s left, %s elapsed",
-			        items_processed,
-			        items_processed + items_remaining,
-			        str1,
-			        str2);
+	if (!tracker_task_pool_find (TRACKER_TASK_POOL (fs->priv->sparql_buffer), file)) {
+		g_autoptr (GError) error = NULL;
 
-			g_free (str2);
-			g_free (str1);
-		}
+		/* The file went away, or it is not eligible */
+		error = g_error_new (G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+		                     "File could not be indexed");
+		return_urgent_tasks (fs, file, error);
+		return;
 	}
 
-	if (file == NULL) {
-		if (!tracker_file_notifier_is_active (fs->priv->file_notifier)) {
-			if (!fs->priv->flushing &&
-			    tracker_task_pool_get_size (TRACKER_TASK_POOL (fs->priv->sparql_buffer)) == 0) {
-				/* Print stats and signal finished */
-				process_stop (fs);
-			} else {
-				/* Flush any possible pending update here */
-				if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
-								 "Queue handlers NONE",
-								 sparql_buffer_flush_cb,
-								 fs))
-					fs->priv->flushing = TRUE;
+	/* If a batch is executing, sparql_buffer_flush_cb() flushes this one */
+	if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
+	                                 "Urgent file",
+	                                 sparql_buffer_flush_cb,
+	                                 fs))
+		fs->priv->flushing = TRUE;
+}
 
-				/* Check if we've finished inserting for given prefixes ... */
-				notify_roots_finished (fs);
+/* Same for files changed by the user, without anyone to notify */
+static void
+flush_hot_item (TrackerMinerFS *fs,
+                GFile          *file)
+{
+	if (!g_hash_table_contains (fs->priv->hot_files, file))
+		return;
+
+	if (!tracker_task_pool_find (TRACKER_TASK_POOL (fs->priv->sparql_buffer), file)) {
+		g_hash_table_remove (fs->priv->hot_files, file);
+		return;
+	}
+
+	if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
+	                                 "Hot file",
+	                                 sparql_buffer_flush_cb,
+	                                 fs))
+		fs->priv->flushing = TRUE;
+}
+
+/* Processes the ready items at the head of the pending queue, so
+ * changes get to the SPARQL buffer in the order they were queued.
+ */
+static gboolean
+process_pending_items (TrackerMinerFS *fs)
+{
+	PendingItem *item;
+	gboolean keep_processing = TRUE;
+
+	while ((item = g_queue_peek_head (&fs->priv->pending_items)) != NULL &&
+	       item->ready) {
+		g_queue_pop_head (&fs->priv->pending_items);
+		keep_processing = pending_item_process (fs, item);
+
+		if (fs->priv->urgent_tasks->len > 0)
+			flush_urgent_item (fs, item->file);
+		if (g_hash_table_size (fs->priv->hot_files) > 0)
+			flush_hot_item (fs, item->file);
+
+		pending_item_free (item);
+
+		if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
+			if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
+			                                 "SPARQL buffer limit reached",
+			                                 sparql_buffer_flush_cb,
+			                                 fs)) {
+				fs->priv->flushing = TRUE;
+			} else {
+				/* If we cannot flush, both the executing batch and
+				 * the one being built are full, wait for the pending
+				 * operations to finish. sparql_buffer_flush_cb() will
+				 * flush this one and resume processing.
+				 */
+				keep_processing = FALSE;
 			}
+
+			/* Check if we've finished inserting for given prefixes ... */
+			notify_roots_finished (fs);
 		}
 
-		/* No more files left to process */
-		return FALSE;
+		if (!keep_processing)
+			break;
 	}
 
-	fs->priv->changes_processed++;
+	return keep_processing;
+}
 
-	/* Handle queues */
-	switch (type) {
-	case TRACKER_MINER_FS_EVENT_MOVED:
-		keep_processing = item_move (fs, file, source_file, is_dir);
-		break;
-	case TRACKER_MINER_FS_EVENT_DELETED:
-		keep_processing = item_remove (fs, file, is_dir, FALSE);
-		break;
-	case TRACKER_MINER_FS_EVENT_CREATED:
-		keep_processing = item_add_or_update (fs, file, info, FALSE, TRUE);
-		break;
-	case TRACKER_MINER_FS_EVENT_UPDATED:
-		keep_processing = item_add_or_update (fs, file, info, attributes_update, FALSE);
-		break;
-	default:
-		g_assert_not_reached ();
-	}
+static gboolean
+update_progress_cb (gpointer user_data)
+{
+	TrackerMinerFS *fs = user_data;
+	guint items_processed, items_remaining;
+	gdouble progress_now;
+	gdouble seconds_elapsed, extraction_elapsed;
 
-	if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
-		if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
-						 "SPARQL buffer limit reached",
-						 sparql_buffer_flush_cb,
-						 fs)) {
-			fs->priv->flushing = TRUE;
+	progress_now = item_queue_get_progress (fs,
+	                                        &items_processed,
+	                                        &items_remaining);
+	seconds_elapsed = g_timer_elapsed (fs->priv->timer, NULL);
+	extraction_elapsed = g_timer_elapsed (fs->priv->extraction_timer, NULL);
+
+	if (!tracker_file_notifier_is_active (fs->priv->file_notifier)) {
+		gchar *status;
+		gint remaining_time;
+
+		g_object_get (fs, "status", &status, NULL);
+
+		/* Compute remaining time */
+		remaining_time = (gint)tracker_seconds_estimate (extraction_elapsed,
+		                                                 items_processed,
+		                                                 items_remaining);
+
+		/* CLAMP progress so it doesn't go back below
+		 * 2% (which we use for crawling)
+		 */
+		if (g_strcmp0 (status, "Processing…") != 0) {
+			/* Don't spam this */
+			g_object_set (fs,
+			              "status", "Processing…",
+			              "progress", CLAMP (progress_now, 0.02, 1.00),
+			              "remaining-time", remaining_time,
+			              NULL);
 		} else {
-			/* If we cannot flush, wait for the pending operations
-			 * to finish.
-			 */
-			keep_processing = FALSE;
+			g_object_set (fs,
+			              "progress", CLAMP (progress_now, 0.02, 1.00),
+			              "remaining-time", remaining_time,
+			              NULL);
 		}
 
-		/* Check if we've finished inserting for given prefixes ... */
-		notify_roots_finished (fs);
+		g_free (status);
+	}
+
+	publish_status_page (fs);
+
+	if (++fs->priv->n_progress_updates >= 5 &&
+	    (gint) (fs->priv->progress_logged * 100) != (gint) (progress_now * 100)) {
+		gchar *str1, *str2;
+
+		fs->priv->n_progress_updates = 0;
+		fs->priv->progress_logged = progress_now;
+
+		/* Log estimated remaining time */
+		str1 = tracker_seconds_estimate_to_string (extraction_elapsed,
+		                                           TRUE,
+		                                           items_processed,
+		                                           items_remaining);
+		str2 = tracker_seconds_to_string (seconds_elapsed, TRUE);
+
+		g_info ("Processed %u/%u, estimated %s left, %s elapsed",
+		        items_processed,
+		        items_processed + items_remaining,
+		        str1,
+		        str2);
+
+		g_free (str2);
+		g_free (str1);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+miner_handle_next_item (TrackerMinerFS *fs)
+{
+	GFile *file = NULL;
+	GFile *source_file = NULL;
+	gboolean keep_processing = TRUE;
+	gboolean attributes_update = FALSE;
+	gboolean is_dir = FALSE;
+	TrackerMinerFSEventType type;
+	GFileInfo *info = NULL;
+	PendingItem *item;
+
+	if (!process_pending_items (fs))
+		return FALSE;
+
+	/* Wait for the oldest items to be ready, prepare_item_cb()
+	 * resumes processing.
+	 */
+	if (g_queue_get_length (&fs->priv->pending_items) >= MAX_PENDING_ITEMS)
+		return FALSE;
+
+	item_queue_get_next_file (fs, &file, &source_file, &info, &type,
+	                          &attributes_update, &is_dir);
+
+	if (fs->priv->timer_stopped) {
+		g_timer_start (fs->priv->timer);
+		fs->priv->timer_stopped = FALSE;
+	}
+
+	if (file == NULL && !fs->priv->extraction_timer_stopped) {
+		g_timer_stop (fs->priv->extraction_timer);
+		fs->priv->extraction_timer_stopped = TRUE;
+	} else if (file != NULL && fs->priv->extraction_timer_stopped) {
+		g_timer_continue (fs->priv->extraction_timer);
+		fs->priv->extraction_timer_stopped = FALSE;
+	}
+
+	/* Progress is updated periodically while there are items */
+	if (fs->priv->progress_update_id == 0) {
+		fs->priv->progress_update_id =
+			g_timeout_add_seconds (1, update_progress_cb, fs);
+	}
+
+	if (file == NULL) {
+		if (!tracker_file_notifier_is_active (fs->priv->file_notifier)) {
+			if (!fs->priv->flushing &&
+			    g_queue_is_empty (&fs->priv->pending_items) &&
+			    tracker_task_pool_get_size (TRACKER_TASK_POOL (fs->priv->sparql_buffer)) == 0) {
+				/* Print stats and signal finished */
+				process_stop (fs);
+			} else {
+				/* Flush any possible pending update here */
+				if (tracker_sparql_buffer_flush (fs->priv->sparql_buffer,
+								 "Queue handlers NONE",
+								 sparql_buffer_flush_cb,
+								 fs))
+					fs->priv->flushing = TRUE;
+
+				/* Check if we've finished inserting for given prefixes ... */
+				notify_roots_finished (fs);
+			}
+		}
+
+		/* No more files left to process */
+		return FALSE;
 	}
 
+	fs->priv->changes_processed++;
+
+	item = g_slice_new0 (PendingItem);
+	item->file = g_steal_pointer (&file);
+	item->source_file = g_steal_pointer (&source_file);
+	item->info = g_steal_pointer (&info);
+	item->type = type;
+	item->attributes_update = !!attributes_update;
+	item->is_dir = !!is_dir;
+	g_queue_push_tail (&fs->priv->pending_items, item);
+
+	/* Looking up file info and content types may block on I/O,
+	 * keep that off the main loop.
+	 */
+	if ((type == TRACKER_MINER_FS_EVENT_CREATED ||
+	     type == TRACKER_MINER_FS_EVENT_UPDATED) &&
+	    (!item->info || TRACKER_MINER_FS_GET_CLASS (fs)->prepare_file))
+		pending_item_prepare (fs, item);
+	else
+		item->ready = TRUE;
+
+	keep_processing = process_pending_items (fs);
+
 	item_queue_handlers_set_up (fs);
 
 	g_clear_object (&file);
@@ -1284,14 +1824,15 @@ static gboolean
 item_queue_handlers_cb (gpointer user_data)
 {
 	TrackerMinerFS *fs = user_data;
-	gboolean retval = FALSE;
-	gint i;
+	gboolean retval;
+	gint64 deadline;
+
+	deadline = g_get_monotonic_time () +
+		(fs->priv->bulk_mode ? BULK_ITEM_SLICE_USEC : ITEM_SLICE_USEC);
 
-	for (i = 0; i < MAX_SIMULTANEOUS_ITEMS; i++) {
+	do {
 		retval = miner_handle_next_item (fs);
-		if (retval == FALSE)
-			break;
-	}
+	} while (retval && g_get_monotonic_time () < deadline);
 
 	if (retval == FALSE) {
 		fs->priv->item_queues_handler_id = 0;
@@ -1366,9 +1907,19 @@ miner_fs_get_queue_priority (TrackerMinerFS *fs,
                              GFile          *file)
 {
 	TrackerDirectoryFlags flags;
+	GFile *root;
 
-	tracker_indexing_tree_get_root (fs->priv->indexing_tree,
-	                                file, &flags);
+	root = tracker_indexing_tree_get_root (fs->priv->indexing_tree,
+	                                       file, &flags);
+
+	/* Past the first levels of progressive roots, files go one
+	 * priority lower so the first levels of every root get done.
+	 */
+	if ((flags & TRACKER_DIRECTORY_FLAG_PROGRESSIVE) != 0 && root &&
+	    tracker_file_get_depth (root, file) > PROGRESSIVE_CRAWL_LEVELS) {
+		return (flags & TRACKER_DIRECTORY_FLAG_PRIORITY) ?
+		        G_PRIORITY_DEFAULT : G_PRIORITY_LOW;
+	}
 
 	return (flags & TRACKER_DIRECTORY_FLAG_PRIORITY) ?
 	        G_PRIORITY_HIGH : G_PRIORITY_DEFAULT;
@@ -1400,6 +1951,19 @@ assign_root_node (TrackerMinerFS *fs,
 	g_queue_push_head_link (queue, event->root_node);
 }
 
+/* Events of different roots take turns within a priority, so a
+ * long crawl does not hold back updates elsewhere. Events keep
+ * their order within a root, directories are still processed
+ * before their contents.
+ */
+static gconstpointer
+queue_event_get_flow (QueueEvent *event)
+{
+	return event->root_node ? event->root_node->data : NULL;
+}
+
+TRACKER_TRACE_DEFINE (queue_event);
+
 static void
 miner_fs_queue_event (TrackerMinerFS *fs,
 		      QueueEvent     *event,
@@ -1407,18 +1971,28 @@ miner_fs_queue_event (TrackerMinerFS *fs,
 {
 	QueueEvent *old = NULL;
 
+	if (TRACKER_TRACE_ENABLED (queue_event)) {
+		TRACKER_TRACE (queue_event,
+		               g_file_peek_path (event->file),
+		               event->type,
+		               priority);
+	}
+
+	if (fs->priv->event_recorder) {
+		tracker_event_recorder_log_event (fs->priv->event_recorder,
+		                                  event->attributes_update ?
+		                                  "attributes" : event_names[event->type],
+		                                  event->file,
+		                                  event->dest_file,
+		                                  event->is_dir);
+	}
+
 	if (event->type == TRACKER_MINER_FS_EVENT_MOVED) {
 		/* Remove all children of the dest location from being processed. */
-		g_hash_table_foreach_remove (fs->priv->items_by_file,
-		                             remove_items_by_file_foreach,
-		                             event->dest_file);
-		tracker_priority_queue_foreach_remove (fs->priv->items,
-						       (GEqualFunc) queue_event_is_equal_or_descendant,
-						       event->dest_file,
-						       (GDestroyNotify) queue_event_free);
+		remove_descendant_events (fs, event->dest_file);
 	}
 
-	old = g_hash_table_lookup (fs->priv->items_by_file, event->file);
+	old = queue_index_lookup (fs, event->file);
 
 	if (old) {
 		QueueCoalesceAction action;
@@ -1427,7 +2001,7 @@ miner_fs_queue_event (TrackerMinerFS *fs,
 		action = queue_event_coalesce (old, event, &replacement);
 
 		if (action & QUEUE_ACTION_DELETE_FIRST) {
-			g_hash_table_remove (fs->priv->items_by_file, old->file);
+			queue_index_remove (fs, old);
 			tracker_priority_queue_remove_node (fs->priv->items,
 							    old->queue_node);
 			queue_event_free (old);
@@ -1444,32 +2018,78 @@ miner_fs_queue_event (TrackerMinerFS *fs,
 
 	if (event) {
 		if (event->is_dir &&
-		    event->type == TRACKER_MINER_FS_EVENT_DELETED &&
-		    g_hash_table_size (fs->priv->items_by_file) < BIG_QUEUE_THRESHOLD) {
-			/* Attempt to optimize by removing any children
-			 * of this directory from being processed.
+		    event->type == TRACKER_MINER_FS_EVENT_DELETED) {
+			/* Remove any children of this directory
+			 * from being processed.
 			 */
-			g_hash_table_foreach_remove (fs->priv->items_by_file,
-			                             remove_items_by_file_foreach,
-			                             event->file);
-			tracker_priority_queue_foreach_remove (fs->priv->items,
-							       (GEqualFunc) queue_event_is_equal_or_descendant,
-							       event->file,
-							       (GDestroyNotify) queue_event_free);
+			remove_descendant_events (fs, event->file);
 		}
 
 		trace_eq_event (event);
 
 		assign_root_node (fs, event);
+		event->priority = priority;
 		event->queue_node =
-			tracker_priority_queue_add (fs->priv->items, event, priority);
-		g_hash_table_replace (fs->priv->items_by_file,
-		                      g_object_ref (event->file), event);
+			tracker_priority_queue_add_full (fs->priv->items, event, priority,
+			                                 queue_event_get_flow (event));
+		queue_index_add (fs, event);
 		item_queue_handlers_set_up (fs);
 		check_notifier_high_water (fs);
 	}
 }
 
+/* Moves the events queued for @file ahead to @priority, returns
+ * %FALSE if there are none.
+ */
+static gboolean
+miner_fs_raise_events (TrackerMinerFS *fs,
+                       GFile          *file,
+                       gint            priority)
+{
+	GList *events, *l;
+
+	events = tracker_file_trie_lookup (fs->priv->items_by_file, file);
+
+	/* Events are listed newest first, keep their order */
+	for (l = g_list_last (events); l; l = l->prev) {
+		QueueEvent *event = l->data;
+
+		if (event->priority <= priority)
+			continue;
+
+		tracker_priority_queue_remove_node (fs->priv->items,
+		                                    event->queue_node);
+		event->priority = priority;
+		event->queue_node =
+			tracker_priority_queue_add_full (fs->priv->items, event,
+			                                 priority,
+			                                 queue_event_get_flow (event));
+	}
+
+	return events != NULL;
+}
+
+/* Queues @event, ahead of crawled files if @hot_file is the file
+ * being changed by the user.
+ */
+static void
+miner_fs_queue_monitored_event (TrackerMinerFS *fs,
+                                QueueEvent     *event,
+                                GFile          *hot_file)
+{
+	GFile *file = event->file;
+
+	if (!g_hash_table_contains (fs->priv->hot_files, hot_file)) {
+		miner_fs_queue_event (fs, event,
+		                      miner_fs_get_queue_priority (fs, file));
+		return;
+	}
+
+	miner_fs_queue_event (fs, event, HOT_PRIORITY);
+	/* Earlier events may have been kept instead of this one */
+	miner_fs_raise_events (fs, file, HOT_PRIORITY);
+}
+
 static void
 file_notifier_file_created (TrackerFileNotifier  *notifier,
                             GFile                *file,
@@ -1480,7 +2100,7 @@ file_notifier_file_created (TrackerFileNotifier  *notifier,
 	QueueEvent *event;
 
 	event = queue_event_new (TRACKER_MINER_FS_EVENT_CREATED, file, info);
-	miner_fs_queue_event (fs, event, miner_fs_get_queue_priority (fs, file));
+	miner_fs_queue_monitored_event (fs, event, file);
 }
 
 static void
@@ -1492,6 +2112,8 @@ file_notifier_file_deleted (TrackerFileNotifier  *notifier,
 	TrackerMinerFS *fs = user_data;
 	QueueEvent *event;
 
+	g_hash_table_remove (fs->priv->hot_files, file);
+
 	event = queue_event_new (TRACKER_MINER_FS_EVENT_DELETED, file, NULL);
 	event->is_dir = !!is_dir;
 	miner_fs_queue_event (fs, event, miner_fs_get_queue_priority (fs, file));
@@ -1509,7 +2131,7 @@ file_notifier_file_updated (TrackerFileNotifier  *notifier,
 
 	event = queue_event_new (TRACKER_MINER_FS_EVENT_UPDATED, file, info);
 	event->attributes_update = attributes_only;
-	miner_fs_queue_event (fs, event, miner_fs_get_queue_priority (fs, file));
+	miner_fs_queue_monitored_event (fs, event, file);
 }
 
 static void
@@ -1523,7 +2145,17 @@ file_notifier_file_moved (TrackerFileNotifier *notifier,
 	QueueEvent *event;
 
 	event = queue_event_moved_new (source, dest, is_dir);
-	miner_fs_queue_event (fs, event, miner_fs_get_queue_priority (fs, source));
+	miner_fs_queue_monitored_event (fs, event, dest);
+}
+
+static void
+file_notifier_hot_file (TrackerFileNotifier *notifier,
+                        GFile               *file,
+                        gpointer             user_data)
+{
+	TrackerMinerFS *fs = user_data;
+
+	g_hash_table_add (fs->priv->hot_files, g_object_ref (file));
 }
 
 static void
@@ -1535,6 +2167,12 @@ file_notifier_directory_started (TrackerFileNotifier *notifier,
 	TrackerDirectoryFlags flags;
 	gchar *str, *uri;
 
+	/* Everything in a root that is new to the store gets created,
+	 * there is no point in keeping latency low until that is done.
+	 */
+	if (tracker_file_notifier_is_indexing_from_scratch (notifier))
+		miner_fs_set_bulk_mode (fs, TRUE);
+
 	uri = g_file_get_uri (directory);
 	tracker_indexing_tree_get_root (fs->priv->indexing_tree,
 					directory, &flags);
@@ -1594,6 +2232,28 @@ file_notifier_directory_finished (TrackerFileNotifier *notifier,
 	}
 }
 
+static void
+file_notifier_level_finished (TrackerFileNotifier *notifier,
+                              GFile               *directory,
+                              guint                level,
+                              guint                directories_found,
+                              guint                files_found,
+                              gpointer             user_data)
+{
+	TrackerMinerFS *fs = user_data;
+	g_autofree gchar *str = NULL, *uri = NULL;
+
+	uri = g_file_get_uri (directory);
+	str = g_strdup_printf ("Crawled directory '%s' down to level %u, "
+	                       "%u directories and %u files found",
+	                       uri, level,
+	                       directories_found, files_found);
+
+	g_object_set (fs,
+	              "status", str,
+	              NULL);
+}
+
 static void
 file_notifier_finished (TrackerFileNotifier *notifier,
                         gpointer             user_data)
@@ -1609,7 +2269,6 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
                                  gpointer             user_data)
 {
 	TrackerMinerFS *fs = user_data;
-	TrackerMinerFSPrivate *priv = fs->priv;
 	GTimer *timer = g_timer_new ();
 
 	TRACKER_NOTE (MINER_FS_EVENTS, g_message ("  Cancelled processing pool tasks at %f\n", g_timer_elapsed (timer, NULL)));
@@ -1617,13 +2276,7 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
 	/* Remove anything contained in the removed directory
 	 * from all relevant processing queues.
 	 */
-	g_hash_table_foreach_remove (fs->priv->items_by_file,
-	                             remove_items_by_file_foreach,
-	                             directory);
-	tracker_priority_queue_foreach_remove (priv->items,
-					       (GEqualFunc) queue_event_is_equal_or_descendant,
-					       directory,
-					       (GDestroyNotify) queue_event_free);
+	remove_descendant_events (fs, directory);
 
 	TRACKER_NOTE (MINER_FS_EVENTS, g_message ("  Removed files at %f\n", g_timer_elapsed (timer, NULL)));
 	g_timer_destroy (timer);
@@ -1686,11 +2339,46 @@ tracker_miner_fs_get_throttle (TrackerMinerFS *fs)
 	return fs->priv->throttle;
 }
 
+static const gchar *
+miner_fs_add_identifier (TrackerMinerFS *fs,
+                         GFile          *file,
+                         GFileInfo      *info)
+{
+	gchar *str;
+
+	if (!tracker_indexing_tree_file_is_indexable (fs->priv->indexing_tree, file, info))
+		return NULL;
+
+	str = TRACKER_MINER_FS_GET_CLASS (fs)->get_content_identifier (fs, file, info);
+	tracker_lru_add (fs->priv->urn_lru, g_object_ref (file), str);
+
+	return str;
+}
+
+static void
+miner_fs_cache_identifier (TrackerMinerFS *fs,
+                           GFile          *file,
+                           GFileInfo      *info)
+{
+	/* Identifiers are based on the symlink target, while the
+	 * notifier does not follow symlinks.
+	 */
+	if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE) ||
+	    !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM) ||
+	    g_file_info_get_file_type (info) == G_FILE_TYPE_SYMBOLIC_LINK)
+		return;
+
+	if (tracker_lru_find (fs->priv->urn_lru, file, NULL))
+		return;
+
+	miner_fs_add_identifier (fs, file, info);
+}
+
 const gchar *
 tracker_miner_fs_get_identifier (TrackerMinerFS *fs,
 				 GFile          *file)
 {
-	GFileInfo *info;
+	g_autoptr (GFileInfo) info = NULL;
 	gchar *str;
 
 	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), NULL);
@@ -1710,16 +2398,209 @@ tracker_miner_fs_get_identifier (TrackerMinerFS *fs,
 	if (!info)
 		return NULL;
 
-	if (!tracker_indexing_tree_file_is_indexable (fs->priv->indexing_tree, file, info)) {
-		g_object_unref (info);
-		return NULL;
-	}
+	return miner_fs_add_identifier (fs, file, info);
+}
 
-	str = TRACKER_MINER_FS_GET_CLASS (fs)->get_content_identifier (fs, file, info);
-	tracker_lru_add (fs->priv->urn_lru, g_object_ref (file), str);
-	g_object_unref (info);
+/**
+ * tracker_miner_fs_set_crawl_limits:
+ * @fs: a #TrackerMinerFS
+ * @max_roots: maximum number of indexed folders crawled at once
+ * @max_directories: maximum number of directories enumerated at once
+ *   within an indexed folder
+ *
+ * Sets how much filesystem crawling happens in parallel. Indexed
+ * folders are only crawled in parallel if they are on different
+ * devices.
+ **/
+void
+tracker_miner_fs_set_crawl_limits (TrackerMinerFS *fs,
+                                   guint           max_roots,
+                                   guint           max_directories)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
 
-	return str;
+	tracker_file_notifier_set_crawl_limits (fs->priv->file_notifier,
+	                                        max_roots, max_directories);
+}
+
+/**
+ * tracker_miner_fs_set_max_monitors:
+ * @fs: a #TrackerMinerFS
+ * @max_monitors: maximum number of directories watched individually,
+ *   or 0 for the system limit
+ *
+ * Caps the number of directory monitors. Further directories are
+ * checked periodically for changes instead.
+ **/
+void
+tracker_miner_fs_set_max_monitors (TrackerMinerFS *fs,
+                                   guint           max_monitors)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+
+	tracker_file_notifier_set_max_monitors (fs->priv->file_notifier,
+	                                        max_monitors);
+}
+
+/**
+ * tracker_miner_fs_set_update_delays:
+ * @fs: a #TrackerMinerFS
+ * @min_delay: milliseconds that updates of a file changing again
+ *   shortly after its last update are held back, or 0 to never
+ *   hold them back
+ * @max_delay: maximum milliseconds that updates are held back
+ *
+ * Sets how updates of files that keep changing are merged together.
+ **/
+void
+tracker_miner_fs_set_update_delays (TrackerMinerFS *fs,
+                                    guint           min_delay,
+                                    guint           max_delay)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+
+	tracker_file_notifier_set_update_delays (fs->priv->file_notifier,
+	                                         min_delay, max_delay);
+}
+
+/**
+ * tracker_miner_fs_set_checkpoint_file:
+ * @fs: a #TrackerMinerFS
+ * @file: file to save crawling progress to
+ *
+ * Makes @fs keep track of crawling progress in @file, so crawling
+ * indexed folders resumes where it was left if the miner is
+ * interrupted before finishing.
+ **/
+void
+tracker_miner_fs_set_checkpoint_file (TrackerMinerFS *fs,
+                                      GFile          *file)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (G_IS_FILE (file));
+
+	tracker_file_notifier_set_checkpoint_file (fs->priv->file_notifier, file);
+}
+
+/**
+ * tracker_miner_fs_set_consistent_roots_file:
+ * @fs: a #TrackerMinerFS
+ * @file: file to save the fully indexed folders to
+ * @trust: whether to trust the folders saved by a previous instance
+ *
+ * Makes @fs keep track in @file of the indexed folders that are up
+ * to date. If @trust is %TRUE, only the directories that changed
+ * since then, as recorded in the checkpoint file, are checked again
+ * when those folders are first crawled.
+ **/
+void
+tracker_miner_fs_set_consistent_roots_file (TrackerMinerFS *fs,
+                                            GFile          *file,
+                                            gboolean        trust)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (G_IS_FILE (file));
+
+	tracker_file_notifier_set_consistent_roots_file (fs->priv->file_notifier,
+	                                                 file, trust);
+}
+
+/**
+ * tracker_miner_fs_set_status_page:
+ * @fs: a #TrackerMinerFS
+ * @page: (transfer full) (nullable): status page to publish counters to
+ *
+ * Makes @fs publish its progress and counters to @page, so they can
+ * be polled by other processes without D-Bus round trips.
+ **/
+void
+tracker_miner_fs_set_status_page (TrackerMinerFS    *fs,
+                                  TrackerStatusPage *page)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+
+	g_clear_pointer (&fs->priv->status_page, tracker_status_page_free);
+	fs->priv->status_page = page;
+	publish_status_page (fs);
+}
+
+/**
+ * tracker_miner_fs_get_status_page:
+ * @fs: a #TrackerMinerFS
+ *
+ * Returns the status page set through tracker_miner_fs_set_status_page().
+ *
+ * Returns: (transfer none) (nullable): the status page
+ **/
+TrackerStatusPage *
+tracker_miner_fs_get_status_page (TrackerMinerFS *fs)
+{
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), NULL);
+
+	return fs->priv->status_page;
+}
+
+/**
+ * tracker_miner_fs_set_event_recorder:
+ * @fs: a #TrackerMinerFS
+ * @recorder: (transfer full) (nullable): recorder to log events to
+ *
+ * Makes @fs log every event it queues to @recorder, along with a mark
+ * every time it goes idle.
+ **/
+void
+tracker_miner_fs_set_event_recorder (TrackerMinerFS       *fs,
+                                     TrackerEventRecorder *recorder)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+
+	g_clear_pointer (&fs->priv->event_recorder, tracker_event_recorder_free);
+	fs->priv->event_recorder = recorder;
+}
+
+/**
+ * tracker_miner_fs_set_storage:
+ * @fs: a #TrackerMinerFS
+ * @storage: a #TrackerStorage
+ *
+ * Makes @fs crawl the indexed folders in @storage that are on
+ * rotational disks in an order suited to them.
+ **/
+void
+tracker_miner_fs_set_storage (TrackerMinerFS *fs,
+                              TrackerStorage *storage)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (TRACKER_IS_STORAGE (storage));
+
+	tracker_file_notifier_set_storage (fs->priv->file_notifier, storage);
+}
+
+/**
+ * tracker_miner_fs_set_identifier_cache_size:
+ * @fs: a #TrackerMinerFS
+ * @size: maximum number of cached identifiers
+ *
+ * Sets the number of content identifiers kept in memory by
+ * tracker_miner_fs_get_identifier(). Changing the size drops
+ * the currently cached identifiers.
+ **/
+void
+tracker_miner_fs_set_identifier_cache_size (TrackerMinerFS *fs,
+                                            guint           size)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (size > 0);
+
+	if (tracker_lru_get_size (fs->priv->urn_lru) == size)
+		return;
+
+	g_clear_pointer (&fs->priv->urn_lru, tracker_lru_unref);
+	fs->priv->urn_lru = tracker_lru_new (size,
+	                                     g_file_hash,
+	                                     (GEqualFunc) g_file_equal,
+	                                     g_object_unref,
+	                                     g_free);
 }
 
 /**
@@ -1749,6 +2630,92 @@ tracker_miner_fs_has_items_to_process (TrackerMinerFS *fs)
 	return FALSE;
 }
 
+/**
+ * tracker_miner_fs_is_file_queued:
+ * @fs: a #TrackerMinerFS
+ * @file: a #GFile
+ *
+ * Checks whether there are pending events for @file that were not
+ * processed yet.
+ *
+ * Returns: %TRUE if @file is waiting to be processed.
+ **/
+gboolean
+tracker_miner_fs_is_file_queued (TrackerMinerFS *fs,
+                                 GFile          *file)
+{
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	return queue_index_lookup (fs, file) != NULL;
+}
+
+/**
+ * tracker_miner_fs_index_file_async:
+ * @fs: a #TrackerMinerFS
+ * @file: a #GFile
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: callback to call when @file is stored
+ * @user_data: data for @callback
+ *
+ * Processes @file ahead of every other queued event, and stores it
+ * without waiting for a full batch. Events already queued for @file
+ * are moved ahead, otherwise @file is queued as updated. @callback
+ * is called once the changes to @file are in the store.
+ **/
+void
+tracker_miner_fs_index_file_async (TrackerMinerFS      *fs,
+                                   GFile               *file,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+	g_return_if_fail (G_IS_FILE (file));
+
+	task = g_task_new (fs, cancellable, callback, user_data);
+	g_task_set_task_data (task, g_object_ref (file), g_object_unref);
+
+	if (fs->priv->is_paused) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_BUSY,
+		                         "Indexer is paused");
+		g_object_unref (task);
+		return;
+	}
+
+	if (!miner_fs_raise_events (fs, file, URGENT_PRIORITY)) {
+		miner_fs_queue_event (fs,
+		                      queue_event_new (TRACKER_MINER_FS_EVENT_UPDATED,
+		                                       file, NULL),
+		                      URGENT_PRIORITY);
+	}
+
+	g_ptr_array_add (fs->priv->urgent_tasks, task);
+	item_queue_handlers_set_up (fs);
+}
+
+/**
+ * tracker_miner_fs_index_file_finish:
+ * @fs: a #TrackerMinerFS
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes an operation started with tracker_miner_fs_index_file_async().
+ *
+ * Returns: %TRUE if the file was stored.
+ **/
+gboolean
+tracker_miner_fs_index_file_finish (TrackerMinerFS  *fs,
+                                    GAsyncResult    *result,
+                                    GError         **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, fs), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * tracker_miner_fs_get_indexing_tree:
  * @fs: a #TrackerMinerFS
@@ -30,8 +30,10 @@
 
 #include <libtracker-miners-common/tracker-common.h>
 
+#include "tracker-event-recorder.h"
 #include "tracker-indexing-tree.h"
 #include "tracker-sparql-buffer.h"
+#include "tracker-storage.h"
 
 G_BEGIN_DECLS
 
@@ -68,7 +70,13 @@ struct _TrackerMinerFS {
  * @remove_file: Called when a file is removed.
  * @remove_children: Called when children have been removed.
  * @move_file: Called when a file has moved.
- * @padding: Reserved for future API improvements.
+ * @get_content_identifier: Called to get the content identifier of a file.
+ * @prepare_file: Called from a worker thread before @process_file or
+ * @process_file_attributes, to do blocking queries on the file. Returns
+ * the #GFileInfo to process the file with. It must not access any
+ * other miner state.
+ * @hot_file_stored: Called when a file the user is likely working on
+ * was stored, ahead of the files being crawled.
  *
  * Prototype for the abstract class, @process_file must be implemented
  * in the deriving class in order to actually extract data.
@@ -112,6 +120,12 @@ typedef struct {
 	gchar * (* get_content_identifier)    (TrackerMinerFS       *fs,
 					       GFile                *file,
 	                                       GFileInfo            *info);
+	GFileInfo * (* prepare_file)          (TrackerMinerFS       *fs,
+	                                       GFile                *file,
+	                                       GFileInfo            *info,
+	                                       GCancellable         *cancellable);
+	void     (* hot_file_stored)          (TrackerMinerFS       *fs,
+	                                       GFile                *file);
 } TrackerMinerFSClass;
 
 GType                 tracker_miner_fs_get_type              (void) G_GNUC_CONST;
@@ -121,13 +135,46 @@ TrackerIndexingTree * tracker_miner_fs_get_indexing_tree     (TrackerMinerFS  *f
 gdouble               tracker_miner_fs_get_throttle          (TrackerMinerFS  *fs);
 void                  tracker_miner_fs_set_throttle          (TrackerMinerFS  *fs,
                                                               gdouble          throttle);
+void                  tracker_miner_fs_set_crawl_limits      (TrackerMinerFS  *fs,
+                                                              guint            max_roots,
+                                                              guint            max_directories);
+void                  tracker_miner_fs_set_max_monitors      (TrackerMinerFS  *fs,
+                                                              guint            max_monitors);
+void                  tracker_miner_fs_set_update_delays     (TrackerMinerFS  *fs,
+                                                              guint            min_delay,
+                                                              guint            max_delay);
+void                  tracker_miner_fs_set_checkpoint_file   (TrackerMinerFS  *fs,
+                                                              GFile           *file);
+void                  tracker_miner_fs_set_consistent_roots_file (TrackerMinerFS *fs,
+                                                                  GFile          *file,
+                                                                  gboolean        trust);
+void                  tracker_miner_fs_set_status_page       (TrackerMinerFS    *fs,
+                                                              TrackerStatusPage *page);
+TrackerStatusPage *   tracker_miner_fs_get_status_page       (TrackerMinerFS  *fs);
+void                  tracker_miner_fs_set_event_recorder    (TrackerMinerFS       *fs,
+                                                              TrackerEventRecorder *recorder);
+void                  tracker_miner_fs_set_storage           (TrackerMinerFS  *fs,
+                                                              TrackerStorage  *storage);
 
 /* URNs */
 const gchar * tracker_miner_fs_get_identifier (TrackerMinerFS *miner,
                                                GFile          *file);
+void          tracker_miner_fs_set_identifier_cache_size (TrackerMinerFS *fs,
+                                                          guint           size);
 
 /* Progress */
 gboolean              tracker_miner_fs_has_items_to_process  (TrackerMinerFS  *fs);
+gboolean              tracker_miner_fs_is_file_queued        (TrackerMinerFS  *fs,
+                                                              GFile           *file);
+
+void                  tracker_miner_fs_index_file_async      (TrackerMinerFS      *fs,
+                                                              GFile               *file,
+                                                              GCancellable        *cancellable,
+                                                              GAsyncReadyCallback  callback,
+                                                              gpointer             user_data);
+gboolean              tracker_miner_fs_index_file_finish     (TrackerMinerFS  *fs,
+                                                              GAsyncResult    *result,
+                                                              GError         **error);
 
 G_END_DECLS
 
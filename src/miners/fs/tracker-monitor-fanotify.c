@@ -22,14 +22,18 @@
 #include "config-miners.h"
 
 #include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <gio/gio.h>
 #include <sys/fanotify.h>
+#include <sys/ioctl.h>
 #include <sys/vfs.h>
 
 #include <glib-unix.h>
 
+#include "tracker-file-trie.h"
 #include "tracker-monitor-fanotify.h"
 #include "tracker-monitor-private.h"
 
@@ -41,6 +45,15 @@
                          FAN_MOVED_TO | FAN_MOVED_FROM | FAN_MOVE_SELF | \
                          FAN_EVENT_ON_CHILD | FAN_ONDIR)
 
+/* FAN_EVENT_ON_CHILD is implicit in filesystem-wide marks */
+#define FANOTIFY_FILESYSTEM_EVENTS(events) ((events) & ~FAN_EVENT_ON_CHILD)
+
+/* The event buffer grows up to the maximum size if
+ * events are queued faster than we read them.
+ */
+#define MIN_EVENT_BUFFER_SIZE (8 * 1024)
+#define MAX_EVENT_BUFFER_SIZE (256 * 1024)
+
 typedef enum {
 	EVENT_NONE,
 	EVENT_CREATE,
@@ -50,10 +63,13 @@ typedef enum {
 	EVENT_MOVE,
 } EventType;
 
+/* Events are keyed by parent directory and file name, so the
+ * GFile for the file is only created if the event gets emitted.
+ */
 typedef struct {
 	EventType type;
-	TrackerMonitor *monitor;
-	GFile *file;
+	GFile *dir;
+	gchar *name;
 	gboolean is_directory;
 } MonitorEvent;
 
@@ -61,14 +77,26 @@ struct _TrackerMonitorFanotify {
 	TrackerMonitor parent_instance;
 
 	GHashTable *monitored_dirs;
+	/* The same directories, to find subtrees */
+	TrackerFileTrie *monitored_tree;
 	GHashTable *handles;
+	GHashTable *filesystems;
 	GHashTable *cached_events;
 	GSource *source;
 	gboolean enabled;
+	gboolean filesystem_marks;
 	int fanotify_fd;
+	/* Events requested in marks, FAN_RENAME replaces the
+	 * FAN_MOVED_FROM/TO pair if the kernel supports it.
+	 */
+	uint32_t events;
 
 	ssize_t file_handle_payload;
-	GFile *moved_file;
+	GFile *moved_dir;
+	gchar *moved_name;
+
+	gpointer event_buffer;
+	gsize event_buffer_size;
 	guint limit;
 	guint ignored;
 };
@@ -82,11 +110,20 @@ typedef struct {
 typedef struct {
 	TrackerMonitorFanotify *monitor;
 	GFile *file;
-	GBytes *handle_bytes;
 	/* This must be last in the struct */
 	HandleData handle;
 } MonitoredFile;
 
+/* A FAN_MARK_FILESYSTEM mark, events for all directories in the
+ * filesystem are resolved through open_by_handle_at() and filtered
+ * against the monitored directories.
+ */
+typedef struct {
+	TrackerMonitorFanotify *monitor;
+	fsid_t fsid;
+	int fd;
+} FilesystemMark;
+
 enum {
 	ITEM_CREATED,
 	ITEM_UPDATED,
@@ -179,43 +216,107 @@ emit_event (TrackerMonitorFanotify *monitor,
 	}
 }
 
+static inline GFile *
+get_file (GFile       *dir,
+          const gchar *name)
+{
+	if (strcmp (name, ".") == 0)
+		return g_object_ref (dir);
+
+	return g_file_get_child (dir, name);
+}
+
+static void
+emit_file_event (TrackerMonitorFanotify *monitor,
+                 EventType               evtype,
+                 GFile                  *dir,
+                 const gchar            *name,
+                 gboolean                is_directory)
+{
+	GFile *file;
+
+	file = get_file (dir, name);
+	emit_event (monitor, evtype, file, NULL, is_directory);
+	g_object_unref (file);
+}
+
+static guint
+monitor_event_hash (gconstpointer data)
+{
+	const MonitorEvent *event = data;
+
+	return g_file_hash (event->dir) ^ g_str_hash (event->name);
+}
+
+static gboolean
+monitor_event_equal (gconstpointer a,
+                     gconstpointer b)
+{
+	const MonitorEvent *event_a = a, *event_b = b;
+
+	return (strcmp (event_a->name, event_b->name) == 0 &&
+	        g_file_equal (event_a->dir, event_b->dir));
+}
+
+static MonitorEvent *
+lookup_event (TrackerMonitorFanotify *monitor,
+              GFile                  *dir,
+              const gchar            *name)
+{
+	MonitorEvent key;
+
+	key.dir = dir;
+	key.name = (gchar *) name;
+
+	return g_hash_table_lookup (monitor->cached_events, &key);
+}
+
 static void
 flush_event (TrackerMonitorFanotify *monitor,
-             GFile                  *file)
+             GFile                  *dir,
+             const gchar            *name)
 {
 	MonitorEvent *event;
 
-	event = g_hash_table_lookup (monitor->cached_events, file);
+	event = lookup_event (monitor, dir, name);
 	if (!event)
 		return;
 
-	emit_event (monitor, event->type, event->file, NULL, event->is_directory);
-	g_hash_table_remove (monitor->cached_events, file);
+	emit_file_event (monitor, event->type, event->dir, event->name,
+	                 event->is_directory);
+	g_hash_table_remove (monitor->cached_events, event);
 }
 
 static void
 forget_event (TrackerMonitorFanotify *monitor,
-              GFile                  *file)
+              GFile                  *dir,
+              const gchar            *name)
 {
-	g_hash_table_remove (monitor->cached_events, file);
+	MonitorEvent *event;
+
+	event = lookup_event (monitor, dir, name);
+	if (event)
+		g_hash_table_remove (monitor->cached_events, event);
 }
 
 static void
 monitor_event_free (MonitorEvent *event)
 {
-	g_object_unref (event->file);
+	g_object_unref (event->dir);
+	g_free (event->name);
 	g_slice_free (MonitorEvent, event);
 }
 
 static void
 cache_event (TrackerMonitorFanotify *monitor,
              EventType               evtype,
-             GFile                  *file,
+             GFile                  *dir,
+             const gchar            *name,
              gboolean                is_directory)
 {
 	MonitorEvent *event, *prev_event;
 
-	prev_event = g_hash_table_lookup (monitor->cached_events, file);
+	prev_event = lookup_event (monitor, dir, name);
 
 	if (prev_event) {
 		/* Check whether the prior event is compatible */
@@ -227,20 +328,29 @@ cache_event (TrackerMonitorFanotify *monitor,
 			return;
 
 		/* Otherwise flush the event */
-		flush_event (monitor, file);
+		flush_event (monitor, dir, name);
 	}
 
 	event = g_slice_new0 (MonitorEvent);
 	event->type = evtype;
-	event->file = g_object_ref (file);
+	event->dir = g_object_ref (dir);
+	event->name = g_strdup (name);
 	event->is_directory = is_directory;
 
-	g_hash_table_insert (monitor->cached_events, event->file, event);
+	g_hash_table_add (monitor->cached_events, event);
+}
+
+static void
+clear_moved_file (TrackerMonitorFanotify *monitor)
+{
+	g_clear_object (&monitor->moved_dir);
+	g_clear_pointer (&monitor->moved_name, g_free);
 }
 
 static void
 handle_monitor_events (TrackerMonitorFanotify *monitor,
-                       GFile                  *file,
+                       GFile                  *dir,
+                       const gchar            *name,
                        uint32_t                mask)
 {
 	gboolean is_directory;
@@ -249,10 +359,12 @@ handle_monitor_events (TrackerMonitorFanotify *monitor,
 
 	if (mask & FAN_CREATE) {
 		if (is_directory) {
-			emit_event (monitor, EVENT_CREATE, file, NULL, is_directory);
+			emit_file_event (monitor, EVENT_CREATE, dir, name, is_directory);
 		} else {
 			GFileType file_type;
+			GFile *file;
 
+			file = get_file (dir, name);
 			file_type = g_file_query_file_type (file,
 							    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 							    NULL);
@@ -262,106 +374,381 @@ handle_monitor_events (TrackerMonitorFanotify *monitor,
 				/* We will not get FAN_CLOSE for these file types */
 				emit_event (monitor, EVENT_CREATE, file, NULL, is_directory);
 			} else if (file_type != G_FILE_TYPE_UNKNOWN) {
-				cache_event (monitor, EVENT_CREATE, file, is_directory);
+				cache_event (monitor, EVENT_CREATE, dir, name, is_directory);
 			}
+
+			g_object_unref (file);
 		}
 	}
 
 	if (mask & FAN_MODIFY) {
 		if (is_directory) {
-			emit_event (monitor, EVENT_UPDATE, file, NULL, is_directory);
+			emit_file_event (monitor, EVENT_UPDATE, dir, name, is_directory);
 		} else {
-			cache_event (monitor, EVENT_UPDATE, file, is_directory);
+			cache_event (monitor, EVENT_UPDATE, dir, name, is_directory);
 		}
 	}
 
 	if (mask & FAN_ATTRIB) {
-		emit_event (monitor, EVENT_ATTRIBUTES_UPDATE,
-		            file, NULL, is_directory);
+		emit_file_event (monitor, EVENT_ATTRIBUTES_UPDATE,
+		                 dir, name, is_directory);
 	}
 
 	if (mask & (FAN_DELETE | FAN_DELETE_SELF)) {
-		cache_event (monitor, EVENT_DELETE, file, is_directory);
+		cache_event (monitor, EVENT_DELETE, dir, name, is_directory);
 		if (mask & FAN_DELETE)
-			flush_event (monitor, file);
+			flush_event (monitor, dir, name);
 	}
 
 	if (mask & FAN_CLOSE_WRITE) {
 		/* Flush the CREATE/UPDATE event here */
-		flush_event (monitor, file);
+		flush_event (monitor, dir, name);
 	}
 
 	if (mask & FAN_MOVED_FROM) {
-		cache_event (monitor, EVENT_DELETE, file, is_directory);
-		g_set_object (&monitor->moved_file, file);
+		cache_event (monitor, EVENT_DELETE, dir, name, is_directory);
+		clear_moved_file (monitor);
+		monitor->moved_dir = g_object_ref (dir);
+		monitor->moved_name = g_strdup (name);
 	}
 
 	if (mask & FAN_MOVED_TO) {
-		GFile *source_file;
-
-		source_file = monitor->moved_file;
-
-		if (source_file == NULL) {
-			emit_event (monitor, EVENT_CREATE, file, NULL, is_directory);
+		if (monitor->moved_dir == NULL) {
+			emit_file_event (monitor, EVENT_CREATE, dir, name, is_directory);
 		} else {
-			forget_event (monitor, source_file);
+			GFile *source_file, *file;
+
+			forget_event (monitor, monitor->moved_dir, monitor->moved_name);
+			source_file = get_file (monitor->moved_dir, monitor->moved_name);
+			file = get_file (dir, name);
 			emit_event (monitor, EVENT_MOVE, source_file, file, is_directory);
+			g_object_unref (source_file);
+			g_object_unref (file);
 		}
 
-		g_clear_object (&monitor->moved_file);
+		clear_moved_file (monitor);
 	}
 }
 
-static inline GBytes *
-create_bytes_for_handle (HandleData *handle)
+static inline guint
+hash_bytes (gconstpointer data,
+            gsize         len)
+{
+	const guchar *p = data;
+	guint32 h = 5381;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		h = (h << 5) + h + p[i];
+
+	return h;
+}
+
+static inline gsize
+handle_data_size (const HandleData *handle)
+{
+	return sizeof (HandleData) + handle->handle.handle_bytes;
+}
+
+/* HandleData is hashed in place, so event data can be
+ * used as a lookup key without copying it.
+ */
+static guint
+handle_data_hash (gconstpointer data)
+{
+	return hash_bytes (data, handle_data_size (data));
+}
+
+static gboolean
+handle_data_equal (gconstpointer a,
+                   gconstpointer b)
+{
+	const HandleData *handle_a = a, *handle_b = b;
+
+	return (handle_a->handle.handle_bytes == handle_b->handle.handle_bytes &&
+	        memcmp (handle_a, handle_b, handle_data_size (handle_a)) == 0);
+}
+
+static guint
+fsid_hash (gconstpointer data)
 {
-	return g_bytes_new_static (handle,
-	                           sizeof (HandleData) +
-	                           handle->handle.handle_bytes);
+	return hash_bytes (data, sizeof (fsid_t));
+}
+
+static gboolean
+fsid_equal (gconstpointer a,
+            gconstpointer b)
+{
+	return memcmp (a, b, sizeof (fsid_t)) == 0;
+}
+
+static GFile *
+resolve_filesystem_handle (TrackerMonitorFanotify *monitor,
+                           FilesystemMark         *mark,
+                           HandleData             *handle)
+{
+	gchar proc_path[64], path[PATH_MAX];
+	ssize_t len;
+	int fd;
+
+	fd = open_by_handle_at (mark->fd, &handle->handle, O_PATH);
+	if (fd < 0) {
+		/* ESTALE means the directory is already gone */
+		if (errno != ESTALE)
+			TRACKER_NOTE (MONITORS, g_message ("Could not open file handle: %m"));
+		return NULL;
+	}
+
+	g_snprintf (proc_path, sizeof (proc_path), "/proc/self/fd/%d", fd);
+	len = readlink (proc_path, path, sizeof (path) - 1);
+	close (fd);
+
+	if (len < 0)
+		return NULL;
+
+	path[len] = '\0';
+
+	return g_file_new_for_path (path);
+}
+
+/* Returns a borrowed reference, either owned by the monitored
+ * directory or by @last_dir.
+ */
+static GFile *
+lookup_directory (TrackerMonitorFanotify  *monitor,
+                  HandleData              *handle,
+                  HandleData             **last_handle,
+                  GFile                  **last_dir)
+{
+	FilesystemMark *mark = NULL;
+	MonitoredFile *data;
+
+	if (g_hash_table_size (monitor->filesystems) > 0)
+		mark = g_hash_table_lookup (monitor->filesystems, &handle->fsid);
+
+	if (!mark) {
+		data = g_hash_table_lookup (monitor->handles, handle);
+		return data ? data->file : NULL;
+	}
+
+	/* Events often come in bursts for the same directory, avoid
+	 * resolving the handle again for those.
+	 */
+	if (!*last_handle || !handle_data_equal (*last_handle, handle)) {
+		g_clear_object (last_dir);
+
+		*last_dir = resolve_filesystem_handle (monitor, mark, handle);
+
+		/* Filter out directories that are not indexed */
+		if (*last_dir &&
+		    !g_hash_table_contains (monitor->monitored_dirs, *last_dir))
+			g_clear_object (last_dir);
+
+		/* Points into the event buffer, valid until the next read */
+		*last_handle = handle;
+	}
+
+	return *last_dir;
+}
+
+#ifdef FAN_RENAME
+static struct fanotify_event_info_fid *
+find_event_info (struct fanotify_event_metadata *event,
+                 guint8                          info_type)
+{
+	gchar *p, *end;
+
+	p = (gchar *) event + event->metadata_len;
+	end = (gchar *) event + event->event_len;
+
+	while (p + sizeof (struct fanotify_event_info_header) <= end) {
+		struct fanotify_event_info_header *hdr;
+
+		hdr = (struct fanotify_event_info_header *) p;
+		if (hdr->len == 0 || p + hdr->len > end)
+			break;
+
+		if (hdr->info_type == info_type)
+			return (struct fanotify_event_info_fid *) hdr;
+
+		p += hdr->len;
+	}
+
+	return NULL;
+}
+
+/* Returns a new reference to the directory in the event info,
+ * or %NULL if it is not monitored.
+ */
+static GFile *
+lookup_event_info_directory (TrackerMonitorFanotify          *monitor,
+                             struct fanotify_event_metadata  *event,
+                             guint8                           info_type,
+                             HandleData                     **last_handle,
+                             GFile                          **last_dir,
+                             const gchar                    **name)
+{
+	struct fanotify_event_info_fid *fid;
+	HandleData *handle;
+	GFile *dir;
+
+	fid = find_event_info (event, info_type);
+	if (!fid)
+		return NULL;
+
+	/* fsid/handle portions are compatible with HandleData */
+	handle = (HandleData *) &fid->fsid;
+	dir = lookup_directory (monitor, handle, last_handle, last_dir);
+	if (!dir)
+		return NULL;
+
+	/* File name comes after the file handle data */
+	*name = handle->handle.f_handle + handle->handle.handle_bytes;
+
+	return g_object_ref (dir);
+}
+
+/* FAN_RENAME carries both the old and new locations, so moves
+ * within monitored folders need no pairing of events.
+ */
+static void
+handle_rename_event (TrackerMonitorFanotify          *monitor,
+                     struct fanotify_event_metadata  *event,
+                     HandleData                     **last_handle,
+                     GFile                          **last_dir)
+{
+	const gchar *old_name = NULL, *new_name = NULL;
+	GFile *old_dir, *new_dir;
+	gboolean is_directory;
+
+	is_directory = (event->mask & FAN_ONDIR) != 0;
+
+	old_dir = lookup_event_info_directory (monitor, event,
+	                                       FAN_EVENT_INFO_TYPE_OLD_DFID_NAME,
+	                                       last_handle, last_dir,
+	                                       &old_name);
+	new_dir = lookup_event_info_directory (monitor, event,
+	                                       FAN_EVENT_INFO_TYPE_NEW_DFID_NAME,
+	                                       last_handle, last_dir,
+	                                       &new_name);
+
+	/* Events pending on the old location happened before the move */
+	if (old_dir)
+		flush_event (monitor, old_dir, old_name);
+
+	if (old_dir && new_dir) {
+		GFile *source_file, *file;
+
+		source_file = get_file (old_dir, old_name);
+		file = get_file (new_dir, new_name);
+		emit_event (monitor, EVENT_MOVE, source_file, file, is_directory);
+		g_object_unref (source_file);
+		g_object_unref (file);
+	} else if (old_dir) {
+		/* Moved outside our inspected folders */
+		emit_file_event (monitor, EVENT_DELETE, old_dir, old_name, is_directory);
+	} else if (new_dir) {
+		emit_file_event (monitor, EVENT_CREATE, new_dir, new_name, is_directory);
+	}
+
+	g_clear_object (&old_dir);
+	g_clear_object (&new_dir);
 }
+#endif
 
 static void
 flush_moved_file_event (TrackerMonitorFanotify *monitor)
 {
-	if (monitor->moved_file) {
-		flush_event (monitor, monitor->moved_file);
-		g_clear_object (&monitor->moved_file);
+	if (monitor->moved_dir) {
+		flush_event (monitor, monitor->moved_dir, monitor->moved_name);
+		clear_moved_file (monitor);
 	}
 }
 
+static void
+ensure_event_buffer (TrackerMonitorFanotify *monitor)
+{
+	gsize size;
+	int queued = 0;
+
+	size = MAX (monitor->event_buffer_size, MIN_EVENT_BUFFER_SIZE);
+
+	/* Size the buffer after the queued events, so storms of
+	 * events are handled in as few reads as possible.
+	 */
+	if (ioctl (monitor->fanotify_fd, FIONREAD, &queued) == 0 &&
+	    (gsize) queued > size)
+		size = MIN ((gsize) queued, MAX_EVENT_BUFFER_SIZE);
+
+	if (size == monitor->event_buffer_size)
+		return;
+
+	g_free (monitor->event_buffer);
+	monitor->event_buffer = g_malloc (size);
+	monitor->event_buffer_size = size;
+}
+
 static gboolean
 fanotify_events_cb (int          fd,
                     GIOCondition condition,
                     gpointer     user_data)
 {
 	TrackerMonitorFanotify *monitor = user_data;
-	struct fanotify_event_metadata buf[200], *event;
+	struct fanotify_event_metadata *event;
+	HandleData *last_handle = NULL;
+	GFile *last_dir = NULL;
 	ssize_t len;
 
-	len = read (monitor->fanotify_fd, buf, sizeof (buf));
+	ensure_event_buffer (monitor);
+	len = read (monitor->fanotify_fd,
+	            monitor->event_buffer,
+	            monitor->event_buffer_size);
 
-	event = buf;
+	event = monitor->event_buffer;
 
 	while (FAN_EVENT_OK (event, len)) {
 		struct fanotify_event_info_fid *fid;
 		HandleData *handle;
-		MonitoredFile *data;
 		const gchar *file_name;
-		GBytes *fid_bytes;
-		GFile *child;
+		GFile *dir, *parent = NULL;
+		gchar *basename = NULL;
 
 		/* Check that run-time and compile-time structures match. */
 		if (event->vers != FANOTIFY_METADATA_VERSION) {
 			g_warning ("Fanotify ABI mismatch, monitoring is disabled");
+			g_clear_object (&last_dir);
 			return G_SOURCE_REMOVE;
 		}
 
+		if (event->mask & FAN_Q_OVERFLOW) {
+			/* The queue is shared by all marks, so there is no
+			 * telling which directories lost events.
+			 */
+			g_info ("Fanotify event queue overflowed, monitored folders will be checked again");
+			tracker_monitor_emit_overflow (TRACKER_MONITOR (monitor), NULL);
+			goto cont;
+		}
+
 		/* We expect data as FID, not as a file descriptor */
 		if (event->fd != FAN_NOFD) {
 			TRACKER_NOTE (MONITORS, g_message ("Received a file descriptor unexpectedly"));
 			goto cont;
 		}
 
+#ifdef FAN_RENAME
+		if (event->mask & FAN_RENAME) {
+			handle_rename_event (monitor, event, &last_handle, &last_dir);
+
+			/* Handles of the moved directory resolve elsewhere now */
+			if (event->mask & FAN_ONDIR) {
+				last_handle = NULL;
+				g_clear_object (&last_dir);
+			}
+
+			goto cont;
+		}
+#endif
+
 		fid = (struct fanotify_event_info_fid *) (event + 1);
 
 		/* Ensure that the event info is of the correct type. */
@@ -370,15 +757,14 @@ fanotify_events_cb (int          fd,
 
 		/* fsid/handle portions are compatible with HandleData */
 		handle = (HandleData *) &fid->fsid;
-		fid_bytes = create_bytes_for_handle (handle);
-		data = g_hash_table_lookup (monitor->handles, fid_bytes);
-		g_bytes_unref (fid_bytes);
+		dir = lookup_directory (monitor, handle, &last_handle, &last_dir);
 
-		if (!data) {
+		if (!dir) {
 			/* We are receiving a notification on an unknown handle,
 			 * should this ever happen on folders? In either case this is
 			 * ignored, presumably will be fixed by events that
-			 * are yet to be handled.
+			 * are yet to be handled. With filesystem-wide marks,
+			 * this is also the case for all non-indexed folders.
 			 */
 			goto cont;
 		}
@@ -386,25 +772,47 @@ fanotify_events_cb (int          fd,
 		/* File name comes after the file handle data */
 		file_name = handle->handle.f_handle + handle->handle.handle_bytes;
 
-		if (g_strcmp0 (file_name, ".") == 0)
-			child = g_object_ref (data->file);
-		else
-			child = g_file_get_child (data->file, file_name);
+		if (strcmp (file_name, ".") == 0) {
+			/* Events on the directory itself, refer to it through
+			 * its parent so these coalesce with the events
+			 * received there.
+			 */
+			parent = g_file_get_parent (dir);
+
+			if (parent) {
+				basename = g_file_get_basename (dir);
+				file_name = basename;
+				dir = parent;
+			}
+		}
 
 		/* We have a pending MOVED_FROM event, now unpaired. Flush
 		 * it as a DELETE event, since it's moving outside our
 		 * inspected folders.
 		 */
-		if (monitor->moved_file && (event->mask & FAN_MOVED_TO) == 0)
+		if (monitor->moved_dir && (event->mask & FAN_MOVED_TO) == 0)
 			flush_moved_file_event (monitor);
 
-		handle_monitor_events (monitor, child, event->mask);
-		g_object_unref (child);
+		handle_monitor_events (monitor, dir, file_name, event->mask);
+		g_clear_object (&parent);
+		g_free (basename);
+
+		/* Directories moving around change the paths that
+		 * handles resolve to.
+		 */
+		if ((event->mask & FAN_ONDIR) &&
+		    (event->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_MOVE_SELF |
+		                    FAN_DELETE | FAN_DELETE_SELF))) {
+			last_handle = NULL;
+			g_clear_object (&last_dir);
+		}
 
 	cont:
 		event = FAN_EVENT_NEXT (event, len);
 	}
 
+	g_clear_object (&last_dir);
+
 	flush_moved_file_event (monitor);
 
 	return G_SOURCE_CONTINUE;
@@ -433,6 +841,30 @@ get_fanotify_limit (guint   *limit,
 	return TRUE;
 }
 
+static gboolean
+supports_rename_events (TrackerMonitorFanotify *monitor)
+{
+#ifdef FAN_RENAME
+	/* Kernels older than 5.17 reject the event */
+	if (fanotify_mark (monitor->fanotify_fd,
+	                   FAN_MARK_ADD | FAN_MARK_ONLYDIR,
+	                   FAN_RENAME | FAN_ONDIR,
+	                   AT_FDCWD,
+	                   "/") < 0)
+		return FALSE;
+
+	fanotify_mark (monitor->fanotify_fd,
+	               FAN_MARK_REMOVE,
+	               FAN_RENAME | FAN_ONDIR,
+	               AT_FDCWD,
+	               "/");
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 static gboolean
 tracker_monitor_fanotify_initable_init (GInitable     *initable,
                                         GCancellable  *cancellable,
@@ -458,6 +890,19 @@ tracker_monitor_fanotify_initable_init (GInitable     *initable,
 	if (!get_fanotify_limit (&limit, error))
 		return FALSE;
 
+	monitor->events = FANOTIFY_EVENTS;
+
+#ifdef FAN_RENAME
+	if (supports_rename_events (monitor)) {
+		monitor->events &= ~(FAN_MOVED_FROM | FAN_MOVED_TO);
+		monitor->events |= FAN_RENAME;
+	}
+#endif
+
+	TRACKER_NOTE (MONITORS, g_message ("Fanotify rename events are %s",
+	                                   (monitor->events & FAN_MOVED_FROM) ?
+	                                   "not supported" : "supported"));
+
 	/* Take up to 80% of available marks */
 	monitor->limit = limit * 8 / 10;
 	TRACKER_NOTE (MONITORS, g_message ("Setting a limit of %d  Fanotify marks",
@@ -497,6 +942,9 @@ tracker_monitor_fanotify_set_enabled (TrackerMonitor *object,
 	g_list_foreach (files, (GFunc) g_object_ref, NULL);
 	g_hash_table_remove_all (monitor->handles);
 	g_hash_table_remove_all (monitor->monitored_dirs);
+	tracker_file_trie_free (monitor->monitored_tree);
+	monitor->monitored_tree = tracker_file_trie_new (g_object_unref);
+	g_hash_table_remove_all (monitor->filesystems);
 
 	while (files) {
 		GFile *file;
@@ -530,9 +978,12 @@ tracker_monitor_fanotify_finalize (GObject *object)
 	}
 
 	g_hash_table_unref (monitor->monitored_dirs);
+	tracker_file_trie_free (monitor->monitored_tree);
 	g_hash_table_unref (monitor->handles);
+	g_hash_table_unref (monitor->filesystems);
 	g_hash_table_unref (monitor->cached_events);
-	g_clear_object (&monitor->moved_file);
+	clear_moved_file (monitor);
+	g_free (monitor->event_buffer);
 
 	G_OBJECT_CLASS (tracker_monitor_fanotify_parent_class)->finalize (object);
 }
@@ -589,7 +1040,7 @@ add_mark (TrackerMonitorFanotify *monitor,
 
 	if (fanotify_mark (monitor->fanotify_fd,
 	                   (FAN_MARK_ADD | FAN_MARK_ONLYDIR),
-	                   FANOTIFY_EVENTS,
+	                   monitor->events,
 	                   AT_FDCWD,
 	                   path) < 0) {
 		if (errno == EXDEV)
@@ -614,7 +1065,7 @@ remove_mark (TrackerMonitorFanotify *monitor,
 
 	if (fanotify_mark (monitor->fanotify_fd,
 	                   FAN_MARK_REMOVE,
-	                   FANOTIFY_EVENTS,
+	                   monitor->events,
 	                   AT_FDCWD,
 	                   path) < 0) {
 		if (errno != ENOENT)
@@ -624,6 +1075,107 @@ remove_mark (TrackerMonitorFanotify *monitor,
 	g_free (path);
 }
 
+static void
+filesystem_mark_free (FilesystemMark *mark)
+{
+	if (fanotify_mark (mark->monitor->fanotify_fd,
+	                   FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+	                   FANOTIFY_FILESYSTEM_EVENTS (mark->monitor->events),
+	                   mark->fd,
+	                   NULL) < 0)
+		g_warning ("Could not remove filesystem mark: %m");
+
+	close (mark->fd);
+	g_free (mark);
+}
+
+static gboolean
+add_filesystem_mark (TrackerMonitorFanotify *monitor,
+                     GFile                  *file)
+{
+	FilesystemMark *mark;
+	gchar *path;
+	struct statfs buf;
+	struct {
+		struct file_handle handle;
+		unsigned char f_handle[MAX_HANDLE_SZ];
+	} test;
+	int fd, handle_fd, mntid, saved_errno;
+
+	path = g_file_get_path (file);
+
+	if (statfs (path, &buf) < 0) {
+		g_free (path);
+		return FALSE;
+	}
+
+	if (g_hash_table_contains (monitor->filesystems, &buf.f_fsid)) {
+		g_free (path);
+		return TRUE;
+	}
+
+	fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		g_free (path);
+		return FALSE;
+	}
+
+	/* Resolving handles in events back to paths requires
+	 * CAP_DAC_READ_SEARCH, check that this works before
+	 * setting up the mark.
+	 */
+	test.handle.handle_bytes = MAX_HANDLE_SZ;
+
+	if (name_to_handle_at (fd, "", &test.handle, &mntid, AT_EMPTY_PATH) < 0)
+		goto error;
+
+	handle_fd = open_by_handle_at (fd, &test.handle, O_PATH);
+	if (handle_fd < 0)
+		goto error;
+
+	close (handle_fd);
+
+	/* This requires CAP_SYS_ADMIN */
+	if (fanotify_mark (monitor->fanotify_fd,
+	                   FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+	                   FANOTIFY_FILESYSTEM_EVENTS (monitor->events),
+	                   fd,
+	                   NULL) < 0)
+		goto error;
+
+	mark = g_new0 (FilesystemMark, 1);
+	mark->monitor = monitor;
+	mark->fd = fd;
+	memcpy (&mark->fsid, &buf.f_fsid, sizeof (fsid_t));
+	g_hash_table_insert (monitor->filesystems, &mark->fsid, mark);
+
+	TRACKER_NOTE (MONITORS, g_message ("Added filesystem mark for path:'%s'", path));
+	g_free (path);
+
+	return TRUE;
+
+ error:
+	saved_errno = errno;
+
+	if (saved_errno == EPERM) {
+		/* Stop trying, we are not privileged enough */
+		TRACKER_NOTE (MONITORS, g_message ("Not allowed to add filesystem marks, "
+		                                   "using per-directory marks"));
+		monitor->filesystem_marks = FALSE;
+	} else {
+		/* Other errors (e.g. EXDEV on btrfs subvolumes) only
+		 * affect this filesystem, use per-directory marks there.
+		 */
+		TRACKER_NOTE (MONITORS, g_message ("Could not add filesystem mark for path:'%s': %s",
+		                                   path, g_strerror (saved_errno)));
+	}
+
+	close (fd);
+	g_free (path);
+
+	return FALSE;
+}
+
 static MonitoredFile *
 monitored_file_new (TrackerMonitorFanotify *monitor,
                     GFile                  *file)
@@ -686,8 +1238,6 @@ retry:
 		return NULL;
 	}
 
-	data->handle_bytes = create_bytes_for_handle (&data->handle);
-
 	return data;
 }
 
@@ -697,13 +1247,34 @@ monitored_file_free (MonitoredFile *data)
 	if (!data)
 		return;
 
-	g_bytes_unref (data->handle_bytes);
 	remove_mark (data->monitor, data->file);
 	g_object_unref (data->file);
 	g_slice_free1 (sizeof (MonitoredFile) +
 	               data->handle.handle.handle_bytes, data);
 }
 
+static void
+add_monitored_dir (TrackerMonitorFanotify *monitor,
+                   GFile                  *file,
+                   MonitoredFile          *data)
+{
+	g_hash_table_insert (monitor->monitored_dirs, g_object_ref (file), data);
+	tracker_file_trie_insert (monitor->monitored_tree, file, g_object_ref (file));
+}
+
+static void
+remove_monitored_dir (TrackerMonitorFanotify *monitor,
+                      GFile                  *file)
+{
+	MonitoredFile *data;
+
+	data = g_hash_table_lookup (monitor->monitored_dirs, file);
+	if (data)
+		g_hash_table_remove (monitor->handles, &data->handle);
+
+	g_hash_table_remove (monitor->monitored_dirs, file);
+}
+
 static gboolean
 tracker_monitor_fanotify_add (TrackerMonitor *object,
                               GFile          *file)
@@ -714,7 +1285,11 @@ tracker_monitor_fanotify_add (TrackerMonitor *object,
 	if (g_hash_table_contains (monitor->monitored_dirs, file))
 		return TRUE;
 
-	if (g_hash_table_size (monitor->monitored_dirs) > monitor->limit) {
+	/* Directories covered by filesystem marks do not take marks
+	 * of their own.
+	 */
+	if (!monitor->filesystem_marks &&
+	    g_hash_table_size (monitor->monitored_dirs) > monitor->limit) {
 		monitor->ignored++;
 		return FALSE;
 	}
@@ -724,6 +1299,12 @@ tracker_monitor_fanotify_add (TrackerMonitor *object,
 	                                   g_hash_table_size (monitor->monitored_dirs)));
 
 	if (monitor->enabled) {
+		if (monitor->filesystem_marks &&
+		    add_filesystem_mark (monitor, file)) {
+			add_monitored_dir (monitor, file, NULL);
+			return TRUE;
+		}
+
 		data = monitored_file_new (monitor, file);
 		if (!data) {
 			/* If we cannot create fanotify handles (e.g. EXDEV on
@@ -733,10 +1314,10 @@ tracker_monitor_fanotify_add (TrackerMonitor *object,
 			                                                                           file);
 		}
 
-		g_hash_table_insert (monitor->monitored_dirs, g_object_ref (data->file), data);
-		g_hash_table_insert (monitor->handles, data->handle_bytes, data);
+		add_monitored_dir (monitor, data->file, data);
+		g_hash_table_insert (monitor->handles, &data->handle, data);
 	} else {
-		g_hash_table_insert (monitor->monitored_dirs, g_object_ref (file), NULL);
+		add_monitored_dir (monitor, file, NULL);
 	}
 
 	return TRUE;
@@ -751,41 +1332,29 @@ tracker_monitor_fanotify_remove (TrackerMonitor *object,
 
 	data = g_hash_table_lookup (monitor->monitored_dirs, file);
 	if (data) {
-		g_hash_table_remove (monitor->handles, data->handle_bytes);
+		g_hash_table_remove (monitor->handles, &data->handle);
 		TRACKER_NOTE (MONITORS, g_message ("Removed monitor for path:'%s', total monitors:%d",
 		                                   g_file_peek_path (file),
 		                                   g_hash_table_size (monitor->monitored_dirs) - 1));
 	}
 
-	if (g_hash_table_remove (monitor->monitored_dirs, file))
+	if (g_hash_table_remove (monitor->monitored_dirs, file)) {
+		g_object_unref (tracker_file_trie_remove (monitor->monitored_tree, file));
 		return TRUE;
+	}
 
 	return TRACKER_MONITOR_CLASS (tracker_monitor_fanotify_parent_class)->remove (object,
 	                                                                              file);
 }
 
-/* If @is_strict is %TRUE, return %TRUE iff @file is a child of @prefix.
- * If @is_strict is %FALSE, additionally return %TRUE if @file equals @prefix.
- */
-static gboolean
-file_has_maybe_strict_prefix (GFile    *file,
-                              GFile    *prefix,
-                              gboolean  is_strict)
-{
-	return (g_file_has_prefix (file, prefix) ||
-	        (!is_strict && g_file_equal (file, prefix)));
-}
-
 static gboolean
 tracker_monitor_fanotify_remove_recursively (TrackerMonitor *object,
                                              GFile          *file,
                                              gboolean        only_children)
 {
 	TrackerMonitorFanotify *monitor = TRACKER_MONITOR_FANOTIFY (object);
-	MonitoredFile *data;
-	GHashTableIter iter;
+	GList *descendants, *l;
 	guint items_removed = 0;
-	GFile *f;
 	gchar *uri;
 
 	if (!g_hash_table_contains (monitor->monitored_dirs, file)) {
@@ -794,17 +1363,24 @@ tracker_monitor_fanotify_remove_recursively (TrackerMonitor *object,
 		                                                                                          only_children);
 	}
 
-	g_hash_table_iter_init (&iter, monitor->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, (gpointer *) &f, (gpointer *) &data)) {
-		if (!file_has_maybe_strict_prefix (f, file, only_children))
+	descendants = tracker_file_trie_steal_descendants (monitor->monitored_tree,
+	                                                   file);
+
+	for (l = descendants; l; l = l->next) {
+		GFile *f = l->data;
+
+		if (only_children && g_file_equal (f, file)) {
+			tracker_file_trie_insert (monitor->monitored_tree, f, f);
 			continue;
+		}
 
-		if (data)
-			g_hash_table_remove (monitor->handles, data->handle_bytes);
-		g_hash_table_iter_remove (&iter);
+		remove_monitored_dir (monitor, f);
+		g_object_unref (f);
 		items_removed++;
 	}
 
+	g_list_free (descendants);
+
 	uri = g_file_get_uri (file);
 	TRACKER_NOTE (MONITORS,
 	              g_message ("Removed all monitors %srecursively for path:'%s', )"
@@ -822,12 +1398,8 @@ tracker_monitor_fanotify_move (TrackerMonitor *object,
                                GFile          *new_file)
 {
 	TrackerMonitorFanotify *monitor = TRACKER_MONITOR_FANOTIFY (object);
-	MonitoredFile *data;
-	GHashTableIter iter;
-	gchar *old_prefix;
-	gpointer iter_file;
 	guint items_moved = 0;
-	GList *files = NULL;
+	GList *descendants, *files = NULL, *l;
 	GFile *f;
 
 	if (!g_hash_table_contains (monitor->monitored_dirs, old_file)) {
@@ -836,52 +1408,32 @@ tracker_monitor_fanotify_move (TrackerMonitor *object,
 		                                                                            new_file);
 	}
 
-	old_prefix = g_file_get_path (old_file);
-
 	/* Find out which subdirectories should have a file monitor added */
-	g_hash_table_iter_init (&iter, monitor->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, (gpointer *) &data)) {
-		gchar *old_path, *new_path;
-		gchar *new_prefix;
-		gchar *p;
-
-		if (!file_has_maybe_strict_prefix (iter_file, old_file, FALSE))
-			continue;
-
-		old_path = g_file_get_path (iter_file);
-		p = strstr (old_path, old_prefix);
+	descendants = tracker_file_trie_steal_descendants (monitor->monitored_tree,
+	                                                   old_file);
 
-		if (!p || strcmp (p, old_prefix) == 0) {
-			g_free (old_path);
-			continue;
-		}
+	for (l = descendants; l; l = l->next) {
+		gchar *relative_path;
 
-		/* Move to end of prefix */
-		p += strlen (old_prefix) + 1;
+		f = l->data;
+		relative_path = g_file_get_relative_path (old_file, f);
 
-		/* Check this is not the end of the string */
-		if (*p == '\0') {
-			g_free (old_path);
+		if (!relative_path) {
+			tracker_file_trie_insert (monitor->monitored_tree, f, f);
 			continue;
 		}
 
-		new_prefix = g_file_get_path (new_file);
-		new_path = g_build_path (G_DIR_SEPARATOR_S, new_prefix, p, NULL);
-		g_free (new_prefix);
-
-		f = g_file_new_for_path (new_path);
-		g_free (new_path);
-
-		files = g_list_prepend (files, g_object_ref (f));
-		if (data)
-			g_hash_table_remove (monitor->handles, data->handle_bytes);
-		g_hash_table_iter_remove (&iter);
-
+		files = g_list_prepend (files,
+		                        g_file_resolve_relative_path (new_file,
+		                                                      relative_path));
+		remove_monitored_dir (monitor, f);
 		g_object_unref (f);
-		g_free (old_path);
+		g_free (relative_path);
 		items_moved++;
 	}
 
+	g_list_free (descendants);
+
 	while (files) {
 		f = files->data;
 		tracker_monitor_fanotify_add (object, f);
@@ -889,8 +1441,6 @@ tracker_monitor_fanotify_move (TrackerMonitor *object,
 		g_object_unref (f);
 	}
 
-	g_free (old_prefix);
-
 	return items_moved > 0;
 }
 
@@ -955,17 +1505,24 @@ tracker_monitor_fanotify_init (TrackerMonitorFanotify *monitor)
 {
 	/* By default we enable monitoring */
 	monitor->enabled = TRUE;
+	/* Filesystem-wide marks are used if the process is privileged enough */
+	monitor->filesystem_marks = TRUE;
 
 	monitor->monitored_dirs =
 		g_hash_table_new_full (g_file_hash,
 		                       (GEqualFunc) g_file_equal,
 		                       (GDestroyNotify) g_object_unref,
 		                       (GDestroyNotify) monitored_file_free);
+	monitor->monitored_tree = tracker_file_trie_new (g_object_unref);
 	monitor->cached_events =
-		g_hash_table_new_full (g_file_hash,
-		                       (GEqualFunc) g_file_equal,
+		g_hash_table_new_full (monitor_event_hash,
+		                       monitor_event_equal,
+		                       (GDestroyNotify) monitor_event_free,
+		                       NULL);
+
+	monitor->handles = g_hash_table_new (handle_data_hash, handle_data_equal);
+	monitor->filesystems =
+		g_hash_table_new_full (fsid_hash, fsid_equal,
 		                       NULL,
-		                       (GDestroyNotify) monitor_event_free);
-
-	monitor->handles = g_hash_table_new (g_bytes_hash, g_bytes_equal);
+		                       (GDestroyNotify) filesystem_mark_free);
 }
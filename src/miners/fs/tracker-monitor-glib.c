@@ -30,6 +30,7 @@
 #define TRACKER_MONITOR_KQUEUE
 #endif
 
+#include "tracker-file-trie.h"
 #include "tracker-monitor-glib.h"
 #include "tracker-monitor-private.h"
 
@@ -39,24 +40,51 @@ typedef struct TrackerMonitorGlibPrivate  TrackerMonitorGlibPrivate;
 
 struct TrackerMonitorGlibPrivate {
 	GHashTable    *monitored_dirs;
+	/* The same directories, so subtrees can be found on moves
+	 * and recursive removals.
+	 */
+	TrackerFileTrie *monitored_tree;
 
 	gboolean       enabled;
 
 	guint          monitor_limit;
 	gboolean       monitor_limit_warned;
-	guint          monitors_ignored;
+	guint          watch_budget;
+
+	/* Last time each watched directory had events, in seconds */
+	GHashTable    *activity;
+
+	/* Directories over the watch limit, their mtime is checked
+	 * periodically instead.
+	 */
+	GHashTable    *polled_dirs;
+	TrackerFileTrie *polled_tree;
+	GQueue         poll_queue;
+	GSource       *poll_source;
+
+	/* Requests accumulated while in a batch */
+	GQueue         pending_requests;
+	guint          batch_depth;
 
 	/* For FAM, the _CHANGES_DONE event is not signalled, so we
 	 * have to just use the _CHANGED event instead.
 	 */
 	gboolean       use_changed_event;
 
+	/* Bounds in milliseconds of the delay of updates of files
+	 * changing often, read from the monitor thread.
+	 */
+	gint           min_update_delay;
+	gint           max_update_delay;
+
 	struct {
 		GMainContext *owner_context;
 		GMainContext *monitor_context;
 		GMainLoop *monitor_thread_loop;
 		GThread *monitor_thread;
 		GHashTable *cached_events;
+		GHashTable *hot_files;
+		guint hot_files_prune_size;
 		GHashTable *monitors;
 		GMutex mutex;
 		GCond cond;
@@ -64,6 +92,18 @@ struct TrackerMonitorGlibPrivate {
 	} thread;
 };
 
+typedef struct {
+	GFile *file;
+	GList *link;
+	gint64 mtime;
+} PolledDir;
+
+/* Update history of a recently updated file */
+typedef struct {
+	gint64 last_flush;
+	guint delay;
+} HotFile;
+
 typedef struct {
 	GFile    *file;
 	gchar    *file_uri;
@@ -111,6 +151,15 @@ enum {
 	PROP_IGNORED,
 };
 
+/* Interval between checks of polled directories, and the number
+ * of them checked each time.
+ */
+#define POLL_INTERVAL_S 30
+#define MAX_POLLED_PER_CHECK 1000
+
+/* Size of the update history that triggers pruning of cooled files */
+#define HOT_FILES_PRUNE_SIZE 1024
+
 static void           tracker_monitor_glib_finalize     (GObject        *object);
 static void           tracker_monitor_glib_set_property (GObject        *object,
                                                          guint           prop_id,
@@ -125,6 +174,19 @@ static guint          get_inotify_limit            (void);
 static GFileMonitor * directory_monitor_new        (TrackerMonitorGlib *monitor,
                                                     GFile              *file);
 static void           directory_monitor_cancel     (GFileMonitor     *dir_monitor);
+static guint          get_watch_limit              (TrackerMonitorGlibPrivate *priv);
+static gboolean       poll_directories_cb          (gpointer          user_data);
+static gint64         query_directory_mtime        (GFile            *file);
+static void           poll_directory               (TrackerMonitorGlib *monitor,
+                                                    GFile              *file,
+                                                    gint64              mtime);
+static void           tracker_monitor_glib_set_watch_budget (TrackerMonitor *monitor,
+                                                             guint           budget);
+static void           tracker_monitor_glib_set_update_delays (TrackerMonitor *monitor,
+                                                              guint           min_delay,
+                                                              guint           max_delay);
+static void           tracker_monitor_glib_begin_batch (TrackerMonitor *monitor);
+static void           tracker_monitor_glib_end_batch   (TrackerMonitor *monitor);
 
 
 static gboolean       monitor_cancel_recursively   (TrackerMonitorGlib *monitor,
@@ -313,6 +375,10 @@ tracker_monitor_glib_class_init (TrackerMonitorGlibClass *klass)
 	monitor_class->is_watched = tracker_monitor_glib_is_watched;
 	monitor_class->set_enabled = tracker_monitor_glib_set_enabled;
 	monitor_class->get_count = tracker_monitor_glib_get_count;
+	monitor_class->set_watch_budget = tracker_monitor_glib_set_watch_budget;
+	monitor_class->set_update_delays = tracker_monitor_glib_set_update_delays;
+	monitor_class->begin_batch = tracker_monitor_glib_begin_batch;
+	monitor_class->end_batch = tracker_monitor_glib_end_batch;
 
 	g_object_class_override_property (object_class, PROP_ENABLED, "enabled");
 	g_object_class_override_property (object_class, PROP_LIMIT, "limit");
@@ -365,12 +431,32 @@ tracker_monitor_glib_init (TrackerMonitorGlib *object)
 		                       (GEqualFunc) g_file_equal,
 		                       (GDestroyNotify) g_object_unref,
 		                       NULL);
+	priv->monitored_tree = tracker_file_trie_new (g_object_unref);
+	priv->activity =
+		g_hash_table_new_full (g_file_hash,
+		                       (GEqualFunc) g_file_equal,
+		                       (GDestroyNotify) g_object_unref,
+		                       NULL);
+	priv->polled_dirs =
+		g_hash_table_new_full (g_file_hash,
+		                       (GEqualFunc) g_file_equal,
+		                       (GDestroyNotify) g_object_unref,
+		                       g_free);
+	priv->polled_tree = tracker_file_trie_new (NULL);
+	g_queue_init (&priv->poll_queue);
+	g_queue_init (&priv->pending_requests);
 
 	priv->thread.cached_events =
 		g_hash_table_new_full (g_file_hash,
 		                       (GEqualFunc) g_file_equal,
 		                       g_object_unref,
 		                       (GDestroyNotify) monitor_event_free);
+	priv->thread.hot_files =
+		g_hash_table_new_full (g_file_hash,
+		                       (GEqualFunc) g_file_equal,
+		                       g_object_unref,
+		                       g_free);
+	priv->thread.hot_files_prune_size = HOT_FILES_PRUNE_SIZE;
 
 	priv->thread.monitors =
 		g_hash_table_new_full (g_file_hash,
@@ -413,8 +499,21 @@ tracker_monitor_glib_finalize (GObject *object)
 	g_clear_pointer (&priv->thread.monitor_context, g_main_context_unref);
 	g_clear_pointer (&priv->thread.owner_context, g_main_context_unref);
 	g_clear_pointer (&priv->thread.cached_events, g_hash_table_unref);
+	g_clear_pointer (&priv->thread.hot_files, g_hash_table_unref);
 	g_clear_pointer (&priv->thread.monitors, g_hash_table_unref);
 
+	if (priv->poll_source) {
+		g_source_destroy (priv->poll_source);
+		g_source_unref (priv->poll_source);
+	}
+
+	g_queue_clear (&priv->poll_queue);
+	g_queue_clear_full (&priv->pending_requests,
+	                    (GDestroyNotify) monitor_request_free);
+	tracker_file_trie_free (priv->polled_tree);
+	g_hash_table_unref (priv->polled_dirs);
+	g_hash_table_unref (priv->activity);
+	tracker_file_trie_free (priv->monitored_tree);
 	g_hash_table_unref (priv->monitored_dirs);
 
 	G_OBJECT_CLASS (tracker_monitor_glib_parent_class)->finalize (object);
@@ -451,13 +550,13 @@ tracker_monitor_glib_get_property (GObject      *object,
 		g_value_set_boolean (value, priv->enabled);
 		break;
 	case PROP_LIMIT:
-		g_value_set_uint (value, priv->monitor_limit);
+		g_value_set_uint (value, get_watch_limit (priv));
 		break;
 	case PROP_COUNT:
 		g_value_set_uint (value, tracker_monitor_get_count (TRACKER_MONITOR (object)));
 		break;
 	case PROP_IGNORED:
-		g_value_set_uint (value, priv->monitors_ignored);
+		g_value_set_uint (value, g_hash_table_size (priv->polled_dirs));
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -578,20 +677,53 @@ monitor_request_execute (MonitorRequest *request)
 	return G_SOURCE_REMOVE;
 }
 
+static void
+monitor_request_free (MonitorRequest *request)
+{
+	g_list_free_full (request->files, g_object_unref);
+	g_free (request);
+}
+
 /* Executed in main thread */
 static void
+flush_requests (TrackerMonitorGlib *monitor)
+{
+	TrackerMonitorGlibPrivate *priv;
+	MonitorRequest *request;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+
+	while ((request = g_queue_pop_head (&priv->pending_requests)) != NULL) {
+		g_atomic_int_inc (&priv->thread.n_requests);
+		g_main_context_invoke_full (priv->thread.monitor_context,
+		                            G_PRIORITY_DEFAULT,
+		                            (GSourceFunc) monitor_request_execute,
+		                            request, g_free);
+	}
+}
+
+/* Executed in main thread. Within a batch, consecutive requests of
+ * the same type are merged, so the monitor thread handles them at once.
+ */
+static void
 monitor_request_queue (TrackerMonitorGlib *monitor,
                        MonitorRequest     *request)
 {
 	TrackerMonitorGlibPrivate *priv;
+	MonitorRequest *last;
 
 	priv = tracker_monitor_glib_get_instance_private (monitor);
+	last = g_queue_peek_tail (&priv->pending_requests);
+
+	if (last && last->type == request->type) {
+		last->files = g_list_concat (last->files, request->files);
+		g_free (request);
+	} else {
+		g_queue_push_tail (&priv->pending_requests, request);
+	}
 
-	g_atomic_int_inc (&priv->thread.n_requests);
-	g_main_context_invoke_full (priv->thread.monitor_context,
-	                            G_PRIORITY_DEFAULT,
-	                            (GSourceFunc) monitor_request_execute,
-	                            request, g_free);
+	if (priv->batch_depth == 0)
+		flush_requests (monitor);
 }
 
 static void
@@ -601,6 +733,10 @@ block_for_requests (TrackerMonitorGlib *monitor)
 
 	priv = tracker_monitor_glib_get_instance_private (monitor);
 
+	/* Waited for at the end of the batch */
+	if (priv->batch_depth > 0)
+		return;
+
 	g_mutex_lock (&priv->thread.mutex);
 
 	while (g_atomic_int_get (&priv->thread.n_requests) != 0)
@@ -615,10 +751,8 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
                            GFile          *new_file)
 {
 	TrackerMonitorGlibPrivate *priv;
-	GHashTableIter iter;
 	MonitorRequest *request;
-	gchar *old_prefix;
-	gpointer iter_file;
+	GList *descendants, *polled = NULL, *l;
 	guint items_moved = 0;
 
 	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
@@ -637,52 +771,46 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
 	request->monitor = TRACKER_MONITOR_GLIB (monitor);
 	request->type = MONITOR_REQUEST_ADD;
 
-	old_prefix = g_file_get_path (old_file);
-
 	/* Find out which subdirectories should have a file monitor added */
-	g_hash_table_iter_init (&iter, priv->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, NULL)) {
-		GFile *f;
-		gchar *old_path, *new_path;
-		gchar *new_prefix;
-		gchar *p;
-
-		if (!g_file_has_prefix (iter_file, old_file) &&
-		    !g_file_equal (iter_file, old_file)) {
-			continue;
-		}
+	descendants = tracker_file_trie_get_descendants (priv->monitored_tree,
+	                                                 old_file);
 
-		old_path = g_file_get_path (iter_file);
-		p = strstr (old_path, old_prefix);
+	for (l = descendants; l; l = l->next) {
+		gchar *relative_path;
 
-		if (!p || strcmp (p, old_prefix) == 0) {
-			g_free (old_path);
+		relative_path = g_file_get_relative_path (old_file, l->data);
+		if (!relative_path)
 			continue;
-		}
 
-		/* Move to end of prefix */
-		p += strlen (old_prefix) + 1;
+		request->files = g_list_prepend (request->files,
+		                                 g_file_resolve_relative_path (new_file,
+		                                                               relative_path));
+		g_free (relative_path);
+		items_moved++;
+	}
 
-		/* Check this is not the end of the string */
-		if (*p == '\0') {
-			g_free (old_path);
-			continue;
-		}
+	g_list_free (descendants);
 
-		new_prefix = g_file_get_path (new_file);
-		new_path = g_build_path (G_DIR_SEPARATOR_S, new_prefix, p, NULL);
-		g_free (new_prefix);
+	/* Periodically checked subdirectories keep being checked */
+	descendants = tracker_file_trie_get_descendants (priv->polled_tree,
+	                                                 old_file);
 
-		f = g_file_new_for_path (new_path);
-		g_free (new_path);
+	for (l = descendants; l; l = l->next) {
+		PolledDir *dir = l->data;
+		gchar *relative_path;
 
-		request->files = g_list_prepend (request->files, g_object_ref (f));
+		relative_path = g_file_get_relative_path (old_file, dir->file);
+		if (!relative_path)
+			continue;
 
-		g_object_unref (f);
-		g_free (old_path);
-		items_moved++;
+		polled = g_list_prepend (polled,
+		                         g_file_resolve_relative_path (new_file,
+		                                                       relative_path));
+		g_free (relative_path);
 	}
 
+	g_list_free (descendants);
+
 	/* Add a new monitor for the top level directory */
 	tracker_monitor_glib_add (monitor, new_file);
 
@@ -692,7 +820,15 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
 	/* Remove the monitor for the old top level directory hierarchy */
 	tracker_monitor_glib_remove_recursively (monitor, old_file, FALSE);
 
-	g_free (old_prefix);
+	for (l = polled; l; l = l->next) {
+		gint64 mtime;
+
+		mtime = query_directory_mtime (l->data);
+		if (mtime >= 0)
+			poll_directory (TRACKER_MONITOR_GLIB (monitor), l->data, mtime);
+	}
+
+	g_list_free_full (polled, g_object_unref);
 
 	block_for_requests (TRACKER_MONITOR_GLIB (monitor));
 
@@ -731,6 +867,32 @@ monitor_event_to_string (GFileMonitorEvent event_type)
 	return "unknown";
 }
 
+static gint
+get_seconds (void)
+{
+	return (gint) (g_get_monotonic_time () / G_USEC_PER_SEC);
+}
+
+/* Executed in main thread */
+static void
+note_activity (TrackerMonitorGlib *monitor,
+               GFile              *file)
+{
+	TrackerMonitorGlibPrivate *priv;
+	GFile *parent;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+	parent = g_file_get_parent (file);
+
+	if (parent && g_hash_table_contains (priv->monitored_dirs, parent)) {
+		g_hash_table_replace (priv->activity, parent,
+		                      GINT_TO_POINTER (get_seconds ()));
+		return;
+	}
+
+	g_clear_object (&parent);
+}
+
 /* Executed in main thread */
 static gboolean
 emit_signal_for_event (MonitorEvent *event)
@@ -740,6 +902,10 @@ emit_signal_for_event (MonitorEvent *event)
 	GFile *file = event->file;
 	GFile *other_file = event->other_file;
 
+	note_activity (event->monitor, file);
+	if (other_file)
+		note_activity (event->monitor, other_file);
+
 	switch (event->event_type) {
 	case G_FILE_MONITOR_EVENT_CREATED:
 		tracker_monitor_emit_created (monitor, file, is_directory);
@@ -835,6 +1001,11 @@ flush_event_idle_cb (gpointer user_data)
        MonitorEvent *event = user_data;
        TrackerMonitorGlibPrivate *priv =
 	       tracker_monitor_glib_get_instance_private (event->monitor);
+       HotFile *hot;
+
+       hot = g_hash_table_lookup (priv->thread.hot_files, event->file);
+       if (hot)
+	       hot->last_flush = g_get_monotonic_time ();
 
        queue_signal_for_event (event->monitor, event->event_type,
                                event->is_directory, event->file, NULL);
@@ -845,7 +1016,8 @@ flush_event_idle_cb (gpointer user_data)
 
 static void
 flush_event_later (TrackerMonitorGlib *monitor,
-                   GFile              *file)
+                   GFile              *file,
+                   guint               delay)
 {
        TrackerMonitorGlibPrivate *priv =
 	       tracker_monitor_glib_get_instance_private (monitor);
@@ -855,12 +1027,88 @@ flush_event_later (TrackerMonitorGlib *monitor,
        if (!event)
                return;
 
-       event->source = g_idle_source_new ();
+       if (delay > 0)
+	       event->source = g_timeout_source_new (delay);
+       else
+	       event->source = g_idle_source_new ();
+
        g_source_set_callback (event->source, flush_event_idle_cb, event, NULL);
        g_source_attach (event->source,
                         priv->thread.monitor_context);
 }
 
+/* Executed in monitor thread */
+static void
+prune_hot_files (TrackerMonitorGlibPrivate *priv,
+                 gint64                     now)
+{
+	GHashTableIter iter;
+	HotFile *hot;
+
+	g_hash_table_iter_init (&iter, priv->thread.hot_files);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &hot)) {
+		if (now - hot->last_flush > (gint64) hot->delay * 1000)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	priv->thread.hot_files_prune_size =
+		MAX (HOT_FILES_PRUNE_SIZE,
+		     g_hash_table_size (priv->thread.hot_files) * 2);
+}
+
+/* Executed in monitor thread. Returns how many milliseconds the
+ * update of @file should be held back. Files updated again while
+ * within the delay of their last update are considered hot, and
+ * the delay doubles for each further update arriving within it.
+ * Files quiet for longer start over without delay.
+ */
+static guint
+get_update_delay (TrackerMonitorGlib *monitor,
+                  GFile              *file)
+{
+	TrackerMonitorGlibPrivate *priv;
+	guint min_delay, max_delay, delay;
+	gint64 now;
+	HotFile *hot;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+	min_delay = g_atomic_int_get (&priv->min_update_delay);
+	max_delay = MAX (min_delay, (guint) g_atomic_int_get (&priv->max_update_delay));
+
+	if (min_delay == 0)
+		return 0;
+
+	now = g_get_monotonic_time ();
+	hot = g_hash_table_lookup (priv->thread.hot_files, file);
+
+	if (!hot || now - hot->last_flush > (gint64) hot->delay * 1000) {
+		if (!hot) {
+			if (g_hash_table_size (priv->thread.hot_files) >=
+			    priv->thread.hot_files_prune_size)
+				prune_hot_files (priv, now);
+
+			hot = g_new0 (HotFile, 1);
+			g_hash_table_insert (priv->thread.hot_files,
+			                     g_object_ref (file), hot);
+		}
+
+		hot->delay = min_delay;
+		hot->last_flush = now;
+
+		return 0;
+	}
+
+	delay = hot->delay;
+	hot->delay = MIN (hot->delay * 2, max_delay);
+
+	TRACKER_NOTE (MONITORS,
+	              g_message ("Holding back update of hot file '%s' for %d ms",
+	                         g_file_peek_path (file), delay));
+
+	return delay;
+}
+
 /* Executed in monitor thread */
 static void
 monitor_event_cb (GFileMonitor      *file_monitor,
@@ -875,6 +1123,7 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 	gboolean is_directory = FALSE;
 	TrackerMonitorGlibPrivate *priv;
 	MonitorEvent *prev_event;
+	guint delay;
 
 	monitor = user_data;
 	priv = tracker_monitor_glib_get_instance_private (monitor);
@@ -984,16 +1233,26 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 
 		/* In any case, cached events are stale */
 		g_hash_table_remove (priv->thread.cached_events, file);
+		g_hash_table_remove (priv->thread.hot_files, file);
 
 		cache_event (monitor, file, event_type, is_directory);
-		flush_event_later (monitor, file);
+		flush_event_later (monitor, file, 0);
 		break;
 	case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
 		queue_signal_for_event (monitor, event_type,
 		                        is_directory, file, NULL);
 		break;
 	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-		flush_cached_event (monitor, file);
+		/* Held back updates take in further changes */
+		if (!prev_event || prev_event->source)
+			break;
+
+		delay = get_update_delay (monitor, file);
+
+		if (delay > 0)
+			flush_event_later (monitor, file, delay);
+		else
+			flush_cached_event (monitor, file);
 		break;
 	case G_FILE_MONITOR_EVENT_MOVED_IN:
 		if (other_file) {
@@ -1110,34 +1369,44 @@ tracker_monitor_glib_set_enabled (TrackerMonitor *object,
 	block_for_requests (monitor);
 }
 
-static gboolean
-tracker_monitor_glib_add (TrackerMonitor *monitor,
-                          GFile          *file)
+static guint
+get_watch_limit (TrackerMonitorGlibPrivate *priv)
 {
-	TrackerMonitorGlibPrivate *priv;
-	gchar *uri;
+	if (priv->watch_budget > 0)
+		return MIN (priv->watch_budget, priv->monitor_limit);
 
-	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
-
-	if (g_hash_table_lookup (priv->monitored_dirs, file)) {
-		return TRUE;
-	}
-
-	/* Cap the number of monitors */
-	if (g_hash_table_size (priv->monitored_dirs) >= priv->monitor_limit) {
-		priv->monitors_ignored++;
+	return priv->monitor_limit;
+}
 
-		if (!priv->monitor_limit_warned) {
-			g_warning ("The maximum number of monitors to set (%d) "
-			           "has been reached, not adding any new ones",
-			           priv->monitor_limit);
-			priv->monitor_limit_warned = TRUE;
-		}
+static gint64
+query_directory_mtime (GFile *file)
+{
+	GFileInfo *info;
+	gint64 mtime;
+
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, NULL);
+	if (!info)
+		return -1;
+
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref (info);
+
+	return mtime;
+}
 
-		return FALSE;
-	}
+static void
+watch_directory (TrackerMonitorGlib *monitor,
+                 GFile              *file)
+{
+	TrackerMonitorGlibPrivate *priv;
+	gchar *uri;
 
-	uri = g_file_get_uri (file);
+	priv = tracker_monitor_glib_get_instance_private (monitor);
 
 	if (priv->enabled) {
 		/* We don't check if a file exists or not since we might want
@@ -1148,68 +1417,359 @@ tracker_monitor_glib_add (TrackerMonitor *monitor,
 		MonitorRequest *request;
 
 		request = g_new0 (MonitorRequest, 1);
-		request->monitor = TRACKER_MONITOR_GLIB (monitor);
+		request->monitor = monitor;
 		request->files = g_list_prepend (NULL, g_object_ref (file));
 		request->type = MONITOR_REQUEST_ADD;
 
-		monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), request);
-		block_for_requests (TRACKER_MONITOR_GLIB (monitor));
+		monitor_request_queue (monitor, request);
+		block_for_requests (monitor);
 	}
 
-	g_hash_table_add (priv->monitored_dirs, g_object_ref (file));
+	if (g_hash_table_add (priv->monitored_dirs, g_object_ref (file)))
+		tracker_file_trie_insert (priv->monitored_tree, file, g_object_ref (file));
+	g_hash_table_replace (priv->activity, g_object_ref (file),
+	                      GINT_TO_POINTER (get_seconds ()));
 
+	uri = g_file_get_uri (file);
 	TRACKER_NOTE (MONITORS, g_message ("Added monitor for path:'%s', total monitors:%d",
 	                                   uri,
 	                                   g_hash_table_size (priv->monitored_dirs)));
-
 	g_free (uri);
+}
+
+static gboolean
+unwatch_directory (TrackerMonitorGlibPrivate *priv,
+                   GFile                     *file)
+{
+	GFile *dir;
+
+	dir = tracker_file_trie_remove (priv->monitored_tree, file);
+	if (!dir)
+		return FALSE;
+
+	g_hash_table_remove (priv->monitored_dirs, dir);
+	g_object_unref (dir);
 
 	return TRUE;
 }
 
+static void
+poll_directory (TrackerMonitorGlib *monitor,
+                GFile              *file,
+                gint64              mtime)
+{
+	TrackerMonitorGlibPrivate *priv;
+	PolledDir *dir;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+
+	dir = g_new0 (PolledDir, 1);
+	dir->file = g_object_ref (file);
+	dir->mtime = mtime;
+	g_queue_push_tail (&priv->poll_queue, dir);
+	dir->link = priv->poll_queue.tail;
+	g_hash_table_insert (priv->polled_dirs, dir->file, dir);
+	tracker_file_trie_insert (priv->polled_tree, dir->file, dir);
+
+	if (!priv->poll_source) {
+		priv->poll_source = g_timeout_source_new_seconds (POLL_INTERVAL_S);
+		g_source_set_callback (priv->poll_source,
+		                       poll_directories_cb,
+		                       monitor, NULL);
+		g_source_attach (priv->poll_source, priv->thread.owner_context);
+	}
+}
+
 static gboolean
-tracker_monitor_glib_remove (TrackerMonitor *monitor,
-                             GFile          *file)
+unpoll_directory (TrackerMonitorGlibPrivate *priv,
+                  GFile                     *file)
+{
+	PolledDir *dir;
+
+	dir = g_hash_table_lookup (priv->polled_dirs, file);
+	if (!dir)
+		return FALSE;
+
+	g_queue_delete_link (&priv->poll_queue, dir->link);
+	tracker_file_trie_remove (priv->polled_tree, file);
+	g_hash_table_remove (priv->polled_dirs, file);
+
+	return TRUE;
+}
+
+static gint
+compare_activity (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+	GHashTable *activity = user_data;
+	gint time_a, time_b;
+
+	time_a = GPOINTER_TO_INT (g_hash_table_lookup (activity, *((GFile **) a)));
+	time_b = GPOINTER_TO_INT (g_hash_table_lookup (activity, *((GFile **) b)));
+
+	return time_a - time_b;
+}
+
+/* Replaces the watches of the @n least recently active directories
+ * with periodic checks.
+ */
+static void
+demote_directories (TrackerMonitorGlib *monitor,
+                    guint               n)
+{
+	TrackerMonitorGlibPrivate *priv;
+	MonitorRequest *request;
+	GHashTableIter iter;
+	GPtrArray *dirs;
+	gpointer file;
+	guint i;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+	n = MIN (n, g_hash_table_size (priv->monitored_dirs));
+
+	if (n == 0)
+		return;
+
+	dirs = g_ptr_array_sized_new (g_hash_table_size (priv->monitored_dirs));
+	g_hash_table_iter_init (&iter, priv->monitored_dirs);
+	while (g_hash_table_iter_next (&iter, &file, NULL))
+		g_ptr_array_add (dirs, g_object_ref (file));
+
+	g_ptr_array_sort_with_data (dirs, compare_activity, priv->activity);
+
+	request = g_new0 (MonitorRequest, 1);
+	request->monitor = monitor;
+	request->type = MONITOR_REQUEST_REMOVE;
+
+	for (i = 0; i < n; i++) {
+		GFile *dir = g_ptr_array_index (dirs, i);
+		gint64 mtime;
+
+		/* Read before the watch is gone, so nothing is missed */
+		mtime = query_directory_mtime (dir);
+
+		g_hash_table_remove (priv->activity, dir);
+		unwatch_directory (priv, dir);
+		request->files = g_list_prepend (request->files, g_object_ref (dir));
+
+		if (mtime >= 0)
+			poll_directory (monitor, dir, mtime);
+	}
+
+	TRACKER_NOTE (MONITORS,
+	              g_message ("Replaced %d inactive monitors with periodic checks, "
+	                         "total monitors:%d, checked:%d",
+	                         n, g_hash_table_size (priv->monitored_dirs),
+	                         g_hash_table_size (priv->polled_dirs)));
+
+	g_ptr_array_free (dirs, TRUE);
+
+	if (priv->enabled) {
+		monitor_request_queue (monitor, request);
+		block_for_requests (monitor);
+	} else {
+		monitor_request_free (request);
+	}
+}
+
+/* Executed in main thread */
+static gboolean
+poll_directories_cb (gpointer user_data)
+{
+	TrackerMonitorGlib *monitor = user_data;
+	TrackerMonitorGlibPrivate *priv;
+	GList *changed = NULL, *l;
+	guint i, n, limit;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+
+	if (!priv->enabled)
+		return G_SOURCE_CONTINUE;
+
+	n = MIN (MAX_POLLED_PER_CHECK, g_queue_get_length (&priv->poll_queue));
+
+	for (i = 0; i < n; i++) {
+		GList *link;
+		PolledDir *dir;
+		gint64 mtime;
+
+		link = g_queue_pop_head_link (&priv->poll_queue);
+		dir = link->data;
+		mtime = query_directory_mtime (dir->file);
+
+		if (mtime != dir->mtime) {
+			changed = g_list_prepend (changed, g_object_ref (dir->file));
+			g_list_free (link);
+			tracker_file_trie_remove (priv->polled_tree, dir->file);
+			g_hash_table_remove (priv->polled_dirs, dir->file);
+		} else {
+			g_queue_push_tail_link (&priv->poll_queue, link);
+		}
+	}
+
+	/* Changed directories get watched again, in place of the least
+	 * recently active ones.
+	 */
+	limit = get_watch_limit (priv);
+	n = g_list_length (changed);
+
+	if (g_hash_table_size (priv->monitored_dirs) + n > limit)
+		demote_directories (monitor, g_hash_table_size (priv->monitored_dirs) + n - limit);
+
+	for (l = changed; l; l = l->next) {
+		GFile *file = l->data;
+
+		TRACKER_NOTE (MONITORS,
+		              g_message ("Checked directory '%s' changed, watching it",
+		                         g_file_peek_path (file)));
+
+		if (g_file_query_exists (file, NULL))
+			watch_directory (monitor, file);
+
+		tracker_monitor_emit_overflow (TRACKER_MONITOR (monitor), file);
+	}
+
+	g_list_free_full (changed, g_object_unref);
+
+	if (g_queue_is_empty (&priv->poll_queue)) {
+		g_clear_pointer (&priv->poll_source, g_source_unref);
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+tracker_monitor_glib_add (TrackerMonitor *monitor,
+                          GFile          *file)
 {
 	TrackerMonitorGlibPrivate *priv;
-	gboolean removed;
 
 	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
-	removed = g_hash_table_remove (priv->monitored_dirs, file);
 
-	if (removed) {
-		MonitorRequest *request;
-		gchar *uri;
+	if (g_hash_table_contains (priv->monitored_dirs, file) ||
+	    g_hash_table_contains (priv->polled_dirs, file)) {
+		return TRUE;
+	}
 
-		request = g_new0 (MonitorRequest, 1);
-		request->monitor = TRACKER_MONITOR_GLIB (monitor);
-		request->files = g_list_prepend (NULL, g_object_ref (file));
-		request->type = MONITOR_REQUEST_REMOVE;
+	/* Cap the number of monitors, further directories are
+	 * checked periodically instead.
+	 */
+	if (g_hash_table_size (priv->monitored_dirs) >= get_watch_limit (priv)) {
+		gint64 mtime;
 
-		monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), request);
+		if (!priv->monitor_limit_warned) {
+			g_warning ("The maximum number of monitors to set (%d) "
+			           "has been reached, further directories are "
+			           "checked every %d seconds",
+			           get_watch_limit (priv), POLL_INTERVAL_S);
+			priv->monitor_limit_warned = TRUE;
+		}
+
+		mtime = query_directory_mtime (file);
+		if (mtime < 0)
+			return FALSE;
+
+		poll_directory (TRACKER_MONITOR_GLIB (monitor), file, mtime);
+		return TRUE;
+	}
+
+	watch_directory (TRACKER_MONITOR_GLIB (monitor), file);
+
+	return TRUE;
+}
+
+static void
+tracker_monitor_glib_begin_batch (TrackerMonitor *monitor)
+{
+	TrackerMonitorGlibPrivate *priv;
+
+	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
+	priv->batch_depth++;
+}
+
+static void
+tracker_monitor_glib_end_batch (TrackerMonitor *monitor)
+{
+	TrackerMonitorGlibPrivate *priv;
+
+	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
+	g_return_if_fail (priv->batch_depth > 0);
+
+	priv->batch_depth--;
+
+	if (priv->batch_depth == 0) {
+		flush_requests (TRACKER_MONITOR_GLIB (monitor));
 		block_for_requests (TRACKER_MONITOR_GLIB (monitor));
+	}
+}
 
-		uri = g_file_get_uri (file);
-		TRACKER_NOTE (MONITORS, g_message ("Removed monitor for path:'%s', total monitors:%d",
-		                                   uri,
-		                                   g_hash_table_size (priv->monitored_dirs)));
+static void
+tracker_monitor_glib_set_watch_budget (TrackerMonitor *monitor,
+                                       guint           budget)
+{
+	TrackerMonitorGlibPrivate *priv;
+	guint limit;
 
-		g_free (uri);
+	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
+	priv->watch_budget = budget;
+	priv->monitor_limit_warned = FALSE;
+
+	limit = get_watch_limit (priv);
+	TRACKER_NOTE (MONITORS, g_message ("Monitor limit is %d", limit));
+
+	if (g_hash_table_size (priv->monitored_dirs) > limit) {
+		demote_directories (TRACKER_MONITOR_GLIB (monitor),
+		                    g_hash_table_size (priv->monitored_dirs) - limit);
 	}
 
-	return removed;
+	g_object_notify (G_OBJECT (monitor), "limit");
+}
+
+static void
+tracker_monitor_glib_set_update_delays (TrackerMonitor *monitor,
+                                        guint           min_delay,
+                                        guint           max_delay)
+{
+	TrackerMonitorGlibPrivate *priv;
+
+	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
+	g_atomic_int_set (&priv->min_update_delay, min_delay);
+	g_atomic_int_set (&priv->max_update_delay, max_delay);
 }
 
-/* If @is_strict is %TRUE, return %TRUE iff @file is a child of @prefix.
- * If @is_strict is %FALSE, additionally return %TRUE if @file equals @prefix.
- */
 static gboolean
-file_has_maybe_strict_prefix (GFile    *file,
-                              GFile    *prefix,
-                              gboolean  is_strict)
+tracker_monitor_glib_remove (TrackerMonitor *monitor,
+                             GFile          *file)
 {
-	return (g_file_has_prefix (file, prefix) ||
-	        (!is_strict && g_file_equal (file, prefix)));
+	TrackerMonitorGlibPrivate *priv;
+	MonitorRequest *request;
+	gchar *uri;
+
+	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
+
+	if (!unwatch_directory (priv, file))
+		return unpoll_directory (priv, file);
+
+	g_hash_table_remove (priv->activity, file);
+
+	request = g_new0 (MonitorRequest, 1);
+	request->monitor = TRACKER_MONITOR_GLIB (monitor);
+	request->files = g_list_prepend (NULL, g_object_ref (file));
+	request->type = MONITOR_REQUEST_REMOVE;
+
+	monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), request);
+	block_for_requests (TRACKER_MONITOR_GLIB (monitor));
+
+	uri = g_file_get_uri (file);
+	TRACKER_NOTE (MONITORS, g_message ("Removed monitor for path:'%s', total monitors:%d",
+	                                   uri,
+	                                   g_hash_table_size (priv->monitored_dirs)));
+
+	g_free (uri);
+
+	return TRUE;
 }
 
 static gboolean
@@ -1218,9 +1778,8 @@ remove_recursively (TrackerMonitorGlib *monitor,
                     gboolean            remove_top_level)
 {
 	TrackerMonitorGlibPrivate *priv;
-	GHashTableIter iter;
 	MonitorRequest *request;
-	gpointer iter_file;
+	GList *descendants, *l;
 	guint items_removed = 0;
 	gchar *uri;
 
@@ -1233,18 +1792,44 @@ remove_recursively (TrackerMonitorGlib *monitor,
 	request->monitor = monitor;
 	request->type = MONITOR_REQUEST_REMOVE;
 
-	g_hash_table_iter_init (&iter, priv->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, NULL)) {
-		if (!file_has_maybe_strict_prefix (iter_file, file,
-		                                   !remove_top_level)) {
+	descendants = tracker_file_trie_steal_descendants (priv->monitored_tree,
+	                                                   file);
+
+	for (l = descendants; l; l = l->next) {
+		GFile *dir = l->data;
+
+		if (!remove_top_level && g_file_equal (dir, file)) {
+			tracker_file_trie_insert (priv->monitored_tree, dir, dir);
 			continue;
 		}
 
-		request->files = g_list_prepend (request->files, g_object_ref (file));
-		g_hash_table_iter_remove (&iter);
+		g_hash_table_remove (priv->activity, dir);
+		g_hash_table_remove (priv->monitored_dirs, dir);
+		/* The request takes the reference held by the trie */
+		request->files = g_list_prepend (request->files, dir);
 		items_removed++;
 	}
 
+	g_list_free (descendants);
+
+	descendants = tracker_file_trie_steal_descendants (priv->polled_tree,
+	                                                   file);
+
+	for (l = descendants; l; l = l->next) {
+		PolledDir *dir = l->data;
+
+		if (!remove_top_level && g_file_equal (dir->file, file)) {
+			tracker_file_trie_insert (priv->polled_tree, dir->file, dir);
+			continue;
+		}
+
+		g_queue_delete_link (&priv->poll_queue, dir->link);
+		g_hash_table_remove (priv->polled_dirs, dir->file);
+		items_removed++;
+	}
+
+	g_list_free (descendants);
+
 	uri = g_file_get_uri (file);
 	TRACKER_NOTE (MONITORS,
 	              g_message ("Removed all monitors %srecursively for path:'%s', )"
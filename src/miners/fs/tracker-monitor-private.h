@@ -39,3 +39,5 @@ void tracker_monitor_emit_moved (TrackerMonitor *monitor,
                                  GFile          *file,
                                  GFile          *other_file,
                                  gboolean        is_directory);
+void tracker_monitor_emit_overflow (TrackerMonitor *monitor,
+                                    GFile          *file);
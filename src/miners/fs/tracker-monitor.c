@@ -33,6 +33,7 @@ enum {
 	ITEM_ATTRIBUTE_UPDATED,
 	ITEM_DELETED,
 	ITEM_MOVED,
+	OVERFLOW,
 	LAST_SIGNAL
 };
 
@@ -153,6 +154,19 @@ tracker_monitor_class_init (TrackerMonitorClass *klass)
 		              G_TYPE_OBJECT,
 		              G_TYPE_BOOLEAN,
 		              G_TYPE_BOOLEAN);
+	/* Emitted when events got lost, the file is the directory
+	 * that needs checking again, or %NULL for all of them.
+	 */
+	signals[OVERFLOW] =
+		g_signal_new ("overflow",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL, NULL,
+		              NULL,
+		              G_TYPE_NONE,
+		              1,
+		              G_TYPE_FILE);
 
 	pspecs[PROP_ENABLED] =
 		g_param_spec_boolean ("enabled",
@@ -320,6 +334,56 @@ tracker_monitor_get_limit (TrackerMonitor *monitor)
 	return limit;
 }
 
+/* Caps the number of directories watched individually, 0 leaves it up
+ * to the backend. Backends without per-directory watches ignore it.
+ */
+void
+tracker_monitor_set_watch_budget (TrackerMonitor *monitor,
+                                  guint           budget)
+{
+	g_return_if_fail (TRACKER_IS_MONITOR (monitor));
+
+	if (TRACKER_MONITOR_GET_CLASS (monitor)->set_watch_budget)
+		TRACKER_MONITOR_GET_CLASS (monitor)->set_watch_budget (monitor, budget);
+}
+
+/* Bounds the delay in milliseconds applied to updates of files that
+ * keep changing, a @min_delay of 0 emits all updates right away.
+ */
+void
+tracker_monitor_set_update_delays (TrackerMonitor *monitor,
+                                   guint           min_delay,
+                                   guint           max_delay)
+{
+	g_return_if_fail (TRACKER_IS_MONITOR (monitor));
+
+	if (TRACKER_MONITOR_GET_CLASS (monitor)->set_update_delays)
+		TRACKER_MONITOR_GET_CLASS (monitor)->set_update_delays (monitor,
+		                                                        min_delay,
+		                                                        max_delay);
+}
+
+/* Monitors added between these calls may be set up together, the
+ * batch is only waited for by tracker_monitor_end_batch().
+ */
+void
+tracker_monitor_begin_batch (TrackerMonitor *monitor)
+{
+	g_return_if_fail (TRACKER_IS_MONITOR (monitor));
+
+	if (TRACKER_MONITOR_GET_CLASS (monitor)->begin_batch)
+		TRACKER_MONITOR_GET_CLASS (monitor)->begin_batch (monitor);
+}
+
+void
+tracker_monitor_end_batch (TrackerMonitor *monitor)
+{
+	g_return_if_fail (TRACKER_IS_MONITOR (monitor));
+
+	if (TRACKER_MONITOR_GET_CLASS (monitor)->end_batch)
+		TRACKER_MONITOR_GET_CLASS (monitor)->end_batch (monitor);
+}
+
 void
 tracker_monitor_emit_created (TrackerMonitor *monitor,
                               GFile          *file,
@@ -373,6 +437,15 @@ tracker_monitor_emit_moved (TrackerMonitor *monitor,
 	               is_directory, TRUE);
 }
 
+void
+tracker_monitor_emit_overflow (TrackerMonitor *monitor,
+                               GFile          *file)
+{
+	g_signal_emit (monitor,
+	               signals[OVERFLOW], 0,
+	               file);
+}
+
 TrackerMonitor *
 tracker_monitor_new (GError **error)
 {
@@ -52,6 +52,13 @@ struct _TrackerMonitorClass {
 	void (* set_enabled) (TrackerMonitor *monitor,
 	                      gboolean        enabled);
 	guint (* get_count) (TrackerMonitor *monitor);
+	void (* set_watch_budget) (TrackerMonitor *monitor,
+	                           guint           budget);
+	void (* set_update_delays) (TrackerMonitor *monitor,
+	                            guint           min_delay,
+	                            guint           max_delay);
+	void (* begin_batch) (TrackerMonitor *monitor);
+	void (* end_batch) (TrackerMonitor *monitor);
 };
 
 GType           tracker_monitor_get_type             (void);
@@ -75,6 +82,13 @@ gboolean        tracker_monitor_is_watched           (TrackerMonitor *monitor,
 guint           tracker_monitor_get_count            (TrackerMonitor *monitor);
 guint           tracker_monitor_get_ignored          (TrackerMonitor *monitor);
 guint           tracker_monitor_get_limit            (TrackerMonitor *monitor);
+void            tracker_monitor_set_watch_budget     (TrackerMonitor *monitor,
+                                                      guint           budget);
+void            tracker_monitor_set_update_delays    (TrackerMonitor *monitor,
+                                                      guint           min_delay,
+                                                      guint           max_delay);
+void            tracker_monitor_begin_batch          (TrackerMonitor *monitor);
+void            tracker_monitor_end_batch            (TrackerMonitor *monitor);
 
 TrackerMonitor * tracker_monitor_new (GError **error);
 
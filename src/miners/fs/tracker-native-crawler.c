@@ -0,0 +1,426 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include "tracker-native-crawler.h"
+
+/* Enumerates local directories with getdents64() and statx(), in a
+ * single thread job per directory. This avoids the per-batch jobs of
+ * GFileEnumerator, and the generic attribute handling of GLocalFile.
+ * The resulting GFileInfos hold the same data that GIO would provide
+ * for the supported attributes.
+ */
+
+#if defined (HAVE_STATX) && defined (HAVE_GETDENTS64)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#define DIRENT_BUFFER_SIZE (32 * 1024)
+#define MAX_HIDDEN_FILE_SIZE (64 * 1024)
+
+#define STATX_MASK (STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_INO | \
+                    STATX_MTIME | STATX_ATIME | STATX_BTIME)
+
+struct linux_dirent64 {
+	guint64 d_ino;
+	gint64 d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+typedef struct {
+	gchar *path;
+	GFileAttributeMatcher *matcher;
+	gboolean inode_order;
+} EnumerateData;
+
+typedef struct {
+	guint64 inode;
+	gchar *name;
+} DirectoryEntry;
+
+static const gchar *supported_attributes[] = {
+	G_FILE_ATTRIBUTE_STANDARD_NAME,
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+	G_FILE_ATTRIBUTE_STANDARD_TYPE,
+	G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+	G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+	G_FILE_ATTRIBUTE_TIME_ACCESS,
+	G_FILE_ATTRIBUTE_TIME_ACCESS_USEC,
+	G_FILE_ATTRIBUTE_TIME_CREATED,
+	G_FILE_ATTRIBUTE_TIME_CREATED_USEC,
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+	G_FILE_ATTRIBUTE_UNIX_INODE,
+	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT,
+};
+
+static void
+enumerate_data_free (EnumerateData *data)
+{
+	g_file_attribute_matcher_unref (data->matcher);
+	g_free (data->path);
+	g_slice_free (EnumerateData, data);
+}
+
+static GHashTable *
+read_hidden_file (int dir_fd)
+{
+	GHashTable *hidden;
+	gchar *contents, *line, *next;
+	gssize len = 0, n;
+	int fd;
+
+	fd = openat (dir_fd, ".hidden", O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0)
+		return NULL;
+
+	contents = g_malloc (MAX_HIDDEN_FILE_SIZE + 1);
+
+	while (len < MAX_HIDDEN_FILE_SIZE) {
+		n = read (fd, &contents[len], MAX_HIDDEN_FILE_SIZE - len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+	}
+
+	close (fd);
+	contents[len] = '\0';
+
+	hidden = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (line = contents; line && *line; line = next) {
+		next = strchr (line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (*line)
+			g_hash_table_add (hidden, g_strdup (line));
+	}
+
+	g_free (contents);
+
+	return hidden;
+}
+
+static void
+directory_entry_clear (DirectoryEntry *entry)
+{
+	g_free (entry->name);
+}
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+	const DirectoryEntry *entry_a = a, *entry_b = b;
+
+	return (entry_a->inode > entry_b->inode) - (entry_a->inode < entry_b->inode);
+}
+
+static GFileType
+file_type_from_mode (guint16 mode)
+{
+	if (S_ISREG (mode))
+		return G_FILE_TYPE_REGULAR;
+	if (S_ISDIR (mode))
+		return G_FILE_TYPE_DIRECTORY;
+	if (S_ISLNK (mode))
+		return G_FILE_TYPE_SYMBOLIC_LINK;
+	if (S_ISCHR (mode) || S_ISBLK (mode) || S_ISFIFO (mode) || S_ISSOCK (mode))
+		return G_FILE_TYPE_SPECIAL;
+
+	return G_FILE_TYPE_UNKNOWN;
+}
+
+static void
+set_time (GFileInfo                 *info,
+          const gchar               *attribute,
+          const gchar               *usec_attribute,
+          struct statx_timestamp    *timestamp)
+{
+	g_file_info_set_attribute_uint64 (info, attribute, timestamp->tv_sec);
+	g_file_info_set_attribute_uint32 (info, usec_attribute, timestamp->tv_nsec / 1000);
+}
+
+static GFileInfo *
+create_file_info (int                    dir_fd,
+                  const gchar           *name,
+                  dev_t                  dir_device,
+                  GHashTable            *hidden,
+                  GFileAttributeMatcher *matcher)
+{
+	GFileInfo *info;
+	struct statx stx;
+	dev_t device;
+
+	if (statx (dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+	           STATX_MASK, &stx) < 0)
+		return NULL;
+
+	device = makedev (stx.stx_dev_major, stx.stx_dev_minor);
+
+	info = g_file_info_new ();
+	/* Setters ignore the attributes that were not requested */
+	g_file_info_set_attribute_mask (info, matcher);
+
+	g_file_info_set_name (info, name);
+	g_file_info_set_file_type (info, file_type_from_mode (stx.stx_mode));
+	g_file_info_set_size (info, stx.stx_size);
+	g_file_info_set_is_hidden (info,
+	                           name[0] == '.' ||
+	                           (hidden && g_hash_table_contains (hidden, name)));
+
+	if (g_file_attribute_matcher_matches (matcher, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME)) {
+		g_autofree gchar *display_name = NULL;
+
+		display_name = g_filename_display_name (name);
+		g_file_info_set_display_name (info, display_name);
+	}
+
+	set_time (info, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, &stx.stx_mtime);
+	set_time (info, G_FILE_ATTRIBUTE_TIME_ACCESS,
+	          G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, &stx.stx_atime);
+
+	if (stx.stx_mask & STATX_BTIME) {
+		set_time (info, G_FILE_ATTRIBUTE_TIME_CREATED,
+		          G_FILE_ATTRIBUTE_TIME_CREATED_USEC, &stx.stx_btime);
+	}
+
+	if (g_file_attribute_matcher_matches (matcher, G_FILE_ATTRIBUTE_ID_FILESYSTEM)) {
+		gchar id[32];
+
+		/* Same format as GLocalFile */
+		g_snprintf (id, sizeof (id), "l%" G_GUINT64_FORMAT, (guint64) device);
+		g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM, id);
+	}
+
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE, stx.stx_ino);
+	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT,
+	                                   device != dir_device);
+
+	g_file_info_unset_attribute_mask (info);
+
+	return info;
+}
+
+static void
+enumerate_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+	EnumerateData *data = task_data;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GArray) entries = NULL;
+	g_autoptr (GHashTable) hidden = NULL;
+	g_autofree gchar *buffer = NULL;
+	struct statx dir_stx;
+	dev_t dir_device;
+	guint i;
+	int fd, errsv = 0;
+
+	fd = open (data->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		errsv = errno;
+		goto error;
+	}
+
+	if (statx (fd, "", AT_EMPTY_PATH, STATX_INO, &dir_stx) < 0) {
+		errsv = errno;
+		close (fd);
+		goto error;
+	}
+
+	dir_device = makedev (dir_stx.stx_dev_major, dir_stx.stx_dev_minor);
+
+	if (g_file_attribute_matcher_matches (data->matcher, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN))
+		hidden = read_hidden_file (fd);
+
+	infos = g_ptr_array_new_with_free_func (g_object_unref);
+	buffer = g_malloc (DIRENT_BUFFER_SIZE);
+
+	if (data->inode_order) {
+		entries = g_array_new (FALSE, FALSE, sizeof (DirectoryEntry));
+		g_array_set_clear_func (entries, (GDestroyNotify) directory_entry_clear);
+	}
+
+	while (!g_cancellable_is_cancelled (cancellable)) {
+		long n, offset;
+
+		n = syscall (SYS_getdents64, fd, buffer, DIRENT_BUFFER_SIZE);
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < 0) {
+			errsv = errno;
+			break;
+		} else if (n == 0) {
+			break;
+		}
+
+		for (offset = 0; offset < n;) {
+			struct linux_dirent64 *entry;
+			GFileInfo *info;
+
+			entry = (struct linux_dirent64 *) &buffer[offset];
+			offset += entry->d_reclen;
+
+			if (strcmp (entry->d_name, ".") == 0 ||
+			    strcmp (entry->d_name, "..") == 0)
+				continue;
+
+			if (entries) {
+				DirectoryEntry dir_entry = { entry->d_ino, g_strdup (entry->d_name) };
+
+				g_array_append_val (entries, dir_entry);
+				continue;
+			}
+
+			/* Files may go away while enumerating */
+			info = create_file_info (fd, entry->d_name, dir_device,
+			                         hidden, data->matcher);
+			if (info)
+				g_ptr_array_add (infos, info);
+		}
+	}
+
+	/* Stat the files in the order of their inodes, which is mostly
+	 * the order of their metadata on disk.
+	 */
+	if (entries && errsv == 0) {
+		g_array_sort (entries, compare_entries);
+
+		for (i = 0; i < entries->len && !g_cancellable_is_cancelled (cancellable); i++) {
+			DirectoryEntry *dir_entry = &g_array_index (entries, DirectoryEntry, i);
+			GFileInfo *info;
+
+			info = create_file_info (fd, dir_entry->name, dir_device,
+			                         hidden, data->matcher);
+			if (info)
+				g_ptr_array_add (infos, info);
+		}
+	}
+
+	close (fd);
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	if (errsv == 0) {
+		g_task_return_pointer (task, g_steal_pointer (&infos),
+		                       (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+
+ error:
+	g_task_return_new_error (task, G_IO_ERROR,
+	                         g_io_error_from_errno (errsv),
+	                         "Error enumerating '%s': %s",
+	                         data->path, g_strerror (errsv));
+}
+
+#endif /* HAVE_STATX && HAVE_GETDENTS64 */
+
+/* Returns whether all of @attributes can be provided by this
+ * crawler. Otherwise GIO should be used.
+ */
+gboolean
+tracker_native_crawler_supports_attributes (const gchar *attributes)
+{
+#if defined (HAVE_STATX) && defined (HAVE_GETDENTS64)
+	g_auto (GStrv) names = NULL;
+	guint i, j;
+
+	names = g_strsplit (attributes, ",", -1);
+
+	for (i = 0; names[i]; i++) {
+		gboolean found = FALSE;
+
+		for (j = 0; j < G_N_ELEMENTS (supported_attributes); j++) {
+			if (g_strcmp0 (g_strstrip (names[i]), supported_attributes[j]) == 0) {
+				found = TRUE;
+				break;
+			}
+		}
+
+		if (!found)
+			return FALSE;
+	}
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+void
+tracker_native_crawler_enumerate_async (GFile               *directory,
+                                        const gchar         *attributes,
+                                        gboolean             inode_order,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+
+	task = g_task_new (directory, cancellable, callback, user_data);
+	g_task_set_source_tag (task, tracker_native_crawler_enumerate_async);
+
+#if defined (HAVE_STATX) && defined (HAVE_GETDENTS64)
+	if (g_file_is_native (directory)) {
+		EnumerateData *data;
+
+		data = g_slice_new0 (EnumerateData);
+		data->path = g_file_get_path (directory);
+		data->matcher = g_file_attribute_matcher_new (attributes);
+		data->inode_order = inode_order;
+		g_task_set_task_data (task, data, (GDestroyNotify) enumerate_data_free);
+		g_task_run_in_thread (task, enumerate_thread);
+		return;
+	}
+#endif
+
+	g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+	                         "Native crawling is not supported");
+}
+
+/* Returns a GPtrArray of GFileInfo for all children of @directory */
+GPtrArray *
+tracker_native_crawler_enumerate_finish (GFile         *directory,
+                                         GAsyncResult  *res,
+                                         GError       **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, directory), NULL);
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_NATIVE_CRAWLER_H__
+#define __TRACKER_NATIVE_CRAWLER_H__
+
+#include <gio/gio.h>
+
+gboolean tracker_native_crawler_supports_attributes (const gchar *attributes);
+
+void tracker_native_crawler_enumerate_async (GFile               *directory,
+                                             const gchar         *attributes,
+                                             gboolean             inode_order,
+                                             GCancellable        *cancellable,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+
+GPtrArray * tracker_native_crawler_enumerate_finish (GFile         *directory,
+                                                     GAsyncResult  *res,
+                                                     GError       **error);
+
+#endif /* __TRACKER_NATIVE_CRAWLER_H__ */
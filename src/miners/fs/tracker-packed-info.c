@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include "tracker-packed-info.h"
+
+/* Compact storage for the file info of queued events. A GFileInfo
+ * keeps an array of generic attribute values, plus the GObject
+ * overhead, there may be one of these for every file being indexed.
+ * Infos with attributes other than the ones below are not packed.
+ */
+
+enum {
+	SLOT_TYPE,
+	SLOT_MODIFIED_USEC,
+	SLOT_MODIFIED_NSEC,
+	SLOT_ACCESS_USEC,
+	SLOT_ACCESS_NSEC,
+	SLOT_CREATED_USEC,
+	SLOT_CREATED_NSEC,
+	N_UINT32_SLOTS
+};
+
+enum {
+	SLOT_SIZE,
+	SLOT_INODE,
+	SLOT_MODIFIED,
+	SLOT_ACCESS,
+	SLOT_CREATED,
+	N_UINT64_SLOTS
+};
+
+enum {
+	SLOT_NAME,
+	SLOT_DISPLAY_NAME,
+	SLOT_FILESYSTEM,
+};
+
+static const struct {
+	const gchar *name;
+	GFileAttributeType type;
+	guint slot;
+} packed_attributes[] = {
+	{ G_FILE_ATTRIBUTE_STANDARD_TYPE, G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_TYPE },
+	{ G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN, G_FILE_ATTRIBUTE_TYPE_BOOLEAN, 0 },
+	{ G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK, G_FILE_ATTRIBUTE_TYPE_BOOLEAN, 0 },
+	{ G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT, G_FILE_ATTRIBUTE_TYPE_BOOLEAN, 0 },
+	{ G_FILE_ATTRIBUTE_STANDARD_NAME, G_FILE_ATTRIBUTE_TYPE_BYTE_STRING, SLOT_NAME },
+	{ G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME, G_FILE_ATTRIBUTE_TYPE_STRING, SLOT_DISPLAY_NAME },
+	{ G_FILE_ATTRIBUTE_ID_FILESYSTEM, G_FILE_ATTRIBUTE_TYPE_STRING, SLOT_FILESYSTEM },
+	{ G_FILE_ATTRIBUTE_STANDARD_SIZE, G_FILE_ATTRIBUTE_TYPE_UINT64, SLOT_SIZE },
+	{ G_FILE_ATTRIBUTE_UNIX_INODE, G_FILE_ATTRIBUTE_TYPE_UINT64, SLOT_INODE },
+	{ G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_ATTRIBUTE_TYPE_UINT64, SLOT_MODIFIED },
+	{ G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_MODIFIED_USEC },
+	{ "time::modified-nsec", G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_MODIFIED_NSEC },
+	{ G_FILE_ATTRIBUTE_TIME_ACCESS, G_FILE_ATTRIBUTE_TYPE_UINT64, SLOT_ACCESS },
+	{ G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_ACCESS_USEC },
+	{ "time::access-nsec", G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_ACCESS_NSEC },
+	{ G_FILE_ATTRIBUTE_TIME_CREATED, G_FILE_ATTRIBUTE_TYPE_UINT64, SLOT_CREATED },
+	{ G_FILE_ATTRIBUTE_TIME_CREATED_USEC, G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_CREATED_USEC },
+	{ "time::created-nsec", G_FILE_ATTRIBUTE_TYPE_UINT32, SLOT_CREATED_NSEC },
+};
+
+struct _TrackerPackedInfo {
+	/* Bits of set attributes and boolean values, by attribute index */
+	guint32 mask;
+	guint32 booleans;
+	guint32 uint32_values[N_UINT32_SLOTS];
+	guint64 uint64_values[N_UINT64_SLOTS];
+	/* Interned, there are only a few distinct ones */
+	const gchar *filesystem;
+	/* NULL if the name is the file basename */
+	gchar *name;
+	/* NULL if the same as the name */
+	gchar *display_name;
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (packed_attributes) <= 32);
+
+static GHashTable *
+get_attribute_indexes (void)
+{
+	static GHashTable *indexes = NULL;
+
+	if (g_once_init_enter (&indexes)) {
+		GHashTable *table;
+		guint i;
+
+		table = g_hash_table_new (g_str_hash, g_str_equal);
+
+		/* Stored off by one, so NULL means unknown */
+		for (i = 0; i < G_N_ELEMENTS (packed_attributes); i++) {
+			g_hash_table_insert (table,
+			                     (gpointer) packed_attributes[i].name,
+			                     GUINT_TO_POINTER (i + 1));
+		}
+
+		g_once_init_leave (&indexes, table);
+	}
+
+	return indexes;
+}
+
+/* Returns %NULL if @info has attributes that cannot be packed */
+TrackerPackedInfo *
+tracker_packed_info_new (GFile     *file,
+                         GFileInfo *info)
+{
+	TrackerPackedInfo *packed;
+	g_auto (GStrv) attributes = NULL;
+	g_autofree gchar *basename = NULL;
+	GHashTable *indexes;
+	const gchar *name = NULL, *display_name = NULL;
+	guint i;
+
+	indexes = get_attribute_indexes ();
+	attributes = g_file_info_list_attributes (info, NULL);
+	packed = g_slice_new0 (TrackerPackedInfo);
+
+	for (i = 0; attributes[i]; i++) {
+		guint idx;
+
+		idx = GPOINTER_TO_UINT (g_hash_table_lookup (indexes, attributes[i]));
+
+		if (idx == 0 ||
+		    g_file_info_get_attribute_type (info, attributes[i]) !=
+		    packed_attributes[idx - 1].type) {
+			tracker_packed_info_free (packed);
+			return NULL;
+		}
+
+		idx--;
+		packed->mask |= 1 << idx;
+
+		switch (packed_attributes[idx].type) {
+		case G_FILE_ATTRIBUTE_TYPE_BOOLEAN:
+			if (g_file_info_get_attribute_boolean (info, attributes[i]))
+				packed->booleans |= 1 << idx;
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_UINT32:
+			packed->uint32_values[packed_attributes[idx].slot] =
+				g_file_info_get_attribute_uint32 (info, attributes[i]);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_UINT64:
+			packed->uint64_values[packed_attributes[idx].slot] =
+				g_file_info_get_attribute_uint64 (info, attributes[i]);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_BYTE_STRING:
+			name = g_file_info_get_attribute_byte_string (info, attributes[i]);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_STRING:
+			if (packed_attributes[idx].slot == SLOT_FILESYSTEM) {
+				packed->filesystem =
+					g_intern_string (g_file_info_get_attribute_string (info, attributes[i]));
+			} else {
+				display_name = g_file_info_get_attribute_string (info, attributes[i]);
+			}
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+
+	if (name) {
+		basename = g_file_get_basename (file);
+		if (g_strcmp0 (name, basename) != 0)
+			packed->name = g_strdup (name);
+	}
+
+	if (display_name && g_strcmp0 (display_name, name) != 0)
+		packed->display_name = g_strdup (display_name);
+
+	return packed;
+}
+
+void
+tracker_packed_info_free (TrackerPackedInfo *packed)
+{
+	g_free (packed->name);
+	g_free (packed->display_name);
+	g_slice_free (TrackerPackedInfo, packed);
+}
+
+GFileInfo *
+tracker_packed_info_unpack (TrackerPackedInfo *packed,
+                            GFile             *file)
+{
+	g_autofree gchar *basename = NULL;
+	const gchar *name;
+	GFileInfo *info;
+	guint i;
+
+	info = g_file_info_new ();
+
+	if (packed->name) {
+		name = packed->name;
+	} else {
+		basename = g_file_get_basename (file);
+		name = basename;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (packed_attributes); i++) {
+		const gchar *attribute = packed_attributes[i].name;
+		guint slot = packed_attributes[i].slot;
+
+		if ((packed->mask & (1 << i)) == 0)
+			continue;
+
+		switch (packed_attributes[i].type) {
+		case G_FILE_ATTRIBUTE_TYPE_BOOLEAN:
+			g_file_info_set_attribute_boolean (info, attribute,
+			                                   (packed->booleans & (1 << i)) != 0);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_UINT32:
+			g_file_info_set_attribute_uint32 (info, attribute,
+			                                  packed->uint32_values[slot]);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_UINT64:
+			g_file_info_set_attribute_uint64 (info, attribute,
+			                                  packed->uint64_values[slot]);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_BYTE_STRING:
+			g_file_info_set_attribute_byte_string (info, attribute, name);
+			break;
+		case G_FILE_ATTRIBUTE_TYPE_STRING:
+			if (slot == SLOT_FILESYSTEM) {
+				g_file_info_set_attribute_string (info, attribute,
+				                                  packed->filesystem);
+			} else {
+				g_file_info_set_attribute_string (info, attribute,
+				                                  packed->display_name ?
+				                                  packed->display_name : name);
+			}
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+
+	return info;
+}
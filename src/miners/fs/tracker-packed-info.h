@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_PACKED_INFO_H__
+#define __TRACKER_PACKED_INFO_H__
+
+#include <gio/gio.h>
+
+typedef struct _TrackerPackedInfo TrackerPackedInfo;
+
+TrackerPackedInfo * tracker_packed_info_new (GFile     *file,
+                                             GFileInfo *info);
+void tracker_packed_info_free (TrackerPackedInfo *packed);
+
+GFileInfo * tracker_packed_info_unpack (TrackerPackedInfo *packed,
+                                        GFile             *file);
+
+#endif /* __TRACKER_PACKED_INFO_H__ */
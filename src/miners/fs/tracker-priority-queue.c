@@ -21,21 +21,38 @@
 
 #include "config-miners.h"
 
+#include <libtracker-miners-common/tracker-common.h>
+
 #include "tracker-priority-queue.h"
 
-typedef struct PrioritySegment PrioritySegment;
+typedef struct PriorityBucket PriorityBucket;
+typedef struct PriorityFlow PriorityFlow;
+
+/* Elements of the same priority and flow are kept in a list of
+ * their own, in insertion order. Flows of a bucket are served in
+ * turn, so a long flow does not hold back the others. Buckets are
+ * sorted by priority, and there usually are just a couple of them
+ * with a few flows, so this is all O(1) in practice. Flows and
+ * buckets are removed as soon as they are empty.
+ */
+struct PriorityFlow
+{
+	gconstpointer key;
+	GList *head;
+	GList *tail;
+};
 
-struct PrioritySegment
+struct PriorityBucket
 {
 	gint priority;
-	GList *first_elem;
-	GList *last_elem;
+	GArray *flows;
+	guint next_flow;
 };
 
 struct _TrackerPriorityQueue
 {
-	GQueue queue;
-	GArray *segments;
+	GArray *buckets;
+	guint length;
 
 	gint ref_count;
 };
@@ -45,13 +62,14 @@ tracker_priority_queue_new (void)
 {
 	TrackerPriorityQueue *queue;
 
-	queue = g_slice_new (TrackerPriorityQueue);
-	g_queue_init (&queue->queue);
-	queue->segments = g_array_new (FALSE, FALSE,
-	                               sizeof (PrioritySegment));
+	queue = g_slice_new0 (TrackerPriorityQueue);
+	queue->buckets = g_array_new (FALSE, FALSE,
+	                              sizeof (PriorityBucket));
 
 	queue->ref_count = 1;
 
+	TRACKER_MEMORY_ALLOC (QUEUES, sizeof (TrackerPriorityQueue));
+
 	return queue;
 }
 
@@ -66,114 +84,158 @@ void
 tracker_priority_queue_unref (TrackerPriorityQueue *queue)
 {
 	if (g_atomic_int_dec_and_test (&queue->ref_count)) {
-		g_queue_clear (&queue->queue);
-		g_array_free (queue->segments, TRUE);
+		guint i, j;
+
+		for (i = 0; i < queue->buckets->len; i++) {
+			PriorityBucket *bucket;
+
+			bucket = &g_array_index (queue->buckets, PriorityBucket, i);
+
+			for (j = 0; j < bucket->flows->len; j++) {
+				PriorityFlow *flow;
+				GList *l;
+
+				flow = &g_array_index (bucket->flows, PriorityFlow, j);
+
+				for (l = flow->head; l; l = l->next)
+					TRACKER_MEMORY_FREE (QUEUES, sizeof (GList));
+
+				g_list_free (flow->head);
+			}
+
+			g_array_free (bucket->flows, TRUE);
+		}
+
+		g_array_free (queue->buckets, TRUE);
+		TRACKER_MEMORY_FREE (QUEUES, sizeof (TrackerPriorityQueue));
 		g_slice_free (TrackerPriorityQueue, queue);
 	}
 }
 
-static void
-queue_insert_before_link (GQueue *queue,
-                          GList  *sibling,
-                          GList  *link_)
+static PriorityBucket *
+ensure_bucket (TrackerPriorityQueue *queue,
+               gint                  priority)
 {
-	if (sibling == queue->head)
-		g_queue_push_head_link (queue, link_);
-	else {
-		link_->next = sibling;
-		link_->prev = sibling->prev;
-		sibling->prev->next = link_;
-		sibling->prev = link_;
-		queue->length++;
+	PriorityBucket *bucket, new_bucket = { 0 };
+	gint l, r, c;
+
+	/* Perform binary search to find out the bucket for
+	 * the given priority, create one if it isn't found.
+	 */
+	l = 0;
+	r = (gint) queue->buckets->len - 1;
+
+	while (l <= r) {
+		c = (r + l) / 2;
+		bucket = &g_array_index (queue->buckets, PriorityBucket, c);
+
+		if (bucket->priority == priority)
+			return bucket;
+		else if (bucket->priority > priority)
+			r = c - 1;
+		else
+			l = c + 1;
 	}
+
+	/* l is now the position to insert the bucket at */
+	new_bucket.priority = priority;
+	new_bucket.flows = g_array_new (FALSE, FALSE, sizeof (PriorityFlow));
+	g_array_insert_val (queue->buckets, l, new_bucket);
+
+	return &g_array_index (queue->buckets, PriorityBucket, l);
 }
 
-static void
-queue_insert_after_link (GQueue *queue,
-                         GList  *sibling,
-                         GList  *link_)
+static PriorityFlow *
+ensure_flow (PriorityBucket *bucket,
+             gconstpointer   key)
 {
-	if (sibling == queue->tail)
-		g_queue_push_tail_link (queue, link_);
-	else
-		queue_insert_before_link (queue, sibling->next, link_);
+	PriorityFlow *flow, new_flow = { 0 };
+	guint i;
+
+	for (i = 0; i < bucket->flows->len; i++) {
+		flow = &g_array_index (bucket->flows, PriorityFlow, i);
+
+		if (flow->key == key)
+			return flow;
+	}
+
+	new_flow.key = key;
+	g_array_append_val (bucket->flows, new_flow);
+
+	return &g_array_index (bucket->flows, PriorityFlow,
+	                       bucket->flows->len - 1);
 }
 
 static void
 insert_node (TrackerPriorityQueue *queue,
              gint                  priority,
+             gconstpointer         flow_key,
              GList                *node)
 {
-	PrioritySegment *segment = NULL;
-	gboolean found = FALSE;
-	gint l, r, c;
+	PriorityFlow *flow;
 
-	/* Perform binary search to find out the segment for
-	 * the given priority, create one if it isn't found.
-	 */
-	l = 0;
-	r = queue->segments->len - 1;
+	flow = ensure_flow (ensure_bucket (queue, priority), flow_key);
 
-	while (queue->segments->len > 0 && !found) {
-		c = (r + l) / 2;
-		segment = &g_array_index (queue->segments, PrioritySegment, c);
+	node->next = NULL;
+	node->prev = flow->tail;
 
-		if (segment->priority == priority) {
-			found = TRUE;
-			break;
-		} else if (segment->priority > priority) {
-			r = c - 1;
-		} else if (segment->priority < priority) {
-			l = c + 1;
-		}
+	if (flow->tail)
+		flow->tail->next = node;
+	else
+		flow->head = node;
 
-		if (l > r) {
-			break;
-		}
-	}
+	flow->tail = node;
+	queue->length++;
+	TRACKER_MEMORY_ALLOC (QUEUES, sizeof (GList));
+}
 
-	if (found) {
-		/* Element found, append at the end of segment */
-		g_assert (segment != NULL);
-		g_assert (segment->priority == priority);
-
-		queue_insert_after_link (&queue->queue, segment->last_elem, node);
-		segment->last_elem = node;
-	} else {
-		PrioritySegment new_segment = { 0 };
-
-		new_segment.priority = priority;
-
-		if (segment) {
-			g_assert (segment->priority != priority);
-
-			/* Binary search got to one of the closest results,
-			 * but we may have come from either of both sides,
-			 * so check whether we have to insert after the
-			 * segment we got.
-			 */
-			if (segment->priority > priority) {
-				/* We have to insert to the left of this element */
-				queue_insert_before_link (&queue->queue, segment->first_elem, node);
-			} else {
-				/* We have to insert to the right of this element */
-				queue_insert_after_link (&queue->queue, segment->last_elem, node);
-				c++;
-			}
+/* Unlinks @node from the flow at position @n_flow of the bucket at
+ * position @n_bucket. Returns %TRUE if the bucket got removed.
+ */
+static gboolean
+bucket_unlink_node (TrackerPriorityQueue *queue,
+                    guint                 n_bucket,
+                    guint                 n_flow,
+                    GList                *node)
+{
+	PriorityBucket *bucket;
+	PriorityFlow *flow;
 
-			new_segment.first_elem = new_segment.last_elem = node;
-			g_array_insert_val (queue->segments, c, new_segment);
-		} else {
-			/* Segments list has 0 elements */
-			g_assert (queue->segments->len == 0);
-			g_assert (g_queue_get_length (&queue->queue) == 0);
+	bucket = &g_array_index (queue->buckets, PriorityBucket, n_bucket);
+	flow = &g_array_index (bucket->flows, PriorityFlow, n_flow);
 
-			g_queue_push_head_link (&queue->queue, node);
-			new_segment.first_elem = new_segment.last_elem = node;
+	if (node == flow->head)
+		flow->head = node->next;
+	if (node == flow->tail)
+		flow->tail = node->prev;
 
-			g_array_append_val (queue->segments, new_segment);
-		}
-	}
+	if (node->prev)
+		node->prev->next = node->next;
+	if (node->next)
+		node->next->prev = node->prev;
+
+	node->next = node->prev = NULL;
+	queue->length--;
+	TRACKER_MEMORY_FREE (QUEUES, sizeof (GList));
+
+	if (flow->head)
+		return FALSE;
+
+	g_array_remove_index (bucket->flows, n_flow);
+
+	/* Keep serving the flow that was next in turn */
+	if (bucket->next_flow > n_flow)
+		bucket->next_flow--;
+	if (bucket->next_flow >= bucket->flows->len)
+		bucket->next_flow = 0;
+
+	if (bucket->flows->len > 0)
+		return FALSE;
+
+	g_array_free (bucket->flows, TRUE);
+	g_array_remove_index (queue->buckets, n_bucket);
+
+	return TRUE;
 }
 
 void
@@ -181,10 +243,28 @@ tracker_priority_queue_foreach (TrackerPriorityQueue *queue,
                                 GFunc                 func,
                                 gpointer              user_data)
 {
+	guint i, j;
+
 	g_return_if_fail (queue != NULL);
 	g_return_if_fail (func != NULL);
 
-	g_queue_foreach (&queue->queue, func, user_data);
+	for (i = 0; i < queue->buckets->len; i++) {
+		PriorityBucket *bucket;
+
+		bucket = &g_array_index (queue->buckets, PriorityBucket, i);
+
+		for (j = 0; j < bucket->flows->len; j++) {
+			PriorityFlow *flow;
+			GList *l, *next;
+
+			flow = &g_array_index (bucket->flows, PriorityFlow, j);
+
+			for (l = flow->head; l; l = next) {
+				next = l->next;
+				(func) (l->data, user_data);
+			}
+		}
+	}
 }
 
 gboolean
@@ -193,68 +273,52 @@ tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
                                        gpointer              compare_user_data,
                                        GDestroyNotify        destroy_notify)
 {
-	PrioritySegment *segment;
-	gint n_segment = 0;
 	gboolean updated = FALSE;
-	GList *list;
+	guint i = 0;
 
 	g_return_val_if_fail (queue != NULL, FALSE);
 	g_return_val_if_fail (compare_func != NULL, FALSE);
 
-	list = queue->queue.head;
+	while (i < queue->buckets->len) {
+		PriorityBucket *bucket;
+		gboolean bucket_removed = FALSE;
+		guint j = 0;
 
-	if (!list) {
-		return FALSE;
-	}
+		bucket = &g_array_index (queue->buckets, PriorityBucket, i);
 
-	segment = &g_array_index (queue->segments, PrioritySegment, n_segment);
-
-	while (list) {
-		gboolean fetch_segment = FALSE;
-		GList *elem;
-
-		elem = list;
-		list = list->next;
-
-		if ((compare_func) (elem->data, compare_user_data)) {
-			/* Update segment limits */
-			if (elem == segment->first_elem &&
-			    elem == segment->last_elem) {
-				/* Last element of segment, remove it */
-				g_array_remove_index (queue->segments,
-				                      n_segment);
-				fetch_segment = TRUE;
-			} else if (elem == segment->first_elem) {
-				/* First elemen in segment */
-				segment->first_elem = elem->next;
-			} else if (elem == segment->last_elem) {
-				segment->last_elem = elem->prev;
-				n_segment++;
-				fetch_segment = TRUE;
-			}
+		while (!bucket_removed && j < bucket->flows->len) {
+			PriorityFlow *flow;
+			guint n_flows;
+			GList *l, *next;
 
-			if (destroy_notify) {
-				(destroy_notify) (elem->data);
-			}
+			flow = &g_array_index (bucket->flows, PriorityFlow, j);
+			n_flows = bucket->flows->len;
+
+			for (l = flow->head; l; l = next) {
+				next = l->next;
+
+				if (!(compare_func) (l->data, compare_user_data))
+					continue;
+
+				bucket_removed = bucket_unlink_node (queue, i, j, l);
+
+				if (destroy_notify)
+					(destroy_notify) (l->data);
 
-			g_queue_delete_link (&queue->queue, elem);
-			updated = TRUE;
-		} else {
-			if (list != NULL &&
-			    elem == segment->last_elem) {
-				/* Move on to the next segment */
-				n_segment++;
-				fetch_segment = TRUE;
+				g_list_free_1 (l);
+				updated = TRUE;
+
+				/* The flow is gone once its last node is */
+				if (!next)
+					break;
 			}
-		}
 
-		if (list && fetch_segment) {
-			/* Fetch the next segment */
-			g_assert (n_segment < queue->segments->len);
-			segment = &g_array_index (queue->segments,
-			                          PrioritySegment,
-			                          n_segment);
+			if (!bucket_removed && bucket->flows->len == n_flows)
+				j++;
 		}
+
+		if (!bucket_removed)
+			i++;
 	}
 
 	return updated;
@@ -265,7 +329,7 @@ tracker_priority_queue_is_empty (TrackerPriorityQueue *queue)
 {
 	g_return_val_if_fail (queue != NULL, FALSE);
 
-	return g_queue_is_empty (&queue->queue);
+	return queue->length == 0;
 }
 
 guint
@@ -273,13 +337,35 @@ tracker_priority_queue_get_length (TrackerPriorityQueue *queue)
 {
 	g_return_val_if_fail (queue != NULL, 0);
 
-	return g_queue_get_length (&queue->queue);
+	return queue->length;
 }
 
 GList *
 tracker_priority_queue_add (TrackerPriorityQueue *queue,
                             gpointer              data,
                             gint                  priority)
+{
+	return tracker_priority_queue_add_full (queue, data, priority, NULL);
+}
+
+/**
+ * tracker_priority_queue_add_full:
+ * @queue: a #TrackerPriorityQueue
+ * @data: element to add
+ * @priority: priority of @data
+ * @flow: (nullable): flow @data belongs to
+ *
+ * Adds @data to @queue. Elements of the same priority are popped in
+ * insertion order within each @flow, different flows of the same
+ * priority take turns.
+ *
+ * Returns: the list node holding @data
+ **/
+GList *
+tracker_priority_queue_add_full (TrackerPriorityQueue *queue,
+                                 gpointer              data,
+                                 gint                  priority,
+                                 gconstpointer         flow)
 {
 	GList *node;
 
@@ -288,7 +374,7 @@ tracker_priority_queue_add (TrackerPriorityQueue *queue,
 
 	node = g_list_alloc ();
 	node->data = data;
-	insert_node (queue, priority, node);
+	insert_node (queue, priority, flow, node);
 
 	return node;
 }
@@ -301,38 +387,47 @@ tracker_priority_queue_add_node (TrackerPriorityQueue *queue,
 	g_return_if_fail (queue != NULL);
 	g_return_if_fail (node != NULL);
 
-	insert_node (queue, priority, node);
+	insert_node (queue, priority, NULL, node);
 }
 
 void
 tracker_priority_queue_remove_node (TrackerPriorityQueue *queue,
                                     GList                *node)
 {
-	guint i;
+	guint i, j;
 
 	g_return_if_fail (queue != NULL);
 
-	/* Check if it is the first or last of a segment */
-	for (i = 0; i < queue->segments->len; i++) {
-		PrioritySegment *segment;
+	if (node->prev && node->next) {
+		/* Not at either end of its flow, unlink right away */
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		queue->length--;
+		TRACKER_MEMORY_FREE (QUEUES, sizeof (GList));
+		g_list_free_1 (node);
+		return;
+	}
 
-		segment = &g_array_index (queue->segments, PrioritySegment, i);
+	/* Find out the flow the node is the first or last of */
+	for (i = 0; i < queue->buckets->len; i++) {
+		PriorityBucket *bucket;
 
-		if (segment->first_elem == node) {
-			if (segment->last_elem == node)
-				g_array_remove_index (queue->segments, i);
-			else
-				segment->first_elem = node->next;
-			break;
-		}
+		bucket = &g_array_index (queue->buckets, PriorityBucket, i);
+
+		for (j = 0; j < bucket->flows->len; j++) {
+			PriorityFlow *flow;
+
+			flow = &g_array_index (bucket->flows, PriorityFlow, j);
 
-		if (segment->last_elem == node) {
-			segment->last_elem = node->prev;
-			break;
+			if (flow->head == node || flow->tail == node) {
+				bucket_unlink_node (queue, i, j, node);
+				g_list_free_1 (node);
+				return;
+			}
 		}
 	}
 
-	g_queue_delete_link (&queue->queue, node);
+	g_assert_not_reached ();
 }
 
 gpointer
@@ -341,36 +436,31 @@ tracker_priority_queue_find (TrackerPriorityQueue *queue,
                              GEqualFunc            compare_func,
                              gpointer              user_data)
 {
-	PrioritySegment *segment;
-	gint n_segment = 0;
-	GList *list;
+	guint i, j;
 
 	g_return_val_if_fail (queue != NULL, NULL);
 	g_return_val_if_fail (compare_func != NULL, NULL);
 
-	list = queue->queue.head;
-	segment = &g_array_index (queue->segments, PrioritySegment, n_segment);
+	for (i = 0; i < queue->buckets->len; i++) {
+		PriorityBucket *bucket;
 
-	while (list) {
-		if ((compare_func) (list->data, user_data)) {
-			if (priority_out) {
-				*priority_out = segment->priority;
-			}
+		bucket = &g_array_index (queue->buckets, PriorityBucket, i);
 
-			return list->data;
-		}
+		for (j = 0; j < bucket->flows->len; j++) {
+			PriorityFlow *flow;
+			GList *l;
 
-		if (list->next != NULL &&
-		    list == segment->last_elem) {
-			/* Move on to the next segment */
-			n_segment++;
-			g_assert (n_segment < queue->segments->len);
-			segment = &g_array_index (queue->segments,
-			                          PrioritySegment,
-			                          n_segment);
-		}
+			flow = &g_array_index (bucket->flows, PriorityFlow, j);
 
-		list = list->next;
+			for (l = flow->head; l; l = l->next) {
+				if ((compare_func) (l->data, user_data)) {
+					if (priority_out)
+						*priority_out = bucket->priority;
+
+					return l->data;
+				}
+			}
+		}
 	}
 
 	return NULL;
@@ -380,16 +470,21 @@ gpointer
 tracker_priority_queue_peek (TrackerPriorityQueue *queue,
                              gint                 *priority_out)
 {
+	PriorityBucket *bucket;
+	PriorityFlow *flow;
+
 	g_return_val_if_fail (queue != NULL, NULL);
 
-	if (priority_out && queue->segments->len > 0) {
-		PrioritySegment *segment;
+	if (queue->buckets->len == 0)
+		return NULL;
+
+	bucket = &g_array_index (queue->buckets, PriorityBucket, 0);
+	flow = &g_array_index (bucket->flows, PriorityFlow, bucket->next_flow);
 
-		segment = &g_array_index (queue->segments, PrioritySegment, 0);
-		*priority_out = segment->priority;
-	}
+	if (priority_out)
+		*priority_out = bucket->priority;
 
-	return g_queue_peek_head (&queue->queue);
+	return flow->head->data;
 }
 
 gpointer
@@ -413,43 +508,34 @@ GList *
 tracker_priority_queue_pop_node (TrackerPriorityQueue *queue,
                                  gint                 *priority_out)
 {
-	PrioritySegment *segment;
+	PriorityBucket *bucket;
+	PriorityFlow *flow;
+	guint n_flow;
 	GList *node;
 
 	g_return_val_if_fail (queue != NULL, NULL);
 
-	node = g_queue_peek_head_link (&queue->queue);
-
-	if (!node) {
+	if (queue->buckets->len == 0) {
 		/* No elements in queue */
 		return NULL;
 	}
 
-	segment = &g_array_index (queue->segments, PrioritySegment, 0);
-	g_assert (segment->first_elem == node);
+	bucket = &g_array_index (queue->buckets, PriorityBucket, 0);
+	n_flow = bucket->next_flow;
+	flow = &g_array_index (bucket->flows, PriorityFlow, n_flow);
+	node = flow->head;
 
 	if (priority_out) {
-		*priority_out = segment->priority;
-	}
-
-	if (segment->last_elem == node) {
-		/* It is the last element of the first
-		 * segment, remove segment as well.
-		 */
-		g_array_remove_index (queue->segments, 0);
-	} else {
-
-		/* Move segments first element forward */
-		segment->first_elem = segment->first_elem->next;
+		*priority_out = bucket->priority;
 	}
 
-	return g_queue_pop_head_link (&queue->queue);
-}
+	/* Let the next flow go first next time, unless this one
+	 * is about to go away.
+	 */
+	if (node->next)
+		bucket->next_flow = (n_flow + 1) % bucket->flows->len;
 
-GList *
-tracker_priority_queue_get_head (TrackerPriorityQueue *queue)
-{
-	g_return_val_if_fail (queue != NULL, NULL);
+	bucket_unlink_node (queue, 0, n_flow, node);
 
-	return queue->queue.head;
+	return node;
 }
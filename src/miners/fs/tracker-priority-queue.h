@@ -40,6 +40,10 @@ guint    tracker_priority_queue_get_length         (TrackerPriorityQueue *queue)
 GList *  tracker_priority_queue_add     (TrackerPriorityQueue *queue,
                                          gpointer              data,
                                          gint                  priority);
+GList *  tracker_priority_queue_add_full (TrackerPriorityQueue *queue,
+                                          gpointer              data,
+                                          gint                  priority,
+                                          gconstpointer         flow);
 void     tracker_priority_queue_foreach (TrackerPriorityQueue *queue,
                                          GFunc                 func,
                                          gpointer              user_data);
@@ -59,7 +63,6 @@ gpointer tracker_priority_queue_peek    (TrackerPriorityQueue *queue,
 gpointer tracker_priority_queue_pop     (TrackerPriorityQueue *queue,
                                          gint                 *priority_out);
 
-GList *  tracker_priority_queue_get_head    (TrackerPriorityQueue *queue);
 void     tracker_priority_queue_add_node    (TrackerPriorityQueue *queue,
                                              GList                *node,
                                              gint                  priority);
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include "tracker-resource-control.h"
+
+/* Resource control through the systemd user manager. The files miner
+ * and the extractor processes it spawns share the cgroup of the
+ * service, so setting properties on the unit covers all of them.
+ */
+
+#define SYSTEMD_BUS_NAME "org.freedesktop.systemd1"
+#define SYSTEMD_OBJECT_PATH "/org/freedesktop/systemd1"
+#define SYSTEMD_MANAGER_IFACE "org.freedesktop.systemd1.Manager"
+#define SYSTEMD_UNIT_IFACE "org.freedesktop.systemd1.Unit"
+
+typedef struct {
+	guint weight;
+	guint64 memory_high;
+} ResourceControlData;
+
+static void
+set_properties_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	g_autoptr (GVariant) reply = NULL;
+	g_autoptr (GError) error = NULL;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object),
+	                                       result, &error);
+	if (!reply)
+		g_debug ("Could not set resource control properties: %s", error->message);
+}
+
+static void
+get_unit_cb (GObject      *object,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+	ResourceControlData *data = user_data;
+	GDBusConnection *conn = G_DBUS_CONNECTION (object);
+	g_autoptr (GVariant) reply = NULL;
+	g_autoptr (GError) error = NULL;
+	GVariantBuilder builder;
+	const gchar *unit_path;
+
+	reply = g_dbus_connection_call_finish (conn, result, &error);
+
+	if (!reply) {
+		g_debug ("Could not find systemd unit: %s", error->message);
+		g_slice_free (ResourceControlData, data);
+		return;
+	}
+
+	g_variant_get (reply, "(&o)", &unit_path);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sv)"));
+	g_variant_builder_add (&builder, "(sv)", "CPUWeight",
+	                       g_variant_new_uint64 (data->weight));
+	g_variant_builder_add (&builder, "(sv)", "IOWeight",
+	                       g_variant_new_uint64 (data->weight));
+	g_variant_builder_add (&builder, "(sv)", "MemoryHigh",
+	                       g_variant_new_uint64 (data->memory_high > 0 ?
+	                                             data->memory_high : G_MAXUINT64));
+
+	g_debug ("Setting resource weight to %u, memory high limit to %" G_GUINT64_FORMAT,
+	         data->weight, data->memory_high);
+
+	/* Runtime only, nothing is persisted in the unit configuration */
+	g_dbus_connection_call (conn,
+	                        SYSTEMD_BUS_NAME,
+	                        unit_path,
+	                        SYSTEMD_UNIT_IFACE,
+	                        "SetProperties",
+	                        g_variant_new ("(ba(sv))", TRUE, &builder),
+	                        NULL,
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        -1, NULL,
+	                        set_properties_cb,
+	                        NULL);
+
+	g_slice_free (ResourceControlData, data);
+}
+
+/* Sets the CPU and IO weight, and the high memory boundary in bytes
+ * (or 0 for none) of the systemd service we run in.
+ */
+void
+tracker_resource_control_apply (guint   weight,
+                                guint64 memory_high)
+{
+	g_autoptr (GDBusConnection) conn = NULL;
+	ResourceControlData *data;
+
+	/* Only act on our own service, not on whatever scope
+	 * we were started from.
+	 */
+	if (!g_getenv ("INVOCATION_ID"))
+		return;
+
+	conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+	if (!conn)
+		return;
+
+	data = g_slice_new0 (ResourceControlData);
+	data->weight = weight;
+	data->memory_high = memory_high;
+
+	g_dbus_connection_call (conn,
+	                        SYSTEMD_BUS_NAME,
+	                        SYSTEMD_OBJECT_PATH,
+	                        SYSTEMD_MANAGER_IFACE,
+	                        "GetUnitByPID",
+	                        g_variant_new ("(u)", 0),
+	                        G_VARIANT_TYPE ("(o)"),
+	                        G_DBUS_CALL_FLAGS_NONE,
+	                        -1, NULL,
+	                        get_unit_cb,
+	                        data);
+}
@@ -23,15 +23,43 @@
 
 #include "tracker-sparql-buffer.h"
 
+#include <gobject/gvaluecollector.h>
+
 #include "libtracker-miners-common/tracker-debug.h"
+#include "libtracker-miners-common/tracker-memory.h"
+#include "libtracker-miners-common/tracker-metrics.h"
+#include "libtracker-miners-common/tracker-trace.h"
 
 #include "tracker-utils.h"
 
 #define DEFAULT_GRAPH "tracker:FileSystem"
 
+/* Batch sizes are adapted so a commit takes roughly this long,
+ * within [limit / BATCH_LIMIT_RANGE, limit * BATCH_LIMIT_RANGE]
+ * of the limit given at construction.
+ */
+#define TARGET_BATCH_LATENCY_USEC (500 * G_TIME_SPAN_MILLISECOND)
+#define BATCH_LIMIT_RANGE 4
+
+/* In bulk mode there are no interactive changes waiting behind the
+ * batches, so they can take longer and amortize more of the commit
+ * overhead.
+ */
+#define BULK_TARGET_BATCH_LATENCY_USEC (2 * G_TIME_SPAN_SECOND)
+#define BULK_BATCH_LIMIT_RANGE 16
+
+/* Folders with more descendants than this have their content deleted
+ * in chunks of this size before the batch deleting them is executed,
+ * each chunk in a transaction of its own.
+ */
+#define CONTENT_DELETE_CHUNK_SIZE 5000
+
 typedef struct _TrackerSparqlBufferPrivate TrackerSparqlBufferPrivate;
 typedef struct _SparqlTaskData SparqlTaskData;
 typedef struct _UpdateBatchData UpdateBatchData;
+typedef struct _BatchOp BatchOp;
+typedef struct _BatchRange BatchRange;
+typedef struct _OpGroup OpGroup;
 
 enum {
 	PROP_0,
@@ -43,13 +71,33 @@ struct _TrackerSparqlBufferPrivate
 	TrackerSparqlConnection *connection;
 	GPtrArray *tasks;
 	gint n_updates;
-	TrackerBatch *batch;
+	/* Array of BatchOp, the contents of the next batch */
+	GPtrArray *ops;
+
+	/* GFile -> GPtrArray of OpGroup, the updates of each file
+	 * that later ones may still supersede.
+	 */
+	GHashTable *groups;
+	OpGroup *current_group;
+	guint n_superseded;
+
+	guint initial_limit;
+	gint64 target_latency;
+	guint limit_range;
 
 	TrackerSparqlStatement *delete_file;
 	TrackerSparqlStatement *delete_file_content;
 	TrackerSparqlStatement *delete_content;
+	TrackerSparqlStatement *delete_content_chunk;
+	TrackerSparqlStatement *get_content_left;
 	TrackerSparqlStatement *move_file;
 	TrackerSparqlStatement *move_content;
+	TrackerSparqlStatement *update_attributes;
+	TrackerSparqlStatement *update_rewritten;
+	TrackerSparqlStatement *insert_file;
+	TrackerSparqlStatement *insert_fingerprint;
+	/* Content graph -> TrackerSparqlStatement */
+	GHashTable *insert_file_content;
 };
 
 enum {
@@ -60,6 +108,7 @@ enum {
 struct _SparqlTaskData
 {
 	guint type;
+	GError *error;
 
 	union {
 		struct {
@@ -75,11 +124,67 @@ struct _SparqlTaskData
 	} d;
 };
 
+/* Every update added to a batch is also kept as one of these, so
+ * the updates of the files that made a batch fail can be told apart
+ * by executing them again in smaller batches.
+ */
+struct _BatchOp {
+	GFile *file;
+	TrackerSparqlStatement *stmt;
+	guint n_values;
+	const gchar **names;
+	GValue *values;
+	gchar *graph;
+	TrackerResource *resource;
+	guint superseded : 1;
+};
+
+/* What a group of ops does to its file. A file may be updated
+ * several times before the buffer is flushed (e.g. while it is being
+ * written), only the last state of it needs to be in the batch.
+ */
+typedef enum {
+	/* Ops that later ones on the file must not be reordered with */
+	OP_KIND_OTHER,
+	/* Same, but the ops also touch other files (moves, content deletes) */
+	OP_KIND_TREE,
+	OP_KIND_FILE,
+	OP_KIND_ATTRIBUTES,
+	OP_KIND_REWRITTEN,
+	OP_KIND_DELETE,
+} OpKind;
+
+/* The ops added by one log call, these are not owned */
+struct _OpGroup {
+	OpKind kind;
+	GPtrArray *ops;
+};
+
+/* Range of groups of consecutive ops on the same file */
+struct _BatchRange {
+	guint first;
+	guint last;
+};
+
 struct _UpdateBatchData {
 	TrackerSparqlBuffer *buffer;
 	GPtrArray *tasks;
+	GPtrArray *ops;
 	TrackerBatch *batch;
 	GTask *async_task;
+	gint64 start_time;
+
+	/* URIs of the folders whose content is deleted in chunks
+	 * before the batch is executed.
+	 */
+	GPtrArray *content_deletes;
+
+	/* Set while looking for the failing files, the op index
+	 * each group starts at, and the ranges left to execute.
+	 */
+	GArray *groups;
+	GArray *ranges;
+	GHashTable *failed_files;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerSparqlBuffer, tracker_sparql_buffer, TRACKER_TYPE_TASK_POOL)
@@ -94,8 +199,17 @@ tracker_sparql_buffer_finalize (GObject *object)
 	g_object_unref (priv->delete_file);
 	g_object_unref (priv->delete_file_content);
 	g_object_unref (priv->delete_content);
+	g_object_unref (priv->delete_content_chunk);
+	g_object_unref (priv->get_content_left);
 	g_object_unref (priv->move_file);
 	g_object_unref (priv->move_content);
+	g_object_unref (priv->update_attributes);
+	g_object_unref (priv->update_rewritten);
+	g_object_unref (priv->insert_file);
+	g_object_unref (priv->insert_fingerprint);
+	g_hash_table_unref (priv->insert_file_content);
+	g_hash_table_unref (priv->groups);
+	g_clear_pointer (&priv->ops, g_ptr_array_unref);
 	g_object_unref (priv->connection);
 
 	G_OBJECT_CLASS (tracker_sparql_buffer_parent_class)->finalize (object);
@@ -155,10 +269,25 @@ tracker_sparql_buffer_constructed (GObject *object)
 		tracker_load_statement (priv->connection, "delete-file-content.rq", NULL);
 	priv->delete_content =
 		tracker_load_statement (priv->connection, "delete-folder-contents.rq", NULL);
+	priv->delete_content_chunk =
+		tracker_load_statement (priv->connection, "delete-folder-contents-chunk.rq", NULL);
+	priv->get_content_left =
+		tracker_load_statement (priv->connection, "get-folder-contents-left.rq", NULL);
 	priv->move_file =
 		tracker_load_statement (priv->connection, "move-file.rq", NULL);
 	priv->move_content =
 		tracker_load_statement (priv->connection, "move-folder-contents.rq", NULL);
+	priv->update_attributes =
+		tracker_load_statement (priv->connection, "update-file-attributes.rq", NULL);
+	priv->update_rewritten =
+		tracker_load_statement (priv->connection, "update-file-rewritten.rq", NULL);
+	priv->insert_file =
+		tracker_load_statement (priv->connection, "insert-file.rq", NULL);
+	priv->insert_fingerprint =
+		tracker_load_statement (priv->connection, "insert-file-fingerprint.rq", NULL);
+	priv->insert_file_content =
+		g_hash_table_new_full (g_str_hash, g_str_equal,
+		                       g_free, g_object_unref);
 
 	G_OBJECT_CLASS (tracker_sparql_buffer_parent_class)->constructed (object);
 }
@@ -187,16 +316,33 @@ tracker_sparql_buffer_class_init (TrackerSparqlBufferClass *klass)
 static void
 tracker_sparql_buffer_init (TrackerSparqlBuffer *buffer)
 {
+	TrackerSparqlBufferPrivate *priv;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+	priv->target_latency = TARGET_BATCH_LATENCY_USEC;
+	priv->limit_range = BATCH_LIMIT_RANGE;
+	priv->groups = g_hash_table_new_full (g_file_hash,
+	                                      (GEqualFunc) g_file_equal,
+	                                      g_object_unref,
+	                                      (GDestroyNotify) g_ptr_array_unref);
 }
 
 TrackerSparqlBuffer *
 tracker_sparql_buffer_new (TrackerSparqlConnection *connection,
                            guint                    limit)
 {
-	return g_object_new (TRACKER_TYPE_SPARQL_BUFFER,
-	                     "connection", connection,
-	                     "limit", limit,
-	                     NULL);
+	TrackerSparqlBuffer *buffer;
+	TrackerSparqlBufferPrivate *priv;
+
+	buffer = g_object_new (TRACKER_TYPE_SPARQL_BUFFER,
+	                       "connection", connection,
+	                       "limit", limit,
+	                       NULL);
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+	priv->initial_limit = limit;
+
+	return buffer;
 }
 
 static void
@@ -206,32 +352,468 @@ remove_task_foreach (TrackerTask     *task,
 	tracker_task_pool_remove (pool, task);
 }
 
+static void
+batch_op_free (BatchOp *op)
+{
+	guint i;
+
+	for (i = 0; i < op->n_values; i++)
+		g_value_unset (&op->values[i]);
+
+	g_object_unref (op->file);
+	g_clear_object (&op->stmt);
+	g_clear_object (&op->resource);
+	g_free (op->names);
+	g_free (op->values);
+	g_free (op->graph);
+	TRACKER_MEMORY_FREE (BATCHES, sizeof (BatchOp) +
+	                     op->n_values * (sizeof (gchar *) + sizeof (GValue)));
+	g_slice_free (BatchOp, op);
+}
+
+static BatchOp *
+batch_op_new_valist (GFile                  *file,
+                     TrackerSparqlStatement *stmt,
+                     const gchar            *first_name,
+                     va_list                 args)
+{
+	GArray *names, *values;
+	const gchar *name;
+	BatchOp *op;
+
+	names = g_array_new (FALSE, FALSE, sizeof (const gchar *));
+	values = g_array_new (FALSE, TRUE, sizeof (GValue));
+
+	for (name = first_name; name; name = va_arg (args, const gchar *)) {
+		GValue value = G_VALUE_INIT;
+		g_autofree gchar *error = NULL;
+		GType type;
+
+		type = va_arg (args, GType);
+		G_VALUE_COLLECT_INIT (&value, type, args, 0, &error);
+
+		if (error) {
+			g_critical ("Could not bind %s: %s", name, error);
+			break;
+		}
+
+		g_array_append_val (names, name);
+		g_array_append_val (values, value);
+	}
+
+	op = g_slice_new0 (BatchOp);
+	op->file = g_object_ref (file);
+	op->stmt = g_object_ref (stmt);
+	op->n_values = names->len;
+	op->names = (const gchar **) g_array_free (names, FALSE);
+	op->values = (GValue *) g_array_free (values, FALSE);
+
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (BatchOp) +
+	                      op->n_values * (sizeof (gchar *) + sizeof (GValue)));
+
+	return op;
+}
+
+static void
+sparql_buffer_add_op (TrackerSparqlBuffer *buffer,
+                      BatchOp             *op)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	if (!priv->ops)
+		priv->ops = g_ptr_array_new_with_free_func ((GDestroyNotify) batch_op_free);
+
+	g_ptr_array_add (priv->ops, op);
+
+	if (priv->current_group)
+		g_ptr_array_add (priv->current_group->ops, op);
+}
+
+static void
+op_group_free (OpGroup *group)
+{
+	g_ptr_array_unref (group->ops);
+	TRACKER_MEMORY_FREE (BATCHES, sizeof (OpGroup));
+	g_slice_free (OpGroup, group);
+}
+
+static gboolean
+op_kind_supersedes (OpKind kind,
+                    OpKind prev_kind)
+{
+	switch (kind) {
+	case OP_KIND_FILE:
+	case OP_KIND_DELETE:
+		/* Both replace everything known about the file */
+		return (prev_kind == OP_KIND_FILE ||
+		        prev_kind == OP_KIND_ATTRIBUTES ||
+		        prev_kind == OP_KIND_REWRITTEN);
+	case OP_KIND_ATTRIBUTES:
+	case OP_KIND_REWRITTEN:
+		return prev_kind == kind;
+	default:
+		return FALSE;
+	}
+}
+
+/* Starts the ops of a log call about @file, and drops the ops
+ * queued for it that these make redundant. Following ops are
+ * added to the group until sparql_buffer_end_group().
+ */
+static void
+sparql_buffer_begin_group (TrackerSparqlBuffer *buffer,
+                           GFile               *file,
+                           OpKind               kind)
+{
+	TrackerSparqlBufferPrivate *priv;
+	GPtrArray *file_groups;
+	OpGroup *group;
+	guint i, j;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	if (kind == OP_KIND_TREE) {
+		/* Other files may be moved or deleted, nothing
+		 * before this may be dropped.
+		 */
+		g_hash_table_remove_all (priv->groups);
+		return;
+	}
+
+	file_groups = g_hash_table_lookup (priv->groups, file);
+
+	for (i = file_groups ? file_groups->len : 0; i > 0; i--) {
+		group = g_ptr_array_index (file_groups, i - 1);
+
+		if (!op_kind_supersedes (kind, group->kind))
+			continue;
+
+		for (j = 0; j < group->ops->len; j++) {
+			BatchOp *op = g_ptr_array_index (group->ops, j);
+
+			op->superseded = TRUE;
+			priv->n_superseded++;
+		}
+
+		g_ptr_array_remove_index (file_groups, i - 1);
+	}
+
+	/* Deletes are kept before whatever follows them, a file
+	 * created again must not inherit anything from the deleted
+	 * one.
+	 */
+	if (kind == OP_KIND_OTHER || kind == OP_KIND_DELETE) {
+		g_hash_table_remove (priv->groups, file);
+		return;
+	}
+
+	if (!file_groups) {
+		file_groups = g_ptr_array_new_with_free_func ((GDestroyNotify) op_group_free);
+		g_hash_table_insert (priv->groups, g_object_ref (file), file_groups);
+	}
+
+	group = g_slice_new0 (OpGroup);
+	group->kind = kind;
+	group->ops = g_ptr_array_new ();
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (OpGroup));
+	g_ptr_array_add (file_groups, group);
+	priv->current_group = group;
+}
+
+static void
+sparql_buffer_end_group (TrackerSparqlBuffer *buffer)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+	priv->current_group = NULL;
+}
+
+static void
+batch_add_op (TrackerBatch *batch,
+              BatchOp      *op)
+{
+	if (op->resource) {
+		tracker_batch_add_resource (batch, op->graph, op->resource);
+	} else {
+		tracker_batch_add_statementv (batch, op->stmt,
+		                              op->n_values,
+		                              op->names,
+		                              op->values);
+	}
+}
+
+static BatchOp *
+batch_op_new (GFile                  *file,
+              TrackerSparqlStatement *stmt,
+              const gchar            *first_name,
+              ...)
+{
+	BatchOp *op;
+	va_list args;
+
+	va_start (args, first_name);
+	op = batch_op_new_valist (file, stmt, first_name, args);
+	va_end (args);
+
+	return op;
+}
+
+/* Adds the statement with the given bindings to the next batch,
+ * varargs are as in tracker_batch_add_statement().
+ */
+static void
+sparql_buffer_add_statement (TrackerSparqlBuffer    *buffer,
+                             GFile                  *file,
+                             TrackerSparqlStatement *stmt,
+                             const gchar            *first_name,
+                             ...)
+{
+	BatchOp *op;
+	va_list args;
+
+	va_start (args, first_name);
+	op = batch_op_new_valist (file, stmt, first_name, args);
+	va_end (args);
+
+	sparql_buffer_add_op (buffer, op);
+}
+
 static void
 update_batch_data_free (UpdateBatchData *batch_data)
 {
 	g_object_unref (batch_data->batch);
 
 	g_ptr_array_unref (batch_data->tasks);
+	g_clear_pointer (&batch_data->ops, g_ptr_array_unref);
+	g_clear_pointer (&batch_data->groups, g_array_unref);
+	g_clear_pointer (&batch_data->ranges, g_array_unref);
+	g_clear_pointer (&batch_data->failed_files, g_hash_table_unref);
+	g_clear_pointer (&batch_data->content_deletes, g_ptr_array_unref);
 
 	g_clear_object (&batch_data->async_task);
 
+	TRACKER_MEMORY_FREE (BATCHES, sizeof (UpdateBatchData));
 	g_slice_free (UpdateBatchData, batch_data);
 }
 
+static void
+update_batch_limit (TrackerSparqlBuffer *buffer,
+                    guint                n_tasks,
+                    gint64               elapsed)
+{
+	TrackerSparqlBufferPrivate *priv;
+	guint limit, new_limit, min_limit, max_limit;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+	limit = tracker_task_pool_get_limit (TRACKER_TASK_POOL (buffer));
+
+	if (priv->initial_limit == 0 || n_tasks == 0)
+		return;
+
+	if (elapsed > priv->target_latency) {
+		/* Too slow, shrink to what would have fit in the target time */
+		new_limit = (guint) (((gdouble) n_tasks * priv->target_latency) / elapsed);
+		new_limit = MAX (new_limit, limit / 2);
+	} else if (n_tasks >= limit && elapsed < priv->target_latency / 2) {
+		/* Full batch and well under target, there is room to grow.
+		 * Batches flushed for other reasons than the limit being
+		 * reached say little about the throughput.
+		 */
+		new_limit = limit + (limit / 4);
+	} else {
+		return;
+	}
+
+	min_limit = MAX (priv->initial_limit / BATCH_LIMIT_RANGE, 1);
+	max_limit = priv->initial_limit * priv->limit_range;
+	new_limit = CLAMP (new_limit, min_limit, max_limit);
+
+	if (new_limit == limit)
+		return;
+
+	TRACKER_NOTE (MINER_FS_EVENTS,
+	              g_message ("(Sparql buffer) %u tasks committed in %" G_GINT64_FORMAT "ms, "
+	                         "changing batch limit from %u to %u",
+	                         n_tasks, elapsed / G_TIME_SPAN_MILLISECOND,
+	                         limit, new_limit));
+
+	tracker_task_pool_set_limit (TRACKER_TASK_POOL (buffer), new_limit);
+}
+
+TRACKER_TRACE_DEFINE (buffer_flush);
+TRACKER_TRACE_DEFINE (batch_done);
+
+static void batch_execute_cb (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data);
+
+static void
+update_batch_data_return (UpdateBatchData *update_data,
+                          GError          *error)
+{
+	TrackerSparqlBufferPrivate *priv;
+	guint i;
+
+	priv = tracker_sparql_buffer_get_instance_private (update_data->buffer);
+	priv->n_updates--;
+
+	if (error) {
+		g_task_set_task_data (update_data->async_task,
+		                      g_ptr_array_ref (update_data->tasks),
+		                      (GDestroyNotify) g_ptr_array_unref);
+		g_task_return_error (update_data->async_task, error);
+		update_batch_data_free (update_data);
+		return;
+	}
+
+	for (i = 0; update_data->failed_files && i < update_data->tasks->len; i++) {
+		TrackerTask *task = g_ptr_array_index (update_data->tasks, i);
+		SparqlTaskData *task_data = tracker_task_get_data (task);
+		const GError *file_error;
+
+		file_error = g_hash_table_lookup (update_data->failed_files,
+		                                  tracker_task_get_file (task));
+		if (file_error)
+			task_data->error = g_error_copy (file_error);
+	}
+
+	g_task_return_pointer (update_data->async_task,
+	                       g_ptr_array_ref (update_data->tasks),
+	                       (GDestroyNotify) g_ptr_array_unref);
+	update_batch_data_free (update_data);
+}
+
+static void
+update_batch_data_execute_next_range (UpdateBatchData *update_data)
+{
+	TrackerSparqlBufferPrivate *priv;
+	BatchRange *range;
+	guint i, first, last;
+
+	if (update_data->ranges->len == 0) {
+		update_batch_data_return (update_data, NULL);
+		return;
+	}
+
+	priv = tracker_sparql_buffer_get_instance_private (update_data->buffer);
+	range = &g_array_index (update_data->ranges, BatchRange, 0);
+	first = g_array_index (update_data->groups, guint, range->first);
+	last = g_array_index (update_data->groups, guint, range->last);
+
+	g_object_unref (update_data->batch);
+	update_data->batch = tracker_sparql_connection_create_batch (priv->connection);
+	TRACKER_MEMORY_TRACK_OBJECT (BATCHES, update_data->batch);
+
+	for (i = first; i < last; i++)
+		batch_add_op (update_data->batch, g_ptr_array_index (update_data->ops, i));
+
+	tracker_batch_execute_async (update_data->batch,
+	                             NULL,
+	                             batch_execute_cb,
+	                             update_data);
+}
+
+/* Splits @range in halves to be executed next, in order */
+static void
+update_batch_data_split_range (UpdateBatchData *update_data,
+                               BatchRange       range)
+{
+	BatchRange first_half, second_half;
+
+	first_half.first = range.first;
+	first_half.last = second_half.first = range.first + (range.last - range.first) / 2;
+	second_half.last = range.last;
+
+	g_array_prepend_val (update_data->ranges, second_half);
+	g_array_prepend_val (update_data->ranges, first_half);
+}
+
+/* Returns %FALSE if the batch is about a single file */
+static gboolean
+update_batch_data_start_bisect (UpdateBatchData *update_data)
+{
+	BatchRange range;
+	GFile *file = NULL;
+	guint i;
+
+	if (!update_data->ops)
+		return FALSE;
+
+	update_data->groups = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	for (i = 0; i < update_data->ops->len; i++) {
+		BatchOp *op = g_ptr_array_index (update_data->ops, i);
+
+		if (file && g_file_equal (file, op->file))
+			continue;
+
+		g_array_append_val (update_data->groups, i);
+		file = op->file;
+	}
+
+	if (update_data->groups->len <= 1)
+		return FALSE;
+
+	/* Sentinel, so groups[N + 1] is where group N ends */
+	g_array_append_val (update_data->groups, i);
+
+	update_data->ranges = g_array_new (FALSE, FALSE, sizeof (BatchRange));
+	update_data->failed_files = g_hash_table_new_full (g_file_hash,
+	                                                   (GEqualFunc) g_file_equal,
+	                                                   g_object_unref,
+	                                                   (GDestroyNotify) g_error_free);
+	range.first = 0;
+	range.last = update_data->groups->len - 1;
+	update_batch_data_split_range (update_data, range);
+
+	return TRUE;
+}
+
 static void
 batch_execute_cb (GObject      *object,
                   GAsyncResult *result,
                   gpointer      user_data)
 {
-	TrackerSparqlBufferPrivate *priv;
 	TrackerSparqlBuffer *buffer;
 	GError *error = NULL;
 	UpdateBatchData *update_data;
+	BatchRange range;
 
 	update_data = user_data;
 	buffer = TRACKER_SPARQL_BUFFER (update_data->buffer);
-	priv = tracker_sparql_buffer_get_instance_private (buffer);
-	priv->n_updates--;
+
+	if (update_data->ranges) {
+		/* Executing part of a batch that failed */
+		range = g_array_index (update_data->ranges, BatchRange, 0);
+		g_array_remove_index (update_data->ranges, 0);
+
+		if (!tracker_batch_execute_finish (TRACKER_BATCH (object),
+		                                   result,
+		                                   &error)) {
+			if (g_error_matches (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_CORRUPT)) {
+				update_batch_data_return (update_data, error);
+				return;
+			}
+
+			if (range.last - range.first > 1) {
+				update_batch_data_split_range (update_data, range);
+				g_error_free (error);
+			} else {
+				BatchOp *op;
+
+				op = g_ptr_array_index (update_data->ops,
+				                        g_array_index (update_data->groups, guint, range.first));
+				g_hash_table_insert (update_data->failed_files,
+				                     g_object_ref (op->file), error);
+			}
+		}
+
+		update_batch_data_execute_next_range (update_data);
+		return;
+	}
 
 	TRACKER_NOTE (MINER_FS_EVENTS,
 	              g_message ("(Sparql buffer) Finished array-update with %u tasks",
@@ -240,17 +822,293 @@ batch_execute_cb (GObject      *object,
 	if (!tracker_batch_execute_finish (TRACKER_BATCH (object),
 	                                   result,
 	                                   &error)) {
-		g_task_set_task_data (update_data->async_task,
-		                      g_ptr_array_ref (update_data->tasks),
-		                      (GDestroyNotify) g_ptr_array_unref);
-		g_task_return_error (update_data->async_task, error);
+		if (TRACKER_TRACE_ENABLED (batch_done)) {
+			TRACKER_TRACE (batch_done, update_data->tasks->len,
+			               g_get_monotonic_time () - update_data->start_time, 0);
+		}
+
+		/* Find out the files that make the batch fail, the
+		 * updates of all others can still be committed.
+		 */
+		if (!g_error_matches (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_CORRUPT) &&
+		    update_batch_data_start_bisect (update_data)) {
+			g_warning ("Could not execute sparql: %s, retrying in smaller batches",
+			           error->message);
+			g_error_free (error);
+			update_batch_data_execute_next_range (update_data);
+			return;
+		}
+
+		update_batch_data_return (update_data, error);
 	} else {
-		g_task_return_pointer (update_data->async_task,
-		                       g_ptr_array_ref (update_data->tasks),
-		                       (GDestroyNotify) g_ptr_array_unref);
+		gint64 elapsed;
+
+		elapsed = g_get_monotonic_time () - update_data->start_time;
+		TRACKER_TRACE (batch_done, update_data->tasks->len, elapsed, 1);
+		tracker_metrics_record (TRACKER_METRIC_BATCH_EXECUTE, elapsed);
+		update_batch_limit (buffer, update_data->tasks->len, elapsed);
+		update_batch_data_return (update_data, NULL);
 	}
+}
 
-	update_batch_data_free (update_data);
+/* Files deleted one after another, e.g. the ones found missing while
+ * crawling a directory, are deleted by a single update.
+ */
+static void
+batch_add_deletes (TrackerSparqlBuffer *buffer,
+                   TrackerBatch        *batch,
+                   GPtrArray           *uris)
+{
+	TrackerSparqlBufferPrivate *priv;
+	g_autoptr (GString) values = NULL;
+	g_autofree gchar *sparql = NULL;
+	guint i;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	if (uris->len == 0)
+		return;
+
+	if (uris->len == 1) {
+		tracker_batch_add_statement (batch, priv->delete_file,
+		                             "uri", G_TYPE_STRING,
+		                             g_ptr_array_index (uris, 0),
+		                             NULL);
+		g_ptr_array_set_size (uris, 0);
+		return;
+	}
+
+	values = g_string_new (NULL);
+
+	for (i = 0; i < uris->len; i++) {
+		g_autofree gchar *escaped = NULL;
+
+		escaped = tracker_sparql_escape_string (g_ptr_array_index (uris, i));
+		g_string_append_printf (values, " \"%s\"", escaped);
+	}
+
+	/* Same as delete-file.rq, for all the files at once */
+	sparql = g_strdup_printf ("DELETE { "
+	                          "  GRAPH tracker:FileSystem { "
+	                          "    ?f a rdfs:Resource . "
+	                          "    ?hash a rdfs:Resource . "
+	                          "  } "
+	                          "  GRAPH ?g { "
+	                          "    ?f a rdfs:Resource . "
+	                          "    ?ie a rdfs:Resource . "
+	                          "  } "
+	                          "} WHERE { "
+	                          "  VALUES ?u {%s } "
+	                          "  GRAPH tracker:FileSystem { "
+	                          "    ?f a rdfs:Resource ; "
+	                          "      nie:url ?u . "
+	                          "    OPTIONAL { ?f nfo:hasHash ?hash } "
+	                          "  } "
+	                          "  GRAPH ?g { "
+	                          "    ?f a rdfs:Resource . "
+	                          "    OPTIONAL { ?ie nie:isStoredAs ?f } "
+	                          "  } "
+	                          "}",
+	                          values->str);
+	tracker_batch_add_sparql (batch, sparql);
+	g_ptr_array_set_size (uris, 0);
+}
+
+/* Drops the ops superseded by later ones on the same file */
+static GPtrArray *
+compact_ops (GPtrArray *ops)
+{
+	GPtrArray *live;
+	guint i;
+
+	live = g_ptr_array_new_full (ops->len,
+	                             (GDestroyNotify) batch_op_free);
+
+	for (i = 0; i < ops->len; i++) {
+		BatchOp *op = g_ptr_array_index (ops, i);
+
+		if (op->superseded)
+			batch_op_free (op);
+		else
+			g_ptr_array_add (live, op);
+	}
+
+	g_ptr_array_set_free_func (ops, NULL);
+	g_ptr_array_unref (ops);
+
+	return live;
+}
+
+static TrackerBatch *
+create_batch (TrackerSparqlBuffer *buffer,
+              GPtrArray           *ops)
+{
+	TrackerSparqlBufferPrivate *priv;
+	g_autoptr (GPtrArray) deletes = NULL;
+	TrackerBatch *batch;
+	guint i;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	batch = tracker_sparql_connection_create_batch (priv->connection);
+	TRACKER_MEMORY_TRACK_OBJECT (BATCHES, batch);
+	deletes = g_ptr_array_new ();
+
+	for (i = 0; ops && i < ops->len; i++) {
+		BatchOp *op = g_ptr_array_index (ops, i);
+
+		if (op->stmt == priv->delete_file) {
+			g_ptr_array_add (deletes,
+			                 (gpointer) g_value_get_string (&op->values[0]));
+			continue;
+		}
+
+		/* Updates must apply in order, deletions are added first */
+		batch_add_deletes (buffer, batch, deletes);
+		batch_add_op (batch, op);
+	}
+
+	batch_add_deletes (buffer, batch, deletes);
+
+	return batch;
+}
+
+/* Content deletes may go ahead of the batch if nothing before them in
+ * the batch is about the deleted files. Moves are not looked into, the
+ * content deletes after them stay in the batch.
+ */
+static GPtrArray *
+collect_content_deletes (TrackerSparqlBuffer *buffer,
+                         GPtrArray           *ops)
+{
+	TrackerSparqlBufferPrivate *priv;
+	GPtrArray *content_deletes = NULL;
+	guint i, j;
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	for (i = 0; ops && i < ops->len; i++) {
+		BatchOp *op = g_ptr_array_index (ops, i);
+		gboolean touched = FALSE;
+
+		if (op->stmt == priv->move_file || op->stmt == priv->move_content)
+			break;
+		if (op->stmt != priv->delete_content)
+			continue;
+
+		for (j = 0; j < i && !touched; j++) {
+			BatchOp *prev = g_ptr_array_index (ops, j);
+
+			touched = g_file_has_prefix (prev->file, op->file);
+		}
+
+		if (touched)
+			continue;
+
+		if (!content_deletes)
+			content_deletes = g_ptr_array_new_with_free_func (g_free);
+
+		g_ptr_array_add (content_deletes,
+		                 g_value_dup_string (&op->values[0]));
+	}
+
+	return content_deletes;
+}
+
+static void update_batch_data_delete_next_content (UpdateBatchData *update_data);
+
+static void
+update_batch_data_execute (UpdateBatchData *update_data)
+{
+	update_data->start_time = g_get_monotonic_time ();
+	tracker_batch_execute_async (update_data->batch,
+	                             NULL,
+	                             batch_execute_cb,
+	                             update_data);
+}
+
+static void
+content_chunk_deleted_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	UpdateBatchData *update_data = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                             result, &error)) {
+		/* The batch deletes what is left */
+		g_warning ("Could not delete folder content: %s", error->message);
+		g_ptr_array_remove_index (update_data->content_deletes, 0);
+	}
+
+	update_batch_data_delete_next_content (update_data);
+}
+
+static void
+content_left_cb (GObject      *object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	UpdateBatchData *update_data = user_data;
+	TrackerSparqlBufferPrivate *priv;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+	const gchar *uri;
+
+	priv = tracker_sparql_buffer_get_instance_private (update_data->buffer);
+	uri = g_ptr_array_index (update_data->content_deletes, 0);
+
+	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                  result, &error);
+
+	if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		TRACKER_NOTE (MINER_FS_EVENTS,
+		              g_message ("(Sparql buffer) Deleting up to %d files in the content of '%s'",
+		                         CONTENT_DELETE_CHUNK_SIZE, uri));
+		tracker_sparql_statement_bind_string (priv->delete_content_chunk, "uri", uri);
+		tracker_sparql_statement_bind_int (priv->delete_content_chunk, "limit",
+		                                   CONTENT_DELETE_CHUNK_SIZE);
+		tracker_sparql_statement_update_async (priv->delete_content_chunk,
+		                                       NULL,
+		                                       content_chunk_deleted_cb,
+		                                       update_data);
+		return;
+	}
+
+	if (error)
+		g_warning ("Could not query folder content: %s", error->message);
+
+	/* Few enough files are left for the batch */
+	g_ptr_array_remove_index (update_data->content_deletes, 0);
+	update_batch_data_delete_next_content (update_data);
+}
+
+/* Large folder contents are deleted in chunks, between these other
+ * connections get to read and write. If this is interrupted, the
+ * folders are still there to be found missing and deleted again.
+ */
+static void
+update_batch_data_delete_next_content (UpdateBatchData *update_data)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	if (!update_data->content_deletes ||
+	    update_data->content_deletes->len == 0) {
+		update_batch_data_execute (update_data);
+		return;
+	}
+
+	priv = tracker_sparql_buffer_get_instance_private (update_data->buffer);
+
+	tracker_sparql_statement_bind_string (priv->get_content_left, "uri",
+	                                      g_ptr_array_index (update_data->content_deletes, 0));
+	tracker_sparql_statement_bind_int (priv->get_content_left, "limit",
+	                                   CONTENT_DELETE_CHUNK_SIZE);
+	tracker_sparql_statement_execute_async (priv->get_content_left,
+	                                        NULL,
+	                                        content_left_cb,
+	                                        update_data);
 }
 
 gboolean
@@ -264,6 +1122,12 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 
 	priv = tracker_sparql_buffer_get_instance_private (buffer);
 
+	/* Buffers are double-buffered: flushed tasks are taken out of the
+	 * pool, so the next batch can be filled while this one executes.
+	 * Only one batch executes at a time, the caller is expected to
+	 * stop adding tasks once the pool limit is reached again, and
+	 * flush once the previous batch is done.
+	 */
 	if (priv->n_updates > 0) {
 		return FALSE;
 	}
@@ -274,12 +1138,26 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	}
 
 	TRACKER_NOTE (MINER_FS_EVENTS, g_message ("Flushing SPARQL buffer, reason: %s", reason));
+	TRACKER_TRACE (buffer_flush, priv->tasks->len, reason);
+
+	if (priv->n_superseded > 0) {
+		TRACKER_NOTE (MINER_FS_EVENTS,
+		              g_message ("(Sparql buffer) Dropping %u updates superseded by later ones",
+		                         priv->n_superseded));
+		priv->ops = compact_ops (priv->ops);
+		priv->n_superseded = 0;
+	}
+
+	g_hash_table_remove_all (priv->groups);
 
 	update_data = g_slice_new0 (UpdateBatchData);
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (UpdateBatchData));
 	update_data->buffer = buffer;
 	update_data->tasks = g_ptr_array_ref (priv->tasks);
-	update_data->batch = g_object_ref (priv->batch);
+	update_data->ops = g_steal_pointer (&priv->ops);
+	update_data->batch = create_batch (buffer, update_data->ops);
 	update_data->async_task = g_task_new (buffer, NULL, cb, user_data);
+	update_data->content_deletes = collect_content_deletes (buffer, update_data->ops);
 
 	/* Empty pool, update_data will keep
 	 * references to the tasks to keep
@@ -288,7 +1166,6 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	g_ptr_array_unref (priv->tasks);
 	priv->tasks = NULL;
 	priv->n_updates++;
-	g_clear_object (&priv->batch);
 
 	/* While flushing, remove the tasks from the task pool too, so it's
 	 * hinted as below limits again.
@@ -297,10 +1174,7 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	                     (GFunc) remove_task_foreach,
 	                     update_data->buffer);
 
-	tracker_batch_execute_async (update_data->batch,
-	                             NULL,
-	                             batch_execute_cb,
-	                             update_data);
+	update_batch_data_delete_next_content (update_data);
 	return TRUE;
 }
 
@@ -323,21 +1197,6 @@ sparql_buffer_push_to_pool (TrackerSparqlBuffer *buffer,
 	g_ptr_array_add (priv->tasks, tracker_task_ref (task));
 }
 
-static TrackerBatch *
-tracker_sparql_buffer_get_current_batch (TrackerSparqlBuffer *buffer)
-{
-	TrackerSparqlBufferPrivate *priv;
-
-	g_return_val_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer), NULL);
-
-	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
-
-	if (!priv->batch)
-		priv->batch = tracker_sparql_connection_create_batch (priv->connection);
-
-	return priv->batch;
-}
-
 static SparqlTaskData *
 sparql_task_data_new_resource (const gchar     *graph,
                                TrackerResource *resource)
@@ -348,6 +1207,7 @@ sparql_task_data_new_resource (const gchar     *graph,
 	task_data->type = TASK_TYPE_RESOURCE;
 	task_data->d.resource.resource = g_object_ref (resource);
 	task_data->d.resource.graph = g_strdup (graph);
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (SparqlTaskData));
 
 	return task_data;
 }
@@ -360,6 +1220,7 @@ sparql_task_data_new_stmt (TrackerSparqlStatement *stmt)
 	task_data = g_slice_new0 (SparqlTaskData);
 	task_data->type = TASK_TYPE_STMT;
 	task_data->d.stmt.stmt = stmt;
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (SparqlTaskData));
 
 	return task_data;
 }
@@ -367,11 +1228,14 @@ sparql_task_data_new_stmt (TrackerSparqlStatement *stmt)
 static void
 sparql_task_data_free (SparqlTaskData *data)
 {
+	g_clear_error (&data->error);
+
 	if (data->type == TASK_TYPE_RESOURCE) {
 		g_clear_object (&data->d.resource.resource);
 		g_free (data->d.resource.graph);
 	}
 
+	TRACKER_MEMORY_FREE (BATCHES, sizeof (SparqlTaskData));
 	g_slice_free (SparqlTaskData, data);
 }
 
@@ -381,16 +1245,21 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
                             const gchar         *graph,
                             TrackerResource     *resource)
 {
-	TrackerBatch *batch;
 	TrackerTask *task;
 	SparqlTaskData *data;
+	BatchOp *op;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
 	g_return_if_fail (G_IS_FILE (file));
 	g_return_if_fail (TRACKER_IS_RESOURCE (resource));
 
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
-	tracker_batch_add_resource (batch, graph, resource);
+	op = g_slice_new0 (BatchOp);
+	op->file = g_object_ref (file);
+	op->graph = g_strdup (graph);
+	op->resource = g_object_ref (resource);
+	TRACKER_MEMORY_ALLOC (BATCHES, sizeof (BatchOp));
+	TRACKER_MEMORY_TRACK_OBJECT (BATCHES, resource);
+	sparql_buffer_add_op (buffer, op);
 
 	data = sparql_task_data_new_resource (graph, resource);
 
@@ -400,6 +1269,36 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 	tracker_task_unref (task);
 }
 
+/* Bulk mode favors throughput over the latency of single changes,
+ * batches start at the largest size and may grow further.
+ */
+void
+tracker_sparql_buffer_set_bulk_mode (TrackerSparqlBuffer *buffer,
+                                     gboolean             bulk_mode)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
+
+	priv = tracker_sparql_buffer_get_instance_private (buffer);
+
+	if (bulk_mode) {
+		priv->target_latency = BULK_TARGET_BATCH_LATENCY_USEC;
+		priv->limit_range = BULK_BATCH_LIMIT_RANGE;
+	} else {
+		priv->target_latency = TARGET_BATCH_LATENCY_USEC;
+		priv->limit_range = BATCH_LIMIT_RANGE;
+	}
+
+	if (priv->initial_limit == 0)
+		return;
+
+	tracker_task_pool_set_limit (TRACKER_TASK_POOL (buffer),
+	                             bulk_mode ?
+	                             priv->initial_limit * BATCH_LIMIT_RANGE :
+	                             priv->initial_limit);
+}
+
 gchar *
 tracker_sparql_task_get_sparql (TrackerTask *task)
 {
@@ -418,6 +1317,19 @@ tracker_sparql_task_get_sparql (TrackerTask *task)
 	return NULL;
 }
 
+/* Returns the error the updates of the file of @task failed with,
+ * if the rest of the batch could be committed.
+ */
+const GError *
+tracker_sparql_task_get_error (TrackerTask *task)
+{
+	SparqlTaskData *task_data;
+
+	task_data = tracker_task_get_data (task);
+
+	return task_data->error;
+}
+
 GPtrArray *
 tracker_sparql_buffer_flush_finish (TrackerSparqlBuffer  *buffer,
                                     GAsyncResult         *res,
@@ -457,7 +1369,6 @@ tracker_sparql_buffer_log_delete (TrackerSparqlBuffer *buffer,
                                   GFile               *file)
 {
 	TrackerSparqlBufferPrivate *priv;
-	TrackerBatch *batch;
 	g_autofree gchar *uri = NULL;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
@@ -465,11 +1376,15 @@ tracker_sparql_buffer_log_delete (TrackerSparqlBuffer *buffer,
 
 	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
 
+	/* Consecutive deletes are merged into one update when the
+	 * batch is created.
+	 */
 	uri = g_file_get_uri (file);
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
-	tracker_batch_add_statement (batch, priv->delete_file,
-	                             "uri", G_TYPE_STRING, uri,
-	                             NULL);
+	sparql_buffer_begin_group (buffer, file, OP_KIND_DELETE);
+	sparql_buffer_add_op (buffer,
+	                      batch_op_new (file, priv->delete_file,
+	                                    "uri", G_TYPE_STRING, uri,
+	                                    NULL));
 	push_stmt_task (buffer, priv->delete_file, file);
 }
 
@@ -478,7 +1393,6 @@ tracker_sparql_buffer_log_delete_content (TrackerSparqlBuffer *buffer,
                                           GFile               *file)
 {
 	TrackerSparqlBufferPrivate *priv;
-	TrackerBatch *batch;
 	g_autofree gchar *uri = NULL;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
@@ -487,8 +1401,8 @@ tracker_sparql_buffer_log_delete_content (TrackerSparqlBuffer *buffer,
 	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
 
 	uri = g_file_get_uri (file);
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
-	tracker_batch_add_statement (batch, priv->delete_content,
+	sparql_buffer_begin_group (buffer, file, OP_KIND_TREE);
+	sparql_buffer_add_statement (buffer, file, priv->delete_content,
 	                             "uri", G_TYPE_STRING, uri,
 	                             NULL);
 	push_stmt_task (buffer, priv->delete_content, file);
@@ -501,7 +1415,6 @@ tracker_sparql_buffer_log_move (TrackerSparqlBuffer *buffer,
                                 const gchar         *dest_data_source)
 {
 	TrackerSparqlBufferPrivate *priv;
-	TrackerBatch *batch;
 	g_autofree gchar *source_uri = NULL, *dest_uri = NULL, *new_parent_uri = NULL;
 	g_autofree gchar *basename = NULL, *path = NULL;
 	g_autoptr (GFile) new_parent = NULL;
@@ -519,8 +1432,8 @@ tracker_sparql_buffer_log_move (TrackerSparqlBuffer *buffer,
 	new_parent_uri = g_file_get_uri (new_parent);
 	basename = g_filename_display_basename (path);
 
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
-	tracker_batch_add_statement (batch, priv->move_file,
+	sparql_buffer_begin_group (buffer, dest, OP_KIND_TREE);
+	sparql_buffer_add_statement (buffer, dest, priv->move_file,
 	                             "sourceUri", G_TYPE_STRING, source_uri,
 	                             "destUri", G_TYPE_STRING, dest_uri,
 	                             "newFilename", G_TYPE_STRING, basename,
@@ -537,7 +1450,6 @@ tracker_sparql_buffer_log_move_content (TrackerSparqlBuffer *buffer,
                                         GFile               *dest)
 {
 	TrackerSparqlBufferPrivate *priv;
-	TrackerBatch *batch;
 	g_autofree gchar *source_uri = NULL, *dest_uri = NULL;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
@@ -549,8 +1461,8 @@ tracker_sparql_buffer_log_move_content (TrackerSparqlBuffer *buffer,
 	source_uri = g_file_get_uri (source);
 	dest_uri = g_file_get_uri (dest);
 
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
-	tracker_batch_add_statement (batch, priv->move_content,
+	sparql_buffer_begin_group (buffer, dest, OP_KIND_TREE);
+	sparql_buffer_add_statement (buffer, dest, priv->move_content,
 	                             "sourceUri", G_TYPE_STRING, source_uri,
 	                             "destUri", G_TYPE_STRING, dest_uri,
 	                             NULL);
@@ -558,15 +1470,58 @@ tracker_sparql_buffer_log_move_content (TrackerSparqlBuffer *buffer,
 	push_stmt_task (buffer, priv->move_content, dest);
 }
 
+/* Content is kept if the file has the same nie:InformationElement and
+ * content fingerprint as last time, otherwise it is deleted for the
+ * extractor to process the file again.
+ */
+static void
+log_delete_file_content (TrackerSparqlBuffer *buffer,
+                         GFile               *file,
+                         const gchar         *uri,
+                         const gchar         *content_urn,
+                         const gchar         *content_fingerprint)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
+
+	if (!content_urn || !content_fingerprint)
+		content_urn = content_fingerprint = "";
+
+	sparql_buffer_add_statement (buffer, file, priv->delete_file_content,
+	                             "uri", G_TYPE_STRING, uri,
+	                             "contentUrn", G_TYPE_STRING, content_urn,
+	                             "fingerprint", G_TYPE_STRING, content_fingerprint,
+	                             NULL);
+}
+
+/* Goes after the file insertion */
+static void
+log_insert_fingerprint (TrackerSparqlBuffer *buffer,
+                        GFile               *file,
+                        const gchar         *uri,
+                        const gchar         *content_fingerprint)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
+
+	sparql_buffer_add_statement (buffer, file, priv->insert_fingerprint,
+	                             "uri", G_TYPE_STRING, uri,
+	                             "fingerprint", G_TYPE_STRING, content_fingerprint,
+	                             NULL);
+	push_stmt_task (buffer, priv->insert_fingerprint, file);
+}
+
 void
 tracker_sparql_buffer_log_file (TrackerSparqlBuffer *buffer,
                                 GFile               *file,
                                 const gchar         *content_graph,
                                 TrackerResource     *file_resource,
-                                TrackerResource     *graph_resource)
+                                TrackerResource     *graph_resource,
+                                const gchar         *content_fingerprint)
 {
-	TrackerSparqlBufferPrivate *priv;
-	TrackerBatch *batch;
+	TrackerResource *content = NULL;
 	g_autofree gchar *uri = NULL;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
@@ -574,17 +1529,25 @@ tracker_sparql_buffer_log_file (TrackerSparqlBuffer *buffer,
 	g_return_if_fail (TRACKER_IS_RESOURCE (file_resource));
 	g_return_if_fail (!graph_resource || TRACKER_IS_RESOURCE (graph_resource));
 
-	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
-	batch = tracker_sparql_buffer_get_current_batch (buffer);
 	uri = g_file_get_uri (file);
-	tracker_batch_add_statement (batch, priv->delete_file_content,
-	                             "uri", G_TYPE_STRING, uri,
-	                             NULL);
+
+	if (content_graph && graph_resource)
+		content = tracker_resource_get_first_relation (graph_resource, "nie:interpretedAs");
+
+	sparql_buffer_begin_group (buffer, file, OP_KIND_FILE);
+	log_delete_file_content (buffer, file, uri,
+	                         content ? tracker_resource_get_identifier (content) : NULL,
+	                         content_fingerprint);
 
 	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
 
 	if (content_graph && graph_resource)
 		tracker_sparql_buffer_push (buffer, file, content_graph, graph_resource);
+
+	if (content_fingerprint)
+		log_insert_fingerprint (buffer, file, uri, content_fingerprint);
+
+	sparql_buffer_end_group (buffer);
 }
 
 void
@@ -599,6 +1562,8 @@ tracker_sparql_buffer_log_folder (TrackerSparqlBuffer *buffer,
 	g_return_if_fail (TRACKER_IS_RESOURCE (file_resource));
 	g_return_if_fail (TRACKER_IS_RESOURCE (folder_resource));
 
+	sparql_buffer_begin_group (buffer, file, OP_KIND_OTHER);
+
 	/* Add indexing roots also to content specific graphs to provide the availability information */
 	if (is_root) {
 		const gchar *special_graphs[] = {
@@ -622,17 +1587,185 @@ tracker_sparql_buffer_log_folder (TrackerSparqlBuffer *buffer,
 void
 tracker_sparql_buffer_log_attributes_update (TrackerSparqlBuffer *buffer,
                                              GFile               *file,
-                                             const gchar         *content_graph,
-                                             TrackerResource     *file_resource,
-                                             TrackerResource     *graph_resource)
+                                             GDateTime           *modified,
+                                             GDateTime           *accessed,
+                                             GDateTime           *created)
 {
+	TrackerSparqlBufferPrivate *priv;
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GDateTime) epoch = NULL;
+
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
 	g_return_if_fail (G_IS_FILE (file));
-	g_return_if_fail (TRACKER_IS_RESOURCE (file_resource));
-	g_return_if_fail (!graph_resource || TRACKER_IS_RESOURCE (graph_resource));
+	g_return_if_fail (modified != NULL);
 
-	if (content_graph && graph_resource)
-		tracker_sparql_buffer_push (buffer, file, content_graph, graph_resource);
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
 
-	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
+	/* Attribute updates have a fixed shape, use a prepared statement
+	 * instead of building a TrackerResource for every file.
+	 * Unset dates keep their current value, but still need something
+	 * bound.
+	 */
+	epoch = g_date_time_new_from_unix_utc (0);
+
+	uri = g_file_get_uri (file);
+	sparql_buffer_begin_group (buffer, file, OP_KIND_ATTRIBUTES);
+	sparql_buffer_add_statement (buffer, file, priv->update_attributes,
+	                             "uri", G_TYPE_STRING, uri,
+	                             "modified", G_TYPE_DATE_TIME, modified,
+	                             "accessed", G_TYPE_DATE_TIME, accessed ? accessed : epoch,
+	                             "hasAccessed", G_TYPE_BOOLEAN, accessed != NULL,
+	                             "created", G_TYPE_DATE_TIME, created ? created : epoch,
+	                             "hasCreated", G_TYPE_BOOLEAN, created != NULL,
+	                             NULL);
+	sparql_buffer_end_group (buffer);
+
+	push_stmt_task (buffer, priv->update_attributes, file);
+}
+
+/* For files whose content changed, but not its metadata (e.g. it was
+ * just written back), extracted content is left untouched.
+ */
+void
+tracker_sparql_buffer_log_rewritten_file (TrackerSparqlBuffer *buffer,
+                                          GFile               *file,
+                                          gint64               file_size,
+                                          const gchar         *content_fingerprint)
+{
+	TrackerSparqlBufferPrivate *priv;
+	g_autofree gchar *uri = NULL;
+
+	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
+	g_return_if_fail (G_IS_FILE (file));
+
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
+
+	uri = g_file_get_uri (file);
+	sparql_buffer_begin_group (buffer, file, OP_KIND_REWRITTEN);
+	sparql_buffer_add_statement (buffer, file, priv->update_rewritten,
+	                             "uri", G_TYPE_STRING, uri,
+	                             "fileSize", G_TYPE_INT64, file_size,
+	                             "fingerprint", G_TYPE_STRING,
+	                             content_fingerprint ? content_fingerprint : "",
+	                             NULL);
+	sparql_buffer_end_group (buffer);
+
+	push_stmt_task (buffer, priv->update_rewritten, file);
+}
+
+static TrackerSparqlStatement *
+get_insert_file_content_stmt (TrackerSparqlBuffer *buffer,
+                              const gchar         *graph)
+{
+	TrackerSparqlBufferPrivate *priv;
+	TrackerSparqlStatement *stmt;
+	g_autoptr (GBytes) bytes = NULL;
+	g_autoptr (GError) error = NULL;
+	g_auto (GStrv) parts = NULL;
+	g_autofree gchar *sparql = NULL;
+
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
+
+	stmt = g_hash_table_lookup (priv->insert_file_content, graph);
+	if (stmt)
+		return stmt;
+
+	bytes = g_resources_lookup_data ("/org/freedesktop/Tracker3/Miner/Files/queries/insert-file-content.rq",
+	                                 G_RESOURCE_LOOKUP_FLAGS_NONE,
+	                                 NULL);
+	g_assert (bytes != NULL);
+
+	/* There is a handful of content graphs, keep one statement each */
+	parts = g_strsplit (g_bytes_get_data (bytes, NULL), "~graph", -1);
+	sparql = g_strjoinv (graph, parts);
+
+	stmt = tracker_sparql_connection_update_statement (priv->connection,
+	                                                   sparql,
+	                                                   NULL,
+	                                                   &error);
+	if (!stmt) {
+		g_critical ("Could not create statement for graph %s: %s",
+		            graph, error->message);
+		return NULL;
+	}
+
+	g_hash_table_insert (priv->insert_file_content, g_strdup (graph), stmt);
+
+	return stmt;
+}
+
+void
+tracker_sparql_buffer_log_file_info (TrackerSparqlBuffer *buffer,
+                                     GFile               *file,
+                                     const gchar         *parent_urn,
+                                     const gchar         *data_source,
+                                     const gchar         *file_name,
+                                     gint64               file_size,
+                                     GDateTime           *modified,
+                                     GDateTime           *accessed,
+                                     GDateTime           *created,
+                                     const gchar         *content_graph,
+                                     const gchar         *content_urn,
+                                     const gchar         *content_fingerprint)
+{
+	TrackerSparqlBufferPrivate *priv;
+	TrackerSparqlStatement *content_stmt = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GDateTime) epoch = NULL;
+
+	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
+	g_return_if_fail (G_IS_FILE (file));
+	g_return_if_fail (parent_urn != NULL);
+	g_return_if_fail (data_source != NULL);
+	g_return_if_fail (modified != NULL);
+	g_return_if_fail (!content_graph || content_urn);
+
+	priv = tracker_sparql_buffer_get_instance_private (TRACKER_SPARQL_BUFFER (buffer));
+
+	if (content_graph) {
+		content_stmt = get_insert_file_content_stmt (buffer, content_graph);
+		if (!content_stmt)
+			return;
+	}
+
+	/* Regular files are the bulk of the indexed data, and are all
+	 * inserted with the same shape. Bind them to prepared statements
+	 * instead of building and serializing TrackerResources for each.
+	 */
+	epoch = g_date_time_new_from_unix_utc (0);
+
+	uri = g_file_get_uri (file);
+	sparql_buffer_begin_group (buffer, file, OP_KIND_FILE);
+	log_delete_file_content (buffer, file, uri, content_urn, content_fingerprint);
+
+	sparql_buffer_add_statement (buffer, file, priv->insert_file,
+	                             "uri", G_TYPE_STRING, uri,
+	                             "parent", G_TYPE_STRING, parent_urn,
+	                             "fileName", G_TYPE_STRING, file_name,
+	                             "fileSize", G_TYPE_INT64, file_size,
+	                             "dataSource", G_TYPE_STRING, data_source,
+	                             "modified", G_TYPE_DATE_TIME, modified,
+	                             "accessed", G_TYPE_DATE_TIME, accessed ? accessed : epoch,
+	                             "hasAccessed", G_TYPE_BOOLEAN, accessed != NULL,
+	                             "created", G_TYPE_DATE_TIME, created ? created : epoch,
+	                             "hasCreated", G_TYPE_BOOLEAN, created != NULL,
+	                             NULL);
+	push_stmt_task (buffer, priv->insert_file, file);
+
+	if (content_stmt) {
+		sparql_buffer_add_statement (buffer, file, content_stmt,
+		                             "uri", G_TYPE_STRING, uri,
+		                             "fileName", G_TYPE_STRING, file_name,
+		                             "fileSize", G_TYPE_INT64, file_size,
+		                             "dataSource", G_TYPE_STRING, data_source,
+		                             "modified", G_TYPE_DATE_TIME, modified,
+		                             "contentUrn", G_TYPE_STRING, content_urn,
+		                             NULL);
+		push_stmt_task (buffer, content_stmt, file);
+	}
+
+	if (content_fingerprint)
+		log_insert_fingerprint (buffer, file, uri, content_fingerprint);
+
+	sparql_buffer_end_group (buffer);
 }
@@ -65,7 +65,11 @@ GPtrArray *          tracker_sparql_buffer_flush_finish (TrackerSparqlBuffer  *b
                                                          GAsyncResult         *res,
                                                          GError              **error);
 
+void                 tracker_sparql_buffer_set_bulk_mode (TrackerSparqlBuffer *buffer,
+                                                          gboolean             bulk_mode);
+
 gchar *              tracker_sparql_task_get_sparql          (TrackerTask *task);
+const GError *       tracker_sparql_task_get_error           (TrackerTask *task);
 
 void tracker_sparql_buffer_log_delete (TrackerSparqlBuffer *buffer,
                                        GFile               *file);
@@ -86,7 +90,8 @@ void tracker_sparql_buffer_log_file (TrackerSparqlBuffer *buffer,
                                      GFile               *file,
                                      const gchar         *content_graph,
                                      TrackerResource     *file_resource,
-                                     TrackerResource     *graph_resource);
+                                     TrackerResource     *graph_resource,
+                                     const gchar         *content_fingerprint);
 
 void tracker_sparql_buffer_log_folder (TrackerSparqlBuffer *buffer,
                                        GFile               *file,
@@ -96,9 +101,27 @@ void tracker_sparql_buffer_log_folder (TrackerSparqlBuffer *buffer,
 
 void tracker_sparql_buffer_log_attributes_update (TrackerSparqlBuffer *buffer,
                                                   GFile               *file,
-                                                  const gchar         *content_graph,
-                                                  TrackerResource     *file_resource,
-                                                  TrackerResource     *graph_resource);
+                                                  GDateTime           *modified,
+                                                  GDateTime           *accessed,
+                                                  GDateTime           *created);
+
+void tracker_sparql_buffer_log_rewritten_file (TrackerSparqlBuffer *buffer,
+                                               GFile               *file,
+                                               gint64               file_size,
+                                               const gchar         *content_fingerprint);
+
+void tracker_sparql_buffer_log_file_info (TrackerSparqlBuffer *buffer,
+                                          GFile               *file,
+                                          const gchar         *parent_urn,
+                                          const gchar         *data_source,
+                                          const gchar         *file_name,
+                                          gint64               file_size,
+                                          GDateTime           *modified,
+                                          GDateTime           *accessed,
+                                          GDateTime           *created,
+                                          const gchar         *content_graph,
+                                          const gchar         *content_urn,
+                                          const gchar         *content_fingerprint);
 
 G_END_DECLS
 
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include <libtracker-miners-common/tracker-common.h>
+
+#include "tracker-spill-queue.h"
+
+/* A FIFO of files kept in an unlinked temporary file, one URI per
+ * line. Used to keep memory bounded when there are more items
+ * queued than are reasonable to keep around as GFiles.
+ */
+
+#define READ_BUFFER_SIZE 65536
+
+typedef struct {
+	/* Next unread offset in the file */
+	goffset offset;
+	/* Read ahead data, unread from pos to len */
+	gchar *buffer;
+	gsize pos;
+	gsize len;
+} SpillReader;
+
+struct _TrackerSpillQueue {
+	gint fd;
+	goffset write_offset;
+	SpillReader reader;
+	guint length;
+};
+
+TrackerSpillQueue *
+tracker_spill_queue_new (void)
+{
+	TrackerSpillQueue *queue;
+
+	queue = g_new0 (TrackerSpillQueue, 1);
+	queue->fd = -1;
+
+	return queue;
+}
+
+void
+tracker_spill_queue_free (TrackerSpillQueue *queue)
+{
+	if (queue->fd >= 0)
+		close (queue->fd);
+
+	if (queue->reader.buffer)
+		TRACKER_MEMORY_FREE (QUEUES, READ_BUFFER_SIZE);
+
+	g_free (queue->reader.buffer);
+	g_free (queue);
+}
+
+static gboolean
+spill_queue_ensure_file (TrackerSpillQueue *queue)
+{
+	g_autofree gchar *path = NULL;
+	g_autoptr (GError) error = NULL;
+
+	if (queue->fd >= 0)
+		return TRUE;
+
+	queue->fd = g_file_open_tmp ("tracker-spill-XXXXXX", &path, &error);
+	if (queue->fd < 0) {
+		g_warning ("Could not create spill file: %s", error->message);
+		return FALSE;
+	}
+
+	/* Only reachable through the file descriptor from now on */
+	g_unlink (path);
+
+	return TRUE;
+}
+
+static void
+spill_queue_reset (TrackerSpillQueue *queue)
+{
+	/* Give the disk space back once everything was read */
+	if (queue->fd >= 0 && ftruncate (queue->fd, 0) < 0)
+		g_warning ("Could not truncate spill file: %s", g_strerror (errno));
+
+	queue->write_offset = 0;
+	queue->reader.offset = 0;
+	queue->reader.pos = queue->reader.len = 0;
+	queue->length = 0;
+}
+
+static gboolean
+spill_reader_fill (TrackerSpillQueue *queue,
+                   SpillReader       *reader)
+{
+	gsize to_read;
+	gssize n;
+
+	if (!reader->buffer) {
+		reader->buffer = g_malloc (READ_BUFFER_SIZE);
+		TRACKER_MEMORY_ALLOC (QUEUES, READ_BUFFER_SIZE);
+	}
+
+	/* Move the incomplete line to the start of the buffer */
+	memmove (reader->buffer, reader->buffer + reader->pos,
+	         reader->len - reader->pos);
+	reader->len -= reader->pos;
+	reader->pos = 0;
+
+	to_read = MIN (READ_BUFFER_SIZE - reader->len,
+	               queue->write_offset - reader->offset);
+	if (to_read == 0)
+		return FALSE;
+
+	do {
+		n = pread (queue->fd, reader->buffer + reader->len,
+		           to_read, reader->offset);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0) {
+		if (n < 0)
+			g_warning ("Could not read spill file: %s", g_strerror (errno));
+		return FALSE;
+	}
+
+	reader->len += n;
+	reader->offset += n;
+
+	return TRUE;
+}
+
+/* Returns the next line, owned by the reader buffer */
+static gchar *
+spill_reader_next_line (TrackerSpillQueue *queue,
+                        SpillReader       *reader)
+{
+	gchar *start, *end;
+
+	while (TRUE) {
+		start = reader->buffer + reader->pos;
+		end = reader->buffer ?
+			memchr (start, '\n', reader->len - reader->pos) : NULL;
+
+		if (end) {
+			*end = '\0';
+			reader->pos = end - reader->buffer + 1;
+			return start;
+		}
+
+		if (!spill_reader_fill (queue, reader))
+			return NULL;
+	}
+}
+
+gboolean
+tracker_spill_queue_push (TrackerSpillQueue *queue,
+                          GFile             *file)
+{
+	g_autofree gchar *uri = NULL, *line = NULL;
+	gsize len, written = 0;
+	gssize n;
+
+	if (!spill_queue_ensure_file (queue))
+		return FALSE;
+
+	uri = g_file_get_uri (file);
+	line = g_strconcat (uri, "\n", NULL);
+	len = strlen (line);
+
+	while (written < len) {
+		n = pwrite (queue->fd, line + written, len - written,
+		            queue->write_offset + written);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			g_warning ("Could not write spill file: %s", g_strerror (errno));
+			return FALSE;
+		}
+
+		written += n;
+	}
+
+	queue->write_offset += len;
+	queue->length++;
+
+	return TRUE;
+}
+
+GFile *
+tracker_spill_queue_pop (TrackerSpillQueue *queue)
+{
+	GFile *file;
+	gchar *uri;
+
+	if (queue->length == 0)
+		return NULL;
+
+	uri = spill_reader_next_line (queue, &queue->reader);
+
+	if (!uri) {
+		g_warning ("Lost %d spilled items", queue->length);
+		spill_queue_reset (queue);
+		return NULL;
+	}
+
+	file = g_file_new_for_uri (uri);
+	queue->length--;
+
+	if (queue->length == 0)
+		spill_queue_reset (queue);
+
+	return file;
+}
+
+guint
+tracker_spill_queue_get_length (TrackerSpillQueue *queue)
+{
+	return queue->length;
+}
+
+/* Calls @func on every queued file, oldest first, without popping them */
+void
+tracker_spill_queue_foreach (TrackerSpillQueue *queue,
+                             GFunc              func,
+                             gpointer           user_data)
+{
+	SpillReader reader = { 0, };
+	gchar *uri;
+	guint i;
+
+	if (queue->length == 0)
+		return;
+
+	/* Start from where the queue reader is */
+	reader.offset = queue->reader.offset;
+	reader.buffer = g_malloc (READ_BUFFER_SIZE);
+	reader.len = queue->reader.len - queue->reader.pos;
+
+	if (reader.len > 0) {
+		memcpy (reader.buffer,
+		        queue->reader.buffer + queue->reader.pos,
+		        reader.len);
+	}
+
+	for (i = 0; i < queue->length; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		uri = spill_reader_next_line (queue, &reader);
+		if (!uri)
+			break;
+
+		file = g_file_new_for_uri (uri);
+		func (file, user_data);
+	}
+
+	g_free (reader.buffer);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+#ifndef __TRACKER_SPILL_QUEUE_H__
+#define __TRACKER_SPILL_QUEUE_H__
+
+#include <gio/gio.h>
+
+typedef struct _TrackerSpillQueue TrackerSpillQueue;
+
+TrackerSpillQueue * tracker_spill_queue_new (void);
+void tracker_spill_queue_free (TrackerSpillQueue *queue);
+
+gboolean tracker_spill_queue_push (TrackerSpillQueue *queue,
+                                   GFile             *file);
+GFile * tracker_spill_queue_pop (TrackerSpillQueue *queue);
+
+guint tracker_spill_queue_get_length (TrackerSpillQueue *queue);
+
+void tracker_spill_queue_foreach (TrackerSpillQueue *queue,
+                                  GFunc              func,
+                                  gpointer           user_data);
+
+#endif /* __TRACKER_SPILL_QUEUE_H__ */
@@ -23,6 +23,7 @@
 
 #include <gio/gio.h>
 #include <gio/gunixmounts.h>
+#include <gudev/gudev.h>
 
 #include "tracker-storage.h"
 
@@ -45,12 +46,26 @@ typedef struct {
 
 	GNode *mounts;
 	GHashTable *mounts_by_uuid;
+	/* G_FILE_ATTRIBUTE_ID_FILESYSTEM -> GNode, or NULL if several
+	 * mounts are on the same filesystem, e.g. bind mounts.
+	 */
+	GHashTable *mounts_by_device;
+	/* Mounts whose filesystem ID is not known */
+	guint n_unresolved_mounts;
 	GHashTable *unmount_watchdogs;
+
+	GUnixMountMonitor *unix_mount_monitor;
+	GUdevClient *udev_client;
+	/* G_FILE_ATTRIBUTE_ID_FILESYSTEM -> filesystem UUID */
+	GHashTable *filesystem_ids;
+	/* G_FILE_ATTRIBUTE_UNIX_DEVICE -> whether it is rotational */
+	GHashTable *rotational_devices;
 } TrackerStoragePrivate;
 
 typedef struct {
 	gchar *mount_point;
 	gchar *uuid;
+	gchar *device_id;
 	guint unmount_timer_id;
 	guint removable : 1;
 	guint optical : 1;
@@ -86,6 +101,8 @@ static void     mount_removed_cb         (GVolumeMonitor *monitor,
 static void     mount_pre_removed_cb     (GVolumeMonitor *monitor,
                                           GMount         *mount,
                                           gpointer        user_data);
+static void     unix_mounts_changed_cb   (GUnixMountMonitor *monitor,
+                                          gpointer           user_data);
 
 enum {
 	MOUNT_POINT_ADDED,
@@ -147,6 +164,8 @@ tracker_storage_init (TrackerStorage *storage)
 	                                              g_str_equal,
 	                                              (GDestroyNotify) g_free,
 	                                              NULL);
+	/* Keys are owned by the MountInfo */
+	priv->mounts_by_device = g_hash_table_new (g_str_hash, g_str_equal);
 	priv->unmount_watchdogs = g_hash_table_new_full (NULL, NULL, NULL,
 							 (GDestroyNotify) g_source_remove);
 
@@ -160,6 +179,18 @@ tracker_storage_init (TrackerStorage *storage)
 	g_signal_connect_object (priv->volume_monitor, "mount-added",
 	                         G_CALLBACK (mount_added_cb), storage, 0);
 
+	priv->filesystem_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                              g_free, g_free);
+	priv->rotational_devices = g_hash_table_new (NULL, NULL);
+	priv->udev_client = g_udev_client_new (NULL);
+
+	/* Any mount table change may put a different filesystem
+	 * behind a device number.
+	 */
+	priv->unix_mount_monitor = g_unix_mount_monitor_get ();
+	g_signal_connect_object (priv->unix_mount_monitor, "mounts-changed",
+	                         G_CALLBACK (unix_mounts_changed_cb), storage, 0);
+
 	TRACKER_NOTE (MONITORS, g_message ("Mount monitors set up for to watch for added, removed and pre-unmounts..."));
 
 	/* Get all mounts and set them up */
@@ -176,11 +207,17 @@ tracker_storage_finalize (GObject *object)
 	priv = tracker_storage_get_instance_private (TRACKER_STORAGE (object));
 
 	g_hash_table_destroy (priv->unmount_watchdogs);
+	g_clear_pointer (&priv->filesystem_ids, g_hash_table_unref);
+	g_clear_pointer (&priv->rotational_devices, g_hash_table_unref);
+	g_clear_object (&priv->udev_client);
+	g_clear_object (&priv->unix_mount_monitor);
 
 	if (priv->mounts_by_uuid) {
 		g_hash_table_unref (priv->mounts_by_uuid);
 	}
 
+	g_clear_pointer (&priv->mounts_by_device, g_hash_table_unref);
+
 	if (priv->mounts) {
 		mount_node_free (priv->mounts);
 	}
@@ -255,6 +292,7 @@ mount_info_free (GNode    *node,
 	if (info) {
 		g_free (info->mount_point);
 		g_free (info->uuid);
+		g_free (info->device_id);
 
 		g_slice_free (MountInfo, info);
 	}
@@ -272,6 +310,45 @@ mount_info_find (GNode       *root,
 	return (node) ? node->data : NULL;
 }
 
+static gboolean
+mount_index_add_func (GNode    *node,
+                      gpointer  user_data)
+{
+	TrackerStoragePrivate *priv = user_data;
+	MountInfo *info = node->data;
+
+	if (!info)
+		return FALSE;
+
+	if (!info->device_id)
+		priv->n_unresolved_mounts++;
+	else if (g_hash_table_contains (priv->mounts_by_device, info->device_id))
+		g_hash_table_insert (priv->mounts_by_device, info->device_id, NULL);
+	else
+		g_hash_table_insert (priv->mounts_by_device, info->device_id, node);
+
+	return FALSE;
+}
+
+/* Mounts change rarely, so the index is just built again then */
+static void
+mount_index_rebuild (TrackerStorage *storage)
+{
+	TrackerStoragePrivate *priv;
+
+	priv = tracker_storage_get_instance_private (storage);
+
+	g_hash_table_remove_all (priv->mounts_by_device);
+	priv->n_unresolved_mounts = 0;
+
+	g_node_traverse (priv->mounts,
+	                 G_PRE_ORDER,
+	                 G_TRAVERSE_ALL,
+	                 -1,
+	                 mount_index_add_func,
+	                 priv);
+}
+
 static TrackerStorageType
 mount_info_get_type (MountInfo *info)
 {
@@ -306,6 +383,7 @@ mount_point_normalize (const gchar *mount_point)
 static GNode *
 mount_add_hierarchy (GNode       *root,
                      const gchar *uuid,
+                     const gchar *device_id,
                      const gchar *mount_point,
                      gboolean     removable,
                      gboolean     optical)
@@ -321,9 +399,10 @@ mount_add_hierarchy (GNode       *root,
 		node = root;
 	}
 
-	info = g_slice_new (MountInfo);
+	info = g_slice_new0 (MountInfo);
 	info->mount_point = mp;
 	info->uuid = g_strdup (uuid);
+	info->device_id = g_strdup (device_id);
 	info->removable = removable;
 	info->optical = optical;
 
@@ -339,12 +418,25 @@ mount_add_new (TrackerStorage *storage,
                gboolean        optical_disc)
 {
 	TrackerStoragePrivate *priv;
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileInfo) info = NULL;
+	const gchar *device_id = NULL;
 	GNode *node;
 
 	priv = tracker_storage_get_instance_private (storage);
 
-	node = mount_add_hierarchy (priv->mounts, uuid, mount_point, removable_device, optical_disc);
+	file = g_file_new_for_path (mount_point);
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (info)
+		device_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+
+	node = mount_add_hierarchy (priv->mounts, uuid, device_id, mount_point,
+	                            removable_device, optical_disc);
 	g_hash_table_insert (priv->mounts_by_uuid, g_strdup (uuid), node);
+	mount_index_rebuild (storage);
 
 	g_signal_emit (storage,
 	               signals[MOUNT_POINT_ADDED],
@@ -769,6 +861,7 @@ mount_remove (TrackerStorage *storage,
 
 		g_hash_table_remove (priv->mounts_by_uuid, info->uuid);
 		mount_node_free (node);
+		mount_index_rebuild (storage);
 	} else {
 		TRACKER_NOTE (MONITORS,
 		              g_message ("Mount:'%s' now unmounted from:'%s' (was not tracked)",
@@ -847,6 +940,17 @@ mount_pre_removed_cb (GVolumeMonitor *monitor,
 	                     GUINT_TO_POINTER (id));
 }
 
+static void
+unix_mounts_changed_cb (GUnixMountMonitor *monitor,
+                        gpointer           user_data)
+{
+	TrackerStoragePrivate *priv;
+
+	priv = tracker_storage_get_instance_private (user_data);
+	g_hash_table_remove_all (priv->filesystem_ids);
+	g_hash_table_remove_all (priv->rotational_devices);
+}
+
 /**
  * tracker_storage_new:
  *
@@ -931,17 +1035,63 @@ tracker_storage_get_device_roots (TrackerStorage     *storage,
 	return gr.roots;
 }
 
+/**
+ * tracker_storage_get_type_for_file:
+ * @storage: A #TrackerStorage
+ * @file: a local file
+ *
+ * Returns the type of the storage containing @file, looking up the
+ * mount point from its path.
+ *
+ * Returns: the #TrackerStorageType flags of the mount
+ **/
 TrackerStorageType
 tracker_storage_get_type_for_file (TrackerStorage *storage,
                                    GFile          *file)
+{
+	return tracker_storage_get_type_for_device (storage, file, NULL);
+}
+
+/**
+ * tracker_storage_get_type_for_device:
+ * @storage: A #TrackerStorage
+ * @file: a local file
+ * @device_id: (nullable): %G_FILE_ATTRIBUTE_ID_FILESYSTEM of @file
+ *
+ * Returns the type of the storage containing @file. If @device_id is
+ * given, the mount is looked up by filesystem, unless there are several
+ * on it, which saves comparing the path of @file with every mount point.
+ * Files inside mounts not tracked by @storage are then not considered to
+ * be in the mount around them.
+ *
+ * Returns: the #TrackerStorageType flags of the mount
+ **/
+TrackerStorageType
+tracker_storage_get_type_for_device (TrackerStorage *storage,
+                                     GFile          *file,
+                                     const gchar    *device_id)
 {
 	TrackerStoragePrivate *priv;
 	g_autofree gchar *path = NULL;
 	TrackerStorageType type = 0;
 	MountInfo *info;
+	gpointer node;
 
 	g_return_val_if_fail (TRACKER_IS_STORAGE (storage), FALSE);
 
+	priv = tracker_storage_get_instance_private (storage);
+
+	if (device_id) {
+		if (g_hash_table_lookup_extended (priv->mounts_by_device, device_id,
+		                                  NULL, &node)) {
+			if (node)
+				return mount_info_get_type (((GNode *) node)->data);
+		} else if (priv->n_unresolved_mounts == 0) {
+			/* No mount with this filesystem */
+			return type;
+		}
+	}
+
 	path = g_file_get_path (file);
 	if (!path)
 		return type;
@@ -955,18 +1105,160 @@ tracker_storage_get_type_for_file (TrackerStorage *storage,
 		path = norm_path;
 	}
 
-	priv = tracker_storage_get_instance_private (storage);
-
 	info = mount_info_find (priv->mounts, path);
 
 	if (!info)
 		return type;
 
-	if (info->removable)
-		type |= TRACKER_STORAGE_REMOVABLE;
-	if (info->optical)
-		type |= TRACKER_STORAGE_OPTICAL;
+	return mount_info_get_type (info);
+}
+
+
+static gchar *
+lookup_filesystem_id (TrackerStorage *storage,
+                      GFile          *file)
+{
+	TrackerStoragePrivate *priv;
+	const gchar *id = NULL, *devname = NULL;
+	GUnixMountEntry *mount;
+	g_autoptr (GUdevDevice) udev_device = NULL;
+
+	priv = tracker_storage_get_instance_private (storage);
+
+	mount = g_unix_mount_for (g_file_peek_path (file), NULL);
+	if (mount)
+		devname = g_unix_mount_get_device_path (mount);
+
+	if (devname) {
+		udev_device = g_udev_client_query_by_device_file (priv->udev_client, devname);
+		if (udev_device) {
+			id = g_udev_device_get_property (udev_device, "ID_FS_UUID_SUB");
+			if (!id)
+				id = g_udev_device_get_property (udev_device, "ID_FS_UUID");
+		}
+	}
+
+	g_clear_pointer (&mount, g_unix_mount_free);
+
+	return g_strdup (id);
+}
+
+/**
+ * tracker_storage_get_filesystem_id:
+ * @storage: A #TrackerStorage
+ * @file: a local file
+ * @device_id: (nullable): %G_FILE_ATTRIBUTE_ID_FILESYSTEM of @file
+ *
+ * Looks up the UUID of the filesystem containing @file. The result is
+ * cached for all files with the same @device_id until the mount table
+ * changes.
+ *
+ * Returns: (transfer full) (nullable): the filesystem UUID
+ **/
+gchar *
+tracker_storage_get_filesystem_id (TrackerStorage *storage,
+                                   GFile          *file,
+                                   const gchar    *device_id)
+{
+	TrackerStoragePrivate *priv;
+	gpointer id;
+	gchar *str;
+
+	g_return_val_if_fail (TRACKER_IS_STORAGE (storage), NULL);
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	if (!device_id)
+		return lookup_filesystem_id (storage, file);
+
+	priv = tracker_storage_get_instance_private (storage);
+
+	if (g_hash_table_lookup_extended (priv->filesystem_ids, device_id, NULL, &id))
+		return g_strdup (id);
+
+	str = lookup_filesystem_id (storage, file);
+	g_hash_table_insert (priv->filesystem_ids, g_strdup (device_id), g_strdup (str));
+
+	return str;
+}
 
-	return type;
+static gboolean
+lookup_rotational (TrackerStorage *storage,
+                   GFile          *file,
+                   guint32         device)
+{
+	TrackerStoragePrivate *priv;
+	g_autoptr (GUdevDevice) udev_device = NULL;
+	g_autoptr (GUdevDevice) disk = NULL;
+
+	priv = tracker_storage_get_instance_private (storage);
+
+	udev_device = g_udev_client_query_by_device_number (priv->udev_client,
+	                                                    G_UDEV_DEVICE_TYPE_BLOCK,
+	                                                    device);
+
+	if (!udev_device && g_file_peek_path (file)) {
+		/* E.g. btrfs, which uses anonymous device numbers */
+		GUnixMountEntry *mount;
+		const gchar *devname = NULL;
+
+		mount = g_unix_mount_for (g_file_peek_path (file), NULL);
+		if (mount)
+			devname = g_unix_mount_get_device_path (mount);
+		if (devname)
+			udev_device = g_udev_client_query_by_device_file (priv->udev_client, devname);
+
+		g_clear_pointer (&mount, g_unix_mount_free);
+	}
+
+	if (!udev_device)
+		return FALSE;
+
+	/* The queue attributes are on the disk holding partitions */
+	if (g_strcmp0 (g_udev_device_get_devtype (udev_device), "partition") == 0)
+		disk = g_udev_device_get_parent (udev_device);
+	else
+		disk = g_object_ref (udev_device);
+
+	return (disk &&
+	        g_udev_device_has_sysfs_attr (disk, "queue/rotational") &&
+	        g_udev_device_get_sysfs_attr_as_boolean (disk, "queue/rotational"));
 }
 
+/**
+ * tracker_storage_is_rotational:
+ * @storage: A #TrackerStorage
+ * @file: a local file
+ * @device: %G_FILE_ATTRIBUTE_UNIX_DEVICE of @file
+ *
+ * Checks whether @file is stored in a rotational disk, where reads
+ * in an order different from the layout on disk are costly. The
+ * result is cached for all files on @device until the mount table
+ * changes.
+ *
+ * Returns: %TRUE if @file is on rotational media
+ **/
+gboolean
+tracker_storage_is_rotational (TrackerStorage *storage,
+                               GFile          *file,
+                               guint32         device)
+{
+	TrackerStoragePrivate *priv;
+	gpointer value;
+	gboolean rotational;
+
+	g_return_val_if_fail (TRACKER_IS_STORAGE (storage), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	priv = tracker_storage_get_instance_private (storage);
+
+	if (g_hash_table_lookup_extended (priv->rotational_devices,
+	                                  GUINT_TO_POINTER (device), NULL, &value))
+		return GPOINTER_TO_INT (value);
+
+	rotational = lookup_rotational (storage, file, device);
+	g_hash_table_insert (priv->rotational_devices,
+	                     GUINT_TO_POINTER (device),
+	                     GINT_TO_POINTER (rotational));
+
+	return rotational;
+}
@@ -106,6 +106,17 @@ GSList *           tracker_storage_get_device_roots         (TrackerStorage
 
 TrackerStorageType tracker_storage_get_type_for_file (TrackerStorage *storage,
                                                       GFile          *file);
+TrackerStorageType tracker_storage_get_type_for_device (TrackerStorage *storage,
+                                                        GFile          *file,
+                                                        const gchar    *device_id);
+
+gchar *            tracker_storage_get_filesystem_id (TrackerStorage *storage,
+                                                      GFile          *file,
+                                                      const gchar    *device_id);
+
+gboolean           tracker_storage_is_rotational (TrackerStorage *storage,
+                                                  GFile          *file,
+                                                  guint32         device);
 
 G_END_DECLS
 
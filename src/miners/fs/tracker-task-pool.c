@@ -21,6 +21,8 @@
 
 #include "config-miners.h"
 
+#include <libtracker-miners-common/tracker-common.h>
+
 #include "tracker-task-pool.h"
 
 enum {
@@ -321,6 +323,8 @@ tracker_task_new (GFile          *file,
 	task->data = data;
 	task->ref_count = 1;
 
+	TRACKER_MEMORY_ALLOC (QUEUES, sizeof (TrackerTask));
+
 	return task;
 }
 
@@ -346,6 +350,7 @@ tracker_task_unref (TrackerTask *task)
 			(task->destroy_notify) (task->data);
 		}
 
+		TRACKER_MEMORY_FREE (QUEUES, sizeof (TrackerTask));
 		g_slice_free (TrackerTask, task);
 	}
 }
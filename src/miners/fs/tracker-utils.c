@@ -19,6 +19,8 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include "tracker-utils.h"
 
 #define QUERY_RESOURCE "/org/freedesktop/Tracker3/Miner/Files/queries/"
@@ -37,3 +39,45 @@ tracker_load_statement (TrackerSparqlConnection  *conn,
 	                                                                NULL,
 	                                                                error);
 }
+
+/* Returns the number of directory levels @file is below @root, 0 if
+ * it is @root itself or not within it. Only paths are looked at.
+ */
+guint
+tracker_file_get_depth (GFile *root,
+                        GFile *file)
+{
+	const gchar *root_path, *path;
+	gboolean separator = TRUE;
+	guint depth = 0;
+	gsize len;
+
+	root_path = g_file_peek_path (root);
+	path = g_file_peek_path (file);
+
+	if (!root_path || !path)
+		return 0;
+
+	len = strlen (root_path);
+
+	if (strncmp (path, root_path, len) != 0)
+		return 0;
+
+	path += len;
+
+	/* Only prefixes ending at a path component */
+	if (*path && *path != G_DIR_SEPARATOR &&
+	    (len == 0 || root_path[len - 1] != G_DIR_SEPARATOR))
+		return 0;
+
+	for (; *path; path++) {
+		if (*path == G_DIR_SEPARATOR) {
+			separator = TRUE;
+		} else if (separator) {
+			separator = FALSE;
+			depth++;
+		}
+	}
+
+	return depth;
+}
@@ -33,6 +33,9 @@ TrackerSparqlStatement * tracker_load_statement (TrackerSparqlConnection  *conn,
                                                  const gchar              *query_filename,
                                                  GError                  **error);
 
+guint tracker_file_get_depth (GFile *root,
+                              GFile *file);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_MINER_UTILS_H__ */
@@ -23,9 +23,11 @@
 #include <stdio.h>
 
 #include <libgrss.h>
+#include <libsoup/soup.h>
 
 #include <libtracker-miners-common/tracker-dbus.h>
 #include <libtracker-miners-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
 
 #include <glib/gi18n.h>
 
@@ -33,6 +35,24 @@
 
 #define TRACKER_MINER_RSS_GET_PRIVATE(obj) (tracker_miner_rss_get_instance_private (TRACKER_MINER_RSS (obj)))
 
+/* Feeds are fetched at most this many at a time, and fewer from the
+ * same host, so refreshing many feeds does not overload a server.
+ */
+#define MAX_FETCHES 16
+#define MAX_FETCHES_PER_HOST 2
+
+/* Items stored from the last fetch of a channel, see feed_item_get_key() */
+#define SEEN_ITEMS_KEY "seen-items"
+
+/* Items of all channels are written together, once there are this many
+ * or after this many seconds.
+ */
+#define FEED_BATCH_MAX_ITEMS 500
+#define FEED_BATCH_TIMEOUT 1
+
+/* Upper bound for threads turning feed items into resources */
+#define MAX_BUILD_THREADS 8
+
 typedef struct _TrackerMinerRSSPrivate TrackerMinerRSSPrivate;
 
 struct _TrackerMinerRSSPrivate {
@@ -47,6 +67,20 @@ struct _TrackerMinerRSSPrivate {
 
 	GHashTable *channel_updates;
 	GHashTable *channels;
+	/* Feed URL -> FeedValidators, for conditional requests */
+	GHashTable *validators;
+
+	TrackerBatch *batch;
+	/* FeedItemListInsertData of the channels in the batch */
+	GPtrArray *batch_data;
+	guint n_batch_items;
+	guint batch_flush_id;
+
+	TrackerSparqlStatement *update_channel;
+	TrackerSparqlStatement *delete_properties;
+
+	/* Builds the resources of the items of one channel per task */
+	GThreadPool *build_pool;
 
 	TrackerNotifier *notifier;
 };
@@ -68,8 +102,31 @@ typedef struct {
 	TrackerMinerRSS *miner;
 	GrssFeedChannel *channel;
 	GHashTable *items;
+	/* Keys of the items known to be stored, and of those that will
+	 * be once the update succeeds.
+	 */
+	GHashTable *seen;
+	GPtrArray *stored;
+	/* FeedMessage of the items to store, in order */
+	GPtrArray *messages;
+	gchar *channel_urn;
 } FeedItemListInsertData;
 
+/* An item to store, with its resource built in a thread if it is
+ * new or updated, the batch is only touched from the main thread.
+ */
+typedef struct {
+	GrssFeedItem *item;
+	gchar *urn;
+	TrackerResource *resource;
+	gboolean up_to_date;
+} FeedMessage;
+
+typedef struct {
+	gchar *etag;
+	gchar *last_modified;
+} FeedValidators;
+
 static void         notifier_events_cb              (TrackerNotifier       *notifier,
                                                      const gchar           *service,
                                                      const gchar           *graph,
@@ -91,78 +148,12 @@ static void         feed_ready_cb                   (GrssFeedsPool             *
                                                      GList                 *items,
                                                      gpointer               user_data);
 static const gchar *get_message_url                 (GrssFeedItem              *item);
+static void         feed_batch_flush                (TrackerMinerRSS       *miner);
+static void         build_messages_thread           (gpointer               data,
+                                                     gpointer               user_data);
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerMinerRSS, tracker_miner_rss, TRACKER_TYPE_MINER_ONLINE)
 
-static void
-parser_characters (void          *data,
-                   const xmlChar *ch,
-                   int            len)
-{
-	GString *string = data;
-	const gchar *str, *end;
-
-	str = (gchar *)ch;
-	g_utf8_validate (str, len, &end);
-
-	if (end > str) {
-		g_string_append_len (string, str, end - str);
-	}
-
-	if (string->str[string->len - 1] != ' ')
-		g_string_append_c (string, ' ');
-}
-
-static gchar *
-parse_html_text (const gchar *html)
-{
-	GString *string;
-	htmlDocPtr doc;
-	xmlSAXHandler handler = {
-		NULL, /* internalSubset */
-		NULL, /* isStandalone */
-		NULL, /* hasInternalSubset */
-		NULL, /* hasExternalSubset */
-		NULL, /* resolveEntity */
-		NULL, /* getEntity */
-		NULL, /* entityDecl */
-		NULL, /* notationDecl */
-		NULL, /* attributeDecl */
-		NULL, /* elementDecl */
-		NULL, /* unparsedEntityDecl */
-		NULL, /* setDocumentLocator */
-		NULL, /* startDocument */
-		NULL, /* endDocument */
-		NULL, /* startElement */
-		NULL, /* endElement */
-		NULL, /* reference */
-		parser_characters, /* characters */
-		NULL, /* ignorableWhitespace */
-		NULL, /* processingInstruction */
-		NULL, /* comment */
-		NULL, /* xmlParserWarning */
-		NULL, /* xmlParserError */
-		NULL, /* xmlParserError */
-		NULL, /* getParameterEntity */
-		NULL, /* cdataBlock */
-		NULL, /* externalSubset */
-		1,    /* initialized */
-		NULL, /* private */
-		NULL, /* startElementNsSAX2Func */
-		NULL, /* endElementNsSAX2Func */
-		NULL  /* xmlStructuredErrorFunc */
-	};
-
-	string = g_string_new (NULL);
-	doc = htmlSAXParseDoc ((xmlChar *) html, "UTF-8", &handler, string);
-
-	if (doc) {
-		xmlFreeDoc (doc);
-	}
-
-	return g_string_free (string, FALSE);
-}
-
 static void
 tracker_miner_rss_constructed (GObject *object)
 {
@@ -175,6 +166,20 @@ tracker_miner_rss_constructed (GObject *object)
 	priv->notifier = tracker_sparql_connection_create_notifier (connection);
 	g_signal_connect (priv->notifier, "events",
 	                  G_CALLBACK (notifier_events_cb), object);
+
+	priv->update_channel =
+		tracker_sparql_connection_update_statement (connection,
+		                                            "INSERT SILENT { ~msg nmo:communicationChannel ~channel }",
+		                                            NULL, NULL);
+	priv->delete_properties =
+		tracker_sparql_connection_update_statement (connection,
+		                                            "DELETE { ~msg ?p ?o }"
+		                                            "WHERE  { ~msg a mfo:FeedMessage ;"
+		                                            "              ?p ?o ."
+		                                            "              FILTER (?p != rdf:type &&"
+		                                            "                      ?p != nmo:communicationChannel)"
+		                                            "}",
+		                                            NULL, NULL);
 }
 
 static void
@@ -185,16 +190,115 @@ tracker_miner_rss_finalize (GObject *object)
 	priv = TRACKER_MINER_RSS_GET_PRIVATE (object);
 
 	priv->stopped = TRUE;
+	feed_batch_flush (TRACKER_MINER_RSS (object));
 	g_free (priv->last_status);
 	g_object_unref (priv->pool);
 	g_object_unref (priv->notifier);
+	g_thread_pool_free (priv->build_pool, FALSE, TRUE);
 
 	g_hash_table_unref (priv->channel_updates);
 	g_hash_table_unref (priv->channels);
+	g_hash_table_unref (priv->validators);
+	g_clear_object (&priv->update_channel);
+	g_clear_object (&priv->delete_properties);
 
 	G_OBJECT_CLASS (tracker_miner_rss_parent_class)->finalize (object);
 }
 
+static void
+feed_validators_free (FeedValidators *validators)
+{
+	g_free (validators->etag);
+	g_free (validators->last_modified);
+	g_slice_free (FeedValidators, validators);
+}
+
+static gchar *
+get_request_url (SoupMessage *msg)
+{
+	return soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+}
+
+static void
+feed_request_queued_cb (SoupSession *session,
+                        SoupMessage *msg,
+                        gpointer     user_data)
+{
+	TrackerMinerRSSPrivate *priv;
+	FeedValidators *validators;
+	g_autofree gchar *url = NULL;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (user_data);
+	url = get_request_url (msg);
+	validators = g_hash_table_lookup (priv->validators, url);
+
+	if (!validators)
+		return;
+
+	/* Let the server answer 304 if the feed did not change */
+	if (validators->etag) {
+		soup_message_headers_replace (msg->request_headers,
+		                              "If-None-Match",
+		                              validators->etag);
+	}
+
+	if (validators->last_modified) {
+		soup_message_headers_replace (msg->request_headers,
+		                              "If-Modified-Since",
+		                              validators->last_modified);
+	}
+}
+
+static void
+feed_request_unqueued_cb (SoupSession *session,
+                          SoupMessage *msg,
+                          gpointer     user_data)
+{
+	TrackerMinerRSS *miner = user_data;
+	TrackerMinerRSSPrivate *priv;
+	const gchar *etag, *last_modified;
+	g_autofree gchar *url = NULL;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (miner);
+
+	/* Not modified feeds produce no items, so fetches are accounted
+	 * here instead of in feed_ready_cb().
+	 */
+	priv->now_fetching--;
+
+	g_debug ("Feed fetched, %d remaining", priv->now_fetching);
+
+	if (priv->now_fetching <= 0) {
+		priv->now_fetching = 0;
+		g_object_set (miner, "progress", 1.0, "status", "Idle", NULL);
+	}
+
+	url = get_request_url (msg);
+
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_debug ("Feed '%s' not modified", url);
+		return;
+	} else if (msg->status_code != SOUP_STATUS_OK) {
+		return;
+	}
+
+	etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	last_modified = soup_message_headers_get_one (msg->response_headers, "Last-Modified");
+
+	if (etag || last_modified) {
+		FeedValidators *validators;
+
+		validators = g_slice_new0 (FeedValidators);
+		validators->etag = g_strdup (etag);
+		validators->last_modified = g_strdup (last_modified);
+		g_hash_table_replace (priv->validators,
+		                      g_steal_pointer (&url),
+		                      validators);
+	} else {
+		g_hash_table_remove (priv->validators, url);
+	}
+}
+
 static gboolean
 miner_connected (TrackerMinerOnline *miner,
 		 TrackerNetworkType  network)
@@ -224,6 +328,7 @@ static void
 tracker_miner_rss_init (TrackerMinerRSS *object)
 {
 	TrackerMinerRSSPrivate *priv;
+	SoupSession *session;
 
 	g_message ("Initializing...");
 
@@ -237,10 +342,28 @@ tracker_miner_rss_init (TrackerMinerRSS *object)
 	priv->channels = g_hash_table_new_full (NULL, NULL, NULL,
 	                                        (GDestroyNotify) g_object_unref);
 
+	priv->validators = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                          g_free,
+	                                          (GDestroyNotify) feed_validators_free);
+
+	priv->build_pool = g_thread_pool_new (build_messages_thread, NULL,
+	                                      CLAMP (g_get_num_processors (), 1, MAX_BUILD_THREADS),
+	                                      FALSE, NULL);
+
 	priv->pool = grss_feeds_pool_new ();
 	g_signal_connect (priv->pool, "feed-fetching", G_CALLBACK (feed_fetching_cb), object);
 	g_signal_connect (priv->pool, "feed-ready", G_CALLBACK (feed_ready_cb), object);
 	priv->now_fetching = 0;
+
+	session = grss_feeds_pool_get_session (priv->pool);
+	g_object_set (session,
+	              "max-conns", MAX_FETCHES,
+	              "max-conns-per-host", MAX_FETCHES_PER_HOST,
+	              NULL);
+	g_signal_connect (session, "request-queued",
+	                  G_CALLBACK (feed_request_queued_cb), object);
+	g_signal_connect (session, "request-unqueued",
+	                  G_CALLBACK (feed_request_unqueued_cb), object);
 }
 
 static void
@@ -402,6 +525,30 @@ feed_channel_update_data_free (FeedChannelUpdateData *fcud)
 	g_slice_free (FeedChannelUpdateData, fcud);
 }
 
+static FeedMessage *
+feed_message_new (GrssFeedItem *item,
+                  const gchar  *urn,
+                  gboolean      up_to_date)
+{
+	FeedMessage *message;
+
+	message = g_slice_new0 (FeedMessage);
+	message->item = g_object_ref (item);
+	message->urn = g_strdup (urn);
+	message->up_to_date = up_to_date;
+
+	return message;
+}
+
+static void
+feed_message_free (FeedMessage *message)
+{
+	g_object_unref (message->item);
+	g_free (message->urn);
+	g_clear_object (&message->resource);
+	g_slice_free (FeedMessage, message);
+}
+
 static FeedItemListInsertData *
 feed_item_list_insert_data_new (TrackerMinerRSS *miner,
                                 GrssFeedChannel *channel,
@@ -413,11 +560,15 @@ feed_item_list_insert_data_new (TrackerMinerRSS *miner,
 	GList *l;
 
 	data = g_slice_new0 (FeedItemListInsertData);
-	data->channel = channel;
+	data->channel = g_object_ref (channel);
 	data->miner = miner;
 	data->items = g_hash_table_new_full (g_str_hash, g_str_equal,
 	                                     (GDestroyNotify) g_free,
 	                                     (GDestroyNotify) g_object_unref);
+	data->seen = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                    g_free, NULL);
+	data->stored = g_ptr_array_new_with_free_func (g_free);
+	data->messages = g_ptr_array_new_with_free_func ((GDestroyNotify) feed_message_free);
 
 	/* Make items unique, keep most recent */
 	for (l = items; l; l = l->next) {
@@ -442,9 +593,37 @@ static void
 feed_item_list_insert_data_free (FeedItemListInsertData *data)
 {
 	g_hash_table_destroy (data->items);
+	g_clear_pointer (&data->seen, g_hash_table_unref);
+	g_ptr_array_unref (data->stored);
+	g_ptr_array_unref (data->messages);
+	g_free (data->channel_urn);
+	g_object_unref (data->channel);
 	g_slice_free (FeedItemListInsertData, data);
 }
 
+/* Items are known by URL and publish time, so updated items are
+ * checked again.
+ */
+static gchar *
+feed_item_get_key (GrssFeedItem *item)
+{
+	return g_strdup_printf ("%" G_GINT64_FORMAT " %s",
+	                        (gint64) grss_feed_item_get_publish_time (item),
+	                        get_message_url (item));
+}
+
+/* Replaces the seen items of the channel, so the set only holds
+ * items still in the feed.
+ */
+static void
+feed_item_list_insert_data_commit_seen (FeedItemListInsertData *data)
+{
+	g_object_set_data_full (G_OBJECT (data->channel),
+	                        SEEN_ITEMS_KEY,
+	                        g_steal_pointer (&data->seen),
+	                        (GDestroyNotify) g_hash_table_unref);
+}
+
 static void
 feed_channel_change_updated_time_cb (GObject      *source,
                                      GAsyncResult *result,
@@ -632,45 +811,19 @@ sparql_add_enclosure (TrackerResource   *resource,
 	tracker_resource_add_take_relation (resource, "mfo:enclosureList", child);
 }
 
-static gchar *
-feed_message_create_update_channel_query (const gchar  *item_urn,
-                                          GrssFeedItem *item)
-{
-	GrssFeedChannel *channel;
-	const gchar *channel_urn;
-
-	channel = grss_feed_item_get_parent (item);
-	channel_urn = g_object_get_data (G_OBJECT (channel), "subject");
-
-	return g_strdup_printf ("INSERT SILENT { <%s> nmo:communicationChannel <%s> }",
-	                        item_urn, channel_urn);
-}
-
-static gchar *
-feed_message_create_delete_properties_query (const gchar *item_urn)
-{
-	return g_strdup_printf ("DELETE { <%s> ?p ?o }"
-	                        "WHERE  { <%s> a mfo:FeedMessage ;"
-	                        "              ?p ?o ."
-	                        "              FILTER (?p != rdf:type &&"
-	                        "                      ?p != nmo:communicationChannel)"
-	                        "}", item_urn, item_urn);
-}
-
+/* Called from the build threads, so it must only read @item */
 static TrackerResource *
-feed_message_create_resource (TrackerMinerRSS *miner,
-                              GrssFeedItem    *item,
-                              const gchar     *item_urn)
+feed_message_create_resource (GrssFeedItem *item,
+                              const gchar  *item_urn,
+                              const gchar  *channel_urn)
 {
 	time_t t;
-	gchar *uri;
 	const gchar *url;
 	GrssPerson *author;
 	gdouble latitude;
 	gdouble longitude;
 	const gchar *tmp_string;
 	TrackerResource *resource;
-	GrssFeedChannel *channel;
 	const GList *contributors;
 	const GList *enclosures;
 	const GList *list, *l;
@@ -691,7 +844,6 @@ feed_message_create_resource (TrackerMinerRSS *miner,
 	resource = tracker_resource_new (NULL);
 	author = grss_feed_item_get_author (item);
 	contributors = grss_feed_item_get_contributors (item);
-	channel = grss_feed_item_get_parent (item);
 	enclosures = grss_feed_item_get_enclosures (item);
 
 	if (grss_feed_item_get_geo_point (item, &latitude, &longitude)) {
@@ -743,9 +895,11 @@ feed_message_create_resource (TrackerMinerRSS *miner,
 	if (tmp_string != NULL) {
 		gchar *plain_text;
 
-		plain_text = parse_html_text (tmp_string);
-		tracker_resource_set_string (resource, "nie:plainTextContent", plain_text);
-		g_free (plain_text);
+		plain_text = tracker_html_get_text (tmp_string, -1, G_MAXSIZE);
+		if (plain_text) {
+			tracker_resource_set_string (resource, "nie:plainTextContent", plain_text);
+			g_free (plain_text);
+		}
 
 		tracker_resource_set_string (resource, "nmo:htmlMessageContent", tmp_string);
 	}
@@ -760,8 +914,7 @@ feed_message_create_resource (TrackerMinerRSS *miner,
 
 	tracker_resource_set_boolean (resource, "nmo:isRead", FALSE);
 
-	uri = g_object_get_data (G_OBJECT (channel), "subject");
-	tracker_resource_add_uri (resource, "nmo:communicationChannel", uri);
+	tracker_resource_add_uri (resource, "nmo:communicationChannel", channel_urn);
 
 	tmp_string = grss_feed_item_get_copyright (item);
 	if (tmp_string) {
@@ -777,23 +930,164 @@ feed_message_create_resource (TrackerMinerRSS *miner,
 }
 
 static void
-feed_channel_content_update_cb (GObject      *source,
-                                GAsyncResult *result,
-                                gpointer      user_data)
+feed_batch_execute_cb (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      user_data)
 {
-	TrackerSparqlConnection *connection;
-	GPtrArray *array = user_data;
+	GPtrArray *batch_data = user_data;
 	GError *error = NULL;
+	gboolean success;
+	guint i, j;
 
-	connection = TRACKER_SPARQL_CONNECTION (source);
-	if (!tracker_sparql_connection_update_array_finish (connection,
-	                                                    result, &error)) {
+	success = tracker_batch_execute_finish (TRACKER_BATCH (source),
+	                                        result, &error);
+	if (!success) {
 		g_warning ("Could not update feed items: %s",
 		           error->message);
 		g_error_free (error);
 	}
 
-	g_ptr_array_unref (array);
+	for (i = 0; i < batch_data->len; i++) {
+		FeedItemListInsertData *data = g_ptr_array_index (batch_data, i);
+
+		if (success) {
+			for (j = 0; j < data->stored->len; j++) {
+				g_hash_table_add (data->seen,
+				                  g_strdup (g_ptr_array_index (data->stored, j)));
+			}
+		}
+
+		feed_item_list_insert_data_commit_seen (data);
+	}
+
+	g_ptr_array_unref (batch_data);
+}
+
+static void
+feed_batch_flush (TrackerMinerRSS *miner)
+{
+	TrackerMinerRSSPrivate *priv;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (miner);
+	g_clear_handle_id (&priv->batch_flush_id, g_source_remove);
+
+	if (!priv->batch)
+		return;
+
+	g_debug ("Updating %d feed items", priv->n_batch_items);
+
+	tracker_batch_execute_async (priv->batch,
+	                             NULL,
+	                             feed_batch_execute_cb,
+	                             g_steal_pointer (&priv->batch_data));
+	g_clear_object (&priv->batch);
+	priv->n_batch_items = 0;
+}
+
+static gboolean
+feed_batch_flush_cb (gpointer user_data)
+{
+	TrackerMinerRSSPrivate *priv;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (user_data);
+	priv->batch_flush_id = 0;
+	feed_batch_flush (user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+static TrackerBatch *
+feed_batch_get (TrackerMinerRSS *miner)
+{
+	TrackerMinerRSSPrivate *priv;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (miner);
+
+	if (!priv->batch) {
+		priv->batch = tracker_sparql_connection_create_batch (tracker_miner_get_connection (TRACKER_MINER (miner)));
+		priv->batch_data = g_ptr_array_new_with_free_func ((GDestroyNotify) feed_item_list_insert_data_free);
+		priv->batch_flush_id = g_timeout_add_seconds (FEED_BATCH_TIMEOUT,
+		                                              feed_batch_flush_cb,
+		                                              miner);
+	}
+
+	priv->n_batch_items++;
+
+	return priv->batch;
+}
+
+static void
+build_messages_thread (gpointer data,
+                       gpointer user_data)
+{
+	GTask *task = data;
+	FeedItemListInsertData *insert_data = g_task_get_task_data (task);
+	guint i;
+
+	/* Only item parsing happens here, the batch and the
+	 * channel are left to the main thread.
+	 */
+	for (i = 0; i < insert_data->messages->len; i++) {
+		FeedMessage *message = g_ptr_array_index (insert_data->messages, i);
+
+		if (message->up_to_date)
+			continue;
+
+		message->resource = feed_message_create_resource (message->item,
+		                                                  message->urn,
+		                                                  insert_data->channel_urn);
+	}
+
+	g_task_return_boolean (task, TRUE);
+	g_object_unref (task);
+}
+
+static void
+build_messages_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	TrackerMinerRSS *miner = TRACKER_MINER_RSS (object);
+	TrackerMinerRSSPrivate *priv;
+	FeedItemListInsertData *data = user_data;
+	TrackerBatch *batch;
+	guint i;
+
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (miner);
+	g_task_propagate_boolean (G_TASK (result), NULL);
+
+	for (i = 0; i < data->messages->len; i++) {
+		FeedMessage *message = g_ptr_array_index (data->messages, i);
+
+		batch = feed_batch_get (miner);
+
+		if (message->up_to_date) {
+			tracker_batch_add_statement (batch, priv->update_channel,
+			                             "msg", G_TYPE_STRING, message->urn,
+			                             "channel", G_TYPE_STRING, data->channel_urn,
+			                             NULL);
+		} else {
+			if (message->urn) {
+				tracker_batch_add_statement (batch, priv->delete_properties,
+				                             "msg", G_TYPE_STRING, message->urn,
+				                             NULL);
+			}
+
+			tracker_batch_add_resource (batch, NULL, message->resource);
+		}
+
+		g_ptr_array_add (data->stored, feed_item_get_key (message->item));
+	}
+
+	g_ptr_array_set_size (data->messages, 0);
+
+	feed_channel_change_updated_time (miner, data->channel);
+
+	/* Seen items are updated once the batch is written */
+	g_ptr_array_add (priv->batch_data, data);
+
+	if (priv->n_batch_items >= FEED_BATCH_MAX_ITEMS)
+		feed_batch_flush (miner);
 }
 
 static void
@@ -801,25 +1095,26 @@ check_feed_items_cb (GObject      *source_object,
                      GAsyncResult *res,
                      gpointer      user_data)
 {
+	TrackerMinerRSSPrivate *priv;
 	TrackerSparqlConnection *connection;
-	TrackerResource *resource;
 	FeedItemListInsertData *data;
 	TrackerSparqlCursor *cursor;
 	GrssFeedItem *item;
 	GError *error = NULL;
 	GHashTableIter iter;
-	GPtrArray *array;
-	const gchar *str;
+	GTask *task;
 
 	data = user_data;
+	priv = TRACKER_MINER_RSS_GET_PRIVATE (data->miner);
 	connection = TRACKER_SPARQL_CONNECTION (source_object);
 	cursor = tracker_sparql_connection_query_finish (connection, res, &error);
-	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
+	data->channel_urn = g_strdup (g_object_get_data (G_OBJECT (data->channel), "subject"));
 
 	while (!error && tracker_sparql_cursor_next (cursor, NULL, &error)) {
 		const gchar *urn, *url;
 		g_autoptr (GDateTime) datetime = NULL;
 		time_t time;
+		gboolean up_to_date;
 
 		urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
 		url = tracker_sparql_cursor_get_string (cursor, 1, NULL);
@@ -831,21 +1126,15 @@ check_feed_items_cb (GObject      *source_object,
 		if (!item)
 			continue;
 
-		if (time <= grss_feed_item_get_publish_time (item)) {
+		up_to_date = time <= grss_feed_item_get_publish_time (item);
+
+		if (up_to_date)
 			g_debug ("Item '%s' already up to date", url);
-			g_ptr_array_add (array, feed_message_create_update_channel_query (urn, item));
-		} else {
+		else
 			g_debug ("Updating item '%s'", url);
 
-			g_ptr_array_add (array, feed_message_create_delete_properties_query (urn));
-
-			resource = feed_message_create_resource (data->miner,
-			                                       item, urn);
-			str = tracker_resource_print_sparql_update (resource, NULL, NULL);
-			g_ptr_array_add (array, g_strdup (str));
-			g_object_unref (resource);
-		}
-
+		g_ptr_array_add (data->messages,
+		                 feed_message_new (item, urn, up_to_date));
 		g_hash_table_remove (data->items, url);
 	}
 
@@ -856,36 +1145,29 @@ check_feed_items_cb (GObject      *source_object,
 	if (error) {
 		g_message ("Could check feed items, %s", error->message);
 		g_error_free (error);
+		feed_item_list_insert_data_commit_seen (data);
 		feed_item_list_insert_data_free (data);
-		g_ptr_array_unref (array);
 		return;
 	}
 
 	g_hash_table_iter_init (&iter, data->items);
 
 	/* Insert all remaining items as new */
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &item)) {
-		resource = feed_message_create_resource (data->miner,
-		                                       item, NULL);
-		str = tracker_resource_print_sparql_update (resource, NULL, NULL);
-		g_ptr_array_add (array, g_strdup (str));
-		g_object_unref (resource);
-	}
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &item))
+		g_ptr_array_add (data->messages, feed_message_new (item, NULL, FALSE));
 
-	if (array->len == 0) {
+	if (data->messages->len == 0) {
+		feed_item_list_insert_data_commit_seen (data);
 		feed_item_list_insert_data_free (data);
-		g_ptr_array_unref (array);
 		return;
 	}
 
-	tracker_sparql_connection_update_array_async (tracker_miner_get_connection (TRACKER_MINER (data->miner)),
-	                                              (gchar **) array->pdata,
-	                                              array->len,
-	                                              NULL,
-	                                              feed_channel_content_update_cb,
-	                                              array);
-	feed_channel_change_updated_time (data->miner, data->channel);
-	feed_item_list_insert_data_free (data);
+	/* HTML parsing and resource building may take a while with
+	 * large channels, so it is kept off the main loop.
+	 */
+	task = g_task_new (data->miner, NULL, build_messages_cb, data);
+	g_task_set_task_data (task, data, NULL);
+	g_thread_pool_push (priv->build_pool, task, NULL);
 }
 
 static void
@@ -896,11 +1178,42 @@ check_feed_items (TrackerMinerRSS *miner,
 	FeedItemListInsertData *data;
 	GHashTableIter iter;
 	GrssFeedItem *item;
+	GHashTable *seen;
 	gboolean first = TRUE;
 	const gchar *url;
 	GString *query;
 
 	data = feed_item_list_insert_data_new (miner, channel, items);
+
+	/* Items stored from the last fetch need no round trip to the store */
+	seen = g_object_get_data (G_OBJECT (channel), SEEN_ITEMS_KEY);
+
+	if (seen) {
+		g_hash_table_iter_init (&iter, data->items);
+
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &item)) {
+			gchar *key;
+
+			key = feed_item_get_key (item);
+
+			if (g_hash_table_contains (seen, key)) {
+				g_hash_table_add (data->seen, key);
+				g_hash_table_iter_remove (&iter);
+			} else {
+				g_free (key);
+			}
+		}
+	}
+
+	if (g_hash_table_size (data->items) == 0) {
+		g_debug ("All items in channel '%s' already known",
+		         grss_feed_channel_get_title (channel));
+		feed_channel_change_updated_time (miner, channel);
+		feed_item_list_insert_data_commit_seen (data);
+		feed_item_list_insert_data_free (data);
+		return;
+	}
+
 	g_hash_table_iter_init (&iter, data->items);
 
 	query = g_string_new ("SELECT ?msg nie:url(?msg)"
@@ -1003,19 +1316,8 @@ feed_ready_cb (GrssFeedsPool   *pool,
                gpointer         user_data)
 {
 	TrackerMinerRSS *miner;
-	TrackerMinerRSSPrivate *priv;
 
 	miner = TRACKER_MINER_RSS (user_data);
-	priv = TRACKER_MINER_RSS_GET_PRIVATE (miner);
-
-	priv->now_fetching--;
-
-	g_debug ("Feed fetched, %d remaining", priv->now_fetching);
-
-	if (priv->now_fetching <= 0) {
-		priv->now_fetching = 0;
-		g_object_set (miner, "progress", 1.0, "status", "Idle", NULL);
-	}
 
 	if (items == NULL) {
 		return;
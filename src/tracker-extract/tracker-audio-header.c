@@ -0,0 +1,1021 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <gst/tag/tag.h>
+#include <gst/pbutils/pbutils.h>
+
+#include <libtracker-miners-common/tracker-file-utils.h>
+
+#include "tracker-audio-header.h"
+
+/* Tags and stream information of common audio formats, read straight
+ * from the file headers. This is much cheaper than prerolling a
+ * GStreamer pipeline, files that look any different from the simple
+ * single audio stream case are left to GStreamer.
+ *
+ * Like in the MP3 extractor, only the beginning of the file is mapped,
+ * and the few other bits that may be needed (The last Ogg page, MP4
+ * metadata after the media data) are read separately.
+ */
+
+#define MAX_HEADER_READ (1024 * 1024 * 5)
+#define MAX_TAIL_READ   (64 * 1024)
+
+#define FLAC_STREAMINFO     0
+#define FLAC_VORBIS_COMMENT 4
+#define FLAC_CUESHEET       5
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_PAGE_BOS         0x02
+
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+
+typedef struct {
+	int fd;
+	goffset size;
+	const guint8 *head;
+	gsize head_size;
+} AudioFile;
+
+typedef enum {
+	OGG_CODEC_NONE,
+	OGG_CODEC_VORBIS,
+	OGG_CODEC_OPUS,
+} OggCodec;
+
+static const struct {
+	const gchar id[5];
+	const gchar *tag;
+} riff_info_tags[] = {
+	{ "INAM", GST_TAG_TITLE },
+	{ "IART", GST_TAG_ARTIST },
+	{ "IPRD", GST_TAG_ALBUM },
+	{ "ICMT", GST_TAG_COMMENT },
+	{ "ICOP", GST_TAG_COPYRIGHT },
+	{ "IGNR", GST_TAG_GENRE },
+	{ "ICRD", GST_TAG_DATE_TIME },
+	{ "ISFT", GST_TAG_ENCODER },
+	{ "ITRK", GST_TAG_TRACK_NUMBER },
+	{ "IPRT", GST_TAG_TRACK_NUMBER },
+};
+
+static const struct {
+	const gchar id[5];
+	const gchar *tag;
+} mp4_tags[] = {
+	{ "\251nam", GST_TAG_TITLE },
+	{ "\251ART", GST_TAG_ARTIST },
+	{ "\251alb", GST_TAG_ALBUM },
+	{ "aART", GST_TAG_ALBUM_ARTIST },
+	{ "\251wrt", GST_TAG_COMPOSER },
+	{ "\251gen", GST_TAG_GENRE },
+	{ "\251cmt", GST_TAG_COMMENT },
+	{ "cprt", GST_TAG_COPYRIGHT },
+	{ "\251too", GST_TAG_ENCODER },
+	{ "\251day", GST_TAG_DATE_TIME },
+};
+
+/* Names in "----" atoms */
+static const struct {
+	const gchar *name;
+	const gchar *tag;
+} mp4_freeform_tags[] = {
+	{ "MusicBrainz Track Id", GST_TAG_MUSICBRAINZ_TRACKID },
+	{ "MusicBrainz Artist Id", GST_TAG_MUSICBRAINZ_ARTISTID },
+	{ "MusicBrainz Album Id", GST_TAG_MUSICBRAINZ_ALBUMID },
+	{ "MusicBrainz Album Artist Id", GST_TAG_MUSICBRAINZ_ALBUMARTISTID },
+#if defined GST_TAG_MUSICBRAINZ_RELEASEGROUPID
+	{ "MusicBrainz Release Group Id", GST_TAG_MUSICBRAINZ_RELEASEGROUPID },
+#endif
+#if defined GST_TAG_MUSICBRAINZ_RELEASETRACKID
+	{ "MusicBrainz Release Track Id", GST_TAG_MUSICBRAINZ_RELEASETRACKID },
+#endif
+};
+
+static inline guint16
+read_uint16_le (const guint8 *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+static inline guint16
+read_uint16_be (const guint8 *data)
+{
+	return (data[0] << 8) | data[1];
+}
+
+static inline guint32
+read_uint24_be (const guint8 *data)
+{
+	return ((guint32) data[0] << 16) | (data[1] << 8) | data[2];
+}
+
+static inline guint32
+read_uint32_le (const guint8 *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((guint32) data[3] << 24);
+}
+
+static inline guint32
+read_uint32_be (const guint8 *data)
+{
+	return ((guint32) data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static inline guint64
+read_uint64_le (const guint8 *data)
+{
+	return read_uint32_le (data) | ((guint64) read_uint32_le (&data[4]) << 32);
+}
+
+static inline guint64
+read_uint64_be (const guint8 *data)
+{
+	return ((guint64) read_uint32_be (data) << 32) | read_uint32_be (&data[4]);
+}
+
+/* Returns @len bytes at @offset, from the mapped head of the file if
+ * possible, otherwise *@buffer is set to a newly allocated copy.
+ */
+static const guint8 *
+audio_file_get (AudioFile  *file,
+                goffset     offset,
+                gsize       len,
+                guint8    **buffer)
+{
+	gsize done = 0;
+	gssize n;
+
+	*buffer = NULL;
+
+	if (offset < 0 || len > MAX_HEADER_READ ||
+	    offset > file->size || (goffset) len > file->size - offset)
+		return NULL;
+
+	if (offset + len <= file->head_size)
+		return file->head + offset;
+
+	*buffer = g_malloc (len);
+
+	while (done < len) {
+		n = pread (file->fd, *buffer + done, len - done, offset + done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n <= 0) {
+			g_clear_pointer (buffer, g_free);
+			return NULL;
+		}
+
+		done += n;
+	}
+
+	return *buffer;
+}
+
+static gchar *
+dup_tag_string (const guint8 *data,
+                gsize         len)
+{
+	const guint8 *nul;
+
+	nul = memchr (data, '\0', len);
+	if (nul)
+		len = nul - data;
+
+	if (g_utf8_validate ((const gchar *) data, len, NULL))
+		return g_strndup ((const gchar *) data, len);
+
+	return g_convert ((const gchar *) data, len,
+	                  "UTF-8", "ISO-8859-1",
+	                  NULL, NULL, NULL);
+}
+
+static void
+add_tag_from_string (GstTagList  *tags,
+                     const gchar *tag,
+                     const gchar *str)
+{
+	GType type;
+
+	if (!str || !*str)
+		return;
+
+	type = gst_tag_get_type (tag);
+
+	if (type == G_TYPE_STRING) {
+		gst_tag_list_add (tags, GST_TAG_MERGE_APPEND, tag, str, NULL);
+	} else if (type == G_TYPE_UINT) {
+		guint64 value;
+
+		/* Also takes "3/12" like track numbers */
+		value = g_ascii_strtoull (str, NULL, 10);
+		if (value > 0 && value <= G_MAXUINT)
+			gst_tag_list_add (tags, GST_TAG_MERGE_APPEND, tag, (guint) value, NULL);
+	} else if (type == GST_TYPE_DATE_TIME) {
+		GstDateTime *date_time;
+
+		date_time = gst_date_time_new_from_iso8601_string (str);
+		if (date_time) {
+			gst_tag_list_add (tags, GST_TAG_MERGE_APPEND, tag, date_time, NULL);
+			gst_date_time_unref (date_time);
+		}
+	}
+}
+
+static void
+add_vorbis_comments (TrackerAudioHeader *header,
+                     const guint8       *data,
+                     gsize               len,
+                     const gchar        *id,
+                     guint               id_len)
+{
+	GstTagList *tags;
+
+	tags = gst_tag_list_from_vorbiscomment (data, len, (const guint8 *) id, id_len, NULL);
+	if (tags) {
+		gst_tag_list_insert (header->tags, tags, GST_TAG_MERGE_APPEND);
+		gst_tag_list_unref (tags);
+	}
+}
+
+static void
+add_codec (TrackerAudioHeader *header,
+           GstCaps            *caps)
+{
+	gst_pb_utils_add_codec_description_to_tag_list (header->tags,
+	                                                GST_TAG_AUDIO_CODEC,
+	                                                caps);
+	gst_caps_unref (caps);
+}
+
+/* FLAC */
+
+static gboolean
+parse_flac (AudioFile          *file,
+            TrackerAudioHeader *header)
+{
+	goffset offset = 4;
+	gboolean last = FALSE, have_info = FALSE;
+
+	while (!last) {
+		g_autofree guint8 *block_buffer = NULL, *buffer = NULL;
+		const guint8 *block, *data;
+		guint type;
+		gsize len;
+
+		block = audio_file_get (file, offset, 4, &block_buffer);
+		if (!block)
+			return FALSE;
+
+		last = (block[0] & 0x80) != 0;
+		type = block[0] & 0x7f;
+		len = read_uint24_be (&block[1]);
+		offset += 4;
+
+		if (type == FLAC_CUESHEET) {
+			/* GStreamer turns these into a table of contents */
+			return FALSE;
+		} else if (type == FLAC_STREAMINFO) {
+			guint64 n_samples;
+
+			data = audio_file_get (file, offset, len, &buffer);
+			if (!data || len < 34)
+				return FALSE;
+
+			header->sample_rate = (data[10] << 12) | (data[11] << 4) | (data[12] >> 4);
+			header->channels = ((data[12] >> 1) & 0x07) + 1;
+			n_samples = ((guint64) (data[13] & 0x0f) << 32) | read_uint32_be (&data[14]);
+
+			if (header->sample_rate > 0 && n_samples > 0)
+				header->duration = n_samples / header->sample_rate;
+
+			have_info = TRUE;
+		} else if (type == FLAC_VORBIS_COMMENT) {
+			data = audio_file_get (file, offset, len, &buffer);
+			if (!data)
+				return FALSE;
+
+			add_vorbis_comments (header, data, len, NULL, 0);
+		}
+
+		offset += len;
+	}
+
+	if (!have_info)
+		return FALSE;
+
+	add_codec (header, gst_caps_new_empty_simple ("audio/x-flac"));
+
+	return TRUE;
+}
+
+/* Ogg Vorbis and Opus */
+
+static gboolean
+parse_ogg_packet (TrackerAudioHeader *header,
+                  const guint8       *data,
+                  gsize               len,
+                  guint               n_packet,
+                  OggCodec           *codec,
+                  guint              *pre_skip)
+{
+	if (n_packet == 0) {
+		if (len >= 30 && memcmp (data, "\001vorbis", 7) == 0) {
+			*codec = OGG_CODEC_VORBIS;
+			header->channels = data[11];
+			header->sample_rate = read_uint32_le (&data[12]);
+		} else if (len >= 19 && memcmp (data, "OpusHead", 8) == 0) {
+			*codec = OGG_CODEC_OPUS;
+			header->channels = data[9];
+			*pre_skip = read_uint16_le (&data[10]);
+			header->sample_rate = read_uint32_le (&data[12]);
+			if (header->sample_rate <= 0)
+				header->sample_rate = 48000;
+		} else {
+			/* Other codecs, e.g. FLAC, Speex, or video */
+			return FALSE;
+		}
+	} else if (*codec == OGG_CODEC_VORBIS) {
+		if (len < 7 || memcmp (data, "\003vorbis", 7) != 0)
+			return FALSE;
+
+		add_vorbis_comments (header, data, len, "\003vorbis", 7);
+	} else if (*codec == OGG_CODEC_OPUS) {
+		if (len < 8 || memcmp (data, "OpusTags", 8) != 0)
+			return FALSE;
+
+		add_vorbis_comments (header, data, len, "OpusTags", 8);
+	}
+
+	return TRUE;
+}
+
+static gint64
+get_ogg_last_granule (AudioFile *file,
+                      guint32    serial)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	gsize len;
+	gssize i;
+
+	len = MIN (file->size, MAX_TAIL_READ);
+	data = audio_file_get (file, file->size - len, len, &buffer);
+	if (!data || len < OGG_PAGE_HEADER_SIZE)
+		return -1;
+
+	for (i = len - OGG_PAGE_HEADER_SIZE; i >= 0; i--) {
+		gint64 granule;
+
+		if (data[i] != 'O' || memcmp (&data[i], "OggS", 4) != 0 ||
+		    read_uint32_le (&data[i + 14]) != serial)
+			continue;
+
+		/* -1 for pages where no packet ends */
+		granule = (gint64) read_uint64_le (&data[i + 6]);
+		if (granule >= 0)
+			return granule;
+	}
+
+	return -1;
+}
+
+static gboolean
+parse_ogg (AudioFile          *file,
+           TrackerAudioHeader *header)
+{
+	g_autoptr (GByteArray) packet = NULL;
+	OggCodec codec = OGG_CODEC_NONE;
+	goffset offset = 0;
+	guint32 serial = 0;
+	guint n_packets = 0, pre_skip = 0;
+	gint64 granule;
+
+	packet = g_byte_array_new ();
+
+	/* The identification and comment packets come first */
+	while (n_packets < 2) {
+		g_autofree guint8 *page_buffer = NULL, *body_buffer = NULL;
+		const guint8 *page, *body;
+		guint n_segments, i;
+		gsize body_len = 0, pos = 0;
+
+		page = audio_file_get (file, offset, OGG_PAGE_HEADER_SIZE, &page_buffer);
+		if (!page || memcmp (page, "OggS", 4) != 0)
+			return FALSE;
+
+		n_segments = page[26];
+		g_clear_pointer (&page_buffer, g_free);
+		page = audio_file_get (file, offset, OGG_PAGE_HEADER_SIZE + n_segments, &page_buffer);
+		if (!page)
+			return FALSE;
+
+		if (offset == 0) {
+			if ((page[5] & OGG_PAGE_BOS) == 0)
+				return FALSE;
+
+			serial = read_uint32_le (&page[14]);
+		} else if (read_uint32_le (&page[14]) != serial) {
+			/* Several logical streams, e.g. audio and video */
+			return FALSE;
+		}
+
+		for (i = 0; i < n_segments; i++)
+			body_len += page[OGG_PAGE_HEADER_SIZE + i];
+
+		body = audio_file_get (file, offset + OGG_PAGE_HEADER_SIZE + n_segments,
+		                       body_len, &body_buffer);
+		if (!body)
+			return FALSE;
+
+		for (i = 0; i < n_segments && n_packets < 2; i++) {
+			guint segment_len = page[OGG_PAGE_HEADER_SIZE + i];
+
+			if (packet->len + segment_len > MAX_HEADER_READ)
+				return FALSE;
+
+			g_byte_array_append (packet, &body[pos], segment_len);
+			pos += segment_len;
+
+			/* Packets end in a segment shorter than 255 bytes */
+			if (segment_len < 255) {
+				if (!parse_ogg_packet (header, packet->data, packet->len,
+				                       n_packets, &codec, &pre_skip))
+					return FALSE;
+
+				n_packets++;
+				g_byte_array_set_size (packet, 0);
+			}
+		}
+
+		offset += OGG_PAGE_HEADER_SIZE + n_segments + body_len;
+	}
+
+	granule = get_ogg_last_granule (file, serial);
+
+	if (codec == OGG_CODEC_VORBIS) {
+		if (granule > 0 && header->sample_rate > 0)
+			header->duration = granule / header->sample_rate;
+
+		add_codec (header, gst_caps_new_empty_simple ("audio/x-vorbis"));
+	} else {
+		/* Opus granule positions are always at 48kHz */
+		if (granule > pre_skip)
+			header->duration = (granule - pre_skip) / 48000;
+
+		add_codec (header, gst_caps_new_empty_simple ("audio/x-opus"));
+	}
+
+	return TRUE;
+}
+
+/* WAV */
+
+static const gchar *
+get_raw_format (guint format_tag,
+                guint bits)
+{
+	if (format_tag == WAVE_FORMAT_PCM) {
+		switch (bits) {
+		case 8:
+			return "U8";
+		case 16:
+			return "S16LE";
+		case 24:
+			return "S24LE";
+		case 32:
+			return "S32LE";
+		}
+	} else if (format_tag == WAVE_FORMAT_IEEE_FLOAT) {
+		switch (bits) {
+		case 32:
+			return "F32LE";
+		case 64:
+			return "F64LE";
+		}
+	}
+
+	return NULL;
+}
+
+static void
+parse_riff_info (TrackerAudioHeader *header,
+                 const guint8       *data,
+                 gsize               len)
+{
+	gsize offset = 0;
+	guint i;
+
+	while (offset + 8 <= len) {
+		guint32 size = read_uint32_le (&data[offset + 4]);
+
+		if (size > len - offset - 8)
+			break;
+
+		for (i = 0; i < G_N_ELEMENTS (riff_info_tags); i++) {
+			g_autofree gchar *str = NULL;
+
+			if (memcmp (&data[offset], riff_info_tags[i].id, 4) != 0)
+				continue;
+
+			str = dup_tag_string (&data[offset + 8], size);
+			add_tag_from_string (header->tags, riff_info_tags[i].tag, str);
+			break;
+		}
+
+		offset += 8 + size + (size & 1);
+	}
+}
+
+static gboolean
+parse_wav (AudioFile          *file,
+           TrackerAudioHeader *header)
+{
+	const gchar *format = NULL;
+	goffset offset = 12;
+	guint32 byte_rate = 0;
+	guint64 data_size = 0;
+	gboolean have_data = FALSE;
+
+	while (offset + 8 <= file->size) {
+		g_autofree guint8 *chunk_buffer = NULL, *buffer = NULL;
+		const guint8 *chunk, *data;
+		guint32 size;
+
+		chunk = audio_file_get (file, offset, 8, &chunk_buffer);
+		if (!chunk)
+			return FALSE;
+
+		size = read_uint32_le (&chunk[4]);
+		offset += 8;
+
+		if (memcmp (chunk, "fmt ", 4) == 0) {
+			guint format_tag, bits;
+
+			data = audio_file_get (file, offset, size, &buffer);
+			if (!data || size < 16)
+				return FALSE;
+
+			format_tag = read_uint16_le (data);
+			header->channels = read_uint16_le (&data[2]);
+			header->sample_rate = read_uint32_le (&data[4]);
+			byte_rate = read_uint32_le (&data[8]);
+			bits = read_uint16_le (&data[14]);
+
+			if (format_tag == WAVE_FORMAT_EXTENSIBLE && size >= 26)
+				format_tag = read_uint16_le (&data[24]);
+
+			/* Compressed formats are left to GStreamer */
+			format = get_raw_format (format_tag, bits);
+			if (!format)
+				return FALSE;
+		} else if (memcmp (chunk, "data", 4) == 0) {
+			/* Streams being written may not have the size set yet */
+			data_size = MIN ((goffset) size, file->size - offset);
+			have_data = TRUE;
+		} else if (memcmp (chunk, "LIST", 4) == 0 && size >= 4 && size <= MAX_TAIL_READ) {
+			data = audio_file_get (file, offset, size, &buffer);
+			if (data && memcmp (data, "INFO", 4) == 0)
+				parse_riff_info (header, &data[4], size - 4);
+		}
+
+		offset += (goffset) size + (size & 1);
+	}
+
+	if (!format || !have_data)
+		return FALSE;
+
+	if (byte_rate > 0)
+		header->duration = data_size / byte_rate;
+
+	add_codec (header, gst_caps_new_simple ("audio/x-raw",
+	                                        "format", G_TYPE_STRING, format,
+	                                        NULL));
+
+	return TRUE;
+}
+
+/* MP4 audio */
+
+static gboolean
+read_box (AudioFile *file,
+          goffset    offset,
+          goffset    end,
+          gchar      type[4],
+          goffset   *body,
+          goffset   *next)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	guint64 size;
+	guint header_size = 8;
+
+	if (end - offset < 8)
+		return FALSE;
+
+	data = audio_file_get (file, offset, 16, &buffer);
+	if (!data) {
+		g_clear_pointer (&buffer, g_free);
+		data = audio_file_get (file, offset, 8, &buffer);
+		if (!data)
+			return FALSE;
+	}
+
+	size = read_uint32_be (data);
+	memcpy (type, &data[4], 4);
+
+	if (size == 1) {
+		if (end - offset < 16)
+			return FALSE;
+
+		size = read_uint64_be (&data[8]);
+		header_size = 16;
+	} else if (size == 0) {
+		/* Extends to the end of the file */
+		size = end - offset;
+	}
+
+	if (size < header_size || size > (guint64) (end - offset))
+		return FALSE;
+
+	*body = offset + header_size;
+	*next = offset + size;
+
+	return TRUE;
+}
+
+static gboolean
+find_box (AudioFile   *file,
+          goffset      start,
+          goffset      end,
+          const gchar *type,
+          goffset     *body,
+          goffset     *box_end)
+{
+	goffset offset = start;
+	gchar box_type[4];
+
+	while (read_box (file, offset, end, box_type, body, box_end)) {
+		if (memcmp (box_type, type, 4) == 0)
+			return TRUE;
+
+		offset = *box_end;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+parse_mp4_track (AudioFile          *file,
+                 goffset             start,
+                 goffset             end,
+                 TrackerAudioHeader *header,
+                 GstCaps           **caps)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	goffset body, body_end, mdia, mdia_end;
+	gchar codec[4];
+
+	if (!find_box (file, start, end, "mdia", &mdia, &mdia_end))
+		return FALSE;
+
+	/* Only audio tracks */
+	if (!find_box (file, mdia, mdia_end, "hdlr", &body, &body_end))
+		return FALSE;
+
+	data = audio_file_get (file, body, 12, &buffer);
+	if (!data || body_end - body < 12 || memcmp (&data[8], "soun", 4) != 0)
+		return FALSE;
+
+	if (!find_box (file, mdia, mdia_end, "minf", &body, &body_end) ||
+	    !find_box (file, body, body_end, "stbl", &body, &body_end) ||
+	    !find_box (file, body, body_end, "stsd", &body, &body_end))
+		return FALSE;
+
+	/* Skip version, flags and entry count to the first sample entry */
+	if (!read_box (file, body + 8, body_end, codec, &body, &body_end) ||
+	    body_end - body < 28)
+		return FALSE;
+
+	g_clear_pointer (&buffer, g_free);
+	data = audio_file_get (file, body, 28, &buffer);
+	if (!data)
+		return FALSE;
+
+	header->channels = read_uint16_be (&data[16]);
+	/* 16.16 fixed point */
+	header->sample_rate = read_uint32_be (&data[24]) >> 16;
+
+	if (memcmp (codec, "mp4a", 4) == 0) {
+		*caps = gst_caps_new_simple ("audio/mpeg",
+		                             "mpegversion", G_TYPE_INT, 4,
+		                             NULL);
+	} else if (memcmp (codec, "alac", 4) == 0) {
+		*caps = gst_caps_new_empty_simple ("audio/x-alac");
+	} else if (memcmp (codec, "fLaC", 4) == 0) {
+		*caps = gst_caps_new_empty_simple ("audio/x-flac");
+	} else if (memcmp (codec, "Opus", 4) == 0) {
+		*caps = gst_caps_new_empty_simple ("audio/x-opus");
+	}
+
+	return TRUE;
+}
+
+static void
+parse_mp4_freeform_item (AudioFile          *file,
+                         goffset             start,
+                         goffset             end,
+                         const guint8       *value,
+                         gsize               value_len,
+                         TrackerAudioHeader *header)
+{
+	g_autofree guint8 *buffer = NULL;
+	g_autofree gchar *name = NULL, *str = NULL;
+	const guint8 *data;
+	goffset body, body_end;
+	guint i;
+
+	if (!find_box (file, start, end, "name", &body, &body_end) ||
+	    body_end - body <= 4)
+		return;
+
+	data = audio_file_get (file, body + 4, body_end - body - 4, &buffer);
+	if (!data)
+		return;
+
+	name = g_strndup ((const gchar *) data, body_end - body - 4);
+
+	for (i = 0; i < G_N_ELEMENTS (mp4_freeform_tags); i++) {
+		if (g_strcmp0 (name, mp4_freeform_tags[i].name) != 0)
+			continue;
+
+		str = dup_tag_string (value, value_len);
+		add_tag_from_string (header->tags, mp4_freeform_tags[i].tag, str);
+		break;
+	}
+}
+
+static void
+parse_mp4_item (AudioFile          *file,
+                const gchar         type[4],
+                goffset             start,
+                goffset             end,
+                TrackerAudioHeader *header)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	goffset body, body_end;
+	gsize len;
+	guint i;
+
+	if (!find_box (file, start, end, "data", &body, &body_end) ||
+	    body_end - body < 8)
+		return;
+
+	/* Skip the type indicator and locale */
+	len = body_end - body - 8;
+	data = audio_file_get (file, body + 8, len, &buffer);
+	if (!data)
+		return;
+
+	if (memcmp (type, "trkn", 4) == 0 || memcmp (type, "disk", 4) == 0) {
+		gboolean track = type[0] == 't';
+		guint number, count;
+
+		if (len < 6)
+			return;
+
+		number = read_uint16_be (&data[2]);
+		count = read_uint16_be (&data[4]);
+
+		if (number > 0) {
+			gst_tag_list_add (header->tags, GST_TAG_MERGE_APPEND,
+			                  track ? GST_TAG_TRACK_NUMBER : GST_TAG_ALBUM_VOLUME_NUMBER,
+			                  number, NULL);
+		}
+
+		if (count > 0) {
+			gst_tag_list_add (header->tags, GST_TAG_MERGE_APPEND,
+			                  track ? GST_TAG_TRACK_COUNT : GST_TAG_ALBUM_VOLUME_COUNT,
+			                  count, NULL);
+		}
+	} else if (memcmp (type, "gnre", 4) == 0) {
+		const gchar *genre;
+
+		/* ID3v1 genre plus one */
+		if (len < 2 || read_uint16_be (data) == 0)
+			return;
+
+		genre = gst_tag_id3_genre_get (read_uint16_be (data) - 1);
+		add_tag_from_string (header->tags, GST_TAG_GENRE, genre);
+	} else if (memcmp (type, "----", 4) == 0) {
+		parse_mp4_freeform_item (file, start, end, data, len, header);
+	} else {
+		for (i = 0; i < G_N_ELEMENTS (mp4_tags); i++) {
+			g_autofree gchar *str = NULL;
+
+			if (memcmp (type, mp4_tags[i].id, 4) != 0)
+				continue;
+
+			str = dup_tag_string (data, len);
+			add_tag_from_string (header->tags, mp4_tags[i].tag, str);
+			break;
+		}
+	}
+}
+
+static void
+parse_mp4_tags (AudioFile          *file,
+                goffset             start,
+                goffset             end,
+                TrackerAudioHeader *header)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	goffset body, body_end, offset, next;
+	gchar type[4];
+
+	if (!find_box (file, start, end, "udta", &body, &body_end) ||
+	    !find_box (file, body, body_end, "meta", &body, &body_end))
+		return;
+
+	/* An ISO full box, except in some QuickTime files */
+	data = audio_file_get (file, body, 8, &buffer);
+	if (!data)
+		return;
+
+	if (memcmp (&data[4], "hdlr", 4) != 0)
+		body += 4;
+
+	if (!find_box (file, body, body_end, "ilst", &body, &body_end))
+		return;
+
+	for (offset = body; read_box (file, offset, body_end, type, &body, &next); offset = next)
+		parse_mp4_item (file, type, body, next, header);
+}
+
+static gboolean
+parse_mp4 (AudioFile          *file,
+           TrackerAudioHeader *header)
+{
+	g_autofree guint8 *buffer = NULL;
+	const guint8 *data;
+	GstCaps *caps = NULL;
+	goffset moov, moov_end, body, body_end, offset, next;
+	guint n_tracks = 0;
+	gchar type[4];
+
+	if (!find_box (file, 0, file->size, "moov", &moov, &moov_end) ||
+	    moov_end - moov > MAX_HEADER_READ)
+		return FALSE;
+
+	for (offset = moov; read_box (file, offset, moov_end, type, &body, &next); offset = next) {
+		if (memcmp (type, "trak", 4) != 0)
+			continue;
+
+		/* Single audio track files only, e.g. no chapter tracks */
+		if (n_tracks > 0 ||
+		    !parse_mp4_track (file, body, next, header, &caps)) {
+			g_clear_pointer (&caps, gst_caps_unref);
+			return FALSE;
+		}
+
+		n_tracks++;
+	}
+
+	if (n_tracks == 0)
+		return FALSE;
+
+	if (find_box (file, moov, moov_end, "mvhd", &body, &body_end)) {
+		guint64 duration = 0;
+		guint32 timescale = 0;
+
+		data = audio_file_get (file, body, MIN (body_end - body, 32), &buffer);
+
+		if (data && data[0] == 1 && body_end - body >= 32) {
+			timescale = read_uint32_be (&data[20]);
+			duration = read_uint64_be (&data[24]);
+		} else if (data && data[0] == 0 && body_end - body >= 20) {
+			timescale = read_uint32_be (&data[12]);
+			duration = read_uint32_be (&data[16]);
+		}
+
+		if (timescale > 0)
+			header->duration = duration / timescale;
+	}
+
+	parse_mp4_tags (file, moov, moov_end, header);
+
+	if (caps)
+		add_codec (header, caps);
+
+	return TRUE;
+}
+
+static gboolean
+is_mp4_audio_brand (const guint8 *brand)
+{
+	return (memcmp (brand, "M4A ", 4) == 0 ||
+	        memcmp (brand, "M4B ", 4) == 0 ||
+	        memcmp (brand, "mp42", 4) == 0 ||
+	        memcmp (brand, "isom", 4) == 0);
+}
+
+/**
+ * tracker_audio_header_parse:
+ * @path: a local file path
+ * @header: return location for the parsed information
+ *
+ * Reads tags and stream information of FLAC, Ogg Vorbis/Opus, WAV
+ * and MP4 audio files from their headers. Returns %FALSE for any other
+ * kind of file, or if the file should better be handled by GStreamer.
+ * On success, @header must be freed with tracker_audio_header_clear().
+ *
+ * Returns: %TRUE if @header was filled in.
+ **/
+gboolean
+tracker_audio_header_parse (const gchar        *path,
+                            TrackerAudioHeader *header)
+{
+	AudioFile file = { -1, };
+	gboolean parsed = FALSE;
+	void *head;
+
+	header->tags = NULL;
+	header->duration = -1;
+	header->channels = -1;
+	header->sample_rate = -1;
+
+	file.size = tracker_file_get_size (path);
+	if (file.size < 12)
+		return FALSE;
+
+	file.fd = tracker_file_open_fd (path);
+	if (file.fd == -1)
+		return FALSE;
+
+	file.head_size = MIN (file.size, MAX_HEADER_READ);
+	head = mmap (NULL, file.head_size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+
+	if (head == MAP_FAILED) {
+		close (file.fd);
+		return FALSE;
+	}
+
+	file.head = head;
+	header->tags = gst_tag_list_new_empty ();
+
+	if (memcmp (file.head, "fLaC", 4) == 0) {
+		parsed = parse_flac (&file, header);
+	} else if (memcmp (file.head, "OggS", 4) == 0) {
+		parsed = parse_ogg (&file, header);
+	} else if (memcmp (file.head, "RIFF", 4) == 0 &&
+	           memcmp (&file.head[8], "WAVE", 4) == 0) {
+		parsed = parse_wav (&file, header);
+	} else if (memcmp (&file.head[4], "ftyp", 4) == 0 &&
+	           is_mp4_audio_brand (&file.head[8])) {
+		parsed = parse_mp4 (&file, header);
+	}
+
+	munmap (head, file.head_size);
+	close (file.fd);
+
+	if (!parsed)
+		tracker_audio_header_clear (header);
+
+	return parsed;
+}
+
+void
+tracker_audio_header_clear (TrackerAudioHeader *header)
+{
+	g_clear_pointer (&header->tags, gst_tag_list_unref);
+}
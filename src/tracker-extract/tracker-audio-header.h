@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_EXTRACT_AUDIO_HEADER_H__
+#define __TRACKER_EXTRACT_AUDIO_HEADER_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+	GstTagList *tags;
+	/* In seconds, -1 if unknown */
+	gint64 duration;
+	gint channels;
+	gint sample_rate;
+} TrackerAudioHeader;
+
+gboolean tracker_audio_header_parse (const gchar        *path,
+                                     TrackerAudioHeader *header);
+void     tracker_audio_header_clear (TrackerAudioHeader *header);
+
+G_END_DECLS
+
+#endif /* __TRACKER_EXTRACT_AUDIO_HEADER_H__ */
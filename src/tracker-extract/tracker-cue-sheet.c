@@ -290,38 +290,170 @@ tracker_cue_sheet_parse (const gchar *cue_sheet)
 	return result;
 }
 
-static GList *
+/* Directories whose CUE sheets are kept around, so tracks of the same
+ * album don't look them up and read them again.
+ */
+#define CUE_SHEET_CACHE_SIZE 8
+
+typedef struct {
+	GFile *file;
+	gchar *contents;
+} CueSheet;
+
+typedef struct {
+	/* Of the directory, the cache entry is stale if it changed */
+	guint64 modified;
+	GArray *sheets;
+	gint ref_count;
+} DirectoryCueSheets;
+
+static GMutex cache_mutex;
+static GHashTable *cache = NULL;
+
+static void
+cue_sheet_clear (CueSheet *sheet)
+{
+	g_object_unref (sheet->file);
+	g_free (sheet->contents);
+}
+
+static DirectoryCueSheets *
+directory_cue_sheets_new (guint64 modified)
+{
+	DirectoryCueSheets *sheets;
+
+	sheets = g_slice_new0 (DirectoryCueSheets);
+	sheets->modified = modified;
+	sheets->sheets = g_array_new (FALSE, FALSE, sizeof (CueSheet));
+	g_array_set_clear_func (sheets->sheets, (GDestroyNotify) cue_sheet_clear);
+	sheets->ref_count = 1;
+
+	return sheets;
+}
+
+static DirectoryCueSheets *
+directory_cue_sheets_ref (DirectoryCueSheets *sheets)
+{
+	g_atomic_int_inc (&sheets->ref_count);
+	return sheets;
+}
+
+static void
+directory_cue_sheets_unref (DirectoryCueSheets *sheets)
+{
+	if (g_atomic_int_dec_and_test (&sheets->ref_count)) {
+		g_array_unref (sheets->sheets);
+		g_slice_free (DirectoryCueSheets, sheets);
+	}
+}
+
+static guint64
+get_directory_modified (GFile *directory)
+{
+	g_autoptr (GFileInfo) info = NULL;
+
+	info = g_file_query_info (directory,
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (!info)
+		return 0;
+
+	return (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+	        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+}
+
+static void
+add_cue_sheet (DirectoryCueSheets *sheets,
+               GFile              *file)
+{
+	CueSheet sheet;
+	GError *error = NULL;
+
+	if (!g_file_load_contents (file, NULL, &sheet.contents, NULL, NULL, &error)) {
+		g_debug ("Unable to read cue sheet: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	sheet.file = g_object_ref (file);
+	g_array_append_val (sheets->sheets, sheet);
+}
+
+static DirectoryCueSheets *
 find_local_cue_sheets (TrackerSparqlConnection *conn,
                        GFile                   *audio_file)
 {
 	g_autoptr (TrackerSparqlStatement) stmt = NULL;
 	g_autoptr (TrackerSparqlCursor) cursor = NULL;
 	g_autoptr (GFile) parent = NULL;
-	g_autofree gchar *parent_uri = NULL;
-	GList *result = NULL;
+	gchar *parent_uri;
+	DirectoryCueSheets *sheets;
+	guint64 modified;
+
+	parent = g_file_get_parent (audio_file);
+	if (!parent)
+		return NULL;
+
+	parent_uri = g_file_get_uri (parent);
+	modified = get_directory_modified (parent);
+
+	g_mutex_lock (&cache_mutex);
+	sheets = cache ? g_hash_table_lookup (cache, parent_uri) : NULL;
+	if (sheets && sheets->modified == modified && modified != 0) {
+		directory_cue_sheets_ref (sheets);
+		g_mutex_unlock (&cache_mutex);
+		g_free (parent_uri);
+		return sheets;
+	}
+	g_mutex_unlock (&cache_mutex);
 
 	stmt = tracker_sparql_connection_load_statement_from_gresource (conn,
 	                                                                "/org/freedesktop/Tracker3/Extract/queries/get-cue-sheets.rq",
 	                                                                NULL, NULL);
-	if (!stmt)
+	if (!stmt) {
+		g_free (parent_uri);
 		return NULL;
+	}
 
-	parent = g_file_get_parent (audio_file);
-	parent_uri = g_file_get_uri (parent);
 	tracker_sparql_statement_bind_string (stmt, "parent", parent_uri);
 	cursor = tracker_sparql_statement_execute (stmt, NULL, NULL);
 
-	if (!cursor)
+	if (!cursor) {
+		g_free (parent_uri);
 		return NULL;
+	}
+
+	sheets = directory_cue_sheets_new (modified);
 
 	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-		const gchar *str;
+		g_autoptr (GFile) file = NULL;
 
-		str = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-		result = g_list_prepend (result, g_file_new_for_uri (str));
+		file = g_file_new_for_uri (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+		add_cue_sheet (sheets, file);
 	}
 
-	return result;
+	if (modified == 0) {
+		g_free (parent_uri);
+		return sheets;
+	}
+
+	g_mutex_lock (&cache_mutex);
+
+	if (!cache) {
+		cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                               (GDestroyNotify) directory_cue_sheets_unref);
+	} else if (g_hash_table_size (cache) >= CUE_SHEET_CACHE_SIZE) {
+		g_hash_table_remove_all (cache);
+	}
+
+	g_hash_table_replace (cache, parent_uri,
+	                      directory_cue_sheets_ref (sheets));
+
+	g_mutex_unlock (&cache_mutex);
+
+	return sheets;
 }
 
 static GFile *
@@ -352,48 +484,40 @@ tracker_cue_sheet_guess_from_uri (TrackerSparqlConnection *conn,
 	GFile *audio_file;
 	GFile *cue_sheet_file;
 	gchar *audio_file_name;
-	GList *cue_sheet_list = NULL;
+	DirectoryCueSheets *sheets = NULL;
 	TrackerToc *toc;
-	GError *error = NULL;
-	GList *n;
+	guint i;
 
 	audio_file = g_file_new_for_uri (uri);
 	audio_file_name = g_file_get_basename (audio_file);
 
 	cue_sheet_file = find_matching_cue_file (audio_file);
 
-	if (cue_sheet_file)
-		cue_sheet_list = g_list_prepend (cue_sheet_list, cue_sheet_file);
-	else if (conn)
-		cue_sheet_list = find_local_cue_sheets (conn, audio_file);
+	if (cue_sheet_file) {
+		sheets = directory_cue_sheets_new (0);
+		add_cue_sheet (sheets, cue_sheet_file);
+		g_object_unref (cue_sheet_file);
+	} else if (conn) {
+		sheets = find_local_cue_sheets (conn, audio_file);
+	}
 
 	toc = NULL;
 
-	for (n = cue_sheet_list; n != NULL; n = n->next) {
-		gchar *buffer;
-
-		cue_sheet_file = n->data;
-
-		if (!g_file_load_contents (cue_sheet_file, NULL, &buffer, NULL, NULL, &error)) {
-			g_debug ("Unable to read cue sheet: %s", error->message);
-			g_error_free (error);
-			continue;
-		}
-
-		toc = parse_cue_sheet_for_file (buffer, audio_file_name);
+	for (i = 0; sheets && i < sheets->sheets->len; i++) {
+		CueSheet *sheet = &g_array_index (sheets->sheets, CueSheet, i);
 
-		g_free (buffer);
+		toc = parse_cue_sheet_for_file (sheet->contents, audio_file_name);
 
 		if (toc != NULL) {
-			char *path = g_file_get_path (cue_sheet_file);
+			char *path = g_file_get_path (sheet->file);
 			g_debug ("Using external CUE sheet: %s", path);
 			g_free (path);
 			break;
 		}
 	}
 
-	g_list_foreach (cue_sheet_list, (GFunc) g_object_unref, NULL);
-	g_list_free (cue_sheet_list);
+	if (sheets)
+		directory_cue_sheets_unref (sheets);
 
 	g_object_unref (audio_file);
 	g_free (audio_file_name);
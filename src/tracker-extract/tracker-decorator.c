@@ -27,10 +27,30 @@
 
 #ifdef HAVE_POSIX_FADVISE
 #include <fcntl.h>
+#include <sys/stat.h>
 #endif
 
 #define QUERY_BATCH_SIZE 200
+/* Bytes read ahead from the start of the next file, extractors
+ * mostly look at headers, so large files are not read in full.
+ */
+#define PREFETCH_SIZE (1024 * 1024)
+/* Bytes read ahead from the end, for trailing tags and indexes */
+#define PREFETCH_TAIL_SIZE (64 * 1024)
+/* Number of queued files read ahead of the extraction workers */
+#define PREFETCH_AHEAD 4
 #define DEFAULT_BATCH_SIZE 200
+/* Files modified this recently get extracted first */
+#define RECENT_DAYS 7
+/* Files at least this big are looked up among the already extracted
+ * ones by their content fingerprint, smaller ones are cheaper to
+ * extract again.
+ */
+#define DUPLICATE_MIN_SIZE (1024 * 1024)
+/* Minimum time between full counts of the items left, in between
+ * the count is kept up to date from the store change events.
+ */
+#define RECOUNT_INTERVAL (10 * 60 * G_USEC_PER_SEC)
 
 /**
  * SECTION:tracker-decorator
@@ -48,14 +68,33 @@
 **/
 
 typedef struct _TrackerDecoratorPrivate TrackerDecoratorPrivate;
+typedef struct _CommitRange CommitRange;
 typedef struct _ClassInfo ClassInfo;
 
 struct _TrackerDecoratorInfo {
 	GTask *task;
+	GCancellable *cancellable;
+	GCancellable *parent_cancellable;
+	gulong cancelled_id;
+	TrackerExtractInfo *extract_info;
 	gchar *url;
 	gchar *content_id;
+	gchar *mimetype;
+	gchar *shared_hash;
+	gchar *fingerprint;
+	GPtrArray *waiters; /* GTasks of tracker_decorator_prioritize_file_async() */
 	gint id;
 	gint ref_count;
+	guint done      : 1;
+	guint discarded : 1;
+	guint priority  : 1;
+	guint prefetched : 1;
+};
+
+/* Range of items of the commit buffer, last is excluded */
+struct _CommitRange {
+	guint first;
+	guint last;
 };
 
 struct _TrackerDecoratorPrivate {
@@ -63,15 +102,51 @@ struct _TrackerDecoratorPrivate {
 
 	gssize n_remaining_items;
 	gssize n_processed_items;
+	gssize n_processed_before_count;
+	gint64 last_count_time;
 
 	GQueue item_cache; /* Queue of TrackerDecoratorInfo */
+	GQueue in_flight; /* Queue of TrackerDecoratorInfo, in processing order */
 
 	GStrv priority_graphs;
 
+	/* Besides priority graphs, files modified after recent_date,
+	 * or in the folders matched by visible_pattern, have high
+	 * priority. The date is kept for a whole pass over the items,
+	 * so pagination stays consistent.
+	 */
+	GDateTime *recent_date;
+	gchar *visible_pattern;
+
+	/* Last item IDs seen in high/regular priority graphs, the
+	 * next query page starts after those.
+	 */
+	gint64 last_high_id;
+	gint64 last_low_id;
+
+	/* Items left for a later pass by the defer_item vfunc */
+	guint n_deferred;
+
+	/* Share of the items handled by this decorator, by tracker:id */
+	guint partition;
+	guint n_partitions;
+
 	GPtrArray *sparql_buffer; /* Array of TrackerExtractInfo */
+	GArray *sparql_buffer_ids; /* Item IDs of the SPARQL buffer */
 	GPtrArray *commit_buffer; /* Array of TrackerExtractInfo */
+	GArray *retry_ranges; /* Ranges of the commit buffer left to retry */
+
+	/* Waiters for prioritized items in the SPARQL and commit buffers */
+	GPtrArray *buffered_waiters;
+	GPtrArray *committing_waiters;
+
 	GTimer *timer;
+	gint64 commit_start_time;
 
+	/* Connection the items to extract are looked up through,
+	 * updates always go through the miner connection.
+	 */
+	TrackerSparqlConnection *query_conn;
 	TrackerSparqlStatement *remaining_items_query;
 	TrackerSparqlStatement *item_count_query;
 
@@ -83,6 +158,7 @@ struct _TrackerDecoratorPrivate {
 	guint updating   : 1;
 	guint processing : 1;
 	guint querying   : 1;
+	guint counting   : 1;
 };
 
 enum {
@@ -118,6 +194,31 @@ G_DEFINE_QUARK (TrackerDecoratorError, tracker_decorator_error)
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (TrackerDecorator, tracker_decorator, TRACKER_TYPE_MINER)
 
+static void
+propagate_cancellation_cb (GCancellable *parent_cancellable,
+                           GCancellable *cancellable)
+{
+	g_cancellable_cancel (cancellable);
+}
+
+static void
+return_waiters (GPtrArray    *waiters,
+                const GError *error)
+{
+	guint i;
+
+	for (i = 0; i < waiters->len; i++) {
+		GTask *task = g_ptr_array_index (waiters, i);
+
+		if (error)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_boolean (task, TRUE);
+	}
+
+	g_ptr_array_set_size (waiters, 0);
+}
+
 static TrackerDecoratorInfo *
 tracker_decorator_info_new (TrackerDecorator    *decorator,
                             TrackerSparqlCursor *cursor)
@@ -131,10 +232,23 @@ tracker_decorator_info_new (TrackerDecorator    *decorator,
 	info->url = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
 	info->id = tracker_sparql_cursor_get_integer (cursor, 1);
 	info->content_id = g_strdup (tracker_sparql_cursor_get_string (cursor, 2, NULL));
+	info->priority = tracker_sparql_cursor_get_integer (cursor, 3) != 0;
+	info->mimetype = g_strdup (tracker_sparql_cursor_get_string (cursor, 4, NULL));
+	info->shared_hash = g_strdup (tracker_sparql_cursor_get_string (cursor, 5, NULL));
+	info->fingerprint = g_strdup (tracker_sparql_cursor_get_string (cursor, 6, NULL));
 	info->ref_count = 1;
 
+	/* Each item gets its own cancellable, so it can be cancelled
+	 * individually, pausing the decorator cancels all of them.
+	 */
+	info->cancellable = g_cancellable_new ();
+	info->parent_cancellable = g_object_ref (priv->task_cancellable);
+	info->cancelled_id = g_cancellable_connect (info->parent_cancellable,
+	                                            G_CALLBACK (propagate_cancellation_cb),
+	                                            info->cancellable, NULL);
+
 	info->task = g_task_new (decorator,
-	                         priv->task_cancellable,
+	                         info->cancellable,
 	                         decorator_task_done,
 	                         info);
 
@@ -175,8 +289,30 @@ tracker_decorator_info_unref (TrackerDecoratorInfo *info)
 
 	if (info->task)
 		g_object_unref (info->task);
+	if (info->parent_cancellable) {
+		g_cancellable_disconnect (info->parent_cancellable,
+		                          info->cancelled_id);
+		g_object_unref (info->parent_cancellable);
+	}
+	g_clear_object (&info->cancellable);
+	g_clear_pointer (&info->extract_info, tracker_extract_info_unref);
+
+	/* The item went away before its results were committed */
+	if (info->waiters) {
+		g_autoptr (GError) error = NULL;
+
+		error = g_error_new (G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+		                     "File is no longer pending extraction: %s",
+		                     info->url);
+		return_waiters (info->waiters, error);
+		g_ptr_array_unref (info->waiters);
+	}
+
 	g_free (info->url);
 	g_free (info->content_id);
+	g_free (info->mimetype);
+	g_free (info->shared_hash);
+	g_free (info->fingerprint);
 	g_slice_free (TrackerDecoratorInfo, info);
 }
 
@@ -198,8 +334,24 @@ hint_file_needed (GFile    *file,
 		return;
 
 	fd = tracker_file_open_fd (path);
-	posix_fadvise (fd, 0, 0,
-	               needed ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED);
+	if (fd == -1)
+		return;
+
+	if (needed) {
+		struct stat st;
+
+		posix_fadvise (fd, 0, PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+
+		if (fstat (fd, &st) == 0 && st.st_size > PREFETCH_SIZE) {
+			posix_fadvise (fd,
+			               MAX (PREFETCH_SIZE, st.st_size - PREFETCH_TAIL_SIZE),
+			               PREFETCH_TAIL_SIZE,
+			               POSIX_FADV_WILLNEED);
+		}
+	} else {
+		posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+	}
+
 	close (fd);
 #endif /* HAVE_POSIX_FADVISE */
 }
@@ -214,17 +366,57 @@ tracker_decorator_info_hint_needed (TrackerDecoratorInfo *info,
 	hint_file_needed (file, needed);
 }
 
+static void
+prefetch_files_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+	GPtrArray *files = task_data;
+	guint i;
+
+	for (i = 0; i < files->len; i++)
+		hint_file_needed (g_ptr_array_index (files, i), TRUE);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/* Asks the kernel to read ahead the next files in the queue while the
+ * current ones are being parsed. Opening files may block on network
+ * mounts, so this happens in a thread.
+ */
 static void
 decorator_hint_next_file_needed (TrackerDecorator *decorator)
 {
 	TrackerDecoratorPrivate *priv =
 		tracker_decorator_get_instance_private (decorator);
-	TrackerDecoratorInfo *next_info;
-	g_autoptr (GFile) file = NULL;
+	g_autoptr (GPtrArray) files = NULL;
+	g_autoptr (GTask) task = NULL;
+	GList *item;
+	guint i;
+
+	for (item = g_queue_peek_head_link (&priv->item_cache), i = 0;
+	     item && i < PREFETCH_AHEAD;
+	     item = item->next, i++) {
+		TrackerDecoratorInfo *info = item->data;
+
+		if (info->prefetched)
+			continue;
+
+		if (!files)
+			files = g_ptr_array_new_with_free_func (g_object_unref);
 
-	next_info = g_queue_peek_head (&priv->item_cache);
-	if (next_info)
-		tracker_decorator_info_hint_needed (next_info, TRUE);
+		g_ptr_array_add (files, g_file_new_for_uri (info->url));
+		info->prefetched = TRUE;
+	}
+
+	if (!files)
+		return;
+
+	task = g_task_new (decorator, NULL, NULL, NULL);
+	g_task_set_task_data (task, g_steal_pointer (&files),
+	                      (GDestroyNotify) g_ptr_array_unref);
+	g_task_run_in_thread (task, prefetch_files_thread);
 }
 
 static void
@@ -265,32 +457,114 @@ decorator_update_state (TrackerDecorator *decorator,
 }
 
 static void
-retry_synchronously (TrackerDecorator *decorator,
-                     GPtrArray        *commit_buffer)
+decorator_commit_done (TrackerDecorator *decorator)
+{
+	TrackerDecoratorPrivate *priv;
+
+	priv = tracker_decorator_get_instance_private (decorator);
+	priv->updating = FALSE;
+
+	g_clear_pointer (&priv->commit_buffer, g_ptr_array_unref);
+	return_waiters (priv->committing_waiters, NULL);
+
+	if (!decorator_check_commit (decorator))
+		decorator_cache_next_items (decorator);
+}
+
+static void decorator_retry_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data);
+
+/* Executes the next range of the commit buffer left to retry */
+static void
+decorator_retry_next_range (TrackerDecorator *decorator)
 {
 	TrackerSparqlConnection *sparql_conn;
+	TrackerDecoratorPrivate *priv;
+	TrackerBatch *batch;
+	CommitRange *range;
 	guint i;
 
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	if (priv->retry_ranges->len == 0) {
+		decorator_commit_done (decorator);
+		return;
+	}
+
+	range = &g_array_index (priv->retry_ranges, CommitRange, 0);
 	sparql_conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
+	batch = tracker_sparql_connection_create_batch (sparql_conn);
 
-	for (i = 0; i < commit_buffer->len; i++) {
-		g_autoptr (TrackerBatch) batch = NULL;
+	for (i = range->first; i < range->last; i++) {
 		TrackerExtractInfo *info;
-		g_autoptr (GError) error = NULL;
-
-		info = g_ptr_array_index (commit_buffer, i);
-		batch = tracker_sparql_connection_create_batch (sparql_conn);
 
+		info = g_ptr_array_index (priv->commit_buffer, i);
 		TRACKER_DECORATOR_GET_CLASS (decorator)->update (decorator, info, batch);
+	}
 
-		tracker_batch_execute (batch, NULL, &error);
+	tracker_batch_execute_async (batch,
+	                             priv->cancellable,
+	                             decorator_retry_cb,
+	                             decorator);
+	g_object_unref (batch);
+}
 
-		if (error) {
-			TRACKER_DECORATOR_GET_CLASS (decorator)->error (decorator,
-			                                                info,
-			                                                error->message);
-		}
+/* Splits a range of the commit buffer that failed in halves to be
+ * executed next, a single item that failed is reported.
+ */
+static void
+decorator_retry_failed_range (TrackerDecorator *decorator,
+                              CommitRange       range,
+                              const GError     *error)
+{
+	TrackerDecoratorPrivate *priv;
+	CommitRange first_half, second_half;
+
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	if (range.last - range.first <= 1) {
+		TrackerExtractInfo *info;
+
+		info = g_ptr_array_index (priv->commit_buffer, range.first);
+		TRACKER_DECORATOR_GET_CLASS (decorator)->error (decorator,
+		                                                info,
+		                                                error->message);
+		return;
 	}
+
+	first_half.first = range.first;
+	first_half.last = second_half.first = range.first + (range.last - range.first) / 2;
+	second_half.last = range.last;
+
+	g_array_prepend_val (priv->retry_ranges, second_half);
+	g_array_prepend_val (priv->retry_ranges, first_half);
+}
+
+static void
+decorator_retry_cb (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+	TrackerDecoratorPrivate *priv;
+	TrackerDecorator *decorator;
+	g_autoptr (GError) error = NULL;
+	CommitRange range;
+
+	if (!tracker_batch_execute_finish (TRACKER_BATCH (object), result, &error) &&
+	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	decorator = user_data;
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	range = g_array_index (priv->retry_ranges, CommitRange, 0);
+	g_array_remove_index (priv->retry_ranges, 0);
+
+	if (error)
+		decorator_retry_failed_range (decorator, range, error);
+
+	decorator_retry_next_range (decorator);
 }
 
 static void
@@ -303,32 +577,44 @@ decorator_commit_cb (GObject      *object,
 	TrackerBatch *batch;
 	g_autoptr (GError) error = NULL;
 
-	decorator = user_data;
-	priv = tracker_decorator_get_instance_private (decorator);
 	batch = TRACKER_BATCH (object);
 
-	priv->updating = FALSE;
-
 	if (!tracker_batch_execute_finish (batch, result, &error)) {
+		CommitRange range;
+
 		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			return;
 
-		g_debug ("SPARQL error detected in batch, retrying one by one");
-		retry_synchronously (decorator, priv->commit_buffer);
-	}
+		decorator = user_data;
+		priv = tracker_decorator_get_instance_private (decorator);
 
-	g_clear_pointer (&priv->commit_buffer, g_ptr_array_unref);
+		/* Find out the items making the batch fail, extraction
+		 * goes on into the SPARQL buffer meanwhile.
+		 */
+		g_debug ("SPARQL error detected in batch, retrying in smaller batches");
+		range.first = 0;
+		range.last = priv->commit_buffer->len;
+		decorator_retry_failed_range (decorator, range, error);
+		decorator_retry_next_range (decorator);
+		return;
+	}
 
-	if (!decorator_check_commit (decorator))
-		decorator_cache_next_items (decorator);
+	decorator = user_data;
+	priv = tracker_decorator_get_instance_private (decorator);
+	tracker_metrics_record (TRACKER_METRIC_COMMIT,
+	                        g_get_monotonic_time () - priv->commit_start_time);
+	decorator_commit_done (decorator);
 }
 
+TRACKER_TRACE_DEFINE (decorator_commit);
+
 static gboolean
 decorator_commit_info (TrackerDecorator *decorator)
 {
 	TrackerSparqlConnection *sparql_conn;
 	TrackerDecoratorPrivate *priv;
 	TrackerBatch *batch;
+	GPtrArray *waiters;
 	gint i;
 
 	priv = tracker_decorator_get_instance_private (decorator);
@@ -342,8 +628,16 @@ decorator_commit_info (TrackerDecorator *decorator)
 	/* Move sparql buffer to commit buffer */
 	priv->commit_buffer = priv->sparql_buffer;
 	priv->sparql_buffer = NULL;
+	g_array_set_size (priv->sparql_buffer_ids, 0);
 	priv->updating = TRUE;
 
+	/* No commit is executing, so no waiters are there */
+	waiters = priv->committing_waiters;
+	priv->committing_waiters = priv->buffered_waiters;
+	priv->buffered_waiters = waiters;
+
+	TRACKER_TRACE (decorator_commit, priv->commit_buffer->len);
+
 	sparql_conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
 	batch = tracker_sparql_connection_create_batch (sparql_conn);
 
@@ -354,6 +648,7 @@ decorator_commit_info (TrackerDecorator *decorator)
 		TRACKER_DECORATOR_GET_CLASS (decorator)->update (decorator, info, batch);
 	}
 
+	priv->commit_start_time = g_get_monotonic_time ();
 	tracker_batch_execute_async (batch,
 	                             priv->cancellable,
 	                             decorator_commit_cb,
@@ -371,8 +666,10 @@ decorator_check_commit (TrackerDecorator *decorator)
 
 	priv = tracker_decorator_get_instance_private (decorator);
 
+	/* Prioritized items are committed right away */
 	if (!priv->sparql_buffer ||
-	    (priv->n_remaining_items > 0 &&
+	    (priv->buffered_waiters->len == 0 &&
+	     (priv->n_remaining_items > 0 || priv->counting) &&
 	     priv->sparql_buffer->len < (guint) priv->batch_size))
 		return FALSE;
 
@@ -412,17 +709,67 @@ static void
 decorator_rebuild_cache (TrackerDecorator *decorator)
 {
 	TrackerDecoratorPrivate *priv;
+	GList *item, *next;
 
 	priv = tracker_decorator_get_instance_private (decorator);
 
 	priv->n_remaining_items = 0;
-	g_queue_foreach (&priv->item_cache,
-	                 (GFunc) tracker_decorator_info_unref, NULL);
-	g_queue_clear (&priv->item_cache);
+
+	/* Prioritized items stay at the head of the queue */
+	for (item = g_queue_peek_head_link (&priv->item_cache); item; item = next) {
+		TrackerDecoratorInfo *info = item->data;
+
+		next = item->next;
+
+		if (info->waiters)
+			continue;
+
+		g_queue_delete_link (&priv->item_cache, item);
+		tracker_decorator_info_unref (info);
+	}
 
 	decorator_cache_next_items (decorator);
 }
 
+/* Items may finish out of order if several of them are being
+ * processed at once, move the results to the SPARQL buffer in
+ * the order the items were handed out.
+ */
+static void
+decorator_flush_in_flight (TrackerDecorator *decorator)
+{
+	TrackerDecoratorPrivate *priv;
+	TrackerDecoratorInfo *info;
+
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	while ((info = g_queue_peek_head (&priv->in_flight)) != NULL &&
+	       info->done) {
+		g_queue_pop_head (&priv->in_flight);
+
+		if (info->extract_info && !info->discarded) {
+			if (!priv->sparql_buffer) {
+				priv->sparql_buffer =
+					g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_extract_info_unref);
+			}
+
+			g_ptr_array_add (priv->sparql_buffer,
+			                 g_steal_pointer (&info->extract_info));
+			g_array_append_val (priv->sparql_buffer_ids, info->id);
+
+			if (info->waiters) {
+				g_ptr_array_extend_and_steal (priv->buffered_waiters,
+				                              g_steal_pointer (&info->waiters));
+			}
+		} else if (info->waiters && !info->discarded) {
+			/* Nothing else will be extracted from this file */
+			return_waiters (info->waiters, NULL);
+		}
+
+		tracker_decorator_info_unref (info);
+	}
+}
+
 /* This function is called after the caller has completed the
  * GTask given on the TrackerDecoratorInfo, this definitely removes
  * the element being processed from queues.
@@ -444,25 +791,34 @@ decorator_task_done (GObject      *object,
 	tracker_decorator_info_hint_needed (info, FALSE);
 
 	if (!extract_info) {
-		if (error) {
+		if (error &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED)) {
 			g_warning ("Task for '%s' finished with error: %s\n",
 			           info->url, error->message);
-			g_error_free (error);
-		}
-	} else {
-		if (!priv->sparql_buffer) {
-			priv->sparql_buffer =
-				g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_extract_info_unref);
 		}
 
-		g_ptr_array_add (priv->sparql_buffer, extract_info);
+		g_clear_error (&error);
 	}
 
+	info->extract_info = extract_info;
+	info->done = TRUE;
+	decorator_flush_in_flight (decorator);
+
+	if (priv->buffered_waiters->len > 0)
+		decorator_commit_info (decorator);
+
 	if (priv->n_remaining_items > 0)
 		priv->n_remaining_items--;
 	priv->n_processed_items++;
 
-	if (priv->n_remaining_items == 0) {
+	/* Items may show up without a change event saying so, e.g.
+	 * files that need extracting again.
+	 */
+	priv->n_remaining_items = MAX (priv->n_remaining_items,
+	                               (gssize) g_queue_get_length (&priv->item_cache));
+
+	if (priv->n_remaining_items == 0 && !priv->counting) {
 		decorator_finish (decorator);
 		if (!priv->updating)
 			decorator_rebuild_cache (decorator);
@@ -476,14 +832,18 @@ static TrackerSparqlStatement *
 load_statement (TrackerDecorator *decorator,
                 const gchar      *query_filename)
 {
+	TrackerDecoratorPrivate *priv;
 	g_autofree gchar *resource_path = NULL;
 	TrackerSparqlConnection *conn;
 
+	priv = tracker_decorator_get_instance_private (decorator);
 	resource_path =
 		g_strconcat ("/org/freedesktop/Tracker3/Extract/queries/",
 		             query_filename, NULL);
 
-	conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
+	conn = priv->query_conn;
+	if (!conn)
+		conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
 
 	return tracker_sparql_connection_load_statement_from_gresource (conn,
 	                                                                resource_path,
@@ -504,6 +864,12 @@ decorator_count_remaining_items_cb (GObject      *object,
 	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
 	                                                  result, &error);
 
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	priv = tracker_decorator_get_instance_private (decorator);
+	priv->counting = FALSE;
+
 	if (error) {
 		g_warning ("Could not get remaining item count: %s", error->message);
 		return;
@@ -512,17 +878,22 @@ decorator_count_remaining_items_cb (GObject      *object,
 	if (!tracker_sparql_cursor_next (cursor, NULL, NULL))
 		return;
 
-	priv = tracker_decorator_get_instance_private (decorator);
-	priv->querying = FALSE;
-
-	priv->n_remaining_items = tracker_sparql_cursor_get_integer (cursor, 0);
+	/* Items might have been processed while counting, the count is
+	 * just an estimate for progress reporting anyway.
+	 */
+	priv->n_remaining_items =
+		MAX (tracker_sparql_cursor_get_integer (cursor, 0) -
+		     (priv->n_processed_items - priv->n_processed_before_count), 0);
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Found %" G_GSIZE_FORMAT " items to extract", priv->n_remaining_items));
 
-	if (priv->n_remaining_items > 0)
-		decorator_cache_next_items (decorator);
-	else
+	if (priv->n_remaining_items == 0 &&
+	    !priv->querying &&
+	    g_queue_is_empty (&priv->item_cache) &&
+	    g_queue_is_empty (&priv->in_flight))
 		decorator_finish (decorator);
+	else
+		decorator_update_state (decorator, NULL, TRUE);
 }
 
 static void
@@ -535,18 +906,40 @@ decorator_count_remaining_items (TrackerDecorator *decorator)
 	if (!priv->item_count_query)
 		priv->item_count_query = load_statement (decorator, "get-item-count.rq");
 
+	tracker_sparql_statement_bind_int (priv->item_count_query,
+	                                   "partition", priv->partition);
+	tracker_sparql_statement_bind_int (priv->item_count_query,
+	                                   "nPartitions", priv->n_partitions);
+
 	tracker_sparql_statement_execute_async (priv->item_count_query,
 	                                        priv->cancellable,
 	                                        decorator_count_remaining_items_cb,
 	                                        decorator);
 }
 
+static TrackerDecoratorInfo *
+decorator_find_item (GQueue *queue,
+                     gint    id)
+{
+	GList *item;
+
+	for (item = g_queue_peek_head_link (queue); item; item = item->next) {
+		TrackerDecoratorInfo *info = item->data;
+
+		if (info->id == id)
+			return info;
+	}
+
+	return NULL;
+}
+
 static void
 decorator_item_cache_remove (TrackerDecorator *decorator,
                              gint              id)
 {
 	TrackerDecoratorPrivate *priv;
 	GList *item;
+	guint i;
 
 	priv = tracker_decorator_get_instance_private (decorator);
 
@@ -559,25 +952,80 @@ decorator_item_cache_remove (TrackerDecorator *decorator,
 
 		g_queue_remove (&priv->item_cache, info);
 		tracker_decorator_info_unref (info);
-		break;
+
+		if (priv->n_remaining_items > 0)
+			priv->n_remaining_items--;
+		return;
+	}
+
+	/* The item might be already being processed, cancel it so
+	 * its results are not committed. Finished items may still be
+	 * waiting for earlier ones to be flushed.
+	 */
+	for (item = g_queue_peek_head_link (&priv->in_flight);
+	     item; item = item->next) {
+		TrackerDecoratorInfo *info = item->data;
+
+		if (info->id != id)
+			continue;
+
+		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Cancelling in flight item %s", info->url));
+		info->discarded = TRUE;
+		g_cancellable_cancel (info->cancellable);
+		return;
+	}
+
+	/* Or its results be waiting for the next commit */
+	for (i = 0; i < priv->sparql_buffer_ids->len; i++) {
+		if (g_array_index (priv->sparql_buffer_ids, gint, i) != id)
+			continue;
+
+		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Dropping extracted data of deleted item %d", id));
+		g_ptr_array_remove_index (priv->sparql_buffer, i);
+		g_array_remove_index (priv->sparql_buffer_ids, i);
+		return;
 	}
 }
 
+/* Items are paginated by ID, which roughly follows the order files
+ * were found in, across all indexed folders. Sorting each page by URL
+ * keeps files in the same filesystem and folder together, so reads
+ * on rotational or slow removable media do not jump back and forth.
+ */
+static gint
+compare_items (gconstpointer a,
+               gconstpointer b,
+               gpointer      user_data)
+{
+	const TrackerDecoratorInfo *info_a = a, *info_b = b;
+
+	if (!!info_a->waiters != !!info_b->waiters)
+		return info_a->waiters ? -1 : 1;
+
+	if (info_a->priority != info_b->priority)
+		return info_a->priority ? -1 : 1;
+
+	return strcmp (info_a->url, info_b->url);
+}
+
 static void
 decorator_cache_items_cb (GObject      *object,
                           GAsyncResult *result,
                           gpointer      user_data)
 {
 	TrackerDecorator *decorator = user_data;
+	TrackerDecoratorClass *decorator_class;
 	TrackerDecoratorPrivate *priv;
 	g_autoptr (TrackerSparqlCursor) cursor = NULL;
 	TrackerDecoratorInfo *info;
 	g_autoptr (GError) error = NULL;
 	gboolean queue_was_empty;
+	guint n_rows = 0, n_added = 0;
 
 	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
 	                                                  result, &error);
 	priv = tracker_decorator_get_instance_private (decorator);
+	decorator_class = TRACKER_DECORATOR_GET_CLASS (decorator);
 	priv->querying = FALSE;
 
 	decorator_commit_info (decorator);
@@ -589,11 +1037,54 @@ decorator_cache_items_cb (GObject      *object,
 		return;
 	} else {
 		while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+			gint64 id;
+
+			id = tracker_sparql_cursor_get_integer (cursor, 1);
+			n_rows++;
+
+			if (tracker_sparql_cursor_get_integer (cursor, 3) != 0)
+				priv->last_high_id = MAX (priv->last_high_id, id);
+			else
+				priv->last_low_id = MAX (priv->last_low_id, id);
+
+			/* Prioritized items may be already queued */
+			if (decorator_find_item (&priv->item_cache, id) ||
+			    decorator_find_item (&priv->in_flight, id))
+				continue;
+
+			if (decorator_class->defer_item &&
+			    decorator_class->defer_item (decorator,
+			                                 tracker_sparql_cursor_get_string (cursor, 4, NULL))) {
+				priv->n_deferred++;
+				continue;
+			}
+
 			info = tracker_decorator_info_new (decorator, cursor);
 			g_queue_push_tail (&priv->item_cache, info);
+			n_added++;
 		}
+
+		g_queue_sort (&priv->item_cache, compare_items, NULL);
+	}
+
+	/* A full page of deferred items, there may be more to do after it */
+	if (n_added == 0 && n_rows >= QUERY_BATCH_SIZE &&
+	    g_queue_is_empty (&priv->item_cache) && !priv->updating) {
+		priv->querying = TRUE;
+		decorator_query_next_items (decorator);
+		return;
+	}
+
+	if (priv->n_deferred > 0 && n_rows < QUERY_BATCH_SIZE) {
+		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] %u items deferred to a later pass",
+		                                    priv->n_deferred));
 	}
 
+	/* Nothing left in this pass, whatever the estimate said */
+	if (g_queue_is_empty (&priv->item_cache) &&
+	    g_queue_is_empty (&priv->in_flight))
+		priv->n_remaining_items = 0;
+
 	if (!g_queue_is_empty (&priv->item_cache) && !priv->processing) {
 		decorator_start (decorator);
 	} else if (g_queue_is_empty (&priv->item_cache) && priv->processing) {
@@ -605,61 +1096,105 @@ decorator_cache_items_cb (GObject      *object,
 }
 
 static void
-bind_graph_limits (TrackerDecorator *decorator,
-                   gboolean          priority)
+bind_priorities (TrackerDecorator *decorator)
 {
 	TrackerDecoratorPrivate *priv;
-	const gchar *graphs[][3] = {
-		{ "tracker:Audio", "audioHigh", "audioLow" },
-		{ "tracker:Pictures", "picturesHigh", "picturesLow" },
-		{ "tracker:Video", "videoHigh", "videoLow" },
-		{ "tracker:Software", "softwareHigh", "softwareLow" },
-		{ "tracker:Documents", "documentsHigh", "documentsLow" },
+	const gchar *graphs[][2] = {
+		{ "tracker:Audio", "audioPriority" },
+		{ "tracker:Pictures", "picturesPriority" },
+		{ "tracker:Video", "videoPriority" },
+		{ "tracker:Software", "softwarePriority" },
+		{ "tracker:Documents", "documentsPriority" },
 	};
 	guint i;
 
 	priv = tracker_decorator_get_instance_private (decorator);
 
 	for (i = 0; i < G_N_ELEMENTS (graphs); i++) {
-		const gchar *graph = graphs[i][0];
-		const gchar *high_limit = graphs[i][1];
-		const gchar *low_limit = graphs[i][2];
 		gboolean is_priority;
 
 		is_priority = priv->priority_graphs &&
-			g_strv_contains ((const gchar * const *) priv->priority_graphs, graph);
+			g_strv_contains ((const gchar * const *) priv->priority_graphs, graphs[i][0]);
 
-		/* Graphs with high priority get unbound high limit and 0 low limit,
-		 * graphs with regular priority get the opposite.
-		 */
-		tracker_sparql_statement_bind_int (priv->remaining_items_query,
-		                                   high_limit,
-		                                   is_priority ? -1 : 0);
 		tracker_sparql_statement_bind_int (priv->remaining_items_query,
-		                                   low_limit,
-		                                   is_priority ? 0 : -1);
+		                                   graphs[i][1],
+		                                   is_priority ? 1 : 0);
 	}
+
+	if (!priv->recent_date) {
+		g_autoptr (GDateTime) now = NULL;
+
+		now = g_date_time_new_now_utc ();
+		priv->recent_date = g_date_time_add_days (now, -RECENT_DAYS);
+	}
+
+	tracker_sparql_statement_bind_datetime (priv->remaining_items_query,
+	                                        "recentDate", priv->recent_date);
+	tracker_sparql_statement_bind_string (priv->remaining_items_query,
+	                                      "visiblePattern", priv->visible_pattern);
+}
+
+/* Matches the URIs of files in the folders users look at the most */
+static gchar *
+build_visible_pattern (void)
+{
+	const GUserDirectory dirs[] = {
+		G_USER_DIRECTORY_DESKTOP,
+		G_USER_DIRECTORY_DOCUMENTS,
+		G_USER_DIRECTORY_DOWNLOAD,
+	};
+	GString *str;
+	guint i;
+
+	str = g_string_new (NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (dirs); i++) {
+		g_autoptr (GFile) file = NULL;
+		g_autofree gchar *uri = NULL, *escaped = NULL;
+		const gchar *path;
+
+		/* Unset folders fall back to $HOME */
+		path = g_get_user_special_dir (dirs[i]);
+		if (!path || g_strcmp0 (path, g_get_home_dir ()) == 0)
+			continue;
+
+		file = g_file_new_for_path (path);
+		uri = g_file_get_uri (file);
+		escaped = g_regex_escape_string (uri, -1);
+
+		if (str->len > 0)
+			g_string_append_c (str, '|');
+		g_string_append_printf (str, "^%s/", escaped);
+	}
+
+	/* Matches no URI */
+	if (str->len == 0)
+		g_string_append (str, "^$");
+
+	return g_string_free (str, FALSE);
 }
 
 static void
 decorator_query_next_items (TrackerDecorator *decorator)
 {
 	TrackerDecoratorPrivate *priv;
-	gint offset = 0;
 
 	priv = tracker_decorator_get_instance_private (decorator);
 
-	if (priv->sparql_buffer)
-		offset += priv->sparql_buffer->len;
-	if (priv->commit_buffer)
-		offset += priv->commit_buffer->len;
-
 	if (!priv->remaining_items_query)
 		priv->remaining_items_query = load_statement (decorator, "get-items.rq");
 
-	bind_graph_limits (decorator, TRUE);
+	bind_priorities (decorator);
+	tracker_sparql_statement_bind_int (priv->remaining_items_query,
+	                                   "lastHighId", priv->last_high_id);
+	tracker_sparql_statement_bind_int (priv->remaining_items_query,
+	                                   "lastLowId", priv->last_low_id);
+	tracker_sparql_statement_bind_int (priv->remaining_items_query,
+	                                   "partition", priv->partition);
 	tracker_sparql_statement_bind_int (priv->remaining_items_query,
-	                                   "offset", offset);
+	                                   "nPartitions", priv->n_partitions);
+	tracker_sparql_statement_bind_int (priv->remaining_items_query,
+	                                   "minDuplicateSize", DUPLICATE_MIN_SIZE);
 	tracker_sparql_statement_bind_int (priv->remaining_items_query,
 	                                   "limit", QUERY_BATCH_SIZE);
 
@@ -683,13 +1218,29 @@ decorator_cache_next_items (TrackerDecorator *decorator)
 
 	priv->querying = TRUE;
 
-	if (priv->n_remaining_items == 0) {
-		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Counting items which still need processing"));
-		decorator_count_remaining_items (decorator);
-	} else {
-		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Querying items which still need processing"));
-		decorator_query_next_items (decorator);
+	if (priv->n_remaining_items == 0 && !priv->counting) {
+		gint64 now = g_get_monotonic_time ();
+
+		/* Start over, so items updated since the last pass are found */
+		priv->last_high_id = priv->last_low_id = 0;
+		priv->n_deferred = 0;
+		g_clear_pointer (&priv->recent_date, g_date_time_unref);
+
+		/* The count is only used for progress reporting, don't
+		 * wait for it to start processing the first items.
+		 */
+		if (priv->last_count_time == 0 ||
+		    now - priv->last_count_time > RECOUNT_INTERVAL) {
+			TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Counting items which still need processing"));
+			priv->counting = TRUE;
+			priv->last_count_time = now;
+			priv->n_processed_before_count = priv->n_processed_items;
+			decorator_count_remaining_items (decorator);
+		}
 	}
+
+	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Querying items which still need processing"));
+	decorator_query_next_items (decorator);
 }
 
 static void
@@ -752,6 +1303,15 @@ notifier_events_cb (TrackerDecorator *decorator,
 
 		switch (tracker_notifier_event_get_event_type (event)) {
 		case TRACKER_NOTIFIER_EVENT_CREATE:
+			/* Files added to a graph other than the filesystem
+			 * one are pending extraction. The full count will
+			 * include them if it is underway.
+			 */
+			if (!priv->counting &&
+			    g_strcmp0 (graph, TRACKER_PREFIX_TRACKER "FileSystem") != 0 &&
+			    id % priv->n_partitions == priv->partition)
+				priv->n_remaining_items++;
+			/* Fall through */
 		case TRACKER_NOTIFIER_EVENT_UPDATE:
 			/* Merely use this as a hint that there is something
 			 * left to be processed.
@@ -800,7 +1360,10 @@ tracker_decorator_finalize (GObject *object)
 
 	g_clear_object (&priv->remaining_items_query);
 	g_clear_object (&priv->item_count_query);
+	g_clear_object (&priv->query_conn);
 	g_strfreev (priv->priority_graphs);
+	g_clear_pointer (&priv->recent_date, g_date_time_unref);
+	g_free (priv->visible_pattern);
 
 	g_cancellable_cancel (priv->cancellable);
 	g_clear_object (&priv->cancellable);
@@ -815,8 +1378,17 @@ tracker_decorator_finalize (GObject *object)
 	                 NULL);
 	g_queue_clear (&priv->item_cache);
 
+	g_queue_foreach (&priv->in_flight,
+	                 (GFunc) tracker_decorator_info_unref,
+	                 NULL);
+	g_queue_clear (&priv->in_flight);
+
 	g_clear_pointer (&priv->sparql_buffer, g_ptr_array_unref);
+	g_clear_pointer (&priv->sparql_buffer_ids, g_array_unref);
 	g_clear_pointer (&priv->commit_buffer, g_ptr_array_unref);
+	g_array_unref (priv->retry_ranges);
+	g_ptr_array_unref (priv->buffered_waiters);
+	g_ptr_array_unref (priv->committing_waiters);
 	g_timer_destroy (priv->timer);
 
 	G_OBJECT_CLASS (tracker_decorator_parent_class)->finalize (object);
@@ -937,10 +1509,12 @@ tracker_decorator_class_init (TrackerDecoratorClass *klass)
 		              G_OBJECT_CLASS_TYPE (object_class),
 		              G_SIGNAL_RUN_LAST,
 		              0, NULL, NULL, NULL,
-		              G_TYPE_NONE, 3,
+		              G_TYPE_NONE, 5,
 			      G_TYPE_FILE,
 			      G_TYPE_STRING,
-			      G_TYPE_STRING);
+			      G_TYPE_STRING,
+			      G_TYPE_STRING,
+			      G_TYPE_BOOLEAN);
 }
 
 static void
@@ -950,11 +1524,19 @@ tracker_decorator_init (TrackerDecorator *decorator)
 
 	priv = tracker_decorator_get_instance_private (decorator);
 	priv->batch_size = DEFAULT_BATCH_SIZE;
+	priv->n_partitions = 1;
+	priv->visible_pattern = build_visible_pattern ();
 	priv->timer = g_timer_new ();
 	priv->cancellable = g_cancellable_new ();
 	priv->task_cancellable = g_cancellable_new ();
 
 	g_queue_init (&priv->item_cache);
+	g_queue_init (&priv->in_flight);
+
+	priv->sparql_buffer_ids = g_array_new (FALSE, FALSE, sizeof (gint));
+	priv->retry_ranges = g_array_new (FALSE, FALSE, sizeof (CommitRange));
+	priv->buffered_waiters = g_ptr_array_new_with_free_func (g_object_unref);
+	priv->committing_waiters = g_ptr_array_new_with_free_func (g_object_unref);
 }
 
 /**
@@ -1005,6 +1587,8 @@ tracker_decorator_next (TrackerDecorator  *decorator,
 	if (!info)
 		return NULL;
 
+	g_queue_push_tail (&priv->in_flight, tracker_decorator_info_ref (info));
+
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Next item %s", info->url));
 	decorator_hint_next_file_needed (decorator);
 
@@ -1024,6 +1608,67 @@ tracker_decorator_set_priority_graphs (TrackerDecorator    *decorator,
 	decorator_rebuild_cache (decorator);
 }
 
+/**
+ * tracker_decorator_set_query_connection:
+ * @decorator: a #TrackerDecorator
+ * @connection: (nullable): a #TrackerSparqlConnection
+ *
+ * Makes @decorator look up the items to extract through @connection,
+ * e.g. a read-only connection to the miner database, instead of
+ * querying the miner. Updates are still sent to the miner. Passing
+ * %NULL goes back to querying the miner.
+ **/
+void
+tracker_decorator_set_query_connection (TrackerDecorator        *decorator,
+                                        TrackerSparqlConnection *connection)
+{
+	TrackerDecoratorPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_DECORATOR (decorator));
+	g_return_if_fail (!connection || TRACKER_IS_SPARQL_CONNECTION (connection));
+
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	if (!g_set_object (&priv->query_conn, connection))
+		return;
+
+	/* Statements are loaded again on the new connection */
+	g_clear_object (&priv->remaining_items_query);
+	g_clear_object (&priv->item_count_query);
+}
+
+/**
+ * tracker_decorator_set_partition:
+ * @decorator: a #TrackerDecorator
+ * @partition: partition handled by this decorator
+ * @n_partitions: total number of partitions
+ *
+ * Restricts @decorator to the items whose tracker:id modulo
+ * @n_partitions equals @partition, so that several processes
+ * may extract disjoint sets of files at the same time.
+ **/
+void
+tracker_decorator_set_partition (TrackerDecorator *decorator,
+                                 guint             partition,
+                                 guint             n_partitions)
+{
+	TrackerDecoratorPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_DECORATOR (decorator));
+	g_return_if_fail (n_partitions > 0);
+	g_return_if_fail (partition < n_partitions);
+
+	priv = tracker_decorator_get_instance_private (decorator);
+
+	if (priv->partition == partition &&
+	    priv->n_partitions == n_partitions)
+		return;
+
+	priv->partition = partition;
+	priv->n_partitions = n_partitions;
+	decorator_rebuild_cache (decorator);
+}
+
 /**
  * tracker_decorator_info_get_url:
  * @info: a #TrackerDecoratorInfo.
@@ -1049,6 +1694,45 @@ tracker_decorator_info_get_content_id (TrackerDecoratorInfo *info)
 	return info->content_id;
 }
 
+const gchar *
+tracker_decorator_info_get_mimetype (TrackerDecoratorInfo *info)
+{
+	g_return_val_if_fail (info != NULL, NULL);
+	return info->mimetype;
+}
+
+/**
+ * tracker_decorator_info_get_shared_hash:
+ * @info: a #TrackerDecoratorInfo
+ *
+ * Returns the extractor hash of another file with the same content
+ * ID, e.g. a hardlink, if that was already extracted.
+ *
+ * Returns: (nullable): the extractor hash the content was extracted with
+ **/
+const gchar *
+tracker_decorator_info_get_shared_hash (TrackerDecoratorInfo *info)
+{
+	g_return_val_if_fail (info != NULL, NULL);
+	return info->shared_hash;
+}
+
+/**
+ * tracker_decorator_info_get_fingerprint:
+ * @info: a #TrackerDecoratorInfo
+ *
+ * Returns the content fingerprint of the file, if it is big enough
+ * for copies of it to be looked up among the extracted files.
+ *
+ * Returns: (nullable): the content fingerprint
+ **/
+const gchar *
+tracker_decorator_info_get_fingerprint (TrackerDecoratorInfo *info)
+{
+	g_return_val_if_fail (info != NULL, NULL);
+	return info->fingerprint;
+}
+
 GCancellable *
 tracker_decorator_info_get_cancellable (TrackerDecoratorInfo *info)
 {
@@ -1056,6 +1740,24 @@ tracker_decorator_info_get_cancellable (TrackerDecoratorInfo *info)
 	return g_task_get_cancellable (info->task);
 }
 
+/**
+ * tracker_decorator_info_is_discarded:
+ * @info: a #TrackerDecoratorInfo
+ *
+ * Returns whether the item was cancelled individually, e.g. because
+ * the file was deleted while being processed. Unlike the cancellation
+ * of all items when the decorator is paused, the results of this item
+ * will simply be ignored.
+ *
+ * Returns: %TRUE if the item results are no longer wanted.
+ **/
+gboolean
+tracker_decorator_info_is_discarded (TrackerDecoratorInfo *info)
+{
+	g_return_val_if_fail (info != NULL, FALSE);
+	return info->discarded;
+}
+
 /**
  * tracker_decorator_info_complete:
  * @info: a #TrackerDecoratorInfo
@@ -1094,6 +1796,143 @@ tracker_decorator_info_complete_error (TrackerDecoratorInfo *info,
 	g_task_return_error (info->task, error);
 }
 
+static void
+decorator_add_waiter (TrackerDecoratorInfo *info,
+                      GTask                *task)
+{
+	if (!info->waiters)
+		info->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+
+	g_ptr_array_add (info->waiters, task);
+}
+
+static void
+prioritize_item_cb (GObject      *object,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+	g_autoptr (GTask) task = user_data;
+	TrackerDecorator *decorator = g_task_get_source_object (task);
+	TrackerDecoratorPrivate *priv;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	TrackerDecoratorInfo *info;
+	g_autoptr (GError) error = NULL;
+	gboolean queue_was_empty;
+
+	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                  result, &error);
+	if (!cursor) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* Already extracted, or handled by another partition */
+	if (!tracker_sparql_cursor_next (cursor, NULL, &error)) {
+		if (error)
+			g_task_return_error (task, g_steal_pointer (&error));
+		else
+			g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	priv = tracker_decorator_get_instance_private (decorator);
+	queue_was_empty = g_queue_is_empty (&priv->item_cache);
+
+	info = decorator_find_item (&priv->in_flight,
+	                            tracker_sparql_cursor_get_integer (cursor, 1));
+	if (info) {
+		/* Being extracted, wait for it to be committed */
+		decorator_add_waiter (info, g_steal_pointer (&task));
+		return;
+	}
+
+	info = decorator_find_item (&priv->item_cache,
+	                            tracker_sparql_cursor_get_integer (cursor, 1));
+	if (info) {
+		g_queue_remove (&priv->item_cache, info);
+	} else {
+		info = tracker_decorator_info_new (decorator, cursor);
+		priv->n_remaining_items++;
+	}
+
+	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Prioritizing item %s", info->url));
+	decorator_add_waiter (info, g_steal_pointer (&task));
+	g_queue_push_head (&priv->item_cache, info);
+
+	if (!priv->processing) {
+		decorator_start (decorator);
+	} else if (queue_was_empty) {
+		decorator_hint_next_file_needed (decorator);
+		g_signal_emit (decorator, signals[ITEMS_AVAILABLE], 0);
+	}
+}
+
+/**
+ * tracker_decorator_prioritize_file_async:
+ * @decorator: a #TrackerDecorator
+ * @url: URL of the file
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: callback to call when the file was handled
+ * @user_data: data for @callback
+ *
+ * Moves the file at @url ahead of all other items waiting for
+ * extraction, and commits its results as soon as they are available.
+ * @callback is called once the extracted metadata is in the store,
+ * or right away if @url is not pending extraction by @decorator.
+ **/
+void
+tracker_decorator_prioritize_file_async (TrackerDecorator    *decorator,
+                                         const gchar         *url,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data)
+{
+	TrackerDecoratorPrivate *priv;
+	TrackerSparqlStatement *stmt;
+	GTask *task;
+
+	g_return_if_fail (TRACKER_IS_DECORATOR (decorator));
+	g_return_if_fail (url != NULL);
+
+	priv = tracker_decorator_get_instance_private (decorator);
+	task = g_task_new (decorator, cancellable, callback, user_data);
+
+	/* Requests may overlap, each gets its own statement */
+	stmt = load_statement (decorator, "get-item.rq");
+	g_task_set_task_data (task, stmt, g_object_unref);
+
+	tracker_sparql_statement_bind_string (stmt, "url", url);
+	tracker_sparql_statement_bind_int (stmt, "partition", priv->partition);
+	tracker_sparql_statement_bind_int (stmt, "nPartitions", priv->n_partitions);
+	tracker_sparql_statement_bind_int (stmt, "minDuplicateSize", DUPLICATE_MIN_SIZE);
+
+	tracker_sparql_statement_execute_async (stmt,
+	                                        cancellable,
+	                                        prioritize_item_cb,
+	                                        task);
+}
+
+/**
+ * tracker_decorator_prioritize_file_finish:
+ * @decorator: a #TrackerDecorator
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes an operation started with
+ * tracker_decorator_prioritize_file_async().
+ *
+ * Returns: %TRUE if nothing is left to extract from the file.
+ **/
+gboolean
+tracker_decorator_prioritize_file_finish (TrackerDecorator  *decorator,
+                                          GAsyncResult      *result,
+                                          GError           **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, decorator), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 void
 tracker_decorator_invalidate_cache (TrackerDecorator *decorator)
 {
@@ -56,6 +56,8 @@ struct _TrackerDecorator {
  * @parent_class: parent object class.
  * @items_available: Called when there are resources to be processed.
  * @finished: Called when all resources have been processed.
+ * @defer_item: Called on every resource found by a pass, returning
+ *   %TRUE leaves the resource for a later pass.
  * @padding: Reserved for future API improvements.
  *
  * An implementation that takes care of extracting extra metadata
@@ -76,6 +78,9 @@ struct _TrackerDecoratorClass {
 	void (* update) (TrackerDecorator   *decorator,
 	                 TrackerExtractInfo *extract_info,
 	                 TrackerBatch       *batch);
+
+	gboolean (* defer_item) (TrackerDecorator *decorator,
+	                         const gchar      *mimetype);
 };
 
 #define TRACKER_DECORATOR_ERROR (tracker_decorator_error_quark ())
@@ -96,8 +101,24 @@ TrackerDecoratorInfo * tracker_decorator_next (TrackerDecorator  *decorator,
 void          tracker_decorator_set_priority_graphs (TrackerDecorator    *decorator,
                                                      const gchar * const *graphs);
 
+void          tracker_decorator_set_partition     (TrackerDecorator     *decorator,
+                                                   guint                 partition,
+                                                   guint                 n_partitions);
+
+void          tracker_decorator_set_query_connection (TrackerDecorator        *decorator,
+                                                      TrackerSparqlConnection *connection);
+
 void tracker_decorator_invalidate_cache (TrackerDecorator *decorator);
 
+void          tracker_decorator_prioritize_file_async  (TrackerDecorator    *decorator,
+                                                        const gchar         *url,
+                                                        GCancellable        *cancellable,
+                                                        GAsyncReadyCallback  callback,
+                                                        gpointer             user_data);
+gboolean      tracker_decorator_prioritize_file_finish (TrackerDecorator  *decorator,
+                                                        GAsyncResult      *result,
+                                                        GError           **error);
+
 GType         tracker_decorator_info_get_type     (void) G_GNUC_CONST;
 
 TrackerDecoratorInfo *
@@ -105,7 +126,11 @@ TrackerDecoratorInfo *
 void          tracker_decorator_info_unref        (TrackerDecoratorInfo *info);
 const gchar * tracker_decorator_info_get_url      (TrackerDecoratorInfo *info);
 const gchar * tracker_decorator_info_get_content_id (TrackerDecoratorInfo *info);
+const gchar * tracker_decorator_info_get_mimetype (TrackerDecoratorInfo *info);
+const gchar * tracker_decorator_info_get_shared_hash (TrackerDecoratorInfo *info);
+const gchar * tracker_decorator_info_get_fingerprint (TrackerDecoratorInfo *info);
 GCancellable * tracker_decorator_info_get_cancellable (TrackerDecoratorInfo *info);
+gboolean      tracker_decorator_info_is_discarded (TrackerDecoratorInfo *info);
 void          tracker_decorator_info_complete     (TrackerDecoratorInfo *info,
                                                    TrackerExtractInfo   *extract_info);
 void          tracker_decorator_info_complete_error (TrackerDecoratorInfo *info,
@@ -48,7 +48,7 @@ typedef enum {
 
 struct AbwParserData {
 	TrackerResource *resource;
-	GString *content;
+	TrackerTextSink *content;
 	gchar *uri;
 
 	guint cur_tag;
@@ -161,11 +161,8 @@ abw_parser_text (GMarkupParseContext *context,
 	}
 
 	if (data->in_text) {
-		if (G_UNLIKELY (!data->content)) {
-			data->content = g_string_new ("");
-		}
-
-		g_string_append_len (data->content, text, text_len);
+		/* Stops parsing once full */
+		tracker_text_sink_append (data->content, text, text_len, error);
 	}
 
 	data->cur_tag = ABW_PARSER_TAG_UNHANDLED;
@@ -249,21 +246,24 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 
 		tracker_resource_add_uri (data.resource, "rdf:type", "nfo:Document");
 
+		data.content = tracker_text_sink_new (tracker_extract_info_get_max_text (info));
+
 		context = g_markup_parse_context_new (&parser, 0, &data, NULL);
 		g_markup_parse_context_parse (context, contents, len, &error);
 
-		if (error) {
+		if (error &&
+		    !g_error_matches (error, TRACKER_TEXT_SINK_ERROR, TRACKER_TEXT_SINK_ERROR_FULL)) {
 			g_warning ("Could not parse abw file: %s\n", error->message);
-			g_error_free (error);
 		} else {
-			if (data.content) {
-				tracker_resource_set_string (data.resource, "nie:plainTextContent", data.content->str);
-				g_string_free (data.content, TRUE);
-			}
+			tracker_extract_info_take_text (info,
+			                                tracker_text_sink_steal_text (data.content));
 
 			retval = TRUE;
 		}
 
+		g_clear_error (&error);
+		tracker_text_sink_free (data.content);
+
 		g_markup_parse_context_free (context);
 		g_free (data.uri);
 
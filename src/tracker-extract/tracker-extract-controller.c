@@ -52,6 +52,12 @@ static const gchar *introspection_xml =
 	"    <signal name='Error'>"
 	"      <arg type='a{sv}' name='data' direction='out' />"
 	"    </signal>"
+	"    <method name='GetMetrics'>"
+	"      <arg type='a(stta(ut))' name='metrics' direction='out' />"
+	"    </method>"
+	"    <method name='ExtractFile'>"
+	"      <arg type='s' name='uri' direction='in' />"
+	"    </method>"
 	"  </interface>"
 	"</node>";
 
@@ -112,6 +118,89 @@ update_extract_config (TrackerExtractController *controller,
 				tracker_extract_set_max_text (extract, max_bytes);
 				g_object_unref (extract);
 			}
+		} else if (g_strcmp0 (key, "text-limits") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE ("a{si}"))) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_text_limits (extract, value);
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "text-tail-bytes") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_text_tail (extract,
+				                               g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "max-list-entries") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_max_list_entries (extract,
+				                                      g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "media-probe-size") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_media_probe_size (extract,
+				                                      g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "media-analyze-duration") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_media_analyze_duration (extract,
+				                                            g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "module-idle-timeout") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_module_idle_timeout (extract,
+				                                         g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "max-workers") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			TrackerExtract *extract = NULL;
+
+			g_object_get (priv->decorator, "extractor", &extract, NULL);
+
+			if (extract) {
+				tracker_extract_set_max_workers (extract,
+				                                 g_variant_get_int32 (value));
+				g_object_unref (extract);
+			}
+		} else if (g_strcmp0 (key, "max-remote-bandwidth") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			tracker_extract_decorator_set_max_remote_bandwidth (TRACKER_EXTRACT_DECORATOR (priv->decorator),
+			                                                    g_variant_get_int32 (value));
+		} else if (g_strcmp0 (key, "indexing-cpus") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+			tracker_sched_set_affinity (g_variant_get_string (value, NULL));
 		} else if (g_strcmp0 (key, "on-battery") == 0 &&
 		           g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
 			tracker_extract_decorator_set_throttled (TRACKER_EXTRACT_DECORATOR (priv->decorator),
@@ -119,6 +208,10 @@ update_extract_config (TrackerExtractController *controller,
 		} else if (g_strcmp0 (key, "on-low-battery") == 0 &&
 		           g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
 			update_paused_state (controller, g_variant_get_boolean (value));
+		} else if (g_strcmp0 (key, "defer-expensive") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
+			tracker_extract_decorator_set_defer_expensive (TRACKER_EXTRACT_DECORATOR (priv->decorator),
+			                                               g_variant_get_boolean (value));
 		} else if (g_strcmp0 (key, "priority-graphs") == 0 &&
 		           g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY)) {
 			const gchar **graphs = NULL;
@@ -126,6 +219,14 @@ update_extract_config (TrackerExtractController *controller,
 			graphs = g_variant_get_strv (value, NULL);
 			tracker_decorator_set_priority_graphs (priv->decorator, graphs);
 			g_free (graphs);
+		} else if (g_strcmp0 (key, "fallback-mimetypes") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY)) {
+			const gchar **mimetypes = NULL;
+
+			mimetypes = g_variant_get_strv (value, NULL);
+			tracker_extract_decorator_set_fallback_mimetypes (TRACKER_EXTRACT_DECORATOR (priv->decorator),
+			                                                  mimetypes);
+			g_free (mimetypes);
 		}
 
 		g_free (key);
@@ -174,6 +275,57 @@ set_up_persistence (TrackerExtractController  *controller,
 	return TRUE;
 }
 
+static void
+prioritize_file_cb (GObject      *object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+	g_autoptr (GDBusMethodInvocation) invocation = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (tracker_decorator_prioritize_file_finish (TRACKER_DECORATOR (object),
+	                                              res, &error))
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	else
+		g_dbus_method_invocation_return_gerror (invocation, error);
+}
+
+static void
+handle_method_call (GDBusConnection       *connection,
+                    const gchar           *sender,
+                    const gchar           *object_path,
+                    const gchar           *interface_name,
+                    const gchar           *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+{
+	TrackerExtractController *controller = user_data;
+	TrackerExtractControllerPrivate *priv =
+		tracker_extract_controller_get_instance_private (controller);
+
+	if (g_strcmp0 (method_name, "GetMetrics") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+		                                       g_variant_new ("(@a(stta(ut)))",
+		                                                      tracker_metrics_get_snapshot ()));
+	} else if (g_strcmp0 (method_name, "ExtractFile") == 0) {
+		const gchar *uri;
+
+		g_variant_get (parameters, "(&s)", &uri);
+		tracker_decorator_prioritize_file_async (priv->decorator,
+		                                         uri,
+		                                         NULL,
+		                                         prioritize_file_cb,
+		                                         g_object_ref (invocation));
+	} else {
+		g_dbus_method_invocation_return_error (invocation,
+		                                       G_DBUS_ERROR,
+		                                       G_DBUS_ERROR_UNKNOWN_METHOD,
+		                                       "Unknown method %s",
+		                                       method_name);
+	}
+}
+
 static gboolean
 tracker_extract_controller_initable_init (GInitable     *initable,
                                           GCancellable  *cancellable,
@@ -183,7 +335,7 @@ tracker_extract_controller_initable_init (GInitable     *initable,
 	TrackerExtractControllerPrivate *priv;
 	g_autoptr (GDBusNodeInfo) introspection_data = NULL;
 	GDBusInterfaceVTable interface_vtable = {
-		NULL, NULL, NULL
+		handle_method_call, NULL, NULL
 	};
 
 	controller = TRACKER_EXTRACT_CONTROLLER (initable);
@@ -235,6 +387,8 @@ decorator_raise_error_cb (TrackerDecorator         *decorator,
                           GFile                    *file,
                           gchar                    *msg,
                           gchar                    *extra,
+                          gchar                    *mimetype,
+                          gboolean                  fatal,
                           TrackerExtractController *controller)
 {
 	TrackerExtractControllerPrivate *priv =
@@ -256,6 +410,15 @@ decorator_raise_error_cb (TrackerDecorator         *decorator,
 		                       g_variant_new_string (extra));
 	}
 
+	/* Lets the miner notice extractors that keep failing */
+	if (mimetype) {
+		g_variant_builder_add (&builder, "{sv}", "mimetype",
+		                       g_variant_new_string (mimetype));
+	}
+
+	g_variant_builder_add (&builder, "{sv}", "fatal",
+	                       g_variant_new_boolean (fatal));
+
 	g_dbus_connection_emit_signal (priv->connection,
 	                               NULL,
 	                               OBJECT_PATH,
@@ -20,13 +20,29 @@
 #include "config-miners.h"
 
 #include <libtracker-extract/tracker-extract.h>
+#include <libtracker-miners-common/tracker-common.h>
 
 #include "tracker-extract-decorator.h"
 #include "tracker-extract-persistence.h"
 
 #include <tinysparql.h>
 
+#include <glib/gstdio.h>
+
+#define DEFAULT_GRAPH "tracker:FileSystem"
+
 #define THROTTLED_TIMEOUT_MS 10
+/* Delay between files when the system is under full resource pressure */
+#define PRESSURE_MAX_TIMEOUT_MS 1000
+/* Most extractors only read the headers of big files, don't account
+ * more than this for a single remote file.
+ */
+#define REMOTE_READ_MAX_SIZE (16 * 1024 * 1024)
+
+/* Extractor hash of files that only got their basic data, it never
+ * matches a module's, so they are extracted again later.
+ */
+#define FALLBACK_HASH "fallback"
 
 enum {
 	PROP_0,
@@ -48,16 +64,34 @@ struct _ExtractData {
 struct _TrackerExtractDecoratorPrivate {
 	TrackerExtract *extractor;
 	GTimer *timer;
-	gboolean extracting;
+	guint n_extracting;
 
 	TrackerSparqlStatement *update_hash;
 	TrackerSparqlStatement *delete_file;
 
 	TrackerExtractPersistence *persistence;
 	GVolumeMonitor *volume_monitor;
+	TrackerPressure *pressure;
+
+	/* Bytes per second, 0 if unlimited */
+	guint64 max_remote_bandwidth;
+	/* Monotonic time at which remote reads are back under the limit */
+	gint64 remote_budget_time;
+
+	/* MIME types whose extractor keeps failing, and the URIs
+	 * of the files given only basic data for that reason.
+	 */
+	GHashTable *fallback_mimetypes;
+	GHashTable *fallback_files;
 
 	guint throttle_id;
 	guint throttled : 1;
+	/* Leave files for CPU heavy modules for later, e.g. on battery */
+	guint defer_expensive : 1;
+	/* Set after a crash with several files in flight, the culprit
+	 * is unknown, so process files one at a time from then on.
+	 */
+	guint serialized : 1;
 };
 
 static void decorator_get_next_file (TrackerDecorator *decorator);
@@ -65,7 +99,8 @@ static void decorator_get_next_file (TrackerDecorator *decorator);
 static void decorator_ignore_file (GFile                   *file,
                                    TrackerExtractDecorator *decorator,
                                    const gchar             *error_message,
-                                   const gchar             *extra_info);
+                                   const gchar             *extra_info,
+                                   gboolean                 fatal);
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerExtractDecorator, tracker_extract_decorator,
                             TRACKER_TYPE_DECORATOR)
@@ -135,6 +170,32 @@ load_statement (TrackerExtractDecorator *decorator,
 	                                                                NULL);
 }
 
+static void
+on_quota_exceeded (TrackerExtract          *extract,
+                   const gchar             *uri,
+                   const gchar             *reason,
+                   TrackerExtractDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	g_autoptr (GFile) file = NULL;
+	g_autofree gchar *message = NULL;
+
+	priv = tracker_extract_decorator_get_instance_private (decorator);
+
+	/* The process is about to exit, leave only the offending file
+	 * behind so it alone is ignored after restarting, in case
+	 * it can not be ignored right away.
+	 */
+	file = g_file_new_for_uri (uri);
+	tracker_extract_persistence_clear (priv->persistence);
+	tracker_extract_persistence_add_file (priv->persistence, file);
+
+	/* Ignore it now, so the error is reported with the reason */
+	message = g_strdup_printf ("File %s", reason);
+	decorator_ignore_file (file, decorator, message, NULL, TRUE);
+	tracker_extract_persistence_remove_file (priv->persistence, file);
+}
+
 static void
 tracker_extract_decorator_constructed (GObject *object)
 {
@@ -147,6 +208,10 @@ tracker_extract_decorator_constructed (GObject *object)
 
 	priv->update_hash = load_statement (decorator, "update-hash.rq");
 	priv->delete_file = load_statement (decorator, "delete-file.rq");
+
+	g_signal_connect_object (priv->extractor, "quota-exceeded",
+	                         G_CALLBACK (on_quota_exceeded),
+	                         decorator, 0);
 }
 
 static void
@@ -166,11 +231,15 @@ tracker_extract_decorator_finalize (GObject *object)
 		g_timer_destroy (priv->timer);
 
 	g_clear_object (&priv->volume_monitor);
+	g_clear_object (&priv->pressure);
 
 	g_clear_object (&priv->update_hash);
 	g_clear_object (&priv->delete_file);
 	g_clear_object (&priv->persistence);
 
+	g_clear_pointer (&priv->fallback_mimetypes, g_hash_table_unref);
+	g_hash_table_unref (priv->fallback_files);
+
 	G_OBJECT_CLASS (tracker_extract_decorator_parent_class)->finalize (object);
 }
 
@@ -206,33 +275,231 @@ ensure_data (TrackerExtractInfo *info)
 	g_strfreev (rdf_types);
 }
 
+/* Resources created by the tracker_extract_new_*() helpers, whose
+ * URIs are made from their contents and are shared by many files.
+ */
+static const gchar *shared_entity_prefixes[] = {
+	"urn:artist:",
+	"urn:album:",
+	"urn:album-disc:",
+	"urn:contact:",
+	"urn:equipment:",
+};
+
+static GQuark batch_entities_quark = 0;
+
+static gboolean
+is_shared_entity (TrackerResource *resource)
+{
+	const gchar *identifier;
+	guint i;
+
+	identifier = tracker_resource_get_identifier (resource);
+	if (!identifier)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS (shared_entity_prefixes); i++) {
+		if (g_str_has_prefix (identifier, shared_entity_prefixes[i]))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+free_gvalue (GValue *value)
+{
+	g_value_unset (value);
+	g_free (value);
+}
+
+/* Returns a copy of @resource with the given values replaced, the
+ * overwrite semantics of each property are kept.
+ */
+static TrackerResource *
+copy_resource (TrackerResource *resource,
+               GHashTable      *replacements)
+{
+	TrackerResource *copy;
+	GList *properties, *l;
+
+	copy = tracker_resource_new (tracker_resource_get_identifier (resource));
+	properties = tracker_resource_get_properties (resource);
+
+	for (l = properties; l; l = l->next) {
+		const gchar *property = l->data;
+		GList *values, *v;
+		gboolean overwrite;
+
+		overwrite = tracker_resource_get_property_overwrite (resource, property);
+		values = tracker_resource_get_values (resource, property);
+
+		for (v = values; v; v = v->next) {
+			GValue *value;
+
+			value = g_hash_table_lookup (replacements, v->data);
+			if (!value)
+				value = v->data;
+
+			if (overwrite && v == values)
+				tracker_resource_set_gvalue (copy, property, value);
+			else
+				tracker_resource_add_gvalue (copy, property, value);
+		}
+
+		g_list_free (values);
+	}
+
+	g_list_free (properties);
+
+	return copy;
+}
+
+/* Shared entities found in @entities are replaced by references to
+ * their URI, the others are added to it. Returns a new resource if
+ * anything was replaced in @resource or in the resources it links
+ * to, or %NULL if it can be used as is.
+ */
+static TrackerResource *
+dedup_resource (TrackerResource *resource,
+                GHashTable      *entities)
+{
+	g_autoptr (GHashTable) replacements = NULL;
+	TrackerResource *copy = NULL;
+	GList *properties, *l;
+
+	properties = tracker_resource_get_properties (resource);
+
+	for (l = properties; l; l = l->next) {
+		GList *values, *v;
+
+		values = tracker_resource_get_values (resource, l->data);
+
+		for (v = values; v; v = v->next) {
+			GValue *value = v->data, *replacement = NULL;
+			TrackerResource *child, *child_copy;
+			const gchar *identifier;
+
+			if (!G_VALUE_HOLDS (value, TRACKER_TYPE_RESOURCE))
+				continue;
+
+			child = g_value_get_object (value);
+			identifier = tracker_resource_get_identifier (child);
+
+			if (is_shared_entity (child)) {
+				if (g_hash_table_contains (entities, identifier)) {
+					replacement = g_new0 (GValue, 1);
+					g_value_init (replacement, TRACKER_TYPE_URI);
+					g_value_set_string (replacement, identifier);
+				} else {
+					g_hash_table_add (entities, g_strdup (identifier));
+				}
+			}
+
+			if (!replacement) {
+				child_copy = dedup_resource (child, entities);
+
+				if (child_copy) {
+					replacement = g_new0 (GValue, 1);
+					g_value_init (replacement, TRACKER_TYPE_RESOURCE);
+					g_value_take_object (replacement, child_copy);
+				}
+			}
+
+			if (replacement) {
+				if (!replacements) {
+					replacements = g_hash_table_new_full (NULL, NULL, NULL,
+					                                      (GDestroyNotify) free_gvalue);
+				}
+
+				g_hash_table_insert (replacements, value, replacement);
+			}
+		}
+
+		g_list_free (values);
+	}
+
+	g_list_free (properties);
+
+	if (replacements)
+		copy = copy_resource (resource, replacements);
+
+	return copy;
+}
+
 static void
 tracker_extract_decorator_update (TrackerDecorator   *decorator,
                                   TrackerExtractInfo *info,
                                   TrackerBatch       *batch)
 {
-	TrackerExtractDecoratorPrivate *priv;
+	TrackerExtractDecoratorPrivate *priv =
+		tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
 	TrackerResource *resource;
-	const gchar *graph, *mime_type, *hash;
+	const gchar *graph, *mime_type, *hash, *text;
+	g_autoptr (TrackerResource) file_resource = NULL;
 	g_autofree gchar *uri = NULL;
 	GFile *file;
 
-	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
-
 	mime_type = tracker_extract_info_get_mimetype (info);
-	hash = tracker_extract_module_manager_get_hash (mime_type);
 	graph = tracker_extract_info_get_graph (info);
 	resource = tracker_extract_info_get_resource (info);
 	file = tracker_extract_info_get_file (info);
 	uri = g_file_get_uri (file);
 
-	tracker_batch_add_statement (batch, priv->update_hash,
-	                             "file", G_TYPE_STRING, uri,
-	                             "hash", G_TYPE_STRING, hash,
-	                             NULL);
+	if (g_hash_table_remove (priv->fallback_files, uri))
+		hash = FALLBACK_HASH;
+	else
+		hash = tracker_extract_module_manager_get_hash (mime_type);
 
-	if (resource)
-		tracker_batch_add_resource (batch, graph, resource);
+	/* The hash goes in the batch as a resource too, so updates are
+	 * transferred in their serialized form and applied without parsing
+	 * SPARQL for every file.
+	 */
+	file_resource = tracker_resource_new (uri);
+	tracker_resource_set_string (file_resource, "tracker:extractorHash", hash);
+	tracker_batch_add_resource (batch, DEFAULT_GRAPH, file_resource);
+
+	if (resource) {
+		g_autoptr (TrackerResource) dedup = NULL;
+		GHashTable *entities, *graph_entities;
+
+		/* Artists, albums and such are only inserted once per batch
+		 * and graph, further files only refer to them. The store deletes
+		 * resources that are no longer referenced, so this can not be
+		 * extended across batches.
+		 */
+		entities = g_object_get_qdata (G_OBJECT (batch), batch_entities_quark);
+		if (!entities) {
+			entities = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+			                                  (GDestroyNotify) g_hash_table_unref);
+			g_object_set_qdata_full (G_OBJECT (batch), batch_entities_quark,
+			                         entities, (GDestroyNotify) g_hash_table_unref);
+		}
+
+		graph_entities = g_hash_table_lookup (entities, graph ? graph : "");
+		if (!graph_entities) {
+			graph_entities = g_hash_table_new_full (g_str_hash, g_str_equal,
+			                                        g_free, NULL);
+			g_hash_table_insert (entities, g_strdup (graph ? graph : ""),
+			                     graph_entities);
+		}
+
+		dedup = dedup_resource (resource, graph_entities);
+		tracker_batch_add_resource (batch, graph, dedup ? dedup : resource);
+	}
+
+	/* The text goes in a resource of its own, this is the only
+	 * copy made of it, resources copied above do not hold it.
+	 */
+	text = tracker_extract_info_get_text (info);
+
+	if (resource && text) {
+		g_autoptr (TrackerResource) text_resource = NULL;
+
+		text_resource = tracker_resource_new (tracker_resource_get_identifier (resource));
+		tracker_resource_set_string (text_resource, "nie:plainTextContent", text);
+		tracker_batch_add_resource (batch, graph, text_resource);
+	}
 }
 
 static gboolean
@@ -253,10 +520,32 @@ throttle_next_item (TrackerDecorator *decorator)
 		TRACKER_EXTRACT_DECORATOR (decorator);
 	TrackerExtractDecoratorPrivate *priv =
 		tracker_extract_decorator_get_instance_private (extract_decorator);
+	guint timeout = 0;
 
-	if (priv->throttled) {
+	if (priv->throttle_id)
+		return;
+
+	if (priv->throttled)
+		timeout = THROTTLED_TIMEOUT_MS;
+
+	if (priv->pressure) {
+		timeout = MAX (timeout,
+		               PRESSURE_MAX_TIMEOUT_MS *
+		               tracker_pressure_get_pressure (priv->pressure));
+	}
+
+	if (priv->remote_budget_time > 0) {
+		gint64 now = g_get_monotonic_time ();
+
+		if (priv->remote_budget_time > now) {
+			timeout = MAX (timeout,
+			               (priv->remote_budget_time - now) / 1000);
+		}
+	}
+
+	if (timeout > 0) {
 		priv->throttle_id =
-			g_timeout_add (THROTTLED_TIMEOUT_MS,
+			g_timeout_add (timeout,
 				       throttle_next_item_cb,
 				       decorator);
 	} else {
@@ -266,6 +555,44 @@ throttle_next_item (TrackerDecorator *decorator)
 	}
 }
 
+/* Delays the next files by the time it takes to read this one
+ * at the configured bandwidth, if it is on a remote filesystem.
+ */
+static void
+account_remote_read (TrackerExtractDecorator *decorator,
+                     GFile                   *file)
+{
+	TrackerExtractDecoratorPrivate *priv =
+		tracker_extract_decorator_get_instance_private (decorator);
+	const gchar *path;
+	GStatBuf st;
+	gint64 now, size;
+
+	if (priv->max_remote_bandwidth == 0)
+		return;
+
+	path = g_file_peek_path (file);
+	if (!path || g_stat (path, &st) != 0)
+		return;
+
+	if (!tracker_file_system_is_remote (path))
+		return;
+
+	now = g_get_monotonic_time ();
+	size = MIN (st.st_size, REMOTE_READ_MAX_SIZE);
+	priv->remote_budget_time = MAX (priv->remote_budget_time, now) +
+		(size * G_USEC_PER_SEC / priv->max_remote_bandwidth);
+}
+
+static void
+extract_data_free (ExtractData *data)
+{
+	tracker_decorator_info_unref (data->decorator_info);
+	g_object_unref (data->file);
+	g_clear_object (&data->cancellable);
+	g_free (data);
+}
+
 static void
 get_metadata_cb (TrackerExtract *extract,
                  GAsyncResult   *result,
@@ -278,16 +605,18 @@ get_metadata_cb (TrackerExtract *extract,
 	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (data->decorator));
 	info = tracker_extract_file_finish (extract, result, &error);
 
-	tracker_extract_persistence_set_file (priv->persistence, NULL);
+	tracker_extract_persistence_remove_file (priv->persistence, data->file);
 
 	if (data->cancellable && data->signal_id != 0) {
 		g_cancellable_disconnect (data->cancellable, data->signal_id);
 	}
 
 	if (error) {
-		decorator_ignore_file (data->file,
-		                       TRACKER_EXTRACT_DECORATOR (data->decorator),
-		                       error->message, NULL);
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			decorator_ignore_file (data->file,
+			                       TRACKER_EXTRACT_DECORATOR (data->decorator),
+			                       error->message, NULL, FALSE);
+		}
 		tracker_decorator_info_complete_error (data->decorator_info, error);
 	} else {
 		ensure_data (info);
@@ -295,14 +624,12 @@ get_metadata_cb (TrackerExtract *extract,
 		tracker_extract_info_unref (info);
 	}
 
-	priv->extracting = FALSE;
+	priv->n_extracting--;
 
+	account_remote_read (TRACKER_EXTRACT_DECORATOR (data->decorator), data->file);
 	throttle_next_item (data->decorator);
 
-	tracker_decorator_info_unref (data->decorator_info);
-	g_object_unref (data->file);
-	g_object_unref (data->cancellable);
-	g_free (data);
+	extract_data_free (data);
 }
 
 static void
@@ -312,11 +639,17 @@ task_cancellable_cancelled_cb (GCancellable *cancellable,
 	TrackerExtractDecoratorPrivate *priv;
 	gchar *uri;
 
+	/* Items cancelled on their own (e.g. the file was deleted) just
+	 * get their results ignored when the extraction is done.
+	 */
+	if (tracker_decorator_info_is_discarded (data->decorator_info))
+		return;
+
 	/* Delete persistence file on cancellation, we don't want to interpret
 	 * this as a failed operation.
 	 */
 	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (data->decorator));
-	tracker_extract_persistence_set_file (priv->persistence, NULL);
+	tracker_extract_persistence_clear (priv->persistence);
 	uri = g_file_get_uri (data->file);
 
 	g_debug ("Cancelled task for '%s' was currently being "
@@ -327,24 +660,340 @@ task_cancellable_cancelled_cb (GCancellable *cancellable,
 	_exit (EXIT_FAILURE);
 }
 
+static gboolean
+decorator_reuse_shared_content (TrackerDecorator     *decorator,
+                                TrackerDecoratorInfo *info,
+                                GFile                *file)
+{
+	TrackerExtractInfo *extract_info;
+	const gchar *mimetype, *shared_hash, *hash;
+
+	mimetype = tracker_decorator_info_get_mimetype (info);
+	shared_hash = tracker_decorator_info_get_shared_hash (info);
+	if (!mimetype || !shared_hash)
+		return FALSE;
+
+	/* The other file was extracted by the module that would handle
+	 * this one, the content is already there, only the hash is left
+	 * to set.
+	 */
+	hash = tracker_extract_module_manager_get_hash (mimetype);
+	if (g_strcmp0 (hash, shared_hash) != 0)
+		return FALSE;
+
+	TRACKER_NOTE (DECORATOR,
+	              g_message ("[Decorator] Content for '%s' was already extracted",
+	                         tracker_decorator_info_get_url (info)));
+
+	extract_info = tracker_extract_info_new (file,
+	                                         tracker_decorator_info_get_content_id (info),
+	                                         mimetype,
+	                                         tracker_extract_module_manager_get_graph (mimetype),
+	                                         0);
+	tracker_decorator_info_complete (info, extract_info);
+	tracker_extract_info_unref (extract_info);
+
+	return TRUE;
+}
+
+/* Gives only the basic data of its MIME type to files whose
+ * extractor failed often lately, as told by the miner.
+ */
+static gboolean
+decorator_complete_fallback (TrackerDecorator     *decorator,
+                             TrackerDecoratorInfo *info,
+                             GFile                *file)
+{
+	TrackerExtractDecoratorPrivate *priv =
+		tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
+	g_autoptr (TrackerResource) resource = NULL;
+	TrackerExtractInfo *extract_info;
+	const gchar *mimetype, *content_id;
+	GStrv rdf_types;
+	gint i;
+
+	mimetype = tracker_decorator_info_get_mimetype (info);
+	if (!mimetype || !priv->fallback_mimetypes ||
+	    !g_hash_table_contains (priv->fallback_mimetypes, mimetype))
+		return FALSE;
+
+	TRACKER_NOTE (DECORATOR,
+	              g_message ("[Decorator] Extractor for '%s' is failing, adding basic data for '%s'",
+	                         mimetype, tracker_decorator_info_get_url (info)));
+
+	content_id = tracker_decorator_info_get_content_id (info);
+	resource = tracker_resource_new (content_id);
+	rdf_types = tracker_extract_module_manager_get_rdf_types (mimetype);
+
+	for (i = 0; rdf_types[i]; i++)
+		tracker_resource_add_uri (resource, "rdf:type", rdf_types[i]);
+
+	g_strfreev (rdf_types);
+
+	extract_info = tracker_extract_info_new (file,
+	                                         content_id,
+	                                         mimetype,
+	                                         tracker_extract_module_manager_get_graph (mimetype),
+	                                         0);
+	tracker_extract_info_set_resource (extract_info, resource);
+
+	g_hash_table_add (priv->fallback_files, g_file_get_uri (file));
+	tracker_decorator_info_complete (info, extract_info);
+	tracker_extract_info_unref (extract_info);
+
+	return TRUE;
+}
+
 static void
-decorator_get_next_file (TrackerDecorator *decorator)
+decorator_extract_file (ExtractData *data)
 {
 	TrackerExtractDecoratorPrivate *priv;
-	TrackerDecoratorInfo *info;
+	TrackerDecoratorInfo *info = data->decorator_info;
+
+	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (data->decorator));
+
+	TRACKER_NOTE (DECORATOR,
+	              g_message ("[Decorator] Extracting metadata for '%s'",
+	                         tracker_decorator_info_get_url (info)));
+
+	tracker_extract_persistence_add_file (priv->persistence, data->file);
+
+	if (data->cancellable) {
+		data->signal_id = g_cancellable_connect (data->cancellable,
+		                                         G_CALLBACK (task_cancellable_cancelled_cb),
+		                                         data, NULL);
+	}
+
+	tracker_extract_file (priv->extractor,
+	                      tracker_decorator_info_get_url (info),
+	                      tracker_decorator_info_get_content_id (info),
+	                      NULL,
+	                      data->cancellable,
+	                      (GAsyncReadyCallback) get_metadata_cb, data);
+}
+
+/* Builds the resource for @content_id out of the extracted data of
+ * another file, as returned by get-duplicate-content.rq. Returns
+ * %NULL if there is none.
+ */
+static TrackerResource *
+clone_resource_from_cursor (TrackerSparqlCursor *cursor,
+                            const gchar         *content_id)
+{
+	g_autoptr (TrackerResource) resource = NULL;
+	g_autoptr (GHashTable) seen = NULL;
+
+	resource = tracker_resource_new (content_id);
+	seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		const gchar *property;
+		gboolean first;
+
+		property = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+		if (!property)
+			continue;
+
+		/* Single valued properties are set, the values of multiple
+		 * valued ones are added after the first.
+		 */
+		first = g_hash_table_add (seen, g_strdup (property)) &&
+			g_strcmp0 (property, TRACKER_PREFIX_RDF "type") != 0;
+
+		switch (tracker_sparql_cursor_get_value_type (cursor, 1)) {
+		case TRACKER_SPARQL_VALUE_TYPE_URI: {
+			const gchar *value = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+
+			if (first)
+				tracker_resource_set_uri (resource, property, value);
+			else
+				tracker_resource_add_uri (resource, property, value);
+			break;
+		}
+		case TRACKER_SPARQL_VALUE_TYPE_STRING: {
+			const gchar *value = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+
+			if (first)
+				tracker_resource_set_string (resource, property, value);
+			else
+				tracker_resource_add_string (resource, property, value);
+			break;
+		}
+		case TRACKER_SPARQL_VALUE_TYPE_INTEGER: {
+			gint64 value = tracker_sparql_cursor_get_integer (cursor, 1);
+
+			if (first)
+				tracker_resource_set_int64 (resource, property, value);
+			else
+				tracker_resource_add_int64 (resource, property, value);
+			break;
+		}
+		case TRACKER_SPARQL_VALUE_TYPE_DOUBLE: {
+			gdouble value = tracker_sparql_cursor_get_double (cursor, 1);
+
+			if (first)
+				tracker_resource_set_double (resource, property, value);
+			else
+				tracker_resource_add_double (resource, property, value);
+			break;
+		}
+		case TRACKER_SPARQL_VALUE_TYPE_BOOLEAN: {
+			gboolean value = tracker_sparql_cursor_get_boolean (cursor, 1);
+
+			if (first)
+				tracker_resource_set_boolean (resource, property, value);
+			else
+				tracker_resource_add_boolean (resource, property, value);
+			break;
+		}
+		case TRACKER_SPARQL_VALUE_TYPE_DATETIME: {
+			g_autoptr (GDateTime) value = tracker_sparql_cursor_get_datetime (cursor, 1);
+
+			if (!value)
+				break;
+			if (first)
+				tracker_resource_set_datetime (resource, property, value);
+			else
+				tracker_resource_add_datetime (resource, property, value);
+			break;
+		}
+		default:
+			/* Blank nodes are not referable from another resource */
+			break;
+		}
+	}
+
+	if (g_hash_table_size (seen) == 0)
+		return NULL;
+
+	return g_steal_pointer (&resource);
+}
+
+static void
+find_duplicate_content_cb (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+	TrackerSparqlStatement *stmt = TRACKER_SPARQL_STATEMENT (object);
+	ExtractData *data = user_data;
+	TrackerExtractDecoratorPrivate *priv;
+	TrackerDecoratorInfo *info = data->decorator_info;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (TrackerResource) resource = NULL;
 	g_autoptr (GError) error = NULL;
-	ExtractData *data;
-	GCancellable *cancellable;
-	GFile *file;
+	TrackerExtractInfo *extract_info;
+	const gchar *mimetype;
 
-	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
+	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (data->decorator));
+	cursor = tracker_sparql_statement_execute_finish (stmt, result, &error);
+	g_object_unref (stmt);
 
-	if (!tracker_miner_is_started (TRACKER_MINER (decorator)) ||
-	    tracker_miner_is_paused (TRACKER_MINER (decorator)))
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		tracker_decorator_info_complete_error (info, g_steal_pointer (&error));
+		priv->n_extracting--;
+		extract_data_free (data);
 		return;
+	}
 
-	if (priv->extracting)
+	if (cursor) {
+		resource = clone_resource_from_cursor (cursor,
+		                                       tracker_decorator_info_get_content_id (info));
+	} else {
+		g_debug ("Could not look up copies of '%s': %s",
+		         tracker_decorator_info_get_url (info), error->message);
+	}
+
+	if (!resource) {
+		decorator_extract_file (data);
 		return;
+	}
+
+	TRACKER_NOTE (DECORATOR,
+	              g_message ("[Decorator] Copying metadata of a file with the same content to '%s'",
+	                         tracker_decorator_info_get_url (info)));
+
+	mimetype = tracker_decorator_info_get_mimetype (info);
+	extract_info = tracker_extract_info_new (data->file,
+	                                         tracker_decorator_info_get_content_id (info),
+	                                         mimetype,
+	                                         tracker_extract_module_manager_get_graph (mimetype),
+	                                         0);
+	tracker_extract_info_set_resource (extract_info, resource);
+	ensure_data (extract_info);
+	tracker_decorator_info_complete (info, extract_info);
+	tracker_extract_info_unref (extract_info);
+
+	priv->n_extracting--;
+	throttle_next_item (data->decorator);
+	extract_data_free (data);
+}
+
+/* Copies of big files (e.g. photo imports, or attachments saved twice)
+ * get the data extracted from another copy, found by their content
+ * fingerprint, instead of being extracted again.
+ */
+static gboolean
+decorator_find_duplicate_content (ExtractData *data)
+{
+	TrackerDecoratorInfo *info = data->decorator_info;
+	TrackerSparqlStatement *stmt;
+	const gchar *fingerprint, *mimetype, *hash;
+
+	fingerprint = tracker_decorator_info_get_fingerprint (info);
+	mimetype = tracker_decorator_info_get_mimetype (info);
+	if (!fingerprint || !mimetype)
+		return FALSE;
+
+	hash = tracker_extract_module_manager_get_hash (mimetype);
+	if (!hash)
+		return FALSE;
+
+	/* Lookups may overlap, each gets its own statement */
+	stmt = load_statement (TRACKER_EXTRACT_DECORATOR (data->decorator),
+	                       "get-duplicate-content.rq");
+	if (!stmt)
+		return FALSE;
+
+	tracker_sparql_statement_bind_string (stmt, "file",
+	                                      tracker_decorator_info_get_url (info));
+	tracker_sparql_statement_bind_string (stmt, "fingerprint", fingerprint);
+	tracker_sparql_statement_bind_string (stmt, "extractorHash", hash);
+
+	tracker_sparql_statement_execute_async (stmt,
+	                                        data->cancellable,
+	                                        find_duplicate_content_cb,
+	                                        data);
+	return TRUE;
+}
+
+static guint
+decorator_get_max_in_flight (TrackerExtractDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+
+	priv = tracker_extract_decorator_get_instance_private (decorator);
+
+	if (priv->throttled || priv->serialized)
+		return 1;
+
+	/* Keep one item in flight per extractor worker, so thread-safe
+	 * modules get enough work, and I/O for the next files overlaps
+	 * with extraction for the others. Small files handled in batches
+	 * get some more room.
+	 */
+	return MAX (tracker_extract_get_max_in_flight (priv->extractor), 1);
+}
+
+static gboolean
+decorator_extract_next_file (TrackerDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	TrackerDecoratorInfo *info;
+	g_autoptr (GError) error = NULL;
+	ExtractData *data;
+	GFile *file;
+
+	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
 
 	info = tracker_decorator_next (decorator, &error);
 
@@ -358,13 +1007,15 @@ decorator_get_next_file (TrackerDecorator *decorator)
 			g_warning ("Next item could not be processed, %s", error->message);
 		}
 
-		g_clear_error (&error);
-		return;
+		return FALSE;
 	} else if (!tracker_decorator_info_get_url (info)) {
 		/* Skip virtual elements with no real file representation */
+		tracker_decorator_info_complete_error (info,
+		                                       g_error_new (G_IO_ERROR,
+		                                                    G_IO_ERROR_NOT_SUPPORTED,
+		                                                    "No file for this item"));
 		tracker_decorator_info_unref (info);
-		decorator_get_next_file (decorator);
-		return;
+		return TRUE;
 	}
 
 	file = g_file_new_for_uri (tracker_decorator_info_get_url (info));
@@ -372,39 +1023,55 @@ decorator_get_next_file (TrackerDecorator *decorator)
 	if (!g_file_is_native (file)) {
 		g_warning ("URI '%s' is not native",
 		           tracker_decorator_info_get_url (info));
+		tracker_decorator_info_complete_error (info,
+		                                       g_error_new (G_IO_ERROR,
+		                                                    G_IO_ERROR_NOT_SUPPORTED,
+		                                                    "File is not native"));
 		tracker_decorator_info_unref (info);
-		decorator_get_next_file (decorator);
-		return;
+		g_object_unref (file);
+		return TRUE;
 	}
 
-	priv->extracting = TRUE;
+	if (decorator_reuse_shared_content (decorator, info, file) ||
+	    decorator_complete_fallback (decorator, info, file)) {
+		tracker_decorator_info_unref (info);
+		g_object_unref (file);
+		return TRUE;
+	}
+
+	priv->n_extracting++;
 
 	data = g_new0 (ExtractData, 1);
 	data->decorator = decorator;
 	data->decorator_info = info;
 	data->file = file;
-	cancellable = tracker_decorator_info_get_cancellable (info);
+	g_set_object (&data->cancellable,
+	              tracker_decorator_info_get_cancellable (info));
 
-	TRACKER_NOTE (DECORATOR,
-	              g_message ("[Decorator] Extracting metadata for '%s'",
-	                         tracker_decorator_info_get_url (info)));
+	if (!decorator_find_duplicate_content (data))
+		decorator_extract_file (data);
 
-	tracker_extract_persistence_set_file (priv->persistence, data->file);
+	return TRUE;
+}
 
-	g_set_object (&data->cancellable, cancellable);
+static void
+decorator_get_next_file (TrackerDecorator *decorator)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	guint max_in_flight;
 
-	if (data->cancellable) {
-		data->signal_id = g_cancellable_connect (data->cancellable,
-		                                         G_CALLBACK (task_cancellable_cancelled_cb),
-		                                         data, NULL);
-	}
+	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
 
-	tracker_extract_file (priv->extractor,
-	                      tracker_decorator_info_get_url (info),
-	                      tracker_decorator_info_get_content_id (info),
-	                      NULL,
-	                      cancellable,
-	                      (GAsyncReadyCallback) get_metadata_cb, data);
+	if (!tracker_miner_is_started (TRACKER_MINER (decorator)) ||
+	    tracker_miner_is_paused (TRACKER_MINER (decorator)))
+		return;
+
+	max_in_flight = decorator_get_max_in_flight (TRACKER_EXTRACT_DECORATOR (decorator));
+
+	while (priv->n_extracting < max_in_flight) {
+		if (!decorator_extract_next_file (decorator))
+			break;
+	}
 }
 
 static void
@@ -442,12 +1109,24 @@ tracker_extract_decorator_started (TrackerMiner *miner)
 	TrackerExtractDecorator *decorator = TRACKER_EXTRACT_DECORATOR (miner);
 	TrackerExtractDecoratorPrivate *priv =
 		tracker_extract_decorator_get_instance_private (decorator);
-	GFile *file;
-
-	file = tracker_extract_persistence_get_file (priv->persistence);
+	GList *files;
+
+	files = tracker_extract_persistence_get_files (priv->persistence);
+
+	if (files && !files->next) {
+		decorator_ignore_file (files->data, decorator, "Crash/hang handling file", NULL, TRUE);
+	} else if (files) {
+		/* Several files were being processed, we cannot tell which
+		 * one caused the crash. Go one by one, so the culprit is
+		 * caught on its own if this happens again.
+		 */
+		g_debug ("Crash/hang with %d files being processed, extracting serially",
+		         g_list_length (files));
+		priv->serialized = TRUE;
+	}
 
-	if (file)
-		decorator_ignore_file (file, decorator, "Crash/hang handling file", NULL);
+	g_list_free_full (files, g_object_unref);
+	tracker_extract_persistence_clear (priv->persistence);
 
 	TRACKER_MINER_CLASS (tracker_extract_decorator_parent_class)->started (miner);
 }
@@ -504,7 +1183,26 @@ tracker_extract_decorator_error (TrackerDecorator   *decorator,
 	                                               NULL,
 	                                               graph);
 
-	decorator_ignore_file (file, TRACKER_EXTRACT_DECORATOR (decorator), error_message, sparql);
+	decorator_ignore_file (file, TRACKER_EXTRACT_DECORATOR (decorator), error_message, sparql, FALSE);
+}
+
+static gboolean
+tracker_extract_decorator_defer_item (TrackerDecorator *decorator,
+                                      const gchar      *mimetype)
+{
+	TrackerExtractDecoratorPrivate *priv;
+
+	priv = tracker_extract_decorator_get_instance_private (TRACKER_EXTRACT_DECORATOR (decorator));
+
+	if (!priv->defer_expensive || !mimetype)
+		return FALSE;
+
+	/* These only get basic data, without running the module */
+	if (priv->fallback_mimetypes &&
+	    g_hash_table_contains (priv->fallback_mimetypes, mimetype))
+		return FALSE;
+
+	return tracker_extract_module_manager_is_expensive (mimetype);
 }
 
 static void
@@ -516,6 +1214,8 @@ tracker_extract_decorator_class_init (TrackerExtractDecoratorClass *klass)
 
 	object_class->constructed = tracker_extract_decorator_constructed;
 	object_class->finalize = tracker_extract_decorator_finalize;
+
+	batch_entities_quark = g_quark_from_static_string ("tracker-extract-batch-entities");
 	object_class->get_property = tracker_extract_decorator_get_property;
 	object_class->set_property = tracker_extract_decorator_set_property;
 
@@ -527,6 +1227,7 @@ tracker_extract_decorator_class_init (TrackerExtractDecoratorClass *klass)
 	decorator_class->finished = tracker_extract_decorator_finished;
 	decorator_class->error = tracker_extract_decorator_error;
 	decorator_class->update = tracker_extract_decorator_update;
+	decorator_class->defer_item = tracker_extract_decorator_defer_item;
 
 	g_object_class_install_property (object_class,
 	                                 PROP_EXTRACTOR,
@@ -551,13 +1252,14 @@ static void
 decorator_ignore_file (GFile                   *file,
                        TrackerExtractDecorator *decorator,
                        const gchar             *error_message,
-                       const gchar             *extra_info)
+                       const gchar             *extra_info,
+                       gboolean                 fatal)
 {
 	TrackerExtractDecoratorPrivate *priv;
 	g_autoptr (GError) error = NULL, info_error = NULL;
 	g_autofree gchar *uri = NULL;
 	g_autoptr (GFileInfo) info = NULL;
-	const gchar *hash = NULL;
+	const gchar *hash = NULL, *mimetype = NULL;
 	gboolean removed_hash = FALSE;
 
 	priv = tracker_extract_decorator_get_instance_private (decorator);
@@ -571,15 +1273,14 @@ decorator_ignore_file (GFile                   *file,
 	                          NULL, &info_error);
 
 	if (info) {
-		const gchar *mimetype;
-
 		mimetype = g_file_info_get_attribute_string (info,
 		                                             G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
 		hash = tracker_extract_module_manager_get_hash (mimetype);
 	}
 
 	if (hash) {
-		g_signal_emit_by_name (decorator, "raise-error", file, error_message, extra_info);
+		g_signal_emit_by_name (decorator, "raise-error", file, error_message, extra_info,
+		                       mimetype, fatal);
 
 		tracker_sparql_statement_bind_string (priv->update_hash, "file", uri);
 		tracker_sparql_statement_bind_string (priv->update_hash, "hash", hash);
@@ -589,7 +1290,8 @@ decorator_ignore_file (GFile                   *file,
 
 	if (!removed_hash) {
 		if (info_error && !g_error_matches (info_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			g_signal_emit_by_name (decorator, "raise-error", file, error_message, extra_info);
+			g_signal_emit_by_name (decorator, "raise-error", file, error_message, extra_info,
+			                       mimetype, fatal);
 
 		g_clear_error (&error);
 		tracker_sparql_statement_bind_string (priv->delete_file, "file", uri);
@@ -630,6 +1332,10 @@ tracker_extract_decorator_init (TrackerExtractDecorator *decorator)
 	                         G_CALLBACK (mount_points_changed_cb), decorator, 0);
 	g_signal_connect_object (priv->volume_monitor, "mount-removed",
 	                         G_CALLBACK (mount_points_changed_cb), decorator, 0);
+
+	priv->pressure = tracker_pressure_new ();
+	priv->fallback_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                              g_free, NULL);
 }
 
 TrackerDecorator *
@@ -654,3 +1360,57 @@ tracker_extract_decorator_set_throttled (TrackerExtractDecorator *decorator,
 
 	priv->throttled = !!throttled;
 }
+
+void
+tracker_extract_decorator_set_defer_expensive (TrackerExtractDecorator *decorator,
+                                               gboolean                 defer_expensive)
+{
+	TrackerExtractDecoratorPrivate *priv;
+
+	priv = tracker_extract_decorator_get_instance_private (decorator);
+
+	if (priv->defer_expensive == !!defer_expensive)
+		return;
+
+	priv->defer_expensive = !!defer_expensive;
+	g_debug ("%s files for expensive extractors",
+	         defer_expensive ? "Deferring" : "Resuming");
+
+	/* Drop the cached items, or pick up the deferred ones */
+	tracker_decorator_invalidate_cache (TRACKER_DECORATOR (decorator));
+}
+
+void
+tracker_extract_decorator_set_max_remote_bandwidth (TrackerExtractDecorator *decorator,
+                                                    gint                     kbps)
+{
+	TrackerExtractDecoratorPrivate *priv;
+
+	priv = tracker_extract_decorator_get_instance_private (decorator);
+
+	priv->max_remote_bandwidth = (guint64) MAX (kbps, 0) * 1024;
+
+	if (priv->max_remote_bandwidth == 0)
+		priv->remote_budget_time = 0;
+}
+
+void
+tracker_extract_decorator_set_fallback_mimetypes (TrackerExtractDecorator  *decorator,
+                                                  const gchar             **mimetypes)
+{
+	TrackerExtractDecoratorPrivate *priv;
+	gint i;
+
+	priv = tracker_extract_decorator_get_instance_private (decorator);
+
+	g_clear_pointer (&priv->fallback_mimetypes, g_hash_table_unref);
+
+	if (!mimetypes || !mimetypes[0])
+		return;
+
+	priv->fallback_mimetypes = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                                  g_free, NULL);
+
+	for (i = 0; mimetypes[i]; i++)
+		g_hash_table_add (priv->fallback_mimetypes, g_strdup (mimetypes[i]));
+}
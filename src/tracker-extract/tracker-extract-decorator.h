@@ -55,6 +55,15 @@ TrackerDecorator * tracker_extract_decorator_new (TrackerSparqlConnection   *con
 void tracker_extract_decorator_set_throttled (TrackerExtractDecorator *decorator,
                                               gboolean                 throttled);
 
+void tracker_extract_decorator_set_defer_expensive (TrackerExtractDecorator *decorator,
+                                                    gboolean                 defer_expensive);
+
+void tracker_extract_decorator_set_max_remote_bandwidth (TrackerExtractDecorator *decorator,
+                                                         gint                     kbps);
+
+void tracker_extract_decorator_set_fallback_mimetypes (TrackerExtractDecorator  *decorator,
+                                                       const gchar             **mimetypes);
+
 G_END_DECLS
 
 #endif /* __TRACKER_EXTRACT_DECORATOR_H__ */
@@ -19,6 +19,8 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include <gio/gio.h>
 
 #include "tracker-common.h"
@@ -26,72 +28,226 @@
 
 #include "tracker-main.h"
 
-#define GROUP_DESKTOP_ENTRY          "Desktop Entry"
-
 #define SOFTWARE_CATEGORY_URN_PREFIX "urn:software-category:"
 #define THEME_ICON_URN_PREFIX        "urn:theme-icon:"
 #define LINK_URN_PREFIX              "urn:link:"
 
-static GKeyFile *
-get_desktop_key_file (GFile   *file,
-                      gchar  **type,
-                      GError **error)
+/* Values of the extracted keys, pointing into the file contents */
+typedef struct {
+	gchar *contents;
+	GStrv locales; /* Most specific first */
+	const gchar *values[TRACKER_N_DESKTOP_KEYS];
+	gsize value_lens[TRACKER_N_DESKTOP_KEYS];
+	const gchar *localized[TRACKER_N_DESKTOP_KEYS];
+	gsize localized_lens[TRACKER_N_DESKTOP_KEYS];
+	guint localized_rank[TRACKER_N_DESKTOP_KEYS];
+} DesktopEntry;
+
+static void
+desktop_entry_free (DesktopEntry *entry)
 {
-	GKeyFile *key_file;
-	gchar *path;
-	gchar *str;
+	g_free (entry->contents);
+	g_strfreev (entry->locales);
+	g_free (entry);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (DesktopEntry, desktop_entry_free)
+
+static void
+desktop_entry_add_value (TrackerDesktopKey  key,
+                         const gchar       *locale,
+                         gsize              locale_len,
+                         const gchar       *value,
+                         gsize              value_len,
+                         gpointer           user_data)
+{
+	DesktopEntry *entry = user_data;
+	guint i;
+
+	if (!locale) {
+		entry->values[key] = value;
+		entry->value_lens[key] = value_len;
+		return;
+	}
+
+	/* Only the translations for the current locale are kept */
+	for (i = 0; entry->locales[i]; i++) {
+		if (strncmp (entry->locales[i], locale, locale_len) != 0 ||
+		    entry->locales[i][locale_len] != '\0')
+			continue;
+
+		if (!entry->localized[key] || i <= entry->localized_rank[key]) {
+			entry->localized[key] = value;
+			entry->localized_lens[key] = value_len;
+			entry->localized_rank[key] = i;
+		}
+
+		break;
+	}
+}
+
+static DesktopEntry *
+desktop_entry_load (GFile       *file,
+                    const gchar *locale,
+                    GError     **error)
+{
+	g_autoptr (DesktopEntry) entry = NULL;
+	g_autofree gchar *path = NULL;
+	gsize len;
 
 	path = g_file_get_path (file);
-	key_file = g_key_file_new ();
-	*type = NULL;
+	entry = g_new0 (DesktopEntry, 1);
+
+	if (!g_file_get_contents (path, &entry->contents, &len, error))
+		return NULL;
+
+	/* Same locales GKeyFile would look up */
+	if (locale)
+		entry->locales = g_get_locale_variants (locale);
+	else
+		entry->locales = g_strdupv ((gchar **) g_get_language_names ());
 
-	if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, error)) {
-		g_key_file_free (key_file);
-		g_free (path);
+	if (!tracker_desktop_entry_parse (entry->contents, len,
+	                                  desktop_entry_add_value, entry,
+	                                  error))
 		return NULL;
+
+	return g_steal_pointer (&entry);
+}
+
+/* Unescapes a value like GKeyFile does, splitting it at unescaped
+ * semicolons into @list if given.
+ */
+static gchar *
+unescape_value (const gchar *value,
+                gsize        len,
+                GPtrArray   *list)
+{
+	const gchar *p, *end = value + len;
+	GString *str;
+
+	str = g_string_sized_new (len);
+
+	for (p = value; p < end; p++) {
+		if (*p == ';' && list) {
+			g_ptr_array_add (list, g_string_free (str, FALSE));
+			str = g_string_new (NULL);
+			continue;
+		}
+
+		if (*p != '\\' || p + 1 == end) {
+			g_string_append_c (str, *p);
+			continue;
+		}
+
+		p++;
+
+		switch (*p) {
+		case 's':
+			g_string_append_c (str, ' ');
+			break;
+		case 'n':
+			g_string_append_c (str, '\n');
+			break;
+		case 't':
+			g_string_append_c (str, '\t');
+			break;
+		case 'r':
+			g_string_append_c (str, '\r');
+			break;
+		case '\\':
+			g_string_append_c (str, '\\');
+			break;
+		case ';':
+			if (list) {
+				g_string_append_c (str, ';');
+				break;
+			}
+			/* Fall through */
+		default:
+			g_string_append_c (str, '\\');
+			g_string_append_c (str, *p);
+			break;
+		}
 	}
 
-	str = g_key_file_get_string (key_file, GROUP_DESKTOP_ENTRY, "Type", NULL);
+	if (list) {
+		/* A trailing semicolon ends the list */
+		if (str->len > 0)
+			g_ptr_array_add (list, g_string_free (str, FALSE));
+		else
+			g_string_free (str, TRUE);
+
+		return NULL;
+	}
 
-	if (G_UNLIKELY (!str)) {
-		*type = NULL;
+	return g_string_free (str, FALSE);
+}
 
-		g_set_error_literal (error, G_KEY_FILE_ERROR,
-		                     G_KEY_FILE_ERROR_GROUP_NOT_FOUND,
-		                     "Desktop file doesn't contain type");
-		g_key_file_free (key_file);
-		g_free (path);
+/* Returns the translation of @key for the current locale, or the
+ * untranslated value.
+ */
+static gchar *
+desktop_entry_get_string (DesktopEntry      *entry,
+                          TrackerDesktopKey  key,
+                          gboolean           localized)
+{
+	gchar *str;
+
+	if (localized && entry->localized[key])
+		str = unescape_value (entry->localized[key], entry->localized_lens[key], NULL);
+	else if (entry->values[key])
+		str = unescape_value (entry->values[key], entry->value_lens[key], NULL);
+	else
+		return NULL;
+
+	if (!g_utf8_validate (str, -1, NULL))
+		g_clear_pointer (&str, g_free);
+
+	return str;
+}
+
+static GStrv
+desktop_entry_get_string_list (DesktopEntry      *entry,
+                               TrackerDesktopKey  key)
+{
+	GPtrArray *list;
+	guint i;
+
+	list = g_ptr_array_new_with_free_func (g_free);
+
+	if (entry->localized[key])
+		unescape_value (entry->localized[key], entry->localized_lens[key], list);
+	else if (entry->values[key])
+		unescape_value (entry->values[key], entry->value_lens[key], list);
+
+	for (i = 0; i < list->len; i++) {
+		if (!g_utf8_validate (g_ptr_array_index (list, i), -1, NULL)) {
+			g_ptr_array_unref (list);
+			return NULL;
+		}
+	}
+
+	if (list->len == 0) {
+		g_ptr_array_unref (list);
 		return NULL;
-	} else {
-		/* Sanitize type */
-		*type = g_strstrip (str);
 	}
 
-	g_free (path);
+	g_ptr_array_set_free_func (list, NULL);
+	g_ptr_array_add (list, NULL);
 
-	return key_file;
+	return (GStrv) g_ptr_array_free (list, FALSE);
 }
 
 static void
-insert_data_from_desktop_file (TrackerResource *resource,
-                               const gchar     *metadata_key,
-                               GKeyFile        *desktop_file,
-                               const gchar     *key,
-                               const gchar     *locale)
+insert_data_from_desktop_file (TrackerResource   *resource,
+                               const gchar       *metadata_key,
+                               DesktopEntry      *entry,
+                               TrackerDesktopKey  key)
 {
 	gchar *str;
 
-	if (locale) {
-		/* Try to get the key with our desired LANG locale... */
-		str = g_key_file_get_locale_string (desktop_file, GROUP_DESKTOP_ENTRY, key, locale, NULL);
-		/* If our desired locale failed, use the list of LANG locales prepared by GLib
-		 * (will return untranslated string if none of the locales available) */
-		if (!str) {
-			str = g_key_file_get_locale_string (desktop_file, GROUP_DESKTOP_ENTRY, key, NULL, NULL);
-		}
-	} else {
-		str = g_key_file_get_string (desktop_file, GROUP_DESKTOP_ENTRY, key, NULL);
-	}
+	str = desktop_entry_get_string (entry, key, TRUE);
 
 	if (str) {
 		tracker_resource_set_string (resource, metadata_key, str);
@@ -104,7 +260,8 @@ process_desktop_file (TrackerResource  *resource,
                       GFile            *file,
                       GError          **error)
 {
-	GKeyFile *key_file;
+	g_autoptr (DesktopEntry) entry = NULL;
+	g_autofree gchar *hidden = NULL;
 	GError *inner_error = NULL;
 	gchar *name = NULL;
 	gchar *type;
@@ -113,43 +270,42 @@ process_desktop_file (TrackerResource  *resource,
 	gboolean is_software = FALSE;
 	gchar *lang;
 
-	key_file = get_desktop_key_file (file, &type, &inner_error);
-	if (inner_error) {
-		gchar *uri;
+	/* Retrieve LANG locale setup */
+	lang = tracker_locale_get (TRACKER_LOCALE_LANGUAGE);
 
-		uri = g_file_get_uri (file);
+	entry = desktop_entry_load (file, lang, &inner_error);
+	if (inner_error) {
 		g_propagate_prefixed_error (error, inner_error, "Could not load desktop file:");
-		g_free (uri);
+		g_free (lang);
+		return FALSE;
+	}
+
+	type = desktop_entry_get_string (entry, TRACKER_DESKTOP_KEY_TYPE, FALSE);
+
+	if (G_UNLIKELY (!type)) {
+		g_set_error_literal (error, G_KEY_FILE_ERROR,
+		                     G_KEY_FILE_ERROR_GROUP_NOT_FOUND,
+		                     "Could not load desktop file: Desktop file doesn't contain type");
+		g_free (lang);
 		return FALSE;
 	}
 
-	if (g_key_file_get_boolean (key_file, GROUP_DESKTOP_ENTRY, "Hidden", NULL)) {
+	/* Sanitize type */
+	g_strstrip (type);
+
+	hidden = desktop_entry_get_string (entry, TRACKER_DESKTOP_KEY_HIDDEN, FALSE);
+
+	if (g_strcmp0 (hidden, "true") == 0 || g_strcmp0 (hidden, "1") == 0) {
 		g_debug ("Desktop file is hidden");
-		g_key_file_free (key_file);
 		g_free (type);
+		g_free (lang);
 		return TRUE;
 	}
 
-	/* Retrieve LANG locale setup */
-	lang = tracker_locale_get (TRACKER_LOCALE_LANGUAGE);
-
-	/* Try to get the categories with our desired LANG locale... */
-	cats = g_key_file_get_locale_string_list (key_file, GROUP_DESKTOP_ENTRY, "Categories", lang, &cats_len, NULL);
-	if (!cats) {
-		/* If our desired locale failed, use the list of LANG locales prepared by GLib
-		 * (will return untranslated string if none of the locales available) */
-		cats = g_key_file_get_locale_string_list (key_file, GROUP_DESKTOP_ENTRY, "Categories", NULL, &cats_len, NULL);
-	}
+	cats = desktop_entry_get_string_list (entry, TRACKER_DESKTOP_KEY_CATEGORIES);
+	cats_len = cats ? g_strv_length (cats) : 0;
 
-	if (!name) {
-		/* Try to get the name with our desired LANG locale... */
-		name = g_key_file_get_locale_string (key_file, GROUP_DESKTOP_ENTRY, "Name", lang, NULL);
-		if (!name) {
-			/* If our desired locale failed, use the list of LANG locales prepared by GLib
-			 * (will return untranslated string if none of the locales available) */
-			name = g_key_file_get_locale_string (key_file, GROUP_DESKTOP_ENTRY, "Name", NULL, NULL);
-		}
-	}
+	name = desktop_entry_get_string (entry, TRACKER_DESKTOP_KEY_NAME, TRUE);
 
 	/* Sanitize name */
 	if (name) {
@@ -162,7 +318,7 @@ process_desktop_file (TrackerResource  *resource,
 	} else if (name && g_ascii_strcasecmp (type, "Link") == 0) {
 		gchar *link_url;
 
-		link_url = g_key_file_get_string (key_file, GROUP_DESKTOP_ENTRY, "URL", NULL);
+		link_url = desktop_entry_get_string (entry, TRACKER_DESKTOP_KEY_URL, FALSE);
 
 		if (link_url) {
 			TrackerResource *website_resource;
@@ -183,7 +339,6 @@ process_desktop_file (TrackerResource  *resource,
 			             G_IO_ERROR_INVALID_ARGUMENT,
 			             "Link desktop entry does not have an url");
 			g_free (type);
-			g_key_file_free (key_file);
 			g_strfreev (cats);
 			g_free (lang);
 			g_free (name);
@@ -197,7 +352,6 @@ process_desktop_file (TrackerResource  *resource,
 		             "Unknown desktop entry type '%s'",
 		             type);
 		g_free (type);
-		g_key_file_free (key_file);
 		g_strfreev (cats);
 		g_free (lang);
 		g_free (name);
@@ -217,16 +371,14 @@ process_desktop_file (TrackerResource  *resource,
 		tracker_resource_add_uri (resource, "rdf:type", "nfo:Executable");
 		insert_data_from_desktop_file (resource,
 		                               "nie:comment",
-		                               key_file,
-		                               "Comment",
-		                               lang);
+		                               entry,
+		                               TRACKER_DESKTOP_KEY_COMMENT);
 		insert_data_from_desktop_file (resource,
 		                               "nfo:softwareCmdLine",
-		                               key_file,
-		                               "Exec",
-		                               lang);
+		                               entry,
+		                               TRACKER_DESKTOP_KEY_EXEC);
 
-		icon = g_key_file_get_string (key_file, GROUP_DESKTOP_ENTRY, "Icon", NULL);
+		icon = desktop_entry_get_string (entry, TRACKER_DESKTOP_KEY_ICON, FALSE);
 
 		if (icon) {
 			TrackerResource *icon_resource;
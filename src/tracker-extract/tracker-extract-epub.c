@@ -64,11 +64,6 @@ typedef struct {
 	gchar *savedstring;
 } OPFData;
 
-typedef struct {
-	GString *contents;
-	gsize limit;
-} OPFContentData;
-
 static inline OPFData *
 opf_data_new (const char *uri,
               TrackerResource *resource)
@@ -512,27 +507,14 @@ content_xml_text_handler (GMarkupParseContext   *context,
                           gpointer               user_data,
                           GError               **error)
 {
-	OPFContentData *content_data = user_data;
-	gsize written_bytes = 0;
-
-	if (text_len <= 0) {
-		return;
-	}
-
-	if (tracker_text_validate_utf8 (text,
-	                                MIN (text_len, content_data->limit),
-	                                &content_data->contents,
-	                                &written_bytes)) {
-		if (content_data->contents->str[content_data->contents->len - 1] != ' ') {
-			g_string_append_c (content_data->contents, ' ');
-		}
-	}
+	TrackerTextSink *sink = user_data;
 
-	content_data->limit -= written_bytes;
+	/* Stops parsing once full */
+	tracker_text_sink_append_word (sink, text, text_len, error);
 }
 
 static gchar *
-extract_opf_path (const gchar *uri)
+extract_opf_path (TrackerGsfArchive *archive)
 {
 	GMarkupParseContext *context;
 	gchar *path = NULL;
@@ -548,7 +530,7 @@ extract_opf_path (const gchar *uri)
 	/* Load the internal container file from the Zip archive,
 	 * and parse it to extract the .opf file to get metadata from
 	 */
-	tracker_gsf_parse_xml_in_zip (uri, "META-INF/container.xml", context, &error);
+	tracker_gsf_archive_parse_xml (archive, "META-INF/container.xml", context, &error);
 	g_markup_parse_context_free (context);
 
 	if (error || !path) {
@@ -563,12 +545,14 @@ extract_opf_path (const gchar *uri)
 
 static gchar *
 extract_opf_contents (TrackerExtractInfo *info,
-                      const gchar        *uri,
+                      TrackerGsfArchive  *archive,
                       const gchar        *content_prefix,
                       GList              *content_files)
 {
-	OPFContentData content_data = { 0 };
+	TrackerTextSink *sink;
 	GError *error = NULL;
+	gsize max_text;
+	gchar *contents;
 	GList *l;
 	GMarkupParser xml_parser = {
 		NULL, NULL,
@@ -576,41 +560,46 @@ extract_opf_contents (TrackerExtractInfo *info,
 		NULL, NULL
 	};
 
-	content_data.contents = g_string_new ("");
-	content_data.limit = (gsize) tracker_extract_info_get_max_text (info);
+	max_text = (gsize) tracker_extract_info_get_max_text (info);
+	sink = tracker_text_sink_new (max_text);
 
-	g_debug ("Extracting up to %" G_GSIZE_FORMAT " bytes of content", content_data.limit);
+	g_debug ("Extracting up to %" G_GSIZE_FORMAT " bytes of content", max_text);
 
 	for (l = content_files; l; l = l->next) {
 		GMarkupParseContext *context;
 		gchar *path;
 
-		context = g_markup_parse_context_new (&xml_parser, 0, &content_data, NULL);
+		context = g_markup_parse_context_new (&xml_parser, 0, sink, NULL);
 
 		/* Page file is relative to OPF file location */
 		path = g_build_filename (content_prefix, l->data, NULL);
-		tracker_gsf_parse_xml_in_zip (uri, path, context, &error);
+		tracker_gsf_archive_parse_xml (archive, path, context, &error);
 
-		if (error) {
+		if (error &&
+		    !g_error_matches (error, TRACKER_TEXT_SINK_ERROR, TRACKER_TEXT_SINK_ERROR_FULL)) {
 			g_warning ("Error extracting EPUB contents (%s): %s",
 				   path, error->message);
-			g_clear_error (&error);
 		}
+		g_clear_error (&error);
 		g_free (path);
 
 		g_markup_parse_context_free (context);
 
-		if (content_data.limit <= 0) {
+		if (tracker_text_sink_is_full (sink)) {
 			/* Reached plain text extraction limit */
 			break;
 		}
 	}
 
-	return g_string_free (content_data.contents, FALSE);
+	contents = g_strdup (tracker_text_sink_get_text (sink));
+	tracker_text_sink_free (sink);
+
+	return contents;
 }
 
 static TrackerResource *
 extract_opf (TrackerExtractInfo *info,
+             TrackerGsfArchive  *archive,
              const gchar        *uri,
              const gchar        *opf_path)
 {
@@ -644,7 +633,7 @@ extract_opf (TrackerExtractInfo *info,
 	/* Load the internal container file from the Zip archive,
 	 * and parse it to extract the .opf file to get metadata from
 	 */
-	tracker_gsf_parse_xml_in_zip (uri, opf_path, context, &error);
+	tracker_gsf_archive_parse_xml (archive, opf_path, context, &error);
 	g_markup_parse_context_free (context);
 
 	if (error) {
@@ -657,12 +646,11 @@ extract_opf (TrackerExtractInfo *info,
 	}
 
 	dirname = g_path_get_dirname (opf_path);
-	contents = extract_opf_contents (info, uri, dirname, data->pages);
+	contents = extract_opf_contents (info, archive, dirname, data->pages);
 	g_free (dirname);
 
-	if (contents && *contents) {
-		tracker_resource_set_string (ebook, "nie:plainTextContent", contents);
-	}
+	if (contents && *contents)
+		tracker_extract_info_take_text (info, g_steal_pointer (&contents));
 
 	opf_data_free (data);
 	g_free (contents);
@@ -675,20 +663,29 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
 	TrackerResource *ebook;
+	TrackerGsfArchive *archive;
 	gchar *opf_path, *uri;
 	GFile *file;
 
 	file = tracker_extract_info_get_file (info);
 	uri = g_file_get_uri (file);
 
-	opf_path = extract_opf_path (uri);
+	archive = tracker_gsf_archive_open (uri, error);
+	if (!archive) {
+		g_free (uri);
+		return FALSE;
+	}
+
+	opf_path = extract_opf_path (archive);
 
 	if (!opf_path) {
+		tracker_gsf_archive_close (archive);
 		g_free (uri);
 		return FALSE;
 	}
 
-	ebook = extract_opf (info, uri, opf_path);
+	ebook = extract_opf (info, archive, uri, opf_path);
+	tracker_gsf_archive_close (archive);
 	g_free (opf_path);
 	g_free (uri);
 
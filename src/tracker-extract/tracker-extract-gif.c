@@ -27,8 +27,6 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <gif_lib.h>
-
 #include <libtracker-miners-common/tracker-common.h>
 
 #include <libtracker-extract/tracker-extract.h>
@@ -36,6 +34,17 @@
 #define XMP_MAGIC_TRAILER_LENGTH 256
 #define EXTENSION_RECORD_COMMENT_BLOCK_CODE 0xFE
 
+#define GIF_BUFFER_SIZE 4096
+#define GIF_HEADER_SIZE 13
+#define GIF_IMAGE_DESC_SIZE 9
+#define GIF_COLOR_TABLE_FLAG 0x80
+
+enum {
+	GIF_BLOCK_EXTENSION = 0x21,
+	GIF_BLOCK_IMAGE = 0x2C,
+	GIF_BLOCK_TRAILER = 0x3B,
+};
+
 typedef struct {
 	const gchar *title;
 	const gchar *date;
@@ -48,199 +57,229 @@ typedef struct {
 	gchar *comment;
 } GifData;
 
+/* Reads the GIF blocks sequentially, image data is skipped sub-block
+ * after sub-block, without being decoded.
+ */
 typedef struct {
-	unsigned int   byteCount;
-	char          *bytes;
-} ExtBlock;
-
-static int
-ext_block_append(ExtBlock *extBlock,
-		 unsigned int len,
-		 unsigned char extData[])
+	int fd;
+	guchar buffer[GIF_BUFFER_SIZE];
+	gsize pos;
+	gsize len;
+} GifReader;
+
+static gboolean
+gif_reader_read (GifReader *reader,
+                 guchar    *data,
+                 gsize      len)
 {
-	extBlock->bytes = realloc(extBlock->bytes,extBlock->byteCount+len);
-	if (extBlock->bytes == NULL) {
-		return (GIF_ERROR);
+	while (len > 0) {
+		gsize n;
+
+		if (reader->pos == reader->len) {
+			gssize n_read;
+
+			do {
+				n_read = read (reader->fd, reader->buffer, sizeof (reader->buffer));
+			} while (n_read < 0 && errno == EINTR);
+
+			if (n_read <= 0)
+				return FALSE;
+
+			reader->pos = 0;
+			reader->len = n_read;
+		}
+
+		n = MIN (len, reader->len - reader->pos);
+
+		if (data) {
+			memcpy (data, &reader->buffer[reader->pos], n);
+			data += n;
+		}
+
+		reader->pos += n;
+		len -= n;
 	}
 
-	memcpy(&(extBlock->bytes[extBlock->byteCount]), &extData[0], len);
-	extBlock->byteCount += len;
+	return TRUE;
+}
+
+static gboolean
+gif_reader_skip_color_table (GifReader *reader,
+                             guchar     flags)
+{
+	if ((flags & GIF_COLOR_TABLE_FLAG) == 0)
+		return TRUE;
 
-	return (GIF_OK);
+	return gif_reader_read (reader, NULL, 3 * (1 << ((flags & 0x07) + 1)));
 }
 
-#if GIFLIB_MAJOR >= 5
-static inline void
-gif_error (const gchar *action, int err)
+/* Reads the data sub-blocks up to the block terminator, appending them
+ * to @data if given, optionally along with their size bytes.
+ */
+static gboolean
+gif_reader_read_sub_blocks (GifReader  *reader,
+                            GByteArray *data,
+                            gboolean    with_sizes)
 {
-	const char *str = GifErrorString (err);
-	if (str != NULL) {
-		g_debug ("%s, error: '%s'", action, str);
-	} else {
-		g_debug ("%s, undefined error %d", action, err);
+	guchar block[255];
+	guchar size;
+
+	while (TRUE) {
+		if (!gif_reader_read (reader, &size, 1))
+			return FALSE;
+
+		if (size == 0)
+			return TRUE;
+
+		if (!gif_reader_read (reader, data ? block : NULL, size))
+			return FALSE;
+
+		if (data) {
+			if (with_sizes)
+				g_byte_array_append (data, &size, 1);
+			g_byte_array_append (data, block, size);
+		}
 	}
 }
-#else /* GIFLIB_MAJOR >= 5 */
-static inline void print_gif_error()
+
+static gboolean
+read_image (GifReader *reader,
+            GifData   *gd)
 {
-#if defined(GIFLIB_MAJOR) && defined(GIFLIB_MINOR) && ((GIFLIB_MAJOR == 4 && GIFLIB_MINOR >= 2) || GIFLIB_MAJOR > 4)
-	const char *str = GifErrorString ();
-	if (str != NULL) {
-		g_debug ("GIF, error: '%s'", str);
-	} else {
-		g_debug ("GIF, undefined error");
-	}
-#else
-	PrintGifError();
-#endif
+	guchar desc[GIF_IMAGE_DESC_SIZE];
+
+	if (!gif_reader_read (reader, desc, sizeof (desc)) ||
+	    !gif_reader_skip_color_table (reader, desc[8]) ||
+	    /* LZW minimum code size */
+	    !gif_reader_read (reader, NULL, 1) ||
+	    !gif_reader_read_sub_blocks (reader, NULL, FALSE))
+		return FALSE;
+
+	g_free (gd->width);
+	g_free (gd->height);
+	gd->width = g_strdup_printf ("%d", desc[4] | (desc[5] << 8));
+	gd->height = g_strdup_printf ("%d", desc[6] | (desc[7] << 8));
+
+	return TRUE;
 }
-#endif /* GIFLIB_MAJOR >= 5 */
 
-/* giflib 5.1 changed the API of DGifCloseFile to take two arguments */
-#if !defined(GIFLIB_MAJOR) || \
-    !(GIFLIB_MAJOR > 5 || (GIFLIB_MAJOR == 5 && GIFLIB_MINOR >= 1))
-#define DGifCloseFile(a, b) DGifCloseFile(a)
+static gboolean
+read_extension (GifReader       *reader,
+                const gchar     *uri,
+                GifData         *gd,
+                TrackerXmpData **xd)
+{
+	guchar block[255];
+	guchar code, size;
+	GByteArray *data;
+
+	if (!gif_reader_read (reader, &code, 1) ||
+	    !gif_reader_read (reader, &size, 1))
+		return FALSE;
+
+	if (size == 0)
+		return TRUE;
+
+	if (!gif_reader_read (reader, block, size))
+		return FALSE;
+
+#if defined(HAVE_EXEMPI)
+	if (size >= 8 && memcmp (block, "XMP Data", 8) == 0) {
+		/* The size bytes are part of the packet, which ends with
+		 * a "magic trailer" making it look like sub-blocks.
+		 */
+		data = g_byte_array_new ();
+
+		if (!gif_reader_read_sub_blocks (reader, data, TRUE)) {
+			g_byte_array_unref (data);
+			return FALSE;
+		}
+
+		if (!*xd && data->len > XMP_MAGIC_TRAILER_LENGTH) {
+			*xd = tracker_xmp_new ((const gchar *) data->data,
+			                       data->len - XMP_MAGIC_TRAILER_LENGTH,
+			                       uri);
+		}
+
+		g_byte_array_unref (data);
+		return TRUE;
+	}
 #endif
 
+	/* See Section 24. Comment Extension. in the GIF format definition */
+	if (code == EXTENSION_RECORD_COMMENT_BLOCK_CODE) {
+		data = g_byte_array_new ();
+		g_byte_array_append (data, block, size);
+
+		if (!gif_reader_read_sub_blocks (reader, data, FALSE)) {
+			g_byte_array_unref (data);
+			return FALSE;
+		}
+
+		g_debug ("Comment Extension blocks found with %u bytes", data->len);
+
+		/* Add last NUL byte */
+		g_byte_array_append (data, (const guint8 *) "", 1);
+
+		g_free (gd->comment);
+		gd->comment = (gchar *) g_byte_array_free (data, FALSE);
+		return TRUE;
+	}
+
+	return gif_reader_read_sub_blocks (reader, NULL, FALSE);
+}
+
 static TrackerResource *
-read_metadata (GifFileType        *gifFile,
+read_metadata (GifReader          *reader,
                GFile              *file,
                const gchar        *uri,
                TrackerExtractInfo *info)
 {
 	TrackerResource *metadata;
-	GifRecordType RecordType;
-	int frameheight;
-	int framewidth;
-	unsigned char *framedata = NULL;
+	guchar header[GIF_HEADER_SIZE];
 	GPtrArray *keywords;
 	guint i;
-	gint h;
-	int status;
 	MergeData md = { 0 };
 	GifData   gd = { 0 };
 	TrackerXmpData *xd = NULL;
 	gchar *sidecar = NULL, *resource_uri;
+	guchar block_type = 0;
+
+	if (!gif_reader_read (reader, header, sizeof (header)) ||
+	    memcmp (header, "GIF", 3) != 0 ||
+	    !gif_reader_skip_color_table (reader, header[10])) {
+		g_debug ("Could not read GIF header");
+		return NULL;
+	}
+
+	while (block_type != GIF_BLOCK_TRAILER) {
+		gboolean success;
 
-	do {
-		GifByteType *ExtData;
-		int ExtCode;
-		ExtBlock extBlock;
-
-		if (DGifGetRecordType(gifFile, &RecordType) == GIF_ERROR) {
-#if GIFLIB_MAJOR < 5
-			print_gif_error ();
-#else  /* GIFLIB_MAJOR < 5 */
-			gif_error ("Could not read next GIF record type", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-			return NULL;
+		if (!gif_reader_read (reader, &block_type, 1)) {
+			g_debug ("Could not read next GIF record type");
+			goto error;
 		}
 
-		switch (RecordType) {
-			case IMAGE_DESC_RECORD_TYPE:
-			if (DGifGetImageDesc(gifFile) == GIF_ERROR) {
-#if GIFLIB_MAJOR < 5
-				print_gif_error();
-#else  /* GIFLIB_MAJOR < 5 */
-				gif_error ("Could not get GIF record information", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-				return NULL;
-			}
-
-			framewidth  = gifFile->Image.Width;
-			frameheight = gifFile->Image.Height;
-
-			framedata = g_malloc_n (framewidth, sizeof(GifPixelType));
-			for (h = 0; h < frameheight; h++)
-			{
-				if (DGifGetLine(gifFile, framedata, framewidth)==GIF_ERROR) {
-					g_free (framedata);
-#if GIFLIB_MAJOR < 5
-					print_gif_error();
-#else  /* GIFLIB_MAJOR < 5 */
-					gif_error ("Could not load a block of GIF pixes", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-					return NULL;
-				}
-			}
-
-			gd.width  = g_strdup_printf ("%d", framewidth);
-			gd.height = g_strdup_printf ("%d", frameheight);
-
-
-			g_free (framedata);
-
-		break;
-		case EXTENSION_RECORD_TYPE:
-			extBlock.bytes = NULL;
-			extBlock.byteCount = 0;
-
-			if ((status = DGifGetExtension (gifFile, &ExtCode, &ExtData)) != GIF_OK) {
-				g_warning ("Problem getting the extension");
-				return NULL;
-			}
-#if defined(HAVE_EXEMPI)
-			if (ExtData && *ExtData &&
-			    strncmp (&ExtData[1],"XMP Data",8) == 0) {
-				while (ExtData != NULL && status == GIF_OK ) {
-					if ((status = DGifGetExtensionNext (gifFile, &ExtData)) == GIF_OK) {
-						if (ExtData != NULL) {
-							if (ext_block_append (&extBlock, ExtData[0]+1, (char *) &(ExtData[0])) != GIF_OK) {
-								g_warning ("Problem with extension data");
-								return NULL;
-							}
-						}
-					}
-				}
-
-				xd = tracker_xmp_new (extBlock.bytes,
-				                      extBlock.byteCount-XMP_MAGIC_TRAILER_LENGTH,
-				                      uri);
-
-				g_free (extBlock.bytes);
-			} else
-#endif
-			/* See Section 24. Comment Extension. in the GIF format definition */
-			if (ExtCode == EXTENSION_RECORD_COMMENT_BLOCK_CODE &&
-			    ExtData && *ExtData) {
-				guint block_count = 0;
-
-				/* Merge all blocks */
-				do {
-					block_count++;
-
-					g_debug ("Comment Extension block found (#%u, %u bytes)",
-					         block_count,
-					         ExtData[0]);
-					if (ext_block_append (&extBlock, ExtData[0], (char *) &(ExtData[1])) != GIF_OK) {
-						g_warning ("Problem with Comment extension data");
-						return NULL;
-					}
-				} while (((status = DGifGetExtensionNext(gifFile, &ExtData)) == GIF_OK) &&
-				         ExtData != NULL);
-
-				/* Add last NUL byte */
-				g_debug ("Comment Extension blocks found (%u) with %u bytes",
-				         block_count,
-				         extBlock.byteCount);
-				extBlock.bytes = g_realloc (extBlock.bytes, extBlock.byteCount + 1);
-				extBlock.bytes[extBlock.byteCount] = '\0';
-
-				/* Set commentt */
-				gd.comment = extBlock.bytes;
-			} else {
-				do {
-					status = DGifGetExtensionNext(gifFile, &ExtData);
-				} while ( status == GIF_OK && ExtData != NULL);
-			}
-		break;
-		case TERMINATE_RECORD_TYPE:
+		switch (block_type) {
+		case GIF_BLOCK_IMAGE:
+			success = read_image (reader, &gd);
+			break;
+		case GIF_BLOCK_EXTENSION:
+			success = read_extension (reader, uri, &gd, &xd);
+			break;
+		case GIF_BLOCK_TRAILER:
+			success = TRUE;
 			break;
 		default:
+			success = FALSE;
 			break;
 		}
-	} while (RecordType != TERMINATE_RECORD_TYPE);
 
+		if (!success) {
+			g_debug ("Could not read GIF block of type 0x%x", block_type);
+			goto error;
+		}
+	}
 
 	if (!xd) {
 		xd = tracker_xmp_new_from_sidecar (file, &sidecar);
@@ -470,6 +509,15 @@ read_metadata (GifFileType        *gifFile,
 	tracker_xmp_free (xd);
 
 	return metadata;
+
+error:
+	g_free (gd.width);
+	g_free (gd.height);
+	g_free (gd.comment);
+	if (xd)
+		tracker_xmp_free (xd);
+
+	return NULL;
 }
 
 
@@ -479,13 +527,10 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 {
 	TrackerResource *metadata;
 	goffset size;
-	GifFileType *gifFile = NULL;
+	GifReader *reader;
 	gchar *filename, *uri;
 	GFile *file;
 	int fd;
-#if GIFLIB_MAJOR >= 5
-	int err;
-#endif
 
 	file = tracker_extract_info_get_file (info);
 	filename = g_file_get_path (file);
@@ -508,33 +553,17 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		return FALSE;
 	}
 
-#if GIFLIB_MAJOR < 5
-	if ((gifFile = DGifOpenFileHandle (fd)) == NULL) {
-		print_gif_error ();
-#else   /* GIFLIB_MAJOR < 5 */
-	if ((gifFile = DGifOpenFileHandle (fd, &err)) == NULL) {
-		gif_error ("Could not open GIF file with handle", err);
-#endif /* GIFLIB_MAJOR < 5 */
-		g_free (filename);
-		close (fd);
-		return FALSE;
-	}
-
 	g_free (filename);
 
 	uri = g_file_get_uri (file);
 
-	metadata = read_metadata (gifFile, file, uri, info);
+	reader = g_new0 (GifReader, 1);
+	reader->fd = fd;
 
-	g_free (uri);
+	metadata = read_metadata (reader, file, uri, info);
 
-	if (DGifCloseFile (gifFile, NULL) != GIF_OK) {
-#if GIFLIB_MAJOR < 5
-		print_gif_error ();
-#else  /* GIFLIB_MAJOR < 5 */
-		gif_error ("Could not close GIF file", gifFile->Error);
-#endif /* GIFLIB_MAJOR < 5 */
-	}
+	g_free (reader);
+	g_free (uri);
 
 	if (metadata) {
 		tracker_extract_info_set_resource (info, metadata);
@@ -53,6 +53,7 @@
 #include <libtracker-miners-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
 
+#include "tracker-audio-header.h"
 #include "tracker-cue-sheet.h"
 #include "tracker-main.h"
 
@@ -1122,6 +1123,73 @@ common_extract_stream_metadata (MetadataExtractor    *extractor,
 #if defined(GSTREAMER_BACKEND_DISCOVERER) || \
     defined(GSTREAMER_BACKEND_GUPNP_DLNA)
 
+/* Discoverers are kept around per thread, creating their pipelines
+ * is a big part of the time spent on small files like music tracks.
+ * They are recreated after a number of files, or after unexpected
+ * errors, so a leaking or wedged pipeline does not stay forever.
+ */
+#define DISCOVERER_MAX_USES 500
+
+typedef struct {
+	GstDiscoverer *discoverer;
+	guint n_uses;
+} DiscovererSlot;
+
+static void
+discoverer_slot_free (DiscovererSlot *slot)
+{
+	g_clear_object (&slot->discoverer);
+	g_slice_free (DiscovererSlot, slot);
+}
+
+static GPrivate discoverer_slot = G_PRIVATE_INIT ((GDestroyNotify) discoverer_slot_free);
+
+static void
+discoverer_discard (void)
+{
+	DiscovererSlot *slot;
+
+	slot = g_private_get (&discoverer_slot);
+	if (slot)
+		g_clear_object (&slot->discoverer);
+}
+
+static GstDiscoverer *
+discoverer_get (GError **error)
+{
+	DiscovererSlot *slot;
+
+	slot = g_private_get (&discoverer_slot);
+	if (!slot) {
+		slot = g_slice_new0 (DiscovererSlot);
+		g_private_set (&discoverer_slot, slot);
+	}
+
+	if (slot->discoverer && slot->n_uses >= DISCOVERER_MAX_USES)
+		g_clear_object (&slot->discoverer);
+
+	if (!slot->discoverer) {
+		slot->discoverer = gst_discoverer_new (5 * GST_SECOND, error);
+		if (!slot->discoverer)
+			return NULL;
+
+#if defined(GST_TYPE_DISCOVERER_FLAGS)
+		/* Tell the discoverer to use *only* Tagreadbin backend.
+		 *  See https://bugzilla.gnome.org/show_bug.cgi?id=656345
+		 */
+		g_debug ("Using Tagreadbin backend in the GStreamer discoverer...");
+		g_object_set (slot->discoverer,
+		              "flags", GST_DISCOVERER_FLAGS_EXTRACT_LIGHTWEIGHT,
+		              NULL);
+#endif
+		slot->n_uses = 0;
+	}
+
+	slot->n_uses++;
+
+	return g_object_ref (slot->discoverer);
+}
+
 static void
 discoverer_shutdown (MetadataExtractor *extractor)
 {
@@ -1176,7 +1244,7 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 	extractor->has_video = FALSE;
 	extractor->has_audio = FALSE;
 
-	extractor->discoverer = gst_discoverer_new (5 * GST_SECOND, &error);
+	extractor->discoverer = discoverer_get (&error);
 	if (!extractor->discoverer) {
 		g_warning ("Couldn't create discoverer: %s",
 		           error ? error->message : "unknown error");
@@ -1184,22 +1252,14 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 		return FALSE;
 	}
 
-#if defined(GST_TYPE_DISCOVERER_FLAGS)
-	/* Tell the discoverer to use *only* Tagreadbin backend.
-	 *  See https://bugzilla.gnome.org/show_bug.cgi?id=656345
-	 */
-	g_debug ("Using Tagreadbin backend in the GStreamer discoverer...");
-	g_object_set (extractor->discoverer,
-	              "flags", GST_DISCOVERER_FLAGS_EXTRACT_LIGHTWEIGHT,
-	              NULL);
-#endif
-
 	info = gst_discoverer_discover_uri (extractor->discoverer,
 	                                    uri,
 	                                    &error);
 
 	if (!info) {
 		g_warning ("Nothing discovered, bailing out");
+		g_clear_error (&error);
+		discoverer_discard ();
 		return TRUE;
 	}
 
@@ -1215,6 +1275,7 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 		            error->code != GST_STREAM_ERROR_DECODE)) {
 			g_warning ("Call to gst_discoverer_discover_uri(%s) failed: %s",
 			           uri, error->message);
+			discoverer_discard ();
 		}
 		gst_discoverer_info_unref (info);
 		g_error_free (error);
@@ -1336,6 +1397,228 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 #endif /* defined(GSTREAMER_BACKEND_DISCOVERER) || \
           defined(GSTREAMER_BACKEND_GUPNP_DLNA) */
 
+#if !defined(GSTREAMER_BACKEND_GUPNP_DLNA)
+/* Plain audio files don't need a pipeline, the DLNA profile guesser
+ * does need the discoverer info though.
+ */
+static gboolean
+native_header_init_and_run (MetadataExtractor *extractor,
+                            const gchar       *uri)
+{
+	TrackerAudioHeader header;
+	g_autofree gchar *path = NULL;
+
+	path = g_filename_from_uri (uri, NULL, NULL);
+	if (!path || !tracker_audio_header_parse (path, &header))
+		return FALSE;
+
+	extractor->duration = header.duration;
+	extractor->audio_channels = header.channels;
+	extractor->audio_samplerate = header.sample_rate;
+	extractor->height = -1;
+	extractor->width = -1;
+	extractor->video_fps = -1.0;
+	extractor->aspect_ratio = -1.0;
+
+	extractor->has_image = FALSE;
+	extractor->has_video = FALSE;
+	extractor->has_audio = TRUE;
+
+	gst_tag_list_insert (extractor->tagcache,
+	                     header.tags,
+	                     GST_TAG_MERGE_APPEND);
+	tracker_audio_header_clear (&header);
+
+	return TRUE;
+}
+
+/* Videos are first read through the demuxer and parsers alone, the
+ * caps these give are enough for the common containers and codecs,
+ * without the cost of setting up (possibly hardware) decoders for
+ * every file. The discoverer is still used if anything is missing.
+ */
+#define DEMUX_TIMEOUT (5 * GST_SECOND)
+
+static void
+demux_pad_added_cb (GstElement *parsebin,
+                    GstPad     *pad,
+                    gpointer    user_data)
+{
+	GstElement *pipeline = user_data;
+	GstElement *sink;
+	GstPad *sink_pad;
+
+	sink = gst_element_factory_make ("fakesink", NULL);
+	if (!sink)
+		return;
+
+	gst_bin_add (GST_BIN (pipeline), sink);
+	gst_element_sync_state_with_parent (sink);
+
+	sink_pad = gst_element_get_static_pad (sink, "sink");
+	gst_pad_link (pad, sink_pad);
+	gst_object_unref (sink_pad);
+}
+
+static gboolean
+demux_read_pad_caps (GstElement *parsebin,
+                     GstPad     *pad,
+                     gpointer    user_data)
+{
+	MetadataExtractor *extractor = user_data;
+	GstStructure *structure;
+	GstCaps *caps;
+	const gchar *name;
+	gint num, denom;
+
+	caps = gst_pad_get_current_caps (pad);
+	if (!caps)
+		return TRUE;
+
+	structure = gst_caps_get_structure (caps, 0);
+	name = gst_structure_get_name (structure);
+
+	if (g_str_has_prefix (name, "video/")) {
+		extractor->has_video = TRUE;
+		gst_structure_get_int (structure, "width", &extractor->width);
+		gst_structure_get_int (structure, "height", &extractor->height);
+
+		if (gst_structure_get_fraction (structure, "framerate", &num, &denom) &&
+		    num > 0 && denom > 0)
+			extractor->video_fps = (gfloat) num / denom;
+		if (gst_structure_get_fraction (structure, "pixel-aspect-ratio", &num, &denom) &&
+		    num > 0 && denom > 0)
+			extractor->aspect_ratio = (gfloat) num / denom;
+	} else if (g_str_has_prefix (name, "audio/")) {
+		extractor->has_audio = TRUE;
+		gst_structure_get_int (structure, "rate", &extractor->audio_samplerate);
+		gst_structure_get_int (structure, "channels", &extractor->audio_channels);
+	}
+
+	gst_caps_unref (caps);
+
+	return TRUE;
+}
+
+static gboolean
+demux_init_and_run (MetadataExtractor *extractor,
+                    const gchar       *uri)
+{
+	g_autoptr (GstTagList) tags = NULL;
+	g_autoptr (GstToc) toc = NULL;
+	GstElement *pipeline, *source, *parsebin;
+	GstBus *bus;
+	gint64 duration = -1;
+	gboolean prerolled = FALSE, failed = FALSE;
+
+	extractor->duration = -1;
+	extractor->audio_channels = -1;
+	extractor->audio_samplerate = -1;
+	extractor->height = -1;
+	extractor->width = -1;
+	extractor->video_fps = -1.0;
+	extractor->aspect_ratio = -1.0;
+
+	extractor->has_image = FALSE;
+	extractor->has_video = FALSE;
+	extractor->has_audio = FALSE;
+
+	source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+	if (!source)
+		return FALSE;
+
+	parsebin = gst_element_factory_make ("parsebin", NULL);
+	if (!parsebin) {
+		gst_object_unref (source);
+		return FALSE;
+	}
+
+	pipeline = gst_pipeline_new (NULL);
+	gst_bin_add_many (GST_BIN (pipeline), source, parsebin, NULL);
+	g_signal_connect (parsebin, "pad-added",
+	                  G_CALLBACK (demux_pad_added_cb), pipeline);
+
+	tags = gst_tag_list_new_empty ();
+	bus = gst_element_get_bus (pipeline);
+
+	if (!gst_element_link (source, parsebin) ||
+	    gst_element_set_state (pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE)
+		failed = TRUE;
+
+	while (!failed && !prerolled) {
+		GstMessage *message;
+
+		message = gst_bus_timed_pop_filtered (bus, DEMUX_TIMEOUT,
+		                                      GST_MESSAGE_ASYNC_DONE |
+		                                      GST_MESSAGE_ERROR |
+		                                      GST_MESSAGE_ELEMENT |
+		                                      GST_MESSAGE_TAG |
+		                                      GST_MESSAGE_TOC);
+		if (!message) {
+			failed = TRUE;
+			break;
+		}
+
+		switch (GST_MESSAGE_TYPE (message)) {
+		case GST_MESSAGE_ASYNC_DONE:
+			prerolled = TRUE;
+			break;
+		case GST_MESSAGE_ERROR:
+			failed = TRUE;
+			break;
+		case GST_MESSAGE_ELEMENT:
+			/* Let the discoverer report the missing plugins */
+			if (gst_is_missing_plugin_message (message))
+				failed = TRUE;
+			break;
+		case GST_MESSAGE_TAG: {
+			GstTagList *message_tags;
+
+			/* Every sink posts the global tags, keep those once */
+			gst_message_parse_tag (message, &message_tags);
+			gst_tag_list_insert (tags, message_tags, GST_TAG_MERGE_KEEP);
+			gst_tag_list_unref (message_tags);
+			break;
+		}
+		case GST_MESSAGE_TOC:
+			if (!toc)
+				gst_message_parse_toc (message, &toc, NULL);
+			break;
+		default:
+			break;
+		}
+
+		gst_message_unref (message);
+	}
+
+	if (prerolled) {
+		gst_element_foreach_src_pad (parsebin, demux_read_pad_caps, extractor);
+		gst_element_query_duration (pipeline, GST_FORMAT_TIME, &duration);
+	}
+
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+	gst_object_unref (bus);
+	gst_object_unref (pipeline);
+
+	if (!prerolled || duration < 0)
+		return FALSE;
+	if (extractor->has_video &&
+	    (extractor->width <= 0 || extractor->height <= 0))
+		return FALSE;
+	if (!extractor->has_video &&
+	    (!extractor->has_audio ||
+	     extractor->audio_samplerate <= 0 ||
+	     extractor->audio_channels <= 0))
+		return FALSE;
+
+	extractor->duration = duration / GST_SECOND;
+	extractor->gst_toc = g_steal_pointer (&toc);
+	gst_tag_list_insert (extractor->tagcache, tags, GST_TAG_MERGE_APPEND);
+
+	return TRUE;
+}
+#endif
+
 static TrackerResource *
 tracker_extract_gstreamer (const gchar          *uri,
                            TrackerExtractInfo   *info,
@@ -1353,9 +1636,22 @@ tracker_extract_gstreamer (const gchar          *uri,
 	extractor->mime = type;
 	extractor->tagcache = gst_tag_list_new_empty ();
 
-	g_debug ("GStreamer backend in use:");
-	g_debug ("  Discoverer/GUPnP-DLNA");
-	success = discoverer_init_and_run (extractor, uri);
+#if !defined(GSTREAMER_BACKEND_GUPNP_DLNA)
+	if (type == EXTRACT_MIME_AUDIO &&
+	    native_header_init_and_run (extractor, uri)) {
+		g_debug ("Audio file header parsed without GStreamer");
+		success = TRUE;
+	} else if ((type == EXTRACT_MIME_VIDEO || type == EXTRACT_MIME_GUESS) &&
+	           demux_init_and_run (extractor, uri)) {
+		g_debug ("Stream caps read from the demuxer, without decoders");
+		success = TRUE;
+	} else
+#endif
+	{
+		g_debug ("GStreamer backend in use:");
+		g_debug ("  Discoverer/GUPnP-DLNA");
+		success = discoverer_init_and_run (extractor, uri);
+	}
 
 	if (success) {
 		cue_sheet = get_embedded_cue_sheet_data (extractor->tagcache);
@@ -1475,6 +1771,7 @@ tracker_extract_module_init (GError **error)
 
 	gst_registry_fork_set_enabled (FALSE);
 	gst_init (NULL, NULL);
+	gst_pb_utils_init ();
 	registry = gst_registry_get ();
 
 	for (i = 0; i < G_N_ELEMENTS (blocklisted); i++) {
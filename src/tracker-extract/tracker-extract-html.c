@@ -20,11 +20,11 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
 #include <string.h>
 
 #include <glib.h>
 
-#include <libxml/HTMLparser.h>
 #include <libtracker-miners-common/tracker-file-utils.h>
 #include <libtracker-miners-common/tracker-utils.h>
 #include <libtracker-extract/tracker-extract.h>
@@ -43,10 +43,12 @@ typedef struct {
 	guint has_license : 1;
 	guint has_description : 1;
 	GString *title;
-	GString *plain_text;
-	guint n_bytes_remaining;
+	TrackerTextSink *plain_text;
 } parser_data;
 
+/* Size of the chunks fed to the parser */
+#define BUFFER_SIZE 8192
+
 static gboolean
 has_attribute (const gchar **attrs,
                const gchar  *attr,
@@ -69,7 +71,7 @@ has_attribute (const gchar **attrs,
 	return FALSE;
 }
 
-static const xmlChar *
+static const gchar *
 lookup_attribute (const gchar **attrs,
                   const gchar  *attr)
 {
@@ -88,18 +90,12 @@ lookup_attribute (const gchar **attrs,
 	return NULL;
 }
 
-static void
-parser_start_element (void           *data,
-                      const xmlChar  *name_,
-                      const xmlChar **attrs_)
+static gboolean
+parser_start_element (const gchar  *name,
+                      const gchar **attrs,
+                      gpointer      data)
 {
 	parser_data *pd = data;
-	const gchar *name = (const gchar*) name_;
-	const gchar **attrs = (const gchar**) attrs_;
-
-	if (!pd || !name) {
-		return;
-	}
 
 	/* Look for RDFa triple describing the license */
 	if (g_ascii_strcasecmp (name, "a") == 0) {
@@ -108,7 +104,7 @@ parser_start_element (void           *data,
 		 */
 		if (has_attribute (attrs, "rel", "license") &&
 		    has_attribute (attrs, "about", NULL) == FALSE) {
-			const xmlChar *href;
+			const gchar *href;
 
 			href = lookup_attribute (attrs, "href");
 
@@ -121,7 +117,7 @@ parser_start_element (void           *data,
 		pd->current = READ_TITLE;
 	} else if (g_ascii_strcasecmp (name, "meta") == 0) {
 		if (has_attribute (attrs, "name", "author")) {
-			const xmlChar *author;
+			const gchar *author;
 
 			author = lookup_attribute (attrs, "content");
 
@@ -135,7 +131,7 @@ parser_start_element (void           *data,
 		}
 
 		if (has_attribute (attrs, "name", "description")) {
-			const xmlChar *desc;
+			const gchar *desc;
 
 			desc = lookup_attribute (attrs,"content");
 
@@ -146,7 +142,7 @@ parser_start_element (void           *data,
 		}
 
 		if (has_attribute (attrs, "name", "keywords")) {
-			const xmlChar* content = lookup_attribute (attrs, "content");
+			const gchar *content = lookup_attribute (attrs, "content");
 
 			if (content) {
 				gchar **keywords;
@@ -172,61 +168,139 @@ parser_start_element (void           *data,
 		/* Ignore javascript and such */
 		pd->current = READ_IGNORE;
 	}
+
+	return TRUE;
 }
 
-static void
-parser_end_element (void           *data,
-                    const xmlChar  *name_)
+static gboolean
+parser_end_element (const gchar *name,
+                    gpointer     data)
 {
 	parser_data *pd = data;
-	const gchar *name = (const gchar*) name_;
 
-        if (g_ascii_strcasecmp (name, "title") == 0 ||
-            g_ascii_strcasecmp (name, "script") == 0) {
-                    pd->current = -1;
-        }
+	if (g_ascii_strcasecmp (name, "title") == 0 ||
+	    g_ascii_strcasecmp (name, "script") == 0) {
+		pd->current = -1;
+	}
+
+	return TRUE;
 }
 
-static void
-parser_characters (void          *data,
-                   const xmlChar *ch,
-                   int            len)
+static gboolean
+parser_characters (const gchar *text,
+                   gsize        len,
+                   gpointer     data)
 {
 	parser_data *pd = data;
 
 	switch (pd->current) {
 	case READ_TITLE:
-		g_string_append (pd->title, ch);
+		g_string_append_len (pd->title, text, len);
 		break;
 	case READ_IGNORE:
 		break;
 	default:
-		if (pd->in_body && pd->n_bytes_remaining > 0) {
-			gsize text_len;
-
-			text_len = strlen (ch);
-
-			if (tracker_text_validate_utf8 (ch,
-			                                (pd->n_bytes_remaining < text_len ?
-			                                 pd->n_bytes_remaining :
-			                                 text_len),
-			                                &pd->plain_text,
-			                                NULL)) {
-				/* In the case of HTML, each string arriving this
-				 * callback is independent to any other previous
-				 * string, so need to add an explicit whitespace
-				 * separator */
-				g_string_append_c (pd->plain_text, ' ');
-			}
+		if (pd->in_body) {
+			/* Each string arriving this callback is independent
+			 * to any other previous string, so need to add an
+			 * explicit whitespace separator. Tokenizing stops
+			 * once there is all the text we want, the rest of
+			 * the file is not even read. */
+			return tracker_text_sink_append_word (pd->plain_text,
+			                                      text, len,
+			                                      NULL);
+		}
+		break;
+	}
+
+	return TRUE;
+}
+
+/* Looks for the charset declared in a <meta> tag, which is expected
+ * in the first bytes of the document.
+ */
+static gchar *
+sniff_charset (const gchar *buf,
+               gsize        len)
+{
+	const gchar *p, *end = buf + len, *start;
+
+	for (p = buf; p + 8 < end; p++) {
+		if (g_ascii_strncasecmp (p, "charset=", 8) != 0)
+			continue;
+
+		p += 8;
+		if (p < end && (*p == '"' || *p == '\''))
+			p++;
+
+		for (start = p; p < end; p++) {
+			if (!g_ascii_isalnum (*p) && *p != '-' &&
+			    *p != '_' && *p != '.' && *p != ':')
+				break;
+		}
+
+		if (p > start && p < end)
+			return g_strndup (start, p - start);
+
+		return NULL;
+	}
+
+	return NULL;
+}
 
-			if (pd->n_bytes_remaining > text_len) {
-				pd->n_bytes_remaining -= text_len;
-			} else {
-				pd->n_bytes_remaining = 0;
+static gboolean
+charset_is_utf8 (const gchar *charset)
+{
+	return (g_ascii_strcasecmp (charset, "utf-8") == 0 ||
+	        g_ascii_strcasecmp (charset, "utf8") == 0 ||
+	        g_ascii_strcasecmp (charset, "us-ascii") == 0 ||
+	        g_ascii_strcasecmp (charset, "ascii") == 0);
+}
+
+/* Converts the chunk to UTF-8 and feeds it, bytes of a character split
+ * across chunks are kept in @leftover for the next one.
+ */
+static gboolean
+feed_converted (TrackerHtmlTokenizer *tokenizer,
+                GIConv                conv,
+                GString              *leftover,
+                const gchar          *buf,
+                gsize                 len)
+{
+	gchar out[BUFFER_SIZE * 2];
+	gchar *inbuf, *outbuf;
+	gsize inbytes, outbytes;
+
+	g_string_append_len (leftover, buf, len);
+	inbuf = leftover->str;
+	inbytes = leftover->len;
+
+	while (inbytes > 0) {
+		outbuf = out;
+		outbytes = sizeof (out);
+
+		if (g_iconv (conv, &inbuf, &inbytes, &outbuf, &outbytes) == (gsize) -1) {
+			if (errno == EINVAL) {
+				/* Incomplete character at the end */
+				if (!tracker_html_tokenizer_feed (tokenizer, out, outbuf - out))
+					return FALSE;
+				break;
+			} else if (errno == EILSEQ) {
+				/* Skip the invalid byte */
+				inbuf++;
+				inbytes--;
+			} else if (errno != E2BIG) {
+				break;
 			}
 		}
-		break;
+
+		if (!tracker_html_tokenizer_feed (tokenizer, out, outbuf - out))
+			return FALSE;
 	}
+
+	g_string_erase (leftover, 0, inbuf - leftover->str);
+
+	return TRUE;
 }
 
 G_MODULE_EXPORT gboolean
@@ -235,42 +309,14 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 {
 	TrackerResource *metadata;
 	GFile *file;
-	htmlDocPtr doc;
+	TrackerHtmlTokenizer *tokenizer;
 	parser_data pd;
 	gchar *filename, *resource_uri;
-	xmlSAXHandler handler = {
-		NULL, /* internalSubset */
-		NULL, /* isStandalone */
-		NULL, /* hasInternalSubset */
-		NULL, /* hasExternalSubset */
-		NULL, /* resolveEntity */
-		NULL, /* getEntity */
-		NULL, /* entityDecl */
-		NULL, /* notationDecl */
-		NULL, /* attributeDecl */
-		NULL, /* elementDecl */
-		NULL, /* unparsedEntityDecl */
-		NULL, /* setDocumentLocator */
-		NULL, /* startDocument */
-		NULL, /* endDocument */
-		parser_start_element, /* startElement */
-		parser_end_element, /* endElement */
-		NULL, /* reference */
-		parser_characters, /* characters */
-		NULL, /* ignorableWhitespace */
-		NULL, /* processingInstruction */
-		NULL, /* comment */
-		NULL, /* xmlParserWarning */
-		NULL, /* xmlParserError */
-		NULL, /* xmlParserError */
-		NULL, /* getParameterEntity */
-		NULL, /* cdataBlock */
-		NULL, /* externalSubset */
-		1,    /* initialized */
-		NULL, /* private */
-		NULL, /* startElementNsSAX2Func */
-		NULL, /* endElementNsSAX2Func */
-		NULL  /* xmlStructuredErrorFunc */
+	FILE *f;
+	const TrackerHtmlCallbacks callbacks = {
+		parser_start_element,
+		parser_end_element,
+		parser_characters,
 	};
 
 	file = tracker_extract_info_get_file (info);
@@ -283,31 +329,74 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	pd.metadata = metadata;
 	pd.current = -1;
 	pd.in_body = FALSE;
-	pd.plain_text = g_string_new (NULL);
+	pd.has_license = FALSE;
+	pd.has_description = FALSE;
+	pd.plain_text = tracker_text_sink_new (tracker_extract_info_get_max_text (info));
 	pd.title = g_string_new (NULL);
 
-	pd.n_bytes_remaining = tracker_extract_info_get_max_text (info);
-
 	filename = g_file_get_path (file);
-	doc = htmlSAXParseFile (filename, NULL, &handler, &pd);
-	g_free (filename);
+	f = tracker_file_open (filename);
+
+	if (f) {
+		gchar buf[BUFFER_SIZE];
+		GIConv conv = (GIConv) -1;
+		GString *leftover = NULL;
+		gboolean keep_going = TRUE;
+		gsize n_read;
+
+		tokenizer = tracker_html_tokenizer_new (&callbacks, &pd);
 
-	if (doc) {
-		xmlFreeDoc (doc);
+		n_read = fread (buf, 1, sizeof (buf), f);
+
+		if (n_read > 0) {
+			gchar *charset;
+
+			charset = sniff_charset (buf, n_read);
+
+			if (charset && !charset_is_utf8 (charset)) {
+				conv = g_iconv_open ("UTF-8", charset);
+				if (conv == (GIConv) -1)
+					g_debug ("Unknown charset '%s', reading as UTF-8", charset);
+				else
+					leftover = g_string_new (NULL);
+			}
+
+			g_free (charset);
+		}
+
+		while (keep_going && n_read > 0) {
+			if (leftover)
+				keep_going = feed_converted (tokenizer, conv, leftover, buf, n_read);
+			else
+				keep_going = tracker_html_tokenizer_feed (tokenizer, buf, n_read);
+
+			if (keep_going)
+				n_read = fread (buf, 1, sizeof (buf), f);
+		}
+
+		tracker_html_tokenizer_finish (tokenizer);
+		tracker_html_tokenizer_free (tokenizer);
+
+		if (leftover) {
+			g_iconv_close (conv);
+			g_string_free (leftover, TRUE);
+		}
+
+		tracker_file_close (f, FALSE);
 	}
 
-	g_strstrip (pd.plain_text->str);
+	g_free (filename);
+
 	g_strstrip (pd.title->str);
 
 	if (*pd.title->str != '\0') {
 		tracker_resource_set_string (metadata, "nie:title", pd.title->str);
 	}
 
-	if (*pd.plain_text->str != '\0') {
-		tracker_resource_set_string (metadata, "nie:plainTextContent", pd.plain_text->str);
-	}
+	tracker_extract_info_take_text (info,
+	                                tracker_text_sink_steal_text (pd.plain_text));
 
-	g_string_free (pd.plain_text, TRUE);
+	tracker_text_sink_free (pd.plain_text);
 	g_string_free (pd.title, TRUE);
 
 	tracker_extract_info_set_resource (info, metadata);
@@ -31,6 +31,96 @@
 #include <libtracker-extract/tracker-extract.h>
 #include <libtracker-miners-common/tracker-file-utils.h>
 
+/* Media identified per volume, system, publisher and application ID */
+#define MEDIA_CACHE_SIZE 64
+
+#define NONNULL(str) ((str) ? (str) : "")
+
+static GMutex db_mutex;
+static OsinfoLoader *loader = NULL;
+static gboolean loader_failed = FALSE;
+static GHashTable *media_cache = NULL;
+
+/* Parsing the libosinfo database is expensive, it is loaded
+ * on first use and kept for the lifetime of the extractor.
+ */
+static OsinfoDb *
+get_db (void)
+{
+	GError *inner_error = NULL;
+
+	if (loader || loader_failed)
+		return loader ? osinfo_loader_get_db (loader) : NULL;
+
+	loader = osinfo_loader_new ();
+	osinfo_loader_process_default_path (loader, &inner_error);
+	if (inner_error != NULL) {
+		g_message ("Error loading libosinfo OS data: %s",
+			   inner_error->message);
+		g_error_free (inner_error);
+		g_clear_object (&loader);
+		loader_failed = TRUE;
+		return NULL;
+	}
+
+	return osinfo_loader_get_db (loader);
+}
+
+static gchar *
+get_media_key (OsinfoMedia *media)
+{
+	return g_strdup_printf ("%s\n%s\n%s\n%s",
+	                        NONNULL (osinfo_media_get_volume_id (media)),
+	                        NONNULL (osinfo_media_get_system_id (media)),
+	                        NONNULL (osinfo_media_get_publisher_id (media)),
+	                        NONNULL (osinfo_media_get_application_id (media)));
+}
+
+/* Returns media with the OS information filled in if it was identified.
+ * Media with the same IDs as a previously seen image are identified
+ * the same, without looking through the database.
+ */
+static OsinfoMedia *
+identify_media (OsinfoMedia *media)
+{
+	g_autofree gchar *key = NULL;
+	OsinfoMedia *identified;
+	OsinfoDb *db;
+
+	key = get_media_key (media);
+
+	g_mutex_lock (&db_mutex);
+
+	identified = media_cache ? g_hash_table_lookup (media_cache, key) : NULL;
+	if (identified) {
+		g_object_ref (identified);
+		g_mutex_unlock (&db_mutex);
+		return identified;
+	}
+
+	db = get_db ();
+	if (!db) {
+		g_mutex_unlock (&db_mutex);
+		return NULL;
+	}
+
+	osinfo_db_identify_media (db, media);
+
+	if (!media_cache) {
+		media_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                     g_free, g_object_unref);
+	} else if (g_hash_table_size (media_cache) >= MEDIA_CACHE_SIZE) {
+		g_hash_table_remove_all (media_cache);
+	}
+
+	g_hash_table_insert (media_cache, g_steal_pointer (&key),
+	                     g_object_ref (media));
+
+	g_mutex_unlock (&db_mutex);
+
+	return g_object_ref (media);
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info_,
                               GError             **error)
@@ -44,9 +134,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info_,
 	GFile *file;
 	GError *inner_error = NULL;
 	gchar *filename, *resource_uri;
-	OsinfoLoader *loader = NULL;
-	OsinfoMedia *media;
-	OsinfoDb *db;
+	OsinfoMedia *media, *identified;
 	OsinfoOs *os;
 	OsinfoOsVariantList *variants;
 
@@ -79,19 +167,14 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info_,
 	}
 	g_free (filename);
 
-	loader = osinfo_loader_new ();
-	osinfo_loader_process_default_path (loader, &inner_error);
-	if (inner_error != NULL) {
-		g_message ("Error loading libosinfo OS data: %s",
-			   inner_error->message);
-		g_error_free (inner_error);
-		goto no_os;
-	}
 	g_warn_if_fail (media != NULL);
-	g_warn_if_fail (loader != NULL);
 
-	db = osinfo_loader_get_db (loader);
-	osinfo_db_identify_media (db, media);
+	identified = identify_media (media);
+	if (identified == NULL)
+		goto no_os;
+
+	g_object_unref (media);
+	media = identified;
 	os = osinfo_media_get_os (media);
 
 	if (os == NULL)
@@ -143,7 +226,6 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info_,
         g_list_free (languages);
 
 	g_object_unref (media);
-	g_object_unref (loader);
 	g_object_unref (os);
 
 	tracker_extract_info_set_resource (info_, metadata);
@@ -165,9 +247,6 @@ no_os:
 	if (media != NULL) {
 		g_object_unref (G_OBJECT (media));
 	}
-	if (loader != NULL) {
-		g_object_unref (G_OBJECT (loader));
-	}
 
 	tracker_resource_add_uri (metadata, "rdf:type", "nfo:FilesystemImage");
 
@@ -178,3 +257,11 @@ no_os:
 
 	return TRUE;
 }
+
+G_MODULE_EXPORT gboolean
+tracker_extract_module_shutdown (void)
+{
+	g_clear_pointer (&media_cache, g_hash_table_unref);
+	g_clear_object (&loader);
+	return TRUE;
+}
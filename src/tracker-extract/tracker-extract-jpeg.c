@@ -21,6 +21,7 @@
 #include "config-miners.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <setjmp.h>
 
 #include <jpeglib.h>
@@ -32,6 +33,14 @@
 
 #define CMS_PER_INCH            2.54
 
+/* Metadata segments are at the start of the file, JPEGs are read
+ * up to this size without libjpeg.
+ */
+#define MAPPED_HEADER_SIZE      (256 * 1024)
+
+#define JFIF_NAMESPACE          "JFIF\0"
+#define JFIF_NAMESPACE_LENGTH   5
+
 #ifdef HAVE_LIBEXIF
 #define EXIF_NAMESPACE          "Exif"
 #define EXIF_NAMESPACE_LENGTH   4
@@ -82,6 +91,18 @@ typedef struct {
 	const gchar *gps_direction;
 } MergeData;
 
+typedef struct {
+	guint width;
+	guint height;
+	guint8 density_unit;
+	guint16 x_density;
+	guint16 y_density;
+	gchar *comment;
+	TrackerExifData *ed;
+	TrackerXmpData *xd;
+	TrackerIptcData *id;
+} JpegHeader;
+
 struct tej_error_mgr {
 	struct jpeg_error_mgr jpeg;
 	jmp_buf setjmp_buffer;
@@ -95,6 +116,222 @@ extract_jpeg_error_exit (j_common_ptr cinfo)
 	longjmp (h->setjmp_buffer, 1);
 }
 
+static void
+jpeg_header_clear (JpegHeader *header)
+{
+	g_clear_pointer (&header->ed, tracker_exif_free);
+	g_clear_pointer (&header->xd, tracker_xmp_free);
+	g_clear_pointer (&header->id, tracker_iptc_free);
+	g_clear_pointer (&header->comment, g_free);
+	memset (header, 0, sizeof (JpegHeader));
+}
+
+/* Handles COM, APP1 and APP13 segments, the same with and without
+ * libjpeg. @data is the segment payload, after the length.
+ */
+static void
+jpeg_header_add_segment (JpegHeader   *header,
+                         guint         marker,
+                         const guchar *data,
+                         gsize         len,
+                         const gchar  *uri)
+{
+	const gchar *str = (const gchar *) data;
+#ifdef HAVE_LIBIPTCDATA
+	gsize offset;
+	guint sublen;
+#endif /* HAVE_LIBIPTCDATA */
+
+	switch (marker) {
+	case JPEG_COM:
+		g_free (header->comment);
+		header->comment = g_strndup (str, len);
+		break;
+
+	case JPEG_APP0 + 1:
+#ifdef HAVE_LIBEXIF
+		if (!header->ed && len >= EXIF_NAMESPACE_LENGTH &&
+		    strncmp (EXIF_NAMESPACE, str, EXIF_NAMESPACE_LENGTH) == 0) {
+			header->ed = tracker_exif_new (data, len, uri);
+		}
+#endif /* HAVE_LIBEXIF */
+
+#ifdef HAVE_EXEMPI
+		if (!header->xd && len >= XMP_NAMESPACE_LENGTH &&
+		    memcmp (XMP_NAMESPACE, str, XMP_NAMESPACE_LENGTH) == 0) {
+			header->xd = tracker_xmp_new (str + XMP_NAMESPACE_LENGTH,
+			                              len - XMP_NAMESPACE_LENGTH,
+			                              uri);
+		}
+#endif /* HAVE_EXEMPI */
+		break;
+
+	case JPEG_APP0 + 13:
+#ifdef HAVE_LIBIPTCDATA
+		if (!header->id && len >= PS3_NAMESPACE_LENGTH &&
+		    memcmp (PS3_NAMESPACE, str, PS3_NAMESPACE_LENGTH) == 0) {
+			offset = iptc_jpeg_ps3_find_iptc (data, len, &sublen);
+			if (offset > 0 && sublen > 0) {
+				header->id = tracker_iptc_new (data + offset, sublen, uri);
+			}
+		}
+#endif /* HAVE_LIBIPTCDATA */
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Walks the segments up to the start of scan. Returns %FALSE if the
+ * walk could not get to the frame header within @len bytes.
+ */
+static gboolean
+jpeg_header_parse_segments (JpegHeader   *header,
+                            const guchar *data,
+                            gsize         len,
+                            const gchar  *uri)
+{
+	gboolean has_frame = FALSE;
+	gsize pos = 2;
+
+	if (len < 4 || data[0] != 0xFF || data[1] != 0xD8)
+		return FALSE;
+
+	while (pos + 4 <= len) {
+		guint marker;
+		gsize seg_len;
+		const guchar *seg;
+
+		if (data[pos] != 0xFF)
+			return FALSE;
+
+		marker = data[pos + 1];
+
+		/* Fill bytes */
+		if (marker == 0xFF) {
+			pos++;
+			continue;
+		}
+
+		/* Markers without a segment */
+		if (marker == 0x01 || (marker >= JPEG_RST0 && marker <= JPEG_RST0 + 7)) {
+			pos += 2;
+			continue;
+		}
+
+		/* End of image, or start of scan */
+		if (marker == JPEG_EOI || marker == 0xDA)
+			break;
+
+		seg_len = (data[pos + 2] << 8) | data[pos + 3];
+		if (seg_len < 2 || pos + 2 + seg_len > len)
+			return FALSE;
+
+		seg = &data[pos + 4];
+		seg_len -= 2;
+
+		if (marker >= 0xC0 && marker <= 0xCF &&
+		    marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			/* Start of frame: precision, height, width */
+			if (seg_len < 5)
+				return FALSE;
+
+			if (!has_frame) {
+				header->height = (seg[1] << 8) | seg[2];
+				header->width = (seg[3] << 8) | seg[4];
+				has_frame = TRUE;
+			}
+		} else if (marker == JPEG_APP0) {
+			if (seg_len >= JFIF_NAMESPACE_LENGTH + 7 &&
+			    memcmp (JFIF_NAMESPACE, seg, JFIF_NAMESPACE_LENGTH) == 0) {
+				/* Version, units, Xdensity, Ydensity */
+				header->density_unit = seg[7];
+				header->x_density = (seg[8] << 8) | seg[9];
+				header->y_density = (seg[10] << 8) | seg[11];
+			}
+		} else {
+			jpeg_header_add_segment (header, marker, seg, seg_len, uri);
+		}
+
+		pos += 2 + seg_len + 2;
+	}
+
+	/* A height of 0 is defined later in a DNL segment, leave
+	 * those to libjpeg.
+	 */
+	return has_frame && header->height > 0;
+}
+
+static gboolean
+jpeg_header_read_mapped (JpegHeader  *header,
+                         GBytes      *contents,
+                         const gchar *uri)
+{
+	const guchar *data;
+	gsize len;
+
+	data = g_bytes_get_data (contents, &len);
+	len = MIN (len, MAPPED_HEADER_SIZE);
+
+	/* The metadata parsers copy what they need, the segments
+	 * are handed over straight from the mapping.
+	 */
+	return jpeg_header_parse_segments (header, data, len, uri);
+}
+
+static gboolean
+jpeg_header_read_libjpeg (JpegHeader  *header,
+                          FILE        *f,
+                          const gchar *uri)
+{
+	struct jpeg_decompress_struct cinfo = { 0, };
+	struct tej_error_mgr tejerr;
+	struct jpeg_marker_struct *marker;
+
+	cinfo.err = jpeg_std_error (&tejerr.jpeg);
+	tejerr.jpeg.error_exit = extract_jpeg_error_exit;
+	if (setjmp (tejerr.setjmp_buffer)) {
+		jpeg_destroy_decompress (&cinfo);
+		return FALSE;
+	}
+
+	jpeg_create_decompress (&cinfo);
+
+	jpeg_save_markers (&cinfo, JPEG_COM, 0xFFFF);
+	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
+	jpeg_save_markers (&cinfo, JPEG_APP0 + 13, 0xFFFF);
+
+	jpeg_stdio_src (&cinfo, f);
+
+	jpeg_read_header (&cinfo, TRUE);
+
+	/* FIXME? It is possible that there are markers after SOS,
+	 * but there shouldn't be. Should we decompress the whole file?
+	 *
+	 * jpeg_start_decompress(&cinfo);
+	 * jpeg_finish_decompress(&cinfo);
+	 *
+	 * jpeg_calc_output_dimensions(&cinfo);
+	 */
+
+	for (marker = cinfo.marker_list; marker; marker = marker->next) {
+		jpeg_header_add_segment (header, marker->marker,
+		                         marker->data, marker->data_length,
+		                         uri);
+	}
+
+	header->width = cinfo.image_width;
+	header->height = cinfo.image_height;
+	header->density_unit = header.density_unit;
+	header->x_density = header.x_density;
+	header->y_density = header.y_density;
+
+	jpeg_destroy_decompress (&cinfo);
+
+	return TRUE;
+}
+
 static gboolean
 guess_dlna_profile (gint          width,
                     gint          height,
@@ -138,18 +375,15 @@ G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
-	struct jpeg_decompress_struct cinfo = { 0, };
-	struct tej_error_mgr tejerr;
-	struct jpeg_marker_struct *marker;
+	JpegHeader header = { 0 };
 	TrackerResource *metadata = NULL;
 	TrackerXmpData *xd = NULL;
 	TrackerExifData *ed = NULL;
 	TrackerIptcData *id = NULL;
 	MergeData md = { 0 };
 	GFile *file;
-	FILE *f;
-	goffset size;
-	gchar *filename, *uri, *resource_uri;
+	GBytes *contents;
+	gchar *uri, *resource_uri;
 	gchar *comment = NULL;
 	const gchar *dlna_profile, *dlna_mimetype;
 	GPtrArray *keywords;
@@ -157,114 +391,46 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	guint i;
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
-
-	size = tracker_file_get_size (filename);
+	contents = tracker_extract_info_get_contents (info, error);
 
-	if (size < 18) {
-		g_free (filename);
+	if (!contents || g_bytes_get_size (contents) < 18) {
 		return FALSE;
 	}
 
-	f = tracker_file_open (filename);
-	g_free (filename);
+	uri = g_file_get_uri (file);
 
-	if (!f) {
-		return FALSE;
-	}
+	/* libjpeg is only needed for the odd files whose headers
+	 * cannot be walked within the mapped size.
+	 */
+	if (!jpeg_header_read_mapped (&header, contents, uri)) {
+		g_autofree gchar *filename = NULL;
+		FILE *f = NULL;
 
-	uri = g_file_get_uri (file);
+		jpeg_header_clear (&header);
 
-	cinfo.err = jpeg_std_error (&tejerr.jpeg);
-	tejerr.jpeg.error_exit = extract_jpeg_error_exit;
-	if (setjmp (tejerr.setjmp_buffer)) {
-		success = FALSE;
-		goto fail;
+		filename = g_file_get_path (file);
+		f = tracker_file_open (filename);
+
+		if (!f || !jpeg_header_read_libjpeg (&header, f, uri)) {
+			g_clear_pointer (&f, fclose);
+			success = FALSE;
+			goto fail;
+		}
+
+		fclose (f);
 	}
 
+	ed = g_steal_pointer (&header.ed);
+	xd = g_steal_pointer (&header.xd);
+	id = g_steal_pointer (&header.id);
+	comment = g_steal_pointer (&header.comment);
+
 	resource_uri = tracker_extract_info_get_content_id (info, NULL);
 	metadata = tracker_resource_new (resource_uri);
 	tracker_resource_add_uri (metadata, "rdf:type", "nfo:Image");
 	tracker_resource_add_uri (metadata, "rdf:type", "nmm:Photo");
 	g_free (resource_uri);
 
-	jpeg_create_decompress (&cinfo);
-
-	jpeg_save_markers (&cinfo, JPEG_COM, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 13, 0xFFFF);
-
-	jpeg_stdio_src (&cinfo, f);
-
-	jpeg_read_header (&cinfo, TRUE);
-
-	/* FIXME? It is possible that there are markers after SOS,
-	 * but there shouldn't be. Should we decompress the whole file?
-	 *
-	 * jpeg_start_decompress(&cinfo);
-	 * jpeg_finish_decompress(&cinfo);
-	 *
-	 * jpeg_calc_output_dimensions(&cinfo);
-	 */
-
-	marker = (struct jpeg_marker_struct *) &cinfo.marker_list;
-
-	while (marker) {
-		gchar *str;
-		gsize len;
-#ifdef HAVE_LIBIPTCDATA
-		gsize offset;
-		guint sublen;
-#endif /* HAVE_LIBIPTCDATA */
-
-		switch (marker->marker) {
-		case JPEG_COM:
-			g_free (comment);
-			comment = g_strndup ((gchar*) marker->data, marker->data_length);
-			break;
-
-		case JPEG_APP0 + 1:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
-
-#ifdef HAVE_LIBEXIF
-			if (!ed && strncmp (EXIF_NAMESPACE, str, EXIF_NAMESPACE_LENGTH) == 0) {
-				ed = tracker_exif_new ((guchar *) marker->data, len, uri);
-			}
-#endif /* HAVE_LIBEXIF */
-
-#ifdef HAVE_EXEMPI
-			if (!xd && strncmp (XMP_NAMESPACE, str, XMP_NAMESPACE_LENGTH) == 0) {
-				xd = tracker_xmp_new (str + XMP_NAMESPACE_LENGTH,
-				                      len - XMP_NAMESPACE_LENGTH,
-				                      uri);
-			}
-#endif /* HAVE_EXEMPI */
-
-			break;
-
-		case JPEG_APP0 + 13:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
-#ifdef HAVE_LIBIPTCDATA
-			if (len > 0 && strncmp (PS3_NAMESPACE, str, PS3_NAMESPACE_LENGTH) == 0) {
-				offset = iptc_jpeg_ps3_find_iptc (str, len, &sublen);
-				if (offset > 0 && sublen > 0) {
-					id = tracker_iptc_new (str + offset, sublen, uri);
-				}
-			}
-#endif /* HAVE_LIBIPTCDATA */
-
-			break;
-
-		default:
-			marker = marker->next;
-			continue;
-		}
-
-		marker = marker->next;
-	}
-
 	if (!ed) {
 		ed = g_new0 (TrackerExifData, 1);
 	}
@@ -322,10 +488,10 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	md.model = tracker_coalesce_strip (2, xd->model, ed->model);
 
 	/* Prioritize on native dimention in all cases */
-	tracker_resource_set_int64 (metadata, "nfo:width", cinfo.image_width);
-	tracker_resource_set_int64 (metadata, "nfo:height", cinfo.image_height);
+	tracker_resource_set_int64 (metadata, "nfo:width", header.width);
+	tracker_resource_set_int64 (metadata, "nfo:height", header.height);
 
-	if (guess_dlna_profile (cinfo.image_width, cinfo.image_height, &dlna_profile, &dlna_mimetype)) {
+	if (guess_dlna_profile (header.width, header.height, &dlna_profile, &dlna_mimetype)) {
 		tracker_resource_set_string (metadata, "nmm:dlnaProfile", dlna_profile);
 		tracker_resource_set_string (metadata, "nmm:dlnaMime", dlna_mimetype);
 	}
@@ -553,37 +719,37 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		tracker_resource_set_string (metadata, "nfo:heading", md.gps_direction);
 	}
 
-	if (cinfo.density_unit != 0 || ed->x_resolution) {
+	if (header.density_unit != 0 || ed->x_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == JPEG_RESOLUTION_UNIT_UNKNOWN) {
+		if (header.density_unit == JPEG_RESOLUTION_UNIT_UNKNOWN) {
 			if (ed->resolution_unit == EXIF_RESOLUTION_UNIT_PER_CENTIMETER)
 				value = g_strtod (ed->x_resolution, NULL) * CMS_PER_INCH;
 			else
 				value = g_strtod (ed->x_resolution, NULL);
 		} else {
-			if (cinfo.density_unit == JPEG_RESOLUTION_UNIT_PER_INCH)
-				value = cinfo.X_density;
+			if (header.density_unit == JPEG_RESOLUTION_UNIT_PER_INCH)
+				value = header.x_density;
 			else
-				value = cinfo.X_density * CMS_PER_INCH;
+				value = header.x_density * CMS_PER_INCH;
 		}
 
 		tracker_resource_set_double (metadata, "nfo:horizontalResolution", value);
 	}
 
-	if (cinfo.density_unit != 0 || ed->y_resolution) {
+	if (header.density_unit != 0 || ed->y_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == JPEG_RESOLUTION_UNIT_UNKNOWN) {
+		if (header.density_unit == JPEG_RESOLUTION_UNIT_UNKNOWN) {
 			if (ed->resolution_unit == EXIF_RESOLUTION_UNIT_PER_CENTIMETER)
 				value = g_strtod (ed->y_resolution, NULL) * CMS_PER_INCH;
 			else
 				value = g_strtod (ed->y_resolution, NULL);
 		} else {
-			if (cinfo.density_unit == JPEG_RESOLUTION_UNIT_PER_INCH)
-				value = cinfo.Y_density;
+			if (header.density_unit == JPEG_RESOLUTION_UNIT_PER_INCH)
+				value = header.y_density;
 			else
-				value = cinfo.Y_density * CMS_PER_INCH;
+				value = header.y_density * CMS_PER_INCH;
 		}
 
 		tracker_resource_set_double (metadata, "nfo:verticalResolution", value);
@@ -592,7 +758,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	tracker_extract_info_set_resource (info, metadata);
 
 fail:
-	jpeg_destroy_decompress (&cinfo);
+	jpeg_header_clear (&header);
 
 	g_clear_pointer (&ed, tracker_exif_free);
 	g_clear_pointer (&xd, tracker_xmp_free);
@@ -600,7 +766,6 @@ fail:
 	g_clear_pointer (&comment, g_free);
 	g_clear_object (&metadata);
 
-	tracker_file_close (f, FALSE);
 	g_free (uri);
 
 	return success;
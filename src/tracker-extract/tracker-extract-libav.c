@@ -19,6 +19,10 @@
  */
 
 
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <glib.h>
 
 #include <libtracker-sparql/tracker-ontologies.h>
@@ -30,6 +34,186 @@
 #include <libavformat/avformat.h>
 #include <libavutil/mathematics.h>
 
+#define IO_BUFFER_SIZE 32768
+
+static int
+read_packet_cb (void    *opaque,
+                uint8_t *buf,
+                int      buf_size)
+{
+	int fd = GPOINTER_TO_INT (opaque);
+	ssize_t n_read;
+
+	do {
+		n_read = read (fd, buf, buf_size);
+	} while (n_read < 0 && errno == EINTR);
+
+	if (n_read < 0)
+		return AVERROR (errno);
+	if (n_read == 0)
+		return AVERROR_EOF;
+
+	return n_read;
+}
+
+static int64_t
+seek_cb (void    *opaque,
+         int64_t  offset,
+         int      whence)
+{
+	int fd = GPOINTER_TO_INT (opaque);
+	off_t pos;
+
+	if (whence == AVSEEK_SIZE) {
+		struct stat st;
+
+		if (fstat (fd, &st) < 0)
+			return AVERROR (errno);
+
+		return st.st_size;
+	}
+
+	pos = lseek (fd, offset, whence & ~AVSEEK_FORCE);
+	if (pos < 0)
+		return AVERROR (errno);
+
+	return pos;
+}
+
+/* Opens the file through our own fd, so it is read with the same page
+ * cache hints as in other extractors, and only probes as much of it as
+ * configured.
+ */
+static AVFormatContext *
+open_format (TrackerExtractInfo  *info,
+             int                  fd,
+             const gchar         *path,
+             AVIOContext        **io_out)
+{
+	AVFormatContext *format;
+	AVIOContext *io;
+	guint probe_size, analyze_duration;
+	guchar *buffer;
+
+	buffer = av_malloc (IO_BUFFER_SIZE);
+	if (!buffer)
+		return NULL;
+
+	io = avio_alloc_context (buffer, IO_BUFFER_SIZE, 0,
+	                         GINT_TO_POINTER (fd),
+	                         read_packet_cb, NULL, seek_cb);
+	if (!io) {
+		av_free (buffer);
+		return NULL;
+	}
+
+	format = avformat_alloc_context ();
+	if (!format) {
+		av_freep (&io->buffer);
+		avio_context_free (&io);
+		return NULL;
+	}
+
+	format->pb = io;
+
+	tracker_extract_info_get_media_probe_limits (info,
+	                                             &probe_size,
+	                                             &analyze_duration);
+
+	/* libav requires at least 32 bytes to probe */
+	if (probe_size > 0)
+		format->probesize = MAX (probe_size, 32);
+	if (analyze_duration > 0)
+		format->max_analyze_duration = (int64_t) analyze_duration * 1000;
+
+	/* The file name is only used to guess the format */
+	if (avformat_open_input (&format, path, NULL, NULL) < 0) {
+		av_freep (&io->buffer);
+		avio_context_free (&io);
+		return NULL;
+	}
+
+	*io_out = io;
+
+	return format;
+}
+
+static void
+close_format (AVFormatContext *format,
+              AVIOContext     *io)
+{
+	avformat_close_input (&format);
+	av_freep (&io->buffer);
+	avio_context_free (&io);
+}
+
+/* Whether the container headers already described the streams, so
+ * avformat_find_stream_info() does not need to decode any packets.
+ */
+static gboolean
+headers_suffice (AVFormatContext *format)
+{
+	guint i;
+
+	if (format->nb_streams == 0 ||
+	    format->duration == AV_NOPTS_VALUE ||
+	    format->duration <= 0)
+		return FALSE;
+
+	for (i = 0; i < format->nb_streams; i++) {
+		AVStream *stream = format->streams[i];
+		AVCodecParameters *codecpar = stream->codecpar;
+
+		if (codecpar->codec_id == AV_CODEC_ID_NONE)
+			return FALSE;
+
+		if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+		    (codecpar->sample_rate <= 0 || codecpar->channels <= 0))
+			return FALSE;
+
+		if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+		    !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC) &&
+		    (codecpar->width <= 0 || codecpar->height <= 0 ||
+		     stream->avg_frame_rate.num <= 0))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gint64
+get_duration (AVFormatContext *format,
+              AVStream        *stream)
+{
+	if (format->duration != AV_NOPTS_VALUE && format->duration > 0)
+		return av_rescale (format->duration, 1, AV_TIME_BASE);
+
+	if (stream->duration > 0)
+		return av_rescale (stream->duration, stream->time_base.num,
+		                   stream->time_base.den);
+
+	return 0;
+}
+
+static gint64
+get_bit_rate (AVFormatContext *format)
+{
+	int64_t size;
+
+	if (format->bit_rate > 0)
+		return format->bit_rate;
+
+	/* Without avformat_find_stream_info(), it is not estimated */
+	if (format->duration == AV_NOPTS_VALUE || format->duration <= 0)
+		return 0;
+
+	size = avio_size (format->pb);
+	if (size <= 0)
+		return 0;
+
+	return av_rescale (size * 8, AV_TIME_BASE, format->duration);
+}
+
 static AVDictionaryEntry *
 find_tag (AVFormatContext *format,
           AVStream        *stream1,
@@ -57,26 +241,45 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	gchar *content_created = NULL;
 	gchar *uri, *resource_uri;
 	AVFormatContext *format = NULL;
+	AVIOContext *io = NULL;
 	AVStream *audio_stream = NULL;
 	AVStream *video_stream = NULL;
 	int audio_stream_index;
 	int video_stream_index;
 	AVDictionaryEntry *tag = NULL;
 	const char *title = NULL;
+	gint64 duration, bit_rate;
+	int fd;
 
 	file = tracker_extract_info_get_file (info);
 
 	uri = g_file_get_uri (file);
 
 	absolute_file_path = g_file_get_path (file);
-	if (avformat_open_input (&format, absolute_file_path, NULL, NULL)) {
+	fd = tracker_file_open_fd (absolute_file_path);
+
+	if (fd == -1) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not open file: %s",
+		             g_strerror (errno));
 		g_free (absolute_file_path);
 		g_free (uri);
 		return FALSE;
 	}
+
+	format = open_format (info, fd, absolute_file_path, &io);
 	g_free (absolute_file_path);
 
-	avformat_find_stream_info (format, NULL);
+	if (!format) {
+		close (fd);
+		g_free (uri);
+		return FALSE;
+	}
+
+	if (!headers_suffice (format))
+		avformat_find_stream_info (format, NULL);
 
 	audio_stream_index = av_find_best_stream (format, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
 	if (audio_stream_index >= 0) {
@@ -89,7 +292,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	}
 
 	if (!audio_stream && !video_stream) {
-		avformat_close_input (&format);
+		close_format (format, io);
+		close (fd);
 		g_free (uri);
 		return FALSE;
 	}
@@ -121,9 +325,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 			tracker_resource_set_double (metadata, "nfo:frameRate", frame_rate);
 		}
 
-		if (video_stream->duration > 0) {
-			gint64 duration = av_rescale(video_stream->duration, video_stream->time_base.num,
-			                             video_stream->time_base.den);
+		duration = get_duration (format, video_stream);
+		if (duration > 0) {
 			tracker_resource_set_int64 (metadata, "nfo:duration", duration);
 		}
 
@@ -164,9 +367,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		tracker_resource_add_uri (metadata, "rdf:type", "nmm:MusicPiece");
 		tracker_resource_add_uri (metadata, "rdf:type", "nfo:Audio");
 
-		if (audio_stream->duration > 0) {
-			gint64 duration = av_rescale(audio_stream->duration, audio_stream->time_base.num,
-			                             audio_stream->time_base.den);
+		duration = get_duration (format, audio_stream);
+		if (duration > 0) {
 			tracker_resource_set_int64 (metadata, "nfo:duration", duration);
 		}
 
@@ -238,8 +440,9 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 			g_object_unref (performer);
 	}
 
-	if (format->bit_rate > 0) {
-		tracker_resource_set_int64 (metadata, "nfo:averageBitrate", format->bit_rate);
+	bit_rate = get_bit_rate (format);
+	if (bit_rate > 0) {
+		tracker_resource_set_int64 (metadata, "nfo:averageBitrate", bit_rate);
 	}
 
 	if ((tag = find_tag (format, audio_stream, video_stream, "comment"))) {
@@ -267,7 +470,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	g_free (content_created);
 	g_free (uri);
 
-	avformat_close_input (&format);
+	close_format (format, io);
+	close (fd);
 
 	tracker_extract_info_set_resource (info, metadata);
 	g_object_unref (metadata);
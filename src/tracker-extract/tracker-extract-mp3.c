@@ -32,10 +32,6 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 
-#ifndef G_OS_WIN32
-#include <sys/mman.h>
-#endif /* G_OS_WIN32 */
-
 #include <libtracker-miners-common/tracker-common.h>
 
 #include <libtracker-extract/tracker-extract.h>
@@ -44,15 +40,11 @@
 #warning Frame traces enabled
 #endif /* FRAME_ENABLE_TRACE */
 
-/* We mmap the beginning of the file and read separately the last 128
- * bytes for id3v1 tags. While these are probably cornercases the
- * rationale is that we don't want to fault a whole page for the last
- * 128 bytes and on the other we don't want to mmap the whole file
- * with unlimited size (might need to create private copy in some
- * special cases, finding continuous space etc). We now take 5 first
- * MB of the file and assume that this is enough. In theory there is
- * no maximum size as someone could embed 50 gigabytes of album art
- * there.
+/* The file is mapped as a whole, of which we only scan the first 5
+ * MB for tags and frames, plus the last 128 bytes for id3v1 tags.
+ * Only the pages we touch are read. In theory there is no maximum
+ * size as someone could embed 50 gigabytes of album art there, we
+ * assume 5 MB is enough.
  */
 
 #define MAX_FILE_READ     1024 * 1024 * 5
@@ -502,15 +494,20 @@ strnlen (const char *str, size_t max)
 inline static guint32
 extract_uint32 (gconstpointer data)
 {
-	const guint32 *ptr = data;
-	return GUINT32_FROM_BE (*ptr);
+	guint32 value;
+
+	/* Fields are not aligned in the file */
+	memcpy (&value, data, sizeof (value));
+	return GUINT32_FROM_BE (value);
 }
 
 inline static guint16
 extract_uint16 (gconstpointer data)
 {
-	const guint16 *ptr = data;
-	return GUINT16_FROM_BE (*ptr);
+	guint16 value;
+
+	memcpy (&value, data, sizeof (value));
+	return GUINT16_FROM_BE (value);
 }
 
 inline static guint32
@@ -626,49 +623,6 @@ guess_dlna_profile (gint          bitrate,
 	return FALSE;
 }
 
-static char *
-read_id3v1_buffer (int     fd,
-                   goffset size)
-{
-	char *buffer;
-	guint bytes_read;
-	guint rc;
-
-	if (size < 128) {
-		return NULL;
-	}
-
-	if (lseek (fd, size - ID3V1_SIZE, SEEK_SET) < 0) {
-		return NULL;
-	}
-
-	buffer = g_malloc (ID3V1_SIZE);
-
-	if (!buffer) {
-		return NULL;
-	}
-
-	bytes_read = 0;
-
-	while (bytes_read < ID3V1_SIZE) {
-		rc = read (fd,
-		           buffer + bytes_read,
-		           ID3V1_SIZE - bytes_read);
-		if (rc == -1) {
-			if (errno != EINTR) {
-				g_free (buffer);
-				return NULL;
-			}
-		} else if (rc == 0) {
-			break;
-		} else {
-			bytes_read += rc;
-		}
-	}
-
-	return buffer;
-}
-
 /* Convert from UCS-2 to UTF-8 checking the BOM.*/
 static gchar *
 ucs2_to_utf8(const gchar *data, guint len)
@@ -784,17 +738,20 @@ un_unsync (const unsigned char *source,
 }
 
 static gchar *
-get_encoding (const gchar *data,
+get_encoding (GFile       *file,
+              const gchar *data,
               gsize        size,
               gboolean    *encoding_found)
 {
 	gdouble confidence = 1;
-	gchar *encoding;
+	gchar *encoding = NULL;
 
-	/* Try to guess encoding */
-	encoding = (data && size ?
-	            tracker_encoding_guess (data, size, &confidence) :
-	            NULL);
+	/* Try to guess encoding, tags of files in the same folder are
+	 * likely written by the same software. */
+	if (data && size && file)
+		encoding = tracker_encoding_guess_for_file (file, data, size, &confidence);
+	else if (data && size)
+		encoding = tracker_encoding_guess (data, size, &confidence);
 
 	if (confidence < 0.5) {
 		/* Confidence on the results was too low, bail out and
@@ -845,7 +802,7 @@ convert_to_encoding (const gchar  *str,
 	if (error) {
 		gchar *encoding;
 
-		encoding = get_encoding (str, len, NULL);
+		encoding = get_encoding (NULL, str, len, NULL);
 		g_free (word);
 
 		word = g_convert (str,
@@ -864,7 +821,8 @@ convert_to_encoding (const gchar  *str,
 }
 
 static gboolean
-get_id3 (const gchar *data,
+get_id3 (GFile       *file,
+         const gchar *data,
          size_t       size,
          id3tag      *id3)
 {
@@ -904,7 +862,7 @@ get_id3 (const gchar *data,
 		g_string_append_len (s, pos + 60, strnlen (pos+60, 30));
 		g_string_append_len (s, pos + 94, strnlen (pos+94, ((pos+94)[28] != 0) ? 30 : 28));
 
-		encoding = get_encoding (s->str, s->len, &encoding_was_found);
+		encoding = get_encoding (file, s->str, s->len, &encoding_was_found);
 
 		if (encoding_was_found) {
 			id3->encoding = g_strdup (encoding);
@@ -914,7 +872,7 @@ get_id3 (const gchar *data,
 	} else {
 		/* If we cannot guess encoding, don't even try it, just
 		 * use the default one */
-		encoding = get_encoding (NULL, 0, NULL);
+		encoding = get_encoding (NULL, NULL, 0, NULL);
 	}
 
 	id3->title = g_convert (pos, 30, "UTF-8", encoding, NULL, NULL, NULL);
@@ -958,17 +916,26 @@ get_id3 (const gchar *data,
 	return TRUE;
 }
 
+/* Reads the frame count and stream size from the Xing/Info header
+ * written by LAME and others, or from the VBRI header written by
+ * Fraunhofer encoders. Either is found in the first frame.
+ */
 static gboolean
-mp3_parse_xing_header (const gchar          *data,
-                       size_t                frame_pos,
-                       gchar                 mpeg_version,
-                       gint                  n_channels,
-                       guint32              *nr_frames)
+mp3_parse_vbr_header (const gchar          *data,
+                      size_t                size,
+                      size_t                frame_pos,
+                      gchar                 mpeg_version,
+                      gint                  n_channels,
+                      guint32              *nr_frames,
+                      guint32              *nr_bytes)
 {
 	guint32 field_flags;
 	size_t pos;
 	guint xing_header_offset;
 
+	*nr_frames = 0;
+	*nr_bytes = 0;
+
 	if (mpeg_version == MPEG_V1) {
 		xing_header_offset = (n_channels == 1) ? 21: 36;
 	} else {
@@ -977,22 +944,42 @@ mp3_parse_xing_header (const gchar          *data,
 
 	pos = frame_pos + xing_header_offset;
 
-	/* header starts with "Xing" or "Info" */
-	if ((data[pos] == 0x58 && data[pos+1] == 0x69 && data[pos+2] == 0x6E && data[pos+3] == 0x67) ||
-	    (data[pos] == 0x49 && data[pos+1] == 0x6E && data[pos+2] == 0x46 && data[pos+3] == 0x6F)) {
+	/* header starts with "Xing" or "Info", followed by the flags
+	 * and the optional frames and bytes fields.
+	 */
+	if (pos + 16 <= size &&
+	    (memcmp (&data[pos], "Xing", 4) == 0 ||
+	     memcmp (&data[pos], "Info", 4) == 0)) {
 		g_debug ("XING header found");
-	} else {
-		return FALSE;
+
+		pos += 4;
+		field_flags = extract_uint32 (&data[pos]);
+		pos += 4;
+
+		if ((field_flags & 0x0001) > 0) {
+			*nr_frames = extract_uint32 (&data[pos]);
+			pos += 4;
+		}
+
+		if ((field_flags & 0x0002) > 0 && pos + 4 <= size)
+			*nr_bytes = extract_uint32 (&data[pos]);
+
+		return TRUE;
 	}
 
-	/* Try to extract the number of frames if the frames field flag is set */
-	pos += 4;
-	field_flags = extract_uint32 (&data[pos]);
-	if ((field_flags & 0x0001) > 0) {
-		*nr_frames = extract_uint32 (&data[pos+4]);
+	/* The VBRI header comes at a fixed offset after the frame header */
+	pos = frame_pos + 4 + 32;
+
+	if (pos + 18 <= size && memcmp (&data[pos], "VBRI", 4) == 0) {
+		g_debug ("VBRI header found");
+
+		*nr_bytes = extract_uint32 (&data[pos + 10]);
+		*nr_frames = extract_uint32 (&data[pos + 14]);
+
+		return TRUE;
 	}
 
-	return TRUE;
+	return FALSE;
 }
 
 /*
@@ -1023,7 +1010,7 @@ mp3_parse_header (const gchar          *data,
 	guint frames = 0;
 	size_t pos = 0;
 	gint n_channels;
-	guint32 xing_nr_frames = 0;
+	guint32 vbr_nr_frames = 0, vbr_nr_bytes = 0;
 
 	pos = seek_pos;
 
@@ -1070,86 +1057,109 @@ mp3_parse_header (const gchar          *data,
 
 	spfp8 = spf_table[idx_num];
 
-	/* We assume mpeg version, layer and channels are constant in frames */
-	do {
-		frames++;
+	n_channels = ((header & ch_mask) == ch_mask) ? 1 : 2;
 
+	if (mp3_parse_vbr_header (data, size, seek_pos, mpeg_ver, n_channels,
+	                          &vbr_nr_frames, &vbr_nr_bytes) &&
+	    vbr_nr_frames > 0) {
+		guint next_header;
+
+		/* The encoder told the number of frames, there is no need
+		 * to scan them.
+		 */
 		bitrate = 1000 * bitrate_table[(header & bitrate_mask) >> 20][idx_num];
+		sample_rate = freq_table[(header & freq_mask) >> 18][mpeg_ver - 1];
 
-		/* Skip frame headers with bitrate index '0000' (free) or '1111' (bad) */
-		if (bitrate <= 0) {
-			frames--;
+		if (bitrate <= 0 || sample_rate <= 0)
 			return FALSE;
-		}
 
-		sample_rate = freq_table[(header & freq_mask) >> 18][mpeg_ver - 1];
+		/* The next frame must follow, to check the right position */
+		frame_size = spfp8 * bitrate / sample_rate + padsize*((header & pad_mask) >> 17);
+		pos += frame_size;
 
-		/* Skip frame headers with frequency index '11' (reserved) */
-		if (sample_rate <= 0) {
-			frames--;
+		if (pos + sizeof (next_header) > size)
 			return FALSE;
-		}
 
-		frame_size = spfp8 * bitrate / sample_rate + padsize*((header & pad_mask) >> 17);
-		avg_bps += bitrate / 1000;
+		memcpy (&next_header, &data[pos], sizeof (next_header));
+		if ((next_header & sync_mask) != sync_mask)
+			return FALSE;
 
-		pos += frame_size;
+		if (vbr_nr_bytes == 0)
+			vbr_nr_bytes = filedata->size - filedata->id3v2_size;
 
-		if (frames > MAX_FRAMES_SCAN) {
-			/* Optimization */
-			break;
-		}
+		length = (guint64) spfp8 * 8 * vbr_nr_frames / sample_rate;
+		avg_bps = (guint64) vbr_nr_bytes * sample_rate / ((guint64) spfp8 * vbr_nr_frames) / 1000;
+	} else {
+		/* We assume mpeg version, layer and channels are constant in frames */
+		do {
+			frames++;
 
-		if (avg_bps / frames != bitrate / 1000) {
-			vbr_flag = 1;
-		}
+			bitrate = 1000 * bitrate_table[(header & bitrate_mask) >> 20][idx_num];
 
-		if (pos + sizeof (header) > size) {
-			/* EOF */
-			break;
-		}
+			/* Skip frame headers with bitrate index '0000' (free) or '1111' (bad) */
+			if (bitrate <= 0) {
+				frames--;
+				return FALSE;
+			}
 
-		if ((!vbr_flag) && (frames > VBR_THRESHOLD)) {
-			break;
-		}
+			sample_rate = freq_table[(header & freq_mask) >> 18][mpeg_ver - 1];
 
-		memcpy(&header, &data[pos], sizeof (header));
-	} while ((header & sync_mask) == sync_mask);
+			/* Skip frame headers with frequency index '11' (reserved) */
+			if (sample_rate <= 0) {
+				frames--;
+				return FALSE;
+			}
 
-	/* At least 2 frames to check the right position */
-	if (frames < 2) {
-		/* No valid frames */
-		return FALSE;
-	}
+			frame_size = spfp8 * bitrate / sample_rate + padsize*((header & pad_mask) >> 17);
+			avg_bps += bitrate / 1000;
 
-	n_channels = ((header & ch_mask) == ch_mask) ? 1 : 2;
+			pos += frame_size;
 
-	/* If the file is encoded in variable bit mode (VBR),
-	   try to get the number of frames from the xing header
-	   to compute the file duration.  */
-	if (vbr_flag) {
-		mp3_parse_xing_header (data, seek_pos, mpeg_ver, n_channels, &xing_nr_frames);
-	}
+			if (frames > MAX_FRAMES_SCAN) {
+				/* Optimization */
+				break;
+			}
 
-	tracker_resource_set_string (resource, "nfo:codec", "MPEG");
+			if (avg_bps / frames != bitrate / 1000) {
+				vbr_flag = 1;
+			}
 
-	tracker_resource_set_int (resource, "nfo:channels", n_channels);
+			if (pos + sizeof (header) > size) {
+				/* EOF */
+				break;
+			}
 
-	avg_bps /= frames;
+			if ((!vbr_flag) && (frames > VBR_THRESHOLD)) {
+				break;
+			}
 
-	if (vbr_flag && xing_nr_frames > 0) {
-		/* If the file is encoded with variable bitrate mode (VBR)
-		   and the number of frame is known */
-		length = spfp8 * 8 * xing_nr_frames / sample_rate;
-	} else if ((!vbr_flag && frames > VBR_THRESHOLD) || (frames > MAX_FRAMES_SCAN)) {
-		/* If not all frames scanned
-		 * Note that bitrate is always > 0, checked before */
-		length = (filedata->size - filedata->id3v2_size) / (avg_bps ? avg_bps : (bitrate / 1000)) / 125;
-	} else {
-		/* Note that sample_rate is always > 0, checked before */
-		length = spfp8 * 8 * frames / sample_rate;
+			memcpy(&header, &data[pos], sizeof (header));
+		} while ((header & sync_mask) == sync_mask);
+
+		/* At least 2 frames to check the right position */
+		if (frames < 2) {
+			/* No valid frames */
+			return FALSE;
+		}
+
+		n_channels = ((header & ch_mask) == ch_mask) ? 1 : 2;
+
+		avg_bps /= frames;
+
+		if ((!vbr_flag && frames > VBR_THRESHOLD) || (frames > MAX_FRAMES_SCAN)) {
+			/* If not all frames scanned
+			 * Note that bitrate is always > 0, checked before */
+			length = (filedata->size - filedata->id3v2_size) / (avg_bps ? avg_bps : (bitrate / 1000)) / 125;
+		} else {
+			/* Note that sample_rate is always > 0, checked before */
+			length = spfp8 * 8 * frames / sample_rate;
+		}
 	}
 
+	tracker_resource_set_string (resource, "nfo:codec", "MPEG");
+
+	tracker_resource_set_int (resource, "nfo:channels", n_channels);
+
 	tracker_resource_set_int64 (resource, "nfo:duration", length);
 	tracker_resource_set_int64 (resource, "nfo:sampleRate", sample_rate);
 	tracker_resource_set_int64 (resource, "nfo:averageBitrate", avg_bps*1000);
@@ -1172,28 +1182,32 @@ mp3_parse (const gchar          *data,
            TrackerResource      *resource,
            MP3Data              *filedata)
 {
-	guint header;
-	guint counter = 0;
-	guint pos = offset;
+	const gchar *sync;
+	size_t pos, end;
 
-	do {
-		/* Seek for frame start */
-		if (pos + sizeof (header) > size) {
+	if (size < sizeof (guint) || offset > size - sizeof (guint))
+		return FALSE;
+
+	/* Positions where a whole frame header fits */
+	end = MIN (size - sizeof (guint) + 1, offset + MAX_MP3_SCAN_DEEP);
+	pos = offset;
+
+	while (pos < end) {
+		/* Seek for frame start, the sync bits begin with a 0xFF byte */
+		sync = memchr (&data[pos], 0xFF, end - pos);
+		if (!sync)
 			return FALSE;
-		}
 
-		memcpy (&header, &data[pos], sizeof (header));
+		pos = sync - data;
 
-		if ((header & sync_mask) == sync_mask) {
-			/* Found header sync */
-			if (mp3_parse_header (data, size, pos, uri, resource, filedata)) {
-				return TRUE;
-			}
+		/* Found header sync if the next byte completes it */
+		if (((guchar) data[pos + 1] & 0xE0) == 0xE0 &&
+		    mp3_parse_header (data, size, pos, uri, resource, filedata)) {
+			return TRUE;
 		}
 
 		pos++;
-		counter++;
-	} while (counter < MAX_MP3_SCAN_DEEP);
+	}
 
 	return FALSE;
 }
@@ -2637,12 +2651,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
 	g_autofree char *resource_uri = NULL;
-	gchar *filename, *uri;
-	int fd;
-	void *buffer;
-	void *id3v1_buffer;
-	goffset size;
-	goffset  buffer_size;
+	gchar *uri;
+	GBytes *contents;
+	const gchar *buffer;
+	gsize size;
+	gsize buffer_size;
 	goffset audio_offset;
 	MP3Data md = { 0 };
 	GFile *file;
@@ -2650,49 +2663,25 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	TrackerResource *main_resource;
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
+	contents = tracker_extract_info_get_contents (info, error);
 
-	size = tracker_file_get_size (filename);
-
-	if (size == 0) {
-		g_free (filename);
+	if (!contents) {
 		return FALSE;
 	}
 
-	md.size = size;
-	buffer_size = MIN (size, MAX_FILE_READ);
-
-	fd = tracker_file_open_fd (filename);
+	buffer = g_bytes_get_data (contents, &size);
 
-	if (fd == -1) {
+	if (size == 0) {
 		return FALSE;
 	}
 
-#ifndef G_OS_WIN32
-	/* We don't use GLib's mmap because size can not be specified */
-	buffer = mmap (NULL,
-	               buffer_size,
-	               PROT_READ,
-	               MAP_PRIVATE,
-	               fd,
-	               0);
-#endif
-
-	id3v1_buffer = read_id3v1_buffer (fd, size);
-
-	close (fd);
-
-	if (buffer == NULL || buffer == (void*) -1) {
-		g_free (filename);
-		return FALSE;
-	}
+	md.size = size;
+	buffer_size = MIN (size, MAX_FILE_READ);
 
-	if (!get_id3 (id3v1_buffer, ID3V1_SIZE, &md.id3v1)) {
-		/* Do nothing? */
+	if (size >= ID3V1_SIZE) {
+		get_id3 (file, &buffer[size - ID3V1_SIZE], ID3V1_SIZE, &md.id3v1);
 	}
 
-	g_free (id3v1_buffer);
-
 	resource_uri = tracker_extract_info_get_content_id (info, NULL);
 	main_resource = tracker_resource_new (resource_uri);
 
@@ -3001,16 +2990,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	id3v2tag_free (&md.id3v24);
 	id3tag_free (&md.id3v1);
 
-#ifndef G_OS_WIN32
-	munmap (buffer, buffer_size);
-#endif
-
 	if (main_resource) {
 		tracker_extract_info_set_resource (info, main_resource);
 		g_object_unref (main_resource);
 	}
 
-	g_free (filename);
 	g_free (uri);
 
 	return parsed;
@@ -62,6 +62,7 @@ typedef enum {
 typedef struct {
 	/* Common constant stuff */
 	const gchar *uri;
+	TrackerGsfArchive *archive;
 	MsOfficeXMLFileType file_type;
 
 	/* Tag type, reused by Content and Metadata parsers */
@@ -618,10 +619,10 @@ xml_read (MsOfficeXMLParserInfo *parser_info,
 
 		/* Load the internal XML file from the Zip archive, and parse it
 		 * using the given context */
-		tracker_gsf_parse_xml_in_zip (parser_info->uri,
-		                              xml_filename,
-		                              context,
-		                              &error);
+		tracker_gsf_archive_parse_xml (parser_info->archive,
+		                               xml_filename,
+		                               context,
+		                               &error);
 		g_markup_parse_context_free (context);
 
 		if (error) {
@@ -841,6 +842,14 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	info.generator_already_set = FALSE;
 	info.bytes_pending = tracker_extract_info_get_max_text (extract_info);
 
+	info.archive = tracker_gsf_archive_open (uri, &inner_error);
+	if (!info.archive) {
+		g_propagate_prefixed_error (error, inner_error, "Could not open:");
+		g_object_unref (metadata);
+		g_free (uri);
+		return FALSE;
+	}
+
 	/* Create content-type parser context */
 	context = g_markup_parse_context_new (&content_types_parser,
 	                                      0,
@@ -850,12 +859,17 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	info.timer = g_timer_new ();
 	/* Load the internal XML file from the Zip archive, and parse it
 	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri,
-	                              "[Content_Types].xml",
-	                              context,
-	                              &inner_error);
+	tracker_gsf_archive_parse_xml (info.archive,
+	                               "[Content_Types].xml",
+	                               context,
+	                               &inner_error);
 	if (inner_error) {
 		g_propagate_prefixed_error (error, inner_error, "Could not open:");
+		tracker_gsf_archive_close (info.archive);
+		g_timer_destroy (info.timer);
+		g_markup_parse_context_free (context);
+		g_object_unref (metadata);
+		g_free (uri);
 		return FALSE;
 	}
 
@@ -863,15 +877,9 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 
 	/* If we got any content, add it */
 	if (info.content) {
-		gchar *content;
-
-		content = g_string_free (info.content, FALSE);
+		tracker_extract_info_take_text (extract_info,
+		                                g_string_free (info.content, FALSE));
 		info.content = NULL;
-
-		if (content) {
-			tracker_resource_set_string (metadata, "nie:plainTextContent", content);
-			g_free (content);
-		}
 	}
 
 	if (info.parts) {
@@ -879,6 +887,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 		g_list_free (info.parts);
 	}
 
+	tracker_gsf_archive_close (info.archive);
 	g_timer_destroy (info.timer);
 	g_markup_parse_context_free (context);
 	g_free (uri);
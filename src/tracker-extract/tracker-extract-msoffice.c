@@ -364,74 +364,136 @@ read_32bit (const guint8 *buffer)
 	return buffer[0] + (buffer[1] << 8) + (buffer[2] << 16) + (buffer[3] << 24);
 }
 
+/* Characters 0x80 to 0x9F of CP1252, the rest match ISO-8859-1 */
+static const gunichar cp1252_c1_chars[32] = {
+	0x20AC, 0xFFFD, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0xFFFD, 0x017D, 0xFFFD,
+	0xFFFD, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0xFFFD, 0x017E, 0x0178,
+};
+
 /**
  * @brief Common conversion and normalization method for all msoffice type
  *  documents.
  * @param buffer Input buffer with the string contents
  * @param chunk_size Number of valid bytes in the input buffer
  * @param is_ansi If %TRUE, input text should be encoded in CP1252, and
- *  in UTF-16 otherwise.
+ *  in UTF-16LE otherwise.
  * @param p_bytes_remaining Pointer to #gsize specifying how many bytes
- *  should still be considered.
+ *  should still be considered. It is set to 0 once a character does not
+ *  fit.
  * @param p_content Pointer to a #GString where the output normalized words
  *  will be appended.
+ *
+ * Text is decoded straight into @p_content in a single pass, as most of
+ * it is ASCII, instead of going through iconv for every chunk.
  */
 static void
-msoffice_convert_and_normalize_chunk (guint8    *buffer,
-                                      gsize      chunk_size,
-                                      gboolean   is_ansi,
-                                      gsize     *bytes_remaining,
-                                      GString  **content)
+msoffice_convert_and_normalize_chunk (const guint8  *buffer,
+                                      gsize          chunk_size,
+                                      gboolean       is_ansi,
+                                      gsize         *bytes_remaining,
+                                      GString      **content)
 {
-	gsize n_bytes_utf8;
-	gchar *converted_text;
-	GError *error = NULL;
+	gsize i, len, max_len, written = 0;
+	gboolean full = FALSE;
+	gchar *out;
 
 	g_return_if_fail (buffer != NULL);
 	g_return_if_fail (chunk_size > 0);
 	g_return_if_fail (bytes_remaining != NULL);
 	g_return_if_fail (content != NULL);
 
-	/* chunks can have different encoding
-	 *
-	 * TODO: Using g_iconv, this extra heap allocation could be
-	 * avoided, re-using over and over again the same output buffer
-	 * for the UTF-8 encoded string
-	 */
-	converted_text = g_convert (buffer,
-	                            chunk_size,
-	                            "UTF-8",
-	                            is_ansi ? "CP1252" : "UTF-16",
-	                            NULL,
-	                            &n_bytes_utf8,
-	                            &error);
-
-	if (converted_text) {
-		gsize len_to_validate;
-
-		len_to_validate = MIN (*bytes_remaining, n_bytes_utf8);
-
-		if (tracker_text_validate_utf8 (converted_text,
-		                                len_to_validate,
-		                                content,
-		                                NULL)) {
-			/* A whitespace is added to separate next strings appended */
-			g_string_append_c (*content, ' ');
+	if (!*content)
+		*content = g_string_new (NULL);
+
+	/* Characters take at most 3 UTF-8 bytes per input byte in CP1252,
+	 * and per code unit in UTF-16. */
+	max_len = MIN (*bytes_remaining,
+	               is_ansi ? chunk_size * 3 : (chunk_size / 2) * 3);
+	len = (*content)->len;
+	g_string_set_size (*content, len + max_len);
+	out = &(*content)->str[len];
+
+	i = 0;
+
+	while (i < chunk_size) {
+		gunichar ch;
+		gint ch_len;
+
+		if (is_ansi) {
+			/* Runs of ASCII are copied as is */
+			while (i < chunk_size && buffer[i] < 0x80 &&
+			       written < max_len) {
+				if (buffer[i] != 0)
+					out[written++] = buffer[i];
+				i++;
+			}
+
+			if (i == chunk_size)
+				break;
+			if (written == max_len) {
+				full = TRUE;
+				break;
+			}
+
+			ch = buffer[i++];
+			if (ch < 0xA0)
+				ch = cp1252_c1_chars[ch - 0x80];
+		} else {
+			if (i + 1 >= chunk_size)
+				break;
+
+			while (i + 1 < chunk_size && buffer[i + 1] == 0 &&
+			       buffer[i] < 0x80 && written < max_len) {
+				if (buffer[i] != 0)
+					out[written++] = buffer[i];
+				i += 2;
+			}
+
+			if (i + 1 >= chunk_size)
+				break;
+			if (written == max_len) {
+				full = TRUE;
+				break;
+			}
+
+			ch = read_16bit (&buffer[i]);
+			i += 2;
+
+			if (ch >= 0xD800 && ch < 0xDC00 && i + 1 < chunk_size &&
+			    read_16bit (&buffer[i]) >= 0xDC00 &&
+			    read_16bit (&buffer[i]) < 0xE000) {
+				ch = 0x10000 + ((ch - 0xD800) << 10) +
+					(read_16bit (&buffer[i]) - 0xDC00);
+				i += 2;
+			} else if (ch >= 0xD800 && ch < 0xE000) {
+				/* Unpaired surrogate */
+				ch = 0xFFFD;
+			}
 		}
 
-		/* Update accumulated UTF-8 bytes read */
-		*bytes_remaining -= len_to_validate;
-		g_free (converted_text);
-	} else {
-		g_warning ("Couldn't convert %" G_GSIZE_FORMAT " bytes from %s to UTF-8: %s",
-		           chunk_size,
-		           is_ansi ? "CP1252" : "UTF-16",
-		           error ? error->message : "no error given");
+		ch_len = g_unichar_to_utf8 (ch, NULL);
+		if (written + ch_len > max_len) {
+			full = TRUE;
+			break;
+		}
+
+		written += g_unichar_to_utf8 (ch, &out[written]);
 	}
 
-	/* Note that error may be set even if some converted text is
-	 * available, due to G_CONVERT_ERROR_ILLEGAL_SEQUENCE for example */
-	g_clear_error (&error);
+	g_string_truncate (*content, len + written);
+
+	/* Once the limit is hit, no further text is taken */
+	if (full)
+		*bytes_remaining = 0;
+	else
+		*bytes_remaining -= written;
+
+	if (written > 0) {
+		/* A whitespace is added to separate next strings appended */
+		g_string_append_c (*content, ' ');
+	}
 }
 
 /**
@@ -957,202 +1019,147 @@ extract_msword_content (GsfInfile *infile,
 	return content ? g_string_free (content, FALSE) : NULL;
 }
 
-/* Reads and interprets the flags of a given string. May be
- *  used just to skip the fields, as when this bitmask-byte
- *  comes as the first byte of a new record.
- * NOTE: For a detailed meaning of each field parsed here,
- *  take a look at the XLUnicodeRichExtendedString format:
- *  http://msdn.microsoft.com/en-us/library/dd943830.aspx
- **/
-static void
-read_excel_string_flags (GsfInput *stream,
-                         gboolean *p_is_high_byte,
-                         guint16  *p_c_run,
-                         guint16  *p_cb_ext_rst)
-{
-	guint8 tmp_buffer[4] = { 0 };
-	guint8 bit_mask;
-	gboolean is_ext_string;
-	gboolean is_rich_string;
+/* The SST record and its CONTINUE records are read whole, one at a
+ * time, and the strings in them are parsed from memory.
+ */
+typedef struct {
+	GsfInput *stream;
+	GArray *records;
+	guint current;
+	guint8 *data;
+	gsize len;
+	gsize pos;
+} ExcelRecordReader;
 
-	/* Note that output arguments may be NULL if we don't need
-	 * their values... */
+static gboolean
+excel_reader_load_record (ExcelRecordReader *reader,
+                          guint              index)
+{
+	ExcelExtendedStringRecord *record;
 
-	/* Reading 1 byte for mask */
-	gsf_input_read (stream, 1, tmp_buffer);
-	bit_mask = read_8bit (tmp_buffer);
+	if (index >= reader->records->len)
+		return FALSE;
 
-	/* Get flags */
-	if (p_is_high_byte) {
-		*p_is_high_byte = (bit_mask & 0x01) == 0x01;
-	}
-	is_ext_string = (bit_mask & 0x04) == 0x04;
-	is_rich_string = (bit_mask & 0x08) == 0x08;
+	record = &g_array_index (reader->records,
+	                         ExcelExtendedStringRecord,
+	                         index);
 
-	/* If the c_run value is required as output, read it */
-	if (p_c_run) {
-		if (is_rich_string) {
-			/* Reading 2 Bytes */
-			gsf_input_read (stream, 2, tmp_buffer);
+	/* Record lengths come from 16 bit fields, see extract_excel_content() */
+	if (record->length > G_MAXUINT16 ||
+	    gsf_input_seek (reader->stream, record->offset, G_SEEK_SET))
+		return FALSE;
 
-			/* Reading cRun */
-			*p_c_run = read_16bit (tmp_buffer);
-		} else {
-			*p_c_run = 0;
-		}
-	} else if (is_rich_string) {
-		/* If not required, just skip those bytes */
-		gsf_input_seek (stream, 2, G_SEEK_CUR);
-	}
+	if (record->length > 0 &&
+	    !gsf_input_read (reader->stream, record->length, reader->data))
+		return FALSE;
 
-	/* If the cb_ext_rst value is required as output, read it */
-	if (p_cb_ext_rst) {
-		if (is_ext_string) {
-			/* Reading 4 Bytes */
-			gsf_input_read (stream, 4, tmp_buffer);
+	reader->current = index;
+	reader->len = record->length;
+	reader->pos = 0;
 
-			/* Reading cRun */
-			*p_cb_ext_rst = read_16bit (tmp_buffer);
-		} else {
-			*p_cb_ext_rst = 0;
-		}
-	} else if (is_ext_string) {
-		/* If not required, just skip those bytes */
-		gsf_input_seek (stream, 4, G_SEEK_CUR);
-	}
+	return TRUE;
 }
 
-/* Returns TRUE if record was changed. BUT, the value of the
- *  current_record should be checked by the caller to know
- *  if there are no more records */
-static gboolean
-change_excel_record_if_needed (GsfInput *stream,
-                               GArray   *record_array,
-                               guint    *p_current_record)
+/* Returns the next @size bytes, which are never split across
+ * records, or %NULL if there are not as many.
+ */
+static const guint8 *
+excel_reader_read (ExcelRecordReader *reader,
+                   gsize              size)
 {
-	ExcelExtendedStringRecord *record;
+	const guint8 *data;
 
-	/* Get current record */
-	record = &g_array_index (record_array,
-	                         ExcelExtendedStringRecord,
-	                         *p_current_record);
+	if (reader->pos >= reader->len &&
+	    !excel_reader_load_record (reader, reader->current + 1))
+		return NULL;
 
-	/* We may already have surpassed the record, so adjust if so */
-	if (gsf_input_tell (stream) >= (record->offset + record->length)) {
-		/* Switch records and read from the second one... */
-		(*p_current_record)++;
+	if (reader->pos + size > reader->len)
+		return NULL;
 
-		if (*p_current_record < record_array->len) {
-			record = &g_array_index (record_array,
-			                         ExcelExtendedStringRecord,
-			                         *p_current_record);
+	data = &reader->data[reader->pos];
+	reader->pos += size;
 
-			gsf_input_seek (stream, record->offset, G_SEEK_SET);
-		}
+	return data;
+}
 
-		return TRUE;
+static gboolean
+excel_reader_skip (ExcelRecordReader *reader,
+                   gsize              size)
+{
+	while (size > 0) {
+		gsize n_bytes;
+
+		if (reader->pos >= reader->len &&
+		    !excel_reader_load_record (reader, reader->current + 1))
+			return FALSE;
+
+		n_bytes = MIN (size, reader->len - reader->pos);
+		reader->pos += n_bytes;
+		size -= n_bytes;
 	}
 
-	return FALSE;
+	return TRUE;
 }
 
-/* Returns TRUE if correctly read
- *
- *  Note that p_current_record may get changed if the required
- *  bytes to read were split into two different records.
+/* Reads the characters of a string as UTF-16LE into @text, up to
+ * @max_chars of them, the rest is skipped. Strings may be continued
+ * in the next record, which starts with a byte telling whether the
+ * rest of the characters are double-byte.
  */
 static gboolean
-read_excel_string (GsfInput *stream,
-                   guint8   *buffer,
-                   gsize     chunk_size,
-                   GArray   *record_array,
-                   guint    *p_current_record)
+excel_reader_read_string (ExcelRecordReader *reader,
+                          gsize              n_chars,
+                          gboolean           is_high_byte,
+                          gsize              max_chars,
+                          GByteArray        *text)
 {
-	ExcelExtendedStringRecord *record;
-	gsf_off_t current_position;
-	gsf_off_t current_record_end;
-
-	/* Record may have changed when we want to read the string contents
-	 *  This is a pretty special case, where the new CONTINUE record
-	 * shouldn't start with a bitmask */
-	if (change_excel_record_if_needed (stream, record_array, p_current_record) &&
-	    *p_current_record >= record_array->len) {
-		/* When reached max number of records, just return */
-		return FALSE;
-	}
+	g_byte_array_set_size (text, 0);
 
-	/* Get current record */
-	record = &g_array_index (record_array,
-	                         ExcelExtendedStringRecord,
-	                         *p_current_record);
-
-	/* Compute current position in the stream and end of current record*/
-	current_position = gsf_input_tell (stream);
-	current_record_end = record->offset + record->length;
-
-	/* The best case is when the whole number of bytes to read are in the
-	 * current record, as no record switching is therefore needed */
-	if (current_position + chunk_size <= current_record_end) {
-		return gsf_input_read (stream, chunk_size, buffer) != NULL ? TRUE : FALSE;
-	} else if (current_record_end < current_position) {
-		/* Safety check, actually pretty important */
-		return FALSE;
-	} else {
-		/* Read the string in two chunks */
-		gsize chunk_size_first_record;
-		gsize chunk_size_second_record;
-
-		/* Compute how much to read in each record */
-		chunk_size_first_record = current_record_end - current_position;
-		chunk_size_second_record = chunk_size - chunk_size_first_record;
-
-		/* g_debug ("Current position:      %" GSF_OFF_T_FORMAT, current_position); */
-		/* g_debug ("Current record index:  %u", *p_current_record); */
-		/* g_debug ("Current record start:  %" GSF_OFF_T_FORMAT, record->offset); */
-		/* g_debug ("Current record length: %" G_GSIZE_FORMAT, record->length); */
-		/* g_debug ("Current record end:    %" GSF_OFF_T_FORMAT, current_record_end); */
-		/* g_debug ("Bytes to read:         %" G_GSIZE_FORMAT,   chunk_size); */
-		/* g_debug ("Bytes to read (1st):   %" G_GSIZE_FORMAT,   chunk_size_first_record); */
-		/* g_debug ("Bytes to read (2nd):   %" G_GSIZE_FORMAT,   chunk_size_second_record); */
-
-		/* Now, read from first record... */
-		if (gsf_input_read (stream,
-		                    chunk_size_first_record,
-		                    buffer)) {
-			/* Now switch records and read from the second one... */
-			(*p_current_record)++;
-
-			if (*p_current_record < record_array->len) {
-				record = &g_array_index (record_array,
-				                         ExcelExtendedStringRecord,
-				                         *p_current_record);
-
-				/* g_debug ("New record index:  %u", *p_current_record); */
-				/* g_debug ("New record start:  %" GSF_OFF_T_FORMAT, record->offset); */
-				/* g_debug ("New record length: %" G_GSIZE_FORMAT, record->length); */
-
-				/* Move stream pointer to the new location, beginning of next record */
-				gsf_input_seek (stream, record->offset, G_SEEK_SET);
-
-				/* Every CONTINUE records starts with a bitmask + optional fields that
-				 * should be skipped properly */
-				read_excel_string_flags (stream, NULL, NULL, NULL);
-
-				/* And finally, read the second part */
-				if (gsf_input_read (stream,
-				                    chunk_size_second_record,
-				                    &buffer[chunk_size_first_record])) {
-					/* All OK! */
-					return TRUE;
-				}
+	while (n_chars > 0) {
+		const guint8 *data;
+		gsize char_size, n_read, n_copy, i;
+
+		if (reader->pos >= reader->len) {
+			if (!excel_reader_load_record (reader, reader->current + 1) ||
+			    reader->len == 0)
+				return FALSE;
+
+			is_high_byte = (reader->data[0] & 0x01) == 0x01;
+			reader->pos = 1;
+			continue;
+		}
+
+		char_size = is_high_byte ? 2 : 1;
+		n_read = MIN (n_chars, (reader->len - reader->pos) / char_size);
+		if (n_read == 0)
+			return FALSE;
+
+		data = &reader->data[reader->pos];
+		n_copy = MIN (n_read, max_chars);
+
+		if (is_high_byte) {
+			g_byte_array_append (text, data, n_copy * 2);
+		} else {
+			guint8 *out;
+			gsize len = text->len;
+
+			/* All these characters have a high byte of 0x00 */
+			g_byte_array_set_size (text, len + n_copy * 2);
+			out = &text->data[len];
+
+			for (i = 0; i < n_copy; i++) {
+				out[i * 2] = data[i];
+				out[i * 2 + 1] = 0;
 			}
 		}
 
-		return FALSE;
+		max_chars -= n_copy;
+		n_chars -= n_read;
+		reader->pos += n_read * char_size;
 	}
-}
-
 
+	return TRUE;
+}
 
 /**
  * [MS-XLS] — v20090708
@@ -1229,21 +1236,16 @@ xls_get_extended_record_string (GsfInput  *stream,
                                 gsize     *p_bytes_remaining,
                                 GString  **p_content)
 {
-	ExcelExtendedStringRecord *record;
+	ExcelRecordReader reader = { 0, };
+	const guint8 *field;
+	GByteArray *text;
 	guint32 cst_unique;
-	guint parsing_record = 0;
-	guint8 tmp_buffer[4] = { 0 };
-	guint i;
-	guint8 *buffer = NULL;
-	gsize buffer_size = 0;
+	guint32 i;
 
-	/* Parsing the record from the list */
-	record = &g_array_index (list, ExcelExtendedStringRecord, parsing_record);
-
-	/* First record parsing */
-	if (gsf_input_seek (stream, record->offset, G_SEEK_SET)) {
-		return;
-	}
+	reader.stream = stream;
+	reader.records = list;
+	reader.data = g_malloc (G_MAXUINT16);
+	text = g_byte_array_new ();
 
 	/* Note: The first record is ALWAYS the SST, so coming with cst_total and
 	 * cst_unique values.
@@ -1254,114 +1256,74 @@ xls_get_extended_record_string (GsfInput  *stream,
 	 * SST record: http://msdn.microsoft.com/en-us/library/dd773037%28v=office.12%29.aspx
 	 * CONTINUE record: http://msdn.microsoft.com/en-us/library/dd949081%28v=office.12%29.aspx
 	 **/
+	if (!excel_reader_load_record (&reader, 0) ||
+	    !(field = excel_reader_read (&reader, 8))) {
+		goto out;
+	}
 
-	/* Skip cst total */
-	gsf_input_read (stream, 4, tmp_buffer);
-
-	/* Reading cst unique */
-	gsf_input_read (stream, 4, tmp_buffer);
-	cst_unique = read_32bit (tmp_buffer);
+	/* Skip cst total, and read cst unique */
+	cst_unique = read_32bit (field + 4);
 
-	/* Iterate over chunks...
+	/* Iterate over strings...
 	 *   Loop is halted whenever one of this conditions is met:
 	 *     a) Max bytes to be read reached
-	 *     b) No more chunks to read
+	 *     b) No more strings to read
 	 */
-	i = 0;
-	while (*p_bytes_remaining > 0 &&
-	       i < cst_unique) {
+	for (i = 0; *p_bytes_remaining > 0 && i < cst_unique; i++) {
 		guint16 cch;
-		guint16 c_run;
-		guint16 cb_ext_rst;
-		gboolean is_high_byte;
-		gsize chunk_size;
-
-		/* RECORD may have been changed here */
-		if (change_excel_record_if_needed (stream, list, &parsing_record) &&
-		    parsing_record >= list->len) {
-			/* When reached max number of records, stop loop */
-			break;
-		}
-
-		/* Reading 2 bytes for cch */
-		gsf_input_read (stream, 2, tmp_buffer);
-
-		/* Reading cch - char count of current string */
-		cch = read_16bit (tmp_buffer);
-
-		/* Read string flags */
-		read_excel_string_flags (stream,
-		                         &is_high_byte,
-		                         &c_run,
-		                         &cb_ext_rst);
-
-		/* RECORD may have been changed here, but it is managed when reading the
-		 *  string contents */
+		guint8 bit_mask;
+		guint16 c_run = 0;
+		guint32 cb_ext_rst = 0;
 
+		/* cch, the char count of the string, and its flags */
+		if (!(field = excel_reader_read (&reader, 3)))
+			break;
 
-		/* NOTE: In order to avoid reading unnecessary bytes, limit it based
-		 * on the number of bytes remaining */
-		chunk_size = MIN (cch, *p_bytes_remaining);
+		cch = read_16bit (field);
+		bit_mask = read_8bit (field + 2);
 
-		/* If High Byte, chunk size *2 as stream is in UTF-16 */
-		if (is_high_byte) {
-			chunk_size *= 2;
+		/* Rich string, with formatting runs */
+		if ((bit_mask & 0x08) == 0x08) {
+			if (!(field = excel_reader_read (&reader, 2)))
+				break;
+			c_run = read_16bit (field);
 		}
 
-		/* If the new chunk size is longer than our reused buffer,
-		 * make the buffer bigger */
-		if (chunk_size > buffer_size) {
-			buffer = g_realloc (buffer, chunk_size);
-			buffer_size = chunk_size;
+		/* Extended string, with phonetic data */
+		if ((bit_mask & 0x04) == 0x04) {
+			if (!(field = excel_reader_read (&reader, 4)))
+				break;
+			cb_ext_rst = read_32bit (field);
 		}
 
-		/* Read the chunk! NOTE that it may be split in several records... */
-		if (!read_excel_string (stream, buffer, chunk_size, list, &parsing_record)) {
+		/* NOTE: In order to avoid converting unnecessary bytes, limit it
+		 * based on the number of bytes remaining */
+		if (!excel_reader_read_string (&reader, cch,
+		                               (bit_mask & 0x01) == 0x01,
+		                               *p_bytes_remaining,
+		                               text))
 			break;
-		}
 
-		/* Read whole stream in one operation */
-		msoffice_convert_and_normalize_chunk (buffer,
-		                                      chunk_size,
-		                                      !is_high_byte,
-		                                      p_bytes_remaining,
-		                                      p_content);
-
-		/* Formatting string */
-		if (c_run > 0) {
-			/* rgRun (variable): An optional array of
-			 * FormatRun structures that specifies the
-			 * formatting for each ext run. The number of
-			 * elements in the array is cRun. MUST exist
-			 * if and only if fRichSt is 0x1.
-			 *
-			 * Note: As defined in MSDN, a FormatRun structure has a size
-			 *  of 4 bytes, so the size of this rgRun variable is really
-			 *  (4*cRun) bytes.
-			 *  http://msdn.microsoft.com/en-us/library/dd921712.aspx
-			 *
-			 * Skiping this as it will not be useful in
-			 * our case.
-			 */
-			gsf_input_seek (stream, 4 * c_run, G_SEEK_CUR);
-			/* Note that we may be now out of the current record after having
-			 * done this seek operation. */
+		if (text->len > 0) {
+			msoffice_convert_and_normalize_chunk (text->data,
+			                                      text->len,
+			                                      FALSE,
+			                                      p_bytes_remaining,
+			                                      p_content);
 		}
 
-		/* ExtString */
-		if (cb_ext_rst > 0) {
-			/* Again its not so clear may be it will not
-			 * useful in our case.
-			 */
-			gsf_input_seek (stream, cb_ext_rst, G_SEEK_CUR);
-			/* Note that we may be now out of the current record after having
-			 * done this seek operation. */
-		}
-
-		/* Go to next chunk */
-		i++;
+		/* rgRun is an array of 4 byte FormatRun structures, and
+		 * ExtRst the phonetic string data. Skipping both as they
+		 * will not be useful in our case.
+		 * http://msdn.microsoft.com/en-us/library/dd921712.aspx
+		 */
+		if (!excel_reader_skip (&reader, 4 * (gsize) c_run + cb_ext_rst))
+			break;
 	}
-	g_free(buffer);
+
+out:
+	g_byte_array_unref (text);
+	g_free (reader.data);
 }
 
 /**
@@ -1689,10 +1651,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		g_debug ("Mime type was not recognised:'%s'", mime_used);
 	}
 
-	if (content) {
-		tracker_resource_set_string (metadata, "nie:plainTextContent", content);
-		g_free (content);
-	}
+	if (content)
+		tracker_extract_info_take_text (info, content);
 
 	if (is_encrypted) {
 		tracker_resource_set_boolean (metadata, "nfo:isContentEncrypted", TRUE);
@@ -108,18 +108,17 @@ static void xml_text_handler_content           (GMarkupParseContext   *context,
                                                 gsize                  text_len,
                                                 gpointer               user_data,
                                                 GError               **error);
-static void extract_oasis_content              (const gchar           *uri,
+static void extract_oasis_content              (TrackerGsfArchive     *archive,
                                                 gulong                 total_bytes,
                                                 ODTFileType            file_type,
-                                                TrackerResource       *metadata);
+                                                TrackerExtractInfo    *extract_info);
 
 static void
-extract_oasis_content (const gchar     *uri,
-                       gulong           total_bytes,
-                       ODTFileType      file_type,
-                       TrackerResource *metadata)
+extract_oasis_content (TrackerGsfArchive  *archive,
+                       gulong              total_bytes,
+                       ODTFileType         file_type,
+                       TrackerExtractInfo *extract_info)
 {
-	gchar *content = NULL;
 	ODTContentParseInfo info;
 	GMarkupParseContext *context;
 	GError *error = NULL;
@@ -147,11 +146,11 @@ extract_oasis_content (const gchar     *uri,
 
 	/* Load the internal XML file from the Zip archive, and parse it
 	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri, "content.xml", context, &error);
+	tracker_gsf_archive_parse_xml (archive, "content.xml", context, &error);
 
 	if (!error || g_error_matches (error, maximum_size_error_quark, 0)) {
-		content = g_string_free (info.content, FALSE);
-		tracker_resource_set_string (metadata, "nie:plainTextContent", content);
+		tracker_extract_info_take_text (extract_info,
+		                                g_string_free (info.content, FALSE));
 	} else {
 		g_warning ("Got error parsing XML file: %s\n", error->message);
 		g_string_free (info.content, TRUE);
@@ -161,7 +160,6 @@ extract_oasis_content (const gchar     *uri,
 		g_error_free (error);
 	}
 
-	g_free (content);
 	g_markup_parse_context_free (context);
 	g_queue_free (info.tag_stack);
 }
@@ -171,6 +169,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
                               GError             **error)
 {
 	TrackerResource *metadata;
+	TrackerGsfArchive *archive;
 	ODTMetadataParseInfo info = { 0 };
 	ODTFileType file_type;
 	GFile *file;
@@ -200,6 +199,13 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 
 	g_debug ("Extracting OASIS metadata and contents from '%s'", uri);
 
+	archive = tracker_gsf_archive_open (uri, error);
+	if (!archive) {
+		g_object_unref (metadata);
+		g_free (uri);
+		return FALSE;
+	}
+
 	/* First, parse metadata */
 
 	tracker_resource_add_uri (metadata, "rdf:type", "nfo:PaginatedTextDocument");
@@ -214,7 +220,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 
 	/* Load the internal XML file from the Zip archive, and parse it
 	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri, "meta.xml", context, NULL);
+	tracker_gsf_archive_parse_xml (archive, "meta.xml", context, NULL);
 	g_markup_parse_context_free (context);
 
 	if (g_ascii_strcasecmp (mime_used, "application/vnd.oasis.opendocument.text") == 0) {
@@ -231,10 +237,12 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	}
 
 	/* Extract content with the given limitations */
-	extract_oasis_content (uri,
+	extract_oasis_content (archive,
 	                       tracker_extract_info_get_max_text (extract_info),
 	                       file_type,
-	                       metadata);
+	                       extract_info);
+
+	tracker_gsf_archive_close (archive);
 
 	g_queue_free (info.tag_stack);
 
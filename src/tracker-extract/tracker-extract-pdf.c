@@ -39,6 +39,7 @@
 
 #include <gio/gunixoutputstream.h>
 #include <gio/gunixinputstream.h>
+#include <gio/gfiledescriptorbased.h>
 
 #include <libtracker-miners-common/tracker-utils.h>
 #include <libtracker-miners-common/tracker-file-utils.h>
@@ -50,6 +51,17 @@
 /* Time in seconds before we stop processing content */
 #define EXTRACTION_PROCESS_TIMEOUT 10
 
+/* Files bigger than this are read through a stream instead of being
+ * mapped whole, so only the objects poppler looks at get paged in.
+ */
+#define STREAM_THRESHOLD (64 * 1024 * 1024)
+
+/* Text of documents with many pages is extracted by several threads */
+#define MAX_PAGE_WORKERS 4
+#define PARALLEL_MIN_PAGES 16
+/* Pages each worker may extract ahead of the ones being concatenated */
+#define PAGES_AHEAD 4
+
 typedef struct {
 	gchar *title;
 	gchar *subject;
@@ -59,6 +71,101 @@ typedef struct {
 	gchar *keywords;
 } PDFData;
 
+typedef struct {
+	GFile *file;
+	const gchar *contents;
+	gsize len;
+
+	GMutex mutex;
+	GCond cond;
+	gint n_pages;
+	gint next_page;
+	gint max_page;
+	gboolean cancelled;
+	/* By page, set by the thread extracting it */
+	gchar **texts;
+	gboolean *done;
+} PageQueue;
+
+static GInputStream *
+open_stream (GFile   *file,
+             GError **error)
+{
+	GFileInputStream *stream;
+
+	stream = g_file_read (file, NULL, error);
+	if (!stream)
+		return NULL;
+
+#ifdef HAVE_POSIX_FADVISE
+	/* Objects are looked up through the xref table, readahead
+	 * would mostly bring in pages that are never used.
+	 */
+	if (G_IS_FILE_DESCRIPTOR_BASED (stream)) {
+		int fd;
+
+		fd = g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream));
+		posix_fadvise (fd, 0, 0, POSIX_FADV_RANDOM);
+	}
+#endif
+
+	return G_INPUT_STREAM (stream);
+}
+
+/* Big documents are read through a stream and have no @contents */
+static PopplerDocument *
+open_document (GFile        *file,
+               const gchar  *contents,
+               gsize         len,
+               GError      **error)
+{
+	G_GNUC_UNUSED GBytes *bytes;
+	PopplerDocument *document;
+
+#if POPPLER_CHECK_VERSION (0, 22, 0)
+	if (!contents && len > 0) {
+		GInputStream *stream;
+
+		stream = open_stream (file, error);
+		if (!stream)
+			return NULL;
+
+		document = poppler_document_new_from_stream (stream, len, NULL, NULL, error);
+		g_object_unref (stream);
+
+		return document;
+	}
+#endif
+
+#if POPPLER_CHECK_VERSION (0, 82, 0)
+	/* The mapping outlives the documents, no need to copy it */
+	bytes = g_bytes_new_static (contents, len);
+	document = poppler_document_new_from_bytes (bytes, NULL, error);
+	g_bytes_unref (bytes);
+#else
+	document = poppler_document_new_from_data ((gchar *) contents, len, NULL, error);
+#endif
+
+	return document;
+}
+
+static void
+close_file (int    fd,
+            gchar *contents,
+            gsize  len)
+{
+	if (contents) {
+		munmap (contents, len);
+	} else if (len > 0) {
+#ifdef HAVE_POSIX_FADVISE
+		/* Don't leave the whole document in the page cache */
+		posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	}
+
+	close (fd);
+}
+
 static void
 read_toc (PopplerIndexIter  *index,
           GString          **toc)
@@ -191,58 +298,235 @@ read_outline (PopplerDocument *document,
 }
 
 static gchar *
-extract_content_text (PopplerDocument *document,
-                      gsize            n_bytes)
+get_page_text (PopplerDocument *document,
+               gint             n_page)
 {
-	GString *string;
-	GTimer *timer;
-	gsize remaining_bytes;
-	gint n_pages, i;
-	gdouble elapsed;
+	PopplerPage *page;
+	gchar *text;
 
-	n_pages = poppler_document_get_n_pages (document);
-	string = g_string_new ("");
-	timer = g_timer_new ();
+	page = poppler_document_get_page (document, n_page);
+	if (!page)
+		return NULL;
+
+	text = poppler_page_get_text (page);
+	g_object_unref (page);
+
+	return text;
+}
+
+static void
+append_page_text (GString     **string,
+                  const gchar  *text,
+                  gint          n_page,
+                  gsize        *remaining_bytes)
+{
+	gsize written_bytes = 0;
+
+	if (tracker_text_validate_utf8 (text,
+	                                MIN (strlen (text), *remaining_bytes),
+	                                string,
+	                                &written_bytes)) {
+		g_string_append_c (*string, ' ');
+	}
+
+	*remaining_bytes -= written_bytes;
+
+	g_debug ("Extracted %" G_GSIZE_FORMAT " bytes from page %d, "
+	         "%" G_GSIZE_FORMAT " bytes remaining",
+	         written_bytes, n_page, *remaining_bytes);
+}
+
+static gpointer
+page_worker_func (gpointer user_data)
+{
+	PageQueue *queue = user_data;
+	PopplerDocument *document;
+
+	/* Documents can't be shared between threads */
+	document = open_document (queue->file, queue->contents, queue->len, NULL);
+	if (!document)
+		return NULL;
 
-	for (i = 0, remaining_bytes = n_bytes, elapsed = g_timer_elapsed (timer, NULL);
-	     i < n_pages && remaining_bytes > 0 && elapsed < EXTRACTION_PROCESS_TIMEOUT;
-	     i++, elapsed = g_timer_elapsed (timer, NULL)) {
-		PopplerPage *page;
-		gsize written_bytes = 0;
+	g_mutex_lock (&queue->mutex);
+
+	while (!queue->cancelled && queue->next_page < queue->n_pages) {
 		gchar *text;
+		gint n_page;
+
+		if (queue->next_page > queue->max_page) {
+			g_cond_wait (&queue->cond, &queue->mutex);
+			continue;
+		}
+
+		n_page = queue->next_page++;
+		g_mutex_unlock (&queue->mutex);
 
-		page = poppler_document_get_page (document, i);
-		text = poppler_page_get_text (page);
+		text = get_page_text (document, n_page);
+
+		g_mutex_lock (&queue->mutex);
+		queue->texts[n_page] = text;
+		queue->done[n_page] = TRUE;
+		g_cond_broadcast (&queue->cond);
+	}
+
+	g_mutex_unlock (&queue->mutex);
+	g_object_unref (document);
 
-		if (!text) {
-			g_object_unref (page);
+	return NULL;
+}
+
+static gint
+extract_pages_serial (PopplerDocument  *document,
+                      gint              n_pages,
+                      GString         **string,
+                      gsize            *remaining_bytes,
+                      gint64            end_time)
+{
+	gint i;
+
+	for (i = 0;
+	     i < n_pages && *remaining_bytes > 0 && g_get_monotonic_time () < end_time;
+	     i++) {
+		gchar *text;
+
+		text = get_page_text (document, i);
+		if (!text)
 			continue;
+
+		append_page_text (string, text, i, remaining_bytes);
+		g_free (text);
+	}
+
+	return i;
+}
+
+static gint
+extract_pages_parallel (PopplerDocument  *document,
+                        GFile            *file,
+                        const gchar      *contents,
+                        gsize             len,
+                        gint              n_pages,
+                        guint             n_workers,
+                        GString         **string,
+                        gsize            *remaining_bytes,
+                        gint64            end_time)
+{
+	GThread *workers[MAX_PAGE_WORKERS];
+	PageQueue queue = { 0, };
+	gboolean timed_out = FALSE;
+	guint j;
+	gint i;
+
+	queue.file = file;
+	queue.contents = contents;
+	queue.len = len;
+	queue.n_pages = n_pages;
+	queue.max_page = n_workers * PAGES_AHEAD;
+	queue.texts = g_new0 (gchar *, n_pages);
+	queue.done = g_new0 (gboolean, n_pages);
+	g_mutex_init (&queue.mutex);
+	g_cond_init (&queue.cond);
+
+	for (j = 0; j < n_workers; j++)
+		workers[j] = g_thread_new ("pdf-pages", page_worker_func, &queue);
+
+	g_mutex_lock (&queue.mutex);
+
+	/* Pages are concatenated in order as they get ready */
+	for (i = 0; i < n_pages && *remaining_bytes > 0 && !timed_out; i++) {
+		gchar *text;
+
+		while (!queue.done[i] && !timed_out) {
+			if (queue.next_page == i) {
+				/* Not picked by any worker, do it here */
+				queue.next_page++;
+				g_mutex_unlock (&queue.mutex);
+				text = get_page_text (document, i);
+				g_mutex_lock (&queue.mutex);
+
+				queue.texts[i] = text;
+				queue.done[i] = TRUE;
+			} else if (!g_cond_wait_until (&queue.cond, &queue.mutex, end_time)) {
+				timed_out = TRUE;
+			}
 		}
 
-		if (tracker_text_validate_utf8 (text,
-		                                MIN (strlen (text), remaining_bytes),
-		                                &string,
-		                                &written_bytes)) {
-			g_string_append_c (string, ' ');
+		if (timed_out)
+			break;
+
+		text = g_steal_pointer (&queue.texts[i]);
+		queue.max_page = i + 1 + n_workers * PAGES_AHEAD;
+		g_cond_broadcast (&queue.cond);
+		g_mutex_unlock (&queue.mutex);
+
+		if (text) {
+			append_page_text (string, text, i, remaining_bytes);
+			g_free (text);
 		}
 
-		remaining_bytes -= written_bytes;
+		timed_out = g_get_monotonic_time () >= end_time;
+		g_mutex_lock (&queue.mutex);
+	}
 
-		g_debug ("Extracted %" G_GSIZE_FORMAT " bytes from page %d, "
-		         "%" G_GSIZE_FORMAT " bytes remaining",
-		         written_bytes, i, remaining_bytes);
+	queue.cancelled = TRUE;
+	g_cond_broadcast (&queue.cond);
+	g_mutex_unlock (&queue.mutex);
 
-		g_free (text);
-		g_object_unref (page);
+	for (j = 0; j < n_workers; j++)
+		g_thread_join (workers[j]);
+
+	for (j = 0; j < (guint) n_pages; j++)
+		g_free (queue.texts[j]);
+
+	g_free (queue.texts);
+	g_free (queue.done);
+	g_mutex_clear (&queue.mutex);
+	g_cond_clear (&queue.cond);
+
+	return i;
+}
+
+static gchar *
+extract_content_text (PopplerDocument *document,
+                      GFile           *file,
+                      const gchar     *contents,
+                      gsize            len,
+                      gsize            n_bytes)
+{
+	GString *string;
+	GTimer *timer;
+	gsize remaining_bytes = n_bytes;
+	gint64 end_time;
+	gint n_pages, n_extracted;
+	guint n_workers;
+
+	n_pages = poppler_document_get_n_pages (document);
+	string = g_string_new ("");
+	timer = g_timer_new ();
+	end_time = g_get_monotonic_time () +
+		EXTRACTION_PROCESS_TIMEOUT * G_TIME_SPAN_SECOND;
+
+	/* The calling thread works on pages too */
+	n_workers = MIN (g_get_num_processors (), MAX_PAGE_WORKERS + 1) - 1;
+
+	if (n_pages >= PARALLEL_MIN_PAGES && n_workers > 0) {
+		n_extracted = extract_pages_parallel (document, file, contents, len,
+		                                      n_pages, n_workers,
+		                                      &string, &remaining_bytes,
+		                                      end_time);
+	} else {
+		n_extracted = extract_pages_serial (document, n_pages,
+		                                    &string, &remaining_bytes,
+		                                    end_time);
 	}
 
-	if (elapsed >= EXTRACTION_PROCESS_TIMEOUT) {
+	if (n_extracted < n_pages && remaining_bytes > 0) {
 		g_debug ("Extraction timed out, %d seconds reached", EXTRACTION_PROCESS_TIMEOUT);
 	}
 
 	g_debug ("Content extraction finished: %d/%d pages indexed in %2.2f seconds, "
 	         "%" G_GSIZE_FORMAT " bytes extracted",
-	         i,
+	         n_extracted,
 	         n_pages,
 	         g_timer_elapsed (timer, NULL),
 	         (n_bytes - remaining_bytes));
@@ -290,7 +574,6 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	TrackerXmpData *xd = NULL;
 	PDFData pd = { 0 }; /* actual data */
 	PDFData md = { 0 }; /* for merging */
-	G_GNUC_UNUSED GBytes *bytes;
 	PopplerDocument *document;
 	gchar *xml = NULL;
 	gchar *content, *uri;
@@ -329,6 +612,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	if (st.st_size == 0) {
 		contents = NULL;
 		len = 0;
+#if POPPLER_CHECK_VERSION (0, 22, 0)
+	} else if (st.st_size > STREAM_THRESHOLD) {
+		contents = NULL;
+		len = st.st_size;
+#endif
 	} else {
 		contents = (gchar *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 		if (contents == NULL || contents == MAP_FAILED) {
@@ -345,13 +633,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	g_free (filename);
 	uri = g_file_get_uri (file);
 
-#if POPPLER_CHECK_VERSION (0, 82, 0)
-	bytes = g_bytes_new (contents, len);
-	document = poppler_document_new_from_bytes (bytes, NULL, &inner_error);
-	g_bytes_unref (bytes);
-#else
-	document = poppler_document_new_from_data (contents, len, NULL, &inner_error);
-#endif
+	document = open_document (file, contents, len, &inner_error);
 
 	if (inner_error) {
 		if (inner_error->code == POPPLER_ERROR_ENCRYPTED) {
@@ -367,13 +649,13 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 
 			g_error_free (inner_error);
 			g_free (uri);
-			close (fd);
+			close_file (fd, contents, len);
 
 			return TRUE;
 		} else {
 			g_propagate_prefixed_error (error, inner_error, "Couldn't open PopplerDocument:");
 			g_free (uri);
-			close (fd);
+			close_file (fd, contents, len);
 
 			return FALSE;
 		}
@@ -384,7 +666,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		           "NULL returned without an error",
 		           uri);
 		g_free (uri);
-		close (fd);
+		close_file (fd, contents, len);
 		return FALSE;
 	}
 
@@ -554,12 +836,10 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	tracker_resource_set_int64 (metadata, "nfo:pageCount", poppler_document_get_n_pages(document));
 
 	n_bytes = tracker_extract_info_get_max_text (info);
-	content = extract_content_text (document, n_bytes);
+	content = extract_content_text (document, file, contents, len, n_bytes);
 
-	if (content) {
-		tracker_resource_set_string (metadata, "nie:plainTextContent", content);
-		g_free (content);
-	}
+	if (content)
+		tracker_extract_info_take_text (info, content);
 
 	read_outline (document, metadata);
 
@@ -573,12 +853,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	g_free (uri);
 
 	g_object_unref (document);
-
-	if (contents) {
-		munmap (contents, len);
-	}
-
-	close (fd);
+	close_file (fd, contents, len);
 
 	tracker_extract_info_set_resource (info, metadata);
 	g_object_unref (metadata);
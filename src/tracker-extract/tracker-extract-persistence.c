@@ -17,27 +17,59 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include "config-miners.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "tracker-extract-persistence.h"
 
+/* The storage is a fixed array of slots, one per file being
+ * processed, each holding a nul-terminated path or an empty
+ * string if unused. It is mapped in memory, so recording the
+ * current file is a plain store, the contents survive a crash
+ * of this process and are read back by the next one.
+ */
+#define N_SLOTS 16
+#define SLOT_SIZE 4096
+#define STORAGE_SIZE (N_SLOTS * SLOT_SIZE)
+
 typedef struct _TrackerExtractPersistencePrivate TrackerExtractPersistencePrivate;
 
 struct _TrackerExtractPersistencePrivate
 {
 	int fd;
+	gchar *storage;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (TrackerExtractPersistence, tracker_extract_persistence, G_TYPE_OBJECT)
 
 static void
-tracker_extract_persistence_finalize (GObject *object)
+persistence_unmap (TrackerExtractPersistence *persistence)
 {
-	TrackerExtractPersistence *persistence =
-		TRACKER_EXTRACT_PERSISTENCE (object);
 	TrackerExtractPersistencePrivate *priv =
 		tracker_extract_persistence_get_instance_private (persistence);
 
-	if (priv->fd > 0)
+	if (priv->storage) {
+		munmap (priv->storage, STORAGE_SIZE);
+		priv->storage = NULL;
+	}
+
+	if (priv->fd >= 0) {
 		close (priv->fd);
+		priv->fd = -1;
+	}
+}
+
+static void
+tracker_extract_persistence_finalize (GObject *object)
+{
+	TrackerExtractPersistence *persistence =
+		TRACKER_EXTRACT_PERSISTENCE (object);
+
+	persistence_unmap (persistence);
 
 	G_OBJECT_CLASS (tracker_extract_persistence_parent_class)->finalize (object);
 }
@@ -53,6 +85,10 @@ tracker_extract_persistence_class_init (TrackerExtractPersistenceClass *klass)
 static void
 tracker_extract_persistence_init (TrackerExtractPersistence *persistence)
 {
+	TrackerExtractPersistencePrivate *priv =
+		tracker_extract_persistence_get_instance_private (persistence);
+
+	priv->fd = -1;
 }
 
 TrackerExtractPersistence *
@@ -68,63 +104,145 @@ tracker_extract_persistence_set_fd (TrackerExtractPersistence *persistence,
 {
 	TrackerExtractPersistencePrivate *priv =
 		tracker_extract_persistence_get_instance_private (persistence);
+	struct stat st;
+	gpointer storage;
 
-	if (priv->fd > 0)
-		close (priv->fd);
+	persistence_unmap (persistence);
 	priv->fd = fd;
+
+	if (fd < 0)
+		return;
+
+	if (fstat (fd, &st) < 0 ||
+	    (st.st_size < STORAGE_SIZE && ftruncate (fd, STORAGE_SIZE) < 0)) {
+		g_warning ("Could not set up persistent storage: %m");
+		return;
+	}
+
+	storage = mmap (NULL, STORAGE_SIZE, PROT_READ | PROT_WRITE,
+	                MAP_SHARED, fd, 0);
+	if (storage == MAP_FAILED) {
+		g_warning ("Could not map persistent storage: %m");
+		return;
+	}
+
+	priv->storage = storage;
+}
+
+static gchar *
+persistence_get_slot (TrackerExtractPersistence *persistence,
+                      guint                      slot)
+{
+	TrackerExtractPersistencePrivate *priv =
+		tracker_extract_persistence_get_instance_private (persistence);
+
+	return &priv->storage[slot * SLOT_SIZE];
 }
 
 void
-tracker_extract_persistence_set_file (TrackerExtractPersistence *persistence,
+tracker_extract_persistence_add_file (TrackerExtractPersistence *persistence,
                                       GFile                     *file)
 {
 	TrackerExtractPersistencePrivate *priv =
 		tracker_extract_persistence_get_instance_private (persistence);
 	g_autofree gchar *path = NULL;
-	int len, written = 0, retval;
+	gsize len;
+	guint i;
 
 	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
-	g_return_if_fail (!file || G_IS_FILE (file));
+	g_return_if_fail (G_IS_FILE (file));
+
+	if (!priv->storage)
+		return;
+
+	path = g_file_get_path (file);
+	if (!path)
+		return;
 
-	if (file) {
-		path = g_file_get_path (file);
-	} else {
-		path = g_strdup ("");
+	len = strlen (path);
+	if (len == 0 || len >= SLOT_SIZE)
+		return;
+
+	for (i = 0; i < N_SLOTS; i++) {
+		gchar *slot = persistence_get_slot (persistence, i);
+
+		if (slot[0] == '\0') {
+			/* Write also the trailing \0 */
+			memcpy (slot, path, len + 1);
+			return;
+		}
 	}
 
-	/* Write also the trailing \0 */
-	len = strlen (path) + 1;
+	g_debug ("No free persistence slot for '%s'", path);
+}
+
+void
+tracker_extract_persistence_remove_file (TrackerExtractPersistence *persistence,
+                                         GFile                     *file)
+{
+	TrackerExtractPersistencePrivate *priv =
+		tracker_extract_persistence_get_instance_private (persistence);
+	g_autofree gchar *path = NULL;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
+	g_return_if_fail (G_IS_FILE (file));
 
-	lseek (priv->fd, 0, SEEK_SET);
+	if (!priv->storage)
+		return;
 
-	while (TRUE) {
-		retval = write (priv->fd, &path[written], len - written);
-		if (retval < 0)
-			break;
+	path = g_file_get_path (file);
+	if (!path)
+		return;
 
-		written += retval;
-		if (written >= len)
+	for (i = 0; i < N_SLOTS; i++) {
+		gchar *slot = persistence_get_slot (persistence, i);
+
+		if (strncmp (slot, path, SLOT_SIZE) == 0) {
+			slot[0] = '\0';
 			break;
+		}
 	}
 }
 
-GFile *
-tracker_extract_persistence_get_file (TrackerExtractPersistence *persistence)
+void
+tracker_extract_persistence_clear (TrackerExtractPersistence *persistence)
+{
+	TrackerExtractPersistencePrivate *priv =
+		tracker_extract_persistence_get_instance_private (persistence);
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
+
+	if (!priv->storage)
+		return;
+
+	for (i = 0; i < N_SLOTS; i++)
+		persistence_get_slot (persistence, i)[0] = '\0';
+}
+
+GList *
+tracker_extract_persistence_get_files (TrackerExtractPersistence *persistence)
 {
 	TrackerExtractPersistencePrivate *priv =
 		tracker_extract_persistence_get_instance_private (persistence);
-	gchar buf[2048];
-	int len;
+	GList *files = NULL;
+	guint i;
 
 	g_return_val_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence), NULL);
 
-	lseek (priv->fd, 0, SEEK_SET);
-	len = read (priv->fd, buf, sizeof (buf));
-	if (len <= 0)
-		return NULL;
-	if (buf[0] == '\0')
+	if (!priv->storage)
 		return NULL;
 
-	buf[len - 1] = '\0';
-	return g_file_new_for_path (buf);
+	for (i = 0; i < N_SLOTS; i++) {
+		const gchar *slot = persistence_get_slot (persistence, i);
+
+		/* Ignore slots without a terminated path */
+		if (slot[0] == '\0' || !memchr (slot, '\0', SLOT_SIZE))
+			continue;
+
+		files = g_list_prepend (files, g_file_new_for_path (slot));
+	}
+
+	return g_list_reverse (files);
 }
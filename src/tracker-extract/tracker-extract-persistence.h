@@ -51,11 +51,16 @@ TrackerExtractPersistence * tracker_extract_persistence_new (void);
 void tracker_extract_persistence_set_fd (TrackerExtractPersistence *persistence,
                                          int                        fd);
 
-GFile * tracker_extract_persistence_get_file (TrackerExtractPersistence *persistence);
+GList * tracker_extract_persistence_get_files (TrackerExtractPersistence *persistence);
 
-void tracker_extract_persistence_set_file (TrackerExtractPersistence *persistence,
+void tracker_extract_persistence_add_file (TrackerExtractPersistence *persistence,
                                            GFile                     *file);
 
+void tracker_extract_persistence_remove_file (TrackerExtractPersistence *persistence,
+                                              GFile                     *file);
+
+void tracker_extract_persistence_clear (TrackerExtractPersistence *persistence);
+
 G_END_DECLS
 
 #endif /* __TRACKER_EXTRACT_PERSISTENCE_H__ */
@@ -27,7 +27,9 @@
 #include <glib/gstdio.h>
 #include <gio/gio.h>
 
+#ifdef HAVE_TOTEM_PL_PARSER
 #include <totem-pl-parser.h>
+#endif
 
 #include <libtracker-extract/tracker-extract.h>
 #include <libtracker-extract/tracker-guarantee.h>
@@ -43,13 +45,228 @@
 #define PLAYLIST_DEFAULT_NO_TRACKS 0
 #define PLAYLIST_DEFAULT_DURATION 0
 
+#define UTF8_BOM "\xef\xbb\xbf"
+
 typedef struct {
 	guint32 track_counter;
+	guint32 max_entries;
 	gint64 total_time;
 	gchar *title;
 	TrackerResource *metadata;
 } PlaylistMetadata;
 
+static void
+add_entry (PlaylistMetadata *data,
+           const gchar      *uri)
+{
+	TrackerResource *entry;
+
+	data->track_counter++;
+
+	if (data->track_counter > data->max_entries) {
+		/* Entries past the limit are only counted, for query performance reasons */
+		if (data->track_counter == data->max_entries + 1)
+			g_debug ("Playlist has > %u entries. Ignoring the rest for performance reasons.",
+			         data->max_entries);
+		return;
+	}
+
+	entry = tracker_resource_new (NULL);
+	tracker_resource_set_uri (entry, "rdf:type", "nfo:MediaFileListEntry");
+	tracker_resource_set_string (entry, "nfo:entryUrl", uri);
+	tracker_resource_set_int (entry, "nfo:listPosition", data->track_counter);
+
+	if (data->track_counter == 1) {
+		/* This causes all existing relations to be deleted, when we serialize
+		 * to SPARQL. */
+		tracker_resource_set_relation (data->metadata, "nfo:hasMediaFileListEntry", entry);
+	} else {
+		tracker_resource_add_relation (data->metadata, "nfo:hasMediaFileListEntry", entry);
+	}
+	g_object_unref (entry);
+}
+
+static void
+add_duration (PlaylistMetadata *data,
+              const gchar      *str)
+{
+	gint64 secs;
+
+	secs = g_ascii_strtoll (str, NULL, 10);
+
+	if (secs > 0)
+		data->total_time += secs;
+}
+
+static gchar *
+resolve_entry_uri (GFile       *base,
+                   const gchar *location)
+{
+	g_autofree gchar *scheme = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr (GFile) file = NULL;
+
+	scheme = g_uri_parse_scheme (location);
+
+	/* One letter schemes are Windows drive letters */
+	if (scheme && strlen (scheme) > 1)
+		return g_strdup (location);
+	if (g_path_is_absolute (location))
+		return g_filename_to_uri (location, NULL, NULL);
+	if (!base)
+		return NULL;
+
+	path = g_strdelimit (g_strdup (location), "\\", '/');
+	file = g_file_resolve_relative_path (base, path);
+
+	return g_file_get_uri (file);
+}
+
+static void
+add_location (PlaylistMetadata *data,
+              GFile            *base,
+              const gchar      *location)
+{
+	g_autofree gchar *uri = NULL;
+
+	if (!*location)
+		return;
+
+	/* Past the limit there is no need to build the URI */
+	if (data->track_counter >= data->max_entries) {
+		add_entry (data, NULL);
+		return;
+	}
+
+	uri = resolve_entry_uri (base, location);
+	if (uri)
+		add_entry (data, uri);
+}
+
+static void
+parse_m3u_line (PlaylistMetadata *data,
+                GFile            *base,
+                const gchar      *line)
+{
+	if (g_str_has_prefix (line, "#EXTINF:")) {
+		add_duration (data, line + strlen ("#EXTINF:"));
+	} else if (g_str_has_prefix (line, "#PLAYLIST:")) {
+		line += strlen ("#PLAYLIST:");
+
+		if (!data->title && *line && g_utf8_validate (line, -1, NULL))
+			data->title = g_strdup (line);
+	} else if (line[0] != '#') {
+		add_location (data, base, line);
+	}
+}
+
+static gboolean
+key_has_index (const gchar *key,
+               const gchar *prefix)
+{
+	gsize len = strlen (prefix);
+
+	return (g_ascii_strncasecmp (key, prefix, len) == 0 &&
+	        g_ascii_isdigit (key[len]));
+}
+
+static void
+parse_pls_line (PlaylistMetadata *data,
+                GFile            *base,
+                gchar            *line)
+{
+	gchar *value;
+
+	value = strchr (line, '=');
+	if (!value)
+		return;
+
+	*value = '\0';
+	value++;
+	g_strchomp (line);
+	g_strchug (value);
+
+	if (key_has_index (line, "File")) {
+		add_location (data, base, value);
+	} else if (key_has_index (line, "Length")) {
+		add_duration (data, value);
+	} else if (g_ascii_strcasecmp (line, "X-GNOME-Title") == 0) {
+		if (!data->title && *value && g_utf8_validate (value, -1, NULL))
+			data->title = g_strdup (value);
+	}
+}
+
+/* M3U and PLS playlists are read one line at a time, so memory use
+ * depends on the entries that are kept and not on the playlist size.
+ */
+static gboolean
+parse_simple_playlist (GFile             *file,
+                       PlaylistMetadata  *data,
+                       GError           **error)
+{
+	g_autoptr (GFileInputStream) stream = NULL;
+	g_autoptr (GDataInputStream) data_stream = NULL;
+	g_autoptr (GFile) base = NULL;
+	gboolean first = TRUE, is_pls = FALSE;
+	GError *inner_error = NULL;
+	gchar *line;
+
+	stream = g_file_read (file, NULL, error);
+	if (!stream)
+		return FALSE;
+
+	data_stream = g_data_input_stream_new (G_INPUT_STREAM (stream));
+	g_data_input_stream_set_newline_type (data_stream,
+	                                      G_DATA_STREAM_NEWLINE_TYPE_ANY);
+	base = g_file_get_parent (file);
+
+	while ((line = g_data_input_stream_read_line (data_stream, NULL, NULL, &inner_error))) {
+		gchar *str = line;
+
+		if (first && g_str_has_prefix (str, UTF8_BOM))
+			str += strlen (UTF8_BOM);
+
+		g_strstrip (str);
+
+		if (*str && first) {
+			/* PLS playlists are often named .m3u */
+			first = FALSE;
+
+			if (g_ascii_strcasecmp (str, "[playlist]") == 0) {
+				is_pls = TRUE;
+				g_free (line);
+				continue;
+			}
+		}
+
+		if (*str) {
+			if (is_pls)
+				parse_pls_line (data, base, str);
+			else
+				parse_m3u_line (data, base, str);
+		}
+
+		g_free (line);
+	}
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+#ifdef HAVE_TOTEM_PL_PARSER
+
+static gboolean
+is_simple_playlist (const gchar *mimetype)
+{
+	return (g_strcmp0 (mimetype, "audio/x-mpegurl") == 0 ||
+	        g_strcmp0 (mimetype, "audio/mpegurl") == 0 ||
+	        g_strcmp0 (mimetype, "audio/x-scpls") == 0);
+}
+
 static void
 playlist_started (TotemPlParser         *parser,
                   gchar                 *to_uri,
@@ -70,31 +287,10 @@ entry_parsed (TotemPlParser *parser,
               GHashTable    *to_metadata,
               gpointer       user_data)
 {
-	TrackerResource *entry;
 	PlaylistMetadata *data;
 
 	data = (PlaylistMetadata *) user_data;
-	data->track_counter++;
-
-	if (data->track_counter > 1000) {
-		/* limit playlists to 1000 entries for query performance reasons */
-		g_debug ("Playlist has > 1000 entries. Ignoring for performance reasons.");
-		return;
-	}
-
-	entry = tracker_resource_new (NULL);
-	tracker_resource_set_uri (entry, "rdf:type", "nfo:MediaFileListEntry");
-	tracker_resource_set_string (entry, "nfo:entryUrl", to_uri);
-	tracker_resource_set_int (entry, "nfo:listPosition", data->track_counter);
-
-	if (data->track_counter == 1) {
-		/* This causes all existing relations to be deleted, when we serialize
-		 * to SPARQL. */
-		tracker_resource_set_relation (data->metadata, "nfo:hasMediaFileListEntry", entry);
-	} else {
-		tracker_resource_add_relation (data->metadata, "nfo:hasMediaFileListEntry", entry);
-	}
-	g_object_unref (entry);
+	add_entry (data, to_uri);
 
 	if (to_metadata) {
 		gchar *duration;
@@ -115,17 +311,47 @@ entry_parsed (TotemPlParser *parser,
 	}
 }
 
+static gboolean
+parse_playlist (GFile             *file,
+                PlaylistMetadata  *data,
+                GError           **error)
+{
+	TotemPlParser *pl;
+	g_autofree gchar *uri = NULL;
+	gboolean success = TRUE;
+
+	pl = totem_pl_parser_new ();
+	uri = g_file_get_uri (file);
+
+	g_object_set (pl, "recurse", FALSE, "disable-unsafe", TRUE, NULL);
+
+	g_signal_connect (G_OBJECT (pl), "playlist-started", G_CALLBACK (playlist_started), data);
+	g_signal_connect (G_OBJECT (pl), "entry-parsed", G_CALLBACK (entry_parsed), data);
+
+	if (totem_pl_parser_parse (pl, uri, FALSE) != TOTEM_PL_PARSER_RESULT_SUCCESS) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+		             "Playlist could not be parsed, no error given");
+		success = FALSE;
+	}
+
+	g_object_unref (pl);
+
+	return success;
+}
+
+#endif /* HAVE_TOTEM_PL_PARSER */
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
-	TotemPlParser *pl;
 	TrackerResource *metadata;
 	PlaylistMetadata data;
 	GFile *file;
 	gchar *uri, *resource_uri;
+	GError *inner_error = NULL;
+	gboolean success;
 
-	pl = totem_pl_parser_new ();
 	file = tracker_extract_info_get_file (info);
 	uri = g_file_get_uri (file);
 
@@ -134,22 +360,24 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	g_free (resource_uri);
 
 	data.track_counter = PLAYLIST_DEFAULT_NO_TRACKS;
+	data.max_entries = tracker_extract_info_get_max_list_entries (info);
 	data.total_time =  PLAYLIST_DEFAULT_DURATION;
 	data.title = NULL;
 
-	g_object_set (pl, "recurse", FALSE, "disable-unsafe", TRUE, NULL);
-
-	g_signal_connect (G_OBJECT (pl), "playlist-started", G_CALLBACK (playlist_started), &data);
-	g_signal_connect (G_OBJECT (pl), "entry-parsed", G_CALLBACK (entry_parsed), &data);
-
 	tracker_resource_add_uri (metadata, "rdf:type", "nmm:Playlist");
 	tracker_resource_add_uri (metadata, "rdf:type", "nfo:MediaList");
 
-	if (totem_pl_parser_parse (pl, uri, FALSE) == TOTEM_PL_PARSER_RESULT_SUCCESS) {
+#ifdef HAVE_TOTEM_PL_PARSER
+	if (!is_simple_playlist (tracker_extract_info_get_mimetype (info)))
+		success = parse_playlist (file, &data, &inner_error);
+	else
+#endif
+		success = parse_simple_playlist (file, &data, &inner_error);
+
+	if (success) {
 		if (data.title != NULL) {
 			g_debug ("Playlist title:'%s'", data.title);
 			tracker_resource_set_string (metadata, "nie:title", data.title);
-			g_free (data.title);
 		} else {
 			g_debug ("Playlist has no title, attempting to get one from filename");
 			tracker_guarantee_resource_title_from_file (metadata, "nie:title", NULL, uri, NULL);
@@ -163,10 +391,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 			tracker_resource_set_int64 (metadata, "nfo:entryCounter", data.track_counter);
 		}
 	} else {
-		g_warning ("Playlist could not be parsed, no error given");
+		g_warning ("%s", inner_error->message);
+		g_error_free (inner_error);
 	}
 
-	g_object_unref (pl);
+	g_free (data.title);
 	g_free (uri);
 
 	tracker_extract_info_set_resource (info, metadata);
@@ -20,6 +20,9 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+#include <unistd.h>
+
 #include <png.h>
 
 #include <libtracker-miners-common/tracker-file-utils.h>
@@ -28,6 +31,10 @@
 #define RFC1123_DATE_FORMAT "%d %B %Y %H:%M:%S %z"
 #define CMS_PER_INCH        2.54
 
+#define PNG_SIGNATURE_SIZE  8
+/* Length, type and CRC */
+#define CHUNK_OVERHEAD      12
+
 typedef struct {
 	const gchar *title;
 	const gchar *copyright;
@@ -184,7 +191,6 @@ static void
 read_metadata (TrackerResource      *metadata,
                png_structp           png_ptr,
                png_infop             info_ptr,
-               png_infop             end_ptr,
                GFile                *file,
                const gchar          *uri)
 {
@@ -192,141 +198,137 @@ read_metadata (TrackerResource      *metadata,
 	PngData pd = { 0 };
 	TrackerExifData *ed = NULL;
 	TrackerXmpData *xd = NULL;
-	png_infop info_ptrs[2];
 	png_textp text_ptr;
-	gint info_index;
 	gint num_text;
 	gint i;
 	gint found;
 	GPtrArray *keywords;
 
-	info_ptrs[0] = info_ptr;
-	info_ptrs[1] = end_ptr;
+	/* Text chunks after the image data were moved before it,
+	 * all of them are in @info_ptr.
+	 */
+	if ((found = png_get_text (png_ptr, info_ptr, &text_ptr, &num_text)) < 1) {
+		g_debug ("Calling png_get_text() returned %d (< 1)", found);
+		num_text = 0;
+	}
 
-	for (info_index = 0; info_index < 2; info_index++) {
-		if ((found = png_get_text (png_ptr, info_ptrs[info_index], &text_ptr, &num_text)) < 1) {
-			g_debug ("Calling png_get_text() returned %d (< 1)", found);
+	for (i = 0; i < num_text; i++) {
+		if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
 			continue;
 		}
 
-		for (i = 0; i < num_text; i++) {
-			if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
-				continue;
-			}
-
 #if defined(HAVE_EXEMPI) && defined(PNG_iTXt_SUPPORTED)
-			if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
-				/* ATM tracker_extract_xmp_read supports setting xd
-				 * multiple times, keep it that way as here it's
-				 * theoretically possible that the function gets
-				 * called multiple times
-				 */
-				xd = tracker_xmp_new (text_ptr[i].text,
-				                      text_ptr[i].itxt_length,
-				                      uri);
+		if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
+			/* ATM tracker_extract_xmp_read supports setting xd
+			 * multiple times, keep it that way as here it's
+			 * theoretically possible that the function gets
+			 * called multiple times
+			 */
+			xd = tracker_xmp_new (text_ptr[i].text,
+			                      text_ptr[i].itxt_length,
+			                      uri);
 
-				continue;
-			}
+			continue;
+		}
 
-			if (!xd && g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
-				gchar *xmp_buffer;
-				guint xmp_buffer_length = 0;
-				guint input_len;
+		if (!xd && g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
+			gchar *xmp_buffer;
+			guint xmp_buffer_length = 0;
+			guint input_len;
 
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
+			}
 
-				xmp_buffer = raw_profile_new (text_ptr[i].text,
-				                              input_len,
-				                              &xmp_buffer_length);
+			xmp_buffer = raw_profile_new (text_ptr[i].text,
+			                              input_len,
+			                              &xmp_buffer_length);
 
-				if (xmp_buffer) {
-					xd = tracker_xmp_new (xmp_buffer,
-					                      xmp_buffer_length,
-					                      uri);
-				}
+			if (xmp_buffer) {
+				xd = tracker_xmp_new (xmp_buffer,
+				                      xmp_buffer_length,
+				                      uri);
+			}
 
-				g_free (xmp_buffer);
+			g_free (xmp_buffer);
 
-				continue;
-			}
+			continue;
+		}
 #endif /*HAVE_EXEMPI && PNG_iTXt_SUPPORTED */
 
 #if defined(HAVE_LIBEXIF) && defined(PNG_iTXt_SUPPORTED)
-			if (!ed && g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
-				gchar *exif_buffer;
-				guint exif_buffer_length = 0;
-				guint input_len;
-
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
-
-				exif_buffer = raw_profile_new (text_ptr[i].text,
-				                               input_len,
-				                               &exif_buffer_length);
-
-				if (exif_buffer) {
-					ed = tracker_exif_new (exif_buffer,
-					                       exif_buffer_length,
-					                       uri);
-				}
-
-				g_free (exif_buffer);
-
-				continue;
+		if (!ed && g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
+			gchar *exif_buffer;
+			guint exif_buffer_length = 0;
+			guint input_len;
+
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
 			}
-#endif /* HAVE_LIBEXIF && PNG_iTXt_SUPPORTED */
 
-			if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
-				pd.author = text_ptr[i].text;
-				continue;
-			}
+			exif_buffer = raw_profile_new (text_ptr[i].text,
+			                               input_len,
+			                               &exif_buffer_length);
 
-			if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
-				pd.creator = text_ptr[i].text;
-				continue;
+			if (exif_buffer) {
+				ed = tracker_exif_new (exif_buffer,
+				                       exif_buffer_length,
+				                       uri);
 			}
 
-			if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
-				pd.description = text_ptr[i].text;
-				continue;
-			}
+			g_free (exif_buffer);
 
-			if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
-				pd.comment = text_ptr[i].text;
-				continue;
-			}
+			continue;
+		}
+#endif /* HAVE_LIBEXIF && PNG_iTXt_SUPPORTED */
 
-			if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
-				pd.copyright = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
+			pd.author = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
-				pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
+			pd.creator = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
-				pd.title = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
+			pd.description = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
-				pd.disclaimer = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
+			pd.comment = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
-				pd.software = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
+			pd.copyright = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
+			pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
+			pd.title = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
+			pd.disclaimer = text_ptr[i].text;
+			continue;
+		}
+
+		if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
+			pd.software = text_ptr[i].text;
+			continue;
 		}
 	}
 
@@ -593,6 +595,111 @@ read_metadata (TrackerResource      *metadata,
 	g_free (pd.creation_time);
 }
 
+static gboolean
+is_text_chunk (const guchar *type)
+{
+	return (memcmp (type, "tEXt", 4) == 0 ||
+	        memcmp (type, "zTXt", 4) == 0 ||
+	        memcmp (type, "iTXt", 4) == 0);
+}
+
+static gboolean
+read_chunk (int         fd,
+            goffset     offset,
+            gsize       len,
+            GByteArray *chunks)
+{
+	guint prev_len = chunks->len;
+
+	g_byte_array_set_size (chunks, prev_len + len);
+
+	if (pread (fd, chunks->data + prev_len, len, offset) != (gssize) len) {
+		g_byte_array_set_size (chunks, prev_len);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Collects the chunks libpng needs to read the info and text of the
+ * image, without reading the image data. Only chunk headers are read
+ * after the first IDAT, text chunks found there are moved before the
+ * image data, which is valid PNG. The image data is replaced by an
+ * empty IDAT header, for png_read_info() to stop at.
+ */
+static GByteArray *
+read_header_chunks (int     fd,
+                    goffset size)
+{
+	GByteArray *chunks;
+	gboolean has_image_data = FALSE;
+	goffset offset;
+
+	chunks = g_byte_array_new ();
+
+	if (!read_chunk (fd, 0, PNG_SIGNATURE_SIZE, chunks) ||
+	    png_sig_cmp (chunks->data, 0, PNG_SIGNATURE_SIZE) != 0)
+		goto fail;
+
+	offset = PNG_SIGNATURE_SIZE;
+
+	while (offset + CHUNK_OVERHEAD <= size) {
+		guchar header[8];
+		png_uint_32 len;
+
+		if (pread (fd, header, sizeof (header), offset) != sizeof (header))
+			goto fail;
+
+		len = png_get_uint_32 (header);
+		if (len > PNG_UINT_31_MAX ||
+		    len > size - offset - CHUNK_OVERHEAD)
+			goto fail;
+
+		if (memcmp (&header[4], "IEND", 4) == 0)
+			break;
+
+		if (memcmp (&header[4], "IDAT", 4) == 0 ||
+		    memcmp (&header[4], "fdAT", 4) == 0) {
+			has_image_data = TRUE;
+		} else if (!has_image_data || is_text_chunk (&header[4])) {
+			if (!read_chunk (fd, offset, len + CHUNK_OVERHEAD, chunks))
+				goto fail;
+		}
+
+		offset += len + CHUNK_OVERHEAD;
+	}
+
+	if (!has_image_data)
+		goto fail;
+
+	g_byte_array_append (chunks, (const guint8 *) "\0\0\0\0IDAT", 8);
+
+	return chunks;
+
+fail:
+	g_byte_array_unref (chunks);
+	return NULL;
+}
+
+typedef struct {
+	GByteArray *chunks;
+	gsize pos;
+} ChunkReader;
+
+static void
+read_chunks_fn (png_structp png_ptr,
+                png_bytep   data,
+                png_size_t  len)
+{
+	ChunkReader *reader = png_get_io_ptr (png_ptr);
+
+	if (len > reader->chunks->len - reader->pos)
+		png_error (png_ptr, "Read past the end of the header chunks");
+
+	memcpy (data, reader->chunks->data + reader->pos, len);
+	reader->pos += len;
+}
+
 static gboolean
 guess_dlna_profile (gint          depth,
                     gint          width,
@@ -641,12 +748,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 {
 	TrackerResource *metadata;
 	goffset size;
-	FILE *f;
+	int fd;
+	GByteArray *chunks;
+	ChunkReader reader = { 0 };
 	png_structp png_ptr;
 	png_infop info_ptr;
-	png_infop end_ptr;
-	png_bytep row_data;
-	guint row;
 	png_uint_32 width, height;
 	gint bit_depth, color_type;
 	gint interlace_type, compression_type, filter_type;
@@ -663,13 +769,25 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		             G_IO_ERROR,
 		             G_IO_ERROR_INVALID_DATA,
 		             "File too small to be a PNG");
+		g_free (filename);
 		return FALSE;
 	}
 
-	f = tracker_file_open (filename);
+	fd = tracker_file_open_fd (filename);
 	g_free (filename);
 
-	if (!f) {
+	if (fd == -1) {
+		return FALSE;
+	}
+
+	chunks = read_header_chunks (fd, size);
+	close (fd);
+
+	if (!chunks) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_INVALID_DATA,
+		             "Could not read PNG chunks");
 		return FALSE;
 	}
 
@@ -678,31 +796,25 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	                                  NULL,
 	                                  NULL);
 	if (!png_ptr) {
-		tracker_file_close (f, FALSE);
+		g_byte_array_unref (chunks);
 		return FALSE;
 	}
 
 	info_ptr = png_create_info_struct (png_ptr);
 	if (!info_ptr) {
 		png_destroy_read_struct (&png_ptr, NULL, NULL);
-		tracker_file_close (f, FALSE);
-		return FALSE;
-	}
-
-	end_ptr = png_create_info_struct (png_ptr);
-	if (!end_ptr) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
-		tracker_file_close (f, FALSE);
+		g_byte_array_unref (chunks);
 		return FALSE;
 	}
 
 	if (setjmp (png_jmpbuf (png_ptr))) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-		tracker_file_close (f, FALSE);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+		g_byte_array_unref (chunks);
 		return FALSE;
 	}
 
-	png_init_io (png_ptr, f);
+	reader.chunks = chunks;
+	png_set_read_fn (png_ptr, &reader, read_chunks_fn);
 	png_read_info (png_ptr, info_ptr);
 
 	if (!png_get_IHDR (png_ptr,
@@ -714,21 +826,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	                   &interlace_type,
 	                   &compression_type,
 	                   &filter_type)) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-		tracker_file_close (f, FALSE);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+		g_byte_array_unref (chunks);
 		return FALSE;
 	}
 
-	/* Read the image. FIXME We should be able to skip this step and
-	 * just get the info from the end. This causes some errors atm.
-	 */
-	row_data = png_malloc (png_ptr, png_get_rowbytes (png_ptr, info_ptr));
-	for (row = 0; row < height; row++)
-		png_read_row (png_ptr, row_data, NULL);
-	png_free (png_ptr, row_data);
-
-	png_read_end (png_ptr, end_ptr);
-
 	resource_uri = tracker_extract_info_get_content_id (info, NULL);
 	metadata = tracker_resource_new (resource_uri);
 	g_free (resource_uri);
@@ -738,7 +840,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 
 	uri = g_file_get_uri (file);
 
-	read_metadata (metadata, png_ptr, info_ptr, end_ptr, file, uri);
+	read_metadata (metadata, png_ptr, info_ptr, file, uri);
 	g_free (uri);
 
 	tracker_resource_set_int64 (metadata, "nfo:width", width);
@@ -749,8 +851,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		tracker_resource_set_string (metadata, "nmm:dlnaMime", dlna_mimetype);
 	}
 
-	png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
-	tracker_file_close (f, FALSE);
+	png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
+	g_byte_array_unref (chunks);
 
 	tracker_extract_info_set_resource (info, metadata);
 	g_object_unref (metadata);
@@ -26,6 +26,9 @@
 #include <libtracker-miners-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
 
+/* Deferred DSC comments are in the trailer, at the end of the document */
+#define TRAILER_SIZE (64 * 1024)
+
 static gchar *
 hour_day_str_day (const gchar *date)
 {
@@ -94,6 +97,29 @@ date_to_iso8601 (const gchar *date)
 	return NULL;
 }
 
+/* Skips the document body if the stream allows, so the trailer is found
+ * without reading the whole document. Compressed streams are read
+ * through.
+ */
+static void
+seek_to_trailer (GSeekable *seekable)
+{
+	goffset pos, end;
+
+	if (!g_seekable_can_seek (seekable))
+		return;
+
+	pos = g_seekable_tell (seekable);
+
+	if (!g_seekable_seek (seekable, 0, G_SEEK_END, NULL, NULL))
+		return;
+
+	end = g_seekable_tell (seekable);
+
+	g_seekable_seek (seekable, MAX (pos, end - TRAILER_SIZE),
+	                 G_SEEK_SET, NULL, NULL);
+}
+
 static TrackerResource *
 extract_ps_from_inputstream (GInputStream       *stream,
                              GFile              *file,
@@ -153,6 +179,8 @@ extract_ps_from_inputstream (GInputStream       *stream,
 				g_free (line);
 				break;
 			}
+
+			seek_to_trailer (G_SEEKABLE (data_stream));
 		}
 
 		g_free (line);
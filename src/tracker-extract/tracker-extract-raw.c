@@ -19,9 +19,12 @@
 
 #include "config-miners.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_GEXIV2
 #include <gexiv2/gexiv2.h>
+#endif
 
 #include <libtracker-extract/tracker-extract.h>
 #include <libtracker-miners-common/tracker-common.h>
@@ -64,6 +67,7 @@ typedef struct {
 	gchar *make;
 	gchar *metering_mode;
 	gchar *model;
+	gchar *orientation;
 	gchar *time;
 	gchar *time_original;
 	gchar *user_comment;
@@ -75,6 +79,8 @@ typedef struct {
 	gdouble focal_length;
 	gdouble iso_speed_ratings;
 	gint resolution_unit;
+	gint width;
+	gint height;
 } RawExifData;
 
 static void
@@ -94,6 +100,7 @@ raw_exif_data_free (RawExifData *ed)
 	g_free (ed->make);
 	g_free (ed->metering_mode);
 	g_free (ed->model);
+	g_free (ed->orientation);
 	g_free (ed->time);
 	g_free (ed->time_original);
 	g_free (ed->user_comment);
@@ -118,6 +125,96 @@ raw_exif_data_new (void)
 	return ed;
 }
 
+/* Empty strings are as good as missing */
+static gchar *
+steal_exif_string (gchar **str)
+{
+	if (tracker_is_blank_string (*str)) {
+		g_clear_pointer (str, g_free);
+		return NULL;
+	}
+
+	return g_steal_pointer (str);
+}
+
+static gdouble
+steal_exif_double (gchar **str)
+{
+	g_autofree gchar *value = NULL;
+
+	value = steal_exif_string (str);
+
+	return value ? g_ascii_strtod (value, NULL) : -1.0;
+}
+
+/* Reads the IFDs of TIFF based RAW files (CR2, NEF, ARW, DNG, ORF...)
+ * straight from a mapping of the file, only the pages holding the
+ * metadata are actually read.
+ */
+static RawExifData *
+parse_tiff_data (GBytes      *contents,
+                 const gchar *uri)
+{
+	TrackerExifData *exif;
+	RawExifData *ed;
+
+	if (g_bytes_get_size (contents) == 0)
+		return NULL;
+
+	exif = tracker_exif_new_from_tiff (g_bytes_get_data (contents, NULL),
+	                                   g_bytes_get_size (contents),
+	                                   uri);
+	if (!exif)
+		return NULL;
+
+	/* Not a layout we know the image size of */
+	if (!exif->x_dimension || !exif->y_dimension) {
+		tracker_exif_free (exif);
+		return NULL;
+	}
+
+	ed = raw_exif_data_new ();
+	ed->width = atoi (exif->x_dimension);
+	ed->height = atoi (exif->y_dimension);
+
+	ed->orientation = steal_exif_string (&exif->orientation);
+	if (!ed->orientation)
+		ed->orientation = g_strdup ("nfo:orientation-top");
+
+	ed->artist = steal_exif_string (&exif->artist);
+	ed->copyright = steal_exif_string (&exif->copyright);
+	ed->description = steal_exif_string (&exif->description);
+	ed->document_name = steal_exif_string (&exif->document_name);
+	ed->flash = steal_exif_string (&exif->flash);
+	ed->gps_altitude = steal_exif_string (&exif->gps_altitude);
+	ed->gps_direction = steal_exif_string (&exif->gps_direction);
+	ed->gps_latitude = steal_exif_string (&exif->gps_latitude);
+	ed->gps_longitude = steal_exif_string (&exif->gps_longitude);
+	ed->make = steal_exif_string (&exif->make);
+	ed->metering_mode = steal_exif_string (&exif->metering_mode);
+	ed->model = steal_exif_string (&exif->model);
+	ed->time = steal_exif_string (&exif->time);
+	ed->time_original = steal_exif_string (&exif->time_original);
+	ed->user_comment = steal_exif_string (&exif->user_comment);
+	ed->white_balance = steal_exif_string (&exif->white_balance);
+	ed->x_resolution = steal_exif_string (&exif->x_resolution);
+	ed->y_resolution = steal_exif_string (&exif->y_resolution);
+
+	ed->exposure_time = steal_exif_double (&exif->exposure_time);
+	ed->fnumber = steal_exif_double (&exif->fnumber);
+	ed->focal_length = steal_exif_double (&exif->focal_length);
+	ed->iso_speed_ratings = steal_exif_double (&exif->iso_speed_ratings);
+
+	if (exif->resolution_unit)
+		ed->resolution_unit = exif->resolution_unit;
+
+	tracker_exif_free (exif);
+
+	return ed;
+}
+
+#ifdef HAVE_GEXIV2
+
 static gchar *
 convert_exiv2_orientation_to_nfo (GExiv2Orientation orientation)
 {
@@ -317,31 +414,69 @@ out:
 	return ed;
 }
 
+static RawExifData *
+parse_exiv2_data (GBytes  *contents,
+                  GError **error)
+{
+	GError *inner_error = NULL;
+	GExiv2Metadata *metadata;
+	RawExifData *ed;
+
+	metadata = gexiv2_metadata_new ();
+
+	if (!gexiv2_metadata_open_buf (metadata,
+	                               g_bytes_get_data (contents, NULL),
+	                               g_bytes_get_size (contents),
+	                               &inner_error)) {
+		g_propagate_prefixed_error (error, inner_error, "Could not open: ");
+		g_object_unref (metadata);
+		return NULL;
+	}
+
+	ed = parse_exif_data (metadata);
+	ed->width = gexiv2_metadata_get_pixel_width (metadata);
+	ed->height = gexiv2_metadata_get_pixel_height (metadata);
+	ed->orientation =
+		convert_exiv2_orientation_to_nfo (gexiv2_metadata_get_orientation (metadata));
+
+	g_object_unref (metadata);
+
+	return ed;
+}
+
+#endif /* HAVE_GEXIV2 */
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
-	GError *inner_error = NULL;
 	GFile *file;
-	GExiv2Metadata *metadata = NULL;
-	GExiv2Orientation orientation;
 	RawExifData *ed = NULL;
 	TrackerResource *resource = NULL;
 	gboolean retval = FALSE;
 	const gchar *time_content_created;
-	gchar *filename = NULL;
-	gchar *nfo_orientation = NULL;
+	GBytes *contents;
 	gchar *uri = NULL, *resource_uri;
-	gint height;
-	gint width;
 
-	metadata = gexiv2_metadata_new ();
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
+	contents = tracker_extract_info_get_contents (info, error);
+	if (!contents)
+		return FALSE;
 
-	if (!gexiv2_metadata_open_path (metadata, filename, &inner_error)) {
-		g_propagate_prefixed_error (error, inner_error, "Could not open: ");
+	uri = g_file_get_uri (file);
+
+	ed = parse_tiff_data (contents, uri);
+
+	if (!ed) {
+#ifdef HAVE_GEXIV2
+		ed = parse_exiv2_data (contents, error);
+		if (!ed)
+			goto out;
+#else
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		             "Could not read TIFF metadata");
 		goto out;
+#endif
 	}
 
 	resource_uri = tracker_extract_info_get_content_id (info, NULL);
@@ -350,16 +485,9 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	tracker_resource_add_uri (resource, "rdf:type", "nmm:Photo");
 	g_free (resource_uri);
 
-	width = gexiv2_metadata_get_pixel_width (metadata);
-	tracker_resource_set_int (resource, "nfo:width", width);
-	height = gexiv2_metadata_get_pixel_height (metadata);
-	tracker_resource_set_int (resource, "nfo:height", height);
-
-	orientation = gexiv2_metadata_get_orientation (metadata);
-	nfo_orientation = convert_exiv2_orientation_to_nfo (orientation);
-	tracker_resource_set_uri (resource, "nfo:orientation", nfo_orientation);
-
-	ed = parse_exif_data (metadata);
+	tracker_resource_set_int (resource, "nfo:width", ed->width);
+	tracker_resource_set_int (resource, "nfo:height", ed->height);
+	tracker_resource_set_uri (resource, "nfo:orientation", ed->orientation);
 
 	if (ed->make != NULL || ed->model != NULL) {
 		TrackerResource *equipment;
@@ -369,7 +497,6 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		g_object_unref (equipment);
 	}
 
-	uri = g_file_get_uri (file);
 	tracker_guarantee_resource_title_from_file (resource, "nie:title", ed->document_name, uri, NULL);
 
 	if (ed->copyright != NULL)
@@ -457,11 +584,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	retval = TRUE;
 
 out:
-	g_clear_object (&metadata);
 	g_clear_object (&resource);
 	g_clear_pointer (&ed, raw_exif_data_free);
-	g_free (filename);
-	g_free (nfo_orientation);
 	g_free (uri);
 	return retval;
 }
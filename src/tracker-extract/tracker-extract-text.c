@@ -40,12 +40,58 @@
 #include "tracker-extract.h"
 #include "tracker-read.h"
 
+/* Appends the valid UTF-8 text in the last @n_bytes of the file,
+ * from the first line starting there.
+ */
+static void
+append_file_tail (GString **text,
+                  int       fd,
+                  goffset   size,
+                  gsize     n_bytes)
+{
+	g_autofree gchar *buf = NULL;
+	const gchar *start, *end;
+	gsize len = 0;
+
+	buf = g_malloc (n_bytes);
+
+	while (len < n_bytes) {
+		gssize n_read;
+
+		n_read = pread (fd, buf + len, n_bytes - len, size - n_bytes + len);
+		if (n_read < 0 && errno == EINTR)
+			continue;
+		if (n_read <= 0)
+			break;
+
+		len += n_read;
+	}
+
+	end = buf + len;
+	start = memchr (buf, '\n', len);
+	start = start ? start + 1 : buf;
+
+	/* Without lines, at least start at a whole character */
+	while (start < end && ((guchar) *start & 0xC0) == 0x80)
+		start++;
+
+	if (start == end)
+		return;
+
+	if (*text)
+		g_string_append_c (*text, '\n');
+
+	tracker_text_validate_utf8 (start, end - start, text, NULL);
+}
+
 static gchar *
 get_file_content (GFile   *file,
                   gsize    n_bytes,
+                  gsize    tail_bytes,
                   GError **error)
 {
 	gchar *text, *uri, *path;
+	struct stat st;
 	int fd;
 
 	uri = g_file_get_uri (file);
@@ -63,6 +109,47 @@ get_file_content (GFile   *file,
 		return NULL;
 	}
 
+	/* Files allowed as text by their name may still be binary dumps,
+	 * don't read those up to the limit.
+	 */
+	if (tracker_read_looks_binary (fd)) {
+		g_debug ("  Not reading '%s', it does not hold text", uri);
+		close (fd);
+		g_free (uri);
+		g_free (path);
+		return NULL;
+	}
+
+	if (tail_bytes > 0 && fstat (fd, &st) == 0 &&
+	    S_ISREG (st.st_mode) && (guint64) st.st_size > n_bytes) {
+		GString *str = NULL;
+
+		g_debug ("  Starting to read '%s' up to %" G_GSIZE_FORMAT " bytes, "
+		         "%" G_GSIZE_FORMAT " of them from the end...",
+		         uri, n_bytes, tail_bytes);
+
+		if (n_bytes > tail_bytes) {
+			int head_fd;
+
+			head_fd = dup (fd);
+			text = head_fd != -1 ?
+				tracker_read_text_from_fd (head_fd, n_bytes - tail_bytes, NULL) :
+				NULL;
+
+			if (text) {
+				str = g_string_new (text);
+				g_free (text);
+			}
+		}
+
+		append_file_tail (&str, fd, st.st_size, tail_bytes);
+		close (fd);
+		g_free (uri);
+		g_free (path);
+
+		return str ? g_string_free (str, FALSE) : NULL;
+	}
+
 	g_debug ("  Starting to read '%s' up to %" G_GSIZE_FORMAT " bytes...",
 	         uri, n_bytes);
 
@@ -91,6 +178,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 
 	content = get_file_content (tracker_extract_info_get_file (info),
 	                            tracker_extract_info_get_max_text (info),
+	                            tracker_extract_info_get_text_tail (info),
 	                            &inner_error);
 
 	if (inner_error != NULL) {
@@ -99,12 +187,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		return FALSE;
 	}
 
-	if (content) {
-		tracker_resource_set_string (metadata, "nie:plainTextContent", content);
-		g_free (content);
-	} else {
-		tracker_resource_set_string (metadata, "nie:plainTextContent", "");
-	}
+	/* Empty text still replaces what the file had before */
+	tracker_extract_info_take_text (info, content ? content : g_strdup (""));
 
 	tracker_extract_info_set_resource (info, metadata);
 	g_object_unref (metadata);
@@ -102,34 +102,81 @@ tiff_data_free (TiffData *tags)
 	g_free (tags->orientation);
 }
 
+static gchar *
+flash_to_string (guint16 flash)
+{
+	switch (flash) {
+	case 0x0001:
+	case 0x0009:
+	case 0x000D:
+	case 0x000F:
+	case 0x0019:
+	case 0x001D:
+	case 0x001F:
+	case 0x0041:
+	case 0x0045:
+	case 0x0047:
+	case 0x0049:
+	case 0x004D:
+	case 0x004F:
+	case 0x0059:
+	case 0x005F:
+	case 0x005D:
+		return g_strdup ("nmm:flash-on");
+	default:
+		return g_strdup ("nmm:flash-off");
+	}
+}
+
+static gchar *
+orientation_to_string (guint16 orientation)
+{
+	switch (orientation) {
+	case 1: return g_strdup ("nfo:orientation-top");
+	case 2:	return g_strdup ("nfo:orientation-top-mirror");
+	case 3:	return g_strdup ("nfo:orientation-bottom");
+	case 4:	return g_strdup ("nfo:orientation-bottom-mirror");
+	case 5:	return g_strdup ("nfo:orientation-left-mirror");
+	case 6:	return g_strdup ("nfo:orientation-right");
+	case 7:	return g_strdup ("nfo:orientation-right-mirror");
+	case 8:	return g_strdup ("nfo:orientation-left");
+	}
+
+	return NULL;
+}
+
+static gchar *
+metering_mode_to_string (guint16 metering_mode)
+{
+	switch (metering_mode) {
+	case 1: return g_strdup ("nmm:metering-mode-average");
+	case 2: return g_strdup ("nmm:metering-mode-center-weighted-average");
+	case 3: return g_strdup ("nmm:metering-mode-spot");
+	case 4: return g_strdup ("nmm:metering-mode-multispot");
+	case 5: return g_strdup ("nmm:metering-mode-pattern");
+	case 6: return g_strdup ("nmm:metering-mode-partial");
+	default:
+		return g_strdup ("nmm:metering-mode-other");
+	}
+}
+
+static gchar *
+white_balance_to_string (guint16 white_balance)
+{
+	if (white_balance == 0) {
+		return g_strdup ("nmm:white-balance-auto");
+	} else {
+		return g_strdup ("nmm:white-balance-manual");
+	}
+}
+
 static gchar *
 get_flash (TIFF *image)
 {
 	guint16 data = 0;
 
-	if (TIFFGetField (image, EXIFTAG_FLASH, &data)) {
-		switch (data) {
-		case 0x0001:
-		case 0x0009:
-		case 0x000D:
-		case 0x000F:
-		case 0x0019:
-		case 0x001D:
-		case 0x001F:
-		case 0x0041:
-		case 0x0045:
-		case 0x0047:
-		case 0x0049:
-		case 0x004D:
-		case 0x004F:
-		case 0x0059:
-		case 0x005F:
-		case 0x005D:
-			return g_strdup ("nmm:flash-on");
-		default:
-			return g_strdup ("nmm:flash-off");
-		}
-	}
+	if (TIFFGetField (image, EXIFTAG_FLASH, &data))
+		return flash_to_string (data);
 
 	return NULL;
 }
@@ -139,18 +186,8 @@ get_orientation (TIFF *image)
 {
 	guint16 data = 0;
 
-	if (TIFFGetField (image, TIFFTAG_ORIENTATION, &data)) {
-		switch (data) {
-		case 1: return g_strdup ("nfo:orientation-top");
-		case 2:	return g_strdup ("nfo:orientation-top-mirror");
-		case 3:	return g_strdup ("nfo:orientation-bottom");
-		case 4:	return g_strdup ("nfo:orientation-bottom-mirror");
-		case 5:	return g_strdup ("nfo:orientation-left-mirror");
-		case 6:	return g_strdup ("nfo:orientation-right");
-		case 7:	return g_strdup ("nfo:orientation-right-mirror");
-		case 8:	return g_strdup ("nfo:orientation-left");
-		}
-	}
+	if (TIFFGetField (image, TIFFTAG_ORIENTATION, &data))
+		return orientation_to_string (data);
 
 	return NULL;
 }
@@ -160,18 +197,8 @@ get_metering_mode (TIFF *image)
 {
 	guint16 data = 0;
 
-	if (TIFFGetField (image, EXIFTAG_METERINGMODE, &data)) {
-		switch (data) {
-		case 1: return g_strdup ("nmm:metering-mode-average");
-		case 2: return g_strdup ("nmm:metering-mode-center-weighted-average");
-		case 3: return g_strdup ("nmm:metering-mode-spot");
-		case 4: return g_strdup ("nmm:metering-mode-multispot");
-		case 5: return g_strdup ("nmm:metering-mode-pattern");
-		case 6: return g_strdup ("nmm:metering-mode-partial");
-		default: 
-			return g_strdup ("nmm:metering-mode-other");
-		}
-	}
+	if (TIFFGetField (image, EXIFTAG_METERINGMODE, &data))
+		return metering_mode_to_string (data);
 
 	return NULL;
 }
@@ -181,13 +208,8 @@ get_white_balance (TIFF *image)
 {
 	guint16 data = 0;
 
-	if (TIFFGetField (image, EXIFTAG_WHITEBALANCE, &data)) {
-		if (data == 0) {
-			return g_strdup ("nmm:white-balance-auto");
-		} else {
-			return g_strdup ("nmm:white-balance-manual");
-		}
-	}
+	if (TIFFGetField (image, EXIFTAG_WHITEBALANCE, &data))
+		return white_balance_to_string (data);
 
 	return NULL;
 }
@@ -251,24 +273,346 @@ tag_to_string (TIFF    *image,
 	return NULL;
 }
 
-G_MODULE_EXPORT gboolean
-tracker_extract_get_metadata (TrackerExtractInfo  *info,
-                              GError             **error)
+/* Reader of the first IFD, only the directory entries and the values
+ * they point to are read from the file. This avoids libtiff reading
+ * the strip and tile tables of huge images, or every other directory.
+ */
+
+/* Largest string or embedded XMP/IPTC blob read from the file */
+#define TIFF_MAX_STRING_SIZE (64 * 1024)
+#define TIFF_MAX_BLOB_SIZE (16 * 1024 * 1024)
+
+#define TIFF_ENTRY_SIZE 12
+
+/* Sizes of the TIFF data types, by type */
+static const guint8 tiff_type_sizes[] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8, 4 };
+
+typedef struct {
+	int fd;
+	gboolean big_endian;
+} TiffFile;
+
+typedef struct {
+	guchar *entries;
+	guint n_entries;
+} TiffIfd;
+
+static guint16
+tiff_get_short (const TiffFile *file,
+                const guchar   *p)
+{
+	if (file->big_endian)
+		return (p[0] << 8) | p[1];
+	else
+		return (p[1] << 8) | p[0];
+}
+
+static guint32
+tiff_get_long (const TiffFile *file,
+               const guchar   *p)
+{
+	if (file->big_endian)
+		return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	else
+		return ((guint32) p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+static gboolean
+tiff_read_ifd (const TiffFile *file,
+               guint32         offset,
+               TiffIfd        *ifd)
+{
+	guchar count[2];
+	gsize len;
+
+	if (offset < 8 ||
+	    pread (file->fd, count, sizeof (count), offset) != sizeof (count))
+		return FALSE;
+
+	ifd->n_entries = tiff_get_short (file, count);
+	len = ifd->n_entries * TIFF_ENTRY_SIZE;
+	ifd->entries = g_malloc (len);
+
+	if (pread (file->fd, ifd->entries, len, (goffset) offset + 2) != (gssize) len) {
+		g_clear_pointer (&ifd->entries, g_free);
+		ifd->n_entries = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static const guchar *
+tiff_ifd_lookup (const TiffFile *file,
+                 const TiffIfd  *ifd,
+                 guint16         tag)
+{
+	guint i;
+
+	for (i = 0; i < ifd->n_entries; i++) {
+		const guchar *entry = &ifd->entries[i * TIFF_ENTRY_SIZE];
+
+		if (tiff_get_short (file, entry) == tag)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Returns the nul terminated value of @tag, wherever it is stored */
+static guchar *
+tiff_ifd_read_value (const TiffFile *file,
+                     const TiffIfd  *ifd,
+                     guint16         tag,
+                     gsize           max_size,
+                     guint16        *type,
+                     gsize          *size)
+{
+	const guchar *entry;
+	guint64 len;
+	guchar *value;
+
+	entry = tiff_ifd_lookup (file, ifd, tag);
+	if (!entry)
+		return NULL;
+
+	*type = tiff_get_short (file, entry + 2);
+	if (*type == 0 || *type >= G_N_ELEMENTS (tiff_type_sizes))
+		return NULL;
+
+	len = (guint64) tiff_get_long (file, entry + 4) * tiff_type_sizes[*type];
+	if (len == 0 || len > max_size)
+		return NULL;
+
+	value = g_malloc (len + 1);
+	value[len] = '\0';
+
+	if (len <= 4) {
+		memcpy (value, entry + 8, len);
+	} else if (pread (file->fd, value, len,
+	                  tiff_get_long (file, entry + 8)) != (gssize) len) {
+		g_free (value);
+		return NULL;
+	}
+
+	*size = len;
+
+	return value;
+}
+
+static gchar *
+tiff_ifd_get_string (const TiffFile *file,
+                     const TiffIfd  *ifd,
+                     guint16         tag)
+{
+	guchar *value;
+	guint16 type;
+	gsize size;
+
+	value = tiff_ifd_read_value (file, ifd, tag, TIFF_MAX_STRING_SIZE, &type, &size);
+	if (value && type != TIFF_ASCII)
+		g_clear_pointer (&value, g_free);
+
+	return (gchar *) value;
+}
+
+/* First value of a SHORT or LONG tag */
+static gboolean
+tiff_ifd_get_uint (const TiffFile *file,
+                   const TiffIfd  *ifd,
+                   guint16         tag,
+                   guint32        *value)
+{
+	g_autofree guchar *data = NULL;
+	guint16 type;
+	gsize size;
+
+	data = tiff_ifd_read_value (file, ifd, tag, TIFF_MAX_STRING_SIZE, &type, &size);
+	if (!data)
+		return FALSE;
+
+	if (type == TIFF_SHORT)
+		*value = tiff_get_short (file, data);
+	else if (type == TIFF_LONG || type == TIFF_IFD)
+		*value = tiff_get_long (file, data);
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
+/* As a float, like libtiff hands EXIF rationals */
+static gboolean
+tiff_ifd_get_float (const TiffFile *file,
+                    const TiffIfd  *ifd,
+                    guint16         tag,
+                    gfloat         *value)
+{
+	g_autofree guchar *data = NULL;
+	guint32 numerator, denominator;
+	guint16 type;
+	gsize size;
+
+	data = tiff_ifd_read_value (file, ifd, tag, TIFF_MAX_STRING_SIZE, &type, &size);
+	if (!data || (type != TIFF_RATIONAL && type != TIFF_SRATIONAL))
+		return FALSE;
+
+	numerator = tiff_get_long (file, data);
+	denominator = tiff_get_long (file, data + 4);
+	if (denominator == 0)
+		return FALSE;
+
+	if (type == TIFF_SRATIONAL)
+		*value = (gdouble) (gint32) numerator / (gint32) denominator;
+	else
+		*value = (gdouble) numerator / denominator;
+
+	return TRUE;
+}
+
+static gchar *
+tiff_ifd_get_uint_str (const TiffFile *file,
+                       const TiffIfd  *ifd,
+                       guint16         tag)
+{
+	guint32 value;
+
+	if (!tiff_ifd_get_uint (file, ifd, tag, &value))
+		return NULL;
+
+	return g_strdup_printf ("%i", value);
+}
+
+static gchar *
+tiff_ifd_get_float_str (const TiffFile *file,
+                        const TiffIfd  *ifd,
+                        guint16         tag)
+{
+	gfloat value;
+
+	if (!tiff_ifd_get_float (file, ifd, tag, &value))
+		return NULL;
+
+	return g_strdup_printf ("%f", value);
+}
+
+static gchar *
+tiff_ifd_get_date (const TiffFile *file,
+                   const TiffIfd  *ifd,
+                   guint16         tag)
+{
+	g_autofree gchar *date = NULL;
+
+	date = tiff_ifd_get_string (file, ifd, tag);
+
+	return tracker_date_guess (date);
+}
+
+/* Returns FALSE if the file is left to libtiff, e.g. BigTIFF */
+static gboolean
+read_tiff_native (int               fd,
+                  const gchar      *uri,
+                  TiffData         *td,
+                  TrackerExifData  *ed,
+                  TrackerXmpData  **xd,
+                  TrackerIptcData **id)
+{
+	TiffFile file = { fd, FALSE };
+	TiffIfd ifd0 = { 0 }, exif_ifd = { 0 };
+	guchar header[8];
+	guint32 value;
+
+	if (pread (fd, header, sizeof (header), 0) != sizeof (header))
+		return FALSE;
+
+	if (memcmp (header, "II*\0", 4) == 0)
+		file.big_endian = FALSE;
+	else if (memcmp (header, "MM\0*", 4) == 0)
+		file.big_endian = TRUE;
+	else
+		return FALSE;
+
+	if (!tiff_read_ifd (&file, tiff_get_long (&file, header + 4), &ifd0))
+		return FALSE;
+
+	/* Get Tiff specifics */
+	td->width = tiff_ifd_get_uint_str (&file, &ifd0, TIFFTAG_IMAGEWIDTH);
+	td->length = tiff_ifd_get_uint_str (&file, &ifd0, TIFFTAG_IMAGELENGTH);
+	td->artist = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_ARTIST);
+	td->copyright = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_COPYRIGHT);
+	td->date = tiff_ifd_get_date (&file, &ifd0, TIFFTAG_DATETIME);
+	td->title = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_DOCUMENTNAME);
+	td->description = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_IMAGEDESCRIPTION);
+	td->make = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_MAKE);
+	td->model = tiff_ifd_get_string (&file, &ifd0, TIFFTAG_MODEL);
+
+	if (tiff_ifd_get_uint (&file, &ifd0, TIFFTAG_ORIENTATION, &value))
+		td->orientation = orientation_to_string (value);
+
+#ifdef HAVE_LIBIPTCDATA
+	{
+		g_autofree guchar *iptc = NULL;
+		guint16 type;
+		gsize size;
+
+		iptc = tiff_ifd_read_value (&file, &ifd0, TIFFTAG_RICHTIFFIPTC,
+		                            TIFF_MAX_BLOB_SIZE, &type, &size);
+		if (iptc && (type == TIFF_LONG || type == TIFF_UNDEFINED || type == TIFF_BYTE))
+			*id = tracker_iptc_new (iptc, size, uri);
+	}
+#endif /* HAVE_LIBIPTCDATA */
+
+#ifdef HAVE_EXEMPI
+	{
+		g_autofree guchar *xmp = NULL;
+		guint16 type;
+		gsize size;
+
+		xmp = tiff_ifd_read_value (&file, &ifd0, TIFFTAG_XMLPACKET,
+		                           TIFF_MAX_BLOB_SIZE, &type, &size);
+		if (xmp)
+			*xd = tracker_xmp_new ((const gchar *) xmp, size, uri);
+	}
+#endif /* HAVE_EXEMPI */
+
+	/* Get Exif specifics */
+	if (tiff_ifd_get_uint (&file, &ifd0, TIFFTAG_EXIFIFD, &value) &&
+	    tiff_read_ifd (&file, value, &exif_ifd)) {
+		ed->exposure_time = tiff_ifd_get_float_str (&file, &exif_ifd, EXIFTAG_EXPOSURETIME);
+		ed->fnumber = tiff_ifd_get_float_str (&file, &exif_ifd, EXIFTAG_FNUMBER);
+		ed->iso_speed_ratings = tiff_ifd_get_uint_str (&file, &exif_ifd, EXIFTAG_ISOSPEEDRATINGS);
+		ed->time_original = tiff_ifd_get_date (&file, &exif_ifd, EXIFTAG_DATETIMEORIGINAL);
+
+		if (tiff_ifd_get_uint (&file, &exif_ifd, EXIFTAG_METERINGMODE, &value))
+			ed->metering_mode = metering_mode_to_string (value);
+		if (tiff_ifd_get_uint (&file, &exif_ifd, EXIFTAG_FLASH, &value))
+			ed->flash = flash_to_string (value);
+
+		ed->focal_length = tiff_ifd_get_float_str (&file, &exif_ifd, EXIFTAG_FOCALLENGTH);
+
+		if (tiff_ifd_get_uint (&file, &exif_ifd, EXIFTAG_WHITEBALANCE, &value))
+			ed->white_balance = white_balance_to_string (value);
+
+		g_free (exif_ifd.entries);
+	}
+
+	g_free (ifd0.entries);
+
+	return TRUE;
+}
+
+static gboolean
+read_tiff_libtiff (int               fd,
+                   const gchar      *filename,
+                   const gchar      *uri,
+                   TiffData         *td,
+                   TrackerExifData  *ed,
+                   TrackerXmpData  **xd,
+                   TrackerIptcData **id)
 {
-	TrackerResource *metadata;
 	TIFF *image;
-	TrackerXmpData *xd = NULL;
-	TrackerIptcData *id = NULL;
-	TrackerExifData *ed = NULL;
-	MergeData md = { 0 };
-	TiffData td = { 0 };
-	gchar *filename, *uri, *resource_uri;
 	gchar *date;
 	glong exif_offset;
-	GPtrArray *keywords;
-	guint i;
-	GFile *file;
-	int fd;
 
 #ifdef HAVE_LIBIPTCDATA
 	gchar *iptc_offset;
@@ -280,38 +624,8 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	guint32 size;
 #endif /* HAVE_EXEMPI */
 
-	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
-
-	fd = tracker_file_open_fd (filename);
-
-	if (fd == -1) {
-		g_set_error (error,
-		             G_IO_ERROR,
-		             g_io_error_from_errno (errno),
-		             "Could not open tiff file: %s",
-		             g_strerror (errno));
-		g_free (filename);
-		return FALSE;
-	}
-
-	if ((image = TIFFFdOpen (fd, filename, "r")) == NULL){
-		g_set_error (error,
-		             G_IO_ERROR,
-		             G_IO_ERROR_INVALID_ARGUMENT,
-		             "Could not parse tiff file");
-		g_free (filename);
-		close (fd);
+	if ((image = TIFFFdOpen (fd, filename, "r")) == NULL)
 		return FALSE;
-	}
-
-	resource_uri = tracker_extract_info_get_content_id (info, NULL);
-	metadata = tracker_resource_new (resource_uri);
-	tracker_resource_add_uri (metadata, "rdf:type", "nfo:Image");
-	tracker_resource_add_uri (metadata, "rdf:type", "nmm:Photo");
-	g_free (resource_uri);
-
-	uri = g_file_get_uri (file);
 
 #ifdef HAVE_LIBIPTCDATA
 	if (TIFFGetField (image,
@@ -334,58 +648,34 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 				iptc_size = 4 * iptc_size;
 			}
 
-			id = tracker_iptc_new (iptc_offset, iptc_size, uri);
+			*id = tracker_iptc_new (iptc_offset, iptc_size, uri);
 		}
 	}
 #endif /* HAVE_LIBIPTCDATA */
 
-	if (!id) {
-		id = g_new0 (TrackerIptcData, 1);
-	}
-
 	/* FIXME There are problems between XMP data embedded with different tools
 	   due to bugs in the original spec (type) */
 #ifdef HAVE_EXEMPI
 	if (TIFFGetField (image, TIFFTAG_XMLPACKET, &size, &xmp_offset)) {
-		xd = tracker_xmp_new (xmp_offset, size, uri);
-	} else {
-		gchar *sidecar = NULL;
-
-		xd = tracker_xmp_new_from_sidecar (file, &sidecar);
-
-		if (sidecar) {
-			TrackerResource *sidecar_resource;
-
-			sidecar_resource = tracker_resource_new (sidecar);
-			tracker_resource_add_uri (sidecar_resource, "rdf:type", "nfo:FileDataObject");
-			tracker_resource_add_relation (sidecar_resource, "nie:interpretedAs", metadata);
-
-			tracker_resource_add_take_relation (metadata, "nie:isStoredAs", sidecar_resource);
-		}
+		*xd = tracker_xmp_new (xmp_offset, size, uri);
 	}
 #endif /* HAVE_EXEMPI */
 
-	if (!xd) {
-		xd = g_new0 (TrackerXmpData, 1);
-	}
-
-	ed = g_new0 (TrackerExifData, 1);
-
 	/* Get Tiff specifics */
-	td.width = tag_to_string (image, TIFFTAG_IMAGEWIDTH, TAG_TYPE_UINT32);
-	td.length = tag_to_string (image, TIFFTAG_IMAGELENGTH, TAG_TYPE_UINT32);
-	td.artist = tag_to_string (image, TIFFTAG_ARTIST, TAG_TYPE_STRING);
-	td.copyright = tag_to_string (image, TIFFTAG_COPYRIGHT, TAG_TYPE_STRING);
+	td->width = tag_to_string (image, TIFFTAG_IMAGEWIDTH, TAG_TYPE_UINT32);
+	td->length = tag_to_string (image, TIFFTAG_IMAGELENGTH, TAG_TYPE_UINT32);
+	td->artist = tag_to_string (image, TIFFTAG_ARTIST, TAG_TYPE_STRING);
+	td->copyright = tag_to_string (image, TIFFTAG_COPYRIGHT, TAG_TYPE_STRING);
 
 	date = tag_to_string (image, TIFFTAG_DATETIME, TAG_TYPE_STRING);
-	td.date = tracker_date_guess (date);
+	td->date = tracker_date_guess (date);
 	g_free (date);
 
-	td.title = tag_to_string (image, TIFFTAG_DOCUMENTNAME, TAG_TYPE_STRING);
-	td.description = tag_to_string (image, TIFFTAG_IMAGEDESCRIPTION, TAG_TYPE_STRING);
-	td.make = tag_to_string (image, TIFFTAG_MAKE, TAG_TYPE_STRING);
-	td.model = tag_to_string (image, TIFFTAG_MODEL, TAG_TYPE_STRING);
-	td.orientation = get_orientation (image);
+	td->title = tag_to_string (image, TIFFTAG_DOCUMENTNAME, TAG_TYPE_STRING);
+	td->description = tag_to_string (image, TIFFTAG_IMAGEDESCRIPTION, TAG_TYPE_STRING);
+	td->make = tag_to_string (image, TIFFTAG_MAKE, TAG_TYPE_STRING);
+	td->model = tag_to_string (image, TIFFTAG_MODEL, TAG_TYPE_STRING);
+	td->orientation = get_orientation (image);
 
 	/* Get Exif specifics */
 	if (TIFFGetField (image, TIFFTAG_EXIFIFD, &exif_offset)) {
@@ -405,9 +695,94 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		}
 	}
 
+	/* Also closes the file descriptor */
 	TIFFClose (image);
+
+	return TRUE;
+}
+
+G_MODULE_EXPORT gboolean
+tracker_extract_get_metadata (TrackerExtractInfo  *info,
+                              GError             **error)
+{
+	TrackerResource *metadata;
+	TrackerXmpData *xd = NULL;
+	TrackerIptcData *id = NULL;
+	TrackerExifData *ed = NULL;
+	MergeData md = { 0 };
+	TiffData td = { 0 };
+	gchar *filename, *uri, *resource_uri;
+	GPtrArray *keywords;
+	guint i;
+	GFile *file;
+	int fd;
+
+	file = tracker_extract_info_get_file (info);
+	filename = g_file_get_path (file);
+
+	fd = tracker_file_open_fd (filename);
+
+	if (fd == -1) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not open tiff file: %s",
+		             g_strerror (errno));
+		g_free (filename);
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (file);
+	ed = g_new0 (TrackerExifData, 1);
+
+	if (read_tiff_native (fd, uri, &td, ed, &xd, &id)) {
+		close (fd);
+	} else if (!read_tiff_libtiff (fd, filename, uri, &td, ed, &xd, &id)) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_INVALID_ARGUMENT,
+		             "Could not parse tiff file");
+		tracker_exif_free (ed);
+		g_free (filename);
+		g_free (uri);
+		close (fd);
+		return FALSE;
+	}
+
 	g_free (filename);
 
+	resource_uri = tracker_extract_info_get_content_id (info, NULL);
+	metadata = tracker_resource_new (resource_uri);
+	tracker_resource_add_uri (metadata, "rdf:type", "nfo:Image");
+	tracker_resource_add_uri (metadata, "rdf:type", "nmm:Photo");
+	g_free (resource_uri);
+
+	if (!id) {
+		id = g_new0 (TrackerIptcData, 1);
+	}
+
+#ifdef HAVE_EXEMPI
+	if (!xd) {
+		gchar *sidecar = NULL;
+
+		xd = tracker_xmp_new_from_sidecar (file, &sidecar);
+
+		if (sidecar) {
+			TrackerResource *sidecar_resource;
+
+			sidecar_resource = tracker_resource_new (sidecar);
+			tracker_resource_add_uri (sidecar_resource, "rdf:type", "nfo:FileDataObject");
+			tracker_resource_add_relation (sidecar_resource, "nie:interpretedAs", metadata);
+
+			tracker_resource_add_take_relation (metadata, "nie:isStoredAs", sidecar_resource);
+		}
+	}
+#endif /* HAVE_EXEMPI */
+
+	if (!xd) {
+		xd = g_new0 (TrackerXmpData, 1);
+	}
+
 	md.title = tracker_coalesce_strip (5, xd->title, xd->pdf_title, td.title, ed->document_name, xd->title2);
 	md.orientation = tracker_coalesce_strip (4, xd->orientation, td.orientation, ed->orientation, id->image_orientation);
 	md.copyright = tracker_coalesce_strip (4, xd->rights, td.copyright, ed->copyright, id->copyright_notice);
@@ -692,7 +1067,6 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	tracker_xmp_free (xd);
 	tracker_iptc_free (id);
 	g_free (uri);
-	close (fd);
 
 	tracker_extract_info_set_resource (info, metadata);
 	g_object_unref (metadata);
@@ -21,6 +21,8 @@
 
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <gmodule.h>
 #include <glib/gi18n.h>
@@ -45,35 +47,148 @@
 
 G_DEFINE_QUARK (TrackerExtractError, tracker_extract_error)
 
-#define DEFAULT_DEADLINE_SECONDS 5
+/* Per-task quotas, each may be overridden through the environment
+ * (TRACKER_EXTRACT_DEADLINE, TRACKER_EXTRACT_CPU_DEADLINE and
+ * TRACKER_EXTRACT_MAX_RSS), a value of 0 disables the check.
+ */
+#define DEFAULT_DEADLINE_SECONDS 30
+#define DEFAULT_CPU_DEADLINE_SECONDS 5
+#define DEFAULT_MAX_RSS_MB 2048
+
+/* Once a module processed enough files, the time deadlines of each
+ * task are adapted to the time it is expected to take given the
+ * file size, with a margin, and bounded by a factor around the
+ * configured deadlines.
+ */
+#define THROUGHPUT_MIN_SAMPLES 10
+#define THROUGHPUT_DECAY 0.99
+#define DEADLINE_MARGIN 10
+#define DEADLINE_RANGE 5
+
+#define QUOTA_CHECK_INTERVAL_MS 500
 
 #define DEFAULT_MAX_TEXT 1048576
+#define DEFAULT_MAX_LIST_ENTRIES 1000
+#define DEFAULT_MEDIA_PROBE_SIZE 1048576
+#define DEFAULT_MEDIA_ANALYZE_DURATION 1000
+#define DEFAULT_MODULE_IDLE_TIMEOUT 300
+
+#define MODULE_IDLE_CHECK_INTERVAL_S 30
+
+/* Upper bound for worker threads running a thread-safe module */
+#define MAX_WORKERS 16
+
+/* Files for modules taking less than this on average are handed
+ * to workers in batches, up to the given number of files each.
+ */
+#define BATCH_MAX_FILE_USEC 2000
+#define BATCH_MAX_FILES 32
 
 static gint deadline_seconds = -1;
+static gint cpu_deadline_seconds = -1;
+static gint max_rss_mb = -1;
+
+enum {
+	QUOTA_EXCEEDED,
+	N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = { 0, };
 
 extern gboolean debug;
 
+/* Counters of one worker thread for its module, only written from
+ * that thread and merged when logged, so workers never wait on each
+ * other for these. Each takes two cache lines, so no two workers
+ * share one regardless of the alignment of the array holding them.
+ */
+#define WORKER_STATISTICS_SIZE 128
+
+typedef struct {
+	gsize n_extracted;
+	gsize n_failed;
+	gsize bytes;
+	gsize usec;
+	guint8 padding[WORKER_STATISTICS_SIZE - 4 * sizeof (gsize)];
+} WorkerStatistics;
+
+G_STATIC_ASSERT (sizeof (WorkerStatistics) == WORKER_STATISTICS_SIZE);
+
+/* Least squares fit of processing time against file size, with
+ * older samples decaying so the fit follows recent behavior.
+ */
+typedef struct {
+	gdouble n;
+	gdouble sum_size;
+	gdouble sum_time;
+	gdouble sum_size2;
+	gdouble sum_size_time;
+	guint n_samples;
+} ModuleThroughput;
+
+typedef struct {
+	GAsyncQueue *queue;
+	guint n_threads;
+	guint max_threads;
+	gboolean thread_safe;
+
+	/* Tasks dispatched to the queue and not yet finished */
+	gint n_pending;
+	/* Last dispatch time, and whether the module was shut down
+	 * since, only accessed from the main thread.
+	 */
+	gint64 last_used;
+	gboolean shut_down;
+
+	/* Protected by task_mutex */
+	ModuleThroughput throughput;
+
+	/* One slot per worker thread, in spawn order */
+	WorkerStatistics statistics[MAX_WORKERS];
+} ExtractorQueue;
+
 typedef struct {
-	GTimer *elapsed;
-	gint extracted_count;
-	gint failed_count;
-} StatisticsData;
+	GAsyncQueue *queue;
+	WorkerStatistics *statistics;
+} ExtractorWorker;
 
 typedef struct {
-	GHashTable *statistics_data;
 	GList *running_tasks;
 
+	/* Tasks waiting to be dispatched from the main thread, and
+	 * the idle source doing it, protected by task_mutex.
+	 */
+	GQueue pending_tasks;
+	guint dispatch_id;
+	/* Whether the last dispatched files were cheap enough to batch */
+	gboolean batching;
+
+	/* Checks the quotas of running tasks, while there are any */
+	GSource *quota_check;
+	/* Shuts down modules that were not used for a while */
+	guint module_idle_check_id;
+	guint module_idle_timeout;
+
 	gint max_text;
+	gint text_tail;
+	GVariant *text_limits_variant;
+	TrackerTextLimits *text_limits;
+	guint max_list_entries;
+	guint media_probe_size;
+	guint media_analyze_duration;
+	guint max_workers;
 
 	/* used to maintain the running tasks
 	 * and stats from different threads
 	 */
 	GMutex task_mutex;
 
-	/* module -> async queue hashtable
-	 * for single-threaded extractors
+	/* module -> ExtractorQueue hashtable, each queue
+	 * is served by one thread for thread-unsafe
+	 * extractors, and up to max_workers threads for
+	 * extractors declared thread safe.
 	 */
-	GHashTable *single_thread_extractors;
+	GHashTable *extractor_queues;
 
 	gboolean disable_shutdown;
 
@@ -83,6 +198,17 @@ typedef struct {
 	gint unhandled_count;
 } TrackerExtractPrivate;
 
+/* Files processed in a row by one worker, the quotas apply to
+ * the whole batch, accounting is protected by task_mutex.
+ */
+typedef struct {
+	GPtrArray *tasks;
+	gint64 run_start;
+	clockid_t cpu_clock;
+	gint64 cpu_start;
+	gboolean cpu_accounting;
+} TrackerExtractBatch;
+
 typedef struct {
 	TrackerExtract *extract;
 	GCancellable *cancellable;
@@ -92,19 +218,35 @@ typedef struct {
 	gchar *mimetype;
 	const gchar *graph;
 	gint max_text;
+	gint text_tail;
+	guint max_list_entries;
+	guint media_probe_size;
+	guint media_analyze_duration;
 
 	TrackerExtractMetadataFunc func;
 	GModule *module;
+	ExtractorQueue *extractor_queue;
+	TrackerExtractBatch *batch;
 
-	GSource *deadline;
+	/* Accounting for quotas, protected by task_mutex */
+	gint64 run_start;
+	gint64 deadline;
+	gint64 cpu_deadline;
+	goffset size;
+	clockid_t cpu_clock;
+	gint64 cpu_start;
 
 	guint success : 1;
+	guint cpu_accounting : 1;
 } TrackerExtractTask;
 
 static void tracker_extract_finalize (GObject *object);
 static void log_statistics        (GObject *object);
-static gboolean get_metadata         (TrackerExtractTask *task);
-static gboolean dispatch_task_cb     (TrackerExtractTask *task);
+static const gchar * get_module_basename (GModule *module);
+static gboolean dispatch_pending_cb  (gpointer            user_data);
+static gboolean module_throughput_get_rate (ModuleThroughput *throughput,
+                                            gdouble          *usec_per_byte,
+                                            gdouble          *usec_per_file);
 
 
 G_DEFINE_TYPE_WITH_PRIVATE(TrackerExtract, tracker_extract, G_TYPE_OBJECT)
@@ -117,13 +259,45 @@ tracker_extract_class_init (TrackerExtractClass *klass)
 	object_class = G_OBJECT_CLASS (klass);
 
 	object_class->finalize = tracker_extract_finalize;
+
+	signals[QUOTA_EXCEEDED] =
+		g_signal_new ("quota-exceeded",
+		              G_OBJECT_CLASS_TYPE (object_class),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 2,
+		              G_TYPE_STRING,
+		              G_TYPE_STRING);
+}
+
+static inline void
+worker_statistics_add (gsize *counter,
+                       gsize  value)
+{
+	/* Only the owning worker writes, other threads just
+	 * need to never see a torn value.
+	 */
+	g_atomic_pointer_set (counter, GSIZE_TO_POINTER (*counter + value));
+}
+
+static inline gsize
+worker_statistics_get (gsize *counter)
+{
+	return GPOINTER_TO_SIZE (g_atomic_pointer_get (counter));
 }
 
 static void
-statistics_data_free (StatisticsData *data)
+extractor_queue_free (ExtractorQueue *extractor_queue)
 {
-	g_timer_destroy (data->elapsed);
-	g_slice_free (StatisticsData, data);
+	g_async_queue_unref (extractor_queue->queue);
+	TRACKER_MEMORY_FREE (EXTRACTOR, sizeof (ExtractorQueue));
+	g_slice_free (ExtractorQueue, extractor_queue);
+}
+
+static guint
+default_max_workers (void)
+{
+	return CLAMP (g_get_num_processors (), 1, MAX_WORKERS);
 }
 
 static void
@@ -132,15 +306,20 @@ tracker_extract_init (TrackerExtract *object)
 	TrackerExtractPrivate *priv;
 
 	priv = TRACKER_EXTRACT_GET_PRIVATE (object);
-	priv->single_thread_extractors = g_hash_table_new (NULL, NULL);
+	priv->extractor_queues = g_hash_table_new_full (NULL, NULL, NULL,
+	                                                (GDestroyNotify) extractor_queue_free);
 	priv->max_text = DEFAULT_MAX_TEXT;
+	priv->text_limits = tracker_text_limits_new (priv->max_text, 0, NULL);
+	priv->max_list_entries = DEFAULT_MAX_LIST_ENTRIES;
+	priv->media_probe_size = DEFAULT_MEDIA_PROBE_SIZE;
+	priv->media_analyze_duration = DEFAULT_MEDIA_ANALYZE_DURATION;
+	priv->module_idle_timeout = DEFAULT_MODULE_IDLE_TIMEOUT;
+	priv->max_workers = default_max_workers ();
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
 		priv->total_elapsed = g_timer_new ();
 		g_timer_stop (priv->total_elapsed);
-		priv->statistics_data = g_hash_table_new_full (NULL, NULL, NULL,
-		                                               (GDestroyNotify) statistics_data_free);
 	}
 #endif
 
@@ -154,18 +333,26 @@ tracker_extract_finalize (GObject *object)
 
 	priv = TRACKER_EXTRACT_GET_PRIVATE (object);
 
-	tracker_module_manager_shutdown_modules ();
-
-	g_hash_table_destroy (priv->single_thread_extractors);
-
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
 		log_statistics (object);
-		g_hash_table_destroy (priv->statistics_data);
 		g_timer_destroy (priv->total_elapsed);
 	}
 #endif
 
+	g_clear_handle_id (&priv->module_idle_check_id, g_source_remove);
+	tracker_module_manager_shutdown_modules ();
+
+	g_hash_table_destroy (priv->extractor_queues);
+
+	g_clear_pointer (&priv->text_limits, tracker_text_limits_unref);
+	g_clear_pointer (&priv->text_limits_variant, g_variant_unref);
+
+	if (priv->quota_check) {
+		g_source_destroy (priv->quota_check);
+		g_source_unref (priv->quota_check);
+	}
+
 	g_mutex_clear (&priv->task_mutex);
 
 	G_OBJECT_CLASS (tracker_extract_parent_class)->finalize (object);
@@ -180,6 +367,7 @@ log_statistics (GObject *object)
 		GHashTableIter iter;
 		gpointer key, value;
 		gdouble total_elapsed;
+		gboolean handled = FALSE;
 
 		priv = TRACKER_EXTRACT_GET_PRIVATE (object);
 
@@ -188,32 +376,56 @@ log_statistics (GObject *object)
 		g_message ("--------------------------------------------------");
 		g_message ("Statistics:");
 
-		g_hash_table_iter_init (&iter, priv->statistics_data);
+		g_hash_table_iter_init (&iter, priv->extractor_queues);
 		total_elapsed = g_timer_elapsed (priv->total_elapsed, NULL);
 
 		while (g_hash_table_iter_next (&iter, &key, &value)) {
 			GModule *module = key;
-			StatisticsData *data = value;
+			ExtractorQueue *extractor_queue = value;
+			WorkerStatistics total = { 0, };
+			gdouble usec_per_byte, usec_per_file;
+			guint i;
+
+			if (!module)
+				continue;
 
-			if (data->extracted_count > 0 || data->failed_count > 0) {
-				const gchar *name, *name_without_path;
+			for (i = 0; i < G_N_ELEMENTS (extractor_queue->statistics); i++) {
+				WorkerStatistics *worker = &extractor_queue->statistics[i];
 
-				name = g_module_name (module);
-				name_without_path = strrchr (name, G_DIR_SEPARATOR) + 1;
+				total.n_extracted += worker_statistics_get (&worker->n_extracted);
+				total.n_failed += worker_statistics_get (&worker->n_failed);
+				total.bytes += worker_statistics_get (&worker->bytes);
+				total.usec += worker_statistics_get (&worker->usec);
+			}
+
+			if (total.n_extracted == 0)
+				continue;
 
-				g_message ("    Module:'%s', extracted:%d, failures:%d, elapsed: %.2fs (%.2f%% of total)",
-				           name_without_path,
-				           data->extracted_count,
-				           data->failed_count,
-					   g_timer_elapsed (data->elapsed, NULL),
-					   (g_timer_elapsed (data->elapsed, NULL) / total_elapsed) * 100);
+			handled = TRUE;
+
+			/* Busy time is added up over workers, so it may
+			 * exceed the total with several of them.
+			 */
+			g_message ("    Module:'%s', extracted:%" G_GSIZE_FORMAT ", failures:%" G_GSIZE_FORMAT ", "
+			           "read: %.2f MB, busy: %.2fs (%.2f%% of total)",
+			           get_module_basename (module),
+			           total.n_extracted,
+			           total.n_failed,
+			           total.bytes / 1000000.0,
+			           (gdouble) total.usec / G_USEC_PER_SEC,
+			           ((gdouble) total.usec / G_USEC_PER_SEC / total_elapsed) * 100);
+
+			if (module_throughput_get_rate (&extractor_queue->throughput,
+			                                &usec_per_byte, &usec_per_file)) {
+				g_message ("        Rate: %.2f MB/s, %.3fs per file",
+				           usec_per_byte > 0 ? 1 / usec_per_byte : 0,
+				           usec_per_file / G_USEC_PER_SEC);
 			}
 		}
 
 		g_message ("Unhandled files: %d", priv->unhandled_count);
 
-		if (priv->unhandled_count == 0 &&
-		    g_hash_table_size (priv->statistics_data) < 1) {
+		if (priv->unhandled_count == 0 && !handled) {
 			g_message ("    No files handled");
 		}
 
@@ -252,7 +464,6 @@ notify_task_finish (TrackerExtractTask *task,
 {
 	TrackerExtract *extract;
 	TrackerExtractPrivate *priv;
-	StatisticsData *stats_data;
 
 	extract = task->extract;
 	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
@@ -264,19 +475,8 @@ notify_task_finish (TrackerExtractTask *task,
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		if (task->module) {
-			stats_data = g_hash_table_lookup (priv->statistics_data,
-			                                  task->module);
-			if (stats_data) {
-				stats_data->extracted_count++;
-
-				if (!success) {
-					stats_data->failed_count++;
-				}
-			}
-		} else {
+		if (!task->module)
 			priv->unhandled_count++;
-		}
 
 		if (!priv->running_tasks && g_timer_is_active (priv->total_elapsed))
 			g_timer_stop (priv->total_elapsed);
@@ -300,6 +500,11 @@ get_file_metadata (TrackerExtractTask  *task,
 
 	file = g_file_new_for_uri (task->file);
 	info = tracker_extract_info_new (file, task->content_id, task->mimetype, task->graph, task->max_text);
+	tracker_extract_info_set_text_tail (info, task->text_tail);
+	tracker_extract_info_set_max_list_entries (info, task->max_list_entries);
+	tracker_extract_info_set_media_probe_limits (info,
+	                                             task->media_probe_size,
+	                                             task->media_analyze_duration);
 	g_object_unref (file);
 
 	if (!task->mimetype || !*task->mimetype) {
@@ -315,6 +520,9 @@ get_file_metadata (TrackerExtractTask  *task,
 		         g_module_name (task->module));
 
 		task->success = (task->func) (info, error);
+
+		/* Do not hold the file open while the result is queued */
+		tracker_extract_info_release_contents (info);
 	} else {
 		g_autoptr (TrackerResource) resource = NULL;
 
@@ -334,17 +542,367 @@ get_file_metadata (TrackerExtractTask  *task,
 	return task->success;
 }
 
+static gint
+get_quota (const gchar *envvar,
+           gint         default_value)
+{
+	const gchar *value;
+
+	value = g_getenv (envvar);
+	if (value)
+		return atoi (value);
+
+	return default_value;
+}
+
+static void
+ensure_quotas (void)
+{
+	if (deadline_seconds >= 0)
+		return;
+
+	deadline_seconds = get_quota ("TRACKER_EXTRACT_DEADLINE",
+	                              DEFAULT_DEADLINE_SECONDS);
+	cpu_deadline_seconds = get_quota ("TRACKER_EXTRACT_CPU_DEADLINE",
+	                                  DEFAULT_CPU_DEADLINE_SECONDS);
+	max_rss_mb = get_quota ("TRACKER_EXTRACT_MAX_RSS",
+	                        DEFAULT_MAX_RSS_MB);
+}
+
+static gint64
+get_clock_usec (clockid_t clock)
+{
+	struct timespec ts;
+
+	if (clock_gettime (clock, &ts) < 0)
+		return -1;
+
+	return ((gint64) ts.tv_sec * G_USEC_PER_SEC) + (ts.tv_nsec / 1000);
+}
+
+static gint64
+get_resident_size (void)
+{
+	g_autofree gchar *contents = NULL;
+	gchar **fields;
+	gint64 resident = -1;
+
+	/* Second field of statm is the resident set size, in pages */
+	if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+		return -1;
+
+	fields = g_strsplit (contents, " ", 3);
+	if (g_strv_length (fields) >= 2)
+		resident = g_ascii_strtoll (fields[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+	g_strfreev (fields);
+
+	return resident;
+}
+
+static void
+module_throughput_add_sample (ModuleThroughput *throughput,
+                              goffset           size,
+                              gint64            usec)
+{
+	throughput->n = throughput->n * THROUGHPUT_DECAY + 1;
+	throughput->sum_size = throughput->sum_size * THROUGHPUT_DECAY + size;
+	throughput->sum_time = throughput->sum_time * THROUGHPUT_DECAY + usec;
+	throughput->sum_size2 = throughput->sum_size2 * THROUGHPUT_DECAY +
+		(gdouble) size * size;
+	throughput->sum_size_time = throughput->sum_size_time * THROUGHPUT_DECAY +
+		(gdouble) size * usec;
+	throughput->n_samples++;
+}
+
+/* Gets the processing time per byte and per file in microseconds,
+ * if there are enough samples to tell.
+ */
+static gboolean
+module_throughput_get_rate (ModuleThroughput *throughput,
+                            gdouble          *usec_per_byte,
+                            gdouble          *usec_per_file)
+{
+	gdouble mean_size, mean_time, variance, per_byte = 0;
+
+	if (throughput->n_samples < THROUGHPUT_MIN_SAMPLES)
+		return FALSE;
+
+	mean_size = throughput->sum_size / throughput->n;
+	mean_time = throughput->sum_time / throughput->n;
+	variance = throughput->sum_size2 / throughput->n - mean_size * mean_size;
+
+	/* With similarly sized files, it is all time per file */
+	if (variance > 1)
+		per_byte = (throughput->sum_size_time / throughput->n -
+		            mean_size * mean_time) / variance;
+
+	per_byte = MAX (per_byte, 0);
+	*usec_per_byte = per_byte;
+	*usec_per_file = MAX (mean_time - per_byte * mean_size, 0);
+
+	return TRUE;
+}
+
+static gint64
+get_task_deadline (TrackerExtractTask *task,
+                   gint                configured_seconds)
+{
+	gdouble usec_per_byte, usec_per_file, expected;
+	gint64 configured;
+
+	if (configured_seconds <= 0)
+		return 0;
+
+	configured = (gint64) configured_seconds * G_USEC_PER_SEC;
+
+	if (task->size < 0 || !task->extractor_queue ||
+	    !module_throughput_get_rate (&task->extractor_queue->throughput,
+	                                 &usec_per_byte, &usec_per_file))
+		return configured;
+
+	expected = usec_per_file + usec_per_byte * task->size;
+
+	return CLAMP ((gint64) (expected * DEADLINE_MARGIN),
+	              configured / DEADLINE_RANGE,
+	              configured * DEADLINE_RANGE);
+}
+
+static goffset
+get_file_size (const gchar *uri)
+{
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileInfo) info = NULL;
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (!info)
+		return -1;
+
+	return g_file_info_get_size (info);
+}
+
+/* Called from the worker thread, so the CPU time used by
+ * the module can be read from the thread checking quotas.
+ */
+static void
+task_start_accounting (TrackerExtractTask *task)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
+	goffset size;
+
+	size = get_file_size (task->file);
+
+	g_mutex_lock (&priv->task_mutex);
+
+	task->size = size;
+
+	if (task->batch) {
+		TrackerExtractBatch *batch = task->batch;
+
+		/* Time and CPU are accounted since the batch started,
+		 * against the configured quotas.
+		 */
+		if (batch->run_start == 0) {
+			batch->run_start = g_get_monotonic_time ();
+
+			if (pthread_getcpuclockid (pthread_self (), &batch->cpu_clock) == 0) {
+				batch->cpu_start = get_clock_usec (batch->cpu_clock);
+				batch->cpu_accounting = batch->cpu_start >= 0;
+			}
+		}
+
+		task->deadline = deadline_seconds > 0 ?
+			(gint64) deadline_seconds * G_USEC_PER_SEC : 0;
+		task->cpu_deadline = cpu_deadline_seconds > 0 ?
+			(gint64) cpu_deadline_seconds * G_USEC_PER_SEC : 0;
+		task->run_start = batch->run_start;
+		task->cpu_clock = batch->cpu_clock;
+		task->cpu_start = batch->cpu_start;
+		task->cpu_accounting = batch->cpu_accounting;
+	} else {
+		task->deadline = get_task_deadline (task, deadline_seconds);
+		task->cpu_deadline = get_task_deadline (task, cpu_deadline_seconds);
+		task->run_start = g_get_monotonic_time ();
+
+		if (pthread_getcpuclockid (pthread_self (), &task->cpu_clock) == 0) {
+			task->cpu_start = get_clock_usec (task->cpu_clock);
+			task->cpu_accounting = task->cpu_start >= 0;
+		}
+	}
+
+	g_mutex_unlock (&priv->task_mutex);
+}
+
+/* Called with task_mutex held */
+static void
+task_record_throughput (TrackerExtractTask *task,
+                        gint64              usec)
+{
+	if (task->size < 0 || !task->extractor_queue)
+		return;
+
+	module_throughput_add_sample (&task->extractor_queue->throughput,
+	                              task->size, usec);
+}
+
+static gchar *
+describe_quota (TrackerExtractTask *task,
+                const gchar        *reason,
+                gint64              spent,
+                gint64              deadline)
+{
+	gdouble usec_per_byte, usec_per_file;
+	g_autofree gchar *size = NULL, *rate = NULL;
+
+	size = g_format_size (MAX (task->size, 0));
+
+	if (!task->extractor_queue ||
+	    !module_throughput_get_rate (&task->extractor_queue->throughput,
+	                                 &usec_per_byte, &usec_per_file)) {
+		return g_strdup_printf ("%s (%.1fs of %.1fs allowed, %s, module rate not known yet)",
+		                        reason,
+		                        (gdouble) spent / G_USEC_PER_SEC,
+		                        (gdouble) deadline / G_USEC_PER_SEC,
+		                        size);
+	}
+
+	if (usec_per_byte > 0)
+		rate = g_format_size ((guint64) (G_USEC_PER_SEC / usec_per_byte));
+
+	return g_strdup_printf ("%s (%.1fs of %.1fs allowed, %s, module rate %s/s and %.3fs per file)",
+	                        reason,
+	                        (gdouble) spent / G_USEC_PER_SEC,
+	                        (gdouble) deadline / G_USEC_PER_SEC,
+	                        size,
+	                        rate ? rate : "unbounded",
+	                        usec_per_file / G_USEC_PER_SEC);
+}
+
+/* Tasks waiting in a queue are not checked, they are
+ * held back by the running ones, which are.
+ */
+static gchar *
+task_check_quotas (TrackerExtractTask *task,
+                   gint64              now)
+{
+	if (task->run_start == 0)
+		return NULL;
+
+	if (task->deadline > 0 &&
+	    now - task->run_start > task->deadline) {
+		return describe_quota (task,
+		                       task->batch ?
+		                       "took too long to process in its batch" :
+		                       "took too long to process",
+		                       now - task->run_start, task->deadline);
+	}
+
+	if (task->cpu_deadline > 0 && task->cpu_accounting) {
+		gint64 cpu_time;
+
+		cpu_time = get_clock_usec (task->cpu_clock);
+		if (cpu_time >= 0 &&
+		    cpu_time - task->cpu_start > task->cpu_deadline) {
+			return describe_quota (task,
+			                       task->batch ?
+			                       "used too much CPU time in its batch" :
+			                       "used too much CPU time",
+			                       cpu_time - task->cpu_start,
+			                       task->cpu_deadline);
+		}
+	}
+
+	return NULL;
+}
+
 static gboolean
-task_deadline_cb (gpointer user_data)
+quota_check_cb (gpointer user_data)
 {
-	TrackerExtractTask *task = user_data;
+	TrackerExtract *extract = user_data;
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	g_autofree gchar *file = NULL, *reason = NULL;
+	gint64 now, resident;
+	GList *l;
+
+	g_mutex_lock (&priv->task_mutex);
+
+	if (!priv->running_tasks) {
+		g_clear_pointer (&priv->quota_check, g_source_unref);
+		g_mutex_unlock (&priv->task_mutex);
+		return G_SOURCE_REMOVE;
+	}
+
+	now = g_get_monotonic_time ();
+
+	for (l = priv->running_tasks; l; l = l->next) {
+		TrackerExtractTask *task = l->data;
+
+		reason = task_check_quotas (task, now);
+		if (reason) {
+			file = g_strdup (task->file);
+			break;
+		}
+	}
+
+	/* Memory is shared by all tasks, it can only be blamed
+	 * on a file if it is the only one being processed.
+	 */
+	if (!reason && max_rss_mb > 0) {
+		resident = get_resident_size ();
+
+		if (resident > (gint64) max_rss_mb * 1024 * 1024) {
+			reason = g_strdup ("made the extractor use too much memory");
+
+			if (!priv->running_tasks->next) {
+				TrackerExtractTask *task = priv->running_tasks->data;
+
+				file = g_strdup (task->file);
+			}
+		}
+	}
 
-	g_warning ("File '%s' took too long to process. Shutting down everything",
-	           task->file);
+	g_mutex_unlock (&priv->task_mutex);
+
+	if (!reason)
+		return G_SOURCE_CONTINUE;
+
+	if (file) {
+		g_warning ("File '%s' %s. Shutting down everything",
+		           file, reason);
+		g_signal_emit (extract, signals[QUOTA_EXCEEDED], 0, file, reason);
+	} else {
+		g_warning ("Processing files %s. Shutting down everything",
+		           reason);
+	}
 
 	exit (EXIT_FAILURE);
 }
 
+/* Called with task_mutex held */
+static void
+ensure_quota_check (TrackerExtract *extract,
+                    GMainContext   *context)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	if (priv->quota_check || RUNNING_ON_VALGRIND)
+		return;
+
+	ensure_quotas ();
+
+	if (deadline_seconds <= 0 &&
+	    cpu_deadline_seconds <= 0 &&
+	    max_rss_mb <= 0)
+		return;
+
+	priv->quota_check = g_timeout_source_new (QUOTA_CHECK_INTERVAL_MS);
+	g_source_set_callback (priv->quota_check, quota_check_cb, extract, NULL);
+	g_source_attach (priv->quota_check, context);
+}
+
 static TrackerExtractTask *
 extract_task_new (TrackerExtract *extract,
                   const gchar    *uri,
@@ -356,6 +914,7 @@ extract_task_new (TrackerExtract *extract,
 {
 	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
 	TrackerExtractTask *task;
+	const gchar *graph;
 	gchar *mimetype_used;
 
 	if (!mimetype || !*mimetype) {
@@ -392,25 +951,17 @@ extract_task_new (TrackerExtract *extract,
 	task->content_id = g_strdup (content_id);
 	task->mimetype = mimetype_used;
 	task->extract = extract;
-	task->max_text = priv->max_text;
-
-	if (task->res && !RUNNING_ON_VALGRIND) {
-		if (deadline_seconds < 0) {
-			const gchar *deadline_envvar;
-
-			deadline_envvar = g_getenv ("TRACKER_EXTRACT_DEADLINE");
-			if (deadline_envvar)
-				deadline_seconds = atoi (deadline_envvar);
-			else
-				deadline_seconds = DEFAULT_DEADLINE_SECONDS;
-		}
-
-		task->deadline =
-			g_timeout_source_new_seconds (deadline_seconds);
-		g_source_set_callback (task->deadline, task_deadline_cb, task, NULL);
-		g_source_attach (task->deadline,
-		                 g_task_get_context (G_TASK (task->res)));
-	}
+	graph = mimetype_used ? tracker_extract_module_manager_get_graph (mimetype_used) : NULL;
+	task->max_text = tracker_text_limits_get_max_text (priv->text_limits,
+	                                                   mimetype_used, graph);
+	task->text_tail = tracker_text_limits_get_tail (priv->text_limits,
+	                                                mimetype_used, graph);
+	task->max_list_entries = priv->max_list_entries;
+	task->media_probe_size = priv->media_probe_size;
+	task->media_analyze_duration = priv->media_analyze_duration;
+	task->size = -1;
+
+	TRACKER_MEMORY_ALLOC (EXTRACTOR, sizeof (TrackerExtractTask));
 
 	return task;
 }
@@ -420,11 +971,6 @@ extract_task_free (TrackerExtractTask *task)
 {
 	notify_task_finish (task, task->success);
 
-	if (task->deadline) {
-		g_source_destroy (task->deadline);
-		g_source_unref (task->deadline);
-	}
-
 	if (task->res) {
 		g_object_unref (task->res);
 	}
@@ -437,9 +983,31 @@ extract_task_free (TrackerExtractTask *task)
 	g_free (task->file);
 	g_free (task->content_id);
 
+	TRACKER_MEMORY_FREE (EXTRACTOR, sizeof (TrackerExtractTask));
 	g_slice_free (TrackerExtractTask, task);
 }
 
+static TrackerExtractBatch *
+extract_batch_new (void)
+{
+	TrackerExtractBatch *batch;
+
+	batch = g_slice_new0 (TrackerExtractBatch);
+	batch->tasks = g_ptr_array_sized_new (BATCH_MAX_FILES);
+	TRACKER_MEMORY_ALLOC (EXTRACTOR, sizeof (TrackerExtractBatch));
+
+	return batch;
+}
+
+/* Tasks are freed as they are processed */
+static void
+extract_batch_free (TrackerExtractBatch *batch)
+{
+	g_ptr_array_unref (batch->tasks);
+	TRACKER_MEMORY_FREE (EXTRACTOR, sizeof (TrackerExtractBatch));
+	g_slice_free (TrackerExtractBatch, batch);
+}
+
 static gboolean
 filter_module (TrackerExtract *extract,
                GModule        *module)
@@ -487,12 +1055,58 @@ filter_module (TrackerExtract *extract,
 	return filter;
 }
 
+static const gchar *
+get_module_basename (GModule *module)
+{
+	const gchar *name, *basename;
+
+	if (!module)
+		return NULL;
+
+	name = g_module_name (module);
+	basename = strrchr (name, G_DIR_SEPARATOR);
+
+	return basename ? basename + 1 : name;
+}
+
+#ifdef HAVE_USDT
+static gsize
+get_text_length (TrackerExtractInfo *info)
+{
+	const gchar *text;
+
+	text = tracker_extract_info_get_text (info);
+
+	return text ? strlen (text) : 0;
+}
+#endif
+
+static void
+record_module_latency (GModule *module,
+                       gint64   usec)
+{
+	g_autofree gchar *name = NULL;
+
+	if (!module)
+		return;
+
+	name = g_strconcat (TRACKER_METRIC_EXTRACT_PREFIX,
+	                    get_module_basename (module), NULL);
+	tracker_metrics_record (name, usec);
+}
+
+TRACKER_TRACE_DEFINE (extract_start);
+TRACKER_TRACE_DEFINE (extract_done);
+TRACKER_TRACE_DEFINE (extract_dispatch);
+
 static gboolean
-get_metadata (TrackerExtractTask *task)
+get_metadata (TrackerExtractTask *task,
+              WorkerStatistics   *statistics)
 {
 	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
 	TrackerExtractInfo *info;
 	GError *error = NULL;
+	gint64 start, elapsed;
 
 #ifdef THREAD_ENABLE_TRACE
 	g_debug ("Thread:%p --> '%s': Collected metadata",
@@ -505,29 +1119,32 @@ get_metadata (TrackerExtractTask *task)
 		return FALSE;
 	}
 
-#ifdef G_ENABLE_DEBUG
-	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		StatisticsData *stats_data;
-
-		stats_data = g_hash_table_lookup (priv->statistics_data,
-						  task->module);
-		if (!stats_data) {
-			stats_data = g_slice_new0 (StatisticsData);
-			stats_data->elapsed = g_timer_new ();
-			g_hash_table_insert (priv->statistics_data,
-					     task->module,
-					     stats_data);
-		} else {
-			g_timer_continue (stats_data->elapsed);
-		}
+	task_start_accounting (task);
+	start = g_get_monotonic_time ();
+
+	if (TRACKER_TRACE_ENABLED (extract_start)) {
+		TRACKER_TRACE (extract_start, task->file,
+		               get_module_basename (task->module));
 	}
-#endif
 
 	if (!filter_module (task->extract, task->module) &&
 	    get_file_metadata (task, &info, &error)) {
+		/* The info is no longer ours once returned */
+		if (TRACKER_TRACE_ENABLED (extract_done)) {
+			TRACKER_TRACE (extract_done, task->file,
+			               get_module_basename (task->module),
+			               get_text_length (info), 1);
+		}
+
 		g_task_return_pointer (G_TASK (task->res), info,
 		                       (GDestroyNotify) tracker_extract_info_unref);
 	} else {
+		if (TRACKER_TRACE_ENABLED (extract_done)) {
+			TRACKER_TRACE (extract_done, task->file,
+			               get_module_basename (task->module),
+			               0, 0);
+		}
+
 		if (error) {
 			g_task_return_error (G_TASK (task->res), error);
 		} else {
@@ -539,15 +1156,19 @@ get_metadata (TrackerExtractTask *task)
 		}
 	}
 
-#ifdef G_ENABLE_DEBUG
-	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		StatisticsData *stats_data;
+	elapsed = g_get_monotonic_time () - start;
+	record_module_latency (task->module, elapsed);
 
-		stats_data = g_hash_table_lookup (priv->statistics_data,
-						  task->module);
-		g_timer_stop (stats_data->elapsed);
+	if (task->success) {
+		g_mutex_lock (&priv->task_mutex);
+		task_record_throughput (task, elapsed);
+		g_mutex_unlock (&priv->task_mutex);
 	}
-#endif
+
+	worker_statistics_add (&statistics->n_extracted, 1);
+	worker_statistics_add (&statistics->n_failed, task->success ? 0 : 1);
+	worker_statistics_add (&statistics->bytes, MAX (task->size, 0));
+	worker_statistics_add (&statistics->usec, MAX (elapsed, 0));
 
 	extract_task_free (task);
 
@@ -555,32 +1176,141 @@ get_metadata (TrackerExtractTask *task)
 }
 
 static gpointer
-single_thread_get_metadata (GAsyncQueue *queue)
+worker_thread_get_metadata (ExtractorWorker *worker)
 {
 	while (TRUE) {
 		TrackerExtractTask *task;
 
-		task = g_async_queue_pop (queue);
+		ExtractorQueue *extractor_queue;
+
+		task = g_async_queue_pop (worker->queue);
 #ifdef THREAD_ENABLE_TRACE
-		g_debug ("Thread:%p --> '%s': Dispatching in dedicated thread",
+		g_debug ("Thread:%p --> '%s': Dispatching in worker thread",
 		         g_thread_self(), task->file);
 #endif /* THREAD_ENABLE_TRACE */
-		get_metadata (task);
+		extractor_queue = task->extractor_queue;
+
+		if (task->batch) {
+			TrackerExtractBatch *batch = task->batch;
+			guint i;
+
+			for (i = 0; i < batch->tasks->len; i++) {
+				get_metadata (g_ptr_array_index (batch->tasks, i),
+				              worker->statistics);
+				g_atomic_int_dec_and_test (&extractor_queue->n_pending);
+			}
+
+			extract_batch_free (batch);
+		} else {
+			get_metadata (task, worker->statistics);
+			g_atomic_int_dec_and_test (&extractor_queue->n_pending);
+		}
 	}
 
 	return NULL;
 }
 
+static gboolean
+extractor_queue_spawn_thread (ExtractorQueue  *extractor_queue,
+                              GError         **error)
+{
+	ExtractorWorker *worker;
+	GThread *thread;
+
+	g_assert (extractor_queue->n_threads < G_N_ELEMENTS (extractor_queue->statistics));
+
+	/* Workers never exit, so neither is this freed */
+	worker = g_new0 (ExtractorWorker, 1);
+	worker->queue = g_async_queue_ref (extractor_queue->queue);
+	worker->statistics = &extractor_queue->statistics[extractor_queue->n_threads];
+
+	thread = g_thread_try_new ("extract-worker",
+	                           (GThreadFunc) worker_thread_get_metadata,
+	                           worker,
+	                           error);
+	if (!thread) {
+		g_async_queue_unref (worker->queue);
+		g_free (worker);
+		return FALSE;
+	}
+
+	/* We won't join the thread, so just unref it here */
+	g_thread_unref (thread);
+	extractor_queue->n_threads++;
+
+	return TRUE;
+}
+
+static gboolean
+module_idle_check_cb (gpointer user_data)
+{
+	TrackerExtract *extract = user_data;
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	ExtractorQueue *extractor_queue;
+	GHashTableIter iter;
+	GModule *module;
+	gboolean in_use = FALSE;
+	gint64 now;
+
+	if (priv->module_idle_timeout == 0) {
+		priv->module_idle_check_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	now = g_get_monotonic_time ();
+	g_hash_table_iter_init (&iter, priv->extractor_queues);
+
+	while (g_hash_table_iter_next (&iter, (gpointer *) &module, (gpointer *) &extractor_queue)) {
+		if (!module || extractor_queue->shut_down)
+			continue;
+
+		/* Tasks are only dispatched from this thread, so the
+		 * module can not get a new one while shutting down.
+		 */
+		if (g_atomic_int_get (&extractor_queue->n_pending) > 0 ||
+		    now - extractor_queue->last_used <
+		    (gint64) priv->module_idle_timeout * G_USEC_PER_SEC) {
+			in_use = TRUE;
+			continue;
+		}
+
+		if (tracker_module_manager_shutdown_module (module))
+			g_debug ("Shut down idle module '%s'", g_module_name (module));
+
+		extractor_queue->shut_down = TRUE;
+	}
+
+	if (!in_use) {
+		priv->module_idle_check_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+ensure_module_idle_check (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	if (priv->module_idle_check_id != 0 || priv->module_idle_timeout == 0)
+		return;
+
+	priv->module_idle_check_id =
+		g_timeout_add_seconds (MODULE_IDLE_CHECK_INTERVAL_S,
+		                       module_idle_check_cb, extract);
+}
+
 /* This function is executed in the main thread, decides the
- * module that's going to be run for a given task, and dispatches
- * the task according to the threading strategy of that module.
+ * module that's going to be run for a given task, and returns the
+ * queue of that module, or %NULL if the task was finished already.
  */
-static gboolean
-dispatch_task_cb (TrackerExtractTask *task)
+static ExtractorQueue *
+prepare_task (TrackerExtractTask *task)
 {
 	TrackerExtractPrivate *priv;
 	GError *error = NULL;
-	GAsyncQueue *async_queue;
+	ExtractorQueue *extractor_queue;
 
 #ifdef THREAD_ENABLE_TRACE
 	g_debug ("Thread:%p (Main) <-- '%s': Handling task...\n",
@@ -590,6 +1320,8 @@ dispatch_task_cb (TrackerExtractTask *task)
 
 	priv = TRACKER_EXTRACT_GET_PRIVATE (task->extract);
 
+	TRACKER_TRACE (extract_dispatch, task->file, task->mimetype);
+
 	task->graph = tracker_extract_module_manager_get_graph (task->mimetype);
 	if (!task->graph) {
 		g_task_return_new_error (G_TASK (task->res),
@@ -598,7 +1330,7 @@ dispatch_task_cb (TrackerExtractTask *task)
 		                         "Unknown target graph for uri:'%s' and mime:'%s'",
 		                         task->file, task->mimetype);
 		extract_task_free (task);
-		return FALSE;
+		return NULL;
 	}
 
 	if (!task->mimetype) {
@@ -607,42 +1339,191 @@ dispatch_task_cb (TrackerExtractTask *task)
 		                         TRACKER_EXTRACT_ERROR_NO_MIMETYPE,
 		                         "No mimetype for '%s'", task->file);
 		extract_task_free (task);
-		return FALSE;
+		return NULL;
 	} else {
 		task->module = tracker_extract_module_manager_get_module (task->mimetype,
 		                                                          NULL,
 		                                                          &task->func);
 	}
 
-	async_queue = g_hash_table_lookup (priv->single_thread_extractors,
-	                                   task->module);
+	extractor_queue = g_hash_table_lookup (priv->extractor_queues,
+	                                       task->module);
 
-	if (!async_queue) {
-		GThread *thread;
-
-		/* No thread created yet for this module, create it
-		 * together with the async queue used to pass data to it
+	if (!extractor_queue) {
+		/* No queue created yet for this module, create it
+		 * together with its first worker thread.
 		 */
-		async_queue = g_async_queue_new ();
-		thread = g_thread_try_new ("single",
-		                           (GThreadFunc) single_thread_get_metadata,
-		                           g_async_queue_ref (async_queue),
-		                           &error);
-		if (!thread) {
+		extractor_queue = g_slice_new0 (ExtractorQueue);
+		TRACKER_MEMORY_ALLOC (EXTRACTOR, sizeof (ExtractorQueue));
+		extractor_queue->queue = g_async_queue_new ();
+
+		extractor_queue->thread_safe =
+			tracker_extract_module_manager_module_is_thread_safe (task->module);
+		extractor_queue->max_threads =
+			extractor_queue->thread_safe ? priv->max_workers : 1;
+
+		if (!extractor_queue_spawn_thread (extractor_queue, &error)) {
+			extractor_queue_free (extractor_queue);
 			g_task_return_error (G_TASK (task->res), error);
 			extract_task_free (task);
-			return FALSE;
+			return NULL;
 		}
 
-		/* We won't join the thread, so just unref it here */
-		g_thread_unref (thread);
+		g_hash_table_insert (priv->extractor_queues, task->module, extractor_queue);
+	}
+
+	task->extractor_queue = extractor_queue;
 
-		g_hash_table_insert (priv->single_thread_extractors, task->module, async_queue);
+	return extractor_queue;
+}
+
+/* Pushes @task to its module queue, along with the rest of its
+ * batch if it heads one.
+ */
+static void
+extractor_queue_push (ExtractorQueue     *extractor_queue,
+                      TrackerExtractTask *task)
+{
+	GError *error = NULL;
+
+	extractor_queue->last_used = g_get_monotonic_time ();
+	extractor_queue->shut_down = FALSE;
+	g_atomic_int_add (&extractor_queue->n_pending,
+	                  task->batch ? task->batch->tasks->len : 1);
+	ensure_module_idle_check (task->extract);
+
+	g_async_queue_push (extractor_queue->queue, task);
+
+	/* The queue length is the number of queued tasks minus the
+	 * number of threads waiting for one, a positive value means
+	 * every existing worker is busy, so grow the pool if allowed.
+	 */
+	if (g_async_queue_length (extractor_queue->queue) > 0 &&
+	    extractor_queue->n_threads < extractor_queue->max_threads) {
+		if (!extractor_queue_spawn_thread (extractor_queue, &error)) {
+			g_warning ("Could not create extractor worker thread: %s",
+			           error->message);
+			g_clear_error (&error);
+		}
 	}
+}
 
-	g_async_queue_push (async_queue, task);
+/* Called with task_mutex held */
+static gboolean
+extractor_queue_is_cheap (ExtractorQueue *extractor_queue)
+{
+	ModuleThroughput *throughput = &extractor_queue->throughput;
 
-	return FALSE;
+	if (throughput->n_samples < THROUGHPUT_MIN_SAMPLES)
+		return FALSE;
+
+	return throughput->sum_time / throughput->n < BATCH_MAX_FILE_USEC;
+}
+
+/* Dispatches the tasks of a module, in batches if the module is
+ * fast enough that handing files over to workers is a noticeable
+ * part of the time spent on them. Files are split evenly across
+ * the workers the module may use.
+ */
+static void
+dispatch_module_tasks (TrackerExtract *extract,
+                       ExtractorQueue *extractor_queue,
+                       GPtrArray      *tasks)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	guint i, batch_size = 1;
+	gboolean cheap;
+
+	g_mutex_lock (&priv->task_mutex);
+	cheap = extractor_queue_is_cheap (extractor_queue);
+	g_mutex_unlock (&priv->task_mutex);
+
+	if (cheap) {
+		batch_size = (tasks->len + extractor_queue->max_threads - 1) /
+			extractor_queue->max_threads;
+		batch_size = CLAMP (batch_size, 1, BATCH_MAX_FILES);
+	}
+
+	/* Leave room for batches to form while these files come by */
+	priv->batching = cheap;
+
+	for (i = 0; i < tasks->len; i += batch_size) {
+		TrackerExtractTask *task = g_ptr_array_index (tasks, i);
+		guint j, n_tasks = MIN (batch_size, tasks->len - i);
+
+		if (n_tasks > 1) {
+			TrackerExtractBatch *batch;
+
+			batch = extract_batch_new ();
+
+			for (j = 0; j < n_tasks; j++) {
+				TrackerExtractTask *batch_task = g_ptr_array_index (tasks, i + j);
+
+				batch_task->batch = batch;
+				g_ptr_array_add (batch->tasks, batch_task);
+			}
+
+			g_debug ("Dispatching %u files to %s in one batch",
+			         n_tasks,
+			         task->module ? get_module_basename (task->module) : "dummy extractor");
+		}
+
+		extractor_queue_push (extractor_queue, task);
+	}
+}
+
+/* Executed in the main thread for all tasks requested since
+ * the last call, grouped by the module handling them.
+ */
+static gboolean
+dispatch_pending_cb (gpointer user_data)
+{
+	TrackerExtract *extract = user_data;
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	g_autoptr (GPtrArray) queues = NULL;
+	g_autoptr (GHashTable) module_tasks = NULL;
+	TrackerExtractTask *task;
+	GQueue pending;
+	guint i;
+
+	g_mutex_lock (&priv->task_mutex);
+	pending = priv->pending_tasks;
+	g_queue_init (&priv->pending_tasks);
+	priv->dispatch_id = 0;
+	g_mutex_unlock (&priv->task_mutex);
+
+	queues = g_ptr_array_new ();
+	module_tasks = g_hash_table_new_full (NULL, NULL, NULL,
+	                                      (GDestroyNotify) g_ptr_array_unref);
+
+	while ((task = g_queue_pop_head (&pending)) != NULL) {
+		ExtractorQueue *extractor_queue;
+		GPtrArray *tasks;
+
+		extractor_queue = prepare_task (task);
+		if (!extractor_queue)
+			continue;
+
+		tasks = g_hash_table_lookup (module_tasks, extractor_queue);
+
+		if (!tasks) {
+			tasks = g_ptr_array_new ();
+			g_hash_table_insert (module_tasks, extractor_queue, tasks);
+			g_ptr_array_add (queues, extractor_queue);
+		}
+
+		g_ptr_array_add (tasks, task);
+	}
+
+	/* Modules are dispatched in the order of their first file */
+	for (i = 0; i < queues->len; i++) {
+		ExtractorQueue *extractor_queue = g_ptr_array_index (queues, i);
+
+		dispatch_module_tasks (extract, extractor_queue,
+		                       g_hash_table_lookup (module_tasks, extractor_queue));
+	}
+
+	return G_SOURCE_REMOVE;
 }
 
 /* This function can be called in any thread */
@@ -684,6 +1565,7 @@ tracker_extract_file (TrackerExtract      *extract,
 
 		g_mutex_lock (&priv->task_mutex);
 		priv->running_tasks = g_list_prepend (priv->running_tasks, task);
+		ensure_quota_check (extract, g_task_get_context (async_task));
 
 #ifdef G_ENABLE_DEBUG
 		if (TRACKER_DEBUG_CHECK (STATISTICS)) {
@@ -692,15 +1574,114 @@ tracker_extract_file (TrackerExtract      *extract,
 		}
 #endif
 
-		g_mutex_unlock (&priv->task_mutex);
+		/* Tasks requested together are dispatched together */
+		g_queue_push_tail (&priv->pending_tasks, task);
 
-		g_idle_add ((GSourceFunc) dispatch_task_cb, task);
+		if (priv->dispatch_id == 0)
+			priv->dispatch_id = g_idle_add (dispatch_pending_cb, extract);
+
+		g_mutex_unlock (&priv->task_mutex);
 	}
 
 	/* Task takes a ref and if this fails, we want to unref anyway */
 	g_object_unref (async_task);
 }
 
+void
+tracker_extract_print_info (TrackerExtractInfo         *info,
+                            const gchar                *uri,
+                            TrackerSerializationFormat  output_format)
+{
+	TrackerResource *resource;
+	const gchar *graph, *plain_text;
+
+	resource = tracker_extract_info_get_resource (info);
+	graph = tracker_extract_info_get_graph (info);
+
+	/* Printed as part of the resource, as it would be stored */
+	plain_text = tracker_extract_info_get_text (info);
+	if (plain_text)
+		tracker_resource_set_string (resource, "nie:plainTextContent", plain_text);
+
+	if (output_format == TRACKER_SERIALIZATION_FORMAT_SPARQL) {
+		char *text;
+		g_autoptr (TrackerResource) file_resource = NULL;
+
+		/* Set up the corresponding nfo:FileDataObject resource appropriately,
+		 * so the SPARQL we generate is valid according to Nepomuk.
+		 */
+		file_resource = tracker_resource_get_first_relation (resource, "nie:isStoredAs");
+
+		if (file_resource) {
+			g_object_ref (file_resource);
+		} else {
+			file_resource = tracker_resource_new (uri);
+			tracker_resource_set_relation (resource, "nie:isStoredAs", file_resource);
+		}
+
+		tracker_resource_add_uri (file_resource, "rdf:type", "nfo:FileDataObject");
+
+		text = tracker_resource_print_sparql_update (resource, NULL, NULL);
+
+		g_print ("%s\n", text);
+
+		g_free (text);
+	} else if (output_format == TRACKER_SERIALIZATION_FORMAT_TURTLE ||
+	           output_format == TRACKER_SERIALIZATION_FORMAT_TRIG) {
+		TrackerNamespaceManager *namespaces;
+		g_autofree gchar *graph_uri = NULL;
+		char *turtle;
+
+		/* If this was going into the tracker-store we'd generate a unique ID
+		 * here, so that the data persisted across file renames.
+		 */
+		tracker_resource_set_identifier (resource, uri);
+
+		G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+		namespaces = tracker_namespace_manager_get_default ();
+		G_GNUC_END_IGNORE_DEPRECATIONS
+
+		if (output_format == TRACKER_SERIALIZATION_FORMAT_TRIG) {
+			/* Keep the data in the graph the miner would insert it into */
+			if (graph)
+				graph_uri = tracker_namespace_manager_expand_uri (namespaces, graph);
+
+			turtle = tracker_resource_print_rdf (resource, namespaces,
+			                                     TRACKER_RDF_FORMAT_TRIG,
+			                                     graph_uri);
+		} else {
+			turtle = tracker_resource_print_rdf (resource, namespaces,
+			                                     TRACKER_RDF_FORMAT_TURTLE,
+			                                     NULL);
+		}
+
+		if (turtle) {
+			g_print ("%s\n", turtle);
+			g_free (turtle);
+		}
+	} else {
+		/* JSON-LD extraction */
+		char *json;
+
+		/* If this was going into the tracker-store we'd generate a unique ID
+		 * here, so that the data persisted across file renames.
+		 */
+		tracker_resource_set_identifier (resource, uri);
+
+		/* We are using "deprecated" API here as the pretty printed output is
+		 * nicer than with `tracker_resource_print_rdf()`, which uses the
+		 * generic serializer.
+		 */
+		G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+		json = tracker_resource_print_jsonld (resource, NULL);
+		G_GNUC_END_IGNORE_DEPRECATIONS
+		if (json) {
+			g_print ("%s\n", json);
+			g_free (json);
+		}
+	}
+}
+
 void
 tracker_extract_get_metadata_by_cmdline (TrackerExtract             *object,
                                          const gchar                *uri,
@@ -735,68 +1716,7 @@ tracker_extract_get_metadata_by_cmdline (TrackerExtract             *object,
 	}
 
 	if (resource) {
-		if (output_format == TRACKER_SERIALIZATION_FORMAT_SPARQL) {
-			char *text;
-			g_autoptr (TrackerResource) file_resource = NULL;
-
-			/* Set up the corresponding nfo:FileDataObject resource appropriately,
-			 * so the SPARQL we generate is valid according to Nepomuk.
-			 */
-			file_resource = tracker_resource_get_first_relation (resource, "nie:isStoredAs");
-
-			if (file_resource) {
-				g_object_ref (file_resource);
-			} else {
-				file_resource = tracker_resource_new (uri);
-				tracker_resource_set_relation (resource, "nie:isStoredAs", file_resource);
-			}
-
-			tracker_resource_add_uri (file_resource, "rdf:type", "nfo:FileDataObject");
-
-			text = tracker_resource_print_sparql_update (resource, NULL, NULL);
-
-			g_print ("%s\n", text);
-
-			g_free (text);
-		} else if (output_format == TRACKER_SERIALIZATION_FORMAT_TURTLE) {
-			TrackerNamespaceManager *namespaces;
-			char *turtle;
-
-			/* If this was going into the tracker-store we'd generate a unique ID
-			 * here, so that the data persisted across file renames.
-			 */
-			tracker_resource_set_identifier (resource, uri);
-
-			G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-			namespaces = tracker_namespace_manager_get_default ();
-			G_GNUC_END_IGNORE_DEPRECATIONS
-			turtle = tracker_resource_print_rdf (resource, namespaces, TRACKER_RDF_FORMAT_TURTLE, NULL);
-
-			if (turtle) {
-				g_print ("%s\n", turtle);
-				g_free (turtle);
-			}
-		} else {
-			/* JSON-LD extraction */
-			char *json;
-
-			/* If this was going into the tracker-store we'd generate a unique ID
-			 * here, so that the data persisted across file renames.
-			 */
-			tracker_resource_set_identifier (resource, uri);
-
-			/* We are using "deprecated" API here as the pretty printed output is
-			 * nicer than with `tracker_resource_print_rdf()`, which uses the
-			 * generic serializer.
-			 */
-			G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-			json = tracker_resource_print_jsonld (resource, NULL);
-			G_GNUC_END_IGNORE_DEPRECATIONS
-			if (json) {
-				g_print ("%s\n", json);
-				g_free (json);
-			}
-		}
+		tracker_extract_print_info (info, uri, output_format);
 	} else {
 		g_printerr ("%s: %s\n",
 		         uri,
@@ -818,6 +1738,17 @@ tracker_extract_file_finish (TrackerExtract  *extract,
 	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+static void
+update_text_limits (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	g_clear_pointer (&priv->text_limits, tracker_text_limits_unref);
+	priv->text_limits = tracker_text_limits_new (priv->max_text,
+	                                             priv->text_tail,
+	                                             priv->text_limits_variant);
+}
+
 void
 tracker_extract_set_max_text (TrackerExtract *extract,
                               gint            max_text)
@@ -825,4 +1756,115 @@ tracker_extract_set_max_text (TrackerExtract *extract,
 	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
 
 	priv->max_text = max_text;
+	update_text_limits (extract);
+}
+
+/* Takes text limits per graph or MIME type pattern, as "a{si}" */
+void
+tracker_extract_set_text_limits (TrackerExtract *extract,
+                                 GVariant       *limits)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	g_clear_pointer (&priv->text_limits_variant, g_variant_unref);
+	if (limits)
+		priv->text_limits_variant = g_variant_ref_sink (limits);
+	update_text_limits (extract);
+}
+
+void
+tracker_extract_set_text_tail (TrackerExtract *extract,
+                               gint            text_tail)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	priv->text_tail = text_tail;
+	update_text_limits (extract);
+}
+
+void
+tracker_extract_set_max_list_entries (TrackerExtract *extract,
+                                      gint            max_list_entries)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	priv->max_list_entries = MAX (max_list_entries, 0);
+}
+
+void
+tracker_extract_set_media_probe_size (TrackerExtract *extract,
+                                      gint            probe_size)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	priv->media_probe_size = MAX (probe_size, 0);
+}
+
+void
+tracker_extract_set_media_analyze_duration (TrackerExtract *extract,
+                                            gint            duration_ms)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	priv->media_analyze_duration = MAX (duration_ms, 0);
+}
+
+void
+tracker_extract_set_module_idle_timeout (TrackerExtract *extract,
+                                         gint            timeout_s)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	priv->module_idle_timeout = MAX (timeout_s, 0);
+
+	if (priv->module_idle_timeout == 0)
+		g_clear_handle_id (&priv->module_idle_check_id, g_source_remove);
+	else if (g_hash_table_size (priv->extractor_queues) > 0)
+		ensure_module_idle_check (extract);
+}
+
+void
+tracker_extract_set_max_workers (TrackerExtract *extract,
+                                 gint            max_workers)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+	GHashTableIter iter;
+	ExtractorQueue *extractor_queue;
+
+	if (max_workers <= 0)
+		priv->max_workers = default_max_workers ();
+	else
+		priv->max_workers = MIN (max_workers, MAX_WORKERS);
+
+	/* Existing threads are kept around, this only
+	 * affects how far pools may grow from now on.
+	 */
+	g_hash_table_iter_init (&iter, priv->extractor_queues);
+
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &extractor_queue)) {
+		if (extractor_queue->thread_safe)
+			extractor_queue->max_threads = priv->max_workers;
+	}
+}
+
+/* Number of files worth having in flight, beyond one per worker
+ * there is room for a batch if the last files were batched.
+ */
+guint
+tracker_extract_get_max_in_flight (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	if (priv->batching)
+		return priv->max_workers + BATCH_MAX_FILES;
+
+	return priv->max_workers;
+}
+
+guint
+tracker_extract_get_max_workers (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	return priv->max_workers;
 }
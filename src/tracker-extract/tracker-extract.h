@@ -77,12 +77,32 @@ void            tracker_extract_dbus_stop               (TrackerExtract
 
 void            tracker_extract_set_max_text            (TrackerExtract *extract,
                                                          gint            max_text);
+void            tracker_extract_set_text_limits         (TrackerExtract *extract,
+                                                         GVariant       *limits);
+void            tracker_extract_set_text_tail           (TrackerExtract *extract,
+                                                         gint            text_tail);
+void            tracker_extract_set_max_list_entries    (TrackerExtract *extract,
+                                                         gint            max_list_entries);
+void            tracker_extract_set_media_probe_size    (TrackerExtract *extract,
+                                                         gint            probe_size);
+void            tracker_extract_set_media_analyze_duration (TrackerExtract *extract,
+                                                            gint            duration_ms);
+void            tracker_extract_set_module_idle_timeout (TrackerExtract *extract,
+                                                         gint            timeout_s);
+
+void            tracker_extract_set_max_workers         (TrackerExtract *extract,
+                                                         gint            max_workers);
+guint           tracker_extract_get_max_workers         (TrackerExtract *extract);
+guint           tracker_extract_get_max_in_flight       (TrackerExtract *extract);
 
 /* Not DBus API */
 void            tracker_extract_get_metadata_by_cmdline (TrackerExtract             *object,
                                                          const gchar                *path,
                                                          const gchar                *mime,
                                                          TrackerSerializationFormat  output_format);
+void            tracker_extract_print_info              (TrackerExtractInfo         *info,
+                                                         const gchar                *uri,
+                                                         TrackerSerializationFormat  output_format);
 
 G_END_DECLS
 
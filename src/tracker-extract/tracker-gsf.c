@@ -38,141 +38,284 @@
 /* Note: 20 MBytes of max size is really assumed to be a safe limit. */
 #define XML_MAX_BYTES_READ         (20u << 20)  /* bytes */
 
-/**
- * based on find_member() from vsd_utils.c:
- * http://vsdump.sourcearchive.com/documentation/0.0.44/vsd__utils_8c-source.html
- */
+/* A directory in the archive, with its children indexed by name */
+typedef struct {
+	GsfInfile *infile;
+	GHashTable *children;
+} ArchiveDir;
+
+struct _TrackerGsfArchive {
+	gchar *uri;
+	FILE *file;
+	GsfInput *src;
+	GsfInfile *infile;
+	GHashTable *dirs;
+};
+
+static ArchiveDir *
+archive_dir_new (GsfInfile *infile)
+{
+	ArchiveDir *dir;
+	gint i, n_children;
+
+	dir = g_slice_new0 (ArchiveDir);
+	dir->infile = g_object_ref (infile);
+	dir->children = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* Names are owned by the infile, and indexes are stored off by one */
+	n_children = gsf_infile_num_children (infile);
+
+	for (i = 0; i < n_children; i++) {
+		const gchar *name;
+
+		name = gsf_infile_name_by_index (infile, i);
+
+		/* The first member with a name wins, as in gsf_infile_child_by_name() */
+		if (name && !g_hash_table_contains (dir->children, name))
+			g_hash_table_insert (dir->children, (gpointer) name, GINT_TO_POINTER (i + 1));
+	}
+
+	return dir;
+}
+
+static void
+archive_dir_free (ArchiveDir *dir)
+{
+	g_hash_table_unref (dir->children);
+	g_object_unref (dir->infile);
+	g_slice_free (ArchiveDir, dir);
+}
+
 static GsfInput *
-find_member (GsfInfile *arch,
-             gchar const *name)
+archive_dir_get_child (ArchiveDir  *dir,
+                       const gchar *name)
+{
+	gint index;
+
+	index = GPOINTER_TO_INT (g_hash_table_lookup (dir->children, name));
+	if (index == 0)
+		return NULL;
+
+	return gsf_infile_child_by_index (dir->infile, index - 1);
+}
+
+/* Looks up a directory by its path from the root of the archive,
+ * directories are opened the first time they are looked up.
+ */
+static ArchiveDir *
+lookup_dir (TrackerGsfArchive *archive,
+            const gchar       *path)
 {
-	gchar const *slash;
+	ArchiveDir *dir, *parent;
+	g_autofree gchar *parent_path = NULL;
+	const gchar *slash, *name;
+	GsfInput *child;
+
+	dir = g_hash_table_lookup (archive->dirs, path);
+	if (dir)
+		return dir;
 
-	slash = strchr (name, '/');
+	slash = strrchr (path, '/');
 
 	if (slash) {
-		gchar *dirname;
-		GsfInput *member;
+		parent_path = g_strndup (path, slash - path);
+		name = slash + 1;
+	} else {
+		parent_path = g_strdup ("");
+		name = path;
+	}
 
-		dirname = g_strndup (name, slash - name);
+	parent = lookup_dir (archive, parent_path);
+	if (!parent)
+		return NULL;
 
-		/**
-		 * Ignore if the directory is the current one that is ".".
-		 * Go to next direcotry if exists
-		 */
+	child = archive_dir_get_child (parent, name);
+	if (!child)
+		return NULL;
 
-		if (strcmp (dirname, ".") == 0) {
-			member = find_member (arch, slash + 1);
-		} else if ((member = gsf_infile_child_by_name (arch, dirname)) != NULL) {
-			GsfInfile *dir;
+	/* Members that are not directories have no children */
+	if (!GSF_IS_INFILE (child) ||
+	    gsf_infile_num_children (GSF_INFILE (child)) < 0) {
+		g_object_unref (child);
+		return NULL;
+	}
 
-			dir = GSF_INFILE (member);
-			member = find_member (dir, slash + 1);
-			g_object_unref (dir);
-		}
+	dir = archive_dir_new (GSF_INFILE (child));
+	g_object_unref (child);
+	g_hash_table_insert (archive->dirs, g_strdup (path), dir);
 
-		g_free (dirname);
-		return member;
-	} else {
-		return gsf_infile_child_by_name (arch, name);
+	return dir;
+}
+
+static GsfInput *
+find_member (TrackerGsfArchive *archive,
+             const gchar       *name)
+{
+	g_auto (GStrv) components = NULL;
+	g_autoptr (GString) dir_path = NULL;
+	ArchiveDir *dir;
+	guint i, n_components;
+
+	/* "." components refer to the current directory, and are ignored */
+	components = g_strsplit (name, "/", -1);
+	n_components = g_strv_length (components);
+	dir_path = g_string_new (NULL);
+
+	if (n_components == 0)
+		return NULL;
+
+	for (i = 0; i < n_components - 1; i++) {
+		if (strcmp (components[i], ".") == 0)
+			continue;
+
+		if (dir_path->len > 0)
+			g_string_append_c (dir_path, '/');
+		g_string_append (dir_path, components[i]);
 	}
+
+	dir = lookup_dir (archive, dir_path->str);
+	if (!dir)
+		return NULL;
+
+	return archive_dir_get_child (dir, components[n_components - 1]);
 }
 
 /**
- * tracker_gsf_parse_xml_in_zip:
+ * tracker_gsf_archive_open:
  * @zip_file_uri: URI of the ZIP archive
+ * @error: return location for errors
+ *
+ * Opens a ZIP archive, so several of its members can be parsed with
+ * tracker_gsf_archive_parse_xml() while reading its central directory
+ * only once. Members are looked up by name through an index of each
+ * directory, built the first time it is looked into.
+ *
+ * Returns: the opened archive, or %NULL on error.
+ */
+TrackerGsfArchive *
+tracker_gsf_archive_open (const gchar  *zip_file_uri,
+                          GError      **error)
+{
+	TrackerGsfArchive *archive;
+	gchar *filename;
+
+	/* Get filename from the given URI */
+	filename = g_filename_from_uri (zip_file_uri, NULL, error);
+	if (!filename)
+		return NULL;
+
+	archive = g_slice_new0 (TrackerGsfArchive);
+	archive->uri = g_strdup (zip_file_uri);
+	archive->file = tracker_file_open (filename);
+
+	if (!archive->file) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+		             "Can't open file from uri '%s': %s",
+		             zip_file_uri, g_strerror (errno));
+	} else if ((archive->src = gsf_input_stdio_new_FILE (filename, archive->file, TRUE)) == NULL) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+		             "Failed creating a GSF Input object for '%s'",
+		             zip_file_uri);
+	} else {
+		/* Input object is a Zip file */
+		archive->infile = gsf_infile_zip_new (archive->src, error);
+	}
+
+	if (archive->infile) {
+		archive->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                       (GDestroyNotify) archive_dir_free);
+		g_hash_table_insert (archive->dirs, g_strdup (""),
+		                     archive_dir_new (archive->infile));
+	}
+
+	g_free (filename);
+
+	if (!archive->infile) {
+		tracker_gsf_archive_close (archive);
+		return NULL;
+	}
+
+	return archive;
+}
+
+void
+tracker_gsf_archive_close (TrackerGsfArchive *archive)
+{
+	g_clear_pointer (&archive->dirs, g_hash_table_unref);
+	g_clear_object (&archive->infile);
+	g_clear_object (&archive->src);
+
+	if (archive->file)
+		tracker_file_close (archive->file, FALSE);
+
+	g_free (archive->uri);
+	g_slice_free (TrackerGsfArchive, archive);
+}
+
+/**
+ * tracker_gsf_archive_parse_xml:
+ * @archive: an opened ZIP archive
  * @xml_filename: Name of the XML file stored inside the ZIP archive
  * @context: Markup context to be used when parsing the XML
+ * @error: return location for errors
  *
  * This function reads and parses the contents of an XML file stored
- *  inside a ZIP compressed archive. Reading and parsing is done buffered, and
- *  maximum size of the uncompressed XML file is limited to be to 20MBytes.
+ *  inside a ZIP compressed archive. Reading and parsing is done buffered,
+ *  and stops as soon as @context returns an error, e.g. once the parser
+ *  got all the text it wanted. The maximum size of the uncompressed XML
+ *  file is limited to be to 20MBytes.
  */
 void
-tracker_gsf_parse_xml_in_zip (const gchar          *zip_file_uri,
-                              const gchar          *xml_filename,
-                              GMarkupParseContext  *context,
-                              GError              **err)
+tracker_gsf_archive_parse_xml (TrackerGsfArchive    *archive,
+                               const gchar          *xml_filename,
+                               GMarkupParseContext  *context,
+                               GError              **err)
 {
-	gchar *filename;
 	GError *error = NULL;
-	GsfInfile *infile = NULL;
-	GsfInput *src = NULL;
-	GsfInput *member = NULL;
-	FILE *file;
+	GsfInput *member;
+	guint8 buf[XML_BUFFER_SIZE];
+	size_t remaining_size, chunk_size, accum;
 
 	g_debug ("Parsing '%s' XML file contained inside zip archive...",
 	         xml_filename);
 
-	/* Get filename from the given URI */
-	if ((filename = g_filename_from_uri (zip_file_uri,
-	                                     NULL, &error)) == NULL) {
-		g_warning ("Can't get filename from uri '%s': %s",
-		           zip_file_uri, error ? error->message : "no error given");
-	} else { /* Create a new Input GSF object for the given file */
-
-		file = tracker_file_open (filename);
-		if (!file) {
-			g_warning ("Can't open file from uri '%s': %s",
-			           zip_file_uri, g_strerror (errno));
-		} else if ((src = gsf_input_stdio_new_FILE (filename, file, TRUE)) == NULL) {
-			g_warning ("Failed creating a GSF Input object for '%s': %s",
-			           zip_file_uri, error ? error->message : "no error given");
-		}
-		/* Input object is a Zip file */
-		else if ((infile = gsf_infile_zip_new (src, &error)) == NULL) {
-			g_warning ("'%s' Not a zip file: %s",
-			           zip_file_uri, error ? error->message : "no error given");
-		}
-		/* Look for requested filename inside the ZIP file */
-		else if ((member = find_member (infile, xml_filename)) == NULL) {
-			g_warning ("No member '%s' in zip file '%s'",
-			           xml_filename, zip_file_uri);
-		}
-		/* Load whole contents of the internal file in the xml buffer */
-		else {
-			guint8 buf[XML_BUFFER_SIZE];
-			size_t remaining_size, chunk_size, accum;
-
-			/* Get whole size of the contents to read */
-			remaining_size = (size_t) gsf_input_size (GSF_INPUT (member));
-
-			/* Note that gsf_input_read() needs to be able to read ALL specified
-			 *  number of bytes, or it will fail */
-			chunk_size = MIN (remaining_size, XML_BUFFER_SIZE);
-
-			accum = 0;
-			while (!error &&
-			       accum  <= XML_MAX_BYTES_READ &&
-			       chunk_size > 0 &&
-			       gsf_input_read (GSF_INPUT (member), chunk_size, buf) != NULL) {
-
-				/* update accumulated count */
-				accum += chunk_size;
-
-				/* Pass the read stream to the context parser... */
-				g_markup_parse_context_parse (context, buf, chunk_size, &error);
-
-				/* update bytes to be read */
-				remaining_size -= chunk_size;
-				chunk_size = MIN (remaining_size, XML_BUFFER_SIZE);
-			}
-		}
-
-		if (file) {
-			tracker_file_close (file, FALSE);
-		}
+	/* Look for requested filename inside the ZIP file */
+	member = find_member (archive, xml_filename);
+	if (!member) {
+		g_warning ("No member '%s' in zip file '%s'",
+		           xml_filename, archive->uri);
+		return;
 	}
 
-	g_free (filename);
+	/* Get whole size of the contents to read */
+	remaining_size = (size_t) gsf_input_size (GSF_INPUT (member));
+
+	/* Note that gsf_input_read() needs to be able to read ALL specified
+	 *  number of bytes, or it will fail */
+	chunk_size = MIN (remaining_size, XML_BUFFER_SIZE);
+
+	/* Members are inflated as they are parsed, so parts of them
+	 * after the point the parser stopped are never decompressed.
+	 */
+	accum = 0;
+	while (!error &&
+	       accum  <= XML_MAX_BYTES_READ &&
+	       chunk_size > 0 &&
+	       gsf_input_read (GSF_INPUT (member), chunk_size, buf) != NULL) {
+
+		/* update accumulated count */
+		accum += chunk_size;
+
+		/* Pass the read stream to the context parser... */
+		g_markup_parse_context_parse (context, (const gchar *) buf, chunk_size, &error);
+
+		/* update bytes to be read */
+		remaining_size -= chunk_size;
+		chunk_size = MIN (remaining_size, XML_BUFFER_SIZE);
+	}
+
+	g_object_unref (member);
 
 	if (error)
 		g_propagate_error (err, error);
-	if (infile)
-		g_object_unref (infile);
-	if (src)
-		g_object_unref (src);
-	if (member)
-		g_object_unref (member);
 }
-
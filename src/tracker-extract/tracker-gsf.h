@@ -24,10 +24,16 @@
 
 G_BEGIN_DECLS
 
-void tracker_gsf_parse_xml_in_zip (const gchar          *zip_file_uri,
-                                   const gchar          *xml_filename,
-                                   GMarkupParseContext  *context,
-                                   GError              **error);
+typedef struct _TrackerGsfArchive TrackerGsfArchive;
+
+TrackerGsfArchive * tracker_gsf_archive_open (const gchar  *zip_file_uri,
+                                              GError      **error);
+void tracker_gsf_archive_close (TrackerGsfArchive *archive);
+
+void tracker_gsf_archive_parse_xml (TrackerGsfArchive    *archive,
+                                    const gchar          *xml_filename,
+                                    GMarkupParseContext  *context,
+                                    GError              **error);
 
 G_END_DECLS
 
@@ -33,6 +33,7 @@
 #include <glib/gi18n.h>
 #include <glib/gprintf.h>
 #include <gio/gio.h>
+#include <gio/gunixinputstream.h>
 
 #ifndef G_OS_WIN32
 #include <sys/resource.h>
@@ -65,18 +66,28 @@
 static GMainLoop *main_loop;
 
 static gchar *filename;
+static gchar *file_list;
 static gchar *mime_type;
 static gchar *force_module;
 static gchar *output_format_name;
 static gboolean version;
+static gboolean update_rule_cache;
 static gchar *domain_ontology_name = NULL;
 static guint shutdown_timeout_id = 0;
 static int socket_fd;
+static int partition;
+static int n_partitions = 1;
+static gchar *store_dir;
+static int max_workers;
 
 static GOptionEntry entries[] = {
 	{ "file", 'f', 0,
 	  G_OPTION_ARG_FILENAME, &filename,
-	  N_("File to extract metadata for"),
+	  N_("File to extract metadata for, directories are extracted recursively"),
+	  N_("FILE") },
+	{ "file-list", 0, 0,
+	  G_OPTION_ARG_FILENAME, &file_list,
+	  N_("File with the paths or URIs to extract metadata for, one per line (“-” for stdin)"),
 	  N_("FILE") },
 	{ "mime", 't', 0,
 	  G_OPTION_ARG_STRING, &mime_type,
@@ -87,7 +98,7 @@ static GOptionEntry entries[] = {
 	  N_("Force a module to be used for extraction (e.g. “foo” for “foo.so”)"),
 	  N_("MODULE") },
 	{ "output-format", 'o', 0, G_OPTION_ARG_STRING, &output_format_name,
-	  N_("Output results format: “sparql”, “turtle” or “json-ld”"),
+	  N_("Output results format: “sparql”, “turtle”, “trig” or “json-ld”"),
 	  N_("FORMAT") },
 	{ "domain-ontology", 'd', 0,
 	  G_OPTION_ARG_STRING, &domain_ontology_name,
@@ -97,6 +108,26 @@ static GOptionEntry entries[] = {
 	  G_OPTION_ARG_INT, &socket_fd,
 	  N_("Socket file descriptor for peer-to-peer communication"),
 	  N_("FD") },
+	{ "partition", 0, 0,
+	  G_OPTION_ARG_INT, &partition,
+	  N_("Partition of the pending files handled by this process"),
+	  N_("N") },
+	{ "n-partitions", 0, 0,
+	  G_OPTION_ARG_INT, &n_partitions,
+	  N_("Number of processes the pending files are split between"),
+	  N_("N") },
+	{ "store-dir", 0, 0,
+	  G_OPTION_ARG_FILENAME, &store_dir,
+	  N_("Database the pending files are looked up from, instead of querying the miner"),
+	  N_("DIR") },
+	{ "max-workers", 0, 0,
+	  G_OPTION_ARG_INT, &max_workers,
+	  N_("Maximum number of files extracted at once with --file-list or a directory"),
+	  N_("N") },
+	{ "update-rule-cache", 0, 0,
+	  G_OPTION_ARG_NONE, &update_rule_cache,
+	  N_("Writes the cache of the installed extractor rules and exits"),
+	  NULL },
 	{ "version", 'V', 0,
 	  G_OPTION_ARG_NONE, &version,
 	  N_("Displays version information"),
@@ -172,15 +203,250 @@ initialize_signal_handler (void)
 }
 #endif /* !HAVE_LIBSECCOMP */
 
+typedef struct {
+	TrackerExtract *extract;
+	TrackerSerializationFormat output_format;
+	GMainLoop *loop;
+	GDataInputStream *list_stream;
+	GQueue pending_files;
+	GQueue pending_dirs;
+	guint n_running;
+	guint max_running;
+	guint n_extracted;
+	guint n_failed;
+} BulkExtraction;
+
+typedef struct {
+	BulkExtraction *bulk;
+	gchar *uri;
+} BulkExtractionItem;
+
+static void bulk_extraction_fill (BulkExtraction *bulk);
+
+static void
+bulk_extraction_enumerate (BulkExtraction *bulk,
+                           GFile          *dir)
+{
+	g_autoptr (GFileEnumerator) enumerator = NULL;
+	g_autoptr (GError) error = NULL;
+
+	enumerator = g_file_enumerate_children (dir,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME ","
+	                                        G_FILE_ATTRIBUTE_STANDARD_TYPE,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, &error);
+
+	while (enumerator) {
+		GFileInfo *info;
+		GFile *child;
+
+		if (!g_file_enumerator_iterate (enumerator, &info, &child, NULL, &error) ||
+		    !info)
+			break;
+
+		/* Symlinks are not followed, so there are no loops */
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+			g_queue_push_tail (&bulk->pending_dirs, g_object_ref (child));
+		else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
+			g_queue_push_tail (&bulk->pending_files, g_object_ref (child));
+	}
+
+	if (error) {
+		g_autofree gchar *uri = g_file_get_uri (dir);
+
+		g_printerr ("%s: %s\n", uri, error->message);
+	}
+}
+
+static GFile *
+bulk_extraction_next_file (BulkExtraction *bulk)
+{
+	while (TRUE) {
+		g_autoptr (GFile) dir = NULL;
+		g_autoptr (GFileInfo) info = NULL;
+		g_autoptr (GError) error = NULL;
+		g_autofree gchar *line = NULL;
+		GFile *file;
+
+		if (!g_queue_is_empty (&bulk->pending_files))
+			return g_queue_pop_head (&bulk->pending_files);
+
+		dir = g_queue_pop_head (&bulk->pending_dirs);
+		if (dir) {
+			bulk_extraction_enumerate (bulk, dir);
+			continue;
+		}
+
+		if (!bulk->list_stream)
+			return NULL;
+
+		/* The list is read as it is consumed, so it may be
+		 * produced by a pipe while extraction is running.
+		 */
+		line = g_data_input_stream_read_line (bulk->list_stream,
+		                                      NULL, NULL, &error);
+		if (!line) {
+			if (error)
+				g_printerr ("%s\n", error->message);
+			g_clear_object (&bulk->list_stream);
+			continue;
+		}
+
+		if (*line == '\0')
+			continue;
+
+		file = g_file_new_for_commandline_arg (line);
+		info = g_file_query_info (file,
+		                          G_FILE_ATTRIBUTE_STANDARD_TYPE,
+		                          G_FILE_QUERY_INFO_NONE,
+		                          NULL, NULL);
+
+		if (info &&
+		    g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			g_queue_push_tail (&bulk->pending_dirs, file);
+			continue;
+		}
+
+		/* Errors on missing files are reported by the extraction */
+		return file;
+	}
+}
+
+static void
+bulk_extraction_file_cb (GObject      *object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+	BulkExtractionItem *item = user_data;
+	BulkExtraction *bulk = item->bulk;
+	TrackerExtractInfo *info;
+	TrackerResource *resource = NULL;
+	g_autoptr (GError) error = NULL;
+
+	info = tracker_extract_file_finish (TRACKER_EXTRACT (object), res, &error);
+	if (info)
+		resource = tracker_extract_info_get_resource (info);
+
+	if (resource) {
+		tracker_extract_print_info (info, item->uri, bulk->output_format);
+		bulk->n_extracted++;
+	} else {
+		g_printerr ("%s: %s\n",
+		            item->uri,
+		            error ? error->message :
+		            _("No metadata or extractor modules found to handle this file"));
+		bulk->n_failed++;
+	}
+
+	g_clear_pointer (&info, tracker_extract_info_unref);
+	g_free (item->uri);
+	g_free (item);
+
+	bulk->n_running--;
+	bulk_extraction_fill (bulk);
+}
+
+static void
+bulk_extraction_fill (BulkExtraction *bulk)
+{
+	GFile *file;
+
+	/* Keep a few more files queued than there are worker threads,
+	 * so threads do not wait on the main loop between files.
+	 */
+	while (bulk->n_running < bulk->max_running &&
+	       (file = bulk_extraction_next_file (bulk)) != NULL) {
+		BulkExtractionItem *item;
+
+		item = g_new0 (BulkExtractionItem, 1);
+		item->bulk = bulk;
+		item->uri = g_file_get_uri (file);
+		g_object_unref (file);
+
+		bulk->n_running++;
+		tracker_extract_file (bulk->extract, item->uri, "_:content",
+		                      mime_type, NULL,
+		                      bulk_extraction_file_cb, item);
+	}
+
+	if (bulk->n_running == 0)
+		g_main_loop_quit (bulk->loop);
+}
+
+static int
+run_bulk (TrackerExtract             *extract,
+          GFile                      *file,
+          gboolean                    is_dir,
+          TrackerSerializationFormat  output_format)
+{
+	BulkExtraction bulk = { 0, };
+	gint64 start;
+
+	bulk.extract = extract;
+	bulk.output_format = output_format;
+	g_queue_init (&bulk.pending_files);
+	g_queue_init (&bulk.pending_dirs);
+
+	if (file && is_dir)
+		g_queue_push_tail (&bulk.pending_dirs, g_object_ref (file));
+	else if (file)
+		g_queue_push_tail (&bulk.pending_files, g_object_ref (file));
+
+	if (file_list) {
+		g_autoptr (GInputStream) stream = NULL;
+
+		if (g_strcmp0 (file_list, "-") == 0) {
+			stream = g_unix_input_stream_new (STDIN_FILENO, FALSE);
+		} else {
+			g_autoptr (GFile) list = NULL;
+			g_autoptr (GError) error = NULL;
+
+			list = g_file_new_for_commandline_arg (file_list);
+			stream = G_INPUT_STREAM (g_file_read (list, NULL, &error));
+
+			if (!stream) {
+				g_printerr ("%s\n", error->message);
+				g_queue_clear_full (&bulk.pending_files, g_object_unref);
+				g_queue_clear_full (&bulk.pending_dirs, g_object_unref);
+				return EXIT_FAILURE;
+			}
+		}
+
+		bulk.list_stream = g_data_input_stream_new (stream);
+	}
+
+	if (max_workers > 0)
+		tracker_extract_set_max_workers (extract, max_workers);
+
+	bulk.max_running = tracker_extract_get_max_workers (extract) * 2;
+	bulk.loop = g_main_loop_new (NULL, FALSE);
+	start = g_get_monotonic_time ();
+
+	bulk_extraction_fill (&bulk);
+
+	if (bulk.n_running > 0)
+		g_main_loop_run (bulk.loop);
+
+	g_printerr ("%u files extracted, %u failed in %.3f seconds\n",
+	            bulk.n_extracted, bulk.n_failed,
+	            (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+
+	g_main_loop_unref (bulk.loop);
+
+	return bulk.n_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 static int
 run_standalone (void)
 {
 	TrackerExtract *object;
-	GFile *file;
+	GFile *file = NULL;
 	gchar *uri;
 	GEnumClass *enum_class;
 	GEnumValue *enum_value;
 	TrackerSerializationFormat output_format;
+	gboolean is_dir = FALSE;
+	int retval = EXIT_SUCCESS;
 
 	if (!output_format_name) {
 		output_format_name = "turtle";
@@ -198,24 +464,30 @@ run_standalone (void)
 
 	tracker_locale_sanity_check ();
 
-	file = g_file_new_for_commandline_arg (filename);
-	uri = g_file_get_uri (file);
-
 	object = tracker_extract_new (TRUE, force_module);
 
 	if (!object) {
-		g_object_unref (file);
-		g_free (uri);
 		return EXIT_FAILURE;
 	}
 
-	tracker_extract_get_metadata_by_cmdline (object, uri, mime_type, output_format);
+	if (filename) {
+		file = g_file_new_for_commandline_arg (filename);
+		is_dir = g_file_query_file_type (file, G_FILE_QUERY_INFO_NONE,
+		                                 NULL) == G_FILE_TYPE_DIRECTORY;
+	}
+
+	if (file_list || is_dir) {
+		retval = run_bulk (object, file, is_dir, output_format);
+	} else {
+		uri = g_file_get_uri (file);
+		tracker_extract_get_metadata_by_cmdline (object, uri, mime_type, output_format);
+		g_free (uri);
+	}
 
 	g_object_unref (object);
-	g_object_unref (file);
-	g_free (uri);
+	g_clear_object (&file);
 
-	return EXIT_SUCCESS;
+	return retval;
 }
 
 static void
@@ -321,7 +593,7 @@ do_main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	if (!filename && mime_type) {
+	if (!filename && !file_list && mime_type) {
 		gchar *help;
 
 		g_printerr ("%s\n\n",
@@ -342,6 +614,16 @@ do_main (int argc, char *argv[])
 		return EXIT_SUCCESS;
 	}
 
+	if (update_rule_cache) {
+		if (!tracker_extract_module_manager_write_cache (&error)) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	}
+
 	g_set_application_name ("tracker-extract");
 
 	setlocale (LC_ALL, "");
@@ -354,11 +636,11 @@ do_main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	/* Modules are loaded when first needed */
 	tracker_extract_module_manager_init ();
-	tracker_module_manager_load_modules ();
 
 	/* Set conditions when we use stand alone settings */
-	if (filename) {
+	if (filename || file_list) {
 		return run_standalone ();
 	}
 
@@ -410,6 +692,33 @@ do_main (int argc, char *argv[])
 
 	decorator = tracker_extract_decorator_new (sparql_connection, extract, persistence);
 
+	if (store_dir) {
+		g_autoptr (TrackerSparqlConnection) query_connection = NULL;
+		g_autoptr (GFile) store = NULL;
+
+		/* Reading the miner database directly saves querying
+		 * the miner over D-Bus, updates still go through it.
+		 */
+		store = g_file_new_for_commandline_arg (store_dir);
+		query_connection = tracker_sparql_connection_new (TRACKER_SPARQL_CONNECTION_FLAGS_READONLY,
+		                                                  store,
+		                                                  NULL,
+		                                                  NULL,
+		                                                  &error);
+		if (query_connection) {
+			tracker_decorator_set_query_connection (decorator, query_connection);
+		} else {
+			g_debug ("Could not open database at '%s', querying the miner: %s",
+			         store_dir, error->message);
+			g_clear_error (&error);
+		}
+	}
+
+	if (n_partitions > 1 && partition >= 0 && partition < n_partitions) {
+		tracker_decorator_set_partition (decorator,
+		                                 partition, n_partitions);
+	}
+
 #ifdef THREAD_ENABLE_TRACE
 	g_debug ("Thread:%p (Main) --- Waiting for extract requests...",
 	         g_thread_self ());
@@ -442,6 +751,8 @@ do_main (int argc, char *argv[])
 	initialize_signal_handler ();
 #endif
 
+	tracker_memory_start_reporting ();
+
 	g_main_loop_run (main_loop);
 
 	my_main_loop = main_loop;
@@ -19,9 +19,12 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <gio/gio.h>
@@ -34,6 +37,9 @@
 /* Size of the buffer to use when reading, in bytes */
 #define BUFFER_SIZE 65535
 
+/* Bytes looked at to tell binary files apart */
+#define SNIFF_SIZE 4096
+
 static gchar *
 get_string_from_guessed_encoding (const gchar *str,
                                   gsize        str_len,
@@ -88,6 +94,20 @@ get_string_from_guessed_encoding (const gchar *str,
 	return NULL;
 }
 
+static gboolean
+has_line_break (const gchar *data,
+                gsize        len)
+{
+	if (memchr (data, '\n', len - 1) == NULL) {
+		g_debug ("  No '\\n' in the first %" G_GSIZE_FORMAT " bytes, "
+		         "not indexing file",
+		         len);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 /* Returns %TRUE if read operation should continue, %FALSE otherwise */
 static gboolean
 process_chunk (const gchar  *read_bytes,
@@ -114,27 +134,9 @@ process_chunk (const gchar  *read_bytes,
 	 * UTF-16LE), so we can't rely on methods which assume
 	 * NUL-terminated strings, as g_strstr_len().
 	 */
-	if (s->len == 0) {
-		if (read_size == buffer_size) {
-			const gchar *i;
-			gboolean eol_found = FALSE;
-
-			i = read_bytes;
-			while (i != &read_bytes[read_size - 1]) {
-				if (*i == '\n') {
-					eol_found = TRUE;
-					break;
-				}
-				i++;
-			}
-
-			if (!eol_found) {
-				g_debug ("  No '\\n' in the first %" G_GSSIZE_FORMAT " bytes, "
-				         "not indexing file",
-				         read_size);
-				return FALSE;
-			}
-		}
+	if (s->len == 0 && read_size == buffer_size &&
+	    !has_line_break (read_bytes, read_size)) {
+		return FALSE;
 	}
 
 	/* Update remaining bytes */
@@ -152,9 +154,11 @@ process_chunk (const gchar  *read_bytes,
 	return TRUE;
 }
 
+/* Returns a newly allocated UTF-8 copy of @str, converted if needed */
 static gchar *
-process_whole_string (GString  *s,
-                      GError  **error)
+process_text (const gchar  *str,
+              gsize         len,
+              GError      **error)
 {
 	gchar *utf8 = NULL;
 	gsize  utf8_len = 0;
@@ -163,23 +167,23 @@ process_whole_string (GString  *s,
 	/* Support also UTF-16 encoded text files, as the ones generated in
 	 * Windows OS. We will only accept text files in UTF-16 which come
 	 * with a proper BOM. */
-	if (s->len > 2) {
+	if (len > 2) {
 		GError *inner_error = NULL;
 
-		if (memcmp (s->str, "\xFF\xFE", 2) == 0) {
+		if (memcmp (str, "\xFF\xFE", 2) == 0) {
 			g_debug ("String comes in UTF-16LE, converting");
-			utf8 = g_convert (&(s->str[2]),
-			                  s->len - 2,
+			utf8 = g_convert (&str[2],
+			                  len - 2,
 			                  "UTF-8",
 			                  "UTF-16LE",
 			                  NULL,
 			                  &utf8_len,
 			                  &inner_error);
 
-		} else if (memcmp (s->str, "\xFE\xFF", 2) == 0) {
+		} else if (memcmp (str, "\xFE\xFF", 2) == 0) {
 			g_debug ("String comes in UTF-16BE, converting");
-			utf8 = g_convert (&(s->str[2]),
-			                  s->len - 2,
+			utf8 = g_convert (&str[2],
+			                  len - 2,
 			                  "UTF-8",
 			                  "UTF-16BE",
 			                  NULL,
@@ -189,57 +193,91 @@ process_whole_string (GString  *s,
 
 		if (inner_error) {
 			g_propagate_error (error, inner_error);
-			g_string_free (s, TRUE);
 			return NULL;
 		}
 	}
 
 	if (utf8) {
-		n_valid_utf8_bytes = utf8_len;
-		g_string_free (s, TRUE);
-	} else {
-		utf8_len = s->len;
-		utf8 = g_string_free (s, FALSE);
-
-		/* Get number of valid UTF-8 bytes found */
-		tracker_text_validate_utf8 (utf8,
-					    utf8_len,
-					    NULL,
-					    &n_valid_utf8_bytes);
+		if (utf8_len < 1) {
+			g_free (utf8);
+			return NULL;
+		}
+
+		return utf8;
 	}
 
+	/* Get number of valid UTF-8 bytes found, the text is
+	 * only copied once it's known to be valid. */
+	tracker_text_validate_utf8 (str,
+	                            len,
+	                            NULL,
+	                            &n_valid_utf8_bytes);
+
 	/* A valid UTF-8 file will be that where all read bytes are valid,
 	 *  with a margin of 3 bytes for the last UTF-8 character which might
 	 *  have been cut. */
-	if (utf8_len - n_valid_utf8_bytes > 3) {
-		gchar *from_guessed_str;
-		gsize  from_guessed_str_len;
+	if (len - n_valid_utf8_bytes > 3) {
+		gsize  from_guessed_str_len = 0;
 
 		/* If not UTF-8, try to get contents in guessed encoding
 		 *  (returns valid UTF-8) */
-		from_guessed_str = get_string_from_guessed_encoding (utf8,
-		                                                     utf8_len,
-		                                                     &from_guessed_str_len);
-		g_free (utf8);
-		if (!from_guessed_str)
-			return NULL;
-		utf8 = from_guessed_str;
-		utf8_len = from_guessed_str_len;
-	} else if (n_valid_utf8_bytes < utf8_len) {
+		utf8 = get_string_from_guessed_encoding (str,
+		                                         len,
+		                                         &from_guessed_str_len);
+		if (utf8 && from_guessed_str_len < 1)
+			g_clear_pointer (&utf8, g_free);
+
+		return utf8;
+	}
+
+	if (n_valid_utf8_bytes < len) {
 		g_debug ("  Truncating to last valid UTF-8 character "
 		         "(%" G_GSSIZE_FORMAT "/%" G_GSSIZE_FORMAT " bytes)",
 		         n_valid_utf8_bytes,
-		         utf8_len);
-		utf8[n_valid_utf8_bytes] = '\0';
-		utf8_len = n_valid_utf8_bytes;
+		         len);
 	}
 
-	if (utf8_len < 1) {
-		g_free (utf8);
+	if (n_valid_utf8_bytes < 1)
 		return NULL;
-	}
 
-	return utf8;
+	return g_strndup (str, n_valid_utf8_bytes);
+}
+
+/* Returns %FALSE if @fd can't be mapped, e.g. pipes */
+static gboolean
+read_text_mapped (gint      fd,
+                  gsize     max_bytes,
+                  gchar   **text,
+                  GError  **error)
+{
+	struct stat st;
+	gchar *data;
+	gsize len;
+
+	if (fstat (fd, &st) == -1 || !S_ISREG (st.st_mode) || st.st_size == 0)
+		return FALSE;
+
+	len = MIN ((guint64) st.st_size, max_bytes);
+	*text = NULL;
+
+	if (len == 0)
+		return TRUE;
+
+	data = mmap (NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		return FALSE;
+
+	madvise (data, len, MADV_SEQUENTIAL);
+
+	g_debug ("  Mapped %" G_GSIZE_FORMAT " bytes from file", len);
+
+	/* Same as the first chunk read in tracker_read_text_from_fd() */
+	if (len < BUFFER_SIZE || has_line_break (data, BUFFER_SIZE))
+		*text = process_text (data, len, error);
+
+	munmap (data, len);
+
+	return TRUE;
 }
 
 /**
@@ -262,8 +300,20 @@ tracker_read_text_from_fd (gint     fd,
 {
 	FILE *fz;
 	GString *s;
+	gchar *text;
 	gsize n_bytes_remaining = max_bytes;
 
+	/* Regular files are validated in place, and only copied once */
+	if (read_text_mapped (fd, max_bytes, &text, error)) {
+#ifdef HAVE_POSIX_FADVISE
+		if (posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED) != 0)
+			g_warning ("posix_fadvise() call failed: %m");
+#endif /* HAVE_POSIX_FADVISE */
+		close (fd);
+
+		return text;
+	}
+
 	if ((fz = fdopen (fd, "r")) == NULL) {
 		g_set_error (error, TRACKER_EXTRACT_ERROR, TRACKER_EXTRACT_ERROR_IO_ERROR,
 		             "Cannot read from file so could not extract text.");
@@ -309,5 +359,72 @@ tracker_read_text_from_fd (gint     fd,
 	fclose (fz);
 
 	/* Validate UTF-8 if something was read, and return it */
-	return process_whole_string (s, error);
+	text = process_text (s->str, s->len, error);
+	g_string_free (s, TRUE);
+
+	return text;
+}
+
+/* Control characters not expected in text, i.e. all but NUL, \t,
+ * \n, \v, \f, \r and ESC (colored logs). NULs are counted apart.
+ */
+static inline gboolean
+is_binary_control (guchar c)
+{
+	return (c < 0x20) & (c != 0) & ((c < 0x09) | (c > 0x0d)) & (c != 0x1b);
+}
+
+/**
+ * tracker_read_looks_binary:
+ * @fd: input fd to check
+ *
+ * Checks whether the first bytes of @fd look like binary data, going
+ * by the amount of NUL and control characters found in them. Text with
+ * a BOM, or that looks like UTF-16, is never considered binary. The file
+ * offset of @fd is not changed.
+ *
+ * Returns: %TRUE if @fd most likely does not hold text.
+ **/
+gboolean
+tracker_read_looks_binary (gint fd)
+{
+	guchar buf[SNIFF_SIZE];
+	gsize n_nul_even = 0, n_nul_odd = 0, n_control = 0;
+	gssize len;
+	gssize i;
+
+	do {
+		len = pread (fd, buf, sizeof (buf), 0);
+	} while (len < 0 && errno == EINTR);
+
+	/* Not seekable, or too small to tell */
+	if (len < 16)
+		return FALSE;
+
+	if ((buf[0] == 0xEF && buf[1] == 0xBB && buf[2] == 0xBF) ||
+	    (buf[0] == 0xFF && buf[1] == 0xFE) ||
+	    (buf[0] == 0xFE && buf[1] == 0xFF))
+		return FALSE;
+
+	/* Branchless, so the compiler can vectorize it */
+	for (i = 0; i + 1 < len; i += 2) {
+		n_nul_even += buf[i] == 0;
+		n_nul_odd += buf[i + 1] == 0;
+		n_control += is_binary_control (buf[i]) + is_binary_control (buf[i + 1]);
+	}
+
+	/* BOM-less UTF-16 has NULs on one side only, for most characters */
+	if ((n_nul_even == 0 && n_nul_odd >= (gsize) len / 8) ||
+	    (n_nul_odd == 0 && n_nul_even >= (gsize) len / 8))
+		return FALSE;
+
+	if (n_nul_even + n_nul_odd > (gsize) len / 256 ||
+	    n_control > (gsize) len / 10) {
+		g_debug ("  Found %" G_GSIZE_FORMAT " NUL and %" G_GSIZE_FORMAT " control "
+		         "characters in the first %" G_GSSIZE_FORMAT " bytes, not text",
+		         n_nul_even + n_nul_odd, n_control, len);
+		return TRUE;
+	}
+
+	return FALSE;
 }
@@ -29,6 +29,8 @@ gchar *tracker_read_text_from_fd (gint     fd,
                                   gsize    max_bytes,
                                   GError **error);
 
+gboolean tracker_read_looks_binary (gint fd);
+
 G_END_DECLS
 
 #endif /* __TRACKER_READ_H__ */
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Post-install script, writes the cache of the installed extract rules
+# so the extractor does not parse them on every start.
+#
+# Staged installs are skipped, as for the GSettings schemas. Packagers
+# should run "EXTRACTOR --update-rule-cache" once the rules are
+# installed, the extractor parses the rules itself otherwise.
+
+set -e
+
+if [ "$#" -ne 1 ]; then
+    echo >&2 "Usage: $0 EXTRACTOR"
+    exit 1;
+fi
+
+if [ -z "$DESTDIR" ]; then
+    "$1" --update-rule-cache
+fi
@@ -239,6 +239,26 @@ tracker_writeback_file_write_metadata (TrackerWriteback  *writeback,
 		return FALSE;
 	}
 
+	/* Small updates may fit in the file as it is, avoid copying it */
+	if (writeback_file_class->write_file_metadata_in_place) {
+		retval = (writeback_file_class->write_file_metadata_in_place) (TRACKER_WRITEBACK_FILE (writeback),
+		                                                               file,
+		                                                               mime_type,
+		                                                               resource,
+		                                                               cancellable,
+		                                                               &n_error);
+
+		if (retval || n_error) {
+			g_object_unref (file_info);
+			g_object_unref (file);
+
+			if (n_error)
+				g_propagate_error (error, n_error);
+
+			return retval;
+		}
+	}
+
 	/* Copy to a temporary file so we can perform an atomic write on move */
 	tmp_file = create_temporary_file (file, file_info, &n_error);
 
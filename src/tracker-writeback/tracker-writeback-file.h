@@ -50,6 +50,17 @@ struct TrackerWritebackFileClass {
 	                                  TrackerResource       *resource,
 	                                  GCancellable          *cancellable,
 	                                  GError               **error);
+
+	/* Optional, writes to the file directly instead of to a temporary
+	 * copy. Returns %FALSE with no error set to fall back to
+	 * write_file_metadata().
+	 */
+	gboolean (* write_file_metadata_in_place) (TrackerWritebackFile  *writeback_file,
+	                                           GFile                 *file,
+	                                           const gchar           *mime_type,
+	                                           TrackerResource       *resource,
+	                                           GCancellable          *cancellable,
+	                                           GError               **error);
 };
 
 GType tracker_writeback_file_get_type (void) G_GNUC_CONST;
@@ -19,13 +19,17 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <gst/gst.h>
 #include <gst/tag/tag.h>
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 
 #include <tinysparql.h>
@@ -34,6 +38,12 @@
 
 #define TRACKER_TYPE_WRITEBACK_GSTREAMER (tracker_writeback_gstreamer_get_type ())
 
+#define ID3V2_HEADER_SIZE 10
+#define FLAC_BLOCK_HEADER_SIZE 4
+#define MP4_ATOM_HEADER_SIZE 8
+/* Bigger moov atoms are left to the muxer */
+#define MP4_MAX_MOOV_SIZE (64 * 1024 * 1024)
+
 typedef struct TrackerWritebackGstreamer         TrackerWritebackGstreamer;
 typedef struct TrackerWritebackGstreamerClass    TrackerWritebackGstreamerClass;
 typedef struct TrackerWritebackGstreamerElements TagElements;
@@ -70,6 +80,12 @@ static gboolean            writeback_gstreamer_write_file_metadata  (TrackerWrit
                                                                      TrackerResource         *resource,
                                                                      GCancellable            *cancellable,
                                                                      GError                 **error);
+static gboolean            writeback_gstreamer_write_file_metadata_in_place (TrackerWritebackFile  *writeback_file,
+                                                                             GFile                 *file,
+                                                                             const gchar           *mime_type,
+                                                                             TrackerResource       *resource,
+                                                                             GCancellable          *cancellable,
+                                                                             GError               **error);
 static const gchar* const *writeback_gstreamer_content_types        (TrackerWritebackFile    *writeback_file);
 
 G_DEFINE_DYNAMIC_TYPE (TrackerWritebackGstreamer, tracker_writeback_gstreamer, TRACKER_TYPE_WRITEBACK_FILE);
@@ -82,6 +98,7 @@ tracker_writeback_gstreamer_class_init (TrackerWritebackGstreamerClass *klass)
 	gst_init (NULL, NULL);
 
 	writeback_file_class->write_file_metadata = writeback_gstreamer_write_file_metadata;
+	writeback_file_class->write_file_metadata_in_place = writeback_gstreamer_write_file_metadata_in_place;
 	writeback_file_class->content_types = writeback_gstreamer_content_types;
 }
 
@@ -111,6 +128,8 @@ writeback_gstreamer_content_types (TrackerWritebackFile *writeback_file)
 		"audio/ogg",
 		"audio/x-ogg",
 		"audio/x-vorbis+ogg",
+		"audio/mp4",
+		"audio/x-m4a",
 		NULL
 	};
 
@@ -643,51 +662,12 @@ handle_musicbrainz_tags (TrackerResource     *resource,
 	}
 }
 
-static gboolean
-writeback_gstreamer_write_file_metadata (TrackerWritebackFile  *writeback,
-                                         GFile                 *file,
-                                         TrackerResource       *resource,
-                                         GCancellable          *cancellable,
-                                         GError               **error)
+static void
+writeback_gstreamer_collect_tags (TagElements     *element,
+                                  TrackerResource *resource)
 {
-	gboolean ret = FALSE;
-	TagElements *element = (TagElements *) g_malloc (sizeof (TagElements));
 	GList *l, *properties;
 
-	element->tags = NULL;
-	element->taggers = g_hash_table_new (g_str_hash, g_str_equal);
-
-	if (gst_element_factory_find ("giostreamsink") == NULL) {
-		g_warning ("giostreamsink not found, can't tag anything");
-		g_hash_table_unref (element->taggers);
-		g_free (element);
-		return ret;
-	} else {
-		if (gst_element_factory_find ("vorbistag") &&
-		    gst_element_factory_find ("vorbisparse") &&
-		    gst_element_factory_find ("oggmux")) {
-			g_debug ("ogg vorbis tagging available");
-			g_hash_table_insert (element->taggers, "audio/x-vorbis", (gpointer) vorbis_tagger);
-		}
-
-		if (gst_element_factory_find ("flactag")) {
-			g_debug ("flac tagging available");
-			g_hash_table_insert (element->taggers, "audio/x-flac", flac_tagger);
-		}
-
-		if (gst_element_factory_find ("id3v2mux") ||
-		    gst_element_factory_find ("id3mux")) {
-			g_debug ("id3 tagging available");
-			g_hash_table_insert (element->taggers, "audio/mpeg", mp3_tagger);
-		}
-
-		if (gst_element_factory_find ("mp4mux")) {
-			g_debug ("mp4 tagging available");
-			g_hash_table_insert (element->taggers, "audio/mp4", mp4_tagger);
-			g_hash_table_insert (element->taggers, "audio/x-ac3", mp4_tagger);
-		}
-	}
-
 	gst_tag_register_musicbrainz_tags ();
 
 	properties = tracker_resource_get_properties (resource);
@@ -980,6 +960,55 @@ writeback_gstreamer_write_file_metadata (TrackerWritebackFile  *writeback,
 #endif
 	}
 
+	g_list_free (properties);
+}
+
+static gboolean
+writeback_gstreamer_write_file_metadata (TrackerWritebackFile  *writeback,
+                                         GFile                 *file,
+                                         TrackerResource       *resource,
+                                         GCancellable          *cancellable,
+                                         GError               **error)
+{
+	gboolean ret = FALSE;
+	TagElements *element = (TagElements *) g_malloc (sizeof (TagElements));
+
+	element->tags = NULL;
+	element->taggers = g_hash_table_new (g_str_hash, g_str_equal);
+
+	if (gst_element_factory_find ("giostreamsink") == NULL) {
+		g_warning ("giostreamsink not found, can't tag anything");
+		g_hash_table_unref (element->taggers);
+		g_free (element);
+		return ret;
+	} else {
+		if (gst_element_factory_find ("vorbistag") &&
+		    gst_element_factory_find ("vorbisparse") &&
+		    gst_element_factory_find ("oggmux")) {
+			g_debug ("ogg vorbis tagging available");
+			g_hash_table_insert (element->taggers, "audio/x-vorbis", (gpointer) vorbis_tagger);
+		}
+
+		if (gst_element_factory_find ("flactag")) {
+			g_debug ("flac tagging available");
+			g_hash_table_insert (element->taggers, "audio/x-flac", flac_tagger);
+		}
+
+		if (gst_element_factory_find ("id3v2mux") ||
+		    gst_element_factory_find ("id3mux")) {
+			g_debug ("id3 tagging available");
+			g_hash_table_insert (element->taggers, "audio/mpeg", mp3_tagger);
+		}
+
+		if (gst_element_factory_find ("mp4mux")) {
+			g_debug ("mp4 tagging available");
+			g_hash_table_insert (element->taggers, "audio/mp4", mp4_tagger);
+			g_hash_table_insert (element->taggers, "audio/x-ac3", mp4_tagger);
+		}
+	}
+
+	writeback_gstreamer_collect_tags (element, resource);
+
 	writeback_gstreamer_save (element, file, error);
 
 	if (*error != NULL) {
@@ -992,12 +1021,1348 @@ writeback_gstreamer_write_file_metadata (TrackerWritebackFile  *writeback,
 		gst_tag_list_unref (element->tags);
 	if (element->taggers != NULL)
 		g_hash_table_unref (element->taggers);
-	g_list_free (properties);
 	g_free (element);
 
 	return ret;
 }
 
+typedef enum {
+	TAG_VALUE_STRING,
+	TAG_VALUE_NUMBER,
+	TAG_VALUE_DATE,
+	TAG_VALUE_IMAGE,
+} TagValueType;
+
+/* How the tags we write are stored in ID3v2 frames and MP4 ilst items.
+ * The description of TXXX frames and the name of MP4 freeform ("----")
+ * items tell apart the values stored in those, for UFID frames it is
+ * the owner.
+ */
+typedef struct {
+	const gchar *gst_tag;
+	TagValueType type;
+	const gchar *id3v2_frame;
+	const gchar *id3v2_description;
+	const gchar *mp4_atom;
+	const gchar *mp4_name;
+} TagField;
+
+static const TagField tag_fields[] = {
+	{ GST_TAG_TITLE, TAG_VALUE_STRING, "TIT2", NULL, "\251nam", NULL },
+	{ GST_TAG_ARTIST, TAG_VALUE_STRING, "TPE1", NULL, "\251ART", NULL },
+	{ GST_TAG_ALBUM, TAG_VALUE_STRING, "TALB", NULL, "\251alb", NULL },
+	{ GST_TAG_ALBUM_ARTIST, TAG_VALUE_STRING, "TPE2", NULL, "aART", NULL },
+	{ GST_TAG_GENRE, TAG_VALUE_STRING, "TCON", NULL, "\251gen", NULL },
+	{ GST_TAG_COMPOSER, TAG_VALUE_STRING, "TCOM", NULL, "\251wrt", NULL },
+	{ GST_TAG_PUBLISHER, TAG_VALUE_STRING, "TPUB", NULL, NULL, NULL },
+	{ GST_TAG_COMMENT, TAG_VALUE_STRING, "COMM", NULL, "\251cmt", NULL },
+	{ GST_TAG_DESCRIPTION, TAG_VALUE_STRING, NULL, NULL, "desc", NULL },
+	{ GST_TAG_LYRICS, TAG_VALUE_STRING, "USLT", NULL, "\251lyr", NULL },
+	{ GST_TAG_ISRC, TAG_VALUE_STRING, "TSRC", NULL, "----", "ISRC" },
+	{ GST_TAG_TRACK_NUMBER, TAG_VALUE_NUMBER, "TRCK", NULL, "trkn", NULL },
+	{ GST_TAG_ALBUM_VOLUME_NUMBER, TAG_VALUE_NUMBER, "TPOS", NULL, "disk", NULL },
+	{ GST_TAG_DATE_TIME, TAG_VALUE_DATE, "TDRC", NULL, "\251day", NULL },
+	{ GST_TAG_IMAGE, TAG_VALUE_IMAGE, "APIC", NULL, "covr", NULL },
+	{ GST_TAG_MUSICBRAINZ_TRACKID, TAG_VALUE_STRING,
+	  "UFID", "http://musicbrainz.org", "----", "MusicBrainz Track Id" },
+	{ GST_TAG_MUSICBRAINZ_ALBUMID, TAG_VALUE_STRING,
+	  "TXXX", "MusicBrainz Album Id", "----", "MusicBrainz Album Id" },
+	{ GST_TAG_MUSICBRAINZ_ARTISTID, TAG_VALUE_STRING,
+	  "TXXX", "MusicBrainz Artist Id", "----", "MusicBrainz Artist Id" },
+#ifdef GST_TAG_MUSICBRAINZ_RELEASETRACKID
+	{ GST_TAG_MUSICBRAINZ_RELEASETRACKID, TAG_VALUE_STRING,
+	  "TXXX", "MusicBrainz Release Track Id", "----", "MusicBrainz Release Track Id" },
+#endif
+#ifdef GST_TAG_MUSICBRAINZ_RELEASEGROUPID
+	{ GST_TAG_MUSICBRAINZ_RELEASEGROUPID, TAG_VALUE_STRING,
+	  "TXXX", "MusicBrainz Release Group Id", "----", "MusicBrainz Release Group Id" },
+#endif
+#ifdef GST_TAG_ACOUSTID_FINGERPRINT
+	{ GST_TAG_ACOUSTID_FINGERPRINT, TAG_VALUE_STRING,
+	  "TXXX", "Acoustid Fingerprint", "----", "Acoustid Fingerprint" },
+#endif
+};
+
+/* An encoded ID3v2 frame or MP4 ilst item, replacing the ones in
+ * the file with the same ID and name.
+ */
+typedef struct {
+	gchar id[5];
+	const gchar *name;
+	GByteArray *data;
+} TagItem;
+
+static TagItem *
+tag_item_new (const gchar *id,
+              const gchar *name)
+{
+	TagItem *item;
+
+	item = g_new0 (TagItem, 1);
+	memcpy (item->id, id, 4);
+	item->name = name;
+	item->data = g_byte_array_new ();
+
+	return item;
+}
+
+static void
+tag_item_free (TagItem *item)
+{
+	g_byte_array_unref (item->data);
+	g_free (item);
+}
+
+static guint32
+read_uint32_be (const guchar *data)
+{
+	return ((guint32) data[0] << 24 | (guint32) data[1] << 16 |
+	        (guint32) data[2] << 8 | (guint32) data[3]);
+}
+
+static void
+write_uint32_be (guchar  *data,
+                 guint32  value)
+{
+	data[0] = value >> 24;
+	data[1] = value >> 16;
+	data[2] = value >> 8;
+	data[3] = value;
+}
+
+static void
+append_uint32_be (GByteArray *array,
+                  guint32     value)
+{
+	guchar bytes[4];
+
+	write_uint32_be (bytes, value);
+	g_byte_array_append (array, bytes, sizeof (bytes));
+}
+
+static gboolean
+pread_all (gint     fd,
+           guchar  *data,
+           gsize    len,
+           goffset  offset)
+{
+	gssize n_read;
+
+	while (len > 0) {
+		n_read = pread (fd, data, len, offset);
+
+		if (n_read < 0 && errno == EINTR)
+			continue;
+		if (n_read <= 0)
+			return FALSE;
+
+		data += n_read;
+		len -= n_read;
+		offset += n_read;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+pwrite_all (gint          fd,
+            const guchar *data,
+            gsize         len,
+            goffset       offset)
+{
+	gssize written;
+
+	while (len > 0) {
+		written = pwrite (fd, data, len, offset);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+
+		data += written;
+		len -= written;
+		offset += written;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+write_tags_region (gint           fd,
+                   GByteArray    *data,
+                   goffset        offset,
+                   const gchar   *path,
+                   GError       **error)
+{
+	if (!pwrite_all (fd, data->data, data->len, offset)) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not update tags in '%s': %s",
+		             path, g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static const TagField *
+find_tag_field (const gchar *gst_tag)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (tag_fields); i++) {
+		if (g_strcmp0 (tag_fields[i].gst_tag, gst_tag) == 0)
+			return &tag_fields[i];
+	}
+
+	return NULL;
+}
+
+/* Returns the image data and its MIME type, the muxers would
+ * take care of converting other formats.
+ */
+static gboolean
+tag_list_get_image (const GstTagList  *tags,
+                    const gchar       *tag,
+                    GBytes           **data,
+                    const gchar      **mime_type)
+{
+	GstSample *sample;
+	GstBuffer *buffer;
+	GstCaps *caps;
+	GstMapInfo map;
+	const gchar *name;
+
+	if (!gst_tag_list_get_sample (tags, tag, &sample))
+		return FALSE;
+
+	buffer = gst_sample_get_buffer (sample);
+	caps = gst_sample_get_caps (sample);
+	name = caps ? gst_structure_get_name (gst_caps_get_structure (caps, 0)) : NULL;
+
+	if (g_strcmp0 (name, "image/jpeg") == 0)
+		*mime_type = "image/jpeg";
+	else if (g_strcmp0 (name, "image/png") == 0)
+		*mime_type = "image/png";
+	else
+		*mime_type = NULL;
+
+	if (!*mime_type || !buffer || !gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+		gst_sample_unref (sample);
+		return FALSE;
+	}
+
+	*data = g_bytes_new (map.data, map.size);
+	gst_buffer_unmap (buffer, &map);
+	gst_sample_unref (sample);
+
+	return TRUE;
+}
+
+static guint32
+id3v2_read_syncsafe (const guchar *data)
+{
+	return ((guint32) (data[0] & 0x7f) << 21 | (guint32) (data[1] & 0x7f) << 14 |
+	        (guint32) (data[2] & 0x7f) << 7 | (guint32) (data[3] & 0x7f));
+}
+
+static gboolean
+id3v2_is_syncsafe (const guchar *data)
+{
+	return ((data[0] | data[1] | data[2] | data[3]) & 0x80) == 0;
+}
+
+static void
+id3v2_append_frame_header (GByteArray  *frame,
+                           guint        version,
+                           const gchar *id,
+                           guint32      size)
+{
+	guchar header[ID3V2_HEADER_SIZE] = { 0, };
+
+	memcpy (header, id, 4);
+
+	if (version >= 4) {
+		header[4] = (size >> 21) & 0x7f;
+		header[5] = (size >> 14) & 0x7f;
+		header[6] = (size >> 7) & 0x7f;
+		header[7] = size & 0x7f;
+	} else {
+		write_uint32_be (&header[4], size);
+	}
+
+	g_byte_array_append (frame, header, sizeof (header));
+}
+
+/* Text is stored as UTF-8 in ID3v2.4, and as UTF-16 with a BOM in
+ * ID3v2.3 which has no UTF-8 encoding.
+ */
+static guchar
+id3v2_text_encoding (guint version)
+{
+	return version >= 4 ? 0x03 : 0x01;
+}
+
+static void
+id3v2_append_text (GByteArray  *data,
+                   guint        version,
+                   const gchar *str,
+                   gboolean     terminate)
+{
+	if (version >= 4) {
+		g_byte_array_append (data, (const guchar *) str, strlen (str));
+		if (terminate)
+			g_byte_array_append (data, (const guchar *) "", 1);
+	} else {
+		static const guchar bom[] = { 0xff, 0xfe };
+		g_autofree gchar *utf16 = NULL;
+		gsize len = 0;
+
+		utf16 = g_convert (str, -1, "UTF-16LE", "UTF-8", NULL, &len, NULL);
+		g_byte_array_append (data, bom, sizeof (bom));
+		if (utf16)
+			g_byte_array_append (data, (const guchar *) utf16, len);
+		if (terminate)
+			g_byte_array_append (data, (const guchar *) "\0", 2);
+	}
+}
+
+static TagItem *
+id3v2_encode_field (const TagField   *field,
+                    const GstTagList *tags,
+                    guint             version)
+{
+	g_autoptr (GByteArray) body = NULL;
+	const gchar *id = field->id3v2_frame;
+	guchar encoding = id3v2_text_encoding (version);
+	TagItem *item;
+
+	body = g_byte_array_new ();
+
+	if (field->type == TAG_VALUE_STRING) {
+		const gchar *str;
+
+		if (!gst_tag_list_peek_string_index (tags, field->gst_tag, 0, &str))
+			return NULL;
+
+		if (strcmp (id, "UFID") == 0) {
+			g_byte_array_append (body, (const guchar *) field->id3v2_description,
+			                     strlen (field->id3v2_description) + 1);
+			g_byte_array_append (body, (const guchar *) str, strlen (str));
+		} else if (strcmp (id, "COMM") == 0 || strcmp (id, "USLT") == 0) {
+			g_byte_array_append (body, &encoding, 1);
+			g_byte_array_append (body, (const guchar *) "XXX", 3);
+			id3v2_append_text (body, version, "", TRUE);
+			id3v2_append_text (body, version, str, FALSE);
+		} else if (strcmp (id, "TXXX") == 0) {
+			g_byte_array_append (body, &encoding, 1);
+			id3v2_append_text (body, version, field->id3v2_description, TRUE);
+			id3v2_append_text (body, version, str, FALSE);
+		} else {
+			g_byte_array_append (body, &encoding, 1);
+			id3v2_append_text (body, version, str, FALSE);
+		}
+	} else if (field->type == TAG_VALUE_NUMBER) {
+		g_autofree gchar *str = NULL;
+		guint number;
+
+		if (!gst_tag_list_get_uint (tags, field->gst_tag, &number))
+			return NULL;
+
+		str = g_strdup_printf ("%u", number);
+		g_byte_array_append (body, &encoding, 1);
+		id3v2_append_text (body, version, str, FALSE);
+	} else if (field->type == TAG_VALUE_DATE) {
+		g_autoptr (GstDateTime) datetime = NULL;
+		g_autofree gchar *str = NULL;
+
+		if (!gst_tag_list_get_date_time (tags, field->gst_tag, &datetime))
+			return NULL;
+
+		/* ID3v2.3 only has a frame for the year */
+		if (version >= 4) {
+			str = gst_date_time_to_iso8601_string (datetime);
+		} else {
+			id = "TYER";
+			str = g_strdup_printf ("%04d", gst_date_time_get_year (datetime));
+		}
+
+		if (!str)
+			return NULL;
+
+		g_byte_array_append (body, &encoding, 1);
+		id3v2_append_text (body, version, str, FALSE);
+	} else if (field->type == TAG_VALUE_IMAGE) {
+		g_autoptr (GBytes) data = NULL;
+		const gchar *mime_type;
+		guchar picture_type = 0x03; /* Front cover */
+		gconstpointer image;
+		gsize len;
+
+		if (!tag_list_get_image (tags, field->gst_tag, &data, &mime_type))
+			return NULL;
+
+		image = g_bytes_get_data (data, &len);
+		g_byte_array_append (body, &encoding, 1);
+		g_byte_array_append (body, (const guchar *) mime_type, strlen (mime_type) + 1);
+		g_byte_array_append (body, &picture_type, 1);
+		id3v2_append_text (body, version, "", TRUE);
+		g_byte_array_append (body, image, len);
+	}
+
+	/* ID3v2.4 sizes are 28 bit */
+	if (body->len >= (1 << 28))
+		return NULL;
+
+	item = tag_item_new (id, field->id3v2_description);
+	id3v2_append_frame_header (item->data, version, id, body->len);
+	g_byte_array_append (item->data, body->data, body->len);
+
+	return item;
+}
+
+/* Returns the frames for the tags, or %NULL if some of these can't be
+ * written directly.
+ */
+static GPtrArray *
+id3v2_encode_tags (const GstTagList *tags,
+                   guint             version)
+{
+	g_autoptr (GPtrArray) items = NULL;
+	gint i, n_tags;
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) tag_item_free);
+	n_tags = gst_tag_list_n_tags (tags);
+
+	for (i = 0; i < n_tags; i++) {
+		const gchar *tag = gst_tag_list_nth_tag_name (tags, i);
+		const TagField *field;
+		TagItem *item;
+
+		field = find_tag_field (tag);
+		if (!field || !field->id3v2_frame ||
+		    gst_tag_list_get_tag_size (tags, tag) != 1)
+			return NULL;
+
+		item = id3v2_encode_field (field, tags, version);
+		if (!item)
+			return NULL;
+
+		g_ptr_array_add (items, item);
+	}
+
+	return g_steal_pointer (&items);
+}
+
+/* Compares the ASCII @name with the string at the start of a frame,
+ * in the given ID3v2 text encoding.
+ */
+static gboolean
+id3v2_string_equals (const guchar *data,
+                     gsize         len,
+                     guchar        encoding,
+                     const gchar  *name)
+{
+	gsize i, name_len = strlen (name);
+
+	if (encoding == 0x00 || encoding == 0x03) {
+		return (len > name_len &&
+		        memcmp (data, name, name_len) == 0 &&
+		        data[name_len] == '\0');
+	} else if (encoding == 0x01 || encoding == 0x02) {
+		gboolean big_endian = encoding == 0x02;
+
+		if (encoding == 0x01) {
+			if (len < 2)
+				return FALSE;
+			if (data[0] == 0xfe && data[1] == 0xff)
+				big_endian = TRUE;
+			else if (data[0] != 0xff || data[1] != 0xfe)
+				return FALSE;
+			data += 2;
+			len -= 2;
+		}
+
+		if (len < (name_len + 1) * 2)
+			return FALSE;
+
+		for (i = 0; i <= name_len; i++) {
+			guchar hi = data[i * 2 + (big_endian ? 0 : 1)];
+			guchar lo = data[i * 2 + (big_endian ? 1 : 0)];
+
+			if (hi != 0 || lo != (guchar) name[i])
+				return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+id3v2_is_date_frame (const guchar *id)
+{
+	return (memcmp (id, "TDRC", 4) == 0 || memcmp (id, "TYER", 4) == 0 ||
+	        memcmp (id, "TDAT", 4) == 0 || memcmp (id, "TIME", 4) == 0);
+}
+
+static gboolean
+id3v2_frame_is_replaced (const guchar *frame,
+                         gsize         size,
+                         GPtrArray    *items)
+{
+	const guchar *body = &frame[ID3V2_HEADER_SIZE];
+	guint i;
+
+	for (i = 0; i < items->len; i++) {
+		TagItem *item = g_ptr_array_index (items, i);
+
+		if (id3v2_is_date_frame ((const guchar *) item->id)) {
+			if (id3v2_is_date_frame (frame))
+				return TRUE;
+			continue;
+		}
+
+		if (memcmp (frame, item->id, 4) != 0)
+			continue;
+
+		if (!item->name)
+			return TRUE;
+
+		/* Compressed or encrypted frames are kept as they are */
+		if (frame[9] != 0)
+			continue;
+
+		if (strcmp (item->id, "UFID") == 0) {
+			if (id3v2_string_equals (body, size, 0x00, item->name))
+				return TRUE;
+		} else if (size > 0 &&
+		           id3v2_string_equals (&body[1], size - 1, body[0], item->name)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Returns the frames of the tag with @items replacing the ones they
+ * stand for, padded to the current size of the tag, or %NULL if they
+ * do not fit.
+ */
+static GByteArray *
+id3v2_rebuild_frames (const guchar *frames,
+                      gsize         len,
+                      guint         version,
+                      GPtrArray    *items)
+{
+	g_autoptr (GByteArray) result = NULL;
+	gsize pos = 0, old_len;
+	guint i;
+
+	result = g_byte_array_new ();
+
+	/* Padding follows the last frame */
+	while (pos + ID3V2_HEADER_SIZE <= len && frames[pos] != '\0') {
+		const guchar *frame = &frames[pos];
+		guint32 size;
+
+		if (version >= 4) {
+			if (!id3v2_is_syncsafe (&frame[4]))
+				return NULL;
+			size = id3v2_read_syncsafe (&frame[4]);
+		} else {
+			size = read_uint32_be (&frame[4]);
+		}
+
+		if (size > len - pos - ID3V2_HEADER_SIZE)
+			return NULL;
+
+		if (!id3v2_frame_is_replaced (frame, size, items))
+			g_byte_array_append (result, frame, ID3V2_HEADER_SIZE + size);
+
+		pos += ID3V2_HEADER_SIZE + size;
+	}
+
+	for (i = 0; i < items->len; i++) {
+		TagItem *item = g_ptr_array_index (items, i);
+
+		g_byte_array_append (result, item->data->data, item->data->len);
+	}
+
+	if (result->len > len)
+		return NULL;
+
+	old_len = result->len;
+	g_byte_array_set_size (result, len);
+	memset (&result->data[old_len], 0, len - old_len);
+
+	return g_steal_pointer (&result);
+}
+
+static gboolean
+write_id3v2_in_place (gint               fd,
+                      const GstTagList  *tags,
+                      const gchar       *path,
+                      GError           **error)
+{
+	guchar header[ID3V2_HEADER_SIZE];
+	g_autoptr (GPtrArray) items = NULL;
+	g_autoptr (GByteArray) frames = NULL;
+	g_autofree guchar *current = NULL;
+	guint version;
+	gsize size;
+
+	if (!pread_all (fd, header, sizeof (header), 0) ||
+	    memcmp (header, "ID3", 3) != 0)
+		return FALSE;
+
+	version = header[3];
+	if (version != 3 && version != 4)
+		return FALSE;
+
+	/* Unsynchronized tags, extended headers and footers are left
+	 * to the muxer.
+	 */
+	if ((header[5] & 0xf0) != 0 || !id3v2_is_syncsafe (&header[6]))
+		return FALSE;
+
+	size = id3v2_read_syncsafe (&header[6]);
+
+	items = id3v2_encode_tags (tags, version);
+	if (!items)
+		return FALSE;
+
+	current = g_malloc (size);
+	if (!pread_all (fd, current, size, ID3V2_HEADER_SIZE))
+		return FALSE;
+
+	frames = id3v2_rebuild_frames (current, size, version, items);
+	if (!frames)
+		return FALSE;
+
+	return write_tags_region (fd, frames, ID3V2_HEADER_SIZE, path, error);
+}
+
+static gboolean
+vorbis_comment_has_key (const guchar *comment,
+                        gsize         len,
+                        GPtrArray    *keys)
+{
+	const guchar *equals;
+	guint i;
+
+	equals = memchr (comment, '=', len);
+	if (!equals)
+		return FALSE;
+
+	for (i = 0; i < keys->len; i++) {
+		const gchar *key = g_ptr_array_index (keys, i);
+
+		if ((gsize) (equals - comment) == strlen (key) &&
+		    g_ascii_strncasecmp ((const gchar *) comment, key, strlen (key)) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static guint32
+read_uint32_le (const guchar *data)
+{
+	return ((guint32) data[3] << 24 | (guint32) data[2] << 16 |
+	        (guint32) data[1] << 8 | (guint32) data[0]);
+}
+
+static void
+append_uint32_le (GByteArray *array,
+                  guint32     value)
+{
+	guchar bytes[4] = { value, value >> 8, value >> 16, value >> 24 };
+
+	g_byte_array_append (array, bytes, sizeof (bytes));
+}
+
+/* Returns the body of a Vorbis comment block with the fields of
+ * @comments replacing the ones with the same keys in @data, which
+ * may be %NULL if the file had no such block.
+ */
+static GByteArray *
+flac_rebuild_vorbis_comment (const guchar *data,
+                             gsize         len,
+                             GPtrArray    *comments)
+{
+	g_autoptr (GByteArray) result = NULL;
+	g_autoptr (GPtrArray) keys = NULL;
+	guint32 vendor_len = 0, n_comments = 0, n_kept = 0, i;
+	gsize pos = 0, count_offset;
+
+	result = g_byte_array_new ();
+	keys = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < comments->len; i++) {
+		const gchar *comment = g_ptr_array_index (comments, i);
+		const gchar *equals = strchr (comment, '=');
+
+		if (equals)
+			g_ptr_array_add (keys, g_strndup (comment, equals - comment));
+	}
+
+	if (data) {
+		if (len < 8)
+			return NULL;
+		vendor_len = read_uint32_le (data);
+		if (vendor_len > len - 8)
+			return NULL;
+		n_comments = read_uint32_le (&data[4 + vendor_len]);
+		pos = 8 + vendor_len;
+	}
+
+	append_uint32_le (result, vendor_len);
+	if (vendor_len > 0)
+		g_byte_array_append (result, &data[4], vendor_len);
+
+	count_offset = result->len;
+	append_uint32_le (result, 0);
+
+	for (i = 0; i < n_comments; i++) {
+		guint32 comment_len;
+
+		if (pos + 4 > len)
+			return NULL;
+		comment_len = read_uint32_le (&data[pos]);
+		if (comment_len > len - pos - 4)
+			return NULL;
+
+		if (!vorbis_comment_has_key (&data[pos + 4], comment_len, keys)) {
+			g_byte_array_append (result, &data[pos], comment_len + 4);
+			n_kept++;
+		}
+
+		pos += comment_len + 4;
+	}
+
+	for (i = 0; i < comments->len; i++) {
+		const gchar *comment = g_ptr_array_index (comments, i);
+
+		append_uint32_le (result, strlen (comment));
+		g_byte_array_append (result, (const guchar *) comment, strlen (comment));
+	}
+
+	n_kept += comments->len;
+	result->data[count_offset] = n_kept;
+	result->data[count_offset + 1] = n_kept >> 8;
+	result->data[count_offset + 2] = n_kept >> 16;
+	result->data[count_offset + 3] = n_kept >> 24;
+
+	return g_steal_pointer (&result);
+}
+
+static void
+flac_append_block (GByteArray   *metadata,
+                   guchar        type,
+                   const guchar *data,
+                   gsize         len)
+{
+	guchar header[FLAC_BLOCK_HEADER_SIZE] = { type, len >> 16, len >> 8, len };
+
+	g_byte_array_append (metadata, header, sizeof (header));
+	if (len > 0)
+		g_byte_array_append (metadata, data, len);
+}
+
+/* Rebuilds the metadata blocks after the "fLaC" marker with the new
+ * Vorbis comment, and a single padding block taking the space that
+ * is left. Returns %NULL if the blocks do not fit in the current
+ * metadata.
+ */
+static GByteArray *
+flac_rebuild_metadata (const guchar *metadata,
+                       gsize         len,
+                       GPtrArray    *comments)
+{
+	g_autoptr (GByteArray) result = NULL;
+	g_autoptr (GByteArray) vorbis_comment = NULL;
+	gsize pos = 0, last_block = 0;
+	gboolean has_padding = FALSE;
+
+	result = g_byte_array_new ();
+
+	while (pos < len) {
+		guchar type;
+		gsize block_len;
+
+		if (pos + FLAC_BLOCK_HEADER_SIZE > len)
+			return NULL;
+
+		type = metadata[pos] & 0x7f;
+		block_len = ((gsize) metadata[pos + 1] << 16 |
+		             (gsize) metadata[pos + 2] << 8 |
+		             (gsize) metadata[pos + 3]);
+
+		if (type == 127 || block_len > len - pos - FLAC_BLOCK_HEADER_SIZE)
+			return NULL;
+
+		if (type == 1) {
+			/* Padding, merged into a single block at the end */
+			has_padding = TRUE;
+		} else if (type == 4) {
+			/* Only the first Vorbis comment block is valid */
+			if (!vorbis_comment) {
+				vorbis_comment = flac_rebuild_vorbis_comment (&metadata[pos + FLAC_BLOCK_HEADER_SIZE],
+				                                              block_len, comments);
+				if (!vorbis_comment || vorbis_comment->len > 0xffffff)
+					return NULL;
+
+				last_block = result->len;
+				flac_append_block (result, type,
+				                   vorbis_comment->data, vorbis_comment->len);
+			}
+		} else {
+			last_block = result->len;
+			flac_append_block (result, type,
+			                   &metadata[pos + FLAC_BLOCK_HEADER_SIZE], block_len);
+		}
+
+		pos += FLAC_BLOCK_HEADER_SIZE + block_len;
+	}
+
+	/* Files without comments but with padding get a new block */
+	if (!vorbis_comment) {
+		if (!has_padding)
+			return NULL;
+
+		vorbis_comment = flac_rebuild_vorbis_comment (NULL, 0, comments);
+		last_block = result->len;
+		flac_append_block (result, 4, vorbis_comment->data, vorbis_comment->len);
+	}
+
+	if (result->len + FLAC_BLOCK_HEADER_SIZE <= len &&
+	    len - result->len - FLAC_BLOCK_HEADER_SIZE <= 0xffffff) {
+		gsize padding_len = len - result->len - FLAC_BLOCK_HEADER_SIZE;
+		gsize old_len = result->len;
+
+		flac_append_block (result, 1, NULL, 0);
+		result->data[old_len + 1] = padding_len >> 16;
+		result->data[old_len + 2] = padding_len >> 8;
+		result->data[old_len + 3] = padding_len;
+		last_block = old_len;
+
+		g_byte_array_set_size (result, len);
+		memset (&result->data[old_len + FLAC_BLOCK_HEADER_SIZE], 0, padding_len);
+	} else if (result->len != len) {
+		return NULL;
+	}
+
+	result->data[last_block] |= 0x80;
+
+	return g_steal_pointer (&result);
+}
+
+static gboolean
+write_flac_in_place (gint               fd,
+                     const GstTagList  *tags,
+                     const gchar       *path,
+                     GError           **error)
+{
+	g_autoptr (GPtrArray) comments = NULL;
+	g_autoptr (GByteArray) current = NULL;
+	g_autoptr (GByteArray) metadata = NULL;
+	guchar header[FLAC_BLOCK_HEADER_SIZE];
+	gboolean last = FALSE;
+	goffset pos = 4;
+	gint i, n_tags;
+
+	if (!pread_all (fd, header, 4, 0) ||
+	    memcmp (header, "fLaC", 4) != 0)
+		return FALSE;
+
+	/* Pictures are stored in blocks of their own */
+	if (gst_tag_list_get_tag_size (tags, GST_TAG_IMAGE) > 0)
+		return FALSE;
+
+	comments = g_ptr_array_new_with_free_func (g_free);
+	n_tags = gst_tag_list_n_tags (tags);
+
+	for (i = 0; i < n_tags; i++) {
+		GList *fields, *l;
+
+		fields = gst_tag_to_vorbis_comments (tags, gst_tag_list_nth_tag_name (tags, i));
+		for (l = fields; l; l = l->next)
+			g_ptr_array_add (comments, l->data);
+		g_list_free (fields);
+	}
+
+	current = g_byte_array_new ();
+
+	while (!last) {
+		gsize block_len, old_len;
+
+		if (!pread_all (fd, header, sizeof (header), pos))
+			return FALSE;
+
+		last = (header[0] & 0x80) != 0;
+		block_len = ((gsize) header[1] << 16 | (gsize) header[2] << 8 | header[3]);
+
+		old_len = current->len;
+		g_byte_array_set_size (current, old_len + sizeof (header) + block_len);
+		memcpy (&current->data[old_len], header, sizeof (header));
+
+		if ((header[0] & 0x7f) == 1) {
+			/* No need to read through padding */
+			memset (&current->data[old_len + sizeof (header)], 0, block_len);
+		} else if (!pread_all (fd, &current->data[old_len + sizeof (header)],
+		                       block_len, pos + sizeof (header))) {
+			return FALSE;
+		}
+
+		pos += sizeof (header) + block_len;
+	}
+
+	metadata = flac_rebuild_metadata (current->data, current->len, comments);
+	if (!metadata)
+		return FALSE;
+
+	return write_tags_region (fd, metadata, 4, path, error);
+}
+
+static void
+mp4_append_atom_header (GByteArray  *array,
+                        guint32      size,
+                        const gchar *type)
+{
+	append_uint32_be (array, size);
+	g_byte_array_append (array, (const guchar *) type, 4);
+}
+
+/* Encodes an ilst item holding a single "data" atom */
+static TagItem *
+mp4_item_new (const TagField *field,
+              guint32         data_type,
+              gconstpointer   payload,
+              gsize           len)
+{
+	TagItem *item;
+	gsize data_size = MP4_ATOM_HEADER_SIZE + 8 + len;
+
+	item = tag_item_new (field->mp4_atom, field->mp4_name);
+
+	if (field->mp4_name) {
+		static const gchar *mean = "com.apple.iTunes";
+		gsize mean_size = MP4_ATOM_HEADER_SIZE + 4 + strlen (mean);
+		gsize name_size = MP4_ATOM_HEADER_SIZE + 4 + strlen (field->mp4_name);
+
+		mp4_append_atom_header (item->data,
+		                        MP4_ATOM_HEADER_SIZE + mean_size + name_size + data_size,
+		                        "----");
+		mp4_append_atom_header (item->data, mean_size, "mean");
+		append_uint32_be (item->data, 0);
+		g_byte_array_append (item->data, (const guchar *) mean, strlen (mean));
+		mp4_append_atom_header (item->data, name_size, "name");
+		append_uint32_be (item->data, 0);
+		g_byte_array_append (item->data, (const guchar *) field->mp4_name,
+		                     strlen (field->mp4_name));
+	} else {
+		mp4_append_atom_header (item->data,
+		                        MP4_ATOM_HEADER_SIZE + data_size,
+		                        field->mp4_atom);
+	}
+
+	mp4_append_atom_header (item->data, data_size, "data");
+	append_uint32_be (item->data, data_type);
+	append_uint32_be (item->data, 0);
+	g_byte_array_append (item->data, payload, len);
+
+	return item;
+}
+
+static TagItem *
+mp4_encode_field (const TagField   *field,
+                  const GstTagList *tags)
+{
+	if (field->type == TAG_VALUE_STRING) {
+		const gchar *str;
+
+		if (!gst_tag_list_peek_string_index (tags, field->gst_tag, 0, &str))
+			return NULL;
+
+		return mp4_item_new (field, 1, str, strlen (str));
+	} else if (field->type == TAG_VALUE_NUMBER) {
+		guchar payload[8] = { 0, };
+		guint number;
+
+		if (!gst_tag_list_get_uint (tags, field->gst_tag, &number) ||
+		    number > G_MAXUINT16)
+			return NULL;
+
+		/* Number and total count, disk has no trailing bytes */
+		payload[2] = number >> 8;
+		payload[3] = number;
+
+		return mp4_item_new (field, 0, payload,
+		                     strcmp (field->mp4_atom, "disk") == 0 ? 6 : 8);
+	} else if (field->type == TAG_VALUE_DATE) {
+		g_autoptr (GstDateTime) datetime = NULL;
+		g_autofree gchar *str = NULL;
+
+		if (!gst_tag_list_get_date_time (tags, field->gst_tag, &datetime))
+			return NULL;
+
+		str = gst_date_time_to_iso8601_string (datetime);
+		if (!str)
+			return NULL;
+
+		return mp4_item_new (field, 1, str, strlen (str));
+	} else if (field->type == TAG_VALUE_IMAGE) {
+		g_autoptr (GBytes) data = NULL;
+		const gchar *mime_type;
+		gconstpointer image;
+		gsize len;
+
+		if (!tag_list_get_image (tags, field->gst_tag, &data, &mime_type))
+			return NULL;
+
+		image = g_bytes_get_data (data, &len);
+
+		return mp4_item_new (field,
+		                     strcmp (mime_type, "image/png") == 0 ? 14 : 13,
+		                     image, len);
+	}
+
+	return NULL;
+}
+
+static GPtrArray *
+mp4_encode_tags (const GstTagList *tags)
+{
+	g_autoptr (GPtrArray) items = NULL;
+	gint i, n_tags;
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) tag_item_free);
+	n_tags = gst_tag_list_n_tags (tags);
+
+	for (i = 0; i < n_tags; i++) {
+		const gchar *tag = gst_tag_list_nth_tag_name (tags, i);
+		const TagField *field;
+		TagItem *item;
+
+		field = find_tag_field (tag);
+		if (!field || !field->mp4_atom ||
+		    gst_tag_list_get_tag_size (tags, tag) != 1)
+			return NULL;
+
+		item = mp4_encode_field (field, tags);
+		if (!item)
+			return NULL;
+
+		g_ptr_array_add (items, item);
+	}
+
+	return g_steal_pointer (&items);
+}
+
+typedef struct {
+	gsize offset;
+	gsize size;
+} Mp4Atom;
+
+/* Finds a child atom between @start and @end, only 32 bit sizes
+ * are handled in metadata atoms.
+ */
+static gboolean
+mp4_find_child (const guchar *data,
+                gsize         start,
+                gsize         end,
+                const gchar  *type,
+                Mp4Atom      *atom)
+{
+	gsize pos = start;
+
+	while (pos + MP4_ATOM_HEADER_SIZE <= end) {
+		guint32 size = read_uint32_be (&data[pos]);
+
+		if (size < MP4_ATOM_HEADER_SIZE || size > end - pos)
+			return FALSE;
+
+		if (memcmp (&data[pos + 4], type, 4) == 0) {
+			atom->offset = pos;
+			atom->size = size;
+			return TRUE;
+		}
+
+		pos += size;
+	}
+
+	return FALSE;
+}
+
+/* Returns the end of the free atoms found at @pos */
+static gsize
+mp4_skip_free_atoms (const guchar *data,
+                     gsize         pos,
+                     gsize         end)
+{
+	while (pos + MP4_ATOM_HEADER_SIZE <= end) {
+		guint32 size = read_uint32_be (&data[pos]);
+
+		if (size < MP4_ATOM_HEADER_SIZE || size > end - pos ||
+		    (memcmp (&data[pos + 4], "free", 4) != 0 &&
+		     memcmp (&data[pos + 4], "skip", 4) != 0))
+			break;
+
+		pos += size;
+	}
+
+	return pos;
+}
+
+static gboolean
+mp4_item_is_replaced (const guchar *item_data,
+                      gsize         size,
+                      GPtrArray    *items)
+{
+	const guchar *type = &item_data[4];
+	guint i;
+
+	for (i = 0; i < items->len; i++) {
+		TagItem *item = g_ptr_array_index (items, i);
+		Mp4Atom name;
+
+		/* Numeric genres are replaced with the text one */
+		if (memcmp (item->id, "\251gen", 4) == 0 &&
+		    memcmp (type, "gnre", 4) == 0)
+			return TRUE;
+
+		if (memcmp (type, item->id, 4) != 0)
+			continue;
+
+		if (!item->name)
+			return TRUE;
+
+		if (mp4_find_child (item_data, MP4_ATOM_HEADER_SIZE, size, "name", &name) &&
+		    name.size == MP4_ATOM_HEADER_SIZE + 4 + strlen (item->name) &&
+		    memcmp (&item_data[name.offset + MP4_ATOM_HEADER_SIZE + 4],
+		            item->name, strlen (item->name)) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Rewrites the moov atom with a new ilst atom, which may take the
+ * space of free atoms following it, the atoms containing it are
+ * grown to cover that space. Returns %FALSE if the items do not fit.
+ */
+static gboolean
+mp4_rebuild_moov (guchar    *moov,
+                  gsize      moov_size,
+                  GPtrArray *items)
+{
+	g_autoptr (GByteArray) ilst_data = NULL;
+	Mp4Atom parents[3], ilst;
+	gsize children, pos, region_end, available, i;
+	gint level;
+
+	parents[0].offset = 0;
+	parents[0].size = moov_size;
+
+	if (!mp4_find_child (moov, MP4_ATOM_HEADER_SIZE, moov_size, "udta", &parents[1]) ||
+	    !mp4_find_child (moov, parents[1].offset + MP4_ATOM_HEADER_SIZE,
+	                     parents[1].offset + parents[1].size, "meta", &parents[2]))
+		return FALSE;
+
+	/* The meta atom is a full box in MP4 files, but not in QuickTime ones */
+	children = parents[2].offset + MP4_ATOM_HEADER_SIZE;
+	if (parents[2].size >= MP4_ATOM_HEADER_SIZE + 4 &&
+	    read_uint32_be (&moov[children]) == 0)
+		children += 4;
+
+	if (!mp4_find_child (moov, children, parents[2].offset + parents[2].size,
+	                     "ilst", &ilst))
+		return FALSE;
+
+	ilst_data = g_byte_array_new ();
+	mp4_append_atom_header (ilst_data, 0, "ilst");
+	pos = ilst.offset + MP4_ATOM_HEADER_SIZE;
+
+	while (pos < ilst.offset + ilst.size) {
+		gsize size;
+
+		if (pos + MP4_ATOM_HEADER_SIZE > ilst.offset + ilst.size)
+			return FALSE;
+
+		size = read_uint32_be (&moov[pos]);
+		if (size < MP4_ATOM_HEADER_SIZE || size > ilst.offset + ilst.size - pos)
+			return FALSE;
+
+		if (!mp4_item_is_replaced (&moov[pos], size, items))
+			g_byte_array_append (ilst_data, &moov[pos], size);
+
+		pos += size;
+	}
+
+	for (i = 0; i < items->len; i++) {
+		TagItem *item = g_ptr_array_index (items, i);
+
+		g_byte_array_append (ilst_data, item->data->data, item->data->len);
+	}
+
+	write_uint32_be (ilst_data->data, ilst_data->len);
+
+	/* Take up free atoms after ilst, then after its parents if
+	 * those were the last children.
+	 */
+	region_end = ilst.offset + ilst.size;
+
+	for (level = G_N_ELEMENTS (parents) - 1; level >= 0; level--) {
+		gsize parent_end = parents[level].offset + parents[level].size;
+
+		region_end = mp4_skip_free_atoms (moov, region_end, parent_end);
+		if (region_end < parent_end)
+			break;
+	}
+
+	available = region_end - ilst.offset;
+
+	if (ilst_data->len > available ||
+	    (ilst_data->len < available &&
+	     available - ilst_data->len < MP4_ATOM_HEADER_SIZE))
+		return FALSE;
+
+	if (ilst_data->len < available) {
+		gsize free_size = available - ilst_data->len;
+		gsize old_len = ilst_data->len;
+
+		mp4_append_atom_header (ilst_data, free_size, "free");
+		g_byte_array_set_size (ilst_data, available);
+		memset (&ilst_data->data[old_len + MP4_ATOM_HEADER_SIZE], 0,
+		        free_size - MP4_ATOM_HEADER_SIZE);
+	}
+
+	for (level = 1; level < (gint) G_N_ELEMENTS (parents); level++) {
+		gsize parent_end = parents[level].offset + parents[level].size;
+
+		if (parent_end < region_end) {
+			write_uint32_be (&moov[parents[level].offset],
+			                 parents[level].size + region_end - parent_end);
+		}
+	}
+
+	memcpy (&moov[ilst.offset], ilst_data->data, available);
+
+	return TRUE;
+}
+
+static gboolean
+write_mp4_in_place (gint               fd,
+                    const GstTagList  *tags,
+                    const gchar       *path,
+                    GError           **error)
+{
+	g_autoptr (GPtrArray) items = NULL;
+	g_autoptr (GByteArray) moov = NULL;
+	guchar header[16];
+	goffset pos = 0;
+	guint64 size;
+
+	items = mp4_encode_tags (tags);
+	if (!items)
+		return FALSE;
+
+	/* Find the moov atom at the top level */
+	while (TRUE) {
+		if (!pread_all (fd, header, MP4_ATOM_HEADER_SIZE, pos))
+			return FALSE;
+
+		size = read_uint32_be (header);
+
+		if (memcmp (&header[4], "moov", 4) == 0)
+			break;
+
+		if (size == 1) {
+			if (!pread_all (fd, &header[8], 8, pos + 8))
+				return FALSE;
+			size = ((guint64) read_uint32_be (&header[8]) << 32 |
+			        read_uint32_be (&header[12]));
+		}
+
+		if (size < MP4_ATOM_HEADER_SIZE)
+			return FALSE;
+
+		pos += size;
+	}
+
+	if (size < MP4_ATOM_HEADER_SIZE || size > MP4_MAX_MOOV_SIZE)
+		return FALSE;
+
+	moov = g_byte_array_sized_new (size);
+	g_byte_array_set_size (moov, size);
+
+	if (!pread_all (fd, moov->data, size, pos) ||
+	    !mp4_rebuild_moov (moov->data, moov->len, items))
+		return FALSE;
+
+	return write_tags_region (fd, moov, pos, path, error);
+}
+
+/* Patches the tags in the file if they fit in the space that the
+ * current ones take, plus padding. This avoids remuxing the whole
+ * file, the pipeline is used for everything else.
+ */
+static gboolean
+writeback_gstreamer_write_file_metadata_in_place (TrackerWritebackFile  *writeback,
+                                                  GFile                 *file,
+                                                  const gchar           *mime_type,
+                                                  TrackerResource       *resource,
+                                                  GCancellable          *cancellable,
+                                                  GError               **error)
+{
+	gboolean (* write_in_place) (gint, const GstTagList *, const gchar *, GError **);
+	TagElements element = { 0, };
+	g_autofree gchar *path = NULL;
+	gboolean retval = FALSE;
+	gint fd;
+
+	if (g_strcmp0 (mime_type, "audio/flac") == 0 ||
+	    g_strcmp0 (mime_type, "audio/x-flac") == 0)
+		write_in_place = write_flac_in_place;
+	else if (g_strcmp0 (mime_type, "audio/mpeg") == 0 ||
+	         g_strcmp0 (mime_type, "audio/x-mpeg") == 0 ||
+	         g_strcmp0 (mime_type, "audio/mp3") == 0 ||
+	         g_strcmp0 (mime_type, "audio/x-mp3") == 0 ||
+	         g_strcmp0 (mime_type, "audio/mpeg3") == 0 ||
+	         g_strcmp0 (mime_type, "audio/x-mpeg3") == 0)
+		write_in_place = write_id3v2_in_place;
+	else if (g_strcmp0 (mime_type, "audio/mp4") == 0 ||
+	         g_strcmp0 (mime_type, "audio/x-m4a") == 0)
+		write_in_place = write_mp4_in_place;
+	else
+		return FALSE;
+
+	writeback_gstreamer_collect_tags (&element, resource);
+	if (!element.tags)
+		return FALSE;
+
+	path = g_file_get_path (file);
+	fd = path ? g_open (path, O_RDWR | O_CLOEXEC, 0) : -1;
+
+	if (fd >= 0 && !g_cancellable_is_cancelled (cancellable)) {
+		retval = write_in_place (fd, element.tags, path, error);
+
+		if (retval)
+			g_debug ("Updated tags of '%s' in place", path);
+	}
+
+	if (fd >= 0)
+		close (fd);
+	gst_tag_list_unref (element.tags);
+
+	return retval;
+}
+
 TrackerWriteback *
 writeback_module_create (GTypeModule *module)
 {
@@ -21,14 +21,18 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
 
 #include <exempi/xmp.h>
 #include <exempi/xmpconsts.h>
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <tinysparql.h>
 
@@ -38,6 +42,13 @@
 
 #define TRACKER_TYPE_WRITEBACK_XMP (tracker_writeback_xmp_get_type ())
 
+/* PNG stores XMP in an iTXt chunk with the "XML:com.adobe.xmp" keyword,
+ * no compression and empty language tags, the packet is preceded by the
+ * chunk length and type, and followed by the chunk CRC.
+ */
+#define PNG_XMP_KEYWORD "XML:com.adobe.xmp"
+#define PNG_XMP_HEADER_SIZE (8 + sizeof (PNG_XMP_KEYWORD) + 4)
+
 typedef struct TrackerWritebackXMP TrackerWritebackXMP;
 typedef struct TrackerWritebackXMPClass TrackerWritebackXMPClass;
 
@@ -56,6 +67,12 @@ static gboolean             writeback_xmp_write_file_metadata  (TrackerWriteback
                                                                 GCancellable          *cancellable,
                                                                 GError               **error);
 static const gchar * const *writeback_xmp_content_types        (TrackerWritebackFile  *writeback_file);
+static gboolean             writeback_xmp_write_file_metadata_in_place (TrackerWritebackFile  *writeback_file,
+                                                                        GFile                 *file,
+                                                                        const gchar           *mime_type,
+                                                                        TrackerResource       *resource,
+                                                                        GCancellable          *cancellable,
+                                                                        GError               **error);
 
 G_DEFINE_DYNAMIC_TYPE (TrackerWritebackXMP, tracker_writeback_xmp, TRACKER_TYPE_WRITEBACK_FILE);
 
@@ -67,6 +84,7 @@ tracker_writeback_xmp_class_init (TrackerWritebackXMPClass *klass)
 	xmp_init ();
 
 	writeback_file_class->write_file_metadata = writeback_xmp_write_file_metadata;
+	writeback_file_class->write_file_metadata_in_place = writeback_xmp_write_file_metadata_in_place;
 	writeback_file_class->content_types = writeback_xmp_content_types;
 }
 
@@ -128,49 +146,11 @@ write_gps_coord (XmpPtr       xmp,
 	g_free (val);
 }
 
-static gboolean
-writeback_xmp_write_file_metadata (TrackerWritebackFile  *wbf,
-                                   GFile                 *file,
-                                   TrackerResource       *resource,
-                                   GCancellable          *cancellable,
-                                   GError               **error)
+static void
+write_resource_properties (XmpPtr           xmp,
+                           TrackerResource *resource)
 {
 	GList *properties, *l;
-	gchar *path;
-	XmpFilePtr xmp_files;
-	XmpPtr xmp;
-#ifdef DEBUG_XMP
-	XmpStringPtr str;
-#endif
-
-	path = g_file_get_path (file);
-
-	xmp_files = xmp_files_open_new (path, XMP_OPEN_FORUPDATE);
-
-	if (!xmp_files) {
-		g_set_error (error,
-		             G_IO_ERROR,
-		             G_IO_ERROR_FAILED,
-		             "Can't open '%s' for update with Exempi (Exempi error code = %d)",
-		             path,
-		             xmp_get_error ());
-		g_free (path);
-		return FALSE;
-	}
-
-	xmp = xmp_files_get_new_xmp (xmp_files);
-
-	if (!xmp) {
-		xmp = xmp_new_empty ();
-	}
-
-#ifdef DEBUG_XMP
-	str = xmp_string_new ();
-	g_print ("\nBEFORE: ---- \n");
-	xmp_serialize_and_format (xmp, str, 0, 0, "\n", "\t", 1);
-	g_print ("%s\n", xmp_string_cstr (str));
-	xmp_string_free (str);
-#endif
 
 	properties = tracker_resource_get_properties (resource);
 
@@ -513,6 +493,262 @@ writeback_xmp_write_file_metadata (TrackerWritebackFile  *wbf,
 		}
 	}
 
+	g_list_free (properties);
+}
+
+static guint32
+png_crc (const guchar *data,
+         gsize         len,
+         guint32       crc)
+{
+	gsize i;
+	gint k;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+
+		for (k = 0; k < 8; k++)
+			crc = (crc & 1) ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+	}
+
+	return crc;
+}
+
+static gboolean
+pwrite_all (gint          fd,
+            const guchar *data,
+            gsize         len,
+            goffset       offset)
+{
+	gssize written;
+
+	while (len > 0) {
+		written = pwrite (fd, data, len, offset);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+
+		data += written;
+		len -= written;
+		offset += written;
+	}
+
+	return TRUE;
+}
+
+/* Reads the iTXt chunk header before the packet, returns the CRC of
+ * the chunk type and header fields, to be completed with the packet.
+ */
+static gboolean
+read_png_chunk_header (gint     fd,
+                       goffset  packet_offset,
+                       gsize    packet_len,
+                       guint32 *crc)
+{
+	guchar header[PNG_XMP_HEADER_SIZE];
+	guint32 chunk_len;
+
+	if (packet_offset < (goffset) PNG_XMP_HEADER_SIZE)
+		return FALSE;
+
+	if (pread (fd, header, sizeof (header),
+	           packet_offset - PNG_XMP_HEADER_SIZE) != sizeof (header))
+		return FALSE;
+
+	chunk_len = ((guint32) header[0] << 24 | (guint32) header[1] << 16 |
+	             (guint32) header[2] << 8 | (guint32) header[3]);
+
+	if (chunk_len != PNG_XMP_HEADER_SIZE - 8 + packet_len ||
+	    memcmp (&header[4], "iTXt", 4) != 0 ||
+	    memcmp (&header[8], PNG_XMP_KEYWORD, sizeof (PNG_XMP_KEYWORD)) != 0 ||
+	    memcmp (&header[8 + sizeof (PNG_XMP_KEYWORD)], "\0\0\0\0", 4) != 0)
+		return FALSE;
+
+	*crc = png_crc (&header[4], sizeof (header) - 4, 0xffffffff);
+
+	return TRUE;
+}
+
+/* Replaces the XMP packet in the file, if the updated packet fits in
+ * the padding of the current one. This avoids copying the whole file,
+ * which for large images is most of the cost of writeback.
+ */
+static gboolean
+writeback_xmp_write_file_metadata_in_place (TrackerWritebackFile  *wbf,
+                                            GFile                 *file,
+                                            const gchar           *mime_type,
+                                            TrackerResource       *resource,
+                                            GCancellable          *cancellable,
+                                            GError               **error)
+{
+	XmpFilePtr xmp_files;
+	XmpStringPtr packet, new_packet;
+	XmpPacketInfo packet_info = { 0, };
+	XmpPtr xmp = NULL;
+	g_autofree gchar *path = NULL;
+	g_autofree guchar *current = NULL;
+	const gchar *packet_str, *new_packet_str;
+	gboolean is_png, retval = FALSE;
+	guint32 crc = 0;
+	gsize len;
+	gint fd = -1;
+
+	is_png = g_strcmp0 (mime_type, "image/png") == 0;
+
+	if (!is_png &&
+	    g_strcmp0 (mime_type, "image/jpeg") != 0 &&
+	    g_strcmp0 (mime_type, "image/tiff") != 0)
+		return FALSE;
+
+	path = g_file_get_path (file);
+	xmp_files = xmp_files_open_new (path, XMP_OPEN_READ);
+	if (!xmp_files)
+		return FALSE;
+
+	packet = xmp_string_new ();
+	new_packet = xmp_string_new ();
+
+	if (!xmp_files_get_xmp_xmpstring (xmp_files, packet, &packet_info))
+		goto out;
+
+	packet_str = xmp_string_cstr (packet);
+	len = strlen (packet_str);
+
+	/* Only UTF-8 packets with a known location in the file */
+	if (packet_info.offset < 0 ||
+	    packet_info.length <= 0 ||
+	    packet_info.charForm != 0 ||
+	    !packet_info.hasWrapper ||
+	    len != (gsize) packet_info.length)
+		goto out;
+
+	xmp = xmp_new (packet_str, len);
+	if (!xmp)
+		goto out;
+
+	write_resource_properties (xmp, resource);
+
+	/* Fails if the packet does not fit in the current space */
+	if (!xmp_serialize (xmp, new_packet,
+	                    XMP_SERIAL_EXACTPACKETLENGTH,
+	                    packet_info.length))
+		goto out;
+
+	new_packet_str = xmp_string_cstr (new_packet);
+	if (strlen (new_packet_str) != len)
+		goto out;
+
+	fd = g_open (path, O_RDWR | O_CLOEXEC, 0);
+	if (fd < 0)
+		goto out;
+
+	/* Check the packet is really where it was reported */
+	current = g_malloc (len);
+	if (pread (fd, current, len, packet_info.offset) != (gssize) len ||
+	    memcmp (current, packet_str, len) != 0)
+		goto out;
+
+	if (is_png &&
+	    !read_png_chunk_header (fd, packet_info.offset, len, &crc))
+		goto out;
+
+	if (g_cancellable_is_cancelled (cancellable))
+		goto out;
+
+	if (!pwrite_all (fd, (const guchar *) new_packet_str, len,
+	                 packet_info.offset)) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not update XMP packet in '%s': %s",
+		             path, g_strerror (errno));
+		goto out;
+	}
+
+	if (is_png) {
+		guchar crc_bytes[4];
+
+		crc = png_crc ((const guchar *) new_packet_str, len, crc) ^ 0xffffffff;
+		crc_bytes[0] = crc >> 24;
+		crc_bytes[1] = crc >> 16;
+		crc_bytes[2] = crc >> 8;
+		crc_bytes[3] = crc;
+
+		if (!pwrite_all (fd, crc_bytes, sizeof (crc_bytes),
+		                 packet_info.offset + len)) {
+			g_set_error (error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not update PNG chunk CRC in '%s': %s",
+			             path, g_strerror (errno));
+			goto out;
+		}
+	}
+
+	g_debug ("Updated XMP packet of '%s' in place", path);
+	retval = TRUE;
+
+out:
+	if (fd >= 0)
+		close (fd);
+	if (xmp)
+		xmp_free (xmp);
+	xmp_string_free (new_packet);
+	xmp_string_free (packet);
+	xmp_files_close (xmp_files, XMP_CLOSE_NOOPTION);
+	xmp_files_free (xmp_files);
+
+	return retval;
+}
+
+static gboolean
+writeback_xmp_write_file_metadata (TrackerWritebackFile  *wbf,
+                                   GFile                 *file,
+                                   TrackerResource       *resource,
+                                   GCancellable          *cancellable,
+                                   GError               **error)
+{
+	gchar *path;
+	XmpFilePtr xmp_files;
+	XmpPtr xmp;
+#ifdef DEBUG_XMP
+	XmpStringPtr str;
+#endif
+
+	path = g_file_get_path (file);
+
+	xmp_files = xmp_files_open_new (path, XMP_OPEN_FORUPDATE);
+
+	if (!xmp_files) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_FAILED,
+		             "Can't open '%s' for update with Exempi (Exempi error code = %d)",
+		             path,
+		             xmp_get_error ());
+		g_free (path);
+		return FALSE;
+	}
+
+	xmp = xmp_files_get_new_xmp (xmp_files);
+
+	if (!xmp) {
+		xmp = xmp_new_empty ();
+	}
+
+#ifdef DEBUG_XMP
+	str = xmp_string_new ();
+	g_print ("\nBEFORE: ---- \n");
+	xmp_serialize_and_format (xmp, str, 0, 0, "\n", "\t", 1);
+	g_print ("%s\n", xmp_string_cstr (str));
+	xmp_string_free (str);
+#endif
+
+	write_resource_properties (xmp, resource);
+
 #ifdef DEBUG_XMP
 	g_print ("\nAFTER: ---- \n");
 	str = xmp_string_new ();
@@ -537,7 +773,6 @@ writeback_xmp_write_file_metadata (TrackerWritebackFile  *wbf,
 	xmp_free (xmp);
 	xmp_files_free (xmp_files);
 	g_free (path);
-	g_list_free (properties);
 
 	return TRUE;
 }
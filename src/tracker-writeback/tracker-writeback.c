@@ -34,14 +34,27 @@
 #warning Controller thread traces enabled
 #endif /* THREAD_ENABLE_TRACE */
 
+/* Writebacks run at the same time, on different files */
+#define MAX_RUNNING_WRITEBACKS 4
+
 typedef struct {
-	TrackerController *controller;
-	GCancellable *cancellable;
 	GDBusMethodInvocation *invocation;
 	TrackerDBusRequest *request;
+} WritebackCall;
+
+typedef struct {
+	TrackerController *controller;
+	GCancellable *cancellable;
+	/* WritebackCalls merged into this one, in arrival order */
+	GList *calls;
+	gchar *url;
 	TrackerResource *resource;
 	GList *writeback_handlers;
 	GError *error;
+	/* State the file was left in, for the miner to recognize it */
+	gboolean rewritten;
+	gint64 modified;
+	goffset size;
 } WritebackData;
 
 typedef struct {
@@ -54,19 +67,25 @@ typedef struct {
 	guint bus_name_id;
 	guint old_bus_name_id;
 
-	GList *ongoing_tasks;
+	/* WritebackData waiting to run, in order, and by file. Later
+	 * writebacks to a file that is still waiting are merged into it.
+	 */
+	GQueue pending;
+	GHashTable *pending_by_url;
+	/* Files being written back */
+	GHashTable *running_urls;
+	guint n_running;
 
 	guint shutdown_timeout;
 	GSource *shutdown_source;
 
 	GCond initialization_cond;
-	GMutex initialization_mutex, mutex;
+	GMutex initialization_mutex;
 	GError *initialization_error;
 
 	guint initialized : 1;
 
 	GHashTable *modules;
-	WritebackData *current;
 } TrackerControllerPrivate;
 
 #define WRITEBACK_SERVICE "org.freedesktop.LocalSearch3.Writeback"
@@ -131,13 +150,14 @@ tracker_controller_finalize (GObject *object)
 	tracker_controller_dbus_stop (controller);
 
 	g_hash_table_unref (priv->modules);
+	g_hash_table_unref (priv->pending_by_url);
+	g_hash_table_unref (priv->running_urls);
 
 	g_main_loop_unref (priv->main_loop);
 	g_main_context_unref (priv->context);
 
 	g_cond_clear (&priv->initialization_cond);
 	g_mutex_clear (&priv->initialization_mutex);
-	g_mutex_clear (&priv->mutex);
 
 	G_OBJECT_CLASS (tracker_controller_parent_class)->finalize (object);
 }
@@ -201,26 +221,124 @@ writeback_data_new (TrackerController       *controller,
 {
 	WritebackData *data;
 
-	data = g_slice_new (WritebackData);
+	WritebackCall *call;
+
+	call = g_slice_new (WritebackCall);
+	call->invocation = invocation;
+	call->request = request;
+
+	data = g_slice_new0 (WritebackData);
 	data->cancellable = g_cancellable_new ();
 	data->controller = g_object_ref (controller);
+	data->url = g_strdup (tracker_resource_get_first_string (resource, "nie:isStoredAs"));
 	data->resource = g_object_ref (resource);
-	data->invocation = invocation;
+	data->calls = g_list_prepend (NULL, call);
 	data->writeback_handlers = writeback_handlers;
-	data->request = request;
 	data->error = NULL;
 
 	return data;
 }
 
+static gboolean
+writeback_handlers_contain_type (GList *writeback_handlers,
+                                 GType  type)
+{
+	GList *l;
+
+	for (l = writeback_handlers; l; l = l->next) {
+		if (G_OBJECT_TYPE (l->data) == type)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Folds a later writeback to the same file into @data, so the file
+ * is only rewritten once. Properties set by @resource replace the
+ * ones in @data, as if both were written in turn.
+ */
+static void
+writeback_data_merge (WritebackData         *data,
+                      GList                 *writeback_handlers,
+                      TrackerResource       *resource,
+                      GDBusMethodInvocation *invocation,
+                      TrackerDBusRequest    *request)
+{
+	WritebackCall *call;
+	GList *properties, *l;
+
+	properties = tracker_resource_get_properties (resource);
+
+	for (l = properties; l; l = l->next) {
+		const gchar *property = l->data;
+		GList *values, *v;
+
+		values = tracker_resource_get_values (resource, property);
+
+		for (v = values; v; v = v->next) {
+			/* Keep all types, so every matching module runs */
+			if (v == values && g_strcmp0 (property, "rdf:type") != 0)
+				tracker_resource_set_gvalue (data->resource, property, v->data);
+			else
+				tracker_resource_add_gvalue (data->resource, property, v->data);
+		}
+
+		g_list_free (values);
+	}
+
+	g_list_free (properties);
+
+	for (l = writeback_handlers; l; l = l->next) {
+		if (writeback_handlers_contain_type (data->writeback_handlers,
+		                                     G_OBJECT_TYPE (l->data))) {
+			g_object_unref (l->data);
+		} else {
+			data->writeback_handlers =
+				g_list_append (data->writeback_handlers, l->data);
+		}
+	}
+
+	g_list_free (writeback_handlers);
+
+	call = g_slice_new (WritebackCall);
+	call->invocation = invocation;
+	call->request = request;
+	data->calls = g_list_append (data->calls, call);
+}
+
+static void
+writeback_data_return (WritebackData *data)
+{
+	GList *l;
+
+	for (l = data->calls; l; l = l->next) {
+		WritebackCall *call = l->data;
+
+		if (data->error == NULL) {
+			g_dbus_method_invocation_return_value (call->invocation, NULL);
+		} else {
+			g_dbus_method_invocation_return_gerror (call->invocation,
+			                                        data->error);
+		}
+
+		tracker_dbus_request_end (call->request, NULL);
+		g_slice_free (WritebackCall, call);
+	}
+
+	g_clear_pointer (&data->calls, g_list_free);
+}
+
 static void
 writeback_data_free (WritebackData *data)
 {
-	/* We rely on data->invocation being freed through
+	/* We rely on the invocations being freed through
 	 * the g_dbus_method_invocation_return_* methods
 	 */
+	g_assert (data->calls == NULL);
 	g_object_unref (data->cancellable);
 	g_object_unref (data->resource);
+	g_object_unref (data->controller);
+	g_free (data->url);
 
 	g_list_foreach (data->writeback_handlers, (GFunc) g_object_unref, NULL);
 	g_list_free (data->writeback_handlers);
@@ -290,34 +408,10 @@ tracker_controller_init (TrackerController *controller)
 
 	g_cond_init (&priv->initialization_cond);
 	g_mutex_init (&priv->initialization_mutex);
-	g_mutex_init (&priv->mutex);
-}
-
-static gboolean
-perform_writeback_cb (gpointer user_data)
-{
-	TrackerControllerPrivate *priv;
-	WritebackData *data;
-
-	data = user_data;
-	priv = tracker_controller_get_instance_private (data->controller);
-	priv->ongoing_tasks = g_list_remove (priv->ongoing_tasks, data);
-
-	if (data->error == NULL) {
-		g_dbus_method_invocation_return_value (data->invocation, NULL);
-	} else {
-		g_dbus_method_invocation_return_gerror (data->invocation, data->error);
-	}
 
-	tracker_dbus_request_end (data->request, NULL);
-
-	g_mutex_lock (&priv->mutex);
-	priv->current = NULL;
-	g_mutex_unlock (&priv->mutex);
-
-	writeback_data_free (data);
-
-	return FALSE;
+	g_queue_init (&priv->pending);
+	priv->pending_by_url = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->running_urls = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 static void
@@ -327,15 +421,10 @@ io_writeback_job (GTask        *task,
                   GCancellable *cancellable)
 {
 	WritebackData *data = task_data;
-	TrackerControllerPrivate *priv = tracker_controller_get_instance_private (data->controller);
 	GError *error = NULL;
 	gboolean handled = FALSE;
 	GList *writeback_handlers;
 
-	g_mutex_lock (&priv->mutex);
-	priv->current = data;
-	g_mutex_unlock (&priv->mutex);
-
 	writeback_handlers = data->writeback_handlers;
 
 	while (writeback_handlers) {
@@ -358,9 +447,119 @@ io_writeback_job (GTask        *task,
 		}
 	} else {
 		g_clear_error (&error);
+
+		if (data->url) {
+			g_autoptr (GFile) file = NULL;
+			g_autoptr (GFileInfo) info = NULL;
+
+			file = g_file_new_for_uri (data->url);
+			info = g_file_query_info (file,
+			                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+			                          G_FILE_ATTRIBUTE_STANDARD_SIZE,
+			                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+			                          NULL, NULL);
+			if (info) {
+				data->modified = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+				data->size = g_file_info_get_size (info);
+				data->rewritten = TRUE;
+			}
+		}
 	}
 
-	g_idle_add (perform_writeback_cb, data);
+	g_task_return_boolean (task, TRUE);
+}
+
+/* The miner would otherwise see the rewritten file as changed, and
+ * extract again the metadata that was just written.
+ */
+static void
+controller_register_writeback (TrackerController *controller,
+                               WritebackData     *data)
+{
+	TrackerControllerPrivate *priv;
+
+	priv = tracker_controller_get_instance_private (controller);
+
+	g_dbus_connection_call (priv->d_connection,
+	                        "org.freedesktop.Tracker3.Miner.Files",
+	                        "/org/freedesktop/Tracker3/Files",
+	                        "org.freedesktop.Tracker3.Files",
+	                        "RegisterWriteback",
+	                        g_variant_new ("(sxx)",
+	                                       data->url,
+	                                       data->modified,
+	                                       (gint64) data->size),
+	                        NULL,
+	                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                        -1, NULL, NULL, NULL);
+}
+
+static void controller_run_writebacks (TrackerController *controller);
+
+static void
+writeback_done_cb (GObject      *object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	TrackerController *controller = TRACKER_CONTROLLER (object);
+	TrackerControllerPrivate *priv;
+	WritebackData *data = user_data;
+
+	priv = tracker_controller_get_instance_private (controller);
+
+	if (data->rewritten)
+		controller_register_writeback (controller, data);
+
+	writeback_data_return (data);
+
+	if (data->url)
+		g_hash_table_remove (priv->running_urls, data->url);
+	priv->n_running--;
+
+	writeback_data_free (data);
+
+	controller_run_writebacks (controller);
+}
+
+/* Starts the pending writebacks in order, as long as there are free
+ * slots. Files already being written back wait for it to finish.
+ */
+static void
+controller_run_writebacks (TrackerController *controller)
+{
+	TrackerControllerPrivate *priv;
+	GList *l, *next;
+
+	priv = tracker_controller_get_instance_private (controller);
+
+	for (l = priv->pending.head;
+	     l && priv->n_running < MAX_RUNNING_WRITEBACKS;
+	     l = next) {
+		WritebackData *data = l->data;
+		GTask *task;
+
+		next = l->next;
+
+		if (data->url &&
+		    g_hash_table_contains (priv->running_urls, data->url))
+			continue;
+
+		g_queue_delete_link (&priv->pending, l);
+
+		if (data->url) {
+			g_hash_table_remove (priv->pending_by_url, data->url);
+			g_hash_table_add (priv->running_urls, data->url);
+		}
+
+		priv->n_running++;
+
+		/* Completes in the controller thread, which owns the queues */
+		task = g_task_new (controller, data->cancellable,
+		                   writeback_done_cb, data);
+		g_task_set_task_data (task, data, NULL);
+		g_task_run_in_thread (task, io_writeback_job);
+		g_object_unref (task);
+	}
 }
 
 gboolean
@@ -457,20 +656,33 @@ handle_method_call_writeback (TrackerController     *controller,
 	g_list_free (types);
 
 	if (writeback_handlers != NULL) {
-		WritebackData *data;
-		GTask *task;
-
-		data = writeback_data_new (controller,
-		                           writeback_handlers,
-		                           resource,
-		                           invocation,
-		                           request);
-		task = g_task_new (controller, data->cancellable, NULL, NULL);
+		const gchar *url;
+		WritebackData *data = NULL;
+
+		url = tracker_resource_get_first_string (resource, "nie:isStoredAs");
+		if (url)
+			data = g_hash_table_lookup (priv->pending_by_url, url);
+
+		if (data) {
+			g_debug ("Merging writeback into the one pending for '%s'", url);
+			writeback_data_merge (data,
+			                      writeback_handlers,
+			                      resource,
+			                      invocation,
+			                      request);
+		} else {
+			data = writeback_data_new (controller,
+			                           writeback_handlers,
+			                           resource,
+			                           invocation,
+			                           request);
+			g_queue_push_tail (&priv->pending, data);
+
+			if (data->url)
+				g_hash_table_insert (priv->pending_by_url, data->url, data);
+		}
 
-		/* No need to free data here, it's done in the callback. */
-		g_task_set_task_data (task, data, NULL);
-		g_task_run_in_thread (task, io_writeback_job);
-		g_object_unref (task);
+		controller_run_writebacks (controller);
 	} else {
 		g_dbus_method_invocation_return_error (invocation,
 		                                       TRACKER_DBUS_ERROR,
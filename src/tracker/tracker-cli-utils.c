@@ -20,6 +20,8 @@
  */
 
 
+#include <unistd.h>
+
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gio/gio.h>
@@ -107,6 +109,27 @@ tracker_cli_get_error_keyfiles (void)
 	return keyfiles;
 }
 
+gboolean
+tracker_cli_get_status_page (TrackerStatusPageData data[TRACKER_STATUS_PAGE_N_SECTIONS])
+{
+	g_autoptr (GFile) cache_dir = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *path = NULL;
+
+	path = g_build_filename (g_get_user_cache_dir (),
+	                         "tracker3",
+	                         "files",
+	                         NULL);
+	cache_dir = g_file_new_for_path (path);
+
+	if (!tracker_status_page_read (cache_dir, data, &error)) {
+		g_debug ("No status page, falling back to D-Bus: %s", error->message);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 gboolean
 tracker_cli_check_inside_build_tree (const gchar* argv0)
 {
@@ -118,3 +141,61 @@ tracker_cli_check_inside_build_tree (const gchar* argv0)
 
 	return g_file_has_prefix (path, build_root);
 }
+
+/* Appends the paths in @path, one per line, to @files. Standard input
+ * is read if @path is NULL or "-".
+ */
+gboolean
+tracker_cli_read_file_list (const gchar  *path,
+                            GStrv        *files,
+                            GError      **error)
+{
+	GIOChannel *channel;
+	GPtrArray *array;
+	GIOStatus status;
+	gchar *line;
+	gsize terminator;
+	guint i;
+
+	if (!path || g_strcmp0 (path, "-") == 0)
+		channel = g_io_channel_unix_new (STDIN_FILENO);
+	else
+		channel = g_io_channel_new_file (path, "r", error);
+
+	if (!channel)
+		return FALSE;
+
+	/* File names are not necessarily UTF-8 */
+	g_io_channel_set_encoding (channel, NULL, NULL);
+
+	array = g_ptr_array_new ();
+
+	for (i = 0; *files && (*files)[i]; i++)
+		g_ptr_array_add (array, (*files)[i]);
+
+	while ((status = g_io_channel_read_line (channel, &line, NULL,
+	                                         &terminator, error)) == G_IO_STATUS_NORMAL) {
+		line[terminator] = '\0';
+
+		if (*line)
+			g_ptr_array_add (array, line);
+		else
+			g_free (line);
+	}
+
+	g_io_channel_unref (channel);
+
+	if (status == G_IO_STATUS_ERROR) {
+		/* Leave @files untouched */
+		for (i = *files ? g_strv_length (*files) : 0; i < array->len; i++)
+			g_free (g_ptr_array_index (array, i));
+		g_ptr_array_unref (array);
+		return FALSE;
+	}
+
+	g_ptr_array_add (array, NULL);
+	g_free (*files);
+	*files = (GStrv) g_ptr_array_free (array, FALSE);
+
+	return TRUE;
+}
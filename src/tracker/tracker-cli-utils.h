@@ -25,9 +25,16 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <libtracker-miners-common/tracker-common.h>
 
 GList* tracker_cli_get_error_keyfiles (void);
 
+gboolean tracker_cli_get_status_page (TrackerStatusPageData data[TRACKER_STATUS_PAGE_N_SECTIONS]);
+
 gboolean tracker_cli_check_inside_build_tree (const gchar* argv0);
 
+gboolean tracker_cli_read_file_list (const gchar  *path,
+                                     GStrv        *files,
+                                     GError      **error);
+
 #endif /* __TRACKER_CLI_UTILS_H__ */
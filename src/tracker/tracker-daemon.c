@@ -39,11 +39,18 @@
 #include "tracker-process.h"
 #include "tracker-dbus.h"
 #include "tracker-miner-manager.h"
+#include "tracker-cli-utils.h"
+
+/* Changes sampled in each --watch-interval summary */
+#define WATCH_SUMMARY_SAMPLES 5
 
 typedef struct {
 	TrackerSparqlConnection *connection;
-	GHashTable *prefixes;
-	GStrv filter;
+	gchar *graph;
+	gchar *class;
+	gchar *prefix;
+	guint counts[TRACKER_NOTIFIER_EVENT_UPDATE + 1];
+	GPtrArray *samples;
 } WatchData;
 
 static GMainLoop *main_loop;
@@ -62,6 +69,11 @@ static gboolean status;
 static gboolean follow;
 static gboolean watch;
 static gboolean list_common_statuses;
+static gboolean show_metrics;
+static gchar *watch_graph;
+static gchar *watch_class;
+static gchar *watch_prefix;
+static gint watch_interval;
 
 static gchar *miner_name;
 static gchar *pause_reason;
@@ -79,7 +91,8 @@ static gchar *backup;
 static gchar *restore;
 
 #define DAEMON_OPTIONS_ENABLED() \
-	((status || follow || watch || list_common_statuses) || \
+	((status || follow || watch || list_common_statuses || show_metrics) || \
+	 (watch_graph || watch_class || watch_prefix || watch_interval > 0) || \
 	 (miner_name || \
 	  pause_reason || \
 	  pause_for_process_reason || \
@@ -116,10 +129,26 @@ static GOptionEntry entries[] = {
 	  N_("Watch changes to the database in real time (e.g. resources or files being added)"),
 	  NULL
 	},
+	{ "watch-graph", 0, 0, G_OPTION_ARG_STRING, &watch_graph,
+	  N_("Only watch changes to resources in GRAPH (e.g. tracker:Audio)"),
+	  N_("GRAPH") },
+	{ "watch-class", 0, 0, G_OPTION_ARG_STRING, &watch_class,
+	  N_("Only watch changes to resources of CLASS (e.g. nfo:Document)"),
+	  N_("CLASS") },
+	{ "watch-prefix", 0, 0, G_OPTION_ARG_FILENAME, &watch_prefix,
+	  N_("Only watch changes to files in LOCATION"),
+	  N_("LOCATION") },
+	{ "watch-interval", 0, 0, G_OPTION_ARG_INT, &watch_interval,
+	  N_("Summarize the changes made every SECONDS, instead of showing them as they happen"),
+	  N_("SECONDS") },
 	{ "list-common-statuses", 0, 0, G_OPTION_ARG_NONE, &list_common_statuses,
 	  N_("List common statuses for miners"),
 	  NULL
 	},
+	{ "metrics", 0, 0, G_OPTION_ARG_NONE, &show_metrics,
+	  N_("Show latency statistics of the running miners"),
+	  NULL
+	},
 	/* Miners */
 	{ "pause", 0 , 0, G_OPTION_ARG_STRING, &pause_reason,
 	  N_("Pause a miner (you must use this with --miner)"),
@@ -228,6 +257,28 @@ miner_get_details (TrackerMinerManager  *manager,
 	return TRUE;
 }
 
+static void
+print_status_page (void)
+{
+	TrackerStatusPageData data[TRACKER_STATUS_PAGE_N_SECTIONS];
+	const TrackerStatusPageData *files, *extractor;
+
+	if (!tracker_cli_get_status_page (data))
+		return;
+
+	files = &data[TRACKER_STATUS_PAGE_SECTION_FILES];
+	extractor = &data[TRACKER_STATUS_PAGE_SECTION_EXTRACTOR];
+
+	g_print ("\n%s:\n", _("Statistics"));
+	g_print ("  %s: %u\n", _("Queued changes"), files->queued);
+	g_print ("  %s: %" G_GUINT64_FORMAT " (%.1f/s)\n",
+	         _("Processed changes"), files->processed, files->rate);
+	g_print ("  %s: %" G_GUINT64_FORMAT "\n",
+	         _("Indexing errors"), files->errors);
+	g_print ("  %s: %" G_GUINT64_FORMAT "\n",
+	         _("Extraction errors"), extractor->errors);
+}
+
 static void
 miner_print_state (TrackerMinerManager *manager,
                    const gchar         *miner_name,
@@ -414,22 +465,216 @@ print_key (GHashTable  *prefixes,
 	}
 }
 
+static const gchar *
+event_type_to_string (TrackerNotifierEventType type)
+{
+	switch (type) {
+	case TRACKER_NOTIFIER_EVENT_CREATE:
+		return "created";
+	case TRACKER_NOTIFIER_EVENT_DELETE:
+		return "deleted";
+	case TRACKER_NOTIFIER_EVENT_UPDATE:
+		return "updated";
+	}
+
+	g_assert_not_reached ();
+}
+
+/* Drops the events on resources not in the watched class. This costs
+ * one query for the whole batch, deleted resources are not in the
+ * database anymore and are always kept.
+ */
 static void
-notifier_events_cb (TrackerNotifier         *notifier,
-		    const gchar             *service,
-		    const gchar             *graph,
-		    GPtrArray               *events,
-		    TrackerSparqlConnection *conn)
+watch_filter_class (WatchData *data,
+                    GPtrArray *events)
 {
-	gint i;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GHashTable) matches = NULL;
+	g_autoptr (GString) query = NULL;
+	g_autoptr (GError) error = NULL;
+	gboolean has_values = FALSE;
+	guint i;
+
+	query = g_string_new ("SELECT ?u { VALUES ?u {");
 
 	for (i = 0; i < events->len; i++) {
-		TrackerNotifierEvent *event;
+		TrackerNotifierEvent *event = g_ptr_array_index (events, i);
+		g_autofree gchar *escaped = NULL;
+
+		if (tracker_notifier_event_get_event_type (event) == TRACKER_NOTIFIER_EVENT_DELETE)
+			continue;
+
+		escaped = tracker_sparql_escape_uri (tracker_notifier_event_get_urn (event));
+		g_string_append_printf (query, " <%s>", escaped);
+		has_values = TRUE;
+	}
+
+	if (!has_values)
+		return;
+
+	g_string_append_printf (query, " } ?u a <%s> }", data->class);
+
+	cursor = tracker_sparql_connection_query (data->connection, query->str,
+	                                          NULL, &error);
+	if (!cursor) {
+		g_printerr ("%s, %s\n",
+		            _("Could not query resource classes"),
+		            error->message);
+		return;
+	}
+
+	matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_hash_table_add (matches,
+		                  g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)));
+	}
+
+	for (i = 0; i < events->len; ) {
+		TrackerNotifierEvent *event = g_ptr_array_index (events, i);
+
+		if (tracker_notifier_event_get_event_type (event) != TRACKER_NOTIFIER_EVENT_DELETE &&
+		    !g_hash_table_contains (matches, tracker_notifier_event_get_urn (event)))
+			g_ptr_array_remove_index (events, i);
+		else
+			i++;
+	}
+}
+
+static gboolean
+watch_matches_prefix (WatchData   *data,
+                      const gchar *urn)
+{
+	gsize len = strlen (data->prefix);
+
+	/* Files are named by their URI */
+	if (!g_str_has_prefix (urn, data->prefix))
+		return FALSE;
+
+	return (urn[len] == '\0' || urn[len] == '/' ||
+	        data->prefix[len - 1] == '/');
+}
+
+static void
+notifier_events_cb (TrackerNotifier *notifier,
+		    const gchar     *service,
+		    const gchar     *graph,
+		    GPtrArray       *events,
+		    WatchData       *data)
+{
+	g_autoptr (GPtrArray) matched = NULL;
+	guint i;
+
+	if (data->graph && g_strcmp0 (graph, data->graph) != 0)
+		return;
+
+	/* Filters on names are applied right away over the batch, only
+	 * those on classes need to look resources up.
+	 */
+	matched = g_ptr_array_new ();
+
+	for (i = 0; i < events->len; i++) {
+		TrackerNotifierEvent *event = g_ptr_array_index (events, i);
+
+		if (data->prefix &&
+		    !watch_matches_prefix (data, tracker_notifier_event_get_urn (event)))
+			continue;
+
+		g_ptr_array_add (matched, event);
+	}
+
+	if (data->class && matched->len > 0)
+		watch_filter_class (data, matched);
+
+	for (i = 0; i < matched->len; i++) {
+		TrackerNotifierEvent *event = g_ptr_array_index (matched, i);
+		TrackerNotifierEventType type;
+
+		type = tracker_notifier_event_get_event_type (event);
+
+		if (watch_interval > 0) {
+			data->counts[type]++;
+
+			if (data->samples->len < WATCH_SUMMARY_SAMPLES) {
+				g_ptr_array_add (data->samples,
+				                 g_strdup_printf ("%s '%s'",
+				                                  event_type_to_string (type),
+				                                  tracker_notifier_event_get_urn (event)));
+			}
+		} else {
+			g_print ("  '%s' => '%s'\n", graph,
+			         tracker_notifier_event_get_urn (event));
+		}
+	}
+}
+
+static gboolean
+watch_summary_cb (gpointer user_data)
+{
+	WatchData *data = user_data;
+	g_autoptr (GDateTime) now = NULL;
+	g_autofree gchar *time_str = NULL;
+	guint i;
+
+	now = g_date_time_new_now_local ();
+	time_str = g_date_time_format (now, "%T");
+
+	/* Translators: the first %s is the time of day, followed by the
+	 * number of resources created, updated and deleted since the
+	 * previous summary.
+	 */
+	g_print (_("%s: %u created, %u updated, %u deleted"),
+	         time_str,
+	         data->counts[TRACKER_NOTIFIER_EVENT_CREATE],
+	         data->counts[TRACKER_NOTIFIER_EVENT_UPDATE],
+	         data->counts[TRACKER_NOTIFIER_EVENT_DELETE]);
+	g_print ("\n");
+
+	for (i = 0; i < data->samples->len; i++)
+		g_print ("  %s\n", (gchar *) g_ptr_array_index (data->samples, i));
+
+	memset (data->counts, 0, sizeof (data->counts));
+	g_ptr_array_set_size (data->samples, 0);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+watch_data_init (WatchData               *data,
+                 TrackerSparqlConnection *connection)
+{
+	TrackerNamespaceManager *namespaces;
+
+	namespaces = tracker_sparql_connection_get_namespace_manager (connection);
+
+	data->connection = connection;
+	data->samples = g_ptr_array_new_with_free_func (g_free);
+
+	if (watch_graph)
+		data->graph = tracker_namespace_manager_expand_uri (namespaces, watch_graph);
+
+	if (watch_class) {
+		g_autofree gchar *expanded = NULL;
 
-		event = g_ptr_array_index (events, i);
-		g_print ("  '%s' => '%s'\n", graph,
-			 tracker_notifier_event_get_urn (event));
+		expanded = tracker_namespace_manager_expand_uri (namespaces, watch_class);
+		data->class = tracker_sparql_escape_uri (expanded);
 	}
+
+	if (watch_prefix) {
+		g_autoptr (GFile) file = NULL;
+
+		file = g_file_new_for_commandline_arg (watch_prefix);
+		data->prefix = g_file_get_uri (file);
+	}
+}
+
+static void
+watch_data_clear (WatchData *data)
+{
+	g_clear_pointer (&data->samples, g_ptr_array_unref);
+	g_free (data->graph);
+	g_free (data->class);
+	g_free (data->prefix);
 }
 
 static gint
@@ -689,6 +934,55 @@ miner_pause_details (void)
 	return EXIT_SUCCESS;
 }
 
+static gint
+miner_print_metrics (void)
+{
+	TrackerMinerManager *manager;
+	GError *error = NULL;
+	GSList *miners_running, *l;
+
+	/* Don't auto-start the miners here */
+	manager = tracker_miner_manager_new_full (FALSE, &error);
+	if (!manager) {
+		g_printerr (_("Could not get metrics, manager could not be created, %s"),
+		            error ? error->message : _("No error given"));
+		g_printerr ("\n");
+		g_clear_error (&error);
+		return EXIT_FAILURE;
+	}
+
+	miners_running = tracker_miner_manager_get_running (manager);
+
+	if (!miners_running)
+		g_print ("%s\n", _("No miners are running"));
+
+	for (l = miners_running; l; l = l->next) {
+		g_autoptr (GVariant) metrics = NULL;
+		g_autofree gchar *str = NULL;
+
+		metrics = tracker_miner_manager_get_metrics (manager, l->data, &error);
+		if (!metrics) {
+			g_printerr (_("Could not get metrics from miner: %s"),
+			            error ? error->message : _("No error given"));
+			g_printerr ("\n");
+			g_clear_error (&error);
+			continue;
+		}
+
+		str = tracker_metrics_snapshot_to_string (metrics);
+		g_print ("%s:\n%s\n",
+		         tracker_miner_manager_get_display_name (manager, l->data),
+		         str);
+	}
+
+	g_slist_foreach (miners_running, (GFunc) g_free, NULL);
+	g_slist_free (miners_running);
+
+	g_object_unref (manager);
+
+	return EXIT_SUCCESS;
+}
+
 static gint
 daemon_run (void)
 {
@@ -699,10 +993,16 @@ daemon_run (void)
 		status = TRUE;
 	}
 
+	if (watch_graph || watch_class || watch_prefix || watch_interval > 0) {
+		watch = TRUE;
+	}
+
 	if (watch) {
 		TrackerSparqlConnection *sparql_connection;
 		TrackerNotifier *notifier;
+		WatchData data = { 0, };
 		GError *error = NULL;
+		guint summary_id = 0;
 
 		sparql_connection = tracker_sparql_connection_bus_new ("org.freedesktop.Tracker3.Miner.Files",
 		                                                       NULL, NULL, &error);
@@ -715,10 +1015,14 @@ daemon_run (void)
 			return EXIT_FAILURE;
 		}
 
+		watch_data_init (&data, sparql_connection);
+
 		notifier = tracker_sparql_connection_create_notifier (sparql_connection);
 		g_signal_connect (notifier, "events",
-				  G_CALLBACK (notifier_events_cb), sparql_connection);
-		g_object_unref (sparql_connection);
+				  G_CALLBACK (notifier_events_cb), &data);
+
+		if (watch_interval > 0)
+			summary_id = g_timeout_add_seconds (watch_interval, watch_summary_cb, &data);
 
 		g_print ("%s\n", _("Now listening for resource updates to the database"));
 		g_print ("%s\n\n", _("All nie:plainTextContent properties are omitted"));
@@ -727,7 +1031,10 @@ daemon_run (void)
 		main_loop = g_main_loop_new (NULL, FALSE);
 		g_main_loop_run (main_loop);
 		g_main_loop_unref (main_loop);
+		g_clear_handle_id (&summary_id, g_source_remove);
 		g_object_unref (notifier);
+		watch_data_clear (&data);
+		g_object_unref (sparql_connection);
 
 		/* Carriage return, so we paper over the ^C */
 		g_print ("\r");
@@ -735,6 +1042,10 @@ daemon_run (void)
 		return EXIT_SUCCESS;
 	}
 
+	if (show_metrics) {
+		return miner_print_metrics ();
+	}
+
 	if (list_common_statuses) {
 		gint i;
 
@@ -833,6 +1144,8 @@ daemon_run (void)
 		g_slist_foreach (miners_running, (GFunc) g_free, NULL);
 		g_slist_free (miners_running);
 
+		print_status_page ();
+
 		if (!follow) {
 			/* Do nothing further */
 			g_print ("\n");
@@ -43,7 +43,7 @@ static gchar **filenames;
 
 static GOptionEntry entries[] = {
 	{ "output-format", 'o', 0, G_OPTION_ARG_STRING, &output_format,
-	  N_("Output results format: “sparql”, “turtle” or “json-ld”"),
+	  N_("Output results format: “sparql”, “turtle”, “trig” or “json-ld”"),
 	  N_("FORMAT") },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames,
 	  N_("FILE"),
@@ -20,6 +20,7 @@
 #include "config-miners.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #ifdef __sun
@@ -28,6 +29,7 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 #include <locale.h>
 #include <tinysparql.h>
@@ -35,16 +37,47 @@
 
 #include <libtracker-miners-common/tracker-common.h>
 
+#include "tracker-cli-utils.h"
 #include "tracker-color.h"
 #include "tracker-dbus.h"
 
 static gboolean opt_add;
 static gboolean opt_remove;
 static gboolean opt_recursive;
+static gboolean opt_now;
+static gboolean opt_estimate;
+static gchar *opt_export_bundle;
+static gchar *opt_import_bundle;
 static gchar **filenames;
+static gboolean inside_build_tree = FALSE;
 
 #define INDEX_OPTIONS_ENABLED()	  \
-	(opt_add || opt_remove || opt_recursive)
+	(opt_add || opt_remove || opt_recursive || opt_now || \
+	 opt_estimate || opt_export_bundle || opt_import_bundle)
+
+/* Must match the miner, see restore_index_bundle() */
+#define INDEX_BUNDLE_HEADER "# localsearch-bundle 1"
+
+#define ROOT_QUERY \
+	"SELECT ?root { " \
+	"  GRAPH tracker:FileSystem { " \
+	"    ?root a tracker:IndexedFolder ; " \
+	"      nie:isStoredAs ~uri " \
+	"  } " \
+	"}"
+
+/* Everything stored for the files in the root, including
+ * the root folder itself.
+ */
+#define BUNDLE_QUERY \
+	"DESCRIBE ?f ?hash ?ie " \
+	"WHERE { " \
+	"  GRAPH tracker:FileSystem { " \
+	"    ?f nie:dataSource ~root . " \
+	"    OPTIONAL { ?f nfo:hasHash ?hash } " \
+	"  } " \
+	"  OPTIONAL { ?ie nie:isStoredAs ?f } " \
+	"}"
 
 static GOptionEntry entries[] = {
 	{ "add", 'a', 0, G_OPTION_ARG_NONE, &opt_add,
@@ -56,6 +89,18 @@ static GOptionEntry entries[] = {
 	{ "recursive", 'r', 0, G_OPTION_ARG_NONE, &opt_recursive,
 	  N_("Makes indexing recursive"),
 	  NULL },
+	{ "now", 'n', 0, G_OPTION_ARG_NONE, &opt_now,
+	  N_("Indexes FILE right away, and waits until its metadata is available"),
+	  NULL },
+	{ "estimate", 0, 0, G_OPTION_ARG_NONE, &opt_estimate,
+	  N_("Estimates what indexing FILE would cost, without indexing it"),
+	  NULL },
+	{ "export-bundle", 0, 0, G_OPTION_ARG_FILENAME, &opt_export_bundle,
+	  N_("Saves the index data of the indexed location FILE into BUNDLE"),
+	  N_("BUNDLE") },
+	{ "import-bundle", 0, 0, G_OPTION_ARG_FILENAME, &opt_import_bundle,
+	  N_("Uses the index data in BUNDLE for FILE, when it is first indexed"),
+	  N_("BUNDLE") },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames,
 	  N_("FILE"),
 	  N_("FILE") },
@@ -275,9 +320,307 @@ index_remove (void)
 	return EXIT_SUCCESS;
 }
 
+static int
+index_now (void)
+{
+	g_autoptr (GDBusConnection) bus = NULL;
+	g_autoptr (GError) error = NULL;
+	gboolean handled = TRUE;
+	guint i;
+
+	bus = g_bus_get_sync (TRACKER_IPC_BUS, NULL, &error);
+	if (!bus) {
+		g_printerr ("%s: %s\n",
+		            _("Could not get D-Bus connection"),
+		            error->message);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; filenames[i]; i++) {
+		g_autoptr (GFile) file = NULL;
+		g_autoptr (GVariant) reply = NULL;
+		g_autofree gchar *uri = NULL;
+
+		file = g_file_new_for_commandline_arg (filenames[i]);
+		uri = g_file_get_uri (file);
+
+		reply = g_dbus_connection_call_sync (bus,
+		                                     "org.freedesktop.Tracker3.Miner.Files",
+		                                     "/org/freedesktop/Tracker3/Files",
+		                                     "org.freedesktop.Tracker3.Files",
+		                                     "IndexFile",
+		                                     g_variant_new ("(s)", uri),
+		                                     NULL,
+		                                     G_DBUS_CALL_FLAGS_NONE,
+		                                     -1, NULL, &error);
+		if (!reply) {
+			g_dbus_error_strip_remote_error (error);
+			g_printerr (_("Could not index “%s”: %s"),
+			            filenames[i], error->message);
+			g_printerr ("\n");
+			g_clear_error (&error);
+			handled = FALSE;
+		}
+	}
+
+	return handled ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int
+index_estimate (void)
+{
+	g_autofree gchar *tracker_miner_fs_path = NULL;
+	gboolean handled = TRUE;
+	guint i;
+
+	if (inside_build_tree) {
+		/* Developer convienence - use uninstalled version if running from build tree */
+		tracker_miner_fs_path = g_build_filename (BUILDROOT, "src", "miners", "fs", "localsearch-3", NULL);
+	} else {
+		tracker_miner_fs_path = g_build_filename (LIBEXECDIR, "localsearch-3", NULL);
+	}
+
+	for (i = 0; filenames[i]; i++) {
+		char *argv[] = { tracker_miner_fs_path, "--estimate", filenames[i], NULL };
+		g_autoptr (GError) error = NULL;
+		gint status;
+
+		if (i > 0)
+			g_print ("\n");
+
+		if (!g_spawn_sync (NULL, argv, NULL, G_SPAWN_CHILD_INHERITS_STDIN,
+		                   NULL, NULL, NULL, NULL, &status, &error) ||
+		    !g_spawn_check_wait_status (status, &error)) {
+			g_printerr (_("Could not estimate “%s”: %s"),
+			            filenames[i], error->message);
+			g_printerr ("\n");
+			handled = FALSE;
+		}
+	}
+
+	return handled ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+typedef struct {
+	GMainLoop *loop;
+	GInputStream *stream;
+	GError *error;
+} BundleExport;
+
+static void
+bundle_serialized_cb (GObject      *object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+	BundleExport *export = user_data;
+
+	export->stream =
+		tracker_sparql_statement_serialize_finish (TRACKER_SPARQL_STATEMENT (object),
+		                                           res, &export->error);
+	g_main_loop_quit (export->loop);
+}
+
+static int
+index_export_bundle (void)
+{
+	g_autoptr (TrackerSparqlConnection) connection = NULL;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GFileOutputStream) ostream = NULL;
+	g_autoptr (GFile) file = NULL, bundle = NULL;
+	g_autofree gchar *uri = NULL, *root_urn = NULL, *header = NULL;
+	g_autoptr (GError) error = NULL;
+	BundleExport export = { 0, };
+
+	connection = tracker_sparql_connection_bus_new ("org.freedesktop.Tracker3.Miner.Files",
+	                                                NULL, NULL, &error);
+	if (!connection) {
+		g_printerr ("%s: %s\n",
+		            _("Could not establish a connection to Tracker"),
+		            error->message);
+		return EXIT_FAILURE;
+	}
+
+	file = g_file_new_for_commandline_arg (filenames[0]);
+	uri = g_file_get_uri (file);
+
+	stmt = tracker_sparql_connection_query_statement (connection, ROOT_QUERY,
+	                                                  NULL, &error);
+	if (stmt) {
+		tracker_sparql_statement_bind_string (stmt, "uri", uri);
+		cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	}
+
+	if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error))
+		root_urn = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+
+	if (!root_urn) {
+		g_printerr (_("Could not export “%s”: %s"), filenames[0],
+		            error ? error->message : _("Not an indexed location"));
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	g_clear_object (&stmt);
+	stmt = tracker_sparql_connection_query_statement (connection, BUNDLE_QUERY,
+	                                                  NULL, &error);
+	if (!stmt) {
+		g_printerr (_("Could not export “%s”: %s"), filenames[0],
+		            error->message);
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	export.loop = g_main_loop_new (NULL, FALSE);
+	tracker_sparql_statement_bind_string (stmt, "root", root_urn);
+	tracker_sparql_statement_serialize_async (stmt,
+	                                          TRACKER_SERIALIZE_FLAGS_NONE,
+	                                          TRACKER_RDF_FORMAT_TRIG,
+	                                          NULL,
+	                                          bundle_serialized_cb,
+	                                          &export);
+	g_main_loop_run (export.loop);
+	g_main_loop_unref (export.loop);
+
+	if (export.stream) {
+		bundle = g_file_new_for_commandline_arg (opt_export_bundle);
+		ostream = g_file_replace (bundle, NULL, FALSE,
+		                          G_FILE_CREATE_REPLACE_DESTINATION,
+		                          NULL, &export.error);
+	}
+
+	/* The importing miner needs the original locations to replace them */
+	header = g_strdup_printf (INDEX_BUNDLE_HEADER "\n"
+	                          "# root-uri %s\n"
+	                          "# root-urn %s\n",
+	                          uri, root_urn);
+
+	if (ostream &&
+	    g_output_stream_write_all (G_OUTPUT_STREAM (ostream),
+	                               header, strlen (header),
+	                               NULL, NULL, &export.error)) {
+		g_output_stream_splice (G_OUTPUT_STREAM (ostream), export.stream,
+		                        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+		                        G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+		                        NULL, &export.error);
+	}
+
+	g_clear_object (&export.stream);
+
+	if (export.error) {
+		g_printerr (_("Could not export “%s”: %s"), filenames[0],
+		            export.error->message);
+		g_printerr ("\n");
+		g_error_free (export.error);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int
+index_import_bundle (void)
+{
+	g_autoptr (GFile) file = NULL, bundle = NULL, dest = NULL;
+	g_autoptr (GFileInputStream) istream = NULL;
+	g_autoptr (GDataInputStream) data = NULL;
+	g_autofree gchar *uri = NULL, *checksum = NULL, *basename = NULL;
+	g_autofree gchar *dir = NULL, *path = NULL, *header = NULL;
+	g_autoptr (GError) error = NULL;
+
+	bundle = g_file_new_for_commandline_arg (opt_import_bundle);
+	istream = g_file_read (bundle, NULL, &error);
+
+	if (istream) {
+		data = g_data_input_stream_new (G_INPUT_STREAM (istream));
+		header = g_data_input_stream_read_line (data, NULL, NULL, &error);
+	}
+
+	if (error) {
+		g_printerr (_("Could not import “%s”: %s"), opt_import_bundle,
+		            error->message);
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	if (g_strcmp0 (header, INDEX_BUNDLE_HEADER) != 0) {
+		g_printerr (_("Could not import “%s”: %s"), opt_import_bundle,
+		            _("Not an index bundle"));
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	/* The miner picks the bundle from its cache when the location
+	 * is added to the indexed locations, and rewrites its URIs then.
+	 */
+	file = g_file_new_for_commandline_arg (filenames[0]);
+	uri = g_file_get_uri (file);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, uri, -1);
+	basename = g_strconcat (checksum, ".trig", NULL);
+
+	dir = g_build_filename (g_get_user_cache_dir (), "tracker3", "files", "bundles", NULL);
+	path = g_build_filename (dir, basename, NULL);
+	dest = g_file_new_for_path (path);
+
+	if (g_mkdir_with_parents (dir, 0700) < 0 ||
+	    !g_file_copy (bundle, dest, G_FILE_COPY_OVERWRITE,
+	                  NULL, NULL, NULL, &error)) {
+		g_printerr (_("Could not import “%s”: %s"), opt_import_bundle,
+		            error ? error->message : g_strerror (errno));
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int
+index_bundle (void)
+{
+	if (opt_add || opt_remove || opt_recursive || opt_now || opt_estimate ||
+	    (opt_export_bundle && opt_import_bundle)) {
+		/* TRANSLATORS: These are commandline options */
+		g_printerr ("%s\n", _("--export-bundle and --import-bundle can not be combined with other options"));
+		return EXIT_FAILURE;
+	}
+
+	if (g_strv_length (filenames) != 1) {
+		g_printerr ("%s\n", _("Please specify one indexed location."));
+		return EXIT_FAILURE;
+	}
+
+	if (opt_export_bundle)
+		return index_export_bundle ();
+
+	return index_import_bundle ();
+}
+
 static int
 index_run (void)
 {
+	if (opt_export_bundle || opt_import_bundle)
+		return index_bundle ();
+
+	if (opt_now) {
+		if (opt_add || opt_remove || opt_recursive) {
+			/* TRANSLATORS: These are commandline options */
+			g_printerr ("%s\n", _("--now can not be combined with other options"));
+			return EXIT_FAILURE;
+		}
+
+		return index_now ();
+	}
+
+	if (opt_estimate) {
+		if (opt_add || opt_remove || opt_recursive) {
+			/* TRANSLATORS: These are commandline options */
+			g_printerr ("%s\n", _("--estimate can not be combined with other options"));
+			return EXIT_FAILURE;
+		}
+
+		return index_estimate ();
+	}
+
 	if (!opt_add && !opt_remove) {
 		/* TRANSLATORS: These are commandline options */
 		g_printerr ("%s\n", _("Either --add or --remove must be provided"));
@@ -390,6 +733,8 @@ tracker_index (int          argc,
 	context = g_option_context_new (NULL);
 	g_option_context_add_main_entries (context, entries, NULL);
 
+	inside_build_tree = tracker_cli_check_inside_build_tree (argv[0]);
+
 	argv[0] = "tracker index";
 
 	if (!g_option_context_parse (context, &argc, (char***) &argv, &error)) {
@@ -57,6 +57,8 @@ static gboolean resource_is_iri;
 static gboolean turtle;
 static gboolean eligible;
 static gchar *url_property;
+static gboolean read_stdin;
+static gchar *files_from;
 
 static gboolean output_is_tty;
 
@@ -90,6 +92,14 @@ static GOptionEntry entries[] = {
 	{ "eligible", 'e', 0, G_OPTION_ARG_NONE, &eligible,
 	  N_("Checks if FILE is eligible for being mined based on configuration"),
 	  NULL },
+	{ "stdin", 0, 0, G_OPTION_ARG_NONE, &read_stdin,
+	  N_("Read FILEs from standard input, one per line"),
+	  NULL,
+	},
+	{ "files-from", 0, 0, G_OPTION_ARG_FILENAME, &files_from,
+	  N_("Read FILEs from LIST, one per line"),
+	  N_("LIST"),
+	},
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames,
 	  N_("FILE"),
 	  N_("FILE")},
@@ -404,13 +414,133 @@ print_errors (GList       *keyfiles,
 }
 
 
+/* Files are looked up in chunks, so the queries stay reasonably sized
+ * while still taking a single round trip for many files.
+ */
+#define LOOKUP_CHUNK_SIZE 500
+
+static gchar *
+get_uri_for_filename (const gchar *filename)
+{
+	g_autoptr (GFile) file = NULL;
+
+	/* support both, URIs and local file paths */
+	if (has_valid_uri_scheme (filename) || resource_is_iri)
+		return g_strdup (filename);
+
+	file = g_file_new_for_commandline_arg (filename);
+
+	return g_file_get_uri (file);
+}
+
+static gboolean
+resolve_url_property (TrackerSparqlConnection  *connection,
+                      GStrv                     uris,
+                      guint                     first,
+                      guint                     last,
+                      GError                  **error)
+{
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GHashTable) by_value = NULL;
+	g_autoptr (GString) values = NULL;
+	g_autofree gchar *query = NULL;
+	guint i;
+
+	by_value = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	values = g_string_new (NULL);
+
+	for (i = first; i < last; i++) {
+		g_autofree gchar *escaped = NULL;
+
+		escaped = tracker_sparql_escape_string (uris[i]);
+		g_string_append_printf (values, " \"%s\"", escaped);
+	}
+
+	/* First check whether there's some entity with nie:url like this */
+	query = g_strdup_printf ("SELECT ?value ?urn { VALUES ?value {%s } ?urn %s ?value }",
+	                         values->str, url_property);
+	cursor = tracker_sparql_connection_query (connection, query, NULL, error);
+	if (!cursor)
+		return FALSE;
+
+	while (tracker_sparql_cursor_next (cursor, NULL, error)) {
+		g_hash_table_insert (by_value,
+		                     g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)),
+		                     g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL)));
+	}
+
+	if (error && *error)
+		return FALSE;
+
+	for (i = first; i < last; i++) {
+		gchar *urn;
+
+		urn = g_hash_table_lookup (by_value, uris[i]);
+		if (urn) {
+			g_free (uris[i]);
+			uris[i] = g_strdup (urn);
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+lookup_urns (TrackerSparqlConnection  *connection,
+             GStrv                     uris,
+             guint                     first,
+             guint                     last,
+             GHashTable               *found,
+             GList                   **urns,
+             GError                  **error)
+{
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GString) values = NULL;
+	g_autofree gchar *query = NULL;
+	guint i;
+
+	values = g_string_new (NULL);
+
+	for (i = first; i < last; i++) {
+		g_autofree gchar *escaped = NULL;
+
+		escaped = tracker_sparql_escape_uri (uris[i]);
+		g_string_append_printf (values, " <%s>", escaped);
+	}
+
+	query = g_strdup_printf ("SELECT DISTINCT (STR (?uri) AS ?str) ?urn {"
+	                         "  VALUES ?uri {%s } "
+	                         "  {"
+	                         "    BIND (?uri AS ?urn) . "
+	                         "    ?urn a rdfs:Resource . "
+	                         "  } UNION {"
+	                         "    ?uri nie:interpretedAs ?urn ."
+	                         "  }"
+	                         "}",
+	                         values->str);
+
+	cursor = tracker_sparql_connection_query (connection, query, NULL, error);
+	if (!cursor)
+		return FALSE;
+
+	while (tracker_sparql_cursor_next (cursor, NULL, error)) {
+		g_hash_table_add (found, g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)));
+		*urns = g_list_prepend (*urns,
+		                        g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL)));
+	}
+
+	return !error || !*error;
+}
+
 static int
 info_run (void)
 {
 	TrackerSparqlConnection *connection;
 	GError *error = NULL;
 	GList *urns = NULL;
-	gchar **p;
+	g_auto (GStrv) uris = NULL;
+	g_autoptr (GHashTable) found = NULL;
+	guint i, len;
 
 	tracker_term_pipe_to_pager ();
 
@@ -424,108 +554,58 @@ info_run (void)
 		return EXIT_FAILURE;
 	}
 
-	for (p = filenames; *p; p++) {
-		g_autoptr (TrackerSparqlStatement) stmt = NULL;
-		g_autoptr (TrackerSparqlCursor) cursor = NULL;
-		gchar *uri = NULL;
-		gchar *query;
-		GList *keyfiles;
-		gboolean found = FALSE;
+	len = g_strv_length (filenames);
+	uris = g_new0 (gchar *, len + 1);
+	found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-		/* support both, URIs and local file paths */
-		if (has_valid_uri_scheme (*p)) {
-			uri = g_strdup (*p);
-		} else if (resource_is_iri) {
-			uri = g_strdup (*p);
-		} else {
-			GFile *file;
+	for (i = 0; i < len; i++)
+		uris[i] = get_uri_for_filename (filenames[i]);
+
+	for (i = 0; i < len; i += LOOKUP_CHUNK_SIZE) {
+		guint last = MIN (i + LOOKUP_CHUNK_SIZE, len);
 
-			file = g_file_new_for_commandline_arg (*p);
-			uri = g_file_get_uri (file);
-			g_object_unref (file);
+		if (url_property &&
+		    !resolve_url_property (connection, uris, i, last, &error)) {
+			g_printerr ("  %s, %s\n",
+			            _("Unable to retrieve URN for URI"),
+			            error->message);
+			g_clear_error (&error);
+			continue;
 		}
 
-		if (url_property) {
-			g_autoptr (TrackerSparqlStatement) stmt = NULL;
-			g_autoptr (TrackerSparqlCursor) cursor = NULL;
+		if (!lookup_urns (connection, uris, i, last, found, &urns, &error)) {
+			g_printerr ("  %s, %s\n",
+			            _("Unable to retrieve data for URI"),
+			            error->message);
+			g_clear_error (&error);
+		}
+	}
 
-			/* First check whether there's some entity with nie:url like this */
-			query = g_strdup_printf ("SELECT ?urn { ?urn %s ~value }", url_property);
-			stmt = tracker_sparql_connection_query_statement (connection, query,
-			                                                  NULL, &error);
-			g_free (query);
+	for (i = 0; i < len; i++) {
+		g_autofree gchar *escaped = NULL;
+		GList *keyfiles;
 
-			if (stmt) {
-				tracker_sparql_statement_bind_string (stmt, "prop", url_property);
-				tracker_sparql_statement_bind_string (stmt, "value", uri);
-				cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
-			}
+		escaped = tracker_sparql_escape_uri (uris[i]);
+		if (g_hash_table_contains (found, escaped))
+			continue;
 
-			if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error)) {
-				g_clear_pointer (&uri, g_free);
-				uri = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
-			}
+		if (turtle) {
+			g_print ("# No metadata available for <%s>\n", uris[i]);
+		} else {
+			g_print ("  %s\n",
+			         _("No metadata available for that URI"));
+			output_eligible_status_for_file (filenames[i], &error);
 
 			if (error) {
-				g_printerr ("  %s, %s\n",
-				            _("Unable to retrieve URN for URI"),
+				g_printerr ("%s: %s\n",
+				            _("Could not get eligible status: "),
 				            error->message);
 				g_clear_error (&error);
-				continue;
-			}
-		}
-
-		stmt = tracker_sparql_connection_query_statement (connection,
-		                                                  "SELECT DISTINCT ?urn {"
-		                                                  "  {"
-		                                                  "    BIND (~uri AS ?urn) . "
-		                                                  "    ?urn a rdfs:Resource . "
-		                                                  "  } UNION {"
-		                                                  "    ~uri nie:interpretedAs ?urn ."
-		                                                  "  }"
-		                                                  "}",
-		                                                  NULL, &error);
-		if (stmt) {
-			tracker_sparql_statement_bind_string (stmt, "uri", uri);
-			cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
-		}
-
-		if (cursor) {
-			while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-				const gchar *str;
-
-				str = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-				urns = g_list_prepend (urns, g_strdup (str));
-				found = TRUE;
 			}
-		}
 
-		if (error) {
-			g_printerr ("  %s, %s\n",
-			            _("Unable to retrieve data for URI"),
-			            error->message);
-			g_clear_error (&error);
-		}
-
-		if (!found) {
-			if (turtle) {
-				g_print ("# No metadata available for <%s>\n", uri);
-			} else {
-				g_print ("  %s\n",
-				         _("No metadata available for that URI"));
-				output_eligible_status_for_file (*p, &error);
-
-				if (error) {
-					g_printerr ("%s: %s\n",
-					            _("Could not get eligible status: "),
-					            error->message);
-					g_clear_error (&error);
-				}
-
-				keyfiles = tracker_cli_get_error_keyfiles ();
-				if (keyfiles)
-					print_errors (keyfiles, uri);
-			}
+			keyfiles = tracker_cli_get_error_keyfiles ();
+			if (keyfiles)
+				print_errors (keyfiles, uris[i]);
 		}
 	}
 
@@ -567,12 +647,67 @@ info_run (void)
 	return EXIT_SUCCESS;
 }
 
+/* Asks the indexer about all files at once, instead of spawning it
+ * in --eligible mode for each of them.
+ */
+static gboolean
+info_run_file_statuses (GError **error)
+{
+	g_autoptr (GDBusConnection) bus = NULL;
+	g_autoptr (GVariant) reply = NULL;
+	g_autofree const gchar **statuses = NULL;
+	g_auto (GStrv) uris = NULL;
+	guint i, len;
+
+	bus = g_bus_get_sync (TRACKER_IPC_BUS, NULL, error);
+	if (!bus)
+		return FALSE;
+
+	len = g_strv_length (filenames);
+	uris = g_new0 (gchar *, len + 1);
+
+	for (i = 0; i < len; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = g_file_new_for_commandline_arg (filenames[i]);
+		uris[i] = g_file_get_uri (file);
+	}
+
+	reply = g_dbus_connection_call_sync (bus,
+	                                     "org.freedesktop.Tracker3.Miner.Files",
+	                                     "/org/freedesktop/Tracker3/Files",
+	                                     "org.freedesktop.Tracker3.Files",
+	                                     "GetFileStatuses",
+	                                     g_variant_new ("(^as)", uris),
+	                                     G_VARIANT_TYPE ("(as)"),
+	                                     G_DBUS_CALL_FLAGS_NONE,
+	                                     -1, NULL, error);
+	if (!reply)
+		return FALSE;
+
+	g_variant_get (reply, "(^a&s)", &statuses);
+
+	for (i = 0; i < len && statuses[i]; i++)
+		g_print ("%s: %s\n", filenames[i], statuses[i]);
+
+	return TRUE;
+}
+
 static int
 info_run_eligible (void)
 {
 	char **p;
 	g_autoptr (GError) error = NULL;
 
+	if (read_stdin || files_from) {
+		if (info_run_file_statuses (&error))
+			return EXIT_SUCCESS;
+
+		g_debug ("Could not get file statuses, checking one by one: %s",
+		         error->message);
+		g_clear_error (&error);
+	}
+
 	for (p = filenames; *p; p++) {
 		output_eligible_status_for_file (*p, &error);
 
@@ -641,6 +776,15 @@ tracker_info (int          argc,
 
 	g_option_context_free (context);
 
+	if (read_stdin || files_from) {
+		if ((read_stdin && !tracker_cli_read_file_list (NULL, &filenames, &error)) ||
+		    (files_from && !tracker_cli_read_file_list (files_from, &filenames, &error))) {
+			g_printerr ("%s, %s\n", _("Could not read file list"), error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (info_options_enabled ()) {
 		if (eligible)
 			return info_run_eligible ();
@@ -1136,6 +1136,93 @@ tracker_miner_manager_is_active (TrackerMinerManager *manager,
 	return active;
 }
 
+static gboolean
+get_status_details (GDBusProxy  *proxy,
+                    gchar      **status,
+                    gdouble     *progress,
+                    gint        *remaining_time,
+                    GError     **error)
+{
+	const gchar *str;
+	GVariant *v;
+	gdouble p;
+	gint t;
+
+	v = g_dbus_proxy_call_sync (proxy,
+	                            "GetStatusDetails",
+	                            NULL,
+	                            G_DBUS_CALL_FLAGS_NONE,
+	                            -1,
+	                            NULL,
+	                            error);
+	if (!v)
+		return FALSE;
+
+	g_variant_get (v, "(&sdi)", &str, &p, &t);
+
+	if (status)
+		*status = g_strdup (str);
+	if (progress)
+		*progress = p;
+	if (remaining_time)
+		*remaining_time = t;
+
+	g_variant_unref (v);
+
+	return TRUE;
+}
+
+/**
+ * tracker_miner_manager_get_metrics:
+ * @manager: a #TrackerMinerManager
+ * @miner: miner reference
+ * @error: return location for errors
+ *
+ * Returns the latency histograms recorded by @miner, see
+ * tracker_metrics_snapshot_to_string() to format them.
+ *
+ * Returns: (transfer full) (nullable): a #GVariant of type
+ *   %TRACKER_METRICS_SNAPSHOT_TYPE, or %NULL on error
+ **/
+GVariant *
+tracker_miner_manager_get_metrics (TrackerMinerManager  *manager,
+                                   const gchar          *miner,
+                                   GError              **error)
+{
+	g_autoptr (GVariant) v = NULL;
+	GDBusProxy *proxy;
+
+	g_return_val_if_fail (TRACKER_IS_MINER_MANAGER (manager), NULL);
+	g_return_val_if_fail (miner != NULL, NULL);
+
+	proxy = find_miner_proxy (manager, miner, TRUE);
+
+	if (!proxy) {
+		g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN,
+		             "No D-Bus proxy found for miner '%s'", miner);
+		return NULL;
+	}
+
+	v = g_dbus_proxy_call_sync (proxy,
+	                            "GetMetrics",
+	                            NULL,
+	                            G_DBUS_CALL_FLAGS_NONE,
+	                            -1,
+	                            NULL,
+	                            error);
+	if (!v)
+		return NULL;
+
+	if (!g_variant_is_of_type (v, G_VARIANT_TYPE ("(a(stta(ut)))"))) {
+		g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_SIGNATURE,
+		             "Unexpected reply type '%s'",
+		             g_variant_get_type_string (v));
+		return NULL;
+	}
+
+	return g_variant_get_child_value (v, 0);
+}
+
 /**
  * tracker_miner_manager_get_status:
  * @manager: a #TrackerMinerManager
@@ -1161,6 +1248,7 @@ tracker_miner_manager_get_status (TrackerMinerManager  *manager,
                                   gint                 *remaining_time)
 {
 	GDBusProxy *proxy;
+	GError *details_error = NULL;
 
 	g_return_val_if_fail (TRACKER_IS_MINER_MANAGER (manager), FALSE);
 	g_return_val_if_fail (miner != NULL, FALSE);
@@ -1176,6 +1264,24 @@ tracker_miner_manager_get_status (TrackerMinerManager  *manager,
 		return FALSE;
 	}
 
+	/* Fetch everything at once, older miners only have the
+	 * separate calls below.
+	 */
+	if (get_status_details (proxy, status, progress, remaining_time, &details_error))
+		return TRUE;
+
+	if (!g_error_matches (details_error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD)) {
+		if (details_error->code != G_DBUS_ERROR_SERVICE_UNKNOWN) {
+			g_critical ("Could not get miner status for '%s': %s", miner,
+			            details_error->message);
+		}
+
+		g_error_free (details_error);
+		return FALSE;
+	}
+
+	g_error_free (details_error);
+
 	if (progress) {
 		GError *error = NULL;
 		GVariant *v;
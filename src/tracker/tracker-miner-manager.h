@@ -125,6 +125,9 @@ gboolean             tracker_miner_manager_get_status         (TrackerMinerManag
                                                                gchar               **status,
                                                                gdouble              *progress,
                                                                gint                 *remaining_time);
+GVariant *           tracker_miner_manager_get_metrics        (TrackerMinerManager  *manager,
+                                                               const gchar          *miner,
+                                                               GError              **error);
 const gchar *        tracker_miner_manager_get_display_name   (TrackerMinerManager  *manager,
                                                                const gchar          *miner);
 const gchar *        tracker_miner_manager_get_description    (TrackerMinerManager  *manager,
@@ -44,6 +44,60 @@ static gchar *filename = NULL;
 	 rss || \
 	 filename)
 
+/* Descendants are deleted in chunks of this many files, each in its
+ * own transaction, so the miner and other readers are not held off.
+ */
+#define DELETE_CHUNK_SIZE 5000
+
+#define DELETE_CHUNK_QUERY \
+	"DELETE { " \
+	"  GRAPH ?g { " \
+	"    ?f a rdfs:Resource . " \
+	"    ?ie a rdfs:Resource " \
+	"  } " \
+	"} WHERE { " \
+	"  { " \
+	"    SELECT ?f { " \
+	"      GRAPH tracker:FileSystem { " \
+	"        ?f nie:url ?url . " \
+	"        FILTER (STRSTARTS (?url, CONCAT (~uri, \"/\"))) " \
+	"      } " \
+	"    } " \
+	"    LIMIT ~limit " \
+	"  } " \
+	"  GRAPH ?g { " \
+	"    ?f a rdfs:Resource . " \
+	"    OPTIONAL { ?ie nie:isStoredAs ?f } " \
+	"  } " \
+	"}"
+
+#define CONTENT_LEFT_QUERY \
+	"SELECT ?f { " \
+	"  GRAPH tracker:FileSystem { " \
+	"    ?f nie:url ?url . " \
+	"    FILTER (STRSTARTS (?url, CONCAT (~uri, \"/\"))) " \
+	"  } " \
+	"} LIMIT 1"
+
+/* The file itself goes last, so running this again after being
+ * interrupted still finds it, and deletes what was left.
+ */
+#define DELETE_FILE_QUERY \
+	"DELETE { " \
+	"  GRAPH ?g { " \
+	"    ?f a rdfs:Resource . " \
+	"    ?ie a rdfs:Resource " \
+	"  } " \
+	"} WHERE { " \
+	"  GRAPH tracker:FileSystem { " \
+	"    ?f nie:url ~uri " \
+	"  } " \
+	"  GRAPH ?g { " \
+	"    ?f a rdfs:Resource . " \
+	"    OPTIONAL { ?ie nie:isStoredAs ?f } " \
+	"  } " \
+	"}"
+
 static GOptionEntry entries[] = {
 	{ "filesystem", 's', 0, G_OPTION_ARG_NONE, &files,
 	  N_("Remove filesystem indexer database"),
@@ -57,6 +111,61 @@ static GOptionEntry entries[] = {
 	{ NULL }
 };
 
+static gboolean
+delete_content_chunked (TrackerSparqlConnection  *connection,
+                        const gchar              *uri,
+                        GError                  **error)
+{
+	g_autoptr (TrackerSparqlStatement) delete_chunk = NULL, content_left = NULL;
+	g_autoptr (TrackerSparqlStatement) delete_file = NULL;
+	GError *inner_error = NULL;
+
+	delete_chunk = tracker_sparql_connection_update_statement (connection,
+	                                                           DELETE_CHUNK_QUERY,
+	                                                           NULL, error);
+	if (!delete_chunk)
+		return FALSE;
+
+	content_left = tracker_sparql_connection_query_statement (connection,
+	                                                          CONTENT_LEFT_QUERY,
+	                                                          NULL, error);
+	if (!content_left)
+		return FALSE;
+
+	delete_file = tracker_sparql_connection_update_statement (connection,
+	                                                          DELETE_FILE_QUERY,
+	                                                          NULL, error);
+	if (!delete_file)
+		return FALSE;
+
+	tracker_sparql_statement_bind_string (delete_chunk, "uri", uri);
+	tracker_sparql_statement_bind_int (delete_chunk, "limit", DELETE_CHUNK_SIZE);
+	tracker_sparql_statement_bind_string (content_left, "uri", uri);
+	tracker_sparql_statement_bind_string (delete_file, "uri", uri);
+
+	while (TRUE) {
+		g_autoptr (TrackerSparqlCursor) cursor = NULL;
+
+		cursor = tracker_sparql_statement_execute (content_left, NULL, error);
+		if (!cursor)
+			return FALSE;
+
+		if (!tracker_sparql_cursor_next (cursor, NULL, &inner_error)) {
+			if (inner_error) {
+				g_propagate_error (error, inner_error);
+				return FALSE;
+			}
+
+			break;
+		}
+
+		if (!tracker_sparql_statement_update (delete_chunk, NULL, error))
+			return FALSE;
+	}
+
+	return tracker_sparql_statement_update (delete_file, NULL, error);
+}
+
 static int
 delete_info_recursively (GFile *file)
 {
@@ -93,20 +202,9 @@ delete_info_recursively (GFile *file)
 
 	/* Now, delete the element recursively */
 	g_print ("%s\n", _("Deleting…"));
-	query = g_strdup_printf ("DELETE { "
-	                         "  ?f a rdfs:Resource . "
-	                         "  ?ie a rdfs:Resource "
-	                         "} WHERE {"
-	                         "  ?f nie:url ?url . "
-	                         "  ?ie nie:isStoredAs ?f . "
-	                         "  FILTER (?url = '%s' ||"
-	                         "          STRSTARTS (?url, '%s/'))"
-	                         "}", uri, uri);
+	delete_content_chunked (connection, uri, &error);
 	g_free (uri);
 
-	tracker_sparql_connection_update (connection, query, NULL, &error);
-	g_free (query);
-
 	if (error)
 		goto error;
 
@@ -44,6 +44,7 @@ static gboolean all;
 static gboolean disable_snippets;
 static gboolean disable_fts;
 static gboolean disable_color;
+static gboolean stream;
 static gboolean files;
 static gboolean folders;
 static gboolean music_albums;
@@ -154,6 +155,10 @@ static GOptionEntry entries[] = {
 	  N_("Disable color when printing snippets and results"),
 	  NULL,
 	},
+	{ "stream", 0, 0, G_OPTION_ARG_NONE, &stream,
+	  N_("Print results as they are found, most relevant first"),
+	  NULL,
+	},
 
 	/* Main arguments, the search terms */
 	{ G_OPTION_REMAINING, 0, 0,
@@ -1172,6 +1177,343 @@ get_folders (TrackerSparqlConnection *connection,
 	return success;
 }
 
+/* Snippets are only computed for the results being shown, broad
+ * search terms might otherwise spend most of the query time in
+ * fts:snippet() for rows that are discarded by OFFSET/LIMIT.
+ */
+#define SNIPPET_CHUNK_SIZE 8
+
+typedef struct {
+	gchar *uri;
+	gchar *mime_type;
+	gchar *class;
+	gchar *snippet;
+} SearchResult;
+
+typedef struct {
+	TrackerSparqlCursor *cursor;
+	GError *error;
+	gboolean done;
+} SnippetRequest;
+
+static const gchar *all_query =
+	"SELECT ?uri "
+	"WHERE {"
+	"  {"
+	"    SELECT (?s AS ?uri) {"
+	"      GRAPH tracker:FileSystem {"
+	"        ?s a nfo:FileDataObject ;"
+	"           fts:match ~match ;"
+	"           nie:dataSource ?ds ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available))"
+	"      }"
+	"    }"
+	"  } UNION {"
+	"    SELECT ?uri {"
+	"      GRAPH ?g {"
+	"        ?s a nie:InformationElement ;"
+	"           fts:match ~match ;"
+	"           nie:isStoredAs ?uri ."
+	"      }"
+	"      GRAPH tracker:FileSystem {"
+	"        ?uri nie:dataSource ?ds ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available))"
+	"      }"
+	"    }"
+	"  }"
+	"} "
+	"GROUP BY ?uri "
+	"ORDER BY ?uri "
+	"OFFSET ~offset "
+	"LIMIT ~limit";
+
+static const gchar *all_detailed_query =
+	"SELECT ?uri ?mimetype ?type "
+	"WHERE {"
+	"  {"
+	"    SELECT (?s AS ?uri) ?mimetype ?type {"
+	"      GRAPH tracker:FileSystem {"
+	"        ?s a nfo:FileDataObject ;"
+	"           fts:match ~match ;"
+	"           rdf:type ?type ;"
+	"           nie:dataSource ?ds ."
+	"         ?ie nie:isStoredAs ?s;"
+	"           nie:mimeType ?mimetype ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available)) ."
+	"      }"
+	"    }"
+	"  } UNION {"
+	"    SELECT ?uri ?mimetype ?type {"
+	"      GRAPH ?g {"
+	"        ?s a nie:InformationElement ;"
+	"           fts:match ~match ;"
+	"           rdf:type ?type ;"
+	"           nie:mimeType ?mimetype ;"
+	"           nie:isStoredAs ?uri ."
+	"      }"
+	"      GRAPH tracker:FileSystem {"
+	"        ?uri nie:dataSource ?ds ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available)) ."
+	"      }"
+	"    }"
+	"  }"
+	"} "
+	"GROUP BY ?uri "
+	"ORDER BY ?uri "
+	"OFFSET ~offset "
+	"LIMIT ~limit";
+
+/* Unlike the queries above, there is no GROUP BY here, so rows can be
+ * returned before all matches were looked at. The same file might be
+ * matched by its metadata and its contents, those are deduplicated as
+ * results are printed.
+ */
+static const gchar *stream_query =
+	"SELECT ?uri ?mimetype ?rank "
+	"WHERE {"
+	"  {"
+	"    SELECT (?s AS ?uri) ?mimetype (fts:rank(?s) AS ?rank) {"
+	"      GRAPH tracker:FileSystem {"
+	"        ?s a nfo:FileDataObject ;"
+	"           fts:match ~match ;"
+	"           nie:dataSource ?ds ."
+	"        OPTIONAL { ?ie nie:isStoredAs ?s ; nie:mimeType ?mimetype } ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available))"
+	"      }"
+	"    }"
+	"  } UNION {"
+	"    SELECT ?uri ?mimetype (fts:rank(?s) AS ?rank) {"
+	"      GRAPH ?g {"
+	"        ?s a nie:InformationElement ;"
+	"           fts:match ~match ;"
+	"           nie:mimeType ?mimetype ;"
+	"           nie:isStoredAs ?uri ."
+	"      }"
+	"      GRAPH tracker:FileSystem {"
+	"        ?uri nie:dataSource ?ds ."
+	"        OPTIONAL { ?ds tracker:available ?available } ."
+	"        FILTER (IF (~showAll, true, ?available))"
+	"      }"
+	"    }"
+	"  }"
+	"} "
+	"ORDER BY DESC (?rank) "
+	"OFFSET ~offset "
+	"LIMIT ~limit";
+
+static void
+search_result_free (SearchResult *result)
+{
+	g_free (result->uri);
+	g_free (result->mime_type);
+	g_free (result->class);
+	g_free (result->snippet);
+	g_slice_free (SearchResult, result);
+}
+
+static SearchResult *
+search_result_new (TrackerSparqlCursor *cursor,
+                   gboolean             details,
+                   gboolean             with_class)
+{
+	SearchResult *result;
+
+	result = g_slice_new0 (SearchResult);
+	result->uri = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+
+	if (details) {
+		const gchar *mime_type;
+
+		mime_type = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+		if (mime_type && *mime_type)
+			result->mime_type = g_strdup (mime_type);
+
+		if (with_class)
+			result->class = g_strdup (tracker_sparql_cursor_get_string (cursor, 2, NULL));
+	}
+
+	return result;
+}
+
+static gchar *
+get_fts_match (GStrv    search_words,
+               gboolean use_or_operator)
+{
+	if (disable_fts || !search_words)
+		return NULL;
+
+	/* Parameters need no SPARQL escaping */
+	return g_strjoinv (use_or_operator ? " OR " : " ", search_words);
+}
+
+static TrackerSparqlStatement *
+create_results_statement (TrackerSparqlConnection  *connection,
+                          const gchar              *query,
+                          const gchar              *match,
+                          gboolean                  show_all,
+                          gint                      search_offset,
+                          gint                      search_limit,
+                          GError                  **error)
+{
+	TrackerSparqlStatement *stmt;
+
+	stmt = tracker_sparql_connection_query_statement (connection, query,
+	                                                  NULL, error);
+	if (!stmt)
+		return NULL;
+
+	if (search_limit < 0)
+		search_limit = G_MAXINT;
+
+	tracker_sparql_statement_bind_string (stmt, "match", match);
+	tracker_sparql_statement_bind_boolean (stmt, "showAll", show_all);
+	tracker_sparql_statement_bind_int (stmt, "offset", search_offset);
+	tracker_sparql_statement_bind_int (stmt, "limit", search_limit);
+
+	return stmt;
+}
+
+static TrackerSparqlStatement *
+create_snippet_statement (TrackerSparqlConnection  *connection,
+                          GPtrArray                *results,
+                          guint                     first,
+                          const gchar              *match,
+                          GError                  **error)
+{
+	TrackerSparqlStatement *stmt;
+	g_autoptr (GString) values = NULL;
+	g_autofree gchar *query = NULL;
+	guint i;
+
+	/* VALUES takes no parameters, the URIs come from the store */
+	values = g_string_new (NULL);
+
+	for (i = first; i < results->len; i++) {
+		SearchResult *result = g_ptr_array_index (results, i);
+		g_autofree gchar *escaped = NULL;
+
+		escaped = tracker_sparql_escape_uri (result->uri);
+		g_string_append_printf (values, " <%s>", escaped);
+	}
+
+	query = g_strdup_printf ("SELECT ?uri ?snippet "
+	                         "WHERE {"
+	                         "  {"
+	                         "    SELECT (?s AS ?uri) (fts:snippet(?s, ~snippetBegin, ~snippetEnd) AS ?snippet) {"
+	                         "      VALUES ?s {%s }"
+	                         "      GRAPH tracker:FileSystem {"
+	                         "        ?s fts:match ~match ."
+	                         "      }"
+	                         "    }"
+	                         "  } UNION {"
+	                         "    SELECT ?uri (fts:snippet(?s, ~snippetBegin, ~snippetEnd) AS ?snippet) {"
+	                         "      VALUES ?uri {%s }"
+	                         "      GRAPH ?g {"
+	                         "        ?s fts:match ~match ;"
+	                         "           nie:isStoredAs ?uri ."
+	                         "      }"
+	                         "    }"
+	                         "  }"
+	                         "}",
+	                         values->str,
+	                         values->str);
+
+	stmt = tracker_sparql_connection_query_statement (connection, query,
+	                                                  NULL, error);
+	if (!stmt)
+		return NULL;
+
+	tracker_sparql_statement_bind_string (stmt, "match", match);
+	tracker_sparql_statement_bind_string (stmt, "snippetBegin",
+	                                      disable_color ? "" : SNIPPET_BEGIN);
+	tracker_sparql_statement_bind_string (stmt, "snippetEnd",
+	                                      disable_color ? "" : SNIPPET_END);
+
+	return stmt;
+}
+
+static gboolean
+add_snippets (TrackerSparqlCursor  *cursor,
+              GPtrArray            *results,
+              guint                 first,
+              GError              **error)
+{
+	g_autoptr (GHashTable) by_uri = NULL;
+	guint i;
+
+	by_uri = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (i = first; i < results->len; i++) {
+		SearchResult *result = g_ptr_array_index (results, i);
+
+		g_hash_table_insert (by_uri, result->uri, result);
+	}
+
+	while (tracker_sparql_cursor_next (cursor, NULL, error)) {
+		SearchResult *result;
+		const gchar *snippet;
+
+		result = g_hash_table_lookup (by_uri,
+		                              tracker_sparql_cursor_get_string (cursor, 0, NULL));
+		snippet = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+
+		/* Metadata and contents may both match, keep the first */
+		if (result && !result->snippet && snippet && *snippet)
+			result->snippet = g_strdup (snippet);
+	}
+
+	return !error || !*error;
+}
+
+static void
+snippets_cb (GObject      *object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+	SnippetRequest *request = user_data;
+
+	request->cursor =
+		tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+		                                         res,
+		                                         &request->error);
+	request->done = TRUE;
+}
+
+static void
+print_result (SearchResult *result,
+              gboolean      details)
+{
+	if (details && result->mime_type && result->class) {
+		g_print ("  %s%s%s\n"
+		         "    %s\n"
+		         "    %s\n",
+		         disable_color ? "" : TITLE_BEGIN,
+		         result->uri,
+		         disable_color ? "" : TITLE_END,
+		         result->mime_type,
+		         result->class);
+	} else if (details && (result->mime_type || result->class)) {
+		g_print ("  %s%s%s\n"
+		         "    %s\n",
+		         disable_color ? "" : TITLE_BEGIN,
+		         result->uri,
+		         disable_color ? "" : TITLE_END,
+		         result->mime_type ? result->mime_type : result->class);
+	} else {
+		g_print ("  %s%s%s\n",
+		         disable_color ? "" : TITLE_BEGIN,
+		         result->uri,
+		         disable_color ? "" : TITLE_END);
+	}
+
+	print_snippet (result->snippet);
+}
+
 static gboolean
 get_all_by_search (TrackerSparqlConnection *connection,
                    GStrv                    search_words,
@@ -1181,180 +1523,190 @@ get_all_by_search (TrackerSparqlConnection *connection,
                    gboolean                 use_or_operator,
                    gboolean                 details)
 {
-	GError *error = NULL;
-	TrackerSparqlCursor *cursor;
-	gchar *fts;
-	gchar *query;
-
-	fts = get_fts_string (search_words, use_or_operator);
-	if (!fts) {
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GPtrArray) results = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *match = NULL;
+	guint i;
+
+	match = get_fts_match (search_words, use_or_operator);
+	if (!match) {
 		return FALSE;
 	}
 
-	if (search_limit < 0)
-		search_limit = G_MAXINT;
-
-	if (details) {
-		query = g_strdup_printf ("SELECT ?uri ?mimetype ?type ?snippet "
-		                         "WHERE {"
-					 "  {"
-					 "    SELECT (?s AS ?uri) ?mimetype ?type (fts:snippet(?s, \"%s\", \"%s\") AS ?snippet) {"
-					 "      GRAPH tracker:FileSystem {"
-					 "        ?s a nfo:FileDataObject ;"
-					 "           fts:match \"%s\" ;"
-					 "           rdf:type ?type ;"
-					 "           nie:dataSource ?ds ."
-					 "         ?ie nie:isStoredAs ?s;"
-					 "           nie:mimeType ?mimetype ."
-					 "        OPTIONAL { ?ds tracker:available ?available } ."
-					 "        FILTER (IF (%s, true, ?available)) ."
-					 "      }"
-					 "    }"
-					 "  } UNION {"
-					 "    SELECT ?uri ?mimetype ?type (fts:snippet(?s, \"%s\", \"%s\") AS ?snippet) {"
-					 "      GRAPH ?g {"
-					 "        ?s a nie:InformationElement ;"
-					 "           fts:match \"%s\" ;"
-					 "           rdf:type ?type ;"
-					 "           nie:mimeType ?mimetype ;"
-					 "           nie:isStoredAs ?uri ."
-		                         "      }"
-		                         "      GRAPH tracker:FileSystem {"
-					 "        ?uri nie:dataSource ?ds ."
-					 "        OPTIONAL { ?ds tracker:available ?available } ."
-					 "        FILTER (IF (%s, true, ?available)) ."
-					 "      }"
-					 "    }"
-					 "  }"
-		                         "} "
-		                         "GROUP BY ?uri "
-		                         "ORDER BY ?uri "
-		                         "OFFSET %d "
-					 "LIMIT %d",
-		                         disable_color ? "" : SNIPPET_BEGIN,
-		                         disable_color ? "" : SNIPPET_END,
-		                         fts,
-		                         show_all ? "true" : "false",
-		                         disable_color ? "" : SNIPPET_BEGIN,
-		                         disable_color ? "" : SNIPPET_END,
-		                         fts,
-		                         show_all ? "true" : "false",
-		                         search_offset,
-		                         search_limit);
-	} else {
-		query = g_strdup_printf ("SELECT ?uri SAMPLE(?snippet) "
-		                         "WHERE {"
-					 "  {"
-					 "    SELECT (?s AS ?uri) (fts:snippet(?s, \"%s\", \"%s\") AS ?snippet) {"
-					 "      GRAPH tracker:FileSystem {"
-					 "        ?s a nfo:FileDataObject ;"
-					 "           fts:match \"%s\" ;"
-					 "           nie:dataSource ?ds ."
-					 "        OPTIONAL { ?ds tracker:available ?available } ."
-					 "        FILTER (IF (%s, true, ?available))"
-					 "      }"
-					 "    }"
-					 "  } UNION {"
-					 "    SELECT ?uri (fts:snippet(?s, \"%s\", \"%s\") AS ?snippet) {"
-					 "      GRAPH ?g {"
-					 "        ?s a nie:InformationElement ;"
-					 "           fts:match \"%s\" ;"
-					 "           nie:isStoredAs ?uri ."
-		                         "      }"
-		                         "      GRAPH tracker:FileSystem {"
-					 "        ?uri nie:dataSource ?ds ."
-					 "        OPTIONAL { ?ds tracker:available ?available } ."
-					 "        FILTER (IF (%s, true, ?available))"
-					 "      }"
-					 "    }"
-					 "  }"
-		                         "} "
-		                         "GROUP BY ?uri "
-		                         "ORDER BY ?uri "
-		                         "OFFSET %d "
-					 "LIMIT %d",
-		                         disable_color ? "" : SNIPPET_BEGIN,
-		                         disable_color ? "" : SNIPPET_END,
-		                         fts,
-		                         show_all ? "true" : "false",
-		                         disable_color ? "" : SNIPPET_BEGIN,
-		                         disable_color ? "" : SNIPPET_END,
-		                         fts,
-		                         show_all ? "true" : "false",
-		                         search_offset,
-		                         search_limit);
+	stmt = create_results_statement (connection,
+	                                 details ? all_detailed_query : all_query,
+	                                 match, show_all,
+	                                 search_offset, search_limit,
+	                                 &error);
+	if (stmt)
+		cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+
+	results = g_ptr_array_new_with_free_func ((GDestroyNotify) search_result_free);
+
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, &error))
+		g_ptr_array_add (results, search_result_new (cursor, details, details));
+
+	if (!error && !disable_snippets && results->len > 0) {
+		g_autoptr (TrackerSparqlStatement) snippet_stmt = NULL;
+		g_autoptr (TrackerSparqlCursor) snippet_cursor = NULL;
+
+		/* Only for the page of results that is shown */
+		snippet_stmt = create_snippet_statement (connection, results, 0,
+		                                         match, &error);
+		if (snippet_stmt)
+			snippet_cursor = tracker_sparql_statement_execute (snippet_stmt, NULL, &error);
+		if (snippet_cursor)
+			add_snippets (snippet_cursor, results, 0, &error);
 	}
 
-	g_free (fts);
-
-	cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
-	g_free (query);
-
 	if (error) {
 		g_printerr ("%s, %s\n",
 		            _("Could not get search results"),
 		            error->message);
-		g_error_free (error);
 
 		return FALSE;
 	}
 
-	if (!cursor) {
+	if (results->len == 0) {
 		g_print ("%s\n",
 		         _("No results were found matching your query"));
 	} else {
-		gint count = 0;
-
 		g_print ("%s:\n", _("Results"));
 
-		while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-			if (details) {
-				const gchar *urn;
-				const gchar *mime_type;
-				const gchar *class;
-
-				g_print ("cols:%d\n", tracker_sparql_cursor_get_n_columns (cursor));
-
-				urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-				mime_type = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-				class = tracker_sparql_cursor_get_string (cursor, 2, NULL);
-
-				if (mime_type && mime_type[0] == '\0') {
-					mime_type = NULL;
-				}
-
-				if (mime_type) {
-					g_print ("  %s%s%s\n"
-					         "    %s\n"
-					         "    %s\n",
-					         disable_color ? "" : TITLE_BEGIN,
-					         urn,
-					         disable_color ? "" : TITLE_END,
-					         mime_type,
-					         class);
-				} else {
-					g_print ("  %s%s%s\n"
-					         "    %s\n",
-					         disable_color ? "" : TITLE_BEGIN,
-					         urn,
-					         disable_color ? "" : TITLE_END,
-					         class);
-				}
-				print_snippet (tracker_sparql_cursor_get_string (cursor, 3, NULL));
-			} else {
-				g_print ("  %s%s%s\n",
-		                         disable_color ? "" : TITLE_BEGIN,
-				         tracker_sparql_cursor_get_string (cursor, 0, NULL),
-				         disable_color ? "" : TITLE_END);
-				print_snippet (tracker_sparql_cursor_get_string (cursor, 1, NULL));
+		for (i = 0; i < results->len; i++)
+			print_result (g_ptr_array_index (results, i), details);
+
+		g_print ("\n");
+	}
+
+	return TRUE;
+}
+
+static gboolean
+get_all_by_search_streamed (TrackerSparqlConnection *connection,
+                            GStrv                    search_words,
+                            gboolean                 show_all,
+                            gint                     search_offset,
+                            gint                     search_limit,
+                            gboolean                 use_or_operator,
+                            gboolean                 details)
+{
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (TrackerSparqlStatement) snippet_stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GPtrArray) results = NULL;
+	g_autoptr (GHashTable) seen = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *match = NULL;
+	SnippetRequest request = { 0, };
+	gboolean finished = FALSE;
+	guint printed = 0, pending = 0, ready;
+
+	match = get_fts_match (search_words, use_or_operator);
+	if (!match)
+		return FALSE;
+
+	stmt = create_results_statement (connection, stream_query,
+	                                 match, show_all,
+	                                 search_offset, search_limit,
+	                                 &error);
+	if (stmt)
+		cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	if (!cursor) {
+		g_printerr ("%s, %s\n",
+		            _("Could not get search results"),
+		            error->message);
+		return FALSE;
+	}
+
+	results = g_ptr_array_new_with_free_func ((GDestroyNotify) search_result_free);
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* Results are read in chunks, snippets for one chunk are generated
+	 * while the next one is read, and printed as soon as they are ready.
+	 */
+	while (!finished || printed < results->len) {
+		guint chunk_start = results->len;
+
+		while (!finished && results->len - chunk_start < SNIPPET_CHUNK_SIZE) {
+			SearchResult *result;
+
+			if (!tracker_sparql_cursor_next (cursor, NULL, &error)) {
+				finished = TRUE;
+				break;
 			}
 
-			count++;
+			result = search_result_new (cursor, details, FALSE);
+			if (!g_hash_table_add (seen, result->uri)) {
+				search_result_free (result);
+				continue;
+			}
+
+			g_ptr_array_add (results, result);
 		}
 
-		g_print ("\n");
+		if (error)
+			break;
 
-		g_object_unref (cursor);
+		/* Wait for the snippets of the previous chunk */
+		if (snippet_stmt) {
+			while (!request.done)
+				g_main_context_iteration (NULL, TRUE);
+
+			if (request.cursor) {
+				add_snippets (request.cursor, results, printed, &request.error);
+				g_clear_object (&request.cursor);
+			}
+
+			if (request.error) {
+				g_propagate_error (&error, request.error);
+				break;
+			}
+
+			g_clear_object (&snippet_stmt);
+		}
+
+		ready = disable_snippets ? results->len : pending;
+
+		for (; printed < ready; printed++) {
+			if (printed == 0)
+				g_print ("%s:\n", _("Results"));
+
+			print_result (g_ptr_array_index (results, printed), details);
+		}
+
+		/* Show each chunk as soon as it is available */
+		fflush (stdout);
+
+		if (chunk_start < results->len && !disable_snippets) {
+			snippet_stmt = create_snippet_statement (connection, results,
+			                                         chunk_start, match,
+			                                         &error);
+			if (!snippet_stmt)
+				break;
+
+			request = (SnippetRequest) { 0, };
+			tracker_sparql_statement_execute_async (snippet_stmt, NULL,
+			                                        snippets_cb, &request);
+		}
+
+		pending = results->len;
+	}
+
+	if (error) {
+		g_printerr ("%s, %s\n",
+		            _("Could not get search results"),
+		            error->message);
+		return FALSE;
+	}
+
+	if (results->len == 0) {
+		g_print ("%s\n",
+		         _("No results were found matching your query"));
+	} else {
+		g_print ("\n");
 	}
 
 	return TRUE;
@@ -1496,7 +1848,10 @@ search_run (void)
 	if (terms) {
 		gboolean success;
 
-		success = get_all_by_search (connection, terms, all, offset, limit, or_operator, detailed);
+		if (stream)
+			success = get_all_by_search_streamed (connection, terms, all, offset, limit, or_operator, detailed);
+		else
+			success = get_all_by_search (connection, terms, all, offset, limit, or_operator, detailed);
 		g_object_unref (connection);
 		tracker_term_pager_close ();
 
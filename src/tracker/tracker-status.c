@@ -264,15 +264,40 @@ get_file_and_folder_count (int *files,
 	return EXIT_SUCCESS;
 }
 
+static gboolean
+status_page_is_finished (const TrackerStatusPageData *data)
+{
+	/* Sections are cleared until first published */
+	return data->status[0] == '\0' || data->progress == 1.0;
+}
+
 static gboolean
 are_miners_finished (gint *max_remaining_time)
 {
+	TrackerStatusPageData data[TRACKER_STATUS_PAGE_N_SECTIONS];
 	TrackerMinerManager *manager;
 	GError *error = NULL;
 	GSList *miners_running;
 	GSList *l;
 	gboolean finished = TRUE;
 	gint _max_remaining_time = 0;
+	gint i;
+
+	/* Read the status the indexer publishes, if it is running */
+	if (tracker_cli_get_status_page (data)) {
+		for (i = 0; i < TRACKER_STATUS_PAGE_N_SECTIONS; i++) {
+			if (status_page_is_finished (&data[i]))
+				continue;
+
+			finished = FALSE;
+			_max_remaining_time = MAX (data[i].remaining_time, _max_remaining_time);
+		}
+
+		if (max_remaining_time)
+			*max_remaining_time = _max_remaining_time;
+
+		return finished;
+	}
 
 	/* Don't auto-start the miners here */
 	manager = tracker_miner_manager_new_full (FALSE, &error);
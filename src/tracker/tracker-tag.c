@@ -30,6 +30,8 @@
 
 #include <tinysparql.h>
 
+#include "tracker-cli-utils.h"
+
 #define TAG_OPTIONS_ENABLED() \
 	(resources || \
 	 add_tag || \
@@ -45,6 +47,8 @@ static gchar *remove_tag;
 static gchar *description;
 static gboolean *list;
 static gboolean show_resources;
+static gboolean read_stdin;
+static gchar *files_from;
 
 static GOptionEntry entries[] = {
 	{ "list", 't', 0, G_OPTION_ARG_NONE, &list,
@@ -79,6 +83,14 @@ static GOptionEntry entries[] = {
 	  N_("Use AND for search terms instead of OR (the default)"),
 	  NULL
 	},
+	{ "stdin", 0, 0, G_OPTION_ARG_NONE, &read_stdin,
+	  N_("Read FILEs from standard input, one per line"),
+	  NULL,
+	},
+	{ "files-from", 0, 0, G_OPTION_ARG_FILENAME, &files_from,
+	  N_("Read FILEs from LIST, one per line"),
+	  N_("LIST"),
+	},
 	{ G_OPTION_REMAINING, 0, 0,
 	  G_OPTION_ARG_FILENAME_ARRAY, &resources,
 	  N_("FILE…"),
@@ -140,54 +152,6 @@ get_escaped_sparql_string (const gchar *str)
 	return g_string_free (sparql, FALSE);
 }
 
-static gchar *
-get_filter_string (GStrv        resources,
-                   const gchar *subject,
-                   gboolean     resources_are_urns,
-                   const gchar *tag)
-{
-	GString *filter;
-	gint i, len;
-
-	if (!resources) {
-		return NULL;
-	}
-
-	len = g_strv_length (resources);
-
-	if (len < 1) {
-		return NULL;
-	}
-
-	filter = g_string_new ("");
-
-	g_string_append_printf (filter, "FILTER (");
-
-	if (tag) {
-		g_string_append (filter, "(");
-	}
-
-	for (i = 0; i < len; i++) {
-		g_string_append_printf (filter, "%s = %s%s%s",
-		                        subject,
-		                        resources_are_urns ? "<" : "\"",
-		                        resources[i],
-		                        resources_are_urns ? ">" : "\"");
-
-		if (i < len - 1) {
-			g_string_append (filter, " || ");
-		}
-	}
-
-	if (tag) {
-		g_string_append_printf (filter, ") && ?t = <%s>", tag);
-	}
-
-	g_string_append (filter, ")");
-
-	return g_string_free (filter, FALSE);
-}
-
 static GStrv
 get_uris (GStrv resources)
 {
@@ -217,40 +181,78 @@ get_uris (GStrv resources)
 	return uris;
 }
 
-static TrackerSparqlCursor *
-get_file_urns (TrackerSparqlConnection *connection,
-	       GStrv                    uris,
-	       const gchar             *tag)
+/* Resolves files in chunks, so the queries stay reasonably sized
+ * while still taking a single round trip for many files.
+ */
+#define LOOKUP_CHUNK_SIZE 500
+
+static gboolean
+lookup_files (TrackerSparqlConnection  *connection,
+              GStrv                     uris,
+              const gchar              *tag_escaped,
+              GHashTable               *indexed,
+              GHashTable               *tagged,
+              GError                  **error)
 {
-	TrackerSparqlCursor *cursor;
-	gchar *query, *filter;
-	GError *error = NULL;
+	guint i, len;
 
-	filter = get_filter_string (uris, "?f", FALSE, tag);
-	query = g_strdup_printf ("SELECT ?urn ?f "
-	                         "WHERE { "
-	                         "  ?urn "
-	                         "    %s "
-	                         "    nie:url ?f . "
-	                         "  %s "
-	                         "}",
-	                         tag ? "nao:hasTag ?t ; " : "",
-	                         filter ? filter : "");
+	len = g_strv_length (uris);
 
-	cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
+	for (i = 0; i < len; i += LOOKUP_CHUNK_SIZE) {
+		g_autoptr (TrackerSparqlCursor) cursor = NULL;
+		g_autoptr (GString) values = NULL;
+		g_autofree gchar *query = NULL;
+		guint j;
 
-	g_free (query);
-	g_free (filter);
+		values = g_string_new (NULL);
 
-	if (error) {
-		g_print ("    %s, %s\n",
-		         _("Could not get file URNs"),
-		         error->message);
-		g_error_free (error);
-		return NULL;
+		for (j = i; j < len && j < i + LOOKUP_CHUNK_SIZE; j++) {
+			g_autofree gchar *escaped = NULL;
+
+			escaped = get_escaped_sparql_string (uris[j]);
+			g_string_append_printf (values, " %s", escaped);
+		}
+
+		if (tag_escaped) {
+			query = g_strdup_printf ("SELECT ?f (BOUND (?t) AS ?tagged) "
+			                         "WHERE { "
+			                         "  VALUES ?f {%s } "
+			                         "  ?urn nie:url ?f . "
+			                         "  OPTIONAL { "
+			                         "    ?urn nao:hasTag ?t . "
+			                         "    ?t nao:prefLabel %s "
+			                         "  } "
+			                         "}",
+			                         values->str,
+			                         tag_escaped);
+		} else {
+			query = g_strdup_printf ("SELECT ?f "
+			                         "WHERE { "
+			                         "  VALUES ?f {%s } "
+			                         "  ?urn nie:url ?f . "
+			                         "}",
+			                         values->str);
+		}
+
+		cursor = tracker_sparql_connection_query (connection, query, NULL, error);
+		if (!cursor)
+			return FALSE;
+
+		while (tracker_sparql_cursor_next (cursor, NULL, error)) {
+			const gchar *uri;
+
+			uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+			g_hash_table_add (indexed, g_strdup (uri));
+
+			if (tagged && tracker_sparql_cursor_get_boolean (cursor, 1))
+				g_hash_table_add (tagged, g_strdup (uri));
+		}
+
+		if (error && *error)
+			return FALSE;
 	}
 
-	return cursor;
+	return TRUE;
 }
 
 static GStrv
@@ -577,33 +579,38 @@ get_all_tags (TrackerSparqlConnection *connection,
 }
 
 static void
-print_file_report (TrackerSparqlConnection *connection,
-                   GStrv                    uris,
-                   const gchar             *urn,
-                   const gchar             *found_msg,
-                   const gchar             *not_found_msg)
+print_file_report (GStrv        uris,
+                   GHashTable  *changed,
+                   const gchar *found_msg,
+                   const gchar *not_found_msg)
 {
 	gint i;
 
-	if (!uris) {
-		g_print ("  %s\n", _("No files were modified"));
-		return;
-	}
-
 	for (i = 0; uris[i]; i++) {
-		g_autoptr (TrackerSparqlCursor) cursor = NULL;
-		gboolean found = FALSE;
-		gchar *arr[2] = { uris[i], NULL };
-
-		cursor = get_file_urns (connection, arr, urn);
-		found = cursor && tracker_sparql_cursor_next (cursor, NULL, NULL);
 		g_print ("  %s: %s\n",
-		         found ? found_msg : not_found_msg,
+		         g_hash_table_contains (changed, uris[i]) ? found_msg : not_found_msg,
 		         uris[i]);
 	}
+}
 
+static void
+add_file_statements (TrackerBatch             *batch,
+                    TrackerSparqlStatement   *stmt,
+                    GStrv                     uris,
+                    GHashTable               *files,
+                    const gchar              *tag)
+{
+	gint i;
 
+	for (i = 0; uris[i]; i++) {
+		if (!g_hash_table_contains (files, uris[i]))
+			continue;
 
+		tracker_batch_add_statement (batch, stmt,
+		                             "url", G_TYPE_STRING, uris[i],
+		                             "label", G_TYPE_STRING, tag,
+		                             NULL);
+	}
 }
 
 static gboolean
@@ -612,13 +619,16 @@ add_tag_for_urns (TrackerSparqlConnection *connection,
                   const gchar             *tag,
                   const gchar             *description)
 {
-	g_autoptr (TrackerSparqlCursor) cursor = NULL;
-	GError *error = NULL;
-	GStrv  uris = NULL, urns_strv = NULL;
-	gchar *tag_escaped;
-	gchar *query;
+	g_autoptr (TrackerBatch) batch = NULL;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (GHashTable) indexed = NULL;
+	g_autoptr (GError) error = NULL;
+	g_auto (GStrv) uris = NULL;
+	g_autofree gchar *tag_escaped = NULL;
+	g_autofree gchar *query = NULL;
 
 	tag_escaped = get_escaped_sparql_string (tag);
+	indexed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	if (resources) {
 		uris = get_uris (resources);
@@ -627,25 +637,21 @@ add_tag_for_urns (TrackerSparqlConnection *connection,
 			return FALSE;
 		}
 
-		cursor = get_file_urns (connection, uris, NULL);
-
-		if (!cursor) {
-			g_printerr ("%s\n", _("Files do not exist or aren’t indexed"));
-			g_strfreev (uris);
+		if (!lookup_files (connection, uris, NULL, indexed, NULL, &error)) {
+			g_printerr ("    %s, %s\n",
+			            _("Could not get file URNs"),
+			            error->message);
 			return FALSE;
 		}
 
-		urns_strv = result_to_strv (cursor, 0);
-
-		if (!urns_strv || g_strv_length (urns_strv) < 1) {
+		if (g_hash_table_size (indexed) == 0) {
 			g_printerr ("%s\n", _("Files do not exist or aren’t indexed"));
-			g_strfreev (uris);
 			return FALSE;
 		}
 	}
 
 	if (description) {
-		gchar *description_escaped;
+		g_autofree gchar *description_escaped = NULL;
 
 		description_escaped = get_escaped_sparql_string (description);
 
@@ -660,8 +666,6 @@ add_tag_for_urns (TrackerSparqlConnection *connection,
 		                         tag_escaped,
 		                         description_escaped,
 		                         tag_escaped);
-
-		g_free (description_escaped);
 	} else {
 		query = g_strdup_printf ("INSERT { "
 		                         "  _:tag a nao:Tag;"
@@ -674,246 +678,247 @@ add_tag_for_urns (TrackerSparqlConnection *connection,
 		                         tag_escaped);
 	}
 
-	tracker_sparql_connection_update (connection, query, NULL, &error);
-	g_free (query);
+	/* The tag and all its files go in a single transaction */
+	batch = tracker_sparql_connection_create_batch (connection);
+	tracker_batch_add_sparql (batch, query);
+
+	if (uris) {
+		stmt = tracker_sparql_connection_update_statement (connection,
+		                                                   "INSERT { "
+		                                                   "  ?urn a rdfs:Resource ;"
+		                                                   "    nao:hasTag ?id "
+		                                                   "} "
+		                                                   "WHERE {"
+		                                                   "  ?urn nie:url ~url ."
+		                                                   "  ?id nao:prefLabel ~label "
+		                                                   "}",
+		                                                   NULL, &error);
+		if (!stmt) {
+			g_printerr ("%s, %s\n",
+			            _("Could not add tag to files"),
+			            error->message);
+			return FALSE;
+		}
 
-	if (error) {
+		add_file_statements (batch, stmt, uris, indexed, tag);
+	}
+
+	if (!tracker_batch_execute (batch, NULL, &error)) {
 		g_printerr ("%s, %s\n",
-		            _("Could not add tag"),
+		            uris ? _("Could not add tag to files") : _("Could not add tag"),
 		            error->message);
-
-		g_error_free (error);
-		g_free (tag_escaped);
-		g_strfreev (urns_strv);
-		g_strfreev (uris);
-
 		return FALSE;
 	}
 
 	g_print ("%s\n",
 	         _("Tag was added successfully"));
 
-	/* First we check if the tag is already set and only add if it
-	 * is, then we add the urns specified to the new tag.
-	 */
-	if (urns_strv) {
-		gchar *filter;
-
-		filter = get_filter_string (urns_strv, "?urn", TRUE, NULL);
-
-		/* Add tag to specific urns */
-		query = g_strdup_printf ("INSERT { "
-		                         "  ?urn a rdfs:Resource ;"
-		                         "    nao:hasTag ?id "
-		                         "} "
-		                         "WHERE {"
-		                         "  ?urn nie:url ?f ."
-		                         "  ?id nao:prefLabel %s "
-		                         "  %s "
-		                         "}",
-		                         tag_escaped,
-		                         filter ? filter : "");
-
-		tracker_sparql_connection_update (connection, query, NULL, &error);
-		g_strfreev (urns_strv);
-		g_free (filter);
-		g_free (query);
-
-		if (error) {
-			g_printerr ("%s, %s\n",
-			            _("Could not add tag to files"),
-			            error->message);
-			g_object_unref (cursor);
-			g_error_free (error);
-			g_free (tag_escaped);
-			g_strfreev (uris);
-
-			return FALSE;
-		}
-
-		print_file_report (connection,
-		                   uris, NULL, _("Tagged"),
+	if (uris) {
+		print_file_report (uris, indexed, _("Tagged"),
 		                   _("Not tagged, file is not indexed"));
 	}
 
-	g_strfreev (uris);
-	g_free (tag_escaped);
-
 	return TRUE;
 }
 
 static gboolean
-remove_tag_for_urns (TrackerSparqlConnection *connection,
-                     GStrv                    resources,
-                     const gchar             *tag)
+remove_tag_from_files (TrackerSparqlConnection *connection,
+                       GStrv                    uris,
+                       const gchar             *tag,
+                       const gchar             *tag_escaped)
 {
-	GError *error = NULL;
-	gchar *tag_escaped;
-	gchar *query;
-	g_autofree gchar *urn = NULL;
-	GStrv uris;
-
-	tag_escaped = get_escaped_sparql_string (tag);
-	uris = get_uris (resources);
-
-	if (uris && *uris) {
-		TrackerSparqlCursor *urns_cursor;
-		TrackerSparqlCursor *tag_cursor;
-		gchar *filter;
-		GStrv urns_strv;
-
-		/* Get all tags urns */
-		query = g_strdup_printf ("SELECT ?tag "
-		                         "WHERE {"
-		                         "  ?tag a nao:Tag ."
-		                         "  ?tag nao:prefLabel %s "
-		                         "}",
-		                         tag_escaped);
+	g_autoptr (TrackerBatch) batch = NULL;
+	g_autoptr (TrackerSparqlStatement) stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) tag_cursor = NULL;
+	g_autoptr (GHashTable) indexed = NULL;
+	g_autoptr (GHashTable) tagged = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *query = NULL;
+
+	/* Get all tags urns */
+	query = g_strdup_printf ("SELECT ?tag "
+	                         "WHERE {"
+	                         "  ?tag a nao:Tag ."
+	                         "  ?tag nao:prefLabel %s "
+	                         "}",
+	                         tag_escaped);
 
-		tag_cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
-		g_free (query);
+	tag_cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
 
-		if (error) {
-			g_printerr ("%s, %s\n",
-			            _("Could not get tag by label"),
-			            error->message);
-			g_error_free (error);
-			g_free (tag_escaped);
-			g_strfreev (uris);
-
-			return FALSE;
-		}
+	if (error) {
+		g_printerr ("%s, %s\n",
+		            _("Could not get tag by label"),
+		            error->message);
+		return FALSE;
+	}
 
-		if (!tag_cursor || !tracker_sparql_cursor_next (tag_cursor, NULL, NULL)) {
-			g_print ("%s\n",
-			         _("No tags were found by that name"));
+	if (!tag_cursor || !tracker_sparql_cursor_next (tag_cursor, NULL, NULL)) {
+		g_print ("%s\n",
+		         _("No tags were found by that name"));
+		return TRUE;
+	}
 
-			g_free (tag_escaped);
-			g_strfreev (uris);
+	indexed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	tagged = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-			if (tag_cursor) {
-				g_object_unref (tag_cursor);
-			}
+	if (!lookup_files (connection, uris, tag_escaped, indexed, tagged, &error)) {
+		g_printerr ("    %s, %s\n",
+		            _("Could not get file URNs"),
+		            error->message);
+		return FALSE;
+	}
 
-			return TRUE;
-		}
+	if (g_hash_table_size (tagged) == 0) {
+		g_print ("%s\n",
+		         _("None of the files had this tag set"));
+		return TRUE;
+	}
 
-		urn = g_strdup (tracker_sparql_cursor_get_string (tag_cursor, 0, NULL));
-		urns_cursor = get_file_urns (connection, uris, urn);
-		urns_strv = result_to_strv (urns_cursor, 0);
+	stmt = tracker_sparql_connection_update_statement (connection,
+	                                                   "DELETE { "
+	                                                   "  ?urn nao:hasTag ?t "
+	                                                   "} "
+	                                                   "WHERE { "
+	                                                   "  ?urn nie:url ~url ;"
+	                                                   "    nao:hasTag ?t . "
+	                                                   "  ?t nao:prefLabel ~label "
+	                                                   "}",
+	                                                   NULL, &error);
+	if (stmt) {
+		batch = tracker_sparql_connection_create_batch (connection);
+		add_file_statements (batch, stmt, uris, tagged, tag);
+		tracker_batch_execute (batch, NULL, &error);
+	}
 
-		if (!urns_strv || !*urns_strv) {
-			g_print ("%s\n",
-			         _("None of the files had this tag set"));
+	if (error) {
+		g_printerr ("%s, %s\n",
+		            _("Could not remove tag"),
+		            error->message);
+		return FALSE;
+	}
 
-			g_strfreev (uris);
-			g_free (tag_escaped);
-			g_object_unref (tag_cursor);
+	g_print ("%s\n", _("Tag was removed successfully"));
 
-			if (urns_cursor) {
-				g_object_unref (urns_cursor);
-			}
+	print_file_report (uris, tagged,
+	                   _("Untagged"),
+	                   _("File not indexed or already untagged"));
 
-			return TRUE;
-		}
+	return TRUE;
+}
 
-		filter = get_filter_string (urns_strv, "?urn", TRUE, urn);
-		g_strfreev (urns_strv);
+static gboolean
+remove_tag_for_urns (TrackerSparqlConnection *connection,
+                     GStrv                    resources,
+                     const gchar             *tag)
+{
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *tag_escaped = NULL;
+	g_autofree gchar *query = NULL;
+	g_auto (GStrv) uris = NULL;
 
-		query = g_strdup_printf ("DELETE { "
-		                         "  ?urn nao:hasTag ?t "
-		                         "} "
-		                         "WHERE { "
-		                         "  ?urn nao:hasTag ?t . "
-		                         "  %s "
-		                         "}",
-		                         filter ? filter : "");
-		g_free (filter);
+	tag_escaped = get_escaped_sparql_string (tag);
+	uris = get_uris (resources);
 
-		g_object_unref (tag_cursor);
-	} else {
-		/* Remove tag completely */
-		query = g_strdup_printf ("DELETE { "
-		                         "  ?tag a rdfs:Resource . "
-		                         "  ?r nao:hasTag ?tag . "
-		                         "} "
-		                         "WHERE {"
-		                         "  ?tag nao:prefLabel %s . "
-		                         "  OPTIONAL { ?r nao:hasTag ?tag } . "
-		                         "}",
-		                         tag_escaped);
-	}
+	if (uris && *uris)
+		return remove_tag_from_files (connection, uris, tag, tag_escaped);
 
-	g_free (tag_escaped);
+	/* Remove tag completely */
+	query = g_strdup_printf ("DELETE { "
+	                         "  ?tag a rdfs:Resource . "
+	                         "  ?r nao:hasTag ?tag . "
+	                         "} "
+	                         "WHERE {"
+	                         "  ?tag nao:prefLabel %s . "
+	                         "  OPTIONAL { ?r nao:hasTag ?tag } . "
+	                         "}",
+	                         tag_escaped);
 
 	tracker_sparql_connection_update (connection, query, NULL, &error);
-	g_free (query);
 
 	if (error) {
 		g_printerr ("%s, %s\n",
 		            _("Could not remove tag"),
 		            error->message);
-		g_error_free (error);
-		g_strfreev (uris);
-
 		return FALSE;
 	}
 
 	g_print ("%s\n", _("Tag was removed successfully"));
 
-	if (uris && *uris) {
-		print_file_report (connection, uris, urn,
-		                   _("Untagged"),
-		                   _("File not indexed or already untagged"));
-	}
-
-	g_strfreev (uris);
-
 	return TRUE;
 }
 
 static gboolean
-get_tags_by_file (TrackerSparqlConnection *connection,
-                  const gchar             *uri)
+get_tags_by_files (TrackerSparqlConnection *connection,
+                   GStrv                    uris)
 {
-	TrackerSparqlCursor *cursor;
-	GError *error = NULL;
-	gchar *query;
+	g_autoptr (GHashTable) labels = NULL;
+	g_autoptr (GError) error = NULL;
+	guint i, len;
 
-	query = g_strdup_printf ("SELECT ?tags ?labels "
-	                         "WHERE {"
-	                         "  ?urn nao:hasTag ?tags ;"
-	                         "  nie:url <%s> ."
-	                         "  ?tags a nao:Tag ;"
-	                         "  nao:prefLabel ?labels "
-	                         "} "
-	                         "ORDER BY ASC(?labels)",
-	                         uri);
+	labels = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                (GDestroyNotify) g_ptr_array_unref);
+	len = g_strv_length (uris);
 
-	cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
-	g_free (query);
+	for (i = 0; i < len; i += LOOKUP_CHUNK_SIZE) {
+		g_autoptr (TrackerSparqlCursor) cursor = NULL;
+		g_autoptr (GString) values = NULL;
+		g_autofree gchar *query = NULL;
+		guint j;
 
-	if (error) {
-		g_printerr ("%s, %s\n",
-		            _("Could not get all tags"),
-		            error->message);
-		g_error_free (error);
+		values = g_string_new (NULL);
 
-		return FALSE;
-	}
+		for (j = i; j < len && j < i + LOOKUP_CHUNK_SIZE; j++) {
+			g_autofree gchar *escaped = NULL;
 
-	if (!cursor) {
-		g_print ("  %s\n",
-		         _("No tags were found"));
-	} else {
-		gint count = 0;
+			escaped = get_escaped_sparql_string (uris[j]);
+			g_string_append_printf (values, " %s", escaped);
+		}
 
-		while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-			g_print ("  %s\n", tracker_sparql_cursor_get_string (cursor, 1, NULL));
-			count++;
+		query = g_strdup_printf ("SELECT ?f ?labels "
+		                         "WHERE {"
+		                         "  VALUES ?f {%s }"
+		                         "  ?urn nao:hasTag ?tags ;"
+		                         "  nie:url ?f ."
+		                         "  ?tags a nao:Tag ;"
+		                         "  nao:prefLabel ?labels "
+		                         "} "
+		                         "ORDER BY ASC(?labels)",
+		                         values->str);
+
+		cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
+
+		while (cursor && tracker_sparql_cursor_next (cursor, NULL, &error)) {
+			const gchar *uri;
+			GPtrArray *file_labels;
+
+			uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+			file_labels = g_hash_table_lookup (labels, uri);
+
+			if (!file_labels) {
+				file_labels = g_ptr_array_new_with_free_func (g_free);
+				g_hash_table_insert (labels, g_strdup (uri), file_labels);
+			}
+
+			g_ptr_array_add (file_labels,
+			                 g_strdup (tracker_sparql_cursor_get_string (cursor, 1, NULL)));
 		}
 
-		if (count == 0) {
+		if (error) {
+			g_printerr ("%s, %s\n",
+			            _("Could not get all tags"),
+			            error->message);
+			return FALSE;
+		}
+	}
+
+	for (i = 0; i < len; i++) {
+		GPtrArray *file_labels;
+		guint j;
+
+		g_print ("%s\n", uris[i]);
+		file_labels = g_hash_table_lookup (labels, uris[i]);
+
+		if (!file_labels) {
 			/* To translators: This is to say there are no
 			 * tags found for a particular file, e.g.:
 			 *
@@ -924,9 +929,10 @@ get_tags_by_file (TrackerSparqlConnection *connection,
 			g_print ("  %s\n", _("None"));
 		}
 
-		g_print ("\n");
+		for (j = 0; file_labels && j < file_labels->len; j++)
+			g_print ("  %s\n", (gchar *) g_ptr_array_index (file_labels, j));
 
-		g_object_unref (cursor);
+		g_print ("\n");
 	}
 
 	return TRUE;
@@ -981,23 +987,11 @@ tag_run (void)
 	}
 
 	if (resources) {
-		gboolean success = TRUE;
-		gchar **p;
-
-		for (p = resources; *p; p++) {
-			GFile *file;
-			gchar *uri;
-			
-			file = g_file_new_for_commandline_arg (*p);
-			uri = g_file_get_uri (file);
-			g_object_unref (file);
-
-			g_print ("%s\n", uri);
-			success &= get_tags_by_file (connection, uri);
-
-			g_free (uri);
-		}
+		g_auto (GStrv) uris = NULL;
+		gboolean success;
 
+		uris = get_uris (resources);
+		success = get_tags_by_files (connection, uris);
 		g_object_unref (connection);
 
 		return success ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -1061,6 +1055,15 @@ tracker_tag (int          argc,
 
 	g_option_context_free (context);
 
+	if (read_stdin || files_from) {
+		if ((read_stdin && !tracker_cli_read_file_list (NULL, &resources, &error)) ||
+		    (files_from && !tracker_cli_read_file_list (files_from, &resources, &error))) {
+			g_printerr ("%s, %s\n", _("Could not read file list"), error->message);
+			g_error_free (error);
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (!list && show_resources) {
 		failed = _("The --list option is required for --show-files");
 	} else if (and_operator && (!list || !resources)) {
@@ -0,0 +1,266 @@
+# Copyright (C) 2026, The Tracker developers
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA  02110-1301, USA.
+
+"""
+Replay a trace recorded with `localsearch-3 --record-trace=FILE`.
+
+The events queued before the miner first went idle describe the tree
+that was crawled, that tree is created before the miner starts. The
+events after it are replayed as filesystem operations, at the original
+pace or faster, and the time until each change is visible in the store
+is reported.
+
+    LOCALSEARCH_REPLAY_TRACE=trace.txt LOCALSEARCH_REPLAY_SPEED=10 \\
+        meson test -C build --benchmark replay-trace
+"""
+
+import gi
+
+gi.require_version("Tsparql", "3.0")
+from gi.repository import GLib
+
+import logging
+import os
+import pathlib
+import shutil
+import time
+
+import configuration as cfg
+import fixtures
+import trackertestutils.mainloop
+
+
+log = logging.getLogger(__name__)
+
+TRACE_HEADER = "# localsearch-trace 1"
+PLACEHOLDER_TEXT = "Replayed content\n"
+
+# Time to wait for changes to become visible after the last operation
+SETTLE_TIMEOUT = 30
+
+
+class TraceEvent:
+    def __init__(self, line):
+        fields = line.rstrip("\n").split("\t")
+        self.time = int(fields[0]) / 1000000.0
+        self.event = fields[1]
+        self.is_dir = fields[2] == "d"
+        self.path = None if fields[3] == "-" else fields[3]
+        self.dest_path = None if fields[4] == "-" else fields[4]
+
+
+def read_trace(path):
+    """Returns the crawled events and the ones queued after the crawl."""
+    crawled = []
+    replayed = []
+    events = crawled
+
+    with open(path) as f:
+        if f.readline().rstrip("\n") != TRACE_HEADER:
+            raise RuntimeError(f"{path} is not a localsearch trace")
+
+        for line in f:
+            if line.startswith("# "):
+                if line.rstrip("\n").endswith("\tidle"):
+                    events = replayed
+                continue
+
+            events.append(TraceEvent(line))
+
+    return crawled, replayed
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    idx = min(int(len(values) * fraction), len(values) - 1)
+    return values[idx]
+
+
+class TraceReplayTest(fixtures.TrackerMinerTest):
+    def setUp(self):
+        trace = os.environ.get("LOCALSEARCH_REPLAY_TRACE")
+        if not trace:
+            self.skipTest("LOCALSEARCH_REPLAY_TRACE is not set")
+
+        self.speed = float(os.environ.get("LOCALSEARCH_REPLAY_SPEED", "1"))
+        self.crawled, self.replayed = read_trace(trace)
+
+        # The crawled tree must exist before the miner starts
+        os.makedirs(self.indexed_dir, exist_ok=True)
+        for event in self.crawled:
+            if event.event in ["created", "updated"] and event.path:
+                self.ensure_exists(event.path, event.is_dir)
+
+        self.crawl_start = time.monotonic()
+
+        try:
+            fixtures.TrackerMinerTest.setUp(self)
+        except Exception:
+            cfg.remove_monitored_test_dir(self.workdir)
+            raise
+
+    def trace_path(self, path):
+        return pathlib.Path(self.indexed_dir, path)
+
+    def trace_uri(self, path):
+        return self.trace_path(path).as_uri()
+
+    def ensure_exists(self, path, is_dir):
+        file = self.trace_path(path)
+        if is_dir:
+            file.mkdir(parents=True, exist_ok=True)
+        elif not file.exists():
+            file.parent.mkdir(parents=True, exist_ok=True)
+            file.write_text(PLACEHOLDER_TEXT)
+
+    def remove(self, path):
+        file = self.trace_path(path)
+        if file.is_dir():
+            shutil.rmtree(file)
+        elif file.exists():
+            file.unlink()
+
+    def apply(self, event):
+        """Performs the operation, returns the URI that should change."""
+        if event.event == "created":
+            self.ensure_exists(event.path, event.is_dir)
+            return self.trace_uri(event.path)
+        elif event.event == "updated":
+            if event.is_dir:
+                self.ensure_exists(event.path, True)
+            else:
+                self.trace_path(event.path).parent.mkdir(parents=True, exist_ok=True)
+                with open(self.trace_path(event.path), "a") as f:
+                    f.write(PLACEHOLDER_TEXT)
+            return self.trace_uri(event.path)
+        elif event.event == "attributes":
+            self.ensure_exists(event.path, event.is_dir)
+            os.utime(self.trace_path(event.path))
+            return self.trace_uri(event.path)
+        elif event.event == "deleted":
+            self.remove(event.path)
+            return self.trace_uri(event.path)
+        elif event.event == "moved":
+            if event.path and event.dest_path:
+                self.ensure_exists(event.path, event.is_dir)
+                self.remove(event.dest_path)
+                self.trace_path(event.dest_path).parent.mkdir(parents=True, exist_ok=True)
+                os.rename(self.trace_path(event.path), self.trace_path(event.dest_path))
+                return self.trace_uri(event.dest_path)
+            elif event.dest_path:
+                self.ensure_exists(event.dest_path, event.is_dir)
+                return self.trace_uri(event.dest_path)
+            elif event.path:
+                self.remove(event.path)
+                return self.trace_uri(event.path)
+
+        return None
+
+    def await_crawl(self):
+        """Waits until the crawled tree is in the store."""
+        loop = trackertestutils.mainloop.MainLoop()
+        wakeups = self.miner_fs.wakeup_count()
+
+        if wakeups == 0:
+            def timeout_cb():
+                loop.quit()
+                return GLib.SOURCE_CONTINUE
+
+            while self.miner_fs.wakeup_count() == wakeups:
+                timeout_id = GLib.timeout_add(100, timeout_cb)
+                loop.run_checked()
+                GLib.source_remove(timeout_id)
+
+        return time.monotonic() - self.crawl_start
+
+    def test_replay(self):
+        loop = trackertestutils.mainloop.MainLoop()
+        conn = self.miner_fs.get_sparql_connection()
+        notifier = conn.create_notifier()
+        pending = {}
+        latencies = []
+        state = {"idx": 0, "last_change": time.monotonic()}
+
+        crawl_time = self.await_crawl()
+
+        def events_cb(notifier, service, graph, events):
+            now = time.monotonic()
+            for event in events:
+                op_time = pending.pop(event.get_urn(), None)
+                if op_time is not None:
+                    latencies.append(now - op_time)
+                    state["last_change"] = now
+
+            if state["idx"] >= len(self.replayed) and not pending:
+                loop.quit()
+
+        def replay_cb():
+            start = state["start"]
+            while state["idx"] < len(self.replayed):
+                event = self.replayed[state["idx"]]
+                due = start + (event.time - self.replayed[0].time) / self.speed
+                now = time.monotonic()
+
+                if due > now:
+                    GLib.timeout_add(int((due - now) * 1000) + 1, replay_cb)
+                    return GLib.SOURCE_REMOVE
+
+                uri = self.apply(event)
+                if uri:
+                    # Later operations on the same file supersede it
+                    pending.setdefault(uri, time.monotonic())
+                state["idx"] += 1
+
+            state["last_change"] = time.monotonic()
+            if not pending:
+                loop.quit()
+            return GLib.SOURCE_REMOVE
+
+        def settle_cb():
+            if (state["idx"] >= len(self.replayed) and
+                    time.monotonic() - state["last_change"] > SETTLE_TIMEOUT):
+                loop.quit()
+            return GLib.SOURCE_CONTINUE
+
+        signal_id = notifier.connect("events", events_cb)
+        settle_id = GLib.timeout_add_seconds(1, settle_cb)
+        state["start"] = time.monotonic()
+
+        if self.replayed:
+            GLib.idle_add(replay_cb)
+            loop.run_checked()
+
+        replay_time = time.monotonic() - state["start"]
+        GLib.source_remove(settle_id)
+        notifier.disconnect(signal_id)
+
+        latencies.sort()
+        print(f"Crawled {len(self.crawled)} events in {crawl_time:.3f} s")
+        print(f"Replayed {len(self.replayed)} events at {self.speed}x "
+              f"in {replay_time:.3f} s")
+        print(f"Changes observed:   {len(latencies)}")
+        print(f"Changes not seen:   {len(pending)}")
+        print("Freshness latency:  p50 {:.3f} s, p90 {:.3f} s, p99 {:.3f} s, max {:.3f} s".format(
+            percentile(latencies, 0.5),
+            percentile(latencies, 0.9),
+            percentile(latencies, 0.99),
+            percentile(latencies, 1.0)))
+
+
+if __name__ == "__main__":
+    fixtures.tracker_test_main()
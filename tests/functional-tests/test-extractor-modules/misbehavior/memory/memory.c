@@ -0,0 +1,36 @@
+#include <string.h>
+#include <unistd.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+#define CHUNK_SIZE (1024 * 1024)
+#define N_CHUNKS 1024
+
+G_MODULE_EXPORT gboolean
+tracker_extract_get_metadata (TrackerExtractInfo  *info,
+                              GError             **error)
+{
+	TrackerResource *resource;
+	GPtrArray *chunks;
+	guint i;
+
+	/* Grow the resident size well past the memory quota */
+	chunks = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < N_CHUNKS; i++) {
+		gpointer chunk = g_malloc (CHUNK_SIZE);
+
+		memset (chunk, 1, CHUNK_SIZE);
+		g_ptr_array_add (chunks, chunk);
+		g_usleep (1000);
+	}
+
+	sleep (60);
+	g_ptr_array_unref (chunks);
+
+	/* If we got here, the extractor memory quota was not made effective */
+	resource = tracker_resource_new ("fail://");
+	tracker_resource_add_uri (resource, "rdf:type", "rdfs:Resource");
+	tracker_extract_info_set_resource (info, resource);
+	return TRUE;
+}
@@ -0,0 +1,21 @@
+#include <libtracker-extract/tracker-extract.h>
+
+G_MODULE_EXPORT gboolean
+tracker_extract_get_metadata (TrackerExtractInfo  *info,
+                              GError             **error)
+{
+	TrackerResource *resource;
+	GTimer *timer;
+
+	/* Busy loop, so the task runs out of CPU time */
+	timer = g_timer_new ();
+	while (g_timer_elapsed (timer, NULL) < 60)
+		;
+	g_timer_destroy (timer);
+
+	/* If we got here, the extractor CPU quota was not made effective */
+	resource = tracker_resource_new ("fail://");
+	tracker_resource_add_uri (resource, "rdf:type", "rdfs:Resource");
+	tracker_extract_info_set_resource (info, resource);
+	return TRUE;
+}
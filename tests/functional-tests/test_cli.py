@@ -139,6 +139,36 @@ class TrackerTagOutputParser:
 
 
 class TestCliSearch(fixtures.TrackerCommandLineTestCase):
+    def test_cli_file_statuses(self):
+        """Check the status of many files at once."""
+        datadir = pathlib.Path(__file__).parent.joinpath("data/content")
+        indexed = pathlib.Path(self.indexed_dir, "Document 1.txt")
+        with self.await_document_inserted(indexed):
+            shutil.copy(datadir.joinpath("text", "Document 1.txt"), self.indexed_dir)
+
+        outside = pathlib.Path(self.workdir, "outside.txt")
+        file_list = pathlib.Path(self.workdir, "file-list")
+        file_list.write_text("%s\n%s\n" % (indexed, outside))
+
+        output = self.run_cli(
+            ["localsearch", "info", "--eligible", "--files-from", file_list]
+        )
+        assert "%s: indexed" % indexed in output
+        assert "%s: outside" % outside in output
+
+    def test_cli_index_now(self):
+        """Index a file right away and check its metadata is available."""
+        datadir = pathlib.Path(__file__).parent.joinpath("data/content")
+        target = pathlib.Path(self.indexed_dir, "Document 2.txt")
+        shutil.copy(datadir.joinpath("text", "Document 2.txt"), target)
+
+        self.run_cli(["localsearch", "index", "--now", target])
+
+        assert self.tracker.ask(
+            "ASK { ?f nie:isStoredAs <%s> ; nie:plainTextContent ?content }"
+            % target.as_uri()
+        )
+
     def test_cli_tags(self):
         """Basic "smoke test" that we can create and delete tags."""
         datadir = pathlib.Path(__file__).parent.joinpath("data/content")
@@ -210,6 +240,52 @@ class TestCliSearch(fixtures.TrackerCommandLineTestCase):
         output = self.run_cli(["localsearch", "tag", "--list"])
         parser.assert_tag_list_empty(output)
 
+    def test_cli_tags_files_from(self):
+        """Tag and untag files listed in a file."""
+        datadir = pathlib.Path(__file__).parent.joinpath("data/content")
+        targets = []
+        for name in ["Document 1.txt", "Document 2.txt"]:
+            target = pathlib.Path(self.indexed_dir, name)
+            with self.await_document_inserted(target):
+                shutil.copy(datadir.joinpath("text", name), self.indexed_dir)
+            targets.append(target)
+
+        # A file that is not indexed is reported, but doesn't fail
+        missing = pathlib.Path(self.workdir, "not-indexed.txt")
+        file_list = pathlib.Path(self.workdir, "file-list")
+        file_list.write_text("\n".join(str(t) for t in targets + [missing]) + "\n")
+
+        parser = TrackerTagOutputParser()
+
+        output = self.run_cli(
+            [
+                "localsearch",
+                "tag",
+                "--files-from",
+                file_list,
+                "--add=test_tag_2",
+                "--description=Tagged in bulk",
+            ]
+        )
+        assert "Not tagged, file is not indexed: %s" % missing.as_uri() in output
+
+        output = self.run_cli(["localsearch", "tag", "--list", "--show-files"])
+        tag_infos = parser.parse_tag_list_with_files(output)
+        assert len(tag_infos) == 1
+        assert tag_infos[0].file_count == 2
+        assert sorted(tag_infos[0].files) == sorted(t.as_uri() for t in targets)
+
+        output = self.run_cli(
+            ["localsearch", "tag", "--files-from", file_list, "--delete=test_tag_2"]
+        )
+        for target in targets:
+            assert "Untagged: %s" % target.as_uri() in output
+
+        output = self.run_cli(["localsearch", "tag", "--list"])
+        tag_infos = parser.parse_tag_list(output)
+        assert len(tag_infos) == 1
+        assert tag_infos[0].file_count == 0
+
 
 if __name__ == "__main__":
     fixtures.tracker_test_main()
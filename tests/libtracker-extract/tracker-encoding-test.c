@@ -50,6 +50,23 @@ test_encoding_guessing ()
 	g_free (output);
 }
 
+static void
+test_encoding_guessing_unicode (void)
+{
+	gchar *output;
+	gdouble confidence = 0;
+
+	/* Plain ASCII tells nothing about the encoding */
+	output = tracker_encoding_guess ("Plain ASCII text", 16, &confidence);
+	g_assert_null (output);
+
+	/* Valid UTF-8 is taken as is, without running any detector */
+	output = tracker_encoding_guess ("Gr\xC3\xBC\xC3\x9F Gott", 11, &confidence);
+	g_assert_cmpstr (output, ==, "UTF-8");
+	g_assert_cmpfloat (confidence, ==, 1);
+	g_free (output);
+}
+
 static void
 test_encoding_can_guess (void)
 {
@@ -69,6 +86,8 @@ main (int argc, char **argv)
 	setlocale (LC_ALL, "");
 	g_test_add_func ("/libtracker-extract/tracker-encoding/encoding_guessing",
 	                 test_encoding_guessing);
+	g_test_add_func ("/libtracker-extract/tracker-encoding/encoding_guessing_unicode",
+	                 test_encoding_guessing_unicode);
 	g_test_add_func ("/libtracker-extract/tracker-encoding/can_guess",
 	                 test_encoding_can_guess);
 
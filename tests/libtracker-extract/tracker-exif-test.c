@@ -17,21 +17,18 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include "config-miners.h"
+
+#include <string.h>
+
 #include <glib-object.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
 static void
-test_exif_parse (void)
+check_exif_data (TrackerExifData *exif)
 {
-        TrackerExifData *exif;
-        gchar *blob;
-        gsize  length;
-
-
-        g_assert_true (g_file_get_contents (TOP_SRCDIR "/tests/libtracker-extract/exif-img.jpg", &blob, &length, NULL));
-
-        exif = tracker_exif_new ((guchar *)blob, length, "test://file");
+        g_assert_nonnull (exif);
 
         /* Ignored on purpose on the code (?) */
         //g_assert_cmpstr (exif->x_dimension, ==, );
@@ -64,7 +61,41 @@ test_exif_parse (void)
         g_assert_cmpstr (exif->gps_latitude, ==, "-42.5"); // -exif:gpslatitude="42 30 0.00" -exif:gpslatituderef=S
         g_assert_cmpstr (exif->gps_longitude, ==, "-10.166674613952637"); // -exif:gpslongitude="10 10 0.03" -exif:gpslongituderef=W
         g_assert_cmpstr (exif->gps_direction, ==, "12.300000000000001"); // -n -Exif:GPSImgDirection=12.3
-        
+}
+
+static void
+test_exif_parse (void)
+{
+        TrackerExifData *exif;
+        gchar *blob;
+        gsize  length;
+
+
+        g_assert_true (g_file_get_contents (TOP_SRCDIR "/tests/libtracker-extract/exif-img.jpg", &blob, &length, NULL));
+
+        exif = tracker_exif_new ((guchar *)blob, length, "test://file");
+        check_exif_data (exif);
+
+        tracker_exif_free (exif);
+        g_free (blob);
+}
+
+static void
+test_exif_parse_app1 (void)
+{
+        TrackerExifData *exif;
+        gchar *blob, *app1;
+        gsize  length;
+
+        g_assert_true (g_file_get_contents (TOP_SRCDIR "/tests/libtracker-extract/exif-img.jpg", &blob, &length, NULL));
+
+        /* The APP1 segment payload, as handed by the JPEG extractor */
+        app1 = memmem (blob, length, "Exif\0\0", 6);
+        g_assert_nonnull (app1);
+
+        exif = tracker_exif_new ((guchar *) app1, length - (app1 - blob), "test://file");
+        check_exif_data (exif);
+
         tracker_exif_free (exif);
         g_free (blob);
 }
@@ -84,6 +115,34 @@ test_exif_parse_empty (void)
         g_free (blob);
 }
 
+static void
+test_exif_parse_tiff_raw (void)
+{
+        TrackerExifData *exif;
+        gchar *blob;
+        gsize  length;
+
+        g_assert_true (g_file_get_contents (TOP_SRCDIR "/tests/functional-tests/data/extractor-content/images/raw-cr2.cr2", &blob, &length, NULL));
+
+        exif = tracker_exif_new_from_tiff ((guchar *) blob, length, "test://file");
+        g_assert_nonnull (exif);
+
+        g_assert_cmpstr (exif->x_dimension, ==, "5472");
+        g_assert_cmpstr (exif->y_dimension, ==, "3648");
+        g_assert_cmpstr (exif->make, ==, "Canon");
+        g_assert_cmpstr (exif->model, ==, "Canon EOS 70D");
+        g_assert_cmpstr (exif->orientation, ==, "nfo:orientation-left");
+        g_assert_cmpstr (exif->fnumber, ==, "4.0");
+        g_assert_cmpstr (exif->focal_length, ==, "18.0");
+        g_assert_cmpstr (exif->iso_speed_ratings, ==, "1250");
+        g_assert_cmpstr (exif->metering_mode, ==, "nmm:metering-mode-pattern");
+        g_assert_cmpstr (exif->white_balance, ==, "nmm:white-balance-auto");
+        g_assert_cmpstr (exif->flash, ==, "nmm:flash-off");
+
+        tracker_exif_free (exif);
+        g_free (blob);
+}
+
 int
 main (int argc, char **argv) 
 {
@@ -91,8 +150,12 @@ main (int argc, char **argv)
 
         g_test_add_func ("/libtracker-extract/exif/parse",
                          test_exif_parse);
+        g_test_add_func ("/libtracker-extract/exif/parse_app1",
+                         test_exif_parse_app1);
         g_test_add_func ("/libtracker-extract/exif/parse_empty",
                          test_exif_parse_empty);
+        g_test_add_func ("/libtracker-extract/exif/parse_tiff_raw",
+                         test_exif_parse_tiff_raw);
 
         return g_test_run ();
 }
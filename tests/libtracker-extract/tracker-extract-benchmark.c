@@ -0,0 +1,472 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Extractor benchmarks: runs the extract module matching each file of
+ * a corpus directory over it a number of times, and reports the
+ * latency distribution, allocations and bytes read per module.
+ *
+ *   tracker-extract-benchmark --iterations=10 --json CORPUS-DIR
+ *
+ * TRACKER_EXTRACTORS_DIR and TRACKER_EXTRACTOR_RULES_DIR may point to
+ * the modules and rules of a build tree.
+ */
+
+#include "config-miners.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-miners-common/tracker-common.h>
+#include <libtracker-extract/tracker-extract.h>
+
+#define MAX_TEXT 1048576
+
+typedef struct {
+	gchar *name;
+	GArray *latencies;
+	guint n_failures;
+	guint64 n_allocations;
+	guint64 allocated_bytes;
+	guint64 read_bytes;
+} ModuleStats;
+
+static gint iterations = 5;
+static gboolean json = FALSE;
+static gchar *mimetype = NULL;
+static gchar **ignored = NULL;
+static gchar **corpus = NULL;
+
+static GOptionEntry entries[] = {
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of times each file is extracted", "N" },
+	{ "mimetype", 't', 0, G_OPTION_ARG_STRING, &mimetype,
+	  "Use this MIME type instead of guessing it for each file", "MIME" },
+	{ "ignore", 'i', 0, G_OPTION_ARG_STRING_ARRAY, &ignored,
+	  "Skip files matching this pattern", "PATTERN" },
+	{ "json", 'j', 0, G_OPTION_ARG_NONE, &json,
+	  "Print the results as JSON", NULL },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &corpus,
+	  "Corpus directory", "DIR" },
+	{ NULL }
+};
+
+#ifdef __GLIBC__
+/* Count heap allocations made from any thread by wrapping the glibc
+ * allocator, GLib and the extract modules all go through it.
+ */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static gsize n_allocations = 0;
+static gsize allocated_bytes = 0;
+
+static inline void
+count_allocation (size_t size)
+{
+	g_atomic_pointer_add (&n_allocations, 1);
+	g_atomic_pointer_add (&allocated_bytes, size);
+}
+
+void *
+malloc (size_t size)
+{
+	count_allocation (size);
+	return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb,
+        size_t size)
+{
+	count_allocation (nmemb * size);
+	return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+	count_allocation (size);
+	return __libc_realloc (ptr, size);
+}
+
+#define HAVE_ALLOCATION_COUNTS 1
+#endif
+
+static void
+get_allocations (guint64 *n_allocs,
+                 guint64 *n_bytes)
+{
+#ifdef HAVE_ALLOCATION_COUNTS
+	*n_allocs = (gsize) g_atomic_pointer_get (&n_allocations);
+	*n_bytes = (gsize) g_atomic_pointer_get (&allocated_bytes);
+#else
+	*n_allocs = *n_bytes = 0;
+#endif
+}
+
+static guint64 read_overhead = 0;
+
+/* Bytes passed through read() and friends, mmap()ed files are not
+ * accounted for. Reading /proc/self/io adds to it too, that is
+ * measured once as read_overhead.
+ */
+static guint64
+get_read_bytes (void)
+{
+	g_autofree gchar *contents = NULL;
+	const gchar *rchar;
+
+	if (!g_file_get_contents ("/proc/self/io", &contents, NULL, NULL))
+		return 0;
+
+	rchar = strstr (contents, "rchar: ");
+	if (!rchar)
+		return 0;
+
+	return g_ascii_strtoull (rchar + strlen ("rchar: "), NULL, 10);
+}
+
+static gboolean
+is_ignored (const gchar *basename)
+{
+	guint i;
+
+	for (i = 0; ignored && ignored[i]; i++) {
+		if (g_pattern_match_simple (ignored[i], basename))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+collect_files (GFile     *dir,
+               GPtrArray *files)
+{
+	g_autoptr (GFileEnumerator) enumerator = NULL;
+	g_autoptr (GError) error = NULL;
+	GFileInfo *info;
+	GFile *child;
+
+	enumerator = g_file_enumerate_children (dir,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME ","
+	                                        G_FILE_ATTRIBUTE_STANDARD_TYPE,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, &error);
+	if (!enumerator) {
+		g_printerr ("Could not enumerate %s: %s\n",
+		            g_file_peek_path (dir), error->message);
+		return;
+	}
+
+	while (g_file_enumerator_iterate (enumerator, &info, &child, NULL, &error) && info) {
+		if (is_ignored (g_file_info_get_name (info)))
+			continue;
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+			collect_files (child, files);
+		else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
+			g_ptr_array_add (files, g_object_ref (child));
+	}
+
+	if (error) {
+		g_printerr ("Could not enumerate %s: %s\n",
+		            g_file_peek_path (dir), error->message);
+	}
+}
+
+static gchar *
+get_mimetype (GFile *file)
+{
+	g_autoptr (GFileInfo) info = NULL;
+
+	if (mimetype)
+		return g_strdup (mimetype);
+
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL, NULL);
+	if (!info || !g_file_info_get_content_type (info))
+		return NULL;
+
+	return g_content_type_get_mime_type (g_file_info_get_content_type (info));
+}
+
+static ModuleStats *
+module_stats_lookup (GHashTable *stats,
+                     GModule    *module)
+{
+	ModuleStats *module_stats;
+	const gchar *name;
+
+	name = strrchr (g_module_name (module), G_DIR_SEPARATOR);
+	name = name ? name + 1 : g_module_name (module);
+
+	module_stats = g_hash_table_lookup (stats, name);
+	if (!module_stats) {
+		module_stats = g_new0 (ModuleStats, 1);
+		module_stats->name = g_strdup (name);
+		module_stats->latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+		g_hash_table_insert (stats, module_stats->name, module_stats);
+	}
+
+	return module_stats;
+}
+
+static void
+module_stats_free (ModuleStats *module_stats)
+{
+	g_array_unref (module_stats->latencies);
+	g_free (module_stats->name);
+	g_free (module_stats);
+}
+
+static void
+run_file (GHashTable *stats,
+          GFile      *file)
+{
+	g_autofree gchar *mime = NULL;
+	TrackerExtractMetadataFunc func;
+	ModuleStats *module_stats;
+	GModule *module;
+	gint i;
+
+	mime = get_mimetype (file);
+	if (!mime)
+		return;
+
+	module = tracker_extract_module_manager_get_module (mime, NULL, &func);
+	if (!module || !func)
+		return;
+
+	module_stats = module_stats_lookup (stats, module);
+
+	for (i = 0; i < iterations; i++) {
+		g_autoptr (GError) error = NULL;
+		guint64 allocs_start, allocs_end, bytes_start, bytes_end;
+		guint64 read_start, read_end;
+		TrackerExtractInfo *info;
+		gint64 start, elapsed;
+		gboolean success;
+
+		info = tracker_extract_info_new (file, "_:content", mime,
+		                                 tracker_extract_module_manager_get_graph (mime),
+		                                 MAX_TEXT);
+
+		read_start = get_read_bytes ();
+		get_allocations (&allocs_start, &bytes_start);
+		start = g_get_monotonic_time ();
+
+		success = func (info, &error);
+
+		elapsed = g_get_monotonic_time () - start;
+		get_allocations (&allocs_end, &bytes_end);
+		read_end = get_read_bytes ();
+
+		tracker_extract_info_unref (info);
+
+		if (!success) {
+			if (i == 0) {
+				g_printerr ("Could not extract %s: %s\n",
+				            g_file_peek_path (file),
+				            error ? error->message : "No error given");
+			}
+
+			module_stats->n_failures++;
+			continue;
+		}
+
+		g_array_append_val (module_stats->latencies, elapsed);
+		module_stats->n_allocations += allocs_end - allocs_start;
+		module_stats->allocated_bytes += bytes_end - bytes_start;
+		module_stats->read_bytes += read_end - read_start - MIN (read_end - read_start, read_overhead);
+	}
+}
+
+static gint
+compare_latency (gconstpointer a,
+                 gconstpointer b)
+{
+	gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+	return (la > lb) - (la < lb);
+}
+
+static gint64
+get_percentile (GArray  *sorted,
+                gdouble  percentile)
+{
+	guint idx;
+
+	if (sorted->len == 0)
+		return 0;
+
+	idx = MIN ((guint) (sorted->len * percentile), sorted->len - 1);
+
+	return g_array_index (sorted, gint64, idx);
+}
+
+static gint
+compare_stats (gconstpointer a,
+               gconstpointer b)
+{
+	const ModuleStats *sa = *(ModuleStats * const *) a;
+	const ModuleStats *sb = *(ModuleStats * const *) b;
+
+	return g_strcmp0 (sa->name, sb->name);
+}
+
+static void
+print_results (GHashTable *stats)
+{
+	g_autoptr (GPtrArray) modules = NULL;
+	g_autoptr (GString) str = NULL;
+	GHashTableIter iter;
+	ModuleStats *module_stats;
+	guint i;
+
+	modules = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, stats);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &module_stats))
+		g_ptr_array_add (modules, module_stats);
+	g_ptr_array_sort (modules, compare_stats);
+
+	str = g_string_new (NULL);
+
+	if (json) {
+		g_string_append_printf (str, "{\"iterations\": %d, \"modules\": [", iterations);
+	} else {
+		g_string_append_printf (str, "%-28s %6s %5s %9s %9s %9s %9s %10s %12s %12s\n",
+		                        "module", "runs", "fail", "p50 us", "p90 us", "p99 us", "max us",
+		                        "allocs", "alloc bytes", "read bytes");
+	}
+
+	for (i = 0; i < modules->len; i++) {
+		GArray *latencies;
+		guint64 n_runs;
+
+		module_stats = g_ptr_array_index (modules, i);
+		latencies = module_stats->latencies;
+		g_array_sort (latencies, compare_latency);
+		n_runs = MAX (latencies->len, 1);
+
+		/* Allocations and reads are averaged per run */
+		if (json) {
+			g_string_append_printf (str,
+			                        "%s{\"module\": \"%s\", \"runs\": %u, \"failures\": %u, "
+			                        "\"p50_usec\": %" G_GINT64_FORMAT ", "
+			                        "\"p90_usec\": %" G_GINT64_FORMAT ", "
+			                        "\"p99_usec\": %" G_GINT64_FORMAT ", "
+			                        "\"max_usec\": %" G_GINT64_FORMAT ", "
+			                        "\"allocations\": %" G_GUINT64_FORMAT ", "
+			                        "\"allocated_bytes\": %" G_GUINT64_FORMAT ", "
+			                        "\"read_bytes\": %" G_GUINT64_FORMAT "}",
+			                        i > 0 ? ", " : "",
+			                        module_stats->name,
+			                        latencies->len,
+			                        module_stats->n_failures,
+			                        get_percentile (latencies, 0.50),
+			                        get_percentile (latencies, 0.90),
+			                        get_percentile (latencies, 0.99),
+			                        get_percentile (latencies, 1.0),
+			                        module_stats->n_allocations / n_runs,
+			                        module_stats->allocated_bytes / n_runs,
+			                        module_stats->read_bytes / n_runs);
+		} else {
+			g_string_append_printf (str,
+			                        "%-28s %6u %5u %9" G_GINT64_FORMAT " %9" G_GINT64_FORMAT
+			                        " %9" G_GINT64_FORMAT " %9" G_GINT64_FORMAT
+			                        " %10" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT
+			                        " %12" G_GUINT64_FORMAT "\n",
+			                        module_stats->name,
+			                        latencies->len,
+			                        module_stats->n_failures,
+			                        get_percentile (latencies, 0.50),
+			                        get_percentile (latencies, 0.90),
+			                        get_percentile (latencies, 0.99),
+			                        get_percentile (latencies, 1.0),
+			                        module_stats->n_allocations / n_runs,
+			                        module_stats->allocated_bytes / n_runs,
+			                        module_stats->read_bytes / n_runs);
+		}
+	}
+
+	if (json)
+		g_string_append (str, "]}\n");
+
+	g_print ("%s", str->str);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_autoptr (GOptionContext) context = NULL;
+	g_autoptr (GHashTable) stats = NULL;
+	g_autoptr (GPtrArray) files = NULL;
+	g_autoptr (GFile) dir = NULL;
+	g_autoptr (GError) error = NULL;
+	guint i;
+
+	context = g_option_context_new ("- Benchmark extract modules over a corpus");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (!corpus || !corpus[0] || corpus[1] || iterations < 1) {
+		g_autofree gchar *help = NULL;
+
+		help = g_option_context_get_help (context, TRUE, NULL);
+		g_printerr ("%s", help);
+		return EXIT_FAILURE;
+	}
+
+	if (!tracker_extract_module_manager_init ()) {
+		g_printerr ("Could not initialize the extract module manager\n");
+		return EXIT_FAILURE;
+	}
+
+	read_overhead = get_read_bytes ();
+	read_overhead = get_read_bytes () - read_overhead;
+
+	files = g_ptr_array_new_with_free_func (g_object_unref);
+	dir = g_file_new_for_commandline_arg (corpus[0]);
+	collect_files (dir, files);
+
+	stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                               (GDestroyNotify) module_stats_free);
+
+	for (i = 0; i < files->len; i++)
+		run_file (stats, g_ptr_array_index (files, i));
+
+	print_results (stats);
+
+	tracker_module_manager_shutdown_modules ();
+
+	return EXIT_SUCCESS;
+}
@@ -36,6 +36,12 @@ test_extract_info_setters (void)
 
 	g_assert_cmpstr (tracker_extract_info_get_mimetype (info), ==, "imaginary/mime");
 
+	g_assert_null (tracker_extract_info_get_text (info));
+	tracker_extract_info_take_text (info, g_strdup ("foo"));
+	g_assert_cmpstr (tracker_extract_info_get_text (info), ==, "foo");
+	tracker_extract_info_take_text (info, NULL);
+	g_assert_null (tracker_extract_info_get_text (info));
+
 	tracker_extract_info_unref (info_ref);
 	tracker_extract_info_unref (info);
 
@@ -59,6 +65,66 @@ test_extract_info_empty_objects (void)
 	g_object_unref (file);
 }
 
+static void
+test_extract_info_contents (void)
+{
+	TrackerExtractInfo *info;
+	GBytes *contents;
+	GError *error = NULL;
+	gchar *expected;
+	gsize expected_len;
+	GFile *file;
+	int fd;
+
+	g_assert_true (g_file_get_contents (TOP_SRCDIR "/tests/libtracker-extract/getline-test.txt",
+	                                    &expected, &expected_len, NULL));
+
+	file = g_file_new_for_path (TOP_SRCDIR "/tests/libtracker-extract/getline-test.txt");
+	info = tracker_extract_info_new (file, "_:a", "text/plain", NULL, 100);
+
+	fd = tracker_extract_info_get_fd (info, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (fd, >=, 0);
+	g_assert_cmpint (tracker_extract_info_get_fd (info, NULL), ==, fd);
+
+	contents = tracker_extract_info_get_contents (info, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (contents);
+	g_assert_true (tracker_extract_info_get_contents (info, NULL) == contents);
+	g_assert_cmpmem (g_bytes_get_data (contents, NULL), g_bytes_get_size (contents),
+	                 expected, expected_len);
+
+	/* Both are created again after being released */
+	tracker_extract_info_release_contents (info);
+	contents = tracker_extract_info_get_contents (info, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (g_bytes_get_size (contents), ==, expected_len);
+
+	tracker_extract_info_unref (info);
+	g_object_unref (file);
+	g_free (expected);
+}
+
+static void
+test_extract_info_contents_missing (void)
+{
+	TrackerExtractInfo *info;
+	GError *error = NULL;
+	GFile *file;
+
+	file = g_file_new_for_path ("./imaginary-file");
+	info = tracker_extract_info_new (file, "_:a", "imaginary/mime", NULL, 100);
+
+	g_assert_null (tracker_extract_info_get_contents (info, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_clear_error (&error);
+
+	g_assert_cmpint (tracker_extract_info_get_fd (info, NULL), ==, -1);
+
+	tracker_extract_info_unref (info);
+	g_object_unref (file);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -68,6 +134,10 @@ main (int argc, char **argv)
 	                 test_extract_info_empty_objects);
 	g_test_add_func ("/libtracker-extract/extract-info/setters",
 	                 test_extract_info_setters);
+	g_test_add_func ("/libtracker-extract/extract-info/contents",
+	                 test_extract_info_contents);
+	g_test_add_func ("/libtracker-extract/extract-info/contents-missing",
+	                 test_extract_info_contents_missing);
 
 	return g_test_run ();
 }
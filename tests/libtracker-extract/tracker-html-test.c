@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+#define TEST_DOCUMENT \
+	"<!DOCTYPE html>\n" \
+	"<html><head><title>Fish &amp; Chips</title>\n" \
+	"<script>if (a < b) document.write ('</p>');</script>\n" \
+	"<style>p { color: red; }</style></head>\n" \
+	"<!-- <p>Not text</p> -->\n" \
+	"<body><p class=intro>Caf&eacute; &lt;menu&gt;</p>\n" \
+	"<div>1 < 2 &#x263A; &#65; &bogus;</div></body></html>\n"
+
+#define TEST_DOCUMENT_TEXT \
+	"Fish & Chips Café <menu> 1 < 2 ☺ A &bogus;"
+
+typedef struct {
+	GString *tags;
+	TrackerTextSink *sink;
+	gint max_tags;
+} TestData;
+
+static gboolean
+start_tag_cb (const gchar  *name,
+              const gchar **attrs,
+              gpointer      user_data)
+{
+	TestData *data = user_data;
+	gint i;
+
+	g_string_append_printf (data->tags, "<%s", name);
+
+	for (i = 0; attrs[i]; i += 2)
+		g_string_append_printf (data->tags, " %s='%s'", attrs[i], attrs[i + 1]);
+
+	g_string_append_c (data->tags, '>');
+
+	return --data->max_tags > 0;
+}
+
+static gboolean
+end_tag_cb (const gchar *name,
+            gpointer     user_data)
+{
+	TestData *data = user_data;
+
+	g_string_append_printf (data->tags, "</%s>", name);
+
+	return TRUE;
+}
+
+static gboolean
+text_cb (const gchar *text,
+         gsize        len,
+         gpointer     user_data)
+{
+	TestData *data = user_data;
+
+	return tracker_text_sink_append_word (data->sink, text, len, NULL);
+}
+
+static const TrackerHtmlCallbacks callbacks = {
+	start_tag_cb,
+	end_tag_cb,
+	text_cb,
+};
+
+static void
+test_data_init (TestData *data,
+                gsize     max_text)
+{
+	data->tags = g_string_new (NULL);
+	data->sink = tracker_text_sink_new (max_text);
+	data->max_tags = G_MAXINT;
+}
+
+static void
+test_data_clear (TestData *data)
+{
+	g_string_free (data->tags, TRUE);
+	tracker_text_sink_free (data->sink);
+}
+
+static void
+tokenize_in_chunks (TestData    *data,
+                    const gchar *html,
+                    gsize        chunk_size)
+{
+	TrackerHtmlTokenizer *tokenizer;
+	gsize len, i;
+
+	tokenizer = tracker_html_tokenizer_new (&callbacks, data);
+	len = strlen (html);
+
+	for (i = 0; i < len; i += chunk_size) {
+		if (!tracker_html_tokenizer_feed (tokenizer, &html[i],
+		                                  MIN (chunk_size, len - i)))
+			break;
+	}
+
+	tracker_html_tokenizer_finish (tokenizer);
+	tracker_html_tokenizer_free (tokenizer);
+}
+
+static void
+test_html_get_text (void)
+{
+	gchar *text;
+
+	text = tracker_html_get_text (TEST_DOCUMENT, -1, G_MAXSIZE);
+	g_assert_cmpstr (text, ==, TEST_DOCUMENT_TEXT);
+	g_free (text);
+
+	text = tracker_html_get_text ("<p> </p><!-- text -->", -1, G_MAXSIZE);
+	g_assert_null (text);
+
+	/* Broken markup is taken as text */
+	text = tracker_html_get_text ("<p>a <a href='b", -1, G_MAXSIZE);
+	g_assert_cmpstr (text, ==, "a <a href='b");
+	g_free (text);
+}
+
+static void
+test_html_references (void)
+{
+	gchar *text;
+
+	text = tracker_html_get_text ("&amp;amp; &#0; &#x110000; &#xD800; &#; &amp", -1, G_MAXSIZE);
+	g_assert_cmpstr (text, ==, "&amp; \xef\xbf\xbd \xef\xbf\xbd \xef\xbf\xbd &#; &amp");
+	g_free (text);
+}
+
+static void
+test_html_tags (void)
+{
+	TestData data;
+
+	test_data_init (&data, G_MAXSIZE);
+	tokenize_in_chunks (&data,
+	                    "<A HREF=\"x&amp;y\" rel = license title='a > b'>"
+	                    "<br/><IMG src=z alt=\"\" hidden></a>",
+	                    G_MAXSIZE);
+	g_assert_cmpstr (data.tags->str, ==,
+	                 "<a href='x&y' rel='license' title='a > b'>"
+	                 "<br></br><img src='z' alt='' hidden=''></a>");
+	test_data_clear (&data);
+}
+
+static void
+test_html_chunks (void)
+{
+	TestData data;
+	gsize chunk_size;
+
+	/* Tags, words and references split across chunks are not cut */
+	for (chunk_size = 1; chunk_size < 16; chunk_size++) {
+		test_data_init (&data, G_MAXSIZE);
+		tokenize_in_chunks (&data, TEST_DOCUMENT, chunk_size);
+		g_assert_cmpstr (tracker_text_sink_get_text (data.sink), ==,
+		                 TEST_DOCUMENT_TEXT);
+		g_assert_cmpstr (data.tags->str, ==,
+		                 "<html><head><title></title><script></script>"
+		                 "<style></style></head><body><p class='intro'></p>"
+		                 "<div></div></body></html>");
+		test_data_clear (&data);
+	}
+}
+
+static void
+test_html_stop (void)
+{
+	TestData data;
+
+	/* Nothing is parsed after the text budget is used up */
+	test_data_init (&data, 4);
+	tokenize_in_chunks (&data, TEST_DOCUMENT, 8);
+	g_assert_cmpstr (tracker_text_sink_get_text (data.sink), ==, "Fish");
+	g_assert_cmpstr (data.tags->str, ==, "<html><head><title>");
+	test_data_clear (&data);
+
+	/* Or after any other callback returns FALSE */
+	test_data_init (&data, G_MAXSIZE);
+	data.max_tags = 2;
+	tokenize_in_chunks (&data, TEST_DOCUMENT, G_MAXSIZE);
+	g_assert_null (tracker_text_sink_get_text (data.sink));
+	g_assert_cmpstr (data.tags->str, ==, "<html><head>");
+	test_data_clear (&data);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-html/get-text",
+	                 test_html_get_text);
+	g_test_add_func ("/libtracker-extract/tracker-html/references",
+	                 test_html_references);
+	g_test_add_func ("/libtracker-extract/tracker-html/tags",
+	                 test_html_tags);
+	g_test_add_func ("/libtracker-extract/tracker-html/chunks",
+	                 test_html_chunks);
+	g_test_add_func ("/libtracker-extract/tracker-html/stop",
+	                 test_html_stop);
+
+	return g_test_run ();
+}
@@ -20,6 +20,7 @@
 #include "config-miners.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <libtracker-miners-common/tracker-common.h>
 #include <libtracker-extract/tracker-module-manager.h>
@@ -73,13 +74,160 @@ test_extract_rules (void)
 	g_assert_cmpint (g_list_length (l), ==, 0);
 }
 
+static void
+test_extract_rules_order (void)
+{
+	GList *l;
+
+	// Exact matches come first when their rule was loaded first.
+	l = tracker_extract_module_manager_get_matching_rules ("audio/x-specific");
+
+	g_assert_cmpint (g_list_length (l), ==, 2);
+	assert_path_basename (l->data, ==, "10-specific.rule");
+	assert_path_basename (l->next->data, ==, "90-audio-generic.rule");
+	g_list_free (l);
+
+	// Patterns other than prefixes are matched too.
+	l = tracker_extract_module_manager_get_matching_rules ("image/x-very-special");
+
+	g_assert_cmpint (g_list_length (l), ==, 2);
+	assert_path_basename (l->data, ==, "10-specific.rule");
+	assert_path_basename (l->next->data, ==, "90-image-generic.rule");
+	g_list_free (l);
+
+	// Prefixes are matched within the media type only.
+	l = tracker_extract_module_manager_get_matching_rules ("audiox/mpeg");
+	g_assert_cmpint (g_list_length (l), ==, 0);
+}
+
+static gpointer
+lookup_thread (gpointer data)
+{
+	guint i;
+
+	for (i = 0; i < 1000; i++) {
+		g_autofree gchar *mimetype = NULL;
+
+		// Distinct mimetypes, so lookups also add cache entries
+		mimetype = g_strdup_printf ("audio/x-thread-%u", i);
+		g_assert_true (tracker_extract_module_manager_check_fallback_rdf_type (mimetype, "nfo:Audio"));
+
+		g_assert_true (tracker_extract_module_manager_check_fallback_rdf_type ("image/png", "nfo:Image"));
+		g_assert_true (tracker_extract_module_manager_check_fallback_rdf_type ("audio/x-specific", "nfo:Document"));
+		g_assert_false (tracker_extract_module_manager_check_fallback_rdf_type ("image/x-blocked", "nfo:Image"));
+	}
+
+	return NULL;
+}
+
+static void
+test_concurrent_lookups (void)
+{
+	GThread *threads[4];
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new ("lookup", lookup_thread, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (threads); i++)
+		g_thread_join (threads[i]);
+}
+
+static void
+test_thread_safe (void)
+{
+	GModule *module;
+
+	// The dummy extractor can always run in several threads.
+	g_assert_true (tracker_extract_module_manager_module_is_thread_safe (NULL));
+
+	// Modules not loaded through rules are assumed to be thread-unsafe.
+	module = g_module_open (NULL, 0);
+	g_assert_nonnull (module);
+	g_assert_false (tracker_extract_module_manager_module_is_thread_safe (module));
+	g_module_close (module);
+}
+
+static void
+test_shutdown_module (void)
+{
+	GModule *module;
+
+	// The dummy extractor has nothing to shut down.
+	g_assert_false (tracker_module_manager_shutdown_module (NULL));
+
+	// Neither do modules not loaded through rules.
+	module = g_module_open (NULL, 0);
+	g_assert_nonnull (module);
+	g_assert_false (tracker_module_manager_shutdown_module (module));
+	g_module_close (module);
+}
+
+static gchar *
+get_rule_cache_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "tracker3", "extract-rules.cache", NULL);
+}
+
+static void
+test_rule_cache (void)
+{
+	g_autofree gchar *cache_path = NULL;
+
+	if (g_test_subprocess ()) {
+		// Rules come from the cache written by the parent process.
+		test_extract_rules ();
+		test_extract_rules_order ();
+		return;
+	}
+
+	cache_path = get_rule_cache_path ();
+	g_assert_true (g_file_test (cache_path, G_FILE_TEST_IS_REGULAR));
+
+	g_test_trap_subprocess (NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+	g_test_trap_assert_passed ();
+}
+
 int
 main (int argc, char **argv)
 {
+	g_autofree gchar *cache_dir = NULL;
+	int result;
+
 	g_test_init (&argc, &argv, NULL);
+
+	// Rules parsed here are cached for the user, keep that out of $HOME.
+	if (!g_test_subprocess ()) {
+		cache_dir = g_dir_make_tmp ("tracker-module-manager-test-XXXXXX", NULL);
+		g_assert_nonnull (cache_dir);
+		g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+	}
+
 	init_module_manager ();
 
 	g_test_add_func ("/libtracker-extract/module-manager/extract-rules",
 	                 test_extract_rules);
-	return g_test_run ();
+	g_test_add_func ("/libtracker-extract/module-manager/extract-rules-order",
+	                 test_extract_rules_order);
+	g_test_add_func ("/libtracker-extract/module-manager/concurrent-lookups",
+	                 test_concurrent_lookups);
+	g_test_add_func ("/libtracker-extract/module-manager/thread-safe",
+	                 test_thread_safe);
+	g_test_add_func ("/libtracker-extract/module-manager/shutdown-module",
+	                 test_shutdown_module);
+	g_test_add_func ("/libtracker-extract/module-manager/rule-cache",
+	                 test_rule_cache);
+	result = g_test_run ();
+
+	if (cache_dir) {
+		g_autofree gchar *cache_path = NULL, *tracker_dir = NULL;
+
+		cache_path = get_rule_cache_path ();
+		tracker_dir = g_path_get_dirname (cache_path);
+		g_unlink (cache_path);
+		g_rmdir (tracker_dir);
+		g_rmdir (cache_dir);
+	}
+
+	return result;
 }
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <glib-object.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+static void
+test_text_limits_default (void)
+{
+	g_autoptr (TrackerTextLimits) limits = NULL;
+
+	limits = tracker_text_limits_new (1000, 0, NULL);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/plain", "tracker:Documents"), ==, 1000);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/plain", NULL), ==, 1000);
+	g_assert_cmpuint (tracker_text_limits_get_tail (limits, "text/plain", NULL), ==, 0);
+}
+
+static void
+test_text_limits_lookup (void)
+{
+	g_autoptr (TrackerTextLimits) limits = NULL;
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{si}"));
+	g_variant_builder_add (&builder, "{si}", "tracker:Software", 10);
+	g_variant_builder_add (&builder, "{si}", "text/x-*", 20);
+	g_variant_builder_add (&builder, "{si}", "text/x-log", 30);
+	g_variant_builder_add (&builder, "{si}", "text/invalid", -1);
+
+	limits = tracker_text_limits_new (1000, 25, g_variant_builder_end (&builder));
+
+	/* MIME type patterns take precedence, the longest one wins */
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/x-log", "tracker:Software"), ==, 30);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/x-csrc", "tracker:Software"), ==, 20);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "application/x-sh", "tracker:Software"), ==, 10);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/plain", "tracker:Documents"), ==, 1000);
+	g_assert_cmpuint (tracker_text_limits_get_max_text (limits, "text/invalid", NULL), ==, 1000);
+
+	/* The tail is never more than the limit */
+	g_assert_cmpuint (tracker_text_limits_get_tail (limits, "text/x-log", NULL), ==, 25);
+	g_assert_cmpuint (tracker_text_limits_get_tail (limits, "text/x-csrc", NULL), ==, 20);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-text-limits/default",
+	                 test_text_limits_default);
+	g_test_add_func ("/libtracker-extract/tracker-text-limits/lookup",
+	                 test_text_limits_lookup);
+
+	return g_test_run ();
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <glib-object.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+static void
+test_text_sink_append (void)
+{
+	TrackerTextSink *sink;
+	GError *error = NULL;
+
+	sink = tracker_text_sink_new (100);
+	g_assert_null (tracker_text_sink_get_text (sink));
+
+	g_assert_true (tracker_text_sink_append (sink, "foo", -1, &error));
+	g_assert_true (tracker_text_sink_append (sink, "bar baz", 3, &error));
+	g_assert_no_error (error);
+	g_assert_false (tracker_text_sink_is_full (sink));
+	g_assert_cmpstr (tracker_text_sink_get_text (sink), ==, "foobar");
+
+	tracker_text_sink_free (sink);
+}
+
+static void
+test_text_sink_steal_text (void)
+{
+	TrackerTextSink *sink;
+	gchar *text;
+
+	sink = tracker_text_sink_new (100);
+	g_assert_null (tracker_text_sink_steal_text (sink));
+
+	g_assert_true (tracker_text_sink_append (sink, " foo ", -1, NULL));
+	text = tracker_text_sink_steal_text (sink);
+	g_assert_cmpstr (text, ==, "foo");
+	g_assert_null (tracker_text_sink_get_text (sink));
+	g_free (text);
+
+	tracker_text_sink_free (sink);
+}
+
+static void
+test_text_sink_append_word (void)
+{
+	TrackerTextSink *sink;
+	GError *error = NULL;
+
+	sink = tracker_text_sink_new (100);
+
+	g_assert_true (tracker_text_sink_append_word (sink, "foo", -1, &error));
+	g_assert_true (tracker_text_sink_append_word (sink, "", -1, &error));
+	g_assert_true (tracker_text_sink_append_word (sink, "bar ", -1, &error));
+	g_assert_true (tracker_text_sink_append_word (sink, "baz", -1, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (tracker_text_sink_get_text (sink), ==, "foo bar baz");
+
+	tracker_text_sink_free (sink);
+}
+
+static void
+test_text_sink_full (void)
+{
+	TrackerTextSink *sink;
+	GError *error = NULL;
+
+	sink = tracker_text_sink_new (6);
+
+	g_assert_true (tracker_text_sink_append (sink, "foo", -1, &error));
+	g_assert_no_error (error);
+
+	/* Cut at the limit */
+	g_assert_false (tracker_text_sink_append (sink, "barbaz", -1, &error));
+	g_assert_error (error, TRACKER_TEXT_SINK_ERROR, TRACKER_TEXT_SINK_ERROR_FULL);
+	g_clear_error (&error);
+	g_assert_true (tracker_text_sink_is_full (sink));
+
+	/* Nothing else fits */
+	g_assert_false (tracker_text_sink_append_word (sink, "qux", -1, &error));
+	g_assert_error (error, TRACKER_TEXT_SINK_ERROR, TRACKER_TEXT_SINK_ERROR_FULL);
+	g_clear_error (&error);
+
+	g_assert_cmpstr (tracker_text_sink_get_text (sink), ==, "foobar");
+
+	tracker_text_sink_free (sink);
+}
+
+static void
+test_text_sink_full_multibyte (void)
+{
+	TrackerTextSink *sink;
+	GError *error = NULL;
+
+	/* "ü" takes 2 bytes, and doesn't fit in the last one */
+	sink = tracker_text_sink_new (4);
+
+	g_assert_false (tracker_text_sink_append (sink, "füü", -1, &error));
+	g_assert_error (error, TRACKER_TEXT_SINK_ERROR, TRACKER_TEXT_SINK_ERROR_FULL);
+	g_clear_error (&error);
+	g_assert_true (tracker_text_sink_is_full (sink));
+	g_assert_cmpstr (tracker_text_sink_get_text (sink), ==, "fü");
+
+	tracker_text_sink_free (sink);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-text-sink/append",
+	                 test_text_sink_append);
+	g_test_add_func ("/libtracker-extract/tracker-text-sink/steal-text",
+	                 test_text_sink_steal_text);
+	g_test_add_func ("/libtracker-extract/tracker-text-sink/append-word",
+	                 test_text_sink_append_word);
+	g_test_add_func ("/libtracker-extract/tracker-text-sink/full",
+	                 test_text_sink_full);
+	g_test_add_func ("/libtracker-extract/tracker-text-sink/full-multibyte",
+	                 test_text_sink_full_multibyte);
+
+	return g_test_run ();
+}
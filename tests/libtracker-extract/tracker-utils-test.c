@@ -101,6 +101,39 @@ test_guess_date (void)
         result = tracker_date_guess ("2010-03-18T01:02:03.100");
         g_assert_cmpstr (result, ==, "2010-03-18T01:02:03.100");
         g_free (result);
+
+        /* Out of range fields */
+        result = tracker_date_guess ("2010-02-30");
+        g_assert_true (!result);
+
+        result = tracker_date_guess ("2012-02-29");
+        g_assert_cmpstr (result, ==, "2012-02-29T00:00:00");
+        g_free (result);
+
+        result = tracker_date_guess ("2010:03:18 24:02:03");
+        g_assert_true (!result);
+}
+
+static void
+test_guess_date_unix (void)
+{
+        gint64 unix_time;
+
+        g_assert_true (tracker_date_guess_unix ("2010", &unix_time));
+        g_assert_cmpint (unix_time, ==, 1262304000);
+
+        g_assert_true (tracker_date_guess_unix ("20100318010203Z", &unix_time));
+        g_assert_cmpint (unix_time, ==, 1268874123);
+
+        g_assert_true (tracker_date_guess_unix ("2010-03-18T01:02:03.10+01:00", &unix_time));
+        g_assert_cmpint (unix_time, ==, 1268870523);
+
+        g_assert_true (tracker_date_guess_unix ("20100318010203-00:30Z", &unix_time));
+        g_assert_cmpint (unix_time, ==, 1268875923);
+
+        g_assert_false (tracker_date_guess_unix (NULL, &unix_time));
+        g_assert_false (tracker_date_guess_unix ("201a", &unix_time));
+        g_assert_false (tracker_date_guess_unix ("2010-13-18", &unix_time));
 }
 
 static void
@@ -204,6 +237,69 @@ test_text_validate_utf8 ()
 	g_string_free (s, TRUE);
 }
 
+static void
+test_text_validate_utf8_words ()
+{
+	gsize utf8_len = 0;
+	gboolean result;
+
+	/* Non-ASCII characters and invalid bytes past the first
+	 *  few words of ASCII text */
+	result = tracker_text_validate_utf8 ("abcdefghijklmnopqrstuvw" "\xCE\xA9" "xyz" "\xE8\xAA\x9E",
+	                                     -1, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 31);
+
+	result = tracker_text_validate_utf8 ("abcdefghijklmnopqrstuvw" "\xCE" "xyz",
+	                                     -1, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 23);
+
+	/* Overlong sequences and surrogates are not valid */
+	result = tracker_text_validate_utf8 ("abcdefghijklmnopqrstuvw" "\xC0\xAF",
+	                                     -1, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 23);
+
+	result = tracker_text_validate_utf8 ("abcdefghijklmnopqrstuvw" "\xED\xA0\x80",
+	                                     -1, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 23);
+
+	/* Characters cut at the given length */
+	result = tracker_text_validate_utf8 ("abcdefghijklmnopqrstuvw" "\xE8\xAA\x9E",
+	                                     25, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 23);
+
+	/* Embedded NULs end the valid text */
+	result = tracker_text_validate_utf8 ("abcdefghijklm\0nopqrstuvw",
+	                                     24, NULL, &utf8_len);
+	g_assert_true (result);
+	g_assert_cmpuint (utf8_len, ==, 13);
+}
+
+static void
+test_text_normalize ()
+{
+	gchar *result;
+	guint n_words;
+
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	result = tracker_text_normalize ("Hello, w\xC3\xB6rld 42 \xCE\xA9mega!", 10, &n_words);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+	g_assert_cmpstr (result, ==, "Hello w\xC3\xB6rld \xCE\xA9mega ");
+	g_assert_cmpuint (n_words, ==, 3);
+	g_free (result);
+
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	result = tracker_text_normalize ("one two three four", 1, &n_words);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+	g_assert_cmpstr (result, ==, "one two ");
+	g_assert_cmpuint (n_words, ==, 2);
+	g_free (result);
+}
+
 static void
 test_date_to_iso8601 ()
 {
@@ -218,6 +314,18 @@ test_date_to_iso8601 ()
         /* Pattern and string don't match */
         result = tracker_date_format_to_iso8601 ("2010:03:13 12:12", "%Y:%m:%d %H:%M:%S");
         g_assert_true (result == NULL);
+
+        result = tracker_date_format_to_iso8601 ("2010:13:13 12:12:12", "%Y:%m:%d %H:%M:%S");
+        g_assert_true (result == NULL);
+
+        /* IPTC style, also with fields not padded */
+        result = tracker_date_format_to_iso8601 ("2010 03 13", "%Y %m %d");
+        g_assert_true (g_str_has_prefix (result, "2010-03-13T00:00:00"));
+        g_free (result);
+
+        result = tracker_date_format_to_iso8601 ("2010 3 13", "%Y %m %d");
+        g_assert_true (g_str_has_prefix (result, "2010-03-13T00:00:00"));
+        g_free (result);
 }
 
 static void
@@ -291,12 +399,18 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/libtracker-extract/tracker-utils/guess_date",
 	                 test_guess_date);
+	g_test_add_func ("/libtracker-extract/tracker-utils/guess_date_unix",
+	                 test_guess_date_unix);
 	g_test_add_func ("/libtracker-extract/tracker-utils/guess_date_failures",
 	                 test_guess_date_failures);
 	g_test_add_func ("/libtracker-extract/tracker-utils/guess_date_failures/subprocess",
 	                 test_guess_date_failures_subprocess);
         g_test_add_func ("/libtracker-extract/tracker-utils/text-validate-utf8",
                          test_text_validate_utf8);
+        g_test_add_func ("/libtracker-extract/tracker-utils/text-validate-utf8-words",
+                         test_text_validate_utf8_words);
+        g_test_add_func ("/libtracker-extract/tracker-utils/text-normalize",
+                         test_text_normalize);
         g_test_add_func ("/libtracker-extract/tracker-utils/date_to_iso8601",
                          test_date_to_iso8601);
         g_test_add_func ("/libtracker-extract/tracker-utils/coalesce_strip",
@@ -20,6 +20,7 @@
 #include "config-miners.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
@@ -68,6 +69,34 @@
 "     </rdf:RDF> " \
 "   </x:xmpmeta>"
 
+#define PACKET_XMP \
+"<?xpacket begin=\"\xef\xbb\xbf\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>" \
+"<x:xmpmeta xmlns:x=\"adobe:ns:meta/\">" \
+" <rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">" \
+"  <rdf:Description rdf:about=\"\"" \
+"    xmlns:dc=\"http://purl.org/dc/elements/1.1/\"" \
+"    xmlns:exif=\"http://ns.adobe.com/exif/1.0/\"" \
+"    exif:Artist=\"Artist in exif\"" \
+"    exif:FNumber=\"40/10\">" \
+"   <dc:title>" \
+"    <rdf:Alt>" \
+"     <rdf:li xml:lang=\"x-default\">Title &amp; more</rdf:li>" \
+"     <rdf:li xml:lang=\"xx-XX\">Unwanted title</rdf:li>" \
+"    </rdf:Alt>" \
+"   </dc:title>" \
+"   <dc:subject>" \
+"    <rdf:Bag>" \
+"     <rdf:li>first</rdf:li>" \
+"     <rdf:li>second</rdf:li>" \
+"    </rdf:Bag>" \
+"   </dc:subject>" \
+"   <dc:source rdf:resource=\"http://example.com/source\"/>" \
+"  </rdf:Description>" \
+" </rdf:RDF>" \
+"</x:xmpmeta>" \
+"                                                  " \
+"<?xpacket end=\"w\"?>"
+
 #define METERING_MODE_XMP \
 "   <x:xmpmeta   " \
 "      xmlns:x=\'adobe:ns:meta/\'" \
@@ -245,6 +274,23 @@ test_parsing_xmp (void)
 	tracker_xmp_free (data);
 }
 
+static void
+test_parsing_xmp_packet (void)
+{
+	TrackerXmpData *data;
+
+	data = tracker_xmp_new (PACKET_XMP, strlen (PACKET_XMP), "test://file");
+	g_assert_nonnull (data);
+
+	g_assert_cmpstr (data->title, ==, "Title & more");
+	g_assert_cmpstr (data->subject, ==, "second, first");
+	g_assert_cmpstr (data->source, ==, "http://example.com/source");
+	g_assert_cmpstr (data->artist, ==, "Artist in exif");
+	g_assert_cmpstr (data->fnumber, ==, "4");
+
+	tracker_xmp_free (data);
+}
+
 static void
 test_xmp_metering_mode (void)
 {
@@ -539,6 +585,70 @@ test_xmp_regions_nb282393_2 ()
 	tracker_xmp_free (data);
 }
 
+static void
+test_xmp_sidecar (void)
+{
+	TrackerXmpData *data;
+	GFile *file;
+	gchar *filepath, *sidecar_uri;
+
+	/* The image itself doesn't need to exist */
+	filepath = g_build_filename (TOP_SRCDIR, "tests", "libtracker-extract", "areas.jpg", NULL);
+	file = g_file_new_for_path (filepath);
+	g_free (filepath);
+
+	data = tracker_xmp_new_from_sidecar (file, &sidecar_uri);
+	g_object_unref (file);
+
+	g_assert_nonnull (data);
+	g_assert_true (g_str_has_suffix (sidecar_uri, "/areas.xmp"));
+	g_assert_cmpint (2, ==, g_slist_length (data->regions));
+
+	g_free (sidecar_uri);
+	tracker_xmp_free (data);
+}
+
+static void
+test_xmp_sidecar_uppercase (void)
+{
+	TrackerXmpData *data;
+	GFile *file;
+	gchar *dir, *filepath, *contents, *sidecar_uri;
+	gsize len;
+
+	filepath = g_build_filename (TOP_SRCDIR, "tests", "libtracker-extract", "areas.xmp", NULL);
+	g_assert_true (g_file_get_contents (filepath, &contents, &len, NULL));
+	g_free (filepath);
+
+	dir = g_dir_make_tmp ("tracker-xmp-test-XXXXXX", NULL);
+	g_assert_nonnull (dir);
+
+	filepath = g_build_filename (dir, "photo.XMP", NULL);
+	g_assert_true (g_file_set_contents (filepath, contents, len, NULL));
+	g_free (contents);
+
+	/* The image itself doesn't need to exist */
+	file = g_file_new_build_filename (dir, "photo.JPG", NULL);
+	data = tracker_xmp_new_from_sidecar (file, &sidecar_uri);
+	g_object_unref (file);
+
+	g_assert_nonnull (data);
+	g_assert_true (g_str_has_suffix (sidecar_uri, "/photo.XMP"));
+	g_assert_cmpint (2, ==, g_slist_length (data->regions));
+
+	/* No sidecar for other images in the same folder */
+	file = g_file_new_build_filename (dir, "other.jpg", NULL);
+	g_assert_null (tracker_xmp_new_from_sidecar (file, NULL));
+	g_object_unref (file);
+
+	g_unlink (filepath);
+	g_rmdir (dir);
+	g_free (filepath);
+	g_free (dir);
+	g_free (sidecar_uri);
+	tracker_xmp_free (data);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -549,15 +659,19 @@ main (int    argc,
 
 	g_test_message ("Testing XMP");
 
-#ifdef HAVE_EXEMPI
-
 	g_test_add_func ("/libtracker-extract/tracker-xmp/parsing_xmp",
 	                 test_parsing_xmp);
 
+	g_test_add_func ("/libtracker-extract/tracker-xmp/parsing_xmp_packet",
+	                 test_parsing_xmp_packet);
+
+#ifdef HAVE_EXEMPI
+	/* Exempi is the one reporting the failure */
 	g_test_add_func ("/libtracker-extract/tracker-xmp/parsing_xmp_invalid_file",
 	                 test_parsing_xmp_invalid_file);
 	g_test_add_func ("/libtracker-extract/tracker-xmp/parsing_xmp_invalid_file/subprocess",
 	                 test_parsing_xmp_invalid_file_subprocess);
+#endif
 
 	g_test_add_func ("/libtracker-extract/tracker-xmp/metering-mode",
 	                 test_xmp_metering_mode);
@@ -583,7 +697,12 @@ main (int    argc,
 	g_test_add_func ("/libtracker-extract/tracker-xmp/xmp_regions_ns_prefix",
 	                 test_xmp_regions_ns_prefix);
 
-#endif
+	g_test_add_func ("/libtracker-extract/tracker-xmp/xmp_sidecar",
+	                 test_xmp_sidecar);
+
+	g_test_add_func ("/libtracker-extract/tracker-xmp/xmp_sidecar_uppercase",
+	                 test_xmp_sidecar_uppercase);
+
 	g_test_add_func ("/libtracker-extract/tracker-xmp/sparql_translation_location",
 	                 test_xmp_apply_location);
 
@@ -157,6 +157,44 @@ test_dbus_request (void)
 	g_test_trap_assert_stderr ("*The indexer founded an error*");
 }
 
+static void
+test_dbus_request_client_cache_subprocess (void)
+{
+	TrackerDBusRequest *requests[40];
+	guint i;
+
+	tracker_dbus_enable_client_lookup (TRUE);
+
+	g_log_set_default_handler (log_handler, NULL);
+
+	/* More senders than cached clients, with requests still
+	 * active on evicted ones.
+	 */
+	for (i = 0; i < G_N_ELEMENTS (requests); i++) {
+		g_autofree gchar *sender = NULL;
+
+		sender = g_strdup_printf (":1.%u", i % 20);
+		requests[i] = tracker_dbus_request_begin (sender,
+		                                          "Test request (%s))",
+		                                          "--TestCachedOK--");
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (requests); i++)
+		tracker_dbus_request_end (requests[i], NULL);
+
+	tracker_dbus_enable_client_lookup (FALSE);
+}
+
+static void
+test_dbus_request_client_cache (void)
+{
+	g_test_trap_subprocess ("/libtracker-common/tracker-dbus/request-client-cache/subprocess", 0, 0);
+
+	g_test_trap_assert_passed ();
+	g_test_trap_assert_stdout ("*TestCachedOK*");
+	g_test_trap_assert_stdout ("*Success*");
+}
+
 int
 main (int argc, char **argv) {
 
@@ -183,6 +221,10 @@ main (int argc, char **argv) {
 	                 test_dbus_request);
 	g_test_add_func ("/libtracker-common/tracker-dbus/request/subprocess",
 	                 test_dbus_request_subprocess);
+	g_test_add_func ("/libtracker-common/tracker-dbus/request-client-cache",
+	                 test_dbus_request_client_cache);
+	g_test_add_func ("/libtracker-common/tracker-dbus/request-client-cache/subprocess",
+	                 test_dbus_request_client_cache_subprocess);
 /* port to gdbus first
 	 g_test_add_func ("/libtracker-common/tracker-dbus/request-client-lookup",
 	                 test_dbus_request_client_lookup);
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <libtracker-miners-common/tracker-common.h>
+
+static void
+collect_value (TrackerDesktopKey  key,
+               const gchar       *locale,
+               gsize              locale_len,
+               const gchar       *value,
+               gsize              value_len,
+               gpointer           user_data)
+{
+	GString *str = user_data;
+
+	g_string_append_printf (str, "%d", key);
+	if (locale)
+		g_string_append_printf (str, "[%.*s]", (gint) locale_len, locale);
+	g_string_append_printf (str, "=%.*s\n", (gint) value_len, value);
+}
+
+static void
+test_desktop_entry_parse (void)
+{
+	g_autoptr (GString) str = g_string_new (NULL);
+	g_autoptr (GError) error = NULL;
+	const gchar *data =
+		"# Comment\n"
+		"[Desktop Entry]\n"
+		"Type=Application\n"
+		"Name=Editor\n"
+		"Name[de] = Bearbeiter  \r\n"
+		"Keywords=text;editor;\n"
+		"X-Vendor-Foo=bar\n"
+		"Categories=Utility;TextEditor;\n"
+		"\n"
+		"[Desktop Action new-window]\n"
+		"Name=New Window\n"
+		"Exec=editor --new-window\n";
+
+	g_assert_true (tracker_desktop_entry_parse (data, strlen (data),
+	                                            collect_value, str,
+	                                            &error));
+	g_assert_no_error (error);
+
+	/* Only extracted keys, and only from the main group */
+	g_assert_cmpstr (str->str, ==,
+	                 "0=Application\n"
+	                 "2=Editor\n"
+	                 "2[de]=Bearbeiter\n"
+	                 "3=Utility;TextEditor;\n");
+}
+
+static void
+test_desktop_entry_parse_invalid (void)
+{
+	g_autoptr (GString) str = g_string_new (NULL);
+	GError *error = NULL;
+	const gchar *no_group = "Name=Editor\n[Desktop Entry]\n";
+	const gchar *no_value = "[Desktop Entry]\nName\n";
+	const gchar *bad_group = "[Desktop Entry\nName=Editor\n";
+
+	g_assert_false (tracker_desktop_entry_parse (no_group, strlen (no_group),
+	                                             collect_value, str,
+	                                             &error));
+	g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_GROUP_NOT_FOUND);
+	g_clear_error (&error);
+
+	g_assert_false (tracker_desktop_entry_parse (no_value, strlen (no_value),
+	                                             collect_value, str,
+	                                             &error));
+	g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE);
+	g_clear_error (&error);
+
+	g_assert_false (tracker_desktop_entry_parse (bad_group, strlen (bad_group),
+	                                             collect_value, str,
+	                                             &error));
+	g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE);
+	g_clear_error (&error);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-common/desktop-entry/parse",
+	                 test_desktop_entry_parse);
+	g_test_add_func ("/libtracker-common/desktop-entry/parse-invalid",
+	                 test_desktop_entry_parse_invalid);
+
+	return g_test_run ();
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <libtracker-miners-common/tracker-common.h>
+
+static gboolean
+snapshot_lookup (GVariant    *snapshot,
+                 const gchar *name,
+                 guint64     *count,
+                 guint64     *sum,
+                 guint64     *bucket_total)
+{
+	GVariantIter iter, *buckets;
+	const gchar *metric_name;
+	guint64 c, s;
+
+	g_variant_iter_init (&iter, snapshot);
+
+	while (g_variant_iter_next (&iter, "(&stta(ut))", &metric_name, &c, &s, &buckets)) {
+		guint64 bucket_count, total = 0;
+		guint bucket;
+
+		while (g_variant_iter_next (buckets, "(ut)", &bucket, &bucket_count))
+			total += bucket_count;
+
+		g_variant_iter_free (buckets);
+
+		if (g_strcmp0 (metric_name, name) == 0) {
+			*count = c;
+			*sum = s;
+			*bucket_total = total;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+test_metrics_record (void)
+{
+	g_autoptr (GVariant) snapshot = NULL;
+	TrackerMetric *metric;
+	guint64 count, sum, total;
+	gint i;
+
+	metric = tracker_metrics_lookup ("test-record");
+	g_assert_true (metric == tracker_metrics_lookup ("test-record"));
+
+	for (i = 0; i < 1000; i++)
+		tracker_metric_record (metric, i);
+
+	/* Negative latencies are clamped */
+	tracker_metrics_record ("test-record", -5);
+
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	g_assert_true (g_variant_is_of_type (snapshot, TRACKER_METRICS_SNAPSHOT_TYPE));
+	g_assert_true (snapshot_lookup (snapshot, "test-record", &count, &sum, &total));
+	g_assert_cmpuint (count, ==, 1001);
+	g_assert_cmpuint (sum, ==, 999 * 1000 / 2);
+	g_assert_cmpuint (total, ==, count);
+}
+
+static void
+test_metrics_remote (void)
+{
+	g_autoptr (GVariant) remote = NULL, snapshot = NULL;
+	guint64 count, sum, total;
+
+	tracker_metrics_record ("test-remote", 100);
+
+	remote = g_variant_ref_sink (g_variant_new_parsed ("[('test-remote', uint64 2, uint64 3000, [(uint32 40, uint64 2)])]"));
+	tracker_metrics_set_remote_snapshot ("remote", remote);
+
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	g_assert_true (snapshot_lookup (snapshot, "test-remote", &count, &sum, &total));
+	g_assert_cmpuint (count, ==, 3);
+	g_assert_cmpuint (sum, ==, 3100);
+	g_assert_cmpuint (total, ==, 3);
+	g_clear_pointer (&snapshot, g_variant_unref);
+
+	/* Replacing a snapshot does not accumulate it */
+	tracker_metrics_set_remote_snapshot ("remote", remote);
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	g_assert_true (snapshot_lookup (snapshot, "test-remote", &count, &sum, &total));
+	g_assert_cmpuint (count, ==, 3);
+	g_clear_pointer (&snapshot, g_variant_unref);
+
+	tracker_metrics_set_remote_snapshot ("remote", NULL);
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	g_assert_true (snapshot_lookup (snapshot, "test-remote", &count, &sum, &total));
+	g_assert_cmpuint (count, ==, 1);
+}
+
+static void
+test_metrics_to_string (void)
+{
+	g_autoptr (GVariant) snapshot = NULL;
+	g_autofree gchar *str = NULL;
+	gint i;
+
+	for (i = 0; i < 99; i++)
+		tracker_metrics_record ("test-string", 10);
+	tracker_metrics_record ("test-string", 100000);
+
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	str = tracker_metrics_snapshot_to_string (snapshot);
+
+	g_assert_nonnull (strstr (str, "test-string"));
+	/* 10us falls in the [10, 11] bucket */
+	g_assert_nonnull (strstr (str, "test-string 11 99\n"));
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-common/metrics/record",
+	                 test_metrics_record);
+	g_test_add_func ("/libtracker-common/metrics/remote",
+	                 test_metrics_remote);
+	g_test_add_func ("/libtracker-common/metrics/to-string",
+	                 test_metrics_to_string);
+
+	return g_test_run ();
+}
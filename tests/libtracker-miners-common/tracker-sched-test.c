@@ -56,6 +56,39 @@ test_sched_set_and_get (void)
 #endif
 }
 
+static void
+test_sched_set_affinity (void)
+{
+#ifdef __linux__
+        cpu_set_t initial, set;
+        gint cpu;
+
+        g_assert_cmpint (sched_getaffinity (0, sizeof (initial), &initial), ==, 0);
+
+        for (cpu = 0; !CPU_ISSET (cpu, &initial); cpu++)
+                ;
+
+        if (CPU_COUNT (&initial) > 1) {
+                g_autofree gchar *cpus = g_strdup_printf ("%d", cpu);
+
+                g_assert_true (tracker_sched_set_affinity (cpus));
+                g_assert_cmpint (sched_getaffinity (0, sizeof (set), &set), ==, 0);
+                g_assert_cmpint (CPU_COUNT (&set), ==, 1);
+                g_assert_true (CPU_ISSET (cpu, &set));
+        }
+
+        g_assert_false (tracker_sched_set_affinity ("0-"));
+        g_assert_false (tracker_sched_set_affinity ("3-1"));
+        g_assert_false (tracker_sched_set_affinity ("cpu0"));
+
+        /* Back to the default */
+        g_assert_cmpint (sched_setaffinity (0, sizeof (initial), &initial), ==, 0);
+        g_assert_true (tracker_sched_set_affinity (NULL));
+#else
+        g_assert_true (tracker_sched_set_affinity ("0"));
+#endif
+}
+
 
 gint
 main (gint argc, gchar **argv)
@@ -64,6 +97,8 @@ main (gint argc, gchar **argv)
 
         g_test_add_func ("/libtracker-common/sched/set_and_get",
                          test_sched_set_and_get);
+        g_test_add_func ("/libtracker-common/sched/set_affinity",
+                         test_sched_set_affinity);
 
         return g_test_run ();
 }
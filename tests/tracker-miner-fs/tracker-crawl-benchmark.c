@@ -0,0 +1,630 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Crawl benchmarks: generate a synthetic tree, index it with a
+ * minimal TrackerMinerFS subclass against a real store, and report
+ * throughput, peak RSS and the per-stage latency histograms.
+ *
+ * Run one scenario per invocation, eg.:
+ *   tracker-crawl-benchmark --scenario=wide --scale=4
+ */
+
+#include "config-miners.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <tracker-miner-fs.h>
+#include <libtracker-miners-common/tracker-common.h>
+
+typedef struct {
+	TrackerMinerFS parent_instance;
+	guint n_processed;
+	guint n_removed;
+	guint n_moved;
+	guint finished : 1;
+} BenchMiner;
+
+typedef struct {
+	TrackerMinerFSClass parent_class;
+} BenchMinerClass;
+
+typedef struct {
+	TrackerMinerFS *miner;
+	TrackerSparqlConnection *connection;
+	gchar *root_path;
+	GFile *root;
+	guint n_files;
+	guint n_dirs;
+} Bench;
+
+typedef struct {
+	const gchar *name;
+	const gchar *description;
+	void (* run) (Bench *bench);
+} Scenario;
+
+static gchar *scenario_name = NULL;
+static gint scale = 1;
+static gboolean in_memory = FALSE;
+
+static GOptionEntry entries[] = {
+	{ "scenario", 's', 0, G_OPTION_ARG_STRING, &scenario_name,
+	  "Scenario to run (wide, deep, small-files, deep-rename, churn)", "NAME" },
+	{ "scale", 'n', 0, G_OPTION_ARG_INT, &scale,
+	  "Multiply the size of the generated tree", "N" },
+	{ "in-memory", 'm', 0, G_OPTION_ARG_NONE, &in_memory,
+	  "Use an in-memory store instead of an on-disk one", NULL },
+	{ NULL }
+};
+
+G_DEFINE_TYPE (BenchMiner, bench_miner, TRACKER_TYPE_MINER_FS)
+
+static void
+bench_miner_process_file (TrackerMinerFS      *fs,
+                          GFile               *file,
+                          GFileInfo           *info,
+                          TrackerSparqlBuffer *buffer,
+                          gboolean             created)
+{
+	BenchMiner *miner = (BenchMiner *) fs;
+	g_autoptr (TrackerResource) resource = NULL;
+	g_autoptr (GFile) parent = NULL;
+	g_autofree gchar *uri = NULL, *parent_uri = NULL, *root_uri = NULL;
+	TrackerIndexingTree *tree;
+	GFile *root;
+
+	miner->n_processed++;
+	miner->finished = FALSE;
+
+	uri = g_file_get_uri (file);
+	resource = tracker_resource_new (uri);
+
+	if (info && g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+		tracker_resource_add_uri (resource, "rdf:type", "nfo:Folder");
+
+	tracker_resource_add_uri (resource, "rdf:type", "nfo:FileDataObject");
+	tracker_resource_add_uri (resource, "rdf:type", "nie:InformationElement");
+	tracker_resource_add_relation (resource, "nie:interpretedAs", resource);
+	tracker_resource_add_relation (resource, "nie:isStoredAs", resource);
+	tracker_resource_set_string (resource, "nie:url", uri);
+
+	if (info) {
+		g_autoptr (GDateTime) modification_time = NULL;
+
+		modification_time = g_file_info_get_modification_date_time (info);
+		if (modification_time)
+			tracker_resource_set_datetime (resource, "nfo:fileLastModified", modification_time);
+	}
+
+	tree = tracker_miner_fs_get_indexing_tree (fs);
+
+	if (tracker_indexing_tree_file_is_root (tree, file)) {
+		tracker_resource_set_uri (resource, "nie:rootElementOf", uri);
+		tracker_resource_add_uri (resource, "rdf:type", "nie:DataSource");
+	}
+
+	root = tracker_indexing_tree_get_root (tree, file, NULL);
+	if (root) {
+		root_uri = g_file_get_uri (root);
+		tracker_resource_set_uri (resource, "nie:dataSource", root_uri);
+	}
+
+	parent = g_file_get_parent (file);
+	parent_uri = g_file_get_uri (parent);
+	tracker_resource_set_uri (resource, "nfo:belongsToContainer", parent_uri);
+
+	tracker_sparql_buffer_log_file (buffer, file, "tracker:FileSystem", resource, NULL, NULL);
+}
+
+static void
+bench_miner_process_file_attributes (TrackerMinerFS      *fs,
+                                     GFile               *file,
+                                     GFileInfo           *info,
+                                     TrackerSparqlBuffer *buffer)
+{
+	bench_miner_process_file (fs, file, info, buffer, FALSE);
+}
+
+static void
+bench_miner_remove_file (TrackerMinerFS      *fs,
+                         GFile               *file,
+                         TrackerSparqlBuffer *buffer,
+                         gboolean             is_dir)
+{
+	BenchMiner *miner = (BenchMiner *) fs;
+
+	miner->n_removed++;
+	miner->finished = FALSE;
+
+	tracker_sparql_buffer_log_delete (buffer, file);
+	if (is_dir)
+		tracker_sparql_buffer_log_delete_content (buffer, file);
+}
+
+static void
+bench_miner_remove_children (TrackerMinerFS      *fs,
+                             GFile               *file,
+                             TrackerSparqlBuffer *buffer)
+{
+	tracker_sparql_buffer_log_delete_content (buffer, file);
+}
+
+static void
+bench_miner_move_file (TrackerMinerFS      *fs,
+                       GFile               *dest,
+                       GFile               *source,
+                       TrackerSparqlBuffer *buffer,
+                       gboolean             recursive)
+{
+	BenchMiner *miner = (BenchMiner *) fs;
+	g_autofree gchar *root_uri = NULL;
+	GFile *root;
+
+	miner->n_moved++;
+	miner->finished = FALSE;
+
+	root = tracker_indexing_tree_get_root (tracker_miner_fs_get_indexing_tree (fs),
+	                                       dest, NULL);
+	if (root)
+		root_uri = g_file_get_uri (root);
+
+	tracker_sparql_buffer_log_move (buffer, source, dest, root_uri);
+
+	if (recursive)
+		tracker_sparql_buffer_log_move_content (buffer, source, dest);
+}
+
+static void
+bench_miner_finished (TrackerMinerFS *fs,
+                      gdouble         elapsed,
+                      gint            directories_found,
+                      gint            directories_ignored,
+                      gint            files_found,
+                      gint            files_ignored)
+{
+	((BenchMiner *) fs)->finished = TRUE;
+}
+
+static void
+bench_miner_class_init (BenchMinerClass *klass)
+{
+	TrackerMinerFSClass *fs_class = TRACKER_MINER_FS_CLASS (klass);
+
+	fs_class->process_file = bench_miner_process_file;
+	fs_class->process_file_attributes = bench_miner_process_file_attributes;
+	fs_class->remove_file = bench_miner_remove_file;
+	fs_class->remove_children = bench_miner_remove_children;
+	fs_class->move_file = bench_miner_move_file;
+	fs_class->finished = bench_miner_finished;
+}
+
+static void
+bench_miner_init (BenchMiner *miner)
+{
+}
+
+static void
+bench_miner_reset (BenchMiner *miner)
+{
+	miner->n_processed = 0;
+	miner->n_removed = 0;
+	miner->n_moved = 0;
+	miner->finished = FALSE;
+}
+
+/* Tree generation */
+static void
+bench_create_dir (Bench       *bench,
+                  const gchar *path)
+{
+	if (g_mkdir_with_parents (path, 0700) < 0)
+		g_error ("Could not create %s: %m", path);
+
+	bench->n_dirs++;
+}
+
+static void
+bench_create_files (Bench       *bench,
+                    const gchar *dir,
+                    guint        n_files,
+                    gsize        size)
+{
+	g_autofree gchar *contents = NULL;
+	guint i;
+
+	contents = g_malloc (size + 1);
+	memset (contents, 'x', size);
+	contents[size] = '\0';
+
+	for (i = 0; i < n_files; i++) {
+		g_autofree gchar *basename = NULL, *path = NULL;
+		g_autoptr (GError) error = NULL;
+
+		basename = g_strdup_printf ("file-%05u.txt", i);
+		path = g_build_filename (dir, basename, NULL);
+
+		if (!g_file_set_contents (path, contents, size, &error))
+			g_error ("Could not create %s: %s", path, error->message);
+
+		bench->n_files++;
+	}
+}
+
+/* Creates @fanout directories per level, @depth levels deep,
+ * with @n_files in each of them.
+ */
+static void
+bench_create_tree (Bench       *bench,
+                   const gchar *dir,
+                   guint        depth,
+                   guint        fanout,
+                   guint        n_files,
+                   gsize        size)
+{
+	guint i;
+
+	bench_create_files (bench, dir, n_files, size);
+
+	if (depth == 0)
+		return;
+
+	for (i = 0; i < fanout; i++) {
+		g_autofree gchar *basename = NULL, *path = NULL;
+
+		basename = g_strdup_printf ("dir-%03u", i);
+		path = g_build_filename (dir, basename, NULL);
+		bench_create_dir (bench, path);
+		bench_create_tree (bench, path, depth - 1, fanout, n_files, size);
+	}
+}
+
+/* Measurement */
+static void
+bench_wait (Bench *bench,
+            guint  n_processed,
+            guint  n_removed,
+            guint  n_moved)
+{
+	BenchMiner *miner = (BenchMiner *) bench->miner;
+
+	/* Events may trickle in from the monitors after the miner went
+	 * idle once, so wait for both the expected work and a finished
+	 * signal after the last bit of it.
+	 */
+	while (miner->n_processed < n_processed ||
+	       miner->n_removed < n_removed ||
+	       miner->n_moved < n_moved ||
+	       !miner->finished)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+bench_print_rate (const gchar *label,
+                  guint        n_items,
+                  gint64       usec)
+{
+	gdouble secs = usec / (gdouble) G_USEC_PER_SEC;
+
+	g_print ("%-24s %8u items in %8.3f s, %10.1f items/s\n",
+	         label, n_items, secs,
+	         secs > 0 ? n_items / secs : 0.0);
+}
+
+static gint64
+bench_index (Bench                 *bench,
+             TrackerDirectoryFlags  flags)
+{
+	BenchMiner *miner = (BenchMiner *) bench->miner;
+	gint64 start;
+
+	bench_miner_reset (miner);
+	start = g_get_monotonic_time ();
+
+	tracker_indexing_tree_add (tracker_miner_fs_get_indexing_tree (bench->miner),
+	                           bench->root,
+	                           flags |
+	                           TRACKER_DIRECTORY_FLAG_CHECK_MTIME |
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_miner_start (TRACKER_MINER (bench->miner));
+
+	/* The root itself is processed too */
+	bench_wait (bench, bench->n_files + bench->n_dirs + 1, 0, 0);
+
+	return g_get_monotonic_time () - start;
+}
+
+static void
+bench_crawl (Bench *bench)
+{
+	gint64 elapsed;
+
+	elapsed = bench_index (bench, TRACKER_DIRECTORY_FLAG_NONE);
+	bench_print_rate ("crawl", ((BenchMiner *) bench->miner)->n_processed, elapsed);
+}
+
+/* Scenarios */
+static void
+run_wide (Bench *bench)
+{
+	bench_create_files (bench, bench->root_path, 20000 * scale, 16);
+	bench_crawl (bench);
+}
+
+static void
+run_deep (Bench *bench)
+{
+	g_autoptr (GString) path = NULL;
+	guint i;
+
+	path = g_string_new (bench->root_path);
+
+	/* The depth is bounded by PATH_MAX, so scale the files per level */
+	for (i = 0; i < 200; i++) {
+		g_string_append_printf (path, G_DIR_SEPARATOR_S "level-%u", i);
+		bench_create_dir (bench, path->str);
+		bench_create_files (bench, path->str, 10 * scale, 16);
+	}
+
+	bench_crawl (bench);
+}
+
+static void
+run_small_files (Bench *bench)
+{
+	/* 3 levels of 10 directories, 20 small files in each */
+	bench_create_tree (bench, bench->root_path, 3, 10, 20 * scale, 512);
+	bench_crawl (bench);
+}
+
+static void
+run_deep_rename (Bench *bench)
+{
+	BenchMiner *miner = (BenchMiner *) bench->miner;
+	gint64 elapsed, total = 0;
+	guint i, n_rounds = 10;
+
+	bench_create_tree (bench, bench->root_path, 4, 4, 4 * scale, 16);
+	elapsed = bench_index (bench, TRACKER_DIRECTORY_FLAG_MONITOR);
+	bench_print_rate ("crawl", miner->n_processed, elapsed);
+
+	/* Rename one of the top level directories back and forth, the
+	 * whole subtree below it moves along.
+	 */
+	for (i = 0; i < n_rounds; i++) {
+		g_autofree gchar *from = NULL, *to = NULL;
+		gint64 start;
+
+		from = g_strdup_printf ("%s/dir-000%s", bench->root_path, (i % 2) ? "-renamed" : "");
+		to = g_strdup_printf ("%s/dir-000%s", bench->root_path, (i % 2) ? "" : "-renamed");
+
+		bench_miner_reset (miner);
+		start = g_get_monotonic_time ();
+
+		if (g_rename (from, to) < 0)
+			g_error ("Could not rename %s: %m", from);
+
+		bench_wait (bench, 0, 0, 1);
+		total += g_get_monotonic_time () - start;
+	}
+
+	bench_print_rate ("rename", n_rounds, total);
+}
+
+/* Plain writes, g_file_set_contents() would show up as moves */
+static void
+bench_write_file (const gchar *path,
+                  const gchar *contents)
+{
+	FILE *f;
+
+	f = g_fopen (path, "w");
+	if (!f || fputs (contents, f) < 0 || fclose (f) != 0)
+		g_error ("Could not write %s: %m", path);
+}
+
+static void
+run_churn (Bench *bench)
+{
+	BenchMiner *miner = (BenchMiner *) bench->miner;
+	g_autofree gchar *churn_dir = NULL;
+	gint64 elapsed, total = 0;
+	guint i, j, n_rounds = 10, n_changes = 100 * scale, n_events = 0;
+
+	bench_create_tree (bench, bench->root_path, 2, 10, 10 * scale, 16);
+	churn_dir = g_build_filename (bench->root_path, "churn", NULL);
+	bench_create_dir (bench, churn_dir);
+
+	elapsed = bench_index (bench, TRACKER_DIRECTORY_FLAG_MONITOR);
+	bench_print_rate ("crawl", miner->n_processed, elapsed);
+
+	/* Every round creates a set of files, and modifies half and
+	 * deletes the other half of the set created by the previous one.
+	 */
+	for (i = 0; i < n_rounds; i++) {
+		guint n_modified = 0, n_removed = 0;
+		gint64 start;
+
+		bench_miner_reset (miner);
+		start = g_get_monotonic_time ();
+
+		for (j = 0; j < n_changes; j++) {
+			g_autofree gchar *path = NULL, *old_path = NULL;
+
+			path = g_strdup_printf ("%s/round-%u-%u.txt", churn_dir, i, j);
+			bench_write_file (path, "churn");
+
+			if (i == 0)
+				continue;
+
+			old_path = g_strdup_printf ("%s/round-%u-%u.txt", churn_dir, i - 1, j);
+
+			if (j % 2 == 0) {
+				bench_write_file (old_path, "modified");
+				n_modified++;
+			} else {
+				if (g_unlink (old_path) < 0)
+					g_error ("Could not delete %s: %m", old_path);
+				n_removed++;
+			}
+		}
+
+		bench_wait (bench, n_changes + n_modified, n_removed, 0);
+		total += g_get_monotonic_time () - start;
+		n_events += n_changes + n_modified + n_removed;
+	}
+
+	bench_print_rate ("churn", n_events, total);
+}
+
+static const Scenario scenarios[] = {
+	{ "wide", "A single directory with many files", run_wide },
+	{ "deep", "A long chain of nested directories", run_deep },
+	{ "small-files", "A balanced tree of many small files", run_small_files },
+	{ "deep-rename", "Renames of a directory with a deep subtree", run_deep_rename },
+	{ "churn", "Files being created, modified and deleted", run_churn },
+};
+
+static const Scenario *
+find_scenario (const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (scenarios); i++) {
+		if (g_strcmp0 (scenarios[i].name, name) == 0)
+			return &scenarios[i];
+	}
+
+	return NULL;
+}
+
+static void
+bench_setup (Bench *bench)
+{
+	g_autoptr (GFile) ontology = NULL, db = NULL;
+	g_autoptr (TrackerIndexingTree) indexing_tree = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *path = NULL;
+
+	path = g_build_filename (g_get_tmp_dir (), "tracker-crawl-benchmark-XXXXXX", NULL);
+	if (!g_mkdtemp_full (path, 0700))
+		g_error ("Could not create temporary directory: %m");
+
+	bench->root_path = g_build_filename (path, "tree", NULL);
+	g_mkdir (bench->root_path, 0700);
+	bench->root = g_file_new_for_path (bench->root_path);
+
+	if (!in_memory)
+		db = g_file_new_build_filename (path, "db", NULL);
+
+	ontology = tracker_sparql_get_ontology_nepomuk ();
+	bench->connection = tracker_sparql_connection_new (0, db, ontology, NULL, &error);
+	if (!bench->connection)
+		g_error ("Could not create store: %s", error->message);
+
+	tracker_sparql_connection_update (bench->connection,
+	                                  "CREATE SILENT GRAPH tracker:FileSystem",
+	                                  NULL, &error);
+	if (error)
+		g_error ("Could not create graphs: %s", error->message);
+
+	indexing_tree = tracker_indexing_tree_new ();
+	bench->miner = g_object_new (bench_miner_get_type (),
+	                             "indexing-tree", indexing_tree,
+	                             "connection", bench->connection,
+	                             "file-attributes", "standard::*,time::*",
+	                             NULL);
+}
+
+static void
+bench_teardown (Bench *bench)
+{
+	g_autofree gchar *base_path = NULL, *command = NULL;
+
+	g_clear_object (&bench->miner);
+	g_clear_object (&bench->connection);
+	g_clear_object (&bench->root);
+
+	base_path = g_path_get_dirname (bench->root_path);
+	command = g_strdup_printf ("rm -rf '%s'", base_path);
+	if (system (command) != 0)
+		g_warning ("Could not remove %s", base_path);
+
+	g_free (bench->root_path);
+}
+
+static void
+bench_print_summary (Bench *bench)
+{
+	g_autoptr (GVariant) snapshot = NULL;
+	g_autofree gchar *table = NULL;
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) == 0)
+		g_print ("%-24s %8ld kB\n", "peak RSS", usage.ru_maxrss);
+
+	/* The batch-execute stage is the commit latency */
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	table = tracker_metrics_snapshot_to_string (snapshot);
+	g_print ("\n%s", table);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_autoptr (GOptionContext) context = NULL;
+	g_autoptr (GError) error = NULL;
+	const Scenario *scenario;
+	Bench bench = { 0, };
+	guint i;
+
+	context = g_option_context_new ("- Benchmark crawling synthetic trees");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	scenario = find_scenario (scenario_name);
+
+	if (!scenario || scale < 1) {
+		g_printerr ("Available scenarios:\n");
+		for (i = 0; i < G_N_ELEMENTS (scenarios); i++)
+			g_printerr ("  %-14s %s\n", scenarios[i].name, scenarios[i].description);
+		return EXIT_FAILURE;
+	}
+
+	bench_setup (&bench);
+
+	g_print ("Scenario: %s, scale %d, %s store\n",
+	         scenario->name, scale, in_memory ? "in-memory" : "on-disk");
+	scenario->run (&bench);
+	g_print ("%-24s %8u files, %u directories\n",
+	         "tree", bench.n_files, bench.n_dirs);
+	bench_print_summary (&bench);
+
+	bench_teardown (&bench);
+
+	return EXIT_SUCCESS;
+}
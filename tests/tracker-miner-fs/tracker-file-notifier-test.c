@@ -902,6 +902,108 @@ test_file_notifier_start_stop (TestCommonContext *fixture,
 	tracker_file_notifier_stop (fixture->notifier);
 }
 
+static void
+test_file_notifier_crawl_checkpoint (TestCommonContext *fixture,
+                                     gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive", NULL },
+		{ OPERATION_CREATE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "recursive/folder/aaa", NULL },
+		{ OPERATION_CREATE, "recursive/bbb", NULL },
+	};
+	g_autoptr (GFile) checkpoint = NULL, root = NULL;
+	g_autofree gchar *contents = NULL, *uri = NULL;
+	g_autoptr (GError) error = NULL;
+	gint64 deadline;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+	CREATE_UPDATE_FILE (fixture, "recursive/bbb");
+
+	checkpoint = g_file_get_child (fixture->test_file, "checkpoint");
+	tracker_file_notifier_set_checkpoint_file (fixture->notifier, checkpoint);
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+
+	/* Hold crawling before the root directory is crawled */
+	tracker_file_notifier_set_high_water (fixture->notifier, TRUE);
+	tracker_file_notifier_start (fixture->notifier);
+
+	deadline = g_get_monotonic_time () + 2 * G_USEC_PER_SEC;
+
+	while (!g_file_query_exists (checkpoint, NULL) &&
+	       g_get_monotonic_time () < deadline) {
+		g_main_context_iteration (NULL, FALSE);
+		tracker_file_notifier_save_checkpoint (fixture->notifier);
+	}
+
+	/* The root directory is left to crawl */
+	g_file_load_contents (checkpoint, NULL, &contents, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	root = test_common_context_get_file (fixture, "recursive");
+	uri = g_file_get_uri (root);
+	g_assert_nonnull (strstr (contents, uri));
+
+	tracker_file_notifier_set_high_water (fixture->notifier, FALSE);
+	test_common_context_expect_results (fixture, expected_results,
+					    G_N_ELEMENTS (expected_results),
+					    2, TRUE);
+
+	/* Nothing is left to resume once everything is processed */
+	tracker_file_notifier_clear_checkpoint (fixture->notifier);
+	g_assert_false (g_file_query_exists (checkpoint, NULL));
+
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
+static void
+test_file_notifier_consistent_roots (TestCommonContext *fixture,
+                                     gconstpointer      data)
+{
+	FilesystemOperation expected_results[] = {
+		{ OPERATION_CREATE, "recursive", NULL },
+		{ OPERATION_CREATE, "recursive/folder", NULL },
+		{ OPERATION_CREATE, "recursive/folder/aaa", NULL },
+	};
+	g_autoptr (GFile) checkpoint = NULL, consistent = NULL, root = NULL;
+	g_autofree gchar *contents = NULL, *uri = NULL;
+	g_autoptr (GError) error = NULL;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_UPDATE_FILE (fixture, "recursive/folder/aaa");
+
+	checkpoint = g_file_get_child (fixture->test_file, "checkpoint");
+	tracker_file_notifier_set_checkpoint_file (fixture->notifier, checkpoint);
+	consistent = g_file_get_child (fixture->test_file, "consistent-roots");
+	tracker_file_notifier_set_consistent_roots_file (fixture->notifier,
+	                                                 consistent, TRUE);
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE |
+	                               TRACKER_DIRECTORY_FLAG_CHECK_MTIME);
+	tracker_file_notifier_start (fixture->notifier);
+
+	test_common_context_expect_results (fixture, expected_results,
+					    G_N_ELEMENTS (expected_results),
+					    2, TRUE);
+
+	/* Roots are consistent once everything is processed */
+	tracker_file_notifier_clear_checkpoint (fixture->notifier);
+	tracker_file_notifier_stop (fixture->notifier);
+
+	g_file_load_contents (consistent, NULL, &contents, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	root = test_common_context_get_file (fixture, "recursive");
+	uri = g_file_get_uri (root);
+	g_assert_true (g_str_has_prefix (contents, uri));
+	g_assert_cmpint (contents[strlen (uri)], ==, '\t');
+}
+
 static void
 test_file_notifier_monitor_updates_non_recursive (TestCommonContext *fixture,
                                                   gconstpointer      data)
@@ -1038,6 +1140,10 @@ main (gint    argc,
 		  test_file_notifier_changes_update_child);
 	test_add ("/libtracker-miner/file-notifier/start-stop",
 		  test_file_notifier_start_stop);
+	test_add ("/libtracker-miner/file-notifier/crawl-checkpoint",
+		  test_file_notifier_crawl_checkpoint);
+	test_add ("/libtracker-miner/file-notifier/consistent-roots",
+		  test_file_notifier_consistent_roots);
 
 	/* Monitoring */
 	test_add ("/libtracker-miner/file-notifier/monitor-updates-non-recursive",
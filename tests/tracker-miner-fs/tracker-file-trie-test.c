@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ */
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-file-trie.h>
+
+static void
+insert_path (TrackerFileTrie *trie,
+             const gchar     *path)
+{
+	g_autoptr (GFile) file = NULL;
+
+	file = g_file_new_for_path (path);
+	tracker_file_trie_insert (trie, file, g_strdup (path));
+}
+
+static const gchar *
+lookup_path (TrackerFileTrie *trie,
+             const gchar     *path)
+{
+	g_autoptr (GFile) file = NULL;
+
+	file = g_file_new_for_path (path);
+
+	return tracker_file_trie_lookup (trie, file);
+}
+
+static void
+test_file_trie_lookup (void)
+{
+	TrackerFileTrie *trie;
+	g_autoptr (GFile) file = NULL;
+	gchar *data;
+
+	trie = tracker_file_trie_new (g_free);
+
+	insert_path (trie, "/a/b/c");
+	insert_path (trie, "/a/b");
+	insert_path (trie, "/a/d");
+	g_assert_cmpuint (tracker_file_trie_get_size (trie), ==, 3);
+
+	g_assert_cmpstr (lookup_path (trie, "/a/b/c"), ==, "/a/b/c");
+	g_assert_cmpstr (lookup_path (trie, "/a/b"), ==, "/a/b");
+	g_assert_null (lookup_path (trie, "/a"));
+	g_assert_null (lookup_path (trie, "/a/b/c/e"));
+	g_assert_null (lookup_path (trie, "/x"));
+
+	/* Replacing data keeps the size */
+	insert_path (trie, "/a/d");
+	g_assert_cmpuint (tracker_file_trie_get_size (trie), ==, 3);
+
+	file = g_file_new_for_path ("/a/b");
+	data = tracker_file_trie_remove (trie, file);
+	g_assert_cmpstr (data, ==, "/a/b");
+	g_free (data);
+
+	g_assert_null (lookup_path (trie, "/a/b"));
+	g_assert_cmpstr (lookup_path (trie, "/a/b/c"), ==, "/a/b/c");
+	g_assert_cmpuint (tracker_file_trie_get_size (trie), ==, 2);
+
+	tracker_file_trie_free (trie);
+}
+
+static void
+test_file_trie_lookup_ancestor (void)
+{
+	TrackerFileTrie *trie;
+	g_autoptr (GFile) root = NULL, file = NULL;
+
+	trie = tracker_file_trie_new (g_free);
+
+	root = g_file_new_for_path ("/");
+	tracker_file_trie_insert (trie, root, g_strdup ("/"));
+	insert_path (trie, "/a/b");
+	insert_path (trie, "/a/b/c/d");
+
+	file = g_file_new_for_path ("/a/b/c/d/e");
+	g_assert_cmpstr (tracker_file_trie_lookup_ancestor (trie, file), ==, "/a/b/c/d");
+	g_clear_object (&file);
+
+	file = g_file_new_for_path ("/a/b/c");
+	g_assert_cmpstr (tracker_file_trie_lookup_ancestor (trie, file), ==, "/a/b");
+	g_clear_object (&file);
+
+	file = g_file_new_for_path ("/a/b");
+	g_assert_cmpstr (tracker_file_trie_lookup_ancestor (trie, file), ==, "/a/b");
+	g_clear_object (&file);
+
+	file = g_file_new_for_path ("/a/bb");
+	g_assert_cmpstr (tracker_file_trie_lookup_ancestor (trie, file), ==, "/");
+	g_clear_object (&file);
+
+	file = g_file_new_for_uri ("http://example.com/a/b");
+	g_assert_null (tracker_file_trie_lookup_ancestor (trie, file));
+
+	tracker_file_trie_free (trie);
+}
+
+static void
+test_file_trie_steal_descendants (void)
+{
+	TrackerFileTrie *trie;
+	g_autoptr (GFile) file = NULL;
+	GList *list;
+
+	trie = tracker_file_trie_new (g_free);
+
+	insert_path (trie, "/a");
+	insert_path (trie, "/a/b");
+	insert_path (trie, "/a/b/c");
+	insert_path (trie, "/a/b/c/d");
+	insert_path (trie, "/a/bb");
+	insert_path (trie, "/e");
+
+	file = g_file_new_for_path ("/a/b");
+	list = tracker_file_trie_steal_descendants (trie, file);
+	g_assert_cmpuint (g_list_length (list), ==, 3);
+	g_assert_nonnull (g_list_find_custom (list, "/a/b", (GCompareFunc) g_strcmp0));
+	g_assert_nonnull (g_list_find_custom (list, "/a/b/c", (GCompareFunc) g_strcmp0));
+	g_assert_nonnull (g_list_find_custom (list, "/a/b/c/d", (GCompareFunc) g_strcmp0));
+	g_list_free_full (list, g_free);
+
+	/* Siblings sharing a name prefix are not descendants */
+	g_assert_cmpstr (lookup_path (trie, "/a/bb"), ==, "/a/bb");
+	g_assert_cmpstr (lookup_path (trie, "/a"), ==, "/a");
+	g_assert_null (lookup_path (trie, "/a/b/c"));
+	g_assert_cmpuint (tracker_file_trie_get_size (trie), ==, 3);
+
+	/* Nothing stored there */
+	list = tracker_file_trie_steal_descendants (trie, file);
+	g_assert_null (list);
+
+	tracker_file_trie_free (trie);
+}
+
+static void
+test_file_trie_get_descendants (void)
+{
+	TrackerFileTrie *trie;
+	g_autoptr (GFile) file = NULL;
+	GList *list;
+
+	trie = tracker_file_trie_new (g_free);
+
+	insert_path (trie, "/a/b");
+	insert_path (trie, "/a/b/c/d");
+	insert_path (trie, "/a/bb");
+
+	file = g_file_new_for_path ("/a/b");
+	list = tracker_file_trie_get_descendants (trie, file);
+	g_assert_cmpuint (g_list_length (list), ==, 2);
+	g_assert_nonnull (g_list_find_custom (list, "/a/b", (GCompareFunc) g_strcmp0));
+	g_assert_nonnull (g_list_find_custom (list, "/a/b/c/d", (GCompareFunc) g_strcmp0));
+	g_list_free (list);
+
+	/* The data stays in the trie */
+	g_assert_cmpstr (lookup_path (trie, "/a/b/c/d"), ==, "/a/b/c/d");
+	g_assert_cmpuint (tracker_file_trie_get_size (trie), ==, 3);
+	g_clear_object (&file);
+
+	file = g_file_new_for_path ("/a/b/x");
+	g_assert_null (tracker_file_trie_get_descendants (trie, file));
+
+	tracker_file_trie_free (trie);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-file-trie/lookup",
+	                 test_file_trie_lookup);
+	g_test_add_func ("/libtracker-miner/tracker-file-trie/lookup-ancestor",
+	                 test_file_trie_lookup_ancestor);
+	g_test_add_func ("/libtracker-miner/tracker-file-trie/steal-descendants",
+	                 test_file_trie_steal_descendants);
+	g_test_add_func ("/libtracker-miner/tracker-file-trie/get-descendants",
+	                 test_file_trie_get_descendants);
+
+	return g_test_run ();
+}
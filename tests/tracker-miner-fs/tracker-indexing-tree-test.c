@@ -943,6 +943,280 @@ test_indexing_tree_030 (TestCommonContext *fixture,
 	ASSERT_INDEXABLE (fixture, TEST_DIRECTORY_ABA);
 }
 
+/* Filters are matched against the file basename, whatever the
+ * glob form, and are updated as filters are added and cleared.
+ */
+static void
+test_indexing_tree_031 (TestCommonContext *fixture,
+                        gconstpointer      data)
+{
+	static const struct {
+		const gchar *path;
+		gboolean match;
+	} files[] = {
+		{ "/A/core", TRUE },
+		{ "/A/B/notes.bak", TRUE },
+		{ "/A/file.o", TRUE },
+		{ "/A/.#lock", TRUE },
+		{ "/A/tmp-x.part", TRUE },
+		{ "/A/doc1.txt", TRUE },
+		{ "/A/core.c", FALSE },
+		{ "/A/bak", FALSE },
+		{ "/A/doc12.txt", FALSE },
+		{ "/A/B", FALSE },
+	};
+	g_autoptr (GFile) file = NULL;
+	guint i;
+
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "core");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*.bak");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*.o");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, ".#*");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "tmp-*.part");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "doc?.txt");
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		g_clear_object (&file);
+		file = g_file_new_for_path (files[i].path);
+
+		g_assert_true (tracker_indexing_tree_file_matches_filter (fixture->tree,
+		                                                          TRACKER_FILTER_FILE,
+		                                                          file) == files[i].match);
+		g_assert_false (tracker_indexing_tree_file_matches_filter (fixture->tree,
+		                                                           TRACKER_FILTER_DIRECTORY,
+		                                                           file));
+	}
+
+	tracker_indexing_tree_clear_filters (fixture->tree, TRACKER_FILTER_FILE);
+	g_assert_false (tracker_indexing_tree_file_matches_filter (fixture->tree,
+	                                                           TRACKER_FILTER_FILE,
+	                                                           file));
+
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, "*");
+	g_assert_true (tracker_indexing_tree_file_matches_filter (fixture->tree,
+	                                                          TRACKER_FILTER_FILE,
+	                                                          file));
+}
+
+typedef struct {
+	guint filters_added;
+	guint n_globs;
+	guint directories_updated;
+} FilterSignals;
+
+static void
+filters_added_cb (TrackerIndexingTree *tree,
+                  TrackerFilterType    type,
+                  GStrv                globs,
+                  FilterSignals       *signals)
+{
+	g_assert_cmpint (type, ==, TRACKER_FILTER_FILE);
+	signals->filters_added++;
+	signals->n_globs = g_strv_length (globs);
+}
+
+static void
+directory_updated_cb (TrackerIndexingTree *tree,
+                      GFile               *directory,
+                      FilterSignals       *signals)
+{
+	signals->directories_updated++;
+}
+
+/* Replacing filters only notifies about the content they affect,
+ * new filters alone do not need roots to be crawled again.
+ */
+static void
+test_indexing_tree_032 (TestCommonContext *fixture,
+                        gconstpointer      data)
+{
+	FilterSignals signals = { 0, };
+	g_autoptr (GFile) file = NULL;
+	const gchar *bak = "*.bak";
+	GSList *globs = NULL;
+
+	g_signal_connect (fixture->tree, "filters-added",
+	                  G_CALLBACK (filters_added_cb), &signals);
+	g_signal_connect (fixture->tree, "directory-updated",
+	                  G_CALLBACK (directory_updated_cb), &signals);
+
+	/* Nothing to notify without roots */
+	globs = g_slist_append (globs, "*.o");
+	tracker_indexing_tree_set_filters (fixture->tree, TRACKER_FILTER_FILE, globs);
+	g_assert_cmpuint (signals.filters_added, ==, 0);
+
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_A],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	signals.directories_updated = 0;
+
+	/* Unchanged filters */
+	tracker_indexing_tree_set_filters (fixture->tree, TRACKER_FILTER_FILE, globs);
+	g_assert_cmpuint (signals.filters_added, ==, 0);
+	g_assert_cmpuint (signals.directories_updated, ==, 0);
+
+	globs = g_slist_append (globs, (gpointer) bak);
+	globs = g_slist_append (globs, "core");
+	tracker_indexing_tree_set_filters (fixture->tree, TRACKER_FILTER_FILE, globs);
+	g_assert_cmpuint (signals.filters_added, ==, 1);
+	g_assert_cmpuint (signals.n_globs, ==, 2);
+	g_assert_cmpuint (signals.directories_updated, ==, 0);
+
+	file = g_file_new_for_path ("/A/notes.bak");
+	g_assert_true (tracker_indexing_tree_file_matches_filter (fixture->tree,
+	                                                          TRACKER_FILTER_FILE,
+	                                                          file));
+
+	/* Removed filters need the roots checked again */
+	globs = g_slist_remove (globs, bak);
+	tracker_indexing_tree_set_filters (fixture->tree, TRACKER_FILTER_FILE, globs);
+	g_assert_cmpuint (signals.filters_added, ==, 1);
+	g_assert_cmpuint (signals.directories_updated, ==, 1);
+	g_assert_false (tracker_indexing_tree_file_matches_filter (fixture->tree,
+	                                                           TRACKER_FILTER_FILE,
+	                                                           file));
+
+	g_signal_handlers_disconnect_by_data (fixture->tree, &signals);
+	g_slist_free (globs);
+}
+
+/* Directory content markers are looked up by name, so they can be
+ * matched against the names returned by enumerating a directory.
+ */
+static void
+test_indexing_tree_033 (TestCommonContext *fixture,
+                        gconstpointer      data)
+{
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_PARENT_DIRECTORY, ".nomedia");
+	tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_PARENT_DIRECTORY, "CACHEDIR.TAG");
+
+	g_assert_true (tracker_indexing_tree_name_matches_filter (fixture->tree,
+	                                                          TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                          ".nomedia"));
+	g_assert_true (tracker_indexing_tree_name_matches_filter (fixture->tree,
+	                                                          TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                          "CACHEDIR.TAG"));
+	g_assert_false (tracker_indexing_tree_name_matches_filter (fixture->tree,
+	                                                           TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                           "nomedia"));
+	g_assert_false (tracker_indexing_tree_name_matches_filter (fixture->tree,
+	                                                           TRACKER_FILTER_FILE,
+	                                                           ".nomedia"));
+
+	tracker_indexing_tree_clear_filters (fixture->tree, TRACKER_FILTER_PARENT_DIRECTORY);
+	g_assert_false (tracker_indexing_tree_name_matches_filter (fixture->tree,
+	                                                           TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                           ".nomedia"));
+}
+
+typedef struct {
+	guint added;
+	guint removed;
+	guint updated;
+	gboolean removed_was_root;
+} UpdateSignals;
+
+static void
+update_added_cb (TrackerIndexingTree *tree,
+                 GFile               *directory,
+                 UpdateSignals       *signals)
+{
+	signals->added++;
+}
+
+static void
+update_removed_cb (TrackerIndexingTree *tree,
+                   GFile               *directory,
+                   UpdateSignals       *signals)
+{
+	/* Handlers query the flags of removed directories */
+	signals->removed_was_root = tracker_indexing_tree_file_is_root (tree, directory);
+	signals->removed++;
+}
+
+static void
+update_updated_cb (TrackerIndexingTree *tree,
+                   GFile               *directory,
+                   UpdateSignals       *signals)
+{
+	signals->updated++;
+}
+
+/* Changes within an update are signalled once it ends, by their
+ * difference to the tree before it.
+ */
+static void
+test_indexing_tree_034 (TestCommonContext *fixture,
+                        gconstpointer      data)
+{
+	UpdateSignals signals = { 0, };
+
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AA],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AB],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	g_signal_connect (fixture->tree, "directory-added",
+	                  G_CALLBACK (update_added_cb), &signals);
+	g_signal_connect (fixture->tree, "directory-removed",
+	                  G_CALLBACK (update_removed_cb), &signals);
+	g_signal_connect (fixture->tree, "directory-updated",
+	                  G_CALLBACK (update_updated_cb), &signals);
+
+	tracker_indexing_tree_begin_update (fixture->tree);
+
+	/* Removed and added back */
+	tracker_indexing_tree_remove (fixture->tree,
+	                              fixture->test_dir[TEST_DIRECTORY_AA]);
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AA],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	/* Added and removed */
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AAB],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_indexing_tree_remove (fixture->tree,
+	                              fixture->test_dir[TEST_DIRECTORY_AAB]);
+
+	/* Added, in a nested update */
+	tracker_indexing_tree_begin_update (fixture->tree);
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AAA],
+	                           TRACKER_DIRECTORY_FLAG_NONE);
+	tracker_indexing_tree_end_update (fixture->tree);
+
+	/* Removed */
+	tracker_indexing_tree_remove (fixture->tree,
+	                              fixture->test_dir[TEST_DIRECTORY_AB]);
+
+	g_assert_cmpuint (signals.added, ==, 0);
+	g_assert_cmpuint (signals.removed, ==, 0);
+	g_assert_cmpuint (signals.updated, ==, 0);
+
+	tracker_indexing_tree_end_update (fixture->tree);
+
+	g_assert_cmpuint (signals.added, ==, 1);
+	g_assert_cmpuint (signals.removed, ==, 1);
+	g_assert_cmpuint (signals.updated, ==, 1);
+	g_assert_true (signals.removed_was_root);
+
+	g_assert_true (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                                   fixture->test_dir[TEST_DIRECTORY_AA]));
+	g_assert_true (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                                   fixture->test_dir[TEST_DIRECTORY_AAA]));
+	g_assert_false (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                                    fixture->test_dir[TEST_DIRECTORY_AAB]));
+	g_assert_false (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                                    fixture->test_dir[TEST_DIRECTORY_AB]));
+	ASSERT_INDEXABLE (fixture, TEST_DIRECTORY_AAB);
+	ASSERT_NOT_INDEXABLE (fixture, TEST_DIRECTORY_ABA);
+
+	g_signal_handlers_disconnect_by_data (fixture->tree, &signals);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -981,6 +1255,10 @@ main (gint    argc,
 	test_add ("/libtracker-miner/indexing-tree/028", test_indexing_tree_028);
 	test_add ("/libtracker-miner/indexing-tree/029", test_indexing_tree_029);
 	test_add ("/libtracker-miner/indexing-tree/030", test_indexing_tree_030);
+	test_add ("/libtracker-miner/indexing-tree/031", test_indexing_tree_031);
+	test_add ("/libtracker-miner/indexing-tree/032", test_indexing_tree_032);
+	test_add ("/libtracker-miner/indexing-tree/033", test_indexing_tree_033);
+	test_add ("/libtracker-miner/indexing-tree/034", test_indexing_tree_034);
 
 	return g_test_run ();
 }
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2024, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ */
+#include <glib.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-lru.h>
+
+static TrackerLRU *
+create_lru (guint size)
+{
+	return tracker_lru_new (size, g_str_hash, g_str_equal,
+	                        g_free, g_free);
+}
+
+static void
+test_lru_find (void)
+{
+	TrackerLRU *lru;
+	gpointer data;
+	guint hits, misses;
+
+	lru = create_lru (3);
+
+	tracker_lru_add (lru, g_strdup ("a"), g_strdup ("1"));
+	tracker_lru_add (lru, g_strdup ("b"), g_strdup ("2"));
+
+	g_assert_true (tracker_lru_find (lru, "a", &data));
+	g_assert_cmpstr (data, ==, "1");
+	g_assert_true (tracker_lru_find (lru, "b", &data));
+	g_assert_cmpstr (data, ==, "2");
+	g_assert_false (tracker_lru_find (lru, "c", &data));
+
+	/* Replacing existing elements */
+	tracker_lru_add (lru, g_strdup ("a"), g_strdup ("3"));
+	g_assert_true (tracker_lru_find (lru, "a", &data));
+	g_assert_cmpstr (data, ==, "3");
+
+	tracker_lru_get_stats (lru, &hits, &misses);
+	g_assert_cmpuint (hits, ==, 3);
+	g_assert_cmpuint (misses, ==, 1);
+
+	tracker_lru_remove (lru, "a");
+	g_assert_false (tracker_lru_find (lru, "a", NULL));
+
+	tracker_lru_unref (lru);
+}
+
+static void
+test_lru_eviction (void)
+{
+	TrackerLRU *lru;
+	gchar *elem;
+	guint i;
+
+	lru = create_lru (3);
+
+	tracker_lru_add (lru, g_strdup ("a"), g_strdup ("1"));
+	tracker_lru_add (lru, g_strdup ("b"), g_strdup ("2"));
+	tracker_lru_add (lru, g_strdup ("c"), g_strdup ("3"));
+
+	/* All elements are recently used, the first sweep clears
+	 * the referenced bits and "a" is evicted.
+	 */
+	tracker_lru_add (lru, g_strdup ("d"), g_strdup ("4"));
+	g_assert_false (tracker_lru_find (lru, "a", NULL));
+
+	/* "b" is used again, so "c" goes next */
+	g_assert_true (tracker_lru_find (lru, "b", NULL));
+	tracker_lru_add (lru, g_strdup ("e"), g_strdup ("5"));
+	g_assert_true (tracker_lru_find (lru, "b", NULL));
+	g_assert_false (tracker_lru_find (lru, "c", NULL));
+	g_assert_true (tracker_lru_find (lru, "d", NULL));
+	g_assert_true (tracker_lru_find (lru, "e", NULL));
+
+	/* The cache never grows beyond its size */
+	for (i = 0; i < 100; i++) {
+		elem = g_strdup_printf ("%d", i);
+		tracker_lru_add (lru, elem, g_strdup (elem));
+	}
+
+	g_assert_cmpuint (tracker_lru_get_size (lru), ==, 3);
+	g_assert_true (tracker_lru_find (lru, "99", NULL));
+	g_assert_false (tracker_lru_find (lru, "0", NULL));
+
+	tracker_lru_unref (lru);
+}
+
+static gboolean
+has_prefix (gconstpointer elem,
+            gconstpointer prefix)
+{
+	return g_str_has_prefix (elem, prefix);
+}
+
+static void
+test_lru_remove_foreach (void)
+{
+	TrackerLRU *lru;
+
+	lru = create_lru (5);
+
+	tracker_lru_add (lru, g_strdup ("/a/1"), g_strdup ("1"));
+	tracker_lru_add (lru, g_strdup ("/a/2"), g_strdup ("2"));
+	tracker_lru_add (lru, g_strdup ("/b/1"), g_strdup ("3"));
+
+	tracker_lru_remove_foreach (lru, has_prefix, "/a/");
+
+	g_assert_false (tracker_lru_find (lru, "/a/1", NULL));
+	g_assert_false (tracker_lru_find (lru, "/a/2", NULL));
+	g_assert_true (tracker_lru_find (lru, "/b/1", NULL));
+
+	tracker_lru_unref (lru);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-lru/find",
+	                 test_lru_find);
+	g_test_add_func ("/libtracker-miner/tracker-lru/eviction",
+	                 test_lru_eviction);
+	g_test_add_func ("/libtracker-miner/tracker-lru/remove-foreach",
+	                 test_lru_remove_foreach);
+
+	return g_test_run ();
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <glib.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-mem-pool.h>
+
+typedef struct {
+	gpointer ptr;
+	guint64 value;
+	guint16 flags;
+} TestElem;
+
+static void
+test_mem_pool_alloc_recycle (void)
+{
+	TrackerMemPool *pool;
+	GPtrArray *elems;
+	TestElem *elem, *reused;
+	guint i, n_elems = 50000;
+
+	pool = tracker_mem_pool_new ("test-alloc", sizeof (TestElem));
+	elems = g_ptr_array_new ();
+
+	/* Enough elements to need several slabs */
+	for (i = 0; i < n_elems; i++) {
+		elem = tracker_mem_pool_alloc0 (pool);
+		g_assert_null (elem->ptr);
+		g_assert_cmpuint (elem->value, ==, 0);
+		g_assert_cmpuint (elem->flags, ==, 0);
+		elem->value = i;
+		elem->flags = 0xffff;
+		g_ptr_array_add (elems, elem);
+	}
+
+	for (i = 0; i < n_elems; i++) {
+		elem = g_ptr_array_index (elems, i);
+		g_assert_cmpuint (elem->value, ==, i);
+	}
+
+	/* Live elements keep the slabs around */
+	g_assert_cmpuint (tracker_mem_pool_trim (pool), ==, 0);
+
+	/* Recycled elements are handed out again, zeroed */
+	elem = g_ptr_array_index (elems, 0);
+	tracker_mem_pool_recycle (pool, elem);
+	reused = tracker_mem_pool_alloc0 (pool);
+	g_assert_true (reused == elem);
+	g_assert_cmpuint (reused->value, ==, 0);
+	g_assert_cmpuint (reused->flags, ==, 0);
+
+	for (i = 0; i < n_elems; i++)
+		tracker_mem_pool_recycle (pool, g_ptr_array_index (elems, i));
+
+	g_ptr_array_unref (elems);
+	g_assert_cmpuint (tracker_mem_pool_trim (pool), >=, n_elems * sizeof (TestElem));
+	g_assert_cmpuint (tracker_mem_pool_trim (pool), ==, 0);
+}
+
+static void
+test_mem_pool_trim_reuse (void)
+{
+	TrackerMemPool *pool;
+	TestElem *elem;
+	guint i;
+
+	pool = tracker_mem_pool_new ("test-trim", sizeof (TestElem));
+
+	/* Pools are usable again after being trimmed */
+	for (i = 0; i < 3; i++) {
+		elem = tracker_mem_pool_alloc0 (pool);
+		g_assert_nonnull (elem);
+		g_assert_cmpuint (elem->value, ==, 0);
+		elem->value = G_MAXUINT64;
+		tracker_mem_pool_recycle (pool, elem);
+		g_assert_cmpuint (tracker_mem_pool_trim (pool), >, 0);
+	}
+
+	tracker_mem_pool_recycle (pool, NULL);
+	g_assert_cmpuint (tracker_mem_pool_trim_all (), ==, 0);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-mem-pool/alloc-recycle",
+	                 test_mem_pool_alloc_recycle);
+	g_test_add_func ("/libtracker-miner/tracker-mem-pool/trim-reuse",
+	                 test_mem_pool_trim_reuse);
+
+	return g_test_run ();
+}
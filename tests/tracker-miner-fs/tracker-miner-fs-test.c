@@ -93,7 +93,7 @@ test_miner_process_file (TrackerMinerFS      *miner,
 	g_free (parent_uri);
 	g_object_unref (parent);
 
-	tracker_sparql_buffer_log_file (buffer, file, "tracker:FileSystem", resource, NULL);
+	tracker_sparql_buffer_log_file (buffer, file, "tracker:FileSystem", resource, NULL, NULL);
 	g_object_unref (resource);
 	g_free (uri);
 }
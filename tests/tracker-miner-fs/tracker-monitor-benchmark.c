@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Monitor benchmarks: a thread generates create, modify, move and
+ * delete storms over monitored directories at a given rate, while the
+ * main loop receives the monitor signals. Reports event latency,
+ * operations that were merged into another event or never got one,
+ * overflows, and the CPU time spent on the main thread.
+ *
+ *   tracker-monitor-benchmark --backend=fanotify --rate=5000
+ */
+
+#include "config-miners.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libtracker-miners-common/tracker-common.h>
+
+#include "tracker-monitor-glib.h"
+#ifdef HAVE_FANOTIFY
+#include "tracker-monitor-fanotify.h"
+#endif
+
+#define METRIC_EVENT_LATENCY "monitor-event"
+#define SETTLE_USEC (2 * G_USEC_PER_SEC)
+
+typedef enum {
+	OP_CREATE,
+	OP_MODIFY,
+	OP_MOVE,
+	OP_DELETE,
+	N_OPS,
+} Operation;
+
+typedef struct {
+	TrackerMonitor *monitor;
+	gchar *root_path;
+	GThread *generator;
+	GMainLoop *main_loop;
+
+	/* Path -> GArray of timestamps of operations without an event */
+	GMutex mutex;
+	GHashTable *pending;
+	guint n_ops;
+	gint64 generator_time;
+	gint64 generator_cpu;
+	gint done;
+
+	guint n_events;
+	guint n_merged;
+	guint n_unexpected;
+	guint n_overflows;
+	gint64 last_event;
+} Bench;
+
+static gchar *backend = NULL;
+static gint rate = 1000;
+static gint n_files = 1000;
+static gint n_dirs = 10;
+static gint rounds = 5;
+
+static GOptionEntry entries[] = {
+	{ "backend", 'b', 0, G_OPTION_ARG_STRING, &backend,
+	  "Monitor backend (glib, fanotify), defaults to the best available", "NAME" },
+	{ "rate", 'r', 0, G_OPTION_ARG_INT, &rate,
+	  "Operations per second, 0 for as fast as possible", "N" },
+	{ "files", 'f', 0, G_OPTION_ARG_INT, &n_files,
+	  "Number of files operated on", "N" },
+	{ "dirs", 'd', 0, G_OPTION_ARG_INT, &n_dirs,
+	  "Number of monitored directories the files are spread over", "N" },
+	{ "rounds", 'n', 0, G_OPTION_ARG_INT, &rounds,
+	  "Times every file is created, modified, moved and deleted", "N" },
+	{ NULL }
+};
+
+static gint64
+get_thread_cpu_time (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_THREAD, &usage) != 0)
+		return 0;
+
+	return ((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+	        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+static gchar *
+get_file_path (Bench   *bench,
+               guint    idx,
+               gboolean moved)
+{
+	return g_strdup_printf ("%s/dir-%03u/%s-%05u",
+	                        bench->root_path, idx % n_dirs,
+	                        moved ? "moved" : "file", idx);
+}
+
+static void
+add_pending (Bench       *bench,
+             const gchar *path,
+             gint64       timestamp)
+{
+	GArray *timestamps;
+
+	timestamps = g_hash_table_lookup (bench->pending, path);
+	if (!timestamps) {
+		timestamps = g_array_new (FALSE, FALSE, sizeof (gint64));
+		g_hash_table_insert (bench->pending, g_strdup (path), timestamps);
+	}
+
+	g_array_append_val (timestamps, timestamp);
+}
+
+static void
+write_file (const gchar *path,
+            const gchar *contents)
+{
+	FILE *f;
+
+	f = g_fopen (path, "w");
+	if (!f || fputs (contents, f) < 0 || fclose (f) != 0)
+		g_error ("Could not write %s: %m", path);
+}
+
+static gpointer
+generator_thread (gpointer user_data)
+{
+	Bench *bench = user_data;
+	gint64 start, cpu_start;
+	guint i, n_total;
+
+	n_total = n_files * N_OPS * rounds;
+	start = g_get_monotonic_time ();
+	cpu_start = get_thread_cpu_time ();
+
+	/* Every round creates, then modifies, then moves, then deletes
+	 * all files, so operations on the same file are spread apart.
+	 */
+	for (i = 0; i < n_total; i++) {
+		g_autofree gchar *path = NULL, *moved_path = NULL;
+		Operation op = (i / n_files) % N_OPS;
+		guint idx = i % n_files;
+
+		if (rate > 0) {
+			gint64 due = start + (gint64) i * G_USEC_PER_SEC / rate;
+			gint64 now = g_get_monotonic_time ();
+
+			if (due > now)
+				g_usleep (due - now);
+		}
+
+		path = get_file_path (bench, idx, FALSE);
+		moved_path = get_file_path (bench, idx, TRUE);
+
+		/* Register the operation first, the event may be
+		 * received before the call below returns.
+		 */
+		g_mutex_lock (&bench->mutex);
+		add_pending (bench,
+		             op == OP_DELETE ? moved_path : path,
+		             g_get_monotonic_time ());
+		bench->n_ops++;
+		g_mutex_unlock (&bench->mutex);
+
+		switch (op) {
+		case OP_CREATE:
+			write_file (path, "created");
+			break;
+		case OP_MODIFY:
+			write_file (path, "modified");
+			break;
+		case OP_MOVE:
+			if (g_rename (path, moved_path) < 0)
+				g_error ("Could not move %s: %m", path);
+			break;
+		case OP_DELETE:
+			if (g_unlink (moved_path) < 0)
+				g_error ("Could not delete %s: %m", moved_path);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+
+	bench->generator_time = g_get_monotonic_time () - start;
+	bench->generator_cpu = get_thread_cpu_time () - cpu_start;
+	g_atomic_int_set (&bench->done, TRUE);
+
+	return NULL;
+}
+
+/* An event accounts for all operations on the file that happened
+ * before it, the oldest one gives the latency and the others count
+ * as merged into it.
+ */
+static gboolean
+consume_pending (Bench  *bench,
+                 GFile  *file,
+                 gint64  now)
+{
+	g_autofree gchar *path = NULL;
+	GArray *timestamps;
+	gboolean found = FALSE;
+
+	path = g_file_get_path (file);
+
+	g_mutex_lock (&bench->mutex);
+
+	timestamps = g_hash_table_lookup (bench->pending, path);
+
+	if (timestamps && timestamps->len > 0) {
+		tracker_metrics_record (METRIC_EVENT_LATENCY,
+		                        now - g_array_index (timestamps, gint64, 0));
+		bench->n_merged += timestamps->len - 1;
+		g_hash_table_remove (bench->pending, path);
+		found = TRUE;
+	}
+
+	g_mutex_unlock (&bench->mutex);
+
+	return found;
+}
+
+static void
+handle_event (Bench *bench,
+              GFile *file,
+              GFile *other_file)
+{
+	gint64 now = g_get_monotonic_time ();
+	gboolean found;
+
+	found = consume_pending (bench, file, now);
+	if (other_file)
+		found |= consume_pending (bench, other_file, now);
+
+	if (found)
+		bench->n_events++;
+	else
+		bench->n_unexpected++;
+
+	bench->last_event = now;
+}
+
+static void
+item_event_cb (TrackerMonitor *monitor,
+               GFile          *file,
+               gboolean        is_dir,
+               Bench          *bench)
+{
+	handle_event (bench, file, NULL);
+}
+
+static void
+item_moved_cb (TrackerMonitor *monitor,
+               GFile          *file,
+               GFile          *other_file,
+               gboolean        is_dir,
+               gboolean        is_source_monitored,
+               Bench          *bench)
+{
+	handle_event (bench, file, other_file);
+}
+
+static void
+overflow_cb (TrackerMonitor *monitor,
+             GFile          *file,
+             Bench          *bench)
+{
+	bench->n_overflows++;
+}
+
+static gboolean
+check_settled_cb (gpointer user_data)
+{
+	Bench *bench = user_data;
+
+	if (!g_atomic_int_get (&bench->done))
+		return G_SOURCE_CONTINUE;
+
+	if (g_get_monotonic_time () - bench->last_event < SETTLE_USEC)
+		return G_SOURCE_CONTINUE;
+
+	g_main_loop_quit (bench->main_loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static TrackerMonitor *
+create_monitor (GError **error)
+{
+	if (!backend)
+		return tracker_monitor_new (error);
+
+	if (g_strcmp0 (backend, "glib") == 0)
+		return g_initable_new (TRACKER_TYPE_MONITOR_GLIB, NULL, error, NULL);
+
+#ifdef HAVE_FANOTIFY
+	if (g_strcmp0 (backend, "fanotify") == 0)
+		return g_initable_new (TRACKER_TYPE_MONITOR_FANOTIFY, NULL, error, NULL);
+#endif
+
+	g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+	             "Unknown or unavailable monitor backend “%s”", backend);
+
+	return NULL;
+}
+
+static void
+bench_setup (Bench *bench)
+{
+	g_autofree gchar *path = NULL;
+	g_autoptr (GError) error = NULL;
+	gint i;
+
+	path = g_build_filename (g_get_tmp_dir (), "tracker-monitor-benchmark-XXXXXX", NULL);
+	if (!g_mkdtemp_full (path, 0700))
+		g_error ("Could not create temporary directory: %m");
+
+	bench->root_path = g_steal_pointer (&path);
+	bench->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                        (GDestroyNotify) g_array_unref);
+	g_mutex_init (&bench->mutex);
+	bench->main_loop = g_main_loop_new (NULL, FALSE);
+
+	bench->monitor = create_monitor (&error);
+	if (!bench->monitor)
+		g_error ("Could not create monitor: %s", error->message);
+
+	g_signal_connect (bench->monitor, "item-created",
+	                  G_CALLBACK (item_event_cb), bench);
+	g_signal_connect (bench->monitor, "item-updated",
+	                  G_CALLBACK (item_event_cb), bench);
+	g_signal_connect (bench->monitor, "item-attribute-updated",
+	                  G_CALLBACK (item_event_cb), bench);
+	g_signal_connect (bench->monitor, "item-deleted",
+	                  G_CALLBACK (item_event_cb), bench);
+	g_signal_connect (bench->monitor, "item-moved",
+	                  G_CALLBACK (item_moved_cb), bench);
+	g_signal_connect (bench->monitor, "overflow",
+	                  G_CALLBACK (overflow_cb), bench);
+
+	for (i = 0; i < n_dirs; i++) {
+		g_autofree gchar *dir_path = NULL;
+		g_autoptr (GFile) dir = NULL;
+
+		dir_path = g_strdup_printf ("%s/dir-%03d", bench->root_path, i);
+		if (g_mkdir (dir_path, 0700) < 0)
+			g_error ("Could not create %s: %m", dir_path);
+
+		dir = g_file_new_for_path (dir_path);
+		tracker_monitor_add (bench->monitor, dir);
+	}
+}
+
+static void
+bench_teardown (Bench *bench)
+{
+	g_autofree gchar *command = NULL;
+
+	g_clear_object (&bench->monitor);
+	g_clear_pointer (&bench->main_loop, g_main_loop_unref);
+	g_clear_pointer (&bench->pending, g_hash_table_unref);
+	g_mutex_clear (&bench->mutex);
+
+	command = g_strdup_printf ("rm -rf '%s'", bench->root_path);
+	if (system (command) != 0)
+		g_warning ("Could not remove %s", bench->root_path);
+
+	g_free (bench->root_path);
+}
+
+static void
+bench_print_results (Bench  *bench,
+                     gint64  main_cpu)
+{
+	g_autoptr (GVariant) snapshot = NULL;
+	g_autofree gchar *table = NULL;
+	GHashTableIter iter;
+	GArray *timestamps;
+	guint n_dropped = 0;
+	struct rusage usage;
+
+	g_hash_table_iter_init (&iter, bench->pending);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &timestamps))
+		n_dropped += timestamps->len;
+
+	g_print ("Backend: %s, %u operations over %d directories in %.3f s\n",
+	         G_OBJECT_TYPE_NAME (bench->monitor), bench->n_ops, n_dirs,
+	         bench->generator_time / (gdouble) G_USEC_PER_SEC);
+	g_print ("%-24s %8u\n", "events", bench->n_events);
+	g_print ("%-24s %8u\n", "merged operations", bench->n_merged);
+	g_print ("%-24s %8u\n", "operations without event", n_dropped);
+	g_print ("%-24s %8u\n", "unexpected events", bench->n_unexpected);
+	g_print ("%-24s %8u\n", "overflows", bench->n_overflows);
+	g_print ("%-24s %8.3f s\n", "main loop CPU",
+	         main_cpu / (gdouble) G_USEC_PER_SEC);
+	g_print ("%-24s %8.3f s\n", "generator CPU",
+	         bench->generator_cpu / (gdouble) G_USEC_PER_SEC);
+
+	if (getrusage (RUSAGE_SELF, &usage) == 0)
+		g_print ("%-24s %8ld kB\n", "peak RSS", usage.ru_maxrss);
+
+	snapshot = g_variant_ref_sink (tracker_metrics_get_snapshot ());
+	table = tracker_metrics_snapshot_to_string (snapshot);
+	g_print ("\n%s", table);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_autoptr (GOptionContext) context = NULL;
+	g_autoptr (GError) error = NULL;
+	Bench bench = { 0, };
+	gint64 cpu_start;
+
+	context = g_option_context_new ("- Benchmark file monitor event storms");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (rate < 0 || n_files < 1 || n_dirs < 1 || rounds < 1) {
+		g_printerr ("Invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	bench_setup (&bench);
+
+	cpu_start = get_thread_cpu_time ();
+	bench.last_event = g_get_monotonic_time ();
+
+	bench.generator = g_thread_new ("generator", generator_thread, &bench);
+	g_timeout_add (100, check_settled_cb, &bench);
+	g_main_loop_run (bench.main_loop);
+	g_thread_join (bench.generator);
+
+	bench_print_results (&bench, get_thread_cpu_time () - cpu_start);
+	bench_teardown (&bench);
+
+	return EXIT_SUCCESS;
+}
@@ -24,6 +24,7 @@
 #include <glib/gstdio.h>
 
 #include <tracker-monitor.h>
+#include <tracker-monitor-glib.h>
 
 /* -------------- COMMON FOR ALL FILE EVENT TESTS ----------------- */
 
@@ -1332,6 +1333,111 @@ test_monitor_basic (void)
 	g_object_unref (monitor);
 }
 
+static void
+test_monitor_batch (void)
+{
+	TrackerMonitor *monitor;
+	gchar *basename, *path, *path1, *path2;
+	GFile *file, *file1, *file2;
+	GError *error = NULL;
+
+	basename = g_strdup_printf ("monitor-batch-test-%d", getpid ());
+	path = g_build_path (G_DIR_SEPARATOR_S, g_get_tmp_dir (), basename, NULL);
+	path1 = g_build_path (G_DIR_SEPARATOR_S, path, "a", NULL);
+	path2 = g_build_path (G_DIR_SEPARATOR_S, path, "b", NULL);
+	g_free (basename);
+	g_assert_cmpint (g_mkdir_with_parents (path1, 00755), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (path2, 00755), ==, 0);
+
+	file = g_file_new_for_path (path);
+	file1 = g_file_new_for_path (path1);
+	file2 = g_file_new_for_path (path2);
+
+	monitor = tracker_monitor_new (&error);
+	g_assert_no_error (error);
+
+	tracker_monitor_begin_batch (monitor);
+	g_assert_true (tracker_monitor_add (monitor, file1));
+	g_assert_true (tracker_monitor_add (monitor, file2));
+	g_assert_true (tracker_monitor_remove (monitor, file1));
+	g_assert_true (tracker_monitor_add (monitor, file1));
+	tracker_monitor_end_batch (monitor);
+
+	g_assert_cmpint (tracker_monitor_get_count (monitor), ==, 2);
+	g_assert_true (tracker_monitor_is_watched (monitor, file1));
+	g_assert_true (tracker_monitor_is_watched (monitor, file2));
+
+	g_assert_true (tracker_monitor_remove_recursively (monitor, file));
+	g_assert_cmpint (tracker_monitor_get_count (monitor), ==, 0);
+
+	g_object_unref (monitor);
+
+	g_assert_cmpint (g_rmdir (path1), ==, 0);
+	g_assert_cmpint (g_rmdir (path2), ==, 0);
+	g_assert_cmpint (g_rmdir (path), ==, 0);
+	g_object_unref (file);
+	g_object_unref (file1);
+	g_object_unref (file2);
+	g_free (path);
+	g_free (path1);
+	g_free (path2);
+}
+
+static void
+test_monitor_watch_budget (void)
+{
+	TrackerMonitor *monitor;
+	gchar *basename, *path, *path1, *path2;
+	GFile *file, *file1, *file2;
+	GError *error = NULL;
+
+	basename = g_strdup_printf ("monitor-budget-test-%d", getpid ());
+	path = g_build_path (G_DIR_SEPARATOR_S, g_get_tmp_dir (), basename, NULL);
+	path1 = g_build_path (G_DIR_SEPARATOR_S, path, "a", NULL);
+	path2 = g_build_path (G_DIR_SEPARATOR_S, path, "b", NULL);
+	g_free (basename);
+	g_assert_cmpint (g_mkdir_with_parents (path1, 00755), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (path2, 00755), ==, 0);
+
+	file = g_file_new_for_path (path);
+	file1 = g_file_new_for_path (path1);
+	file2 = g_file_new_for_path (path2);
+
+	monitor = g_initable_new (TRACKER_TYPE_MONITOR_GLIB, NULL, &error, NULL);
+	g_assert_no_error (error);
+
+	tracker_monitor_set_watch_budget (monitor, 1);
+	g_assert_cmpint (tracker_monitor_get_limit (monitor), ==, 1);
+
+	/* Directories over the budget are checked periodically instead */
+	g_assert_true (tracker_monitor_add (monitor, file1));
+	g_assert_true (tracker_monitor_add (monitor, file2));
+	g_assert_cmpint (tracker_monitor_get_count (monitor), ==, 1);
+	g_assert_cmpint (tracker_monitor_get_ignored (monitor), ==, 1);
+	g_assert_true (tracker_monitor_is_watched (monitor, file1));
+	g_assert_false (tracker_monitor_is_watched (monitor, file2));
+
+	g_assert_true (tracker_monitor_remove (monitor, file2));
+	g_assert_cmpint (tracker_monitor_get_ignored (monitor), ==, 0);
+
+	g_assert_true (tracker_monitor_add (monitor, file2));
+	g_assert_true (tracker_monitor_remove_recursively (monitor, file));
+	g_assert_cmpint (tracker_monitor_get_count (monitor), ==, 0);
+	g_assert_cmpint (tracker_monitor_get_ignored (monitor), ==, 0);
+
+	g_object_unref (monitor);
+
+	g_assert_cmpint (g_rmdir (path1), ==, 0);
+	g_assert_cmpint (g_rmdir (path2), ==, 0);
+	g_assert_cmpint (g_rmdir (path), ==, 0);
+	g_object_unref (file);
+	g_object_unref (file1);
+	g_object_unref (file2);
+	g_free (path);
+	g_free (path1);
+	g_free (path2);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -1343,6 +1449,10 @@ main (gint    argc,
 	/* Basic API tests */
 	g_test_add_func ("/libtracker-miner/tracker-monitor/basic",
 	                 test_monitor_basic);
+	g_test_add_func ("/libtracker-miner/tracker-monitor/watch-budget",
+	                 test_monitor_watch_budget);
+	g_test_add_func ("/libtracker-miner/tracker-monitor/batch",
+	                 test_monitor_batch);
 
 	/* File Event tests */
 	g_test_add ("/libtracker-miner/tracker-monitor/file-event/created",
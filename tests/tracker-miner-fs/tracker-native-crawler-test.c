@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-native-crawler.h>
+
+#define ATTRIBUTES	  \
+	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE
+
+#if defined (HAVE_STATX) && defined (HAVE_GETDENTS64)
+
+static void
+enumerate_cb (GObject      *object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+	GAsyncResult **result = user_data;
+
+	*result = g_object_ref (res);
+}
+
+static GHashTable *
+enumerate_gio (GFile *directory)
+{
+	g_autoptr (GFileEnumerator) enumerator = NULL;
+	g_autoptr (GError) error = NULL;
+	GHashTable *infos;
+	GFileInfo *info;
+
+	infos = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	enumerator = g_file_enumerate_children (directory, ATTRIBUTES,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        NULL, &error);
+	g_assert_no_error (error);
+
+	while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+		g_hash_table_insert (infos, (gpointer) g_file_info_get_name (info), info);
+
+	g_assert_no_error (error);
+
+	return infos;
+}
+
+static void
+test_native_crawler_attributes (void)
+{
+	g_assert_true (tracker_native_crawler_supports_attributes (ATTRIBUTES));
+	g_assert_false (tracker_native_crawler_supports_attributes ("standard::*"));
+	g_assert_false (tracker_native_crawler_supports_attributes (G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE));
+}
+
+static void
+test_native_crawler_enumerate (void)
+{
+	g_autofree gchar *path = NULL, *subdir = NULL, *link = NULL;
+	g_autoptr (GFile) directory = NULL;
+	g_autoptr (GAsyncResult) res = NULL;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GHashTable) expected = NULL;
+	g_autoptr (GError) error = NULL;
+	const gchar *files[] = { "a.txt", ".hidden-file", "listed", ".hidden" };
+	guint i;
+
+	path = g_dir_make_tmp ("tracker-native-crawler-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		g_autofree gchar *file_path = NULL;
+
+		file_path = g_build_filename (path, files[i], NULL);
+		g_file_set_contents (file_path,
+		                     g_str_equal (files[i], ".hidden") ? "listed\n" : "content",
+		                     -1, &error);
+		g_assert_no_error (error);
+	}
+
+	subdir = g_build_filename (path, "subdir", NULL);
+	g_assert_cmpint (g_mkdir (subdir, 0700), ==, 0);
+	link = g_build_filename (path, "link", NULL);
+	g_assert_cmpint (symlink ("a.txt", link), ==, 0);
+
+	directory = g_file_new_for_path (path);
+	tracker_native_crawler_enumerate_async (directory, ATTRIBUTES, FALSE, NULL,
+	                                        enumerate_cb, &res);
+	while (!res)
+		g_main_context_iteration (NULL, TRUE);
+
+	infos = tracker_native_crawler_enumerate_finish (directory, res, &error);
+	g_assert_no_error (error);
+
+	expected = enumerate_gio (directory);
+	g_assert_cmpuint (infos->len, ==, g_hash_table_size (expected));
+
+	for (i = 0; i < infos->len; i++) {
+		GFileInfo *info = g_ptr_array_index (infos, i), *gio_info;
+		g_autoptr (GDateTime) mtime = NULL, gio_mtime = NULL;
+
+		gio_info = g_hash_table_lookup (expected, g_file_info_get_name (info));
+		g_assert_nonnull (gio_info);
+
+		g_assert_cmpint (g_file_info_get_file_type (info), ==,
+		                 g_file_info_get_file_type (gio_info));
+		g_assert_cmpint (g_file_info_get_size (info), ==,
+		                 g_file_info_get_size (gio_info));
+		g_assert_cmpint (g_file_info_get_is_hidden (info), ==,
+		                 g_file_info_get_is_hidden (gio_info));
+		g_assert_cmpstr (g_file_info_get_display_name (info), ==,
+		                 g_file_info_get_display_name (gio_info));
+		g_assert_cmpstr (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM), ==,
+		                 g_file_info_get_attribute_string (gio_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM));
+		g_assert_cmpuint (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE), ==,
+		                  g_file_info_get_attribute_uint64 (gio_info, G_FILE_ATTRIBUTE_UNIX_INODE));
+		g_assert_cmpint (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT), ==,
+		                 g_file_info_get_attribute_boolean (gio_info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT));
+
+		mtime = g_file_info_get_modification_date_time (info);
+		gio_mtime = g_file_info_get_modification_date_time (gio_info);
+		g_assert_true (g_date_time_equal (mtime, gio_mtime));
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		g_autofree gchar *file_path = NULL;
+
+		file_path = g_build_filename (path, files[i], NULL);
+		g_remove (file_path);
+	}
+
+	g_remove (link);
+	g_rmdir (subdir);
+	g_rmdir (path);
+}
+
+static void
+test_native_crawler_inode_order (void)
+{
+	g_autofree gchar *path = NULL;
+	g_autoptr (GFile) directory = NULL;
+	g_autoptr (GAsyncResult) res = NULL;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GError) error = NULL;
+	guint64 last_inode = 0;
+	guint i;
+
+	path = g_dir_make_tmp ("tracker-native-crawler-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < 50; i++) {
+		g_autofree gchar *name = NULL, *file_path = NULL;
+
+		name = g_strdup_printf ("file-%u", (i * 37) % 50);
+		file_path = g_build_filename (path, name, NULL);
+		g_file_set_contents (file_path, "content", -1, &error);
+		g_assert_no_error (error);
+	}
+
+	directory = g_file_new_for_path (path);
+	tracker_native_crawler_enumerate_async (directory, ATTRIBUTES, TRUE, NULL,
+	                                        enumerate_cb, &res);
+	while (!res)
+		g_main_context_iteration (NULL, TRUE);
+
+	infos = tracker_native_crawler_enumerate_finish (directory, res, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (infos->len, ==, 50);
+
+	for (i = 0; i < infos->len; i++) {
+		GFileInfo *info = g_ptr_array_index (infos, i);
+		g_autofree gchar *file_path = NULL;
+		guint64 inode;
+
+		inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+		g_assert_cmpuint (inode, >, last_inode);
+		last_inode = inode;
+
+		file_path = g_build_filename (path, g_file_info_get_name (info), NULL);
+		g_remove (file_path);
+	}
+
+	g_rmdir (path);
+}
+
+#endif /* HAVE_STATX && HAVE_GETDENTS64 */
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+#if defined (HAVE_STATX) && defined (HAVE_GETDENTS64)
+	g_test_add_func ("/libtracker-miner/tracker-native-crawler/attributes",
+	                 test_native_crawler_attributes);
+	g_test_add_func ("/libtracker-miner/tracker-native-crawler/enumerate",
+	                 test_native_crawler_enumerate);
+	g_test_add_func ("/libtracker-miner/tracker-native-crawler/inode-order",
+	                 test_native_crawler_inode_order);
+#endif
+
+	return g_test_run ();
+}
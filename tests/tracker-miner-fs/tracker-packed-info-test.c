@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-packed-info.h>
+
+#define FILE_ATTRIBUTES	  \
+	G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_TIME_CREATED "," \
+	G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE
+
+static void
+check_same_info (GFileInfo *info,
+                 GFileInfo *unpacked)
+{
+	g_auto (GStrv) attributes = NULL, unpacked_attributes = NULL;
+	guint i;
+
+	attributes = g_file_info_list_attributes (info, NULL);
+	unpacked_attributes = g_file_info_list_attributes (unpacked, NULL);
+	g_assert_cmpuint (g_strv_length (attributes), ==,
+	                  g_strv_length (unpacked_attributes));
+
+	for (i = 0; attributes[i]; i++) {
+		g_autofree gchar *value = NULL, *unpacked_value = NULL;
+
+		g_assert_true (g_file_info_has_attribute (unpacked, attributes[i]));
+		g_assert_cmpint (g_file_info_get_attribute_type (info, attributes[i]), ==,
+		                 g_file_info_get_attribute_type (unpacked, attributes[i]));
+
+		value = g_file_info_get_attribute_as_string (info, attributes[i]);
+		unpacked_value = g_file_info_get_attribute_as_string (unpacked, attributes[i]);
+		g_assert_cmpstr (value, ==, unpacked_value);
+	}
+}
+
+static void
+test_packed_info_file (void)
+{
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileIOStream) stream = NULL;
+	g_autoptr (GFileInfo) info = NULL, unpacked = NULL;
+	g_autoptr (GError) error = NULL;
+	TrackerPackedInfo *packed;
+
+	file = g_file_new_tmp ("tracker-packed-info-XXXXXX", &stream, &error);
+	g_assert_no_error (error);
+
+	info = g_file_query_info (file, FILE_ATTRIBUTES,
+	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                          NULL, &error);
+	g_assert_no_error (error);
+
+	packed = tracker_packed_info_new (file, info);
+	g_assert_nonnull (packed);
+
+	unpacked = tracker_packed_info_unpack (packed, file);
+	check_same_info (info, unpacked);
+
+	tracker_packed_info_free (packed);
+	g_file_delete (file, NULL, NULL);
+}
+
+static void
+test_packed_info_names (void)
+{
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileInfo) info = NULL, unpacked = NULL;
+	TrackerPackedInfo *packed;
+
+	file = g_file_new_for_path ("/test/file.txt");
+
+	/* Names different from the basename are kept */
+	info = g_file_info_new ();
+	g_file_info_set_name (info, "other.txt");
+	g_file_info_set_display_name (info, "Other file");
+	g_file_info_set_file_type (info, G_FILE_TYPE_REGULAR);
+	g_file_info_set_is_hidden (info, TRUE);
+	g_file_info_set_size (info, G_MAXUINT32 + 1ULL);
+
+	packed = tracker_packed_info_new (file, info);
+	g_assert_nonnull (packed);
+
+	unpacked = tracker_packed_info_unpack (packed, file);
+	check_same_info (info, unpacked);
+	g_assert_cmpstr (g_file_info_get_name (unpacked), ==, "other.txt");
+	g_assert_cmpstr (g_file_info_get_display_name (unpacked), ==, "Other file");
+	g_assert_true (g_file_info_get_is_hidden (unpacked));
+	g_assert_cmpuint (g_file_info_get_size (unpacked), ==, G_MAXUINT32 + 1ULL);
+
+	tracker_packed_info_free (packed);
+}
+
+static void
+test_packed_info_unknown (void)
+{
+	g_autoptr (GFile) file = NULL;
+	g_autoptr (GFileInfo) info = NULL;
+
+	file = g_file_new_for_path ("/test/file.txt");
+
+	info = g_file_info_new ();
+	g_file_info_set_file_type (info, G_FILE_TYPE_REGULAR);
+	g_file_info_set_content_type (info, "text/plain");
+	g_assert_null (tracker_packed_info_new (file, info));
+
+	/* Known attribute, but unexpected type */
+	g_clear_object (&info);
+	info = g_file_info_new ();
+	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_SIZE, "1");
+	g_assert_null (tracker_packed_info_new (file, info));
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-packed-info/file",
+	                 test_packed_info_file);
+	g_test_add_func ("/libtracker-miner/tracker-packed-info/names",
+	                 test_packed_info_names);
+	g_test_add_func ("/libtracker-miner/tracker-packed-info/unknown",
+	                 test_packed_info_unknown);
+
+	return g_test_run ();
+}
@@ -193,6 +193,76 @@ test_priority_queue_foreach_remove (void)
         tracker_priority_queue_unref (queue);
 }
 
+static void
+test_priority_queue_remove_node (void)
+{
+        TrackerPriorityQueue *queue;
+        GList                *first, *middle, *last, *other;
+        gint                  priority;
+
+        queue = tracker_priority_queue_new ();
+
+        first = tracker_priority_queue_add (queue, "a", 5);
+        middle = tracker_priority_queue_add (queue, "b", 5);
+        last = tracker_priority_queue_add (queue, "c", 5);
+        other = tracker_priority_queue_add (queue, "d", 1);
+
+        /* Middle, first and last elements of a priority */
+        tracker_priority_queue_remove_node (queue, middle);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 3);
+        tracker_priority_queue_remove_node (queue, first);
+        tracker_priority_queue_remove_node (queue, other);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 1);
+
+        g_assert_cmpstr (tracker_priority_queue_peek (queue, &priority), ==, "c");
+        g_assert_cmpint (priority, ==, 5);
+
+        tracker_priority_queue_remove_node (queue, last);
+        g_assert_true (tracker_priority_queue_is_empty (queue));
+        g_assert_null (tracker_priority_queue_peek (queue, NULL));
+
+        tracker_priority_queue_unref (queue);
+}
+
+static void
+test_priority_queue_flows (void)
+{
+        TrackerPriorityQueue *queue;
+        GList                *node;
+        gint                  flow_a, flow_b;
+
+        queue = tracker_priority_queue_new ();
+
+        /* Flows of the same priority take turns, each in order */
+        tracker_priority_queue_add_full (queue, "a1", 5, &flow_a);
+        tracker_priority_queue_add_full (queue, "a2", 5, &flow_a);
+        node = tracker_priority_queue_add_full (queue, "a3", 5, &flow_a);
+        tracker_priority_queue_add_full (queue, "b1", 5, &flow_b);
+        tracker_priority_queue_add_full (queue, "b2", 5, &flow_b);
+        tracker_priority_queue_add_full (queue, "c1", 1, &flow_b);
+
+        g_assert_cmpstr (tracker_priority_queue_pop (queue, NULL), ==, "c1");
+        g_assert_cmpstr (tracker_priority_queue_pop (queue, NULL), ==, "a1");
+        g_assert_cmpstr (tracker_priority_queue_peek (queue, NULL), ==, "b1");
+        g_assert_cmpstr (tracker_priority_queue_pop (queue, NULL), ==, "b1");
+        g_assert_cmpstr (tracker_priority_queue_pop (queue, NULL), ==, "a2");
+
+        tracker_priority_queue_remove_node (queue, node);
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 1);
+        g_assert_cmpstr (tracker_priority_queue_pop (queue, NULL), ==, "b2");
+        g_assert_true (tracker_priority_queue_is_empty (queue));
+
+        /* Removing elements across flows */
+        tracker_priority_queue_add_full (queue, g_strdup ("x"), 5, &flow_a);
+        tracker_priority_queue_add_full (queue, g_strdup ("x"), 5, &flow_b);
+        tracker_priority_queue_add_full (queue, g_strdup ("y"), 5, &flow_b);
+        g_assert_true (tracker_priority_queue_foreach_remove (queue, g_str_equal, "x", g_free));
+        g_assert_cmpint (tracker_priority_queue_get_length (queue), ==, 1);
+        g_free (tracker_priority_queue_pop (queue, NULL));
+
+        tracker_priority_queue_unref (queue);
+}
+
 static void
 test_priority_queue_branches (void)
 {
@@ -254,6 +324,10 @@ main (int    argc,
 	                 test_priority_queue_foreach);
 	g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach_remove",
 	                 test_priority_queue_foreach_remove);
+	g_test_add_func ("/libtracker-miner/tracker-priority-queue/remove_node",
+	                 test_priority_queue_remove_node);
+	g_test_add_func ("/libtracker-miner/tracker-priority-queue/flows",
+	                 test_priority_queue_flows);
 
         g_test_add_func ("/libtracker-miner/tracker-priority-queue/branches",
                          test_priority_queue_branches);
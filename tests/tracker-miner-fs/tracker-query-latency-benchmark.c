@@ -0,0 +1,918 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Query latency benchmark: export the store of a minimal TrackerMinerFS
+ * subclass through a D-Bus endpoint, like tracker-miner-fs does, and run
+ * a read workload of application-like queries against it while a synthetic
+ * tree is crawled and its documents get text inserted. The same workload
+ * then runs on the idle store for comparison.
+ *
+ * Reports reader latency percentiles per query, and the indexer throughput,
+ * eg.:
+ *   tracker-query-latency-benchmark --readers=4 --queries=fts,count --scale=2
+ */
+
+#include "config-miners.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <tracker-miner-fs.h>
+#include <libtracker-miners-common/tracker-common.h>
+
+typedef enum {
+	QUERY_FTS,
+	QUERY_LIST,
+	QUERY_COUNT,
+	N_QUERIES
+} QueryKind;
+
+typedef enum {
+	PHASE_INDEXING,
+	PHASE_IDLE,
+	N_PHASES
+} Phase;
+
+typedef struct {
+	TrackerMinerFS parent_instance;
+	GAsyncQueue *extract_queue;
+	guint n_processed;
+	guint finished : 1;
+} BenchMiner;
+
+typedef struct {
+	TrackerMinerFSClass parent_class;
+} BenchMinerClass;
+
+typedef struct {
+	TrackerMinerFS *miner;
+	TrackerSparqlConnection *connection;
+	TrackerEndpointDBus *endpoint;
+	GDBusConnection *server_conn;
+	GDBusConnection *client_conn;
+	TrackerSparqlConnection *bus_connection;
+	gchar *root_path;
+	GFile *root;
+	guint n_files;
+	guint n_dirs;
+
+	GAsyncQueue *extract_queue;
+	GThread *extractor;
+	guint n_extracted;
+
+	GPtrArray *readers;
+	gint stop_readers;
+	gint n_running_readers;
+	GArray *latencies[N_PHASES][N_QUERIES];
+} Bench;
+
+typedef struct {
+	Bench *bench;
+	GThread *thread;
+	GRand *rand;
+	GArray *latencies[N_QUERIES];
+} Reader;
+
+static gint n_readers = 2;
+static gint interval = 10;
+static gchar *query_names = NULL;
+static gint scale = 1;
+static gint batch_size = 50;
+static gdouble throttle = 0;
+static gint idle_seconds = 3;
+static gboolean in_memory = FALSE;
+
+static GOptionEntry entries[] = {
+	{ "readers", 'r', 0, G_OPTION_ARG_INT, &n_readers,
+	  "Number of threads running queries", "N" },
+	{ "interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+	  "Milliseconds each reader waits between queries", "MS" },
+	{ "queries", 'q', 0, G_OPTION_ARG_STRING, &query_names,
+	  "Comma separated queries to run (fts, list, count), all by default", "NAMES" },
+	{ "scale", 'n', 0, G_OPTION_ARG_INT, &scale,
+	  "Multiply the size of the generated tree", "N" },
+	{ "batch-size", 'b', 0, G_OPTION_ARG_INT, &batch_size,
+	  "Number of documents inserted per extraction batch", "N" },
+	{ "throttle", 't', 0, G_OPTION_ARG_DOUBLE, &throttle,
+	  "Throttle of the miner, between 0 and 1", "VALUE" },
+	{ "idle-seconds", 'd', 0, G_OPTION_ARG_INT, &idle_seconds,
+	  "Seconds to run the queries on the idle store", "SECONDS" },
+	{ "in-memory", 'm', 0, G_OPTION_ARG_NONE, &in_memory,
+	  "Use an in-memory store instead of an on-disk one", NULL },
+	{ NULL }
+};
+
+/* Mimics the queries of tracker3 search, and of file managers
+ * listing and counting the indexed files.
+ */
+static const struct {
+	const gchar *name;
+	const gchar *sparql;
+} queries[] = {
+	{ "fts",
+	  "SELECT ?document ?u fts:snippet(?document, '[', ']') "
+	  "WHERE {"
+	  "  GRAPH tracker:Documents {"
+	  "    ?document a nfo:Document ;"
+	  "      nie:isStoredAs ?u ;"
+	  "      fts:match ~term ."
+	  "  }"
+	  "} "
+	  "ORDER BY DESC(fts:rank(?document)) "
+	  "LIMIT 10" },
+	{ "list",
+	  "SELECT ?u "
+	  "WHERE {"
+	  "  GRAPH tracker:FileSystem {"
+	  "    ?file a nfo:FileDataObject ;"
+	  "      nie:url ?u ."
+	  "  }"
+	  "} "
+	  "ORDER BY ASC(?u) "
+	  "OFFSET ~offset "
+	  "LIMIT 50" },
+	{ "count",
+	  "SELECT (COUNT(?file) AS ?count) "
+	  "WHERE {"
+	  "  GRAPH tracker:FileSystem {"
+	  "    ?file a nfo:FileDataObject ."
+	  "  }"
+	  "}" },
+};
+
+static const gchar *phase_names[] = {
+	"indexing",
+	"idle",
+};
+
+static const gchar *vocabulary[] = {
+	"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+	"hotel", "india", "juliett", "kilo", "lima", "mike", "november",
+	"oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform",
+	"victor", "whiskey", "xray", "yankee", "zulu", "report", "invoice",
+	"holiday", "meeting", "budget", "recipe",
+};
+
+#define WORDS_PER_DOCUMENT 64
+
+/* Pushed to the extraction queue after the last file */
+static gchar extract_done[] = "";
+
+static gboolean enabled_queries[N_QUERIES];
+
+G_DEFINE_TYPE (BenchMiner, bench_miner, TRACKER_TYPE_MINER_FS)
+
+static void
+bench_miner_process_file (TrackerMinerFS      *fs,
+                          GFile               *file,
+                          GFileInfo           *info,
+                          TrackerSparqlBuffer *buffer,
+                          gboolean             created)
+{
+	BenchMiner *miner = (BenchMiner *) fs;
+	g_autoptr (TrackerResource) resource = NULL;
+	g_autoptr (GFile) parent = NULL;
+	g_autofree gchar *uri = NULL, *parent_uri = NULL, *root_uri = NULL;
+	TrackerIndexingTree *tree;
+	gboolean is_dir;
+	GFile *root;
+
+	miner->n_processed++;
+	miner->finished = FALSE;
+
+	uri = g_file_get_uri (file);
+	resource = tracker_resource_new (uri);
+	is_dir = info && g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY;
+
+	if (is_dir)
+		tracker_resource_add_uri (resource, "rdf:type", "nfo:Folder");
+
+	tracker_resource_add_uri (resource, "rdf:type", "nfo:FileDataObject");
+	tracker_resource_add_uri (resource, "rdf:type", "nie:InformationElement");
+	tracker_resource_add_relation (resource, "nie:interpretedAs", resource);
+	tracker_resource_add_relation (resource, "nie:isStoredAs", resource);
+	tracker_resource_set_string (resource, "nie:url", uri);
+
+	tree = tracker_miner_fs_get_indexing_tree (fs);
+
+	if (tracker_indexing_tree_file_is_root (tree, file)) {
+		tracker_resource_set_uri (resource, "nie:rootElementOf", uri);
+		tracker_resource_add_uri (resource, "rdf:type", "nie:DataSource");
+	}
+
+	root = tracker_indexing_tree_get_root (tree, file, NULL);
+	if (root) {
+		root_uri = g_file_get_uri (root);
+		tracker_resource_set_uri (resource, "nie:dataSource", root_uri);
+	}
+
+	parent = g_file_get_parent (file);
+	parent_uri = g_file_get_uri (parent);
+	tracker_resource_set_uri (resource, "nfo:belongsToContainer", parent_uri);
+
+	tracker_sparql_buffer_log_file (buffer, file, "tracker:FileSystem", resource, NULL, NULL);
+
+	/* Regular files are handed over to the extraction thread */
+	if (!is_dir)
+		g_async_queue_push (miner->extract_queue, g_steal_pointer (&uri));
+}
+
+static void
+bench_miner_process_file_attributes (TrackerMinerFS      *fs,
+                                     GFile               *file,
+                                     GFileInfo           *info,
+                                     TrackerSparqlBuffer *buffer)
+{
+	bench_miner_process_file (fs, file, info, buffer, FALSE);
+}
+
+static void
+bench_miner_remove_file (TrackerMinerFS      *fs,
+                         GFile               *file,
+                         TrackerSparqlBuffer *buffer,
+                         gboolean             is_dir)
+{
+	tracker_sparql_buffer_log_delete (buffer, file);
+	if (is_dir)
+		tracker_sparql_buffer_log_delete_content (buffer, file);
+}
+
+static void
+bench_miner_remove_children (TrackerMinerFS      *fs,
+                             GFile               *file,
+                             TrackerSparqlBuffer *buffer)
+{
+	tracker_sparql_buffer_log_delete_content (buffer, file);
+}
+
+static void
+bench_miner_move_file (TrackerMinerFS      *fs,
+                       GFile               *dest,
+                       GFile               *source,
+                       TrackerSparqlBuffer *buffer,
+                       gboolean             recursive)
+{
+	tracker_sparql_buffer_log_move (buffer, source, dest, NULL);
+
+	if (recursive)
+		tracker_sparql_buffer_log_move_content (buffer, source, dest);
+}
+
+static void
+bench_miner_finished (TrackerMinerFS *fs,
+                      gdouble         elapsed,
+                      gint            directories_found,
+                      gint            directories_ignored,
+                      gint            files_found,
+                      gint            files_ignored)
+{
+	((BenchMiner *) fs)->finished = TRUE;
+}
+
+static void
+bench_miner_class_init (BenchMinerClass *klass)
+{
+	TrackerMinerFSClass *fs_class = TRACKER_MINER_FS_CLASS (klass);
+
+	fs_class->process_file = bench_miner_process_file;
+	fs_class->process_file_attributes = bench_miner_process_file_attributes;
+	fs_class->remove_file = bench_miner_remove_file;
+	fs_class->remove_children = bench_miner_remove_children;
+	fs_class->move_file = bench_miner_move_file;
+	fs_class->finished = bench_miner_finished;
+}
+
+static void
+bench_miner_init (BenchMiner *miner)
+{
+}
+
+/* Tree generation */
+static gchar *
+bench_generate_text (GRand *rand)
+{
+	GString *str;
+	guint i;
+
+	str = g_string_new (NULL);
+
+	for (i = 0; i < WORDS_PER_DOCUMENT; i++) {
+		if (i > 0)
+			g_string_append_c (str, ' ');
+		g_string_append (str, vocabulary[g_rand_int_range (rand, 0, G_N_ELEMENTS (vocabulary))]);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+bench_create_files (Bench       *bench,
+                    const gchar *dir,
+                    guint        n_files)
+{
+	guint i;
+
+	for (i = 0; i < n_files; i++) {
+		g_autofree gchar *basename = NULL, *path = NULL;
+		g_autoptr (GError) error = NULL;
+
+		basename = g_strdup_printf ("file-%05u.txt", i);
+		path = g_build_filename (dir, basename, NULL);
+
+		if (!g_file_set_contents (path, "x", 1, &error))
+			g_error ("Could not create %s: %s", path, error->message);
+
+		bench->n_files++;
+	}
+}
+
+static void
+bench_create_tree (Bench       *bench,
+                   const gchar *dir,
+                   guint        depth,
+                   guint        fanout,
+                   guint        n_files)
+{
+	guint i;
+
+	bench_create_files (bench, dir, n_files);
+
+	if (depth == 0)
+		return;
+
+	for (i = 0; i < fanout; i++) {
+		g_autofree gchar *basename = NULL, *path = NULL;
+
+		basename = g_strdup_printf ("dir-%03u", i);
+		path = g_build_filename (dir, basename, NULL);
+
+		if (g_mkdir_with_parents (path, 0700) < 0)
+			g_error ("Could not create %s: %m", path);
+
+		bench->n_dirs++;
+		bench_create_tree (bench, path, depth - 1, fanout, n_files);
+	}
+}
+
+/* Synthetic extraction, inserts the text of the crawled files
+ * in batches, as tracker-extract does.
+ */
+static void
+bench_execute_batch (TrackerBatch **batch)
+{
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_batch_execute (*batch, NULL, &error))
+		g_error ("Could not insert documents: %s", error->message);
+
+	g_clear_object (batch);
+}
+
+static gpointer
+extractor_thread_func (gpointer user_data)
+{
+	Bench *bench = user_data;
+	g_autoptr (TrackerBatch) batch = NULL;
+	g_autoptr (GRand) rand = NULL;
+	gint n_batched = 0;
+	gchar *uri;
+
+	rand = g_rand_new_with_seed (0);
+
+	while ((uri = g_async_queue_pop (bench->extract_queue)) != extract_done) {
+		g_autoptr (TrackerResource) resource = NULL;
+		g_autofree gchar *text = NULL;
+
+		if (!batch)
+			batch = tracker_sparql_connection_create_batch (bench->connection);
+
+		text = bench_generate_text (rand);
+
+		resource = tracker_resource_new (uri);
+		tracker_resource_add_uri (resource, "rdf:type", "nfo:Document");
+		tracker_resource_set_uri (resource, "nie:isStoredAs", uri);
+		tracker_resource_set_string (resource, "nie:plainTextContent", text);
+		tracker_batch_add_resource (batch, "tracker:Documents", resource);
+		g_free (uri);
+
+		bench->n_extracted++;
+
+		if (++n_batched >= batch_size) {
+			bench_execute_batch (&batch);
+			n_batched = 0;
+		}
+	}
+
+	if (batch)
+		bench_execute_batch (&batch);
+
+	return NULL;
+}
+
+/* Readers */
+static void
+reader_run_query (Reader                 *reader,
+                  TrackerSparqlStatement *stmt,
+                  QueryKind               kind)
+{
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+	gint64 start, elapsed;
+
+	if (kind == QUERY_FTS) {
+		tracker_sparql_statement_bind_string (stmt, "term",
+		                                      vocabulary[g_rand_int_range (reader->rand, 0, G_N_ELEMENTS (vocabulary))]);
+	} else if (kind == QUERY_LIST) {
+		tracker_sparql_statement_bind_int (stmt, "offset",
+		                                   g_rand_int_range (reader->rand, 0, reader->bench->n_files + 1));
+	}
+
+	start = g_get_monotonic_time ();
+
+	/* Queries on the endpoint only finish when the results are read */
+	cursor = tracker_sparql_statement_execute (stmt, NULL, &error);
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, &error))
+		;
+
+	if (error)
+		g_error ("Could not run %s query: %s", queries[kind].name, error->message);
+
+	elapsed = g_get_monotonic_time () - start;
+	g_array_append_val (reader->latencies[kind], elapsed);
+}
+
+static gpointer
+reader_thread_func (gpointer user_data)
+{
+	Reader *reader = user_data;
+	Bench *bench = reader->bench;
+	TrackerSparqlStatement *stmts[N_QUERIES] = { NULL, };
+	QueryKind kind;
+
+	for (kind = 0; kind < N_QUERIES; kind++) {
+		g_autoptr (GError) error = NULL;
+
+		if (!enabled_queries[kind])
+			continue;
+
+		stmts[kind] = tracker_sparql_connection_query_statement (bench->bus_connection,
+		                                                         queries[kind].sparql,
+		                                                         NULL, &error);
+		if (!stmts[kind])
+			g_error ("Could not prepare %s query: %s", queries[kind].name, error->message);
+	}
+
+	while (!g_atomic_int_get (&bench->stop_readers)) {
+		for (kind = 0; kind < N_QUERIES; kind++) {
+			if (!stmts[kind])
+				continue;
+
+			reader_run_query (reader, stmts[kind], kind);
+
+			if (interval > 0)
+				g_usleep (interval * 1000);
+		}
+	}
+
+	for (kind = 0; kind < N_QUERIES; kind++)
+		g_clear_object (&stmts[kind]);
+
+	g_atomic_int_dec_and_test (&bench->n_running_readers);
+
+	return NULL;
+}
+
+static void
+bench_start_readers (Bench *bench)
+{
+	gint i;
+
+	g_atomic_int_set (&bench->stop_readers, FALSE);
+	g_atomic_int_set (&bench->n_running_readers, n_readers);
+	bench->readers = g_ptr_array_new ();
+
+	for (i = 0; i < n_readers; i++) {
+		Reader *reader;
+		QueryKind kind;
+
+		reader = g_new0 (Reader, 1);
+		reader->bench = bench;
+		reader->rand = g_rand_new_with_seed (i);
+
+		for (kind = 0; kind < N_QUERIES; kind++)
+			reader->latencies[kind] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+		reader->thread = g_thread_new ("reader", reader_thread_func, reader);
+		g_ptr_array_add (bench->readers, reader);
+	}
+}
+
+/* Stops the readers and merges their samples into those of @phase */
+static void
+bench_stop_readers (Bench *bench,
+                    Phase  phase)
+{
+	guint i;
+
+	g_atomic_int_set (&bench->stop_readers, TRUE);
+
+	/* The endpoint replies from the main context, keep it running
+	 * until the readers are done with their last query.
+	 */
+	while (g_atomic_int_get (&bench->n_running_readers) > 0) {
+		if (!g_main_context_iteration (NULL, FALSE))
+			g_usleep (1000);
+	}
+
+	for (i = 0; i < bench->readers->len; i++) {
+		Reader *reader = g_ptr_array_index (bench->readers, i);
+		QueryKind kind;
+
+		g_thread_join (reader->thread);
+
+		for (kind = 0; kind < N_QUERIES; kind++) {
+			g_array_append_vals (bench->latencies[phase][kind],
+			                     reader->latencies[kind]->data,
+			                     reader->latencies[kind]->len);
+			g_array_unref (reader->latencies[kind]);
+		}
+
+		g_rand_free (reader->rand);
+		g_free (reader);
+	}
+
+	g_clear_pointer (&bench->readers, g_ptr_array_unref);
+}
+
+/* Measurement */
+static void
+bench_iterate (gint64 usec)
+{
+	gint64 end = g_get_monotonic_time () + usec;
+
+	while (g_get_monotonic_time () < end) {
+		if (!g_main_context_iteration (NULL, FALSE))
+			g_usleep (1000);
+	}
+}
+
+static void
+bench_print_rate (const gchar *label,
+                  guint        n_items,
+                  gint64       usec)
+{
+	gdouble secs = usec / (gdouble) G_USEC_PER_SEC;
+
+	g_print ("%-24s %8u items in %8.3f s, %10.1f items/s\n",
+	         label, n_items, secs,
+	         secs > 0 ? n_items / secs : 0.0);
+}
+
+static gint
+compare_latencies (gconstpointer a,
+                   gconstpointer b)
+{
+	gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+	return (la > lb) - (la < lb);
+}
+
+static gdouble
+get_percentile (GArray *latencies,
+                guint   percentile)
+{
+	guint idx;
+
+	idx = MIN ((latencies->len * percentile) / 100, latencies->len - 1);
+
+	return g_array_index (latencies, gint64, idx) / 1000.0;
+}
+
+static void
+bench_print_latencies (Bench *bench)
+{
+	Phase phase;
+	QueryKind kind;
+
+	g_print ("\n%-8s %-10s %8s %10s %10s %10s\n",
+	         "query", "phase", "count", "p50 ms", "p99 ms", "max ms");
+
+	for (kind = 0; kind < N_QUERIES; kind++) {
+		if (!enabled_queries[kind])
+			continue;
+
+		for (phase = 0; phase < N_PHASES; phase++) {
+			GArray *latencies = bench->latencies[phase][kind];
+
+			if (latencies->len == 0) {
+				g_print ("%-8s %-10s %8u\n", queries[kind].name, phase_names[phase], 0);
+				continue;
+			}
+
+			g_array_sort (latencies, compare_latencies);
+			g_print ("%-8s %-10s %8u %10.2f %10.2f %10.2f\n",
+			         queries[kind].name, phase_names[phase], latencies->len,
+			         get_percentile (latencies, 50),
+			         get_percentile (latencies, 99),
+			         g_array_index (latencies, gint64, latencies->len - 1) / 1000.0);
+		}
+	}
+}
+
+static void
+bench_run (Bench *bench)
+{
+	BenchMiner *miner = (BenchMiner *) bench->miner;
+	gint64 start, crawl_time, extract_time;
+
+	/* 3 levels of 10 directories, 10 files in each */
+	bench_create_tree (bench, bench->root_path, 3, 10, 10 * scale);
+
+	start = g_get_monotonic_time ();
+	bench->extractor = g_thread_new ("extractor", extractor_thread_func, bench);
+	bench_start_readers (bench);
+
+	tracker_indexing_tree_add (tracker_miner_fs_get_indexing_tree (bench->miner),
+	                           bench->root,
+	                           TRACKER_DIRECTORY_FLAG_CHECK_MTIME |
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_miner_start (TRACKER_MINER (bench->miner));
+
+	/* The root itself is processed too */
+	while (miner->n_processed < bench->n_files + bench->n_dirs + 1 ||
+	       !miner->finished)
+		g_main_context_iteration (NULL, TRUE);
+
+	crawl_time = g_get_monotonic_time () - start;
+
+	g_async_queue_push (bench->extract_queue, extract_done);
+	g_thread_join (bench->extractor);
+	bench->extractor = NULL;
+	extract_time = g_get_monotonic_time () - start;
+
+	bench_stop_readers (bench, PHASE_INDEXING);
+
+	bench_print_rate ("crawl", miner->n_processed, crawl_time);
+	bench_print_rate ("extraction", bench->n_extracted, extract_time);
+
+	/* Same workload with nothing else going on */
+	bench_start_readers (bench);
+	bench_iterate (idle_seconds * G_USEC_PER_SEC);
+	bench_stop_readers (bench, PHASE_IDLE);
+
+	bench_print_latencies (bench);
+}
+
+/* Setup */
+static void
+connection_ready_cb (GObject      *source,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+	GDBusConnection **conn = user_data;
+	g_autoptr (GError) error = NULL;
+
+	*conn = g_dbus_connection_new_finish (res, &error);
+	if (!*conn)
+		g_error ("Could not create D-Bus connection: %s", error->message);
+}
+
+static void
+bus_connection_ready_cb (GObject      *source,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+	Bench *bench = user_data;
+	g_autoptr (GError) error = NULL;
+
+	bench->bus_connection = tracker_sparql_connection_bus_new_finish (res, &error);
+	if (!bench->bus_connection)
+		g_error ("Could not connect to endpoint: %s", error->message);
+}
+
+static GIOStream *
+create_stream (gint fd)
+{
+	g_autoptr (GSocket) socket = NULL;
+	g_autoptr (GError) error = NULL;
+
+	socket = g_socket_new_from_fd (fd, &error);
+	if (!socket)
+		g_error ("Could not create socket: %s", error->message);
+
+	return G_IO_STREAM (g_socket_connection_factory_create_connection (socket));
+}
+
+/* Peer to peer D-Bus connection, the endpoint is served on one side
+ * and the readers query through the other one.
+ */
+static void
+bench_setup_endpoint (Bench *bench)
+{
+	g_autoptr (GIOStream) server_stream = NULL, client_stream = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *guid = NULL;
+	gint fds[2];
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+		g_error ("Could not create socket pair: %m");
+
+	server_stream = create_stream (fds[0]);
+	client_stream = create_stream (fds[1]);
+	guid = g_dbus_generate_guid ();
+
+	g_dbus_connection_new (server_stream, guid,
+	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER |
+	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_ALLOW_ANONYMOUS,
+	                       NULL, NULL,
+	                       connection_ready_cb, &bench->server_conn);
+	g_dbus_connection_new (client_stream, NULL,
+	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+	                       NULL, NULL,
+	                       connection_ready_cb, &bench->client_conn);
+
+	while (!bench->server_conn || !bench->client_conn)
+		g_main_context_iteration (NULL, TRUE);
+
+	bench->endpoint = tracker_endpoint_dbus_new (bench->connection,
+	                                             bench->server_conn,
+	                                             NULL, NULL, &error);
+	if (!bench->endpoint)
+		g_error ("Could not create endpoint: %s", error->message);
+
+	tracker_sparql_connection_bus_new_async (NULL, NULL, bench->client_conn, NULL,
+	                                         bus_connection_ready_cb, bench);
+
+	while (!bench->bus_connection)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+bench_setup (Bench *bench)
+{
+	g_autoptr (GFile) ontology = NULL, db = NULL;
+	g_autoptr (TrackerIndexingTree) indexing_tree = NULL;
+	g_autoptr (GError) error = NULL;
+	g_autofree gchar *path = NULL;
+	Phase phase;
+	QueryKind kind;
+
+	path = g_build_filename (g_get_tmp_dir (), "tracker-query-latency-benchmark-XXXXXX", NULL);
+	if (!g_mkdtemp_full (path, 0700))
+		g_error ("Could not create temporary directory: %m");
+
+	bench->root_path = g_build_filename (path, "tree", NULL);
+	g_mkdir (bench->root_path, 0700);
+	bench->root = g_file_new_for_path (bench->root_path);
+
+	if (!in_memory)
+		db = g_file_new_build_filename (path, "db", NULL);
+
+	ontology = tracker_sparql_get_ontology_nepomuk ();
+	bench->connection = tracker_sparql_connection_new (0, db, ontology, NULL, &error);
+	if (!bench->connection)
+		g_error ("Could not create store: %s", error->message);
+
+	tracker_sparql_connection_update (bench->connection,
+	                                  "CREATE SILENT GRAPH tracker:FileSystem; "
+	                                  "CREATE SILENT GRAPH tracker:Documents",
+	                                  NULL, &error);
+	if (error)
+		g_error ("Could not create graphs: %s", error->message);
+
+	bench_setup_endpoint (bench);
+
+	bench->extract_queue = g_async_queue_new ();
+
+	indexing_tree = tracker_indexing_tree_new ();
+	bench->miner = g_object_new (bench_miner_get_type (),
+	                             "indexing-tree", indexing_tree,
+	                             "connection", bench->connection,
+	                             "file-attributes", "standard::*,time::*",
+	                             "throttle", throttle,
+	                             NULL);
+	((BenchMiner *) bench->miner)->extract_queue = bench->extract_queue;
+
+	for (phase = 0; phase < N_PHASES; phase++) {
+		for (kind = 0; kind < N_QUERIES; kind++)
+			bench->latencies[phase][kind] = g_array_new (FALSE, FALSE, sizeof (gint64));
+	}
+}
+
+static void
+bench_teardown (Bench *bench)
+{
+	g_autofree gchar *base_path = NULL, *command = NULL;
+	Phase phase;
+	QueryKind kind;
+
+	g_clear_object (&bench->miner);
+	g_clear_object (&bench->bus_connection);
+	g_clear_object (&bench->endpoint);
+	g_clear_object (&bench->client_conn);
+	g_clear_object (&bench->server_conn);
+	g_clear_object (&bench->connection);
+	g_clear_object (&bench->root);
+	g_clear_pointer (&bench->extract_queue, g_async_queue_unref);
+
+	for (phase = 0; phase < N_PHASES; phase++) {
+		for (kind = 0; kind < N_QUERIES; kind++)
+			g_array_unref (bench->latencies[phase][kind]);
+	}
+
+	base_path = g_path_get_dirname (bench->root_path);
+	command = g_strdup_printf ("rm -rf '%s'", base_path);
+	if (system (command) != 0)
+		g_warning ("Could not remove %s", base_path);
+
+	g_free (bench->root_path);
+}
+
+static gboolean
+parse_queries (const gchar *names)
+{
+	g_auto (GStrv) split = NULL;
+	QueryKind kind;
+	guint i;
+
+	if (!names) {
+		for (kind = 0; kind < N_QUERIES; kind++)
+			enabled_queries[kind] = TRUE;
+		return TRUE;
+	}
+
+	split = g_strsplit (names, ",", -1);
+
+	for (i = 0; split[i]; i++) {
+		for (kind = 0; kind < N_QUERIES; kind++) {
+			if (g_strcmp0 (queries[kind].name, g_strstrip (split[i])) == 0)
+				break;
+		}
+
+		if (kind == N_QUERIES)
+			return FALSE;
+
+		enabled_queries[kind] = TRUE;
+	}
+
+	return i > 0;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_autoptr (GOptionContext) context = NULL;
+	g_autoptr (GError) error = NULL;
+	Bench bench = { 0, };
+
+	context = g_option_context_new ("- Benchmark query latency while indexing");
+	g_option_context_add_main_entries (context, entries, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (!parse_queries (query_names)) {
+		g_printerr ("Available queries: fts, list, count\n");
+		return EXIT_FAILURE;
+	}
+
+	if (scale < 1 || n_readers < 1 || interval < 0 ||
+	    batch_size < 1 || idle_seconds < 0 ||
+	    throttle < 0 || throttle > 1) {
+		g_printerr ("Invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	bench_setup (&bench);
+
+	g_print ("Readers: %d, interval %d ms, scale %d, batch size %d, throttle %.2f, %s store\n",
+	         n_readers, interval, scale, batch_size, throttle,
+	         in_memory ? "in-memory" : "on-disk");
+	bench_run (&bench);
+
+	bench_teardown (&bench);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026, The Tracker developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <tracker-spill-queue.h>
+
+static GFile *
+get_file (guint i)
+{
+	g_autofree gchar *path = NULL;
+
+	path = g_strdup_printf ("/test/directory with spaces/%05u/ñ", i);
+
+	return g_file_new_for_path (path);
+}
+
+static void
+check_file (GFile *file,
+            guint  i)
+{
+	g_autoptr (GFile) expected = NULL;
+
+	expected = get_file (i);
+	g_assert_true (g_file_equal (file, expected));
+}
+
+static void
+count_file (GFile *file,
+            guint *count)
+{
+	check_file (file, *count);
+	(*count)++;
+}
+
+static void
+test_spill_queue_empty (void)
+{
+	TrackerSpillQueue *queue;
+
+	queue = tracker_spill_queue_new ();
+	g_assert_cmpuint (tracker_spill_queue_get_length (queue), ==, 0);
+	g_assert_null (tracker_spill_queue_pop (queue));
+	tracker_spill_queue_free (queue);
+}
+
+static void
+test_spill_queue_push_pop (void)
+{
+	TrackerSpillQueue *queue;
+	guint i, count = 0, n_items = 20000;
+
+	queue = tracker_spill_queue_new ();
+
+	/* Enough items to need several reads */
+	for (i = 0; i < n_items; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = get_file (i);
+		g_assert_true (tracker_spill_queue_push (queue, file));
+	}
+
+	g_assert_cmpuint (tracker_spill_queue_get_length (queue), ==, n_items);
+
+	/* Pop some, then check the remaining are iterated in order */
+	for (i = 0; i < n_items / 2; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = tracker_spill_queue_pop (queue);
+		check_file (file, i);
+	}
+
+	count = n_items / 2;
+	tracker_spill_queue_foreach (queue, (GFunc) count_file, &count);
+	g_assert_cmpuint (count, ==, n_items);
+
+	for (i = n_items / 2; i < n_items; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = tracker_spill_queue_pop (queue);
+		check_file (file, i);
+	}
+
+	g_assert_cmpuint (tracker_spill_queue_get_length (queue), ==, 0);
+	g_assert_null (tracker_spill_queue_pop (queue));
+
+	tracker_spill_queue_free (queue);
+}
+
+static void
+test_spill_queue_interleaved (void)
+{
+	TrackerSpillQueue *queue;
+	guint i, pushed = 0, popped = 0;
+
+	queue = tracker_spill_queue_new ();
+
+	for (i = 0; i < 1000; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = get_file (pushed++);
+		tracker_spill_queue_push (queue, file);
+
+		if (i % 3 == 0) {
+			g_autoptr (GFile) next = NULL;
+
+			next = tracker_spill_queue_pop (queue);
+			check_file (next, popped++);
+		}
+	}
+
+	while (tracker_spill_queue_get_length (queue) > 0) {
+		g_autoptr (GFile) next = NULL;
+
+		next = tracker_spill_queue_pop (queue);
+		check_file (next, popped++);
+	}
+
+	g_assert_cmpuint (pushed, ==, popped);
+
+	/* Pushing after the queue got emptied starts over */
+	for (i = 0; i < 10; i++) {
+		g_autoptr (GFile) file = NULL;
+
+		file = get_file (pushed++);
+		tracker_spill_queue_push (queue, file);
+	}
+
+	for (i = 0; i < 10; i++) {
+		g_autoptr (GFile) next = NULL;
+
+		next = tracker_spill_queue_pop (queue);
+		check_file (next, popped++);
+	}
+
+	tracker_spill_queue_free (queue);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-miner/tracker-spill-queue/empty",
+	                 test_spill_queue_empty);
+	g_test_add_func ("/libtracker-miner/tracker-spill-queue/push-pop",
+	                 test_spill_queue_push_pop);
+	g_test_add_func ("/libtracker-miner/tracker-spill-queue/interleaved",
+	                 test_spill_queue_interleaved);
+
+	return g_test_run ();
+}